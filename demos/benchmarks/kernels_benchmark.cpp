@@ -0,0 +1,448 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+// Measures the pre- and postprocessing kernels of the demos on synthetic network
+// outputs of the sizes of the demo models, so no model or device is needed. A line
+// per kernel holds the runs, the mean, median and minimal time of a call and a
+// checksum of the result, which changes if an optimization changes the result.
+// The optional argument selects the kernels whose names contain it.
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <inference_engine.hpp>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include <pose/peak.hpp>
+#include <samples/assignment.hpp>
+#include <samples/embeddings.hpp>
+#include <samples/hwc_to_chw.hpp>
+#include <samples/microbenchmark.hpp>
+#include <samples/nms.hpp>
+#include <samples/ocv_common.hpp>
+#include <samples/yolo_region.hpp>
+
+#include "detectionoutput.h"
+#include "distance.hpp"
+#include "text_detection.hpp"
+#include "text_recognition.hpp"
+
+namespace {
+const int kWarmupRuns = 3;
+const int kMinRuns = 10;
+const double kMinTotalMs = 300;
+
+// the human pose estimation demo: 18 keypoints, the maps of a 456x256 input upsampled to a stride of 2
+const size_t kKeypointsNumber = 18;
+const cv::Size kPoseMapSize(228, 128);
+const int kPeople = 8;
+
+// OpenPose keypoint positions of a person of a unit height standing at the origin
+const cv::Point2f kSkeleton[kKeypointsNumber] = {
+    {0.0f, -0.42f}, {0.0f, -0.3f}, {-0.1f, -0.3f}, {-0.14f, -0.15f}, {-0.16f, 0.0f}, {0.1f, -0.3f},
+    {0.14f, -0.15f}, {0.16f, 0.0f}, {-0.06f, 0.05f}, {-0.07f, 0.27f}, {-0.07f, 0.48f}, {0.06f, 0.05f},
+    {0.07f, 0.27f}, {0.07f, 0.48f}, {-0.02f, -0.45f}, {0.02f, -0.45f}, {-0.04f, -0.43f}, {0.04f, -0.43f}
+};
+// the limbs of groupPeaksToPoses: the 1-based keypoints and the PAF channels offset by kKeypointsNumber + 1
+const std::pair<int, int> kLimbKeypoints[] = {
+    {2, 3}, {2, 6}, {3, 4}, {4, 5}, {6, 7}, {7, 8}, {2, 9}, {9, 10}, {10, 11}, {2, 12}, {12, 13}, {13, 14},
+    {2, 1}, {1, 15}, {15, 17}, {1, 16}, {16, 18}, {3, 17}, {6, 18}
+};
+const std::pair<int, int> kLimbPafs[] = {
+    {31, 32}, {39, 40}, {33, 34}, {35, 36}, {41, 42}, {43, 44}, {19, 20}, {21, 22}, {23, 24}, {25, 26},
+    {27, 28}, {29, 30}, {47, 48}, {49, 50}, {53, 54}, {51, 52}, {55, 56}, {37, 38}, {45, 46}
+};
+
+// YOLO V3 of a 416x416 input: three scales of 3 anchors and 80 classes
+const int kYoloInputSize = 416;
+const int kYoloClasses = 80;
+const int kYoloAnchorsNumber = 3;
+const int kYoloCoords = 4;
+
+// Faster R-CNN of the object detection demo
+const int kProposals = 300;
+const int kRcnnClasses = 21;
+const cv::Size kRcnnInputSize(1000, 600);
+
+// PixelLink of the text detection demo, its maps have a stride of 4
+const cv::Size kTextInputSize(1280, 768);
+const int kTextRegions = 30;
+const int kTextRecognitionTimesteps = 30;
+const int kWordsNumber = 30;
+const std::string kAlphabet = "0123456789abcdefghijklmnopqrstuvwxyz#";
+const char kPadSymbol = '#';
+
+const int kEmbeddingSize = 256;
+
+template <typename F>
+void Measure(const std::string &filter, const std::string &name, F run) {
+    if (name.find(filter) == std::string::npos) {
+        return;
+    }
+    double checksum = 0;
+    BenchmarkSamples times = measureRuns([&](int) { checksum = run(); }, kWarmupRuns, kMinRuns, kMinTotalMs);
+    std::cout << name << '\t' << times.size() << '\t' << times.mean() << '\t'
+              << times.median() << '\t' << times.min() << '\t' << checksum << std::endl;
+}
+
+InferenceEngine::Blob::Ptr MakeBlob(const InferenceEngine::SizeVector &dims) {
+    auto blob = InferenceEngine::make_shared_blob<float>(
+        InferenceEngine::TensorDesc(InferenceEngine::Precision::FP32, dims,
+                                    InferenceEngine::TensorDesc::getLayoutByDims(dims)));
+    blob->allocate();
+    return blob;
+}
+
+float *BlobData(const InferenceEngine::Blob::Ptr &blob) {
+    return blob->buffer().as<float *>();
+}
+
+// Heatmaps with a gaussian at every keypoint of every person and the background map,
+// PAFs with the unit vectors of the limbs along them
+void MakePoseMaps(cv::RNG *rng, std::vector<cv::Mat> *heat_maps, std::vector<cv::Mat> *pafs) {
+    heat_maps->resize(kKeypointsNumber + 1);
+    for (auto &map : *heat_maps) {
+        map.create(kPoseMapSize, CV_32F);
+        rng->fill(map, cv::RNG::UNIFORM, 0.0f, 0.02f);
+    }
+    pafs->resize(2 * (sizeof(kLimbPafs) / sizeof(*kLimbPafs)));
+    for (auto &map : *pafs) {
+        map = cv::Mat::zeros(kPoseMapSize, CV_32F);
+    }
+
+    const float sigma = 2.0f;
+    const int radius = 6;
+    for (int person = 0; person < kPeople; person++) {
+        const float height = rng->uniform(0.45f, 0.8f) * kPoseMapSize.height;
+        const cv::Point2f center((person + 0.5f) * kPoseMapSize.width / kPeople,
+                                 kPoseMapSize.height / 2.0f + rng->uniform(-0.1f, 0.1f) * kPoseMapSize.height);
+        std::vector<cv::Point2f> keypoints(kKeypointsNumber);
+        for (size_t k = 0; k < kKeypointsNumber; k++) {
+            keypoints[k] = center + kSkeleton[k] * height;
+            cv::Mat &map = (*heat_maps)[k];
+            const int cx = cvRound(keypoints[k].x), cy = cvRound(keypoints[k].y);
+            for (int y = std::max(0, cy - radius); y <= std::min(map.rows - 1, cy + radius); y++) {
+                for (int x = std::max(0, cx - radius); x <= std::min(map.cols - 1, cx + radius); x++) {
+                    const float dx = x - keypoints[k].x, dy = y - keypoints[k].y;
+                    float &value = map.at<float>(y, x);
+                    value = std::max(value, std::exp(-(dx * dx + dy * dy) / (2 * sigma * sigma)));
+                }
+            }
+        }
+        for (size_t limb = 0; limb < sizeof(kLimbPafs) / sizeof(*kLimbPafs); limb++) {
+            const cv::Point2f a = keypoints[kLimbKeypoints[limb].first - 1];
+            const cv::Point2f b = keypoints[kLimbKeypoints[limb].second - 1];
+            const cv::Point2f direction = (b - a) / std::max(static_cast<float>(cv::norm(b - a)), 1e-5f);
+            cv::line((*pafs)[kLimbPafs[limb].first - kKeypointsNumber - 1], a, b, direction.x, 3);
+            cv::line((*pafs)[kLimbPafs[limb].second - kKeypointsNumber - 1], a, b, direction.y, 3);
+        }
+    }
+    cv::Mat keypoints_max = (*heat_maps)[0].clone();
+    for (size_t k = 1; k < kKeypointsNumber; k++) {
+        keypoints_max = cv::max(keypoints_max, (*heat_maps)[k]);
+    }
+    (*heat_maps)[kKeypointsNumber] = 1.0f - keypoints_max;
+}
+
+// A RegionYolo output of side x side cells, about one cell in a hundred holds an object
+std::vector<float> MakeYoloOutput(cv::RNG *rng, int side) {
+    const int side_square = side * side;
+    const int entry = kYoloCoords + 1 + kYoloClasses;
+    std::vector<float> output(static_cast<size_t>(kYoloAnchorsNumber) * entry * side_square);
+    cv::Mat all(1, static_cast<int>(output.size()), CV_32F, output.data());
+    rng->fill(all, cv::RNG::UNIFORM, 0.0f, 0.05f);
+    for (int n = 0; n < kYoloAnchorsNumber; n++) {
+        float *anchor = output.data() + static_cast<size_t>(n) * entry * side_square;
+        for (int i = 0; i < side_square; i++) {
+            anchor[0 * side_square + i] = rng->uniform(0.0f, 1.0f);
+            anchor[1 * side_square + i] = rng->uniform(0.0f, 1.0f);
+            anchor[2 * side_square + i] = static_cast<float>(rng->gaussian(0.5));
+            anchor[3 * side_square + i] = static_cast<float>(rng->gaussian(0.5));
+            if (rng->uniform(0.0f, 1.0f) < 0.01f) {
+                anchor[kYoloCoords * side_square + i] = rng->uniform(0.6f, 1.0f);
+                anchor[(kYoloCoords + 1 + rng->uniform(0, kYoloClasses)) * side_square + i] = rng->uniform(0.8f, 1.0f);
+            }
+        }
+    }
+    return output;
+}
+
+// Clusters of the overlapping boxes a detector outputs around every object
+NmsBoxes MakeNmsBoxes(cv::RNG *rng, int objects, int boxes_per_object, int labels) {
+    NmsBoxes boxes;
+    for (int object = 0; object < objects; object++) {
+        const float x = rng->uniform(0.0f, 1800.0f), y = rng->uniform(0.0f, 1000.0f);
+        const float w = rng->uniform(20.0f, 200.0f), h = rng->uniform(20.0f, 200.0f);
+        const int label = rng->uniform(0, labels);
+        for (int i = 0; i < boxes_per_object; i++) {
+            const float dx = rng->uniform(-0.1f, 0.1f) * w, dy = rng->uniform(-0.1f, 0.1f) * h;
+            boxes.push_back(x + dx, y + dy, x + dx + w, y + dy + h, rng->uniform(0.3f, 1.0f), label);
+        }
+    }
+    return boxes;
+}
+
+// Scores of the recognition model for a word: every char is followed by some repeats or pads
+std::vector<float> MakeWordScores(cv::RNG *rng) {
+    const int symbols = static_cast<int>(kAlphabet.size());
+    std::vector<float> scores(static_cast<size_t>(kTextRecognitionTimesteps) * symbols);
+    cv::Mat all(1, static_cast<int>(scores.size()), CV_32F, scores.data());
+    rng->fill(all, cv::RNG::NORMAL, 0.0f, 1.0f);
+    int symbol = symbols - 1;
+    for (int t = 0; t < kTextRecognitionTimesteps; t++) {
+        if (rng->uniform(0.0f, 1.0f) < 0.4f) {
+            symbol = rng->uniform(0.0f, 1.0f) < 0.3f ? symbols - 1 : rng->uniform(0, symbols - 1);
+        }
+        scores[static_cast<size_t>(t) * symbols + symbol] += rng->uniform(2.0f, 6.0f);
+    }
+    return scores;
+}
+
+double AssignmentCost(const cv::Mat &dissimilarity, const std::vector<size_t> &assignment) {
+    double cost = 0;
+    for (size_t i = 0; i < assignment.size(); i++) {
+        if (assignment[i] < static_cast<size_t>(dissimilarity.cols)) {
+            cost += dissimilarity.at<float>(static_cast<int>(i), static_cast<int>(assignment[i]));
+        }
+    }
+    return cost;
+}
+}  // namespace
+
+int main(int argc, char *argv[]) {
+    const std::string filter = argc > 1 ? argv[1] : "";
+    cv::RNG rng(0);
+    std::cout << std::fixed << std::setprecision(4) << "kernel\truns\tmean ms\tmedian ms\tmin ms\tchecksum"
+              << std::endl;
+
+    // ---------------------------------------- preprocessing ----------------------------------------
+    cv::Mat frame(1080, 1920, CV_8UC3);
+    rng.fill(frame, cv::RNG::UNIFORM, 0, 256);
+    InferenceEngine::Blob::Ptr ssd_input = MakeBlob({1, 3, 300, 300});
+    Measure(filter, "matU8ToBlob 1920x1080 to 300x300", [&] {
+        matU8ToBlob<float>(frame, ssd_input);
+        return static_cast<double>(BlobData(ssd_input)[0] + BlobData(ssd_input)[ssd_input->size() - 1]);
+    });
+    cv::Mat yolo_frame(kYoloInputSize, kYoloInputSize, CV_8UC3);
+    rng.fill(yolo_frame, cv::RNG::UNIFORM, 0, 256);
+    InferenceEngine::Blob::Ptr yolo_input = MakeBlob({1, 3, kYoloInputSize, kYoloInputSize});
+    Measure(filter, "matU8ToBlob 416x416 same size", [&] {
+        matU8ToBlob<float>(yolo_frame, yolo_input);
+        return static_cast<double>(BlobData(yolo_input)[0] + BlobData(yolo_input)[yolo_input->size() - 1]);
+    });
+    // the conversion of loadImgToIEGraph of the multi channel demos after the resize to the network input
+    std::vector<float> planes(3 * static_cast<size_t>(kYoloInputSize) * kYoloInputSize);
+    Measure(filter, "hwcU8ToChwF32 416x416", [&] {
+        hwcU8ToChwF32(yolo_frame.data, yolo_frame.step, yolo_frame.cols, yolo_frame.rows, 3, planes.data());
+        return static_cast<double>(planes.front() + planes.back());
+    });
+
+    // ---------------------------------------- human pose estimation ----------------------------------------
+    {
+        std::vector<cv::Mat> heat_maps, pafs;
+        MakePoseMaps(&rng, &heat_maps, &pafs);
+        std::vector<std::vector<human_pose_estimation::Peak>> peaks(kKeypointsNumber);
+        Measure(filter, "findPeaks 18 heatmaps 228x128", [&] {
+            size_t found = 0;
+            for (size_t k = 0; k < kKeypointsNumber; k++) {
+                peaks[k].clear();
+                human_pose_estimation::findPeaks(heat_maps, 3.0f, peaks, static_cast<int>(k));
+                found += peaks[k].size();
+            }
+            return static_cast<double>(found);
+        });
+        // the ids of the peaks of groupPeaksToPoses are global
+        int peaks_before = 0;
+        for (auto &heat_map_peaks : peaks) {
+            for (auto &peak : heat_map_peaks) {
+                peak.id += peaks_before;
+            }
+            peaks_before += static_cast<int>(heat_map_peaks.size());
+        }
+        human_pose_estimation::PoseGroupingScratch scratch;
+        auto poses_checksum = [](const std::vector<human_pose_estimation::HumanPose> &poses) {
+            double checksum = static_cast<double>(poses.size());
+            for (const auto &pose : poses) {
+                checksum += pose.score;
+            }
+            return checksum;
+        };
+        Measure(filter, "groupPeaksToPoses 8 people", [&] {
+            return poses_checksum(human_pose_estimation::groupPeaksToPoses(
+                peaks, pafs, kKeypointsNumber, 0.05f, 0.8f, 3, 0.2f, scratch));
+        });
+        Measure(filter, "findPoses 8 people", [&] {
+            return poses_checksum(human_pose_estimation::findPoses(
+                heat_maps, pafs, kKeypointsNumber, 3.0f, 0.05f, 0.8f, 3, 0.2f, false, scratch));
+        });
+    }
+
+    // ---------------------------------------- detection ----------------------------------------
+    {
+        const std::vector<std::pair<int, std::vector<float>>> scales = {
+            {13, {116, 90, 156, 198, 373, 326}}, {26, {30, 61, 62, 45, 59, 119}}, {52, {10, 13, 16, 30, 33, 23}}
+        };
+        std::vector<std::vector<float>> outputs;
+        for (const auto &scale : scales) {
+            outputs.push_back(MakeYoloOutput(&rng, scale.first));
+        }
+        NmsBoxes boxes;
+        Measure(filter, "decodeYoloRegion 416x416 3 scales", [&] {
+            boxes.clear();
+            for (size_t i = 0; i < scales.size(); i++) {
+                decodeYoloRegion(outputs[i].data(), scales[i].first, kYoloAnchorsNumber, kYoloCoords, kYoloClasses,
+                                 scales[i].second, 0.5f, cv::Size(kYoloInputSize, kYoloInputSize),
+                                 [&](float x, float y, float height, float width, int class_id, float prob) {
+                    boxes.push_back(x - width / 2, y - height / 2, x + width / 2, y + height / 2, prob, class_id);
+                });
+            }
+            return static_cast<double>(boxes.size());
+        });
+        const NmsBoxes clusters = MakeNmsBoxes(&rng, 100, 20, kYoloClasses);
+        Measure(filter, "nms 2000 boxes", [&] {
+            return static_cast<double>(nms(clusters, 0.4f).size());
+        });
+        Measure(filter, "nms 2000 boxes class agnostic", [&] {
+            return static_cast<double>(nms(clusters, 0.4f, true).size());
+        });
+    }
+    {
+        InferenceEngine::Blob::Ptr loc = MakeBlob({kProposals, 4 * kRcnnClasses});
+        InferenceEngine::Blob::Ptr conf = MakeBlob({kProposals, kRcnnClasses});
+        InferenceEngine::Blob::Ptr priors = MakeBlob({kProposals, 5});
+        cv::Mat deltas(1, static_cast<int>(loc->size()), CV_32F, BlobData(loc));
+        rng.fill(deltas, cv::RNG::NORMAL, 0.0f, 0.1f);
+        for (int i = 0; i < kProposals; i++) {
+            float *prior = BlobData(priors) + 5 * i;
+            const float x = rng.uniform(0.0f, 0.8f * kRcnnInputSize.width);
+            const float y = rng.uniform(0.0f, 0.8f * kRcnnInputSize.height);
+            prior[0] = 0;
+            prior[1] = x;
+            prior[2] = y;
+            prior[3] = x + rng.uniform(20.0f, 0.2f * kRcnnInputSize.width);
+            prior[4] = y + rng.uniform(20.0f, 0.2f * kRcnnInputSize.height);
+            // a softmax with most of the probability on a single class
+            float *probs = BlobData(conf) + kRcnnClasses * i;
+            const float top = rng.uniform(0.5f, 0.99f);
+            for (int c = 0; c < kRcnnClasses; c++) {
+                probs[c] = (1.0f - top) / (kRcnnClasses - 1);
+            }
+            probs[rng.uniform(0, kRcnnClasses)] = top;
+        }
+        DetectionOutputPostProcessor post_processor(
+            {1, 3, static_cast<size_t>(kRcnnInputSize.height), static_cast<size_t>(kRcnnInputSize.width)},
+            loc->getTensorDesc().getDims(), conf->getTensorDesc().getDims(), priors->getTensorDesc().getDims());
+        std::vector<InferenceEngine::Blob::Ptr> inputs = {loc, conf, priors};
+        std::vector<InferenceEngine::Blob::Ptr> detections = {MakeBlob({1, 1, 200, 7})};
+        Measure(filter, "DetectionOutputPostProcessor 300 proposals", [&] {
+            post_processor.execute(inputs, detections, nullptr);
+            const float *detection = BlobData(detections[0]);
+            double checksum = 0;
+            for (int i = 0; i < 200 && detection[7 * i] >= 0; i++) {
+                checksum += detection[7 * i + 2];
+            }
+            return checksum;
+        });
+    }
+
+    // ---------------------------------------- text ----------------------------------------
+    {
+        const int width = kTextInputSize.width / 4, height = kTextInputSize.height / 4;
+        InferenceEngine::Blob::Ptr cls = MakeBlob({1, 2, static_cast<size_t>(height), static_cast<size_t>(width)});
+        InferenceEngine::Blob::Ptr link = MakeBlob({1, 16, static_cast<size_t>(height), static_cast<size_t>(width)});
+        std::vector<cv::Mat> cls_planes, link_planes;
+        for (int c = 0; c < 2; c++) {
+            cls_planes.emplace_back(height, width, CV_32F, BlobData(cls) + c * width * height);
+        }
+        for (int c = 0; c < 16; c++) {
+            link_planes.emplace_back(height, width, CV_32F, BlobData(link) + c * width * height);
+        }
+        // the logits of the text and of the links of its pixels are the odd channels
+        cv::Mat text_mask = cv::Mat::zeros(height, width, CV_8U);
+        for (int i = 0; i < kTextRegions; i++) {
+            const cv::Point origin(rng.uniform(0, width - 40), rng.uniform(0, height - 10));
+            const cv::Size size(rng.uniform(10, 40), rng.uniform(3, 10));
+            cv::rectangle(text_mask, cv::Rect(origin, size), 255, cv::FILLED);
+        }
+        auto fill = [&](std::vector<cv::Mat> &maps) {
+            for (size_t c = 0; c < maps.size(); c++) {
+                rng.fill(maps[c], cv::RNG::NORMAL, 0.0f, 0.5f);
+                const bool text_channel = 1 == c % 2;
+                maps[c] += cv::Scalar(text_channel ? -3.0 : 3.0);
+                cv::add(maps[c], cv::Scalar(text_channel ? 6.0 : -6.0), maps[c], text_mask);
+            }
+        };
+        fill(cls_planes);
+        fill(link_planes);
+        InferenceEngine::BlobMap blobs = {{"cls", cls}, {"link", link}};
+        Measure(filter, "text detection postProcess 1280x768", [&] {
+            return static_cast<double>(postProcess(blobs, kTextInputSize, 0.8f, 0.8f).size());
+        });
+    }
+    {
+        std::vector<std::vector<float>> words;
+        for (int i = 0; i < kWordsNumber; i++) {
+            words.push_back(MakeWordScores(&rng));
+        }
+        auto decode = [&](int bandwidth) {
+            double checksum = 0;
+            for (const auto &scores : words) {
+                double conf = 0;
+                const std::string word = 0 == bandwidth
+                    ? CTCGreedyDecoder(scores.data(), kTextRecognitionTimesteps, kAlphabet.size(), kAlphabet,
+                                       kPadSymbol, &conf)
+                    : CTCBeamSearchDecoder(scores.data(), kTextRecognitionTimesteps, kAlphabet.size(), kAlphabet,
+                                           kPadSymbol, &conf, bandwidth);
+                checksum += static_cast<double>(word.size()) + conf;
+            }
+            return checksum;
+        };
+        Measure(filter, "CTCGreedyDecoder 30 words", [&] {
+            return decode(0);
+        });
+        Measure(filter, "CTCBeamSearchDecoder 30 words bandwidth 10", [&] {
+            return decode(10);
+        });
+    }
+
+    // ---------------------------------------- tracking ----------------------------------------
+    for (int size : {50, 200}) {
+        cv::Mat dissimilarity(size, size, CV_32F);
+        rng.fill(dissimilarity, cv::RNG::UNIFORM, 0.0f, 1.0f);
+        Measure(filter, "AssignmentSolver::solve " + std::to_string(size) + "x" + std::to_string(size), [&] {
+            return AssignmentCost(dissimilarity, AssignmentSolver().solve(dissimilarity));
+        });
+    }
+    {
+        std::vector<cv::Mat> tracks(100), detections(100);
+        for (auto &embedding : tracks) {
+            embedding.create(kEmbeddingSize, 1, CV_32F);
+            rng.fill(embedding, cv::RNG::NORMAL, 0.0f, 1.0f);
+        }
+        for (auto &embedding : detections) {
+            embedding.create(kEmbeddingSize, 1, CV_32F);
+            rng.fill(embedding, cv::RNG::NORMAL, 0.0f, 1.0f);
+        }
+        CosDistance distance(cv::Size(1, kEmbeddingSize));
+        Measure(filter, "CosDistance::Compute 100 pairs", [&] {
+            const std::vector<float> distances = distance.Compute(tracks, detections);
+            double checksum = 0;
+            for (float value : distances) {
+                checksum += value;
+            }
+            return checksum;
+        });
+        Measure(filter, "NormalizedEmbeddings::similarities 100x100", [&] {
+            return cv::sum(NormalizedEmbeddings::similarities(NormalizedEmbeddings(tracks),
+                                                              NormalizedEmbeddings(detections)))[0];
+        });
+    }
+    return 0;
+}
@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+"""
+ Copyright (c) 2020 Intel Corporation
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+"""
+
+# Compares two per layer performance counter reports written by the -pc_report option of the demos, e.g. of
+# two devices or of FP32 and INT8 models, and lists the layers and the layer types with the greatest change of
+# the real time. Layers are matched by name, layer types are compared in total, so runs of models with
+# differently fused layers are still comparable by type.
+
+import argparse
+import json
+import sys
+
+
+def build_argparser():
+    parser = argparse.ArgumentParser(
+        description='Compares two per layer performance counter reports written by the -pc_report option of the demos')
+    parser.add_argument('baseline', help='Report of the reference run')
+    parser.add_argument('candidate', help='Report of the run to compare with the reference')
+    parser.add_argument('--metric', choices=('mean', 'p95'), default='mean',
+                        help='Statistic of the real time to compare')
+    parser.add_argument('-n', '--top', type=int, default=20, help='Number of layers to list')
+    parser.add_argument('-t', '--threshold', type=float, default=10.0,
+                        help='Percentage of the time increase which is reported as a regression')
+    parser.add_argument('--fail_on_regression', action='store_true',
+                        help='Exit with a non-zero status if any layer or layer type regresses')
+    return parser
+
+
+def load(path, metric):
+    with open(path) as report_file:
+        report = json.load(report_file)
+    layers = {layer['name']: layer for layer in report['layers']}
+    times = {name: layer['real_us'][metric] for name, layer in layers.items()}
+    types = {}
+    for layer in layers.values():
+        types[layer['type']] = types.get(layer['type'], 0.0) + layer['real_us'][metric]
+    return report, layers, times, types
+
+
+def change(baseline, candidate):
+    if baseline > 0:
+        return 100.0 * (candidate - baseline) / baseline
+    return float('inf') if candidate > 0 else 0.0
+
+
+def print_table(title, rows, threshold):
+    print(title)
+    print('{:<40} {:>14} {:>14} {:>14} {:>9}'.format('', 'baseline, us', 'candidate, us', 'delta, us', 'change'))
+    regressions = 0
+    for name, baseline, candidate in rows:
+        percent = change(baseline, candidate)
+        regressed = percent > threshold
+        regressions += regressed
+        shown = name if len(name) < 40 else name[:36] + '...'
+        print('{:<40} {:>14.1f} {:>14.1f} {:>+14.1f} {:>8.1f}%{}'.format(
+            shown, baseline, candidate, candidate - baseline, percent, ' REGRESSION' if regressed else ''))
+    print()
+    return regressions
+
+
+def main():
+    args = build_argparser().parse_args()
+    baseline_report, baseline_layers, baseline_times, baseline_types = load(args.baseline, args.metric)
+    candidate_report, candidate_layers, candidate_times, candidate_types = load(args.candidate, args.metric)
+
+    print('Baseline:  {} ({} inferences), total {:.1f} us'.format(
+        baseline_report['device'], baseline_report['iterations'], baseline_report['total_us'][args.metric]))
+    print('Candidate: {} ({} inferences), total {:.1f} us'.format(
+        candidate_report['device'], candidate_report['iterations'], candidate_report['total_us'][args.metric]))
+    print()
+
+    common = [name for name in baseline_times if name in candidate_times]
+    common.sort(key=lambda name: abs(candidate_times[name] - baseline_times[name]), reverse=True)
+    regressions = print_table('Layers by the change of the {} real time:'.format(args.metric),
+                              [(name, baseline_times[name], candidate_times[name]) for name in common[:args.top]],
+                              args.threshold)
+
+    types = sorted(set(baseline_types) | set(candidate_types),
+                   key=lambda layer_type: abs(candidate_types.get(layer_type, 0.0)
+                                              - baseline_types.get(layer_type, 0.0)), reverse=True)
+    regressions += print_table('Layer types by the change of the total {} real time:'.format(args.metric),
+                               [(layer_type, baseline_types.get(layer_type, 0.0), candidate_types.get(layer_type, 0.0))
+                                for layer_type in types], args.threshold)
+
+    only_baseline = sorted(set(baseline_layers) - set(candidate_layers))
+    only_candidate = sorted(set(candidate_layers) - set(baseline_layers))
+    if only_baseline:
+        print('{} layers are only in the baseline, e.g. {}'.format(len(only_baseline), ', '.join(only_baseline[:5])))
+    if only_candidate:
+        print('{} layers are only in the candidate, e.g. {}'.format(len(only_candidate), ', '.join(only_candidate[:5])))
+
+    if args.fail_on_regression and regressions:
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,103 @@
+// Copyright (C) 2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "allocation_counter.h"
+
+#ifdef MONITORS_COUNT_ALLOCATIONS
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+// threads add to different shards so that counting doesn't make the allocating threads contend on a cache line.
+// The counters are constant initialized and work for allocations of static initializers too
+constexpr unsigned SHARDS_NUMBER = 32;
+
+struct alignas(64) Shard {
+    std::atomic<std::uint64_t> allocatedBytes;
+    std::atomic<std::uint64_t> allocations;
+};
+
+Shard shards[SHARDS_NUMBER];
+std::atomic<unsigned> nextShard{0};
+thread_local unsigned threadShard = 0;  // 1-based, 0 if it isn't assigned yet
+
+void count(std::size_t size) {
+    if (0 == threadShard) {
+        threadShard = nextShard.fetch_add(1, std::memory_order_relaxed) % SHARDS_NUMBER + 1;
+    }
+    Shard& shard = shards[threadShard - 1];
+    shard.allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    shard.allocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+void* allocate(std::size_t size) {
+    count(size);
+    while (true) {
+        if (void* ptr = std::malloc(0 == size ? 1 : size)) {
+            return ptr;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (nullptr == handler) {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+void* allocateNothrow(std::size_t size) noexcept {
+    try {
+        return allocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+}
+
+void* operator new(std::size_t size) {
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size) {
+    return allocate(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return allocateNothrow(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return allocateNothrow(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+    std::free(ptr);
+}
+
+AllocationStats getAllocationStats() {
+    AllocationStats stats{true, 0, 0};
+    for (const Shard& shard : shards) {
+        stats.allocatedBytes += shard.allocatedBytes.load(std::memory_order_relaxed);
+        stats.allocations += shard.allocations.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+#else
+AllocationStats getAllocationStats() {
+    return {false, 0, 0};
+}
+#endif
@@ -0,0 +1,15 @@
+// Copyright (C) 2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include <cstdint>
+
+struct AllocationStats {
+    bool counted;  // false if the monitors are built without MONITORS_COUNT_ALLOCATIONS
+    std::uint64_t allocatedBytes;  // by operator new since the process start
+    std::uint64_t allocations;
+};
+
+AllocationStats getAllocationStats();
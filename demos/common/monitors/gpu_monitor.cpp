@@ -0,0 +1,386 @@
+// Copyright (C) 2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "gpu_monitor.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <string>
+
+namespace {
+const double UNAVAILABLE = std::numeric_limits<double>::quiet_NaN();
+
+typedef std::chrono::duration<double, std::chrono::seconds::period> Sec;
+}
+
+#ifdef _WIN32
+#include "query_wrapper.h"
+#include <system_error>
+#include <vector>
+#include <pdhmsg.h>
+#include <windows.h>
+
+namespace {
+// the instances of the GPU counters are named pid_<pid>_luid_<adapter>_phys_<n>_eng_<n>_engtype_<type>
+const std::wstring processInstancePrefix = L"pid_" + std::to_wstring(GetCurrentProcessId()) + L"_";
+
+std::vector<PDH_FMT_COUNTERVALUE_ITEM_W> getCounterArray(PDH_HCOUNTER counter, std::vector<char>& buffer) {
+    DWORD bufferSize = 0, itemCount = 0;
+    PDH_STATUS status = PdhGetFormattedCounterArrayW(counter, PDH_FMT_DOUBLE, &bufferSize, &itemCount, nullptr);
+    if (PDH_MORE_DATA != status) {
+        return {};  // no process instances yet
+    }
+    buffer.resize(bufferSize);
+    auto items = reinterpret_cast<PDH_FMT_COUNTERVALUE_ITEM_W*>(buffer.data());
+    status = PdhGetFormattedCounterArrayW(counter, PDH_FMT_DOUBLE, &bufferSize, &itemCount, items);
+    if (ERROR_SUCCESS != status) {
+        throw std::system_error(status, std::system_category(), "PdhGetFormattedCounterArrayW() failed");
+    }
+    std::vector<PDH_FMT_COUNTERVALUE_ITEM_W> processItems;
+    for (DWORD i = 0; i < itemCount; ++i) {
+        if (0 == std::wstring{items[i].szName}.compare(0, processInstancePrefix.size(), processInstancePrefix)
+                && (PDH_CSTATUS_VALID_DATA == items[i].FmtValue.CStatus
+                    || PDH_CSTATUS_NEW_DATA == items[i].FmtValue.CStatus)) {
+            processItems.push_back(items[i]);
+        }
+    }
+    return processItems;
+}
+}
+
+class GpuMonitor::PerformanceCounter {
+public:
+    PerformanceCounter() : engineCounter{nullptr}, dedicatedCounter{nullptr}, sharedCounter{nullptr} {
+        // the counters exist since Windows 10 1709, older systems just don't report the GPU state
+        if (ERROR_SUCCESS != PdhAddCounterW(query, L"\\GPU Engine(*)\\Utilization Percentage", 0, &engineCounter)) {
+            engineCounter = nullptr;
+        } else {
+            PdhSetCounterScaleFactor(engineCounter, -2); // scale counter to [0, 1]
+        }
+        if (ERROR_SUCCESS != PdhAddCounterW(query, L"\\GPU Process Memory(*)\\Dedicated Usage", 0, &dedicatedCounter)
+                || ERROR_SUCCESS != PdhAddCounterW(query, L"\\GPU Process Memory(*)\\Shared Usage", 0,
+                    &sharedCounter)) {
+            dedicatedCounter = sharedCounter = nullptr;
+        }
+        PDH_STATUS status = PdhCollectQueryData(query);
+        if (ERROR_SUCCESS != status) {
+            throw std::system_error(status, std::system_category(), "PdhCollectQueryData() failed");
+        }
+    }
+
+    GpuState getGpuState() {
+        PDH_STATUS status = PdhCollectQueryData(query);
+        if (ERROR_SUCCESS != status) {
+            throw std::system_error(status, std::system_category(), "PdhCollectQueryData() failed");
+        }
+        GpuState state{UNAVAILABLE, UNAVAILABLE, UNAVAILABLE};
+        if (nullptr != engineCounter) {
+            state.busy = 0.0;
+            for (const auto& item : getCounterArray(engineCounter, buffer)) {
+                state.busy = std::max(state.busy, std::min(1.0, item.FmtValue.doubleValue));
+            }
+        }
+        if (nullptr != dedicatedCounter) {
+            double bytes = 0.0;
+            for (PDH_HCOUNTER counter : {dedicatedCounter, sharedCounter}) {
+                for (const auto& item : getCounterArray(counter, buffer)) {
+                    bytes += item.FmtValue.doubleValue;
+                }
+            }
+            state.memory = bytes / (1024 * 1024 * 1024);
+        }
+        return state;
+    }
+
+    double getHardwareMaxFrequency() const {
+        return UNAVAILABLE;
+    }
+
+private:
+    QueryWrapper query;
+    PDH_HCOUNTER engineCounter;
+    PDH_HCOUNTER dedicatedCounter;
+    PDH_HCOUNTER sharedCounter;
+    std::vector<char> buffer;
+};
+
+#elif __linux__
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <dirent.h>
+#include <sys/utsname.h>
+
+namespace {
+bool readNumber(const std::string& path, double& value) {
+    std::ifstream file(path);
+    return static_cast<bool>(file >> value);
+}
+
+// the sysfs directory of the first card bound to the i915 driver, empty if there is none
+std::string findI915Card() {
+    std::string card;
+    DIR* drm = opendir("/sys/class/drm");
+    if (nullptr == drm) {
+        return card;
+    }
+    std::set<std::string> cards;  // sorted, so the choice doesn't depend on the directory order
+    while (dirent* entry = readdir(drm)) {
+        std::string name = entry->d_name;
+        // skip connectors like card0-HDMI-A-1 and render nodes
+        if (0 == name.compare(0, 4, "card") && std::string::npos == name.find('-')) {
+            cards.insert(name);
+        }
+    }
+    closedir(drm);
+    for (const std::string& name : cards) {
+        std::ifstream uevent("/sys/class/drm/" + name + "/device/uevent");
+        std::string line;
+        while (std::getline(uevent, line)) {
+            if ("DRIVER=i915" == line) {
+                return "/sys/class/drm/" + name + "/";
+            }
+        }
+    }
+    return card;
+}
+
+// the drm-* keys of /proc/<pid>/fdinfo appeared in Linux 5.19
+bool fdinfoReportsDrmUsage() {
+    utsname name;
+    int major = 0, minor = 0;
+    return 0 == uname(&name) && 2 == std::sscanf(name.release, "%d.%d", &major, &minor)
+        && (major > 5 || (5 == major && minor >= 19));
+}
+
+struct DrmUsage {
+    bool clientOpened = false;
+    bool engineTimesReported = false;
+    bool memoryReported = false;
+    std::map<std::string, double> engineTimes;  // sec of the engine class busy with the process work
+    std::map<std::string, unsigned> engineCapacities;  // engines of the class
+    double memory = 0.0;  // bytes
+};
+
+double toBytes(const std::string& value) {
+    std::istringstream stream(value);
+    double number = 0.0;
+    std::string unit;
+    stream >> number >> unit;
+    if ("KiB" == unit) {
+        return number * 1024;
+    } else if ("MiB" == unit) {
+        return number * 1024 * 1024;
+    } else if ("GiB" == unit) {
+        return number * 1024 * 1024 * 1024;
+    }
+    return number;
+}
+
+// sums the usage of the i915 clients the process has opened. Several descriptors may refer to one client
+DrmUsage getDrmUsage() {
+    DrmUsage usage;
+    DIR* fds = opendir("/proc/self/fdinfo");
+    if (nullptr == fds) {
+        return usage;
+    }
+    std::set<std::string> countedClients;
+    while (dirent* fd = readdir(fds)) {
+        if ('.' == fd->d_name[0]) {
+            continue;
+        }
+        std::ifstream fdinfo(std::string("/proc/self/fdinfo/") + fd->d_name);
+        std::map<std::string, std::string> keys;
+        std::string line;
+        while (std::getline(fdinfo, line)) {
+            std::size_t colon = line.find(':');
+            if (0 == line.compare(0, 4, "drm-") && std::string::npos != colon) {
+                std::size_t valueBegin = line.find_first_not_of(" \t", colon + 1);
+                keys[line.substr(0, colon)] = std::string::npos == valueBegin ? "" : line.substr(valueBegin);
+            }
+        }
+        if ("i915" != keys["drm-driver"] || !countedClients.insert(keys["drm-client-id"]).second) {
+            continue;
+        }
+        usage.clientOpened = true;
+        double resident = 0.0, total = 0.0;
+        bool residentReported = false;
+        for (const auto& key : keys) {
+            const std::string capacityPrefix = "drm-engine-capacity-", enginePrefix = "drm-engine-";
+            if (0 == key.first.compare(0, capacityPrefix.size(), capacityPrefix)) {
+                usage.engineCapacities[key.first.substr(capacityPrefix.size())] = std::stoul(key.second);
+            } else if (0 == key.first.compare(0, enginePrefix.size(), enginePrefix)) {
+                usage.engineTimesReported = true;
+                usage.engineTimes[key.first.substr(enginePrefix.size())] += std::stod(key.second) * 1e-9;
+            } else if (0 == key.first.compare(0, 13, "drm-resident-")) {
+                residentReported = usage.memoryReported = true;
+                resident += toBytes(key.second);
+            } else if (0 == key.first.compare(0, 10, "drm-total-")) {
+                usage.memoryReported = true;
+                total += toBytes(key.second);
+            }
+        }
+        usage.memory += residentReported ? resident : total;
+    }
+    closedir(fds);
+    return usage;
+}
+}
+
+class GpuMonitor::PerformanceCounter {
+public:
+    PerformanceCounter() :
+            card{findI915Card()},
+            drmUsageReported{!card.empty() && fdinfoReportsDrmUsage()},
+            prevTimePoint{std::chrono::steady_clock::now()} {
+        if (drmUsageReported) {
+            prevDrmUsage = getDrmUsage();
+        }
+    }
+
+    GpuState getGpuState() {
+        GpuState state{UNAVAILABLE, UNAVAILABLE, UNAVAILABLE};
+        if (card.empty()) {
+            return state;
+        }
+        if (!readNumber(card + "gt_act_freq_mhz", state.frequency)
+                && !readNumber(card + "gt_cur_freq_mhz", state.frequency)) {
+            state.frequency = UNAVAILABLE;
+        }
+        if (drmUsageReported) {
+            auto timePoint = std::chrono::steady_clock::now();
+            DrmUsage drmUsage = getDrmUsage();
+            const double duration = std::chrono::duration_cast<Sec>(timePoint - prevTimePoint).count();
+            // a process that hasn't opened the GPU yet doesn't use it
+            if (!drmUsage.clientOpened || drmUsage.engineTimesReported) {
+                state.busy = 0.0;
+                for (const auto& engineTime : drmUsage.engineTimes) {
+                    unsigned capacity = std::max(1u, drmUsage.engineCapacities[engineTime.first]);
+                    double busyTime = engineTime.second - prevDrmUsage.engineTimes[engineTime.first];
+                    if (duration > 0.0) {
+                        state.busy = std::max(state.busy, std::min(1.0, busyTime / capacity / duration));
+                    }
+                }
+            }
+            if (!drmUsage.clientOpened || drmUsage.memoryReported) {
+                state.memory = drmUsage.memory / (1024 * 1024 * 1024);
+            }
+            prevDrmUsage = std::move(drmUsage);
+            prevTimePoint = timePoint;
+        }
+        return state;
+    }
+
+    double getHardwareMaxFrequency() const {
+        double frequency;
+        if (!card.empty()
+                && (readNumber(card + "gt_RP0_freq_mhz", frequency) || readNumber(card + "gt_max_freq_mhz", frequency))) {
+            return frequency;
+        }
+        return UNAVAILABLE;
+    }
+
+private:
+    const std::string card;
+    const bool drmUsageReported;
+    DrmUsage prevDrmUsage;
+    std::chrono::steady_clock::time_point prevTimePoint;
+};
+
+#else
+// not implemented
+class GpuMonitor::PerformanceCounter {
+public:
+    GpuState getGpuState() {return {UNAVAILABLE, UNAVAILABLE, UNAVAILABLE};}
+    double getHardwareMaxFrequency() const {return UNAVAILABLE;}
+};
+#endif
+
+void GpuMonitor::Mean::add(double value) {
+    if (!std::isnan(value)) {
+        sum += value;
+        ++samplesNumber;
+    }
+}
+
+double GpuMonitor::Mean::get() const {
+    return 0 == samplesNumber ? UNAVAILABLE : sum / samplesNumber;
+}
+
+GpuMonitor::GpuMonitor() :
+    historySize{0},
+    busy{0.0, 0},
+    frequency{0.0, 0},
+    memory{0.0, 0},
+    maxFrequency{UNAVAILABLE},
+    maxMemory{UNAVAILABLE} {}
+
+// PerformanceCounter is incomplete in header and destructor can't be defined implicitly
+GpuMonitor::~GpuMonitor() = default;
+
+void GpuMonitor::setHistorySize(std::size_t size) {
+    if (0 == historySize && 0 != size) {
+        performanceCounter.reset(new PerformanceCounter);
+        double hardwareMaxFrequency = performanceCounter->getHardwareMaxFrequency();
+        if (!std::isnan(hardwareMaxFrequency)) {
+            maxFrequency = hardwareMaxFrequency;
+        }
+    } else if (0 != historySize && 0 == size) {
+        performanceCounter.reset();
+    }
+    historySize = size;
+    std::size_t newSize = std::min(size, gpuStateHistory.size());
+    gpuStateHistory.erase(gpuStateHistory.begin(), gpuStateHistory.end() - newSize);
+}
+
+void GpuMonitor::collectData() {
+    GpuState gpuState = performanceCounter->getGpuState();
+
+    busy.add(gpuState.busy);
+    frequency.add(gpuState.frequency);
+    memory.add(gpuState.memory);
+    // std::max() with NaN depends on the argument order, keep the first available value
+    if (!std::isnan(gpuState.frequency) && !(maxFrequency >= gpuState.frequency)) {
+        maxFrequency = gpuState.frequency;
+    }
+    if (!std::isnan(gpuState.memory) && !(maxMemory >= gpuState.memory)) {
+        maxMemory = gpuState.memory;
+    }
+
+    gpuStateHistory.push_back(gpuState);
+    if (gpuStateHistory.size() > historySize) {
+        gpuStateHistory.pop_front();
+    }
+}
+
+std::size_t GpuMonitor::getHistorySize() const {
+    return historySize;
+}
+
+std::deque<GpuState> GpuMonitor::getLastHistory() const {
+    return gpuStateHistory;
+}
+
+double GpuMonitor::getMeanBusy() const {
+    return busy.get();
+}
+
+double GpuMonitor::getMeanFrequency() const {
+    return frequency.get();
+}
+
+double GpuMonitor::getMaxFrequency() const {
+    return maxFrequency;
+}
+
+double GpuMonitor::getMeanMemory() const {
+    return memory.get();
+}
+
+double GpuMonitor::getMaxMemory() const {
+    return maxMemory;
+}
@@ -0,0 +1,45 @@
+// Copyright (C) 2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include <deque>
+#include <memory>
+
+// a value of a sample is NaN if the system doesn't report it
+struct GpuState {
+    double busy;  // the busiest engine share of time running the process work, [0, 1]
+    double frequency;  // MHz
+    double memory;  // GiB of the process allocations on the device
+};
+
+class GpuMonitor {
+public:
+    GpuMonitor();
+    ~GpuMonitor();
+    void setHistorySize(std::size_t size);
+    std::size_t getHistorySize() const;
+    void collectData();
+    std::deque<GpuState> getLastHistory() const;
+    double getMeanBusy() const;
+    double getMeanFrequency() const;
+    double getMaxFrequency() const; // the hardware limit if the system reports it, the observed max otherwise
+    double getMeanMemory() const;
+    double getMaxMemory() const;
+
+private:
+    struct Mean {
+        double sum;
+        unsigned samplesNumber;
+        void add(double value);
+        double get() const;
+    };
+
+    unsigned historySize;
+    Mean busy, frequency, memory;
+    double maxFrequency, maxMemory;
+    std::deque<GpuState> gpuStateHistory;
+    class PerformanceCounter;
+    std::unique_ptr<PerformanceCounter> performanceCounter;
+};
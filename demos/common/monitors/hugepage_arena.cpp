@@ -0,0 +1,148 @@
+// Copyright (C) 2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "hugepage_arena.h"
+
+#include <algorithm>
+#include <limits>
+#include <new>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace {
+// the larger sizes would overflow the sizes of their classes
+const std::size_t maxBlockSize = std::size_t(1) << (std::numeric_limits<std::size_t>::digits - 2);
+}
+
+HugePageArena& HugePageArena::instance() {
+    static HugePageArena* arena = new HugePageArena;
+    return *arena;
+}
+
+HugePageArena::HugePageArena():
+    sizeClasses(classIndex(maxBlockSize) + 1),
+    chunkPos{nullptr},
+    chunkEnd{nullptr},
+    stats{false, 0, 0, 0, 0, 0, 0} {}
+
+std::size_t HugePageArena::classIndex(std::size_t size) {
+    if (size <= 4 * alignment) {
+        return (std::max<std::size_t>(size, 1) + alignment - 1) / alignment - 1;
+    }
+    std::size_t power = 8;  // 2^power < size <= 2^(power + 1)
+    while ((std::size_t(1) << (power + 1)) < size) {
+        ++power;
+    }
+    const std::size_t step = std::size_t(1) << (power - 2);
+    return 4 + (power - 8) * 4 + (size - (std::size_t(1) << power) + step - 1) / step - 1;
+}
+
+std::size_t HugePageArena::classSize(std::size_t index) {
+    if (index < 4) {
+        return (index + 1) * alignment;
+    }
+    const std::size_t power = 8 + (index - 4) / 4;
+    return (std::size_t(1) << power) + ((index - 4) % 4 + 1) * (std::size_t(1) << (power - 2));
+}
+
+char* HugePageArena::map(std::size_t size) {
+#ifdef _WIN32
+    // large pages need SeLockMemoryPrivilege, which the demos don't have by default
+    void* ptr = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    if (nullptr == ptr) {
+        throw std::bad_alloc();
+    }
+    stats.reservedBytes += size;
+    return static_cast<char*>(ptr);
+#else
+#ifdef MAP_HUGETLB
+    // fails at once if there are not enough free reserved hugepages
+    void* hugePtr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (MAP_FAILED != hugePtr) {
+        stats.reservedBytes += size;
+        stats.hugePageBytes += size;
+        return static_cast<char*>(hugePtr);
+    }
+#endif
+    // over-mapped and trimmed, so transparent hugepages can back the whole chunks
+    void* ptr = mmap(nullptr, size + chunkSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED == ptr) {
+        throw std::bad_alloc();
+    }
+    char* const begin = static_cast<char*>(ptr);
+    char* const aligned = begin + (chunkSize - reinterpret_cast<std::uintptr_t>(begin) % chunkSize) % chunkSize;
+    if (aligned != begin) {
+        munmap(begin, static_cast<std::size_t>(aligned - begin));
+    }
+    munmap(aligned + size, static_cast<std::size_t>(begin + chunkSize - aligned));
+#ifdef MADV_HUGEPAGE
+    madvise(aligned, size, MADV_HUGEPAGE);
+#endif
+    stats.reservedBytes += size;
+    return aligned;
+#endif
+}
+
+void* HugePageArena::allocate(std::size_t size) {
+    if (size > maxBlockSize - alignment) {
+        throw std::bad_alloc();
+    }
+    // the header of the alignment size before the data keeps the size class of the block
+    const std::size_t index = classIndex(size + alignment);
+    const std::size_t blockSize = classSize(index);
+    std::lock_guard<std::mutex> lock(mutex);
+    char* block;
+    SizeClass& sizeClass = sizeClasses[index];
+    if (!sizeClass.freeBlocks.empty()) {
+        block = sizeClass.freeBlocks.back();
+        sizeClass.freeBlocks.pop_back();
+        ++stats.reusedBlocks;
+    } else {
+        if (blockSize > chunkSize / 4) {
+            block = map((blockSize + chunkSize - 1) / chunkSize * chunkSize);
+        } else {
+            if (static_cast<std::size_t>(chunkEnd - chunkPos) < blockSize) {
+                // the rest of the previous chunk is left unused, it is less than a quarter of the chunk
+                chunkPos = map(chunkSize);
+                chunkEnd = chunkPos + chunkSize;
+            }
+            block = chunkPos;
+            chunkPos += blockSize;
+        }
+        *reinterpret_cast<std::size_t*>(block) = index;
+        // a free list never holds more blocks than were cut for its class, so returning a block can't allocate
+        if (sizeClass.freeBlocks.capacity() < ++sizeClass.blocksNumber) {
+            sizeClass.freeBlocks.reserve(2 * sizeClass.blocksNumber);
+        }
+    }
+    stats.used = true;
+    ++stats.allocations;
+    stats.usedBytes += blockSize;
+    stats.peakUsedBytes = std::max(stats.peakUsedBytes, stats.usedBytes);
+    return block + alignment;
+}
+
+void HugePageArena::deallocate(void* ptr) noexcept {
+    if (nullptr == ptr) {
+        return;
+    }
+    char* block = static_cast<char*>(ptr) - alignment;
+    const std::size_t index = *reinterpret_cast<std::size_t*>(block);
+    std::lock_guard<std::mutex> lock(mutex);
+    sizeClasses[index].freeBlocks.push_back(block);
+    stats.usedBytes -= classSize(index);
+}
+
+ArenaStats HugePageArena::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+ArenaStats getArenaStats() {
+    return HugePageArena::instance().getStats();
+}
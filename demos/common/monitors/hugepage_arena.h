@@ -0,0 +1,62 @@
+// Copyright (C) 2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+struct ArenaStats {
+    bool used;  // false if nothing was allocated from the arena
+    std::uint64_t reservedBytes;  // mapped for the arena, the freed blocks stay mapped for reuse
+    std::uint64_t hugePageBytes;  // of reservedBytes on the reserved hugepages, the rest is advised to THP
+    std::uint64_t usedBytes;  // in the blocks which are not freed
+    std::uint64_t peakUsedBytes;
+    std::uint64_t allocations;
+    std::uint64_t reusedBlocks;  // allocations served from a free list
+};
+
+// The process wide arena of the frames and the blobs. The memory is mapped in 2 MB chunks, on the reserved
+// hugepages (vm.nr_hugepages) if there are free ones, otherwise advised to transparent hugepages, so a large buffer
+// takes few TLB entries and page faults. The blocks are 64-byte aligned and rounded up to size classes with four
+// classes per power of two, a freed block goes to the free list of its class and serves the next allocation of the
+// class, so the buffers of a steady stream of frames are faulted in once and don't fragment over a long run.
+// The blocks up to a quarter of a chunk are cut from the shared chunks, larger blocks get their own mappings
+class HugePageArena {
+public:
+    static const std::size_t alignment = 64;
+    static const std::size_t chunkSize = 2 * 1024 * 1024;
+
+    // never destroyed, the buffers of the static objects may be freed after main() returns
+    static HugePageArena& instance();
+
+    // throws std::bad_alloc
+    void* allocate(std::size_t size);
+    void deallocate(void* ptr) noexcept;
+    ArenaStats getStats() const;
+
+private:
+    HugePageArena();
+    HugePageArena(const HugePageArena&) = delete;
+    HugePageArena& operator=(const HugePageArena&) = delete;
+
+    static std::size_t classIndex(std::size_t size);
+    static std::size_t classSize(std::size_t index);
+    char* map(std::size_t size);
+
+    struct SizeClass {
+        std::vector<char*> freeBlocks;
+        std::size_t blocksNumber = 0;  // cut for the class
+    };
+
+    mutable std::mutex mutex;
+    std::vector<SizeClass> sizeClasses;
+    char* chunkPos;  // the rest of the current chunk
+    char* chunkEnd;
+    ArenaStats stats;
+};
+
+ArenaStats getArenaStats();
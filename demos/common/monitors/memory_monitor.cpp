@@ -3,9 +3,11 @@
 //
 
 #include "memory_monitor.h"
+#include "allocation_counter.h"
 
 struct MemState {
     double memTotal, usedMem, usedSwap;
+    double processRss, processPeakRss;
 };
 
 #ifdef _WIN32
@@ -64,12 +66,18 @@ public:
         double pagingFilesSize = static_cast<double>(
             (performanceInformation.CommitLimit - performanceInformation.PhysicalTotal)
             * performanceInformation.PageSize) / (1024 * 1024 * 1024);
+        PROCESS_MEMORY_COUNTERS processMemoryCounters;
+        if (!GetProcessMemoryInfo(GetCurrentProcess(), &processMemoryCounters, sizeof(processMemoryCounters))) {
+            throw std::runtime_error("GetProcessMemoryInfo() failed");
+        }
         return {static_cast<double>(performanceInformation.PhysicalTotal * performanceInformation.PageSize)
                 / (1024 * 1024 * 1024),
             static_cast<double>(
                 (performanceInformation.PhysicalTotal - performanceInformation.PhysicalAvailable)
                 * performanceInformation.PageSize) / (1024 * 1024 * 1024),
-            pagingFilesSize * displayValue.doubleValue};
+            pagingFilesSize * displayValue.doubleValue,
+            static_cast<double>(processMemoryCounters.WorkingSetSize) / (1024 * 1024 * 1024),
+            static_cast<double>(processMemoryCounters.PeakWorkingSetSize) / (1024 * 1024 * 1024)};
     }
 private:
     QueryWrapper query;
@@ -111,6 +119,21 @@ std::pair<std::pair<double, double>, std::pair<double, double>> getAvailableMemS
 double getMemTotal() {
     return getAvailableMemSwapTotalMemSwap().second.first;
 }
+
+std::pair<double, double> getProcessRssPeakRss() {
+    double rss = 0, peakRss = 0;
+    std::string line;
+    std::ifstream status("/proc/self/status");
+    while (std::getline(status, line)) {
+        // VmRSS:      1234 kB
+        if (0 == line.compare(0, 6, "VmRSS:")) {
+            rss = stod(line.substr(6)) / (1024 * 1024);
+        } else if (0 == line.compare(0, 6, "VmHWM:")) {
+            peakRss = stod(line.substr(6)) / (1024 * 1024);
+        }
+    }
+    return {rss, peakRss};
+}
 }
 
 class MemoryMonitor::PerformanceCounter {
@@ -120,7 +143,9 @@ public:
             = getAvailableMemSwapTotalMemSwap();
         double memTotal = availableMemSwapTotalMemSwap.second.first;
         double swapTotal = availableMemSwapTotalMemSwap.second.second;
-        return {memTotal, memTotal - availableMemSwapTotalMemSwap.first.first, swapTotal - availableMemSwapTotalMemSwap.first.second};
+        std::pair<double, double> processRssPeakRss = getProcessRssPeakRss();
+        return {memTotal, memTotal - availableMemSwapTotalMemSwap.first.first, swapTotal - availableMemSwapTotalMemSwap.first.second,
+            processRssPeakRss.first, processRssPeakRss.second};
     }
 };
 
@@ -132,7 +157,7 @@ double getMemTotal() {return 0.0;}
 
 class MemoryMonitor::PerformanceCounter {
 public:
-    MemState getMemState() {return {0.0, 0.0, 0.0};}
+    MemState getMemState() {return {0.0, 0.0, 0.0, 0.0, 0.0};}
 };
 #endif
 
@@ -144,7 +169,16 @@ MemoryMonitor::MemoryMonitor() :
     maxMem{0.0},
     maxSwap{0.0},
     memTotal{0.0},
-    maxMemTotal{0.0} {}
+    maxMemTotal{0.0},
+    processRss{0.0},
+    processRssSum{0.0},
+    processPeakRss{0.0},
+    allocationsCounted{false},
+    firstAllocatedBytes{0},
+    firstAllocations{0},
+    lastAllocatedBytes{0},
+    lastAllocations{0},
+    allocationRate{0.0} {}
 
 // PerformanceCounter is incomplete in header and destructor can't be defined implicitly
 MemoryMonitor::~MemoryMonitor() = default;
@@ -174,6 +208,28 @@ void MemoryMonitor::collectData() {
     maxMem = std::max(maxMem, memState.usedMem);
     maxSwap = std::max(maxSwap, memState.usedSwap);
 
+    const std::chrono::steady_clock::time_point timePoint = std::chrono::steady_clock::now();
+    const AllocationStats allocationStats = getAllocationStats();
+    processRss = memState.processRss;
+    processRssSum += memState.processRss;
+    processPeakRss = std::max(processPeakRss, memState.processPeakRss);
+    if (1 == samplesNumber) {
+        firstTimePoint = timePoint;
+        firstAllocatedBytes = allocationStats.allocatedBytes;
+        firstAllocations = allocationStats.allocations;
+    } else {
+        double duration = std::chrono::duration_cast<Sec>(timePoint - lastTimePoint).count();
+        allocationRate = (allocationStats.allocatedBytes - lastAllocatedBytes) / duration / (1024 * 1024);
+    }
+    lastTimePoint = timePoint;
+    lastAllocatedBytes = allocationStats.allocatedBytes;
+    lastAllocations = allocationStats.allocations;
+    allocationsCounted = allocationStats.counted;
+    rssTrend.emplace_back(std::chrono::duration_cast<Sec>(timePoint - firstTimePoint).count(), memState.processRss);
+    if (rssTrend.size() > rssTrendSize) {
+        rssTrend.pop_front();
+    }
+
     memSwapUsageHistory.emplace_back(memState.usedMem, memState.usedSwap);
     if (memSwapUsageHistory.size() > historySize) {
         memSwapUsageHistory.pop_front();
@@ -211,3 +267,52 @@ double MemoryMonitor::getMemTotal() const {
 double MemoryMonitor::getMaxMemTotal() const {
     return maxMemTotal;
 }
+
+double MemoryMonitor::getProcessRss() const {
+    return processRss;
+}
+
+double MemoryMonitor::getMeanProcessRss() const {
+    return processRssSum / samplesNumber;
+}
+
+double MemoryMonitor::getPeakProcessRss() const {
+    return processPeakRss;
+}
+
+bool MemoryMonitor::allocationsAreCounted() const {
+    return allocationsCounted;
+}
+
+double MemoryMonitor::getAllocationRate() const {
+    return allocationRate;
+}
+
+double MemoryMonitor::getMeanAllocationRate() const {
+    double duration = std::chrono::duration_cast<Sec>(lastTimePoint - firstTimePoint).count();
+    return duration > 0 ? (lastAllocatedBytes - firstAllocatedBytes) / duration / (1024 * 1024) : 0.0;
+}
+
+double MemoryMonitor::getMeanAllocationsPerSecond() const {
+    double duration = std::chrono::duration_cast<Sec>(lastTimePoint - firstTimePoint).count();
+    return duration > 0 ? (lastAllocations - firstAllocations) / duration : 0.0;
+}
+
+double MemoryMonitor::getRssSlope() const {
+    // least squares fit of rss = slope * time + c over the trend window
+    if (rssTrend.size() < 2) {
+        return 0.0;
+    }
+    double n = static_cast<double>(rssTrend.size()), sumT = 0, sumRss = 0, sumTT = 0, sumTRss = 0;
+    for (const std::pair<double, double>& sample : rssTrend) {
+        sumT += sample.first;
+        sumRss += sample.second;
+        sumTT += sample.first * sample.first;
+        sumTRss += sample.first * sample.second;
+    }
+    double denominator = n * sumTT - sumT * sumT;
+    if (denominator <= 0) {
+        return 0.0;
+    }
+    return (n * sumTRss - sumT * sumRss) / denominator * 1024 * 3600;  // GiB per sec to MiB per hour
+}
@@ -4,8 +4,11 @@
 
 #pragma once
 
+#include <chrono>
+#include <cstdint>
 #include <deque>
 #include <memory>
+#include <utility>
 
 class MemoryMonitor {
 public:
@@ -21,7 +24,23 @@ public:
     double getMaxSwap() const;
     double getMemTotal() const;
     double getMaxMemTotal() const; // a system may have hotpluggable memory
+    // resident set size of the current process, in GiB
+    double getProcessRss() const;
+    double getMeanProcessRss() const;
+    double getPeakProcessRss() const;
+    // operator new rates, MiB/s, available if the monitors are built with MONITORS_COUNT_ALLOCATIONS
+    bool allocationsAreCounted() const;
+    double getAllocationRate() const; // between the last two samples
+    double getMeanAllocationRate() const;
+    double getMeanAllocationsPerSecond() const;
+    // RSS growth over the last rssTrendSize samples in MiB per hour, a steady positive slope of a long run
+    // indicates a leak
+    double getRssSlope() const;
+
+    static const std::size_t rssTrendSize = 3600; // an hour at one sample per second
 private:
+    typedef std::chrono::duration<double, std::chrono::seconds::period> Sec;
+
     unsigned samplesNumber;
     std::size_t historySize;
     double memSum, swapSum;
@@ -29,6 +48,15 @@ private:
     double memTotal;
     double maxMemTotal;
     std::deque<std::pair<double, double>> memSwapUsageHistory;
+    double processRss;
+    double processRssSum;
+    double processPeakRss;
+    bool allocationsCounted;
+    std::chrono::steady_clock::time_point firstTimePoint, lastTimePoint;
+    std::uint64_t firstAllocatedBytes, firstAllocations;
+    std::uint64_t lastAllocatedBytes, lastAllocations;
+    double allocationRate;
+    std::deque<std::pair<double, double>> rssTrend; // sec since the first sample, RSS in GiB
     class PerformanceCounter;
     std::unique_ptr<PerformanceCounter> performanceCounter;
 };
@@ -0,0 +1,277 @@
+// Copyright (C) 2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "power_monitor.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <utility>
+
+namespace {
+const double UNAVAILABLE = std::numeric_limits<double>::quiet_NaN();
+
+typedef std::chrono::duration<double, std::chrono::seconds::period> Sec;
+}
+
+#ifdef __linux__
+#include <cstdint>
+#include <fstream>
+#include <set>
+#include <vector>
+#include <dirent.h>
+
+namespace {
+template <typename T>
+bool readValue(const std::string& path, T& value) {
+    std::ifstream file(path);
+    return static_cast<bool>(file >> value);
+}
+
+// the sorted names of the entries of a directory starting with the prefix
+std::set<std::string> listDirectory(const std::string& path, const std::string& prefix) {
+    std::set<std::string> names;
+    DIR* dir = opendir(path.c_str());
+    if (nullptr == dir) {
+        return names;
+    }
+    while (dirent* entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (0 == name.compare(0, prefix.size(), prefix)) {
+            names.insert(name);
+        }
+    }
+    closedir(dir);
+    return names;
+}
+
+enum class Domain {Package, Dram, Gpu, Sensors};
+
+// a RAPL energy counter of the powercap framework. The counters wrap around at max_energy_range_uj.
+// energy_uj of a recent kernel is readable by root only, such zones are skipped
+struct RaplZone {
+    Domain domain;
+    std::string energyPath;
+    std::uint64_t range;
+    std::uint64_t prevEnergy;
+};
+
+// a meter of the current power in uW, e.g. a hwmon sensor or a battery
+struct PowerMeter {
+    std::string powerPath;
+    std::string statusPath;  // a battery reports its own consumption only while it is discharging
+};
+
+std::vector<RaplZone> findRaplZones() {
+    const std::string powercap = "/sys/class/powercap/";
+    std::vector<RaplZone> zones;
+    // the packages are intel-rapl:<n>, their subzones are intel-rapl:<n>:<m>, the mmio duplicates are skipped
+    for (const std::string& zone : listDirectory(powercap, "intel-rapl:")) {
+        std::string name;
+        RaplZone raplZone;
+        raplZone.energyPath = powercap + zone + "/energy_uj";
+        if (!readValue(powercap + zone + "/name", name)
+                || !readValue(powercap + zone + "/max_energy_range_uj", raplZone.range)
+                || !readValue(raplZone.energyPath, raplZone.prevEnergy)) {
+            continue;
+        }
+        if (0 == name.compare(0, 7, "package")) {
+            raplZone.domain = Domain::Package;
+        } else if ("dram" == name) {
+            raplZone.domain = Domain::Dram;
+        } else if ("uncore" == name) {  // the integrated GPU of the client CPUs
+            raplZone.domain = Domain::Gpu;
+        } else if ("psys" == name) {  // the whole platform
+            raplZone.domain = Domain::Sensors;
+        } else {
+            continue;  // core is a part of package
+        }
+        zones.push_back(raplZone);
+    }
+    return zones;
+}
+
+std::vector<PowerMeter> findPowerMeters() {
+    std::vector<PowerMeter> meters;
+    const std::string hwmon = "/sys/class/hwmon/";
+    for (const std::string& device : listDirectory(hwmon, "hwmon")) {
+        std::set<std::string> channels;  // power<n>_input and power<n>_average are the same power
+        for (const std::string& sensor : listDirectory(hwmon + device, "power")) {
+            double power;
+            const std::string suffix = "_input", averageSuffix = "_average";
+            const bool input = sensor.size() > suffix.size()
+                && 0 == sensor.compare(sensor.size() - suffix.size(), suffix.size(), suffix);
+            const bool average = sensor.size() > averageSuffix.size()
+                && 0 == sensor.compare(sensor.size() - averageSuffix.size(), averageSuffix.size(), averageSuffix);
+            if ((input || average) && readValue(hwmon + device + "/" + sensor, power)
+                    && channels.insert(sensor.substr(0, sensor.find('_'))).second) {
+                meters.push_back({hwmon + device + "/" + sensor, ""});
+            }
+        }
+    }
+    const std::string powerSupply = "/sys/class/power_supply/";
+    for (const std::string& supply : listDirectory(powerSupply, "")) {
+        std::string type;
+        double power;
+        if (readValue(powerSupply + supply + "/type", type) && "Battery" == type
+                && readValue(powerSupply + supply + "/power_now", power)) {
+            meters.push_back({powerSupply + supply + "/power_now", powerSupply + supply + "/status"});
+        }
+    }
+    return meters;
+}
+
+void addPower(double& sum, double power) {
+    sum = std::isnan(sum) ? power : sum + power;
+}
+}
+
+class PowerMonitor::PerformanceCounter {
+public:
+    PerformanceCounter() :
+        raplZones{findRaplZones()},
+        powerMeters{findPowerMeters()},
+        prevTimePoint{std::chrono::steady_clock::now()} {}
+
+    // the power between the previous sample and now, duration is the time between them
+    PowerState getPowerState(double& duration) {
+        const auto timePoint = std::chrono::steady_clock::now();
+        duration = std::chrono::duration_cast<Sec>(timePoint - prevTimePoint).count();
+        prevTimePoint = timePoint;
+        PowerState state{UNAVAILABLE, UNAVAILABLE, UNAVAILABLE, UNAVAILABLE};
+        for (RaplZone& zone : raplZones) {
+            std::uint64_t energy;
+            if (!readValue(zone.energyPath, energy)) {
+                continue;
+            }
+            const std::uint64_t consumed = energy >= zone.prevEnergy
+                ? energy - zone.prevEnergy : zone.range - zone.prevEnergy + energy;
+            zone.prevEnergy = energy;
+            if (duration <= 0.0) {
+                continue;
+            }
+            const double power = consumed * 1e-6 / duration;
+            switch (zone.domain) {
+                case Domain::Package: addPower(state.package, power); break;
+                case Domain::Dram: addPower(state.dram, power); break;
+                case Domain::Gpu: addPower(state.gpu, power); break;
+                case Domain::Sensors: addPower(state.sensors, power); break;
+            }
+        }
+        // RAPL psys already measures the platform
+        if (std::isnan(state.sensors)) {
+            for (const PowerMeter& meter : powerMeters) {
+                std::string status;
+                double power;
+                if ((meter.statusPath.empty() || (readValue(meter.statusPath, status) && "Discharging" == status))
+                        && readValue(meter.powerPath, power)) {
+                    addPower(state.sensors, std::abs(power) * 1e-6);
+                }
+            }
+        }
+        return state;
+    }
+
+private:
+    std::vector<RaplZone> raplZones;
+    const std::vector<PowerMeter> powerMeters;
+    std::chrono::steady_clock::time_point prevTimePoint;
+};
+
+#else
+// not implemented
+class PowerMonitor::PerformanceCounter {
+public:
+    PowerState getPowerState(double& duration) {
+        duration = 0.0;
+        return {UNAVAILABLE, UNAVAILABLE, UNAVAILABLE, UNAVAILABLE};
+    }
+};
+#endif
+
+double PowerState::total() const {
+    if (!std::isnan(package)) {
+        return std::isnan(dram) ? package : package + dram;
+    }
+    return sensors;
+}
+
+void PowerMonitor::Energy::add(double watts, double duration) {
+    if (!std::isnan(watts)) {
+        joules += watts * duration;
+        seconds += duration;
+    }
+}
+
+double PowerMonitor::Energy::getPower() const {
+    return seconds > 0.0 ? joules / seconds : UNAVAILABLE;
+}
+
+PowerMonitor::PowerMonitor() :
+    historySize{0},
+    package{0.0, 0.0},
+    dram{0.0, 0.0},
+    gpu{0.0, 0.0},
+    sensors{0.0, 0.0},
+    total{0.0, 0.0},
+    maxPower{UNAVAILABLE} {}
+
+// PerformanceCounter is incomplete in header and destructor can't be defined implicitly
+PowerMonitor::~PowerMonitor() = default;
+
+void PowerMonitor::setHistorySize(std::size_t size) {
+    if (0 == historySize && 0 != size) {
+        performanceCounter.reset(new PerformanceCounter);
+    } else if (0 != historySize && 0 == size) {
+        performanceCounter.reset();
+    }
+    historySize = size;
+    std::size_t newSize = std::min(size, powerStateHistory.size());
+    powerStateHistory.erase(powerStateHistory.begin(), powerStateHistory.end() - newSize);
+}
+
+void PowerMonitor::collectData() {
+    double duration;
+    PowerState powerState = performanceCounter->getPowerState(duration);
+
+    package.add(powerState.package, duration);
+    dram.add(powerState.dram, duration);
+    gpu.add(powerState.gpu, duration);
+    sensors.add(powerState.sensors, duration);
+    total.add(powerState.total(), duration);
+    // std::max() with NaN depends on the argument order, keep the first available value
+    if (!std::isnan(powerState.total()) && !(maxPower >= powerState.total())) {
+        maxPower = powerState.total();
+    }
+
+    powerStateHistory.push_back(powerState);
+    if (powerStateHistory.size() > historySize) {
+        powerStateHistory.pop_front();
+    }
+}
+
+std::size_t PowerMonitor::getHistorySize() const {
+    return historySize;
+}
+
+std::deque<PowerState> PowerMonitor::getLastHistory() const {
+    return powerStateHistory;
+}
+
+PowerState PowerMonitor::getMeanPower() const {
+    return {package.getPower(), dram.getPower(), gpu.getPower(), sensors.getPower()};
+}
+
+double PowerMonitor::getMaxPower() const {
+    return maxPower;
+}
+
+double PowerMonitor::getEnergy() const {
+    return total.seconds > 0.0 ? total.joules : UNAVAILABLE;
+}
+
+double PowerMonitor::getMeasuredTime() const {
+    return total.seconds;
+}
@@ -0,0 +1,48 @@
+// Copyright (C) 2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include <deque>
+#include <memory>
+
+// a value of a sample is NaN if the system doesn't report it. The values are W averaged between the samples
+struct PowerState {
+    double package;  // CPU packages including their integrated GPUs
+    double dram;  // memory attached to the packages
+    double gpu;  // integrated GPUs, a part of package
+    double sensors;  // other power meters, e.g. a platform meter or a discharging battery
+    // package + dram if RAPL reports them, sensors otherwise
+    double total() const;
+};
+
+class PowerMonitor {
+public:
+    PowerMonitor();
+    ~PowerMonitor();
+    void setHistorySize(std::size_t size);
+    std::size_t getHistorySize() const;
+    void collectData();
+    std::deque<PowerState> getLastHistory() const;
+    // the means over the whole time the monitor is enabled
+    PowerState getMeanPower() const;
+    double getMaxPower() const; // the max of PowerState::total()
+    double getEnergy() const; // J of PowerState::total() since the monitor is enabled
+    double getMeasuredTime() const; // sec covered by getEnergy()
+
+private:
+    struct Energy {
+        double joules;
+        double seconds;
+        void add(double watts, double duration);
+        double getPower() const;
+    };
+
+    unsigned historySize;
+    Energy package, dram, gpu, sensors, total;
+    double maxPower;
+    std::deque<PowerState> powerStateHistory;
+    class PerformanceCounter;
+    std::unique_ptr<PerformanceCounter> performanceCounter;
+};
@@ -4,16 +4,23 @@
 
 #include <cctype>
 #include <chrono>
+#include <cmath>
 #include <iomanip>
 #include <numeric>
 
 #include "presenter.h"
+#include "hugepage_arena.h"
 
 namespace {
 const std::map<int, MonitorType> keyToMonitorType{
     {'C', MonitorType::CpuAverage},
     {'D', MonitorType::DistributionCpu},
-    {'M', MonitorType::Memory}};
+    {'M', MonitorType::Memory},
+    {'T', MonitorType::Threads},
+    {'G', MonitorType::GpuBusy},
+    {'F', MonitorType::GpuFrequency},
+    {'V', MonitorType::GpuMemory},
+    {'W', MonitorType::Power}};
 
 std::set<MonitorType> strKeysToMonitorSet(const std::string& keys) {
     std::set<MonitorType> enabledMonitors;
@@ -38,6 +45,15 @@ Presenter::Presenter(std::set<MonitorType> enabledMonitors,
             graphPadding{std::max(1, static_cast<int>(graphSize.width * 0.05))},
             historySize{historySize},
             distributionCpuEnabled{false},
+            gpuBusyEnabled{false},
+            gpuFrequencyEnabled{false},
+            gpuMemoryEnabled{false},
+            framesNumber{0},
+            powerFramesMark{0},
+            powerFrames{0},
+            overlayOutdated{true},
+            overlayFrameWidth{0},
+            panelPos{0},
             strStream{std::ios_base::app} {
     for (MonitorType monitor : enabledMonitors) {
         addRemoveMonitor(monitor);
@@ -86,20 +102,61 @@ void Presenter::addRemoveMonitor(MonitorType monitor) {
             }
             break;
         }
+        case MonitorType::Threads: {
+            // only the last sample is drawn
+            threadMonitor.setHistorySize(0 == threadMonitor.getHistorySize() ? 1 : 0);
+            break;
+        }
+        case MonitorType::GpuBusy: {
+            gpuBusyEnabled = !gpuBusyEnabled;
+            break;
+        }
+        case MonitorType::GpuFrequency: {
+            gpuFrequencyEnabled = !gpuFrequencyEnabled;
+            break;
+        }
+        case MonitorType::GpuMemory: {
+            gpuMemoryEnabled = !gpuMemoryEnabled;
+            break;
+        }
+        case MonitorType::Power: {
+            if (powerMonitor.getHistorySize() > 1) {
+                powerMonitor.setHistorySize(0);
+            } else {
+                powerMonitor.setHistorySize(updatedHistorySize);
+                powerFramesMark = framesNumber;
+            }
+            break;
+        }
     }
+    // the GPU graphs share gpuMonitor
+    gpuMonitor.setHistorySize(gpuBusyEnabled || gpuFrequencyEnabled || gpuMemoryEnabled ? updatedHistorySize : 0);
+    overlayOutdated = true;
 }
 
 void Presenter::handleKey(int key) {
     key = std::toupper(key);
     if ('H' == key) {
-        if (0 == cpuMonitor.getHistorySize() && memoryMonitor.getHistorySize() <= 1) {
+        if (0 == cpuMonitor.getHistorySize() && memoryMonitor.getHistorySize() <= 1
+                && 0 == threadMonitor.getHistorySize() && 0 == gpuMonitor.getHistorySize()
+                && powerMonitor.getHistorySize() <= 1) {
             addRemoveMonitor(MonitorType::CpuAverage);
             addRemoveMonitor(MonitorType::DistributionCpu);
             addRemoveMonitor(MonitorType::Memory);
+            addRemoveMonitor(MonitorType::Threads);
+            addRemoveMonitor(MonitorType::GpuBusy);
+            addRemoveMonitor(MonitorType::GpuFrequency);
+            addRemoveMonitor(MonitorType::GpuMemory);
+            addRemoveMonitor(MonitorType::Power);
         } else {
             cpuMonitor.setHistorySize(0);
             distributionCpuEnabled = false;
             memoryMonitor.setHistorySize(0);
+            threadMonitor.setHistorySize(0);
+            gpuMonitor.setHistorySize(0);
+            gpuBusyEnabled = gpuFrequencyEnabled = gpuMemoryEnabled = false;
+            powerMonitor.setHistorySize(0);
+            overlayOutdated = true;
         }
     } else {
         auto iter = keyToMonitorType.find(key);
@@ -110,6 +167,7 @@ void Presenter::handleKey(int key) {
 }
 
 void Presenter::drawGraphs(cv::Mat& frame) {
+    ++framesNumber;
     const std::chrono::steady_clock::time_point curTimeStamp = std::chrono::steady_clock::now();
     if (curTimeStamp - prevTimeStamp >= std::chrono::milliseconds{1000}) {
         prevTimeStamp = curTimeStamp;
@@ -119,17 +177,70 @@ void Presenter::drawGraphs(cv::Mat& frame) {
         if (memoryMonitor.getHistorySize() > 1) {
             memoryMonitor.collectData();
         }
+        if (0 != threadMonitor.getHistorySize()) {
+            threadMonitor.collectData();
+        }
+        if (gpuMonitor.getHistorySize() > 1) {
+            gpuMonitor.collectData();
+        }
+        if (powerMonitor.getHistorySize() > 1) {
+            powerMonitor.collectData();
+            // the frames count for the energy only if the sample measured it
+            if (!std::isnan(powerMonitor.getLastHistory().back().total())) {
+                powerFrames += framesNumber - powerFramesMark;
+            }
+            powerFramesMark = framesNumber;
+        }
+        overlayOutdated = true;
+    }
+    if (overlayOutdated || frame.cols != overlayFrameWidth) {
+        renderOverlay(frame.cols);
     }
 
+    cv::Rect panelRect =
+        cv::Rect{cv::Point{panelPos, yPos}, overlayAlpha.size()} & cv::Rect(0, 0, frame.cols, frame.rows);
+    if (panelRect.area() > 0) {
+        cv::Rect spriteRect = panelRect - cv::Point{panelPos, yPos};
+        cv::Mat panel = frame(panelRect);
+        // frame * alpha + premultiplied color, the graphs are rasterized only when the data changes
+        cv::multiply(panel, overlayAlpha(spriteRect), panel, 1.0 / 255);
+        cv::add(panel, overlayColor(spriteRect), panel);
+    }
+}
+
+void Presenter::renderOverlay(int frameWidth) {
+    overlayOutdated = false;
+    overlayFrameWidth = frameWidth;
+    bool gpuGraphsDrawn = gpuMonitor.getHistorySize() > 1;
     int numberOfEnabledMonitors = (cpuMonitor.getHistorySize() > 1) + distributionCpuEnabled
-        + (memoryMonitor.getHistorySize() > 1);
+        + (memoryMonitor.getHistorySize() > 1) + (0 != threadMonitor.getHistorySize())
+        + gpuGraphsDrawn * (gpuBusyEnabled + gpuFrequencyEnabled + gpuMemoryEnabled)
+        + (powerMonitor.getHistorySize() > 1);
     int panelWidth = graphSize.width * numberOfEnabledMonitors
         + std::max(0, numberOfEnabledMonitors - 1) * graphPadding;
-    while (panelWidth > frame.cols) {
+    while (panelWidth > frameWidth) {
         panelWidth = std::max(0, panelWidth - graphSize.width - graphPadding);
         --numberOfEnabledMonitors; // can't draw all monitors
     }
-    int graphPos = std::max(0, (frame.cols - 1 - panelWidth) / 2);
+    panelPos = std::max(0, (frameWidth - 1 - panelWidth) / 2);
+    if (0 == panelWidth) {
+        overlayAlpha.release();
+        overlayColor.release();
+        return;
+    }
+    // the panel drawn over black and over white gives the alpha of every pixel and its premultiplied color.
+    // The graph background is half transparent gray, frame / 2 + 127
+    cv::Mat overBlack{graphSize.height, panelWidth, CV_8UC3, cv::Scalar{0, 0, 0}};
+    cv::Mat overWhite{graphSize.height, panelWidth, CV_8UC3, cv::Scalar{255, 255, 255}};
+    drawPanel(overBlack, numberOfEnabledMonitors, gpuGraphsDrawn, {127, 127, 127});
+    drawPanel(overWhite, numberOfEnabledMonitors, gpuGraphsDrawn, {254, 254, 254});
+    cv::subtract(overWhite, overBlack, overlayAlpha);
+    overlayColor = overBlack;
+}
+
+void Presenter::drawPanel(cv::Mat& panel, int numberOfEnabledMonitors, bool gpuGraphsDrawn,
+        const cv::Scalar& graphBackground) {
+    int graphPos = 0;
     int textGraphSplittingLine = graphSize.height / 5;
     int graphRectHeight = graphSize.height - textGraphSplittingLine;
     int sampleStep = 1;
@@ -141,8 +252,8 @@ void Presenter::drawGraphs(cv::Mat& frame) {
 
     if (cpuMonitor.getHistorySize() > 1 && possibleHistorySize > 1 && --numberOfEnabledMonitors >= 0) {
         std::deque<std::vector<double>> lastHistory = cpuMonitor.getLastHistory();
-        cv::Mat graph = frame(cv::Rect{cv::Point{graphPos, yPos}, graphSize} & cv::Rect(0, 0, frame.cols, frame.rows));
-        graph = graph / 2 + cv::Scalar{127, 127, 127};
+        cv::Mat graph = panel(cv::Rect{cv::Point{graphPos, 0}, graphSize});
+        graph = graphBackground;
 
         int lineXPos = graph.cols - 1;
         std::vector<cv::Point> averageLoad(lastHistory.size());
@@ -154,8 +265,8 @@ void Presenter::drawGraphs(cv::Mat& frame) {
         }
 
         cv::polylines(graph, averageLoad, false, {255, 0, 0}, 2);
-        cv::rectangle(frame, cv::Rect{
-                cv::Point{graphPos, yPos + textGraphSplittingLine},
+        cv::rectangle(panel, cv::Rect{
+                cv::Point{graphPos, textGraphSplittingLine},
                 cv::Size{graphSize.width, graphSize.height - textGraphSplittingLine}
             }, {0, 0, 0});
         strStream.str("CPU");
@@ -182,8 +293,8 @@ void Presenter::drawGraphs(cv::Mat& frame) {
 
     if (distributionCpuEnabled && --numberOfEnabledMonitors >= 0) {
         std::deque<std::vector<double>> lastHistory = cpuMonitor.getLastHistory();
-        cv::Mat graph = frame(cv::Rect{cv::Point{graphPos, yPos}, graphSize} & cv::Rect(0, 0, frame.cols, frame.rows));
-        graph = graph / 2 + cv::Scalar{127, 127, 127};
+        cv::Mat graph = panel(cv::Rect{cv::Point{graphPos, 0}, graphSize});
+        graph = graphBackground;
 
         if (!lastHistory.empty()) {
             int rectXPos = 0;
@@ -201,9 +312,9 @@ void Presenter::drawGraphs(cv::Mat& frame) {
             int yLine = graph.rows - static_cast<int>(graphRectHeight * sum);
             cv::line(graph, cv::Point{0, yLine}, cv::Point{graph.cols, yLine}, {0, 255, 0}, 2);
         }
-        cv::Rect border{cv::Point{graphPos, yPos + textGraphSplittingLine},
+        cv::Rect border{cv::Point{graphPos, textGraphSplittingLine},
             cv::Size{graphSize.width, graphSize.height - textGraphSplittingLine}};
-        cv::rectangle(frame, border, {0, 0, 0});
+        cv::rectangle(panel, border, {0, 0, 0});
         strStream.str("Core load");
         if (!lastHistory.empty()) {
             strStream << ": " << std::fixed << std::setprecision(1)
@@ -227,8 +338,8 @@ void Presenter::drawGraphs(cv::Mat& frame) {
 
     if (memoryMonitor.getHistorySize() > 1 && possibleHistorySize > 1 && --numberOfEnabledMonitors >= 0) {
         std::deque<std::pair<double, double>> lastHistory = memoryMonitor.getLastHistory();
-        cv::Mat graph = frame(cv::Rect{cv::Point{graphPos, yPos}, graphSize} & cv::Rect(0, 0, frame.cols, frame.rows));
-        graph = graph / 2 + cv::Scalar{127, 127, 127};
+        cv::Mat graph = panel(cv::Rect{cv::Point{graphPos, 0}, graphSize});
+        graph = graphBackground;
         int histxPos = graph.cols - 1;
         double range = std::min(memoryMonitor.getMaxMemTotal() + memoryMonitor.getMaxSwap(),
             (memoryMonitor.getMaxMem() + memoryMonitor.getMaxSwap()) * 1.2);
@@ -249,9 +360,9 @@ void Presenter::drawGraphs(cv::Mat& frame) {
             }
         }
 
-        cv::Rect border{cv::Point{graphPos, yPos + textGraphSplittingLine},
+        cv::Rect border{cv::Point{graphPos, textGraphSplittingLine},
             cv::Size{graphSize.width, graphSize.height - textGraphSplittingLine}};
-        cv::rectangle(frame, {border}, {0, 0, 0});
+        cv::rectangle(panel, {border}, {0, 0, 0});
         if (lastHistory.empty()) {
             strStream.str("Memory");
         } else {
@@ -271,7 +382,150 @@ void Presenter::drawGraphs(cv::Mat& frame) {
             cv::FONT_HERSHEY_SIMPLEX,
             textGraphSplittingLine * 0.04,
             {0, 35, 35});
+        graphPos += graphSize.width + graphPadding;
+    }
+
+    if (0 != threadMonitor.getHistorySize() && --numberOfEnabledMonitors >= 0) {
+        std::deque<std::vector<std::pair<std::string, double>>> lastHistory = threadMonitor.getLastHistory();
+        cv::Mat graph = panel(cv::Rect{cv::Point{graphPos, 0}, graphSize});
+        graph = graphBackground;
+
+        // a bar per top consumer, a full width bar is a fully loaded core
+        constexpr std::size_t MAX_THREADS_SHOWN = 4;
+        if (!lastHistory.empty() && !lastHistory.back().empty()) {
+            const std::vector<std::pair<std::string, double>>& threadLoad = lastHistory.back();
+            std::size_t barsNumber = std::min(MAX_THREADS_SHOWN, threadLoad.size());
+            int barHeight = std::max(1, graphRectHeight / static_cast<int>(MAX_THREADS_SHOWN));
+            for (std::size_t i = 0; i < barsNumber; ++i) {
+                int barYPos = textGraphSplittingLine + static_cast<int>(i) * barHeight;
+                int barWidth = static_cast<int>(graph.cols * std::min(1.0, threadLoad[i].second));
+                cv::rectangle(graph, cv::Rect{cv::Point{0, barYPos}, cv::Size{barWidth, barHeight}},
+                    {255, 0, 255}, cv::FILLED);
+                strStream.str("");
+                strStream << threadLoad[i].first << ": " << std::fixed << std::setprecision(0)
+                    << threadLoad[i].second * 100 << '%';
+                cv::putText(graph,
+                    strStream.str(),
+                    cv::Point{2, barYPos + barHeight - 2},
+                    cv::FONT_HERSHEY_SIMPLEX,
+                    barHeight * 0.035,
+                    {0, 0, 0},
+                    1);
+            }
+        }
+        cv::Rect border{cv::Point{graphPos, textGraphSplittingLine},
+            cv::Size{graphSize.width, graphSize.height - textGraphSplittingLine}};
+        cv::rectangle(panel, border, {0, 0, 0});
+        strStream.str("Threads");
+        int baseline;
+        int textWidth = cv::getTextSize(strStream.str(),
+            cv::FONT_HERSHEY_SIMPLEX,
+            textGraphSplittingLine * 0.04,
+            1,
+            &baseline).width;
+        cv::putText(graph,
+            strStream.str(),
+            cv::Point{(graphSize.width - textWidth) / 2, textGraphSplittingLine - 1},
+            cv::FONT_HERSHEY_SIMPLEX,
+            textGraphSplittingLine * 0.04,
+            {70, 0, 70});
+        graphPos += graphSize.width + graphPadding;
     }
+
+    if (gpuGraphsDrawn) {
+        std::deque<GpuState> lastHistory = gpuMonitor.getLastHistory();
+        if (gpuBusyEnabled && --numberOfEnabledMonitors >= 0) {
+            std::deque<double> busy;
+            for (const GpuState& state : lastHistory) {
+                busy.push_back(state.busy);
+            }
+            strStream.str("GPU");
+            if (!lastHistory.empty() && !std::isnan(lastHistory.back().busy)) {
+                strStream << ": " << std::fixed << std::setprecision(1) << lastHistory.back().busy * 100 << '%';
+            }
+            drawLineGraph(panel, graphPos, graphBackground, busy, {0, 128, 255}, strStream.str());
+            graphPos += graphSize.width + graphPadding;
+        }
+        if (gpuFrequencyEnabled && --numberOfEnabledMonitors >= 0) {
+            std::deque<double> frequency;
+            for (const GpuState& state : lastHistory) {
+                frequency.push_back(state.frequency / gpuMonitor.getMaxFrequency());
+            }
+            strStream.str("GPU freq");
+            if (!lastHistory.empty() && !std::isnan(lastHistory.back().frequency)) {
+                strStream << ": " << std::fixed << std::setprecision(0) << lastHistory.back().frequency << " MHz";
+            }
+            drawLineGraph(panel, graphPos, graphBackground, frequency, {255, 128, 0}, strStream.str());
+            graphPos += graphSize.width + graphPadding;
+        }
+        if (gpuMemoryEnabled && --numberOfEnabledMonitors >= 0) {
+            std::deque<double> memory;
+            for (const GpuState& state : lastHistory) {
+                memory.push_back(state.memory / (gpuMonitor.getMaxMemory() * 1.2));
+            }
+            strStream.str("GPU mem");
+            if (!lastHistory.empty() && !std::isnan(lastHistory.back().memory)) {
+                strStream << ": " << std::fixed << std::setprecision(2) << lastHistory.back().memory << " GiB";
+            }
+            drawLineGraph(panel, graphPos, graphBackground, memory, {128, 0, 255}, strStream.str());
+            graphPos += graphSize.width + graphPadding;
+        }
+    }
+
+    if (powerMonitor.getHistorySize() > 1 && --numberOfEnabledMonitors >= 0) {
+        std::deque<PowerState> lastHistory = powerMonitor.getLastHistory();
+        std::deque<double> power;
+        for (const PowerState& state : lastHistory) {
+            power.push_back(state.total() / (powerMonitor.getMaxPower() * 1.2));
+        }
+        strStream.str("Power");
+        if (!lastHistory.empty() && !std::isnan(lastHistory.back().total())) {
+            strStream << ": " << std::fixed << std::setprecision(1) << lastHistory.back().total() << " W";
+        }
+        drawLineGraph(panel, graphPos, graphBackground, power, {0, 160, 0}, strStream.str());
+    }
+}
+
+void Presenter::drawLineGraph(cv::Mat& panel, int graphPos, const cv::Scalar& graphBackground,
+        const std::deque<double>& values, cv::Scalar color, const std::string& caption) {
+    int textGraphSplittingLine = graphSize.height / 5;
+    int graphRectHeight = graphSize.height - textGraphSplittingLine;
+    int sampleStep = 1;
+    if (historySize > 1) {
+        sampleStep = std::max(1, static_cast<int>(graphSize.width / (historySize - 1)));
+    }
+    cv::Mat graph = panel(cv::Rect{cv::Point{graphPos, 0}, graphSize});
+    graph = graphBackground;
+
+    int lineXPos = graph.cols - 1;
+    for (std::size_t i = values.size(); i > 1; --i) {
+        double right = values[i - 1], left = values[i - 2];
+        if (!std::isnan(right) && !std::isnan(left)) {
+            cv::line(graph,
+                {lineXPos, graphSize.height - static_cast<int>(std::min(1.0, right) * graphRectHeight)},
+                {lineXPos - sampleStep, graphSize.height - static_cast<int>(std::min(1.0, left) * graphRectHeight)},
+                color, 2);
+        }
+        lineXPos -= sampleStep;
+    }
+
+    cv::rectangle(panel, cv::Rect{
+            cv::Point{graphPos, textGraphSplittingLine},
+            cv::Size{graphSize.width, graphSize.height - textGraphSplittingLine}
+        }, {0, 0, 0});
+    int baseline;
+    int textWidth = cv::getTextSize(caption,
+        cv::FONT_HERSHEY_SIMPLEX,
+        textGraphSplittingLine * 0.04,
+        1,
+        &baseline).width;
+    cv::putText(graph,
+        caption,
+        cv::Point{(graphSize.width - textWidth) / 2, textGraphSplittingLine - 1},
+        cv::FONT_HERSHEY_SIMPLEX,
+        textGraphSplittingLine * 0.04,
+        color * 0.3,
+        1);
 }
 
 std::string Presenter::reportMeans() const {
@@ -292,6 +546,67 @@ std::string Presenter::reportMeans() const {
     if (memoryMonitor.getHistorySize() > 1) {
         collectedDataStream << "Memory mean usage: " << memoryMonitor.getMeanMem() << " GiB\n";
         collectedDataStream << "Mean swap usage: " << memoryMonitor.getMeanSwap() << " GiB\n";
+        collectedDataStream << "Process RSS mean: " << memoryMonitor.getMeanProcessRss() << " GiB, peak: "
+            << memoryMonitor.getPeakProcessRss() << " GiB, trend: " << std::showpos << memoryMonitor.getRssSlope()
+            << std::noshowpos << " MiB/h\n";
+        if (memoryMonitor.allocationsAreCounted()) {
+            collectedDataStream << "Mean allocation rate: " << memoryMonitor.getMeanAllocationRate() << " MiB/s, "
+                << memoryMonitor.getMeanAllocationsPerSecond() << " allocations/s\n";
+        }
+    }
+    const ArenaStats arenaStats = getArenaStats();
+    if (arenaStats.used) {
+        // the arena maps its memory directly, the allocation rate above doesn't include it
+        const double mib = 1024 * 1024;
+        collectedDataStream << "Hugepage arena: " << arenaStats.reservedBytes / mib << " MiB mapped, "
+            << arenaStats.hugePageBytes / mib << " MiB of them on reserved hugepages, "
+            << arenaStats.usedBytes / mib << " MiB used, peak: " << arenaStats.peakUsedBytes / mib << " MiB, "
+            << arenaStats.reusedBlocks << " of " << arenaStats.allocations << " allocations reused a block\n";
+    }
+    if (0 != threadMonitor.getHistorySize()) {
+        collectedDataStream << "Mean thread utilization: ";
+        for (const auto& threadLoad : threadMonitor.getMeanThreadLoad()) {
+            collectedDataStream << threadLoad.first << ' ' << threadLoad.second * 100 << "% ";
+        }
+        collectedDataStream << '\n';
+    }
+    if (gpuMonitor.getHistorySize() > 1) {
+        // NaN means the system doesn't report the value
+        if (gpuBusyEnabled && !std::isnan(gpuMonitor.getMeanBusy())) {
+            collectedDataStream << "Mean GPU utilization: " << gpuMonitor.getMeanBusy() * 100 << "%\n";
+        }
+        if (gpuFrequencyEnabled && !std::isnan(gpuMonitor.getMeanFrequency())) {
+            collectedDataStream << "Mean GPU frequency: " << gpuMonitor.getMeanFrequency() << " MHz (max "
+                << gpuMonitor.getMaxFrequency() << " MHz)\n";
+        }
+        if (gpuMemoryEnabled && !std::isnan(gpuMonitor.getMeanMemory())) {
+            collectedDataStream << "GPU memory mean usage: " << gpuMonitor.getMeanMemory() << " GiB, peak: "
+                << gpuMonitor.getMaxMemory() << " GiB\n";
+        }
+    }
+    if (powerMonitor.getHistorySize() > 1 && !std::isnan(powerMonitor.getEnergy())) {
+        const PowerState mean = powerMonitor.getMeanPower();
+        const double meanPower = powerMonitor.getEnergy() / powerMonitor.getMeasuredTime();
+        collectedDataStream << "Mean power: " << meanPower << " W";
+        if (!std::isnan(mean.package)) {
+            collectedDataStream << " (package " << mean.package << " W";
+            if (!std::isnan(mean.gpu)) {
+                collectedDataStream << " of which GPU " << mean.gpu << " W";
+            }
+            if (!std::isnan(mean.dram)) {
+                collectedDataStream << ", DRAM " << mean.dram << " W";
+            }
+            collectedDataStream << ')';
+        }
+        if (!std::isnan(mean.sensors)) {
+            collectedDataStream << ", platform sensors " << mean.sensors << " W";
+        }
+        collectedDataStream << ", peak: " << powerMonitor.getMaxPower() << " W\n";
+        if (powerMonitor.getEnergy() > 0.0 && 0 != powerFrames) {
+            collectedDataStream << "Energy efficiency: " << std::setprecision(3)
+                << powerFrames / powerMonitor.getEnergy() << " frames/J, "
+                << powerMonitor.getEnergy() / powerFrames << " J/frame\n" << std::setprecision(1);
+        }
     }
     std::string collectedData = collectedDataStream.str();
     // drop last \n because usually it is not expeted that printing an object starts a new line
@@ -12,9 +12,12 @@
 #include <opencv2/imgproc.hpp>
 
 #include "cpu_monitor.h"
+#include "gpu_monitor.h"
 #include "memory_monitor.h"
+#include "power_monitor.h"
+#include "thread_monitor.h"
 
-enum class MonitorType{CpuAverage, DistributionCpu, Memory};
+enum class MonitorType{CpuAverage, DistributionCpu, Memory, Threads, GpuBusy, GpuFrequency, GpuMemory, Power};
 
 class Presenter {
 public:
@@ -27,7 +30,7 @@ public:
         cv::Size graphSize = {150, 60},
         std::size_t historySize = 20);
     void addRemoveMonitor(MonitorType monitor);
-    void handleKey(int key); // handles c, d, m, h keys
+    void handleKey(int key); // handles c, d, m, t, g, f, v, w, h keys
     void drawGraphs(cv::Mat& frame);
     std::string reportMeans() const;
 
@@ -35,10 +38,34 @@ public:
     const cv::Size graphSize;
     const int graphPadding;
 private:
+    void renderOverlay(int frameWidth);
+    void drawPanel(cv::Mat& panel, int numberOfEnabledMonitors, bool gpuGraphsDrawn,
+        const cv::Scalar& graphBackground);
+    // draws values from [0, 1] as a line, NaN values break it
+    void drawLineGraph(cv::Mat& panel, int graphPos, const cv::Scalar& graphBackground,
+        const std::deque<double>& values, cv::Scalar color, const std::string& caption);
+
     std::chrono::steady_clock::time_point prevTimeStamp;
     std::size_t historySize;
     CpuMonitor cpuMonitor;
     bool distributionCpuEnabled;
     MemoryMonitor memoryMonitor;
+    ThreadMonitor threadMonitor;
+    GpuMonitor gpuMonitor;
+    bool gpuBusyEnabled;
+    bool gpuFrequencyEnabled;
+    bool gpuMemoryEnabled;
+    PowerMonitor powerMonitor;
+    // the frames drawn while the power is measured, for the frames per joule
+    std::size_t framesNumber;
+    std::size_t powerFramesMark;
+    std::size_t powerFrames;
+    // the graphs are rendered into a sprite when a sample arrives or the set of monitors changes,
+    // every frame only blends it: frame * overlayAlpha / 255 + overlayColor
+    bool overlayOutdated;
+    int overlayFrameWidth;
+    int panelPos;
+    cv::Mat overlayAlpha;
+    cv::Mat overlayColor;
     std::ostringstream strStream;
 };
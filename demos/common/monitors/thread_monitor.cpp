@@ -0,0 +1,253 @@
+// Copyright (C) 2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "thread_monitor.h"
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <stdexcept>
+
+namespace {
+std::mutex registeredNamesMutex;
+std::map<unsigned long, std::string> registeredNames;  // by system thread ids
+
+bool findRegisteredName(unsigned long threadId, std::string& name) {
+    std::lock_guard<std::mutex> lock{registeredNamesMutex};
+    auto iter = registeredNames.find(threadId);
+    if (registeredNames.end() == iter) {
+        return false;
+    }
+    name = iter->second;
+    return true;
+}
+
+// erases the name of a thread when the thread exits, so a new thread which gets its id isn't reported by it
+struct Registration {
+    unsigned long threadId;
+
+    ~Registration() {
+        std::lock_guard<std::mutex> lock{registeredNamesMutex};
+        registeredNames.erase(threadId);
+    }
+};
+
+typedef std::chrono::duration<double, std::chrono::seconds::period> Sec;
+
+struct ThreadTimes {
+    std::string name;
+    double cpuTime;  // in sec since the thread start
+};
+}
+
+#ifdef _WIN32
+#include <windows.h>
+#include <tlhelp32.h>
+
+namespace {
+unsigned long getCurrentThreadId() {
+    return GetCurrentThreadId();
+}
+
+std::map<unsigned long, ThreadTimes> getThreadTimes() {
+    std::map<unsigned long, ThreadTimes> threadTimes;
+    HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+    if (INVALID_HANDLE_VALUE == snapshot) {
+        throw std::runtime_error("CreateToolhelp32Snapshot() failed");
+    }
+    const DWORD processId = GetCurrentProcessId();
+    THREADENTRY32 entry;
+    entry.dwSize = sizeof(entry);
+    for (BOOL found = Thread32First(snapshot, &entry); found; found = Thread32Next(snapshot, &entry)) {
+        if (processId != entry.th32OwnerProcessID) {
+            continue;
+        }
+        HANDLE thread = OpenThread(THREAD_QUERY_LIMITED_INFORMATION, FALSE, entry.th32ThreadID);
+        if (NULL == thread) {
+            continue;  // the thread has exited
+        }
+        FILETIME creationTime, exitTime, kernelTime, userTime;
+        if (GetThreadTimes(thread, &creationTime, &exitTime, &kernelTime, &userTime)) {
+            ULARGE_INTEGER kernel{{kernelTime.dwLowDateTime, kernelTime.dwHighDateTime}},
+                user{{userTime.dwLowDateTime, userTime.dwHighDateTime}};
+            ThreadTimes& times = threadTimes[entry.th32ThreadID];
+            if (!findRegisteredName(entry.th32ThreadID, times.name)) {
+                times.name = "other";
+            }
+            times.cpuTime = (kernel.QuadPart + user.QuadPart) * 1e-7;  // FILETIME is in 100 ns intervals
+        }
+        CloseHandle(thread);
+    }
+    CloseHandle(snapshot);
+    return threadTimes;
+}
+}
+
+#elif __linux__
+#include <fstream>
+#include <sstream>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+const long clockTicks = sysconf(_SC_CLK_TCK);
+
+unsigned long getCurrentThreadId() {
+    return syscall(SYS_gettid);
+}
+
+std::map<unsigned long, ThreadTimes> getThreadTimes() {
+    std::map<unsigned long, ThreadTimes> threadTimes;
+    DIR* tasks = opendir("/proc/self/task");
+    if (nullptr == tasks) {
+        throw std::runtime_error("Can't open /proc/self/task");
+    }
+    while (dirent* task = readdir(tasks)) {
+        if ('.' == task->d_name[0]) {
+            continue;
+        }
+        std::ifstream taskStat(std::string("/proc/self/task/") + task->d_name + "/stat");
+        std::string stat;
+        if (!std::getline(taskStat, stat)) {
+            continue;  // the thread has exited
+        }
+        // the name is in parentheses and may contain spaces and parentheses itself
+        std::size_t nameBegin = stat.find('('), nameEnd = stat.rfind(')');
+        if (std::string::npos == nameBegin || std::string::npos == nameEnd) {
+            continue;
+        }
+        std::istringstream fields(stat.substr(nameEnd + 1));
+        std::string skipped;
+        for (int field = 3; field < 14; ++field) {  // state ... cmajflt
+            fields >> skipped;
+        }
+        unsigned long long utime, stime;
+        if (!(fields >> utime >> stime)) {
+            continue;
+        }
+        const unsigned long threadId = std::stoul(task->d_name);
+        ThreadTimes& times = threadTimes[threadId];
+        if (!findRegisteredName(threadId, times.name)) {
+            times.name = stat.substr(nameBegin + 1, nameEnd - nameBegin - 1);
+        }
+        times.cpuTime = static_cast<double>(utime + stime) / clockTicks;
+    }
+    closedir(tasks);
+    return threadTimes;
+}
+}
+
+#else
+// not implemented
+namespace {
+unsigned long getCurrentThreadId() {
+    return 0;
+}
+
+std::map<unsigned long, ThreadTimes> getThreadTimes() {
+    return {};
+}
+}
+#endif
+
+class ThreadMonitor::PerformanceCounter {
+public:
+    PerformanceCounter() : prevThreadTimes{getThreadTimes()}, prevTimePoint{std::chrono::steady_clock::now()} {}
+
+    std::vector<std::pair<std::string, double>> getThreadLoad() {
+        auto timePoint = std::chrono::steady_clock::now();
+        // don't update data too frequently, CPU times are counted in clock ticks
+        if (timePoint - prevTimePoint <= std::chrono::milliseconds{100}) {
+            return {};
+        }
+        std::map<unsigned long, ThreadTimes> threadTimes = getThreadTimes();
+        const double duration = std::chrono::duration_cast<Sec>(timePoint - prevTimePoint).count();
+        std::map<std::string, double> loadByName;
+        for (const auto& thread : threadTimes) {
+            // a new thread was started after the previous sample, so all its time falls into this interval
+            auto prevIter = prevThreadTimes.find(thread.first);
+            double prevCpuTime = prevThreadTimes.end() == prevIter ? 0.0 : prevIter->second.cpuTime;
+            loadByName[thread.second.name] += std::max(0.0, thread.second.cpuTime - prevCpuTime) / duration;
+        }
+        prevThreadTimes = std::move(threadTimes);
+        prevTimePoint = timePoint;
+
+        std::vector<std::pair<std::string, double>> threadLoad(loadByName.begin(), loadByName.end());
+        std::stable_sort(threadLoad.begin(), threadLoad.end(),
+            [](const std::pair<std::string, double>& l, const std::pair<std::string, double>& r) {
+                return l.second > r.second;
+            });
+        return threadLoad;
+    }
+
+private:
+    std::map<unsigned long, ThreadTimes> prevThreadTimes;
+    std::chrono::steady_clock::time_point prevTimePoint;
+};
+
+ThreadMonitor::ThreadMonitor() :
+    samplesNumber{0},
+    historySize{0} {}
+
+// PerformanceCounter is incomplete in header and destructor can't be defined implicitly
+ThreadMonitor::~ThreadMonitor() = default;
+
+void ThreadMonitor::registerCurrentThread(const std::string& name) {
+#ifdef __linux__
+    // the system name is limited to 15 characters, but it makes the name visible to top and perf too
+    pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+#endif
+    const unsigned long threadId = getCurrentThreadId();
+    static thread_local Registration registration{threadId};
+    std::lock_guard<std::mutex> lock{registeredNamesMutex};
+    registeredNames[threadId] = name;
+}
+
+void ThreadMonitor::setHistorySize(std::size_t size) {
+    if (0 == historySize && 0 != size) {
+        performanceCounter.reset(new PerformanceCounter);
+    } else if (0 != historySize && 0 == size) {
+        performanceCounter.reset();
+    }
+    historySize = size;
+    std::size_t newSize = std::min(size, threadLoadHistory.size());
+    threadLoadHistory.erase(threadLoadHistory.begin(), threadLoadHistory.end() - newSize);
+}
+
+void ThreadMonitor::collectData() {
+    std::vector<std::pair<std::string, double>> threadLoad = performanceCounter->getThreadLoad();
+
+    if (!threadLoad.empty()) {
+        for (const auto& load : threadLoad) {
+            threadLoadSum[load.first] += load.second;
+        }
+        ++samplesNumber;
+
+        threadLoadHistory.push_back(std::move(threadLoad));
+        if (threadLoadHistory.size() > historySize) {
+            threadLoadHistory.pop_front();
+        }
+    }
+}
+
+std::size_t ThreadMonitor::getHistorySize() const {
+    return historySize;
+}
+
+std::deque<std::vector<std::pair<std::string, double>>> ThreadMonitor::getLastHistory() const {
+    return threadLoadHistory;
+}
+
+std::vector<std::pair<std::string, double>> ThreadMonitor::getMeanThreadLoad() const {
+    std::vector<std::pair<std::string, double>> meanThreadLoad;
+    for (const auto& loadSum : threadLoadSum) {
+        meanThreadLoad.emplace_back(loadSum.first, loadSum.second / samplesNumber);
+    }
+    std::stable_sort(meanThreadLoad.begin(), meanThreadLoad.end(),
+        [](const std::pair<std::string, double>& l, const std::pair<std::string, double>& r) {
+            return l.second > r.second;
+        });
+    return meanThreadLoad;
+}
@@ -0,0 +1,36 @@
+// Copyright (C) 2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// samples CPU time of every thread of the process and groups it by thread names. Threads named with
+// registerCurrentThread() are reported by that name until they exit, other threads by their system name, e.g. of
+// an inference plugin thread pool, which sums up the threads of a pool
+class ThreadMonitor {
+public:
+    ThreadMonitor();
+    ~ThreadMonitor();
+    static void registerCurrentThread(const std::string& name);
+    void setHistorySize(std::size_t size);
+    std::size_t getHistorySize() const;
+    void collectData();
+    // the load of every thread name in CPU cores, 1.0 for a fully loaded core, sorted by the load descending
+    std::deque<std::vector<std::pair<std::string, double>>> getLastHistory() const;
+    std::vector<std::pair<std::string, double>> getMeanThreadLoad() const;
+
+private:
+    unsigned samplesNumber;
+    std::size_t historySize;
+    std::map<std::string, double> threadLoadSum;
+    std::deque<std::vector<std::pair<std::string, double>>> threadLoadHistory;
+    class PerformanceCounter;
+    std::unique_ptr<PerformanceCounter> performanceCounter;
+};
@@ -8,7 +8,9 @@
 
 namespace human_pose_estimation {
 HumanPose::HumanPose(const std::vector<cv::Point2f>& keypoints,
-                     const float& score)
+                     const float& score,
+                     const std::vector<float>& keypointsScores)
     : keypoints(keypoints),
-      score(score) {}
+      score(score),
+      keypointsScores(keypointsScores) {}
 }  // namespace human_pose_estimation
@@ -11,9 +11,11 @@
 namespace human_pose_estimation {
 struct HumanPose {
     HumanPose(const std::vector<cv::Point2f>& keypoints = std::vector<cv::Point2f>(),
-              const float& score = 0);
+              const float& score = 0,
+              const std::vector<float>& keypointsScores = std::vector<float>());
 
     std::vector<cv::Point2f> keypoints;
     float score;
+    std::vector<float> keypointsScores;  // heatmap values of the keypoints, -1 for the missing ones
 };
 }  // namespace human_pose_estimation
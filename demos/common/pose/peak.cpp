@@ -0,0 +1,370 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include <samples/heatmap_peaks.hpp>
+
+#include "peak.hpp"
+
+namespace human_pose_estimation {
+Peak::Peak(const int id, const cv::Point2f& pos, const float score)
+    : id(id),
+      pos(pos),
+      score(score) {}
+
+TwoJointsConnection::TwoJointsConnection(const int firstJointIdx,
+                                         const int secondJointIdx,
+                                         const float score)
+    : firstJointIdx(firstJointIdx),
+      secondJointIdx(secondJointIdx),
+      score(score) {}
+
+void findPeaks(const std::vector<cv::Mat>& heatMaps,
+               const float minPeaksDistance,
+               std::vector<std::vector<Peak> >& allPeaks,
+               int heatMapId) {
+    const float threshold = 0.1f;
+    const cv::Mat& heatMap = heatMaps[heatMapId];
+    std::vector<cv::Point> peaks = suppressClosePeaks(findHeatMapMaxima(heatMap, threshold),
+                                                      heatMap.size(), minPeaksDistance);
+    std::vector<Peak>& peaksWithScoreAndID = allPeaks[heatMapId];
+    for (size_t i = 0; i < peaks.size(); i++) {
+        peaksWithScoreAndID.push_back(Peak(static_cast<int>(i), peaks[i], heatMap.at<float>(peaks[i])));
+    }
+}
+
+void findRefinedPeaks(const std::vector<cv::Mat>& heatMaps,
+                      const float minPeaksDistance,
+                      std::vector<std::vector<Peak> >& allPeaks,
+                      int heatMapId) {
+    const float threshold = 0.1f;
+    const cv::Mat& heatMap = heatMaps[heatMapId];
+    std::vector<cv::Point> peaks = suppressClosePeaks(findHeatMapMaxima(heatMap, threshold),
+                                                      heatMap.size(), minPeaksDistance);
+    std::vector<Peak>& peaksWithScoreAndID = allPeaks[heatMapId];
+    for (size_t i = 0; i < peaks.size(); i++) {
+        peaksWithScoreAndID.push_back(Peak(static_cast<int>(i), refineHeatMapMaximum(heatMap, peaks[i]),
+                                           heatMap.at<float>(peaks[i])));
+    }
+}
+
+std::vector<HumanPose> groupPeaksToPoses(const std::vector<std::vector<Peak> >& allPeaks,
+                                         const std::vector<cv::Mat>& pafs,
+                                         const size_t keypointsNumber,
+                                         const float midPointsScoreThreshold,
+                                         const float foundMidPointsRatioThreshold,
+                                         const int minJointsNumber,
+                                         const float minSubsetScore) {
+    PoseGroupingScratch scratch;
+    return groupPeaksToPoses(allPeaks, pafs, keypointsNumber, midPointsScoreThreshold,
+                             foundMidPointsRatioThreshold, minJointsNumber, minSubsetScore, scratch);
+}
+
+std::vector<HumanPose> groupPeaksToPoses(const std::vector<std::vector<Peak> >& allPeaks,
+                                         const std::vector<cv::Mat>& pafs,
+                                         const size_t keypointsNumber,
+                                         const float midPointsScoreThreshold,
+                                         const float foundMidPointsRatioThreshold,
+                                         const int minJointsNumber,
+                                         const float minSubsetScore,
+                                         PoseGroupingScratch& scratch) {
+    static const std::pair<int, int> limbIdsHeatmap[] = {
+        {2, 3}, {2, 6}, {3, 4}, {4, 5}, {6, 7}, {7, 8}, {2, 9}, {9, 10}, {10, 11}, {2, 12}, {12, 13}, {13, 14},
+        {2, 1}, {1, 15}, {15, 17}, {1, 16}, {16, 18}, {3, 17}, {6, 18}
+    };
+    static const std::pair<int, int> limbIdsPaf[] = {
+        {31, 32}, {39, 40}, {33, 34}, {35, 36}, {41, 42}, {43, 44}, {19, 20}, {21, 22}, {23, 24}, {25, 26},
+        {27, 28}, {29, 30}, {47, 48}, {49, 50}, {53, 54}, {51, 52}, {55, 56}, {37, 38}, {45, 46}
+    };
+
+    std::vector<cv::Point2f>& positions = scratch.candidatePositions;
+    std::vector<float>& scores = scratch.candidateScores;
+    std::vector<int>& firstPeakIds = scratch.firstPeakIds;
+    positions.clear();
+    scores.clear();
+    firstPeakIds.clear();
+    for (const auto& peaks : allPeaks) {
+        firstPeakIds.push_back(static_cast<int>(positions.size()));
+        for (const auto& peak : peaks) {
+            positions.push_back(peak.pos);
+            scores.push_back(peak.score);
+        }
+    }
+
+    std::vector<int>& posePeaksIds = scratch.posePeaksIds;
+    std::vector<int>& poseJointsNumbers = scratch.poseJointsNumbers;
+    std::vector<float>& poseScores = scratch.poseScores;
+    posePeaksIds.clear();
+    poseJointsNumbers.clear();
+    poseScores.clear();
+    auto peaksIdsOf = [&](size_t pose) {
+        return posePeaksIds.data() + pose * keypointsNumber;
+    };
+    auto addPose = [&](int jointA, int idA, int jointB, int idB, int jointsNumber, float score) {
+        posePeaksIds.insert(posePeaksIds.end(), keypointsNumber, -1);
+        int* peaksIds = peaksIdsOf(poseScores.size());
+        peaksIds[jointA] = idA;
+        peaksIds[jointB] = idB;
+        poseJointsNumbers.push_back(jointsNumber);
+        poseScores.push_back(score);
+    };
+    // starts the poses of the peaks of a joint, which aren't in the poses yet
+    auto addSingleJointPoses = [&](int joint) {
+        const int firstId = firstPeakIds[joint];
+        const int lastId = firstId + static_cast<int>(allPeaks[joint].size());
+        for (int id = firstId; id < lastId; id++) {
+            bool found = false;
+            for (size_t j = 0; j < poseScores.size() && !found; j++) {
+                found = peaksIdsOf(j)[joint] == id;
+            }
+            if (!found) {
+                addPose(joint, id, joint, id, 1, scores[id]);
+            }
+        }
+    };
+
+    std::vector<TwoJointsConnection>& connections = scratch.connections;
+    std::vector<TwoJointsConnection>& tempJointConnections = scratch.tempJointConnections;
+    std::vector<int>& occurA = scratch.occurA;
+    std::vector<int>& occurB = scratch.occurB;
+    const int mapIdxOffset = static_cast<int>(keypointsNumber) + 1;
+    const int height_n = pafs[0].rows / 2;
+    for (size_t k = 0; k < sizeof(limbIdsPaf) / sizeof(*limbIdsPaf); k++) {
+        connections.clear();
+        const cv::Mat& pafX = pafs[limbIdsPaf[k].first - mapIdxOffset];
+        const cv::Mat& pafY = pafs[limbIdsPaf[k].second - mapIdxOffset];
+        const int idxJointA = limbIdsHeatmap[k].first - 1;
+        const int idxJointB = limbIdsHeatmap[k].second - 1;
+        const size_t nJointsA = allPeaks[idxJointA].size();
+        const size_t nJointsB = allPeaks[idxJointB].size();
+        if (nJointsA == 0
+                && nJointsB == 0) {
+            continue;
+        } else if (nJointsA == 0) {
+            addSingleJointPoses(idxJointB);
+            continue;
+        } else if (nJointsB == 0) {
+            addSingleJointPoses(idxJointA);
+            continue;
+        }
+        const int firstIdA = firstPeakIds[idxJointA];
+        const int firstIdB = firstPeakIds[idxJointB];
+        const cv::Point2f* candA = positions.data() + firstIdA;
+        const cv::Point2f* candB = positions.data() + firstIdB;
+
+        tempJointConnections.clear();
+        for (size_t i = 0; i < nJointsA; i++) {
+            for (size_t j = 0; j < nJointsB; j++) {
+                cv::Point2f pt = candA[i] * 0.5 + candB[j] * 0.5;
+                cv::Point mid = cv::Point(cvRound(pt.x), cvRound(pt.y));
+                cv::Point2f vec = candB[j] - candA[i];
+                double norm_vec = cv::norm(vec);
+                if (norm_vec == 0) {
+                    continue;
+                }
+                vec /= norm_vec;
+                float score = vec.x * pafX.at<float>(mid) + vec.y * pafY.at<float>(mid);
+                float suc_ratio = 0.0f;
+                float mid_score = 0.0f;
+                const int mid_num = 10;
+                const float scoreThreshold = -100.0f;
+                if (score > scoreThreshold) {
+                    float p_sum = 0;
+                    int p_count = 0;
+                    cv::Size2f step((candB[j].x - candA[i].x)/(mid_num - 1),
+                                    (candB[j].y - candA[i].y)/(mid_num - 1));
+                    for (int n = 0; n < mid_num; n++) {
+                        cv::Point midPoint(cvRound(candA[i].x + n * step.width),
+                                           cvRound(candA[i].y + n * step.height));
+                        score = vec.x * pafX.at<float>(midPoint) + vec.y * pafY.at<float>(midPoint);
+                        if (score > midPointsScoreThreshold) {
+                            p_sum += score;
+                            p_count++;
+                        }
+                    }
+                    suc_ratio = static_cast<float>(p_count / mid_num);
+                    float ratio = p_count > 0 ? p_sum / p_count : 0.0f;
+                    mid_score = ratio + static_cast<float>(std::min(height_n / norm_vec - 1, 0.0));
+                }
+                if (mid_score > 0
+                        && suc_ratio > foundMidPointsRatioThreshold) {
+                    tempJointConnections.push_back(TwoJointsConnection(static_cast<int>(i), static_cast<int>(j), mid_score));
+                }
+            }
+        }
+        if (!tempJointConnections.empty()) {
+            std::sort(tempJointConnections.begin(), tempJointConnections.end(),
+                      [](const TwoJointsConnection& a,
+                         const TwoJointsConnection& b) {
+                return (a.score > b.score);
+            });
+        }
+        size_t num_limbs = std::min(nJointsA, nJointsB);
+        size_t cnt = 0;
+        occurA.assign(nJointsA, 0);
+        occurB.assign(nJointsB, 0);
+        for (size_t row = 0; row < tempJointConnections.size(); row++) {
+            if (cnt == num_limbs) {
+                break;
+            }
+            const int& indexA = tempJointConnections[row].firstJointIdx;
+            const int& indexB = tempJointConnections[row].secondJointIdx;
+            const float& score = tempJointConnections[row].score;
+            if (occurA[indexA] == 0
+                    && occurB[indexB] == 0) {
+                connections.push_back(TwoJointsConnection(firstIdA + indexA, firstIdB + indexB, score));
+                cnt++;
+                occurA[indexA] = 1;
+                occurB[indexB] = 1;
+            }
+        }
+        if (connections.empty()) {
+            continue;
+        }
+
+        bool extraJointConnections = (k == 17 || k == 18);
+        if (k == 0) {
+            posePeaksIds.clear();
+            poseJointsNumbers.clear();
+            poseScores.clear();
+            for (size_t i = 0; i < connections.size(); i++) {
+                const int& indexA = connections[i].firstJointIdx;
+                const int& indexB = connections[i].secondJointIdx;
+                addPose(idxJointA, indexA, idxJointB, indexB, 2,
+                        scores[indexA] + scores[indexB] + connections[i].score);
+            }
+        } else if (extraJointConnections) {
+            for (size_t i = 0; i < connections.size(); i++) {
+                const int& indexA = connections[i].firstJointIdx;
+                const int& indexB = connections[i].secondJointIdx;
+                for (size_t j = 0; j < poseScores.size(); j++) {
+                    int* peaksIds = peaksIdsOf(j);
+                    if (peaksIds[idxJointA] == indexA
+                            && peaksIds[idxJointB] == -1) {
+                        peaksIds[idxJointB] = indexB;
+                    } else if (peaksIds[idxJointB] == indexB
+                                && peaksIds[idxJointA] == -1) {
+                        peaksIds[idxJointA] = indexA;
+                    }
+                }
+            }
+            continue;
+        } else {
+            for (size_t i = 0; i < connections.size(); i++) {
+                const int& indexA = connections[i].firstJointIdx;
+                const int& indexB = connections[i].secondJointIdx;
+                bool num = false;
+                for (size_t j = 0; j < poseScores.size(); j++) {
+                    int* peaksIds = peaksIdsOf(j);
+                    if (peaksIds[idxJointA] == indexA) {
+                        peaksIds[idxJointB] = indexB;
+                        poseJointsNumbers[j]++;
+                        poseScores[j] += scores[indexB] + connections[i].score;
+                        num = true;
+                    }
+                }
+                if (!num) {
+                    addPose(idxJointA, indexA, idxJointB, indexB, 2,
+                            scores[indexA] + scores[indexB] + connections[i].score);
+                }
+            }
+        }
+    }
+    std::vector<HumanPose> poses;
+    poses.reserve(poseScores.size());
+    for (size_t i = 0; i < poseScores.size(); i++) {
+        if (poseJointsNumbers[i] < minJointsNumber
+                || poseScores[i] / poseJointsNumbers[i] < minSubsetScore) {
+            continue;
+        }
+        HumanPose pose(std::vector<cv::Point2f>(keypointsNumber, cv::Point2f(-1.0f, -1.0f)),
+                       poseScores[i] * std::max(0, poseJointsNumbers[i] - 1),
+                       std::vector<float>(keypointsNumber, -1.0f));
+        const int* peaksIds = peaksIdsOf(i);
+        for (size_t position = 0; position < keypointsNumber; position++) {
+            const int peakIdx = peaksIds[position];
+            if (peakIdx >= 0) {
+                pose.keypoints[position] = positions[peakIdx];
+                pose.keypoints[position].x += 0.5;
+                pose.keypoints[position].y += 0.5;
+                pose.keypointsScores[position] = scores[peakIdx];
+            }
+        }
+        poses.push_back(pose);
+    }
+    return poses;
+}
+
+class FindPeaksBody: public cv::ParallelLoopBody {
+public:
+    FindPeaksBody(const std::vector<cv::Mat>& heatMaps, float minPeaksDistance, bool refine,
+                  std::vector<std::vector<Peak> >& peaksFromHeatMap)
+        : heatMaps(heatMaps),
+          minPeaksDistance(minPeaksDistance),
+          refine(refine),
+          peaksFromHeatMap(peaksFromHeatMap) {}
+
+    virtual void operator()(const cv::Range& range) const {
+        for (int i = range.start; i < range.end; i++) {
+            if (refine) {
+                findRefinedPeaks(heatMaps, minPeaksDistance, peaksFromHeatMap, i);
+            } else {
+                findPeaks(heatMaps, minPeaksDistance, peaksFromHeatMap, i);
+            }
+        }
+    }
+
+private:
+    const std::vector<cv::Mat>& heatMaps;
+    float minPeaksDistance;
+    bool refine;
+    std::vector<std::vector<Peak> >& peaksFromHeatMap;
+};
+
+std::vector<HumanPose> findPoses(const std::vector<cv::Mat>& heatMaps,
+                                 const std::vector<cv::Mat>& pafs,
+                                 const size_t keypointsNumber,
+                                 const float minPeaksDistance,
+                                 const float midPointsScoreThreshold,
+                                 const float foundMidPointsRatioThreshold,
+                                 const int minJointsNumber,
+                                 const float minSubsetScore,
+                                 const bool refinePeaks) {
+    PoseGroupingScratch scratch;
+    return findPoses(heatMaps, pafs, keypointsNumber, minPeaksDistance, midPointsScoreThreshold,
+                     foundMidPointsRatioThreshold, minJointsNumber, minSubsetScore, refinePeaks, scratch);
+}
+
+std::vector<HumanPose> findPoses(const std::vector<cv::Mat>& heatMaps,
+                                 const std::vector<cv::Mat>& pafs,
+                                 const size_t keypointsNumber,
+                                 const float minPeaksDistance,
+                                 const float midPointsScoreThreshold,
+                                 const float foundMidPointsRatioThreshold,
+                                 const int minJointsNumber,
+                                 const float minSubsetScore,
+                                 const bool refinePeaks,
+                                 PoseGroupingScratch& scratch) {
+    std::vector<std::vector<Peak> >& peaksFromHeatMap = scratch.peaksFromHeatMap;
+    peaksFromHeatMap.resize(heatMaps.size());
+    for (auto& peaks : peaksFromHeatMap) {
+        peaks.clear();
+    }
+    FindPeaksBody findPeaksBody(heatMaps, minPeaksDistance, refinePeaks, peaksFromHeatMap);
+    cv::parallel_for_(cv::Range(0, static_cast<int>(heatMaps.size())),
+                      findPeaksBody);
+    int peaksBefore = 0;
+    for (size_t heatmapId = 1; heatmapId < heatMaps.size(); heatmapId++) {
+        peaksBefore += static_cast<int>(peaksFromHeatMap[heatmapId - 1].size());
+        for (auto& peak : peaksFromHeatMap[heatmapId]) {
+            peak.id += peaksBefore;
+        }
+    }
+    return groupPeaksToPoses(peaksFromHeatMap, pafs, keypointsNumber, midPointsScoreThreshold,
+                             foundMidPointsRatioThreshold, minJointsNumber, minSubsetScore, scratch);
+}
+}  // namespace human_pose_estimation
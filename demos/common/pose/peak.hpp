@@ -0,0 +1,108 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "human_pose.hpp"
+
+namespace human_pose_estimation {
+struct Peak {
+    Peak(const int id = -1,
+         const cv::Point2f& pos = cv::Point2f(),
+         const float score = 0.0f);
+
+    int id;
+    cv::Point2f pos;
+    float score;
+};
+
+struct TwoJointsConnection {
+    TwoJointsConnection(const int firstJointIdx,
+                        const int secondJointIdx,
+                        const float score);
+
+    int firstJointIdx;
+    int secondJointIdx;
+    float score;
+};
+
+// Buffers of the peaks search and the grouping kept between the frames, they only grow
+// to the largest scene, so the grouping doesn't allocate after the first frames.
+// The peaks and the poses are stored as flat columns, a scratch is used by one thread at a time
+struct PoseGroupingScratch {
+    std::vector<std::vector<Peak> > peaksFromHeatMap;
+    std::vector<cv::Point2f> candidatePositions;  // of all the peaks, indexed by the peak ids
+    std::vector<float> candidateScores;
+    std::vector<int> firstPeakIds;  // of the heatmaps
+    std::vector<int> posePeaksIds;  // keypointsNumber per pose, -1 for the missing keypoints
+    std::vector<int> poseJointsNumbers;
+    std::vector<float> poseScores;
+    std::vector<TwoJointsConnection> connections;
+    std::vector<TwoJointsConnection> tempJointConnections;
+    std::vector<int> occurA;
+    std::vector<int> occurB;
+};
+
+void findPeaks(const std::vector<cv::Mat>& heatMaps,
+               const float minPeaksDistance,
+               std::vector<std::vector<Peak> >& allPeaks,
+               int heatMapId);
+
+// Finds the peaks as findPeaks does and moves them to their subpixel positions,
+// which is precise enough on the feature maps of the network resolution
+void findRefinedPeaks(const std::vector<cv::Mat>& heatMaps,
+                      const float minPeaksDistance,
+                      std::vector<std::vector<Peak> >& allPeaks,
+                      int heatMapId);
+
+std::vector<HumanPose> groupPeaksToPoses(
+        const std::vector<std::vector<Peak> >& allPeaks,
+        const std::vector<cv::Mat>& pafs,
+        const size_t keypointsNumber,
+        const float midPointsScoreThreshold,
+        const float foundMidPointsRatioThreshold,
+        const int minJointsNumber,
+        const float minSubsetScore);
+
+// Groups the peaks using the buffers of the scratch, the peak ids are the indices of
+// the peaks in allPeaks concatenated
+std::vector<HumanPose> groupPeaksToPoses(
+        const std::vector<std::vector<Peak> >& allPeaks,
+        const std::vector<cv::Mat>& pafs,
+        const size_t keypointsNumber,
+        const float midPointsScoreThreshold,
+        const float foundMidPointsRatioThreshold,
+        const int minJointsNumber,
+        const float minSubsetScore,
+        PoseGroupingScratch& scratch);
+
+// Finds the peaks of all the heatmaps in parallel and groups them to poses by the PAFs,
+// the peaks are refined by findRefinedPeaks if refinePeaks is set
+std::vector<HumanPose> findPoses(
+        const std::vector<cv::Mat>& heatMaps,
+        const std::vector<cv::Mat>& pafs,
+        const size_t keypointsNumber,
+        const float minPeaksDistance,
+        const float midPointsScoreThreshold,
+        const float foundMidPointsRatioThreshold,
+        const int minJointsNumber,
+        const float minSubsetScore,
+        const bool refinePeaks = false);
+
+std::vector<HumanPose> findPoses(
+        const std::vector<cv::Mat>& heatMaps,
+        const std::vector<cv::Mat>& pafs,
+        const size_t keypointsNumber,
+        const float minPeaksDistance,
+        const float midPointsScoreThreshold,
+        const float foundMidPointsRatioThreshold,
+        const int minJointsNumber,
+        const float minSubsetScore,
+        const bool refinePeaks,
+        PoseGroupingScratch& scratch);
+}  // namespace human_pose_estimation
@@ -0,0 +1,252 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+/**
+ * @brief a header file with a solver of the rectangular linear assignment problem
+ * @file assignment.hpp
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+/**
+* @brief Solves the linear assignment problem for a rectangular CV_32F cost matrix by shortest augmenting paths
+* with dual potentials (the Jonker-Volgenant scheme) in O(n^3), n = max(rows, cols). The matrix is padded to
+* a square one with zero cost dummy rows or columns, so the surplus rows or columns stay unassigned.
+*
+* With a finite maxCost the input is gated: a pair costing more is never assigned and leaving a row or
+* a column unassigned costs maxCost / 2, so a pair is assigned only if it is cheaper than maxCost. The search
+* visits only the admissible pairs, so a sparse gated matrix is solved faster than a dense one.
+*
+* The row duals of the last solve can be passed to the next one for the rows that persist, e.g. the tracks
+* of consecutive frames, to start closer to the optimal dual solution.
+*/
+class AssignmentSolver {
+public:
+    enum : std::size_t {
+        UNASSIGNED = static_cast<std::size_t>(-1)
+    };
+
+    explicit AssignmentSolver(float maxCost = std::numeric_limits<float>::infinity()) : maxCost(maxCost) {}
+
+    /**
+    * @brief Returns the column assigned to each row or UNASSIGNED. initialRowDuals may be empty or have
+    * a value per row, NaN values start from the row minimum
+    */
+    std::vector<std::size_t> solve(const cv::Mat& cost, const std::vector<float>& initialRowDuals = {}) {
+        if (CV_32F != cost.type() || 2 != cost.dims) {
+            throw std::invalid_argument("AssignmentSolver expects a CV_32F matrix");
+        }
+        if (!initialRowDuals.empty() && initialRowDuals.size() != static_cast<std::size_t>(cost.rows)) {
+            throw std::invalid_argument("AssignmentSolver expects a dual per row");
+        }
+        if (std::isinf(maxCost)) {
+            buildDense(cost);
+        } else {
+            buildGated(cost);
+        }
+        initDuals(initialRowDuals);
+        run();
+
+        std::vector<std::size_t> assignment(cost.rows, UNASSIGNED);
+        for (int i = 0; i < cost.rows; ++i) {
+            if (colForRow[i] < static_cast<std::size_t>(cost.cols)) {
+                assignment[i] = colForRow[i];
+            }
+        }
+        rowDuals.assign(u.begin(), u.begin() + cost.rows);
+        return assignment;
+    }
+
+    /** @brief the row duals of the last solve for a warm start of the next one */
+    const std::vector<float>& getRowDuals() const {
+        return rowDuals;
+    }
+
+private:
+    void addPair(std::size_t col, double pairCost) {
+        columns.push_back(col);
+        costs.push_back(pairCost);
+    }
+
+    void buildDense(const cv::Mat& cost) {
+        n = std::max(cost.rows, cost.cols);
+        rowBegin.clear();
+        columns.clear();
+        costs.clear();
+        for (int i = 0; i < static_cast<int>(n); ++i) {
+            rowBegin.push_back(columns.size());
+            const float* costRow = i < cost.rows ? cost.ptr<float>(i) : nullptr;
+            for (int j = 0; j < static_cast<int>(n); ++j) {
+                addPair(j, nullptr != costRow && j < cost.cols ? costRow[j] : 0.0);
+            }
+        }
+        rowBegin.push_back(columns.size());
+    }
+
+    // rows: the real ones, then a dummy per real column. Columns: the real ones, then a dummy per real row.
+    // A real row pairs with its dummy column, a real column with its dummy row for maxCost / 2. A dummy row of
+    // a column pairs with the dummy columns of the rows admissible for the column at no cost, so the dummies
+    // of the rows and the columns of any assigned pair complete each other to a perfect assignment
+    void buildGated(const cv::Mat& cost) {
+        const int rows = cost.rows, cols = cost.cols;
+        n = rows + cols;
+        const double unassignedCost = maxCost / 2;
+        std::vector<std::vector<int>> admissibleRows(cols);
+        rowBegin.clear();
+        columns.clear();
+        costs.clear();
+        for (int i = 0; i < rows; ++i) {
+            rowBegin.push_back(columns.size());
+            const float* costRow = cost.ptr<float>(i);
+            for (int j = 0; j < cols; ++j) {
+                if (costRow[j] <= maxCost) {
+                    addPair(j, costRow[j]);
+                    admissibleRows[j].push_back(i);
+                }
+            }
+            addPair(cols + i, unassignedCost);
+        }
+        for (int j = 0; j < cols; ++j) {
+            rowBegin.push_back(columns.size());
+            addPair(j, unassignedCost);
+            for (int i : admissibleRows[j]) {
+                addPair(cols + i, 0.0);
+            }
+        }
+        rowBegin.push_back(columns.size());
+    }
+
+    // any duals with cost - u - v >= 0 are a valid start of a square problem. The row duals are given or
+    // reduce the rows to the minimum, the columns take the minimal reduced costs
+    void initDuals(const std::vector<float>& initialRowDuals) {
+        const double inf = std::numeric_limits<double>::infinity();
+        u.assign(n, inf);
+        v.assign(n, inf);
+        for (std::size_t i = 0; i < n; ++i) {
+            if (i < initialRowDuals.size() && !std::isnan(initialRowDuals[i])) {
+                u[i] = initialRowDuals[i];
+            } else {
+                for (std::size_t k = rowBegin[i]; k < rowBegin[i + 1]; ++k) {
+                    u[i] = std::min(u[i], costs[k]);
+                }
+            }
+            for (std::size_t k = rowBegin[i]; k < rowBegin[i + 1]; ++k) {
+                v[columns[k]] = std::min(v[columns[k]], costs[k] - u[i]);
+            }
+        }
+    }
+
+    void run() {
+        colForRow.assign(n, UNASSIGNED);
+        rowForCol.assign(n, UNASSIGNED);
+        // the tight pairs of the initial duals give a partial optimal assignment for free
+        for (std::size_t i = 0; i < n; ++i) {
+            for (std::size_t k = rowBegin[i]; k < rowBegin[i + 1] && UNASSIGNED == colForRow[i]; ++k) {
+                const std::size_t j = columns[k];
+                if (UNASSIGNED == rowForCol[j] && costs[k] - u[i] - v[j] <= 0.0) {
+                    colForRow[i] = j;
+                    rowForCol[j] = i;
+                }
+            }
+        }
+
+        const double inf = std::numeric_limits<double>::infinity();
+        dist.assign(n, inf);
+        predecessor.assign(n, UNASSIGNED);
+        scanned.assign(n, 0);
+        for (std::size_t freeRow = 0; freeRow < n; ++freeRow) {
+            if (UNASSIGNED != colForRow[freeRow]) {
+                continue;
+            }
+            // Dijkstra over the columns with the reduced costs, the assigned pairs are tight
+            touched.clear();
+            scannedColumns.clear();
+            auto relax = [&](std::size_t row, double rowDist) {
+                for (std::size_t k = rowBegin[row]; k < rowBegin[row + 1]; ++k) {
+                    const std::size_t j = columns[k];
+                    const double newDist = rowDist + costs[k] - u[row] - v[j];
+                    if (!scanned[j] && newDist < dist[j]) {
+                        if (std::isinf(dist[j])) {
+                            touched.push_back(j);
+                        }
+                        dist[j] = newDist;
+                        predecessor[j] = row;
+                    }
+                }
+            };
+            relax(freeRow, 0.0);
+            std::size_t freeCol = UNASSIGNED;
+            while (UNASSIGNED == freeCol) {
+                std::size_t nearest = UNASSIGNED;
+                for (std::size_t j : touched) {
+                    if (!scanned[j] && (UNASSIGNED == nearest || dist[j] < dist[nearest])) {
+                        nearest = j;
+                    }
+                }
+                if (UNASSIGNED == nearest) {
+                    throw std::logic_error("AssignmentSolver found no augmenting path");  // a square problem has one
+                }
+                scanned[nearest] = 1;
+                scannedColumns.push_back(nearest);
+                if (UNASSIGNED == rowForCol[nearest]) {
+                    freeCol = nearest;
+                } else {
+                    relax(rowForCol[nearest], dist[nearest]);
+                }
+            }
+
+            // keeps the pairs of the path and of the assignment tight and the rest nonnegative
+            const double pathLength = dist[freeCol];
+            u[freeRow] += pathLength;
+            for (std::size_t j : scannedColumns) {
+                if (j != freeCol) {
+                    u[rowForCol[j]] += pathLength - dist[j];
+                    v[j] -= pathLength - dist[j];
+                }
+            }
+            for (std::size_t j = freeCol; UNASSIGNED != j;) {
+                const std::size_t row = predecessor[j];
+                const std::size_t nextCol = colForRow[row];
+                colForRow[row] = j;
+                rowForCol[j] = row;
+                j = nextCol;
+            }
+            for (std::size_t j : touched) {
+                dist[j] = inf;
+                predecessor[j] = UNASSIGNED;
+                scanned[j] = 0;
+            }
+        }
+    }
+
+    const float maxCost;
+
+    std::size_t n = 0;  // of the square problem
+    // the pairs of row i are [rowBegin[i], rowBegin[i + 1]) in columns and costs
+    std::vector<std::size_t> rowBegin;
+    std::vector<std::size_t> columns;
+    std::vector<double> costs;
+
+    std::vector<double> u;
+    std::vector<double> v;
+    std::vector<std::size_t> colForRow;
+    std::vector<std::size_t> rowForCol;
+
+    std::vector<double> dist;
+    std::vector<std::size_t> predecessor;
+    std::vector<char> scanned;
+    std::vector<std::size_t> touched;
+    std::vector<std::size_t> scannedColumns;
+
+    std::vector<float> rowDuals;
+};
@@ -0,0 +1,199 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+/**
+ * @brief a header file with a display thread showing the frames of a demo, so the window doesn't stall the inference
+ * @file async_presenter.hpp
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+#include <monitors/presenter.h>
+#include <samples/instrumentation.hpp>
+
+/**
+* @brief Shows the frames of a single stream demo on its own thread, like AsyncOutput of multi_channel. The frames
+* go through a latest-wins slot: a frame not shown yet is replaced by the next one, so a slow window skips frames
+* instead of holding the inference loop back. All the HighGUI calls for the window are on the display thread,
+* the keys pressed in it are queued for waitKey() of the caller. If a Presenter is given, its graphs are drawn on
+* the display thread and handleKey() passes the keys to it, the caller doesn't touch the Presenter then
+*/
+class AsyncPresenter {
+public:
+    struct Stats {
+        std::size_t shownFrames;
+        std::size_t skippedFrames;  // replaced in the slot before they were shown
+        double renderTime;  // the mean msec of drawing the graphs and showing a frame
+    };
+
+    /**
+    * @param show false - no window and no thread, the frames are dropped and waitKey() returns -1 after the delay
+    * @param setupWindow creates the window on the display thread, e.g. with its trackbars, cv::namedWindow() by
+    * default
+    */
+    AsyncPresenter(const std::string& windowName, bool show, Presenter* presenter = nullptr,
+                   std::function<void()> setupWindow = nullptr):
+            windowName{windowName}, presenter{presenter}, setupWindow{std::move(setupWindow)}, stopped{false},
+            stats{0, 0, 0.0} {
+        if (show) {
+            thread = std::thread(&AsyncPresenter::run, this);
+        }
+    }
+
+    AsyncPresenter(const AsyncPresenter&) = delete;
+    AsyncPresenter& operator=(const AsyncPresenter&) = delete;
+
+    ~AsyncPresenter() {
+        stop();
+    }
+
+    /**
+    * @brief Stops the display thread, a frame which isn't shown yet is dropped
+    */
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            stopped = true;
+        }
+        frameChanged.notify_all();
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+    /**
+    * @brief Passes the frame to the display thread, the caller must not change the frame data afterwards
+    */
+    void show(cv::Mat frame) {
+        if (!thread.joinable()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            if (!pending.empty()) {
+                stats.skippedFrames++;
+            }
+            pending = std::move(frame);
+        }
+        frameChanged.notify_all();
+    }
+
+    /**
+    * @brief Returns the first key pressed in the window which isn't returned yet, or -1. Waits for a key up to
+    * delay msec as cv::waitKey() does, for a key forever if delay is 0 and doesn't wait if delay is negative.
+    * Without the window it only sleeps for a positive delay, so the delay still paces the caller
+    */
+    int waitKey(int delay) {
+        if (!thread.joinable()) {
+            if (delay > 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+            }
+            return -1;
+        }
+        std::unique_lock<std::mutex> lock{mutex};
+        const auto pressed = [this] {
+            return !keys.empty();
+        };
+        if (delay > 0) {
+            keyPressed.wait_for(lock, std::chrono::milliseconds(delay), pressed);
+        } else if (0 == delay) {
+            keyPressed.wait(lock, pressed);
+        }
+        if (keys.empty()) {
+            return -1;
+        }
+        const int key = keys.front();
+        keys.pop_front();
+        return key;
+    }
+
+    /**
+    * @brief Presenter::handleKey() of the Presenter drawn on the display thread
+    */
+    void handleKey(int key) {
+        if (nullptr != presenter) {
+            std::lock_guard<std::mutex> lock{presenterMutex};
+            presenter->handleKey(key);
+        }
+    }
+
+    Stats getStats() const {
+        std::lock_guard<std::mutex> lock{mutex};
+        Stats meanStats = stats;
+        meanStats.renderTime = 0 == stats.shownFrames ? 0.0 : stats.renderTime / stats.shownFrames;
+        return meanStats;
+    }
+
+private:
+    void run() {
+        instrumentation::registerCurrentThread("display");
+        if (setupWindow) {
+            setupWindow();
+        } else {
+            cv::namedWindow(windowName);
+        }
+        while (true) {
+            cv::Mat frame;
+            {
+                std::unique_lock<std::mutex> lock{mutex};
+                // the window handles its events between the frames too
+                frameChanged.wait_for(lock, std::chrono::milliseconds(30), [this] {
+                    return stopped || !pending.empty();
+                });
+                if (stopped) {
+                    return;
+                }
+                frame = std::move(pending);
+                pending = cv::Mat();
+            }
+            const auto start = std::chrono::steady_clock::now();
+            if (!frame.empty()) {
+                DEMO_FRAME("display");
+                if (nullptr != presenter) {
+                    std::lock_guard<std::mutex> lock{presenterMutex};
+                    presenter->drawGraphs(frame);
+                }
+                cv::imshow(windowName, frame);
+            }
+            const int key = cv::waitKey(1);
+            std::lock_guard<std::mutex> lock{mutex};
+            if (!frame.empty()) {
+                stats.shownFrames++;
+                stats.renderTime += std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start).count();
+            }
+            if (-1 != key) {
+                keys.push_back(key);
+                keyPressed.notify_all();
+            }
+        }
+    }
+
+    const std::string windowName;
+    Presenter* const presenter;
+    const std::function<void()> setupWindow;
+
+    mutable std::mutex mutex;
+    std::condition_variable frameChanged;
+    std::condition_variable keyPressed;
+    cv::Mat pending;  // the slot of the next frame to show
+    std::deque<int> keys;
+    bool stopped;
+    Stats stats;  // the render time is the sum
+    std::mutex presenterMutex;
+    std::thread thread;
+};
@@ -0,0 +1,309 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+/**
+ * @brief a header file with the benchmarking of the precision variants, batch sizes and streams of a model on a
+ * device, the winner is cached for the later runs of the demo on the host
+ * @file autotune.hpp
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <inference_engine.hpp>
+
+#include <samples/infer_request_pool.hpp>
+#include <samples/network_cache.hpp>
+#include <samples/slog.hpp>
+
+namespace autotune {
+/**
+* @brief A configuration of the model on the device
+*/
+struct Candidate {
+    std::string modelPath;
+    std::size_t batchSize;
+    unsigned streams;  // 0 - the default of the device
+};
+
+struct Measurement {
+    Candidate candidate;
+    double throughput;  // images per second
+    double latency;  // the median msec of a request
+};
+
+/**
+* @brief Returns the model and its precision variants which exist, the variants are the models of the same name
+* in the sibling directories named by the precisions as the Model Downloader lays them out, e.g.
+* intel/<model>/FP16/<model>.xml for intel/<model>/FP32/<model>.xml
+*/
+inline std::vector<std::string> precisionVariants(const std::string& modelPath) {
+    static const char* const precisions[] = {"FP32", "FP16", "FP32-INT8", "FP16-INT8", "INT8"};
+    std::vector<std::string> variants{modelPath};
+    const std::string::size_type fileBegin = modelPath.find_last_of("/\\");
+    if (std::string::npos == fileBegin || 0 == fileBegin) {
+        return variants;
+    }
+    const std::string::size_type dirBegin = modelPath.find_last_of("/\\", fileBegin - 1);
+    const std::string::size_type precisionBegin = std::string::npos == dirBegin ? 0 : dirBegin + 1;
+    const std::string dirName = modelPath.substr(precisionBegin, fileBegin - precisionBegin);
+    if (std::none_of(std::begin(precisions), std::end(precisions), [&](const char* precision) {
+            return dirName == precision;
+        })) {
+        return variants;
+    }
+    for (const char* precision : precisions) {
+        if (dirName == precision) {
+            continue;
+        }
+        const std::string variant = modelPath.substr(0, precisionBegin) + precision + modelPath.substr(fileBegin);
+        const std::string weights = variant.substr(0, variant.rfind('.')) + ".bin";
+        struct stat sb;
+        if (0 == stat(variant.c_str(), &sb) && 0 == stat(weights.c_str(), &sb)) {
+            variants.push_back(variant);
+        }
+    }
+    return variants;
+}
+
+/**
+* @brief The config key of the streams of the device or an empty string if the streams of the device aren't set
+*/
+inline std::string streamsKey(const std::string& deviceName) {
+    if (deviceName == "CPU") {
+        return CONFIG_KEY(CPU_THROUGHPUT_STREAMS);
+    }
+    if (deviceName == "GPU") {
+        return CONFIG_KEY(GPU_THROUGHPUT_STREAMS);
+    }
+    return "";
+}
+
+/**
+* @brief The LoadNetwork() config of the candidate
+*/
+inline std::map<std::string, std::string> config(const Candidate& candidate, const std::string& deviceName) {
+    const std::string key = streamsKey(deviceName);
+    if (key.empty() || 0 == candidate.streams) {
+        return {};
+    }
+    return {{key, std::to_string(candidate.streams)}};
+}
+
+/**
+* @brief The stream counts tried on the device: the powers of two up to half of the hardware threads on the CPU,
+* 1 and 2 on the GPU and the default of the other devices
+*/
+inline std::vector<unsigned> streamCandidates(const std::string& deviceName) {
+    if (deviceName == "CPU") {
+        std::vector<unsigned> streams;
+        const unsigned maxStreams = std::max(1u, std::thread::hardware_concurrency() / 2);
+        for (unsigned count = 1; count <= maxStreams; count *= 2) {
+            streams.push_back(count);
+        }
+        return streams;
+    }
+    if (deviceName == "GPU") {
+        return {1, 2};
+    }
+    return {0};
+}
+
+/**
+* @brief Loads the candidate and keeps defaultInferRequestsNum() requests in flight for the given time, the
+* inputs are zeros. Throws if the device can't load the candidate
+* @param setup configures the inputs and the outputs of the network as the demo does
+*/
+inline Measurement measure(InferenceEngine::Core& ie, const Candidate& candidate, const std::string& deviceName,
+                           const std::function<void(InferenceEngine::CNNNetwork&)>& setup, double seconds) {
+    InferenceEngine::CNNNetwork network = ie.ReadNetwork(candidate.modelPath);
+    if (setup) {
+        setup(network);
+    }
+    network.setBatchSize(candidate.batchSize);
+    InferenceEngine::ExecutableNetwork executableNetwork =
+        ie.LoadNetwork(network, deviceName, config(candidate, deviceName));
+    std::vector<InferenceEngine::InferRequest> requests(defaultInferRequestsNum(executableNetwork, deviceName));
+    for (InferenceEngine::InferRequest& request : requests) {
+        request = executableNetwork.CreateInferRequest();
+        for (const auto& input : executableNetwork.GetInputsInfo()) {
+            InferenceEngine::Blob::Ptr blob = request.GetBlob(input.first);
+            std::memset(blob->buffer().as<char*>(), 0, blob->byteSize());
+        }
+        request.Infer();  // warms the request up
+    }
+
+    using Clock = std::chrono::steady_clock;
+    std::deque<std::pair<std::size_t, Clock::time_point>> started;
+    const Clock::time_point start = Clock::now();
+    const Clock::time_point deadline = start + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(seconds));
+    for (std::size_t request = 0; request < requests.size(); request++) {
+        requests[request].StartAsync();
+        started.emplace_back(request, Clock::now());
+    }
+    std::vector<double> latencies;
+    while (!started.empty()) {
+        const std::pair<std::size_t, Clock::time_point> oldest = started.front();
+        started.pop_front();
+        requests[oldest.first].Wait(InferenceEngine::IInferRequest::WaitMode::RESULT_READY);
+        const Clock::time_point now = Clock::now();
+        latencies.push_back(std::chrono::duration<double, std::milli>(now - oldest.second).count());
+        if (now < deadline) {
+            requests[oldest.first].StartAsync();
+            started.emplace_back(oldest.first, now);
+        }
+    }
+    const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    std::nth_element(latencies.begin(), latencies.begin() + latencies.size() / 2, latencies.end());
+    return {candidate, latencies.size() * candidate.batchSize / elapsed, latencies[latencies.size() / 2]};
+}
+
+inline std::string hostName() {
+#ifdef _WIN32
+    const char* const name = std::getenv("COMPUTERNAME");
+    return nullptr != name ? name : "";
+#else
+    char name[256] = {};
+    return 0 == gethostname(name, sizeof(name) - 1) ? name : "";
+#endif
+}
+
+/**
+* @brief The key of the tuning in the cache: the model, the device, the batch sizes and the limit tried, the
+* Inference Engine build and the host. The key changes with the .xml file, the weights aren't hashed
+*/
+inline std::string cacheKey(const std::string& modelPath, const std::string& deviceName,
+                            const std::vector<std::size_t>& batchSizes, double maxLatency) {
+    uint64_t modelHash = network_cache::hash("", 0);
+    network_cache::hashFile(modelPath, modelHash);
+    std::ostringstream key;
+    key << modelPath << ';' << modelHash << ';' << deviceName << ';' << maxLatency << ';'
+        << InferenceEngine::GetInferenceEngineVersion()->buildNumber << ';' << hostName() << ';'
+        << std::thread::hardware_concurrency();
+    for (std::size_t batchSize : batchSizes) {
+        key << ';' << batchSize;
+    }
+    return std::to_string(network_cache::hash(key.str()));
+}
+}  // namespace autotune
+
+/**
+* @brief Benchmarks the precision variants of the model with the batch sizes and the stream counts of the device
+* and returns the candidate of the highest throughput among the ones within maxLatency msec, or the smallest
+* latency if none is. The winner is cached in <cacheDir>/<demoName>.autotune, the working directory if cacheDir
+* is empty, so the later runs of the demo on the host skip the benchmark. The candidates the device can't load
+* are skipped, if none loads, the model with batch 1 and the default streams is returned unmeasured
+* @param setup configures the inputs and the outputs of the networks as the demo does, e.g. sets U8 inputs
+* @param batchSizes the batch sizes the demo can infer, {1} if it infers a frame per request
+* @param maxLatency msec, 0 - no limit
+*/
+inline autotune::Measurement autotuneNetwork(InferenceEngine::Core& ie, const std::string& demoName,
+                                             const std::string& modelPath, const std::string& deviceName,
+                                             const std::string& cacheDir,
+                                             const std::function<void(InferenceEngine::CNNNetwork&)>& setup = nullptr,
+                                             const std::vector<std::size_t>& batchSizes = {1},
+                                             double maxLatency = 0.0, double secondsPerCandidate = 1.0) {
+    const std::string cachePath = (cacheDir.empty() ? std::string(".") : cacheDir) + '/' + demoName + ".autotune";
+    const std::string key = autotune::cacheKey(modelPath, deviceName, batchSizes, maxLatency);
+    {
+        // the later lines of a key override the earlier ones
+        std::ifstream cache(cachePath);
+        std::string line;
+        bool found = false;
+        autotune::Measurement cached{{modelPath, 1, 0}, 0.0, 0.0};
+        while (std::getline(cache, line)) {
+            std::istringstream fields(line);
+            std::string lineKey;
+            autotune::Measurement measurement{{"", 1, 0}, 0.0, 0.0};
+            if (std::getline(fields, lineKey, '\t') && lineKey == key
+                    && std::getline(fields, measurement.candidate.modelPath, '\t')
+                    && fields >> measurement.candidate.batchSize >> measurement.candidate.streams
+                              >> measurement.throughput >> measurement.latency) {
+                cached = measurement;
+                found = true;
+            }
+        }
+        if (found) {
+            slog::info << "Autotune: " << cached.candidate.modelPath << " with batch " << cached.candidate.batchSize
+                       << " and " << cached.candidate.streams << " streams from " << cachePath << slog::endl;
+            return cached;
+        }
+    }
+
+    slog::info << "Autotune: benchmarking " << modelPath << " on " << deviceName << slog::endl;
+    std::vector<autotune::Measurement> measurements;
+    for (const std::string& variant : autotune::precisionVariants(modelPath)) {
+        for (std::size_t batchSize : batchSizes) {
+            for (unsigned streams : autotune::streamCandidates(deviceName)) {
+                const autotune::Candidate candidate{variant, batchSize, streams};
+                try {
+                    measurements.push_back(autotune::measure(ie, candidate, deviceName, setup, secondsPerCandidate));
+                } catch (const std::exception& error) {
+                    slog::warn << "Autotune: " << variant << " with batch " << batchSize << " and " << streams
+                               << " streams is skipped: " << error.what() << slog::endl;
+                    continue;
+                }
+                const autotune::Measurement& measurement = measurements.back();
+                slog::info << "Autotune: " << variant << " with batch " << batchSize << " and " << streams
+                           << " streams: " << measurement.throughput << " FPS, " << measurement.latency << " ms"
+                           << slog::endl;
+            }
+        }
+    }
+    if (measurements.empty()) {
+        slog::warn << "Autotune: no candidate of " << modelPath << " could be loaded to " << deviceName << slog::endl;
+        return {{modelPath, 1, 0}, 0.0, 0.0};
+    }
+
+    const auto withinLimit = [maxLatency](const autotune::Measurement& measurement) {
+        return maxLatency <= 0.0 || measurement.latency <= maxLatency;
+    };
+    const autotune::Measurement winner = *std::max_element(measurements.begin(), measurements.end(),
+        [&](const autotune::Measurement& a, const autotune::Measurement& b) {
+            if (withinLimit(a) != withinLimit(b)) {
+                return withinLimit(b);
+            }
+            return withinLimit(a) ? a.throughput < b.throughput : a.latency > b.latency;
+        });
+    slog::info << "Autotune: " << winner.candidate.modelPath << " with batch " << winner.candidate.batchSize
+               << " and " << winner.candidate.streams << " streams wins" << slog::endl;
+
+    struct stat sb;
+    if (!cacheDir.empty() && 0 != stat(cacheDir.c_str(), &sb)) {
+#ifdef _WIN32
+        _mkdir(cacheDir.c_str());
+#else
+        mkdir(cacheDir.c_str(), 0755);
+#endif
+    }
+    std::ofstream cache(cachePath, std::ios::app);
+    cache << key << '\t' << winner.candidate.modelPath << '\t' << winner.candidate.batchSize << ' '
+          << winner.candidate.streams << ' ' << winner.throughput << ' ' << winner.latency << '\n';
+    if (!cache) {
+        slog::warn << "Autotune: can't cache the winner in " << cachePath << slog::endl;
+    }
+    return winner;
+}
@@ -0,0 +1,191 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+/**
+ * @brief a header file with the recording of the captured frames and their replay with the original pacing
+ * @file capture_recording.hpp
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgcodecs/imgcodecs.hpp>
+
+namespace capture_recording {
+// a recording is the magic and then a record per frame: the microseconds since the capture of the first frame
+// and the size of the JPEG as uint64 and uint32 in the byte order of the recording machine, and the JPEG
+static const char magic[8] = {'C', 'A', 'P', 'R', 'E', 'C', '0', '1'};
+
+/**
+* @brief Returns true if the path is a recording, which is named by its .caprec extension
+*/
+inline bool isRecording(const std::string& path) {
+    static const std::string extension = ".caprec";
+    return path.size() > extension.size()
+        && 0 == path.compare(path.size() - extension.size(), extension.size(), extension);
+}
+}  // namespace capture_recording
+
+/**
+* @brief Appends the frames of an input to a recording with the moments they were captured. The frames are
+* compressed to JPEG on the calling thread, so a recording run is slower than the runs replaying it
+*/
+class CaptureRecorder {
+public:
+    explicit CaptureRecorder(const std::string& path, int jpegQuality = 90):
+            file(path, std::ios::binary | std::ios::trunc), path{path}, params{cv::IMWRITE_JPEG_QUALITY, jpegQuality} {
+        if (!file.write(capture_recording::magic, sizeof(capture_recording::magic))) {
+            throw std::runtime_error("Can't write the recording " + path);
+        }
+    }
+
+    CaptureRecorder(const CaptureRecorder&) = delete;
+    CaptureRecorder& operator=(const CaptureRecorder&) = delete;
+
+    /**
+    * @param captureTime the time since the epoch of any clock, the same for all the frames of the recording
+    */
+    void write(const cv::Mat& frame, std::chrono::nanoseconds captureTime) {
+        if (0 == framesCount) {
+            firstCaptureTime = captureTime;
+        }
+        cv::imencode(".jpg", frame, encoded, params);
+        const uint64_t stamp = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(captureTime - firstCaptureTime).count());
+        const uint32_t size = static_cast<uint32_t>(encoded.size());
+        file.write(reinterpret_cast<const char*>(&stamp), sizeof(stamp));
+        file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        file.write(reinterpret_cast<const char*>(encoded.data()), encoded.size());
+        if (!file) {
+            throw std::runtime_error("Can't write the recording " + path);
+        }
+        framesCount++;
+    }
+
+    std::size_t getFramesCount() const {
+        return framesCount;
+    }
+
+private:
+    std::ofstream file;
+    const std::string path;
+    const std::vector<int> params;
+    std::vector<uchar> encoded;  // reused by the frames
+    std::chrono::nanoseconds firstCaptureTime{0};
+    std::size_t framesCount = 0;
+};
+
+/**
+* @brief Reads the frames of a recording back. A paced replay releases every frame at its original moment
+* relative to the first read, the other replay returns the frames as fast as they are read, so the runs of
+* different builds get the same frames at the same rate or the same frames at their own rate
+*/
+class CaptureReplayer {
+public:
+    CaptureReplayer(const std::string& path, bool paced, bool loop):
+            file(path, std::ios::binary), path{path}, paced{paced}, loop{loop} {
+        char header[sizeof(capture_recording::magic)];
+        if (!file.read(header, sizeof(header)) || 0 != std::memcmp(header, capture_recording::magic, sizeof(header))) {
+            throw std::runtime_error(path + " is not a recording of captured frames");
+        }
+        if (!readRecord()) {
+            throw std::runtime_error("No frames in the recording " + path);
+        }
+        const cv::Mat first = cv::imdecode(encoded, cv::IMREAD_COLOR);
+        size = first.size();
+    }
+
+    CaptureReplayer(const CaptureReplayer&) = delete;
+    CaptureReplayer& operator=(const CaptureReplayer&) = delete;
+
+    /**
+    * @brief Waits until the next frame is due, returns false after the last frame. Returns at once if the replay
+    * isn't paced or the frame is due already
+    */
+    bool wait() {
+        if (!hasRecord && !(loop && rewind())) {
+            return false;
+        }
+        if (paced) {
+            const auto now = std::chrono::steady_clock::now();
+            if (!started) {
+                started = true;
+                startTime = now - std::chrono::microseconds(stamp + loopOffset);
+            }
+            std::this_thread::sleep_until(startTime + std::chrono::microseconds(stamp + loopOffset));
+        }
+        return true;
+    }
+
+    /**
+    * @brief wait() and decodes the frame, returns false after the last frame
+    */
+    bool read(cv::Mat& frame) {
+        if (!wait()) {
+            return false;
+        }
+        frame = cv::imdecode(encoded, cv::IMREAD_COLOR);
+        lastStamp = stamp;
+        passFrames++;
+        hasRecord = readRecord();
+        return true;
+    }
+
+    /**
+    * @brief Starts the replay over from the first frame, paced as if it followed the last frame
+    */
+    bool rewind() {
+        file.clear();
+        file.seekg(sizeof(capture_recording::magic));
+        if (!readRecord()) {
+            return false;
+        }
+        // the first frame follows the last one after the average interval of the recording
+        loopOffset += lastStamp + (passFrames > 1 ? lastStamp / (passFrames - 1) : 0);
+        passFrames = 0;
+        hasRecord = true;
+        return true;
+    }
+
+    cv::Size getSize() const {
+        return size;
+    }
+
+private:
+    bool readRecord() {
+        uint32_t encodedSize = 0;
+        if (!file.read(reinterpret_cast<char*>(&stamp), sizeof(stamp))
+                || !file.read(reinterpret_cast<char*>(&encodedSize), sizeof(encodedSize))) {
+            return false;
+        }
+        encoded.resize(encodedSize);
+        if (!file.read(reinterpret_cast<char*>(encoded.data()), encodedSize)) {
+            throw std::runtime_error("The recording " + path + " is truncated");
+        }
+        return true;
+    }
+
+    std::ifstream file;
+    const std::string path;
+    const bool paced;
+    const bool loop;
+    cv::Size size;
+    std::vector<uchar> encoded;  // of the next frame
+    uint64_t stamp = 0;  // usec of the next frame since the first one
+    bool hasRecord = true;
+    uint64_t lastStamp = 0;  // of the last frame read
+    uint64_t passFrames = 0;  // frames read since the replay started or rewound
+    uint64_t loopOffset = 0;  // usec the replay shifted by the previous loops
+    bool started = false;
+    std::chrono::steady_clock::time_point startTime;
+};
@@ -0,0 +1,158 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+/**
+ * @brief a header file with CPU threads and streams planning for several networks on one Core
+ * @file cpu_plan.hpp
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <inference_engine.hpp>
+
+#include <samples/slog.hpp>
+
+/**
+* @brief Splits the CPU threads between the networks loaded to the CPU plugin in proportion to their weights,
+* so a detector and its classifiers don't oversubscribe the same cores. Every network gets its own
+* CPU_THREADS_NUM and CPU_THROUGHPUT_STREAMS in its LoadNetwork() config. Threads are not bound by default:
+* the plugin pins the threads of every ExecutableNetwork starting from the first core, so binding several
+* networks makes them share the same cores
+*/
+class CpuPlan {
+public:
+    struct Budget {
+        std::string network;
+        float weight;
+        unsigned requestedStreams;  // 0 - one per 4 threads
+        unsigned threads;
+        unsigned streams;
+    };
+
+    /**
+    * @param totalThreads threads to split, 0 - std::thread::hardware_concurrency()
+    * @param bind CPU_BIND_THREAD value for all the networks: NO, YES or NUMA
+    */
+    explicit CpuPlan(unsigned totalThreads = 0, const std::string& bind = InferenceEngine::PluginConfigParams::NO):
+        totalThreads{0 == totalThreads ? std::max(1u, std::thread::hardware_concurrency()) : totalThreads}, bind{bind} {}
+
+    /**
+    * @brief Parses comma separated weights, e.g. "2,1,1"
+    */
+    static std::vector<float> parseWeights(const std::string& weights) {
+        std::vector<float> parsed;
+        std::istringstream stream{weights};
+        std::string weight;
+        while (std::getline(stream, weight, ',')) {
+            try {
+                parsed.push_back(std::stof(weight));
+            } catch (const std::exception&) {
+                throw std::invalid_argument("Can't parse CPU weight \"" + weight + "\" of \"" + weights + "\"");
+            }
+            if (parsed.back() <= 0) {
+                throw std::invalid_argument("CPU weights must be positive: " + weights);
+            }
+        }
+        return parsed;
+    }
+
+    /**
+    * @brief Plans a network if its device uses the CPU, also under HETERO or MULTI
+    * @param streams CPU_THROUGHPUT_STREAMS of the network, 0 - one per 4 threads of its budget
+    */
+    void add(const std::string& network, const std::string& deviceName, float weight, unsigned streams = 0) {
+        if (std::string::npos == deviceName.find("CPU")) {
+            return;
+        }
+        budgets.push_back(Budget{network, weight, streams, 0, 0});
+        plan();
+    }
+
+    bool empty() const {
+        return budgets.empty();
+    }
+
+    /**
+    * @brief Returns the config for LoadNetwork() of the network, empty if it isn't planned
+    */
+    std::map<std::string, std::string> config(const std::string& network) const {
+        for (const Budget& budget : budgets) {
+            if (network == budget.network) {
+                return {{CONFIG_KEY(CPU_THREADS_NUM), std::to_string(budget.threads)},
+                        {CONFIG_KEY(CPU_THROUGHPUT_STREAMS), std::to_string(budget.streams)},
+                        {CONFIG_KEY(CPU_BIND_THREAD), bind}};
+            }
+        }
+        return {};
+    }
+
+    void report() const {
+        for (const Budget& budget : budgets) {
+            slog::info << "CPU plan: " << budget.network << " (weight " << budget.weight << ") - " << budget.threads
+                << " threads, " << budget.streams << " streams, bind " << bind << slog::endl;
+        }
+        if (budgets.size() > totalThreads) {
+            slog::warn << "CPU plan: " << budgets.size() << " networks share " << totalThreads << " threads" << slog::endl;
+        }
+    }
+
+    const std::vector<Budget>& getBudgets() const {
+        return budgets;
+    }
+
+    /**
+    * @brief Splits the threads in proportion to the weights, every weight gets at least one thread and the rest is
+    * split by the largest remainders
+    */
+    static std::vector<unsigned> splitThreads(const std::vector<float>& weights, unsigned totalThreads) {
+        float weightsSum = 0;
+        for (float weight : weights) {
+            weightsSum += weight;
+        }
+        std::vector<unsigned> threads(weights.size());
+        unsigned assigned = 0;
+        std::vector<std::pair<float, std::size_t>> remainders;
+        for (std::size_t i = 0; i < weights.size(); i++) {
+            const float share = weights[i] / weightsSum * totalThreads;
+            threads[i] = std::max(1u, static_cast<unsigned>(share));
+            assigned += threads[i];
+            remainders.emplace_back(share - threads[i], i);
+        }
+        std::sort(remainders.begin(), remainders.end(), std::greater<std::pair<float, std::size_t>>());
+        for (std::size_t i = 0; assigned < totalThreads && i < remainders.size(); i++, assigned++) {
+            threads[remainders[i].second]++;
+        }
+        return threads;
+    }
+
+private:
+    void plan() {
+        std::vector<float> weights;
+        for (const Budget& budget : budgets) {
+            weights.push_back(budget.weight);
+        }
+        const std::vector<unsigned> threads = splitThreads(weights, totalThreads);
+        for (std::size_t i = 0; i < budgets.size(); i++) {
+            budgets[i].threads = threads[i];
+        }
+        for (Budget& budget : budgets) {
+            budget.streams = 0 == budget.requestedStreams ? std::max(1u, budget.threads / 4)
+                : std::min(budget.requestedStreams, budget.threads);
+        }
+    }
+
+    const unsigned totalThreads;
+    const std::string bind;
+    std::vector<Budget> budgets;
+};
@@ -0,0 +1,98 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+/**
+ * @brief a header file with a parser of the output of the SSD DetectionOutput layer
+ * @file detection_output.hpp
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#if defined(__x86_64__) || defined(_M_X64)
+  #define DETECTION_OUTPUT_SSE2 1
+  #include <emmintrin.h>
+#endif
+
+namespace detection_output {
+/**
+ * @brief A detection of the [1, 1, N, 7] output of DetectionOutput. The coordinates are relative to the image
+ */
+struct Row {
+    float imageId;  // -1 ends the detections
+    float label;
+    float confidence;
+    float xmin;
+    float ymin;
+    float xmax;
+    float ymax;
+};
+static_assert(sizeof(Row) == 7 * sizeof(float), "Row has to match the layout of the output");
+
+namespace details {
+// Returns the bits of the rows [row, row + 4) which pass the threshold and the bits of the ones ending the output
+inline void classify4(const Row* rows, float threshold, int& passed, int& ended) {
+#ifdef DETECTION_OUTPUT_SSE2
+    const __m128 confidences = _mm_setr_ps(rows[0].confidence, rows[1].confidence,
+                                           rows[2].confidence, rows[3].confidence);
+    const __m128 imageIds = _mm_setr_ps(rows[0].imageId, rows[1].imageId, rows[2].imageId, rows[3].imageId);
+    passed = _mm_movemask_ps(_mm_cmpgt_ps(confidences, _mm_set1_ps(threshold)));
+    ended = _mm_movemask_ps(_mm_cmplt_ps(imageIds, _mm_setzero_ps()));
+#else
+    passed = 0;
+    ended = 0;
+    for (int i = 0; i < 4; i++) {
+        passed |= (rows[i].confidence > threshold) << i;
+        ended |= (rows[i].imageId < 0.0f) << i;
+    }
+#endif
+}
+}  // namespace details
+
+/**
+ * @brief Calls onDetection(batchIdx, row) in the output order for the detections with the confidence above
+ * the threshold which belong to the images [0, batchSize). Stops at the row with the negative image_id. The
+ * rows are checked by 4 at once, most of them are below the threshold and are skipped without branches
+ * @param data the output of N rows of 7 floats
+ * @param rowsNumber N
+ */
+template <typename F>
+void parse(const float* data, std::size_t rowsNumber, float threshold, std::size_t batchSize, F&& onDetection) {
+    const Row* rows = reinterpret_cast<const Row*>(data);
+    std::size_t i = 0;
+    for (; i + 4 <= rowsNumber; i += 4) {
+        int passed, ended;
+        details::classify4(rows + i, threshold, passed, ended);
+        if (0 == (passed | ended)) {
+            continue;
+        }
+        for (std::size_t j = 0; j < 4; j++) {
+            if (ended & (1 << j)) {
+                return;
+            }
+            const std::size_t batchIdx = static_cast<std::size_t>(rows[i + j].imageId);
+            if ((passed & (1 << j)) && batchIdx < batchSize) {
+                onDetection(batchIdx, rows[i + j]);
+            }
+        }
+    }
+    for (; i < rowsNumber; i++) {
+        if (rows[i].imageId < 0.0f) {
+            return;
+        }
+        const std::size_t batchIdx = static_cast<std::size_t>(rows[i].imageId);
+        if (rows[i].confidence > threshold && batchIdx < batchSize) {
+            onDetection(batchIdx, rows[i]);
+        }
+    }
+}
+
+/**
+ * @brief Clamps a relative coordinate to the image
+ */
+inline float clamp(float coordinate) {
+    return coordinate < 0.0f ? 0.0f : (coordinate > 1.0f ? 1.0f : coordinate);
+}
+}  // namespace detection_output
@@ -0,0 +1,175 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+/**
+ * @brief a header file with batched cosine similarities of embeddings and their nearest neighbour search
+ * @file embeddings.hpp
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+/**
+* @brief Stores L2-normalized CV_32F embeddings as the rows of one matrix. The embeddings are normalized once
+* when they are added, so a cosine similarity is a single dot product and the similarities of two sets are
+* one matrix product, which cv::gemm computes with the vectorized kernels of OpenCV
+*/
+class NormalizedEmbeddings {
+public:
+    NormalizedEmbeddings() = default;
+
+    explicit NormalizedEmbeddings(const std::vector<cv::Mat>& embeddings) {
+        for (const cv::Mat& embedding : embeddings) {
+            add(embedding);
+        }
+    }
+
+    /** @brief Appends an embedding of any shape with the number of elements of the others */
+    void add(const cv::Mat& embedding) {
+        if (CV_32F != embedding.type()) {
+            throw std::invalid_argument("NormalizedEmbeddings expects CV_32F embeddings");
+        }
+        const cv::Mat row = (embedding.isContinuous() ? embedding : embedding.clone()).reshape(1, 1);
+        if (!rows.empty() && row.cols != rows.cols) {
+            throw std::invalid_argument("NormalizedEmbeddings expects embeddings of the same size");
+        }
+        // the epsilon keeps the similarities of the original 1 - xy / (sqrt(xx * yy) + eps) distances
+        rows.push_back(cv::Mat(row / (std::sqrt(row.dot(row)) + 1e-6)));
+    }
+
+    int size() const {
+        return rows.rows;
+    }
+
+    bool empty() const {
+        return rows.empty();
+    }
+
+    /** @brief The normalized embeddings, one per row */
+    const cv::Mat& matrix() const {
+        return rows;
+    }
+
+    /** @brief Returns the a.size() x b.size() CV_32F matrix of the cosine similarities of every pair */
+    static cv::Mat similarities(const NormalizedEmbeddings& a, const NormalizedEmbeddings& b) {
+        if (a.empty() || b.empty()) {
+            return cv::Mat(a.size(), b.size(), CV_32F);
+        }
+        cv::Mat result;
+        cv::gemm(a.rows, b.rows, 1.0, cv::noArray(), 0.0, result, cv::GEMM_2_T);
+        return result;
+    }
+
+    /** @brief Returns the cosine similarities of the embeddings with the same indices */
+    static std::vector<float> rowSimilarities(const NormalizedEmbeddings& a, const NormalizedEmbeddings& b) {
+        if (a.size() != b.size()) {
+            throw std::invalid_argument("NormalizedEmbeddings::rowSimilarities expects sets of the same size");
+        }
+        std::vector<float> result(a.size());
+        for (int i = 0; i < a.size(); i++) {
+            result[i] = static_cast<float>(a.rows.row(i).dot(b.rows.row(i)));
+        }
+        return result;
+    }
+
+private:
+    cv::Mat rows;
+};
+
+/**
+* @brief An inverted file index of normalized embeddings for approximate nearest neighbour search. The embeddings
+* are clustered by k-means into lists around normalized centroids and a query is compared only with the embeddings
+* of the lists of its probesNumber most similar centroids. One list searches exactly
+*/
+class EmbeddingsIndex {
+public:
+    EmbeddingsIndex(const NormalizedEmbeddings& embeddings, int listsNumber, int probesNumber)
+            : probesNumber(std::max(1, probesNumber)) {
+        if (embeddings.empty()) {
+            return;
+        }
+        const cv::Mat& data = embeddings.matrix();
+        listsNumber = std::max(1, std::min(listsNumber, data.rows));
+        cv::Mat labels;
+        if (listsNumber > 1) {
+            cv::kmeans(data, listsNumber, labels,
+                cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 20, 1e-4), 1, cv::KMEANS_PP_CENTERS,
+                centroids);
+            for (int i = 0; i < centroids.rows; i++) {
+                cv::Mat centroid = centroids.row(i);
+                centroid /= std::sqrt(centroid.dot(centroid)) + 1e-6;
+            }
+        } else {
+            labels = cv::Mat::zeros(data.rows, 1, CV_32S);
+            centroids = cv::Mat::zeros(1, data.cols, CV_32F);
+        }
+        lists.resize(listsNumber);
+        for (int i = 0; i < data.rows; i++) {
+            List& list = lists[labels.at<int>(i)];
+            list.embeddings.push_back(data.row(i));
+            list.indices.push_back(i);
+        }
+    }
+
+    /** @brief Returns the indices of up to k embeddings for each query, the most similar first */
+    std::vector<std::vector<int>> search(const NormalizedEmbeddings& queries, int k) const {
+        std::vector<std::vector<int>> result(queries.size());
+        if (lists.empty() || queries.empty() || k <= 0) {
+            return result;
+        }
+        cv::Mat centroidSimilarities;
+        cv::gemm(queries.matrix(), centroids, 1.0, cv::noArray(), 0.0, centroidSimilarities, cv::GEMM_2_T);
+
+        std::vector<int> probes(lists.size());
+        std::vector<std::pair<float, int>> candidates;
+        for (int q = 0; q < queries.size(); q++) {
+            const float* centroidSimilarity = centroidSimilarities.ptr<float>(q);
+            for (std::size_t i = 0; i < probes.size(); i++) {
+                probes[i] = static_cast<int>(i);
+            }
+            const std::size_t probed = std::min(probes.size(), static_cast<std::size_t>(probesNumber));
+            std::partial_sort(probes.begin(), probes.begin() + probed, probes.end(), [&](int a, int b) {
+                return centroidSimilarity[a] > centroidSimilarity[b];
+            });
+
+            candidates.clear();
+            const cv::Mat query = queries.matrix().row(q);
+            for (std::size_t p = 0; p < probed; p++) {
+                const List& list = lists[probes[p]];
+                if (list.indices.empty()) {
+                    continue;
+                }
+                cv::Mat similarities;
+                cv::gemm(query, list.embeddings, 1.0, cv::noArray(), 0.0, similarities, cv::GEMM_2_T);
+                for (std::size_t i = 0; i < list.indices.size(); i++) {
+                    candidates.emplace_back(similarities.at<float>(0, static_cast<int>(i)), list.indices[i]);
+                }
+            }
+            const std::size_t found = std::min(candidates.size(), static_cast<std::size_t>(k));
+            std::partial_sort(candidates.begin(), candidates.begin() + found, candidates.end(),
+                [](const std::pair<float, int>& a, const std::pair<float, int>& b) { return a.first > b.first; });
+            for (std::size_t i = 0; i < found; i++) {
+                result[q].push_back(candidates[i].second);
+            }
+        }
+        return result;
+    }
+
+private:
+    struct List {
+        cv::Mat embeddings;
+        std::vector<int> indices;
+    };
+
+    const int probesNumber;
+    cv::Mat centroids;
+    std::vector<List> lists;
+};
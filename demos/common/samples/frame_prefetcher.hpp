@@ -0,0 +1,270 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+/**
+ * @brief a header file with reading of input frames in a background thread ahead of their processing
+ * @file frame_prefetcher.hpp
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+/**
+* @brief A source of input frames read by FramePrefetcher
+*/
+class FrameSource {
+public:
+    /**
+    * @brief Reads the next frame to a new cv::Mat, returns false at the end of the input
+    */
+    virtual bool read(cv::Mat& frame) = 0;
+
+    /**
+    * @brief Returns true for cameras and streams, which produce frames whether they are read or not
+    */
+    virtual bool isLive() const = 0;
+
+    virtual ~FrameSource() = default;
+};
+
+class VideoCaptureSource : public FrameSource {
+public:
+    explicit VideoCaptureSource(int cameraIndex): live{true} {
+        if (!cap.open(cameraIndex)) {
+            throw std::runtime_error("Can't open camera " + std::to_string(cameraIndex));
+        }
+    }
+
+    explicit VideoCaptureSource(const std::string& path, bool live = false): live{live} {
+        if (!cap.open(path)) {
+            throw std::runtime_error("Can't open input " + path);
+        }
+    }
+
+    /**
+    * @brief Opens the camera 0 for "cam", otherwise the video file or stream
+    */
+    static std::unique_ptr<VideoCaptureSource> open(const std::string& input) {
+        return std::unique_ptr<VideoCaptureSource>("cam" == input ? new VideoCaptureSource(0) : new VideoCaptureSource(input));
+    }
+
+    /**
+    * @brief Gives access to the capture to query or set its properties before the source is prefetched
+    */
+    cv::VideoCapture& capture() {
+        return cap;
+    }
+
+    bool read(cv::Mat& frame) override {
+        if (!cap.read(frame)) {
+            if (!frame.empty()) {
+                throw std::runtime_error("Failed to get frame from cv::VideoCapture");
+            }
+            return false;
+        }
+        return true;
+    }
+
+    bool isLive() const override {
+        return live;
+    }
+
+private:
+    cv::VideoCapture cap;
+    const bool live;
+};
+
+class ImageListSource : public FrameSource {
+public:
+    explicit ImageListSource(std::vector<std::string> imagePaths): imagePaths(std::move(imagePaths)), index{0} {}
+
+    /**
+    * @brief Reads the list of images from a file with an image path in the first column of every line
+    */
+    static std::unique_ptr<ImageListSource> fromFile(const std::string& listPath) {
+        std::ifstream list(listPath);
+        if (!list.is_open()) {
+            throw std::runtime_error("Could not find an image list: " + listPath);
+        }
+        std::vector<std::string> imagePaths;
+        std::string line;
+        while (std::getline(list, line)) {
+            std::istringstream columns(line);
+            std::string imagePath;
+            if (columns >> imagePath) {
+                imagePaths.push_back(imagePath);
+            }
+        }
+        return std::unique_ptr<ImageListSource>(new ImageListSource(std::move(imagePaths)));
+    }
+
+    bool read(cv::Mat& frame) override {
+        if (index >= imagePaths.size()) {
+            return false;
+        }
+        frame = cv::imread(imagePaths[index], cv::IMREAD_COLOR);
+        if (frame.empty()) {
+            throw std::runtime_error("Could not read an image: " + imagePaths[index]);
+        }
+        index++;
+        return true;
+    }
+
+    bool isLive() const override {
+        return false;
+    }
+
+private:
+    const std::vector<std::string> imagePaths;
+    std::size_t index;
+};
+
+/**
+* @brief Adapts a reading function, e.g. of a demo specific grabber, which returns false at the end of the input
+*/
+class FunctionSource : public FrameSource {
+public:
+    FunctionSource(std::function<bool(cv::Mat&)> readFunction, bool live):
+        readFunction(std::move(readFunction)), live{live} {}
+
+    bool read(cv::Mat& frame) override {
+        return readFunction(frame);
+    }
+
+    bool isLive() const override {
+        return live;
+    }
+
+private:
+    std::function<bool(cv::Mat&)> readFunction;
+    const bool live;
+};
+
+/**
+* @brief Reads frames of a FrameSource in a background thread to a bounded queue, so decoding overlaps the
+* processing of the previous frames. Live sources drop the oldest queued frame if the queue is full to keep the
+* latency low, other sources wait for a free place, so no frame of a file is lost
+*/
+class FramePrefetcher {
+public:
+    enum class Pacing {
+        AUTO,  // LATEST for live sources, ALL otherwise
+        ALL,  // every frame is processed, reading waits for the queue
+        LATEST  // reading never waits, the oldest queued frame is dropped if the queue is full
+    };
+
+    struct Stats {
+        uint64_t readFrames;
+        uint64_t droppedFrames;
+    };
+
+    explicit FramePrefetcher(std::unique_ptr<FrameSource> source, std::size_t queueSize = 2, Pacing pacing = Pacing::AUTO):
+            source(std::move(source)), queueSize{std::max<std::size_t>(1, queueSize)},
+            dropOldest{Pacing::LATEST == pacing || (Pacing::AUTO == pacing && this->source->isLive())},
+            finished{false}, stopped{false}, stats{0, 0} {
+        reader = std::thread(&FramePrefetcher::readFrames, this);
+    }
+
+    FramePrefetcher(const FramePrefetcher&) = delete;
+    FramePrefetcher& operator=(const FramePrefetcher&) = delete;
+
+    ~FramePrefetcher() {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            stopped = true;
+        }
+        changed.notify_all();
+        reader.join();
+    }
+
+    /**
+    * @brief Waits for the next frame, returns false at the end of the input. Rethrows an exception of the source
+    * after the frames read before it
+    */
+    bool read(cv::Mat& frame) {
+        std::unique_lock<std::mutex> lock{mutex};
+        changed.wait(lock, [this] {return !frames.empty() || finished;});
+        if (frames.empty()) {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+            return false;
+        }
+        frame = std::move(frames.front());
+        frames.pop_front();
+        lock.unlock();
+        changed.notify_all();
+        return true;
+    }
+
+    Stats getStats() const {
+        std::lock_guard<std::mutex> lock{mutex};
+        return stats;
+    }
+
+private:
+    void readFrames() {
+        try {
+            while (true) {
+                cv::Mat frame;  // a new buffer for every frame, the queued ones are still in use
+                if (!source->read(frame)) {
+                    break;
+                }
+                std::unique_lock<std::mutex> lock{mutex};
+                if (!dropOldest) {
+                    changed.wait(lock, [this] {return frames.size() < queueSize || stopped;});
+                }
+                if (stopped) {
+                    return;
+                }
+                if (frames.size() >= queueSize) {
+                    frames.pop_front();
+                    stats.droppedFrames++;
+                }
+                frames.push_back(std::move(frame));
+                stats.readFrames++;
+                lock.unlock();
+                changed.notify_all();
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock{mutex};
+            error = std::current_exception();
+        }
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            finished = true;
+        }
+        changed.notify_all();
+    }
+
+    std::unique_ptr<FrameSource> source;
+    const std::size_t queueSize;
+    const bool dropOldest;
+    std::deque<cv::Mat> frames;
+    bool finished;
+    bool stopped;
+    std::exception_ptr error;
+    Stats stats;
+    mutable std::mutex mutex;
+    std::condition_variable changed;
+    std::thread reader;
+};
@@ -0,0 +1,130 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+/**
+ * @brief a header file with the preprocessing of the frames by OpenCL in the buffers shared with the GPU plugin
+ * @file gpu_preprocessing.hpp
+ */
+
+#pragma once
+
+#include <map>
+#include <stdexcept>
+#include <string>
+
+#include <inference_engine.hpp>
+#include <opencv2/core/core.hpp>
+
+#ifdef USE_GPU_REMOTE_PREPROCESSING
+#include <gpu/gpu_context_api_ocl.hpp>
+#include <opencv2/core/ocl.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#endif
+
+/**
+* @brief Resizes the frames for the GPU plugin by OpenCL of OpenCV and gives them to the network in the OpenCL
+* buffers of the context OpenCV and the plugin share, so the CPU only uploads the frames and stays free for the
+* decoding and the postprocessing. The network has to be loaded by loadNetwork() and get a U8 NCHW input without
+* Inference Engine preprocessing. Without the ENABLE_GPU_REMOTE_PREPROCESSING build option isAvailable() is false
+*/
+class GpuPreprocessor {
+public:
+    /**
+    * @brief Returns true if the frames of the network on the device can be preprocessed by GpuPreprocessor: the
+    * device is a single GPU and OpenCV has an OpenCL device
+    */
+    static bool isAvailable(const std::string& deviceName) {
+#ifdef USE_GPU_REMOTE_PREPROCESSING
+        return 0 == deviceName.compare(0, 3, "GPU") && std::string::npos == deviceName.find(',') && cv::ocl::haveOpenCL();
+#else
+        (void)deviceName;
+        return false;
+#endif
+    }
+
+    /**
+    * @brief Shares the default OpenCL context of OpenCV with the plugin of the device
+    */
+    GpuPreprocessor(InferenceEngine::Core& ie, const std::string& deviceName): ie(ie), deviceName{deviceName} {
+#ifdef USE_GPU_REMOTE_PREPROCESSING
+        cv::ocl::setUseOpenCL(true);
+        context = InferenceEngine::gpu::make_shared_context(ie, deviceName,
+            static_cast<cl_context>(cv::ocl::Context::getDefault().ptr()));
+#else
+        throw std::logic_error("The demos are built without ENABLE_GPU_REMOTE_PREPROCESSING");
+#endif
+    }
+
+    GpuPreprocessor(const GpuPreprocessor&) = delete;
+    GpuPreprocessor& operator=(const GpuPreprocessor&) = delete;
+
+    /**
+    * @brief Loads the network in the shared context. The compiled networks can't be imported to a context, so
+    * the network cache isn't used
+    */
+    InferenceEngine::ExecutableNetwork loadNetwork(const InferenceEngine::CNNNetwork& network,
+                                                   const std::map<std::string, std::string>& config = {}) {
+#ifdef USE_GPU_REMOTE_PREPROCESSING
+        return ie.LoadNetwork(network, context, config);
+#else
+        (void)network;
+        (void)config;
+        return InferenceEngine::ExecutableNetwork();
+#endif
+    }
+
+    /**
+    * @brief Uploads the frame, resizes it to the input of the request and splits it to the planes of the shared
+    * buffer of the request, which is set as its input once. The request can be started when this returns
+    */
+    void frameToBlob(const cv::Mat& frame, const InferenceEngine::InferRequest::Ptr& request, const std::string& inputName) {
+#ifdef USE_GPU_REMOTE_PREPROCESSING
+        auto inputIt = inputs.find(request.get());
+        if (inputs.end() == inputIt) {
+            const InferenceEngine::TensorDesc& desc = request->GetBlob(inputName)->getTensorDesc();
+            if (InferenceEngine::Precision::U8 != desc.getPrecision() || InferenceEngine::Layout::NCHW != desc.getLayout()
+                    || 3 != desc.getDims()[1] || 1 != desc.getDims()[0]) {
+                throw std::logic_error("GPU preprocessing supports only U8 NCHW inputs of 3 channels and batch 1");
+            }
+            Input input;
+            input.size = cv::Size(static_cast<int>(desc.getDims()[3]), static_cast<int>(desc.getDims()[2]));
+            input.planes.create(3 * input.size.height, input.size.width, CV_8UC1, cv::USAGE_ALLOCATE_DEVICE_MEMORY);
+            input.blob = InferenceEngine::gpu::make_shared_blob(desc, context,
+                static_cast<cl_mem>(input.planes.handle(cv::ACCESS_RW)));
+            request->SetBlob(inputName, input.blob);
+            inputIt = inputs.emplace(request.get(), std::move(input)).first;
+        }
+        Input& input = inputIt->second;
+        frame.copyTo(input.uploaded);
+        cv::resize(input.uploaded, input.resized, input.size);
+        std::vector<cv::UMat> planes;
+        for (int c = 0; c < 3; c++) {
+            planes.push_back(input.planes.rowRange(c * input.size.height, (c + 1) * input.size.height));
+        }
+        cv::split(input.resized, planes);
+        // the plugin reads the buffer from its own queue, the queue of OpenCV has to finish the writes first
+        cv::ocl::finish();
+#else
+        (void)frame;
+        (void)request;
+        (void)inputName;
+#endif
+    }
+
+private:
+    InferenceEngine::Core& ie;
+    const std::string deviceName;
+#ifdef USE_GPU_REMOTE_PREPROCESSING
+    struct Input {
+        cv::Size size;
+        cv::UMat planes;  // the NCHW input, the planes of the channels one after another
+        InferenceEngine::Blob::Ptr blob;  // wraps the buffer of planes
+        cv::UMat uploaded;
+        cv::UMat resized;
+    };
+
+    InferenceEngine::RemoteContext::Ptr context;
+    std::map<const InferenceEngine::InferRequest*, Input> inputs;  // by the requests the buffers are set to
+#endif
+};
@@ -0,0 +1,104 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+/**
+ * @brief a header file with the peaks search in the keypoint heatmaps of the pose estimation demos
+ * @file heatmap_peaks.hpp
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+/**
+* @brief Finds the points of a CV_32F heatmap, which aren't less than the threshold and are greater than their four
+* neighbours, the neighbours below the threshold and out of the heatmap count as zeros. The heatmap is thresholded
+* into a copy with a zero border, so the neighbours are the shifted views of the copy and the maximum of them and
+* the comparison are the vectorized OpenCV operations without the border checks
+*/
+inline std::vector<cv::Point> findHeatMapMaxima(const cv::Mat& heatMap, float threshold) {
+    cv::Mat padded = cv::Mat::zeros(heatMap.rows + 2, heatMap.cols + 2, CV_32F);
+    cv::Mat values = padded(cv::Rect(1, 1, heatMap.cols, heatMap.rows));
+    cv::Mat mask;
+    cv::compare(heatMap, threshold, mask, cv::CMP_GE);
+    heatMap.copyTo(values, mask);
+
+    cv::Mat neighbours;
+    cv::max(padded(cv::Rect(0, 1, heatMap.cols, heatMap.rows)), padded(cv::Rect(2, 1, heatMap.cols, heatMap.rows)),
+            neighbours);
+    cv::max(neighbours, padded(cv::Rect(1, 0, heatMap.cols, heatMap.rows)), neighbours);
+    cv::max(neighbours, padded(cv::Rect(1, 2, heatMap.cols, heatMap.rows)), neighbours);
+    cv::compare(values, neighbours, mask, cv::CMP_GT);
+
+    std::vector<cv::Point> maxima;
+    cv::findNonZero(mask, maxima);
+    return maxima;
+}
+
+/**
+* @brief Returns the subpixel position of a maximum found by findHeatMapMaxima, the offset along each axis is the vertex
+* of the parabola through the maximum and its two neighbours. The maxima at the border aren't moved across it
+*/
+inline cv::Point2f refineHeatMapMaximum(const cv::Mat& heatMap, cv::Point maximum) {
+    auto offset = [](float previous, float value, float next) {
+        const float curvature = previous - 2 * value + next;
+        return curvature < 0 ? std::max(-0.5f, std::min(0.5f, 0.5f * (previous - next) / curvature)) : 0.0f;
+    };
+    const float value = heatMap.at<float>(maximum);
+    cv::Point2f refined(maximum);
+    if (maximum.x > 0 && maximum.x < heatMap.cols - 1) {
+        refined.x += offset(heatMap.at<float>(maximum.y, maximum.x - 1), value,
+                            heatMap.at<float>(maximum.y, maximum.x + 1));
+    }
+    if (maximum.y > 0 && maximum.y < heatMap.rows - 1) {
+        refined.y += offset(heatMap.at<float>(maximum.y - 1, maximum.x), value,
+                            heatMap.at<float>(maximum.y + 1, maximum.x));
+    }
+    return refined;
+}
+
+/**
+* @brief Removes the peaks closer than minDistance to a kept one, the peaks are visited in the order of x. The kept
+* peaks are bucketed in a grid of minDistance cells, so a peak is compared only with the kept ones in the nine cells
+* around it
+*/
+inline std::vector<cv::Point> suppressClosePeaks(std::vector<cv::Point> peaks, cv::Size size, float minDistance) {
+    std::stable_sort(peaks.begin(), peaks.end(), [](const cv::Point& a, const cv::Point& b) {
+        return a.x < b.x;
+    });
+    if (minDistance <= 0) {
+        return peaks;
+    }
+    const float cellSize = std::max(minDistance, 1.0f);
+    const int gridCols = static_cast<int>(size.width / cellSize) + 1;
+    const int gridRows = static_cast<int>(size.height / cellSize) + 1;
+    std::vector<std::vector<cv::Point>> grid(gridCols * gridRows);
+
+    std::vector<cv::Point> kept;
+    for (const cv::Point& peak : peaks) {
+        const int cellX = static_cast<int>(peak.x / cellSize);
+        const int cellY = static_cast<int>(peak.y / cellSize);
+        bool isActualPeak = true;
+        for (int y = std::max(cellY - 1, 0); isActualPeak && y <= std::min(cellY + 1, gridRows - 1); y++) {
+            for (int x = std::max(cellX - 1, 0); isActualPeak && x <= std::min(cellX + 1, gridCols - 1); x++) {
+                for (const cv::Point& other : grid[y * gridCols + x]) {
+                    const cv::Point delta = peak - other;
+                    if (std::sqrt(static_cast<float>(delta.dot(delta))) < minDistance) {
+                        isActualPeak = false;
+                        break;
+                    }
+                }
+            }
+        }
+        if (isActualPeak) {
+            grid[cellY * gridCols + cellX].push_back(peak);
+            kept.push_back(peak);
+        }
+    }
+    return kept;
+}
@@ -0,0 +1,134 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+/**
+ * @brief a header file with the OpenCV and the Inference Engine allocators of the hugepage arena
+ * @file hugepage_allocator.hpp
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <stdexcept>
+
+#include <inference_engine.hpp>
+#include <opencv2/core/core.hpp>
+
+#include <monitors/hugepage_arena.h>
+
+/**
+* @brief cv::MatAllocator of the cv::Mat data from HugePageArena, the UMat specific operations are the defaults of
+* cv::MatAllocator as in the standard allocator of OpenCV
+*/
+class ArenaMatAllocator : public cv::MatAllocator {
+public:
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data0, size_t* step,
+                           cv::AccessFlag /*flags*/, cv::UMatUsageFlags /*usageFlags*/) const override {
+        size_t total = CV_ELEM_SIZE(type);
+        for (int i = dims - 1; i >= 0; i--) {
+            if (step) {
+                if (data0 && step[i] != CV_AUTOSTEP) {
+                    CV_Assert(total <= step[i]);
+                    total = step[i];
+                } else {
+                    step[i] = total;
+                }
+            }
+            total *= sizes[i];
+        }
+        uchar* data = data0 ? static_cast<uchar*>(data0)
+                            : static_cast<uchar*>(HugePageArena::instance().allocate(total));
+        cv::UMatData* u = new cv::UMatData(this);
+        u->data = u->origdata = data;
+        u->size = total;
+        if (data0) {
+            u->flags |= cv::UMatData::USER_ALLOCATED;
+        }
+        return u;
+    }
+
+    bool allocate(cv::UMatData* u, cv::AccessFlag /*accessFlags*/, cv::UMatUsageFlags /*usageFlags*/) const override {
+        return nullptr != u;
+    }
+
+    void deallocate(cv::UMatData* u) const override {
+        if (!u) {
+            return;
+        }
+        CV_Assert(u->urefcount == 0);
+        CV_Assert(u->refcount == 0);
+        if (!(u->flags & cv::UMatData::USER_ALLOCATED)) {
+            HugePageArena::instance().deallocate(u->origdata);
+            u->origdata = nullptr;
+        }
+        delete u;
+    }
+};
+
+/**
+* @brief InferenceEngine::IAllocator of the host blobs from HugePageArena, e.g.
+* InferenceEngine::make_shared_blob<uint8_t>(desc, std::make_shared<ArenaBlobAllocator>()). The handles are the
+* pointers to the data
+*/
+class ArenaBlobAllocator : public InferenceEngine::IAllocator {
+public:
+    void* lock(void* handle, InferenceEngine::LockOp = InferenceEngine::LOCK_FOR_WRITE) noexcept override {
+        return handle;
+    }
+
+    void unlock(void*) noexcept override {}
+
+    void* alloc(size_t size) noexcept override {
+        try {
+            return HugePageArena::instance().allocate(size);
+        } catch (const std::bad_alloc&) {
+            return nullptr;
+        }
+    }
+
+    bool free(void* handle) noexcept override {
+        HugePageArena::instance().deallocate(handle);
+        return true;
+    }
+
+    // the releasable interface of the allocators of the older Inference Engine versions, not overridden on the
+    // newer ones which own the allocators by std::shared_ptr only
+    void Release() noexcept {
+        delete this;
+    }
+};
+
+/**
+* @brief Makes HugePageArena the default allocator of the cv::Mat data created after the call, so the frames and
+* the preprocessing intermediates come from the arena. Call it before the threads creating the cv::Mat start, the
+* cv::Mat created earlier are freed by their own allocator
+*/
+inline void useHugePageArena() {
+    // never destroyed, the static cv::Mat may be freed after main() returns
+    static ArenaMatAllocator* allocator = new ArenaMatAllocator;
+    cv::Mat::setDefaultAllocator(allocator);
+}
+
+/**
+* @brief A host blob of the tensor from HugePageArena
+*/
+inline InferenceEngine::Blob::Ptr makeArenaBlob(const InferenceEngine::TensorDesc& desc) {
+    static const std::shared_ptr<InferenceEngine::IAllocator> allocator = std::make_shared<ArenaBlobAllocator>();
+    InferenceEngine::Blob::Ptr blob;
+    switch (desc.getPrecision()) {
+    case InferenceEngine::Precision::U8:
+        blob = InferenceEngine::make_shared_blob<uint8_t>(desc, allocator);
+        break;
+    case InferenceEngine::Precision::FP32:
+        blob = InferenceEngine::make_shared_blob<float>(desc, allocator);
+        break;
+    default:
+        throw std::logic_error("The hugepage arena blobs are U8 or FP32 only");
+    }
+    blob->allocate();
+    return blob;
+}
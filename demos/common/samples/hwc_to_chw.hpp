@@ -0,0 +1,261 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+/**
+ * @brief a header file with a vectorized interleaved u8 to planar float conversion
+ * @file hwc_to_chw.hpp
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+  #define HWC_TO_CHW_X86 1
+  #include <immintrin.h>
+  #ifdef _MSC_VER
+    #include <intrin.h>
+    #define HWC_TO_CHW_TARGET(isa)
+  #else
+    #define HWC_TO_CHW_TARGET(isa) __attribute__((target(isa)))
+  #endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  #define HWC_TO_CHW_NEON 1
+  #include <arm_neon.h>
+#endif
+
+namespace details {
+
+/**
+ * @brief Signature shared by all conversion kernels.
+ * The source is an interleaved image with a row pitch of srcStep bytes, the destination is
+ * channels float planes planeSize floats apart, the rows of a plane are width floats apart.
+ */
+using HwcToChwKernel = void (*)(const uint8_t* src, size_t srcStep, size_t width, size_t height,
+                                size_t channels, float* dst, size_t planeSize);
+
+inline void hwcU8ToChwF32Scalar(const uint8_t* src, size_t srcStep, size_t width, size_t height,
+                                size_t channels, float* dst, size_t planeSize) {
+    for (size_t h = 0; h < height; h++) {
+        const uint8_t* row = src + h * srcStep;
+        for (size_t c = 0; c < channels; c++) {
+            float* dstRow = dst + c * planeSize + h * width;
+            for (size_t w = 0; w < width; w++) {
+                dstRow[w] = static_cast<float>(row[w * channels + c]);
+            }
+        }
+    }
+}
+
+#ifdef HWC_TO_CHW_X86
+/**
+ * @brief Splits 16 packed 3-channel pixels held in a, b, c into one register per channel.
+ */
+HWC_TO_CHW_TARGET("sse4.1")
+inline void deinterleave3(__m128i a, __m128i b, __m128i c, __m128i& c0, __m128i& c1, __m128i& c2) {
+    const __m128i m00 = _mm_setr_epi8(0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i m01 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1);
+    const __m128i m02 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13);
+    const __m128i m10 = _mm_setr_epi8(1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i m11 = _mm_setr_epi8(-1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1);
+    const __m128i m12 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14);
+    const __m128i m20 = _mm_setr_epi8(2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i m21 = _mm_setr_epi8(-1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1);
+    const __m128i m22 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15);
+
+    c0 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a, m00), _mm_shuffle_epi8(b, m01)), _mm_shuffle_epi8(c, m02));
+    c1 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a, m10), _mm_shuffle_epi8(b, m11)), _mm_shuffle_epi8(c, m12));
+    c2 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a, m20), _mm_shuffle_epi8(b, m21)), _mm_shuffle_epi8(c, m22));
+}
+
+HWC_TO_CHW_TARGET("sse4.1")
+inline void storeU8x16AsF32Sse(__m128i v, float* dst) {
+    _mm_storeu_ps(dst,      _mm_cvtepi32_ps(_mm_cvtepu8_epi32(v)));
+    _mm_storeu_ps(dst + 4,  _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(v, 4))));
+    _mm_storeu_ps(dst + 8,  _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(v, 8))));
+    _mm_storeu_ps(dst + 12, _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(v, 12))));
+}
+
+HWC_TO_CHW_TARGET("avx2")
+inline void storeU8x16AsF32Avx2(__m128i v, float* dst) {
+    _mm256_storeu_ps(dst,     _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(v)));
+    _mm256_storeu_ps(dst + 8, _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(v, 8))));
+}
+
+HWC_TO_CHW_TARGET("sse4.1")
+inline void hwcU8ToChwF32Sse41(const uint8_t* src, size_t srcStep, size_t width, size_t height,
+                               size_t channels, float* dst, size_t planeSize) {
+    if (channels != 3) {
+        hwcU8ToChwF32Scalar(src, srcStep, width, height, channels, dst, planeSize);
+        return;
+    }
+    for (size_t h = 0; h < height; h++) {
+        const uint8_t* row = src + h * srcStep;
+        float* d0 = dst + h * width;
+        float* d1 = d0 + planeSize;
+        float* d2 = d1 + planeSize;
+        size_t w = 0;
+        for (; w + 16 <= width; w += 16) {
+            const uint8_t* p = row + w * 3;
+            __m128i c0, c1, c2;
+            deinterleave3(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)),
+                          _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16)),
+                          _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 32)),
+                          c0, c1, c2);
+            storeU8x16AsF32Sse(c0, d0 + w);
+            storeU8x16AsF32Sse(c1, d1 + w);
+            storeU8x16AsF32Sse(c2, d2 + w);
+        }
+        for (; w < width; w++) {
+            d0[w] = static_cast<float>(row[w * 3]);
+            d1[w] = static_cast<float>(row[w * 3 + 1]);
+            d2[w] = static_cast<float>(row[w * 3 + 2]);
+        }
+    }
+}
+
+HWC_TO_CHW_TARGET("avx2")
+inline void hwcU8ToChwF32Avx2(const uint8_t* src, size_t srcStep, size_t width, size_t height,
+                              size_t channels, float* dst, size_t planeSize) {
+    if (channels != 3) {
+        hwcU8ToChwF32Scalar(src, srcStep, width, height, channels, dst, planeSize);
+        return;
+    }
+    for (size_t h = 0; h < height; h++) {
+        const uint8_t* row = src + h * srcStep;
+        float* d0 = dst + h * width;
+        float* d1 = d0 + planeSize;
+        float* d2 = d1 + planeSize;
+        size_t w = 0;
+        for (; w + 16 <= width; w += 16) {
+            const uint8_t* p = row + w * 3;
+            __m128i c0, c1, c2;
+            deinterleave3(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)),
+                          _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16)),
+                          _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 32)),
+                          c0, c1, c2);
+            storeU8x16AsF32Avx2(c0, d0 + w);
+            storeU8x16AsF32Avx2(c1, d1 + w);
+            storeU8x16AsF32Avx2(c2, d2 + w);
+        }
+        for (; w < width; w++) {
+            d0[w] = static_cast<float>(row[w * 3]);
+            d1[w] = static_cast<float>(row[w * 3 + 1]);
+            d2[w] = static_cast<float>(row[w * 3 + 2]);
+        }
+    }
+}
+
+inline bool cpuSupportsSse41() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 19)) != 0;
+#else
+    return __builtin_cpu_supports("sse4.1");
+#endif
+}
+
+inline bool cpuSupportsAvx2() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    if (!osxsave || (_xgetbv(0) & 0x6) != 0x6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif  // HWC_TO_CHW_X86
+
+#ifdef HWC_TO_CHW_NEON
+inline void storeU8x16AsF32Neon(uint8x16_t v, float* dst) {
+    const uint16x8_t lo = vmovl_u8(vget_low_u8(v));
+    const uint16x8_t hi = vmovl_u8(vget_high_u8(v));
+    vst1q_f32(dst,      vcvtq_f32_u32(vmovl_u16(vget_low_u16(lo))));
+    vst1q_f32(dst + 4,  vcvtq_f32_u32(vmovl_u16(vget_high_u16(lo))));
+    vst1q_f32(dst + 8,  vcvtq_f32_u32(vmovl_u16(vget_low_u16(hi))));
+    vst1q_f32(dst + 12, vcvtq_f32_u32(vmovl_u16(vget_high_u16(hi))));
+}
+
+inline void hwcU8ToChwF32Neon(const uint8_t* src, size_t srcStep, size_t width, size_t height,
+                              size_t channels, float* dst, size_t planeSize) {
+    if (channels != 3) {
+        hwcU8ToChwF32Scalar(src, srcStep, width, height, channels, dst, planeSize);
+        return;
+    }
+    for (size_t h = 0; h < height; h++) {
+        const uint8_t* row = src + h * srcStep;
+        float* d0 = dst + h * width;
+        float* d1 = d0 + planeSize;
+        float* d2 = d1 + planeSize;
+        size_t w = 0;
+        for (; w + 16 <= width; w += 16) {
+            const uint8x16x3_t px = vld3q_u8(row + w * 3);
+            storeU8x16AsF32Neon(px.val[0], d0 + w);
+            storeU8x16AsF32Neon(px.val[1], d1 + w);
+            storeU8x16AsF32Neon(px.val[2], d2 + w);
+        }
+        for (; w < width; w++) {
+            d0[w] = static_cast<float>(row[w * 3]);
+            d1[w] = static_cast<float>(row[w * 3 + 1]);
+            d2[w] = static_cast<float>(row[w * 3 + 2]);
+        }
+    }
+}
+#endif  // HWC_TO_CHW_NEON
+
+inline HwcToChwKernel selectHwcToChwKernel() {
+#if defined(HWC_TO_CHW_X86)
+    if (cpuSupportsAvx2()) {
+        return hwcU8ToChwF32Avx2;
+    }
+    if (cpuSupportsSse41()) {
+        return hwcU8ToChwF32Sse41;
+    }
+    return hwcU8ToChwF32Scalar;
+#elif defined(HWC_TO_CHW_NEON)
+    return hwcU8ToChwF32Neon;
+#else
+    return hwcU8ToChwF32Scalar;
+#endif
+}
+
+}  // namespace details
+
+/**
+ * @brief Converts an interleaved 8-bit image (HWC, e.g. BGR cv::Mat data) into planar float data (CHW).
+ * The best kernel for the running CPU (AVX2, SSE4.1, NEON or scalar fallback) is selected on the first call.
+ * Destination planes are written in row order.
+ * @param src - pointer to the first pixel of the source image
+ * @param srcStep - distance in bytes between two source rows
+ * @param width - image width in pixels
+ * @param height - image height in pixels
+ * @param channels - number of interleaved channels, only 3-channel images take the vectorized path
+ * @param dst - destination buffer holding at least channels * height * width floats
+ */
+inline void hwcU8ToChwF32(const uint8_t* src, size_t srcStep, size_t width, size_t height,
+                          size_t channels, float* dst) {
+    static const details::HwcToChwKernel kernel = details::selectHwcToChwKernel();
+    kernel(src, srcStep, width, height, channels, dst, width * height);
+}
+
+/**
+ * @brief Converts a horizontal stripe of an interleaved 8-bit image into the matching rows of planar float data,
+ * so that stripes of one image can be converted in parallel.
+ * @param src - pointer to the first pixel of the first row of the stripe
+ * @param rows - number of rows in the stripe
+ * @param dst - pointer to the first row of the stripe in the first destination plane
+ * @param planeSize - distance in floats between two destination planes, width * height of the whole image
+ */
+inline void hwcU8ToChwF32Rows(const uint8_t* src, size_t srcStep, size_t width, size_t rows,
+                              size_t channels, float* dst, size_t planeSize) {
+    static const details::HwcToChwKernel kernel = details::selectHwcToChwKernel();
+    kernel(src, srcStep, width, rows, channels, dst, planeSize);
+}
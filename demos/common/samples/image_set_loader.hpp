@@ -0,0 +1,179 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+/**
+ * @brief a header file with decoding of a set of images on worker threads ahead of their inference
+ * @file image_set_loader.hpp
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include <samples/slog.hpp>
+
+/**
+* @brief Decodes the images of the paths parseInputFilesArguments() collected on a pool of worker threads. The
+* images are taken in the order of the paths, at most capacity images are decoded and not taken yet, so a large set
+* streams through a fixed amount of memory instead of being read up front. The unreadable images are skipped with
+* a warning
+*/
+class ImageSetLoader {
+public:
+    struct Image {
+        std::size_t index;  // of the path
+        std::string path;
+        cv::Mat image;
+    };
+
+    struct Stats {
+        std::size_t decodedImages;
+        double decodeTime;  // sec, summed over the workers
+        double waitTime;  // sec the caller waited for the decoding
+        double processTime;  // sec the caller spent between taking an image and asking for the next one
+    };
+
+    /**
+    * @param flags of cv::imread
+    * @param workersNum 0 - a worker per hardware thread
+    */
+    ImageSetLoader(std::vector<std::string> paths, std::size_t capacity, int flags = cv::IMREAD_COLOR,
+                   std::size_t workersNum = 0):
+            paths(std::move(paths)), flags{flags}, slots(std::max<std::size_t>(capacity, 1)),
+            claimed{0}, taken{0}, stopped{false}, stats{0, 0.0, 0.0, 0.0} {
+        if (0 == workersNum) {
+            workersNum = std::max(1u, std::thread::hardware_concurrency());
+        }
+        // more workers than the free slots would only wait
+        workersNum = std::min(workersNum, std::min(slots.size(), this->paths.size()));
+        for (std::size_t i = 0; i < workersNum; i++) {
+            workers.emplace_back(&ImageSetLoader::decode, this);
+        }
+    }
+
+    ImageSetLoader(const ImageSetLoader&) = delete;
+    ImageSetLoader& operator=(const ImageSetLoader&) = delete;
+
+    ~ImageSetLoader() {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            stopped = true;
+        }
+        changed.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    /**
+    * @brief Waits for the next readable image, returns false after the last one
+    */
+    bool next(Image& image) {
+        const auto entered = std::chrono::steady_clock::now();
+        std::unique_lock<std::mutex> lock{mutex};
+        if (std::chrono::steady_clock::time_point() != lastReturned) {
+            stats.processTime += std::chrono::duration<double>(entered - lastReturned).count();
+        }
+        bool found = false;
+        while (!found && taken < paths.size()) {
+            Slot& slot = slots[taken % slots.size()];
+            changed.wait(lock, [&slot] {return slot.ready;});
+            slot.ready = false;
+            image = std::move(slot.image);
+            taken++;
+            changed.notify_all();  // the slot is free for a worker
+            if (image.image.empty()) {
+                slog::warn << "Image " + image.path + " cannot be read!" << slog::endl;
+            } else {
+                found = true;
+            }
+        }
+        lastReturned = std::chrono::steady_clock::now();
+        stats.waitTime += std::chrono::duration<double>(lastReturned - entered).count();
+        return found;
+    }
+
+    /**
+    * @brief Takes up to batchSize next images, fewer at the end of the set
+    */
+    std::vector<Image> nextBatch(std::size_t batchSize) {
+        std::vector<Image> batch;
+        Image image;
+        while (batch.size() < batchSize && next(image)) {
+            batch.push_back(std::move(image));
+        }
+        return batch;
+    }
+
+    Stats getStats() const {
+        std::lock_guard<std::mutex> lock{mutex};
+        return stats;
+    }
+
+    /**
+    * @brief Reports whether the decoding or the processing of the images limited the throughput
+    */
+    void printStats() const {
+        const Stats s = getStats();
+        slog::info << "Decoded " << s.decodedImages << " images on " << workers.size() << " threads in "
+                   << s.decodeTime << " s, the inference took " << s.processTime << " s and waited "
+                   << s.waitTime << " s for the images" << slog::endl;
+    }
+
+private:
+    struct Slot {
+        bool ready = false;
+        Image image;
+    };
+
+    void decode() {
+        while (true) {
+            std::size_t index;
+            {
+                std::unique_lock<std::mutex> lock{mutex};
+                changed.wait(lock, [this] {
+                    return stopped || claimed >= paths.size() || claimed < taken + slots.size();
+                });
+                if (stopped || claimed >= paths.size()) {
+                    return;
+                }
+                index = claimed++;
+            }
+            const auto start = std::chrono::steady_clock::now();
+            cv::Mat image = cv::imread(paths[index], flags);
+            const double decodeTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            {
+                std::lock_guard<std::mutex> lock{mutex};
+                Slot& slot = slots[index % slots.size()];
+                slot.image = Image{index, paths[index], std::move(image)};
+                slot.ready = true;
+                stats.decodedImages++;
+                stats.decodeTime += decodeTime;
+            }
+            changed.notify_all();
+        }
+    }
+
+    const std::vector<std::string> paths;
+    const int flags;
+    std::vector<Slot> slots;  // the ring of the images [taken, claimed)
+    std::size_t claimed;  // the next path to decode
+    std::size_t taken;  // the next image to return
+    bool stopped;
+    Stats stats;
+    std::chrono::steady_clock::time_point lastReturned;
+    mutable std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<std::thread> workers;
+};
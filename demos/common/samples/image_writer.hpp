@@ -0,0 +1,124 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+/**
+ * @brief a header file with a pool of threads encoding and writing images in the background
+ * @file image_writer.hpp
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <opencv2/imgcodecs.hpp>
+
+/**
+* @brief Encodes and writes images by cv::imwrite in background threads, so the caller doesn't wait for the
+* encoding and the disk. The queue of the images is bounded: write() waits for a free place, so the images which
+* the threads can't keep up with don't pile up in memory
+*/
+class ImageWriterPool {
+public:
+    explicit ImageWriterPool(std::size_t threadsNum = 2, std::size_t queueSize = 4):
+            queueSize{std::max<std::size_t>(1, queueSize)}, busy{0}, stopped{false} {
+        for (std::size_t i = 0; i < std::max<std::size_t>(1, threadsNum); i++) {
+            threads.emplace_back(&ImageWriterPool::writeImages, this);
+        }
+    }
+
+    ImageWriterPool(const ImageWriterPool&) = delete;
+    ImageWriterPool& operator=(const ImageWriterPool&) = delete;
+
+    /**
+    * @brief Writes the queued images and stops the threads, an error of the writing isn't reported here
+    * unless finish() is called
+    */
+    ~ImageWriterPool() {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            stopped = true;
+        }
+        changed.notify_all();
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+
+    /**
+    * @brief Queues the image to be written to the path, the image must not be modified after it. Rethrows an
+    * error of a previous writing
+    */
+    void write(std::string path, cv::Mat image) {
+        std::unique_lock<std::mutex> lock{mutex};
+        changed.wait(lock, [this] {return images.size() < queueSize || error;});
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        images.emplace_back(std::move(path), std::move(image));
+        lock.unlock();
+        changed.notify_all();
+    }
+
+    /**
+    * @brief Waits for all the queued images to be written, rethrows an error of the writing
+    */
+    void finish() {
+        std::unique_lock<std::mutex> lock{mutex};
+        changed.wait(lock, [this] {return (images.empty() && 0 == busy) || error;});
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+private:
+    void writeImages() {
+        std::unique_lock<std::mutex> lock{mutex};
+        while (true) {
+            changed.wait(lock, [this] {return !images.empty() || stopped;});
+            if (images.empty()) {
+                return;
+            }
+            std::pair<std::string, cv::Mat> image = std::move(images.front());
+            images.pop_front();
+            busy++;
+            lock.unlock();
+            changed.notify_all();
+
+            std::exception_ptr writeError;
+            try {
+                if (!cv::imwrite(image.first, image.second)) {
+                    throw std::runtime_error("Can't write an image: " + image.first);
+                }
+            } catch (...) {
+                writeError = std::current_exception();
+            }
+
+            lock.lock();
+            busy--;
+            if (writeError && !error) {
+                error = writeError;
+            }
+            changed.notify_all();
+        }
+    }
+
+    const std::size_t queueSize;
+    std::size_t busy;
+    bool stopped;
+    std::deque<std::pair<std::string, cv::Mat>> images;
+    std::exception_ptr error;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<std::thread> threads;
+};
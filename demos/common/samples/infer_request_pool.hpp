@@ -0,0 +1,357 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+/**
+ * @brief a header file with a pool of asynchronous infer requests delivering results in order
+ * @file infer_request_pool.hpp
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <inference_engine.hpp>
+
+#include <samples/parallel_load.hpp>
+
+/**
+* @brief Returns the number of infer requests to keep in flight for the device: the optimal number reported by
+* the plugin but at least 2 to overlap the inference with reading and rendering frames, or 4 for MYRIAD and HDDL
+* and 2 for the other devices if the plugin doesn't report it
+*/
+inline std::size_t defaultInferRequestsNum(const InferenceEngine::ExecutableNetwork& network, const std::string& deviceName) {
+    try {
+        const unsigned optimal = network.GetMetric(METRIC_KEY(OPTIMAL_NUMBER_OF_INFER_REQUESTS)).as<unsigned>();
+        return std::max(2u, optimal);
+    } catch (const std::exception&) {
+        return std::string::npos != deviceName.find("MYRIAD") || std::string::npos != deviceName.find("HDDL") ? 4 : 2;
+    }
+}
+
+/**
+* @brief A network loaded to one of the devices the requests of InferRequestPool fan out over
+*/
+struct DeviceNetwork {
+    std::string deviceName;
+    InferenceEngine::ExecutableNetwork network;
+    std::size_t requestsNum;  // 0 for defaultInferRequestsNum()
+};
+
+/**
+* @brief Splits "MULTI:<device1>(<requests1>),<device2>" to the devices and their request counts, 0 if a count
+* isn't given. Other device names, HETERO: too, are a single device
+*/
+inline std::vector<std::pair<std::string, std::size_t>> parseMultiDevice(const std::string& deviceName) {
+    const std::string prefix = "MULTI:";
+    if (0 != deviceName.compare(0, prefix.size(), prefix)) {
+        return {{deviceName, 0}};
+    }
+    std::vector<std::pair<std::string, std::size_t>> devices;
+    std::size_t begin = prefix.size();
+    while (begin < deviceName.size()) {
+        std::size_t end = deviceName.find(',', begin);
+        if (std::string::npos == end) {
+            end = deviceName.size();
+        }
+        std::string device = deviceName.substr(begin, end - begin);
+        std::size_t requestsNum = 0;
+        const std::size_t bracket = device.find('(');
+        if (std::string::npos != bracket) {
+            requestsNum = std::stoul(device.substr(bracket + 1));
+            device.resize(bracket);
+        }
+        if (!device.empty()) {
+            devices.emplace_back(device, requestsNum);
+        }
+        begin = end + 1;
+    }
+    if (devices.empty()) {
+        throw std::invalid_argument("No devices in " + deviceName);
+    }
+    return devices;
+}
+
+/**
+* @brief Loads the network to every device of a MULTI: name at the same time, so InferRequestPool fans the
+* requests out over the devices itself and counts the throughput of every device. The requests of the MULTI
+* plugin can't tell which device ran them. Other device names are loaded as is
+* @param load returns the ExecutableNetwork of a device name, e.g. calls loadNetworkCached()
+*/
+template <typename Load>
+std::vector<DeviceNetwork> loadOnDevices(const std::string& deviceName, Load&& load) {
+    std::vector<DeviceNetwork> networks;
+    for (const auto& device : parseMultiDevice(deviceName)) {
+        networks.push_back({device.first, InferenceEngine::ExecutableNetwork(), device.second});
+    }
+    if (1 == networks.size()) {
+        networks.front().network = load(networks.front().deviceName);
+        return networks;
+    }
+    ParallelLoader loader;
+    for (DeviceNetwork& deviceNetwork : networks) {
+        loader.add(deviceNetwork.deviceName, [&deviceNetwork, &load]() {
+            deviceNetwork.network = load(deviceNetwork.deviceName);
+        });
+    }
+    loader.run();
+    loader.report();
+    return networks;
+}
+
+/**
+* @brief Keeps up to depth infer requests of a network in flight and returns their results in the order the
+* requests were started. Every started request carries a Payload, e.g. the frame it infers, until it is released
+*/
+template <typename Payload>
+class InferRequestPool {
+public:
+    struct Result {
+        std::size_t id;  // the number of the startAsync() call
+        InferenceEngine::InferRequest::Ptr request;
+        Payload payload;
+        std::chrono::high_resolution_clock::time_point startTime;
+        std::size_t slot;
+    };
+
+    /**
+    * @param onCompletion is called from an Inference Engine thread when a request completes
+    */
+    InferRequestPool(InferenceEngine::ExecutableNetwork& network, std::size_t depth,
+                     std::function<void()> onCompletion = nullptr):
+            InferRequestPool(std::vector<DeviceNetwork>{{"", network, std::max<std::size_t>(1, depth)}}, 0,
+                             std::move(onCompletion)) {}
+
+    /**
+    * @brief Fans the requests out over the networks of loadOnDevices(). Without a depth every device gets its
+    * requestsNum or defaultInferRequestsNum(), otherwise the depth is split between the devices evenly. The first
+    * requests alternate between the devices, later ones go to the devices which complete sooner
+    */
+    InferRequestPool(const std::vector<DeviceNetwork>& networks, std::size_t depth,
+                     std::function<void()> onCompletion = nullptr):
+            startedNum{0} {
+        for (std::size_t device = 0; device < networks.size(); device++) {
+            const DeviceNetwork& deviceNetwork = networks[device];
+            const std::size_t requests = 0 != depth ? depth / networks.size() + (device < depth % networks.size() ? 1 : 0)
+                : 0 != deviceNetwork.requestsNum ? deviceNetwork.requestsNum
+                : defaultInferRequestsNum(deviceNetwork.network, deviceNetwork.deviceName);
+            devices.push_back({deviceNetwork.deviceName, std::max<std::size_t>(1, requests), 0});
+        }
+        for (std::size_t round = 0; slots.size() < depthOf(devices); round++) {
+            for (std::size_t device = 0; device < networks.size(); device++) {
+                if (round < devices[device].requests) {
+                    slots.emplace_back();
+                    slots.back().request = InferenceEngine::ExecutableNetwork(networks[device].network).CreateInferRequestPtr();
+                    slots.back().device = device;
+                }
+            }
+        }
+        for (std::size_t i = 0; i < slots.size(); i++) {
+            slots[i].done = true;
+            // the pool may be destroyed as soon as the slot is done, so the callback notifies under the lock and
+            // keeps its own copy of onCompletion
+            slots[i].request->SetCompletionCallback(std::function<void()>([this, i, onCompletion] {
+                {
+                    std::lock_guard<std::mutex> lock{mutex};
+                    slots[i].done = true;
+                    completed.notify_all();
+                }
+                if (onCompletion) {
+                    onCompletion();
+                }
+            }));
+            idle.push_back(i);
+        }
+    }
+
+    InferRequestPool(const InferRequestPool&) = delete;
+    InferRequestPool& operator=(const InferRequestPool&) = delete;
+
+    ~InferRequestPool() {
+        // the completion callbacks of the requests in flight use the pool until they return
+        for (std::size_t slot : started) {
+            try {
+                slots[slot].request->Wait(InferenceEngine::IInferRequest::WaitMode::RESULT_READY);
+            } catch (const std::exception&) {
+                // a failed request has completed too
+            }
+        }
+        std::unique_lock<std::mutex> lock{mutex};
+        for (std::size_t slot : started) {
+            completed.wait(lock, [&] {return slots[slot].done;});
+        }
+    }
+
+    std::size_t depth() const {
+        return slots.size();
+    }
+
+    /**
+    * @brief The requests of a device and how many of them delivered their results
+    */
+    struct DeviceStats {
+        std::string deviceName;
+        std::size_t requests;
+        std::size_t completed;
+    };
+
+    const std::vector<DeviceStats>& deviceStats() const {
+        return devices;
+    }
+
+    bool hasIdle() const {
+        return !idle.empty();
+    }
+
+    std::size_t inFlight() const {
+        return started.size();
+    }
+
+    bool empty() const {
+        return started.empty();
+    }
+
+    /**
+    * @brief Returns the request startAsync() starts next to fill its inputs, requires hasIdle()
+    */
+    const InferenceEngine::InferRequest::Ptr& idleRequest() const {
+        return slots[idle.front()].request;
+    }
+
+    /**
+    * @brief Returns the idle requests in the order the next startAsync() calls start them, e.g. to fill their
+    * inputs in parallel
+    */
+    std::vector<InferenceEngine::InferRequest::Ptr> idleRequests() const {
+        std::vector<InferenceEngine::InferRequest::Ptr> requests;
+        for (std::size_t slot : idle) {
+            requests.push_back(slots[slot].request);
+        }
+        return requests;
+    }
+
+    /**
+    * @brief Starts idleRequest() and keeps the payload with it until the result is released
+    */
+    void startAsync(Payload payload) {
+        const std::size_t slot = idle.front();
+        slots[slot].payload = std::move(payload);
+        slots[slot].id = startedNum++;
+        slots[slot].startTime = std::chrono::high_resolution_clock::now();
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            slots[slot].done = false;
+        }
+        try {
+            slots[slot].request->StartAsync();
+        } catch (...) {
+            std::lock_guard<std::mutex> lock{mutex};
+            slots[slot].done = true;
+            throw;
+        }
+        idle.pop_front();
+        started.push_back(slot);
+    }
+
+    /**
+    * @brief Returns true if the oldest request in flight has completed, so pop() doesn't block
+    */
+    bool frontReady() const {
+        std::lock_guard<std::mutex> lock{mutex};
+        return !started.empty() && slots[started.front()].done;
+    }
+
+    /**
+    * @brief Waits for the oldest request in flight, requires !empty(). Throws if the inference failed.
+    * The request isn't reused until the result is released
+    */
+    Result pop() {
+        const std::size_t slot = started.front();
+        {
+            std::unique_lock<std::mutex> lock{mutex};
+            completed.wait(lock, [&] {return slots[slot].done;});
+        }
+        started.pop_front();
+        Slot& completedSlot = slots[slot];
+        devices[completedSlot.device].completed++;
+        try {
+            // surfaces an error status of the completed request as an exception
+            completedSlot.request->Wait(InferenceEngine::IInferRequest::WaitMode::RESULT_READY);
+        } catch (...) {
+            idle.push_back(slot);
+            throw;
+        }
+        return Result{completedSlot.id, completedSlot.request, std::move(completedSlot.payload), completedSlot.startTime,
+                      slot};
+    }
+
+    /**
+    * @brief Returns the request of the result to the pool
+    */
+    void release(const Result& result) {
+        idle.push_back(result.slot);
+    }
+
+    /**
+    * @brief Returns all the requests, e.g. to set inputs which don't change or to print performance counts
+    */
+    std::vector<InferenceEngine::InferRequest::Ptr> requests() const {
+        std::vector<InferenceEngine::InferRequest::Ptr> all;
+        for (const Slot& slot : slots) {
+            all.push_back(slot.request);
+        }
+        return all;
+    }
+
+private:
+    struct Slot {
+        InferenceEngine::InferRequest::Ptr request;
+        std::size_t device;
+        Payload payload;
+        std::size_t id;
+        std::chrono::high_resolution_clock::time_point startTime;
+        bool done;  // guarded by mutex
+    };
+
+    static std::size_t depthOf(const std::vector<DeviceStats>& devices) {
+        std::size_t depth = 0;
+        for (const DeviceStats& device : devices) {
+            depth += device.requests;
+        }
+        return depth;
+    }
+
+    std::vector<DeviceStats> devices;
+    std::vector<Slot> slots;
+    std::deque<std::size_t> idle;
+    std::deque<std::size_t> started;  // in the start order
+    std::size_t startedNum;
+    mutable std::mutex mutex;
+    std::condition_variable completed;
+};
+
+/**
+* @brief Prints the requests and the FPS of every device of a pool which fans out over several devices
+*/
+template <typename Payload>
+void printDevicesThroughput(std::ostream& out, const InferRequestPool<Payload>& pool, double seconds) {
+    if (pool.deviceStats().size() < 2 || seconds <= 0.0) {
+        return;
+    }
+    for (const auto& device : pool.deviceStats()) {
+        out << device.deviceName << ": " << device.requests << " infer requests, " << device.completed << " frames, "
+            << std::fixed << std::setprecision(1) << device.completed / seconds << " FPS" << std::endl;
+    }
+}
@@ -0,0 +1,313 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+/**
+ * @brief a header file with the annotations of the pipeline stages for the profilers: ITT tasks and frames which
+ * VTune shows if the demos are built with ENABLE_ITT and Chrome trace events which ui.perfetto.dev and
+ * chrome://tracing open if the demos are built with ENABLE_TRACE_EVENTS. The annotations compile to nothing and
+ * don't evaluate their arguments otherwise
+ * @file instrumentation.hpp
+ */
+
+#pragma once
+
+#include <string>
+
+#include <monitors/thread_monitor.h>
+
+#if USE_ITT || USE_TRACE_EVENTS
+#include <unordered_map>
+
+#ifdef __linux__
+#include <pthread.h>
+#endif
+#endif
+
+#if USE_ITT
+#include <ittnotify.h>
+#endif
+
+#if USE_TRACE_EVENTS
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+#endif
+
+namespace instrumentation {
+#if USE_ITT || USE_TRACE_EVENTS
+namespace details {
+#if USE_ITT
+inline __itt_domain* domain() {
+    static __itt_domain* const demosDomain = __itt_domain_create("openvino.demos");
+    return demosDomain;
+}
+
+// the names are string literals, so their handles are cached by the pointers
+inline __itt_string_handle* handle(const char* name) {
+    thread_local std::unordered_map<const char*, __itt_string_handle*> handles;
+    __itt_string_handle*& nameHandle = handles[name];
+    if (nullptr == nameHandle) {
+        nameHandle = __itt_string_handle_create(name);
+    }
+    return nameHandle;
+}
+
+// VTune counts the frames of every domain separately, so a frame name is a domain
+inline __itt_domain* frameDomain(const char* name) {
+    thread_local std::unordered_map<const char*, __itt_domain*> domains;
+    __itt_domain*& nameDomain = domains[name];
+    if (nullptr == nameDomain) {
+        nameDomain = __itt_domain_create(name);
+    }
+    return nameDomain;
+}
+#endif
+
+#if USE_TRACE_EVENTS
+/**
+* @brief The trace events of the process in the Chrome trace format, written at exit to the file DEMO_TRACE_FILE
+* names, demo_trace.json by default. Every thread keeps its own events, so the threads don't contend for them
+*/
+class TraceEvents {
+public:
+    struct Event {
+        const char* name;
+        char phase;  // 'X' - a task or a frame, 'b' and 'e' - the begin and the end of an async span
+        const void* id;  // of an async span
+        double ts;  // usec since the start of the trace
+        double dur;
+    };
+
+    static TraceEvents& instance() {
+        // never destroyed, the threads may add events while the statics are destroyed
+        static TraceEvents* traceEvents = new TraceEvents;
+        return *traceEvents;
+    }
+
+    double now() const {
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - startTime).count();
+    }
+
+    void add(const Event& event) {
+        ThreadEvents& thread = currentThread();
+        std::lock_guard<std::mutex> lock(thread.mutex);
+        if (thread.events.size() < maxEventsPerThread) {
+            thread.events.push_back(event);
+        }
+    }
+
+    void setThreadName(const std::string& name) {
+        ThreadEvents& thread = currentThread();
+        std::lock_guard<std::mutex> lock(thread.mutex);
+        thread.name = name;
+    }
+
+    void write() const {
+        const char* const path = std::getenv("DEMO_TRACE_FILE");
+        std::ofstream file(nullptr != path ? path : "demo_trace.json");
+        file << "{\"traceEvents\":[";
+        const char* separator = "\n";
+        std::lock_guard<std::mutex> lock(threadsMutex);
+        for (const auto& thread : threads) {
+            std::lock_guard<std::mutex> threadLock(thread->mutex);
+            if (!thread->name.empty()) {
+                file << separator << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << thread->tid
+                     << ",\"args\":{\"name\":\"" << escaped(thread->name) << "\"}}";
+                separator = ",\n";
+            }
+            for (const Event& event : thread->events) {
+                file << separator << "{\"ph\":\"" << event.phase << "\",\"name\":\"" << escaped(event.name)
+                     << "\",\"cat\":\"demo\",\"pid\":1,\"tid\":" << thread->tid << ",\"ts\":" << event.ts;
+                if ('X' == event.phase) {
+                    file << ",\"dur\":" << event.dur;
+                } else {
+                    file << ",\"id\":\"" << event.id << '"';
+                }
+                file << '}';
+                separator = ",\n";
+            }
+        }
+        file << "\n]}\n";
+    }
+
+private:
+    static const std::size_t maxEventsPerThread = 1000000;
+
+    struct ThreadEvents {
+        std::mutex mutex;
+        std::size_t tid;
+        std::string name;
+        std::vector<Event> events;
+    };
+
+    TraceEvents(): startTime(std::chrono::steady_clock::now()) {
+        std::atexit([] {instance().write();});
+    }
+
+    ThreadEvents& currentThread() {
+        thread_local std::shared_ptr<ThreadEvents> thread;
+        if (nullptr == thread) {
+            thread = std::make_shared<ThreadEvents>();
+            std::lock_guard<std::mutex> lock(threadsMutex);
+            thread->tid = threads.size() + 1;
+            threads.push_back(thread);
+        }
+        return *thread;
+    }
+
+    static std::string escaped(const std::string& str) {
+        std::string escapedStr;
+        for (char c : str) {
+            if ('"' == c || '\\' == c) {
+                escapedStr += '\\';
+            }
+            escapedStr += c;
+        }
+        return escapedStr;
+    }
+
+    const std::chrono::steady_clock::time_point startTime;
+    mutable std::mutex threadsMutex;
+    std::vector<std::shared_ptr<ThreadEvents>> threads;  // which ever added an event
+};
+#endif
+}  // namespace details
+
+/**
+* @brief Annotates the scope as a task of the current thread, the name is a string literal
+*/
+class ScopedTask {
+public:
+    explicit ScopedTask(const char* name): name{name} {
+#if USE_ITT
+        __itt_task_begin(details::domain(), __itt_null, __itt_null, details::handle(name));
+#endif
+#if USE_TRACE_EVENTS
+        begin = details::TraceEvents::instance().now();
+#endif
+    }
+
+    ScopedTask(const ScopedTask&) = delete;
+    ScopedTask& operator=(const ScopedTask&) = delete;
+
+    ~ScopedTask() {
+#if USE_ITT
+        __itt_task_end(details::domain());
+#endif
+#if USE_TRACE_EVENTS
+        details::TraceEvents& traceEvents = details::TraceEvents::instance();
+        traceEvents.add({name, 'X', nullptr, begin, traceEvents.now() - begin});
+#endif
+    }
+
+private:
+    const char* const name;
+#if USE_TRACE_EVENTS
+    double begin;
+#endif
+};
+
+/**
+* @brief Annotates the scope as a frame, e.g. an iteration of the main loop, VTune reports the frame rate and the
+* slow frames of every frame name
+*/
+class ScopedFrame {
+public:
+    explicit ScopedFrame(const char* name): name{name} {
+#if USE_ITT
+        __itt_frame_begin_v3(details::frameDomain(name), nullptr);
+#endif
+#if USE_TRACE_EVENTS
+        begin = details::TraceEvents::instance().now();
+#endif
+    }
+
+    ScopedFrame(const ScopedFrame&) = delete;
+    ScopedFrame& operator=(const ScopedFrame&) = delete;
+
+    ~ScopedFrame() {
+#if USE_ITT
+        __itt_frame_end_v3(details::frameDomain(name), nullptr);
+#endif
+#if USE_TRACE_EVENTS
+        details::TraceEvents& traceEvents = details::TraceEvents::instance();
+        traceEvents.add({name, 'X', nullptr, begin, traceEvents.now() - begin});
+#endif
+    }
+
+private:
+    const char* const name;
+#if USE_TRACE_EVENTS
+    double begin;
+#endif
+};
+
+/**
+* @brief Begins a span which ends on another thread, e.g. an asynchronous inference, the id tells the spans of
+* the same name apart
+*/
+inline void asyncBegin(const char* name, const void* id) {
+#if USE_ITT
+    const __itt_id ittId = __itt_id_make(const_cast<void*>(id), 0);
+    __itt_id_create(details::domain(), ittId);
+    __itt_task_begin_overlapped(details::domain(), ittId, __itt_null, details::handle(name));
+#endif
+#if USE_TRACE_EVENTS
+    details::TraceEvents& traceEvents = details::TraceEvents::instance();
+    traceEvents.add({name, 'b', id, traceEvents.now(), 0.0});
+#endif
+}
+
+inline void asyncEnd(const char* name, const void* id) {
+#if USE_ITT
+    const __itt_id ittId = __itt_id_make(const_cast<void*>(id), 0);
+    __itt_task_end_overlapped(details::domain(), ittId);
+    __itt_id_destroy(details::domain(), ittId);
+    (void)name;
+#endif
+#if USE_TRACE_EVENTS
+    details::TraceEvents& traceEvents = details::TraceEvents::instance();
+    traceEvents.add({name, 'e', id, traceEvents.now(), 0.0});
+#endif
+}
+#endif
+
+/**
+* @brief ThreadMonitor::registerCurrentThread() which also names the thread for the profilers and the system
+*/
+inline void registerCurrentThread(const std::string& name) {
+    ThreadMonitor::registerCurrentThread(name);
+#if USE_ITT
+    __itt_thread_set_name(name.c_str());
+#endif
+#if USE_TRACE_EVENTS
+    details::TraceEvents::instance().setThreadName(name);
+#endif
+#if (USE_ITT || USE_TRACE_EVENTS) && defined(__linux__)
+    // the system names are up to 15 characters
+    pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+#endif
+}
+}  // namespace instrumentation
+
+#if USE_ITT || USE_TRACE_EVENTS
+#define DEMO_INSTRUMENTATION_CONCAT_(a, b) a##b
+#define DEMO_INSTRUMENTATION_CONCAT(a, b) DEMO_INSTRUMENTATION_CONCAT_(a, b)
+#define DEMO_TASK(name) \
+    ::instrumentation::ScopedTask DEMO_INSTRUMENTATION_CONCAT(demoTask, __LINE__)(name)
+#define DEMO_FRAME(name) \
+    ::instrumentation::ScopedFrame DEMO_INSTRUMENTATION_CONCAT(demoFrame, __LINE__)(name)
+#define DEMO_ASYNC_BEGIN(name, id) ::instrumentation::asyncBegin(name, id)
+#define DEMO_ASYNC_END(name, id) ::instrumentation::asyncEnd(name, id)
+#else
+#define DEMO_TASK(name) ((void)0)
+#define DEMO_FRAME(name) ((void)0)
+#define DEMO_ASYNC_BEGIN(name, id) ((void)0)
+#define DEMO_ASYNC_END(name, id) ((void)0)
+#endif
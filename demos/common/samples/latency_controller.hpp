@@ -0,0 +1,107 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+/**
+ * @brief a header file with a controller trading the quality of a demo for the latency of its frames
+ * @file latency_controller.hpp
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+* @brief Keeps the exponentially smoothed latency of the frames under a target by the quality knobs of a demo, e.g.
+* the interval of a detector or the number of the processed objects. A knob has the levels from 0, the best quality,
+* to its maxLevel. When the smoothed latency exceeds the target, the first knob in the order of addKnob() which
+* isn't at its maxLevel is degraded by a level, and when the latency drops below restoreRatio of the target, the
+* last degraded knob is restored by a level. After a change the controller holds for holdFrames frames, so the
+* latency settles before the next decision. A target of 0 disables the controller
+*/
+class LatencyController {
+public:
+    explicit LatencyController(double targetLatency, double smoothingFactor = 0.1, std::size_t holdFrames = 30,
+                               double restoreRatio = 0.7):
+            targetLatency{targetLatency}, smoothingFactor{smoothingFactor}, holdFrames{holdFrames},
+            restoreRatio{restoreRatio}, smoothedLatency{0}, framesNum{0}, framesSinceChange{0} {}
+
+    /**
+    * @brief Adds a knob, apply(level) is called with the new level when the controller changes it
+    */
+    void addKnob(std::string name, int maxLevel, std::function<void(int)> apply) {
+        knobs.push_back({std::move(name), 0, maxLevel, std::move(apply)});
+    }
+
+    bool enabled() const {
+        return targetLatency > 0 && !knobs.empty();
+    }
+
+    /**
+    * @brief Accounts the latency of a frame and changes a knob if needed. Returns the description of the decision
+    * to log, or an empty string if no knob is changed
+    */
+    std::string update(double latency) {
+        smoothedLatency = 0 == framesNum ? latency : smoothingFactor * latency + (1 - smoothingFactor) * smoothedLatency;
+        framesNum++;
+        if (!enabled() || ++framesSinceChange < holdFrames) {
+            return {};
+        }
+
+        Knob* changed = nullptr;
+        if (smoothedLatency > targetLatency) {
+            for (Knob& knob : knobs) {
+                if (knob.level < knob.maxLevel) {
+                    knob.level++;
+                    changed = &knob;
+                    break;
+                }
+            }
+        } else if (smoothedLatency < restoreRatio * targetLatency) {
+            for (auto knob = knobs.rbegin(); knob != knobs.rend(); ++knob) {
+                if (knob->level > 0) {
+                    knob->level--;
+                    changed = &*knob;
+                    break;
+                }
+            }
+        }
+        if (!changed) {
+            return {};
+        }
+
+        framesSinceChange = 0;
+        changed->apply(changed->level);
+        std::ostringstream decision;
+        decision.precision(1);
+        decision << std::fixed << "Smoothed latency " << smoothedLatency << " ms, target " << targetLatency
+                 << " ms: " << changed->name << " level " << changed->level << " of " << changed->maxLevel;
+        return decision.str();
+    }
+
+    double getSmoothedLatency() const {
+        return smoothedLatency;
+    }
+
+private:
+    struct Knob {
+        std::string name;
+        int level;
+        int maxLevel;
+        std::function<void(int)> apply;
+    };
+
+    const double targetLatency;
+    const double smoothingFactor;
+    const std::size_t holdFrames;
+    const double restoreRatio;
+    double smoothedLatency;
+    std::size_t framesNum;
+    std::size_t framesSinceChange;
+    std::vector<Knob> knobs;
+};
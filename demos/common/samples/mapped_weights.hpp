@@ -0,0 +1,166 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+/**
+ * @brief a header file with reading of networks with the weights mapped to the memory
+ * @file mapped_weights.hpp
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <inference_engine.hpp>
+
+#include <samples/slog.hpp>
+
+#ifndef _WIN32
+namespace mapped_weights {
+/**
+* @brief A read-only shared mapping of a file. The pages of the mapping are the ones of the page cache, so the
+* processes mapping the same file share the memory of its content
+*/
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return;
+        }
+        struct stat sb;
+        if (0 == fstat(fd, &sb) && sb.st_size > 0) {
+            void* mapped = mmap(nullptr, static_cast<std::size_t>(sb.st_size), PROT_READ, MAP_SHARED, fd, 0);
+            if (MAP_FAILED != mapped) {
+                data_ = mapped;
+                size_ = static_cast<std::size_t>(sb.st_size);
+            }
+        }
+        close(fd);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+        if (nullptr != data_) {
+            munmap(data_, size_);
+        }
+    }
+
+    // nullptr if the file can't be mapped
+    const void* data() const {
+        return data_;
+    }
+
+    std::size_t size() const {
+        return size_;
+    }
+
+    // bytes of the mapping in the memory, 0 if unknown
+    std::size_t residentSize() const {
+#ifdef __linux__
+        const std::size_t pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+        std::vector<unsigned char> pages((size_ + pageSize - 1) / pageSize);
+        if (nullptr == data_ || 0 != mincore(data_, size_, pages.data())) {
+            return 0;
+        }
+        std::size_t resident = 0;
+        for (unsigned char page : pages) {
+            resident += page & 1;
+        }
+        return resident * pageSize;
+#else
+        return 0;
+#endif
+    }
+
+private:
+    void* data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+/**
+* @brief Maps a file once per process. The mappings stay for the whole run, since the networks may refer to
+* the weights instead of copying them
+*/
+inline std::shared_ptr<MappedFile> map(const std::string& path) {
+    static std::mutex mutex;
+    static std::map<std::string, std::shared_ptr<MappedFile>> files;
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<MappedFile>& file = files[path];
+    if (!file) {
+        file = std::make_shared<MappedFile>(path);
+    }
+    return file;
+}
+
+/**
+* @brief Returns the resident set size of the process in bytes, 0 if unknown
+*/
+inline std::size_t processResidentSize() {
+    std::ifstream statm("/proc/self/statm");
+    std::size_t totalPages = 0, residentPages = 0;
+    if (!(statm >> totalPages >> residentPages)) {
+        return 0;
+    }
+    return residentPages * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+}
+}  // namespace mapped_weights
+#endif
+
+/**
+* @brief Reads a network like Core::ReadNetwork(modelPath), but the .bin weights of an IR are mapped to the
+* memory read-only instead of being read to the heap, so the processes running the same models share the
+* memory of the weights. Falls back to Core::ReadNetwork(modelPath) for the models without .bin weights, e.g.
+* ONNX ones, for the weights which can't be mapped and on Windows. Logs the reading time and the resident sizes
+* of the weights and of the process
+*/
+inline InferenceEngine::CNNNetwork readNetworkMapped(const InferenceEngine::Core& ie, const std::string& modelPath) {
+#ifndef _WIN32
+    const std::string::size_type extension = modelPath.rfind('.');
+    if (std::string::npos == extension || ".xml" != modelPath.substr(extension)) {
+        return ie.ReadNetwork(modelPath);
+    }
+    const std::shared_ptr<mapped_weights::MappedFile> weights = mapped_weights::map(modelPath.substr(0, extension) + ".bin");
+    std::ifstream xml(modelPath);
+    if (nullptr == weights->data() || !xml.is_open()) {
+        return ie.ReadNetwork(modelPath);
+    }
+    const auto start = std::chrono::steady_clock::now();
+    const std::string model{std::istreambuf_iterator<char>(xml), std::istreambuf_iterator<char>()};
+    // the blob doesn't own the mapping, which outlives the network
+    InferenceEngine::Blob::CPtr blob = InferenceEngine::make_shared_blob<uint8_t>(
+        InferenceEngine::TensorDesc(InferenceEngine::Precision::U8, {weights->size()}, InferenceEngine::Layout::C),
+        static_cast<uint8_t*>(const_cast<void*>(weights->data())), weights->size());
+    InferenceEngine::CNNNetwork network = ie.ReadNetwork(model, blob);
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+    const double mb = 1024.0 * 1024.0;
+    std::ostringstream report;
+    report << std::fixed << std::setprecision(1) << elapsed.count() << " ms, mapped weights "
+           << weights->residentSize() / mb << " of " << weights->size() / mb << " MB resident, process RSS "
+           << mapped_weights::processResidentSize() / mb << " MB";
+    slog::info << "Read " << modelPath << " in " << report.str() << slog::endl;
+    return network;
+#else
+    return ie.ReadNetwork(modelPath);
+#endif
+}
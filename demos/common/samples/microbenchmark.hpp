@@ -0,0 +1,97 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+/**
+ * @brief a header file with the timing harness of the benchmarks of the demo code
+ * @file microbenchmark.hpp
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <numeric>
+#include <vector>
+
+/**
+* @brief Durations of the runs of a benchmark in milliseconds
+*/
+class BenchmarkSamples {
+public:
+    void add(double ms) {
+        samples.push_back(ms);
+        sorted = false;
+    }
+
+    std::size_t size() const {
+        return samples.size();
+    }
+
+    double total() const {
+        return std::accumulate(samples.begin(), samples.end(), 0.0);
+    }
+
+    double mean() const {
+        return samples.empty() ? 0.0 : total() / samples.size();
+    }
+
+    double median() {
+        sort();
+        return samples.empty() ? 0.0 : samples[samples.size() / 2];
+    }
+
+    double min() {
+        sort();
+        return samples.empty() ? 0.0 : samples.front();
+    }
+
+    double max() {
+        sort();
+        return samples.empty() ? 0.0 : samples.back();
+    }
+
+private:
+    void sort() {
+        if (!sorted) {
+            std::sort(samples.begin(), samples.end());
+            sorted = true;
+        }
+    }
+
+    std::vector<double> samples;
+    bool sorted = true;
+};
+
+/**
+* @brief Calls run(index) warmupRuns times, then times the calls until there are at least minRuns of them and
+* they took minTotalMs at least. The index of the timed calls starts from 0
+*/
+template <typename F>
+BenchmarkSamples measureRuns(F run, int warmupRuns, int minRuns, double minTotalMs = 0.0) {
+    for (int i = 0; i < warmupRuns; i++) {
+        run(i);
+    }
+    BenchmarkSamples samples;
+    double total = 0.0;
+    for (int i = 0; i < minRuns || total < minTotalMs; i++) {
+        const auto start = std::chrono::steady_clock::now();
+        run(i);
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        samples.add(elapsed.count());
+        total += elapsed.count();
+    }
+    return samples;
+}
+
+/**
+* @brief Returns the problem sizes given as the command line arguments of a benchmark or the default ones
+*/
+inline std::vector<int> benchmarkSizes(int argc, char *argv[], const std::vector<int>& defaultSizes) {
+    std::vector<int> sizes;
+    for (int i = 1; i < argc; i++) {
+        sizes.push_back(std::atoi(argv[i]));
+    }
+    return sizes.empty() ? defaultSizes : sizes;
+}
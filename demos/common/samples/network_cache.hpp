@@ -0,0 +1,226 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+/**
+ * @brief a header file with loading of networks through an on-disk cache of compiled networks
+ * @file network_cache.hpp
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <inference_engine.hpp>
+
+#include <samples/slog.hpp>
+
+namespace network_cache {
+/**
+* @brief 64-bit FNV-1a hash of the data continuing from the given hash
+*/
+inline uint64_t hash(const char* data, std::size_t size, uint64_t seed = 14695981039346656037ull) {
+    for (std::size_t i = 0; i < size; i++) {
+        seed = (seed ^ static_cast<uint8_t>(data[i])) * 1099511628211ull;
+    }
+    return seed;
+}
+
+inline uint64_t hash(const std::string& data) {
+    return hash(data.data(), data.size());
+}
+
+/**
+* @brief Hashes the content of a file, returns false if the file can't be read
+*/
+inline bool hashFile(const std::string& path, uint64_t& seed) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::string chunk(1 << 20, '\0');
+    while (file.read(&chunk[0], chunk.size()) || file.gcount() > 0) {
+        seed = hash(chunk.data(), static_cast<std::size_t>(file.gcount()), seed);
+    }
+    return true;
+}
+
+/**
+* @brief Returns the config a network is compiled with: the config set on the Core by SetConfig(), such as
+* KEY_PERF_COUNT or the throughput streams, of the device and of the devices HETERO or MULTI spread the network
+* over, overridden by the config of the load. The keys are prefixed by the device names
+*/
+inline std::map<std::string, std::string> effectiveConfig(const InferenceEngine::Core& ie, const std::string& deviceName,
+                                                          const std::map<std::string, std::string>& config) {
+    const std::string::size_type colon = deviceName.find(':');
+    std::vector<std::string> devices = {deviceName.substr(0, colon)};
+    if (std::string::npos != colon) {
+        std::istringstream list(deviceName.substr(colon + 1));
+        for (std::string device; std::getline(list, device, ',');) {
+            devices.push_back(device.substr(0, device.find('(')));  // drops the MULTI priorities like CPU(4)
+        }
+    }
+    std::map<std::string, std::string> effective;
+    for (const std::string& device : devices) {
+        std::vector<std::string> keys;
+        try {
+            keys = ie.GetMetric(device, METRIC_KEY(SUPPORTED_CONFIG_KEYS)).as<std::vector<std::string>>();
+        } catch (const std::exception&) {
+            continue;
+        }
+        for (const std::string& key : keys) {
+            try {
+                effective[device + '.' + key] = ie.GetConfig(device, key).as<std::string>();
+            } catch (const std::exception&) {
+                // the values which aren't strings don't come from SetConfig()
+            }
+        }
+    }
+    for (const auto& item : config) {
+        effective[devices.front() + '.' + item.first] = item.second;
+    }
+    return effective;
+}
+
+/**
+* @brief Describes everything a compiled network depends on: the model files, the inputs and outputs set up
+* by the demo, the device, the effective config and the Inference Engine build. Returns an empty string if the
+* model files can't be read
+*/
+inline std::string describe(const InferenceEngine::Core& ie, const InferenceEngine::CNNNetwork& network,
+                            const std::string& modelPath, const std::string& deviceName,
+                            const std::map<std::string, std::string>& config) {
+    uint64_t modelHash = hash("", 0);
+    const std::string::size_type extension = modelPath.rfind('.');
+    if (!hashFile(modelPath, modelHash) || !hashFile(modelPath.substr(0, extension) + ".bin", modelHash)) {
+        return "";
+    }
+    std::ostringstream description;
+    description << modelHash << ';' << InferenceEngine::GetInferenceEngineVersion()->buildNumber << ';' << deviceName
+        << ';' << network.getBatchSize();
+    for (const auto& item : effectiveConfig(ie, deviceName, config)) {
+        description << ';' << item.first << '=' << item.second;
+    }
+    for (const auto& input : network.getInputsInfo()) {
+        const InferenceEngine::TensorDesc& desc = input.second->getTensorDesc();
+        description << ";in " << input.first << ' ' << desc.getPrecision() << ' ' << desc.getLayout();
+        for (std::size_t dim : desc.getDims()) {
+            description << ' ' << dim;
+        }
+    }
+    for (const auto& output : network.getOutputsInfo()) {
+        const InferenceEngine::TensorDesc& desc = output.second->getTensorDesc();
+        description << ";out " << output.first << ' ' << desc.getPrecision() << ' ' << desc.getLayout();
+        for (std::size_t dim : desc.getDims()) {
+            description << ' ' << dim;
+        }
+    }
+    return description.str();
+}
+
+/**
+* @brief Returns true if the inputs have preprocessing which the exported network doesn't keep
+*/
+inline bool hasPreProcessing(const InferenceEngine::CNNNetwork& network) {
+    for (const auto& input : network.getInputsInfo()) {
+        const InferenceEngine::PreProcessInfo& preProcess = input.second->getPreProcess();
+        if (InferenceEngine::NO_RESIZE != preProcess.getResizeAlgorithm()
+                || InferenceEngine::NONE != preProcess.getMeanVariant()) {
+            return true;
+        }
+    }
+    return false;
+}
+}  // namespace network_cache
+
+/**
+* @brief Loads the network to the device like Core::LoadNetwork() but through cacheDir: the compiled network
+* is imported from the cache if it was exported for the same model, inputs and outputs, device and effective config,
+* otherwise the network is compiled and exported to the cache for later runs. Falls back to compiling if the
+* cache is disabled by an empty cacheDir, the cached network can't be imported, the device doesn't support
+* export or the network has resize or mean preprocessing that exported networks don't keep
+* @param modelPath path to the .xml model file the network was read from
+*/
+inline InferenceEngine::ExecutableNetwork loadNetworkCached(InferenceEngine::Core& ie, const InferenceEngine::CNNNetwork& network,
+                                                            const std::string& modelPath, const std::string& deviceName,
+                                                            const std::map<std::string, std::string>& config,
+                                                            const std::string& cacheDir) {
+    if (cacheDir.empty()) {
+        return ie.LoadNetwork(network, deviceName, config);
+    }
+    if (network_cache::hasPreProcessing(network)) {
+        slog::info << "Compiled network cache is skipped for " << modelPath << ": it has input preprocessing" << slog::endl;
+        return ie.LoadNetwork(network, deviceName, config);
+    }
+    const std::string description = network_cache::describe(ie, network, modelPath, deviceName, config);
+    if (description.empty()) {
+        return ie.LoadNetwork(network, deviceName, config);
+    }
+    std::string modelName = modelPath.substr(modelPath.find_last_of("/\\") + 1);
+    modelName = modelName.substr(0, modelName.rfind('.'));
+    std::ostringstream blobPath;
+    blobPath << cacheDir << '/' << modelName << '-' << std::hex << std::setw(16) << std::setfill('0')
+        << network_cache::hash(description) << ".blob";
+
+    struct stat sb;
+    if (0 == stat(blobPath.str().c_str(), &sb)) {
+        try {
+            InferenceEngine::ExecutableNetwork executableNetwork = ie.ImportNetwork(blobPath.str(), deviceName, config);
+            slog::info << "Imported the compiled network from " << blobPath.str() << slog::endl;
+            return executableNetwork;
+        } catch (const std::exception& error) {
+            slog::warn << "Can't import " << blobPath.str() << ", compiling the network: " << error.what() << slog::endl;
+        }
+    }
+
+    InferenceEngine::ExecutableNetwork executableNetwork = ie.LoadNetwork(network, deviceName, config);
+    if (0 != stat(cacheDir.c_str(), &sb)) {
+#ifdef _WIN32
+        _mkdir(cacheDir.c_str());
+#else
+        mkdir(cacheDir.c_str(), 0755);
+#endif
+    }
+    // exports to a temporary file of this run first so that concurrent runs never import or rename a partially
+    // written network
+#ifdef _WIN32
+    const int pid = _getpid();
+#else
+    const int pid = static_cast<int>(getpid());
+#endif
+    std::ostringstream tmpName;
+    tmpName << blobPath.str() << '.' << pid << '-' << std::hex << std::random_device()() << ".tmp";
+    const std::string tmpPath = tmpName.str();
+    try {
+        executableNetwork.Export(tmpPath);
+#ifdef _WIN32
+        // rename() replaces the target atomically on POSIX only
+        std::remove(blobPath.str().c_str());
+#endif
+        if (0 != std::rename(tmpPath.c_str(), blobPath.str().c_str())) {
+            throw std::runtime_error("can't rename " + tmpPath);
+        }
+        slog::info << "Exported the compiled network to " << blobPath.str() << slog::endl;
+    } catch (const std::exception& error) {
+        std::remove(tmpPath.c_str());
+        slog::info << "The compiled network isn't cached for " << deviceName << ": " << error.what() << slog::endl;
+    }
+    return executableNetwork;
+}
@@ -0,0 +1,119 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+/**
+ * @brief a header file with the non-maximum suppression of the detection demos
+ * @file nms.hpp
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <numeric>
+#include <vector>
+
+/**
+* @brief Boxes to suppress as a structure of arrays, so the overlaps of a box with the kept ones are computed
+* by a loop over contiguous floats, which the compiler vectorizes
+*/
+struct NmsBoxes {
+    std::vector<float> xmin, ymin, xmax, ymax;
+    std::vector<float> scores;
+    std::vector<int> labels;
+
+    std::size_t size() const {
+        return scores.size();
+    }
+
+    void clear() {
+        xmin.clear();
+        ymin.clear();
+        xmax.clear();
+        ymax.clear();
+        scores.clear();
+        labels.clear();
+    }
+
+    void reserve(std::size_t size) {
+        xmin.reserve(size);
+        ymin.reserve(size);
+        xmax.reserve(size);
+        ymax.reserve(size);
+        scores.reserve(size);
+        labels.reserve(size);
+    }
+
+    void push_back(float boxXmin, float boxYmin, float boxXmax, float boxYmax, float score, int label) {
+        xmin.push_back(boxXmin);
+        ymin.push_back(boxYmin);
+        xmax.push_back(boxXmax);
+        ymax.push_back(boxYmax);
+        scores.push_back(score);
+        labels.push_back(label);
+    }
+};
+
+/**
+* @brief Greedy non-maximum suppression: a box is kept if its intersection over union with every kept box of a
+* greater score is less than iouThreshold. The boxes are bucketed by the label, so only the boxes of the same
+* label suppress each other unless classAgnostic is set, and the cost is quadratic in the size of a bucket rather
+* than of all the boxes. Returns the indices of the kept boxes in the descending order of the scores
+*/
+inline std::vector<int> nms(const NmsBoxes& boxes, float iouThreshold, bool classAgnostic = false) {
+    const int count = static_cast<int>(boxes.size());
+    std::vector<int> order(count);
+    std::iota(order.begin(), order.end(), 0);
+    auto label = [&](int idx) {
+        return classAgnostic ? 0 : boxes.labels[idx];
+    };
+    // the boxes of a label are contiguous in the order, the greater scores first
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+        if (label(a) != label(b)) {
+            return label(a) < label(b);
+        }
+        return boxes.scores[a] > boxes.scores[b] || (boxes.scores[a] == boxes.scores[b] && a < b);
+    });
+
+    std::vector<int> kept;
+    std::vector<float> keptXmin, keptYmin, keptXmax, keptYmax, keptAreas;  // of the current label
+    for (int begin = 0, end = 0; begin < count; begin = end) {
+        while (end < count && label(order[end]) == label(order[begin])) {
+            end++;
+        }
+        keptXmin.clear();
+        keptYmin.clear();
+        keptXmax.clear();
+        keptYmax.clear();
+        keptAreas.clear();
+        for (int i = begin; i < end; i++) {
+            const int idx = order[i];
+            const float xmin = boxes.xmin[idx], ymin = boxes.ymin[idx];
+            const float xmax = boxes.xmax[idx], ymax = boxes.ymax[idx];
+            const float area = (xmax - xmin) * (ymax - ymin);
+            const std::size_t numKept = keptAreas.size();
+            int suppressed = 0;
+            // no branches and no division, iou >= threshold is intersection >= threshold * union
+            for (std::size_t k = 0; k < numKept; k++) {
+                const float width = std::max(0.0f, std::min(xmax, keptXmax[k]) - std::max(xmin, keptXmin[k]));
+                const float height = std::max(0.0f, std::min(ymax, keptYmax[k]) - std::max(ymin, keptYmin[k]));
+                const float intersection = width * height;
+                suppressed |= (intersection > 0.0f) & (intersection >= iouThreshold * (area + keptAreas[k] - intersection));
+            }
+            if (!suppressed) {
+                kept.push_back(idx);
+                keptXmin.push_back(xmin);
+                keptYmin.push_back(ymin);
+                keptXmax.push_back(xmax);
+                keptYmax.push_back(ymax);
+                keptAreas.push_back(area);
+            }
+        }
+    }
+
+    std::sort(kept.begin(), kept.end(), [&](int a, int b) {
+        return boxes.scores[a] > boxes.scores[b] || (boxes.scores[a] == boxes.scores[b] && a < b);
+    });
+    return kept;
+}
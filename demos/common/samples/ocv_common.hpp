@@ -9,54 +9,134 @@
 
 #pragma once
 
+#include <vector>
+
 #include <samples/common.hpp>
+#include <samples/hwc_to_chw.hpp>
 #include <opencv2/opencv.hpp>
 
+namespace details {
 /**
-* @brief Sets image data stored in cv::Mat object to a given Blob object.
-* @param orig_image - given cv::Mat object with an image data.
-* @param blob - Blob object which to be filled by an image data.
-* @param batchIndex - batch index of an image inside of the blob.
+* @brief Images with at least that many pixels are converted by horizontal stripes in parallel
 */
+constexpr int parallelConversionPixels = 1 << 18;
+
+/**
+* @brief Converts the rows [range.start, range.end) of an interleaved 8-bit image into planes of T
+* spaced planeSize elements apart
+*/
+inline void hwcU8ToPlanes(const cv::Mat& image, const cv::Range& range, uint8_t* dst, size_t planeSize) {
+    const int channels = image.channels();
+    const cv::Mat rows = image.rowRange(range);
+    std::vector<cv::Mat> planes;
+    std::vector<int> fromTo;
+    for (int c = 0; c < channels; c++) {
+        planes.emplace_back(rows.rows, rows.cols, CV_8UC1, dst + c * planeSize + range.start * image.cols);
+        fromTo.push_back(c);
+        fromTo.push_back(c);
+    }
+    cv::mixChannels(&rows, 1, planes.data(), planes.size(), fromTo.data(), channels);
+}
+
+inline void hwcU8ToPlanes(const cv::Mat& image, const cv::Range& range, float* dst, size_t planeSize) {
+    hwcU8ToChwF32Rows(image.ptr<uint8_t>(range.start), image.step, image.cols, range.size(), image.channels(),
+                      dst + range.start * image.cols, planeSize);
+}
+
 template <typename T>
-void matU8ToBlob(const cv::Mat& orig_image, InferenceEngine::Blob::Ptr& blob, int batchIndex = 0) {
-    InferenceEngine::SizeVector blobSize = blob->getTensorDesc().getDims();
-    const size_t width = blobSize[3];
-    const size_t height = blobSize[2];
-    const size_t channels = blobSize[1];
-    if (static_cast<size_t>(orig_image.channels()) != channels) {
-        THROW_IE_EXCEPTION << "The number of channels for net input and image must match";
+void hwcU8ToPlanes(const cv::Mat& image, const cv::Range& range, T* dst, size_t planeSize) {
+    const cv::Mat rows = image.rowRange(range);
+    std::vector<cv::Mat> planes;
+    cv::split(rows, planes);
+    for (size_t c = 0; c < planes.size(); c++) {
+        planes[c].convertTo(cv::Mat(rows.rows, rows.cols, CV_MAKETYPE(cv::DataType<T>::depth, 1),
+                                    dst + c * planeSize + range.start * image.cols), cv::DataType<T>::depth);
     }
-    T* blob_data = blob->buffer().as<T*>();
+}
+
+template <typename T>
+class HwcU8ToPlanesBody : public cv::ParallelLoopBody {
+public:
+    HwcU8ToPlanesBody(const cv::Mat& image, T* dst) : image(image), dst(dst) {}
 
-    cv::Mat resized_image(orig_image);
-    if (static_cast<int>(width) != orig_image.size().width ||
-            static_cast<int>(height) != orig_image.size().height) {
-        cv::resize(orig_image, resized_image, cv::Size(width, height));
+    void operator()(const cv::Range& range) const override {
+        hwcU8ToPlanes(image, range, dst, image.total());
     }
 
-    int batchOffset = batchIndex * width * height * channels;
+private:
+    const cv::Mat& image;
+    T* dst;
+};
+}  // namespace details
+
+/**
+* @brief Fills one image of a blob of the given layout with image data stored in a cv::Mat object.
+* The image is resized to the blob size if its size differs: straight into the blob data for U8 NHWC blobs,
+* otherwise into a per-thread buffer reused by later calls. Interleaved to planar and u8 to T conversions are
+* vectorized and large images are converted by stripes in parallel. An image which already has the blob size
+* and element type of an NHWC blob is just copied
+* @param image - given cv::Mat object with an 8-bit image data
+* @param desc - tensor descriptor of the blob, NCHW or NHWC
+* @param data - blob data to be filled
+* @param batchIndex - batch index of the image inside of the blob
+*/
+template <typename T>
+void matU8ToBlobData(const cv::Mat& image, const InferenceEngine::TensorDesc& desc, T* data, int batchIndex = 0) {
+    const InferenceEngine::SizeVector& blobSize = desc.getDims();
+    const int width = static_cast<int>(blobSize[3]);
+    const int height = static_cast<int>(blobSize[2]);
+    const int channels = static_cast<int>(blobSize[1]);
+    if (image.channels() != channels) {
+        THROW_IE_EXCEPTION << "The number of channels for net input and image must match";
+    }
+    if (channels != 1 && channels != 3) {
+        THROW_IE_EXCEPTION << "Unsupported number of channels";
+    }
+    T* blobData = data + batchIndex * width * height * channels;
+    const cv::Size size(width, height);
 
-    if (channels == 1) {
-        for (size_t  h = 0; h < height; h++) {
-            for (size_t w = 0; w < width; w++) {
-                blob_data[batchOffset + h * width + w] = resized_image.at<uchar>(h, w);
-            }
+    if (InferenceEngine::Layout::NHWC == desc.getLayout()) {
+        cv::Mat blobImage(size, CV_MAKETYPE(cv::DataType<T>::depth, channels), blobData);
+        if (image.data == blobImage.data && image.type() == blobImage.type() && image.size() == size) {
+            return;  // the image already wraps the blob data
         }
-    } else if (channels == 3) {
-        for (size_t c = 0; c < channels; c++) {
-            for (size_t  h = 0; h < height; h++) {
-                for (size_t w = 0; w < width; w++) {
-                    blob_data[batchOffset + c * width * height + h * width + w] =
-                            resized_image.at<cv::Vec3b>(h, w)[c];
-                }
-            }
+        if (image.size() == size) {
+            image.convertTo(blobImage, blobImage.depth());
+        } else if (CV_8U == blobImage.depth()) {
+            cv::resize(image, blobImage, size);
+        } else {
+            static thread_local cv::Mat resized;
+            cv::resize(image, resized, size);
+            resized.convertTo(blobImage, blobImage.depth());
         }
+        return;
+    }
+
+    cv::Mat resized = image;
+    if (image.size() != size) {
+        static thread_local cv::Mat resizeBuffer;
+        cv::resize(image, resizeBuffer, size);
+        resized = resizeBuffer;
+    }
+    const details::HwcU8ToPlanesBody<T> body(resized, blobData);
+    if (width * height >= details::parallelConversionPixels) {
+        cv::parallel_for_(cv::Range(0, height), body);
     } else {
-        THROW_IE_EXCEPTION << "Unsupported number of channels";
+        body(cv::Range(0, height));
     }
 }
 
+/**
+* @brief Sets image data stored in cv::Mat object to a given Blob object.
+* @param orig_image - given cv::Mat object with an image data.
+* @param blob - Blob object which to be filled by an image data.
+* @param batchIndex - batch index of an image inside of the blob.
+*/
+template <typename T>
+void matU8ToBlob(const cv::Mat& orig_image, InferenceEngine::Blob::Ptr& blob, int batchIndex = 0) {
+    matU8ToBlobData<T>(orig_image, blob->getTensorDesc(), blob->buffer().as<T*>(), batchIndex);
+}
+
 /**
  * @brief Wraps data stored inside of a passed cv::Mat object by new Blob pointer.
  * @note: No memory allocation is happened. The blob just points to already existing
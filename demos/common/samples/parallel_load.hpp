@@ -0,0 +1,104 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+/**
+ * @brief a header file with the concurrent loading of the networks of a demo
+ * @file parallel_load.hpp
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <samples/slog.hpp>
+
+/**
+* @brief Loads the independent networks of a demo at the same time, so that the startup takes about as long as
+* the slowest compilation rather than all of them together, which matters most for GPU and MYRIAD. The loads
+* share an InferenceEngine::Core, which is thread safe. The log is asynchronous while the loads run unless the
+* demo logs asynchronously already, so the lines logged by the concurrent loads don't mix
+*/
+class ParallelLoader {
+public:
+    /**
+    * @brief Adds a load, the name is the one of the startup report
+    */
+    void add(const std::string& name, std::function<void()> load) {
+        loads.emplace_back(name, std::move(load));
+    }
+
+    /**
+    * @brief Runs the added loads, one after another if parallel is false, and waits for all of them. The
+    * exception of the first failed load is rethrown once all the loads are finished
+    */
+    void run(bool parallel = true) {
+        const auto start = clock::now();
+        const bool asyncLog = parallel && loads.size() > 1 && nullptr == slog::asyncSink();
+        if (asyncLog) {
+            slog::startAsyncLogging(std::unique_ptr<slog::AsyncSink>(new slog::AsyncSink(std::cout)));
+        }
+        durations.assign(loads.size(), ms::zero());
+        std::vector<std::future<void>> finished;
+        for (std::size_t i = 0; i < loads.size(); i++) {
+            finished.push_back(std::async(parallel ? std::launch::async : std::launch::deferred, [this, i]() {
+                const auto loadStart = clock::now();
+                loads[i].second();
+                durations[i] = clock::now() - loadStart;
+            }));
+        }
+        std::exception_ptr error;
+        for (auto& load : finished) {
+            try {
+                load.get();
+            } catch (...) {
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+        if (asyncLog) {
+            slog::stopAsyncLogging();
+        }
+        total = clock::now() - start;
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    /**
+    * @brief Logs the time of every load, their sum and the time all of them took
+    */
+    void report() const {
+        std::ostringstream breakdown;
+        breakdown << std::fixed << std::setprecision(1);
+        ms sum = ms::zero();
+        for (std::size_t i = 0; i < loads.size(); i++) {
+            breakdown << (i > 0 ? ", " : "") << loads[i].first << " " << durations[i].count() << " ms";
+            sum += durations[i];
+        }
+        slog::info << "Network loads: " << breakdown.str() << slog::endl;
+        breakdown.str("");
+        breakdown << total.count() << " ms, " << sum.count() << " ms one after another";
+        slog::info << "All network loads: " << breakdown.str() << slog::endl;
+    }
+
+private:
+    using clock = std::chrono::steady_clock;
+    using ms = std::chrono::duration<double, std::milli>;
+
+    std::vector<std::pair<std::string, std::function<void()>>> loads;
+    std::vector<ms> durations;
+    ms total = ms::zero();
+};
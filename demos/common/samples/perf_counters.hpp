@@ -0,0 +1,252 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+/**
+ * @brief a header file with aggregation of per layer performance counters over infer requests and iterations
+ * @file perf_counters.hpp
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <iomanip>
+#include <ios>
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <inference_engine.hpp>
+
+/**
+* @brief Collects GetPerformanceCounts() of every completed inference, of any request of a network, and reports
+* the mean and the 95th percentile of every layer and the layers taking the most time. The percentiles come from
+* histograms of about 9% wide buckets, so a long run over a camera keeps a constant memory. The JSON report can be
+* compared with a report of another run by common/compare_perf_counts.py
+*/
+class PerfCountersAggregator {
+public:
+    struct LayerStats {
+        std::string name;
+        std::string layerType;
+        std::string execType;
+        std::string status;  // of the last inference
+        unsigned executionIndex;
+        std::size_t count;
+        double realMean;
+        double realP95;
+        double realMax;
+        double cpuMean;
+        double cpuP95;
+    };
+
+    void add(const std::map<std::string, InferenceEngine::InferenceEngineProfileInfo>& performanceMap) {
+        long long total = 0;
+        for (const auto& item : performanceMap) {
+            const InferenceEngine::InferenceEngineProfileInfo& info = item.second;
+            Layer& layer = layers[item.first];
+            layer.layerType = info.layer_type;
+            layer.execType = info.exec_type;
+            layer.status = info.status;
+            layer.executionIndex = info.execution_index;
+            const long long realTime = std::max(0ll, static_cast<long long>(info.realTime_uSec));
+            layer.realTimes.add(realTime);
+            layer.cpuTimes.add(std::max(0ll, static_cast<long long>(info.cpu_uSec)));
+            total += realTime;
+        }
+        totalTimes.add(total);
+    }
+
+    void add(InferenceEngine::InferRequest& request) {
+        add(request.GetPerformanceCounts());
+    }
+
+    std::size_t getIterations() const {
+        return totalTimes.getCount();
+    }
+
+    /**
+    * @brief Returns the statistics of the layers in their execution order, real and cpu times are in microseconds
+    */
+    std::vector<LayerStats> getLayerStats() const {
+        std::vector<LayerStats> stats;
+        for (const auto& item : layers) {
+            const Layer& layer = item.second;
+            LayerStats layerStats;
+            layerStats.name = item.first;
+            layerStats.layerType = layer.layerType;
+            layerStats.execType = layer.execType;
+            layerStats.status = statusName(layer.status);
+            layerStats.executionIndex = layer.executionIndex;
+            layerStats.count = layer.realTimes.getCount();
+            layerStats.realMean = layer.realTimes.mean();
+            layerStats.realP95 = layer.realTimes.percentile(0.95);
+            layerStats.realMax = layer.realTimes.getMax();
+            layerStats.cpuMean = layer.cpuTimes.mean();
+            layerStats.cpuP95 = layer.cpuTimes.percentile(0.95);
+            stats.push_back(std::move(layerStats));
+        }
+        std::stable_sort(stats.begin(), stats.end(), [](const LayerStats& l, const LayerStats& r) {
+            return l.executionIndex < r.executionIndex;
+        });
+        return stats;
+    }
+
+    /**
+    * @brief Returns up to topN layers with the greatest mean real time, the greatest first
+    */
+    std::vector<LayerStats> getHotspots(std::size_t topN) const {
+        std::vector<LayerStats> stats = getLayerStats();
+        std::stable_sort(stats.begin(), stats.end(), [](const LayerStats& l, const LayerStats& r) {
+            return l.realMean > r.realMean;
+        });
+        stats.resize(std::min(topN, stats.size()));
+        return stats;
+    }
+
+    void printHotspots(std::ostream& stream, std::size_t topN = 10) const {
+        const double totalMean = totalTimes.mean();
+        const std::ios::fmtflags flags = stream.flags();
+        const std::streamsize precision = stream.precision();
+        stream << std::endl << "Top " << topN << " layers by mean real time over " << getIterations()
+            << " inferences:" << std::endl;
+        for (const LayerStats& layer : getHotspots(topN)) {
+            std::string toPrint(layer.name);
+            const int maxLayerName = 30;
+            if (layer.name.length() >= maxLayerName) {
+                toPrint = layer.name.substr(0, maxLayerName - 4) + "...";
+            }
+            stream << std::setw(maxLayerName) << std::left << toPrint
+                << std::setw(20) << std::left << layer.layerType
+                << std::fixed << std::setprecision(1)
+                << "mean: " << std::setw(10) << std::left << layer.realMean
+                << "p95: " << std::setw(10) << std::left << layer.realP95
+                << std::setw(8) << std::right << (totalMean > 0 ? 100 * layer.realMean / totalMean : 0.0) << " %"
+                << std::endl;
+        }
+        stream << "Total time mean: " << std::fixed << std::setprecision(1) << totalMean << ", p95: "
+            << totalTimes.percentile(0.95) << " microseconds" << std::endl;
+        stream.flags(flags);
+        stream.precision(precision);
+    }
+
+    void writeJson(std::ostream& stream, const std::string& deviceName, std::size_t topN = 10) const {
+        stream << std::fixed << std::setprecision(3);
+        stream << "{\"device\":\"" << escape(deviceName) << "\",\"iterations\":" << getIterations()
+            << ",\"total_us\":{\"mean\":" << totalTimes.mean() << ",\"p95\":" << totalTimes.percentile(0.95)
+            << "},\n\"layers\":[";
+        const char* separator = "\n";
+        for (const LayerStats& layer : getLayerStats()) {
+            stream << separator << "{\"name\":\"" << escape(layer.name) << "\",\"type\":\"" << escape(layer.layerType)
+                << "\",\"exec_type\":\"" << escape(layer.execType) << "\",\"status\":\"" << layer.status
+                << "\",\"count\":" << layer.count
+                << ",\"real_us\":{\"mean\":" << layer.realMean << ",\"p95\":" << layer.realP95
+                << ",\"max\":" << layer.realMax << "},\"cpu_us\":{\"mean\":" << layer.cpuMean
+                << ",\"p95\":" << layer.cpuP95 << "}}";
+            separator = ",\n";
+        }
+        stream << "],\n\"hotspots\":[";
+        separator = "";
+        for (const LayerStats& layer : getHotspots(topN)) {
+            stream << separator << '"' << escape(layer.name) << '"';
+            separator = ",";
+        }
+        stream << "]}\n";
+    }
+
+private:
+    class Times {  // counts times in logarithmic buckets, 8 per power of 2 microseconds
+    public:
+        Times(): count{0}, sum{0}, max{0} {
+            buckets.fill(0);
+        }
+        void add(long long usec) {
+            const std::size_t bucket = usec < 1 ? 0 : 1 + static_cast<std::size_t>(8 * std::log2(static_cast<double>(usec)));
+            buckets[std::min(bucket, buckets.size() - 1)]++;
+            count++;
+            sum += usec;
+            max = std::max(max, usec);
+        }
+        std::size_t getCount() const {
+            return count;
+        }
+        double mean() const {
+            return 0 == count ? 0.0 : static_cast<double>(sum) / count;
+        }
+        double getMax() const {
+            return static_cast<double>(max);
+        }
+        // interpolated in the bucket with the percentile, the maximum the most
+        double percentile(double share) const {
+            const uint64_t rank = static_cast<uint64_t>(std::ceil(share * count));
+            uint64_t counted = 0;
+            for (std::size_t i = 0; i < buckets.size(); i++) {
+                counted += buckets[i];
+                if (counted >= rank && 0 != counted) {
+                    if (0 == i) {
+                        return 0.0;
+                    }
+                    const double lower = 1 == i ? 1.0 : std::pow(2.0, (i - 1) / 8.0);
+                    const double upper = std::pow(2.0, i / 8.0);
+                    const double position = static_cast<double>(rank - (counted - buckets[i])) / buckets[i];
+                    return std::min(lower + (upper - lower) * position, getMax());
+                }
+            }
+            return 0.0;
+        }
+
+    private:
+        std::array<uint64_t, 256> buckets;
+        std::size_t count;
+        long long sum;
+        long long max;
+    };
+
+    struct Layer {
+        std::string layerType;
+        std::string execType;
+        InferenceEngine::InferenceEngineProfileInfo::LayerStatus status;
+        unsigned executionIndex;
+        Times realTimes;
+        Times cpuTimes;
+    };
+
+    static const char* statusName(InferenceEngine::InferenceEngineProfileInfo::LayerStatus status) {
+        switch (status) {
+        case InferenceEngine::InferenceEngineProfileInfo::EXECUTED:
+            return "EXECUTED";
+        case InferenceEngine::InferenceEngineProfileInfo::NOT_RUN:
+            return "NOT_RUN";
+        case InferenceEngine::InferenceEngineProfileInfo::OPTIMIZED_OUT:
+            return "OPTIMIZED_OUT";
+        }
+        return "UNKNOWN";
+    }
+
+    static std::string escape(const std::string& text) {
+        std::string escaped;
+        for (char c : text) {
+            if ('"' == c || '\\' == c) {
+                escaped += '\\';
+                escaped += c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                char code[7];
+                std::snprintf(code, sizeof(code), "\\u%04x", c);
+                escaped += code;
+            } else {
+                escaped += c;
+            }
+        }
+        return escaped;
+    }
+
+    std::map<std::string, Layer> layers;
+    Times totalTimes;  // per inference
+};
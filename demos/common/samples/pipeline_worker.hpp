@@ -0,0 +1,148 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+/**
+ * @brief a header file with a background thread running a stage of a demo pipeline
+ * @file pipeline_worker.hpp
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+/**
+* @brief Runs a stage of a pipeline, e.g. the postprocessing of the inference results, on the pushed items in a
+* background thread. The results are popped in the order of the items, so the stage overlaps the previous and the
+* next stages of the caller without reordering the frames. The caller bounds the number of the items in the stage
+* by size(), e.g. by the number of its infer requests
+*/
+template <typename In, typename Out>
+class PipelineWorker {
+public:
+    explicit PipelineWorker(std::function<Out(In&)> process):
+            process(std::move(process)), queued{0}, stopped{false} {
+        worker = std::thread(&PipelineWorker::run, this);
+    }
+
+    PipelineWorker(const PipelineWorker&) = delete;
+    PipelineWorker& operator=(const PipelineWorker&) = delete;
+
+    /**
+    * @brief Stops the thread, the items which aren't processed yet are dropped
+    */
+    ~PipelineWorker() {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            stopped = true;
+        }
+        changed.notify_all();
+        worker.join();
+    }
+
+    void push(In item) {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            inputs.push_back(std::move(item));
+            queued++;
+        }
+        changed.notify_all();
+    }
+
+    /**
+    * @brief Returns the number of the pushed items which aren't popped
+    */
+    std::size_t size() const {
+        std::lock_guard<std::mutex> lock{mutex};
+        return queued;
+    }
+
+    bool empty() const {
+        return 0 == size();
+    }
+
+    /**
+    * @brief Pops the result of the oldest item if it is ready. Rethrows an exception of the processing of the item
+    */
+    bool tryPop(Out& result) {
+        std::unique_lock<std::mutex> lock{mutex};
+        return popReady(lock, result);
+    }
+
+    /**
+    * @brief Waits for the result of the oldest item, requires !empty(). Rethrows an exception of the processing of
+    * the item
+    */
+    Out pop() {
+        std::unique_lock<std::mutex> lock{mutex};
+        changed.wait(lock, [this] {return !outputs.empty() || error;});
+        Out result;
+        popReady(lock, result);
+        return result;
+    }
+
+private:
+    bool popReady(std::unique_lock<std::mutex>& lock, Out& result) {
+        if (outputs.empty()) {
+            if (error) {
+                std::exception_ptr processError = error;
+                error = nullptr;
+                queued--;
+                lock.unlock();
+                std::rethrow_exception(processError);
+            }
+            return false;
+        }
+        result = std::move(outputs.front());
+        outputs.pop_front();
+        queued--;
+        return true;
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock{mutex};
+        while (true) {
+            // an item after a failed one waits until the error is popped, so the errors are popped in order
+            changed.wait(lock, [this] {return (!inputs.empty() && !error) || stopped;});
+            if (stopped) {
+                return;
+            }
+            In item = std::move(inputs.front());
+            inputs.pop_front();
+            lock.unlock();
+
+            std::exception_ptr processError;
+            Out result;
+            try {
+                result = process(item);
+            } catch (...) {
+                processError = std::current_exception();
+            }
+
+            lock.lock();
+            if (processError) {
+                error = processError;
+            } else {
+                outputs.push_back(std::move(result));
+            }
+            changed.notify_all();
+        }
+    }
+
+    std::function<Out(In&)> process;
+    std::size_t queued;  // the pushed items which aren't popped
+    bool stopped;
+    std::deque<In> inputs;
+    std::deque<Out> outputs;
+    std::exception_ptr error;  // of the item after the outputs
+    mutable std::mutex mutex;
+    std::condition_variable changed;
+    std::thread worker;
+};
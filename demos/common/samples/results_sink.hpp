@@ -0,0 +1,561 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+/**
+ * @brief a header file with a compact binary serialization of the demo results and its background writer
+ * @file results_sink.hpp
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include <samples/slog.hpp>
+
+/**
+* @brief The results of a frame. The layout of a serialized frame, in the host byte order, is:
+*   u32 size of the rest of the message, u32 channel, u64 frame id, i64 timestamp in us since the epoch,
+*   u32 objects count, u32 attributes count,
+*   the objects of 32 bytes: f32 x, y, width, height in the frame pixels, f32 confidence, i32 label,
+*   i64 track id, -1 if untracked,
+*   the attributes: u32 object index, u16 key length, u16 value length, the key and the value bytes.
+* A file or a socket stream starts with the 8 bytes of results::streamMagic
+*/
+namespace results {
+const char streamMagic[8] = {'O', 'M', 'Z', 'R', 'E', 'S', '0', '1'};
+
+struct Object {
+    float x, y, width, height;
+    float confidence;
+    int32_t label;
+    int64_t trackId;
+};
+
+struct Attribute {
+    uint32_t object;  // the index in Frame::objects
+    std::string key, value;
+};
+
+struct Frame {
+    uint32_t channel = 0;
+    uint64_t frameId = 0;
+    int64_t timestampUs = 0;
+    std::vector<Object> objects;
+    std::vector<Attribute> attributes;
+
+    void addObject(float x, float y, float width, float height, float confidence, int32_t label, int64_t trackId = -1) {
+        objects.push_back({x, y, width, height, confidence, label, trackId});
+    }
+
+    // the attribute of the last added object
+    void addAttribute(std::string key, std::string value) {
+        attributes.push_back({static_cast<uint32_t>(objects.size() - 1), std::move(key), std::move(value)});
+    }
+};
+
+inline int64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+template <typename T>
+void put(std::vector<uint8_t>& buffer, T value) {
+    const std::size_t size = buffer.size();
+    buffer.resize(size + sizeof(T));
+    std::memcpy(buffer.data() + size, &value, sizeof(T));
+}
+
+template <typename T>
+bool get(const uint8_t*& data, const uint8_t* end, T& value) {
+    if (static_cast<std::size_t>(end - data) < sizeof(T)) {
+        return false;
+    }
+    std::memcpy(&value, data, sizeof(T));
+    data += sizeof(T);
+    return true;
+}
+
+inline void serialize(const Frame& frame, std::vector<uint8_t>& buffer) {
+    std::size_t size = 4 + 4 + 8 + 8 + 4 + 4 + frame.objects.size() * 32;
+    for (const Attribute& attribute : frame.attributes) {
+        size += 8 + attribute.key.size() + attribute.value.size();
+    }
+    buffer.clear();
+    buffer.reserve(size);
+    put<uint32_t>(buffer, 0);  // the size is known once the strings are written
+    put<uint32_t>(buffer, frame.channel);
+    put<uint64_t>(buffer, frame.frameId);
+    put<int64_t>(buffer, frame.timestampUs);
+    put<uint32_t>(buffer, static_cast<uint32_t>(frame.objects.size()));
+    put<uint32_t>(buffer, static_cast<uint32_t>(frame.attributes.size()));
+    for (const Object& object : frame.objects) {
+        put(buffer, object.x);
+        put(buffer, object.y);
+        put(buffer, object.width);
+        put(buffer, object.height);
+        put(buffer, object.confidence);
+        put(buffer, object.label);
+        put(buffer, object.trackId);
+    }
+    for (const Attribute& attribute : frame.attributes) {
+        // the longer strings are truncated
+        const uint16_t keyLength = static_cast<uint16_t>(std::min<std::size_t>(attribute.key.size(), UINT16_MAX));
+        const uint16_t valueLength = static_cast<uint16_t>(std::min<std::size_t>(attribute.value.size(), UINT16_MAX));
+        put<uint32_t>(buffer, attribute.object);
+        put<uint16_t>(buffer, keyLength);
+        put<uint16_t>(buffer, valueLength);
+        buffer.insert(buffer.end(), attribute.key.begin(), attribute.key.begin() + keyLength);
+        buffer.insert(buffer.end(), attribute.value.begin(), attribute.value.begin() + valueLength);
+    }
+    const uint32_t written = static_cast<uint32_t>(buffer.size() - 4);
+    std::memcpy(buffer.data(), &written, sizeof(written));
+}
+
+/**
+* @brief Parses a serialized frame of the given size including its size field, returns false if it is malformed
+*/
+inline bool parse(const uint8_t* data, std::size_t size, Frame& frame) {
+    const uint8_t* end = data + size;
+    uint32_t messageSize, objectsCount, attributesCount;
+    if (!get(data, end, messageSize) || messageSize != size - 4 || !get(data, end, frame.channel)
+            || !get(data, end, frame.frameId) || !get(data, end, frame.timestampUs)
+            || !get(data, end, objectsCount) || !get(data, end, attributesCount)
+            || static_cast<std::size_t>(end - data) < static_cast<std::size_t>(objectsCount) * 32) {
+        return false;
+    }
+    frame.objects.resize(objectsCount);
+    for (Object& object : frame.objects) {
+        get(data, end, object.x);
+        get(data, end, object.y);
+        get(data, end, object.width);
+        get(data, end, object.height);
+        get(data, end, object.confidence);
+        get(data, end, object.label);
+        get(data, end, object.trackId);
+    }
+    frame.attributes.resize(attributesCount);
+    for (Attribute& attribute : frame.attributes) {
+        uint16_t keyLength, valueLength;
+        if (!get(data, end, attribute.object) || !get(data, end, keyLength) || !get(data, end, valueLength)
+                || static_cast<std::size_t>(end - data) < static_cast<std::size_t>(keyLength) + valueLength
+                || attribute.object >= objectsCount) {
+            return false;
+        }
+        attribute.key.assign(reinterpret_cast<const char*>(data), keyLength);
+        attribute.value.assign(reinterpret_cast<const char*>(data) + keyLength, valueLength);
+        data += keyLength + valueLength;
+    }
+    return data == end;
+}
+
+/**
+* @brief A destination of the serialized frames
+*/
+class Transport {
+public:
+    virtual ~Transport() = default;
+    virtual bool write(const uint8_t* data, std::size_t size) = 0;
+};
+
+class FileTransport : public Transport {
+public:
+    explicit FileTransport(const std::string& path) : file{path, std::ios::binary} {
+        if (!file.is_open()) {
+            throw std::runtime_error("Can't open the results file " + path);
+        }
+        file.write(streamMagic, sizeof(streamMagic));
+    }
+
+    bool write(const uint8_t* data, std::size_t size) override {
+        file.write(reinterpret_cast<const char*>(data), size);
+        return static_cast<bool>(file);
+    }
+
+private:
+    std::ofstream file;
+};
+
+#ifndef _WIN32
+/**
+* @brief A stream socket connected to "tcp:<host>:<port>" or to "unix:<path>"
+*/
+class SocketTransport : public Transport {
+public:
+    explicit SocketTransport(const std::string& target) : fd{-1} {
+        if (0 == target.compare(0, 5, "unix:")) {
+            sockaddr_un address{};
+            address.sun_family = AF_UNIX;
+            const std::string path = target.substr(5);
+            if (path.size() >= sizeof(address.sun_path)) {
+                throw std::runtime_error("Too long results socket path " + path);
+            }
+            std::strcpy(address.sun_path, path.c_str());
+            fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (fd < 0 || 0 != connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address))) {
+                close();
+                throw std::runtime_error("Can't connect to the results socket " + path);
+            }
+        } else {
+            const std::string::size_type colon = target.rfind(':');
+            if (colon <= 4 || std::string::npos == colon) {
+                throw std::runtime_error("The results target " + target + " isn't tcp:<host>:<port>");
+            }
+            const std::string host = target.substr(4, colon - 4), port = target.substr(colon + 1);
+            addrinfo hints{};
+            hints.ai_family = AF_UNSPEC;
+            hints.ai_socktype = SOCK_STREAM;
+            addrinfo* addresses = nullptr;
+            if (0 != getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses)) {
+                throw std::runtime_error("Can't resolve the results host " + host);
+            }
+            for (addrinfo* address = addresses; nullptr != address && fd < 0; address = address->ai_next) {
+                fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+                if (fd >= 0 && 0 != connect(fd, address->ai_addr, address->ai_addrlen)) {
+                    close();
+                }
+            }
+            freeaddrinfo(addresses);
+            if (fd < 0) {
+                throw std::runtime_error("Can't connect to the results consumer " + host + ':' + port);
+            }
+        }
+        write(reinterpret_cast<const uint8_t*>(streamMagic), sizeof(streamMagic));
+    }
+
+    ~SocketTransport() override {
+        close();
+    }
+
+    bool write(const uint8_t* data, std::size_t size) override {
+        while (size > 0) {
+            // MSG_NOSIGNAL, a disconnected consumer doesn't kill the demo by SIGPIPE
+            const ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+            if (sent <= 0) {
+                return false;
+            }
+            data += sent;
+            size -= static_cast<std::size_t>(sent);
+        }
+        return true;
+    }
+
+private:
+    void close() {
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+    int fd;
+};
+
+/**
+* @brief The header of a shared memory ring of the serialized frames, /dev/shm/<name> on Linux, the data of
+* capacity bytes follows it. The frames are 8 byte aligned and don't wrap around: a frame which doesn't fit
+* before the end of the data is preceded by the padding size ringPadding. The offsets are the total bytes
+* written, their remainders of capacity are the positions in the data. The data is a seqlock by reserved: it is
+* accessed by relaxed atomic words, the writer reserves the data it overwrites before writing it and a reader
+* drops its copy of a frame if the writer reserved the data of the frame meanwhile
+*/
+struct RingHeader {
+    char magic[8];
+    uint64_t capacity;
+    std::atomic<uint64_t> reserved;  // the end of the frame being written, the data before it is overwritten
+    std::atomic<uint64_t> written;  // the end of the last written frame
+    std::atomic<uint64_t> lastFrame;  // the start of the last written frame
+};
+const char ringMagic[8] = {'O', 'M', 'Z', 'R', 'I', 'N', 'G', '1'};
+const uint32_t ringPadding = UINT32_MAX;
+const std::size_t ringHeaderSize = 64;
+static_assert(sizeof(RingHeader) <= ringHeaderSize, "the data of the ring is aligned to a cache line");
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "the atomics of the ring are shared by processes, they must be lock free");
+
+inline const std::atomic<uint64_t>* ringWords(const uint8_t* mapped) {
+    return reinterpret_cast<const std::atomic<uint64_t>*>(mapped + ringHeaderSize);
+}
+
+inline std::atomic<uint64_t>* ringWords(uint8_t* mapped) {
+    return reinterpret_cast<std::atomic<uint64_t>*>(mapped + ringHeaderSize);
+}
+
+class ShmRingTransport : public Transport {
+public:
+    ShmRingTransport(const std::string& name, std::size_t capacity) :
+            path{"/" + name}, capacity{(std::max<std::size_t>(capacity, 4096) + 7) / 8 * 8}, mapped{nullptr} {
+        shm_unlink(path.c_str());  // a ring left by a crashed demo
+        const int fd = shm_open(path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0 || 0 != ftruncate(fd, static_cast<off_t>(ringHeaderSize + this->capacity))) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            throw std::runtime_error("Can't create the results ring " + name);
+        }
+        void* memory = mmap(nullptr, ringHeaderSize + this->capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (MAP_FAILED == memory) {
+            shm_unlink(path.c_str());
+            throw std::runtime_error("Can't map the results ring " + name);
+        }
+        mapped = static_cast<uint8_t*>(memory);
+        RingHeader* header = new (mapped) RingHeader;
+        for (std::size_t i = 0; i < this->capacity / 8; i++) {
+            new (ringWords(mapped) + i) std::atomic<uint64_t>(0);
+        }
+        header->capacity = this->capacity;
+        header->reserved = header->written = header->lastFrame = 0;
+        std::memcpy(header->magic, ringMagic, sizeof(ringMagic));  // the readers check the magic last
+    }
+
+    ~ShmRingTransport() override {
+        munmap(mapped, ringHeaderSize + capacity);
+        shm_unlink(path.c_str());
+    }
+
+    bool write(const uint8_t* data, std::size_t size) override {
+        const std::size_t alignedSize = (size + 7) / 8 * 8;
+        if (alignedSize > capacity / 2) {
+            return true;  // dropped, the readers would hardly catch it whole
+        }
+        RingHeader* header = reinterpret_cast<RingHeader*>(mapped);
+        std::atomic<uint64_t>* words = ringWords(mapped);
+        uint64_t start = header->written.load(std::memory_order_relaxed);
+        const std::size_t position = static_cast<std::size_t>(start % capacity);
+        if (position + alignedSize > capacity) {
+            header->reserved.store(start + capacity - position, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            uint64_t padding = 0;
+            std::memcpy(&padding, &ringPadding, sizeof(ringPadding));
+            words[position / 8].store(padding, std::memory_order_relaxed);
+            start += capacity - position;
+        }
+        // a reader which sees a word written after the fence sees the reservation too
+        header->reserved.store(start + alignedSize, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (std::size_t offset = 0; offset < size; offset += 8) {
+            uint64_t word = 0;
+            std::memcpy(&word, data + offset, std::min<std::size_t>(8, size - offset));
+            words[(start % capacity + offset) / 8].store(word, std::memory_order_relaxed);
+        }
+        header->lastFrame.store(start, std::memory_order_release);
+        header->written.store(start + alignedSize, std::memory_order_release);
+        return true;
+    }
+
+private:
+    const std::string path;
+    const std::size_t capacity;
+    uint8_t* mapped;
+};
+
+/**
+* @brief Reads the frames of a ShmRingTransport of another process. A reader which falls behind by more
+* than the capacity of the ring skips to the last written frame
+*/
+class RingReader {
+public:
+    explicit RingReader(const std::string& name) : mapped{nullptr}, size{0}, position{0} {
+        const int fd = shm_open(("/" + name).c_str(), O_RDONLY, 0);
+        struct stat sb;
+        if (fd < 0 || 0 != fstat(fd, &sb) || static_cast<std::size_t>(sb.st_size) < ringHeaderSize) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            throw std::runtime_error("Can't open the results ring " + name);
+        }
+        size = static_cast<std::size_t>(sb.st_size);
+        void* memory = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (MAP_FAILED == memory) {
+            throw std::runtime_error("Can't map the results ring " + name);
+        }
+        mapped = static_cast<const uint8_t*>(memory);
+        if (0 != std::memcmp(header()->magic, ringMagic, sizeof(ringMagic)) || header()->capacity + ringHeaderSize > size) {
+            munmap(const_cast<uint8_t*>(mapped), size);
+            throw std::runtime_error("The results ring " + name + " isn't ready");
+        }
+        position = header()->lastFrame.load(std::memory_order_acquire);
+    }
+
+    ~RingReader() {
+        munmap(const_cast<uint8_t*>(mapped), size);
+    }
+
+    RingReader(const RingReader&) = delete;
+    RingReader& operator=(const RingReader&) = delete;
+
+    /**
+    * @brief Reads the next frame if it is written already, returns false otherwise
+    */
+    bool read(Frame& frame) {
+        const uint64_t capacity = header()->capacity;
+        const std::atomic<uint64_t>* words = ringWords(mapped);
+        std::vector<uint64_t> message;
+        while (position < header()->written.load(std::memory_order_acquire)) {
+            if (header()->written.load(std::memory_order_acquire) - position > capacity) {
+                position = header()->lastFrame.load(std::memory_order_acquire);  // overrun
+                continue;
+            }
+            const std::size_t index = static_cast<std::size_t>(position % capacity / 8);
+            const uint64_t first = words[index].load(std::memory_order_relaxed);
+            uint32_t messageSize;
+            std::memcpy(&messageSize, &first, sizeof(messageSize));
+            const bool padding = ringPadding == messageSize;
+            const bool fits = !padding && position % capacity + 4 + messageSize <= capacity;
+            message.clear();
+            if (fits) {
+                message.resize((4 + messageSize + 7) / 8);
+                message[0] = first;
+                for (std::size_t i = 1; i < message.size(); i++) {
+                    message[i] = words[index + i].load(std::memory_order_relaxed);
+                }
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            // the copy is valid if the writer hasn't reserved the data of the frame to overwrite it meanwhile
+            if (header()->reserved.load(std::memory_order_relaxed) > position + capacity || (!padding && !fits)) {
+                position = header()->lastFrame.load(std::memory_order_acquire);
+                continue;
+            }
+            if (padding) {
+                position += capacity - position % capacity;
+                continue;
+            }
+            position += message.size() * 8;
+            if (parse(reinterpret_cast<const uint8_t*>(message.data()), 4 + messageSize, frame)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    const RingHeader* header() const {
+        return reinterpret_cast<const RingHeader*>(mapped);
+    }
+
+    const uint8_t* mapped;
+    std::size_t size;
+    uint64_t position;
+};
+#endif
+}  // namespace results
+
+/**
+* @brief Serializes the results of the frames by results::serialize() and writes them in a background thread to
+* a target: "shm:<name>" for a shared memory ring read by results::RingReader, "tcp:<host>:<port>" or
+* "unix:<path>" for a stream socket, a path of a file otherwise. The queue of the frames is bounded and a
+* frame which doesn't fit is dropped, so a slow consumer doesn't slow down the demo
+*/
+class ResultsSink {
+public:
+    explicit ResultsSink(const std::string& target, std::size_t queueSize = 64, std::size_t ringCapacity = 4 << 20) :
+            queueSize{std::max<std::size_t>(1, queueSize)}, droppedFrames{0}, stopped{false} {
+#ifndef _WIN32
+        if (0 == target.compare(0, 4, "shm:")) {
+            transport.reset(new results::ShmRingTransport(target.substr(4), ringCapacity));
+        } else if (0 == target.compare(0, 4, "tcp:") || 0 == target.compare(0, 5, "unix:")) {
+            transport.reset(new results::SocketTransport(target));
+        }
+#endif
+        if (!transport) {
+            transport.reset(new results::FileTransport(target));
+        }
+        thread = std::thread(&ResultsSink::writeFrames, this);
+    }
+
+    ResultsSink(const ResultsSink&) = delete;
+    ResultsSink& operator=(const ResultsSink&) = delete;
+
+    /**
+    * @brief Writes the queued frames and stops the thread
+    */
+    ~ResultsSink() {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            stopped = true;
+        }
+        changed.notify_all();
+        thread.join();
+        if (0 != droppedFrames) {
+            slog::warn << "The results of " << droppedFrames << " frames are dropped" << slog::endl;
+        }
+    }
+
+    /**
+    * @brief Queues the results of a frame, thread safe
+    */
+    void push(const results::Frame& frame) {
+        std::vector<uint8_t> buffer;
+        results::serialize(frame, buffer);
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            if (queue.size() >= queueSize) {
+                ++droppedFrames;
+                return;
+            }
+            queue.push_back(std::move(buffer));
+        }
+        changed.notify_one();
+    }
+
+private:
+    void writeFrames() {
+        bool failed = false;
+        std::unique_lock<std::mutex> lock{mutex};
+        while (true) {
+            changed.wait(lock, [this]{return stopped || !queue.empty();});
+            if (queue.empty()) {
+                return;
+            }
+            std::vector<uint8_t> buffer = std::move(queue.front());
+            queue.pop_front();
+            lock.unlock();
+            const bool written = failed || transport->write(buffer.data(), buffer.size());
+            lock.lock();
+            if (!written) {
+                slog::warn << "Can't write the results, the following ones are dropped" << slog::endl;
+                failed = true;
+            }
+            if (failed) {
+                ++droppedFrames;
+            }
+        }
+    }
+
+    const std::size_t queueSize;
+    std::unique_ptr<results::Transport> transport;
+    std::deque<std::vector<uint8_t>> queue;
+    std::size_t droppedFrames;
+    bool stopped;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::thread thread;
+};
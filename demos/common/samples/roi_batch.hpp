@@ -0,0 +1,72 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+/**
+ * @brief a header file with the filling of the batched inputs of the cascade demos by the regions of a frame
+ * @file roi_batch.hpp
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <inference_engine.hpp>
+
+#include <samples/ocv_common.hpp>
+
+/**
+* @brief Fills the input of the requests of a cascade stage with the regions of interest, e.g. the faces or the
+* vehicles found by the previous stage. The regions are split into the batches of up to maxBatch regions, the batch
+* b goes to the request passed to fill() for it, so the caller can keep several batches in flight. The regions of a
+* batch are resized into the blob in parallel. With dynamicBatch the inference of a batch is limited to its regions
+* by SetBatch()
+*/
+class RoiBatchBuilder {
+public:
+    RoiBatchBuilder(std::string inputName, std::size_t maxBatch, bool dynamicBatch):
+            inputName{std::move(inputName)}, maxBatch{std::max<std::size_t>(1, maxBatch)}, dynamicBatch{dynamicBatch} {}
+
+    std::size_t batchesNum(std::size_t roisNum) const {
+        return (roisNum + maxBatch - 1) / maxBatch;
+    }
+
+    std::size_t batchSize(std::size_t roisNum, std::size_t batch) const {
+        return std::min(maxBatch, roisNum - batch * maxBatch);
+    }
+
+    /**
+    * @brief Fills the request with the batch of the images, which are usually the views of the regions of a frame.
+    * Returns the number of the images in the batch
+    */
+    std::size_t fill(InferenceEngine::InferRequest& request, const std::vector<cv::Mat>& images,
+                     std::size_t batch) const {
+        const std::size_t size = batchSize(images.size(), batch);
+        const std::size_t begin = batch * maxBatch;
+        InferenceEngine::Blob::Ptr input = request.GetBlob(inputName);
+        auto fillRange = [&](const cv::Range& range) {
+            for (int i = range.start; i < range.end; i++) {
+                matU8ToBlob<uint8_t>(images[begin + i], input, i);
+            }
+        };
+        if (size > 1) {
+            cv::parallel_for_(cv::Range(0, static_cast<int>(size)), fillRange);
+        } else {
+            fillRange(cv::Range(0, static_cast<int>(size)));
+        }
+        if (dynamicBatch) {
+            request.SetBatch(static_cast<int>(size));
+        }
+        return size;
+    }
+
+private:
+    const std::string inputName;
+    const std::size_t maxBatch;
+    const bool dynamicBatch;
+};
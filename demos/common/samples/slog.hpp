@@ -9,7 +9,23 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <streambuf>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 namespace slog {
 
@@ -31,6 +47,247 @@ class LogStreamBoolAlpha { };
 static constexpr LogStreamBoolAlpha boolalpha;
 
 
+/**
+ * @class AsyncSink
+ * @brief The AsyncSink class writes log records from a background thread. Logging threads only put their records
+ * to a bounded lock-free queue, the records which don't fit into it are dropped and counted
+ */
+class AsyncSink {
+public:
+    enum class Format {
+        TEXT,  // "[ LEVEL ] message" lines like the synchronous log
+        JSON_LINES  // a {"time":seconds since the epoch,"level":"LEVEL","message":"message"} object per line
+    };
+
+    /**
+     * @brief A constructor. Starts the thread writing to the stream
+     * @param capacity The number of records the queue keeps, rounded up to a power of 2, 2 at least
+     */
+    explicit AsyncSink(std::ostream& out, Format format = Format::TEXT, std::size_t capacity = 1 << 14)
+            : _out(&out), _format(format) {
+        start(capacity);
+    }
+
+    /**
+     * @brief A constructor. Creates the file and starts the thread writing to it
+     */
+    explicit AsyncSink(const std::string& path, Format format = Format::JSON_LINES, std::size_t capacity = 1 << 14)
+            : _file(path), _out(&_file), _format(format) {
+        if (!_file.is_open()) {
+            throw std::runtime_error("Can't open the log file " + path);
+        }
+        start(capacity);
+    }
+
+    AsyncSink(const AsyncSink&) = delete;
+    AsyncSink& operator=(const AsyncSink&) = delete;
+
+    ~AsyncSink() {
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+            _stopped = true;
+        }
+        _wakeUp.notify_one();
+        _writer.join();
+    }
+
+    /**
+     * @brief Puts a record to the queue without locking, returns false if the queue is full and the record is dropped
+     * @param level The level of the record, a string literal
+     */
+    bool push(const char* level, std::string message) {
+        std::size_t position = _enqueuePosition.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &_cells[position & _mask];
+            const std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+            if (0 == difference) {
+                if (_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (difference < 0) {
+                _dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            } else {
+                position = _enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+        cell->level = level;
+        cell->time = std::chrono::system_clock::now();
+        cell->message = std::move(message);
+        cell->sequence.store(position + 1, std::memory_order_release);
+        if (0 == (position & (_mask >> 2))) {
+            _wakeUp.notify_one();  // every quarter of the queue, the writer doesn't wait for its poll period
+        }
+        return true;
+    }
+
+    /**
+     * @brief Waits until the records pushed before the call are written and flushed
+     */
+    void flush() {
+        const std::size_t position = _enqueuePosition.load(std::memory_order_acquire);
+        std::unique_lock<std::mutex> lock{_mutex};
+        _flushRequested = true;
+        _wakeUp.notify_one();
+        _flushed.wait(lock, [&] {return _flushedPosition >= position;});
+    }
+
+    uint64_t getDropped() const {
+        return _dropped.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Cell {
+        std::atomic<std::size_t> sequence;
+        const char* level;
+        std::chrono::system_clock::time_point time;
+        std::string message;
+    };
+
+    void start(std::size_t capacity) {
+        // a queue of a single cell can't tell full from empty
+        std::size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        _cells = std::unique_ptr<Cell[]>(new Cell[size]);
+        for (std::size_t i = 0; i < size; i++) {
+            _cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        _mask = size - 1;
+        _enqueuePosition.store(0, std::memory_order_relaxed);
+        _dequeuePosition = 0;
+        _flushedPosition = 0;
+        _dropped.store(0, std::memory_order_relaxed);
+        _stopped = false;
+        _flushRequested = false;
+        _writer = std::thread(&AsyncSink::write, this);
+    }
+
+    void write() {
+        std::unique_lock<std::mutex> lock{_mutex};
+        while (true) {
+            lock.unlock();
+            bool written = false;
+            while (true) {
+                Cell& cell = _cells[_dequeuePosition & _mask];
+                if (cell.sequence.load(std::memory_order_acquire) != _dequeuePosition + 1) {
+                    break;
+                }
+                writeRecord(cell);
+                cell.message.clear();
+                cell.sequence.store(_dequeuePosition + _mask + 1, std::memory_order_release);
+                _dequeuePosition++;
+                written = true;
+            }
+            if (written) {
+                _out->flush();
+            }
+            lock.lock();
+            _flushedPosition = _dequeuePosition;
+            _flushed.notify_all();
+            if (_stopped && _dequeuePosition == _enqueuePosition.load(std::memory_order_acquire)) {
+                return;
+            }
+            // logging threads signal only every quarter of the queue, it is polled in between
+            _wakeUp.wait_for(lock, std::chrono::milliseconds(20), [this] {return _stopped || _flushRequested;});
+            _flushRequested = false;
+        }
+    }
+
+    void writeRecord(const Cell& cell) {
+        if (Format::TEXT == _format) {
+            if (nullptr == cell.level) {
+                (*_out) << cell.message << '\n';
+            } else {
+                (*_out) << "[ " << cell.level << " ] " << cell.message << '\n';
+            }
+            return;
+        }
+        const auto sinceEpoch = std::chrono::duration_cast<std::chrono::microseconds>(cell.time.time_since_epoch());
+        (*_out) << "{\"time\":" << sinceEpoch.count() / 1000000 << '.' << std::setw(6) << std::setfill('0')
+            << sinceEpoch.count() % 1000000 << std::setfill(' ') << ",\"level\":\""
+            << (nullptr == cell.level ? "RAW" : cell.level) << "\",\"message\":\"";
+        for (char c : cell.message) {
+            if ('"' == c || '\\' == c) {
+                (*_out) << '\\' << c;
+            } else if ('\n' == c) {
+                (*_out) << "\\n";
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                (*_out) << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c)
+                    << std::dec << std::setfill(' ');
+            } else {
+                (*_out) << c;
+            }
+        }
+        (*_out) << "\"}\n";
+    }
+
+    std::ofstream _file;
+    std::ostream* _out;
+    const Format _format;
+    std::unique_ptr<Cell[]> _cells;
+    std::size_t _mask;
+    std::atomic<std::size_t> _enqueuePosition;
+    std::size_t _dequeuePosition;  // used by the writer thread only
+    std::size_t _flushedPosition;
+    std::atomic<uint64_t> _dropped;
+    bool _stopped;
+    bool _flushRequested;
+    std::mutex _mutex;
+    std::condition_variable _wakeUp;
+    std::condition_variable _flushed;
+    std::thread _writer;
+};
+
+namespace details {
+enum Level {INFO_LEVEL, WARNING_LEVEL, ERROR_LEVEL, DEBUG_LEVEL, LEVELS_NUM};
+
+inline std::atomic<bool>* enabledLevels() {
+    static std::atomic<bool> enabled[LEVELS_NUM] = {{true}, {true}, {true}, {false}};
+    return enabled;
+}
+
+inline std::unique_ptr<AsyncSink>& sinkOwner() {
+    static std::unique_ptr<AsyncSink> owner;
+    return owner;
+}
+
+inline std::atomic<AsyncSink*>& activeSink() {
+    static std::atomic<AsyncSink*> sink{nullptr};
+    return sink;
+}
+
+// the line a thread is logging to a level while the async sink is active
+inline std::ostringstream& lineBuffer(int level) {
+    thread_local std::ostringstream lines[LEVELS_NUM];
+    return lines[level];
+}
+}  // namespace details
+
+/**
+ * @brief Makes the log streams put their records to the sink instead of writing them synchronously.
+ * Errors are still written synchronously after the records logged before them
+ */
+inline void startAsyncLogging(std::unique_ptr<AsyncSink> sink) {
+    details::activeSink().store(sink.get(), std::memory_order_release);
+    details::sinkOwner() = std::move(sink);
+}
+
+/**
+ * @brief Writes the queued records and returns to synchronous logging, must not race with logging threads
+ */
+inline void stopAsyncLogging() {
+    details::activeSink().store(nullptr, std::memory_order_release);
+    details::sinkOwner().reset();
+}
+
+inline AsyncSink* asyncSink() {
+    return details::activeSink().load(std::memory_order_acquire);
+}
+
 /**
  * @class LogStream
  * @brief The LogStream class implements a stream for sample logging
@@ -39,24 +296,46 @@ class LogStream {
     std::string _prefix;
     std::ostream* _log_stream;
     bool _new_line;
+    int _level;
 
 public:
     /**
      * @brief A constructor. Creates a LogStream object
      * @param prefix The prefix to print
      */
-    LogStream(const std::string &prefix, std::ostream& log_stream)
-            : _prefix(prefix), _new_line(true) {
+    LogStream(const std::string &prefix, std::ostream& log_stream, int level = details::INFO_LEVEL)
+            : _prefix(prefix), _new_line(true), _level(level) {
         _log_stream = &log_stream;
     }
 
+    bool isEnabled() const {
+        return details::enabledLevels()[_level].load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Enables or disables the level of the stream in all translation units
+     */
+    void setEnabled(bool enabled) {
+        details::enabledLevels()[_level].store(enabled, std::memory_order_relaxed);
+    }
+
     /**
      * @brief A stream output operator to be used within the logger
      * @param arg Object for serialization in the logger message
      */
     template<class T>
     LogStream &operator<<(const T &arg) {
+        if (!isEnabled()) {
+            return *this;
+        }
+        if (details::ERROR_LEVEL != _level && nullptr != asyncSink()) {
+            details::lineBuffer(_level) << arg;
+            return *this;
+        }
         if (_new_line) {
+            if (AsyncSink* sink = asyncSink()) {
+                sink->flush();
+            }
             (*_log_stream) << "[ " << _prefix << " ] ";
             _new_line = false;
         }
@@ -67,6 +346,16 @@ public:
 
     // Specializing for LogStreamEndLine to support slog::endl
     LogStream& operator<< (const LogStreamEndLine &/*arg*/) {
+        if (!isEnabled()) {
+            return *this;
+        }
+        AsyncSink* sink = asyncSink();
+        if (details::ERROR_LEVEL != _level && nullptr != sink) {
+            std::ostringstream& line = details::lineBuffer(_level);
+            sink->push(levelName(), line.str());
+            line.str("");
+            return *this;
+        }
         _new_line = true;
 
         (*_log_stream) << std::endl;
@@ -75,14 +364,82 @@ public:
 
     // Specializing for LogStreamBoolAlpha to support slog::boolalpha
     LogStream& operator<< (const LogStreamBoolAlpha &/*arg*/) {
+        if (details::ERROR_LEVEL != _level && nullptr != asyncSink()) {
+            details::lineBuffer(_level) << std::boolalpha;
+            return *this;
+        }
         (*_log_stream) << std::boolalpha;
         return *this;
     }
+
+private:
+    const char* levelName() const {
+        static const char* const names[details::LEVELS_NUM] = {"INFO", "WARNING", "ERROR", "DEBUG"};
+        return names[_level];
+    }
 };
 
+/**
+ * @class AsyncLineStream
+ * @brief The AsyncLineStream class is an std::ostream for raw output, e.g. of detections, which puts every line
+ * to the async sink without a level prefix, or writes it to the fallback stream if async logging isn't started
+ */
+class AsyncLineStream : public std::ostream {
+    class LineBuffer : public std::streambuf {
+        std::string _line;
+        std::ostream& _fallback;
+
+    public:
+        explicit LineBuffer(std::ostream& fallback) : _fallback(fallback) {}
+
+    protected:
+        int_type overflow(int_type c) override {
+            if (traits_type::eq_int_type(c, traits_type::eof())) {
+                return traits_type::not_eof(c);
+            }
+            if ('\n' == traits_type::to_char_type(c)) {
+                pushLine();
+            } else {
+                _line.push_back(traits_type::to_char_type(c));
+            }
+            return c;
+        }
+
+        int sync() override {
+            if (nullptr == asyncSink()) {
+                _fallback.flush();
+            }
+            return 0;
+        }
+
+    private:
+        void pushLine() {
+            if (AsyncSink* sink = asyncSink()) {
+                sink->push(nullptr, std::move(_line));
+            } else {
+                _fallback << _line << '\n';
+            }
+            _line.clear();
+        }
+    };
+
+    LineBuffer _buffer;
+
+public:
+    explicit AsyncLineStream(std::ostream& fallback) : std::ostream(nullptr), _buffer(fallback) {
+        rdbuf(&_buffer);
+    }
+};
+
+/**
+ * @brief Skips evaluating the arguments if the level of the stream is disabled:
+ * SLOG_IF_ENABLED(slog::debug) << expensiveDescription() << slog::endl;
+ */
+#define SLOG_IF_ENABLED(stream) if (!(stream).isEnabled()) {} else (stream)
 
-static LogStream info("INFO", std::cout);
-static LogStream warn("WARNING", std::cout);
-static LogStream err("ERROR", std::cerr);
+static LogStream info("INFO", std::cout, details::INFO_LEVEL);
+static LogStream warn("WARNING", std::cout, details::WARNING_LEVEL);
+static LogStream err("ERROR", std::cerr, details::ERROR_LEVEL);
+static LogStream debug("DEBUG", std::cout, details::DEBUG_LEVEL);
 
 }  // namespace slog
@@ -0,0 +1,102 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+/**
+ * @brief a header file with a generator of synthetic crowds for tracker benchmarks
+ * @file synthetic_crowd.hpp
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+/**
+* @brief Random walkers drawn as filled rectangles. The walkers whose feet are lower are nearer and occlude
+* the others, a walker is missed by the detections with the given probability. The id of a walker is encoded
+* in the color of its rectangle, so a stub descriptor may return precomputed values for it
+*/
+class SyntheticCrowd {
+public:
+    SyntheticCrowd(int walkersNumber, cv::Size frameSize, float missProbability = 0.1f, float maxSpeed = 4.0f,
+                   uint64_t seed = 0)
+            : frameSize(frameSize), missProbability(missProbability), maxSpeed(maxSpeed), rng(seed) {
+        for (int i = 0; i < walkersNumber; i++) {
+            Walker walker;
+            const int width = rng.uniform(20, 50);
+            walker.size = cv::Size(width, static_cast<int>(width * rng.uniform(2.0f, 3.0f)));
+            walker.position = cv::Point2f(rng.uniform(0.0f, static_cast<float>(frameSize.width - walker.size.width)),
+                rng.uniform(0.0f, static_cast<float>(frameSize.height - walker.size.height)));
+            walker.velocity = cv::Point2f(rng.uniform(-maxSpeed, maxSpeed), rng.uniform(-maxSpeed, maxSpeed));
+            walkers.push_back(walker);
+        }
+    }
+
+    /** @brief 0 is the background, the walkers are numbered from 1 */
+    static int walkerId(const cv::Vec3b& color) {
+        return 255 == color[2] ? color[0] + (color[1] << 8) : 0;
+    }
+
+    int size() const {
+        return static_cast<int>(walkers.size());
+    }
+
+    /** @brief Moves the walkers, draws them to the frame and returns the detected ones */
+    std::vector<cv::Rect> step(cv::Mat& frame) {
+        for (Walker& walker : walkers) {
+            walker.velocity += cv::Point2f(rng.uniform(-0.5f, 0.5f), rng.uniform(-0.5f, 0.5f));
+            walker.velocity.x = std::max(-maxSpeed, std::min(maxSpeed, walker.velocity.x));
+            walker.velocity.y = std::max(-maxSpeed, std::min(maxSpeed, walker.velocity.y));
+            walker.position += walker.velocity;
+            // the walkers bounce off the frame borders
+            if (walker.position.x < 0 || walker.position.x + walker.size.width > frameSize.width) {
+                walker.velocity.x = -walker.velocity.x;
+                walker.position.x += 2 * walker.velocity.x;
+            }
+            if (walker.position.y < 0 || walker.position.y + walker.size.height > frameSize.height) {
+                walker.velocity.y = -walker.velocity.y;
+                walker.position.y += 2 * walker.velocity.y;
+            }
+        }
+
+        std::vector<std::size_t> order(walkers.size());
+        for (std::size_t i = 0; i < order.size(); i++) {
+            order[i] = i;
+        }
+        std::sort(order.begin(), order.end(), [this](std::size_t a, std::size_t b) {
+            return walkers[a].position.y + walkers[a].size.height < walkers[b].position.y + walkers[b].size.height;
+        });
+
+        frame.create(frameSize, CV_8UC3);
+        frame.setTo(cv::Scalar::all(0));
+        std::vector<cv::Rect> detections;
+        for (std::size_t i : order) {
+            const cv::Rect rect = cv::Rect(cv::Point(walkers[i].position), walkers[i].size)
+                & cv::Rect(cv::Point(), frameSize);
+            const int id = static_cast<int>(i) + 1;
+            cv::rectangle(frame, rect, cv::Scalar(id & 0xFF, (id >> 8) & 0xFF, 255), cv::FILLED);
+            if (rng.uniform(0.0f, 1.0f) >= missProbability) {
+                detections.push_back(rect);
+            }
+        }
+        return detections;
+    }
+
+private:
+    struct Walker {
+        cv::Point2f position;
+        cv::Point2f velocity;
+        cv::Size size;
+    };
+
+    const cv::Size frameSize;
+    const float missProbability;
+    const float maxSpeed;
+    cv::RNG rng;
+    std::vector<Walker> walkers;
+};
@@ -0,0 +1,91 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+/**
+ * @brief a header file with the partition of the CPU threads between the inference, OpenCV and the pipeline
+ * threads of a demo
+ * @file thread_policy.hpp
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include <samples/cpu_plan.hpp>
+#include <samples/slog.hpp>
+
+/**
+* @brief Splits the hardware threads between the three thread pools of a demo, so they don't oversubscribe the
+* cores: the CPU plugin streams, the cv::parallel_for_ pool of OpenCV (resizes, pose peaks, blob filling) and
+* the threads of the pipeline itself (decoding, postprocessing). The caller passes inference() to the
+* CPU_THREADS_NUM of the networks and pipeline() to its pools, apply() sets the OpenCV share. Configure it once,
+* before the pools start, every share is at least one thread. The weights are parsed and split as the ones of
+* CpuPlan
+*/
+class ThreadPolicy {
+public:
+    enum Share {
+        Inference,
+        OpenCV,
+        Pipeline,
+        SharesNumber
+    };
+
+    /**
+    * @param shares comma separated weights of the inference, OpenCV and the pipeline, e.g. "2,1,1"
+    * @param totalThreads threads to split, 0 - std::thread::hardware_concurrency()
+    */
+    explicit ThreadPolicy(const std::string& shares, unsigned totalThreads = 0):
+        totalThreads{0 == totalThreads ? std::max(1u, std::thread::hardware_concurrency()) : totalThreads} {
+        const std::vector<float> weights = CpuPlan::parseWeights(shares);
+        if (SharesNumber != weights.size()) {
+            throw std::invalid_argument("Expected three thread shares: " + shares);
+        }
+        const std::vector<unsigned> split = CpuPlan::splitThreads(weights, this->totalThreads);
+        std::copy(split.begin(), split.end(), threads.begin());
+    }
+
+    unsigned total() const {
+        return totalThreads;
+    }
+
+    unsigned inference() const {
+        return threads[Inference];
+    }
+
+    unsigned opencv() const {
+        return threads[OpenCV];
+    }
+
+    unsigned pipeline() const {
+        return threads[Pipeline];
+    }
+
+    /**
+    * @brief Limits the OpenCV pool to its share. A share of one thread runs cv::parallel_for_ on the calling
+    * thread
+    */
+    void apply() const {
+        cv::setNumThreads(static_cast<int>(opencv()));
+    }
+
+    void report() const {
+        slog::info << "Thread policy: " << totalThreads << " threads - inference " << inference() << ", OpenCV "
+                   << opencv() << ", pipeline " << pipeline() << slog::endl;
+        if (inference() + opencv() + pipeline() > totalThreads) {
+            slog::warn << "Thread policy: the shares oversubscribe " << totalThreads << " threads" << slog::endl;
+        }
+    }
+
+private:
+    const unsigned totalThreads;
+    std::array<unsigned, SharesNumber> threads;
+};
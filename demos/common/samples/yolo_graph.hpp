@@ -0,0 +1,196 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+/**
+ * @brief a header file with the decoding and the NMS of the RegionYolo outputs appended to the YOLO V3 networks
+ * @file yolo_graph.hpp
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <inference_engine.hpp>
+#include <ngraph/ngraph.hpp>
+#include <ngraph/opsets/opset3.hpp>
+
+namespace yolo_graph {
+inline std::shared_ptr<ngraph::Node> constant(const std::vector<float>& values, const ngraph::Shape& shape) {
+    return ngraph::opset3::Constant::create(ngraph::element::f32, shape, values);
+}
+
+inline std::shared_ptr<ngraph::Node> indices(const std::vector<int32_t>& values, const ngraph::Shape& shape) {
+    return ngraph::opset3::Constant::create(ngraph::element::i32, shape, values);
+}
+
+inline std::shared_ptr<ngraph::Node> axes(const std::vector<int64_t>& values) {
+    return ngraph::opset3::Constant::create(ngraph::element::i64, ngraph::Shape{values.size()}, values);
+}
+
+inline std::shared_ptr<ngraph::Node> reshape(const ngraph::Output<ngraph::Node>& data, const std::vector<int64_t>& dims) {
+    return std::make_shared<ngraph::opset3::Reshape>(data, axes(dims), false);
+}
+
+/**
+* @brief The decoded boxes and the scores of the classes of a RegionYolo output of batch 1
+*/
+struct Region {
+    std::shared_ptr<ngraph::Node> boxes;  // cells x 4 of xmin, ymin, xmax, ymax relative to the input
+    std::shared_ptr<ngraph::Node> scores;  // classes x cells, the objectness times the class probability
+    std::size_t cells;
+    std::size_t classes;
+};
+
+/**
+* @brief Decodes the boxes the same way as decodeYoloRegion() of yolo_region.hpp
+*/
+inline Region decodeRegion(const std::shared_ptr<ngraph::op::RegionYolo>& regionYolo, std::size_t inputHeight,
+                           std::size_t inputWidth) {
+    if (regionYolo->get_do_softmax() || 4 != regionYolo->get_num_coords()) {
+        throw std::runtime_error("Only the YOLO V3 RegionYolo outputs with 4 coordinates can be decoded by the device");
+    }
+    const ngraph::Shape shape = regionYolo->get_output_shape(0);
+    if (shape.size() != 4 || shape[0] != 1) {
+        throw std::runtime_error("The device decodes only 4D RegionYolo outputs of batch 1");
+    }
+    const std::size_t height = shape[2], width = shape[3], cells = height * width;
+    const std::size_t classes = static_cast<std::size_t>(regionYolo->get_num_classes());
+    const std::vector<float> anchors = regionYolo->get_anchors();
+    std::vector<int64_t> mask = regionYolo->get_mask();
+    if (mask.empty()) {
+        for (int64_t n = 0; n < regionYolo->get_num_regions(); n++) {
+            mask.push_back(n);
+        }
+    }
+    const std::size_t num = mask.size();
+    if (shape[1] != num * (classes + 5)) {
+        throw std::runtime_error("Unexpected channels of RegionYolo output " + regionYolo->get_friendly_name());
+    }
+    std::vector<float> maskedAnchors;  // num x 2 x 1 of the widths and the heights in the input pixels
+    for (int64_t n : mask) {
+        maskedAnchors.push_back(anchors.at(2 * n));
+        maskedAnchors.push_back(anchors.at(2 * n + 1));
+    }
+    std::vector<float> grid(2 * cells);  // 1 x 2 x cells of the columns and the rows of the cells
+    for (std::size_t i = 0; i < cells; i++) {
+        grid[i] = static_cast<float>(i % width);
+        grid[cells + i] = static_cast<float>(i / width);
+    }
+
+    const auto parts = std::make_shared<ngraph::opset3::VariadicSplit>(
+        reshape(regionYolo, {static_cast<int64_t>(num), static_cast<int64_t>(classes + 5), static_cast<int64_t>(cells)}),
+        ngraph::opset3::Constant::create(ngraph::element::i64, ngraph::Shape{}, {1}),
+        axes({2, 2, 1, static_cast<int64_t>(classes)}));
+    const auto centers = std::make_shared<ngraph::opset3::Divide>(
+        std::make_shared<ngraph::opset3::Add>(parts->output(0), constant(grid, {1, 2, cells})),
+        constant({static_cast<float>(width), static_cast<float>(height)}, {1, 2, 1}));
+    const auto sizes = std::make_shared<ngraph::opset3::Multiply>(
+        std::make_shared<ngraph::opset3::Exp>(parts->output(1)),
+        constant(maskedAnchors, {num, 2, 1}));
+    const auto halfSizes = std::make_shared<ngraph::opset3::Divide>(sizes,
+        constant({2.0f * inputWidth, 2.0f * inputHeight}, {1, 2, 1}));
+    const auto corners = std::make_shared<ngraph::opset3::Concat>(ngraph::OutputVector{
+        std::make_shared<ngraph::opset3::Subtract>(centers, halfSizes),
+        std::make_shared<ngraph::opset3::Add>(centers, halfSizes)}, 1);
+    const auto scores = std::make_shared<ngraph::opset3::Multiply>(parts->output(2), parts->output(3));
+
+    Region region;
+    region.boxes = reshape(std::make_shared<ngraph::opset3::Transpose>(corners, axes({0, 2, 1})),
+                           {static_cast<int64_t>(num * cells), 4});
+    region.scores = reshape(std::make_shared<ngraph::opset3::Transpose>(scores, axes({1, 0, 2})),
+                            {static_cast<int64_t>(classes), static_cast<int64_t>(num * cells)});
+    region.cells = num * cells;
+    region.classes = classes;
+    return region;
+}
+}  // namespace yolo_graph
+
+/**
+* @brief Replaces the RegionYolo outputs of a YOLO V3 network of batch 1 by the decoding of the boxes and the
+* per class NMS, so the device returns only the detections instead of the raw regions of all the scales. The
+* single output is maxDetections x 6 of the label, the score and xmin, ymin, xmax, ymax relative to the input,
+* sorted by the score. The rows after the detections have the label -1. The thresholds are in the name of the
+* output, so the compiled network cache tells apart the networks of different thresholds
+*/
+inline InferenceEngine::CNNNetwork appendYoloDetectionOutput(InferenceEngine::CNNNetwork network, float threshold,
+                                                             float iouThreshold, std::size_t maxDetections = 100) {
+    const std::shared_ptr<ngraph::Function> function = network.getFunction();
+    if (!function) {
+        throw std::runtime_error("Can't get ngraph::Function. Make sure the provided model is in IR version 10 or greater.");
+    }
+    const ngraph::Shape inputShape = function->get_parameters().front()->get_shape();
+    if (inputShape.size() != 4) {
+        throw std::runtime_error("The device decodes the boxes only for the networks with an NCHW input");
+    }
+
+    ngraph::OutputVector regionBoxes, regionScores;
+    std::size_t cells = 0, classes = 0;
+    for (const auto& result : function->get_results()) {
+        const std::shared_ptr<ngraph::Node> output = result->input_value(0).get_node_shared_ptr();
+        const auto regionYolo = std::dynamic_pointer_cast<ngraph::op::RegionYolo>(output);
+        if (!regionYolo) {
+            throw std::runtime_error("Invalid output type: " + std::string(output->get_type_info().name) +
+                ". RegionYolo expected");
+        }
+        const yolo_graph::Region region = yolo_graph::decodeRegion(regionYolo, inputShape[2], inputShape[3]);
+        if (0 != classes && region.classes != classes) {
+            throw std::runtime_error("The RegionYolo outputs have different numbers of classes");
+        }
+        regionBoxes.push_back(region.boxes);
+        regionScores.push_back(region.scores);
+        cells += region.cells;
+        classes = region.classes;
+    }
+    if (regionBoxes.empty()) {
+        throw std::runtime_error("The network has no RegionYolo outputs");
+    }
+    const int64_t allCells = static_cast<int64_t>(cells);
+    const auto boxes = std::make_shared<ngraph::opset3::Concat>(regionBoxes, 0);  // cells x 4
+    const auto scores = std::make_shared<ngraph::opset3::Concat>(regionScores, 1);  // classes x cells
+
+    // the selected indices are padded by -1 up to min(cells, maxDetections) rows for every class
+    const auto nms = std::make_shared<ngraph::opset3::NonMaxSuppression>(
+        yolo_graph::reshape(boxes, {1, allCells, 4}), yolo_graph::reshape(scores, {1, static_cast<int64_t>(classes), allCells}),
+        ngraph::opset3::Constant::create(ngraph::element::i64, ngraph::Shape{}, {static_cast<int64_t>(maxDetections)}),
+        yolo_graph::constant({iouThreshold}, {}), yolo_graph::constant({threshold}, {}),
+        ngraph::opset3::NonMaxSuppression::BoxEncodingType::CORNER, false, ngraph::element::i32);
+    const std::size_t selected = std::min(cells, maxDetections) * classes;
+    const auto columns = std::make_shared<ngraph::opset3::VariadicSplit>(nms->output(0),
+        ngraph::opset3::Constant::create(ngraph::element::i64, ngraph::Shape{}, {1}), yolo_graph::axes({1, 1, 1}));
+    const auto labels = yolo_graph::reshape(columns->output(1), {-1});
+    const auto zero = yolo_graph::indices({0}, {});
+    const auto labelIds = std::make_shared<ngraph::opset3::Maximum>(labels, zero);
+    const auto cellIds = std::make_shared<ngraph::opset3::Maximum>(yolo_graph::reshape(columns->output(2), {-1}), zero);
+    const auto gatherAxis = ngraph::opset3::Constant::create(ngraph::element::i64, ngraph::Shape{}, {0});
+    const auto valid = std::make_shared<ngraph::opset3::Convert>(
+        std::make_shared<ngraph::opset3::GreaterEqual>(labels, zero), ngraph::element::f32);
+    const auto selectedScores = std::make_shared<ngraph::opset3::Multiply>(std::make_shared<ngraph::opset3::Gather>(
+        yolo_graph::reshape(scores, {-1}),
+        std::make_shared<ngraph::opset3::Add>(std::make_shared<ngraph::opset3::Multiply>(labelIds,
+            yolo_graph::indices({static_cast<int32_t>(cells)}, {})), cellIds),
+        gatherAxis), valid);
+    const auto rows = std::make_shared<ngraph::opset3::Concat>(ngraph::OutputVector{
+        yolo_graph::reshape(std::make_shared<ngraph::opset3::Convert>(labels, ngraph::element::f32), {-1, 1}),
+        yolo_graph::reshape(selectedScores, {-1, 1}),
+        std::make_shared<ngraph::opset3::Gather>(boxes, cellIds, gatherAxis)}, 1);
+
+    // only the most confident rows are returned, the invalid ones have the score 0
+    const auto top = std::make_shared<ngraph::opset3::TopK>(selectedScores,
+        ngraph::opset3::Constant::create(ngraph::element::i64, ngraph::Shape{},
+                                         {static_cast<int64_t>(std::min(selected, maxDetections))}),
+        0, ngraph::opset3::TopK::Mode::MAX, ngraph::opset3::TopK::SortType::SORT_VALUES, ngraph::element::i32);
+    const auto detections = std::make_shared<ngraph::opset3::Gather>(rows, top->output(1), gatherAxis);
+    std::ostringstream name;
+    name << "detections/t=" << threshold << "/iou=" << iouThreshold;
+    detections->set_friendly_name(name.str());
+    return InferenceEngine::CNNNetwork(std::make_shared<ngraph::Function>(ngraph::OutputVector{detections},
+        function->get_parameters(), function->get_friendly_name()));
+}
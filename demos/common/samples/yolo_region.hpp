@@ -0,0 +1,57 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+/**
+ * @brief a header file with the decoding of the RegionYolo outputs of the YOLO V3 detection demos
+ * @file yolo_region.hpp
+ */
+
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+/**
+* @brief Decodes a RegionYolo output of side x side cells in NCHW layout. Every anchor of the output has coords box
+* planes, the objectness plane and classes probability planes. The objectness planes of all the anchors are a single
+* strided cv::Mat, so they are thresholded at once by the vectorized OpenCV comparison, and the boxes and the
+* classes are decoded only for the cells which pass it.
+* Calls addObject(x, y, height, width, classId, probability) for every class probability not less than the
+* threshold, the center and the size of the box are in the pixels of the network input of resizedSize
+*/
+template <typename AddObject>
+void decodeYoloRegion(const float* output, int side, int num, int coords, int classes, const std::vector<float>& anchors,
+                      float threshold, cv::Size resizedSize, AddObject addObject) {
+    if (num <= 0) {
+        return;
+    }
+    const int sideSquare = side * side;
+    const size_t anchorStep = static_cast<size_t>(coords + classes + 1) * sideSquare;
+    const cv::Mat objectness(num, sideSquare, CV_32F, const_cast<float*>(output + coords * sideSquare),
+                             anchorStep * sizeof(float));
+    cv::Mat mask;
+    cv::compare(objectness, threshold, mask, cv::CMP_GE);
+    std::vector<cv::Point> survivors;  // x is the cell, y is the anchor
+    cv::findNonZero(mask, survivors);
+
+    for (const cv::Point& survivor : survivors) {
+        const int n = survivor.y;
+        const int i = survivor.x;
+        const float* box = output + n * anchorStep + i;
+        const float scale = box[coords * sideSquare];
+        const float* classProbs = box + (coords + 1) * sideSquare;
+        const float x = (i % side + box[0 * sideSquare]) / side * resizedSize.width;
+        const float y = (i / side + box[1 * sideSquare]) / side * resizedSize.height;
+        const float height = std::exp(box[3 * sideSquare]) * anchors[2 * n + 1];
+        const float width = std::exp(box[2 * sideSquare]) * anchors[2 * n];
+        for (int j = 0; j < classes; ++j) {
+            const float prob = scale * classProbs[j * sideSquare];
+            if (prob >= threshold) {
+                addObject(x, y, height, width, j, prob);
+            }
+        }
+    }
+}
@@ -0,0 +1,145 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+// Records a short synthetic capture to a .caprec file and replays it: the file holds the stamps and the JPEGs of
+// the frames, and the replay returns the decoded JPEGs byte for byte, in order, paced by the stamps and looped
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgcodecs/imgcodecs.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <samples/capture_recording.hpp>
+#include <tests/unit_test.hpp>
+
+namespace {
+const int framesCount = 5;
+const int jpegQuality = 90;
+const cv::Size frameSize(160, 120);
+const std::chrono::milliseconds frameInterval(20);
+
+cv::Mat makeFrame(int index) {
+    cv::Mat frame(frameSize, CV_8UC3, cv::Scalar(40 * index, 255 - 40 * index, 128));
+    cv::rectangle(frame, cv::Rect(10 * index, 5 * index, 30, 40), cv::Scalar(255, 255, 255), cv::FILLED);
+    return frame;
+}
+
+bool sameBytes(const cv::Mat& a, const cv::Mat& b) {
+    return a.size() == b.size() && a.type() == b.type() && a.isContinuous() && b.isContinuous()
+        && 0 == std::memcmp(a.data, b.data, a.total() * a.elemSize());
+}
+
+template <typename T>
+T readValue(const std::vector<char>& bytes, std::size_t& offset) {
+    CHECK(offset + sizeof(T) <= bytes.size());
+    T value;
+    std::memcpy(&value, bytes.data() + offset, sizeof(T));
+    offset += sizeof(T);
+    return value;
+}
+
+std::vector<char> readFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    CHECK(file.is_open());
+    return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+bool throws(const std::string& path) {
+    try {
+        CaptureReplayer replayer(path, false, false);
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+}  // namespace
+
+void runTest() {
+    const std::string path = "capture_recording_test.caprec";
+    CHECK(capture_recording::isRecording(path));
+    CHECK(!capture_recording::isRecording("input.mp4"));
+
+    // the capture starts at an arbitrary moment, the stamps are relative to its first frame
+    const std::chrono::nanoseconds firstCapture = std::chrono::hours(1000);
+    {
+        CaptureRecorder recorder(path, jpegQuality);
+        for (int i = 0; i < framesCount; i++) {
+            recorder.write(makeFrame(i), firstCapture + i * frameInterval);
+        }
+        CHECK(framesCount == static_cast<int>(recorder.getFramesCount()));
+    }
+
+    // the records are the stamps in microseconds, the sizes and the JPEGs of the frames
+    const std::vector<char> bytes = readFile(path);
+    CHECK(bytes.size() > sizeof(capture_recording::magic));
+    CHECK(0 == std::memcmp(bytes.data(), capture_recording::magic, sizeof(capture_recording::magic)));
+    std::size_t offset = sizeof(capture_recording::magic);
+    std::vector<cv::Mat> recorded;
+    const std::vector<int> params = {cv::IMWRITE_JPEG_QUALITY, jpegQuality};
+    for (int i = 0; i < framesCount; i++) {
+        const uint64_t stamp = readValue<uint64_t>(bytes, offset);
+        const uint32_t size = readValue<uint32_t>(bytes, offset);
+        CHECK(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(i * frameInterval).count())
+            == stamp);
+        CHECK(offset + size <= bytes.size());
+        const std::vector<uchar> jpeg(bytes.begin() + offset, bytes.begin() + offset + size);
+        offset += size;
+        std::vector<uchar> encoded;
+        CHECK(cv::imencode(".jpg", makeFrame(i), encoded, params));
+        CHECK(encoded == jpeg);
+        recorded.push_back(cv::imdecode(jpeg, cv::IMREAD_COLOR));
+        CHECK(!recorded.back().empty());
+    }
+    CHECK(bytes.size() == offset);
+
+    // the replay as fast as it is read returns the recorded frames byte for byte
+    {
+        CaptureReplayer replayer(path, false, false);
+        CHECK(frameSize == replayer.getSize());
+        cv::Mat frame;
+        for (int i = 0; i < framesCount; i++) {
+            CHECK(replayer.read(frame));
+            CHECK(sameBytes(recorded[i], frame));
+        }
+        CHECK(!replayer.read(frame));
+    }
+
+    // the paced replay releases the frames at the moments they were captured and loops over the recording
+    {
+        CaptureReplayer replayer(path, true, true);
+        cv::Mat frame;
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < 2 * framesCount; i++) {
+            CHECK(replayer.read(frame));
+            CHECK(sameBytes(recorded[i % framesCount], frame));
+            // the second pass follows the first one by the average interval of the frames
+            CHECK(std::chrono::steady_clock::now() - start >= i * frameInterval);
+        }
+    }
+
+    // a file of another format and a truncated recording are refused
+    {
+        std::ofstream other("capture_recording_test_other.caprec", std::ios::binary);
+        other << "not a recording";
+    }
+    CHECK(throws("capture_recording_test_other.caprec"));
+    {
+        std::ofstream truncated("capture_recording_test_truncated.caprec", std::ios::binary);
+        truncated.write(bytes.data(), sizeof(capture_recording::magic) + 12 + 10);
+    }
+    CHECK(throws("capture_recording_test_truncated.caprec"));
+
+    std::remove(path.c_str());
+    std::remove("capture_recording_test_other.caprec");
+    std::remove("capture_recording_test_truncated.caprec");
+}
@@ -0,0 +1,186 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+// Round trips of the demo results through results::serialize() and the shared memory ring. The copies of the
+// frames the writer reserved to overwrite while a reader copied them must be dropped and never parsed
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <samples/results_sink.hpp>
+#include <tests/unit_test.hpp>
+
+namespace {
+// the objects and the attributes of a frame are derived from its id, so a reader checks a frame is whole
+results::Frame makeFrame(uint64_t frameId) {
+    results::Frame frame;
+    frame.channel = static_cast<uint32_t>(frameId % 4);
+    frame.frameId = frameId;
+    frame.timestampUs = static_cast<int64_t>(frameId) * 40000;
+    for (uint64_t i = 0; i < frameId % 7; i++) {
+        frame.addObject(static_cast<float>(frameId), static_cast<float>(i), 10.0f, 20.0f, 0.5f,
+                        static_cast<int32_t>(i), static_cast<int64_t>(frameId * 10 + i));
+        frame.addAttribute("id", std::to_string(frameId) + std::string(i * 50, static_cast<char>('a' + frameId % 26)));
+    }
+    return frame;
+}
+
+bool isWhole(const results::Frame& frame) {
+    const results::Frame expected = makeFrame(frame.frameId);
+    if (frame.channel != expected.channel || frame.timestampUs != expected.timestampUs
+            || frame.objects.size() != expected.objects.size() || frame.attributes.size() != expected.attributes.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < frame.objects.size(); i++) {
+        const results::Object& object = frame.objects[i];
+        const results::Object& expectedObject = expected.objects[i];
+        if (object.x != expectedObject.x || object.y != expectedObject.y || object.label != expectedObject.label
+                || object.trackId != expectedObject.trackId) {
+            return false;
+        }
+    }
+    for (std::size_t i = 0; i < frame.attributes.size(); i++) {
+        if (frame.attributes[i].object != expected.attributes[i].object
+                || frame.attributes[i].key != expected.attributes[i].key
+                || frame.attributes[i].value != expected.attributes[i].value) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string ringName(const char* test) {
+    return std::string("results_sink_test_") + test + '_' + std::to_string(getpid());
+}
+
+void testSerialization() {
+    std::vector<uint8_t> buffer;
+    for (uint64_t frameId = 0; frameId < 20; frameId++) {
+        results::serialize(makeFrame(frameId), buffer);
+        results::Frame parsed;
+        CHECK(results::parse(buffer.data(), buffer.size(), parsed));
+        CHECK(parsed.frameId == frameId);
+        CHECK(isWhole(parsed));
+        results::Frame truncated;
+        CHECK(!results::parse(buffer.data(), buffer.size() - 1, truncated));
+    }
+}
+
+// the reader keeps up, so it gets every frame in order, also the frames after the padding at the end of the data
+void testRingInOrder() {
+    const std::string name = ringName("in_order");
+    results::ShmRingTransport ring(name, 4096);
+    results::RingReader reader(name);
+    std::vector<uint8_t> buffer;
+    results::Frame frame;
+    CHECK(!reader.read(frame));
+    for (uint64_t frameId = 1; frameId < 500; frameId++) {
+        results::serialize(makeFrame(frameId), buffer);
+        CHECK(ring.write(buffer.data(), buffer.size()));
+        CHECK(reader.read(frame));
+        CHECK(frame.frameId == frameId);
+        CHECK(isWhole(frame));
+        CHECK(!reader.read(frame));
+    }
+}
+
+// a reader which falls behind by more than the ring skips to the last written frame
+void testRingOverrun() {
+    const std::string name = ringName("overrun");
+    results::ShmRingTransport ring(name, 4096);
+    results::RingReader reader(name);
+    std::vector<uint8_t> buffer;
+    for (uint64_t frameId = 1; frameId < 200; frameId++) {
+        results::serialize(makeFrame(frameId), buffer);
+        CHECK(ring.write(buffer.data(), buffer.size()));
+    }
+    results::Frame frame;
+    CHECK(reader.read(frame));
+    CHECK(199 == frame.frameId);
+    CHECK(isWhole(frame));
+    CHECK(!reader.read(frame));
+}
+
+// the writer has reserved the data of the frame the reader copies but hasn't finished writing over it
+void testRingTornCopy() {
+    const std::string name = ringName("torn");
+    const std::size_t capacity = 4096;
+    results::ShmRingTransport ring(name, capacity);
+    results::RingReader reader(name);
+    const int fd = shm_open(("/" + name).c_str(), O_RDWR, 0);
+    CHECK(fd >= 0);
+    void* memory = mmap(nullptr, results::ringHeaderSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    CHECK(MAP_FAILED != memory);
+    results::RingHeader* header = static_cast<results::RingHeader*>(memory);
+
+    std::vector<uint8_t> buffer;
+    uint64_t frameId = 1;
+    for (;; frameId++) {
+        results::serialize(makeFrame(frameId), buffer);
+        if (header->written + buffer.size() + 8 > capacity) {
+            break;  // the first frame stays in the ring
+        }
+        CHECK(ring.write(buffer.data(), buffer.size()));
+    }
+    const uint64_t lastFrameId = frameId - 1;
+    CHECK(lastFrameId > 1);
+    header->reserved = capacity + 8;  // over the first frame
+
+    results::Frame frame;
+    CHECK(reader.read(frame));
+    CHECK(lastFrameId == frame.frameId);
+    CHECK(isWhole(frame));
+    CHECK(!reader.read(frame));
+    munmap(memory, results::ringHeaderSize);
+}
+
+// the writer laps the small ring many times while the reader copies the frames
+void testRingConcurrent() {
+    const std::string name = ringName("concurrent");
+    results::ShmRingTransport ring(name, 4096);
+    results::RingReader reader(name);
+    const uint64_t framesCount = 200000;
+    std::atomic<bool> done{false};
+    std::thread writer([&] {
+        std::vector<uint8_t> buffer;
+        for (uint64_t frameId = 1; frameId <= framesCount; frameId++) {
+            results::serialize(makeFrame(frameId), buffer);
+            ring.write(buffer.data(), buffer.size());
+        }
+        done = true;
+    });
+    uint64_t lastFrameId = 0, readFrames = 0;
+    results::Frame frame;
+    while (true) {
+        const bool written = done;
+        if (reader.read(frame)) {
+            CHECK(frame.frameId > lastFrameId);
+            CHECK(isWhole(frame));
+            lastFrameId = frame.frameId;
+            readFrames++;
+        } else if (written) {
+            break;
+        }
+    }
+    writer.join();
+    CHECK(readFrames > 0);
+    CHECK(framesCount == lastFrameId);
+}
+}  // namespace
+
+void runTest() {
+    testSerialization();
+    testRingInOrder();
+    testRingOverrun();
+    testRingTornCopy();
+    testRingConcurrent();
+}
@@ -0,0 +1,30 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+/**
+ * @brief a header file with the scaffold of the unit tests of the demo code. A test defines runTest(), it passes
+ * unless a CHECK fails, which reports the failed condition and exits with a non-zero code for ctest
+ * @file unit_test.hpp
+ */
+
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            std::exit(1); \
+        } \
+    } while (false)
+
+void runTest();
+
+int main(int, char *argv[]) {
+    runTest();
+    std::printf("%s passed\n", argv[0]);
+    return 0;
+}
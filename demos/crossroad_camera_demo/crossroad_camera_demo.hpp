@@ -10,7 +10,9 @@
 #include <gflags/gflags.h>
 
 static const char help_message[] = "Print a usage message.";
-static const char video_message[] = "Required. Path to a video or image file. Default value is \"cam\" to work with camera.";
+static const char video_message[] = "Required. Path to a video or image file. Default value is \"cam\" to work with camera. "
+                                    "Comma separated inputs are processed together as the cameras of one scene, "
+                                    "a number is the index of a camera.";
 static const char person_vehicle_bike_detection_model_message[] = "Required. Path to the Person/Vehicle/Bike Detection Crossroad model (.xml) file.";
 static const char person_attribs_model_message[] = "Optional. Path to the Person Attributes Recognition Crossroad model (.xml) file.";
 static const char person_reid_model_message[] = "Optional. Path to the Person Reidentification Retail model (.xml) file.";
@@ -26,6 +28,12 @@ static const char target_device_message_person_reid[] = "Optional. Specify the t
                                                         "The list of available devices is shown below. Default value is CPU. "
                                                         "Use \"-d HETERO:<comma-separated_devices_list>\" format to specify HETERO plugin. "
                                                         "The application looks for a suitable plugin for the specified device.";
+static const char num_batch_pa_message[] = "Optional. Number of the persons in a batch of Person Attributes Recognition. "
+                                           "All the persons of a frame are inferred at once by the batches. "
+                                           "The batch is 1 with -auto_resize. Default value is 16.";
+static const char num_batch_reid_message[] = "Optional. Number of the persons in a batch of Person Reidentification Retail. "
+                                             "All the persons of a frame are inferred at once by the batches. "
+                                             "The batch is 1 with -auto_resize. Default value is 16.";
 static const char performance_counter_message[] = "Optional. Enables per-layer performance statistics.";
 static const char custom_cldnn_message[] = "Optional. For clDNN (GPU)-targeted custom kernels, if any. "
                                            "Absolute path to the xml file with the kernels desc.";
@@ -33,13 +41,29 @@ static const char custom_cpu_library_message[] = "Optional. For MKLDNN (CPU)-tar
                                                  "Absolute path to a shared library with the kernels impl.";
 static const char threshold_output_message[] = "Optional. Probability threshold for person/vehicle/bike crossroad detections.";
 static const char threshold_output_message_person_reid[] = "Optional. Cosine similarity threshold between two vectors for person reidentification.";
+static const char reid_gallery_size_message[] = "Optional. Maximal number of the persons remembered for reidentification. "
+                                                "When it is reached, a new person replaces the one matched longest ago.";
+static const char reid_lists_message[] = "Optional. Number of the clusters of the remembered persons searched approximately "
+                                         "with a tenth of the clusters compared with each person. 0 compares with all of them.";
 static const char raw_output_message[] = "Optional. Output Inference results as raw values.";
 static const char no_show_processed_video[] = "Optional. No show processed video.";
+static const char pipeline_message[] = "Optional. Detect the next frame while the persons of the current frame are inferred. "
+                                       "The frames are still shown in their order.";
 static const char input_resizable_message[] = "Optional. Enables resizable input with support of ROI crop & auto resize.";
 
 /// @brief Message list of monitors to show
 static const char utilization_monitors_message[] = "Optional. List of monitors to show initially.";
 
+/// @brief Message for CPU weights argument
+static const char cpu_weights_message[] = "Optional. Comma separated weights of the person detection, attributes and "
+                                          "reidentification models to split the CPU threads between them. Each model on the CPU "
+                                          "gets its own threads and streams, models on other devices are skipped.";
+
+/// @brief Message for the compiled networks cache directory
+static const char cache_dir_message[] = "Optional. Directory to cache compiled networks in. Later runs import the cached networks "
+                                        "instead of compiling them if the model, device and config didn't change. "
+                                        "Devices without network export support compile on each run.";
+
 
 DEFINE_bool(h, false, help_message);
 DEFINE_string(i, "cam", video_message);
@@ -49,19 +73,32 @@ DEFINE_string(m_reid, "", person_reid_model_message);
 DEFINE_string(d, "CPU", target_device_message);
 DEFINE_string(d_pa, "CPU", target_device_message_person_attribs);
 DEFINE_string(d_reid, "CPU", target_device_message_person_reid);
+DEFINE_uint32(n_pa, 16, num_batch_pa_message);
+DEFINE_uint32(n_reid, 16, num_batch_reid_message);
 DEFINE_bool(pc, false, performance_counter_message);
 DEFINE_string(c, "", custom_cldnn_message);
 DEFINE_string(l, "", custom_cpu_library_message);
 DEFINE_bool(r, false, raw_output_message);
 DEFINE_double(t, 0.5, threshold_output_message);
 DEFINE_double(t_reid, 0.7, threshold_output_message_person_reid);
+DEFINE_int32(reid_gallery_size, 1000, reid_gallery_size_message);
+DEFINE_int32(reid_lists, 0, reid_lists_message);
 DEFINE_bool(no_show, false, no_show_processed_video);
 DEFINE_bool(auto_resize, false, input_resizable_message);
+DEFINE_bool(pipeline, false, pipeline_message);
 
 /// \brief Define a flag to show monitors<br>
 /// It is an optional parameter
 DEFINE_string(u, "", utilization_monitors_message);
 
+/// \brief Define a flag to split the CPU between the models<br>
+/// It is an optional parameter
+DEFINE_string(cpu_weights, "", cpu_weights_message);
+
+/// \brief Define a path to the compiled networks cache<br>
+/// It is an optional parameter
+DEFINE_string(cache_dir, "", cache_dir_message);
+
 
 /**
 * @brief This function show a help message
@@ -82,11 +119,18 @@ static void showUsage() {
     std::cout << "    -d \"<device>\"                " << target_device_message << std::endl;
     std::cout << "    -d_pa \"<device>\"             " << target_device_message_person_attribs << std::endl;
     std::cout << "    -d_reid \"<device>\"           " << target_device_message_person_reid << std::endl;
+    std::cout << "    -n_pa \"<num>\"                " << num_batch_pa_message << std::endl;
+    std::cout << "    -n_reid \"<num>\"              " << num_batch_reid_message << std::endl;
     std::cout << "    -pc                          " << performance_counter_message << std::endl;
     std::cout << "    -r                           " << raw_output_message << std::endl;
     std::cout << "    -t                           " << threshold_output_message << std::endl;
     std::cout << "    -t_reid                      " << threshold_output_message_person_reid << std::endl;
+    std::cout << "    -reid_gallery_size           " << reid_gallery_size_message << std::endl;
+    std::cout << "    -reid_lists                  " << reid_lists_message << std::endl;
     std::cout << "    -no_show                     " << no_show_processed_video << std::endl;
     std::cout << "    -auto_resize                 " << input_resizable_message << std::endl;
+    std::cout << "    -pipeline                    " << pipeline_message << std::endl;
     std::cout << "    -u                           " << utilization_monitors_message << std::endl;
+    std::cout << "    -cpu_weights                 " << cpu_weights_message << std::endl;
+    std::cout << "    -cache_dir \"<path>\"          " << cache_dir_message << std::endl;
 }
@@ -8,6 +8,7 @@
 * \example crossroad_camera_demo/main.cpp
 */
 #include <gflags/gflags.h>
+#include <cctype>
 #include <functional>
 #include <iostream>
 #include <fstream>
@@ -15,8 +16,10 @@
 #include <memory>
 #include <chrono>
 #include <algorithm>
+#include <array>
 #include <iterator>
 #include <map>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <set>
@@ -24,8 +27,14 @@
 #include <inference_engine.hpp>
 
 #include <monitors/presenter.h>
+#include <samples/args_helper.hpp>
 #include <samples/slog.hpp>
 #include <samples/ocv_common.hpp>
+#include <samples/cpu_plan.hpp>
+#include <samples/embeddings.hpp>
+#include <samples/mapped_weights.hpp>
+#include <samples/network_cache.hpp>
+#include <samples/parallel_load.hpp>
 #include "crossroad_camera_demo.hpp"
 
 using namespace InferenceEngine;
@@ -50,6 +59,18 @@ bool ParseAndCheckCommandLine(int argc, char *argv[]) {
         throw std::logic_error("Parameter -m is not set");
     }
 
+    if (FLAGS_n_pa < 1 || FLAGS_n_reid < 1) {
+        throw std::logic_error("Parameters -n_pa and -n_reid must be positive");
+    }
+
+    if (FLAGS_reid_gallery_size < 1) {
+        throw std::logic_error("Parameter -reid_gallery_size must be positive");
+    }
+
+    if (FLAGS_reid_lists < 0) {
+        throw std::logic_error("Parameter -reid_lists must not be negative");
+    }
+
     return true;
 }
 
@@ -124,12 +145,102 @@ struct BaseDetection {
     }
 };
 
-struct PersonDetection : BaseDetection{
-    int maxProposalCount;
-    int objectSize;
-    float width = 0.0f;
-    float height = 0.0f;
-    bool resultsFetched = false;
+/**
+* @brief Base of the networks inferred on the persons of a frame. The persons are split into batches of maxBatch
+* persons and each batch is inferred by its own request, so all the batches are in flight at once. The person ROIs
+* set by setRoiBlob can't be batched, so with -auto_resize maxBatch is 1 and each person gets its own request
+*/
+struct PersonBatchDetection : BaseDetection {
+    const size_t maxBatch;
+    bool isBatchDynamic = false;
+    std::vector<InferRequest::Ptr> batchRequests;  // batchRequests[0] is request
+    size_t enqueuedPersons = 0;
+    size_t submittedPersons = 0;
+
+    PersonBatchDetection(std::string &commandLineFlag, const std::string &topoName, size_t maxBatch)
+        : BaseDetection(commandLineFlag, topoName), maxBatch(FLAGS_auto_resize ? 1 : maxBatch) {}
+
+    /** @brief Adds the config enabling the dynamic batch if the device supports it */
+    std::map<std::string, std::string> config(std::map<std::string, std::string> config, const std::string &deviceName) {
+        isBatchDynamic = maxBatch > 1 &&
+                         (deviceName.find("CPU") != std::string::npos || deviceName.find("GPU") != std::string::npos);
+        if (isBatchDynamic) {
+            config[PluginConfigParams::KEY_DYN_BATCH_ENABLED] = PluginConfigParams::YES;
+        }
+        return config;
+    }
+
+    void setRoiBlob(const Blob::Ptr &roiBlob) override {
+        if (!enabled())
+            return;
+        personRequest(enqueuedPersons++).SetBlob(inputName, roiBlob);
+    }
+
+    void enqueue(const cv::Mat &person) override {
+        if (!enabled())
+            return;
+        InferRequest &batchRequest = personRequest(enqueuedPersons);
+        if (FLAGS_auto_resize) {
+            inputBlob = wrapMat2Blob(person);
+            batchRequest.SetBlob(inputName, inputBlob);
+        } else {
+            inputBlob = batchRequest.GetBlob(inputName);
+            matU8ToBlob<uint8_t>(person, inputBlob, static_cast<int>(enqueuedPersons % maxBatch));
+        }
+        enqueuedPersons++;
+    }
+
+    /** @brief Starts the batches of the enqueued persons */
+    void submitRequest() override {
+        if (!enabled())
+            return;
+        submittedPersons = enqueuedPersons;
+        enqueuedPersons = 0;
+        for (size_t batch = 0; batch * maxBatch < submittedPersons; batch++) {
+            if (isBatchDynamic) {
+                batchRequests[batch]->SetBatch(static_cast<int>(std::min(maxBatch, submittedPersons - batch * maxBatch)));
+            }
+            batchRequests[batch]->StartAsync();
+        }
+    }
+
+    void wait() override {
+        if (!enabled())
+            return;
+        for (size_t batch = 0; batch * maxBatch < submittedPersons; batch++) {
+            batchRequests[batch]->Wait(IInferRequest::WaitMode::RESULT_READY);
+        }
+    }
+
+    /** @brief Returns the first element of the output of a submitted person */
+    template <typename T>
+    const T* personOutput(const std::string &name, size_t personIdx) const {
+        Blob::Ptr blob = batchRequests[personIdx / maxBatch]->GetBlob(name);
+        const SizeVector &dims = blob->getTensorDesc().getDims();
+        const size_t personSize = blob->size() / dims.at(0);
+        return blob->buffer().as<T*>() + personIdx % maxBatch * personSize;
+    }
+
+private:
+    InferRequest &personRequest(size_t personIdx) {
+        const size_t batch = personIdx / maxBatch;
+        while (batchRequests.size() <= batch) {
+            batchRequests.push_back(net.CreateInferRequestPtr());
+        }
+        request = *batchRequests[0];
+        return *batchRequests[batch];
+    }
+};
+
+/**
+* @brief Detects the frames of all the cameras at once, the frame of a camera is an image of the batch. The batch
+* is static, so the frames of fewer cameras cost as much as a full batch and the detections of the images left from
+* the earlier frames are skipped. With -auto_resize each frame gets its own request
+*/
+struct PersonDetection : PersonBatchDetection {
+    int objectSize = 0;
+    std::vector<cv::Size> frameSizes;  // of the enqueued frames
+    std::vector<cv::Size> submittedSizes;
 
     struct Result {
         int label;
@@ -137,34 +248,42 @@ struct PersonDetection : BaseDetection{
         cv::Rect location;
     };
 
-    std::vector<Result> results;
+    std::vector<std::vector<Result>> results;  // of the submitted frames
 
     void submitRequest() override {
-        resultsFetched = false;
-        results.clear();
-        BaseDetection::submitRequest();
+        submittedSizes = std::move(frameSizes);
+        frameSizes.clear();
+        PersonBatchDetection::submitRequest();
     }
 
     void setRoiBlob(const Blob::Ptr &frameBlob) override {
-        height = static_cast<float>(frameBlob->getTensorDesc().getDims()[2]);
-        width = static_cast<float>(frameBlob->getTensorDesc().getDims()[3]);
-        BaseDetection::setRoiBlob(frameBlob);
+        const SizeVector &dims = frameBlob->getTensorDesc().getDims();
+        frameSizes.emplace_back(static_cast<int>(dims[3]), static_cast<int>(dims[2]));
+        PersonBatchDetection::setRoiBlob(frameBlob);
     }
 
     void enqueue(const cv::Mat &frame) override {
-        height = static_cast<float>(frame.rows);
-        width = static_cast<float>(frame.cols);
-        BaseDetection::enqueue(frame);
+        frameSizes.push_back(frame.size());
+        PersonBatchDetection::enqueue(frame);
+    }
+
+    explicit PersonDetection(size_t camerasNumber)
+        : PersonBatchDetection(FLAGS_m, "Person Detection", camerasNumber) {}
+
+    /** @brief Makes the requests of the next frames current, the detection of the current frames must be finished */
+    void next() {
+        std::swap(batchRequests, nextBatchRequests);
     }
 
-    PersonDetection() : BaseDetection(FLAGS_m, "Person Detection"), maxProposalCount(0), objectSize(0) {}
+    std::vector<InferRequest::Ptr> nextBatchRequests;  // infer the next frames in the pipelined mode
+
     CNNNetwork read(const Core& ie) override {
         slog::info << "Loading network files for PersonDetection" << slog::endl;
         /** Read network model **/
-        auto network = ie.ReadNetwork(FLAGS_m);
-        /** Set batch size to 1 **/
-        slog::info << "Batch size is forced to  1" << slog::endl;
-        network.setBatchSize(1);
+        auto network = readNetworkMapped(ie, FLAGS_m);
+        /** Set batch size to the number of the cameras **/
+        slog::info << "Batch size is set to " << maxBatch << " for Person Detection" << slog::endl;
+        network.setBatchSize(maxBatch);
         // -----------------------------------------------------------------------------------------------------
 
         /** SSD-based network should have one input and one output **/
@@ -195,7 +314,6 @@ struct PersonDetection : BaseDetection{
         DataPtr& _output = outputInfo.begin()->second;
         const SizeVector outputDims = _output->getTensorDesc().getDims();
         outputName = outputInfo.begin()->first;
-        maxProposalCount = outputDims[2];
         objectSize = outputDims[3];
         if (objectSize != 7) {
             throw std::logic_error("Output should have 7 as a last dimension");
@@ -210,50 +328,58 @@ struct PersonDetection : BaseDetection{
         return network;
     }
 
+    /** @brief Parses the detections of the submitted frames, the image id of a detection is its frame in the batch */
     void fetchResults() {
-        if (!enabled()) return;
-        results.clear();
-        if (resultsFetched) return;
-        resultsFetched = true;
-        const float *detections = request.GetBlob(outputName)->buffer().as<float *>();
-        // pretty much regular SSD post-processing
-        for (int i = 0; i < maxProposalCount; i++) {
-            float image_id = detections[i * objectSize + 0];  // in case of batch
-            if (image_id < 0) {  // indicates end of detections
-                break;
-            }
-
-            Result r;
-            r.label = static_cast<int>(detections[i * objectSize + 1]);
-            r.confidence = detections[i * objectSize + 2];
-
-            r.location.x = static_cast<int>(detections[i * objectSize + 3] * width);
-            r.location.y = static_cast<int>(detections[i * objectSize + 4] * height);
-            r.location.width = static_cast<int>(detections[i * objectSize + 5] * width - r.location.x);
-            r.location.height = static_cast<int>(detections[i * objectSize + 6] * height - r.location.y);
-
-            if (FLAGS_r) {
-                std::cout << "[" << i << "," << r.label << "] element, prob = " << r.confidence <<
-                          "    (" << r.location.x << "," << r.location.y << ")-(" << r.location.width << ","
-                          << r.location.height << ")"
-                          << ((r.confidence > FLAGS_t) ? " WILL BE RENDERED!" : "") << std::endl;
-            }
+        results.assign(submittedSizes.size(), {});
+        for (size_t batch = 0; batch * maxBatch < submittedSizes.size(); batch++) {
+            Blob::Ptr output = batchRequests[batch]->GetBlob(outputName);
+            const float *detections = output->buffer().as<float *>();
+            const size_t maxProposalCount = output->size() / objectSize;
+            // pretty much regular SSD post-processing
+            for (size_t i = 0; i < maxProposalCount; i++) {
+                float image_id = detections[i * objectSize + 0];
+                if (image_id < 0) {  // indicates end of detections
+                    break;
+                }
+                const size_t frameIdx = batch * maxBatch + static_cast<size_t>(image_id);
+                if (frameIdx >= submittedSizes.size()) {  // the image wasn't enqueued for these frames
+                    continue;
+                }
+                const float width = static_cast<float>(submittedSizes[frameIdx].width);
+                const float height = static_cast<float>(submittedSizes[frameIdx].height);
+
+                Result r;
+                r.label = static_cast<int>(detections[i * objectSize + 1]);
+                r.confidence = detections[i * objectSize + 2];
+
+                r.location.x = static_cast<int>(detections[i * objectSize + 3] * width);
+                r.location.y = static_cast<int>(detections[i * objectSize + 4] * height);
+                r.location.width = static_cast<int>(detections[i * objectSize + 5] * width - r.location.x);
+                r.location.height = static_cast<int>(detections[i * objectSize + 6] * height - r.location.y);
+
+                if (FLAGS_r) {
+                    std::cout << "[" << frameIdx << "," << i << "," << r.label << "] element, prob = " << r.confidence
+                              << "    (" << r.location.x << "," << r.location.y << ")-(" << r.location.width << ","
+                              << r.location.height << ")"
+                              << ((r.confidence > FLAGS_t) ? " WILL BE RENDERED!" : "") << std::endl;
+                }
 
-            if (r.confidence <= FLAGS_t) {
-                continue;
+                if (r.confidence <= FLAGS_t) {
+                    continue;
+                }
+                results[frameIdx].push_back(r);
             }
-            results.push_back(r);
         }
     }
 };
 
-struct PersonAttribsDetection : BaseDetection {
+struct PersonAttribsDetection : PersonBatchDetection {
     std::string outputNameForAttributes;
     std::string outputNameForTopColorPoint;
     std::string outputNameForBottomColorPoint;
 
 
-    PersonAttribsDetection() : BaseDetection(FLAGS_m_pa, "Person Attributes Recognition") {}
+    PersonAttribsDetection() : PersonBatchDetection(FLAGS_m_pa, "Person Attributes Recognition", FLAGS_n_pa) {}
 
     struct AttributesAndColorPoints{
         std::vector<std::string> attributes_strings;
@@ -264,37 +390,52 @@ struct PersonAttribsDetection : BaseDetection {
         cv::Vec3b bottom_color;
     };
 
+    /**
+    * @brief Returns the dominant color of the BGR image. The colors are quantized to 3 bits per channel in a single
+    * pass, the result is the mean color of the most frequent of the 512 bins
+    */
     static cv::Vec3b GetAvgColor(const cv::Mat& image) {
-        int clusterCount = 5;
-        cv::Mat labels;
-        cv::Mat centers;
-        cv::Mat image32f;
-        image.convertTo(image32f, CV_32F);
-        image32f = image32f.reshape(1, image32f.rows*image32f.cols);
-        clusterCount = std::min(clusterCount, image32f.rows);
-        cv::kmeans(image32f, clusterCount, labels, cv::TermCriteria(cv::TermCriteria::EPS+cv::TermCriteria::MAX_ITER, 10, 1.0),
-                    10, cv::KMEANS_RANDOM_CENTERS, centers);
-        centers.convertTo(centers, CV_8U);
-        centers = centers.reshape(0, clusterCount);
-        std::vector<int> freq(clusterCount);
-
-        for (int i = 0; i < labels.rows * labels.cols; ++i) {
-            freq[labels.at<int>(i)]++;
+        constexpr int levelBits = 3;
+        constexpr int shift = 8 - levelBits;
+        struct Bin {
+            int count = 0;
+            int sum[3] = {0, 0, 0};
+        };
+        std::array<Bin, 1 << (3 * levelBits)> bins;
+
+        for (int y = 0; y < image.rows; ++y) {
+            const cv::Vec3b* row = image.ptr<cv::Vec3b>(y);
+            for (int x = 0; x < image.cols; ++x) {
+                const cv::Vec3b& color = row[x];
+                Bin& bin = bins[(color[0] >> shift) << (2 * levelBits) |
+                                (color[1] >> shift) << levelBits |
+                                color[2] >> shift];
+                ++bin.count;
+                bin.sum[0] += color[0];
+                bin.sum[1] += color[1];
+                bin.sum[2] += color[2];
+            }
         }
 
-        auto freqArgmax = std::max_element(freq.begin(), freq.end()) - freq.begin();
-
-        return centers.at<cv::Vec3b>(freqArgmax);
+        const Bin& dominant = *std::max_element(bins.begin(), bins.end(),
+            [](const Bin& a, const Bin& b) { return a.count < b.count; });
+        if (dominant.count == 0) {
+            return cv::Vec3b();
+        }
+        return cv::Vec3b(static_cast<uchar>(dominant.sum[0] / dominant.count),
+                         static_cast<uchar>(dominant.sum[1] / dominant.count),
+                         static_cast<uchar>(dominant.sum[2] / dominant.count));
     }
 
-    AttributesAndColorPoints GetPersonAttributes() {
+    AttributesAndColorPoints GetPersonAttributes(size_t personIdx) {
         static const char *const attributeStrings[] = {
                 "is male", "has_bag", "has_backpack" , "has hat", "has longsleeves", "has longpants", "has longhair", "has coat_jacket"
         };
 
-        Blob::Ptr attribsBlob = request.GetBlob(outputNameForAttributes);
-        Blob::Ptr topColorPointBlob = request.GetBlob(outputNameForTopColorPoint);
-        Blob::Ptr bottomColorPointBlob = request.GetBlob(outputNameForBottomColorPoint);
+        InferRequest::Ptr resultRequest = batchRequests[personIdx / maxBatch];
+        Blob::Ptr attribsBlob = resultRequest->GetBlob(outputNameForAttributes);
+        Blob::Ptr topColorPointBlob = resultRequest->GetBlob(outputNameForTopColorPoint);
+        Blob::Ptr bottomColorPointBlob = resultRequest->GetBlob(outputNameForBottomColorPoint);
         size_t numOfAttrChannels = attribsBlob->getTensorDesc().getDims().at(1);
         size_t numOfTCPointChannels = topColorPointBlob->getTensorDesc().getDims().at(1);
         size_t numOfBCPointChannels = bottomColorPointBlob->getTensorDesc().getDims().at(1);
@@ -313,9 +454,9 @@ struct PersonAttribsDetection : BaseDetection {
                                    "Person Attributes Recognition network is not equal to point coordinates (2)");
         }
 
-        auto outputAttrValues = attribsBlob->buffer().as<float*>();
-        auto outputTCPointValues = topColorPointBlob->buffer().as<float*>();
-        auto outputBCPointValues = bottomColorPointBlob->buffer().as<float*>();
+        auto outputAttrValues = personOutput<float>(outputNameForAttributes, personIdx);
+        auto outputTCPointValues = personOutput<float>(outputNameForTopColorPoint, personIdx);
+        auto outputBCPointValues = personOutput<float>(outputNameForBottomColorPoint, personIdx);
 
         AttributesAndColorPoints returnValue;
 
@@ -336,10 +477,10 @@ struct PersonAttribsDetection : BaseDetection {
     CNNNetwork read(const Core& ie) override {
         slog::info << "Loading network files for PersonAttribs" << slog::endl;
         /** Read network model **/
-        auto network = ie.ReadNetwork(FLAGS_m_pa);
+        auto network = readNetworkMapped(ie, FLAGS_m_pa);
         /** Extract model name and load it's weights **/
-        network.setBatchSize(1);
-        slog::info << "Batch size is forced to 1 for Person Attribs" << slog::endl;
+        network.setBatchSize(maxBatch);
+        slog::info << "Batch size is set to " << maxBatch << " for Person Attribs" << slog::endl;
         // -----------------------------------------------------------------------------------------------------
 
         /** Person Attribs network should have one input two outputs **/
@@ -376,69 +517,144 @@ struct PersonAttribsDetection : BaseDetection {
     }
 };
 
-struct PersonReIdentification : BaseDetection {
-    std::vector<std::vector<float>> globalReIdVec;  // contains vectors characterising all detected persons
-
-    PersonReIdentification() : BaseDetection(FLAGS_m_reid, "Person Reidentification Retail") {}
-
-    unsigned long int findMatchingPerson(const std::vector<float> &newReIdVec) {
-        auto size = globalReIdVec.size();
+/**
+* @brief Bounded gallery of the persons seen recently. The normalized reid vectors are the rows of one matrix,
+* so a vector is scored against all of them with a single matrix product. When the gallery is full, a new person
+* replaces the one matched longest ago. If listsNumber is positive, the rows are searched with an EmbeddingsIndex
+* and the rows changed after it was built are scanned exactly until enough of them are changed to rebuild it.
+* The persons of all the cameras are matched with the same gallery, so a person keeps the id moving between the
+* views, and the cameras match their persons concurrently
+*/
+class PersonGallery {
+public:
+    PersonGallery(int capacity, int listsNumber)
+        : capacity(capacity), listsNumber(listsNumber), ids(capacity), lastMatched(capacity), isChanged(capacity) {}
+
+    /** @brief Returns the id of the most similar person if the similarity exceeds the threshold or a new id */
+    unsigned long findMatchingPerson(const std::vector<float> &newReIdVec, float threshold) {
+        cv::Mat query = cv::Mat(newReIdVec).reshape(1, 1);
+        const double norm = cv::norm(query);
+        if (norm == 0) {
+            throw std::logic_error("cosine similarity is not defined whenever one or both "
+                                   "input vectors are zero-vectors.");
+        }
+        query = query / norm;
+        std::lock_guard<std::mutex> lock(mutex);
+        if (rows.empty()) {
+            rows.create(capacity, query.cols, CV_32F);
+        } else if (query.cols != rows.cols) {
+            throw std::logic_error("cosine similarity can't be called for the vectors of different lengths: "
+                                   "vecA size = " + std::to_string(query.cols) +
+                                   "vecB size = " + std::to_string(rows.cols));
+        }
 
-        /* assigned REID is index of the matched vector from the globalReIdVec */
-        for (size_t i = 0; i < size; ++i) {
-            float cosSim = cosineSimilarity(newReIdVec, globalReIdVec[i]);
+        int best = -1;
+        float bestSimilarity = threshold;
+        auto check = [&](int row, float cosSim) {
             if (FLAGS_r) {
                 std::cout << "cosineSimilarity: " << cosSim << std::endl;
             }
-            if (cosSim > FLAGS_t_reid) {
-                /* We substitute previous person's vector by a new one characterising
-                 * last person's position */
-                globalReIdVec[i] = newReIdVec;
-                return i;
+            if (cosSim > bestSimilarity) {
+                best = row;
+                bestSimilarity = cosSim;
+            }
+        };
+        if (index) {
+            NormalizedEmbeddings queries;
+            queries.add(query);
+            for (int row : index->search(queries, candidatesNumber).front()) {
+                if (!isChanged[row]) {
+                    check(row, static_cast<float>(query.dot(rows.row(row))));
+                }
+            }
+            for (int row : changed) {
+                check(row, static_cast<float>(query.dot(rows.row(row))));
+            }
+        } else if (size > 0) {
+            cv::Mat similarities;
+            cv::gemm(query, rows.rowRange(0, size), 1.0, cv::noArray(), 0.0, similarities, cv::GEMM_2_T);
+            for (int row = 0; row < size; ++row) {
+                check(row, similarities.at<float>(0, row));
+            }
+        }
+
+        if (best < 0) {
+            if (size < capacity) {
+                best = size++;
+            } else {
+                best = static_cast<int>(std::min_element(lastMatched.begin(), lastMatched.end()) - lastMatched.begin());
+            }
+            ids[best] = nextId++;
+        }
+        /* We substitute previous person's vector by a new one characterising
+         * last person's position */
+        query.copyTo(rows.row(best));
+        lastMatched[best] = ++time;
+        if (listsNumber > 0 && !isChanged[best]) {
+            isChanged[best] = true;
+            changed.push_back(best);
+            if (changed.size() >= std::max<size_t>(size / 4, minChangedNumber)) {
+                rebuildIndex();
             }
         }
-        globalReIdVec.push_back(newReIdVec);
-        return size;
+        return ids[best];
     }
 
-    std::vector<float> getReidVec() {
-        Blob::Ptr attribsBlob = request.GetBlob(outputName);
+private:
+    void rebuildIndex() {
+        std::vector<cv::Mat> used;
+        for (int row = 0; row < size; ++row) {
+            used.push_back(rows.row(row));
+        }
+        index.reset(new EmbeddingsIndex(NormalizedEmbeddings(used), listsNumber, (listsNumber + 9) / 10));
+        for (int row : changed) {
+            isChanged[row] = false;
+        }
+        changed.clear();
+    }
 
-        auto numOfChannels = attribsBlob->getTensorDesc().getDims().at(1);
-        auto outputValues = attribsBlob->buffer().as<float*>();
-        return std::vector<float>(outputValues, outputValues + numOfChannels);
+    static constexpr int candidatesNumber = 8;  // rows of the index compared with a vector
+    static constexpr size_t minChangedNumber = 256;  // changed rows scanned exactly before the index is rebuilt
+
+    const int capacity;
+    const int listsNumber;
+    std::mutex mutex;
+    cv::Mat rows;  // capacity x vector length, the first size rows are used
+    int size = 0;
+    std::vector<unsigned long> ids;  // of the persons of the rows
+    std::vector<unsigned long> lastMatched;  // time of the last match of the rows
+    unsigned long time = 0;
+    unsigned long nextId = 0;
+    std::unique_ptr<EmbeddingsIndex> index;
+    std::vector<int> changed;  // rows changed after the index was built
+    std::vector<bool> isChanged;
+};
+
+struct PersonReIdentification : PersonBatchDetection {
+    PersonGallery gallery;  // vectors characterising the recently detected persons
+
+    PersonReIdentification()
+        : PersonBatchDetection(FLAGS_m_reid, "Person Reidentification Retail", FLAGS_n_reid),
+          gallery(FLAGS_reid_gallery_size, FLAGS_reid_lists) {}
+
+    unsigned long int findMatchingPerson(const std::vector<float> &newReIdVec) {
+        return gallery.findMatchingPerson(newReIdVec, static_cast<float>(FLAGS_t_reid));
     }
 
-    template <typename T>
-    float cosineSimilarity(const std::vector<T> &vecA, const std::vector<T> &vecB) {
-        if (vecA.size() != vecB.size()) {
-            throw std::logic_error("cosine similarity can't be called for the vectors of different lengths: "
-                                   "vecA size = " + std::to_string(vecA.size()) +
-                                   "vecB size = " + std::to_string(vecB.size()));
-        }
+    std::vector<float> getReidVec(size_t personIdx) {
+        Blob::Ptr attribsBlob = batchRequests[personIdx / maxBatch]->GetBlob(outputName);
 
-        T mul, denomA, denomB, A, B;
-        mul = denomA = denomB = A = B = 0;
-        for (size_t i = 0; i < vecA.size(); ++i) {
-            A = vecA[i];
-            B = vecB[i];
-            mul += A * B;
-            denomA += A * A;
-            denomB += B * B;
-        }
-        if (denomA == 0 || denomB == 0) {
-            throw std::logic_error("cosine similarity is not defined whenever one or both "
-                                   "input vectors are zero-vectors.");
-        }
-        return mul / (sqrt(denomA) * sqrt(denomB));
+        auto numOfChannels = attribsBlob->getTensorDesc().getDims().at(1);
+        auto outputValues = personOutput<float>(outputName, personIdx);
+        return std::vector<float>(outputValues, outputValues + numOfChannels);
     }
 
     CNNNetwork read(const Core& ie) override {
         slog::info << "Loading network files for Person Reidentification" << slog::endl;
         /** Read network model **/
-        auto network = ie.ReadNetwork(FLAGS_m_reid);
-        slog::info << "Batch size is forced to  1 for Person Reidentification Network" << slog::endl;
-        network.setBatchSize(1);
+        auto network = readNetworkMapped(ie, FLAGS_m_reid);
+        slog::info << "Batch size is set to " << maxBatch << " for Person Reidentification Network" << slog::endl;
+        network.setBatchSize(maxBatch);
         /** Person Reidentification network should have 1 input and one output **/
         // ---------------------------Check inputs ------------------------------------------------------
         slog::info << "Checking Person Reidentification Network input" << slog::endl;
@@ -475,13 +691,68 @@ struct Load {
     BaseDetection& detector;
     explicit Load(BaseDetection& detector) : detector(detector) { }
 
-    void into(Core & ie, const std::string & deviceName) const {
+    void into(Core & ie, const std::string & deviceName, const std::map<std::string, std::string> & config = {}) const {
         if (detector.enabled()) {
-            detector.net = ie.LoadNetwork(detector.read(ie), deviceName);
+            detector.net = loadNetworkCached(ie, detector.read(ie), detector.commandLineFlag, deviceName, config, FLAGS_cache_dir);
         }
     }
 };
 
+/**
+* @brief An input of the demo, a video, a camera or an image. The frames of all the cameras are detected as one
+* batch, the persons of the frames share the batches of the other networks
+*/
+struct Camera {
+    const std::string input;
+    const std::string windowName;
+    cv::VideoCapture cap;
+    bool isVideo = false;
+    bool running = true;
+    cv::Mat frame;  // processed now
+    Blob::Ptr frameBlob;  // Blob to be used to keep processed frame data
+    cv::Mat nextFrame;  // detected while the persons of frame are inferred in the pipelined mode
+    Blob::Ptr nextFrameBlob;
+    std::vector<PersonDetection::Result> persons;  // of frame in the order of their inference
+    size_t firstPerson = 0;  // index of persons.front() in the batches of the persons of all the frames
+    std::vector<PersonAttribsDetection::AttributesAndColorPoints> attributes;  // of persons
+    std::vector<std::vector<float>> reIdVectors;  // of persons
+    size_t framesNumber = 0;
+    std::chrono::high_resolution_clock::time_point start;
+    std::chrono::high_resolution_clock::time_point end;  // of the last frame
+
+    Camera(const std::string &input, const std::string &windowName) : input(input), windowName(windowName) {
+        frame = cv::imread(input, cv::IMREAD_COLOR);
+        isVideo = frame.empty();
+        if (!isVideo) {
+            return;
+        }
+        const bool isCameraIndex = !input.empty() && std::all_of(input.begin(), input.end(), ::isdigit);
+        if (!(input == "cam" ? cap.open(0) : isCameraIndex ? cap.open(std::stoi(input)) : cap.open(input))) {
+            throw std::logic_error("Cannot open input file or camera: " + input);
+        }
+    }
+
+    /** @brief Reads the next frame of the video, returns false at its end and for an image */
+    bool read(cv::Mat &image) {
+        if (!isVideo || !running) {
+            return false;
+        }
+        if (!cap.read(image)) {
+            if (image.empty()) {  // end of video file
+                running = false;
+                return false;
+            }
+            throw std::logic_error("Failed to get frame from cv::VideoCapture of " + input);
+        }
+        return true;
+    }
+
+    /** @brief Frames processed per second from the start until the last frame */
+    double fps() const {
+        const double seconds = std::chrono::duration<double>(end - start).count();
+        return seconds > 0 ? framesNumber / seconds : 0.0;
+    }
+};
 
 
 int main(int argc, char *argv[]) {
@@ -495,14 +766,14 @@ int main(int argc, char *argv[]) {
         }
 
         slog::info << "Reading input" << slog::endl;
-        cv::Mat frame = cv::imread(FLAGS_i, cv::IMREAD_COLOR);
-        const bool isVideo = frame.empty();
-        cv::VideoCapture cap;
-        if (isVideo && !(FLAGS_i == "cam" ? cap.open(0) : cap.open(FLAGS_i))) {
-            throw std::logic_error("Cannot open input file or camera: " + FLAGS_i);
-        }
-        const size_t width  = isVideo ? (size_t) cap.get(cv::CAP_PROP_FRAME_WIDTH) : frame.size().width;
-        const size_t height = isVideo ? (size_t) cap.get(cv::CAP_PROP_FRAME_HEIGHT) : frame.size().height;
+        const std::vector<std::string> inputs = split(FLAGS_i, ',');
+        std::vector<std::unique_ptr<Camera>> cameras;
+        for (size_t i = 0; i < inputs.size(); i++) {
+            cameras.emplace_back(new Camera(inputs[i], inputs.size() == 1 ? "Detection results"
+                                                                          : "Detection results " + std::to_string(i)));
+        }
+        const bool isVideo = std::any_of(cameras.begin(), cameras.end(),
+                                         [](const std::unique_ptr<Camera> &camera) { return camera->isVideo; });
         // -----------------------------------------------------------------------------------------------------
 
         // --------------------------- 1. Load inference engine -------------------------------------
@@ -510,7 +781,7 @@ int main(int argc, char *argv[]) {
 
         std::set<std::string> loadedDevices;
 
-        PersonDetection personDetection;
+        PersonDetection personDetection(cameras.size());
         PersonAttribsDetection personAttribs;
         PersonReIdentification personReId;
 
@@ -557,20 +828,60 @@ int main(int argc, char *argv[]) {
         // -----------------------------------------------------------------------------------------------------
 
         // --------------------------- 2. Read IR models and load them to devices ------------------------------
-        Load(personDetection).into(ie, FLAGS_d);
-        Load(personAttribs).into(ie, FLAGS_d_pa);
-        Load(personReId).into(ie, FLAGS_d_reid);
+        CpuPlan cpuPlan;
+        if (!FLAGS_cpu_weights.empty()) {
+            std::vector<float> weights = CpuPlan::parseWeights(FLAGS_cpu_weights);
+            if (weights.size() != 3) {
+                throw std::logic_error("-cpu_weights must have a weight for each of the person detection, attributes and reidentification models");
+            }
+            cpuPlan.add("PersonDetection", FLAGS_d, weights[0]);
+            if (personAttribs.enabled()) {
+                cpuPlan.add("PersonAttribs", FLAGS_d_pa, weights[1]);
+            }
+            if (personReId.enabled()) {
+                cpuPlan.add("PersonReId", FLAGS_d_reid, weights[2]);
+            }
+            cpuPlan.report();
+        }
+        // config() sets the dynamic batch state of the networks, so it runs here before their loads share them
+        const std::map<std::string, std::string> personDetectionConfig = cpuPlan.config("PersonDetection");
+        const std::map<std::string, std::string> personAttribsConfig =
+            personAttribs.config(cpuPlan.config("PersonAttribs"), FLAGS_d_pa);
+        const std::map<std::string, std::string> personReIdConfig =
+            personReId.config(cpuPlan.config("PersonReId"), FLAGS_d_reid);
+        ParallelLoader loader;
+        loader.add("PersonDetection", [&]() {
+            Load(personDetection).into(ie, FLAGS_d, personDetectionConfig);
+        });
+        if (personAttribs.enabled()) {
+            loader.add("PersonAttribs", [&]() {
+                Load(personAttribs).into(ie, FLAGS_d_pa, personAttribsConfig);
+            });
+        }
+        if (personReId.enabled()) {
+            loader.add("PersonReId", [&]() {
+                Load(personReId).into(ie, FLAGS_d_reid, personReIdConfig);
+            });
+        }
+        loader.run();
+        loader.report();
         // -----------------------------------------------------------------------------------------------------
 
         // --------------------------- 3. Do inference ---------------------------------------------------------
-        Blob::Ptr frameBlob;  // Blob to be used to keep processed frame data
         ROI cropRoi;  // cropped image coordinates
         Blob::Ptr roiBlob;  // This blob contains data from cropped image (vehicle or license plate)
         cv::Mat person;  // Mat object containing person data cropped by openCV
+        std::vector<Camera*> batch;  // the cameras of the frames detected together, in the order of the frames
+        std::vector<Camera*> nextBatch;  // detected while the persons of batch are inferred in the pipelined mode
+        bool isNextBatchSubmitted = false;
+        size_t batchesNumber = 0;
 
         /** Start inference & calc performance **/
         typedef std::chrono::duration<double, std::ratio<1, 1000>> ms;
         auto total_t0 = std::chrono::high_resolution_clock::now();
+        for (auto &camera : cameras) {
+            camera->start = camera->end = total_t0;
+        }
         slog::info << "Start inference " << slog::endl;
 
         std::cout << "To close the application, press 'CTRL+C' here";
@@ -579,230 +890,326 @@ int main(int argc, char *argv[]) {
         }
         std::cout << std::endl;
 
-        cv::Size graphSize{static_cast<int>(cap.get(cv::CAP_PROP_FRAME_WIDTH) / 4), 60};
-        Presenter presenter(FLAGS_u, static_cast<int>(cap.get(cv::CAP_PROP_FRAME_HEIGHT)) - graphSize.height - 10, graphSize);
+        cv::VideoCapture &firstCap = cameras.front()->cap;
+        cv::Size graphSize{static_cast<int>(firstCap.get(cv::CAP_PROP_FRAME_WIDTH) / 4), 60};
+        Presenter presenter(FLAGS_u, static_cast<int>(firstCap.get(cv::CAP_PROP_FRAME_HEIGHT)) - graphSize.height - 10, graphSize);
+
+        auto detectionStart = std::chrono::high_resolution_clock::now();
+        auto submitDetection = [&](const std::vector<Camera*> &frameCameras, bool isNext) {
+            for (Camera *camera : frameCameras) {
+                const cv::Mat &image = isNext ? camera->nextFrame : camera->frame;
+                if (FLAGS_auto_resize) {
+                    // just wrap Mat object with Blob::Ptr without additional memory allocation
+                    Blob::Ptr &imageBlob = isNext ? camera->nextFrameBlob : camera->frameBlob;
+                    imageBlob = wrapMat2Blob(image);
+                    personDetection.setRoiBlob(imageBlob);
+                } else {
+                    personDetection.enqueue(image);
+                }
+            }
+            detectionStart = std::chrono::high_resolution_clock::now();
+            personDetection.submitRequest();
+        };
 
         do {
-            // get and enqueue the next frame (in case of video)
-            if (isVideo && !cap.read(frame)) {
-                if (frame.empty())
-                    break;  // end of video file
-                throw std::logic_error("Failed to get frame from cv::VideoCapture");
-            }
-            if (FLAGS_auto_resize) {
-                // just wrap Mat object with Blob::Ptr without additional memory allocation
-                frameBlob = wrapMat2Blob(frame);
-                personDetection.setRoiBlob(frameBlob);
-            } else {
-                personDetection.enqueue(frame);
+            // get and enqueue the next frames of the videos unless they are already being detected, the images are
+            // detected once
+            if (!isNextBatchSubmitted) {
+                batch.clear();
+                for (auto &camera : cameras) {
+                    if (camera->isVideo ? camera->read(camera->frame) : 0 == batchesNumber) {
+                        batch.push_back(camera.get());
+                    }
+                }
+                if (batch.empty())
+                    break;
+                submitDetection(batch, false);
             }
+            isNextBatchSubmitted = false;
+            batchesNumber++;
             // --------------------------- Run Person detection inference --------------------------------------
-            auto t0 = std::chrono::high_resolution_clock::now();
-            personDetection.submitRequest();
             personDetection.wait();
-            auto t1 = std::chrono::high_resolution_clock::now();
-            ms detection = std::chrono::duration_cast<ms>(t1 - t0);
+            ms detection = std::chrono::duration_cast<ms>(std::chrono::high_resolution_clock::now() - detectionStart);
             // parse inference results internally (e.g. apply a threshold, etc)
             personDetection.fetchResults();
             // -------------------------------------------------------------------------------------------------
 
             // --------------------------- Process the results down to the pipeline ----------------------------
+            /* The persons of all the frames are enqueued to the same batches, so the cameras with few persons
+               don't infer short batches of their own */
             ms personAttribsNetworkTime(0), personReIdNetworktime(0);
             int personAttribsInferred = 0,  personReIdInferred = 0;
-            for (auto && result : personDetection.results) {
-                if (result.label == 1) {  // person
-                    if (FLAGS_auto_resize) {
-                        cropRoi.posX = (result.location.x < 0) ? 0 : result.location.x;
-                        cropRoi.posY = (result.location.y < 0) ? 0 : result.location.y;
-                        cropRoi.sizeX = std::min((size_t) result.location.width, width - cropRoi.posX);
-                        cropRoi.sizeY = std::min((size_t) result.location.height, height - cropRoi.posY);
-                        roiBlob = make_shared_blob(frameBlob, cropRoi);
-                    } else {
-                        // To crop ROI manually and allocate required memory (cv::Mat) again
-                        auto clippedRect = result.location & cv::Rect(0, 0, width, height);
-                        person = frame(clippedRect);
-                    }
-                    PersonAttribsDetection::AttributesAndColorPoints resPersAttrAndColor;
-                    std::string resPersReid = "";
-                    cv::Point top_color_p;
-                    cv::Point bottom_color_p;
-
-                    if (personAttribs.enabled()) {
-                        // --------------------------- Run Person Attributes Recognition -----------------------
+            size_t personsNumber = 0;
+            for (size_t frameIdx = 0; frameIdx < batch.size(); ++frameIdx) {
+                Camera &camera = *batch[frameIdx];
+                const size_t width = static_cast<size_t>(camera.frame.cols);
+                const size_t height = static_cast<size_t>(camera.frame.rows);
+                camera.persons.clear();
+                camera.firstPerson = personsNumber;
+                for (auto && result : personDetection.results[frameIdx]) {
+                    if (result.label == 1) {  // person
                         if (FLAGS_auto_resize) {
+                            cropRoi.posX = (result.location.x < 0) ? 0 : result.location.x;
+                            cropRoi.posY = (result.location.y < 0) ? 0 : result.location.y;
+                            cropRoi.sizeX = std::min((size_t) result.location.width, width - cropRoi.posX);
+                            cropRoi.sizeY = std::min((size_t) result.location.height, height - cropRoi.posY);
+                            roiBlob = make_shared_blob(camera.frameBlob, cropRoi);
                             personAttribs.setRoiBlob(roiBlob);
+                            personReId.setRoiBlob(roiBlob);
                         } else {
+                            // To crop ROI manually and allocate required memory (cv::Mat) again
+                            auto clippedRect = result.location & cv::Rect(0, 0, width, height);
+                            person = camera.frame(clippedRect);
                             personAttribs.enqueue(person);
+                            personReId.enqueue(person);
                         }
+                        camera.persons.push_back(result);
+                    }
+                }
+                personsNumber += camera.persons.size();
+            }
 
-                        t0 = std::chrono::high_resolution_clock::now();
-                        personAttribs.submitRequest();
-                        personAttribs.wait();
-                        t1 = std::chrono::high_resolution_clock::now();
-                        personAttribsNetworkTime += std::chrono::duration_cast<ms>(t1 - t0);
-                        personAttribsInferred++;
-                        // --------------------------- Process outputs -----------------------------------------
-
-                        resPersAttrAndColor = personAttribs.GetPersonAttributes();
-
-                        top_color_p.x = static_cast<int>(resPersAttrAndColor.top_color_point.x) * person.cols;
-                        top_color_p.y = static_cast<int>(resPersAttrAndColor.top_color_point.y) * person.rows;
-
-                        bottom_color_p.x = static_cast<int>(resPersAttrAndColor.bottom_color_point.x) * person.cols;
-                        bottom_color_p.y = static_cast<int>(resPersAttrAndColor.bottom_color_point.y) * person.rows;
-
-
-                        cv::Rect person_rect(0, 0, person.cols, person.rows);
-
-                        // Define area around top color's location
-                        cv::Rect tc_rect;
-                        tc_rect.x = top_color_p.x - person.cols / 6;
-                        tc_rect.y = top_color_p.y - person.rows / 10;
-                        tc_rect.height = 2 * person.rows / 8;
-                        tc_rect.width = 2 * person.cols / 6;
-
-                        tc_rect = tc_rect & person_rect;
+            // ------------------- Run Person Attributes Recognition and Reidentification ----------------------
+            /* All the persons of the frames are inferred by both networks at once, the time of a network
+               is from the start of the inferences until its last batch is ready */
+            auto t0 = std::chrono::high_resolution_clock::now();
+            if (personsNumber > 0) {
+                personAttribs.submitRequest();
+                personReId.submitRequest();
+            }
 
-                        // Define area around bottom color's location
-                        cv::Rect bc_rect;
-                        bc_rect.x = bottom_color_p.x - person.cols / 6;
-                        bc_rect.y = bottom_color_p.y - person.rows / 10;
-                        bc_rect.height =  2 * person.rows / 8;
-                        bc_rect.width = 2 * person.cols / 6;
+            /* In the pipelined mode the next frames are read and detected by other requests while
+               the persons of these frames are inferred, the frames are still shown in their order */
+            if (FLAGS_pipeline && isVideo) {
+                nextBatch.clear();
+                for (auto &camera : cameras) {
+                    if (camera->read(camera->nextFrame)) {
+                        nextBatch.push_back(camera.get());
+                    }
+                }
+                if (!nextBatch.empty()) {
+                    personDetection.next();
+                    submitDetection(nextBatch, true);
+                    isNextBatchSubmitted = true;
+                }
+            }
 
-                        bc_rect = bc_rect & person_rect;
+            if (personsNumber > 0) {
+                if (personAttribs.enabled()) {
+                    personAttribs.wait();
+                    personAttribsNetworkTime = std::chrono::duration_cast<ms>(std::chrono::high_resolution_clock::now() - t0);
+                    personAttribsInferred = static_cast<int>(personsNumber);
+                }
+                if (personReId.enabled()) {
+                    personReId.wait();
+                    personReIdNetworktime = std::chrono::duration_cast<ms>(std::chrono::high_resolution_clock::now() - t0);
+                    personReIdInferred = static_cast<int>(personsNumber);
+                }
+            }
 
-                        resPersAttrAndColor.top_color = PersonAttribsDetection::GetAvgColor(person(tc_rect));
-                        resPersAttrAndColor.bottom_color = PersonAttribsDetection::GetAvgColor(person(bc_rect));
+            // the outputs are copied from the requests on this thread, the cameras are processed concurrently then
+            for (Camera *camera : batch) {
+                camera->attributes.clear();
+                camera->reIdVectors.clear();
+                for (size_t personIdx = camera->firstPerson; personIdx < camera->firstPerson + camera->persons.size();
+                     ++personIdx) {
+                    if (personAttribs.enabled()) {
+                        camera->attributes.push_back(personAttribs.GetPersonAttributes(personIdx));
                     }
                     if (personReId.enabled()) {
-                        // --------------------------- Run Person Reidentification -----------------------------
-                        if (FLAGS_auto_resize) {
-                            personReId.setRoiBlob(roiBlob);
-                        } else {
-                            personReId.enqueue(person);
-                        }
-
-                        t0 = std::chrono::high_resolution_clock::now();
-                        personReId.submitRequest();
-                        personReId.wait();
-                        t1 = std::chrono::high_resolution_clock::now();
-
-                        personReIdNetworktime += std::chrono::duration_cast<ms>(t1 - t0);
-                        personReIdInferred++;
+                        camera->reIdVectors.push_back(personReId.getReidVec(personIdx));
+                    }
+                }
+            }
 
-                        auto reIdVector = personReId.getReidVec();
+            // the raw output of the cameras is printed by one stripe, so its lines don't interleave
+            cv::parallel_for_(cv::Range(0, static_cast<int>(batch.size())), [&](const cv::Range &range) {
+                for (int frameIdx = range.start; frameIdx < range.end; ++frameIdx) {
+                    Camera &camera = *batch[frameIdx];
+                    cv::Mat &frame = camera.frame;
+                    for (size_t personIdx = 0; personIdx < camera.persons.size(); ++personIdx) {
+                        const PersonDetection::Result &result = camera.persons[personIdx];
+                        cv::Mat person = frame(result.location & cv::Rect(0, 0, frame.cols, frame.rows));
+                        PersonAttribsDetection::AttributesAndColorPoints resPersAttrAndColor;
+                        std::string resPersReid = "";
+                        cv::Point top_color_p;
+                        cv::Point bottom_color_p;
+
+                        if (personAttribs.enabled()) {
+                            resPersAttrAndColor = camera.attributes[personIdx];
+                            top_color_p.x = static_cast<int>(resPersAttrAndColor.top_color_point.x) * person.cols;
+                            top_color_p.y = static_cast<int>(resPersAttrAndColor.top_color_point.y) * person.rows;
+
+                            bottom_color_p.x = static_cast<int>(resPersAttrAndColor.bottom_color_point.x) * person.cols;
+                            bottom_color_p.y = static_cast<int>(resPersAttrAndColor.bottom_color_point.y) * person.rows;
+
+
+                            cv::Rect person_rect(0, 0, person.cols, person.rows);
+
+                            // Define area around top color's location
+                            cv::Rect tc_rect;
+                            tc_rect.x = top_color_p.x - person.cols / 6;
+                            tc_rect.y = top_color_p.y - person.rows / 10;
+                            tc_rect.height = 2 * person.rows / 8;
+                            tc_rect.width = 2 * person.cols / 6;
+
+                            tc_rect = tc_rect & person_rect;
+
+                            // Define area around bottom color's location
+                            cv::Rect bc_rect;
+                            bc_rect.x = bottom_color_p.x - person.cols / 6;
+                            bc_rect.y = bottom_color_p.y - person.rows / 10;
+                            bc_rect.height =  2 * person.rows / 8;
+                            bc_rect.width = 2 * person.cols / 6;
+
+                            bc_rect = bc_rect & person_rect;
+
+                            resPersAttrAndColor.top_color = PersonAttribsDetection::GetAvgColor(person(tc_rect));
+                            resPersAttrAndColor.bottom_color = PersonAttribsDetection::GetAvgColor(person(bc_rect));
+                        }
+                        if (personReId.enabled()) {
+                            /* Check cosine similarity with the recently detected persons of all the cameras.
+                               If it's new person it is added to the gallery and new global
+                               ID is assigned to the person. Otherwise, ID of matched person
+                               is assigned to it. */
+                            auto foundId = personReId.findMatchingPerson(camera.reIdVectors[personIdx]);
+                            resPersReid = "REID: " + std::to_string(foundId);
+                        }
 
-                        /* Check cosine similarity with all previously detected persons.
-                           If it's new person it is added to the global Reid vector and
-                           new global ID is assigned to the person. Otherwise, ID of
-                           matched person is assigned to it. */
-                        auto foundId = personReId.findMatchingPerson(reIdVector);
-                        resPersReid = "REID: " + std::to_string(foundId);
-                    }
+                        // --------------------------- Process outputs -----------------------------------------
+                        if (!resPersAttrAndColor.attributes_strings.empty()) {
+                            cv::Rect image_area(0, 0, frame.cols, frame.rows);
+                            cv::Rect tc_label(result.location.x + result.location.width, result.location.y,
+                                              result.location.width / 4, result.location.height / 2);
+                            cv::Rect bc_label(result.location.x + result.location.width, result.location.y + result.location.height / 2,
+                                                result.location.width / 4, result.location.height / 2);
+
+                            frame(tc_label & image_area) = resPersAttrAndColor.top_color;
+                            frame(bc_label & image_area) = resPersAttrAndColor.bottom_color;
+
+                            for (size_t i = 0; i < resPersAttrAndColor.attributes_strings.size(); ++i) {
+                                cv::Scalar color;
+                                if (resPersAttrAndColor.attributes_indicators[i]) {
+                                    color = cv::Scalar(0, 255, 0);
+                                } else {
+                                    color = cv::Scalar(0, 0, 255);
+                                }
+                                cv::putText(frame,
+                                        resPersAttrAndColor.attributes_strings[i],
+                                        cv::Point2f(static_cast<float>(result.location.x + 5 * result.location.width / 4),
+                                                    static_cast<float>(result.location.y + 15 + 15 * i)),
+                                        cv::FONT_HERSHEY_COMPLEX_SMALL,
+                                        0.5,
+                                        color);
+                            }
 
-                    // --------------------------- Process outputs -----------------------------------------
-                    if (!resPersAttrAndColor.attributes_strings.empty()) {
-                        cv::Rect image_area(0, 0, frame.cols, frame.rows);
-                        cv::Rect tc_label(result.location.x + result.location.width, result.location.y,
-                                          result.location.width / 4, result.location.height / 2);
-                        cv::Rect bc_label(result.location.x + result.location.width, result.location.y + result.location.height / 2,
-                                            result.location.width / 4, result.location.height / 2);
-
-                        frame(tc_label & image_area) = resPersAttrAndColor.top_color;
-                        frame(bc_label & image_area) = resPersAttrAndColor.bottom_color;
-
-                        for (size_t i = 0; i < resPersAttrAndColor.attributes_strings.size(); ++i) {
-                            cv::Scalar color;
-                            if (resPersAttrAndColor.attributes_indicators[i]) {
-                                color = cv::Scalar(0, 255, 0);
-                            } else {
-                                color = cv::Scalar(0, 0, 255);
+                            if (FLAGS_r) {
+                                std::string output_attribute_string;
+                                for (size_t i = 0; i < resPersAttrAndColor.attributes_strings.size(); ++i)
+                                    if (resPersAttrAndColor.attributes_indicators[i])
+                                        output_attribute_string += resPersAttrAndColor.attributes_strings[i] + ",";
+                                std::cout << "Person Attributes results: " << output_attribute_string << std::endl;
+                                std::cout << "Person top color: " << resPersAttrAndColor.top_color << std::endl;
+                                std::cout << "Person bottom color: " << resPersAttrAndColor.bottom_color << std::endl;
                             }
+                        }
+                        if (!resPersReid.empty()) {
                             cv::putText(frame,
-                                    resPersAttrAndColor.attributes_strings[i],
-                                    cv::Point2f(static_cast<float>(result.location.x + 5 * result.location.width / 4),
-                                                static_cast<float>(result.location.y + 15 + 15 * i)),
-                                    cv::FONT_HERSHEY_COMPLEX_SMALL,
-                                    0.5,
-                                    color);
+                                        resPersReid,
+                                        cv::Point2f(static_cast<float>(result.location.x), static_cast<float>(result.location.y + 30)),
+                                        cv::FONT_HERSHEY_COMPLEX_SMALL,
+                                        0.6,
+                                        cv::Scalar(255, 255, 255));
+
+                            if (FLAGS_r) {
+                                std::cout << "Person Reidentification results:" << resPersReid << std::endl;
+                            }
                         }
+                        cv::rectangle(frame, result.location, cv::Scalar(0, 255, 0), 1);
+                    }
+                }
+            }, FLAGS_r ? 1.0 : -1.0);
+
+            for (Camera *camera : batch) {
+                cv::Mat &frame = camera->frame;
+                camera->framesNumber++;
+                camera->end = std::chrono::high_resolution_clock::now();
+                if (camera == cameras.front().get()) {
+                    presenter.drawGraphs(frame);
+                }
 
-                        if (FLAGS_r) {
-                            std::string output_attribute_string;
-                            for (size_t i = 0; i < resPersAttrAndColor.attributes_strings.size(); ++i)
-                                if (resPersAttrAndColor.attributes_indicators[i])
-                                    output_attribute_string += resPersAttrAndColor.attributes_strings[i] + ",";
-                            std::cout << "Person Attributes results: " << output_attribute_string << std::endl;
-                            std::cout << "Person top color: " << resPersAttrAndColor.top_color << std::endl;
-                            std::cout << "Person bottom color: " << resPersAttrAndColor.bottom_color << std::endl;
+                // --------------------------- Execution statistics --------------------------------------------
+                std::ostringstream out;
+                out << "Person detection time  : " << std::fixed << std::setprecision(2) << detection.count()
+                    << " ms ("
+                    << 1000.f / detection.count() << " fps)";
+                cv::putText(frame, out.str(), cv::Point2f(0, 20), cv::FONT_HERSHEY_TRIPLEX, 0.5,
+                            cv::Scalar(255, 0, 0));
+                if (personsNumber > 0) {
+                    if (personAttribs.enabled() && personAttribsInferred) {
+                        float average_time = static_cast<float>(personAttribsNetworkTime.count() / personAttribsInferred);
+                        out.str("");
+                        out << "Person Attributes Recognition time (averaged over " << personAttribsInferred
+                            << " detections) :" << std::fixed << std::setprecision(2) << average_time
+                            << " ms " << "(" << 1000.f / average_time << " fps)";
+                        cv::putText(frame, out.str(), cv::Point2f(0, 40), cv::FONT_HERSHEY_SIMPLEX, 0.5,
+                                    cv::Scalar(255, 0, 0));
+                        if (FLAGS_r && camera == batch.front()) {
+                            std::cout << out.str() << std::endl;;
                         }
                     }
-                    if (!resPersReid.empty()) {
-                        cv::putText(frame,
-                                    resPersReid,
-                                    cv::Point2f(static_cast<float>(result.location.x), static_cast<float>(result.location.y + 30)),
-                                    cv::FONT_HERSHEY_COMPLEX_SMALL,
-                                    0.6,
-                                    cv::Scalar(255, 255, 255));
-
-                        if (FLAGS_r) {
-                            std::cout << "Person Reidentification results:" << resPersReid << std::endl;
+                    if (personReId.enabled() && personReIdInferred) {
+                        float average_time = static_cast<float>(personReIdNetworktime.count() / personReIdInferred);
+                        out.str("");
+                        out << "Person Reidentification time (averaged over " << personReIdInferred
+                            << " detections) :" << std::fixed << std::setprecision(2) << average_time
+                            << " ms " << "(" << 1000.f / average_time << " fps)";
+                        cv::putText(frame, out.str(), cv::Point2f(0, 60), cv::FONT_HERSHEY_SIMPLEX, 0.5,
+                                    cv::Scalar(255, 0, 0));
+                        if (FLAGS_r && camera == batch.front()) {
+                            std::cout << out.str() << std::endl;;
                         }
                     }
-                    cv::rectangle(frame, result.location, cv::Scalar(0, 255, 0), 1);
                 }
-            }
-
-            presenter.drawGraphs(frame);
-
-            // --------------------------- Execution statistics ------------------------------------------------
-            std::ostringstream out;
-            out << "Person detection time  : " << std::fixed << std::setprecision(2) << detection.count()
-                << " ms ("
-                << 1000.f / detection.count() << " fps)";
-            cv::putText(frame, out.str(), cv::Point2f(0, 20), cv::FONT_HERSHEY_TRIPLEX, 0.5,
-                        cv::Scalar(255, 0, 0));
-            if (personDetection.results.size()) {
-                if (personAttribs.enabled() && personAttribsInferred) {
-                    float average_time = static_cast<float>(personAttribsNetworkTime.count() / personAttribsInferred);
+                if (cameras.size() > 1) {
                     out.str("");
-                    out << "Person Attributes Recognition time (averaged over " << personAttribsInferred
-                        << " detections) :" << std::fixed << std::setprecision(2) << average_time
-                        << " ms " << "(" << 1000.f / average_time << " fps)";
-                    cv::putText(frame, out.str(), cv::Point2f(0, 40), cv::FONT_HERSHEY_SIMPLEX, 0.5,
+                    out << "Camera " << camera->input << " : " << std::fixed << std::setprecision(2) << camera->fps()
+                        << " fps";
+                    cv::putText(frame, out.str(), cv::Point2f(0, 80), cv::FONT_HERSHEY_SIMPLEX, 0.5,
                                 cv::Scalar(255, 0, 0));
-                    if (FLAGS_r) {
-                        std::cout << out.str() << std::endl;;
-                    }
                 }
-                if (personReId.enabled() && personReIdInferred) {
-                    float average_time = static_cast<float>(personReIdNetworktime.count() / personReIdInferred);
-                    out.str("");
-                    out << "Person Reidentification time (averaged over " << personReIdInferred
-                        << " detections) :" << std::fixed << std::setprecision(2) << average_time
-                        << " ms " << "(" << 1000.f / average_time << " fps)";
-                    cv::putText(frame, out.str(), cv::Point2f(0, 60), cv::FONT_HERSHEY_SIMPLEX, 0.5,
-                                cv::Scalar(255, 0, 0));
-                    if (FLAGS_r) {
-                        std::cout << out.str() << std::endl;;
-                    }
+
+                if (!FLAGS_no_show) {
+                    cv::imshow(camera->windowName, frame);
                 }
             }
 
             if (!FLAGS_no_show) {
-                cv::imshow("Detection results", frame);
                 // for still images wait until any key is pressed, for video 1 ms is enough per frame
                 const int key = cv::waitKey(isVideo ? 1 : 0);
                 if (27 == key)  // Esc
                     break;
                 presenter.handleKey(key);
             }
+            if (isNextBatchSubmitted) {
+                for (Camera *camera : nextBatch) {
+                    std::swap(camera->frame, camera->nextFrame);
+                    std::swap(camera->frameBlob, camera->nextFrameBlob);
+                }
+                std::swap(batch, nextBatch);
+            }
         } while (isVideo);
+        if (isNextBatchSubmitted) {
+            personDetection.wait();
+        }
 
         auto total_t1 = std::chrono::high_resolution_clock::now();
         ms total = std::chrono::duration_cast<ms>(total_t1 - total_t0);
         slog::info << "Total Inference time: " << total.count() << slog::endl;
+        for (const auto &camera : cameras) {
+            slog::info << "Camera " << camera->input << ": " << camera->framesNumber << " frames, " << camera->fps()
+                       << " FPS" << slog::endl;
+        }
 
         /** Show performace results **/
         if (FLAGS_pc) {
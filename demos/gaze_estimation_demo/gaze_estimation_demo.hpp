@@ -41,8 +41,18 @@ static const char performance_counter_message[] = "Optional. Enable per-layer pe
 static const char thresh_output_message[] = "Optional. Probability threshold for Face Detector. The default value is 0.5.";
 static const char raw_output_message[] = "Optional. Output inference results as raw values.";
 static const char fd_reshape_message[] = "Optional. Reshape Face Detector network so that its input resolution has the same aspect ratio as the input frame.";
+static const char fd_interval_message[] = "Optional. Run Face Detector every <number> frames, the face boxes of the frames in between "
+                                          "follow the facial landmarks of the previous frame. A face is detected again as soon as "
+                                          "it is lost. The default value is 1 to detect the faces on every frame.";
+static const char target_latency_message[] = "Optional. Target latency of a frame in milliseconds. If the smoothed latency exceeds it, "
+                                             "the demo runs Face Detector less often and then estimates fewer faces, "
+                                             "and restores them when the latency drops. The decisions are logged. "
+                                             "The default value is 0 to disable the adaptation.";
 static const char no_show_processed_video[] = "Optional. Do not show processed video.";
 static const char utilization_monitors_message[] = "Optional. List of monitors to show initially.";
+static const char cache_dir_message[] = "Optional. Directory to cache compiled networks in. Later runs import the cached networks "
+                                        "instead of compiling them if the model, device and config didn't change. "
+                                        "Devices without network export support compile on each run.";
 
 DEFINE_bool(h, false, help_message);
 DEFINE_string(i, "cam", video_message);
@@ -56,11 +66,14 @@ DEFINE_string(d_hp, "CPU", target_device_message_hp);
 DEFINE_string(d_lm, "CPU", target_device_message_lm);
 DEFINE_string(res, "", camera_resolution_message);
 DEFINE_bool(fd_reshape, false, fd_reshape_message);
+DEFINE_uint32(fd_interval, 1, fd_interval_message);
+DEFINE_double(target_latency, 0, target_latency_message);
 DEFINE_bool(pc, false, performance_counter_message);
 DEFINE_bool(r, false, raw_output_message);
 DEFINE_double(t, 0.5, thresh_output_message);
 DEFINE_bool(no_show, false, no_show_processed_video);
 DEFINE_string(u, "", utilization_monitors_message);
+DEFINE_string(cache_dir, "", cache_dir_message);
 
 /**
 * \brief This function shows a help message
@@ -83,9 +96,12 @@ static void showUsage() {
     std::cout << "    -d_lm \"<device>\"         " << target_device_message_lm << std::endl;
     std::cout << "    -res \"<WxH>\"             " << camera_resolution_message << std::endl;
     std::cout << "    -fd_reshape              " << fd_reshape_message << std::endl;
+    std::cout << "    -fd_interval \"<number>\"  " << fd_interval_message << std::endl;
+    std::cout << "    -target_latency \"<ms>\"   " << target_latency_message << std::endl;
     std::cout << "    -no_show                 " << no_show_processed_video << std::endl;
     std::cout << "    -pc                      " << performance_counter_message << std::endl;
     std::cout << "    -r                       " << raw_output_message << std::endl;
     std::cout << "    -t                       " << thresh_output_message << std::endl;
     std::cout << "    -u                       " << utilization_monitors_message << std::endl;
+    std::cout << "    -cache_dir \"<path>\"      " << cache_dir_message << std::endl;
 }
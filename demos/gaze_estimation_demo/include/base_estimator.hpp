@@ -4,13 +4,16 @@
 
 #pragma once
 
+#include <vector>
+
 #include "face_inference_results.hpp"
 
 namespace gaze_estimation {
 class BaseEstimator {
 public:
+    // Estimates all the faces of the image, the faces are inferred in batches if the device supports it
     void virtual estimate(const cv::Mat& image,
-                          FaceInferenceResults& outputResults) = 0;
+                          std::vector<FaceInferenceResults>& outputResults) = 0;
     void virtual printPerformanceCounts() const = 0;
     virtual ~BaseEstimator() = default;
 };
@@ -21,8 +21,13 @@ public:
                  const std::string& modelPath,
                  const std::string& deviceName,
                  double detectionConfidenceThreshold,
-                 bool enableReshape);
+                 bool enableReshape,
+                 const std::string& cacheDir = "");
     std::vector<FaceInferenceResults> detect(const cv::Mat& image);
+    // Compiles the reshaped network for the image sizes expected later, if the reshape is enabled
+    void warmUp(const std::vector<cv::Size>& imageSizes);
+    // The number of the compilations of the reshaped network at detect()
+    std::size_t getReloadsNum() const;
     void printPerformanceCounts() const;
     ~FaceDetector();
 
@@ -37,5 +42,6 @@ private:
     bool enableReshape;
 
     void adjustBoundingBox(cv::Rect& boundingBox) const;
+    std::vector<unsigned long> inputDimsFor(const cv::Size& imageSize) const;
 };
 }  // namespace gaze_estimation
@@ -0,0 +1,46 @@
+// Copyright (C) 2018 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "face_inference_results.hpp"
+#include "face_detector.hpp"
+
+namespace gaze_estimation {
+// Runs the face detector every detectionInterval frames or when a face is lost, the face boxes of the frames
+// in between are derived from the landmarks of the previous frame
+class FaceTracker {
+public:
+    FaceTracker(FaceDetector& faceDetector, std::size_t detectionInterval);
+    // Returns the faces of the frame with the bounding boxes and the detection confidences set
+    std::vector<FaceInferenceResults> track(const cv::Mat& image);
+    // Follows the faces returned by the last track() by their estimated landmarks
+    void update(const std::vector<FaceInferenceResults>& faces);
+    std::size_t getDetectionsNum() const;
+    void setDetectionInterval(std::size_t interval);
+    // Limits the number of the faces returned by track() to the most confident ones, 0 doesn't limit them
+    void setMaxFaces(std::size_t maxFaces);
+
+private:
+    struct Track {
+        float confidence;
+        // the face box in the units of the bounding rectangle of the landmarks, measured on the detection frame
+        cv::Rect2f boxInLandmarks;
+        cv::Rect nextBox;
+    };
+
+    FaceDetector& faceDetector;
+    std::size_t detectionInterval;
+    std::size_t framesSinceDetection;
+    std::size_t detectionsNum;
+    std::size_t maxFaces;
+    bool detected;  // the faces of the last track() are detected
+    std::vector<Track> tracks;
+};
+}  // namespace gaze_estimation
@@ -4,7 +4,9 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdio>
+#include <vector>
 #include <string>
 
 #include "face_inference_results.hpp"
@@ -18,9 +20,12 @@ public:
     GazeEstimator(InferenceEngine::Core& ie,
                   const std::string& modelPath,
                   const std::string& deviceName,
-                  bool doRollAlign = true);
+                  bool doRollAlign = true,
+                  const std::string& cacheDir = "",
+                  std::size_t maxBatchSize = 1,
+                  std::size_t requestsNum = 1);
     void virtual estimate(const cv::Mat& image,
-                          FaceInferenceResults& outputResults);
+                          std::vector<FaceInferenceResults>& outputResults);
     void virtual printPerformanceCounts() const;
     virtual ~GazeEstimator();
 
@@ -29,6 +34,9 @@ private:
     std::string outputBlobName;
     bool rollAlign;
     cv::Rect createEyeBoundingBox(const cv::Point2i& p1, const cv::Point2i& p2, float scale = 1.8) const;
-    void rotateImageAroundCenter(const cv::Mat& srcImage, cv::Mat& dstImage, float angle) const;
+    // The affine transform of the frame to the eye input blob, which rotates the eye by the angle
+    cv::Mat eyeTransform(const cv::Rect& eyeBoundingBox, float angle, const std::string& blobName) const;
+    void setInputs(const cv::Mat& image, FaceInferenceResults& outputResults,
+                   std::size_t batchIndex, std::size_t requestIndex);
 };
 }  // namespace gaze_estimation
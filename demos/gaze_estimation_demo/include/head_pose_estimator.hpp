@@ -4,7 +4,9 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdio>
+#include <vector>
 #include <string>
 
 #include "face_inference_results.hpp"
@@ -17,9 +19,12 @@ class HeadPoseEstimator: public BaseEstimator {
 public:
     HeadPoseEstimator(InferenceEngine::Core& ie,
                       const std::string& modelPath,
-                      const std::string& deviceName);
+                      const std::string& deviceName,
+                      const std::string& cacheDir = "",
+                      std::size_t maxBatchSize = 1,
+                      std::size_t requestsNum = 1);
     void virtual estimate(const cv::Mat& image,
-                          FaceInferenceResults& outputResults);
+                          std::vector<FaceInferenceResults>& outputResults);
     void virtual printPerformanceCounts() const;
     virtual ~HeadPoseEstimator();
 
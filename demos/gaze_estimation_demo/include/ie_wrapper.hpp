@@ -4,7 +4,9 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdio>
+#include <functional>
 #include <string>
 
 #include <map>
@@ -20,21 +22,50 @@
 #include <samples/common.hpp>
 
 namespace gaze_estimation {
+// A view of the memory of an item of a blob, valid until the network is reshaped
+template <typename T>
+struct BlobSpan {
+    T* data;
+    std::size_t size;
+
+    T* begin() const { return data; }
+    T* end() const { return data + size; }
+    T& operator[](std::size_t i) const { return data[i]; }
+};
+
 class IEWrapper {
 public:
+    // requestsNum infer requests are created, 0 creates the optimal number for the device
     IEWrapper(InferenceEngine::Core& ie,
               const std::string& modelPath,
-              const std::string& deviceName);
-    // For setting input blobs containing images
-    void setInputBlob(const std::string& blobName, const cv::Mat& image);
-    // For setting input blobs containing vectors of data
-    void setInputBlob(const std::string& blobName, const std::vector<float>& data);
-
-    // Get output blob content as a vector given its name
-    void getOutputBlob(const std::string& blobName, std::vector<float>& output);
+              const std::string& deviceName,
+              const std::string& cacheDir = "",
+              std::size_t maxBatchSize = 1,
+              std::size_t requestsNum = 1);
+    // For setting input blobs containing images, batchIndex is the item of the batch to set
+    void setInputBlob(const std::string& blobName, const cv::Mat& image,
+                      std::size_t batchIndex = 0, std::size_t requestIndex = 0);
+    // For setting input blobs containing images warped by the 2x3 affine transform of the image to the blob
+    // pixels, the image is sampled straight into the blob without the intermediate crops
+    void warpToInputBlob(const std::string& blobName, const cv::Mat& image, const cv::Mat& transform,
+                         std::size_t batchIndex = 0, std::size_t requestIndex = 0);
+    // For setting input blobs containing vectors of data of a single item of the batch
+    void setInputBlob(const std::string& blobName, const std::vector<float>& data,
+                      std::size_t batchIndex = 0, std::size_t requestIndex = 0);
+
+    // Get output blob content of an item of the batch as a vector given its name
+    void getOutputBlob(const std::string& blobName, std::vector<float>& output,
+                       std::size_t batchIndex = 0, std::size_t requestIndex = 0);
+
+    // The memory of an item of a FP32 input blob of the request to fill in place
+    BlobSpan<float> inputData(const std::string& blobName, std::size_t batchIndex = 0, std::size_t requestIndex = 0);
+    // The memory of an item of an output blob of the request, valid until the request is started again
+    BlobSpan<const float> outputData(const std::string& blobName,
+                                     std::size_t batchIndex = 0, std::size_t requestIndex = 0);
 
     void printPerlayerPerformance() const;
 
+    // The dimensions are of a single item, the batch dimension is 1
     const std::map<std::string, std::vector<unsigned long>>& getInputBlobDimsInfo() const;
     const std::map<std::string, std::vector<unsigned long>>& getOutputBlobDimsInfo() const;
 
@@ -43,20 +74,57 @@ public:
 
     void expectImageInput(const std::string& blobName) const;
 
-    void reshape(const std::map<std::string, std::vector<unsigned long>>& newBlobsDimsInfo);
-
-    void infer();
+    // Switches to the network compiled for the input dims, the network is compiled only for the dims which weren't
+    // compiled before. Returns true if it was compiled
+    bool reshape(const std::map<std::string, std::vector<unsigned long>>& newBlobsDimsInfo);
+    // Compiles the network for the input dims expected later, so switching to them by reshape() doesn't compile
+    // mid-stream, the current dims are kept
+    void warmUp(const std::vector<std::map<std::string, std::vector<unsigned long>>>& expectedBlobsDimsInfo);
+    // The number of the compilations of the network by reshape() after the first one and the warm-up
+    std::size_t getReloadsNum() const;
+
+    // The greatest number of items inferred at once, 1 if the device doesn't support the dynamic batching
+    std::size_t getMaxBatchSize() const;
+    // Sets the number of the items of the inputs, which the next inference of the request processes
+    void setBatchSize(std::size_t batchSize, std::size_t requestIndex = 0);
+
+    std::size_t getRequestsNum() const;
+
+    void infer(std::size_t requestIndex = 0);
+    void startAsync(std::size_t requestIndex = 0);
+    void wait(std::size_t requestIndex = 0);
+    // The callback is called in a thread of the plugin when an inference of the request completes
+    void setCompletionCallback(std::function<void()> callback, std::size_t requestIndex = 0);
+
+    // Infers itemsNum items in batches of up to getMaxBatchSize() items, the batches are in flight in all the
+    // requests at once. setInputs(requestIndex, begin, batchSize) fills the items [begin, begin + batchSize) at
+    // the batch indices from 0 and getOutputs(requestIndex, begin, batchSize) reads their results, the batches
+    // are read in order
+    using BatchCallback = std::function<void(std::size_t requestIndex, std::size_t begin, std::size_t batchSize)>;
+    void inferBatches(std::size_t itemsNum, const BatchCallback& setInputs, const BatchCallback& getOutputs);
 
 private:
     std::string modelPath;
     std::string deviceName;
+    std::string cacheDir;
+    std::size_t maxBatchSize;
+    std::size_t requestsNum;
     InferenceEngine::Core& ie;
     InferenceEngine::CNNNetwork network;
     InferenceEngine::ExecutableNetwork executableNetwork;
-    InferenceEngine::InferRequest request;
+    std::vector<InferenceEngine::InferRequest> requests;
     std::map<std::string, std::vector<unsigned long>> inputBlobsDimsInfo;
     std::map<std::string, std::vector<unsigned long>> outputBlobsDimsInfo;
 
+    // The networks compiled for the input dims, the members above are of the current one
+    struct ExecPart {
+        InferenceEngine::ExecutableNetwork executableNetwork;
+        std::vector<InferenceEngine::InferRequest> requests;
+        std::map<std::string, std::vector<unsigned long>> outputBlobsDimsInfo;
+    };
+    std::map<std::map<std::string, std::vector<unsigned long>>, ExecPart> execParts;
+    std::size_t reloadsNum;
+
     void setExecPart();
 };
 }  // namespace gaze_estimation
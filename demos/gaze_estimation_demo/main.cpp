@@ -8,7 +8,9 @@
 * \example gaze_estimation_demo/main.cpp
 */
 #include <gflags/gflags.h>
+#include <cstddef>
 #include <functional>
+#include <future>
 #include <iostream>
 #include <fstream>
 #include <random>
@@ -29,6 +31,8 @@
 
 #include <monitors/presenter.h>
 #include <samples/ocv_common.hpp>
+#include <samples/frame_prefetcher.hpp>
+#include <samples/latency_controller.hpp>
 #include <samples/slog.hpp>
 
 #include "gaze_estimation_demo.hpp"
@@ -36,6 +40,7 @@
 #include "face_inference_results.hpp"
 
 #include "face_detector.hpp"
+#include "face_tracker.hpp"
 
 #include "base_estimator.hpp"
 #include "head_pose_estimator.hpp"
@@ -72,6 +77,10 @@ bool ParseAndCheckCommandLine(int argc, char *argv[]) {
         throw std::logic_error("Parameter -m_hp is not set");
     if (FLAGS_m_lm.empty())
         throw std::logic_error("Parameter -m_lm is not set");
+    if (FLAGS_fd_interval == 0)
+        throw std::logic_error("Parameter -fd_interval must be positive");
+    if (FLAGS_target_latency < 0)
+        throw std::logic_error("Parameter -target_latency must not be negative");
 
     return true;
 }
@@ -87,11 +96,7 @@ int main(int argc, char *argv[]) {
         }
 
         slog::info << "Reading input" << slog::endl;
-        cv::VideoCapture cap;
-
-        if (!(FLAGS_i == "cam" ? cap.open(0) : cap.open(FLAGS_i))) {
-            throw std::logic_error("Cannot open input file or camera: " + FLAGS_i);
-        }
+        std::unique_ptr<VideoCaptureSource> source = VideoCaptureSource::open(FLAGS_i);
 
         // Parse camera resolution parameter and set camera resolution
         if (FLAGS_i == "cam" && FLAGS_res != "") {
@@ -103,13 +108,14 @@ int main(int argc, char *argv[]) {
             widthStream >> frameWidth;
             std::stringstream heightStream(FLAGS_res.substr(xPos + 1));
             heightStream >> frameHeight;
-            cap.set(cv::CAP_PROP_FRAME_WIDTH, frameWidth);
-            cap.set(cv::CAP_PROP_FRAME_HEIGHT, frameHeight);
+            source->capture().set(cv::CAP_PROP_FRAME_WIDTH, frameWidth);
+            source->capture().set(cv::CAP_PROP_FRAME_HEIGHT, frameHeight);
         }
+        FramePrefetcher frameReader(std::move(source));
 
         // read input (video) frame
         cv::Mat frame;
-        if (!cap.read(frame)) {
+        if (!frameReader.read(frame)) {
             throw std::logic_error("Failed to get frame from cv::VideoCapture");
         }
 
@@ -131,11 +137,28 @@ int main(int argc, char *argv[]) {
         }
 
         // Set up face detector and estimators
-        FaceDetector faceDetector(ie, FLAGS_m_fd, FLAGS_d_fd, FLAGS_t, FLAGS_fd_reshape);
-
-        HeadPoseEstimator headPoseEstimator(ie, FLAGS_m_hp, FLAGS_d_hp);
-        LandmarksEstimator landmarksEstimator(ie, FLAGS_m_lm, FLAGS_d_lm);
-        GazeEstimator gazeEstimator(ie, FLAGS_m, FLAGS_d);
+        FaceDetector faceDetector(ie, FLAGS_m_fd, FLAGS_d_fd, FLAGS_t, FLAGS_fd_reshape, FLAGS_cache_dir);
+        // the network reshaped for the frames is compiled before the first frame is timed
+        faceDetector.warmUp({frame.size()});
+        FaceTracker faceTracker(faceDetector, FLAGS_fd_interval);
+
+        // Degrades the face detection interval first, then the number of the estimated faces
+        LatencyController latencyController(FLAGS_target_latency);
+        latencyController.addKnob("face detection interval", 3, [&](int level) {
+            faceTracker.setDetectionInterval(FLAGS_fd_interval << level);
+        });
+        latencyController.addKnob("estimated faces", 3, [&](int level) {
+            const std::size_t maxFaces[] = {0, 4, 2, 1};
+            faceTracker.setMaxFaces(maxFaces[level]);
+        });
+
+        // The faces of a frame are inferred in batches of up to this size on the devices supporting the dynamic
+        // batching, so the latency of a frame grows slower than the number of the faces. The batches are pipelined
+        // through the optimal number of infer requests of each device
+        const std::size_t maxFacesBatch = 16;
+        HeadPoseEstimator headPoseEstimator(ie, FLAGS_m_hp, FLAGS_d_hp, FLAGS_cache_dir, maxFacesBatch, 0);
+        LandmarksEstimator landmarksEstimator(ie, FLAGS_m_lm, FLAGS_d_lm, FLAGS_cache_dir, maxFacesBatch, 0);
+        GazeEstimator gazeEstimator(ie, FLAGS_m, FLAGS_d, true, FLAGS_cache_dir, maxFacesBatch, 0);
 
         // Put pointers to all estimators in an array so that they could be processed uniformly in a loop
         BaseEstimator* estimators[] = {&headPoseEstimator, &landmarksEstimator, &gazeEstimator};
@@ -150,8 +173,8 @@ int main(int argc, char *argv[]) {
 
         int delay = 1;
         std::string windowName = "Gaze estimation demo";
-        cv::Size graphSize{static_cast<int>(cap.get(cv::CAP_PROP_FRAME_WIDTH) / 4), 60};
-        Presenter presenter(FLAGS_u, static_cast<int>(cap.get(cv::CAP_PROP_FRAME_HEIGHT)) - graphSize.height - 10, graphSize);
+        cv::Size graphSize{frame.cols / 4, 60};
+        Presenter presenter(FLAGS_u, frame.rows - graphSize.height - 10, graphSize);
         auto tIterationBegins = cv::getTickCount();
         do {
             if (flipImage) {
@@ -160,18 +183,29 @@ int main(int argc, char *argv[]) {
 
             // Infer results
             auto tInferenceBegins = cv::getTickCount();
-            auto inferenceResults = faceDetector.detect(frame);
-            for (auto& inferenceResult : inferenceResults) {
-                for (auto estimator : estimators) {
-                    estimator->estimate(frame, inferenceResult);
-                }
+            auto inferenceResults = faceTracker.track(frame);
+            if (!inferenceResults.empty()) {
+                // head pose and landmarks are independent, so they are inferred concurrently and write different
+                // fields of the results, the gaze needs both. The future waits in its destructor if the landmarks
+                // throw
+                auto headPoses = std::async(std::launch::async, [&] {
+                    headPoseEstimator.estimate(frame, inferenceResults);
+                });
+                landmarksEstimator.estimate(frame, inferenceResults);
+                headPoses.get();
+                gazeEstimator.estimate(frame, inferenceResults);
             }
+            faceTracker.update(inferenceResults);
             auto tInferenceEnds = cv::getTickCount();
 
             // Measure FPS
             auto tIterationEnds = cv::getTickCount();
             double overallTime = (tIterationEnds - tIterationBegins) * 1000. / cv::getTickFrequency();
             overallTimeAverager.updateValue(overallTime);
+            const std::string decision = latencyController.update(overallTime);
+            if (!decision.empty()) {
+                slog::info << decision << slog::endl;
+            }
             tIterationBegins = tIterationEnds;
 
             double inferenceTime = (tInferenceEnds - tInferenceBegins) * 1000. / cv::getTickFrequency();
@@ -215,8 +249,14 @@ int main(int argc, char *argv[]) {
                 flipImage = !flipImage;
             else
                 presenter.handleKey(key);
-        } while (cap.read(frame));
+        } while (frameReader.read(frame));
         std::cout << presenter.reportMeans() << '\n';
+        if (FLAGS_fd_interval > 1) {
+            slog::info << "Face Detection runs: " << faceTracker.getDetectionsNum() << slog::endl;
+        }
+        if (FLAGS_fd_reshape) {
+            slog::info << "Face Detection network reloads: " << faceDetector.getReloadsNum() << slog::endl;
+        }
     }
     catch (const std::exception& error) {
         slog::err << error.what() << slog::endl;
@@ -2,6 +2,8 @@
 // SPDX-License-Identifier: Apache-2.0
 //
 
+#include <cmath>
+#include <cstddef>
 #include <cstdio>
 #include <string>
 
@@ -15,8 +17,9 @@ FaceDetector::FaceDetector(InferenceEngine::Core& ie,
                            const std::string& modelPath,
                            const std::string& deviceName,
                            double detectionConfidenceThreshold,
-                           bool enableReshape):
-             ieWrapper(ie, modelPath, deviceName),
+                           bool enableReshape,
+                           const std::string& cacheDir):
+             ieWrapper(ie, modelPath, deviceName, cacheDir),
              detectionThreshold(detectionConfidenceThreshold),
              enableReshape(enableReshape) {
     const auto& inputInfo = ieWrapper.getInputBlobDimsInfo();
@@ -58,29 +61,53 @@ void FaceDetector::adjustBoundingBox(cv::Rect& boundingBox) const {
     }
 }
 
-std::vector<FaceInferenceResults> FaceDetector::detect(const cv::Mat& image) {
-    std::vector<FaceInferenceResults> detectionResult;
+std::vector<unsigned long> FaceDetector::inputDimsFor(const cv::Size& imageSize) const {
+    double imageAspectRatio = std::round(100. * imageSize.width / imageSize.height) / 100.;
+    double networkAspectRatio = std::round(100. * inputBlobDims[3] / inputBlobDims[2]) / 100.;
+    double aspectRatioThreshold = 0.01;
 
-    if (enableReshape) {
-        double imageAspectRatio = std::round(100. * image.cols / image.rows) / 100.;
-        double networkAspectRatio = std::round(100. * inputBlobDims[3] / inputBlobDims[2]) / 100.;
-        double aspectRatioThreshold = 0.01;
+    auto dims = inputBlobDims;
+    if (std::fabs(imageAspectRatio - networkAspectRatio) > aspectRatioThreshold) {
+        // Fix height and change width to make networkAspectRatio equal to imageAspectRatio
+        dims[3] = static_cast<unsigned long>(inputBlobDims[2] * imageAspectRatio);
+    }
+    return dims;
+}
 
-         if (std::fabs(imageAspectRatio - networkAspectRatio) > aspectRatioThreshold) {
-            std::cout << "Face Detection network is reshaped" << std::endl;
+void FaceDetector::warmUp(const std::vector<cv::Size>& imageSizes) {
+    if (!enableReshape) {
+        return;
+    }
+    std::vector<std::map<std::string, std::vector<unsigned long>>> expectedDims;
+    for (const auto& imageSize : imageSizes) {
+        expectedDims.push_back({{inputBlobName, inputDimsFor(imageSize)}});
+    }
+    ieWrapper.warmUp(expectedDims);
+}
+
+std::size_t FaceDetector::getReloadsNum() const {
+    return ieWrapper.getReloadsNum();
+}
 
-            // Fix height and change width to make networkAspectRatio equal to imageAspectRatio
-            inputBlobDims[3] = static_cast<unsigned long>(inputBlobDims[2] * imageAspectRatio);
+std::vector<FaceInferenceResults> FaceDetector::detect(const cv::Mat& image) {
+    std::vector<FaceInferenceResults> detectionResult;
 
-            ieWrapper.reshape({{inputBlobName, inputBlobDims}});
+    if (enableReshape) {
+        auto dims = inputDimsFor(image.size());
+        if (dims != inputBlobDims) {
+            inputBlobDims = dims;
+            // the networks compiled before for the dims are reused
+            if (ieWrapper.reshape({{inputBlobName, inputBlobDims}})) {
+                std::cout << "Face Detection network is reshaped" << std::endl;
+            }
         }
     }
 
     ieWrapper.setInputBlob(inputBlobName, image);
     ieWrapper.infer();
 
-    std::vector<float> rawDetectionResults;
-    ieWrapper.getOutputBlob(outputBlobName, rawDetectionResults);
+    // the detections are read in place from the output blob
+    auto rawDetectionResults = ieWrapper.outputData(outputBlobName);
 
     FaceInferenceResults tmp;
 
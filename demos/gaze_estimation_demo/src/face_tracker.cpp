@@ -0,0 +1,96 @@
+// Copyright (C) 2018 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include <vector>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "face_tracker.hpp"
+
+namespace gaze_estimation {
+FaceTracker::FaceTracker(FaceDetector& faceDetector, std::size_t detectionInterval):
+             faceDetector(faceDetector), detectionInterval(detectionInterval), framesSinceDetection(0),
+             detectionsNum(0), maxFaces(0), detected(false) {
+}
+
+std::vector<FaceInferenceResults> FaceTracker::track(const cv::Mat& image) {
+    std::vector<FaceInferenceResults> faces;
+
+    cv::Rect imageRect(0, 0, image.cols, image.rows);
+    bool lost = tracks.empty();
+    for (const auto& track : tracks) {
+        // the faces partially out of the frame are ignored by the detector, so they are lost here too
+        if (track.nextBox.area() <= 0 || (track.nextBox & imageRect) != track.nextBox) {
+            lost = true;
+        }
+    }
+
+    detected = lost || framesSinceDetection + 1 >= detectionInterval;
+    if (detected) {
+        framesSinceDetection = 0;
+        ++detectionsNum;
+        // the detections are in the descending order of the confidence
+        faces = faceDetector.detect(image);
+        if (maxFaces > 0 && faces.size() > maxFaces) {
+            faces.resize(maxFaces);
+        }
+        return faces;
+    }
+
+    ++framesSinceDetection;
+    for (const auto& track : tracks) {
+        FaceInferenceResults face;
+        face.faceDetectionConfidence = track.confidence;
+        face.faceBoundingBox = track.nextBox;
+        faces.push_back(face);
+    }
+    return faces;
+}
+
+void FaceTracker::update(const std::vector<FaceInferenceResults>& faces) {
+    if (detected) {
+        tracks.resize(faces.size());
+    }
+
+    for (std::size_t i = 0; i < faces.size(); ++i) {
+        auto& track = tracks[i];
+        const auto& face = faces[i];
+        const cv::Rect landmarksRect = face.faceLandmarks.empty() ? cv::Rect() : cv::boundingRect(face.faceLandmarks);
+        if (landmarksRect.area() <= 0) {
+            track.nextBox = cv::Rect();
+            continue;
+        }
+
+        if (detected) {
+            track.confidence = face.faceDetectionConfidence;
+            track.boxInLandmarks = cv::Rect2f(
+                static_cast<float>(face.faceBoundingBox.x - landmarksRect.x) / landmarksRect.width,
+                static_cast<float>(face.faceBoundingBox.y - landmarksRect.y) / landmarksRect.height,
+                static_cast<float>(face.faceBoundingBox.width) / landmarksRect.width,
+                static_cast<float>(face.faceBoundingBox.height) / landmarksRect.height);
+        }
+
+        track.nextBox = cv::Rect(
+            cvRound(landmarksRect.x + track.boxInLandmarks.x * landmarksRect.width),
+            cvRound(landmarksRect.y + track.boxInLandmarks.y * landmarksRect.height),
+            cvRound(track.boxInLandmarks.width * landmarksRect.width),
+            cvRound(track.boxInLandmarks.height * landmarksRect.height));
+    }
+}
+
+std::size_t FaceTracker::getDetectionsNum() const {
+    return detectionsNum;
+}
+
+void FaceTracker::setDetectionInterval(std::size_t interval) {
+    detectionInterval = interval;
+}
+
+void FaceTracker::setMaxFaces(std::size_t maxFaces) {
+    this->maxFaces = maxFaces;
+    if (maxFaces > 0 && tracks.size() > maxFaces) {
+        tracks.resize(maxFaces);
+    }
+}
+}  // namespace gaze_estimation
@@ -2,6 +2,7 @@
 // SPDX-License-Identifier: Apache-2.0
 //
 
+#include <cstddef>
 #include <string>
 #include <vector>
 #include <cmath>
@@ -17,8 +18,11 @@ const char BLOB_RIGHT_EYE_IMAGE[] = "right_eye_image";
 GazeEstimator::GazeEstimator(InferenceEngine::Core& ie,
                              const std::string& modelPath,
                              const std::string& deviceName,
-                             bool doRollAlign):
-               ieWrapper(ie, modelPath, deviceName), rollAlign(doRollAlign) {
+                             bool doRollAlign,
+                             const std::string& cacheDir,
+                             std::size_t maxBatchSize,
+                             std::size_t requestsNum):
+               ieWrapper(ie, modelPath, deviceName, cacheDir, maxBatchSize, requestsNum), rollAlign(doRollAlign) {
     const auto& inputInfo = ieWrapper.getInputBlobDimsInfo();
 
     for (const auto& blobName: {BLOB_HEAD_POSE_ANGLES, BLOB_LEFT_EYE_IMAGE, BLOB_RIGHT_EYE_IMAGE}) {
@@ -64,24 +68,33 @@ cv::Rect GazeEstimator::createEyeBoundingBox(const cv::Point2i& p1,
     return result;
 }
 
-void GazeEstimator::rotateImageAroundCenter(const cv::Mat& srcImage,
-                                              cv::Mat& dstImage,
-                                              float angle) const {
-    auto w = srcImage.cols;
-    auto h = srcImage.rows;
-
-    cv::Size size(w, h);
-
-    cv::Point2f center(static_cast<float>(w / 2), static_cast<float>(h / 2));
-
-    auto rotMatrix = cv::getRotationMatrix2D(center, static_cast<double>(angle), 1);
-    cv::warpAffine(srcImage, dstImage, rotMatrix, size, 1, cv::BORDER_REPLICATE);
+cv::Mat GazeEstimator::eyeTransform(const cv::Rect& eyeBoundingBox,
+                                    float angle,
+                                    const std::string& blobName) const {
+    if (eyeBoundingBox.area() <= 0) {
+        throw std::runtime_error("The eye bounding box is empty");
+    }
+    const auto& blobDims = ieWrapper.getInputBlobDimsInfo().at(blobName);
+    const double scaleX = static_cast<double>(blobDims[3]) / eyeBoundingBox.width;
+    const double scaleY = static_cast<double>(blobDims[2]) / eyeBoundingBox.height;
+    cv::Point2f center(eyeBoundingBox.x + eyeBoundingBox.width / 2.f, eyeBoundingBox.y + eyeBoundingBox.height / 2.f);
+
+    // rotate around the center of the eye, then scale it to the blob size and move it to the center of the blob
+    cv::Mat transform = cv::getRotationMatrix2D(center, static_cast<double>(angle), 1);
+    transform.row(0) *= scaleX;
+    transform.row(1) *= scaleY;
+    transform.at<double>(0, 2) += blobDims[3] / 2. - center.x * scaleX;
+    transform.at<double>(1, 2) += blobDims[2] / 2. - center.y * scaleY;
+    return transform;
 }
 
 
-void GazeEstimator::estimate(const cv::Mat& image,
-                             FaceInferenceResults& outputResults) {
-    std::vector<float> headPoseAngles(3);
+void GazeEstimator::setInputs(const cv::Mat& image,
+                              FaceInferenceResults& outputResults,
+                              std::size_t batchIndex,
+                              std::size_t requestIndex) {
+    // the angles are written to the blob in place
+    auto headPoseAngles = ieWrapper.inputData(BLOB_HEAD_POSE_ANGLES, batchIndex, requestIndex);
     auto roll = outputResults.headPoseAngles.z;
     headPoseAngles[0] = outputResults.headPoseAngles.x;
     headPoseAngles[1] = outputResults.headPoseAngles.y;
@@ -101,48 +114,55 @@ void GazeEstimator::estimate(const cv::Mat& image,
     outputResults.leftEyeMidpoint = leftEyeMidpoint;
     outputResults.rightEyeMidpoint = rightEyeMidpoint;
 
-    cv::Mat leftEyeImage(image, leftEyeBoundingBox);
-    cv::Mat rightEyeImage(image, rightEyeBoundingBox);
-
+    float angle = 0;
     if (rollAlign) {
         headPoseAngles[2] = 0;
-        cv::Mat leftEyeImageRotated, rightEyeImageRotated;
-        rotateImageAroundCenter(leftEyeImage, leftEyeImageRotated, roll);
-        rotateImageAroundCenter(rightEyeImage, rightEyeImageRotated, roll);
-        leftEyeImage = leftEyeImageRotated;
-        rightEyeImage = rightEyeImageRotated;
+        angle = roll;
     }
 
-    ieWrapper.setInputBlob(BLOB_HEAD_POSE_ANGLES, headPoseAngles);
-    ieWrapper.setInputBlob(BLOB_LEFT_EYE_IMAGE, leftEyeImage);
-    ieWrapper.setInputBlob(BLOB_RIGHT_EYE_IMAGE, rightEyeImage);
-
-    ieWrapper.infer();
-
-    std::vector<float> rawResults;
-
-    ieWrapper.getOutputBlob(outputBlobName, rawResults);
-
-    cv::Point3f gazeVector;
-    gazeVector.x = rawResults[0];
-    gazeVector.y = rawResults[1];
-    gazeVector.z = rawResults[2];
-
-    gazeVector = gazeVector / cv::norm(gazeVector);
-
-    if (rollAlign) {
-        // rotate gaze vector to compensate for the alignment
-        float cs = static_cast<float>(std::cos(static_cast<double>(roll) * CV_PI / 180.0));
-        float sn = static_cast<float>(std::sin(static_cast<double>(roll) * CV_PI / 180.0));
-
-        auto tmpX = gazeVector.x * cs + gazeVector.y * sn;
-        auto tmpY = -gazeVector.x * sn + gazeVector.y * cs;
-
-        gazeVector.x = tmpX;
-        gazeVector.y = tmpY;
-    }
+    // the eyes are cropped, aligned and resized by a single warp from the frame to the blobs
+    ieWrapper.warpToInputBlob(BLOB_LEFT_EYE_IMAGE, image, eyeTransform(leftEyeBoundingBox, angle, BLOB_LEFT_EYE_IMAGE),
+                              batchIndex, requestIndex);
+    ieWrapper.warpToInputBlob(BLOB_RIGHT_EYE_IMAGE, image,
+                              eyeTransform(rightEyeBoundingBox, angle, BLOB_RIGHT_EYE_IMAGE), batchIndex, requestIndex);
+}
 
-    outputResults.gazeVector = gazeVector;
+void GazeEstimator::estimate(const cv::Mat& image,
+                             std::vector<FaceInferenceResults>& outputResults) {
+    ieWrapper.inferBatches(outputResults.size(),
+        [&](std::size_t requestIndex, std::size_t begin, std::size_t batchSize) {
+            for (std::size_t i = 0; i < batchSize; ++i) {
+                setInputs(image, outputResults[begin + i], i, requestIndex);
+            }
+        },
+        [&](std::size_t requestIndex, std::size_t begin, std::size_t batchSize) {
+            for (std::size_t i = 0; i < batchSize; ++i) {
+                auto& faceResults = outputResults[begin + i];
+                auto rawResults = ieWrapper.outputData(outputBlobName, i, requestIndex);
+
+                cv::Point3f gazeVector;
+                gazeVector.x = rawResults[0];
+                gazeVector.y = rawResults[1];
+                gazeVector.z = rawResults[2];
+
+                gazeVector = gazeVector / cv::norm(gazeVector);
+
+                if (rollAlign) {
+                    // rotate gaze vector to compensate for the alignment
+                    auto roll = faceResults.headPoseAngles.z;
+                    float cs = static_cast<float>(std::cos(static_cast<double>(roll) * CV_PI / 180.0));
+                    float sn = static_cast<float>(std::sin(static_cast<double>(roll) * CV_PI / 180.0));
+
+                    auto tmpX = gazeVector.x * cs + gazeVector.y * sn;
+                    auto tmpY = -gazeVector.x * sn + gazeVector.y * cs;
+
+                    gazeVector.x = tmpX;
+                    gazeVector.y = tmpY;
+                }
+
+                faceResults.gazeVector = gazeVector;
+            }
+        });
 }
 
 void GazeEstimator::printPerformanceCounts() const {
@@ -2,6 +2,7 @@
 // SPDX-License-Identifier: Apache-2.0
 //
 
+#include <cstddef>
 #include <string>
 #include <vector>
 
@@ -17,8 +18,11 @@ const std::pair<const char*, float cv::Point3f::*> OUTPUTS[] = {
 
 HeadPoseEstimator::HeadPoseEstimator(InferenceEngine::Core& ie,
                                      const std::string& modelPath,
-                                     const std::string& deviceName):
-                   ieWrapper(ie, modelPath, deviceName) {
+                                     const std::string& deviceName,
+                                     const std::string& cacheDir,
+                                     std::size_t maxBatchSize,
+                                     std::size_t requestsNum):
+                   ieWrapper(ie, modelPath, deviceName, cacheDir, maxBatchSize, requestsNum) {
     inputBlobName = ieWrapper.expectSingleInput();
     ieWrapper.expectImageInput(inputBlobName);
 
@@ -40,19 +44,22 @@ HeadPoseEstimator::HeadPoseEstimator(InferenceEngine::Core& ie,
 }
 
 void HeadPoseEstimator::estimate(const cv::Mat& image,
-                                 FaceInferenceResults& outputResults) {
-    auto faceBoundingBox = outputResults.faceBoundingBox;
-    auto faceCrop(cv::Mat(image, faceBoundingBox));
-
-    ieWrapper.setInputBlob(inputBlobName, faceCrop);
-    ieWrapper.infer();
-
-    std::vector<float> outputValue;
-
-    for (const auto &output: OUTPUTS) {
-        ieWrapper.getOutputBlob(output.first, outputValue);
-        outputResults.headPoseAngles.*output.second = outputValue[0];
-    }
+                                 std::vector<FaceInferenceResults>& outputResults) {
+    ieWrapper.inferBatches(outputResults.size(),
+        [&](std::size_t requestIndex, std::size_t begin, std::size_t batchSize) {
+            for (std::size_t i = 0; i < batchSize; ++i) {
+                auto faceCrop(cv::Mat(image, outputResults[begin + i].faceBoundingBox));
+                ieWrapper.setInputBlob(inputBlobName, faceCrop, i, requestIndex);
+            }
+        },
+        [&](std::size_t requestIndex, std::size_t begin, std::size_t batchSize) {
+            for (std::size_t i = 0; i < batchSize; ++i) {
+                for (const auto &output: OUTPUTS) {
+                    outputResults[begin + i].headPoseAngles.*output.second =
+                        ieWrapper.outputData(output.first, i, requestIndex)[0];
+                }
+            }
+        });
 }
 
 void HeadPoseEstimator::printPerformanceCounts() const {
@@ -2,10 +2,17 @@
 // SPDX-License-Identifier: Apache-2.0
 //
 
+#include <algorithm>
+#include <cstddef>
+#include <functional>
 #include <map>
 #include <string>
 #include <vector>
 
+#include <samples/infer_request_pool.hpp>
+#include <samples/mapped_weights.hpp>
+#include <samples/network_cache.hpp>
+
 #include "ie_wrapper.hpp"
 
 using namespace InferenceEngine;
@@ -14,9 +21,17 @@ namespace gaze_estimation {
 
 IEWrapper::IEWrapper(InferenceEngine::Core& ie,
                      const std::string& modelPath,
-                     const std::string& deviceName):
-           modelPath(modelPath), deviceName(deviceName), ie(ie) {
-    network = ie.ReadNetwork(modelPath);
+                     const std::string& deviceName,
+                     const std::string& cacheDir,
+                     std::size_t maxBatchSize,
+                     std::size_t requestsNum):
+           modelPath(modelPath), deviceName(deviceName), cacheDir(cacheDir), maxBatchSize(maxBatchSize),
+           requestsNum(requestsNum), ie(ie), reloadsNum(0) {
+    // only CPU and GPU plugins support the dynamic batching, other devices infer the items one by one
+    if (0 == this->maxBatchSize || (deviceName.find("CPU") != 0 && deviceName.find("GPU") != 0)) {
+        this->maxBatchSize = 1;
+    }
+    network = readNetworkMapped(ie, modelPath);
     setExecPart();
 }
 
@@ -54,12 +69,35 @@ void IEWrapper::setExecPart() {
         layerData->setPrecision(Precision::FP32);
     }
 
-    executableNetwork = ie.LoadNetwork(network, deviceName);
-    request = executableNetwork.CreateInferRequest();
+    std::map<std::string, std::string> config;
+    if (maxBatchSize > 1) {
+        // the dims above are of the network of batch 1, the blobs are allocated for maxBatchSize items and
+        // SetBatch() limits an inference to the items which are set
+        network.setBatchSize(maxBatchSize);
+        config[PluginConfigParams::KEY_DYN_BATCH_ENABLED] = PluginConfigParams::YES;
+    }
+    executableNetwork = loadNetworkCached(ie, network, modelPath, deviceName, config, cacheDir);
+    const std::size_t createdNum = 0 == requestsNum ? defaultInferRequestsNum(executableNetwork, deviceName)
+                                                    : requestsNum;
+    requests.clear();
+    for (std::size_t i = 0; i < createdNum; ++i) {
+        requests.push_back(executableNetwork.CreateInferRequest());
+    }
+    execParts[inputBlobsDimsInfo] = {executableNetwork, requests, outputBlobsDimsInfo};
+}
+
+static unsigned long itemSize(const std::vector<unsigned long>& dims) {
+    unsigned long dimsProduct = 1;
+    for (auto const& dim : dims) {
+        dimsProduct *= dim;
+    }
+    return dimsProduct;
 }
 
 void IEWrapper::setInputBlob(const std::string& blobName,
-                             const cv::Mat& image) {
+                             const cv::Mat& image,
+                             std::size_t batchIndex,
+                             std::size_t requestIndex) {
     auto blobDims = inputBlobsDimsInfo[blobName];
 
     if (blobDims.size() != 4) {
@@ -70,41 +108,76 @@ void IEWrapper::setInputBlob(const std::string& blobName,
     cv::Mat resizedImage;
     cv::resize(image, resizedImage, scaledSize, 0, 0, cv::INTER_CUBIC);
 
-    auto inputBlob = request.GetBlob(blobName);
-    matU8ToBlob<PrecisionTrait<Precision::U8>::value_type>(resizedImage, inputBlob);
+    auto inputBlob = requests.at(requestIndex).GetBlob(blobName);
+    matU8ToBlob<PrecisionTrait<Precision::U8>::value_type>(resizedImage, inputBlob, static_cast<int>(batchIndex));
 }
 
-void IEWrapper::setInputBlob(const std::string& blobName,
-                             const std::vector<float>& data) {
-    auto blobDims = inputBlobsDimsInfo[blobName];
-    unsigned long dimsProduct = 1;
-    for (auto const& dim : blobDims) {
-        dimsProduct *= dim;
-    }
-    if (dimsProduct != data.size()) {
+void IEWrapper::warpToInputBlob(const std::string& blobName,
+                                const cv::Mat& image,
+                                const cv::Mat& transform,
+                                std::size_t batchIndex,
+                                std::size_t requestIndex) {
+    auto blobDims = inputBlobsDimsInfo.at(blobName);
+
+    if (blobDims.size() != 4 || blobDims[1] != static_cast<unsigned long>(image.channels())) {
         throw std::runtime_error("Input data does not match size of the blob");
     }
-    auto inputBlob = request.GetBlob(blobName);
-    auto buffer = inputBlob->buffer().as<InferenceEngine::PrecisionTrait<InferenceEngine::Precision::FP32>::value_type *>();
-    for (unsigned long int i = 0; i < data.size(); ++i) {
-        buffer[i] = data[i];
+
+    const int height = static_cast<int>(blobDims[2]);
+    const int width = static_cast<int>(blobDims[3]);
+    cv::Mat warpedImage;
+    cv::warpAffine(image, warpedImage, transform, cv::Size(width, height), cv::INTER_CUBIC, cv::BORDER_REPLICATE);
+
+    // the planes of the item of the NCHW blob are filled in place by the split
+    auto inputBlob = requests.at(requestIndex).GetBlob(blobName);
+    auto buffer = inputBlob->buffer().as<PrecisionTrait<Precision::U8>::value_type *>()
+        + batchIndex * itemSize(blobDims);
+    std::vector<cv::Mat> planes;
+    for (unsigned long c = 0; c < blobDims[1]; ++c) {
+        planes.emplace_back(height, width, CV_8UC1, buffer + c * height * width);
     }
+    cv::split(warpedImage, planes);
 }
 
-void IEWrapper::getOutputBlob(const std::string& blobName,
-                              std::vector<float> &output) {
-    output.clear();
-    auto blobDims = outputBlobsDimsInfo[blobName];
-    auto dataSize = 1;
-    for (auto dim : blobDims) {
-        dataSize *= dim;
+void IEWrapper::setInputBlob(const std::string& blobName,
+                             const std::vector<float>& data,
+                             std::size_t batchIndex,
+                             std::size_t requestIndex) {
+    auto buffer = inputData(blobName, batchIndex, requestIndex);
+    if (buffer.size != data.size()) {
+        throw std::runtime_error("Input data does not match size of the blob");
     }
-    auto outputBlob = request.GetBlob(blobName);
-    auto buffer = outputBlob->buffer().as<InferenceEngine::PrecisionTrait<InferenceEngine::Precision::FP32>::value_type *>();
+    std::copy(data.begin(), data.end(), buffer.begin());
+}
+
+void IEWrapper::getOutputBlob(const std::string& blobName,
+                              std::vector<float> &output,
+                              std::size_t batchIndex,
+                              std::size_t requestIndex) {
+    auto buffer = outputData(blobName, batchIndex, requestIndex);
+    output.assign(buffer.begin(), buffer.end());
+}
 
-    for (int i = 0; i < dataSize; ++i) {
-        output.push_back(buffer[i]);
+BlobSpan<float> IEWrapper::inputData(const std::string& blobName,
+                                     std::size_t batchIndex,
+                                     std::size_t requestIndex) {
+    auto blobDims = inputBlobsDimsInfo.at(blobName);
+    if (blobDims.size() != 2) {
+        throw std::runtime_error("Input \"" + blobName + "\" is not a FP32 vector");
     }
+    const unsigned long dataSize = itemSize(blobDims);
+    auto inputBlob = requests.at(requestIndex).GetBlob(blobName);
+    auto buffer = inputBlob->buffer().as<InferenceEngine::PrecisionTrait<InferenceEngine::Precision::FP32>::value_type *>();
+    return {buffer + batchIndex * dataSize, dataSize};
+}
+
+BlobSpan<const float> IEWrapper::outputData(const std::string& blobName,
+                                            std::size_t batchIndex,
+                                            std::size_t requestIndex) {
+    const unsigned long dataSize = itemSize(outputBlobsDimsInfo.at(blobName));
+    auto outputBlob = requests.at(requestIndex).GetBlob(blobName);
+    auto buffer = outputBlob->buffer().as<const InferenceEngine::PrecisionTrait<InferenceEngine::Precision::FP32>::value_type *>();
+    return {buffer + batchIndex * dataSize, dataSize};
 }
 
 const std::map<std::string, std::vector<unsigned long>>& IEWrapper::getInputBlobDimsInfo() const {
@@ -138,15 +211,82 @@ void IEWrapper::expectImageInput(const std::string& blobName) const {
     }
 }
 
-void IEWrapper::infer() {
-    request.Infer();
+std::size_t IEWrapper::getMaxBatchSize() const {
+    return maxBatchSize;
+}
+
+void IEWrapper::setBatchSize(std::size_t batchSize, std::size_t requestIndex) {
+    if (0 == batchSize || batchSize > maxBatchSize) {
+        throw std::runtime_error(modelPath + ": the batch size is out of the range [1, " +
+                                 std::to_string(maxBatchSize) + "]");
+    }
+    if (maxBatchSize > 1) {
+        requests.at(requestIndex).SetBatch(static_cast<int>(batchSize));
+    }
+}
+
+std::size_t IEWrapper::getRequestsNum() const {
+    return requests.size();
 }
 
-void IEWrapper::reshape(const std::map<std::string, std::vector<unsigned long> > &newBlobsDimsInfo) {
+void IEWrapper::infer(std::size_t requestIndex) {
+    requests.at(requestIndex).Infer();
+}
+
+void IEWrapper::startAsync(std::size_t requestIndex) {
+    requests.at(requestIndex).StartAsync();
+}
+
+void IEWrapper::wait(std::size_t requestIndex) {
+    requests.at(requestIndex).Wait(IInferRequest::WaitMode::RESULT_READY);
+}
+
+void IEWrapper::setCompletionCallback(std::function<void()> callback, std::size_t requestIndex) {
+    requests.at(requestIndex).SetCompletionCallback(callback);
+}
+
+void IEWrapper::inferBatches(std::size_t itemsNum, const BatchCallback& setInputs, const BatchCallback& getOutputs) {
+    const std::size_t batchesNum = (itemsNum + maxBatchSize - 1) / maxBatchSize;
+    auto batchSize = [&](std::size_t batch) {
+        return std::min(maxBatchSize, itemsNum - batch * maxBatchSize);
+    };
+    // the batch b is inferred by the request b % requests.size(), the batches [finished, started) are in flight
+    std::size_t started = 0, finished = 0;
+    try {
+        for (; finished < batchesNum; ++finished) {
+            for (; started < batchesNum && started - finished < requests.size(); ++started) {
+                const std::size_t requestIndex = started % requests.size();
+                setBatchSize(batchSize(started), requestIndex);
+                setInputs(requestIndex, started * maxBatchSize, batchSize(started));
+                startAsync(requestIndex);
+            }
+            const std::size_t requestIndex = finished % requests.size();
+            wait(requestIndex);
+            getOutputs(requestIndex, finished * maxBatchSize, batchSize(finished));
+        }
+    } catch (...) {
+        // the requests must not be in flight when the blobs are filled again
+        for (; finished < started; ++finished) {
+            wait(finished % requests.size());
+        }
+        throw;
+    }
+}
+
+bool IEWrapper::reshape(const std::map<std::string, std::vector<unsigned long> > &newBlobsDimsInfo) {
     if (inputBlobsDimsInfo.size() != newBlobsDimsInfo.size()) {
         throw std::runtime_error("Mismatch in the number of blobs being reshaped");
     }
 
+    auto cached = execParts.find(newBlobsDimsInfo);
+    if (cached != execParts.end()) {
+        inputBlobsDimsInfo = cached->first;
+        executableNetwork = cached->second.executableNetwork;
+        requests = cached->second.requests;
+        outputBlobsDimsInfo = cached->second.outputBlobsDimsInfo;
+        return false;
+    }
+
     auto inputShapes = network.getInputShapes();
     for (auto it = newBlobsDimsInfo.begin(); it != newBlobsDimsInfo.end(); ++it) {
         auto blobName = it->first;
@@ -157,12 +297,29 @@ void IEWrapper::reshape(const std::map<std::string, std::vector<unsigned long> >
     }
     network.reshape(inputShapes);
     setExecPart();
+    ++reloadsNum;
+    return true;
+}
+
+void IEWrapper::warmUp(const std::vector<std::map<std::string, std::vector<unsigned long>>>& expectedBlobsDimsInfo) {
+    // the compilations at the warm-up aren't reloads
+    const auto currentBlobsDimsInfo = inputBlobsDimsInfo;
+    const std::size_t currentReloadsNum = reloadsNum;
+    for (const auto& blobsDimsInfo : expectedBlobsDimsInfo) {
+        reshape(blobsDimsInfo);
+    }
+    reshape(currentBlobsDimsInfo);
+    reloadsNum = currentReloadsNum;
+}
+
+std::size_t IEWrapper::getReloadsNum() const {
+    return reloadsNum;
 }
 
 void IEWrapper::printPerlayerPerformance() const {
     std::cout << "\n-----------------START-----------------" << std::endl;
     std::cout << "Performance for " << modelPath << " model\n" << std::endl;
-    printPerformanceCounts(request, std::cout, getFullDeviceName(ie, deviceName), false);
+    printPerformanceCounts(requests.front(), std::cout, getFullDeviceName(ie, deviceName), false);
     std::cout << "------------------END------------------\n" << std::endl;
 }
 }  // namespace gaze_estimation
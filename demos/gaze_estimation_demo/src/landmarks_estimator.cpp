@@ -2,6 +2,7 @@
 // SPDX-License-Identifier: Apache-2.0
 //
 
+#include <cstddef>
 #include <string>
 #include <vector>
 
@@ -10,8 +11,11 @@
 namespace gaze_estimation {
 LandmarksEstimator::LandmarksEstimator(InferenceEngine::Core& ie,
                                        const std::string& modelPath,
-                                       const std::string& deviceName):
-                    ieWrapper(ie, modelPath, deviceName) {
+                                       const std::string& deviceName,
+                                       const std::string& cacheDir,
+                                       std::size_t maxBatchSize,
+                                       std::size_t requestsNum):
+                    ieWrapper(ie, modelPath, deviceName, cacheDir, maxBatchSize, requestsNum) {
     inputBlobName = ieWrapper.expectSingleInput();
     ieWrapper.expectImageInput(inputBlobName);
 
@@ -30,21 +34,27 @@ LandmarksEstimator::LandmarksEstimator(InferenceEngine::Core& ie,
 }
 
 void LandmarksEstimator::estimate(const cv::Mat& image,
-                                  FaceInferenceResults& outputResults) {
-    auto faceBoundingBox = outputResults.faceBoundingBox;
-    auto faceCrop(cv::Mat(image, faceBoundingBox));
+                                  std::vector<FaceInferenceResults>& outputResults) {
+    ieWrapper.inferBatches(outputResults.size(),
+        [&](std::size_t requestIndex, std::size_t begin, std::size_t batchSize) {
+            for (std::size_t i = 0; i < batchSize; ++i) {
+                auto faceCrop(cv::Mat(image, outputResults[begin + i].faceBoundingBox));
+                ieWrapper.setInputBlob(inputBlobName, faceCrop, i, requestIndex);
+            }
+        },
+        [&](std::size_t requestIndex, std::size_t begin, std::size_t batchSize) {
+            for (std::size_t i = 0; i < batchSize; ++i) {
+                auto& faceResults = outputResults[begin + i];
+                auto faceBoundingBox = faceResults.faceBoundingBox;
+                auto rawLandmarks = ieWrapper.outputData(outputBlobName, i, requestIndex);
 
-    ieWrapper.setInputBlob(inputBlobName, faceCrop);
-    ieWrapper.infer();
-    std::vector<float> rawLandmarks;
-
-    ieWrapper.getOutputBlob(outputBlobName, rawLandmarks);
-
-    for (unsigned long i = 0; i < rawLandmarks.size() / 2; ++i) {
-        int x = static_cast<int>(rawLandmarks[2 * i] * faceCrop.cols + faceBoundingBox.tl().x);
-        int y = static_cast<int>(rawLandmarks[2 * i + 1] * faceCrop.rows + faceBoundingBox.tl().y);
-        outputResults.faceLandmarks.push_back(cv::Point2i(x, y));
-    }
+                for (unsigned long j = 0; j < rawLandmarks.size / 2; ++j) {
+                    int x = static_cast<int>(rawLandmarks[2 * j] * faceBoundingBox.width + faceBoundingBox.tl().x);
+                    int y = static_cast<int>(rawLandmarks[2 * j + 1] * faceBoundingBox.height + faceBoundingBox.tl().y);
+                    faceResults.faceLandmarks.push_back(cv::Point2i(x, y));
+                }
+            }
+        });
 }
 
 void LandmarksEstimator::printPerformanceCounts() const {
@@ -19,6 +19,17 @@ static const char no_show_processed_video[] = "Optional. Do not show processed v
 static const char black_background[] = "Optional. Show black background.";
 static const char raw_output_message[] = "Optional. Output inference results as raw values.";
 static const char utilization_monitors_message[] = "Optional. List of monitors to show initially.";
+static const char cache_dir_message[] = "Optional. Directory to cache compiled networks in. Later runs import the cached networks "
+                                        "instead of compiling them if the model, device and config didn't change. "
+                                        "Devices without network export support compile on each run.";
+static const char nireq_message[] = "Optional. Number of infer requests kept in flight in the async mode. "
+                                    "0 uses the optimal number for the device: at least 2, 4 for MYRIAD and HDDL if the device does not report it. "
+                                    "The requests of -d MULTI:<device1>(<requests1>),<device2> are split between the devices, "
+                                    "0 gives each device its number in brackets or its optimal number.";
+static const char native_maps_message[] = "Optional. Find the keypoints on the feature maps of the network resolution and refine them "
+                                          "to subpixel positions instead of upsampling all the feature maps, which is several times faster.";
+static const char pc_report_message[] = "Optional. Aggregate the per-layer performance counters of all the inferences "
+                                        "and write their mean, 95th percentile and top layers to the JSON file.";
 
 DEFINE_bool(h, false, help_message);
 DEFINE_string(i, "cam", video_message);
@@ -29,6 +40,10 @@ DEFINE_bool(no_show, false, no_show_processed_video);
 DEFINE_bool(black, false, black_background);
 DEFINE_bool(r, false, raw_output_message);
 DEFINE_string(u, "", utilization_monitors_message);
+DEFINE_string(cache_dir, "", cache_dir_message);
+DEFINE_uint32(nireq, 0, nireq_message);
+DEFINE_string(pc_report, "", pc_report_message);
+DEFINE_bool(native_maps, false, native_maps_message);
 
 /**
 * @brief This function shows a help message
@@ -47,4 +62,8 @@ static void showUsage() {
     std::cout << "    -black                     " << black_background << std::endl;
     std::cout << "    -r                         " << raw_output_message << std::endl;
     std::cout << "    -u                         " << utilization_monitors_message << std::endl;
+    std::cout << "    -cache_dir \"<path>\"        " << cache_dir_message << std::endl;
+    std::cout << "    -nireq \"<integer>\"         " << nireq_message << std::endl;
+    std::cout << "    -pc_report \"<path>\"        " << pc_report_message << std::endl;
+    std::cout << "    -native_maps               " << native_maps_message << std::endl;
 }
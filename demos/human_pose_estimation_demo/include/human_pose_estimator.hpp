@@ -10,7 +10,9 @@
 #include <inference_engine.hpp>
 #include <opencv2/core/core.hpp>
 
-#include "human_pose.hpp"
+#include <samples/infer_request_pool.hpp>
+#include <pose/human_pose.hpp>
+#include <pose/peak.hpp>
 
 namespace human_pose_estimation {
 class HumanPoseEstimator {
@@ -19,15 +21,14 @@ public:
 
     HumanPoseEstimator(const std::string& modelPath,
                        const std::string& targetDeviceName,
-                       bool enablePerformanceReport = false);
-    std::vector<HumanPose> postprocessCurr();
+                       bool enablePerformanceReport = false,
+                       const std::string& cacheDir = "",
+                       bool nativeMaps = false);
     void reshape(const cv::Mat& image);
-    void frameToBlobCurr(const cv::Mat& image);
-    void frameToBlobNext(const cv::Mat& image);
-    void startCurr();
-    void startNext();
-    bool readyCurr();
-    void swapRequest();
+    // the network of the current input size loaded to every device of a MULTI: target device
+    const std::vector<DeviceNetwork>& getDeviceNetworks() const;
+    void frameToBlob(const cv::Mat& image, const InferenceEngine::InferRequest::Ptr& request);
+    std::vector<HumanPose> postprocessRequest(const InferenceEngine::InferRequest::Ptr& request);
     ~HumanPoseEstimator();
 
 private:
@@ -44,6 +45,7 @@ private:
                             const cv::Size& featureMapsSize,
                             const cv::Size& imageSize) const;
     bool inputWidthIsChanged(const cv::Size& imageSize);
+    void load();  // loads the network of the current input size
 
     int minJointsNumber;
     int stride;
@@ -56,15 +58,19 @@ private:
     cv::Size inputLayerSize;
     cv::Size imageSize;
     int upsampleRatio;
+    bool nativeMaps;  // the peaks are refined and the PAFs are sampled on the maps without upsampling
     InferenceEngine::Core ie;
     std::string targetDeviceName;
     InferenceEngine::CNNNetwork network;
-    InferenceEngine::ExecutableNetwork executableNetwork;
-    InferenceEngine::InferRequest::Ptr requestNext;
-    InferenceEngine::InferRequest::Ptr requestCurr;
+    std::vector<DeviceNetwork> deviceNetworks;
+    InferenceEngine::InferRequest::Ptr lastRequest;  // for the performance report
     std::string pafsBlobName;
     std::string heatmapsBlobName;
     bool enablePerformanceReport;
     std::string modelPath;
+    std::string cacheDir;
+    mutable PoseGroupingScratch groupingScratch;  // reused by the postprocessing of the frames
+    mutable cv::Mat paddedImage;  // the resized frame with the border of meanPixel, reused by the preprocessing
+    mutable cv::Rect paddedImageRoi;  // where the frame is resized to in paddedImage
 };
 }  // namespace human_pose_estimation
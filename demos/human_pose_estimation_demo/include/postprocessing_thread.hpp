@@ -0,0 +1,76 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include <samples/infer_request_pool.hpp>
+#include <pose/human_pose.hpp>
+
+#include "human_pose_estimator.hpp"
+
+namespace human_pose_estimation {
+/**
+* @brief Postprocesses the completed requests in a background thread in the order they are pushed, so the
+* postprocessing of a frame overlaps rendering the previous one and waiting for the next ones
+*/
+class PostprocessingThread {
+public:
+    using Result = InferRequestPool<cv::Mat>::Result;
+
+    struct Output {
+        Result result;
+        std::vector<HumanPose> poses;
+        std::exception_ptr error;
+    };
+
+    explicit PostprocessingThread(HumanPoseEstimator& estimator);
+    PostprocessingThread(const PostprocessingThread&) = delete;
+    PostprocessingThread& operator=(const PostprocessingThread&) = delete;
+
+    /**
+    * @brief Stops the thread, the results not postprocessed yet are dropped
+    */
+    ~PostprocessingThread();
+
+    /**
+    * @brief Passes a completed request to the thread, the request isn't used by the caller until it is popped
+    */
+    void push(Result result);
+
+    /**
+    * @brief Waits for the oldest pushed result, requires !empty(). Rethrows an exception of the postprocessing
+    */
+    Output pop();
+
+    /**
+    * @brief Returns true if every pushed result has been popped
+    */
+    bool empty() const {
+        return 0 == pending;
+    }
+
+private:
+    void run();
+
+    HumanPoseEstimator& estimator;
+    std::size_t pending;  // pushed but not popped, used by the caller only
+    std::deque<Result> inputs;
+    std::deque<Output> outputs;
+    bool stopped;
+    std::mutex mutex;
+    std::condition_variable pushed;
+    std::condition_variable postprocessed;
+    std::thread worker;
+};
+}  // namespace human_pose_estimation
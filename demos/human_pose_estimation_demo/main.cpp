@@ -8,6 +8,7 @@
 * \example human_pose_estimation_demo/main.cpp
 */
 
+#include <fstream>
 #include <vector>
 #include <chrono>
 
@@ -15,9 +16,14 @@
 
 #include <monitors/presenter.h>
 #include <samples/ocv_common.hpp>
+#include <samples/frame_prefetcher.hpp>
+#include <samples/infer_request_pool.hpp>
+#include <samples/perf_counters.hpp>
+#include <samples/async_presenter.hpp>
 
 #include "human_pose_estimation_demo.hpp"
 #include "human_pose_estimator.hpp"
+#include "postprocessing_thread.hpp"
 #include "render_human_pose.hpp"
 
 using namespace InferenceEngine;
@@ -55,22 +61,21 @@ int main(int argc, char* argv[]) {
             return EXIT_SUCCESS;
         }
 
-        HumanPoseEstimator estimator(FLAGS_m, FLAGS_d, FLAGS_pc);
-        cv::VideoCapture cap;
-        if (!(FLAGS_i == "cam" ? cap.open(0) : cap.open(FLAGS_i))) {
-            throw std::logic_error("Cannot open input file or camera: " + FLAGS_i);
-        }
+        const bool collectPerfCounters = FLAGS_pc || !FLAGS_pc_report.empty();
+        HumanPoseEstimator estimator(FLAGS_m, FLAGS_d, collectPerfCounters, FLAGS_cache_dir, FLAGS_native_maps);
+        FramePrefetcher frameReader(VideoCaptureSource::open(FLAGS_i));
 
         int delay = 33;
 
         // read input (video) frame
-        cv::Mat curr_frame; cap >> curr_frame;
         cv::Mat next_frame;
-        if (!cap.grab()) {
-            throw std::logic_error("Failed to get frame from cv::VideoCapture");
+        if (!frameReader.read(next_frame)) {
+            throw std::logic_error("Failed to get frame from " + FLAGS_i);
         }
+        const cv::Size frameSize = next_frame.size();
 
-        estimator.reshape(curr_frame);  // Do not measure network reshape, if it happened
+        estimator.reshape(next_frame);  // Do not measure network reshape, if it happened
+        InferRequestPool<cv::Mat> inferRequests(estimator.getDeviceNetworks(), FLAGS_nireq);
 
         std::cout << "To close the application, press 'CTRL+C' here";
         if (!FLAGS_no_show) {
@@ -79,12 +84,12 @@ int main(int argc, char* argv[]) {
         }
         std::cout << std::endl;
 
-        cv::Size graphSize{static_cast<int>(cap.get(cv::CAP_PROP_FRAME_WIDTH) / 4), 60};
-        Presenter presenter(FLAGS_u, static_cast<int>(cap.get(cv::CAP_PROP_FRAME_HEIGHT)) - graphSize.height - 10, graphSize);
-        std::vector<HumanPose> poses;
-        bool isLastFrame = false;
+        cv::Size graphSize{frameSize.width / 4, 60};
+        Presenter presenter(FLAGS_u, frameSize.height - graphSize.height - 10, graphSize);
+        AsyncPresenter display("Human Pose Estimation on " + FLAGS_d, !FLAGS_no_show, &presenter);
+        PerfCountersAggregator perfCounters;
+        PostprocessingThread postprocessing(estimator);
         bool isAsyncMode = false; // execution is always started in SYNC mode
-        bool isModeChanged = false; // set to true when execution mode is changed (SYNC<->ASYNC)
         bool blackBackground = FLAGS_black;
 
         typedef std::chrono::duration<double, std::ratio<1, 1000>> ms;
@@ -94,143 +99,128 @@ int main(int argc, char* argv[]) {
 
         while (true) {
             auto t0 = std::chrono::high_resolution_clock::now();
-            //here is the first asynchronus point:
-            //in the async mode we capture frame to populate the NEXT infer request
-            //in the regular mode we capture frame to the current infer request
-
-            if (!cap.read(next_frame)) {
-                if (next_frame.empty()) {
-                    isLastFrame = true; //end of video file
-                } else {
-                    throw std::logic_error("Failed to get frame from cv::VideoCapture");
-                }
+            //here is the asynchronus point:
+            //in the async mode we populate and start all the idle infer requests with the next frames
+            //in the regular mode we start one request only after the previous one is processed
+            while (!next_frame.empty() && inferRequests.hasIdle()
+                   && (isAsyncMode || (inferRequests.empty() && postprocessing.empty()))) {
+                estimator.frameToBlob(next_frame, inferRequests.idleRequest());
+                inferRequests.startAsync(next_frame);
+                next_frame = cv::Mat(); // the started request keeps the frame
+                frameReader.read(next_frame);
             }
-            if (isAsyncMode) {
-                if (isModeChanged) {
-                    estimator.frameToBlobCurr(curr_frame);
-                }
-                if (!isLastFrame) {
-                    estimator.frameToBlobNext(next_frame);
-                }
-            } else if (!isModeChanged) {
-                estimator.frameToBlobCurr(curr_frame);
+            // the completed requests are postprocessed by the thread while the oldest one is rendered,
+            // waiting for the inference only if the thread has nothing to postprocess
+            while (!inferRequests.empty() && (inferRequests.frontReady() || postprocessing.empty())) {
+                postprocessing.push(inferRequests.pop());
+            }
+            if (postprocessing.empty()) {
+                break; //end of video file
             }
             auto t1 = std::chrono::high_resolution_clock::now();
             double decode_time = std::chrono::duration_cast<ms>(t1 - t0).count();
 
-            t0 = std::chrono::high_resolution_clock::now();
             // Main sync point:
-            // in the trully Async mode we start the NEXT infer request, while waiting for the CURRENT to complete
-            // in the regular mode we start the CURRENT request and immediately wait for it's completion
-            if (isAsyncMode) {
-                if (isModeChanged) {
-                    estimator.startCurr();
-                }
-                if (!isLastFrame) {
-                    estimator.startNext();
-                }
-            } else if (!isModeChanged) {
-                estimator.startCurr();
-            }
-
-            if (estimator.readyCurr()) {
-                t1 = std::chrono::high_resolution_clock::now();
-                ms detection = std::chrono::duration_cast<ms>(t1 - t0);
-                t0 = std::chrono::high_resolution_clock::now();
-                ms wall = std::chrono::duration_cast<ms>(t0 - wallclock);
-                wallclock = t0;
-
-                t0 = std::chrono::high_resolution_clock::now();
-
-                if (!FLAGS_no_show) {
-                    if (blackBackground) {
-                        curr_frame = cv::Mat::zeros(curr_frame.size(), curr_frame.type());
-                    }
-                    std::ostringstream out;
-                    out << "OpenCV cap/render time: " << std::fixed << std::setprecision(2)
-                        << (decode_time + render_time) << " ms";
+            // we wait for the oldest postprocessed request, results are processed in the order of frames
+            PostprocessingThread::Output output = postprocessing.pop();
+            PostprocessingThread::Result& result = output.result;
+            const std::vector<HumanPose>& poses = output.poses;
+            cv::Mat& curr_frame = result.payload;
+            t0 = std::chrono::high_resolution_clock::now();
+            ms detection = std::chrono::duration_cast<ms>(t0 - result.startTime);
+            ms wall = std::chrono::duration_cast<ms>(t0 - wallclock);
+            wallclock = t0;
 
-                    cv::putText(curr_frame, out.str(), cv::Point2f(0, 25),
-                                cv::FONT_HERSHEY_TRIPLEX, 0.6, cv::Scalar(0, 255, 0));
+            if (!FLAGS_no_show) {
+                if (blackBackground) {
+                    curr_frame = cv::Mat::zeros(curr_frame.size(), curr_frame.type());
+                }
+                std::ostringstream out;
+                out << "OpenCV cap/render time: " << std::fixed << std::setprecision(2)
+                    << (decode_time + render_time) << " ms";
+
+                cv::putText(curr_frame, out.str(), cv::Point2f(0, 25),
+                            cv::FONT_HERSHEY_TRIPLEX, 0.6, cv::Scalar(0, 255, 0));
+                out.str("");
+                out << "Wallclock time " << (isAsyncMode ? "(TRUE ASYNC):      " : "(SYNC, press Tab): ");
+                out << std::fixed << std::setprecision(2) << wall.count()
+                    << " ms (" << 1000.f / wall.count() << " fps)";
+                cv::putText(curr_frame, out.str(), cv::Point2f(0, 50),
+                            cv::FONT_HERSHEY_TRIPLEX, 0.6, cv::Scalar(0, 0, 255));
+                if (!isAsyncMode) {  // In the true async mode, there is no way to measure detection time directly
                     out.str("");
-                    out << "Wallclock time " << (isAsyncMode ? "(TRUE ASYNC):      " : "(SYNC, press Tab): ");
-                    out << std::fixed << std::setprecision(2) << wall.count()
-                        << " ms (" << 1000.f / wall.count() << " fps)";
-                    cv::putText(curr_frame, out.str(), cv::Point2f(0, 50),
-                                cv::FONT_HERSHEY_TRIPLEX, 0.6, cv::Scalar(0, 0, 255));
-                    if (!isAsyncMode) {  // In the true async mode, there is no way to measure detection time directly
-                        out.str("");
-                        out << "Detection time  : " << std::fixed << std::setprecision(2) << detection.count()
-                        << " ms ("
-                        << 1000.f / detection.count() << " fps)";
-                        cv::putText(curr_frame, out.str(), cv::Point2f(0, 75), cv::FONT_HERSHEY_TRIPLEX, 0.6,
-                            cv::Scalar(255, 0, 0));
-                    }
+                    out << "Detection time  : " << std::fixed << std::setprecision(2) << detection.count()
+                    << " ms ("
+                    << 1000.f / detection.count() << " fps)";
+                    cv::putText(curr_frame, out.str(), cv::Point2f(0, 75), cv::FONT_HERSHEY_TRIPLEX, 0.6,
+                        cv::Scalar(255, 0, 0));
                 }
+            }
 
-                poses = estimator.postprocessCurr();
-
-                if (FLAGS_r) {
-                    if (!poses.empty()) {
-                        std::time_t result = std::time(nullptr);
-                        char timeString[sizeof("2020-01-01 00:00:00: ")];
-                        std::strftime(timeString, sizeof(timeString), "%Y-%m-%d %H:%M:%S: ", std::localtime(&result));
-                        std::cout << timeString;
-                     }
-
-                    for (HumanPose const& pose : poses) {
-                        std::stringstream rawPose;
-                        rawPose << std::fixed << std::setprecision(0);
-                        for (auto const& keypoint : pose.keypoints) {
-                            rawPose << keypoint.x << "," << keypoint.y << " ";
-                        }
-                        rawPose << pose.score;
-                        std::cout << rawPose.str() << std::endl;
+            if (FLAGS_r) {
+                if (!poses.empty()) {
+                    std::time_t now = std::time(nullptr);
+                    char timeString[sizeof("2020-01-01 00:00:00: ")];
+                    std::strftime(timeString, sizeof(timeString), "%Y-%m-%d %H:%M:%S: ", std::localtime(&now));
+                    std::cout << timeString;
+                 }
+
+                for (HumanPose const& pose : poses) {
+                    std::stringstream rawPose;
+                    rawPose << std::fixed << std::setprecision(0);
+                    for (auto const& keypoint : pose.keypoints) {
+                        rawPose << keypoint.x << "," << keypoint.y << " ";
                     }
+                    rawPose << pose.score;
+                    std::cout << rawPose.str() << std::endl;
                 }
-
-                if (!FLAGS_no_show) {
-                    presenter.drawGraphs(curr_frame);
-                    renderHumanPose(poses, curr_frame);
-                    cv::imshow("Human Pose Estimation on " + FLAGS_d, curr_frame);
-                    t1 = std::chrono::high_resolution_clock::now();
-                    render_time = std::chrono::duration_cast<ms>(t1 - t0).count();
-                }
-            }
-
-            if (isLastFrame) {
-                break;
             }
 
-            if (isModeChanged) {
-                isModeChanged = false;
+            if (!FLAGS_no_show) {
+                renderHumanPose(poses, curr_frame);
+                display.show(std::move(curr_frame));
+                t1 = std::chrono::high_resolution_clock::now();
+                render_time = std::chrono::duration_cast<ms>(t1 - t0).count();
             }
-
-            // Final point:
-            // in the truly Async mode we swap the NEXT and CURRENT requests for the next iteration
-            curr_frame = next_frame;
-            next_frame = cv::Mat();
-            if (isAsyncMode) {
-                estimator.swapRequest();
+            if (collectPerfCounters) {
+                perfCounters.add(*result.request);
             }
+            inferRequests.release(result);
 
-            const int key = cv::waitKey(delay) & 255;
+            // paces the video and pauses it as cv::waitKey() did, the display thread keeps showing the frames
+            const int key = display.waitKey(delay) & 255;
             if (key == 'p') {
                 delay = (delay == 0) ? 33 : 0;
             } else if (27 == key) { // Esc
                 break;
             } else if (9 == key) { // Tab
                 isAsyncMode ^= true;
-                isModeChanged = true;
             } else if (32 == key) { // Space
                 blackBackground ^= true;
             }
-            presenter.handleKey(key);
+            display.handleKey(key);
         }
+        display.stop();
 
         auto total_t1 = std::chrono::high_resolution_clock::now();
         ms total = std::chrono::duration_cast<ms>(total_t1 - total_t0);
         std::cout << "Total Inference time: " << total.count() << std::endl;
+        printDevicesThroughput(std::cout, inferRequests, total.count() / 1000);
+        const FramePrefetcher::Stats inputStats = frameReader.getStats();
+        if (0 != inputStats.droppedFrames) {
+            std::cout << "Dropped " << inputStats.droppedFrames << " of " << inputStats.readFrames
+                << " input frames" << std::endl;
+        }
+        if (FLAGS_pc) {
+            perfCounters.printHotspots(std::cout);
+        }
+        if (!FLAGS_pc_report.empty()) {
+            std::ofstream report(FLAGS_pc_report);
+            if (!report.is_open()) {
+                throw std::runtime_error("Can't open the performance counters report file " + FLAGS_pc_report);
+            }
+            perfCounters.writeJson(report, FLAGS_d);
+        }
         std::cout << presenter.reportMeans() << '\n';
     }
     catch (const std::exception& error) {
@@ -9,14 +9,18 @@
 #include <opencv2/imgproc/imgproc.hpp>
 
 #include <samples/common.hpp>
+#include <samples/mapped_weights.hpp>
+#include <samples/network_cache.hpp>
+#include <pose/peak.hpp>
 
 #include "human_pose_estimator.hpp"
-#include "peak.hpp"
 
 namespace human_pose_estimation {
 HumanPoseEstimator::HumanPoseEstimator(const std::string& modelPath,
                                        const std::string& targetDeviceName_,
-                                       bool enablePerformanceReport)
+                                       bool enablePerformanceReport,
+                                       const std::string& cacheDir,
+                                       bool nativeMaps)
     : minJointsNumber(3),
       stride(8),
       pad(cv::Vec4i::all(0)),
@@ -27,14 +31,16 @@ HumanPoseEstimator::HumanPoseEstimator(const std::string& modelPath,
       minSubsetScore(0.2f),
       inputLayerSize(-1, -1),
       upsampleRatio(4),
+      nativeMaps(nativeMaps),
       targetDeviceName(targetDeviceName_),
       enablePerformanceReport(enablePerformanceReport),
-      modelPath(modelPath) {
+      modelPath(modelPath),
+      cacheDir(cacheDir) {
     if (enablePerformanceReport) {
         ie.SetConfig({{InferenceEngine::PluginConfigParams::KEY_PERF_COUNT,
                        InferenceEngine::PluginConfigParams::YES}});
     }
-    network = ie.ReadNetwork(modelPath);
+    network = readNetworkMapped(ie, modelPath);
 
     const auto& inputInfo = network.getInputsInfo();
 
@@ -93,9 +99,13 @@ HumanPoseEstimator::HumanPoseEstimator(const std::string& modelPath,
                 "to have matching last two dimensions");
     }
 
-    executableNetwork = ie.LoadNetwork(network, targetDeviceName);
-    requestNext = executableNetwork.CreateInferRequestPtr();
-    requestCurr = executableNetwork.CreateInferRequestPtr();
+    load();
+}
+
+void HumanPoseEstimator::load() {
+    deviceNetworks = loadOnDevices(targetDeviceName, [this](const std::string& deviceName) {
+        return loadNetworkCached(ie, network, modelPath, deviceName, {}, cacheDir);
+    });
 }
 
 void HumanPoseEstimator::reshape(const cv::Mat& image){
@@ -111,50 +121,26 @@ void HumanPoseEstimator::reshape(const cv::Mat& image){
         input_shape[3] = inputLayerSize.width;
         input_shapes[input_name] = input_shape;
         network.reshape(input_shapes);
-        executableNetwork = ie.LoadNetwork(network, targetDeviceName);
-        requestNext = executableNetwork.CreateInferRequestPtr();
-        requestCurr = executableNetwork.CreateInferRequestPtr();
+        load();
         std::cout << "Reshape needed" << std::endl;
     }
 }
 
-void HumanPoseEstimator::frameToBlobCurr(const cv::Mat& image) {
-    CV_Assert(image.type() == CV_8UC3);
-    InferenceEngine::Blob::Ptr input = requestCurr->GetBlob(network.getInputsInfo().begin()->first);
-    auto buffer = input->buffer().as<InferenceEngine::PrecisionTrait<InferenceEngine::Precision::U8>::value_type *>();
-    preprocess(image, buffer);
+const std::vector<DeviceNetwork>& HumanPoseEstimator::getDeviceNetworks() const {
+    return deviceNetworks;
 }
 
-void HumanPoseEstimator::frameToBlobNext(const cv::Mat& image) {
+void HumanPoseEstimator::frameToBlob(const cv::Mat& image, const InferenceEngine::InferRequest::Ptr& request) {
     CV_Assert(image.type() == CV_8UC3);
-    InferenceEngine::Blob::Ptr input = requestNext->GetBlob(network.getInputsInfo().begin()->first);
+    InferenceEngine::Blob::Ptr input = request->GetBlob(network.getInputsInfo().begin()->first);
     auto buffer = input->buffer().as<InferenceEngine::PrecisionTrait<InferenceEngine::Precision::U8>::value_type *>();
     preprocess(image, buffer);
 }
 
-void HumanPoseEstimator::startCurr() {
-    requestCurr->StartAsync();
-}
-
-void HumanPoseEstimator::startNext() {
-    requestNext->StartAsync();
-}
-
-bool HumanPoseEstimator::readyCurr() {
-    if (InferenceEngine::OK == requestCurr->Wait(InferenceEngine::IInferRequest::WaitMode::RESULT_READY)) {
-        return true;
-    } else {
-        return false;
-    }
-}
-
-void HumanPoseEstimator::swapRequest() {
-    requestCurr.swap(requestNext);
-}
-
-std::vector<HumanPose> HumanPoseEstimator::postprocessCurr() {
-    InferenceEngine::Blob::Ptr pafsBlob = requestCurr->GetBlob(pafsBlobName);
-    InferenceEngine::Blob::Ptr heatMapsBlob = requestCurr->GetBlob(heatmapsBlobName);
+std::vector<HumanPose> HumanPoseEstimator::postprocessRequest(const InferenceEngine::InferRequest::Ptr& request) {
+    lastRequest = request;
+    InferenceEngine::Blob::Ptr pafsBlob = request->GetBlob(pafsBlobName);
+    InferenceEngine::Blob::Ptr heatMapsBlob = request->GetBlob(heatmapsBlobName);
     InferenceEngine::SizeVector heatMapDims = heatMapsBlob->getTensorDesc().getDims();
     std::vector<HumanPose> poses = postprocess(
             heatMapsBlob->buffer(),
@@ -169,12 +155,17 @@ std::vector<HumanPose> HumanPoseEstimator::postprocessCurr() {
 }
 
 void HumanPoseEstimator::preprocess(const cv::Mat& image, uint8_t* buffer) const {
-    cv::Mat resizedImage;
+    // The frame is resized right into the padded image, its border is filled only when the padding changes
+    const cv::Rect roi(pad(1), pad(0), inputLayerSize.width - pad(1) - pad(3), inputLayerSize.height - pad(0) - pad(2));
+    if (paddedImage.size() != inputLayerSize || paddedImageRoi != roi) {
+        paddedImage.create(inputLayerSize, CV_8UC3);
+        paddedImage.setTo(meanPixel);
+        paddedImageRoi = roi;
+    }
+    cv::Mat resizedImage = paddedImage(roi);
     double scale = inputLayerSize.height / static_cast<double>(image.rows);
     cv::resize(image, resizedImage, cv::Size(), scale, scale, cv::INTER_CUBIC);
-    cv::Mat paddedImage;
-    cv::copyMakeBorder(resizedImage, paddedImage, pad(0), pad(2), pad(1), pad(3),
-                       cv::BORDER_CONSTANT, meanPixel);
+    CV_Assert(resizedImage.data == paddedImage(roi).data);  // resize() didn't reallocate the destination
     std::vector<cv::Mat> planes(3);
     for (size_t pId = 0; pId < planes.size(); pId++) {
         planes[pId] = cv::Mat(inputLayerSize, CV_8UC1, buffer + pId * inputLayerSize.area());
@@ -194,7 +185,9 @@ std::vector<HumanPose> HumanPoseEstimator::postprocess(
                                   const_cast<float*>(
                                       heatMapsData + i * heatMapOffset)));
     }
-    resizeFeatureMaps(heatMaps);
+    if (!nativeMaps) {
+        resizeFeatureMaps(heatMaps);
+    }
 
     std::vector<cv::Mat> pafs(nPafs);
     for (size_t i = 0; i < pafs.size(); i++) {
@@ -203,51 +196,35 @@ std::vector<HumanPose> HumanPoseEstimator::postprocess(
                               const_cast<float*>(
                                   pafsData + i * pafOffset)));
     }
-    resizeFeatureMaps(pafs);
+    if (!nativeMaps) {
+        resizeFeatureMaps(pafs);
+    }
 
     std::vector<HumanPose> poses = extractPoses(heatMaps, pafs);
-    correctCoordinates(poses, heatMaps[0].size(), imageSize);
-    return poses;
-}
-
-class FindPeaksBody: public cv::ParallelLoopBody {
-public:
-    FindPeaksBody(const std::vector<cv::Mat>& heatMaps, float minPeaksDistance,
-                  std::vector<std::vector<Peak> >& peaksFromHeatMap)
-        : heatMaps(heatMaps),
-          minPeaksDistance(minPeaksDistance),
-          peaksFromHeatMap(peaksFromHeatMap) {}
-
-    virtual void operator()(const cv::Range& range) const {
-        for (int i = range.start; i < range.end; i++) {
-            findPeaks(heatMaps, minPeaksDistance, peaksFromHeatMap, i);
+    cv::Size featureMapsSize = heatMaps[0].size();
+    if (nativeMaps) {
+        // move the keypoints to the pixels of the maps upsampled by cv::resize
+        const cv::Point2f halfPixel(0.5f, 0.5f);
+        for (auto& pose : poses) {
+            for (auto& keypoint : pose.keypoints) {
+                if (keypoint != cv::Point2f(-1, -1)) {
+                    keypoint = (keypoint + halfPixel) * upsampleRatio - halfPixel;
+                }
+            }
         }
+        featureMapsSize = featureMapsSize * upsampleRatio;
     }
-
-private:
-    const std::vector<cv::Mat>& heatMaps;
-    float minPeaksDistance;
-    std::vector<std::vector<Peak> >& peaksFromHeatMap;
-};
+    correctCoordinates(poses, featureMapsSize, imageSize);
+    return poses;
+}
 
 std::vector<HumanPose> HumanPoseEstimator::extractPoses(
         const std::vector<cv::Mat>& heatMaps,
         const std::vector<cv::Mat>& pafs) const {
-    std::vector<std::vector<Peak> > peaksFromHeatMap(heatMaps.size());
-    FindPeaksBody findPeaksBody(heatMaps, minPeaksDistance, peaksFromHeatMap);
-    cv::parallel_for_(cv::Range(0, static_cast<int>(heatMaps.size())),
-                      findPeaksBody);
-    int peaksBefore = 0;
-    for (size_t heatmapId = 1; heatmapId < heatMaps.size(); heatmapId++) {
-        peaksBefore += static_cast<int>(peaksFromHeatMap[heatmapId - 1].size());
-        for (auto& peak : peaksFromHeatMap[heatmapId]) {
-            peak.id += peaksBefore;
-        }
-    }
-    std::vector<HumanPose> poses = groupPeaksToPoses(
-                peaksFromHeatMap, pafs, keypointsNumber, midPointsScoreThreshold,
-                foundMidPointsRatioThreshold, minJointsNumber, minSubsetScore);
-    return poses;
+    return findPoses(heatMaps, pafs, keypointsNumber,
+                     nativeMaps ? minPeaksDistance / upsampleRatio : minPeaksDistance,
+                     midPointsScoreThreshold, foundMidPointsRatioThreshold, minJointsNumber, minSubsetScore,
+                     nativeMaps, groupingScratch);
 }
 
 void HumanPoseEstimator::resizeFeatureMaps(std::vector<cv::Mat>& featureMaps) const {
@@ -306,9 +283,9 @@ bool HumanPoseEstimator::inputWidthIsChanged(const cv::Size& imageSize) {
 
 HumanPoseEstimator::~HumanPoseEstimator() {
     try {
-        if (enablePerformanceReport) {
+        if (enablePerformanceReport && lastRequest) {
             std::cout << "Performance counts for " << modelPath << std::endl << std::endl;
-            printPerformanceCounts(*requestCurr, std::cout, getFullDeviceName(ie, targetDeviceName), false);
+            printPerformanceCounts(*lastRequest, std::cout, getFullDeviceName(ie, targetDeviceName), false);
         }
     }
     catch (...) {
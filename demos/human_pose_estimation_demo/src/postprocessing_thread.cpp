@@ -0,0 +1,69 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include <utility>
+
+#include "postprocessing_thread.hpp"
+
+namespace human_pose_estimation {
+PostprocessingThread::PostprocessingThread(HumanPoseEstimator& estimator)
+    : estimator(estimator),
+      pending(0),
+      stopped(false) {
+    worker = std::thread(&PostprocessingThread::run, this);
+}
+
+PostprocessingThread::~PostprocessingThread() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopped = true;
+    }
+    pushed.notify_one();
+    worker.join();
+}
+
+void PostprocessingThread::push(Result result) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        inputs.push_back(std::move(result));
+    }
+    pending++;
+    pushed.notify_one();
+}
+
+PostprocessingThread::Output PostprocessingThread::pop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    postprocessed.wait(lock, [this] { return !outputs.empty(); });
+    Output output = std::move(outputs.front());
+    outputs.pop_front();
+    pending--;
+    if (output.error) {
+        std::rethrow_exception(output.error);
+    }
+    return output;
+}
+
+void PostprocessingThread::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        pushed.wait(lock, [this] { return stopped || !inputs.empty(); });
+        if (stopped) {
+            return;
+        }
+        Output output{std::move(inputs.front()), {}, nullptr};
+        inputs.pop_front();
+        lock.unlock();
+
+        try {
+            output.poses = estimator.postprocessRequest(output.result.request);
+        } catch (...) {
+            output.error = std::current_exception();
+        }
+
+        lock.lock();
+        outputs.push_back(std::move(output));
+        postprocessed.notify_one();
+    }
+}
+}  // namespace human_pose_estimation
@@ -42,7 +42,10 @@ void renderHumanPose(const std::vector<HumanPose>& poses, cv::Mat& image) {
             }
         }
     }
-    cv::Mat pane = image.clone();
+    // The polygons of the limbs and their colors. The buffers persist between the calls to keep their capacity
+    static thread_local std::vector<std::pair<std::vector<cv::Point>, size_t>> limbs;
+    size_t limbsNumber = 0;
+    cv::Rect limbsRect;
     for (const auto& pose : poses) {
         for (const auto& limbKeypointsId : limbKeypointsIds) {
             std::pair<cv::Point2f, cv::Point2f> limbKeypoints(pose.keypoints[limbKeypointsId.first],
@@ -57,12 +60,32 @@ void renderHumanPose(const std::vector<HumanPose>& poses, cv::Mat& image) {
             cv::Point difference = limbKeypoints.first - limbKeypoints.second;
             double length = std::sqrt(difference.x * difference.x + difference.y * difference.y);
             int angle = static_cast<int>(std::atan2(difference.y, difference.x) * 180 / CV_PI);
-            std::vector<cv::Point> polygon;
+            if (limbs.size() == limbsNumber) {
+                limbs.emplace_back();
+            }
+            std::vector<cv::Point>& polygon = limbs[limbsNumber].first;
             cv::ellipse2Poly(cv::Point2d(meanX, meanY), cv::Size2d(length / 2, stickWidth),
                              angle, 0, 360, 1, polygon);
-            cv::fillConvexPoly(pane, polygon, colors[limbKeypointsId.second]);
+            limbs[limbsNumber].second = limbKeypointsId.second;
+            limbsRect |= cv::boundingRect(polygon);
+            limbsNumber++;
+        }
+    }
+    // The blending doesn't change the pixels without limbs, so only the part of the image with the limbs is blended
+    limbsRect &= cv::Rect(0, 0, image.cols, image.rows);
+    if (limbsRect.area() == 0) {
+        return;
+    }
+    cv::Mat imageLimbs = image(limbsRect);
+    static thread_local cv::Mat pane;
+    imageLimbs.copyTo(pane);
+    for (size_t limbIdx = 0; limbIdx < limbsNumber; limbIdx++) {
+        std::vector<cv::Point>& polygon = limbs[limbIdx].first;
+        for (auto& point : polygon) {
+            point -= limbsRect.tl();
         }
+        cv::fillConvexPoly(pane, polygon, colors[limbs[limbIdx].second]);
     }
-    cv::addWeighted(image, 0.4, pane, 0.6, 0, image);
+    cv::addWeighted(imageLimbs, 0.4, pane, 0.6, 0, imageLimbs);
 }
 }  // namespace human_pose_estimation
@@ -21,6 +21,8 @@
 
 #include <samples/ocv_common.hpp>
 #include <samples/slog.hpp>
+#include <samples/mapped_weights.hpp>
+#include <samples/network_cache.hpp>
 
 #include <ie_iextension.h>
 
@@ -35,7 +37,7 @@ BaseDetection::BaseDetection(const std::string &topoName,
                              bool doRawOutputMessages)
     : topoName(topoName), pathToModel(pathToModel), deviceForInference(deviceForInference),
       maxBatch(maxBatch), isBatchDynamic(isBatchDynamic), isAsync(isAsync),
-      enablingChecked(false), _enabled(false), doRawOutputMessages(doRawOutputMessages) {
+      enablingChecked(false), _enabled(false), doRawOutputMessages(doRawOutputMessages), submittedBatches(0) {
     if (isAsync) {
         slog::info << "Use async mode for " << topoName << slog::endl;
     }
@@ -59,7 +61,62 @@ void BaseDetection::submitRequest() {
 void BaseDetection::wait() {
     if (!enabled()|| !request || !isAsync)
         return;
-    request->Wait(IInferRequest::WaitMode::RESULT_READY);
+    if (submittedBatches == 0) {
+        request->Wait(IInferRequest::WaitMode::RESULT_READY);
+    }
+    for (size_t batch = 0; batch < submittedBatches; batch++) {
+        batchRequests[batch]->Wait(IInferRequest::WaitMode::RESULT_READY);
+    }
+}
+
+InferRequest::Ptr BaseDetection::faceRequest(size_t faceIdx) {
+    const size_t batch = faceIdx / maxBatch;
+    while (batchRequests.size() <= batch) {
+        batchRequests.push_back(net.CreateInferRequestPtr());
+        if (isAsync) {
+            batchRequests.back()->SetCompletionCallback(std::function<void()>([this] {
+                const auto now = std::chrono::steady_clock::now();
+                std::lock_guard<std::mutex> lock(completionMutex);
+                completedAt = std::max(completedAt, now);
+            }));
+        }
+    }
+    request = batchRequests[0];
+    return batchRequests[batch];
+}
+
+InferRequest::Ptr BaseDetection::faceResultRequest(size_t faceIdx) const {
+    return batchRequests[faceIdx / maxBatch];
+}
+
+void BaseDetection::submitFaces(size_t enquedFaces) {
+    submittedBatches = (enquedFaces + maxBatch - 1) / maxBatch;
+    submittedAt = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(completionMutex);
+        completedAt = submittedAt;
+    }
+    for (size_t batch = 0; batch < submittedBatches; batch++) {
+        InferRequest::Ptr& batchRequest = batchRequests[batch];
+        if (isBatchDynamic) {
+            batchRequest->SetBatch(std::min(maxBatch, enquedFaces - batch * maxBatch));
+        }
+        if (isAsync) {
+            batchRequest->StartAsync();
+        } else {
+            batchRequest->Infer();
+        }
+    }
+    if (!isAsync) {
+        completedAt = std::chrono::steady_clock::now();
+    }
+}
+
+double BaseDetection::getSubmissionMs() {
+    std::lock_guard<std::mutex> lock(completionMutex);
+    // the requests are ready, a callback which hasn't recorded the completion yet is about to
+    const auto completed = completedAt > submittedAt ? completedAt : std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(completed - submittedAt).count();
 }
 
 bool BaseDetection::enabled() const  {
@@ -122,7 +179,7 @@ void FaceDetection::enqueue(const cv::Mat &frame) {
 CNNNetwork FaceDetection::read(const InferenceEngine::Core& ie)  {
     slog::info << "Loading network files for Face Detection" << slog::endl;
     /** Read network model **/
-    auto network = ie.ReadNetwork(pathToModel);
+    auto network = readNetworkMapped(ie, pathToModel);
     /** Set batch size to 1 **/
     slog::info << "Batch size is set to " << maxBatch << slog::endl;
     network.setBatchSize(maxBatch);
@@ -290,13 +347,9 @@ AgeGenderDetection::AgeGenderDetection(const std::string &pathToModel,
       enquedFaces(0) {
 }
 
-void AgeGenderDetection::submitRequest()  {
-    if (!enquedFaces)
-        return;
-    if (isBatchDynamic) {
-        request->SetBatch(enquedFaces);
-    }
-    BaseDetection::submitRequest();
+void AgeGenderDetection::submitRequest() {
+    if (!enquedFaces) return;
+    submitFaces(enquedFaces);
     enquedFaces = 0;
 }
 
@@ -304,27 +357,22 @@ void AgeGenderDetection::enqueue(const cv::Mat &face) {
     if (!enabled()) {
         return;
     }
-    if (enquedFaces == maxBatch) {
-        slog::warn << "Number of detected faces more than maximum(" << maxBatch << ") processed by Age/Gender Recognition network" << slog::endl;
-        return;
-    }
-    if (!request) {
-        request = net.CreateInferRequestPtr();
-    }
 
-    Blob::Ptr  inputBlob = request->GetBlob(input);
+    Blob::Ptr  inputBlob = faceRequest(enquedFaces)->GetBlob(input);
 
-    matU8ToBlob<uint8_t>(face, inputBlob, enquedFaces);
+    matU8ToBlob<uint8_t>(face, inputBlob, enquedFaces % maxBatch);
 
     enquedFaces++;
 }
 
 AgeGenderDetection::Result AgeGenderDetection::operator[] (int idx) const {
-    Blob::Ptr  genderBlob = request->GetBlob(outputGender);
-    Blob::Ptr  ageBlob    = request->GetBlob(outputAge);
+    InferRequest::Ptr resultRequest = faceResultRequest(idx);
+    const int batchIdx = static_cast<int>(idx % maxBatch);
+    Blob::Ptr  genderBlob = resultRequest->GetBlob(outputGender);
+    Blob::Ptr  ageBlob    = resultRequest->GetBlob(outputAge);
 
-    AgeGenderDetection::Result r = {ageBlob->buffer().as<float*>()[idx] * 100,
-                                         genderBlob->buffer().as<float*>()[idx * 2 + 1]};
+    AgeGenderDetection::Result r = {ageBlob->buffer().as<float*>()[batchIdx] * 100,
+                                         genderBlob->buffer().as<float*>()[batchIdx * 2 + 1]};
     if (doRawOutputMessages) {
         std::cout << "[" << idx << "] element, male prob = " << r.maleProb << ", age = " << r.age << std::endl;
     }
@@ -335,7 +383,7 @@ AgeGenderDetection::Result AgeGenderDetection::operator[] (int idx) const {
 CNNNetwork AgeGenderDetection::read(const InferenceEngine::Core& ie) {
     slog::info << "Loading network files for Age/Gender Recognition network" << slog::endl;
     // Read network
-    auto network = ie.ReadNetwork(pathToModel);
+    auto network = readNetworkMapped(ie, pathToModel);
     // Set maximum batch size to be used.
     network.setBatchSize(maxBatch);
     slog::info << "Batch size is set to " << network.getBatchSize() << " for Age/Gender Recognition network" << slog::endl;
@@ -350,6 +398,8 @@ CNNNetwork AgeGenderDetection::read(const InferenceEngine::Core& ie) {
     InputInfo::Ptr& inputInfoFirst = inputInfo.begin()->second;
     inputInfoFirst->setPrecision(Precision::U8);
     input = inputInfo.begin()->first;
+    const SizeVector& inputDims = inputInfoFirst->getTensorDesc().getDims();
+    inputSize = cv::Size(static_cast<int>(inputDims[3]), static_cast<int>(inputDims[2]));
     // -----------------------------------------------------------------------------------------------------
 
     // ---------------------------Check outputs ------------------------------------------------------------
@@ -379,12 +429,9 @@ HeadPoseDetection::HeadPoseDetection(const std::string &pathToModel,
       outputAngleR("angle_r_fc"), outputAngleP("angle_p_fc"), outputAngleY("angle_y_fc"), enquedFaces(0) {
 }
 
-void HeadPoseDetection::submitRequest()  {
+void HeadPoseDetection::submitRequest() {
     if (!enquedFaces) return;
-    if (isBatchDynamic) {
-        request->SetBatch(enquedFaces);
-    }
-    BaseDetection::submitRequest();
+    submitFaces(enquedFaces);
     enquedFaces = 0;
 }
 
@@ -392,29 +439,24 @@ void HeadPoseDetection::enqueue(const cv::Mat &face) {
     if (!enabled()) {
         return;
     }
-    if (enquedFaces == maxBatch) {
-        slog::warn << "Number of detected faces more than maximum(" << maxBatch << ") processed by Head Pose estimator" << slog::endl;
-        return;
-    }
-    if (!request) {
-        request = net.CreateInferRequestPtr();
-    }
 
-    Blob::Ptr inputBlob = request->GetBlob(input);
+    Blob::Ptr inputBlob = faceRequest(enquedFaces)->GetBlob(input);
 
-    matU8ToBlob<uint8_t>(face, inputBlob, enquedFaces);
+    matU8ToBlob<uint8_t>(face, inputBlob, enquedFaces % maxBatch);
 
     enquedFaces++;
 }
 
 HeadPoseDetection::Results HeadPoseDetection::operator[] (int idx) const {
-    Blob::Ptr  angleR = request->GetBlob(outputAngleR);
-    Blob::Ptr  angleP = request->GetBlob(outputAngleP);
-    Blob::Ptr  angleY = request->GetBlob(outputAngleY);
+    InferRequest::Ptr resultRequest = faceResultRequest(idx);
+    const int batchIdx = static_cast<int>(idx % maxBatch);
+    Blob::Ptr  angleR = resultRequest->GetBlob(outputAngleR);
+    Blob::Ptr  angleP = resultRequest->GetBlob(outputAngleP);
+    Blob::Ptr  angleY = resultRequest->GetBlob(outputAngleY);
 
-    HeadPoseDetection::Results r = {angleR->buffer().as<float*>()[idx],
-                                    angleP->buffer().as<float*>()[idx],
-                                    angleY->buffer().as<float*>()[idx]};
+    HeadPoseDetection::Results r = {angleR->buffer().as<float*>()[batchIdx],
+                                    angleP->buffer().as<float*>()[batchIdx],
+                                    angleY->buffer().as<float*>()[batchIdx]};
 
     if (doRawOutputMessages) {
         std::cout << "[" << idx << "] element, yaw = " << r.angle_y <<
@@ -428,7 +470,7 @@ HeadPoseDetection::Results HeadPoseDetection::operator[] (int idx) const {
 CNNNetwork HeadPoseDetection::read(const InferenceEngine::Core& ie) {
     slog::info << "Loading network files for Head Pose Estimation network" << slog::endl;
     // Read network model
-    auto network = ie.ReadNetwork(pathToModel);
+    auto network = readNetworkMapped(ie, pathToModel);
     // Set maximum batch size
     network.setBatchSize(maxBatch);
     slog::info << "Batch size is set to  " << network.getBatchSize() << " for Head Pose Estimation network" << slog::endl;
@@ -442,6 +484,8 @@ CNNNetwork HeadPoseDetection::read(const InferenceEngine::Core& ie) {
     InputInfo::Ptr& inputInfoFirst = inputInfo.begin()->second;
     inputInfoFirst->setPrecision(Precision::U8);
     input = inputInfo.begin()->first;
+    const SizeVector& inputDims = inputInfoFirst->getTensorDesc().getDims();
+    inputSize = cv::Size(static_cast<int>(inputDims[3]), static_cast<int>(inputDims[2]));
     // -----------------------------------------------------------------------------------------------------
 
     // ---------------------------Check outputs ------------------------------------------------------------
@@ -471,10 +515,7 @@ EmotionsDetection::EmotionsDetection(const std::string &pathToModel,
 
 void EmotionsDetection::submitRequest() {
     if (!enquedFaces) return;
-    if (isBatchDynamic) {
-        request->SetBatch(enquedFaces);
-    }
-    BaseDetection::submitRequest();
+    submitFaces(enquedFaces);
     enquedFaces = 0;
 }
 
@@ -482,17 +523,10 @@ void EmotionsDetection::enqueue(const cv::Mat &face) {
     if (!enabled()) {
         return;
     }
-    if (enquedFaces == maxBatch) {
-        slog::warn << "Number of detected faces more than maximum(" << maxBatch << ") processed by Emotions Recognition network" << slog::endl;
-        return;
-    }
-    if (!request) {
-        request = net.CreateInferRequestPtr();
-    }
 
-    Blob::Ptr inputBlob = request->GetBlob(input);
+    Blob::Ptr inputBlob = faceRequest(enquedFaces)->GetBlob(input);
 
-    matU8ToBlob<uint8_t>(face, inputBlob, enquedFaces);
+    matU8ToBlob<uint8_t>(face, inputBlob, enquedFaces % maxBatch);
 
     enquedFaces++;
 }
@@ -500,7 +534,7 @@ void EmotionsDetection::enqueue(const cv::Mat &face) {
 std::map<std::string, float> EmotionsDetection::operator[] (int idx) const {
     auto emotionsVecSize = emotionsVec.size();
 
-    Blob::Ptr emotionsBlob = request->GetBlob(outputEmotions);
+    Blob::Ptr emotionsBlob = faceResultRequest(idx)->GetBlob(outputEmotions);
 
     /* emotions vector must have the same size as number of channels
      * in model output. Default output format is NCHW, so index 1 is checked */
@@ -513,7 +547,7 @@ std::map<std::string, float> EmotionsDetection::operator[] (int idx) const {
     }
 
     auto emotionsValues = emotionsBlob->buffer().as<float *>();
-    auto outputIdxPos = emotionsValues + idx * emotionsVecSize;
+    auto outputIdxPos = emotionsValues + idx % maxBatch * emotionsVecSize;
     std::map<std::string, float> emotions;
 
     if (doRawOutputMessages) {
@@ -539,7 +573,7 @@ std::map<std::string, float> EmotionsDetection::operator[] (int idx) const {
 CNNNetwork EmotionsDetection::read(const InferenceEngine::Core& ie) {
     slog::info << "Loading network files for Emotions Recognition" << slog::endl;
     // Read network model
-    auto network = ie.ReadNetwork(pathToModel);
+    auto network = readNetworkMapped(ie, pathToModel);
     // Set maximum batch size
     network.setBatchSize(maxBatch);
     slog::info << "Batch size is set to " << network.getBatchSize() << " for Emotions Recognition" << slog::endl;
@@ -555,6 +589,8 @@ CNNNetwork EmotionsDetection::read(const InferenceEngine::Core& ie) {
     auto& inputInfoFirst = inputInfo.begin()->second;
     inputInfoFirst->setPrecision(Precision::U8);
     input = inputInfo.begin()->first;
+    const SizeVector& inputDims = inputInfoFirst->getTensorDesc().getDims();
+    inputSize = cv::Size(static_cast<int>(inputDims[3]), static_cast<int>(inputDims[2]));
     // -----------------------------------------------------------------------------------------------------
 
     // ---------------------------Check outputs ------------------------------------------------------------
@@ -584,10 +620,7 @@ FacialLandmarksDetection::FacialLandmarksDetection(const std::string &pathToMode
 
 void FacialLandmarksDetection::submitRequest() {
     if (!enquedFaces) return;
-    if (isBatchDynamic) {
-        request->SetBatch(enquedFaces);
-    }
-    BaseDetection::submitRequest();
+    submitFaces(enquedFaces);
     enquedFaces = 0;
 }
 
@@ -595,17 +628,10 @@ void FacialLandmarksDetection::enqueue(const cv::Mat &face) {
     if (!enabled()) {
         return;
     }
-    if (enquedFaces == maxBatch) {
-        slog::warn << "Number of detected faces more than maximum(" << maxBatch << ") processed by Facial Landmarks estimator" << slog::endl;
-        return;
-    }
-    if (!request) {
-        request = net.CreateInferRequestPtr();
-    }
 
-    Blob::Ptr inputBlob = request->GetBlob(input);
+    Blob::Ptr inputBlob = faceRequest(enquedFaces)->GetBlob(input);
 
-    matU8ToBlob<uint8_t>(face, inputBlob, enquedFaces);
+    matU8ToBlob<uint8_t>(face, inputBlob, enquedFaces % maxBatch);
 
     enquedFaces++;
 }
@@ -613,15 +639,15 @@ void FacialLandmarksDetection::enqueue(const cv::Mat &face) {
 std::vector<float> FacialLandmarksDetection::operator[] (int idx) const {
     std::vector<float> normedLandmarks;
 
-    auto landmarksBlob = request->GetBlob(outputFacialLandmarksBlobName);
+    auto landmarksBlob = faceResultRequest(idx)->GetBlob(outputFacialLandmarksBlobName);
     auto n_lm = getTensorChannels(landmarksBlob->getTensorDesc());
-    const float *normed_coordinates = request->GetBlob(outputFacialLandmarksBlobName)->buffer().as<float *>();
+    const float *normed_coordinates = landmarksBlob->buffer().as<float *>();
 
     if (doRawOutputMessages) {
         std::cout << "[" << idx << "] element, normed facial landmarks coordinates (x, y):" << std::endl;
     }
 
-    auto begin = n_lm * idx;
+    auto begin = n_lm * (idx % maxBatch);
     auto end = begin + n_lm / 2;
     for (auto i_lm = begin; i_lm < end; ++i_lm) {
         float normed_x = normed_coordinates[2 * i_lm];
@@ -641,7 +667,7 @@ std::vector<float> FacialLandmarksDetection::operator[] (int idx) const {
 CNNNetwork FacialLandmarksDetection::read(const InferenceEngine::Core& ie) {
     slog::info << "Loading network files for Facial Landmarks Estimation" << slog::endl;
     // Read network model
-    auto network = ie.ReadNetwork(pathToModel);
+    auto network = readNetworkMapped(ie, pathToModel);
     // Set maximum batch size
     network.setBatchSize(maxBatch);
     slog::info << "Batch size is set to  " << network.getBatchSize() << " for Facial Landmarks Estimation network" << slog::endl;
@@ -655,6 +681,8 @@ CNNNetwork FacialLandmarksDetection::read(const InferenceEngine::Core& ie) {
     InputInfo::Ptr& inputInfoFirst = inputInfo.begin()->second;
     inputInfoFirst->setPrecision(Precision::U8);
     input = inputInfo.begin()->first;
+    const SizeVector& inputDims = inputInfoFirst->getTensorDesc().getDims();
+    inputSize = cv::Size(static_cast<int>(inputDims[3]), static_cast<int>(inputDims[2]));
     // -----------------------------------------------------------------------------------------------------
 
     // ---------------------------Check outputs ------------------------------------------------------------
@@ -681,12 +709,38 @@ CNNNetwork FacialLandmarksDetection::read(const InferenceEngine::Core& ie) {
 }
 
 
+void FaceResizer::setFace(const cv::Mat& face) {
+    _face = face;
+    _resizedNum = 0;
+}
+
+const cv::Mat& FaceResizer::resized(const cv::Size& size) {
+    if (size.area() == 0 || size == _face.size()) {
+        return _face;
+    }
+    for (size_t i = 0; i < _resizedNum; i++) {
+        if (_resized[i].first == size) {
+            return _resized[i].second;
+        }
+    }
+    // the buffers of the previous faces are reused
+    if (_resizedNum == _resized.size()) {
+        _resized.emplace_back();
+    }
+    auto& resized = _resized[_resizedNum++];
+    resized.first = size;
+    cv::resize(_face, resized.second, size);
+    return resized.second;
+}
+
+
 Load::Load(BaseDetection& detector) : detector(detector) {
 }
 
-void Load::into(InferenceEngine::Core & ie, const std::string & deviceName, bool enable_dynamic_batch) const {
+void Load::into(InferenceEngine::Core & ie, const std::string & deviceName, bool enable_dynamic_batch,
+                const std::map<std::string, std::string> & networkConfig, const std::string & cacheDir) const {
     if (detector.enabled()) {
-        std::map<std::string, std::string> config = { };
+        std::map<std::string, std::string> config = networkConfig;
         bool isPossibleDynBatch = deviceName.find("CPU") != std::string::npos ||
                                   deviceName.find("GPU") != std::string::npos;
 
@@ -694,13 +748,14 @@ void Load::into(InferenceEngine::Core & ie, const std::string & deviceName, bool
             config[PluginConfigParams::KEY_DYN_BATCH_ENABLED] = PluginConfigParams::YES;
         }
 
-        detector.net = ie.LoadNetwork(detector.read(ie), deviceName, config);
+        detector.net = loadNetworkCached(ie, detector.read(ie), detector.pathToModel, deviceName, config, cacheDir);
     }
 }
 
 
 CallStat::CallStat():
-    _number_of_calls(0), _total_duration(0.0), _last_call_duration(0.0), _smoothed_duration(-1.0) {
+    _number_of_calls(0), _total_duration(0.0), _last_call_duration(0.0), _smoothed_duration(-1.0),
+    _number_of_inferences(0), _number_of_saved_inferences(0) {
 }
 
 double CallStat::getSmoothedDuration() {
@@ -737,6 +792,16 @@ void CallStat::setStartTime() {
     _last_call_start = std::chrono::high_resolution_clock::now();
 }
 
+void CallStat::countInferences(size_t inferred, size_t reused) {
+    _number_of_inferences += inferred;
+    _number_of_saved_inferences += reused;
+}
+
+double CallStat::getSavedInferencesRatio() {
+    const size_t total = _number_of_inferences + _number_of_saved_inferences;
+    return total == 0 ? 0.0 : static_cast<double>(_number_of_saved_inferences) / total;
+}
+
 
 void Timer::start(const std::string& name) {
     if (_timers.find(name) == _timers.end()) {
@@ -17,6 +17,7 @@
 #include <algorithm>
 #include <iterator>
 #include <map>
+#include <mutex>
 
 #include <inference_engine.hpp>
 
@@ -41,6 +42,7 @@ struct BaseDetection {
     mutable bool enablingChecked;
     mutable bool _enabled;
     const bool doRawOutputMessages;
+    cv::Size inputSize;
 
     BaseDetection(const std::string &topoName,
                   const std::string &pathToModel,
@@ -50,10 +52,24 @@ struct BaseDetection {
 
     virtual ~BaseDetection();
 
+    // The faces are split into batches of maxBatch faces, each batch is inferred by its own request,
+    // batchRequests[0] is request
+    std::vector<InferenceEngine::InferRequest::Ptr> batchRequests;
+    size_t submittedBatches;
+    // The time of the last submitFaces() and the completion of its last request, the requests record it
+    // from the completion callbacks, so the work done while they run, e.g. reading the next frame, isn't counted
+    std::chrono::steady_clock::time_point submittedAt, completedAt;
+    std::mutex completionMutex;
+
     InferenceEngine::ExecutableNetwork* operator ->();
     virtual InferenceEngine::CNNNetwork read(const InferenceEngine::Core& ie) = 0;
     virtual void submitRequest();
     virtual void wait();
+    InferenceEngine::InferRequest::Ptr faceRequest(size_t faceIdx);
+    InferenceEngine::InferRequest::Ptr faceResultRequest(size_t faceIdx) const;
+    void submitFaces(size_t enquedFaces);
+    // The time from the last submitFaces() until all its requests completed, call it after wait()
+    double getSubmissionMs();
     bool enabled() const;
     void printPerformanceCounts(std::string fullDeviceName);
 };
@@ -183,12 +199,26 @@ struct FacialLandmarksDetection : BaseDetection {
     std::vector<float> operator[] (int idx) const;
 };
 
+// Resizes a face once for every distinct input size of the attribute networks, the networks get the
+// resized faces, which matU8ToBlob() copies to their inputs without resizing again
+class FaceResizer {
+public:
+    void setFace(const cv::Mat& face);
+    const cv::Mat& resized(const cv::Size& size);
+
+private:
+    cv::Mat _face;
+    std::vector<std::pair<cv::Size, cv::Mat>> _resized;
+    size_t _resizedNum = 0;
+};
+
 struct Load {
     BaseDetection& detector;
 
     explicit Load(BaseDetection& detector);
 
-    void into(InferenceEngine::Core & ie, const std::string & deviceName, bool enable_dynamic_batch = false) const;
+    void into(InferenceEngine::Core & ie, const std::string & deviceName, bool enable_dynamic_batch = false,
+              const std::map<std::string, std::string> & config = {}, const std::string & cacheDir = "") const;
 };
 
 class CallStat {
@@ -202,6 +232,8 @@ public:
     double getLastCallDuration();
     void calculateDuration();
     void setStartTime();
+    void countInferences(size_t inferred, size_t reused);
+    double getSavedInferencesRatio();
 
 private:
     size_t _number_of_calls;
@@ -209,6 +241,8 @@ private:
     double _last_call_duration;
     double _smoothed_duration;
     std::chrono::time_point<std::chrono::high_resolution_clock> _last_call_start;
+    size_t _number_of_inferences;
+    size_t _number_of_saved_inferences;
 };
 
 class Timer {
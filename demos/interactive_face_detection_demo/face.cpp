@@ -14,6 +14,8 @@ Face::Face(size_t id, cv::Rect& location):
     _location(location), _intensity_mean(0.f), _id(id), _age(-1),
     _maleScore(0), _femaleScore(0), _headPose({0.f, 0.f, 0.f}),
     _isAgeGenderEnabled(false), _isEmotionsEnabled(false), _isHeadPoseEnabled(false), _isLandmarksEnabled(false) {
+    _inferenceFrames.fill(0);
+    _isInferred.fill(false);
 }
 
 void Face::updateAge(float value) {
@@ -57,7 +59,7 @@ bool Face::isMale() {
     return _maleScore > _femaleScore;
 }
 
-std::map<std::string, float> Face::getEmotions() {
+const std::map<std::string, float>& Face::getEmotions() {
     return _emotions;
 }
 
@@ -107,6 +109,26 @@ bool Face::isLandmarksEnabled() {
     return _isLandmarksEnabled;
 }
 
+bool Face::isInferenceDue(Attribute attribute, size_t frameIdx, size_t interval) {
+    if (_isInferred[attribute] && frameIdx < _inferenceFrames[attribute] + interval) {
+        return false;
+    }
+    setInferred(attribute, frameIdx);
+    return true;
+}
+
+long Face::framesSinceInference(Attribute attribute, size_t frameIdx) const {
+    if (!_isInferred[attribute]) {
+        return -1;
+    }
+    return static_cast<long>(frameIdx - _inferenceFrames[attribute]);
+}
+
+void Face::setInferred(Attribute attribute, size_t frameIdx) {
+    _isInferred[attribute] = true;
+    _inferenceFrames[attribute] = frameIdx;
+}
+
 float calcIoU(cv::Rect& src, cv::Rect& dst) {
     cv::Rect i = src & dst;
     cv::Rect u = src | dst;
@@ -3,6 +3,7 @@
 //
 
 # pragma once
+#include <array>
 #include <string>
 #include <map>
 #include <memory>
@@ -19,6 +20,8 @@ struct Face {
 public:
     using Ptr = std::shared_ptr<Face>;
 
+    enum Attribute { AGE_GENDER, EMOTIONS, HEAD_POSE, LANDMARKS, ATTRIBUTES_NUM };
+
     explicit Face(size_t id, cv::Rect& location);
 
     void updateAge(float value);
@@ -29,7 +32,7 @@ public:
 
     int getAge();
     bool isMale();
-    std::map<std::string, float> getEmotions();
+    const std::map<std::string, float>& getEmotions();
     std::pair<std::string, float> getMainEmotion();
     HeadPoseDetection::Results getHeadPose();
     const std::vector<float>& getLandmarks();
@@ -45,6 +48,14 @@ public:
     bool isHeadPoseEnabled();
     bool isLandmarksEnabled();
 
+    // Returns true if the attribute was never inferred for the face or was inferred at least
+    // interval frames before frameIdx, the attribute is considered inferred at frameIdx then
+    bool isInferenceDue(Attribute attribute, size_t frameIdx, size_t interval);
+    // Returns the number of frames from the last inference of the attribute for the face until
+    // frameIdx or -1 if the attribute was never inferred
+    long framesSinceInference(Attribute attribute, size_t frameIdx) const;
+    void setInferred(Attribute attribute, size_t frameIdx);
+
 public:
     cv::Rect _location;
     float _intensity_mean;
@@ -62,6 +73,9 @@ private:
     bool _isEmotionsEnabled;
     bool _isHeadPoseEnabled;
     bool _isLandmarksEnabled;
+
+    std::array<size_t, ATTRIBUTES_NUM> _inferenceFrames;
+    std::array<bool, ATTRIBUTES_NUM> _isInferred;
 };
 
 // ----------------------------------- Utils -----------------------------------------------------------------
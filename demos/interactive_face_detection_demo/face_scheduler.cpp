@@ -0,0 +1,120 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include <algorithm>
+#include <list>
+#include <utility>
+#include <vector>
+
+#include "face_scheduler.hpp"
+
+constexpr double FaceScheduler::costSmoothing;
+
+double FaceScheduler::Cost::perFaceMs() const {
+    const double facesVariance = facesSquared - faces * faces;
+    // the faces numbers differ enough to tell the time per face from the fixed time
+    if (facesVariance > 0.25) {
+        const double slope = (facesDuration - faces * duration) / facesVariance;
+        if (slope > 0.0) {
+            return slope;
+        }
+    }
+    return duration / faces;
+}
+
+double FaceScheduler::Cost::fixedMs() const {
+    return std::max(0.0, duration - perFaceMs() * faces);
+}
+
+FaceScheduler::FaceScheduler(double budgetMs): budgetMs(budgetMs) {
+    carriedOver.fill(0);
+}
+
+std::vector<Face::Ptr> FaceScheduler::select(Face::Attribute attribute, const std::list<Face::Ptr>& faces,
+                                             size_t frameIdx, size_t interval) {
+    std::vector<Face::Ptr> selected;
+    if (!hasBudget()) {
+        for (auto&& face : faces) {
+            if (face->isInferenceDue(attribute, frameIdx, interval)) {
+                selected.push_back(face);
+            }
+        }
+        return selected;
+    }
+
+    int maxArea = 1;
+    for (auto&& face : faces) {
+        maxArea = std::max(maxArea, face->_location.area());
+    }
+    // the new faces have no attributes to show yet, so they precede any stale ones
+    struct Candidate {
+        bool isNew;
+        float priority;
+        size_t position;  // in faces
+        Face::Ptr face;
+    };
+    std::vector<Candidate> candidates;
+    size_t position = 0;
+    for (auto&& face : faces) {
+        const long framesSince = face->framesSinceInference(attribute, frameIdx);
+        if (framesSince < 0 || framesSince >= static_cast<long>(interval)) {
+            // the larger faces show the attributes better and are the most noticeable if stale
+            const float relativeSize = static_cast<float>(face->_location.area()) / maxArea;
+            if (framesSince < 0) {
+                candidates.push_back({true, relativeSize, position, face});
+            } else {
+                const float staleness = static_cast<float>(framesSince) / interval;
+                candidates.push_back({false, staleness * (0.5f + relativeSize), position, face});
+            }
+        }
+        position++;
+    }
+
+    size_t capacity = candidates.size();
+    const Cost& cost = costs[attribute];
+    if (cost.samples > 0 && cost.perFaceMs() > 0.0) {
+        // at least one face per frame, so the carried over faces are inferred eventually
+        const double facesBudgetMs = budgetMs - cost.fixedMs();
+        capacity = std::min(capacity, std::max<size_t>(1, static_cast<size_t>(facesBudgetMs / cost.perFaceMs())));
+    }
+    std::partial_sort(candidates.begin(), candidates.begin() + capacity, candidates.end(),
+        [](const Candidate& a, const Candidate& b) {
+            if (a.isNew != b.isNew) {
+                return a.isNew;
+            }
+            return a.priority > b.priority;
+        });
+    carriedOver[attribute] += candidates.size() - capacity;
+    candidates.resize(capacity);
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        return a.position < b.position;
+    });
+    for (auto&& candidate : candidates) {
+        candidate.face->setInferred(attribute, frameIdx);
+        selected.push_back(candidate.face);
+    }
+    return selected;
+}
+
+void FaceScheduler::update(Face::Attribute attribute, size_t facesNum, double durationMs) {
+    if (0 == facesNum) {
+        return;
+    }
+    Cost& cost = costs[attribute];
+    const double n = static_cast<double>(facesNum);
+    const double weight = 0 == cost.samples ? 1.0 : costSmoothing;
+    cost.faces += weight * (n - cost.faces);
+    cost.duration += weight * (durationMs - cost.duration);
+    cost.facesSquared += weight * (n * n - cost.facesSquared);
+    cost.facesDuration += weight * (n * durationMs - cost.facesDuration);
+    cost.samples++;
+}
+
+bool FaceScheduler::hasBudget() const {
+    return budgetMs > 0.0;
+}
+
+size_t FaceScheduler::getCarriedOver(Face::Attribute attribute) const {
+    return carriedOver[attribute];
+}
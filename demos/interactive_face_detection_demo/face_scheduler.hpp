@@ -0,0 +1,55 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include <array>
+#include <list>
+#include <vector>
+
+#include "face.hpp"
+
+// -------------------------Choosing the faces to infer the attribute networks for-----------------------------------
+
+// Fits the attribute inferences of a frame into a time budget of every network. A network costs a fixed time
+// per request and a time per face, both are fitted to its measured times, and it infers as many faces as fit
+// in the budget after the fixed time. The due faces are ordered by the novelty (never inferred first),
+// the staleness of the cached attributes and the size, the faces left out stay due and come first in
+// the next frames. Without a budget every due face is inferred
+class FaceScheduler {
+public:
+    explicit FaceScheduler(double budgetMs);
+
+    // Returns the faces to infer the attribute for at frameIdx in the order of faces, the attribute is
+    // considered inferred for them. A face is due once in interval frames
+    std::vector<Face::Ptr> select(Face::Attribute attribute, const std::list<Face::Ptr>& faces,
+                                  size_t frameIdx, size_t interval);
+    // Updates the cost of the network of the attribute, durationMs is the time of inferring facesNum faces
+    // from their submission until the results are ready
+    void update(Face::Attribute attribute, size_t facesNum, double durationMs);
+
+    bool hasBudget() const;
+    // The due inferences of the attribute left for the later frames
+    size_t getCarriedOver(Face::Attribute attribute) const;
+
+private:
+    static constexpr double costSmoothing = 0.1;
+
+    // The exponentially weighted moments of the faces numbers and the durations of a network, the least squares
+    // line through them is its cost
+    struct Cost {
+        size_t samples = 0;
+        double faces = 0.0;
+        double duration = 0.0;
+        double facesSquared = 0.0;
+        double facesDuration = 0.0;
+
+        double perFaceMs() const;
+        double fixedMs() const;
+    };
+
+    const double budgetMs;
+    std::array<Cost, Face::ATTRIBUTES_NUM> costs;
+    std::array<size_t, Face::ATTRIBUTES_NUM> carriedOver;
+};
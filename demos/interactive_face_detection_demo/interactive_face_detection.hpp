@@ -35,13 +35,13 @@ static const char target_device_message_em[] = "Optional. Target device for Emot
 static const char target_device_message_lm[] = "Optional. Target device for Facial Landmarks Estimation network "
                                                "(the list of available devices is shown below). Default value is CPU. Use \"-d HETERO:<comma-separated_devices_list>\" format to specify HETERO plugin. "
                                                "The demo will look for a suitable plugin for device specified.";
-static const char num_batch_ag_message[] = "Optional. Number of maximum simultaneously processed faces for Age/Gender Recognition network "
+static const char num_batch_ag_message[] = "Optional. Batch size of Age/Gender Recognition network, more faces are inferred in several batches at once "
                                            "(by default, it is 16)";
-static const char num_batch_hp_message[] = "Optional. Number of maximum simultaneously processed faces for Head Pose Estimation network "
+static const char num_batch_hp_message[] = "Optional. Batch size of Head Pose Estimation network, more faces are inferred in several batches at once "
                                            "(by default, it is 16)";
-static const char num_batch_em_message[] = "Optional. Number of maximum simultaneously processed faces for Emotions Recognition network "
+static const char num_batch_em_message[] = "Optional. Batch size of Emotions Recognition network, more faces are inferred in several batches at once "
                                            "(by default, it is 16)";
-static const char num_batch_lm_message[] = "Optional. Number of maximum simultaneously processed faces for Facial Landmarks Estimation network "
+static const char num_batch_lm_message[] = "Optional. Batch size of Facial Landmarks Estimation network, more faces are inferred in several batches at once "
                                            "(by default, it is 16)";
 static const char dyn_batch_ag_message[] = "Optional. Enable dynamic batch size for Age/Gender Recognition network";
 static const char dyn_batch_hp_message[] = "Optional. Enable dynamic batch size for Head Pose Estimation network";
@@ -65,6 +65,25 @@ static const char loop_video_output_message[] = "Optional. Enable playing video
 static const char no_smooth_output_message[] = "Optional. Do not smooth person attributes";
 static const char no_show_emotion_bar_message[] = "Optional. Do not show emotion bar";
 static const char utilization_monitors_message[] = "Optional. List of monitors to show initially.";
+static const char cpu_weights_message[] = "Optional. Comma separated weights of the face detection, age/gender, head pose, "
+                                          "emotions and facial landmarks models to split the CPU threads between them. Each model on the CPU "
+                                          "gets its own threads and streams, models on other devices are skipped.";
+static const char cache_dir_message[] = "Optional. Directory to cache compiled networks in. Later runs import the cached networks "
+                                        "instead of compiling them if the model, device and config didn't change. "
+                                        "Devices without network export support compile on each run.";
+static const char every_ag_message[] = "Optional. Infer Age/Gender Recognition network for a tracked face once in the given number "
+                                       "of frames and reuse the result in between (by default, it is 5)";
+static const char every_hp_message[] = "Optional. Infer Head Pose Estimation network for a tracked face once in the given number "
+                                       "of frames and reuse the result in between (by default, it is 1)";
+static const char every_em_message[] = "Optional. Infer Emotions Recognition network for a tracked face once in the given number "
+                                       "of frames and reuse the result in between (by default, it is 3)";
+static const char budget_message[] = "Optional. Time budget of the attribute networks per frame in msec. The due faces are ordered "
+                                     "by novelty, staleness of their attributes and size, each network infers as many of them as "
+                                     "its measured time per face fits in the budget after its fixed time per request and the rest "
+                                     "are left for the next frames. "
+                                     "0 infers all the due faces (by default, it is 0)";
+static const char every_lm_message[] = "Optional. Infer Facial Landmarks Estimation network for a tracked face once in the given number "
+                                       "of frames and reuse the result in between (by default, it is 1)";
 
 DEFINE_bool(h, false, help_message);
 DEFINE_string(i, "", input_video_message);
@@ -103,6 +122,13 @@ DEFINE_bool(loop_video, false, loop_video_output_message);
 DEFINE_bool(no_smooth, false, no_smooth_output_message);
 DEFINE_bool(no_show_emotion_bar, false, no_show_emotion_bar_message);
 DEFINE_string(u, "", utilization_monitors_message);
+DEFINE_string(cpu_weights, "", cpu_weights_message);
+DEFINE_string(cache_dir, "", cache_dir_message);
+DEFINE_uint32(ag_every, 5, every_ag_message);
+DEFINE_uint32(hp_every, 1, every_hp_message);
+DEFINE_uint32(em_every, 3, every_em_message);
+DEFINE_uint32(lm_every, 1, every_lm_message);
+DEFINE_double(budget_ms, 0, budget_message);
 
 
 /**
@@ -152,4 +178,11 @@ static void showUsage() {
     std::cout << "    -no_smooth                 " << no_smooth_output_message << std::endl;
     std::cout << "    -no_show_emotion_bar       " << no_show_emotion_bar_message << std::endl;
     std::cout << "    -u                         " << utilization_monitors_message << std::endl;
+    std::cout << "    -cpu_weights               " << cpu_weights_message << std::endl;
+    std::cout << "    -cache_dir \"<path>\"        " << cache_dir_message << std::endl;
+    std::cout << "    -ag_every \"<num>\"          " << every_ag_message << std::endl;
+    std::cout << "    -hp_every \"<num>\"          " << every_hp_message << std::endl;
+    std::cout << "    -em_every \"<num>\"          " << every_em_message << std::endl;
+    std::cout << "    -lm_every \"<num>\"          " << every_lm_message << std::endl;
+    std::cout << "    -budget_ms \"<num>\"         " << budget_message << std::endl;
 }
@@ -8,6 +8,7 @@
 * \example interactive_face_detection_demo/main.cpp
 */
 #include <gflags/gflags.h>
+#include <chrono>
 #include <functional>
 #include <iostream>
 #include <fstream>
@@ -27,10 +28,14 @@
 #include <monitors/presenter.h>
 #include <samples/ocv_common.hpp>
 #include <samples/slog.hpp>
+#include <samples/cpu_plan.hpp>
+#include <samples/parallel_load.hpp>
+#include <samples/async_presenter.hpp>
 
 #include "interactive_face_detection.hpp"
 #include "detectors.hpp"
 #include "face.hpp"
+#include "face_scheduler.hpp"
 #include "visualizer.hpp"
 
 #include <ie_iextension.h>
@@ -64,6 +69,14 @@ bool ParseAndCheckCommandLine(int argc, char *argv[]) {
         throw std::logic_error("Parameter -n_hp cannot be 0");
     }
 
+    if (FLAGS_ag_every < 1 || FLAGS_hp_every < 1 || FLAGS_em_every < 1 || FLAGS_lm_every < 1) {
+        throw std::logic_error("Parameters -ag_every, -hp_every, -em_every and -lm_every cannot be 0");
+    }
+
+    if (FLAGS_budget_ms < 0) {
+        throw std::logic_error("Parameter -budget_ms cannot be negative");
+    }
+
     // no need to wait for a key press from a user if an output image/video file is not shown.
     FLAGS_no_wait |= FLAGS_no_show;
 
@@ -158,11 +171,44 @@ int main(int argc, char *argv[]) {
 
         // --------------------------- 2. Reading IR models and loading them to plugins ----------------------
         // Disable dynamic batching for face detector as it processes one image at a time
-        Load(faceDetector).into(ie, FLAGS_d, false);
-        Load(ageGenderDetector).into(ie, FLAGS_d_ag, FLAGS_dyn_ag);
-        Load(headPoseDetector).into(ie, FLAGS_d_hp, FLAGS_dyn_hp);
-        Load(emotionsDetector).into(ie, FLAGS_d_em, FLAGS_dyn_em);
-        Load(facialLandmarksDetector).into(ie, FLAGS_d_lm, FLAGS_dyn_lm);
+        CpuPlan cpuPlan;
+        if (!FLAGS_cpu_weights.empty()) {
+            std::vector<float> weights = CpuPlan::parseWeights(FLAGS_cpu_weights);
+            const std::vector<std::pair<BaseDetection*, std::string>> networks{
+                {&faceDetector, FLAGS_d}, {&ageGenderDetector, FLAGS_d_ag}, {&headPoseDetector, FLAGS_d_hp},
+                {&emotionsDetector, FLAGS_d_em}, {&facialLandmarksDetector, FLAGS_d_lm}};
+            if (weights.size() != networks.size()) {
+                throw std::logic_error("-cpu_weights must have a weight for each of the face detection, age/gender, "
+                                       "head pose, emotions and facial landmarks models");
+            }
+            for (size_t i = 0; i < networks.size(); i++) {
+                if (networks[i].first->enabled()) {
+                    cpuPlan.add(networks[i].first->topoName, networks[i].second, weights[i]);
+                }
+            }
+            cpuPlan.report();
+        }
+        // the face detector and the enabled attribute networks, enabled() logs and is checked before the loads
+        ParallelLoader loader;
+        struct NetworkLoad {
+            BaseDetection* detector;
+            std::string deviceName;
+            bool dynamicBatch;
+        };
+        const std::vector<NetworkLoad> loads{
+            {&faceDetector, FLAGS_d, false}, {&ageGenderDetector, FLAGS_d_ag, FLAGS_dyn_ag},
+            {&headPoseDetector, FLAGS_d_hp, FLAGS_dyn_hp}, {&emotionsDetector, FLAGS_d_em, FLAGS_dyn_em},
+            {&facialLandmarksDetector, FLAGS_d_lm, FLAGS_dyn_lm}};
+        for (const NetworkLoad& load : loads) {
+            if (load.detector->enabled()) {
+                loader.add(load.detector->topoName, [&ie, &cpuPlan, load]() {
+                    Load(*load.detector).into(ie, load.deviceName, load.dynamicBatch,
+                                              cpuPlan.config(load.detector->topoName), FLAGS_cache_dir);
+                });
+            }
+        }
+        loader.run();
+        loader.report();
         // ----------------------------------------------------------------------------------------------------
 
         // --------------------------- 3. Doing inference -----------------------------------------------------
@@ -179,6 +225,13 @@ int main(int argc, char *argv[]) {
         cv::Mat prev_frame, next_frame;
         std::list<Face::Ptr> faces;
         size_t id = 0;
+        FaceResizer faceResizer;
+        // without -async the networks are inferred one after another, so they share the budget
+        const int attributeNetworksNum = ageGenderDetector.enabled() + headPoseDetector.enabled() +
+                                         emotionsDetector.enabled() + facialLandmarksDetector.enabled();
+        FaceScheduler scheduler(FLAGS_async || 0 == attributeNetworksNum ? FLAGS_budget_ms
+                                                                         : FLAGS_budget_ms / attributeNetworksNum);
+        CallStat ageGenderInferences, headPoseInferences, emotionsInferences, landmarksInferences;
 
         if (FLAGS_fps > 0) {
             msrate = 1000.f / FLAGS_fps;
@@ -211,6 +264,8 @@ int main(int argc, char *argv[]) {
 
         cv::Size graphSize{static_cast<int>(cap.get(cv::CAP_PROP_FRAME_WIDTH) / 4), 60};
         Presenter presenter(FLAGS_u, THROUGHPUT_METRIC_POSITION.y + 15, graphSize);
+        // no Presenter is passed, the graphs are drawn on this thread, so the output video has them too
+        AsyncPresenter display("Detection results", !FLAGS_no_show);
 
         while (true) {
             timer.start("total");
@@ -228,45 +283,8 @@ int main(int argc, char *argv[]) {
                 faceDetector.submitRequest();
             }
 
-            // Filling inputs of face analytics networks
-            for (auto &&face : prev_detection_results) {
-                if (isFaceAnalyticsEnabled) {
-                    auto clippedRect = face.location & cv::Rect(0, 0, width, height);
-                    cv::Mat face = prev_frame(clippedRect);
-                    ageGenderDetector.enqueue(face);
-                    headPoseDetector.enqueue(face);
-                    emotionsDetector.enqueue(face);
-                    facialLandmarksDetector.enqueue(face);
-                }
-            }
-
-            // Running Age/Gender Recognition, Head Pose Estimation, Emotions Recognition, and Facial Landmarks Estimation networks simultaneously
-            if (isFaceAnalyticsEnabled) {
-                ageGenderDetector.submitRequest();
-                headPoseDetector.submitRequest();
-                emotionsDetector.submitRequest();
-                facialLandmarksDetector.submitRequest();
-            }
-
-            // Reading the next frame if the current one is not the last
-            if (!isLastFrame) {
-                frameReadStatus = cap.read(next_frame);
-                if (FLAGS_loop_video && !frameReadStatus) {
-                    if (!(FLAGS_i == "cam" ? cap.open(0) : cap.open(FLAGS_i))) {
-                        throw std::logic_error("Cannot open input file or camera: " + FLAGS_i);
-                    }
-                    frameReadStatus = cap.read(next_frame);
-                }
-            }
-
-            if (isFaceAnalyticsEnabled) {
-                ageGenderDetector.wait();
-                headPoseDetector.wait();
-                emotionsDetector.wait();
-                facialLandmarksDetector.wait();
-            }
-
-            //  Postprocessing
+            // Tracking the faces of the previous frame, the attributes of a tracked face are inferred
+            // once in -*_every frames and reused in between
             std::list<Face::Ptr> prev_faces;
 
             if (!FLAGS_no_smooth) {
@@ -298,35 +316,107 @@ int main(int argc, char *argv[]) {
                     face = std::make_shared<Face>(id++, rect);
                 }
 
-                face->ageGenderEnable((ageGenderDetector.enabled() &&
-                                       i < ageGenderDetector.maxBatch));
-                if (face->isAgeGenderEnabled()) {
-                    AgeGenderDetection::Result ageGenderResult = ageGenderDetector[i];
-                    face->updateGender(ageGenderResult.maleProb);
-                    face->updateAge(ageGenderResult.age);
-                }
+                face->ageGenderEnable(ageGenderDetector.enabled());
+                face->emotionsEnable(emotionsDetector.enabled());
+                face->headPoseEnable(headPoseDetector.enabled());
+                face->landmarksEnable(facialLandmarksDetector.enabled());
 
-                face->emotionsEnable((emotionsDetector.enabled() &&
-                                      i < emotionsDetector.maxBatch));
-                if (face->isEmotionsEnabled()) {
-                    face->updateEmotions(emotionsDetector[i]);
-                }
+                faces.push_back(face);
+            }
 
-                face->headPoseEnable((headPoseDetector.enabled() &&
-                                      i < headPoseDetector.maxBatch));
-                if (face->isHeadPoseEnabled()) {
-                    face->updateHeadPose(headPoseDetector[i]);
+            // Filling inputs of face analytics networks with the faces due for inference, with -budget_ms
+            // the faces which don't fit in the budget are left for the next frames
+            std::vector<Face::Ptr> ageGenderFaces, emotionsFaces, headPoseFaces, landmarksFaces;
+            if (isFaceAnalyticsEnabled) {
+                if (ageGenderDetector.enabled()) {
+                    ageGenderFaces = scheduler.select(Face::AGE_GENDER, faces, framesCounter, FLAGS_ag_every);
+                }
+                if (headPoseDetector.enabled()) {
+                    headPoseFaces = scheduler.select(Face::HEAD_POSE, faces, framesCounter, FLAGS_hp_every);
+                }
+                if (emotionsDetector.enabled()) {
+                    emotionsFaces = scheduler.select(Face::EMOTIONS, faces, framesCounter, FLAGS_em_every);
                 }
+                if (facialLandmarksDetector.enabled()) {
+                    landmarksFaces = scheduler.select(Face::LANDMARKS, faces, framesCounter, FLAGS_lm_every);
+                }
+                // the selected faces are in the order of faces, so every face is resized once for all the networks
+                size_t ageGenderIdx = 0, headPoseIdx = 0, emotionsIdx = 0, landmarksIdx = 0;
+                for (auto &&face : faces) {
+                    faceResizer.setFace(prev_frame(face->_location));
+                    if (ageGenderIdx < ageGenderFaces.size() && ageGenderFaces[ageGenderIdx] == face) {
+                        ageGenderDetector.enqueue(faceResizer.resized(ageGenderDetector.inputSize));
+                        ageGenderIdx++;
+                    }
+                    if (headPoseIdx < headPoseFaces.size() && headPoseFaces[headPoseIdx] == face) {
+                        headPoseDetector.enqueue(faceResizer.resized(headPoseDetector.inputSize));
+                        headPoseIdx++;
+                    }
+                    if (emotionsIdx < emotionsFaces.size() && emotionsFaces[emotionsIdx] == face) {
+                        emotionsDetector.enqueue(faceResizer.resized(emotionsDetector.inputSize));
+                        emotionsIdx++;
+                    }
+                    if (landmarksIdx < landmarksFaces.size() && landmarksFaces[landmarksIdx] == face) {
+                        facialLandmarksDetector.enqueue(faceResizer.resized(facialLandmarksDetector.inputSize));
+                        landmarksIdx++;
+                    }
+                }
+            }
 
-                face->landmarksEnable((facialLandmarksDetector.enabled() &&
-                                       i < facialLandmarksDetector.maxBatch));
-                if (face->isLandmarksEnabled()) {
-                    face->updateLandmarks(facialLandmarksDetector[i]);
+            // Running Age/Gender Recognition, Head Pose Estimation, Emotions Recognition, and Facial Landmarks Estimation networks simultaneously
+            if (isFaceAnalyticsEnabled) {
+                ageGenderDetector.submitRequest();
+                headPoseDetector.submitRequest();
+                emotionsDetector.submitRequest();
+                facialLandmarksDetector.submitRequest();
+            }
+
+            // Reading the next frame if the current one is not the last
+            if (!isLastFrame) {
+                frameReadStatus = cap.read(next_frame);
+                if (FLAGS_loop_video && !frameReadStatus) {
+                    if (!(FLAGS_i == "cam" ? cap.open(0) : cap.open(FLAGS_i))) {
+                        throw std::logic_error("Cannot open input file or camera: " + FLAGS_i);
+                    }
+                    frameReadStatus = cap.read(next_frame);
                 }
+            }
 
-                faces.push_back(face);
+            if (isFaceAnalyticsEnabled) {
+                // the time of a network is from its submission until its requests complete, without the read
+                const auto waitFaces = [&](BaseDetection& detector, Face::Attribute attribute, size_t facesNum) {
+                    detector.wait();
+                    if (facesNum > 0) {
+                        scheduler.update(attribute, facesNum, detector.getSubmissionMs());
+                    }
+                };
+                waitFaces(ageGenderDetector, Face::AGE_GENDER, ageGenderFaces.size());
+                waitFaces(headPoseDetector, Face::HEAD_POSE, headPoseFaces.size());
+                waitFaces(emotionsDetector, Face::EMOTIONS, emotionsFaces.size());
+                waitFaces(facialLandmarksDetector, Face::LANDMARKS, landmarksFaces.size());
+            }
+
+            //  Postprocessing
+            for (size_t i = 0; i < ageGenderFaces.size(); i++) {
+                AgeGenderDetection::Result ageGenderResult = ageGenderDetector[i];
+                ageGenderFaces[i]->updateGender(ageGenderResult.maleProb);
+                ageGenderFaces[i]->updateAge(ageGenderResult.age);
+            }
+            for (size_t i = 0; i < emotionsFaces.size(); i++) {
+                emotionsFaces[i]->updateEmotions(emotionsDetector[i]);
+            }
+            for (size_t i = 0; i < headPoseFaces.size(); i++) {
+                headPoseFaces[i]->updateHeadPose(headPoseDetector[i]);
+            }
+            for (size_t i = 0; i < landmarksFaces.size(); i++) {
+                landmarksFaces[i]->updateLandmarks(facialLandmarksDetector[i]);
             }
 
+            ageGenderInferences.countInferences(ageGenderFaces.size(), faces.size() - ageGenderFaces.size());
+            headPoseInferences.countInferences(headPoseFaces.size(), faces.size() - headPoseFaces.size());
+            emotionsInferences.countInferences(emotionsFaces.size(), faces.size() - emotionsFaces.size());
+            landmarksInferences.countInferences(landmarksFaces.size(), faces.size() - landmarksFaces.size());
+
             presenter.drawGraphs(prev_frame);
 
             //  Visualizing results
@@ -341,7 +431,7 @@ int main(int argc, char *argv[]) {
                 visualizer->draw(prev_frame, faces);
 
                 if (!FLAGS_no_show) {
-                    cv::imshow("Detection results", prev_frame);
+                    display.show(prev_frame);
                 }
             }
 
@@ -363,11 +453,11 @@ int main(int argc, char *argv[]) {
             if (isLastFrame) {
                 if (!FLAGS_no_wait) {
                     std::cout << "No more frames to process!" << std::endl;
-                    cv::waitKey(0);
+                    display.waitKey(0);
                 }
                 break;
             } else if (!FLAGS_no_show) {
-                int key = cv::waitKey(delay);
+                int key = display.waitKey(delay);
                 if (27 == key || 'Q' == key || 'q' == key) {
                     break;
                 }
@@ -377,6 +467,27 @@ int main(int argc, char *argv[]) {
 
         slog::info << "Number of processed frames: " << framesCounter << slog::endl;
         slog::info << "Total image throughput: " << framesCounter * (1000.f / timer["total"].getTotalDuration()) << " fps" << slog::endl;
+        struct AttributeInferences {
+            const BaseDetection* detector;
+            CallStat* inferences;
+            Face::Attribute attribute;
+        };
+        const std::vector<AttributeInferences> attributeInferences{
+            {&ageGenderDetector, &ageGenderInferences, Face::AGE_GENDER},
+            {&headPoseDetector, &headPoseInferences, Face::HEAD_POSE},
+            {&emotionsDetector, &emotionsInferences, Face::EMOTIONS},
+            {&facialLandmarksDetector, &landmarksInferences, Face::LANDMARKS}};
+        for (const auto& inferences : attributeInferences) {
+            if (inferences.detector->enabled()) {
+                slog::info << inferences.detector->topoName << " inferences saved by tracking: "
+                           << static_cast<int>(100 * inferences.inferences->getSavedInferencesRatio() + 0.5) << "%"
+                           << slog::endl;
+                if (scheduler.hasBudget()) {
+                    slog::info << inferences.detector->topoName << " inferences carried over by the budget: "
+                               << scheduler.getCarriedOver(inferences.attribute) << slog::endl;
+                }
+            }
+        }
 
         // Showing performance results
         if (FLAGS_pc) {
@@ -23,30 +23,37 @@ EmotionBarVisualizer::EmotionBarVisualizer(std::vector<std::string> const& emoti
 
     textSize = cv::getTextSize(*itMax, cv::FONT_HERSHEY_COMPLEX_SMALL, textScale, textThickness, &textBaseline);
     ystep = (emotionNames.size() < 2) ? 0 : (size.height - 2 * padding.height - textSize.height) / (emotionNames.size() - 1);
+
+    // The names and the outlines of the bars are the same for all the faces, they are rendered once to a mask
+    staticMask = cv::Mat::zeros(size, CV_8UC1);
+    for (size_t i = 0; i < emotionNames.size(); i++) {
+        cv::Point torg(padding.width, static_cast<int>(i) * ystep + textSize.height + padding.height);
+
+        int textWidth = textSize.width + 10;
+        cv::Rect r(torg.x + textWidth, torg.y - textSize.height, size.width - 2 * padding.width - textWidth, textSize.height + textBaseline / 2);
+
+        cv::putText(staticMask, emotionNames[i], torg, cv::FONT_HERSHEY_COMPLEX_SMALL, textScale, cv::Scalar(255), textThickness);
+        cv::rectangle(staticMask, r, cv::Scalar(255), 1);
+        barRects.push_back(r);
+    }
+    background.create(size, CV_8UC3);
 }
 
 cv::Size EmotionBarVisualizer::getSize() {
     return size;
 }
 
-void EmotionBarVisualizer::draw(cv::Mat& img, std::map<std::string, float> emotions, cv::Point org, cv::Scalar fgcolor, cv::Scalar bgcolor) {
+void EmotionBarVisualizer::draw(cv::Mat& img, const std::map<std::string, float>& emotions, cv::Point org, cv::Scalar fgcolor, cv::Scalar bgcolor) {
     cv::Mat tmp = img(cv::Rect(org.x, org.y, size.width, size.height));
-    cv::addWeighted(tmp, 1.f - opacity, bgcolor, opacity, 0, tmp);
-
-    auto drawEmotion = [&](int n, std::string text, float value) {
-        cv::Point torg(org.x + padding.width, org.y + n * ystep + textSize.height + padding.height);
-
-        int textWidth = textSize.width + 10;
-        cv::Rect r(torg.x + textWidth, torg.y - textSize.height, size.width - 2 * padding.width - textWidth, textSize.height + textBaseline / 2);
-
-        cv::putText(img, text, torg, cv::FONT_HERSHEY_COMPLEX_SMALL, textScale, fgcolor, textThickness);
-        cv::rectangle(img, r, fgcolor, 1);
-        r.width = static_cast<int>(r.width * value);
+    background.setTo(bgcolor);
+    cv::addWeighted(tmp, 1.f - opacity, background, opacity, 0, tmp);
+    tmp.setTo(fgcolor, staticMask);
+
+    for (size_t i = 0; i < emotionNames.size(); i++) {
+        auto emotion = emotions.find(emotionNames[i]);
+        cv::Rect r = barRects[i] + org;
+        r.width = static_cast<int>(r.width * (emotion == emotions.end() ? 0.f : emotion->second));
         cv::rectangle(img, r, fgcolor, cv::FILLED);
-    };
-
-    for (size_t i = 0; i< emotionNames.size(); i++) {
-        drawEmotion(i, emotionNames[i], emotions[emotionNames[i]]);
     }
 }
 
@@ -77,16 +84,6 @@ HeadPoseVisualizer::HeadPoseVisualizer(float scale, cv::Scalar xAxisColor, cv::S
                         xAxisColor(xAxisColor), yAxisColor(yAxisColor), zAxisColor(zAxisColor), axisThickness(axisThickness), scale(scale) {
 }
 
-void HeadPoseVisualizer::buildCameraMatrix(cv::Mat& cameraMatrix, int cx, int cy, float focalLength) {
-    if (!cameraMatrix.empty()) return;
-    cameraMatrix = cv::Mat::zeros(3, 3, CV_32F);
-    cameraMatrix.at<float>(0) = focalLength;
-    cameraMatrix.at<float>(2) = static_cast<float>(cx);
-    cameraMatrix.at<float>(4) = focalLength;
-    cameraMatrix.at<float>(5) = static_cast<float>(cy);
-    cameraMatrix.at<float>(8) = 1;
-}
-
 void HeadPoseVisualizer::draw(cv::Mat& frame, cv::Point3f cpoint, HeadPoseDetection::Results headPose) {
     double yaw   = headPose.angle_y;
     double pitch = headPose.angle_p;
@@ -108,54 +105,24 @@ void HeadPoseVisualizer::draw(cv::Mat& frame, cv::Point3f cpoint, HeadPoseDetect
                    static_cast<float>(sin(roll)),  static_cast<float>(cos(roll)), 0,
                    0, 0, 1);
 
+    // The axes are projected with the fixed size matrices, nothing is allocated per face
+    const cv::Matx33f r = Rz * Ry * Rx;
+    const float focalLength = 950.f;
+    const cv::Vec3f o(0, 0, focalLength);
 
-    auto r = cv::Mat(Rz*Ry*Rx);
-    cv::Mat cameraMatrix;
-    buildCameraMatrix(cameraMatrix, frame.cols / 2, frame.rows / 2, 950.0);
-
-    cv::Mat xAxis(3, 1, CV_32F), yAxis(3, 1, CV_32F), zAxis(3, 1, CV_32F), zAxis1(3, 1, CV_32F);
-
-    xAxis.at<float>(0) = 1 * scale;
-    xAxis.at<float>(1) = 0;
-    xAxis.at<float>(2) = 0;
-
-    yAxis.at<float>(0) = 0;
-    yAxis.at<float>(1) = -1 * scale;
-    yAxis.at<float>(2) = 0;
-
-    zAxis.at<float>(0) = 0;
-    zAxis.at<float>(1) = 0;
-    zAxis.at<float>(2) = -1 * scale;
-
-    zAxis1.at<float>(0) = 0;
-    zAxis1.at<float>(1) = 0;
-    zAxis1.at<float>(2) = 1 * scale;
-
-    cv::Mat o(3, 1, CV_32F, cv::Scalar(0));
-    o.at<float>(2) = cameraMatrix.at<float>(0);
-
-    xAxis = r * xAxis + o;
-    yAxis = r * yAxis + o;
-    zAxis = r * zAxis + o;
-    zAxis1 = r * zAxis1 + o;
-
-    cv::Point p1, p2;
-
-    p2.x = static_cast<int>((xAxis.at<float>(0) / xAxis.at<float>(2) * cameraMatrix.at<float>(0)) + cpoint.x);
-    p2.y = static_cast<int>((xAxis.at<float>(1) / xAxis.at<float>(2) * cameraMatrix.at<float>(4)) + cpoint.y);
-    cv::line(frame, cv::Point(static_cast<int>(cpoint.x), static_cast<int>(cpoint.y)), p2, xAxisColor, axisThickness);
-
-    p2.x = static_cast<int>((yAxis.at<float>(0) / yAxis.at<float>(2) * cameraMatrix.at<float>(0)) + cpoint.x);
-    p2.y = static_cast<int>((yAxis.at<float>(1) / yAxis.at<float>(2) * cameraMatrix.at<float>(4)) + cpoint.y);
-    cv::line(frame, cv::Point(static_cast<int>(cpoint.x), static_cast<int>(cpoint.y)), p2, yAxisColor, axisThickness);
+    auto project = [&](const cv::Vec3f& axis) {
+        const cv::Vec3f p = r * axis + o;
+        return cv::Point(static_cast<int>((p[0] / p[2] * focalLength) + cpoint.x),
+                         static_cast<int>((p[1] / p[2] * focalLength) + cpoint.y));
+    };
 
-    p1.x = static_cast<int>((zAxis1.at<float>(0) / zAxis1.at<float>(2) * cameraMatrix.at<float>(0)) + cpoint.x);
-    p1.y = static_cast<int>((zAxis1.at<float>(1) / zAxis1.at<float>(2) * cameraMatrix.at<float>(4)) + cpoint.y);
+    const cv::Point center(static_cast<int>(cpoint.x), static_cast<int>(cpoint.y));
+    cv::line(frame, center, project(cv::Vec3f(scale, 0, 0)), xAxisColor, axisThickness);
+    cv::line(frame, center, project(cv::Vec3f(0, -scale, 0)), yAxisColor, axisThickness);
 
-    p2.x = static_cast<int>((zAxis.at<float>(0) / zAxis.at<float>(2) * cameraMatrix.at<float>(0)) + cpoint.x);
-    p2.y = static_cast<int>((zAxis.at<float>(1) / zAxis.at<float>(2) * cameraMatrix.at<float>(4)) + cpoint.y);
-    cv::line(frame, p1, p2, zAxisColor, axisThickness);
-    cv::circle(frame, p2, 3, zAxisColor, axisThickness);
+    const cv::Point zAxisEnd = project(cv::Vec3f(0, 0, -scale));
+    cv::line(frame, project(cv::Vec3f(0, 0, scale)), zAxisEnd, zAxisColor, axisThickness);
+    cv::circle(frame, zAxisEnd, 3, zAxisColor, axisThickness);
 }
 
 // Visualizer
@@ -186,25 +153,26 @@ void Visualizer::enableEmotionBar(std::vector<std::string> const& emotionNames)
     }
 }
 
-void Visualizer::drawFace(cv::Mat& img, Face::Ptr f, bool drawEmotionBar) {
+void Visualizer::drawFace(cv::Mat& img, const Face::Ptr& f, bool drawEmotionBar) {
     auto genderColor = (f->isAgeGenderEnabled()) ?
                        ((f->isMale()) ? cv::Scalar(255, 0, 0) :
                                         cv::Scalar(147, 20, 255)) :
                                         cv::Scalar(100, 100, 100);
 
-    std::ostringstream out;
+    label.clear();
     if (f->isAgeGenderEnabled()) {
-        out << (f->isMale() ? "Male" : "Female");
-        out << "," << f->getAge();
+        label += f->isMale() ? "Male" : "Female";
+        label += ",";
+        label += std::to_string(f->getAge());
     }
 
     if (f->isEmotionsEnabled()) {
-        auto emotion = f->getMainEmotion();
-        out << "," << emotion.first;
+        label += ",";
+        label += f->getMainEmotion().first;
     }
 
     cv::putText(img,
-                out.str(),
+                label,
                 cv::Point2f(static_cast<float>(f->_location.x), static_cast<float>(f->_location.y - 20)),
                 cv::FONT_HERSHEY_COMPLEX_SMALL,
                 1.5,
@@ -288,11 +256,11 @@ cv::Point Visualizer::findCellForEmotionBar() {
     return cv::Point(-1, -1);
 }
 
-void Visualizer::draw(cv::Mat img, std::list<Face::Ptr> faces) {
+void Visualizer::draw(cv::Mat img, const std::list<Face::Ptr>& faces) {
     drawMap.setTo(0);
     frameCounter++;
 
-    std::vector<Face::Ptr> newFaces;
+    newFaces.clear();
     for (auto&& face : faces) {
         if (emotionVisualizer) {
             if (drawParams.find(face->getId()) == drawParams.end()) {
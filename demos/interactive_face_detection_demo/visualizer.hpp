@@ -23,10 +23,13 @@ public:
     explicit EmotionBarVisualizer(std::vector<std::string> const& emotionNames, cv::Size size = cv::Size(300, 140), cv::Size padding = cv::Size(10, 10),
                               double opacity = 0.6, double textScale = 1, int textThickness = 1);
 
-    void draw(cv::Mat& img, std::map<std::string, float> emotions, cv::Point org, cv::Scalar fgcolor, cv::Scalar bgcolor);
+    void draw(cv::Mat& img, const std::map<std::string, float>& emotions, cv::Point org, cv::Scalar fgcolor, cv::Scalar bgcolor);
     cv::Size getSize();
 private:
     std::vector<std::string> emotionNames;
+    cv::Mat staticMask;  // the names and the bar outlines, rendered once
+    std::vector<cv::Rect> barRects;  // of the emotions relative to the bar origin
+    cv::Mat background;  // scratch image of the bar size
     cv::Size size;
     cv::Size padding;
     cv::Size textSize;
@@ -66,9 +69,6 @@ public:
 
     void draw(cv::Mat& frame, cv::Point3f cpoint, HeadPoseDetection::Results headPose);
 
-private:
-    void buildCameraMatrix(cv::Mat& cameraMatrix, int cx, int cy, float focalLength);
-
 private:
     cv::Scalar xAxisColor;
     cv::Scalar yAxisColor;
@@ -99,10 +99,10 @@ public:
     explicit Visualizer(cv::Size const& imgSize, int leftPadding = 10, int rightPadding = 10, int topPadding = 75, int bottomPadding = 10);
 
     void enableEmotionBar(std::vector<std::string> const& emotionNames);
-    void draw(cv::Mat img, std::list<Face::Ptr> faces);
+    void draw(cv::Mat img, const std::list<Face::Ptr>& faces);
 
 private:
-    void drawFace(cv::Mat& img, Face::Ptr f, bool drawEmotionBar);
+    void drawFace(cv::Mat& img, const Face::Ptr& f, bool drawEmotionBar);
     cv::Point findCellForEmotionBar();
 
     std::map<size_t, DrawParams> drawParams;
@@ -123,4 +123,8 @@ private:
     int bottomPadding;
     cv::Size emotionBarSize;
     size_t frameCounter;
+
+    // reused from frame to frame
+    std::vector<Face::Ptr> newFaces;
+    std::string label;
 };
@@ -15,12 +15,22 @@
 #include <string>
 #include <vector>
 #include <iomanip>
+#include <chrono>
+#include <sstream>
+
+#include <opencv2/videoio.hpp>
 
 #include <inference_engine.hpp>
 
+#include <monitors/presenter.h>
 #include <samples/ocv_common.hpp>
 #include <samples/slog.hpp>
 #include <samples/args_helper.hpp>
+#include <samples/mapped_weights.hpp>
+#include <samples/network_cache.hpp>
+#include <samples/infer_request_pool.hpp>
+#include <samples/frame_prefetcher.hpp>
+#include <samples/image_set_loader.hpp>
 
 #include "mask_rcnn_demo.h"
 
@@ -48,6 +58,250 @@ bool ParseAndCheckCommandLine(int argc, char *argv[]) {
     return true;
 }
 
+/**
+* @brief A mask of a detected object to paste into its box
+*/
+struct PastedMask {
+    cv::Rect roi;
+    const float* mask;  // of the mask size
+    cv::Vec3b color;
+    std::size_t columnsOffset;  // of the columns of the box in the column tables
+};
+
+/**
+* @brief Pastes the masks into the image in their order, each mask is resized bilinearly to its box like
+* cv::resize does, and the pixels where it is greater than the threshold are blended with the color of the mask.
+* The resizing, the thresholding and the blending are fused in a loop over the box, which writes the image directly,
+* and the rows of the image are processed in parallel, so the overlapping masks are pasted in the same order as
+* by a serial loop. xSources, xNext and xWeights are the source columns of the columns of all the boxes
+*/
+void pasteMasks(cv::Mat& image, const std::vector<PastedMask>& masks, cv::Size maskSize,
+                const std::vector<int>& xSources, const std::vector<int>& xNext, const std::vector<float>& xWeights,
+                float threshold, float alpha) {
+    cv::parallel_for_(cv::Range(0, image.rows), [&](const cv::Range& range) {
+        for (const PastedMask& pasted : masks) {
+            const int rowBegin = std::max(range.start, pasted.roi.y);
+            const int rowEnd = std::min(range.end, pasted.roi.y + pasted.roi.height);
+            const float yScale = static_cast<float>(maskSize.height) / pasted.roi.height;
+            const cv::Vec3f blendedColor = cv::Vec3f(pasted.color) * alpha;
+            for (int y = rowBegin; y < rowEnd; y++) {
+                const float sy = std::min(std::max((y - pasted.roi.y + 0.5f) * yScale - 0.5f, 0.0f),
+                                          static_cast<float>(maskSize.height - 1));
+                const int y0 = static_cast<int>(sy);
+                const int y1 = std::min(y0 + 1, maskSize.height - 1);
+                const float fy = sy - y0;
+                const float* row0 = pasted.mask + y0 * maskSize.width;
+                const float* row1 = pasted.mask + y1 * maskSize.width;
+                cv::Vec3b* pixels = image.ptr<cv::Vec3b>(y) + pasted.roi.x;
+                for (int x = 0; x < pasted.roi.width; x++) {
+                    const std::size_t column = pasted.columnsOffset + x;
+                    const int x0 = xSources[column];
+                    const int x1 = xNext[column];
+                    const float fx = xWeights[column];
+                    const float top = row0[x0] + fx * (row0[x1] - row0[x0]);
+                    const float bottom = row1[x0] + fx * (row1[x1] - row1[x0]);
+                    if (top + fy * (bottom - top) > threshold) {
+                        cv::Vec3b& pixel = pixels[x];
+                        for (int c = 0; c < 3; c++) {
+                            pixel[c] = cv::saturate_cast<uchar>(blendedColor[c] + pixel[c] * (1.0f - alpha));
+                        }
+                    }
+                }
+            }
+        }
+    });
+}
+
+/**
+* @brief Returns the copies of the images of the completed request with the boxes and the masks of the detections
+* above the probability threshold drawn
+*/
+std::vector<cv::Mat> renderDetections(InferRequest& infer_request, const std::vector<cv::Mat>& images,
+                                      size_t netBatchSize, bool logDetections) {
+    const auto do_blob = infer_request.GetBlob(FLAGS_detection_output_name.c_str());
+    const auto do_data = do_blob->buffer().as<float*>();
+
+    const auto masks_blob = infer_request.GetBlob(FLAGS_masks_name.c_str());
+    const auto masks_data = masks_blob->buffer().as<float*>();
+
+    const float PROBABILITY_THRESHOLD = 0.2f;
+    const float MASK_THRESHOLD = 0.5f;  // threshold used to determine whether mask pixel corresponds to object or to background
+    // amount of elements in each detected box description (batch, label, prob, x1, y1, x2, y2)
+    IE_ASSERT(do_blob->getTensorDesc().getDims().size() == 2);
+    size_t BOX_DESCRIPTION_SIZE = do_blob->getTensorDesc().getDims().back();
+
+    const TensorDesc& masksDesc = masks_blob->getTensorDesc();
+    IE_ASSERT(masksDesc.getDims().size() == 4);
+    size_t BOXES = getTensorBatch(masksDesc);
+    size_t C = getTensorChannels(masksDesc);
+    size_t H = getTensorHeight(masksDesc);
+    size_t W = getTensorWidth(masksDesc);
+
+
+    size_t box_stride = W * H * C;
+
+    std::map<size_t, size_t> class_color;
+
+    std::vector<cv::Mat> output_images;
+    for (const auto &img : images) {
+        output_images.push_back(img.clone());
+    }
+
+    /** The masks of the boxes of every image and the column tables of the resizing of all of them,
+     *  the tables are the only scratch memory of the pasting **/
+    std::vector<std::vector<PastedMask>> pasted_masks(output_images.size());
+    std::vector<std::vector<cv::Rect>> boxes(output_images.size());
+    std::vector<int> x_sources, x_next;
+    std::vector<float> x_weights;
+
+    /** Iterating over all boxes **/
+    for (size_t box = 0; box < BOXES; ++box) {
+        float* box_info = do_data + box * BOX_DESCRIPTION_SIZE;
+        auto batch = static_cast<int>(box_info[0]);
+        if (batch < 0)
+            break;
+        if (batch >= static_cast<int>(netBatchSize))
+            throw std::logic_error("Invalid batch ID within detection output box");
+        float prob = box_info[2];
+        if (prob <= PROBABILITY_THRESHOLD)
+            continue;  // the box and its mask aren't decoded
+        float x1 = std::min(std::max(0.0f, box_info[3] * images[batch].cols), static_cast<float>(images[batch].cols));
+        float y1 = std::min(std::max(0.0f, box_info[4] * images[batch].rows), static_cast<float>(images[batch].rows));
+        float x2 = std::min(std::max(0.0f, box_info[5] * images[batch].cols), static_cast<float>(images[batch].cols));
+        float y2 = std::min(std::max(0.0f, box_info[6] * images[batch].rows), static_cast<float>(images[batch].rows));
+        int box_width = std::min(static_cast<int>(std::max(0.0f, x2 - x1)), images[batch].cols);
+        int box_height = std::min(static_cast<int>(std::max(0.0f, y2 - y1)), images[batch].rows);
+        auto class_id = static_cast<size_t>(box_info[1] + 1e-6f);
+        size_t color_index = class_color.emplace(class_id, class_color.size()).first->second;
+        auto& color = CITYSCAPES_COLORS[color_index % arraySize(CITYSCAPES_COLORS)];
+        float* mask_arr = masks_data + box_stride * box + H * W * (class_id - 1);
+        if (logDetections) {
+            slog::info << "Detected class " << class_id << " with probability " << prob << " from batch " << batch
+                       << ": [" << x1 << ", " << y1 << "], [" << x2 << ", " << y2 << "]" << slog::endl;
+        }
+
+        cv::Rect roi = cv::Rect(static_cast<int>(x1), static_cast<int>(y1), box_width, box_height);
+        boxes[batch].push_back(roi);
+        if (roi.area() == 0)
+            continue;
+
+        /** The source columns of the bilinear resizing of the mask to the box **/
+        const size_t columns_offset = x_sources.size();
+        const float x_scale = static_cast<float>(W) / box_width;
+        for (int x = 0; x < box_width; x++) {
+            const float sx = std::min(std::max((x + 0.5f) * x_scale - 0.5f, 0.0f), static_cast<float>(W - 1));
+            x_sources.push_back(static_cast<int>(sx));
+            x_next.push_back(std::min(static_cast<int>(sx) + 1, static_cast<int>(W) - 1));
+            x_weights.push_back(sx - static_cast<int>(sx));
+        }
+        pasted_masks[batch].push_back({roi, mask_arr, cv::Vec3b(color.blue(), color.green(), color.red()),
+                                       columns_offset});
+    }
+    const float alpha = 0.7f;
+    for (size_t i = 0; i < output_images.size(); i++) {
+        pasteMasks(output_images[i], pasted_masks[i], cv::Size(static_cast<int>(W), static_cast<int>(H)),
+                   x_sources, x_next, x_weights, MASK_THRESHOLD, alpha);
+        for (const cv::Rect& roi : boxes[i]) {
+            cv::rectangle(output_images[i], roi, cv::Scalar(0, 0, 1), 1);
+        }
+    }
+    return output_images;
+}
+
+/**
+* @brief Segments the frames of a video by the requests of a frame each, the masks of the oldest completed frame are
+* pasted and shown while the next frames are inferred
+*/
+void runVideoMode(ExecutableNetwork& executable_network, const std::string& imageInputName,
+                  const std::string& imInfoInputName, size_t netInputHeight, size_t netInputWidth) {
+    InferRequestPool<cv::Mat> inferRequests(executable_network,
+        0 == FLAGS_nireq ? defaultInferRequestsNum(executable_network, FLAGS_d) : FLAGS_nireq);
+    slog::info << "Number of infer requests: " << inferRequests.depth() << slog::endl;
+    /** The image info doesn't change, it is set to every request once **/
+    if (!imInfoInputName.empty()) {
+        for (const InferRequest::Ptr& request : inferRequests.requests()) {
+            auto data = request->GetBlob(imInfoInputName)->buffer().as<PrecisionTrait<Precision::FP32>::value_type *>();
+            data[0] = static_cast<float>(netInputHeight);  // height
+            data[1] = static_cast<float>(netInputWidth);  // width
+            data[2] = 1;
+        }
+    }
+
+    std::unique_ptr<VideoCaptureSource> source = VideoCaptureSource::open(FLAGS_i);
+    const double fps = source->capture().get(cv::CAP_PROP_FPS);
+    FramePrefetcher frames(std::move(source));
+    cv::Mat frame;
+    if (!frames.read(frame)) {
+        throw std::runtime_error("Can't read a frame from " + FLAGS_i);
+    }
+    cv::VideoWriter videoWriter;
+    if (!FLAGS_o.empty() && !videoWriter.open(FLAGS_o, cv::VideoWriter::fourcc('M', 'J', 'P', 'G'),
+                                              fps > 0 ? fps : 25, frame.size())) {
+        throw std::runtime_error("Can't open the output video " + FLAGS_o);
+    }
+    const cv::Size graphSize{frame.cols / 4, 60};
+    Presenter presenter(FLAGS_u, frame.rows - graphSize.height - 10, graphSize);
+
+    std::cout << "To close the application, press 'CTRL+C' here";
+    if (!FLAGS_no_show) {
+        std::cout << " or switch to the output window and press ESC key";
+    }
+    std::cout << std::endl;
+
+    typedef std::chrono::duration<double, std::ratio<1, 1000>> ms;
+    std::chrono::high_resolution_clock::duration latencySum{0};
+    size_t framesNum = 0;
+    const auto startTime = std::chrono::high_resolution_clock::now();
+    while (true) {
+        while (!frame.empty() && inferRequests.hasIdle()) {
+            Blob::Ptr input = inferRequests.idleRequest()->GetBlob(imageInputName);
+            matU8ToBlob<unsigned char>(frame, input);
+            inferRequests.startAsync(frame);
+            frame = cv::Mat();  // the started request keeps the frame
+            if (!frames.read(frame)) {
+                frame.release();
+            }
+        }
+        if (inferRequests.empty()) {
+            break;  // end of the input
+        }
+
+        InferRequestPool<cv::Mat>::Result result = inferRequests.pop();
+        cv::Mat output = renderDetections(*result.request, {result.payload}, 1, false).front();
+        inferRequests.release(result);
+        const auto now = std::chrono::high_resolution_clock::now();
+        latencySum += now - result.startTime;
+        framesNum++;
+
+        if (videoWriter.isOpened()) {
+            videoWriter.write(output);
+        }
+        if (!FLAGS_no_show) {
+            presenter.drawGraphs(output);
+            std::ostringstream out;
+            out << "Latency: " << std::fixed << std::setprecision(1)
+                << std::chrono::duration_cast<ms>(now - result.startTime).count() << " ms, FPS: "
+                << framesNum / std::chrono::duration_cast<std::chrono::duration<double>>(now - startTime).count();
+            cv::putText(output, out.str(), cv::Point2f(0, 25), cv::FONT_HERSHEY_TRIPLEX, 0.6, cv::Scalar(0, 255, 0));
+            cv::imshow("Detection results", output);
+            const int key = cv::waitKey(1);
+            if (27 == key) {  // Esc
+                break;
+            }
+            presenter.handleKey(key);
+        }
+    }
+
+    if (framesNum > 0) {
+        const double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(
+            std::chrono::high_resolution_clock::now() - startTime).count();
+        std::cout << "Mean latency: " << std::fixed << std::setprecision(1)
+                  << std::chrono::duration_cast<ms>(latencySum).count() / framesNum << " ms" << std::endl;
+        std::cout << "Throughput: " << framesNum / seconds << " FPS" << std::endl;
+    }
+    std::cout << presenter.reportMeans() << std::endl;
+}
+
 int main(int argc, char *argv[]) {
     try {
         std::cout << "InferenceEngine: " << InferenceEngine::GetInferenceEngineVersion() << std::endl;
@@ -57,10 +311,13 @@ int main(int argc, char *argv[]) {
             return 0;
         }
 
+        const bool videoMode = FLAGS_video || "cam" == FLAGS_i;
         /** This vector stores paths to the processed images **/
         std::vector<std::string> imagePaths;
-        parseInputFilesArguments(imagePaths);
-        if (imagePaths.empty()) throw std::logic_error("No suitable images were found");
+        if (!videoMode) {
+            parseInputFilesArguments(imagePaths);
+            if (imagePaths.empty()) throw std::logic_error("No suitable images were found");
+        }
         // -----------------------------------------------------------------------------------------------------
 
         // ---------------------Load inference engine------------------------------------------------
@@ -89,7 +346,7 @@ int main(int argc, char *argv[]) {
         slog::info << "Loading network files" << slog::endl;
 
         /** Read network model **/
-        auto network = ie.ReadNetwork(FLAGS_m);
+        auto network = readNetworkMapped(ie, FLAGS_m);
 
         // add DetectionOutput layer as output so we can get detected boxes and their probabilities
         network.addOutput(FLAGS_detection_output_name.c_str(), 0);
@@ -102,18 +359,25 @@ int main(int argc, char *argv[]) {
         InputsDataMap inputInfo(network.getInputsInfo());
 
         std::string imageInputName;
+        std::string imInfoInputName;
 
         for (const auto & inputInfoItem : inputInfo) {
             if (inputInfoItem.second->getTensorDesc().getDims().size() == 4) {  // first input contains images
                 imageInputName = inputInfoItem.first;
                 inputInfoItem.second->setPrecision(Precision::U8);
             } else if (inputInfoItem.second->getTensorDesc().getDims().size() == 2) {  // second input contains image info
+                imInfoInputName = inputInfoItem.first;
                 inputInfoItem.second->setPrecision(Precision::FP32);
             } else {
                 throw std::logic_error("Unsupported input shape with size = " + std::to_string(inputInfoItem.second->getTensorDesc().getDims().size()));
             }
         }
 
+        /** The frames of a video are inferred by the requests of a frame each **/
+        if (videoMode) {
+            network.setBatchSize(1);
+        }
+
         /** network dimensions for image input **/
         const TensorDesc& inputDesc = inputInfo[imageInputName]->getTensorDesc();
         IE_ASSERT(inputDesc.getDims().size() == 4);
@@ -123,33 +387,34 @@ int main(int argc, char *argv[]) {
 
         slog::info << "Network batch size is " << netBatchSize << slog::endl;
 
-        /** Collect images **/
-        std::vector<cv::Mat> images;
-
-        if (netBatchSize > imagePaths.size()) {
-            slog::warn << "Network batch size is greater than number of images (" << imagePaths.size() <<
-                       "), some input files will be duplicated" << slog::endl;
-        } else if (netBatchSize < imagePaths.size()) {
-            slog::warn << "Network batch size is less than number of images (" << imagePaths.size() <<
-                       "), some input files will be ignored" << slog::endl;
-        }
+        if (!videoMode) {
+            /** Collect images **/
+            std::vector<cv::Mat> images;
 
-        for (size_t i = 0, inputIndex = 0; i < netBatchSize; i++, inputIndex++) {
-            if (inputIndex >= imagePaths.size()) {
-                inputIndex = 0;
+            if (netBatchSize > imagePaths.size()) {
+                slog::warn << "Network batch size is greater than number of images (" << imagePaths.size() <<
+                           "), some input files will be duplicated" << slog::endl;
+            } else if (netBatchSize < imagePaths.size()) {
+                slog::warn << "Network batch size is less than number of images (" << imagePaths.size() <<
+                           "), some input files will be ignored" << slog::endl;
             }
-            slog::info << "Prepare image " << imagePaths[inputIndex] << slog::endl;
-
-            cv::Mat image = cv::imread(imagePaths[inputIndex], cv::IMREAD_COLOR);
 
-            if (image.empty()) {
-                slog::warn << "Image " + imagePaths[inputIndex] + " cannot be read!" << slog::endl;
-                continue;
+            std::vector<std::string> batchPaths;
+            for (size_t i = 0, inputIndex = 0; i < netBatchSize; i++, inputIndex++) {
+                if (inputIndex >= imagePaths.size()) {
+                    inputIndex = 0;
+                }
+                slog::info << "Prepare image " << imagePaths[inputIndex] << slog::endl;
+                batchPaths.push_back(imagePaths[inputIndex]);
             }
 
-            images.push_back(image);
+            /** The images of the batch are decoded in parallel **/
+            ImageSetLoader loader(batchPaths, netBatchSize);
+            for (auto &image : loader.nextBatch(netBatchSize)) {
+                images.push_back(image.image);
+            }
+            if (images.empty()) throw std::logic_error("Valid input images were not found!");
         }
-        if (images.empty()) throw std::logic_error("Valid input images were not found!");
 
         // -----------------------------------------------------------------------------------------------------
 
@@ -165,122 +430,59 @@ int main(int argc, char *argv[]) {
 
         // -------------------------Load model to the device----------------------------------------------------
         slog::info << "Loading model to the device" << slog::endl;
-        auto executable_network = ie.LoadNetwork(network, FLAGS_d);
-
-        // -------------------------Create Infer Request--------------------------------------------------------
-        slog::info << "Create infer request" << slog::endl;
-        auto infer_request = executable_network.CreateInferRequest();
-
-        // -----------------------------------------------------------------------------------------------------
-
-        // -------------------------------Set input data--------------------------------------------------------
-        slog::info << "Setting input data to the blobs" << slog::endl;
-
-        /** Iterate over all the input blobs **/
-        for (const auto & inputInfoItem : inputInfo) {
-            Blob::Ptr input = infer_request.GetBlob(inputInfoItem.first);
-
-            /** Fill first input tensor with images. First b channel, then g and r channels **/
-            if (inputInfoItem.second->getTensorDesc().getDims().size() == 4) {
-                /** Iterate over all input images **/
-                for (size_t image_id = 0; image_id < images.size(); ++image_id)
-                    matU8ToBlob<unsigned char>(images[image_id], input, image_id);
-            }
-
-            /** Fill second input tensor with image info **/
-            if (inputInfoItem.second->getTensorDesc().getDims().size() == 2) {
-                auto data = input->buffer().as<PrecisionTrait<Precision::FP32>::value_type *>();
-                data[0] = static_cast<float>(netInputHeight);  // height
-                data[1] = static_cast<float>(netInputWidth);  // width
-                data[2] = 1;
+        auto executable_network = loadNetworkCached(ie, network, FLAGS_m, FLAGS_d, {}, FLAGS_cache_dir);
+
+        if (videoMode) {
+            runVideoMode(executable_network, imageInputName, imInfoInputName, netInputHeight, netInputWidth);
+        } else {
+            // -------------------------Create Infer Request--------------------------------------------------------
+            slog::info << "Create infer request" << slog::endl;
+            auto infer_request = executable_network.CreateInferRequest();
+
+            // -------------------------------------------------------------------------------------------------
+
+            // -------------------------------Set input data--------------------------------------------------------
+            slog::info << "Setting input data to the blobs" << slog::endl;
+
+            /** Iterate over all the input blobs **/
+            for (const auto & inputInfoItem : inputInfo) {
+                Blob::Ptr input = infer_request.GetBlob(inputInfoItem.first);
+
+                /** Fill first input tensor with images. First b channel, then g and r channels **/
+                if (inputInfoItem.second->getTensorDesc().getDims().size() == 4) {
+                    /** Iterate over all input images **/
+                    for (size_t image_id = 0; image_id < images.size(); ++image_id)
+                        matU8ToBlob<unsigned char>(images[image_id], input, image_id);
+                }
+
+                /** Fill second input tensor with image info **/
+                if (inputInfoItem.second->getTensorDesc().getDims().size() == 2) {
+                    auto data = input->buffer().as<PrecisionTrait<Precision::FP32>::value_type *>();
+                    data[0] = static_cast<float>(netInputHeight);  // height
+                    data[1] = static_cast<float>(netInputWidth);  // width
+                    data[2] = 1;
+                }
             }
-        }
-
-        // -----------------------------------------------------------------------------------------------------
-
-
-        // ----------------------------Do inference-------------------------------------------------------------
-        slog::info << "Start inference" << slog::endl;
-        infer_request.Infer();
-        // -----------------------------------------------------------------------------------------------------
 
-        // ---------------------------Postprocess output blobs--------------------------------------------------
-        slog::info << "Processing output blobs" << slog::endl;
+            // -------------------------------------------------------------------------------------------------
 
-        const auto do_blob = infer_request.GetBlob(FLAGS_detection_output_name.c_str());
-        const auto do_data = do_blob->buffer().as<float*>();
 
-        const auto masks_blob = infer_request.GetBlob(FLAGS_masks_name.c_str());
-        const auto masks_data = masks_blob->buffer().as<float*>();
+            // ----------------------------Do inference-------------------------------------------------------------
+            slog::info << "Start inference" << slog::endl;
+            infer_request.Infer();
+            // -------------------------------------------------------------------------------------------------
 
-        const float PROBABILITY_THRESHOLD = 0.2f;
-        const float MASK_THRESHOLD = 0.5f;  // threshold used to determine whether mask pixel corresponds to object or to background
-        // amount of elements in each detected box description (batch, label, prob, x1, y1, x2, y2)
-        IE_ASSERT(do_blob->getTensorDesc().getDims().size() == 2);
-        size_t BOX_DESCRIPTION_SIZE = do_blob->getTensorDesc().getDims().back();
+            // ---------------------------Postprocess output blobs--------------------------------------------------
+            slog::info << "Processing output blobs" << slog::endl;
 
-        const TensorDesc& masksDesc = masks_blob->getTensorDesc();
-        IE_ASSERT(masksDesc.getDims().size() == 4);
-        size_t BOXES = getTensorBatch(masksDesc);
-        size_t C = getTensorChannels(masksDesc);
-        size_t H = getTensorHeight(masksDesc);
-        size_t W = getTensorWidth(masksDesc);
-
-
-        size_t box_stride = W * H * C;
-
-        std::map<size_t, size_t> class_color;
-
-        std::vector<cv::Mat> output_images;
-        for (const auto &img : images) {
-            output_images.push_back(img.clone());
-        }
-
-        /** Iterating over all boxes **/
-        for (size_t box = 0; box < BOXES; ++box) {
-            float* box_info = do_data + box * BOX_DESCRIPTION_SIZE;
-            auto batch = static_cast<int>(box_info[0]);
-            if (batch < 0)
-                break;
-            if (batch >= static_cast<int>(netBatchSize))
-                throw std::logic_error("Invalid batch ID within detection output box");
-            float prob = box_info[2];
-            float x1 = std::min(std::max(0.0f, box_info[3] * images[batch].cols), static_cast<float>(images[batch].cols));
-            float y1 = std::min(std::max(0.0f, box_info[4] * images[batch].rows), static_cast<float>(images[batch].rows));
-            float x2 = std::min(std::max(0.0f, box_info[5] * images[batch].cols), static_cast<float>(images[batch].cols));
-            float y2 = std::min(std::max(0.0f, box_info[6] * images[batch].rows), static_cast<float>(images[batch].rows));
-            int box_width = std::min(static_cast<int>(std::max(0.0f, x2 - x1)), images[batch].cols);
-            int box_height = std::min(static_cast<int>(std::max(0.0f, y2 - y1)), images[batch].rows);
-            auto class_id = static_cast<size_t>(box_info[1] + 1e-6f);
-            if (prob > PROBABILITY_THRESHOLD) {
-                size_t color_index = class_color.emplace(class_id, class_color.size()).first->second;
-                auto& color = CITYSCAPES_COLORS[color_index % arraySize(CITYSCAPES_COLORS)];
-                float* mask_arr = masks_data + box_stride * box + H * W * (class_id - 1);
-                slog::info << "Detected class " << class_id << " with probability " << prob << " from batch " << batch
-                           << ": [" << x1 << ", " << y1 << "], [" << x2 << ", " << y2 << "]" << slog::endl;
-                cv::Mat mask_mat(H, W, CV_32FC1, mask_arr);
-
-                cv::Rect roi = cv::Rect(static_cast<int>(x1), static_cast<int>(y1), box_width, box_height);
-                cv::Mat roi_input_img = output_images[batch](roi);
-                const float alpha = 0.7f;
-
-                cv::Mat resized_mask_mat(box_height, box_width, CV_32FC1);
-                cv::resize(mask_mat, resized_mask_mat, cv::Size(box_width, box_height));
-
-                cv::Mat uchar_resized_mask(box_height, box_width, CV_8UC3,
-                    cv::Scalar(color.blue(), color.green(), color.red()));
-                roi_input_img.copyTo(uchar_resized_mask, resized_mask_mat <= MASK_THRESHOLD);
-
-                cv::addWeighted(uchar_resized_mask, alpha, roi_input_img, 1.0f - alpha, 0.0f, roi_input_img);
-                cv::rectangle(output_images[batch], roi, cv::Scalar(0, 0, 1), 1);
+            std::vector<cv::Mat> output_images = renderDetections(infer_request, images, netBatchSize, true);
+            for (size_t i = 0; i < output_images.size(); i++) {
+                std::string imgName = "out" + std::to_string(i) + ".png";
+                cv::imwrite(imgName, output_images[i]);
+                slog::info << "Image " << imgName << " created!" << slog::endl;
             }
+            // -------------------------------------------------------------------------------------------------
         }
-        for (size_t i = 0; i < output_images.size(); i++) {
-            std::string imgName = "out" + std::to_string(i) + ".png";
-            cv::imwrite(imgName, output_images[i]);
-            slog::info << "Image " << imgName << " created!" << slog::endl;
-        }
-        // -----------------------------------------------------------------------------------------------------
     }
     catch (const std::exception& error) {
         slog::err << error.what() << slog::endl;
@@ -10,7 +10,8 @@
 #include <iostream>
 
 static const char help_message[] = "Print a usage message.";
-static const char image_message[] = "Required. Path to a .bmp image.";
+static const char image_message[] = "Required. Path to a .bmp image. With -video, a path to a video file or a stream, "
+                                    "\"cam\" works with a camera in both modes.";
 static const char model_message[] = "Required. Path to an .xml file with a trained model.";
 static const char target_device_message[] = "Optional. Specify the target device to infer on (the list of available devices is shown below). "
                                             "Use \"-d HETERO:<comma-separated_devices_list>\" format to specify HETERO plugin. "
@@ -21,6 +22,16 @@ static const char custom_cpu_library_message[] = "Required for CPU custom layers
                                                  "Absolute path to a shared library with the kernels implementations.";
 static const char detection_output_layer_name_message[] = "Optional. The name of detection output layer. Default value is \"reshape_do_2d\"";
 static const char masks_layer_name_message[] = "Optional. The name of masks layer. Default value is \"masks\"";
+static const char cache_dir_message[] = "Optional. Directory to cache compiled networks in. Later runs import the cached networks "
+                                        "instead of compiling them if the model, device and config didn't change. "
+                                        "Devices without network export support compile on each run.";
+static const char video_message[] = "Optional. Segment the frames of the video input by several infer requests in flight "
+                                    "and show them, the latency and the throughput are reported.";
+static const char nireq_message[] = "Optional. Number of infer requests kept in flight in the video mode. "
+                                    "0 uses the optimal number for the device: at least 2, 4 for MYRIAD and HDDL if the device does not report it.";
+static const char output_video_message[] = "Optional. Path to an output video file of the segmented frames in the video mode.";
+static const char no_show_message[] = "Optional. Do not show the segmented frames in the video mode.";
+static const char utilization_monitors_message[] = "Optional. List of monitors to show initially in the video mode.";
 
 DEFINE_string(c, "", custom_cldnn_message);
 DEFINE_string(l, "", custom_cpu_library_message);
@@ -30,6 +41,12 @@ DEFINE_string(m, "", model_message);
 DEFINE_string(d, "CPU", target_device_message);
 DEFINE_string(detection_output_name, "reshape_do_2d", detection_output_layer_name_message);
 DEFINE_string(masks_name, "masks", masks_layer_name_message);
+DEFINE_string(cache_dir, "", cache_dir_message);
+DEFINE_bool(video, false, video_message);
+DEFINE_uint32(nireq, 0, nireq_message);
+DEFINE_string(o, "", output_video_message);
+DEFINE_bool(no_show, false, no_show_message);
+DEFINE_string(u, "", utilization_monitors_message);
 
 /**
 * @brief This function show a help message
@@ -48,4 +65,10 @@ static void showUsage() {
     std::cout << "    -d \"<device>\"                     " << target_device_message << std::endl;
     std::cout << "    -detection_output_name \"<string>\" " << detection_output_layer_name_message << std::endl;
     std::cout << "    -masks_name \"<string>\"            " << masks_layer_name_message << std::endl;
+    std::cout << "    -cache_dir \"<path>\"               " << cache_dir_message << std::endl;
+    std::cout << "    -video                            " << video_message << std::endl;
+    std::cout << "    -nireq \"<integer>\"                " << nireq_message << std::endl;
+    std::cout << "    -o \"<path>\"                       " << output_video_message << std::endl;
+    std::cout << "    -no_show                          " << no_show_message << std::endl;
+    std::cout << "    -u                                " << utilization_monitors_message << std::endl;
 }
@@ -0,0 +1,94 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ring_buffer.hpp"
+
+/**
+* \brief What a pipeline stage does when the next stage is not keeping up
+*/
+enum class OverflowPolicy {
+    Block,       // wait for the next stage, queueing delay grows up to the queue size of every stage
+    DropOldest,  // discard the oldest queued data to make room, keeps latency bounded
+    DropNewest   // discard the data that does not fit, keeps latency bounded
+};
+
+inline OverflowPolicy parseOverflowPolicy(const std::string& name) {
+    if (name == "block") {
+        return OverflowPolicy::Block;
+    } else if (name == "drop_oldest") {
+        return OverflowPolicy::DropOldest;
+    } else if (name == "drop_newest") {
+        return OverflowPolicy::DropNewest;
+    }
+    throw std::invalid_argument("Unknown overflow policy: " + name +
+                                ", expected one of block, drop_oldest, drop_newest");
+}
+
+/**
+* \brief Enqueues the value according to the policy.
+* \param dropped receives the elements discarded to satisfy the policy, the value itself for DropNewest
+* \return false if stop() became true while blocking, the value is not enqueued then
+*/
+template<typename T, typename StopPred>
+bool pushWithPolicy(RingBuffer<T>& queue, T&& value, OverflowPolicy policy,
+                    StopPred&& stop, std::vector<T>& dropped) {
+    switch (policy) {
+    case OverflowPolicy::DropOldest:
+        while (!queue.tryPush(std::move(value))) {
+            T oldest;
+            if (queue.tryPop(oldest)) {
+                dropped.push_back(std::move(oldest));
+            }
+        }
+        return true;
+    case OverflowPolicy::DropNewest:
+        if (!queue.tryPush(std::move(value))) {
+            dropped.push_back(std::move(value));
+        }
+        return true;
+    case OverflowPolicy::Block:
+    default:
+        return queue.push(std::move(value), std::forward<StopPred>(stop));
+    }
+}
+
+/**
+* \brief Per channel counters of dropped frames, safe to update from any thread
+*/
+class DropCounters final {
+    std::size_t channelsCount;
+    std::unique_ptr<std::atomic<std::size_t>[]> counters;
+
+public:
+    explicit DropCounters(std::size_t channelsCount_):
+        channelsCount(channelsCount_), counters(new std::atomic<std::size_t>[channelsCount_]) {
+        for (std::size_t i = 0; i < channelsCount; ++i) {
+            counters[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void add(std::size_t channel, std::size_t count = 1) {
+        if (channel < channelsCount) {
+            counters[channel].fetch_add(count, std::memory_order_relaxed);
+        }
+    }
+
+    std::vector<std::size_t> get() const {
+        std::vector<std::size_t> ret(channelsCount);
+        for (std::size_t i = 0; i < channelsCount; ++i) {
+            ret[i] = counters[i].load(std::memory_order_relaxed);
+        }
+        return ret;
+    }
+};
@@ -0,0 +1,132 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+
+namespace {
+using msec = std::chrono::duration<float, std::milli>;
+
+std::string escapeJson(const std::string& value) {
+    std::string escaped;
+    for (char c : value) {
+        if ('\\' == c || '"' == c) {
+            escaped += '\\';
+            escaped += c;
+        } else if ('\n' == c) {
+            escaped += "\\n";
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+std::string toKey(const char* intervalName) {
+    std::string key = intervalName;
+    std::replace(key.begin(), key.end(), ' ', '_');
+    std::replace(key.begin(), key.end(), '-', '_');
+    return key;
+}
+
+// sorts the samples
+void writeDistribution(std::ostream& os, std::vector<float>& samples) {
+    auto at = [&](float share) {
+        return samples.empty() ? 0.0f :
+            samples[static_cast<std::size_t>(share * static_cast<float>(samples.size() - 1))];
+    };
+    std::sort(samples.begin(), samples.end());
+    const double sum = std::accumulate(samples.begin(), samples.end(), 0.0);
+    os << "{\"count\": " << samples.size()
+       << ", \"mean\": " << (samples.empty() ? 0.0 : sum / samples.size())
+       << ", \"min\": " << at(0.0f) << ", \"p50\": " << at(0.5f) << ", \"p90\": " << at(0.9f)
+       << ", \"p95\": " << at(0.95f) << ", \"p99\": " << at(0.99f) << ", \"max\": " << at(1.0f) << "}";
+}
+}  // namespace
+
+SteadyStateBenchmark::SteadyStateBenchmark(std::size_t channelsCount_, std::chrono::milliseconds warmup_,
+                                           std::chrono::milliseconds duration_):
+    channelsCount(channelsCount_),
+    measureStart(FrameTrace::clock::now() + warmup_),
+    measureEnd(measureStart + duration_),
+    warmup(warmup_),
+    intervals(LatencyTracer::IntervalsCount),
+    channelFrames(channelsCount_, 0) {}
+
+void SteadyStateBenchmark::add(const VideoFrame& frame) {
+    const auto now = FrameTrace::clock::now();
+    const auto& trace = frame.trace;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (now < measureStart) {
+        ++discardedFrames;  // caches, JIT and the queues are still warming up
+        return;
+    }
+    if (now >= measureEnd || frame.sourceIdx >= channelsCount || !trace.has(FrameTrace::Capture)) {
+        return;
+    }
+    // the same intervals as LatencyTracer, a skipped stage is folded into the next reached one
+    std::size_t last = FrameTrace::Capture;
+    for (std::size_t stage = FrameTrace::Capture + 1; stage < FrameTrace::StagesCount; ++stage) {
+        if (!trace.has(static_cast<FrameTrace::Stage>(stage))) {
+            continue;
+        }
+        intervals[stage - 1].push_back(msec(trace.stamps[stage] - trace.stamps[last]).count());
+        last = stage;
+    }
+    intervals[LatencyTracer::EndToEnd].push_back(msec(trace.stamps[last] - trace.stamps[FrameTrace::Capture]).count());
+    ++channelFrames[frame.sourceIdx];
+}
+
+bool SteadyStateBenchmark::finished() const {
+    return FrameTrace::clock::now() >= measureEnd;
+}
+
+void SteadyStateBenchmark::writeJson(std::ostream& os, const Config& config) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto end = std::min(FrameTrace::clock::now(), measureEnd);
+    const float seconds = end > measureStart ? msec(end - measureStart).count() / 1000.0f : 0.0f;
+    const std::size_t frames = std::accumulate(channelFrames.begin(), channelFrames.end(), std::size_t(0));
+
+    os << std::fixed << std::setprecision(3);
+    os << "{\n  \"config\": {";
+    for (std::size_t i = 0; i < config.size(); ++i) {
+        os << (i > 0 ? ", " : "") << "\"" << escapeJson(config[i].first) << "\": \""
+           << escapeJson(config[i].second) << "\"";
+    }
+    os << "},\n";
+    os << "  \"warmup_sec\": " << warmup.count() / 1000.0f << ",\n";
+    os << "  \"duration_sec\": " << seconds << ",\n";
+    os << "  \"discarded_frames\": " << discardedFrames << ",\n";
+    os << "  \"frames\": " << frames << ",\n";
+    os << "  \"throughput_fps\": " << (seconds > 0.0f ? frames / seconds : 0.0f) << ",\n";
+    os << "  \"channel_fps\": [";
+    for (std::size_t channel = 0; channel < channelFrames.size(); ++channel) {
+        os << (channel > 0 ? ", " : "") << (seconds > 0.0f ? channelFrames[channel] / seconds : 0.0f);
+    }
+    os << "],\n";
+    os << "  \"latency_ms\": {";
+    std::vector<float> samples;
+    for (std::size_t interval = 0; interval < LatencyTracer::IntervalsCount; ++interval) {
+        samples = intervals[interval];
+        os << (interval > 0 ? "," : "") << "\n    \"" << toKey(LatencyTracer::getIntervalName(interval)) << "\": ";
+        writeDistribution(os, samples);
+    }
+    os << "\n  }\n}\n";
+}
+
+void SteadyStateBenchmark::writeJson(const std::string& filePath, const Config& config) const {
+    std::ofstream file(filePath);
+    if (!file.is_open()) {
+        throw std::runtime_error("Can't open " + filePath + " for writing");
+    }
+    writeJson(file, config);
+}
@@ -0,0 +1,53 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "input.hpp"
+#include "latency_tracer.hpp"
+
+/**
+* \brief Measures the steady state of the pipeline: the frames leaving it during the warm up after the
+* construction are discarded, the ones of the next duration give the throughput and the latency
+* distributions of the stages of LatencyTracer. Unlike the rolling windows of the stats every frame of
+* the measurement counts, so runs of different models and devices compare by the JSON report
+*/
+class SteadyStateBenchmark final {
+public:
+    // "key": "value" pairs describing the run, e.g. the model and the device, written to the report as is
+    using Config = std::vector<std::pair<std::string, std::string>>;
+
+    SteadyStateBenchmark(std::size_t channelsCount, std::chrono::milliseconds warmup,
+                         std::chrono::milliseconds duration);
+
+    void add(const VideoFrame& frame);
+
+    /**
+    * \brief The measurement is over, the frames added from now on are ignored
+    */
+    bool finished() const;
+
+    void writeJson(std::ostream& os, const Config& config) const;
+
+    void writeJson(const std::string& filePath, const Config& config) const;
+
+private:
+    const std::size_t channelsCount;
+    const FrameTrace::clock::time_point measureStart;
+    const FrameTrace::clock::time_point measureEnd;
+    const std::chrono::milliseconds warmup;
+
+    mutable std::mutex mutex;
+    std::vector<std::vector<float>> intervals;  // msec samples by LatencyTracer interval
+    std::vector<std::size_t> channelFrames;
+    std::size_t discardedFrames = 0;
+};
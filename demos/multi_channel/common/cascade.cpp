@@ -0,0 +1,150 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <samples/instrumentation.hpp>
+
+#include "cascade.hpp"
+
+Cascade::Cascade(std::shared_ptr<IEGraph> graph_, std::size_t queueSize_, RoiFunc roiFunc_, AttachFunc attachFunc_):
+    graph(std::move(graph_)), queueSize(std::max<std::size_t>(queueSize_, 1)),
+    roiFunc(std::move(roiFunc_)), attachFunc(std::move(attachFunc_)) {}
+
+Cascade::~Cascade() {
+    finish();
+    // the getter gives up on the queued crops, their frames are not returned then
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        crops.clear();
+    }
+    cropsChanged.notify_all();
+    if (collector.joinable()) {
+        collector.join();
+    }
+}
+
+void Cascade::start(IEGraph::PostprocessingFunc postprocessingFunc) {
+    assert(!collector.joinable());
+    graph->start([this](VideoFrame& crop) { return getCrop(crop); }, std::move(postprocessingFunc));
+    collector = std::thread(&Cascade::collectCrops, this);
+}
+
+void Cascade::push(std::shared_ptr<VideoFrame> frame) {
+    auto entry = std::make_shared<Entry>();
+    entry->frame = frame;
+    std::vector<cv::Rect> rois;
+    if (!frame->frame.empty()) {
+        rois = roiFunc(*frame);
+    }
+    std::vector<std::shared_ptr<VideoFrame>> frameCrops;
+    for (std::size_t i = 0; i < rois.size(); i++) {
+        const cv::Rect roi = rois[i] & cv::Rect(cv::Point(), frame->frame.size());
+        if (roi.empty()) {
+            continue;
+        }
+        auto crop = cropsPool.acquire();
+        crop->frame = frame->frame(roi);  // a view, the graph resizes it into its input
+        crop->sourceIdx = frame->sourceIdx;  // keeps the crops of a channel in order in the graph
+        crop->cascadeEntry = entry;
+        crop->cascadeRoi = i;
+        frameCrops.push_back(std::move(crop));
+    }
+    entry->pendingCrops = frameCrops.size();
+    pushedFrames++;
+    pushedCrops += frameCrops.size();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    channelEntries[frame->sourceIdx].push_back(entry);
+    if (frameCrops.empty()) {
+        completeEntries(frame->sourceIdx);
+        return;
+    }
+    for (auto& crop : frameCrops) {
+        cropsChanged.wait(lock, [&]() { return crops.size() < queueSize; });
+        crops.push_back(std::move(crop));
+        cropsChanged.notify_all();
+    }
+}
+
+void Cascade::finish() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished = true;
+    }
+    cropsChanged.notify_all();
+}
+
+std::vector<std::shared_ptr<VideoFrame>> Cascade::pop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    completedChanged.wait(lock, [&]() { return !completed.empty() || collected; });
+    std::vector<std::shared_ptr<VideoFrame>> frames;
+    frames.swap(completed);
+    return frames;
+}
+
+Cascade::Stats Cascade::getStats() const {
+    const std::size_t frames = pushedFrames;
+    return {frames > 0 ? static_cast<float>(pushedCrops) / frames : 0.0f, graph->getStats()};
+}
+
+bool Cascade::getCrop(VideoFrame& crop) {
+    // bounded, so the graph infers a partial batch by its timeout rather than waiting for the crops here
+    static const std::chrono::milliseconds waitTime(10);
+    std::unique_lock<std::mutex> lock(mutex);
+    cropsChanged.wait_for(lock, waitTime, [&]() { return !crops.empty() || finished; });
+    if (crops.empty()) {
+        return !finished;  // an empty crop, nothing was ready in time
+    }
+    const VideoFrame& queued = *crops.front();
+    crop.frame = queued.frame;
+    crop.sourceIdx = queued.sourceIdx;
+    crop.cascadeEntry = queued.cascadeEntry;
+    crop.cascadeRoi = queued.cascadeRoi;
+    crops.pop_front();
+    lock.unlock();
+    cropsChanged.notify_all();
+    return true;
+}
+
+void Cascade::collectCrops() {
+    instrumentation::registerCurrentThread("cascade collector");
+    while (true) {
+        // the crops are postprocessed by the graph already, the frame size is not used by them
+        auto inferred = graph->getBatchData(cv::Size());
+        if (inferred.empty()) {
+            break;
+        }
+        for (const auto& crop : inferred) {
+            auto entry = std::static_pointer_cast<Entry>(crop->cascadeEntry);
+            if (!crop->detections.empty()) {
+                attachFunc(*entry->frame, crop->cascadeRoi, crop->detections);
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            entry->pendingCrops--;
+            completeEntries(crop->sourceIdx);
+        }
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    collected = true;
+    completedChanged.notify_all();
+}
+
+void Cascade::completeEntries(std::size_t channel) {
+    auto& entries = channelEntries[channel];
+    bool changed = false;
+    while (!entries.empty() && 0 == entries.front()->pendingCrops) {
+        completed.push_back(std::move(entries.front()->frame));
+        entries.pop_front();
+        changed = true;
+    }
+    if (changed) {
+        completedChanged.notify_all();
+    }
+}
@@ -0,0 +1,97 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "frame_pool.hpp"
+#include "graph.hpp"
+#include "input.hpp"
+
+/**
+* \brief Chains a second IEGraph after the postprocessing of the first one, e.g. classifies the faces a
+* detector found. The regions roiFunc returns for a pushed frame are cut from it without copying and
+* the second graph infers them in batches mixing the crops of all the channels. Once all the crops of
+* a frame are inferred, attachFunc adds their results to the detections of the frame and pop() returns
+* it, the frames of a channel in the order they were pushed. push() blocks while queueSize crops wait
+* for the second graph, so the first graph isn't ahead of it by more than that
+*/
+class Cascade final {
+public:
+    // the regions of the frame in its pixels, the frame is in system memory
+    using RoiFunc = std::function<std::vector<cv::Rect>(const VideoFrame& frame)>;
+    // called on a single thread in the order of the crops of a frame
+    using AttachFunc = std::function<void(VideoFrame& frame, std::size_t roiIdx, const Detections& detections)>;
+
+    // graph must be created with OverflowPolicy::Block, a dropped crop would never complete its frame
+    Cascade(std::shared_ptr<IEGraph> graph, std::size_t queueSize, RoiFunc roiFunc, AttachFunc attachFunc);
+    ~Cascade();
+
+    Cascade(const Cascade&) = delete;
+    Cascade& operator=(const Cascade&) = delete;
+
+    void start(IEGraph::PostprocessingFunc postprocessingFunc);
+
+    void push(std::shared_ptr<VideoFrame> frame);
+
+    /**
+    * \brief No frames are pushed anymore, pop() returns an empty vector once the pushed ones are popped
+    */
+    void finish();
+
+    /**
+    * \brief Waits for the frames whose crops are inferred
+    */
+    std::vector<std::shared_ptr<VideoFrame>> pop();
+
+    struct Stats {
+        float cropsPerFrame;       // average number of the regions of the pushed frames
+        IEGraph::Stats graphStats;
+    };
+
+    Stats getStats() const;
+
+private:
+    // a pushed frame with the number of its crops being inferred
+    struct Entry {
+        std::shared_ptr<VideoFrame> frame;
+        std::size_t pendingCrops = 0;
+    };
+
+    std::shared_ptr<IEGraph> graph;
+    const std::size_t queueSize;
+    RoiFunc roiFunc;
+    AttachFunc attachFunc;
+
+    VideoFramePool cropsPool;
+    std::deque<std::shared_ptr<VideoFrame>> crops;  // wait for the getter of the graph
+    std::map<std::size_t, std::deque<std::shared_ptr<Entry>>> channelEntries;  // by sourceIdx, pushed order
+    std::vector<std::shared_ptr<VideoFrame>> completed;
+    bool finished = false;
+    bool collected = false;  // the graph returned all its crops
+    mutable std::mutex mutex;
+    std::condition_variable cropsChanged;
+    std::condition_variable completedChanged;
+
+    std::atomic<std::size_t> pushedFrames = {0};
+    std::atomic<std::size_t> pushedCrops = {0};
+
+    std::thread collector;
+
+    bool getCrop(VideoFrame& crop);
+    void collectCrops();
+    void completeEntries(std::size_t channel);
+};
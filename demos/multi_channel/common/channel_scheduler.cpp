@@ -0,0 +1,58 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "channel_scheduler.hpp"
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+ChannelScheduler::ChannelScheduler(const std::string& config, std::size_t channelsCount):
+    weights(channelsCount, 1.0f), deficits(channelsCount, 0.0f), finished(channelsCount, false) {
+    std::stringstream stream(config);
+    std::string weight;
+    for (std::size_t i = 0; std::getline(stream, weight, ','); ++i) {
+        float value = 0.0f;
+        std::size_t parsed = 0;
+        try {
+            value = std::stof(weight, &parsed);
+        } catch (const std::exception&) {
+            parsed = 0;
+        }
+        if (weight.empty() || parsed != weight.size() || !(value > 0.0f)) {
+            throw std::invalid_argument("Invalid channel weight: " + weight + ", expected a positive number");
+        }
+        if (i < channelsCount) {
+            weights[i] = value;
+        }
+    }
+    if (!weights.empty()) {
+        deficits[0] = weights[0];
+    }
+}
+
+bool ChannelScheduler::next(std::size_t& channel) {
+    if (finishedCount == weights.size()) {
+        return false;
+    }
+    // the weights are positive, so an unfinished channel gathers a credit within a few visits
+    while (finished[current] || deficits[current] < 1.0f) {
+        current = (current + 1) % weights.size();
+        if (!finished[current]) {
+            deficits[current] += weights[current];
+        }
+    }
+    deficits[current] -= 1.0f;
+    channel = current;
+    return true;
+}
+
+void ChannelScheduler::finish(std::size_t channel) {
+    if (channel < finished.size() && !finished[channel]) {
+        finished[channel] = true;
+        deficits[channel] = 0.0f;
+        ++finishedCount;
+    }
+}
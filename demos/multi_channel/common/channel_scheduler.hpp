@@ -0,0 +1,45 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+* \brief Decides which channel the next frame of a batch is read from by deficit round robin. Every visit
+* a channel earns its weight in credits and a frame costs one, so when the inference can't keep up with all
+* the channels they get the frames in the ratio of their weights: the heavy ones keep their frame rate and the
+* light ones slow down. Equal weights are the plain round robin
+*/
+class ChannelScheduler final {
+public:
+    /**
+    * \param config "" - equal weights, or a comma separated list of positive weights per channel, the
+    * channels without an entry get 1
+    * \throw std::invalid_argument for a malformed list or a weight which isn't positive
+    */
+    ChannelScheduler(const std::string& config, std::size_t channelsCount);
+
+    /**
+    * \brief Returns the channel to read the next frame from, the finished channels are skipped.
+    * \return false once every channel is finished
+    */
+    bool next(std::size_t& channel);
+
+    // the channel ran out of frames
+    void finish(std::size_t channel);
+
+    const std::vector<float>& getWeights() const {
+        return weights;
+    }
+
+private:
+    std::vector<float> weights;
+    std::vector<float> deficits;
+    std::vector<bool> finished;
+    std::size_t finishedCount = 0;
+    std::size_t current = 0;
+};
@@ -0,0 +1,90 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <opencv2/core/ocl.hpp>
+#include <samples/slog.hpp>
+
+#include "compositor.hpp"
+#include "threading.hpp"
+
+#ifdef USE_TBB
+#include <tbb/parallel_for.h>
+#endif
+
+GridCompositor::GridCompositor(cv::Size windowSize, cv::Size cellSize_, std::vector<cv::Point> cellOrigins_,
+                               bool useOpenCL_):
+    cellSize(cellSize_), cellOrigins(std::move(cellOrigins_)), useOpenCL(useOpenCL_),
+    canvas(cv::Mat::zeros(windowSize, CV_8UC3)),
+    cellDetections(cellOrigins.size()) {
+    if (useOpenCL && !cv::ocl::haveOpenCL()) {
+        slog::warn << "OpenCL is not available, frames are scaled on the CPU" << slog::endl;
+        useOpenCL = false;
+    }
+    if (useOpenCL) {
+        cv::ocl::setUseOpenCL(true);
+        canvas.copyTo(canvasUMat);
+    }
+}
+
+void GridCompositor::scaleFrame(const cv::Mat& frame, const cv::Rect& cell) {
+    if (useOpenCL) {
+        cv::UMat cellUMat = canvasUMat(cell);
+        cv::resize(frame.getUMat(cv::ACCESS_READ), cellUMat, cellSize);
+        return;
+    }
+    cv::Mat cellMat = canvas(cell);
+    if (frame.size() == cellSize) {
+        frame.copyTo(cellMat);
+    } else {
+        cv::resize(frame, cellMat, cellSize);
+    }
+}
+
+cv::Mat& GridCompositor::compose(const std::vector<std::shared_ptr<VideoFrame>>& data, const DrawFunc& drawFunc) {
+    updates.assign(cellOrigins.size(), nullptr);
+    for (const auto& elem : data) {
+        if (elem->sourceIdx < cellOrigins.size() && !elem->frame.empty()) {
+            updates[elem->sourceIdx] = elem.get();  // the latest frame of a channel wins
+        }
+    }
+    updates.erase(std::remove(updates.begin(), updates.end(), nullptr), updates.end());
+
+    auto loopBody = [&](size_t i) {
+        scaleFrame(updates[i]->frame, cv::Rect(cellOrigins[updates[i]->sourceIdx], cellSize));
+    };
+    if (useOpenCL) {
+        // the kernels are queued on one device anyway
+        for (size_t i = 0; i < updates.size(); ++i) {
+            loopBody(i);
+        }
+        canvasUMat.copyTo(windowImage);
+    } else {
+#ifdef USE_TBB
+        run_in_arena([&](){
+            tbb::parallel_for<size_t>(0, updates.size(), loopBody);
+        });
+#else
+        get_thread_pool().parallel_for(0, updates.size(), loopBody);
+#endif
+        canvas.copyTo(windowImage);
+    }
+
+    // the cells of channels without a new frame are drawn with the detections of their previous one
+    for (const auto* update : updates) {
+        cellDetections[update->sourceIdx] = update->detections;
+    }
+    for (size_t i = 0; i < cellOrigins.size(); ++i) {
+        if (!cellDetections[i].empty()) {
+            cv::Mat cell = windowImage(cv::Rect(cellOrigins[i], cellSize));
+            drawFunc(cell, cellDetections[i]);
+        }
+    }
+    return windowImage;
+}
@@ -0,0 +1,47 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "input.hpp"
+
+/**
+* \brief Composes channel frames into a persistent grid window image. The cell of a channel
+* is scaled again only when the channel has a new frame, the others keep showing their
+* previous one. New frames are scaled in parallel, or with OpenCL through cv::UMat
+*/
+class GridCompositor final {
+public:
+    using DrawFunc = std::function<void(cv::Mat& cell, const Detections& detections)>;
+
+    // the cell of a channel starts at cellOrigins[VideoFrame::sourceIdx]
+    GridCompositor(cv::Size windowSize, cv::Size cellSize, std::vector<cv::Point> cellOrigins, bool useOpenCL);
+
+    /**
+    * \brief Scales the frames of data into their cells and returns the window image with the latest
+    * detections of every cell drawn by drawFunc. Overlays may be drawn on the image, it is rebuilt by
+    * the next call
+    */
+    cv::Mat& compose(const std::vector<std::shared_ptr<VideoFrame>>& data, const DrawFunc& drawFunc);
+
+private:
+    const cv::Size cellSize;
+    const std::vector<cv::Point> cellOrigins;
+    bool useOpenCL;
+
+    cv::Mat canvas;       // scaled frames only, without detections and overlays
+    cv::UMat canvasUMat;  // the same in OpenCL mode
+    cv::Mat windowImage;
+
+    std::vector<Detections> cellDetections;  // of the frames shown in the cells
+    std::vector<const VideoFrame*> updates;
+
+    void scaleFrame(const cv::Mat& frame, const cv::Rect& cell);
+};
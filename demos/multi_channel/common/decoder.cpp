@@ -6,6 +6,8 @@
 
 #include "perf_timer.hpp"
 
+#include <samples/instrumentation.hpp>
+
 #include <atomic>
 #include <algorithm>
 #include <array>
@@ -14,6 +16,7 @@
 #include <functional>
 #include <limits>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <sstream>
 #include <thread>
@@ -30,6 +33,7 @@
 // #define VA_USE_X11
 
 #include <va/va.h>
+#include <va/va_drmcommon.h>
 #include <va/va_vpp.h>
 
 #ifdef VA_USE_X11
@@ -37,9 +41,9 @@
 #include <va/va_x11.h>
 #else
 #include <fcntl.h>
-#include <unistd.h>
 #include <va/va_drm.h>
 #endif
+#include <unistd.h>
 
 namespace {
 
@@ -338,13 +342,33 @@ struct Decoder::HwContext {
         VASurfaceID decode_surface = InvalidId;
         VASurfaceID convert_surface = InvalidId;
         callback_t callback;
+        surface_callback_t surface_callback;  // set instead of callback when the surface is handed out
         FreeSurfQueue* available_surfaces = nullptr;
         clock::time_point start_time = {};
     };
     tbb::concurrent_bounded_queue<BusySurfDesc> busy_surfaces;
 
+    // decode() only queues the frame, the submit thread sends everything queued meanwhile,
+    // possibly from several cameras, to the hardware in one go
+    struct DecodeJob {
+        const void* data = nullptr;  // nullptr stops the submit thread
+        size_t size = 0;
+        unsigned width = 0;
+        unsigned height = 0;
+        callback_t callback;
+        surface_callback_t surface_callback;
+        clock::time_point start_time = {};
+    };
+    tbb::concurrent_bounded_queue<DecodeJob> pending_jobs;
+
+    // images are derived once per convert surface instead of every frame
+    tbb::concurrent_unordered_map<VASurfaceID, VAImage> derived_images;
+
     PerfTimer perf_timer_decode;
+    std::atomic<size_t> submitted_frames = {0};
+    std::atomic<size_t> submitted_batches = {0};
 
+    std::thread submit_thread;
     std::thread wait_thread;
 
     explicit HwContext(const Decoder::Settings& s):
@@ -378,7 +402,31 @@ struct Decoder::HwContext {
         CHECK_VA(vaInitialize(va_display.get(), &major_version,
                               &minor_version));
 
+        submit_thread = std::thread([this]() {
+            instrumentation::registerCurrentThread("decoder submit");
+            std::vector<DecodeJob> batch;
+            bool stop = false;
+            while (!stop) {
+                DecodeJob job;
+                pending_jobs.pop(job);
+                if (nullptr == job.data) {
+                    break;
+                }
+                batch.clear();
+                batch.push_back(std::move(job));
+                while (batch.size() < settings.num_buffers && pending_jobs.try_pop(job)) {
+                    if (nullptr == job.data) {
+                        stop = true;
+                        break;
+                    }
+                    batch.push_back(std::move(job));
+                }
+                submit(batch);
+            }
+        });
+
         wait_thread = std::thread([this]() {
+            instrumentation::registerCurrentThread("decoder wait");
             while (true) {
                 BusySurfDesc desc = {};
                 busy_surfaces.pop(desc);
@@ -389,41 +437,6 @@ struct Decoder::HwContext {
                 }
                 assert(nullptr != desc.available_surfaces);
                 CHECK_VA(vaSyncSurface(va_display.get(), desc.convert_surface));
-                cv::Mat mat;
-                VAImage image = {};
-                CHECK_VA(vaDeriveImage(va_display.get(), desc.convert_surface, &image));
-
-                const auto format = image.format.fourcc;
-                if (format != VA_FOURCC_NV12 &&
-                    format != VA_FOURCC_ARGB) {
-                    std::stringstream ss;
-                    ss << "unsupported va image format: 0x" << std::hex << format;
-                    throw std::runtime_error(ss.str());
-                }
-
-                map_va_buffer(va_display.get(), image.buf, [&](void* data) {
-                    auto ptr = static_cast<unsigned char*>(data);
-                    switch (format) {
-                    case VA_FOURCC_ARGB: {
-                        assert(1 == image.num_planes);
-                        cv::Mat temp_mat(image.height, image.width, CV_8UC4, ptr + image.offsets[0], image.pitches[0]);
-                        cv::cvtColor(temp_mat, mat, cv::COLOR_BGRA2BGR);
-                        break;
-                    }
-                    case VA_FOURCC_NV12: {
-                        assert(2 == image.num_planes);
-                        cv::Mat temp_mat1(image.height, image.width, CV_8UC1, ptr + image.offsets[0], image.pitches[0]);
-                        cv::Mat temp_mat2(image.height / 2, image.width / 2, CV_8UC2, ptr + image.offsets[1], image.pitches[1]);
-                        cv::cvtColorTwoPlane(temp_mat1, temp_mat2, mat, cv::COLOR_YUV2BGR_NV12);
-                        break;
-                    }
-
-                    default:
-                        assert(false);
-                    }
-                });
-
-                CHECK_VA(vaDestroyImage(va_display.get(), image.image_id));
 
                 if (perf_timer_decode.enabled()) {
                     auto start_time = desc.start_time;
@@ -432,6 +445,23 @@ struct Decoder::HwContext {
                     perf_timer_decode.addValue(duration);
                 }
 
+                if (nullptr != desc.surface_callback) {
+                    FreeSurfDesc free_surf{desc.decode_surface, desc.convert_surface};
+                    auto available_surfaces = desc.available_surfaces;
+                    Decoder::HwSurface surface;
+                    surface.display = va_display.get();
+                    surface.id = desc.convert_surface;
+                    surface.width = settings.output_width;
+                    surface.height = settings.output_height;
+                    surface.holder = std::shared_ptr<void>(nullptr, [available_surfaces, free_surf](void*) {
+                        available_surfaces->push(free_surf);
+                    });
+                    desc.surface_callback(std::move(surface));
+                    continue;
+                }
+
+                cv::Mat mat = download(desc.convert_surface);
+
                 desc.available_surfaces->push(FreeSurfDesc{
                                                   desc.decode_surface,
                                                   desc.convert_surface});
@@ -440,6 +470,37 @@ struct Decoder::HwContext {
         });
     }
 
+    cv::Mat download(VASurfaceID surface) {
+        cv::Mat mat;
+        auto image_it = derived_images.find(surface);
+        assert(derived_images.end() != image_it);
+        const VAImage& image = image_it->second;
+        const auto format = image.format.fourcc;
+
+        map_va_buffer(va_display.get(), image.buf, [&](void* data) {
+            auto ptr = static_cast<unsigned char*>(data);
+            switch (format) {
+            case VA_FOURCC_ARGB: {
+                assert(1 == image.num_planes);
+                cv::Mat temp_mat(image.height, image.width, CV_8UC4, ptr + image.offsets[0], image.pitches[0]);
+                cv::cvtColor(temp_mat, mat, cv::COLOR_BGRA2BGR);
+                break;
+            }
+            case VA_FOURCC_NV12: {
+                assert(2 == image.num_planes);
+                cv::Mat temp_mat1(image.height, image.width, CV_8UC1, ptr + image.offsets[0], image.pitches[0]);
+                cv::Mat temp_mat2(image.height / 2, image.width / 2, CV_8UC2, ptr + image.offsets[1], image.pitches[1]);
+                cv::cvtColorTwoPlane(temp_mat1, temp_mat2, mat, cv::COLOR_YUV2BGR_NV12);
+                break;
+            }
+
+            default:
+                assert(false);
+            }
+        });
+        return mat;
+    }
+
     Context createContext(unsigned width, unsigned height) {
         Context ret;
         VASurfaceAttrib decode_surf_attrib = {};
@@ -452,7 +513,7 @@ struct Decoder::HwContext {
         convert_surf_attrib.type  = VASurfaceAttribPixelFormat;
         convert_surf_attrib.flags = VA_SURFACE_ATTRIB_SETTABLE;
         convert_surf_attrib.value.type = VAGenericValueTypeInteger;
-        convert_surf_attrib.value.value.i = VA_FOURCC_422H;
+        convert_surf_attrib.value.value.i = settings.nv12_output ? VA_FOURCC_NV12 : VA_FOURCC_422H;
 
         std::vector<VASurfaceID> decode_surfaces;
         std::vector<VASurfaceID> convert_surfaces;
@@ -462,10 +523,25 @@ struct Decoder::HwContext {
                                   width, height,
                                   decode_surfaces.data(), settings.num_buffers,
                                   &decode_surf_attrib, 1));
-        CHECK_VA(vaCreateSurfaces(va_display.get(), VA_RT_FORMAT_RGB32,
+        // NV12 is what the GPU plugin takes as a remote blob, so VPP scales and converts in one pass
+        CHECK_VA(vaCreateSurfaces(va_display.get(),
+                                  settings.nv12_output ? VA_RT_FORMAT_YUV420 : VA_RT_FORMAT_RGB32,
                                   settings.output_width, settings.output_height,
                                   convert_surfaces.data(), settings.num_buffers,
-                                  &convert_surf_attrib, 0));
+                                  &convert_surf_attrib, settings.nv12_output ? 1 : 0));
+
+        for (auto surface : convert_surfaces) {
+            VAImage image = {};
+            CHECK_VA(vaDeriveImage(va_display.get(), surface, &image));
+            const auto format = image.format.fourcc;
+            if (format != VA_FOURCC_NV12 &&
+                format != VA_FOURCC_ARGB) {
+                std::stringstream ss;
+                ss << "unsupported va image format: 0x" << std::hex << format;
+                throw std::runtime_error(ss.str());
+            }
+            derived_images.insert({surface, image});
+        }
 
         for (unsigned i = 0; i < settings.num_buffers; ++i) {
             FreeSurfDesc freeSurf = {};
@@ -511,16 +587,28 @@ struct Decoder::HwContext {
     }
 
     ~HwContext() {
-        busy_surfaces.push(BusySurfDesc{InvalidId, InvalidId, nullptr, {}});
+        pending_jobs.push(DecodeJob{});
+        if (submit_thread.joinable()) {
+            submit_thread.join();
+        }
+        busy_surfaces.push(BusySurfDesc{});
         if (wait_thread.joinable()) {
             wait_thread.join();
         }
+        for (auto& item : derived_images) {
+            vaDestroyImage(va_display.get(), item.second.image_id);
+        }
     }
 
     float getLatency() const {
         return perf_timer_decode.getValue();
     }
 
+    float getAvgBatchSize() const {
+        const size_t batches = submitted_batches;
+        return batches > 0 ? static_cast<float>(submitted_frames) / static_cast<float>(batches) : 0.0f;
+    }
+
     void decodeImpl(const void* d, size_t s, VABufferID* buffers,
                     VAContextID context) {
         assert(InvalidId != context);
@@ -822,67 +910,239 @@ struct Decoder::HwContext {
     }
 
     void decode(const void* data, size_t size, unsigned width,
-                unsigned height, callback_t callback) {
-        auto start_time = perf_timer_decode.enabled() ? clock::now() :
-                                                        clock::time_point{};
-        auto size_val = make_size_val(width, height);
-        auto it = contexts.find(size_val);
-        if (contexts.end() == it) {
-            auto ctx = createContext(width, height);
-            auto res = contexts.insert({size_val, std::move(ctx)});
-            it = res.first;
-        }
-        Context& ctx = it->second;
+                unsigned height, callback_t callback, surface_callback_t surface_callback) {
+        DecodeJob job;
+        job.data = data;
+        job.size = size;
+        job.width = width;
+        job.height = height;
+        job.callback = std::move(callback);
+        job.surface_callback = std::move(surface_callback);
+        job.start_time = perf_timer_decode.enabled() ? clock::now() : clock::time_point{};
+        pending_jobs.push(std::move(job));
+    }
 
-        auto available_surfaces = &ctx.available_surfaces;
+    void submit(std::vector<DecodeJob>& batch) {
+        struct Submitted {
+            Context* ctx;
+            FreeSurfDesc surfaces;
+        };
+        std::vector<Submitted> submitted;
+        submitted.reserve(batch.size());
+
+        // all the decodes go first, so the JPEG engine is busy while the conversions are queued
+        for (auto& job : batch) {
+            auto size_val = make_size_val(job.width, job.height);
+            auto it = contexts.find(size_val);
+            if (contexts.end() == it) {
+                auto ctx = createContext(job.width, job.height);
+                auto res = contexts.insert({size_val, std::move(ctx)});
+                it = res.first;
+            }
+            Context& ctx = it->second;
 
-        std::array<VABufferID, MaxBuffers> buffers;
-        std::fill_n(buffers.begin(), buffers.size(), InvalidId);
+            std::array<VABufferID, MaxBuffers> buffers;
+            std::fill_n(buffers.begin(), buffers.size(), InvalidId);
 
-        decodeImpl(data, size, buffers.data(), ctx.decode_context);
+            decodeImpl(job.data, job.size, buffers.data(), ctx.decode_context);
 
-        FreeSurfDesc surfaceDesc = {};
-        available_surfaces->pop(surfaceDesc);
-        VASurfaceID decode_surface = surfaceDesc.decode_surface;
-        assert(InvalidId != decode_surface);
+            FreeSurfDesc surfaceDesc = {};
+            ctx.available_surfaces.pop(surfaceDesc);
+            VASurfaceID decode_surface = surfaceDesc.decode_surface;
+            assert(InvalidId != decode_surface);
 
-        CHECK_VA(vaBeginPicture(va_display.get(), ctx.decode_context, decode_surface));
-        CHECK_VA(vaRenderPicture(va_display.get(), ctx.decode_context, buffers.data(), buffers.size()));
-        CHECK_VA(vaEndPicture(va_display.get(), ctx.decode_context));
-        for (auto buff_id : buffers) {
-            if (InvalidId != buff_id) {
-                CHECK_VA(vaDestroyBuffer(va_display.get(), buff_id));
+            CHECK_VA(vaBeginPicture(va_display.get(), ctx.decode_context, decode_surface));
+            CHECK_VA(vaRenderPicture(va_display.get(), ctx.decode_context, buffers.data(), buffers.size()));
+            CHECK_VA(vaEndPicture(va_display.get(), ctx.decode_context));
+            for (auto buff_id : buffers) {
+                if (InvalidId != buff_id) {
+                    CHECK_VA(vaDestroyBuffer(va_display.get(), buff_id));
+                }
             }
+            submitted.push_back({&ctx, surfaceDesc});
         }
 
-        VASurfaceID convert_surface = surfaceDesc.convert_surface;
-        assert(InvalidId != convert_surface);
+        for (size_t i = 0; i < batch.size(); ++i) {
+            auto& ctx = *submitted[i].ctx;
+            VASurfaceID decode_surface = submitted[i].surfaces.decode_surface;
+            VASurfaceID convert_surface = submitted[i].surfaces.convert_surface;
+            assert(InvalidId != convert_surface);
+
+            VABufferID convert_buffer = InvalidId;
+            convertImpl(convert_buffer, decode_surface, ctx.convert_context);
+
+            assert(InvalidId != convert_buffer);
+            CHECK_VA(vaBeginPicture(va_display.get(), ctx.convert_context, convert_surface));
+            CHECK_VA(vaRenderPicture(va_display.get(), ctx.convert_context, &convert_buffer, 1));
+            CHECK_VA(vaEndPicture(va_display.get(), ctx.convert_context));
+
+            CHECK_VA(vaDestroyBuffer(va_display.get(), convert_buffer));
+
+            BusySurfDesc desc;
+            desc.decode_surface = decode_surface;
+            desc.convert_surface = convert_surface;
+            desc.callback = std::move(batch[i].callback);
+            desc.surface_callback = std::move(batch[i].surface_callback);
+            desc.available_surfaces = &ctx.available_surfaces;
+            desc.start_time = batch[i].start_time;
+            busy_surfaces.push(std::move(desc));
+        }
+        submitted_frames += batch.size();
+        ++submitted_batches;
+    }
+
+    int exportDmaBuf(VASurfaceID surface) {
+        VADRMPRIMESurfaceDescriptor desc = {};
+        CHECK_VA(vaExportSurfaceHandle(va_display.get(), surface,
+                                       VA_SURFACE_ATTRIB_MEM_TYPE_DRM_PRIME_2,
+                                       VA_EXPORT_SURFACE_READ_ONLY | VA_EXPORT_SURFACE_COMPOSED_LAYERS,
+                                       &desc));
+        // composed layers export a single object
+        for (uint32_t i = 1; i < desc.num_objects; ++i) {
+            close(desc.objects[i].fd);
+        }
+        return desc.objects[0].fd;
+    }
+};
 
-        VABufferID convert_buffer = InvalidId;
-        convertImpl(convert_buffer, decode_surface, ctx.convert_context);
+/**
+* \brief Routes the frames of every channel to Hw or Async mode by the recent latencies and the frames in flight
+* of the modes. Every period one channel at most moves from the mode which is slower by a margin or overloaded,
+* so the routes don't oscillate. A channel switches only with no frames in flight, its frames complete in order
+*/
+struct Decoder::AdaptiveRouter {
+    struct Channel {
+        Mode mode = Mode::Hw;
+        Mode target = Mode::Hw;
+        std::size_t in_flight = 0;
+    };
+
+    struct ModeState {
+        double latency = 0.0;  // msec, exponentially weighted, 0 - not measured
+        std::size_t in_flight = 0;
+    };
 
-        assert(InvalidId != convert_buffer);
-        CHECK_VA(vaBeginPicture(va_display.get(), ctx.convert_context, convert_surface));
-        CHECK_VA(vaRenderPicture(va_display.get(), ctx.convert_context, &convert_buffer, 1));
-        CHECK_VA(vaEndPicture(va_display.get(), ctx.convert_context));
+    static constexpr double latency_weight = 1.0 / 16;
+    static constexpr double margin = 1.2;  // the slower mode latency over the faster one to move a channel
+    static constexpr double decay = 0.9;  // of the latency of a mode without channels, so it is retried
+
+    const std::chrono::milliseconds period;
+    const std::size_t hw_buffers;
+    const std::size_t sw_threads;
+
+    mutable std::mutex mutex;
+    std::vector<Channel> channels;
+    ModeState hw;
+    ModeState sw;
+    std::size_t reroutes = 0;
+    std::chrono::steady_clock::time_point last_update;
+
+    explicit AdaptiveRouter(const Decoder::Settings& s):
+        period(std::max(s.adaptive_period_ms, 1u)),
+        hw_buffers(std::max(s.num_buffers, 1u)),
+        sw_threads(std::max(std::thread::hardware_concurrency(), 1u)),
+        last_update(std::chrono::steady_clock::now()) {}
+
+    ModeState& state(Mode mode) {
+        return Mode::Hw == mode ? hw : sw;
+    }
 
-        CHECK_VA(vaDestroyBuffer(va_display.get(), convert_buffer));
+    Mode route(std::size_t channel) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (channel >= channels.size()) {
+            channels.resize(channel + 1);
+        }
+        const auto now = std::chrono::steady_clock::now();
+        if (now - last_update >= period) {
+            last_update = now;
+            rebalance();
+        }
+        Channel& ch = channels[channel];
+        if (0 == ch.in_flight && ch.mode != ch.target) {
+            ch.mode = ch.target;
+            ++reroutes;
+        }
+        ++ch.in_flight;
+        ++state(ch.mode).in_flight;
+        return ch.mode;
+    }
+
+    void complete(std::size_t channel, Mode mode, std::chrono::steady_clock::duration latency) {
+        const double msec = std::chrono::duration<double, std::milli>(latency).count();
+        std::lock_guard<std::mutex> lock(mutex);
+        assert(channel < channels.size());
+        --channels[channel].in_flight;
+        ModeState& modeState = state(mode);
+        --modeState.in_flight;
+        modeState.latency = 0.0 == modeState.latency ? msec
+                                                     : modeState.latency + latency_weight * (msec - modeState.latency);
+    }
+
+    void rebalance() {
+        std::size_t hw_channels = 0;
+        for (const auto& ch : channels) {
+            hw_channels += Mode::Hw == ch.target;
+        }
+        const std::size_t sw_channels = channels.size() - hw_channels;
+        if (0 == hw_channels) {
+            hw.latency *= decay;
+        }
+        if (0 == sw_channels) {
+            sw.latency *= decay;
+        }
+        // the frames queue up beyond the surfaces of the hardware or the threads of the pool
+        const bool hw_overloaded = hw.in_flight > hw_buffers * std::max<std::size_t>(hw_channels, 1);
+        const bool sw_overloaded = sw.in_flight > sw_threads;
+
+        Mode from;
+        if ((hw.latency > sw.latency * margin) || (hw_overloaded && !sw_overloaded)) {
+            from = Mode::Hw;
+        } else if ((sw.latency > hw.latency * margin) || (sw_overloaded && !hw_overloaded)) {
+            from = Mode::Async;
+        } else {
+            return;
+        }
+        // the last channel of the mode, so the channels opened first keep their routes longer
+        for (auto it = channels.rbegin(); it != channels.rend(); ++it) {
+            if (from == it->target) {
+                it->target = Mode::Hw == from ? Mode::Async : Mode::Hw;
+                return;
+            }
+        }
+    }
 
-        busy_surfaces.push(BusySurfDesc{decode_surface,
-                                        convert_surface,
-                                        std::move(callback),
-                                        available_surfaces,
-                                        start_time});
+    void fill(Decoder::Stats& stats) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.channel_modes.reserve(channels.size());
+        for (const auto& ch : channels) {
+            stats.channel_modes.push_back(ch.mode);
+        }
+        stats.hw_latency = static_cast<float>(hw.latency);
+        stats.sw_latency = static_cast<float>(sw.latency);
+        stats.reroutes = reroutes;
     }
 };
 
+Decoder::Mode Decoder::route_adaptive(std::size_t channel) {
+    assert(nullptr != adaptive_router);
+    return adaptive_router->route(channel);
+}
+
+void Decoder::complete_adaptive(std::size_t channel, Mode mode, std::chrono::steady_clock::duration latency) {
+    assert(nullptr != adaptive_router);
+    adaptive_router->complete(channel, mode, latency);
+}
+
 #endif
 
 Decoder::Decoder(const Settings& s):
     settings(s) {
-    if (Mode::Hw == settings.mode) {
+    if (Mode::Hw == settings.mode || Mode::Adaptive == settings.mode) {
 #ifdef USE_LIBVA
         hw_context.reset(new HwContext(settings));
+        if (Mode::Adaptive == settings.mode) {
+            adaptive_router.reset(new AdaptiveRouter(settings));
+        }
 #else
         throw std::logic_error("Hardware decoding is not supported");
 #endif
@@ -895,7 +1155,13 @@ Decoder::~Decoder() {
 Decoder::Stats Decoder::getStats() const {
 #ifdef USE_LIBVA
     if (nullptr != hw_context) {
-        return {hw_context->getLatency()};
+        Stats stats;
+        stats.decoding_latency = hw_context->getLatency();
+        stats.avg_batch_size = hw_context->getAvgBatchSize();
+        if (nullptr != adaptive_router) {
+            adaptive_router->fill(stats);
+        }
+        return stats;
     }
 #endif
     return {};
@@ -905,6 +1171,34 @@ Decoder::Stats Decoder::getStats() const {
 void Decoder::decode_hw(const void* data, size_t size, unsigned width,
                         unsigned height, callback_t callback) {
     assert(nullptr != hw_context);
-    hw_context->decode(data, size, width, height, std::move(callback));
+    hw_context->decode(data, size, width, height, std::move(callback), nullptr);
+}
+
+void Decoder::decode_hw_surface(const void* data, size_t size, unsigned width,
+                                unsigned height, surface_callback_t callback) {
+    assert(nullptr != hw_context);
+    hw_context->decode(data, size, width, height, nullptr, std::move(callback));
 }
 #endif
+
+cv::Mat Decoder::download(const HwSurface& surface) const {
+#ifdef USE_LIBVA
+    assert(nullptr != hw_context);
+    assert(surface.display == hw_context->va_display.get());
+    return hw_context->download(surface.id);
+#else
+    (void)surface;
+    throw std::logic_error("Hardware decoding is not supported");
+#endif
+}
+
+int Decoder::export_dma_buf(const HwSurface& surface) const {
+#ifdef USE_LIBVA
+    assert(nullptr != hw_context);
+    assert(surface.display == hw_context->va_display.get());
+    return hw_context->exportDmaBuf(surface.id);
+#else
+    (void)surface;
+    throw std::logic_error("Hardware decoding is not supported");
+#endif
+}
@@ -5,23 +5,29 @@
 #pragma once
 
 #include <cassert>
+#include <chrono>
+#include <cstdlib>
 #include <functional>
 #include <memory>
+#include <stdexcept>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 #include <opencv2/opencv.hpp>
 
-#ifdef USE_TBB
+#include "jpeg_stripes.hpp"
 #include "threading.hpp"
-#endif
 
 class Decoder final {
 public:
     enum class Mode {
         Immediate,
         Async,
-        Hw
+        Hw,
+        // Async and Hw, the frames of every channel go to the one of them decoding faster under the current
+        // load, see route_adaptive. decode_surface always decodes in Hw mode
+        Adaptive
     };
 
     struct Settings {
@@ -30,6 +36,16 @@ public:
         unsigned output_height = 0;
         unsigned num_buffers = 1;
         bool collect_stats = false;
+        bool nv12_output = false;  // Hw mode converts to NV12 instead of RGB32 surfaces
+        // Immediate and Async modes decode JPEGs scaled down by 1/2, 1/4 or 1/8 in the DCT domain when
+        // the scaled picture still covers this size, 0 - full resolution
+        unsigned target_width = 0;
+        unsigned target_height = 0;
+        // Immediate and Async modes split the JPEGs with restart markers into up to this many bands decoded
+        // in parallel, see decodeJpeg. 0 or 1 - whole
+        unsigned stripes = 1;
+        // Adaptive mode reconsiders the routes of the channels this often, moving at most one channel
+        unsigned adaptive_period_ms = 1000;
     };
 
     explicit Decoder(const Settings& s);
@@ -39,38 +55,119 @@ public:
 
     struct Stats {
         float decoding_latency = 0.0f;
+        float avg_batch_size = 0.0f;  // frames submitted to the hardware at once
+        // Adaptive mode only: the mode every channel is routed to by the channel indices, the channels which
+        // didn't decode yet are Hw
+        std::vector<Mode> channel_modes;
+        float hw_latency = 0.0f;  // msec from decode() to the callback over the recent frames
+        float sw_latency = 0.0f;
+        std::size_t reroutes = 0;  // channels moved to the other mode
+    };
+
+    /**
+    * \brief Decoded picture left in video memory, Hw mode only. The surface goes back
+    * to the decoder pool when the last copy of the handle is released
+    */
+    struct HwSurface {
+        void* display = nullptr;  // VADisplay
+        unsigned id = 0;          // VASurfaceID
+        unsigned width = 0;
+        unsigned height = 0;
+        std::shared_ptr<void> holder;
     };
 
     Stats getStats() const;
 
+    /**
+    * \brief Exports the surface as a DMA-BUF (DRM PRIME) file descriptor, the caller owns it
+    */
+    int export_dma_buf(const HwSurface& surface) const;
+
+    /**
+    * \brief Copies the surface to system memory as a BGR image
+    */
+    cv::Mat download(const HwSurface& surface) const;
+
     template<typename F>
     void decode(const void* data, size_t size, unsigned width, unsigned height,
                 F&& callback) {
+        decode(0, data, size, width, height, std::forward<F>(callback));
+    }
+
+    /**
+    * \brief Decodes a frame of the channel, Adaptive mode routes the channels separately
+    */
+    template<typename F>
+    void decode(std::size_t channel, const void* data, size_t size, unsigned width, unsigned height,
+                F&& callback) {
         assert(nullptr != data);
         assert(size > 0);
         assert(width > 0);
         assert(height > 0);
 
-        auto mode = settings.mode;
+        if (Mode::Adaptive == settings.mode) {
+#ifdef USE_LIBVA
+            const Mode mode = route_adaptive(channel);
+            auto decoded = [this, channel, mode, start = std::chrono::steady_clock::now(), c = std::move(callback)]
+                           (cv::Mat&& img) mutable {
+                complete_adaptive(channel, mode, std::chrono::steady_clock::now() - start);
+                c(std::move(img));
+            };
+            decode_in(mode, data, size, width, height, make_copyable(std::move(decoded)));
+#else
+            (void)channel;
+            assert(false);
+#endif
+        } else {
+            decode_in(settings.mode, data, size, width, height, std::forward<F>(callback));
+        }
+    }
+
+    /**
+    * \brief Decodes into a pooled VA surface without downloading it, requires Hw or Adaptive mode
+    */
+    template<typename F>
+    void decode_surface(const void* data, size_t size, unsigned width, unsigned height,
+                        F&& callback) {
+        assert(nullptr != data);
+        assert(size > 0);
+        if (Mode::Hw != settings.mode && Mode::Adaptive != settings.mode) {
+            throw std::logic_error("Decoding to surfaces requires hardware decoding");
+        }
+#ifdef USE_LIBVA
+        auto decode = [c = std::move(callback)](HwSurface&& surface) mutable {
+            c(std::move(surface));
+        };
+        decode_hw_surface(data, size, width, height, make_copyable(std::move(decode)));
+#else
+        (void)width;
+        (void)height;
+        (void)callback;
+#endif
+    }
+
+private:
+    const Settings settings;
+
+    template<typename F>
+    void decode_in(Mode mode, const void* data, size_t size, unsigned width, unsigned height,
+                   F&& callback) {
         if (Mode::Immediate == mode) {
-            auto img = cv::imdecode(
-            {static_cast<const char*>(data),
-             static_cast<int>(size)},
-                           cv::IMREAD_COLOR);
+            auto img = decodeJpeg(data, size, imdecode_flags(width, height), settings.stripes);
             callback(std::move(img));
         } else if (Mode::Async == mode) {
+            const int flags = imdecode_flags(width, height);
 #ifdef USE_TBB
-            auto decode = [data, size, c = std::move(callback), this]() mutable {
-                auto img = cv::imdecode(
-                {static_cast<const char*>(data),
-                 static_cast<int>(size)},
-                            cv::IMREAD_COLOR);
+            auto decode = [data, size, flags, c = std::move(callback), this]() mutable {
+                auto img = decodeJpeg(data, size, flags, settings.stripes);
                 c(std::move(img));
             };
             auto& arena = get_tbb_arena();
             arena.enqueue(std::move(decode));
 #else
-            throw std::logic_error("Async decoding is not supported");
+            get_thread_pool().enqueue(make_copyable(
+                AsyncDecode<typename std::decay<F>::type>{data, size, flags, settings.stripes,
+                                                          std::forward<F>(callback)}));
 #endif
         } else if (Mode::Hw == mode) {
 #ifdef USE_LIBVA
@@ -88,10 +185,39 @@ public:
         }
     }
 
-private:
-    const Settings settings;
-#ifdef USE_LIBVA
-    struct HwContext;
+    // the largest reduction of a width x height picture still covering the target size
+    int imdecode_flags(unsigned width, unsigned height) const {
+        static const struct {
+            unsigned scale;
+            int flags;
+        } reductions[] = {{8, cv::IMREAD_REDUCED_COLOR_8}, {4, cv::IMREAD_REDUCED_COLOR_4},
+                          {2, cv::IMREAD_REDUCED_COLOR_2}};
+        if (0 == settings.target_width || 0 == settings.target_height) {
+            return cv::IMREAD_COLOR;
+        }
+        for (const auto& reduction : reductions) {
+            if (width / reduction.scale >= settings.target_width &&
+                height / reduction.scale >= settings.target_height) {
+                return reduction.flags;
+            }
+        }
+        return cv::IMREAD_COLOR;
+    }
+
+    template<typename F>
+    struct AsyncDecode {
+        const void* data;
+        size_t size;
+        int flags;
+        unsigned stripes;
+        F callback;
+
+        void operator()() {
+            auto img = decodeJpeg(data, size, flags, stripes);
+            callback(std::move(img));
+        }
+    };
+
     template<typename T>
     struct MoveHack {
         union {
@@ -119,11 +245,25 @@ private:
         return MoveHack<typename std::remove_reference<T>::type>{std::move(val)};
     }
 
+#ifdef USE_LIBVA
+    struct HwContext;
+
     using callback_t = std::function<void(cv::Mat&&)>;
+    using surface_callback_t = std::function<void(HwSurface&&)>;
 
     std::unique_ptr<HwContext> hw_context;
 
+    struct AdaptiveRouter;
+
+    std::unique_ptr<AdaptiveRouter> adaptive_router;
+
+    // the mode of the next frame of the channel, counts the frame in flight
+    Mode route_adaptive(std::size_t channel);
+    void complete_adaptive(std::size_t channel, Mode mode, std::chrono::steady_clock::duration latency);
+
     void decode_hw(const void* data, size_t size, unsigned width,
                    unsigned height, callback_t callback);
+    void decode_hw_surface(const void* data, size_t size, unsigned width,
+                           unsigned height, surface_callback_t callback);
 #endif
 };
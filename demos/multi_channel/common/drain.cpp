@@ -0,0 +1,42 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "drain.hpp"
+
+#include <samples/slog.hpp>
+
+bool readScheduledFrame(ChannelScheduler& scheduler, VideoSources& sources, std::size_t duplicateFactor,
+                        bool drain, VideoFrame& img) {
+    std::size_t channel = 0;
+    while (scheduler.next(channel)) {
+        img.sourceIdx = channel;
+        auto camIdx = channel / duplicateFactor;
+        if (!drain) {
+            return sources.getFrame(camIdx, img);
+        }
+        if (sources.getFrame(camIdx, img)) {
+            return true;
+        }
+        scheduler.finish(channel);
+        img.trace = FrameTrace();  // may be stamped by the failed read
+    }
+    return false;
+}
+
+void printDrainedFrames(std::size_t frames, float elapsedTime) {
+    const float seconds = elapsedTime / 1000.0f;
+    slog::info << "Drained " << frames << " frames in " << seconds << " s, "
+               << (seconds > 0.0f ? static_cast<float>(frames) / seconds : 0.0f) << " fps" << slog::endl;
+}
+
+void printDrainSummary(const IEGraph::Stats& stats) {
+    printDrainedFrames(stats.inferredFrames, stats.elapsedTime);
+    slog::info << "Utilization: input wait " << 100.0f * stats.inputWaitShare
+               << "%, preprocess " << 100.0f * stats.preprocessShare
+               << "%, postprocess " << 100.0f * stats.postprocessShare << "%" << slog::endl;
+    for (const auto& device : stats.devices) {
+        slog::info << "\t" << device.name << " requests in flight: "
+                   << 100.0f * device.occupancy << "%" << slog::endl;
+    }
+}
@@ -0,0 +1,25 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include <cstddef>
+
+#include "channel_scheduler.hpp"
+#include "graph.hpp"
+#include "input.hpp"
+
+/**
+* \brief Reads the frame of the channel the scheduler picks, a source feeds duplicateFactor channels. In drain
+* mode a channel which ran out of frames is finished and the next one is read
+* \return false once every channel is finished, or without drain as soon as a read fails
+*/
+bool readScheduledFrame(ChannelScheduler& scheduler, VideoSources& sources, std::size_t duplicateFactor,
+                        bool drain, VideoFrame& img);
+
+// prints the frames and the throughput of a drain run, elapsedTime is in msec
+void printDrainedFrames(std::size_t frames, float elapsedTime);
+
+// prints the throughput of a drain run and where its time went
+void printDrainSummary(const IEGraph::Stats& stats);
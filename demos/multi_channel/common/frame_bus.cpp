@@ -0,0 +1,462 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <samples/slog.hpp>
+
+#include "frame_bus.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+              "the atomics of the frame bus are shared by processes, they must be lock free");
+
+namespace {
+const char busMagic[8] = "FRAMEBS";
+const std::uint32_t busVersion = 2;
+const std::size_t busAlignment = 64;  // a cache line, so the slots of the channels do not share lines
+const std::size_t maxSlots = 255;  // the slot is the low byte of ChannelHeader::latest
+const std::size_t maxSubscribers = 64;  // a subscriber is a bit of SlotHeader::readers
+const char busPrefix[] = "bus:";
+
+std::size_t align(std::size_t size) {
+    return (size + busAlignment - 1) / busAlignment * busAlignment;
+}
+
+struct BusHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t channels;
+    std::uint32_t slots;
+    std::uint32_t subscribers;
+    std::uint32_t depth;  // the frames of a channel a subscriber holds in place
+    std::int32_t width;
+    std::int32_t height;
+    std::uint64_t slotSize;  // the header of a slot and its pixels
+    std::atomic<std::uint32_t> ready;  // set by the publisher once the layout is written
+};
+
+struct SubscriberHeader {
+    std::atomic<std::int32_t> pid;  // of the process of the subscriber, 0 - a free entry
+};
+
+struct ChannelHeader {
+    std::atomic<std::uint64_t> latest;  // the sequence of the latest frame << 8 | its slot, 0 - none yet
+};
+
+struct SlotHeader {
+    // the sequence of the frame in the slot, 0 while it is written. A subscriber holds the slot by its bit
+    // of readers and then checks the sequence, the publisher clears the sequence and then checks readers,
+    // so either the subscriber sees the cleared sequence or the publisher sees the reader
+    std::atomic<std::uint64_t> sequence;
+    std::atomic<std::uint64_t> readers;  // the bits of the subscribers holding the slot
+    std::int32_t width;
+    std::int32_t height;
+};
+}  // namespace
+
+class FrameBusMapping {
+public:
+    FrameBusMapping(const std::string& name, std::size_t createSize):
+            path("/" + name), owner(createSize > 0) {
+#ifdef _WIN32
+        throw std::runtime_error("The frame bus is not supported on Windows");
+#else
+        int fd = -1;
+        if (owner) {
+            shm_unlink(path.c_str());  // a bus left by a crashed publisher
+            fd = shm_open(path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        } else {
+            fd = shm_open(path.c_str(), O_RDWR, 0);
+        }
+        if (fd < 0) {
+            throw std::runtime_error("Can't open the frame bus " + name + ": " + strerror(errno) +
+                                     (owner ? "" : ", is the publisher running?"));
+        }
+        struct stat sb;
+        if ((owner && ftruncate(fd, static_cast<off_t>(createSize)) != 0) || fstat(fd, &sb) != 0) {
+            const std::string error = strerror(errno);
+            close(fd);
+            throw std::runtime_error("Can't size the frame bus " + name + ": " + error);
+        }
+        size = static_cast<std::size_t>(sb.st_size);
+        data = size > 0 ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+        close(fd);
+        if (MAP_FAILED == data) {
+            if (owner) {
+                shm_unlink(path.c_str());
+            }
+            throw std::runtime_error("Can't map the frame bus " + name);
+        }
+#endif
+    }
+
+    ~FrameBusMapping() {
+#ifndef _WIN32
+        munmap(data, size);
+        if (owner) {
+            shm_unlink(path.c_str());  // the subscribers keep their mappings until they release them
+        }
+#endif
+    }
+
+    FrameBusMapping(const FrameBusMapping&) = delete;
+    FrameBusMapping& operator=(const FrameBusMapping&) = delete;
+
+    BusHeader& header() const {
+        return *static_cast<BusHeader*>(data);
+    }
+
+    SubscriberHeader& subscriber(std::size_t idx) const {
+        return *reinterpret_cast<SubscriberHeader*>(static_cast<char*>(data) + align(sizeof(BusHeader)) +
+                                                    idx * align(sizeof(SubscriberHeader)));
+    }
+
+    ChannelHeader& channel(std::size_t idx) const {
+        return *reinterpret_cast<ChannelHeader*>(static_cast<char*>(data) + channelsOffset(header().subscribers) +
+                                                 idx * align(sizeof(ChannelHeader)));
+    }
+
+    SlotHeader& slot(std::size_t channelIdx, std::size_t idx) const {
+        const BusHeader& bus = header();
+        return *reinterpret_cast<SlotHeader*>(static_cast<char*>(data) + slotsOffset(bus.subscribers, bus.channels) +
+                                              (channelIdx * bus.slots + idx) * bus.slotSize);
+    }
+
+    static void* pixels(SlotHeader& slot) {
+        return reinterpret_cast<char*>(&slot) + align(sizeof(SlotHeader));
+    }
+
+    static std::size_t channelsOffset(std::size_t subscribers) {
+        return align(sizeof(BusHeader)) + subscribers * align(sizeof(SubscriberHeader));
+    }
+
+    static std::size_t slotsOffset(std::size_t subscribers, std::size_t channels) {
+        return channelsOffset(subscribers) + channels * align(sizeof(ChannelHeader));
+    }
+
+    /**
+    * \brief Takes back the slots the subscribers of readers hold if their processes exited without
+    * releasing them, returns the bits of the subscribers which are alive
+    */
+    std::uint64_t reclaimDead(std::uint64_t readers) const {
+        const BusHeader& bus = header();
+        for (std::size_t idx = 0; idx < bus.subscribers && 0 != readers; idx++) {
+            const std::uint64_t bit = std::uint64_t(1) << idx;
+            if (0 == (readers & bit)) {
+                continue;
+            }
+            std::int32_t pid = subscriber(idx).pid.load();
+            if (0 == pid) {
+                // a subscriber frees its entry after its slots, so it released the slots meanwhile
+                readers &= ~bit;
+                continue;
+            }
+            if (isAlive(pid)) {
+                continue;
+            }
+            for (std::size_t channelIdx = 0; channelIdx < bus.channels; channelIdx++) {
+                for (std::size_t slotIdx = 0; slotIdx < bus.slots; slotIdx++) {
+                    slot(channelIdx, slotIdx).readers.fetch_and(~bit);
+                }
+            }
+            // the entry is freed after its bits, so a new subscriber of the entry never loses its slots
+            if (subscriber(idx).pid.compare_exchange_strong(pid, 0)) {
+                slog::warn << "The frame bus took back the slots of the subscriber " << pid << " which exited"
+                           << slog::endl;
+            }
+            readers &= ~bit;
+        }
+        return readers;
+    }
+
+    static std::int32_t currentPid() {
+#ifdef _WIN32
+        return 1;
+#else
+        return static_cast<std::int32_t>(getpid());
+#endif
+    }
+
+    static bool isAlive(std::int32_t pid) {
+#ifdef _WIN32
+        return true;
+#else
+        return 0 == kill(static_cast<pid_t>(pid), 0) || ESRCH != errno;
+#endif
+    }
+
+    static std::size_t slotSize(cv::Size frameSize) {
+        return align(sizeof(SlotHeader)) + align(static_cast<std::size_t>(frameSize.area()) * 3);
+    }
+
+    std::size_t getSize() const {
+        return size;
+    }
+
+private:
+    const std::string path;
+    const bool owner;
+    void* data = nullptr;
+    std::size_t size = 0;
+};
+
+FrameBusPublisher::FrameBusPublisher(const std::string& name, std::size_t channels, std::size_t subscribers,
+                                     std::size_t depth, cv::Size frameSize):
+        sequences(channels, 0), nextSlots(channels, 0), droppedFrames(channels, 0) {
+    // the latest frame is kept for the subscribers and one more slot is written
+    const std::size_t slots = subscribers * depth + 2;
+    if (channels == 0 || subscribers == 0 || subscribers > maxSubscribers || depth == 0 || slots > maxSlots ||
+        frameSize.area() <= 0) {
+        throw std::invalid_argument("Invalid frame bus layout: " + std::to_string(channels) + " channels for " +
+                                    std::to_string(subscribers) + " subscribers of " + std::to_string(depth) +
+                                    " frames, up to " + std::to_string(maxSubscribers) + " subscribers and " +
+                                    std::to_string(maxSlots - 2) + " frames of all of them");
+    }
+    const std::size_t slotSize = FrameBusMapping::slotSize(frameSize);
+    mapping = std::make_shared<FrameBusMapping>(name, FrameBusMapping::slotsOffset(subscribers, channels) +
+                                                      channels * slots * slotSize);
+
+    BusHeader* header = new (&mapping->header()) BusHeader;
+    std::copy(busMagic, busMagic + sizeof(busMagic), header->magic);
+    header->version = busVersion;
+    header->channels = static_cast<std::uint32_t>(channels);
+    header->slots = static_cast<std::uint32_t>(slots);
+    header->subscribers = static_cast<std::uint32_t>(subscribers);
+    header->depth = static_cast<std::uint32_t>(depth);
+    header->width = frameSize.width;
+    header->height = frameSize.height;
+    header->slotSize = slotSize;
+    for (std::size_t idx = 0; idx < subscribers; idx++) {
+        new (&mapping->subscriber(idx).pid) std::atomic<std::int32_t>(0);
+    }
+    for (std::size_t channel = 0; channel < channels; channel++) {
+        new (&mapping->channel(channel).latest) std::atomic<std::uint64_t>(0);
+        for (std::size_t idx = 0; idx < slots; idx++) {
+            SlotHeader& slot = mapping->slot(channel, idx);
+            new (&slot.sequence) std::atomic<std::uint64_t>(0);
+            new (&slot.readers) std::atomic<std::uint64_t>(0);
+        }
+    }
+    new (&header->ready) std::atomic<std::uint32_t>(0);
+    header->ready.store(1, std::memory_order_release);
+}
+
+FrameBusPublisher::~FrameBusPublisher() {}
+
+void FrameBusPublisher::publish(std::size_t channel, const cv::Mat& frame) {
+    const BusHeader& bus = mapping->header();
+    if (channel >= bus.channels || frame.empty() || CV_8UC3 != frame.type()) {
+        return;
+    }
+    ChannelHeader& channelHeader = mapping->channel(channel);
+    const std::uint64_t latest = channelHeader.latest.load(std::memory_order_relaxed);
+    SlotHeader* slot = nullptr;
+    std::size_t slotIdx = 0;
+    for (std::size_t i = 0; i < bus.slots && nullptr == slot; i++) {
+        slotIdx = (nextSlots[channel] + i) % bus.slots;
+        if (0 != latest && (latest & 0xff) == slotIdx) {
+            continue;  // the subscribers take the latest frame
+        }
+        SlotHeader& candidate = mapping->slot(channel, slotIdx);
+        candidate.sequence.store(0);
+        const std::uint64_t readers = candidate.readers.load();
+        if (0 == readers || 0 == mapping->reclaimDead(readers)) {
+            slot = &candidate;
+        }
+    }
+    if (nullptr == slot) {
+        if (!droppedFrames[channel]) {
+            slog::warn << "The subscribers of the frame bus hold every slot of channel " << channel
+                       << ", its frames are dropped" << slog::endl;
+            droppedFrames[channel] = true;
+        }
+        return;
+    }
+    nextSlots[channel] = (slotIdx + 1) % bus.slots;
+
+    const double scale = std::min({1.0, static_cast<double>(bus.width) / frame.cols,
+                                   static_cast<double>(bus.height) / frame.rows});
+    const cv::Size size = scale < 1.0 ?
+        cv::Size(std::max(1, static_cast<int>(frame.cols * scale)), std::max(1, static_cast<int>(frame.rows * scale))) :
+        frame.size();
+    cv::Mat pixels(size, CV_8UC3, FrameBusMapping::pixels(*slot));
+    if (size == frame.size()) {
+        frame.copyTo(pixels);
+    } else {
+        cv::resize(frame, pixels, size, 0, 0, cv::INTER_AREA);
+    }
+    slot->width = size.width;
+    slot->height = size.height;
+
+    const std::uint64_t sequence = ++sequences[channel];
+    slot->sequence.store(sequence, std::memory_order_release);
+    channelHeader.latest.store(sequence << 8 | slotIdx, std::memory_order_release);
+}
+
+class FrameBusLeases {
+public:
+    FrameBusLeases(std::shared_ptr<FrameBusMapping> mapping_, const std::string& name):
+            mapping(std::move(mapping_)) {
+        const BusHeader& bus = mapping->header();
+        if (!takeEntry()) {
+            // the entries of the subscribers which exited without releasing them
+            mapping->reclaimDead(~std::uint64_t(0));
+            if (!takeEntry()) {
+                throw std::runtime_error("The frame bus " + name + " has " + std::to_string(bus.subscribers) +
+                                         " subscribers already, the publisher takes more by -bus_subscribers");
+            }
+        }
+        holds.assign(bus.channels * bus.slots, 0);
+        leased.assign(bus.channels, 0);
+    }
+
+    ~FrameBusLeases() {
+        // the frames of the subscriber are released, so it holds no slot
+        mapping->subscriber(id).pid.store(0);
+    }
+
+    FrameBusLeases(const FrameBusLeases&) = delete;
+    FrameBusLeases& operator=(const FrameBusLeases&) = delete;
+
+    bool takeEntry() {
+        const std::int32_t pid = FrameBusMapping::currentPid();
+        for (id = 0; id < mapping->header().subscribers; id++) {
+            std::int32_t free = 0;
+            if (mapping->subscriber(id).pid.compare_exchange_strong(free, pid)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::uint64_t bit() const {
+        return std::uint64_t(1) << id;
+    }
+
+    /**
+    * \brief Holds the slot for the subscriber, the readers of several frames of the process are its
+    * single bit
+    */
+    void hold(std::size_t channel, std::size_t slotIdx) {
+        if (0 == holds[channel * mapping->header().slots + slotIdx]++) {
+            mapping->slot(channel, slotIdx).readers.fetch_or(bit());
+        }
+    }
+
+    void release(std::size_t channel, std::size_t slotIdx) {
+        if (0 == --holds[channel * mapping->header().slots + slotIdx]) {
+            mapping->slot(channel, slotIdx).readers.fetch_and(~bit());
+        }
+    }
+
+    const std::shared_ptr<FrameBusMapping> mapping;
+    std::size_t id = 0;
+    std::mutex mutex;
+    std::vector<std::size_t> holds;  // by the slots of the channels
+    std::vector<std::size_t> leased;  // the frames held in place by the channels
+};
+
+FrameBusSubscriber::FrameBusSubscriber(const std::string& name):
+        mapping(std::make_shared<FrameBusMapping>(name, 0)) {
+    if (mapping->getSize() < sizeof(BusHeader)) {
+        throw std::runtime_error("The frame bus " + name + " is not initialized");
+    }
+    const BusHeader& bus = mapping->header();
+    if (!std::equal(busMagic, busMagic + sizeof(busMagic), bus.magic) || busVersion != bus.version ||
+        1 != bus.ready.load(std::memory_order_acquire) ||
+        mapping->getSize() < FrameBusMapping::slotsOffset(bus.subscribers, bus.channels) +
+                             bus.channels * bus.slots * bus.slotSize) {
+        throw std::runtime_error("The frame bus " + name + " is not initialized or has another version");
+    }
+    leases = std::make_shared<FrameBusLeases>(mapping, name);
+}
+
+std::size_t FrameBusSubscriber::getChannelsCount() const {
+    return mapping->header().channels;
+}
+
+bool FrameBusSubscriber::read(std::size_t channel, std::uint64_t& lastSequence, cv::Mat& frame,
+                              std::shared_ptr<void>& lease, std::chrono::milliseconds timeout) {
+    if (channel >= getChannelsCount()) {
+        throw std::out_of_range("The frame bus has no channel " + std::to_string(channel));
+    }
+    // the publisher is another process, so the new frames are polled for
+    static const std::chrono::milliseconds pollingInterval(1);
+    using clock = std::chrono::steady_clock;
+    const auto deadline = clock::now() + timeout;
+    ChannelHeader& channelHeader = mapping->channel(channel);
+    while (true) {
+        const std::uint64_t latest = channelHeader.latest.load(std::memory_order_acquire);
+        const std::uint64_t sequence = latest >> 8;
+        if (sequence > lastSequence) {
+            const std::size_t slotIdx = latest & 0xff;
+            SlotHeader& slot = mapping->slot(channel, slotIdx);
+            std::unique_lock<std::mutex> lock(leases->mutex);
+            leases->hold(channel, slotIdx);
+            if (slot.sequence.load() != sequence) {
+                leases->release(channel, slotIdx);  // a newer frame took the slot meanwhile
+                continue;
+            }
+            const bool inPlace = leases->leased[channel] < mapping->header().depth;
+            if (inPlace) {
+                leases->leased[channel]++;
+            }
+            lock.unlock();
+            frame = cv::Mat(slot.height, slot.width, CV_8UC3, FrameBusMapping::pixels(slot));
+            lastSequence = sequence;
+            if (inPlace) {
+                std::shared_ptr<FrameBusLeases> slotLeases = leases;
+                lease = std::shared_ptr<void>(&slot, [slotLeases, channel, slotIdx](void*) {
+                    std::lock_guard<std::mutex> leasesLock(slotLeases->mutex);
+                    slotLeases->leased[channel]--;
+                    slotLeases->release(channel, slotIdx);
+                });
+            } else {
+                // the slots held by the subscriber are reserved for it, so the frames beyond them are copied
+                frame = frame.clone();
+                lease.reset();
+                lock.lock();
+                leases->release(channel, slotIdx);
+            }
+            return true;
+        }
+        if (clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(pollingInterval);
+    }
+}
+
+bool parseFrameBusInput(const std::string& input, std::string& name, std::size_t& channel) {
+    if (0 != input.compare(0, sizeof(busPrefix) - 1, busPrefix)) {
+        return false;
+    }
+    const auto separator = input.rfind('/');
+    if (std::string::npos == separator || separator < sizeof(busPrefix) ||
+        separator + 1 == input.size() ||
+        input.find_first_not_of("0123456789", separator + 1) != std::string::npos) {
+        throw std::invalid_argument("Invalid frame bus input: " + input + ", expected bus:<name>/<channel>");
+    }
+    name = input.substr(sizeof(busPrefix) - 1, separator - sizeof(busPrefix) + 1);
+    channel = std::stoul(input.substr(separator + 1));
+    return true;
+}
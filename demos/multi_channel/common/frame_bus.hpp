@@ -0,0 +1,89 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+// shared memory of a frame bus: the header, the table of the subscribers, then a ring of slots per channel
+// holding BGR frames up to the frame size of the bus, /dev/shm/<name> on Linux
+class FrameBusMapping;
+// the entry of a subscriber in the table of the bus and the slots its frames hold
+class FrameBusLeases;
+
+/**
+* \brief Publishes the decoded frames of the channels to a shared memory bus, so other processes
+* analyse the inputs without opening and decoding them again. A frame is written to a slot of its
+* channel no subscriber holds, so the subscribers read the frames in place. Every subscriber holds
+* up to depth frames of a channel in place, so a ring of subscribers * depth + 2 slots always has a
+* free slot for the next frame while the latest one is kept for the subscribers. The slots held by
+* the subscribers which died are taken back by the pids of the subscribers, so the subscribers must
+* share the pid namespace of the publisher
+*/
+class FrameBusPublisher final {
+public:
+    /**
+    * \param subscribers the subscribers the bus takes at once, up to 64
+    * \param depth the frames of a channel a subscriber holds in place, it copies the frames beyond them
+    */
+    FrameBusPublisher(const std::string& name, std::size_t channels, std::size_t subscribers, std::size_t depth,
+                      cv::Size frameSize);
+    ~FrameBusPublisher();
+
+    FrameBusPublisher(const FrameBusPublisher&) = delete;
+    FrameBusPublisher& operator=(const FrameBusPublisher&) = delete;
+
+    /**
+    * \brief Copies a CV_8UC3 frame into a free slot of the channel, a larger frame than the frame size
+    * of the bus is scaled down to it
+    */
+    void publish(std::size_t channel, const cv::Mat& frame);
+
+private:
+    std::shared_ptr<FrameBusMapping> mapping;
+    std::vector<std::uint64_t> sequences;  // of the last published frames
+    std::vector<std::size_t> nextSlots;
+    std::vector<char> droppedFrames;  // warned about, not bool so the channels are published concurrently
+};
+
+/**
+* \brief Reads the frames a FrameBusPublisher of another process publishes. The frames point to the
+* shared memory and must not be modified, a slot stays held while the lease of its frame is alive.
+* Takes an entry in the table of the subscribers of the bus until the subscriber and the leases of
+* its frames are destroyed
+*/
+class FrameBusSubscriber final {
+public:
+    explicit FrameBusSubscriber(const std::string& name);
+
+    FrameBusSubscriber(const FrameBusSubscriber&) = delete;
+    FrameBusSubscriber& operator=(const FrameBusSubscriber&) = delete;
+
+    std::size_t getChannelsCount() const;
+
+    /**
+    * \brief Waits up to timeout for a frame of the channel published after the frame of lastSequence
+    * and holds its slot until lease is released. When the leases of the subscriber hold the depth of the
+    * bus of the channel, the frame is copied and lease is empty. Returns false on timeout, 0 only checks
+    * for a frame
+    */
+    bool read(std::size_t channel, std::uint64_t& lastSequence, cv::Mat& frame, std::shared_ptr<void>& lease,
+              std::chrono::milliseconds timeout);
+
+private:
+    std::shared_ptr<FrameBusMapping> mapping;
+    std::shared_ptr<FrameBusLeases> leases;
+};
+
+/**
+* \brief Parses a frame bus input "bus:<name>/<channel>", returns false for other inputs
+*/
+bool parseFrameBusInput(const std::string& input, std::string& name, std::size_t& channel);
@@ -0,0 +1,118 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "frame_pool.hpp"
+
+struct FramePoolStorage {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<VideoFrame>> frames;  // all the frames ever allocated
+    std::vector<VideoFrame*> freeFrames;
+    // the control blocks all have the same size, the one of the first allocation
+    std::size_t blockSize = 0;
+    std::vector<std::unique_ptr<std::max_align_t[]>> blocks;
+    std::vector<void*> freeBlocks;
+
+    VideoFrame* acquireFrame() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (freeFrames.empty()) {
+            frames.emplace_back(new VideoFrame);
+            return frames.back().get();
+        }
+        VideoFrame* frame = freeFrames.back();
+        freeFrames.pop_back();
+        return frame;
+    }
+
+    void releaseFrame(VideoFrame* frame) {
+        frame->reset();  // drops the buffers, surfaces and leases the frame held right away
+        std::lock_guard<std::mutex> lock(mutex);
+        freeFrames.push_back(frame);
+    }
+
+    void* allocateBlock(std::size_t size) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (0 == blockSize) {
+            blockSize = size;
+        }
+        if (size != blockSize) {
+            return ::operator new(size);
+        }
+        if (freeBlocks.empty()) {
+            blocks.emplace_back(new std::max_align_t[(size + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t)]);
+            return blocks.back().get();
+        }
+        void* block = freeBlocks.back();
+        freeBlocks.pop_back();
+        return block;
+    }
+
+    void releaseBlock(void* block, std::size_t size) {
+        if (size != blockSize) {
+            ::operator delete(block);
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        freeBlocks.push_back(block);
+    }
+};
+
+namespace {
+// allocates the control blocks of the frame pointers from the storage
+template <typename T>
+struct BlockAllocator {
+    using value_type = T;
+
+    std::shared_ptr<FramePoolStorage> storage;
+
+    explicit BlockAllocator(std::shared_ptr<FramePoolStorage> storage_): storage(std::move(storage_)) {}
+
+    template <typename U>
+    BlockAllocator(const BlockAllocator<U>& other): storage(other.storage) {}
+
+    T* allocate(std::size_t n) {
+        return static_cast<T*>(storage->allocateBlock(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, std::size_t n) {
+        storage->releaseBlock(p, n * sizeof(T));
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const BlockAllocator<T>& a, const BlockAllocator<U>& b) {
+    return a.storage == b.storage;
+}
+
+template <typename T, typename U>
+bool operator!=(const BlockAllocator<T>& a, const BlockAllocator<U>& b) {
+    return !(a == b);
+}
+
+struct FrameRecycler {
+    std::shared_ptr<FramePoolStorage> storage;
+
+    void operator()(VideoFrame* frame) const {
+        storage->releaseFrame(frame);
+    }
+};
+}  // namespace
+
+VideoFramePool::VideoFramePool(): storage(std::make_shared<FramePoolStorage>()) {}
+
+std::shared_ptr<VideoFrame> VideoFramePool::acquire() {
+    return std::shared_ptr<VideoFrame>(storage->acquireFrame(), FrameRecycler{storage},
+                                       BlockAllocator<VideoFrame>(storage));
+}
+
+std::size_t VideoFramePool::getSize() const {
+    std::lock_guard<std::mutex> lock(storage->mutex);
+    return storage->frames.size();
+}
@@ -0,0 +1,77 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "input.hpp"
+
+// the frames and the shared_ptr control blocks of a VideoFramePool, alive while any of its frames is
+struct FramePoolStorage;
+
+/**
+* \brief Recycles VideoFrames, so the frames passing the pipeline in its steady state don't allocate. A frame
+* acquired from the pool is reset and returned to it once the last copy of its pointer is released, the
+* control block of the pointer comes from the pool too. The pool grows to the number of the frames in flight
+* and may be destroyed before them
+*/
+class VideoFramePool final {
+public:
+    VideoFramePool();
+
+    VideoFramePool(const VideoFramePool&) = delete;
+    VideoFramePool& operator=(const VideoFramePool&) = delete;
+
+    /**
+    * \brief A default constructed frame, allocated only when all the frames of the pool are in use
+    */
+    std::shared_ptr<VideoFrame> acquire();
+
+    // frames ever allocated by the pool, stops growing in the steady state
+    std::size_t getSize() const;
+
+private:
+    std::shared_ptr<FramePoolStorage> storage;
+};
+
+/**
+* \brief Reuses the storage of the results no frame holds anymore, e.g. a vector of detections keeps its
+* capacity from one frame to the next. T is a container, the acquired storage is cleared. Thread safe, the
+* postprocessing of several threads shares a pool
+*/
+template <typename T>
+class DetectionsPool final {
+public:
+    Detections acquire() {
+        std::lock_guard<std::mutex> lock(mutex);
+        // round robin, the storage released the longest ago is checked first
+        for (std::size_t checked = 0; checked < storages.size(); checked++) {
+            next = (next + 1) % storages.size();
+            auto& storage = storages[next];
+            if (1 == storage.use_count()) {
+                // the last frame released it on another thread, see its writes before reusing it
+                std::atomic_thread_fence(std::memory_order_acquire);
+                storage->clear();
+                Detections detections;
+                detections.set(storage);
+                return detections;
+            }
+        }
+        storages.push_back(std::make_shared<T>());
+        next = storages.size() - 1;
+        Detections detections;
+        detections.set(storages.back());
+        return detections;
+    }
+
+private:
+    std::mutex mutex;
+    std::vector<std::shared_ptr<T>> storages;
+    std::size_t next = 0;
+};
@@ -0,0 +1,250 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#if USE_GAPI
+
+#include <algorithm>
+#include <cctype>
+#include <deque>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <inference_engine.hpp>
+#include <opencv2/gapi.hpp>
+#include <opencv2/gapi/core.hpp>
+#include <opencv2/gapi/infer.hpp>
+#include <opencv2/gapi/infer/ie.hpp>
+#include <opencv2/gapi/streaming/source.hpp>
+
+#include <samples/instrumentation.hpp>
+
+#include "gapi_pipeline.hpp"
+
+namespace {
+// the traces of the frames a source read which the puller of the channel hasn't taken yet. A streaming graph
+// doesn't reorder or drop the frames, so the traces are taken in the order they were pushed
+class PendingTraces final {
+public:
+    void push(const FrameTrace& trace) {
+        std::lock_guard<std::mutex> lock(mutex);
+        traces.push_back(trace);
+    }
+
+    FrameTrace pop() {
+        std::lock_guard<std::mutex> lock(mutex);
+        FrameTrace trace;
+        if (!traces.empty()) {
+            trace = traces.front();
+            traces.pop_front();
+        }
+        return trace;
+    }
+
+private:
+    std::mutex mutex;
+    std::deque<FrameTrace> traces;
+};
+
+// cv::gapi::wip::GCaptureSource which stamps the captures of the frames and rewinds the looped videos
+class TracedCaptureSource final : public cv::gapi::wip::IStreamSource {
+public:
+    TracedCaptureSource(const std::string& input_, bool loop_, PendingTraces& traces_):
+            input(input_), camera(!input_.empty() && std::all_of(input_.begin(), input_.end(), ::isdigit)),
+            loop(loop_ && !camera), traces(traces_) {
+        open();
+        // the graph is compiled for the format of the first frame before the streaming starts
+        if (!read(first)) {
+            throw std::runtime_error("Cannot read a frame from " + input);
+        }
+        meta = cv::descr_of(first);
+    }
+
+    bool pull(cv::gapi::wip::Data& data) override {
+        cv::Mat frame;  // a new buffer for every frame, the demo keeps the frames while they are shown
+        if (!first.empty()) {
+            std::swap(frame, first);
+        } else if (!read(frame)) {
+            return false;
+        }
+        data = frame;
+        return true;
+    }
+
+    cv::GMetaArg descr_of() const override {
+        return cv::GMetaArg{meta};
+    }
+
+private:
+    void open() {
+        if (camera) {
+            capture.open(std::stoi(input));
+        } else {
+            capture.open(input);
+        }
+        if (!capture.isOpened()) {
+            throw std::runtime_error("Cannot open " + input);
+        }
+    }
+
+    bool read(cv::Mat& frame) {
+        FrameTrace trace;
+        trace.stamp(FrameTrace::Capture);
+        bool read = capture.read(frame);
+        if (!read && loop) {
+            capture.release();
+            open();
+            read = capture.read(frame);
+        }
+        if (!read) {
+            return false;
+        }
+        trace.stamp(FrameTrace::Decode);
+        traces.push(trace);
+        return true;
+    }
+
+    const std::string input;
+    const bool camera;
+    const bool loop;
+    PendingTraces& traces;
+    cv::VideoCapture capture;
+    cv::Mat first;
+    cv::GMatDesc meta;
+};
+
+const char networkTag[] = "multichannel-network";
+}  // namespace
+
+struct GapiPipeline::Channel {
+    PendingTraces traces;
+    cv::GStreamingCompiled compiled;
+};
+
+GapiPipeline::GapiPipeline(const InitParams& params) {
+    // the generic infer of G-API addresses the layers by their names
+    InferenceEngine::Core ie;
+    auto network = ie.ReadNetwork(params.modelPath);
+    const auto inputsInfo = network.getInputsInfo();
+    if (1 != inputsInfo.size()) {
+        throw std::logic_error("-backend gapi supports the networks of a single input only");
+    }
+    for (const auto& output : network.getOutputsInfo()) {
+        outputNames.push_back(output.first);
+    }
+
+    // the IE backend fuses the resize and the layout conversion of the input into the inference
+    cv::GMat in;
+    cv::GInferInputs inferInputs;
+    inferInputs[inputsInfo.begin()->first] = in;
+    cv::GInferOutputs inferOutputs = cv::gapi::infer<cv::gapi::Generic>(networkTag, inferInputs);
+    std::vector<cv::GMat> outs{cv::gapi::copy(in)};  // the frame leaves the graph with its results
+    for (const auto& name : outputNames) {
+        outs.push_back(inferOutputs.at(name));
+    }
+    cv::GComputation graph(std::vector<cv::GMat>{in}, outs);
+
+    const std::string weightsPath = params.modelPath.substr(0, params.modelPath.rfind('.')) + ".bin";
+    for (const auto& input : params.inputs) {
+        cv::gapi::ie::Params<cv::gapi::Generic> networkParams{networkTag, params.modelPath, weightsPath,
+                                                              params.deviceName};
+        networkParams.cfgNumRequests(std::max<std::size_t>(params.maxRequests, 1));
+
+        std::unique_ptr<Channel> channel(new Channel);
+        channel->compiled = graph.compileStreaming(cv::compile_args(cv::gapi::networks(networkParams)));
+        channel->compiled.setSource(cv::gapi::wip::make_src<TracedCaptureSource>(input, params.loopVideo,
+                                                                                 channel->traces));
+        channels.push_back(std::move(channel));
+    }
+    channelFrames.assign(channels.size(), 0);
+}
+
+GapiPipeline::~GapiPipeline() {
+    terminate = true;
+    for (auto& channel : channels) {
+        channel->compiled.stop();  // pull() returns false then
+    }
+    for (auto& puller : pullers) {
+        puller.join();
+    }
+}
+
+const std::vector<std::string>& GapiPipeline::getOutputNames() const {
+    return outputNames;
+}
+
+void GapiPipeline::start(PostprocessingFunc postprocessingFunc_) {
+    postprocessingFunc = std::move(postprocessingFunc_);
+    startTime = std::chrono::steady_clock::now();
+    runningChannels = channels.size();
+    for (auto& channel : channels) {
+        channel->compiled.start();
+    }
+    for (std::size_t i = 0; i < channels.size(); i++) {
+        pullers.emplace_back(&GapiPipeline::pullChannel, this, i);
+    }
+}
+
+void GapiPipeline::pullChannel(std::size_t channelIdx) {
+    instrumentation::registerCurrentThread("gapi puller");
+    Channel& channel = *channels[channelIdx];
+    std::vector<cv::Mat> outputs(outputNames.size());
+    while (!terminate) {
+        cv::Mat frame;  // the returned frames keep theirs
+        cv::GRunArgsP args;
+        args.emplace_back(&frame);
+        for (auto& output : outputs) {
+            args.emplace_back(&output);
+        }
+        if (!channel.compiled.pull(std::move(args))) {
+            break;
+        }
+        auto vframe = std::make_shared<VideoFrame>();
+        vframe->trace = channel.traces.pop();
+        vframe->trace.stamp(FrameTrace::InferEnd);
+        vframe->frame = frame;
+        vframe->sourceIdx = channelIdx;
+        vframe->detections = postprocessingFunc(outputs, frame.size());
+        vframe->trace.stamp(FrameTrace::Postprocess);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            readyFrames.push_back(std::move(vframe));
+            channelFrames[channelIdx]++;
+        }
+        framesReady.notify_one();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        runningChannels--;
+    }
+    framesReady.notify_one();
+}
+
+bool GapiPipeline::isRunning() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return 0 != runningChannels || !readyFrames.empty();
+}
+
+std::vector<std::shared_ptr<VideoFrame>> GapiPipeline::getBatchData() {
+    std::unique_lock<std::mutex> lock(mutex);
+    framesReady.wait(lock, [this] { return !readyFrames.empty() || 0 == runningChannels; });
+    std::vector<std::shared_ptr<VideoFrame>> frames;
+    frames.swap(readyFrames);
+    return frames;
+}
+
+GapiPipeline::Stats GapiPipeline::getStats() const {
+    Stats stats;
+    stats.elapsedTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    std::lock_guard<std::mutex> lock(mutex);
+    for (std::size_t frames : channelFrames) {
+        stats.channelFps.push_back(stats.elapsedTime > 0.0f ? 1000.0f * frames / stats.elapsedTime : 0.0f);
+        stats.inferredFrames += frames;
+    }
+    return stats;
+}
+
+#endif  // USE_GAPI
@@ -0,0 +1,88 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "input.hpp"
+
+/**
+* \brief An alternative to VideoSources and IEGraph on top of the G-API streaming mode, built with
+* MULTICHANNEL_DEMO_USE_GAPI. Every channel is a compiled streaming graph of the capture, the inference with the
+* resize and the layout conversion of the input fused into the IE backend and a copy of the frame for the output.
+* G-API pipelines the stages of a graph itself, a thread per channel only pulls the results and postprocesses them.
+* getBatchData() returns the same frames IEGraph does, so the demos render, trace and benchmark both backends alike
+*/
+class GapiPipeline final {
+public:
+    struct InitParams {
+        std::string modelPath;
+        std::string deviceName;
+        std::size_t maxRequests = 1;  // infer requests of every channel
+        // a video file or a camera index per channel, a file may be opened by several channels
+        std::vector<std::string> inputs;
+        bool loopVideo = false;
+    };
+
+    // outputs are the outputs of the network in the order of getOutputNames(), frameSize is the captured frame
+    using PostprocessingFunc = std::function<Detections(const std::vector<cv::Mat>& outputs, cv::Size frameSize)>;
+
+    explicit GapiPipeline(const InitParams& params);
+    ~GapiPipeline();
+
+    GapiPipeline(const GapiPipeline&) = delete;
+    GapiPipeline& operator=(const GapiPipeline&) = delete;
+
+    const std::vector<std::string>& getOutputNames() const;
+
+    /**
+    * \brief Starts the graphs, postprocessingFunc is called on the threads of the channels
+    */
+    void start(PostprocessingFunc postprocessingFunc);
+
+    bool isRunning();
+
+    /**
+    * \brief Waits for the frames postprocessed since the previous call, empty once all the inputs ended
+    */
+    std::vector<std::shared_ptr<VideoFrame>> getBatchData();
+
+    struct Stats {
+        std::vector<float> channelFps;  // per channel, the frames returned per second since start()
+        std::size_t inferredFrames = 0;
+        float elapsedTime = 0.0f;       // msec since start()
+    };
+
+    Stats getStats() const;
+
+private:
+    struct Channel;
+
+    void pullChannel(std::size_t channelIdx);
+
+    std::vector<std::string> outputNames;
+    std::vector<std::unique_ptr<Channel>> channels;
+    PostprocessingFunc postprocessingFunc;
+    std::vector<std::thread> pullers;
+    std::chrono::steady_clock::time_point startTime;
+
+    mutable std::mutex mutex;
+    std::condition_variable framesReady;
+    std::vector<std::shared_ptr<VideoFrame>> readyFrames;  // of the mutex above
+    std::size_t runningChannels = 0;
+    std::vector<std::size_t> channelFrames;
+    std::atomic<bool> terminate = {false};
+};
@@ -4,12 +4,30 @@
 
 #include <algorithm>
 #include <chrono>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <sstream>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include <cldnn/cldnn_config.hpp>
+#ifdef USE_LIBVA
+#include <gpu/gpu_context_api_va.hpp>
+#endif
+#include <samples/hugepage_allocator.hpp>
+#include <samples/hwc_to_chw.hpp>
+#include <samples/instrumentation.hpp>
+#include <samples/mapped_weights.hpp>
+#include <samples/network_cache.hpp>
+
 #include "graph.hpp"
+#include "raw_image.hpp"
+#include "shared_inference.hpp"
 #include "threading.hpp"
 
 #ifdef USE_TBB
@@ -19,34 +37,53 @@
 namespace {
 
 void loadImgToIEGraph(const cv::Mat& img, size_t batch, void* ieBuffer) {
-    const int channels = img.channels();
-    const int height = img.rows;
-    const int width = img.cols;
-
-    float* ieData = reinterpret_cast<float*>(ieBuffer);
-    int bOffset = static_cast<int>(batch) * channels * width * height;
-    for (int c = 0; c < channels; c++) {
-        int cOffset = c * width * height;
-        for (int w = 0; w < width; w++) {
-            for (int h = 0; h < height; h++) {
-                ieData[bOffset + cOffset + h * width + w] =
-                        static_cast<float>(img.at<cv::Vec3b>(h, w)[c]);
-            }
+    const size_t channels = static_cast<size_t>(img.channels());
+    const size_t height = static_cast<size_t>(img.rows);
+    const size_t width = static_cast<size_t>(img.cols);
+
+    float* ieData = reinterpret_cast<float*>(ieBuffer) + batch * channels * width * height;
+    hwcU8ToChwF32(img.data, img.step, width, height, channels, ieData);
+}
+
+std::vector<std::string> splitDevices(const std::string& deviceName) {
+    if (deviceName.find("HETERO:") == 0 || deviceName.find("MULTI:") == 0) {
+        return {deviceName};
+    }
+    std::vector<std::string> devices;
+    std::stringstream stream(deviceName);
+    std::string device;
+    while (std::getline(stream, device, ',')) {
+        if (!device.empty()) {
+            devices.push_back(device);
         }
     }
+    if (devices.empty()) {
+        throw std::logic_error("No inference device specified");
+    }
+    return devices;
+}
+
+template <typename Duration>
+std::uint64_t toNSec(Duration duration) {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
 }
 
 }  // namespace
 
 void IEGraph::initNetwork(const std::string& deviceName) {
-    auto cnnNetwork = ie.ReadNetwork(modelPath);
+    cnnNetwork = readNetworkMapped(ie, modelPath);
 
-    if (deviceName.find("CPU") != std::string::npos) {
+    const auto deviceNames = splitDevices(deviceName);
+    SharedInference& sharedInference = SharedInference::instance();
+
+    if (!autoThroughput && deviceName.find("CPU") != std::string::npos) {
         ie.SetConfig({{InferenceEngine::PluginConfigParams::KEY_CPU_BIND_THREAD, "NO"}}, "CPU");
     }
+    if (cpuThreads > 0 && 0 == sharedInference.getCpuBudget() && deviceName.find("CPU") != std::string::npos) {
+        ie.SetConfig({{CONFIG_KEY(CPU_THREADS_NUM), std::to_string(cpuThreads)}}, "CPU");
+    }
     if (!cpuExtensionPath.empty()) {
-        auto extension_ptr = InferenceEngine::make_so_pointer<InferenceEngine::IExtension>(cpuExtensionPath);
-        ie.AddExtension(extension_ptr, "CPU");
+        sharedInference.addCpuExtension(cpuExtensionPath);
     }
     if (!cldnnConfigPath.empty()) {
         ie.SetConfig({{InferenceEngine::PluginConfigParams::KEY_CONFIG_FILE, cldnnConfigPath}}, "GPU");
@@ -68,14 +105,41 @@ void IEGraph::initNetwork(const std::string& deviceName) {
         cnnNetwork.reshape(inShapes);
     }
 
-    InferenceEngine::ExecutableNetwork network;
-    network = ie.LoadNetwork(cnnNetwork, deviceName);
-
     InferenceEngine::InputsDataMap inputInfo(cnnNetwork.getInputsInfo());
     if (inputInfo.size() != 1) {
         throw std::logic_error("Face Detection network should have only one input");
     }
     inputDataBlobName = inputInfo.begin()->first;
+    inputDims = inputInfo.begin()->second->getTensorDesc().getDims();
+    if (remoteSurfaces) {
+#ifndef USE_LIBVA
+        throw std::logic_error("Remote surface input requires a build with hardware decoding support");
+#endif
+        if (batchSize != 1 || std::any_of(deviceNames.begin(), deviceNames.end(), [](const std::string& device) {
+                return device.find("GPU") != 0;
+            })) {
+            throw std::logic_error("Remote surface input requires batch size 1 and GPU devices only");
+        }
+        // surfaces are fed as two plane NV12 remote blobs, the plugin converts them on the GPU
+        inputInfo.begin()->second->setPrecision(InferenceEngine::Precision::U8);
+        inputInfo.begin()->second->getPreProcess().setColorFormat(InferenceEngine::ColorFormat::NV12);
+    } else if (u8Input) {
+        inputInfo.begin()->second->setPrecision(InferenceEngine::Precision::U8);
+        inputInfo.begin()->second->setLayout(InferenceEngine::Layout::NHWC);
+    }
+
+    // partially filled batches are inferred with SetBatch where the plugin supports it
+    dynamicBatch = batchTimeout.count() > 0 && batchSize > 1 &&
+                   std::all_of(deviceNames.begin(), deviceNames.end(), [](const std::string& device) {
+                       return device == "CPU" || device == "GPU";
+                   });
+    if (dynamicBatch) {
+        loadConfig[InferenceEngine::PluginConfigParams::KEY_DYN_BATCH_ENABLED] =
+            InferenceEngine::PluginConfigParams::YES;
+    }
+    if (remoteSurfaces) {
+        loadConfig[CLDNN_CONFIG_KEY(NV12_TWO_INPUTS)] = InferenceEngine::PluginConfigParams::YES;
+    }
 
     InferenceEngine::OutputsDataMap outputInfo(cnnNetwork.getOutputsInfo());
     outputDataBlobNames.reserve(outputInfo.size());
@@ -83,16 +147,230 @@ void IEGraph::initNetwork(const std::string& deviceName) {
         outputDataBlobNames.push_back(i.first);
     }
 
-    for (size_t i = 0; i < maxRequests; ++i) {
-        auto req = network.CreateInferRequestPtr();
-        availableRequests.push(req);
+    if (autoThroughput) {
+        // the networks another graph of the process loaded keep the streams they were loaded with
+        std::vector<std::string> loadedDeviceNames;
+        for (const auto& name : deviceNames) {
+            if (remoteSurfaces || nullptr == sharedInference.findNetwork(cnnNetwork, modelPath, name, loadConfig)) {
+                loadedDeviceNames.push_back(name);
+            }
+        }
+        configureThroughput(loadedDeviceNames);
+    }
+
+    for (const auto& name : deviceNames) {
+        std::unique_ptr<DeviceContext> device(new DeviceContext);
+        device->name = name;
+        if (remoteSurfaces) {
+            // the network is loaded on the VA display of the first decoded surface
+            devices.push_back(std::move(device));
+            continue;
+        }
+        device->network = sharedInference.loadNetwork(cnnNetwork, modelPath, name, loadConfig, cacheDir);
+        std::size_t poolSize = maxRequests;
+        if (autoThroughput) {
+            try {
+                poolSize = device->network->GetMetric(
+                    METRIC_KEY(OPTIMAL_NUMBER_OF_INFER_REQUESTS)).as<unsigned int>();
+            } catch (const InferenceEngine::details::InferenceEngineException&) {
+                slog::warn << "Device " << name << " does not report the optimal number of infer requests, using "
+                           << maxRequests << slog::endl;
+            }
+            poolSize = std::max<std::size_t>(poolSize, 1);
+            slog::info << "\tNumber of infer requests for " << name << ": " << poolSize << slog::endl;
+        }
+        createRequests(*device, poolSize);
+        devices.push_back(std::move(device));
     }
 
     if (postLoad != nullptr)
         postLoad(outputDataBlobNames, cnnNetwork);
 
-    availableRequests.front()->StartAsync();
-    availableRequests.front()->Wait(InferenceEngine::IInferRequest::WaitMode::RESULT_READY);
+    warmUp();
+}
+
+void IEGraph::warmUp() {
+    // every request runs at once, so each stream of every device allocates its memory and compiles its kernels
+    // before the first frame rather than on the first batches it infers
+    for (std::size_t run = 0; run < warmupRuns; ++run) {
+        for (auto& request : requests) {
+            request->StartAsync();
+        }
+        for (auto& request : requests) {
+            request->Wait(InferenceEngine::IInferRequest::WaitMode::RESULT_READY);
+        }
+    }
+}
+
+void IEGraph::createRequests(DeviceContext& device, std::size_t poolSize) {
+    device.availableRequests.reset(new RingBuffer<InferenceEngine::InferRequest::Ptr>(poolSize));
+    for (size_t i = 0; i < poolSize; ++i) {
+        auto req = device.network->CreateInferRequestPtr();
+        if (arenaBlobs && !remoteSurfaces) {
+            req->SetBlob(inputDataBlobName, makeArenaBlob(req->GetBlob(inputDataBlobName)->getTensorDesc()));
+        }
+        if (zeroCopy && !remoteSurfaces) {
+            requestInputBlobs[req.get()] = req->GetBlob(inputDataBlobName);
+        }
+        InferenceEngine::InferRequest* rawReq = req.get();
+        {
+            std::lock_guard<std::mutex> lock(batchesMutex);
+            inFlightBatches[rawReq];
+        }
+        req->SetCompletionCallback(std::function<void()>([this, rawReq] {
+            onBatchInferred(rawReq);
+        }));
+        requests.push_back(req);
+        device.requests.push_back(req);
+        auto pushed = device.availableRequests->tryPush(std::move(req));
+        assert(pushed);
+        (void)pushed;
+    }
+}
+
+#ifdef USE_LIBVA
+void IEGraph::loadRemoteNetworks(void* vaDisplay) {
+    for (auto& device : devices) {
+        device->remoteContext = InferenceEngine::gpu::make_shared_context(ie, device->name,
+                                                                           static_cast<VADisplay>(vaDisplay));
+        device->network = std::make_shared<InferenceEngine::ExecutableNetwork>(
+            ie.LoadNetwork(cnnNetwork, device->remoteContext, loadConfig));
+        createRequests(*device, maxRequests);
+    }
+    warmUp();
+}
+#endif
+
+void IEGraph::configureThroughput(const std::vector<std::string>& deviceNames) {
+    // every stream runs one batch at a time, so there is no use in more streams than batches in flight
+    const std::size_t batchesInFlight = numChannels > 0 ? (numChannels + batchSize - 1) / batchSize : 0;
+    const bool useCpu = std::find(deviceNames.begin(), deviceNames.end(), "CPU") != deviceNames.end();
+    const bool useGpu = std::find(deviceNames.begin(), deviceNames.end(), "GPU") != deviceNames.end();
+
+    SharedInference& sharedInference = SharedInference::instance();
+    if (useCpu && sharedInference.getCpuBudget() > 0) {
+        // the CPU networks of the process split the budget, a stream of a thread per core it took. The streams
+        // are not pinned, the cores of the first network would be taken by the streams of the next ones otherwise
+        const std::size_t cores = sharedInference.takeCpuCores(batchesInFlight > 0 ? batchesInFlight :
+                                                                                      sharedInference.getCpuBudget());
+        ie.SetConfig({{CONFIG_KEY(CPU_THROUGHPUT_STREAMS), std::to_string(cores)},
+                      {CONFIG_KEY(CPU_THREADS_NUM), std::to_string(cores)},
+                      {CONFIG_KEY(CPU_BIND_THREAD), CONFIG_VALUE(NO)}}, "CPU");
+        slog::info << "\tCPU throughput streams: " << cores << " of the budget of "
+                   << sharedInference.getCpuBudget() << " cores" << slog::endl;
+    } else if (useCpu) {
+        // leave half of the logical cores or the other shares of ThreadPolicy to decoding, preprocessing and
+        // rendering
+        const std::size_t cores = cpuThreads > 0 ? cpuThreads :
+                                                   std::max<std::size_t>(std::thread::hardware_concurrency() / 2, 1);
+        ie.SetConfig({{CONFIG_KEY(CPU_THROUGHPUT_STREAMS),
+                       batchesInFlight > 0 ? std::to_string(std::min(batchesInFlight, cores)) :
+                                             CONFIG_VALUE(CPU_THROUGHPUT_AUTO)}}, "CPU");
+        slog::info << "\tCPU throughput streams: "
+                   << ie.GetConfig("CPU", CONFIG_KEY(CPU_THROUGHPUT_STREAMS)).as<std::string>() << slog::endl;
+    }
+    if (useGpu) {
+        // more than two streams give no gain on the GPU but cost memory
+        ie.SetConfig({{CONFIG_KEY(GPU_THROUGHPUT_STREAMS),
+                       batchesInFlight > 0 ? std::to_string(std::min<std::size_t>(batchesInFlight, 2)) :
+                                             CONFIG_VALUE(GPU_THROUGHPUT_AUTO)}}, "GPU");
+        if (useCpu) {
+            // otherwise the GPU plugin spin waits and takes a core away from the CPU streams
+            ie.SetConfig({{CLDNN_CONFIG_KEY(PLUGIN_THROTTLE), "1"}}, "GPU");
+        }
+        slog::info << "\tGPU throughput streams: "
+                   << ie.GetConfig("GPU", CONFIG_KEY(GPU_THROUGHPUT_STREAMS)).as<std::string>() << slog::endl;
+    }
+}
+
+void IEGraph::startBatch(BatchRequestDesc&& desc) {
+    sequencedFrames += desc.vfPtrVec.size();
+    InferenceEngine::InferRequest::Ptr req = desc.req;
+    {
+        std::lock_guard<std::mutex> lock(batchesMutex);
+        inFlightBatches.at(req.get()) = std::move(desc);
+        ++inFlightCount;
+    }
+    DEMO_ASYNC_BEGIN("infer", req.get());
+    req->StartAsync();
+}
+
+void IEGraph::onBatchInferred(InferenceEngine::InferRequest* req) {
+    const auto endTime = std::chrono::high_resolution_clock::now();
+    std::lock_guard<std::mutex> lock(batchesMutex);
+    BatchRequestDesc& desc = inFlightBatches.at(req);
+    if (nullptr == desc.req) {
+        return;  // the warm up inference, not started by startBatch
+    }
+    DEMO_ASYNC_END("infer", req);
+    desc.endTime = endTime;
+    completedBatches.push_back(std::move(desc));
+    desc = BatchRequestDesc();
+    --inFlightCount;
+    batchesChanged.notify_all();
+}
+
+bool IEGraph::canDeliverMore() const {
+    // the requests are released once their batches are postprocessed, so the frames waiting for the earlier
+    // frames of their channels or for the consumer are bounded here, as if the requests were busy
+    return sequencedFrames - deliveredFrames < 2 * requests.size() * batchSize;
+}
+
+void IEGraph::skipFrame(std::shared_ptr<VideoFrame> vframe) {
+    // a skipped frame takes no request, so it waits for the consumer here
+    Backoff backoff;
+    while (!canDeliverMore()) {
+        if (terminate) {
+            return;
+        }
+        if (OverflowPolicy::Block != overflowPolicy) {
+            droppedFrames.add(vframe->sourceIdx);
+            return;
+        }
+        backoff.pause();
+    }
+    const std::size_t seq = channelSeqs[vframe->sourceIdx]++;
+    ++skippedFramesCount;
+    ++sequencedFrames;
+    std::lock_guard<std::mutex> lock(batchesMutex);
+    orderFrames({std::move(vframe)}, {seq});
+    batchesChanged.notify_all();
+}
+
+bool IEGraph::acquireRequest(InferenceEngine::InferRequest::Ptr& req, std::size_t& deviceIdx, bool wait) {
+    // devices ordered by measured throughput, the ones without measurements yet go first
+    std::vector<std::pair<float, std::size_t>> order;
+    order.reserve(devices.size());
+    Backoff backoff;
+    while (!terminate) {
+        if (!canDeliverMore()) {
+            if (!wait) {
+                return false;
+            }
+            backoff.pause();
+            continue;
+        }
+        order.clear();
+        for (std::size_t i = 0; i < devices.size(); ++i) {
+            const float latency = devices[i]->avgBatchLatency;
+            const float throughput = latency > 0.0f ?
+                static_cast<float>(devices[i]->requests.size()) / latency :
+                std::numeric_limits<float>::max();
+            order.emplace_back(throughput, i);
+        }
+        std::sort(order.begin(), order.end(), std::greater<std::pair<float, std::size_t>>());
+        for (const auto& item : order) {
+            if (devices[item.second]->availableRequests->tryPop(req)) {
+                deviceIdx = item.second;
+                return true;
+            }
+        }
+        if (!wait) {
+            return false;
+        }
+        backoff.pause();
+    }
+    return false;
 }
 
 void IEGraph::start(GetterFunc getterFunc, PostprocessingFunc postprocessingFunc) {
@@ -101,88 +379,271 @@ void IEGraph::start(GetterFunc getterFunc, PostprocessingFunc postprocessingFunc
     assert(nullptr == getter);
     getter = std::move(getterFunc);
     postprocessing = std::move(postprocessingFunc);
+    startTime = std::chrono::high_resolution_clock::now();
     getterThread = std::thread([&]() {
+        instrumentation::registerCurrentThread("inference feeder");
         std::vector<std::shared_ptr<VideoFrame>> vframes;
+        std::vector<std::size_t> frameSeqs;
         std::vector<cv::Mat> imgsToProc(batchSize);
-        while (!terminate) {
+        Backoff dropBackoff;  // inputs may return cached frames at once, do not spin on dropping them
+        bool inputOver = false;
+        while (!terminate && !inputOver) {
             vframes.clear();
-            size_t b = 0;
-            while (b != batchSize) {
-                VideoFrame vframe;
-                if (getter(vframe)) {
-                    vframes.push_back(std::make_shared<VideoFrame>(vframe));
-                    ++b;
-                } else {
-                    terminate = true;
+            frameSeqs.clear();
+            auto batchStartTime = std::chrono::high_resolution_clock::now();
+            while (vframes.size() != batchSize && !terminate) {
+                if (batchTimeout.count() > 0 && !vframes.empty() &&
+                    std::chrono::high_resolution_clock::now() - batchStartTime >= batchTimeout) {
+                    break;  // deadline expired, infer a partially filled batch
+                }
+                auto vframePtr = framePool.acquire();
+                VideoFrame& vframe = *vframePtr;
+                const auto waitStart = std::chrono::high_resolution_clock::now();
+                const bool gotFrame = getter(vframe);
+                inputWaitNSec += toNSec(std::chrono::high_resolution_clock::now() - waitStart);
+                if (!gotFrame) {
+                    inputOver = true;  // the collected frames are still inferred
                     break;
                 }
+                if (vframe.frame.empty() && nullptr == vframe.surface.holder && vframe.raw.empty()) {
+                    continue;  // the channel had no frame ready in time
+                }
+                if (remoteSurfaces && nullptr == vframe.surface.holder) {
+                    droppedFrames.add(vframe.sourceIdx);  // not decoded to video memory, can not be fed
+                    continue;
+                }
+                if (remoteSurfaces || !vframe.raw.empty()) {
+                    vframe.roi = cv::Rect();  // fed whole, so the detections need no mapping
+                }
+                if (vframe.unchanged) {
+                    skipFrame(std::move(vframePtr));
+                    continue;
+                }
+                vframe.trace.stamp(FrameTrace::Enqueue);
+                if (vframes.empty()) {
+                    batchStartTime = vframe.trace.stamps[FrameTrace::Enqueue];
+                }
+                // numbered now, so a skipped frame of the channel read later is returned after this one
+                frameSeqs.push_back(channelSeqs[vframe.sourceIdx]++);
+                vframes.push_back(std::move(vframePtr));
+            }
+            if (vframes.empty()) {
+                break;
             }
+            const size_t filled = vframes.size();
+
+#ifdef USE_LIBVA
+            if (remoteSurfaces && !remoteNetworksLoaded) {
+                loadRemoteNetworks(vframes.front()->surface.display);
+                remoteNetworksLoaded = true;
+            }
+#endif
 
             InferenceEngine::InferRequest::Ptr req;
-            {
-                std::unique_lock<std::mutex> lock(mtxAvalableRequests);
-                condVarAvailableRequests.wait(lock, [&]() {
-                    return !availableRequests.empty() || terminate;
-                });
+            std::size_t deviceIdx = 0;
+            if (!acquireRequest(req, deviceIdx, OverflowPolicy::Block == overflowPolicy)) {
                 if (terminate) {
                     break;
                 }
-                req = std::move(availableRequests.front());
-                availableRequests.pop();
+                for (const auto& vframe : vframes) {
+                    droppedFrames.add(vframe->sourceIdx);
+                }
+                {
+                    // the later frames of the channels do not wait for the dropped ones
+                    std::lock_guard<std::mutex> lock(batchesMutex);
+                    orderFrames(std::move(vframes), frameSeqs, true);
+                    batchesChanged.notify_all();
+                }
+                dropBackoff.pause();
+                continue;
             }
+            dropBackoff.reset();
 
-            auto inputBlob = req->GetBlob(inputDataBlobName);
-            imgsToProc.resize(batchSize);
-            for (size_t i = 0; i < batchSize; i++) {
-                if (imgsToProc[i].empty()) {
-                    auto& dims = inputBlob->getTensorDesc().getDims();
-                    assert(4 == dims.size());
-                    auto height = static_cast<int>(dims[2]);
-                    auto width  = static_cast<int>(dims[3]);
-                    imgsToProc[i] = cv::Mat(height, width, CV_8UC3);
+            // in zero copy mode the request may still hold a blob wrapping an old frame
+            InferenceEngine::Blob::Ptr inputBlob;
+            if (!remoteSurfaces) {
+                inputBlob = zeroCopy ? requestInputBlobs.at(req.get()) : req->GetBlob(inputDataBlobName);
+            }
+            assert(4 == inputDims.size());
+            const cv::Size inputSize(static_cast<int>(inputDims[3]), static_cast<int>(inputDims[2]));
+            const cv::Mat firstFrame = vframes.front()->analysed();
+            const bool wrapFrame = !remoteSurfaces && zeroCopy && 1 == filled && vframes.front()->raw.empty() &&
+                                   firstFrame.size() == inputSize && CV_8UC3 == firstFrame.type() &&
+                                   firstFrame.isContinuous();
+            const auto rawFrames = static_cast<std::size_t>(std::count_if(vframes.begin(), vframes.end(),
+                [](const std::shared_ptr<VideoFrame>& vframe) { return !vframe->raw.empty(); }));
+            if (!u8Input && !remoteSurfaces) {
+                imgsToProc.resize(batchSize);
+                for (size_t i = 0; i < batchSize; i++) {
+                    if (imgsToProc[i].empty()) {
+                        imgsToProc[i] = cv::Mat(inputSize, CV_8UC3);
+                    }
                 }
             }
 
             auto preprocess = [&]() {
+                DEMO_TASK("preprocess");
+#ifdef USE_LIBVA
+                if (remoteSurfaces) {
+                    // the surface is kept alive by vframes until the request is completed
+                    const auto& surface = vframes.front()->surface;
+                    req->SetBlob(inputDataBlobName, InferenceEngine::gpu::make_shared_blob_nv12(
+                                     surface.height, surface.width, devices[deviceIdx]->remoteContext,
+                                     static_cast<VASurfaceID>(surface.id)));
+                    return;
+                }
+#endif
+                if (wrapFrame) {
+                    // the frame is kept alive by vframes until the request is completed
+                    req->SetBlob(inputDataBlobName, InferenceEngine::make_shared_blob<uint8_t>(
+                                     inputBlob->getTensorDesc(), firstFrame.data));
+                    return;
+                }
+                if (zeroCopy) {
+                    req->SetBlob(inputDataBlobName, inputBlob);
+                }
+                if (dynamicBatch) {
+                    req->SetBatch(static_cast<int>(filled));
+                }
                 auto buff = inputBlob->buffer();
-                float* inputPtr = static_cast<float*>(buff);
-                auto loopBody = [&](size_t i) {
-                    cv::resize(vframes[i]->frame,
-                               imgsToProc[i],
-                               imgsToProc[i].size());
-                    loadImgToIEGraph(imgsToProc[i], i, inputPtr);
-                };
+                std::function<void(size_t)> loopBody;
+                if (u8Input) {
+                    uint8_t* inputPtr = buff.as<uint8_t*>();
+                    const size_t imageSize = static_cast<size_t>(inputSize.area()) * 3;
+                    loopBody = [&, inputPtr, imageSize](size_t i) {
+                        if (!vframes[i]->raw.empty()) {
+                            rawToHwcU8(vframes[i]->raw, inputSize, inputPtr + i * imageSize);
+                            vframes[i]->raw = {};  // the capture buffer can be reused by the camera
+                            return;
+                        }
+                        // interleaved NHWC data, so the blob slot can be used as an image directly
+                        cv::Mat slot(inputSize, CV_8UC3, inputPtr + i * imageSize);
+                        const cv::Mat analysed = vframes[i]->analysed();
+                        if (analysed.size() == inputSize) {
+                            analysed.copyTo(slot);
+                        } else {
+                            cv::resize(analysed, slot, inputSize);
+                        }
+                    };
+                } else {
+                    float* inputPtr = buff.as<float*>();
+                    loopBody = [&, inputPtr](size_t i) {
+                        if (!vframes[i]->raw.empty()) {
+                            // converted and resized in one pass, without intermediate images
+                            rawToChwF32(vframes[i]->raw, inputSize, inputPtr + i * 3 * inputSize.area());
+                            vframes[i]->raw = {};  // the capture buffer can be reused by the camera
+                            return;
+                        }
+                        cv::resize(vframes[i]->analysed(),
+                                   imgsToProc[i],
+                                   imgsToProc[i].size());
+                        loadImgToIEGraph(imgsToProc[i], i, inputPtr);
+                    };
+                }
 #ifdef USE_TBB
                 run_in_arena([&](){
-                    tbb::parallel_for<size_t>(0, batchSize, loopBody);
+                    tbb::parallel_for<size_t>(0, filled, loopBody);
                 });
 #else
-                for (size_t i = 0; i < batchSize; i++) {
-                    loopBody(i);
-                }
+                get_thread_pool().parallel_for(0, filled, loopBody);
 #endif
+                // without dynamic batching the unused slots keep stale data and their results are dropped
             };
 
-            if (perfTimerInfer.enabled()) {
-                {
-                    ScopedTimer st(perfTimerPreprocess);
-                    preprocess();
-                }
-                auto startTime = std::chrono::high_resolution_clock::now();
-                req->StartAsync();
-                std::unique_lock<std::mutex> lock(mtxBusyRequests);
-                busyBatchRequests.push({std::move(vframes), std::move(req), startTime});
+            fedFramesCount += filled;
+            frameCopiesCount += (wrapFrame || remoteSurfaces) ? 0 :
+                                (u8Input ? filled : 2 * (filled - rawFrames) + rawFrames);
+            ++batchesCount;
+
+            const auto preprocessStart = std::chrono::high_resolution_clock::now();
+            if (perfTimerPreprocess.enabled()) {
+                ScopedTimer st(perfTimerPreprocess);
+                preprocess();
             } else {
                 preprocess();
-                req->StartAsync();
-                std::unique_lock<std::mutex> lock(mtxBusyRequests);
-                busyBatchRequests.push({std::move(vframes), std::move(req),
-                                    std::chrono::high_resolution_clock::time_point()});
             }
-            condVarBusyRequests.notify_one();
+            // the start time is always needed to balance the load between devices
+            auto inferStart = std::chrono::high_resolution_clock::now();
+            preprocessNSec += toNSec(inferStart - preprocessStart);
+            for (auto& vframe : vframes) {
+                vframe->trace.stamps[FrameTrace::InferStart] = inferStart;
+            }
+            BatchRequestDesc desc;
+            desc.vfPtrVec = std::move(vframes);
+            desc.frameSeqs = frameSeqs;
+            desc.req = std::move(req);
+            desc.startTime = inferStart;
+            desc.deviceIdx = deviceIdx;
+            startBatch(std::move(desc));
         }
-        condVarBusyRequests.notify_one(); // notify that there will be no new InferRequests
+        terminate = true;  // getBatchData returns the requests still in flight before it stops
+        notifyBatches();
     });
+    for (std::size_t i = 0; i < postprocessThreadsCount; ++i) {
+        postprocessThreads.emplace_back(&IEGraph::postprocessBatches, this);
+    }
+}
+
+void IEGraph::notifyBatches() {
+    // under the lock, so a waiter which has just checked terminate does not miss it
+    std::lock_guard<std::mutex> lock(batchesMutex);
+    batchesChanged.notify_all();
+}
+
+bool IEGraph::allFramesDelivered() const {
+    // sequencedFrames is final once terminate is set
+    return terminate && sequencedFrames == deliveredFrames + orderedFrames.size() &&
+           0 == inFlightCount && completedBatches.empty();
+}
+
+void IEGraph::orderFrames(std::vector<std::shared_ptr<VideoFrame>>&& vframes,
+                          const std::vector<std::size_t>& frameSeqs, bool dropped) {
+    for (std::size_t i = 0; i < vframes.size(); ++i) {
+        ChannelOrder& channel = channelOrders[vframes[i]->sourceIdx];
+        // a dropped frame only holds its place, so the frames after it are not returned before its batch
+        channel.pending.emplace(frameSeqs[i], dropped ? nullptr : std::move(vframes[i]));
+        while (!channel.pending.empty() && channel.pending.begin()->first == channel.nextSeq) {
+            std::shared_ptr<VideoFrame> vframe = std::move(channel.pending.begin()->second);
+            channel.pending.erase(channel.pending.begin());
+            ++channel.nextSeq;
+            if (nullptr == vframe) {
+                continue;
+            }
+            // the copies are taken before the frames are returned, so they hold the detections in the network
+            // coordinates, every frame maps and annotates its own copy
+            if (vframe->unchanged) {
+                vframe->detections = channel.lastDetections.clone();
+            } else {
+                channel.lastDetections = vframe->detections.clone();
+            }
+            orderedFrames.push_back(std::move(vframe));
+        }
+    }
+}
+
+void IEGraph::postprocessBatches() {
+    instrumentation::registerCurrentThread("postprocessing");
+    std::unique_lock<std::mutex> lock(batchesMutex);
+    while (true) {
+        // the frame size comes with the first getBatchData call
+        batchesChanged.wait(lock, [&]() {
+            return (!completedBatches.empty() && (cv::Size() != postprocessFrameSize || terminate)) ||
+                   (terminate && 0 == inFlightCount && completedBatches.empty());
+        });
+        if (completedBatches.empty()) {
+            return;
+        }
+        BatchRequestDesc desc = std::move(completedBatches.front());
+        completedBatches.pop_front();
+        const cv::Size frameSize = postprocessFrameSize;
+        lock.unlock();
+
+        auto vframes = completeBatch(desc, frameSize);
+
+        lock.lock();
+        orderFrames(std::move(vframes), desc.frameSeqs);
+        batchesChanged.notify_all();
+    }
 }
 
 IEGraph::IEGraph(const InitParams& p):
@@ -190,9 +651,16 @@ IEGraph::IEGraph(const InitParams& p):
     perfTimerInfer(p.collectStats ? PerfTimer::DefaultIterationsCount : 0),
     confidenceThreshold(0.5f), batchSize(p.batchSize),
     modelPath(p.modelPath),
-    cpuExtensionPath(p.cpuExtPath), cldnnConfigPath(p.cldnnConfigPath),
+    cpuExtensionPath(p.cpuExtPath), cldnnConfigPath(p.cldnnConfigPath), cacheDir(p.cacheDir),
     printPerfReport(p.reportPerf), deviceName(p.deviceName),
-    maxRequests(p.maxRequests) {
+    u8Input(p.u8Input || p.zeroCopy), zeroCopy(p.zeroCopy),
+    batchTimeout(p.batchTimeoutMSec),
+    ie(SharedInference::instance().core()),
+    postprocessThreadsCount(p.postprocessThreads),
+    maxRequests(p.maxRequests), autoThroughput(p.autoThroughput), numChannels(p.numChannels),
+    overflowPolicy(p.overflowPolicy), droppedFrames(p.numChannels), channelFrames(p.numChannels),
+    remoteSurfaces(p.remoteSurfaces), warmupRuns(p.warmupRuns), arenaBlobs(p.arenaBlobs),
+    cpuThreads(p.cpuThreads) {
     assert(p.maxRequests > 0);
 
     postLoad = p.postLoadFunc;
@@ -200,51 +668,86 @@ IEGraph::IEGraph(const InitParams& p):
 }
 
 bool IEGraph::isRunning() {
-    std::lock_guard<std::mutex> lock(mtxBusyRequests);
-    return !terminate || !busyBatchRequests.empty();
+    std::lock_guard<std::mutex> lock(batchesMutex);
+    return !allFramesDelivered();
 }
 
 InferenceEngine::SizeVector IEGraph::getInputDims() const {
-    assert(!availableRequests.empty());
-    auto inputBlob = availableRequests.front()->GetBlob(inputDataBlobName);
-    return inputBlob->getTensorDesc().getDims();
+    return inputDims;
 }
 
 std::vector<std::shared_ptr<VideoFrame> > IEGraph::getBatchData(cv::Size frameSize) {
-    std::vector<std::shared_ptr<VideoFrame>> vframes;
-    InferenceEngine::InferRequest::Ptr req;
-    std::chrono::high_resolution_clock::time_point startTime;
-    {
-        std::unique_lock<std::mutex> lock(mtxBusyRequests);
-        condVarBusyRequests.wait(lock, [&]() {
-            // wait until the pipeline is stopped or there are new InferRequests
-            return terminate || !busyBatchRequests.empty();
-        });
-        if (busyBatchRequests.empty()) {
-            return {}; // woke up because of termination, so leave if nothing to preces
+    std::unique_lock<std::mutex> lock(batchesMutex);
+    if (postprocessFrameSize != frameSize) {
+        postprocessFrameSize = frameSize;
+        batchesChanged.notify_all();
+    }
+    if (postprocessThreads.empty()) {
+        // postprocess the inferred batches here until a frame is next in its channel
+        while (orderedFrames.empty()) {
+            batchesChanged.wait(lock, [&]() { return !completedBatches.empty() || allFramesDelivered(); });
+            if (completedBatches.empty()) {
+                return {};  // woke up because of termination and nothing is left to process
+            }
+            BatchRequestDesc desc = std::move(completedBatches.front());
+            completedBatches.pop_front();
+            lock.unlock();
+            auto vframes = completeBatch(desc, frameSize);
+            lock.lock();
+            orderFrames(std::move(vframes), desc.frameSeqs);
         }
-        vframes = std::move(busyBatchRequests.front().vfPtrVec);
-        req = std::move(busyBatchRequests.front().req);
-        startTime = std::move(busyBatchRequests.front().startTime);
-        busyBatchRequests.pop();
+    } else {
+        batchesChanged.wait(lock, [&]() { return !orderedFrames.empty() || allFramesDelivered(); });
     }
+    std::vector<std::shared_ptr<VideoFrame>> vframes;
+    vframes.swap(orderedFrames);
+    deliveredFrames += vframes.size();
+    for (const auto& vframe : vframes) {
+        channelFrames.add(vframe->sourceIdx);
+    }
+    return vframes;
+}
+
+std::vector<std::shared_ptr<VideoFrame>> IEGraph::completeBatch(BatchRequestDesc& desc, cv::Size frameSize) {
+    std::vector<std::shared_ptr<VideoFrame>> vframes = std::move(desc.vfPtrVec);
+    InferenceEngine::InferRequest::Ptr req = std::move(desc.req);
+    auto startTime = desc.startTime;
+    auto endTime = desc.endTime;
+    auto& device = *devices[desc.deviceIdx];
 
+    // the request has completed, Wait only returns its status
     if (nullptr != req && InferenceEngine::OK == req->Wait(InferenceEngine::IInferRequest::WaitMode::RESULT_READY)) {
+        DEMO_TASK("postprocess");
+        const auto postprocessStart = std::chrono::high_resolution_clock::now();
+        for (auto& vframe : vframes) {
+            vframe->trace.stamps[FrameTrace::InferEnd] = endTime;
+        }
+        const float latency = std::chrono::duration<float, std::milli>(endTime - startTime).count();
+        const float prevLatency = device.avgBatchLatency;
+        device.avgBatchLatency = prevLatency > 0.0f ? 0.9f * prevLatency + 0.1f * latency : latency;
+        ++device.inferredBatches;
+        device.busyNSec += toNSec(endTime - startTime);
+
         auto detections = postprocessing(req, outputDataBlobNames, frameSize);
-        for (decltype(detections.size()) i = 0; i < detections.size(); i ++) {
+        // a partially filled batch has fewer frames than detection slots
+        for (decltype(detections.size()) i = 0; i < std::min(detections.size(), vframes.size()); i ++) {
             vframes[i]->detections = std::move(detections[i]);
         }
+        const auto postprocessTime = std::chrono::high_resolution_clock::now();
+        for (auto& vframe : vframes) {
+            vframe->trace.stamps[FrameTrace::Postprocess] = postprocessTime;
+        }
         if (perfTimerInfer.enabled()) {
-            auto endTime = std::chrono::high_resolution_clock::now();
-            perfTimerInfer.addValue(endTime - startTime);
+            perfTimerInfer.addValue(postprocessTime - startTime);
         }
+        postprocessNSec += toNSec(postprocessTime - postprocessStart);
+        inferredFramesCount += vframes.size();
     }
 
     if (nullptr != req) {
-        std::unique_lock<std::mutex> lock(mtxAvalableRequests);
-        availableRequests.push(std::move(req));
-        lock.unlock();
-        condVarAvailableRequests.notify_one();
+        auto pushed = device.availableRequests->tryPush(std::move(req));
+        assert(pushed);  // there are never more than maxRequests requests
+        (void)pushed;
     }
 
     return vframes;
@@ -260,38 +763,72 @@ void IEGraph::setDetectionConfidence(float conf) {
 
 IEGraph::~IEGraph() {
     terminate = true;
+    if (getterThread.joinable()) {
+        getterThread.join();
+    }
+    notifyBatches();
+    for (auto& thread : postprocessThreads) {
+        thread.join();
+    }
     {
-        std::unique_lock<std::mutex> lock(mtxAvalableRequests);
-        bool ready = false;
-        while (!ready) {
-            std::unique_lock<std::mutex> lock(mtxBusyRequests);
-            if (!busyBatchRequests.empty()) {
-                auto& req = busyBatchRequests.front().req;
-                if (nullptr != req) {
-                    req->Wait(InferenceEngine::IInferRequest::WaitMode::RESULT_READY);
-                    availableRequests.push(std::move(req));
-                }
-                busyBatchRequests.pop();
-            }
-            if (availableRequests.size() == maxRequests) {
-                ready = true;
+        // the getter thread is gone, so no request is started anymore and the callbacks of the running ones
+        // are the last users of the batches
+        std::unique_lock<std::mutex> lock(batchesMutex);
+        batchesChanged.wait(lock, [this]() { return 0 == inFlightCount; });
+    }
+    if (printPerfReport) {
+        slog::info << "Performance counts report" << slog::endl << slog::endl;
+        for (auto& device : devices) {
+            if (!device->requests.empty()) {
+                ::printPerformanceCounts(*device->requests.front(), std::cout,
+                                         getFullDeviceName(ie, device->name), false);
             }
         }
-        if (printPerfReport) {
-            slog::info << "Performance counts report" << slog::endl << slog::endl;
-            printPerformanceCounts(getFullDeviceName(ie, deviceName));
-        }
-        condVarAvailableRequests.notify_one();
-    }
-    if (getterThread.joinable()) {
-        getterThread.join();
     }
 }
 
 IEGraph::Stats IEGraph::getStats() const {
-    return Stats{perfTimerPreprocess.getValue(), perfTimerInfer.getValue()};
+    const std::size_t fedFrames = fedFramesCount;
+    const float copiesPerFrame = fedFrames > 0 ?
+        static_cast<float>(frameCopiesCount) / static_cast<float>(fedFrames) : 0.0f;
+    const std::size_t batches = batchesCount;
+    const float batchFillRatio = batches > 0 ?
+        static_cast<float>(fedFrames) / static_cast<float>(batches * batchSize) : 0.0f;
+    const auto inferTimeStats = perfTimerInfer.getStats();
+    Stats stats{perfTimerPreprocess.getValue(), inferTimeStats.mean, inferTimeStats,
+                copiesPerFrame, batchFillRatio, {}, {}, 0, 0, {}, {}, 0.0f, 0.0f, 0.0f, 0.0f};
+    const std::uint64_t elapsedNSec = getter != nullptr ?
+        toNSec(std::chrono::high_resolution_clock::now() - startTime) : 0;
+    auto share = [elapsedNSec](std::uint64_t busyNSec) {
+        return elapsedNSec > 0 ? static_cast<float>(static_cast<double>(busyNSec) / elapsedNSec) : 0.0f;
+    };
+    std::size_t totalBatches = 0;
+    for (auto& device : devices) {
+        totalBatches += device->inferredBatches;
+    }
+    for (auto& device : devices) {
+        const float batchesShare = totalBatches > 0 ?
+            static_cast<float>(device->inferredBatches) / static_cast<float>(totalBatches) : 0.0f;
+        const std::uint64_t requestsCount = device->requests.size();
+        const float occupancy = requestsCount > 0 ? share(device->busyNSec / requestsCount) : 0.0f;
+        stats.devices.push_back({device->name, device->avgBatchLatency, batchesShare, occupancy});
+    }
+    stats.droppedFrames = droppedFrames.get();
+    stats.inferredFrames = inferredFramesCount;
+    stats.skippedFrames = skippedFramesCount;
+    stats.channelFrames = channelFrames.get();
+    for (std::size_t frames : stats.channelFrames) {
+        stats.channelFps.push_back(elapsedNSec > 0 ? static_cast<float>(frames * 1e9 / elapsedNSec) : 0.0f);
+    }
+    stats.elapsedTime = static_cast<float>(elapsedNSec / 1e6);
+    stats.inputWaitShare = share(inputWaitNSec);
+    stats.preprocessShare = share(preprocessNSec);
+    stats.postprocessShare = share(postprocessNSec);
+    return stats;
 }
 
 void IEGraph::printPerformanceCounts(std::string fullDeviceName) {
-    ::printPerformanceCounts(*availableRequests.front(), std::cout, fullDeviceName, false);
+    if (!requests.empty()) {
+        ::printPerformanceCounts(*requests.front(), std::cout, fullDeviceName, false);
+    }
 }
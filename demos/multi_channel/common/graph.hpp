@@ -6,12 +6,14 @@
 
 #include <vector>
 #include <chrono>
-#include <queue>
-#include <mutex>
 #include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
 #include <thread>
 #include <functional>
 #include <atomic>
+#include <cstdint>
 #include <string>
 #include <memory>
 
@@ -26,7 +28,10 @@
 #include <samples/common.hpp>
 #include <samples/slog.hpp>
 #include "perf_timer.hpp"
+#include "backpressure.hpp"
+#include "frame_pool.hpp"
 #include "input.hpp"
+#include "ring_buffer.hpp"
 
 void loadImageToIEGraph(cv::Mat img, void* ie_buffer);
 
@@ -44,6 +49,7 @@ private:
     std::string modelPath;
     std::string cpuExtensionPath;
     std::string cldnnConfigPath;
+    std::string cacheDir;
 
     std::string inputDataBlobName;
     std::vector<std::string> outputDataBlobNames;
@@ -51,24 +57,101 @@ private:
     bool printPerfReport;
     std::string deviceName;
 
-    InferenceEngine::Core ie;
-    std::queue<InferenceEngine::InferRequest::Ptr> availableRequests;
+    bool u8Input;
+    bool zeroCopy;
+
+    // input blobs allocated by the plugin, frames wrapped in zero copy mode are set on top of them
+    std::map<InferenceEngine::InferRequest*, InferenceEngine::Blob::Ptr> requestInputBlobs;
+    std::atomic<std::size_t> fedFramesCount = {0};
+    std::atomic<std::size_t> frameCopiesCount = {0};
+
+    std::chrono::milliseconds batchTimeout;
+    bool dynamicBatch = false;
+    std::atomic<std::size_t> batchesCount = {0};
+
+    InferenceEngine::Core& ie;  // of the process, see SharedInference
+    std::vector<InferenceEngine::InferRequest::Ptr> requests;
+
+    // every device gets its own executable network and request pool
+    struct DeviceContext {
+        std::string name;
+        std::shared_ptr<InferenceEngine::ExecutableNetwork> network;  // may be shared with other graphs
+        std::vector<InferenceEngine::InferRequest::Ptr> requests;
+        std::unique_ptr<RingBuffer<InferenceEngine::InferRequest::Ptr>> availableRequests;
+        InferenceEngine::RemoteContext::Ptr remoteContext;
+        std::atomic<float> avgBatchLatency = {0.0f};  // msec, exponential moving average
+        std::atomic<std::size_t> inferredBatches = {0};
+        std::atomic<std::uint64_t> busyNSec = {0};  // summed time the requests were in flight
+    };
+    std::vector<std::unique_ptr<DeviceContext>> devices;
 
     struct BatchRequestDesc {
         std::vector<std::shared_ptr<VideoFrame>> vfPtrVec;
+        std::vector<std::size_t> frameSeqs;  // the order of the frames within their channels
         InferenceEngine::InferRequest::Ptr req;
         std::chrono::high_resolution_clock::time_point startTime;
+        std::chrono::high_resolution_clock::time_point endTime;  // set by the completion callback
+        std::size_t deviceIdx = 0;
+    };
+    // the completion callback of a request moves its batch to completedBatches, so a batch is postprocessed
+    // once it is inferred rather than after the batches started before it on slower requests or devices
+    std::map<InferenceEngine::InferRequest*, BatchRequestDesc> inFlightBatches;
+    std::deque<BatchRequestDesc> completedBatches;
+    std::size_t inFlightCount = 0;
+
+    // the frames are returned in order within a channel only, a frame waits just for the earlier frames of
+    // its own channel
+    struct ChannelOrder {
+        std::size_t nextSeq = 0;
+        std::map<std::size_t, std::shared_ptr<VideoFrame>> pending;
+        Detections lastDetections;  // for the frames skipped as unchanged
     };
-    std::queue<BatchRequestDesc> busyBatchRequests;
+    std::map<std::size_t, std::size_t> channelSeqs;  // the next seq by sourceIdx, of the getter thread
+    std::map<std::size_t, ChannelOrder> channelOrders;
+    std::vector<std::shared_ptr<VideoFrame>> orderedFrames;  // ready for getBatchData
+    std::atomic<std::size_t> sequencedFrames = {0};
+    std::atomic<std::size_t> deliveredFrames = {0};
+
+    std::size_t postprocessThreadsCount = 0;
+    std::vector<std::thread> postprocessThreads;
+    cv::Size postprocessFrameSize;  // of the last getBatchData call
+    std::mutex batchesMutex;  // of the members above
+    std::condition_variable batchesChanged;
 
     std::size_t maxRequests = 0;
+    bool autoThroughput = false;
+    std::size_t numChannels = 0;
+
+    OverflowPolicy overflowPolicy;
+    DropCounters droppedFrames;
+    DropCounters channelFrames;  // returned by getBatchData, not dropped
+
+    // frames decoded to VA surfaces are fed to GPU networks loaded on a shared VA context
+    bool remoteSurfaces = false;
+    bool remoteNetworksLoaded = false;
+
+    std::size_t warmupRuns = 1;
+    bool arenaBlobs = false;
+    std::size_t cpuThreads = 0;
+
+    // the getter fills pooled frames, so the frames in flight are recycled rather than allocated per frame
+    VideoFramePool framePool;
+
+    InferenceEngine::CNNNetwork cnnNetwork;
+    std::map<std::string, std::string> loadConfig;
+    InferenceEngine::SizeVector inputDims;
+
+    // stage busy times since start(), for the utilization stats
+    std::chrono::high_resolution_clock::time_point startTime;
+    std::atomic<std::uint64_t> inputWaitNSec = {0};
+    std::atomic<std::uint64_t> preprocessNSec = {0};
+    std::atomic<std::uint64_t> postprocessNSec = {0};
+    std::atomic<std::size_t> inferredFramesCount = {0};
+    std::atomic<std::size_t> skippedFramesCount = {0};
 
     std::atomic_bool terminate = {false};
-    std::mutex mtxAvalableRequests;
-    std::mutex mtxBusyRequests;
-    std::condition_variable condVarAvailableRequests;
-    std::condition_variable condVarBusyRequests;
 
+    // returns false when the input is over, a frame may be left empty when its channel has nothing ready
     using GetterFunc = std::function<bool(VideoFrame&)>;
     GetterFunc getter;
     using PostprocessingFunc = std::function<std::vector<Detections>(InferenceEngine::InferRequest::Ptr, const std::vector<std::string>&, cv::Size)>;
@@ -78,6 +161,23 @@ private:
     std::thread getterThread;
 
     void initNetwork(const std::string& deviceName);
+    void configureThroughput(const std::vector<std::string>& deviceNames);
+    void createRequests(DeviceContext& device, std::size_t poolSize);
+    void warmUp();
+#ifdef USE_LIBVA
+    void loadRemoteNetworks(void* vaDisplay);
+#endif
+    void startBatch(BatchRequestDesc&& desc);
+    void onBatchInferred(InferenceEngine::InferRequest* req);
+    bool acquireRequest(InferenceEngine::InferRequest::Ptr& req, std::size_t& deviceIdx, bool wait);
+    std::vector<std::shared_ptr<VideoFrame>> completeBatch(BatchRequestDesc& desc, cv::Size frameSize);
+    void orderFrames(std::vector<std::shared_ptr<VideoFrame>>&& vframes, const std::vector<std::size_t>& frameSeqs,
+                     bool dropped = false);
+    bool canDeliverMore() const;
+    void skipFrame(std::shared_ptr<VideoFrame> vframe);
+    bool allFramesDelivered() const;
+    void postprocessBatches();
+    void notifyBatches();
 
 public:
     struct InitParams {
@@ -88,8 +188,47 @@ public:
         std::string modelPath;
         std::string cpuExtPath;
         std::string cldnnConfigPath;
+        // Directory to cache compiled networks in, empty - no cache. Not used with remoteSurfaces
+        std::string cacheDir;
+        // A comma separated list like "CPU,GPU,MYRIAD.1" creates a request pool of maxRequests
+        // on every device, HETERO: and MULTI: device names are passed to the plugin as is
         std::string deviceName;
         PostLoadFunc postLoadFunc = nullptr;
+        // Declare the network input as U8/NHWC so the plugin does the layout and precision
+        // conversion, frames are then resized directly into the input blob memory
+        bool u8Input = false;
+        // Wrap decoded frames into input blobs without copying when they already have the network
+        // input size, implies u8Input. Only applies to batch size 1
+        bool zeroCopy = false;
+        // Infer a partially filled batch when it is not complete this long after its first frame,
+        // 0 - always wait for a full batch
+        std::size_t batchTimeoutMSec = 0;
+        // Configure CPU/GPU throughput streams from the core and channel count and size every
+        // request pool by the OPTIMAL_NUMBER_OF_INFER_REQUESTS metric, maxRequests is ignored
+        bool autoThroughput = false;
+        // Number of input channels the streams are sized for, 0 - let the plugin decide
+        std::size_t numChannels = 0;
+        // What to do with a collected batch when all infer requests are busy, both drop policies
+        // discard the batch since running requests can not be preempted. Drops are counted per
+        // VideoFrame::sourceIdx below numChannels
+        OverflowPolicy overflowPolicy = OverflowPolicy::Block;
+        // Feed VideoFrame::surface to the GPU plugin as remote NV12 blobs, so decoded frames stay
+        // in video memory. Requires a hardware decoding build, GPU devices only and batch size 1,
+        // maxRequests and the network are created on the first frame. Frames without a surface are dropped
+        bool remoteSurfaces = false;
+        // Threads running the postprocessing function on the inferred batches, so it overlaps the consumer of
+        // getBatchData and the batches are postprocessed in parallel, the function must be thread safe then.
+        // getBatchData still returns the frames of a channel in order. 0 - getBatchData postprocesses the batches
+        std::size_t postprocessThreads = 0;
+        // Inferences of every request of every device before the first frame, 0 - no warm up
+        std::size_t warmupRuns = 1;
+        // Allocate the input blobs of the requests from the hugepage arena instead of letting the plugin
+        // allocate them, not used with remoteSurfaces
+        bool arenaBlobs = false;
+        // CPU_THREADS_NUM of the CPU plugin, the inference share of ThreadPolicy, so the plugin streams leave the
+        // rest of the cores to OpenCV and the pipeline threads. Ignored with the CPU budget of SharedInference,
+        // 0 - the plugin default, half of the logical cores with autoThroughput
+        std::size_t cpuThreads = 0;
     };
 
     explicit IEGraph(const InitParams& p);
@@ -111,6 +250,27 @@ public:
     struct Stats {
         float preprocessTime;
         float inferTime;
+        PerfTimer::Stats inferTimeStats;  // distribution of inferTime
+        float copiesPerFrame;  // average number of frame copies between the decoder and the plugin
+        float batchFillRatio;  // average share of batch slots filled with frames
+        struct Device {
+            std::string name;
+            float inferTime;     // average batch latency
+            float batchesShare;  // share of all batches run on the device
+            float occupancy;     // average share of the device requests in flight
+        };
+        std::vector<Device> devices;
+        std::vector<std::size_t> droppedFrames;  // per channel
+        std::size_t inferredFrames;  // frames returned by getBatchData with their results
+        std::size_t skippedFrames;   // unchanged frames returned with the previous results of their channels
+        std::vector<std::size_t> channelFrames;  // per channel, frames returned by getBatchData
+        std::vector<float> channelFps;           // per channel, the same per second of the elapsed time
+        float elapsedTime;           // msec since start()
+        // shares of the elapsed time the getter thread waited for frames and preprocessed them,
+        // and the batches spent in postprocessing, it is summed over the postprocessing threads
+        float inputWaitShare;
+        float preprocessShare;
+        float postprocessShare;
     };
 
     Stats getStats() const;
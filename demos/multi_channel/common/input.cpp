@@ -4,17 +4,33 @@
 
 #include "input.hpp"
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
 #include <memory>
+#include <mutex>
 #include <numeric>
 #include <queue>
+#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <thread>
 #include <utility>
+#include <vector>
+
+#include <samples/capture_recording.hpp>
+#include <samples/instrumentation.hpp>
+#include <samples/slog.hpp>
 
 #include "perf_timer.hpp"
 
 #include "decoder.hpp"
+#include "placement.hpp"
+#include "ring_buffer.hpp"
 #include "threading.hpp"
 
 #ifdef USE_NATIVE_CAMERA_API
@@ -32,6 +48,142 @@
 #include <sys/stat.h>
 #endif
 
+/**
+* \brief Fixed pool of capture threads multiplexing the sources, so the number of threads does not grow with
+* the number of channels. A source is a task capturing one frame per step, it goes back to the end of the ready
+* queue while its frame queue has space, so the sources take turns, and a task blocked on its full queue is
+* parked until the reader re-arms it
+*/
+class CaptureScheduler final {
+public:
+    class Task {
+    public:
+        enum class Status {
+            Ready,    // run the next step
+            Blocked,  // the step can not continue until rearm()
+            Finished  // never run again
+        };
+
+        virtual ~Task() = default;
+        virtual Status step() = 0;
+        // called instead of running the next step when a step throws, the task must end its readers' wait
+        virtual void fail() = 0;
+
+    private:
+        friend CaptureScheduler;
+        enum class State { Idle, Queued, Running, Blocked };
+        State state = State::Idle;  // guarded by the scheduler mutex
+        bool rearmed = false;  // rearm() came while running
+        bool removed = false;
+    };
+
+    CaptureScheduler(std::size_t threadsCount, std::vector<unsigned> cpus) {
+        for (std::size_t i = 0; i < std::max<std::size_t>(1, threadsCount); ++i) {
+            threads.emplace_back([this, cpus]() {
+                instrumentation::registerCurrentThread("video input");
+                pinCurrentThread(cpus);  // frames are allocated on the node of the capture threads
+                run();
+            });
+        }
+    }
+
+    CaptureScheduler(const CaptureScheduler&) = delete;
+    CaptureScheduler& operator =(const CaptureScheduler&) = delete;
+
+    ~CaptureScheduler() {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            terminate = true;
+        }
+        changed.notify_all();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    void add(Task& task) {
+        std::unique_lock<std::mutex> lock(mutex);
+        task.removed = false;
+        task.rearmed = false;
+        queue(task);
+    }
+
+    /**
+    * \brief Queues the blocked task again, e.g. once its frame queue has space
+    */
+    void rearm(Task& task) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (Task::State::Blocked == task.state) {
+            queue(task);
+        } else if (Task::State::Running == task.state) {
+            task.rearmed = true;  // the step may be about to block on the space just freed
+        }
+    }
+
+    /**
+    * \brief Waits for the running step of the task, the task is not run after it
+    */
+    void remove(Task& task) {
+        std::unique_lock<std::mutex> lock(mutex);
+        task.removed = true;
+        if (Task::State::Queued == task.state) {
+            ready.erase(std::find(ready.begin(), ready.end(), &task));
+            task.state = Task::State::Idle;
+        }
+        changed.wait(lock, [&task]() { return Task::State::Running != task.state; });
+        task.state = Task::State::Idle;
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<Task*> ready;
+    bool terminate = false;
+    std::vector<std::thread> threads;
+
+    void queue(Task& task) {
+        task.state = Task::State::Queued;
+        ready.push_back(&task);
+        changed.notify_all();
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            changed.wait(lock, [this]() { return !ready.empty() || terminate; });
+            if (terminate) {
+                return;
+            }
+            Task& task = *ready.front();
+            ready.pop_front();
+            task.state = Task::State::Running;
+            task.rearmed = false;
+            lock.unlock();
+
+            Task::Status status = Task::Status::Finished;
+            try {
+                status = task.step();
+            } catch (const std::exception& e) {
+                slog::err << "Video input failed: " << e.what() << slog::endl;
+                task.fail();
+            } catch (...) {
+                slog::err << "Video input failed" << slog::endl;
+                task.fail();
+            }
+
+            lock.lock();
+            if (task.removed || Task::Status::Finished == status) {
+                task.state = Task::State::Idle;
+                changed.notify_all();  // remove() may wait for the step
+            } else if (Task::Status::Ready == status || task.rearmed) {
+                queue(task);
+            } else {
+                task.state = Task::State::Blocked;
+            }
+        }
+    }
+};
+
 class VideoSource {
 public:
     virtual bool isRunning() const = 0;
@@ -42,13 +194,27 @@ public:
 
     virtual float getAvgReadTime() const = 0;
 
+    virtual std::size_t getDroppedFrames() const = 0;
+
+    // msec from capture by the driver until the frame is dequeued, 0 when unknown
+    virtual float getCaptureLatency() const = 0;
+
     virtual ~VideoSource();
 };
 
 VideoSource::~VideoSource() {}
 
+struct DecodedFrame {
+    RawImage raw;  // set when the camera frame needs no decoding
+    cv::Mat frame;
+    Decoder::HwSurface surface;  // set when the hardware decoder keeps the frame in video memory
+    FrameTrace trace;  // empty for the sources stamping the frames when they are read
+};
+
 #ifdef USE_LIBVA
 
+// a file of concatenated JPEGs mapped into memory, the decoder reads the frames in place. The frames are
+// indexed once, so replaying the file for load tests scans nothing and a frame is seeked to directly
 struct VideoStream {
     struct frame_t {
         void* ptr;
@@ -61,15 +227,16 @@ struct VideoStream {
     std::unique_ptr<void, std::function<void(void*)>> ptr;
     size_t length;
 
-    size_t frame_offset;
-    size_t next_frame_offset;
+    std::vector<frame_t> frames;  // in file order
+    size_t next_frame = 0;
+    const bool loop;
 
     mcam::file_descriptor fd;
 
     using stream_t = unsigned char;
 
-    explicit VideoStream(const std::string& filepath)
-        : ptr(0, [](void*){}), fd(open(filepath.c_str(), O_RDONLY)) {
+    VideoStream(const std::string& filepath, bool loop_)
+        : ptr(0, [](void*){}), loop(loop_), fd(open(filepath.c_str(), O_RDONLY)) {
         struct stat sb;
         if (!fd.valid())
             throw std::runtime_error(std::string("Cannot open input file: ") + std::string(strerror(errno)));
@@ -82,68 +249,90 @@ struct VideoStream {
 
         auto l = sb.st_size;
         ptr = std::unique_ptr<void, std::function<void(void*)>>(p, [l](void* _p) { munmap(_p, l); });
+        // the whole file is replayed, keep it resident rather than reading it ahead page by page
+        madvise(p, length, MADV_WILLNEED);
 
+        index_frames();
+        if (frames.empty())
+            throw std::runtime_error("No JPEG frames in input file: " + filepath);
         advance_frame();
     }
 
     VideoStream (const VideoStream&) = delete;
     VideoStream (VideoStream&&) = delete;
 
-    void update_frame_dims() {
-        auto p = static_cast<stream_t*>(frame.ptr);
-        size_t header_offset = 0;
-        bool is_marker_found = false;
-        while (header_offset < frame.length && !is_marker_found) {
-            if (p[header_offset] == static_cast<stream_t>(0xFF) &&
-                p[header_offset + 1] == static_cast<stream_t>(0xC0))
-                is_marker_found = true;
-            else
-                header_offset++;
-        }
-        if (is_marker_found) {
-            size_t offset = header_offset;
-            offset += 2;  // skip header marker
-            offset += 2;  // skip header size
-            offset += 1;  // skip precision
-            frame.height = p[offset + 0] * 256 + p[offset + 1];
-            frame.width = p[offset + 2] * 256 + p[offset + 3];
-        } else {
-            assert(false);
+    // offset of the next marker of the type at or after begin, length if there is none. 0xFF is stuffed
+    // with a zero in the entropy coded data, so the markers are found without parsing it
+    size_t find_marker(size_t begin, stream_t type) const {
+        auto p = static_cast<const stream_t*>(ptr.get());
+        for (size_t offset = begin; offset + 1 < length;) {
+            auto found = static_cast<const stream_t*>(memchr(p + offset, 0xFF, length - offset - 1));
+            if (nullptr == found)
+                break;
+            offset = static_cast<size_t>(found - p);
+            if (p[offset + 1] == type)
+                return offset;
+            offset++;
         }
+        return length;
     }
 
-    void advance_frame() {
-        // Loop
-        if (next_frame_offset >= length) {
-            next_frame_offset = 0;
+    bool read_frame_dims(frame_t& f) const {
+        auto p = static_cast<const stream_t*>(f.ptr);
+        for (size_t header_offset = 0; header_offset + 8 < f.length; header_offset++) {
+            if (p[header_offset] == static_cast<stream_t>(0xFF) &&
+                p[header_offset + 1] == static_cast<stream_t>(0xC0)) {
+                size_t offset = header_offset;
+                offset += 2;  // skip header marker
+                offset += 2;  // skip header size
+                offset += 1;  // skip precision
+                f.height = p[offset + 0] * 256 + p[offset + 1];
+                f.width = p[offset + 2] * 256 + p[offset + 3];
+                return f.width > 0 && f.height > 0;
+            }
         }
+        return false;
+    }
 
-        frame_offset = next_frame_offset;
+    void index_frames() {
         auto p = static_cast<stream_t*>(ptr.get());
-        while (next_frame_offset < length) {
-            if (p[next_frame_offset] == static_cast<stream_t>(0xFF) &&
-                p[next_frame_offset + 1] == static_cast<stream_t>(0xD9) )
-                break;
-            else
-                next_frame_offset++;
+        size_t offset = 0;
+        while (offset < length) {
+            const size_t soi = find_marker(offset, 0xD8);
+            const size_t eoi = find_marker(soi + 2, 0xD9);
+            if (eoi >= length)
+                break;  // a truncated last frame
+            frame_t f = {p + soi, soi, eoi + 2 - soi, 0, 0};
+            if (read_frame_dims(f))
+                frames.push_back(f);  // not baseline otherwise, the hardware decoder can not decode it
+            offset = eoi + 2;
         }
-        next_frame_offset += 2;
-        frame.length = next_frame_offset - frame_offset;
-        frame.ptr = &(p[frame_offset]);
-        update_frame_dims();
+    }
+
+    // returns false at the end of the file when not looping
+    bool advance_frame() {
+        if (next_frame >= frames.size()) {
+            if (!loop)
+                return false;
+            next_frame = 0;
+        }
+        frame = frames[next_frame++];
+        return true;
     }
 };
 
 class VideoSourceStreamFile : public VideoSource {
-    using queue_elem_t = std::pair<bool, cv::Mat>;
+    using queue_elem_t = std::pair<bool, DecodedFrame>;
     using queue_t = std::queue<queue_elem_t>;
 
     VideoSources& parent;
+    const std::size_t channel;  // the index of the input, routes its frames in the adaptive decoding
 
     VideoStream stream;
 
     std::atomic_bool running = {false};
     std::atomic_bool is_decoding = {false};
+    bool ended = false;  // the last frame of the file is decoded, guarded by mutex
 
     std::mutex mutex;
     std::thread workThread;
@@ -152,6 +341,7 @@ class VideoSourceStreamFile : public VideoSource {
 
     queue_t frameQueue;
     const std::size_t queueSize;
+    const std::vector<unsigned> cpus;
 
     using clock = std::chrono::high_resolution_clock;
     clock::time_point lastFrameTime;
@@ -159,15 +349,20 @@ class VideoSourceStreamFile : public VideoSource {
 
 public:
     VideoSourceStreamFile(VideoSources& p,
+                          std::size_t channel_,
                           bool async,
                           bool collectStats_,
                           const std::string& name,
                           size_t queueSize_,
                           size_t pollingTimeMSec_,
-                          bool realFps_):
+                          bool realFps_,
+                          bool loopVideo,
+                          std::vector<unsigned> cpus_):
         parent(p),
-        stream(name),
+        channel(channel_),
+        stream(name, loopVideo),
         queueSize(queueSize_),
+        cpus(std::move(cpus_)),
         perfTimer(collectStats_ ? PerfTimer::DefaultIterationsCount : 0) { }
 
     bool isRunning() const override {
@@ -177,6 +372,9 @@ public:
     void start() {
         running = true;
         workThread = std::thread([&]() {
+            instrumentation::registerCurrentThread("camera input");
+            pinCurrentThread(cpus);
+            bool more = true;
             while (running) {
                 {
                     cv::Mat frame;
@@ -184,10 +382,12 @@ public:
                         is_decoding = true;
                         std::unique_lock<std::mutex> lock(parent.decode_mutex);
 
-                        parent.decoder.decode(stream.frame.ptr, stream.frame.length, stream.frame.width, stream.frame.height,
-                            [this](cv::Mat&& img) mutable {
-                            bool success = !img.empty();
-                            frameQueue.push({success, std::move(img)});
+                        auto onDecoded = [this](bool success, DecodedFrame&& decoded) {
+                            {
+                                // the callback runs on the decoder thread
+                                std::unique_lock<std::mutex> queueLock(mutex);
+                                frameQueue.push({success, std::move(decoded)});
+                            }
                             if (perfTimer.enabled()) {
                                 auto prev = lastFrameTime;
                                 auto current = clock::now();
@@ -199,16 +399,37 @@ public:
                             }
                             is_decoding = false;
                             condVar.notify_one();
-                        });
-                        stream.advance_frame();
+                        };
+                        if (parent.hwSurfaces) {
+                            parent.decoder.decode_surface(stream.frame.ptr, stream.frame.length,
+                                                          stream.frame.width, stream.frame.height,
+                                [onDecoded](Decoder::HwSurface&& surface) mutable {
+                                DecodedFrame decoded;
+                                decoded.surface = std::move(surface);
+                                onDecoded(true, std::move(decoded));
+                            });
+                        } else {
+                            parent.decoder.decode(channel, stream.frame.ptr, stream.frame.length,
+                                                  stream.frame.width, stream.frame.height,
+                                [onDecoded](cv::Mat&& img) mutable {
+                                DecodedFrame decoded;
+                                decoded.frame = std::move(img);
+                                onDecoded(!decoded.frame.empty(), std::move(decoded));
+                            });
+                        }
+                        more = stream.advance_frame();
                     }
 
                     std::unique_lock<std::mutex> lock(mutex);
                     condVar.wait(lock, [&]() {
                         return !is_decoding && (frameQueue.size() < queueSize || !running);
                     });
+                    ended = !more;
                 }
                 hasFrame.notify_one();
+                if (!more) {
+                    break;
+                }
             }
         });
     }
@@ -230,13 +451,17 @@ public:
         {
             std::unique_lock<std::mutex> lock(mutex);
             hasFrame.wait(lock, [&]() {
-                return !frameQueue.empty() || !running;
+                return !frameQueue.empty() || ended || !running;
             });
+            if (frameQueue.empty()) {
+                running = running && !ended;
+                return false;
+            }
             elem = std::move(frameQueue.front());
             frameQueue.pop();
         }
         condVar.notify_one();
-        frame.frame = std::move(elem.second);
+        parent.setFrame(frame, std::move(elem.second));
 
         return elem.first && running;
     }
@@ -244,39 +469,72 @@ public:
     float getAvgReadTime() const {
         return perfTimer.getValue();
     }
+
+    std::size_t getDroppedFrames() const {
+        return 0;  // the decoding thread always waits for the queue
+    }
+
+    float getCaptureLatency() const {
+        return 0.0f;
+    }
 };
 
 #endif
 
-class VideoSourceOCV : public VideoSource {
+class VideoSourceOCV : public VideoSource, CaptureScheduler::Task {
     PerfTimer perfTimer;
-    std::thread workThread;
+    CaptureScheduler* scheduler;  // runs the capture steps of async sources
     const bool isAsync;
     std::atomic_bool running = {true};
     std::string videoName;
-
-    std::mutex mutex;
-    std::condition_variable condVar;
-    std::condition_variable hasFrame;
-    std::queue<std::pair<bool, cv::Mat>> queue;
+    std::string pipeline;  // GStreamer pipeline decoding videoName, empty - opened directly
 
     cv::VideoCapture source;
+    std::unique_ptr<CaptureReplayer> replayer;  // reads a recording instead of source when set
     bool loopVideo;
 
     bool realFps;
 
     const size_t queueSize = 1;
     const size_t pollingTimeMSec = 1000;
+    const std::chrono::milliseconds readTimeout;
+    const OverflowPolicy overflowPolicy;
+    std::atomic<std::size_t> droppedFrames = {0};
+
+    struct CapturedFrame {
+        cv::Mat frame;
+        FrameTrace trace;
+    };
+    using queue_elem_t = std::pair<bool, CapturedFrame>;
+    RingBuffer<queue_elem_t> queue;
+    queue_elem_t lastElem;  // repeated when frames caching is on and no new frame is ready
+    queue_elem_t pendingElem;  // captured, waits for space in the queue
+    bool pending = false;
+    std::vector<queue_elem_t> dropped;
 
     template<bool CollectStats>
     bool readFrame(cv::Mat& frame);
+    bool readSource(cv::Mat& frame) {
+        DEMO_TASK("decode");
+        return replayer ? replayer->read(frame) : source.read(frame);
+    }
+    bool rewind();
 
-    template<bool CollectStats>
-    void startImpl();
+    Status step() override;
+    void fail() override {
+        running = false;  // the readers waiting for a frame check it and return the end of the input
+    }
+    void rearm() {
+        if (OverflowPolicy::Block == overflowPolicy) {
+            scheduler->rearm(*this);  // the queue has space for the pending frame
+        }
+    }
 
 public:
     VideoSourceOCV(bool async, bool collectStats_, const std::string& name, bool loopVideo,
-                size_t queueSize_, size_t pollingTimeMSec_, bool realFps_);
+                size_t queueSize_, size_t pollingTimeMSec_, bool realFps_, size_t readTimeoutMSec_,
+                OverflowPolicy overflowPolicy_, CaptureScheduler* scheduler_, std::string pipeline_ = {},
+                std::unique_ptr<CaptureReplayer> replayer_ = nullptr);
 
     ~VideoSourceOCV();
 
@@ -286,22 +544,105 @@ public:
 
     void stop();
 
-    bool read(cv::Mat& frame);
     bool read(VideoFrame& frame);
 
     float getAvgReadTime() const {
         return perfTimer.getValue();
     }
 
-private:
-    template<bool CollectStats>
-    static void thread_fn(VideoSourceOCV*);
+    std::size_t getDroppedFrames() const {
+        return droppedFrames;
+    }
+
+    float getCaptureLatency() const {
+        return 0.0f;
+    }
+};
+
+/**
+* \brief A channel of a frame bus another process publishes. The frames are read in place from the
+* shared memory, nothing is captured or decoded here
+*/
+class VideoSourceBus : public VideoSource {
+    std::shared_ptr<FrameBusSubscriber> bus;
+    const std::size_t channel;
+    const bool realFps;
+    const std::chrono::milliseconds readTimeout;
+    const std::chrono::milliseconds pollingTime;
+    std::atomic_bool running = {false};
+
+    std::uint64_t lastSequence = 0;
+    cv::Mat lastFrame;  // repeated when frames caching is on and no new frame is published
+    std::shared_ptr<void> lastLease;
+
+public:
+    VideoSourceBus(std::shared_ptr<FrameBusSubscriber> bus_, std::size_t channel_, bool realFps_,
+                   std::size_t readTimeoutMSec, std::size_t pollingTimeMSec):
+        bus(std::move(bus_)), channel(channel_), realFps(realFps_), readTimeout(readTimeoutMSec),
+        pollingTime(std::max<std::size_t>(pollingTimeMSec, 1)) {
+        if (channel >= bus->getChannelsCount()) {
+            throw std::invalid_argument("The frame bus has " + std::to_string(bus->getChannelsCount()) +
+                                        " channels, there is no channel " + std::to_string(channel));
+        }
+    }
+
+    void start() override {
+        running = true;
+    }
+
+    bool isRunning() const override {
+        return running;
+    }
+
+    bool read(VideoFrame& frame) override {
+        cv::Mat newFrame;
+        std::shared_ptr<void> newLease;
+        bool published = true;
+        if (realFps || lastFrame.empty()) {
+            using clock = std::chrono::steady_clock;
+            const auto deadline = clock::now() + readTimeout;
+            // waits in steps, so a stopped source or a timeout is noticed while the publisher is silent
+            while (!bus->read(channel, lastSequence, newFrame, newLease, pollingTime)) {
+                if (!running) {
+                    return false;
+                }
+                if (readTimeout.count() > 0 && clock::now() >= deadline) {
+                    frame.frame = cv::Mat();  // no frame in time, the publisher may still be alive
+                    frame.busLease.reset();
+                    return true;
+                }
+            }
+        } else {
+            published = bus->read(channel, lastSequence, newFrame, newLease, std::chrono::milliseconds(0));
+        }
+        if (published) {  // the frames the bus copies have no lease
+            lastFrame = newFrame;
+            lastLease = std::move(newLease);
+        }
+        frame.frame = lastFrame;
+        frame.busLease = lastLease;
+        frame.trace = FrameTrace();  // stamped when read, the publisher decoded the frame
+        return true;
+    }
+
+    float getAvgReadTime() const override {
+        return 0.0f;
+    }
+
+    std::size_t getDroppedFrames() const override {
+        return 0;
+    }
+
+    float getCaptureLatency() const override {
+        return 0.0f;
+    }
 };
 
 #ifdef USE_NATIVE_CAMERA_API
 class VideoSourceNative : public VideoSource {
     VideoSources& parent;
-    using queue_elem_t = std::pair<bool, cv::Mat>;
+    const std::size_t channel;  // the index of the input, routes its frames in the adaptive decoding
+    using queue_elem_t = std::pair<bool, DecodedFrame>;
 #ifdef USE_TBB
     using queue_t = tbb::concurrent_bounded_queue<queue_elem_t>;
 #else
@@ -309,7 +650,8 @@ class VideoSourceNative : public VideoSource {
 #endif
     const int queueSize = 0;
     const bool realFps = false;
-    cv::Mat dummyFrame;
+    std::atomic<std::size_t> droppedFrames = {0};
+    DecodedFrame dummyFrame;
     std::size_t frameIdx = 0;
     queue_t frameQueue;
     mcam::camera camera;
@@ -323,7 +665,7 @@ class VideoSourceNative : public VideoSource {
                       mcam::camera::frame frame);
 
 public:
-    VideoSourceNative(VideoSources& p, mcam::controller& ctrl,
+    VideoSourceNative(VideoSources& p, std::size_t channel, mcam::controller& ctrl,
            const std::string& source, const mcam::camera::settings& settings,
            size_t queueSize, bool realFps, bool collectStats);
 
@@ -338,13 +680,22 @@ public:
     float getAvgReadTime() const {
         return perfTimer.getValue();
     }
+
+    std::size_t getDroppedFrames() const {
+        return droppedFrames + camera.get_stats().dropped_buffers;
+    }
+
+    float getCaptureLatency() const {
+        return camera.get_stats().avg_dequeue_latency;
+    }
 };
 
 
-VideoSourceNative::VideoSourceNative(VideoSources& p, mcam::controller& ctrl,
+VideoSourceNative::VideoSourceNative(VideoSources& p, std::size_t channel, mcam::controller& ctrl,
        const std::string& source, const mcam::camera::settings& settings,
        size_t queueSize, bool realFps, bool collectStats):
     parent(p),
+    channel(channel),
     queueSize(static_cast<int>(queueSize)),
     realFps(realFps),
     camera(ctrl, source, [this](
@@ -373,21 +724,21 @@ void VideoSourceNative::frameHandler(mcam::camera::frame_status status,
                   mcam::camera::frame frame) {
     if (status == mcam::camera::frame_status::ok) {
         if (frameQueue.size() < queueSize) {
-            (void)settings;
-            assert(mcam::make_4cc('M', 'J', 'P', 'G') ==
-                   settings.format4cc);
             assert(frame.valid());
             auto data = frame.data();
             auto size = frame.size();
 
+            // the driver stamped the sensor readout, the frame is as old on the clock of the trace
+            FrameTrace trace;
+            const std::int64_t age = std::max<std::int64_t>(frame.age_us(), 0);  // unknown - the dequeue
+            trace.stamps[FrameTrace::Capture] = FrameTrace::clock::now() - std::chrono::microseconds(age);
+
             std::unique_lock<std::mutex> lock(parent.decode_mutex);
 
-            parent.decoder.decode(
-                        data, size, settings.width, settings.height,
-            [this, fr = std::move(frame)](cv::Mat&& img) mutable {
-                fr = {};
-                bool success = !img.empty();
-                frameQueue.push({success, std::move(img)});
+            auto onDecoded = [this, trace](bool success, DecodedFrame&& decoded) {
+                decoded.trace = trace;
+                decoded.trace.stamp(FrameTrace::Decode);
+                frameQueue.push({success, std::move(decoded)});
                 if (perfTimer.enabled()) {
                     auto prev = lastFrameTime;
                     auto current = clock::now();
@@ -398,7 +749,43 @@ void VideoSourceNative::frameHandler(mcam::camera::frame_status status,
 
                     lastFrameTime = current;
                 }
-            });
+            };
+            const bool yuyv = mcam::make_4cc('Y', 'U', 'Y', 'V') == settings.format4cc;
+            if (yuyv || mcam::make_4cc('N', 'V', '1', '2') == settings.format4cc) {
+                // no decoding, the capture buffer is converted straight into the network input
+                // and goes back to the driver once the frame is preprocessed
+                DecodedFrame decoded;
+                decoded.raw.format = yuyv ? RawImage::YUYV : RawImage::NV12;
+                decoded.raw.data = static_cast<const std::uint8_t*>(data);
+                decoded.raw.size = cv::Size(static_cast<int>(settings.width), static_cast<int>(settings.height));
+                decoded.raw.stride = settings.stride;
+                decoded.raw.holder = std::make_shared<mcam::camera::frame>(std::move(frame));
+                onDecoded(true, std::move(decoded));
+                return;
+            }
+            assert(mcam::make_4cc('M', 'J', 'P', 'G') == settings.format4cc);
+            // the decoder reads the capture buffer in place, it is reclaimed once decoded
+            if (parent.hwSurfaces) {
+                parent.decoder.decode_surface(
+                            data, size, settings.width, settings.height,
+                [onDecoded, fr = std::move(frame)](Decoder::HwSurface&& surface) mutable {
+                    fr = {};
+                    DecodedFrame decoded;
+                    decoded.surface = std::move(surface);
+                    onDecoded(true, std::move(decoded));
+                });
+            } else {
+                parent.decoder.decode(
+                            channel, data, size, settings.width, settings.height,
+                [onDecoded, fr = std::move(frame)](cv::Mat&& img) mutable {
+                    fr = {};
+                    DecodedFrame decoded;
+                    decoded.frame = std::move(img);
+                    onDecoded(!decoded.frame.empty(), std::move(decoded));
+                });
+            }
+        } else {
+            ++droppedFrames;  // camera frames can not be held back, so the newest ones are dropped
         }
     }
 }
@@ -424,11 +811,12 @@ bool VideoSourceNative::read(VideoFrame& frame) {
                 dummyFrame = elem.second;
             }
         } else {
-            elem.first = (!dummyFrame.empty());
+            elem.first = (!dummyFrame.frame.empty() || nullptr != dummyFrame.surface.holder ||
+                          !dummyFrame.raw.empty());
             elem.second = dummyFrame;
         }
     }
-    frame.frame = std::move(elem.second);
+    parent.setFrame(frame, std::move(elem.second));
     return elem.first;
 }
 #endif  // USE_NATIVE_CAMERA_API
@@ -437,23 +825,63 @@ namespace {
 bool isNumeric(const std::string& str) {
     return std::strspn(str.c_str(), "0123456789") == str.length();
 }
+
+bool hasExtension(const std::string& name, const std::string& extension) {
+    return name.size() > extension.size() && std::equal(extension.rbegin(), extension.rend(), name.rbegin());
+}
+
+/**
+* \brief Decodes H.264/H.265 on the GPU and scales frames to the network input size there.
+* The sink takes frames as fast as they are read instead of at the stream rate and keeps
+* up to queueSize decoded frames in flight
+*/
+std::string makeHwDecodingPipeline(const std::string& file, unsigned width, unsigned height,
+                                   std::size_t queueSize) {
+    std::stringstream pipeline;
+    pipeline << "filesrc location=\"" << file << "\" ! decodebin ! vaapipostproc";
+    if (width > 0 && height > 0) {
+        pipeline << " width=" << width << " height=" << height;
+    }
+    pipeline << " ! videoconvert ! video/x-raw,format=BGR ! appsink max-buffers="
+             << std::max<std::size_t>(queueSize, 1) << " sync=false";
+    return pipeline.str();
+}
+
+bool isCompressedVideo(const std::string& name) {
+    for (auto extension : {".mp4", ".mkv", ".mov", ".avi", ".ts", ".h264", ".264", ".h265", ".265", ".hevc"}) {
+        if (hasExtension(name, extension)) {
+            return true;
+        }
+    }
+    return false;
+}
 }  // namespace
 
+bool VideoSourceOCV::rewind() {
+    if (replayer) {
+        return replayer->rewind();
+    }
+    if (pipeline.empty()) {
+        return source.set(cv::CAP_PROP_POS_FRAMES, 0.0);
+    }
+    // the pipeline is at end of stream, starting over is more reliable than seeking it
+    source.release();
+    return source.open(pipeline, cv::CAP_GSTREAMER);
+}
+
 template<bool CollectStats>
 bool VideoSourceOCV::readFrame(cv::Mat& frame) {
     if (CollectStats) {
         ScopedTimer st(perfTimer);
-        bool captured = source.read(frame);
-        if (!captured && loopVideo) {
-            source.set(cv::CAP_PROP_POS_FRAMES, 0.0);
-            return source.read(frame);
+        bool captured = readSource(frame);
+        if (!captured && loopVideo && rewind()) {
+            return readSource(frame);
         }
         return captured;
     } else {
-        bool captured = source.read(frame);
-        if (!captured && loopVideo) {
-            source.set(cv::CAP_PROP_POS_FRAMES, 0.0);
-            return source.read(frame);
+        bool captured = readSource(frame);
+        if (!captured && loopVideo && rewind()) {
+            return readSource(frame);
         }
         return captured;
     }
@@ -461,19 +889,34 @@ bool VideoSourceOCV::readFrame(cv::Mat& frame) {
 
 VideoSourceOCV::VideoSourceOCV(bool async, bool collectStats_,
                          const std::string& name, bool loopVideo, size_t queueSize_,
-                         size_t pollingTimeMSec_, bool realFps_):
+                         size_t pollingTimeMSec_, bool realFps_, size_t readTimeoutMSec_,
+                         OverflowPolicy overflowPolicy_, CaptureScheduler* scheduler_, std::string pipeline_,
+                         std::unique_ptr<CaptureReplayer> replayer_):
         perfTimer(collectStats_ ? PerfTimer::DefaultIterationsCount : 0),
-        isAsync(async), videoName(name),
+        scheduler(scheduler_),
+        isAsync(async), videoName(name), pipeline(std::move(pipeline_)),
+        replayer(std::move(replayer_)),
         loopVideo(loopVideo),
         realFps(realFps_),
         queueSize(queueSize_),
-        pollingTimeMSec(pollingTimeMSec_) {
+        pollingTimeMSec(pollingTimeMSec_),
+        readTimeout(readTimeoutMSec_),
+        overflowPolicy(overflowPolicy_),
+        queue(queueSize_) {
+    if (replayer) {
+        return;
+    }
     if (isNumeric(videoName)) {
         if (!source.open(std::stoi(videoName))) {
             throw std::runtime_error("Can't open " + videoName + " with cv::VideoCapture::open(int)");
         }
     } else {
-        if (!source.open(videoName)) {
+        if (!pipeline.empty() && !source.open(pipeline, cv::CAP_GSTREAMER)) {
+            slog::warn << "Can't decode " << videoName << " with VA-API through GStreamer, "
+                       << "falling back to cv::VideoCapture decoding" << slog::endl;
+            pipeline.clear();
+        }
+        if (pipeline.empty() && !source.open(videoName)) {
             throw std::runtime_error("Can't open " + videoName + " with cv::VideoCapture::open(std::string)");
         }
     }
@@ -488,87 +931,131 @@ bool VideoSourceOCV::isRunning() const {
     return running;
 }
 
-template<bool CollectStats>
-void VideoSourceOCV::thread_fn(VideoSourceOCV *vs) {
-    while (vs->running) {
-        cv::Mat frame;
-        const bool result = vs->readFrame<CollectStats>(frame);
+VideoSourceOCV::Status VideoSourceOCV::step() {
+    if (!pending) {
+        if (!running) {
+            return Status::Finished;
+        }
+        CapturedFrame captured;
+        if (replayer) {
+            replayer->wait();  // a paced replay waits for the moment the frame was captured, it is stamped after that
+        }
+        captured.trace.stamp(FrameTrace::Capture);
+        const bool result = perfTimer.enabled() ? readFrame<true>(captured.frame) : readFrame<false>(captured.frame);
+        captured.trace.stamp(FrameTrace::Decode);  // cv::VideoCapture decodes while reading
         if (!result) {
-            vs->running = false; // stop() also affects running, so override it only when out of frames
+            running = false; // stop() also affects running, so override it only when out of frames
         }
-        std::unique_lock<std::mutex> lock(vs->mutex);
-        vs->condVar.wait(lock, [&]() {
-            return vs->queue.size() < vs->queueSize || !vs->running; // queue has space or source ran out of frames
-        });
-        vs->queue.push({result, frame});
-        vs->hasFrame.notify_one();
+        pendingElem = queue_elem_t(result, std::move(captured));
+        pending = true;
     }
-}
-
-template<bool CollectStats>
-void VideoSourceOCV::startImpl() {
-    if (isAsync) {
-        running = true;
-        workThread = std::thread(&VideoSourceOCV::thread_fn<CollectStats>, this);
+    if (OverflowPolicy::Block == overflowPolicy) {
+        // the frame waits in pendingElem until read() frees space and re-arms the source
+        if (!queue.tryPush(std::move(pendingElem))) {
+            return running ? Status::Blocked : Status::Finished;
+        }
+    } else {
+        pushWithPolicy(queue, std::move(pendingElem), overflowPolicy, []() { return true; }, dropped);
+        for (const auto& elem : dropped) {
+            if (elem.first) {
+                ++droppedFrames;
+            }
+        }
+        dropped.clear();
     }
+    pending = false;
+    return running ? Status::Ready : Status::Finished;
 }
 
 void VideoSourceOCV::start() {
-    if (perfTimer.enabled()) {
-        startImpl<true>();
-    } else {
-        startImpl<false>();
+    if (isAsync) {
+        running = true;
+        scheduler->add(*this);
     }
 }
 
 void VideoSourceOCV::stop() {
     if (isAsync) {
         running = false;
-        condVar.notify_one();
-        if (workThread.joinable()) {
-            workThread.join();
-        }
+        scheduler->remove(*this);
     }
 }
 
-bool VideoSourceOCV::read(cv::Mat& frame) {
+bool VideoSourceOCV::read(VideoFrame& frame) {
     if (isAsync) {
-        bool res;
-        {
-            std::unique_lock<std::mutex> lock(mutex);
-            hasFrame.wait(lock, [&]() {
-                return !queue.empty() || !running;
-            });
-            res = queue.front().first;
-            frame = queue.front().second;
-            if (realFps || queue.size() > 1 || queueSize == 1) {
-                queue.pop();
+        queue_elem_t elem;
+        if (realFps || queueSize == 1 || lastElem.second.frame.empty()) {
+            using clock = std::chrono::high_resolution_clock;
+            const auto deadline = clock::now() + readTimeout;
+            bool timedOut = false;
+            if (!queue.pop(elem, [&]() {
+                    timedOut = readTimeout.count() > 0 && clock::now() >= deadline;
+                    return !running || timedOut;
+                })) {
+                if (running && timedOut) {
+                    frame.frame = cv::Mat();  // no frame in time, the source is still alive
+                    return true;
+                }
+                return false;
             }
+            lastElem = elem;
+            rearm();
+        } else if (queue.tryPop(elem)) {
+            lastElem = elem;
+            rearm();
+        } else if (!running) {
+            return false;  // the capture failed or was stopped, no new frame comes
+        } else {
+            elem = lastElem;  // no new frame yet, show the previous one again
         }
-        condVar.notify_one();
-        return res;
+        frame.frame = elem.second.frame;
+        frame.trace = elem.second.trace;
+        return elem.first;
     } else {
-        return source.read(frame);
+        if (replayer) {
+            replayer->wait();
+        }
+        frame.trace.stamp(FrameTrace::Capture);
+        const bool result = readSource(frame.frame);
+        frame.trace.stamp(FrameTrace::Decode);
+        return result;
     }
 }
 
-bool VideoSourceOCV::read(VideoFrame& frame) {
-    return read(frame.frame);
-}
-
 namespace {
 Decoder::Settings makeDecoderSettings(bool collectStats, std::size_t queueSize,
-                                      unsigned width, unsigned height) {
+                                      unsigned width, unsigned height, bool hwSurfaces, bool adaptive,
+                                      bool reducedDecoding, std::size_t stripes) {
     Decoder::Settings ret = {};
 #if defined(USE_LIBVA)
     ret.mode = Decoder::Mode::Hw;
     ret.num_buffers = static_cast<unsigned>(queueSize);
     ret.output_width = width;
     ret.output_height = height;
-#elif defined(USE_TBB)
-    ret.mode = Decoder::Mode::Async;
+    ret.nv12_output = hwSurfaces;
+    // the surfaces stay in video memory, so there is nothing to route to the CPU
+    if (adaptive && !hwSurfaces) {
+        ret.mode = Decoder::Mode::Adaptive;
+        if (reducedDecoding) {
+            ret.target_width = width;
+            ret.target_height = height;
+        }
+        ret.stripes = static_cast<unsigned>(stripes);
+    }
 #else
-    ret.mode = Decoder::Mode::Immediate;
+    // runs on the TBB arena or on the built-in thread pool
+    ret.mode = Decoder::Mode::Async;
+    if (reducedDecoding) {
+        ret.target_width = width;
+        ret.target_height = height;
+    }
+    ret.stripes = static_cast<unsigned>(stripes);
+    if (hwSurfaces) {
+        throw std::logic_error("Decoding to video memory requires hardware decoding");
+    }
+    if (adaptive) {
+        throw std::logic_error("Adaptive decoding requires hardware decoding");
+    }
 #endif
     ret.collect_stats = collectStats;
     return ret;
@@ -576,13 +1063,51 @@ Decoder::Settings makeDecoderSettings(bool collectStats, std::size_t queueSize,
 }  // namespace
 
 VideoSources::VideoSources(const InitParams& p):
-    decoder(makeDecoderSettings(p.collectStats, p.queueSize, p.expectedWidth,
-                                p.expectedHeight)),
+    decoder(makeDecoderSettings(p.collectStats, p.queueSize, p.expectedWidth, p.expectedHeight, p.hwSurfaces,
+                                p.adaptiveDecoding,
+                                // the regions are in the pixels of the full frames
+                                p.reducedDecoding && p.channelRois.empty(), p.decodingStripes)),
     isAsync(p.isAsync),
     collectStats(p.collectStats),
-    realFps(p.realFps),
+    realFps(p.realFps || p.drain),  // sources waiting for new frames do not repeat cached ones
     queueSize(p.queueSize),
-    pollingTimeMSec(p.pollingTimeMSec) {}
+    pollingTimeMSec(p.pollingTimeMSec),
+    readTimeoutMSec(p.drain ? 0 : p.readTimeoutMSec),
+    overflowPolicy(p.drain ? OverflowPolicy::Block : p.overflowPolicy),
+    hwSurfaces(p.hwSurfaces),
+    downloadSurfaces(p.downloadSurfaces),
+    channelCpus(p.channelCpus),
+    channelRois(p.channelRois),
+    motionThreshold(p.motionThreshold),
+    cameraFormat(p.cameraFormat),
+    cameraIo(p.cameraIo),
+    cameraWorkers(p.cameraWorkers),
+    captureThreads(p.captureThreads),
+    hwFileDecoding(p.hwFileDecoding),
+    expectedWidth(p.expectedWidth),
+    expectedHeight(p.expectedHeight),
+    publishBus(p.publishBus),
+    busSubscribers(p.busSubscribers),
+    busDepth(p.busDepth),
+    busFrameSize(p.busFrameSize),
+    recordDir(p.recordDir),
+    replayFast(p.replayFast) {}
+
+#if defined(USE_NATIVE_CAMERA_API) || defined(USE_LIBVA)
+void VideoSources::setFrame(VideoFrame& frame, DecodedFrame&& decoded) {
+    frame.trace = decoded.trace;
+    frame.surface = std::move(decoded.surface);
+    frame.raw = std::move(decoded.raw);
+    frame.frame = std::move(decoded.frame);
+    if (frame.frame.empty() && !frame.raw.empty() && downloadSurfaces) {
+        frame.frame = rawToBgr(frame.raw);
+    }
+    if (frame.frame.empty() && nullptr != frame.surface.holder && downloadSurfaces) {
+        // only the displayed copy goes to system memory, inference takes the surface
+        frame.frame = decoder.download(frame.surface);
+    }
+}
+#endif
 
 VideoSources::~VideoSources() {
     // nothing
@@ -595,7 +1120,58 @@ bool VideoSources::isRunning() const {
         [](const std::unique_ptr<VideoSource>& input){return input->isRunning();});
 }
 
+#ifdef USE_NATIVE_CAMERA_API
+mcam::controller& VideoSources::getController(const std::vector<unsigned>& cpus) {
+    for (auto& ctrl : controllers) {
+        if (ctrl.first == cpus) {
+            return *ctrl.second;
+        }
+    }
+    controllers.emplace_back(cpus, std::unique_ptr<mcam::controller>(
+        new mcam::controller(cpus, static_cast<unsigned>(cameraWorkers))));
+    return *controllers.back().second;
+}
+#endif
+
+CaptureScheduler& VideoSources::getScheduler(const std::vector<unsigned>& cpus) {
+    for (auto& scheduler : schedulers) {
+        if (scheduler.first == cpus) {
+            return *scheduler.second;
+        }
+    }
+    schedulers.emplace_back(cpus, std::unique_ptr<CaptureScheduler>(new CaptureScheduler(captureThreads, cpus)));
+    return *schedulers.back().second;
+}
+
+std::shared_ptr<FrameBusSubscriber> VideoSources::getFrameBus(const std::string& name) {
+    for (auto& bus : frameBuses) {
+        if (bus.first == name) {
+            return bus.second;
+        }
+    }
+    frameBuses.emplace_back(name, std::make_shared<FrameBusSubscriber>(name));
+    return frameBuses.back().second;
+}
+
 void VideoSources::openVideo(const std::string& source, bool native, bool loopVideo) {
+    std::string busName;
+    std::size_t busChannel = 0;
+    if (parseFrameBusInput(source, busName, busChannel)) {
+        inputs.emplace_back(new VideoSourceBus(getFrameBus(busName), busChannel, realFps, readTimeoutMSec,
+                                               pollingTimeMSec));
+        return;
+    }
+    const auto cpus = inputs.size() < channelCpus.size() ? channelCpus[inputs.size()] : std::vector<unsigned>();
+    if (capture_recording::isRecording(source)) {
+        // the capture thread replays the recording like cv::VideoCapture reads a file, at the recorded pace
+        // unless replayFast. The replayer loops itself, so the pace goes on over the end of the recording
+        std::unique_ptr<CaptureReplayer> replayer(new CaptureReplayer(source, !replayFast, loopVideo));
+        inputs.emplace_back(new VideoSourceOCV(isAsync, collectStats, source, loopVideo,
+                                               queueSize, pollingTimeMSec, realFps, readTimeoutMSec,
+                                               overflowPolicy, isAsync ? &getScheduler(cpus) : nullptr,
+                                               std::string(), std::move(replayer)));
+        return;
+    }
 #ifdef USE_NATIVE_CAMERA_API
     if (native) {
         std::string dev;
@@ -605,47 +1181,159 @@ void VideoSources::openVideo(const std::string& source, bool native, bool loopVi
             dev = source;
         }
         mcam::camera::settings camSettings;
-        camSettings.format4cc = mcam::make_4cc('M', 'J', 'P', 'G');
+        const auto mjpeg = mcam::make_4cc('M', 'J', 'P', 'G');
+        const auto yuyv = mcam::make_4cc('Y', 'U', 'Y', 'V');
+        const auto nv12 = mcam::make_4cc('N', 'V', '1', '2');
+        if ("mjpeg" == cameraFormat) {
+            camSettings.format4cc = mjpeg;
+        } else if ("yuyv" == cameraFormat) {
+            camSettings.format4cc = yuyv;
+        } else if ("nv12" == cameraFormat) {
+            camSettings.format4cc = nv12;
+        } else if ("raw" == cameraFormat) {
+            camSettings.preferred_formats = {nv12, yuyv, mjpeg};
+        } else {
+            throw std::invalid_argument("Unknown camera format: " + cameraFormat +
+                                        ", expected one of mjpeg, yuyv, nv12, raw");
+        }
+        if (hwSurfaces && mjpeg != camSettings.format4cc) {
+            // raw frames are not in video memory
+            camSettings.preferred_formats.clear();
+            camSettings.format4cc = mjpeg;
+        }
         camSettings.width = 640;
         camSettings.height = 480;
         camSettings.num_buffers = static_cast<unsigned>(queueSize);
+        if ("mmap" == cameraIo) {
+            camSettings.io = mcam::camera::io_mode::mmap;
+        } else if ("dmabuf" == cameraIo) {
+            camSettings.io = mcam::camera::io_mode::dma_buf;
+        } else if ("userptr" == cameraIo) {
+            camSettings.io = mcam::camera::io_mode::user_ptr;
+        } else {
+            throw std::invalid_argument("Unknown camera i/o mode: " + cameraIo +
+                                        ", expected one of userptr, mmap, dmabuf");
+        }
 
-        std::unique_ptr<VideoSource> newSrc(new VideoSourceNative(*this, controller, dev, camSettings,
-                                                                     queueSize, realFps, collectStats));
+        // cameras of one node share the controller thread polling them
+        std::unique_ptr<VideoSource> newSrc(new VideoSourceNative(*this, inputs.size(), getController(cpus), dev,
+                                                                     camSettings, queueSize, realFps, collectStats));
         inputs.emplace_back(std::move(newSrc));
     } else {
 #else
     {
 #endif
+        const std::string pipeline = hwFileDecoding && isCompressedVideo(source) ?
+            makeHwDecodingPipeline(source, expectedWidth, expectedHeight, queueSize) : std::string();
 #if defined(USE_LIBVA)
-        const std::string extension = ".mjpeg";
         std::unique_ptr<VideoSource> newSrc;
-        if (source.size() > extension.size() && std::equal(extension.rbegin(), extension.rend(), source.rbegin()))
-            if (loopVideo)
-                throw std::runtime_error("Looping video is not supported for .mjpeg when built with USE_LIBVA");
-            newSrc.reset(new VideoSourceStreamFile(*this, isAsync, collectStats, source,
-                                            queueSize, pollingTimeMSec, realFps));
-        else
+        if (hasExtension(source, ".mjpeg")) {
+            newSrc.reset(new VideoSourceStreamFile(*this, inputs.size(), isAsync, collectStats, source,
+                                            queueSize, pollingTimeMSec, realFps, loopVideo, cpus));
+        } else {
             newSrc.reset(new VideoSourceOCV(isAsync, collectStats, source, loopVideo,
-                                            queueSize, pollingTimeMSec, realFps));
+                                            queueSize, pollingTimeMSec, realFps, readTimeoutMSec,
+                                            overflowPolicy, isAsync ? &getScheduler(cpus) : nullptr, pipeline));
+        }
 #else
         std::unique_ptr<VideoSource> newSrc(new VideoSourceOCV(isAsync, collectStats, source, loopVideo,
-                                            queueSize, pollingTimeMSec, realFps));
+                                            queueSize, pollingTimeMSec, realFps, readTimeoutMSec,
+                                            overflowPolicy, isAsync ? &getScheduler(cpus) : nullptr, pipeline));
 #endif
         inputs.emplace_back(std::move(newSrc));
     }
 }
 
 void VideoSources::start() {
+    if (!publishBus.empty()) {
+        busPublisher.reset(new FrameBusPublisher(publishBus, inputs.size(), busSubscribers, busDepth,
+                                                 busFrameSize));
+        publishedCaptures.assign(inputs.size(), FrameTrace::clock::time_point());
+    }
+    recorders.clear();
+    if (!recordDir.empty()) {
+        for (std::size_t i = 0; i < inputs.size(); ++i) {
+            const std::string path = recordDir + "/input" + std::to_string(i) + ".caprec";
+            slog::info << "Recording input " << i << " to " << path << slog::endl;
+            recorders.emplace_back(new CaptureRecorder(path));
+        }
+        recordedCaptures.assign(inputs.size(), FrameTrace::clock::time_point());
+    }
+    motionGates.clear();
     for (auto& input : inputs) {
+        motionGates.emplace_back(new MotionGate);
         input->start();
     }
 }
 
+bool VideoSources::isUnchanged(MotionGate& gate, const cv::Mat& image) {
+    // small enough to filter the noise and to cost little next to the network input resize
+    static const cv::Size thumbnailSize(64, 36);
+    static const int changedLevel = 16;
+    ++gate.frames;
+    cv::resize(image, gate.diff, thumbnailSize, 0, 0, cv::INTER_AREA);
+    cv::cvtColor(gate.diff, gate.thumbnail, cv::COLOR_BGR2GRAY);
+    if (!gate.reference.empty()) {
+        cv::absdiff(gate.thumbnail, gate.reference, gate.diff);
+        cv::threshold(gate.diff, gate.diff, changedLevel, 255, cv::THRESH_BINARY);
+        if (cv::countNonZero(gate.diff) < motionThreshold * thumbnailSize.area()) {
+            ++gate.unchanged;
+            return true;  // the reference stays, so a slow change adds up until the frame is inferred
+        }
+    }
+    std::swap(gate.reference, gate.thumbnail);
+    return false;
+}
+
+std::vector<cv::Rect> parseChannelRois(const std::string& rois) {
+    std::vector<cv::Rect> result;
+    if (rois.empty()) {
+        return result;
+    }
+    std::stringstream stream(rois);
+    std::string roi;
+    while (std::getline(stream, roi, ';')) {
+        result.emplace_back();
+        if (roi.empty()) {
+            continue;
+        }
+        std::stringstream roiStream(roi);
+        char comma1 = 0, comma2 = 0, comma3 = 0;
+        cv::Rect& rect = result.back();
+        if (!(roiStream >> rect.x >> comma1 >> rect.y >> comma2 >> rect.width >> comma3 >> rect.height) ||
+            ',' != comma1 || ',' != comma2 || ',' != comma3 || !roiStream.eof() ||
+            rect.x < 0 || rect.y < 0 || rect.width <= 0 || rect.height <= 0) {
+            throw std::invalid_argument("Invalid input region: " + roi + ", expected x,y,width,height");
+        }
+    }
+    return result;
+}
+
 bool VideoSources::getFrame(size_t index, VideoFrame& frame) {
     if (inputs.size() > 0) {
         if (index < inputs.size()) {
-            return inputs[index]->read(frame);
+            const bool result = inputs[index]->read(frame);
+            frame.roi = index < channelRois.size() ? channelRois[index] & cv::Rect(cv::Point(), frame.frame.size()) :
+                                                     cv::Rect();
+            frame.unchanged = result && motionThreshold > 0.0f && index < motionGates.size() &&
+                              !frame.frame.empty() && frame.raw.empty() && CV_8UC3 == frame.frame.type() &&
+                              isUnchanged(*motionGates[index], frame.analysed());
+            if (!frame.trace.has(FrameTrace::Capture)) {
+                // the source does not track its frames, so they are accounted from the moment they are read
+                frame.trace.stamp(FrameTrace::Capture);
+                frame.trace.stamp(FrameTrace::Decode);
+            }
+            // a frame repeated by frames caching keeps its capture moment and is published once
+            if (busPublisher && result && frame.trace.stamps[FrameTrace::Capture] != publishedCaptures[index]) {
+                publishedCaptures[index] = frame.trace.stamps[FrameTrace::Capture];
+                busPublisher->publish(index, frame.frame);
+            }
+            if (!recorders.empty() && result && !frame.frame.empty() &&
+                    frame.trace.stamps[FrameTrace::Capture] != recordedCaptures[index]) {
+                recordedCaptures[index] = frame.trace.stamps[FrameTrace::Capture];
+                recorders[index]->write(frame.frame, recordedCaptures[index].time_since_epoch());
+            }
+            return result;
         }
     }
     return false;
@@ -658,7 +1346,27 @@ VideoSources::Stats VideoSources::getStats() const {
         for (auto& input : inputs) {
             ret.readTimes.push_back(input->getAvgReadTime());
         }
-        ret.decodingLatency = decoder.getStats().decoding_latency;
+        auto decoderStats = decoder.getStats();
+        ret.decodingLatency = decoderStats.decoding_latency;
+        ret.decodingBatchSize = decoderStats.avg_batch_size;
+        ret.decodingModes = std::move(decoderStats.channel_modes);
+        ret.hwDecodingLatency = decoderStats.hw_latency;
+        ret.swDecodingLatency = decoderStats.sw_latency;
+        ret.decodingReroutes = decoderStats.reroutes;
+        ret.captureLatencies.reserve(inputs.size());
+        for (auto& input : inputs) {
+            ret.captureLatencies.push_back(input->getCaptureLatency());
+        }
+    }
+    ret.droppedFrames.reserve(inputs.size());
+    for (auto& input : inputs) {
+        ret.droppedFrames.push_back(input->getDroppedFrames());
+    }
+    if (motionThreshold > 0.0f) {
+        for (auto& gate : motionGates) {
+            const std::size_t frames = gate->frames;
+            ret.unchangedShares.push_back(frames > 0 ? static_cast<float>(gate->unchanged) / frames : 0.0f);
+        }
     }
     return ret;
 }
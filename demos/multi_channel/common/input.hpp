@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <chrono>
 #include <memory>
 #include <vector>
 #include <thread>
@@ -12,6 +13,7 @@
 #include <condition_variable>
 #include <queue>
 #include <string>
+#include <utility>
 
 #include <opencv2/opencv.hpp>
 
@@ -19,7 +21,10 @@
 #include "multicam/controller.hpp"
 #endif
 
+#include "backpressure.hpp"
 #include "decoder.hpp"
+#include "frame_bus.hpp"
+#include "raw_image.hpp"
 
 class Detections {
 public:
@@ -28,9 +33,62 @@ public:
     }
     template <typename T> void set(T* detections) {
         this->detections.reset(detections);
+        copy = &copyOf<T>;
+    }
+    // shares storage, e.g. of a DetectionsPool
+    template <typename T> void set(std::shared_ptr<T> detections) {
+        this->detections = std::move(detections);
+        copy = &copyOf<T>;
+    }
+    bool empty() const {
+        return nullptr == detections;
+    }
+    /**
+    * \brief Returns a deep copy, the copied detections don't share the storage, e.g. the detections of a frame taken
+    * for the next frames to change on their own
+    */
+    Detections clone() const {
+        Detections cloned;
+        if (!empty()) {
+            cloned.detections = copy(detections);
+            cloned.copy = copy;
+        }
+        return cloned;
     }
 private:
+    template <typename T> static std::shared_ptr<void> copyOf(const std::shared_ptr<void>& detections) {
+        return std::make_shared<T>(*std::static_pointer_cast<T>(detections));
+    }
+
     std::shared_ptr<void> detections;
+    std::shared_ptr<void> (*copy)(const std::shared_ptr<void>&) = nullptr;
+};
+
+/**
+* \brief Moments a frame passes the pipeline stages, empty for the stages not reached yet
+*/
+struct FrameTrace {
+    enum Stage {
+        Capture = 0,  // the driver timestamp for the native cameras, so the end-to-end latency is glass to glass
+        Decode,
+        Enqueue,
+        InferStart,
+        InferEnd,
+        Postprocess,
+        Render,
+        StagesCount
+    };
+
+    using clock = std::chrono::high_resolution_clock;
+    clock::time_point stamps[StagesCount] = {};
+
+    void stamp(Stage stage) {
+        stamps[stage] = clock::now();
+    }
+
+    bool has(Stage stage) const {
+        return clock::time_point() != stamps[stage];
+    }
 };
 
 class VideoFrame final {
@@ -38,25 +96,96 @@ public:
     cv::Mat frame;
     std::size_t sourceIdx = 0;
     Detections detections;
+    FrameTrace trace;
+    Decoder::HwSurface surface;  // the frame in video memory, set by hardware decoding sources with hwSurfaces
+    RawImage raw;  // the undecoded camera frame, released once it is converted into the network input
+    // the region of frame the network input is cut from, empty - the whole frame. The raw frames and the
+    // remote surfaces are fed whole, the region is reset for them
+    cv::Rect roi;
+    // set by the motion gate of VideoSources, the frame is not inferred and gets the detections of the previous
+    // frame of its channel
+    bool unchanged = false;
+    std::shared_ptr<void> busLease;  // holds the frame bus slot frame points to, set by the frame bus inputs
+    // set on the crops a Cascade cuts from a frame: the entry of the frame and the index of the region
+    std::shared_ptr<void> cascadeEntry;
+    std::size_t cascadeRoi = 0;
     VideoFrame() = default;
 
     VideoFrame& operator =(VideoFrame const& vf) = delete;
+
+    /**
+    * \brief Returns the frame to the state of a default constructed one, e.g. for reuse by VideoFramePool
+    */
+    void reset() {
+        frame.release();
+        sourceIdx = 0;
+        detections = Detections();
+        trace = FrameTrace();
+        surface = Decoder::HwSurface();
+        raw = RawImage();
+        roi = cv::Rect();
+        unchanged = false;
+        busLease.reset();
+        cascadeEntry.reset();
+        cascadeRoi = 0;
+    }
+
+    cv::Mat analysed() const {
+        return roi.empty() ? frame : frame(roi);
+    }
+
+    /**
+    * \brief Maps a point of a detection relative to roi to the whole frame. The point is in a space the
+    * region spans, e.g. (1, 1) for normalized coordinates or the cell size for pixels of the scaled frame,
+    * the result is in the same space spanning the whole frame
+    */
+    cv::Point2f toFrame(cv::Point2f point, cv::Size2f space) const {
+        if (roi.empty() || frame.empty()) {
+            return point;
+        }
+        return {(roi.x + point.x / space.width * roi.width) / frame.cols * space.width,
+                (roi.y + point.y / space.height * roi.height) / frame.rows * space.height};
+    }
+
+    cv::Rect2f toFrame(const cv::Rect2f& rect, cv::Size2f space) const {
+        return {toFrame(rect.tl(), space), toFrame(rect.br(), space)};
+    }
 };
 
+/**
+* \brief Parses the regions of the inputs like "0,0,640,360;;100,50,800,600": x,y,width,height in the pixels of
+* the input frames in the order of the inputs, an empty entry is the whole frame
+*/
+std::vector<cv::Rect> parseChannelRois(const std::string& rois);
+
 class VideoSource;
+struct DecodedFrame;
 class VideoSourceNative;
 class VideoSourceOCV;
 class VideoSourceStreamFile;
+class VideoSourceBus;
+class CaptureScheduler;
+class CaptureRecorder;
 
 class VideoSources {
 private:
     Decoder decoder;
 #ifdef USE_NATIVE_CAMERA_API
-    mcam::controller controller;
+    // one controller per CPU set, so camera polling stays on the node of its channels
+    std::vector<std::pair<std::vector<unsigned>, std::unique_ptr<mcam::controller>>> controllers;
+    mcam::controller& getController(const std::vector<unsigned>& cpus);
 #endif
 
     std::mutex decode_mutex;  // hardware decoding enqueue lock
 
+    // one pool of capture threads per CPU set, declared before the inputs which leave it when destroyed
+    std::vector<std::pair<std::vector<unsigned>, std::unique_ptr<CaptureScheduler>>> schedulers;
+    CaptureScheduler& getScheduler(const std::vector<unsigned>& cpus);
+
+    // the buses of the "bus:<name>/<channel>" inputs, shared by the inputs of a bus
+    std::vector<std::pair<std::string, std::shared_ptr<FrameBusSubscriber>>> frameBuses;
+    std::shared_ptr<FrameBusSubscriber> getFrameBus(const std::string& name);
+
     std::vector<std::unique_ptr<VideoSource>> inputs;
     const bool isAsync;
     const bool collectStats;
@@ -65,8 +194,46 @@ private:
 
     const size_t queueSize = 1;
     const size_t pollingTimeMSec = 1000;
+    const size_t readTimeoutMSec = 0;
+    const OverflowPolicy overflowPolicy = OverflowPolicy::Block;
+    const bool hwSurfaces = false;
+    const bool downloadSurfaces = true;
+    const std::vector<std::vector<unsigned>> channelCpus;
+    const std::vector<cv::Rect> channelRois;
+    const float motionThreshold = 0.0f;
+
+    // the thumbnail of the last frame of an input passed to the networks, see InitParams::motionThreshold
+    struct MotionGate {
+        cv::Mat reference;
+        cv::Mat thumbnail;
+        cv::Mat diff;
+        std::atomic<std::size_t> frames = {0};
+        std::atomic<std::size_t> unchanged = {0};
+    };
+    std::vector<std::unique_ptr<MotionGate>> motionGates;  // created by start(), one per input
+    bool isUnchanged(MotionGate& gate, const cv::Mat& image);
+    const std::string cameraFormat;
+    const std::string cameraIo;
+    const std::size_t cameraWorkers = 0;
+    const std::size_t captureThreads = 1;
+    const bool hwFileDecoding = false;
+    const unsigned expectedWidth = 0;
+    const unsigned expectedHeight = 0;
+
+    const std::string publishBus;
+    const std::size_t busSubscribers = 2;
+    const std::size_t busDepth = 3;
+    const cv::Size busFrameSize;
+    std::unique_ptr<FrameBusPublisher> busPublisher;  // created by start() when publishBus is set
+    std::vector<FrameTrace::clock::time_point> publishedCaptures;  // of the last published frames per input
+
+    const std::string recordDir;
+    const bool replayFast = false;
+    std::vector<std::unique_ptr<CaptureRecorder>> recorders;  // created by start() when recordDir is set
+    std::vector<FrameTrace::clock::time_point> recordedCaptures;  // of the last recorded frames per input
 
     void stop();
+    void setFrame(VideoFrame& frame, DecodedFrame&& decoded);
 
     friend VideoSourceNative;
     friend VideoSourceOCV;
@@ -79,8 +246,70 @@ public:
         bool isAsync = true;
         bool collectStats = false;
         bool realFps = false;
+        // Maximum time a read waits for a new frame before returning an empty one, 0 - wait forever
+        std::size_t readTimeoutMSec = 0;
+        // What a capture thread does when its frame queue is full
+        OverflowPolicy overflowPolicy = OverflowPolicy::Block;
+        // Hardware decoding keeps frames in video memory as NV12 surfaces of the expected size
+        bool hwSurfaces = false;
+        // Also copy surfaces and raw camera frames to system memory as BGR images, e.g. for display
+        bool downloadSurfaces = true;
         unsigned expectedWidth = 0;
         unsigned expectedHeight = 0;
+        // Software decoding of the MJPEG cameras decodes the frames at 1/2, 1/4 or 1/8 of their resolution
+        // when that still covers the expected size, so small networks don't pay for the full size decode.
+        // The frames are displayed at that resolution too, ignored with channelRois
+        bool reducedDecoding = false;
+        // Software decoding of the MJPEG cameras splits the frames with restart markers into up to this many
+        // bands decoded in parallel, lowering the latency of the large frames. 0 or 1 - whole frames
+        std::size_t decodingStripes = 1;
+        // Hardware decoding routes the frames of every MJPEG input to VA-API or to the software decoding
+        // threads, whichever decodes faster under the current load, see Decoder::Mode::Adaptive. Ignored
+        // with hwSurfaces
+        bool adaptiveDecoding = false;
+        // CPUs the capture and decoding threads of every input are pinned to, in openVideo order,
+        // see ThreadPlacement::getChannelsCpus. Inputs without an entry are not pinned
+        std::vector<std::vector<unsigned>> channelCpus;
+        // Regions of the inputs the networks analyse in openVideo order, see VideoFrame::roi. They are clipped
+        // to the frames, inputs without an entry or with an empty one are analysed whole
+        std::vector<cv::Rect> channelRois;
+        // Skip the inference of a frame when less than this share of the pixels of its downscaled region
+        // changed since the last inferred frame of its input, the previous detections are reused then.
+        // 0 - infer every frame
+        float motionThreshold = 0.0f;
+        // Native camera format: "mjpeg", "yuyv", "nv12" or "raw" (the first of nv12, yuyv, mjpeg the
+        // camera supports). Raw frames skip the decoder and are converted straight into the network
+        // input from VideoFrame::raw, hwSurfaces forces mjpeg
+        std::string cameraFormat = "mjpeg";
+        // Native camera buffers: "userptr", "mmap" or "dmabuf" (mapped and exported as DMA-BUF)
+        std::string cameraIo = "userptr";
+        // Threads dequeuing native camera frames per CPU set of channelCpus, 0 - the thread waiting for them
+        std::size_t cameraWorkers = 2;
+        // Threads capturing and decoding the cv::VideoCapture inputs per CPU set of channelCpus, the inputs
+        // take turns on them, so the number of threads doesn't depend on the number of inputs
+        std::size_t captureThreads = 4;
+        // Decode H.264/H.265 video files with VA-API through a GStreamer pipeline, scaled to the
+        // expected size on the GPU. Falls back to cv::VideoCapture decoding when it can't be opened
+        bool hwFileDecoding = false;
+        // Read every frame of every input once, for benchmarks and offline processing: reads wait
+        // for new frames instead of repeating the last one or timing out and full queues block the
+        // capture threads, realFps, readTimeoutMSec and overflowPolicy are ignored
+        bool drain = false;
+        // Publish the frames read from the inputs to the frame bus of this name, so other processes open them
+        // as "bus:<name>/<input index>" instead of decoding them again, see FrameBusPublisher. The frames
+        // must be in system memory, see downloadSurfaces
+        std::string publishBus;
+        // The subscribers the bus takes at once and the frames of an input each holds in place, they size
+        // the ring of the frames of every input. The larger frames are scaled down to busFrameSize
+        std::size_t busSubscribers = 2;
+        std::size_t busDepth = 3;
+        cv::Size busFrameSize = cv::Size(1920, 1080);
+        // Record the frames read from the inputs with the moments they were captured to
+        // <recordDir>/input<index>.caprec in openVideo order, see CaptureRecorder. A frame repeated by frames
+        // caching is recorded once, the frames must be in system memory, see downloadSurfaces. Empty - no recording
+        std::string recordDir;
+        // The .caprec inputs are replayed as fast as they are read rather than at the moments they were captured
+        bool replayFast = false;
     };
 
     explicit VideoSources(const InitParams& p);
@@ -97,6 +326,16 @@ public:
     struct Stats {
         std::vector<float> readTimes;
         float decodingLatency = 0.0f;
+        float decodingBatchSize = 0.0f;  // frames submitted to the hardware decoder at once
+        std::vector<std::size_t> droppedFrames;  // per input, collected even without collectStats
+        std::vector<float> captureLatencies;  // per input, msec from driver capture to dequeue
+        std::vector<float> unchangedShares;  // per input, share of the frames skipped by the motion gate
+        // adaptiveDecoding only: the decoding routes of the inputs which decoded frames, the recent msec
+        // latencies of the routes and the number of reroutes
+        std::vector<Decoder::Mode> decodingModes;
+        float hwDecodingLatency = 0.0f;
+        float swDecodingLatency = 0.0f;
+        std::size_t decodingReroutes = 0;
     };
 
     Stats getStats() const;
@@ -0,0 +1,187 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#include "jpeg_stripes.hpp"
+#include "threading.hpp"
+
+namespace {
+unsigned readBE16(const unsigned char* p) {
+    return 256u * p[0] + p[1];
+}
+
+bool isRestartMarker(unsigned char type) {
+    return type >= 0xD0 && type <= 0xD7;
+}
+
+// the frame markers of the progressive, lossless, hierarchical and arithmetic coded pictures
+bool isUnsupportedFrame(unsigned char type) {
+    return (type >= 0xC2 && type <= 0xCF) && 0xC4 != type && 0xC8 != type && 0xCC != type;
+}
+}  // namespace
+
+bool splitJpegStripes(const void* data, std::size_t size, std::size_t maxStripes, std::vector<JpegStripe>& stripes) {
+    const auto bytes = static_cast<const unsigned char*>(data);
+    if (maxStripes < 2 || size < 4 || 0xFF != bytes[0] || 0xD8 != bytes[1]) {
+        return false;
+    }
+
+    // the headers up to the end of the scan header
+    std::size_t sofPos = 0;
+    unsigned width = 0, height = 0, components = 0, maxH = 1, maxV = 1;
+    std::size_t restartInterval = 0;
+    std::size_t headerEnd = 0;
+    for (std::size_t pos = 2; 0 == headerEnd;) {
+        while (pos + 1 < size && 0xFF == bytes[pos] && 0xFF == bytes[pos + 1]) {
+            ++pos;  // fill bytes
+        }
+        if (pos + 4 > size || 0xFF != bytes[pos]) {
+            return false;
+        }
+        const unsigned char type = bytes[pos + 1];
+        const std::size_t end = pos + 2 + readBE16(bytes + pos + 2);
+        if (end > size || isUnsupportedFrame(type) || 0xE1 == type || 0xD9 == type) {
+            return false;  // EXIF may rotate every stripe on its own
+        }
+        if (0xC0 == type || 0xC1 == type) {
+            if (end < pos + 10) {
+                return false;
+            }
+            sofPos = pos;
+            height = readBE16(bytes + pos + 5);
+            width = readBE16(bytes + pos + 7);
+            components = bytes[pos + 9];
+            if (end < pos + 10 + 3 * components) {
+                return false;
+            }
+            for (unsigned i = 0; i < components; ++i) {
+                const unsigned char sampling = bytes[pos + 10 + 3 * i + 1];
+                maxH = std::max(maxH, static_cast<unsigned>(sampling >> 4));
+                maxV = std::max(maxV, static_cast<unsigned>(sampling & 0x0F));
+            }
+        } else if (0xDD == type) {
+            restartInterval = readBE16(bytes + pos + 4);
+        } else if (0xDA == type) {
+            // a single scan of all the components, so every restart interval holds whole MCUs of all of them
+            if (0 == sofPos || bytes[pos + 4] != components) {
+                return false;
+            }
+            headerEnd = end;
+        }
+        pos = end;
+    }
+    if (0 == width || 0 == height || 0 == restartInterval) {
+        return false;  // the height may come with a DNL marker after the scan
+    }
+
+    // the restart markers of the entropy coded data, the stuffed zero bytes are not markers
+    std::vector<std::size_t> markers;
+    std::size_t eoi = 0;
+    for (std::size_t pos = headerEnd; 0 == eoi;) {
+        auto found = static_cast<const unsigned char*>(std::memchr(bytes + pos, 0xFF, size - pos));
+        if (nullptr == found) {
+            return false;  // truncated
+        }
+        pos = static_cast<std::size_t>(found - bytes);
+        if (pos + 1 >= size) {
+            return false;
+        }
+        const unsigned char type = bytes[pos + 1];
+        if (0x00 == type || 0xFF == type) {
+            pos += 0x00 == type ? 2 : 1;
+        } else if (isRestartMarker(type)) {
+            markers.push_back(pos);
+            pos += 2;
+        } else if (0xD9 == type) {
+            eoi = pos;
+        } else {
+            return false;  // a DNL or a second scan
+        }
+    }
+
+    const unsigned mcuWidth = 1 == components ? 8 : 8 * maxH;
+    const unsigned mcuHeight = 1 == components ? 8 : 8 * maxV;
+    const std::size_t mcusPerRow = (width + mcuWidth - 1) / mcuWidth;
+    const std::size_t mcuRows = (height + mcuHeight - 1) / mcuHeight;
+    const std::size_t intervals = (mcusPerRow * mcuRows + restartInterval - 1) / restartInterval;
+    if (markers.size() + 1 != intervals) {
+        return false;
+    }
+
+    // the first intervals of the stripes, starting on MCU rows close to even shares of the picture
+    std::vector<std::size_t> starts = {0};
+    std::vector<std::size_t> startRows = {0};
+    std::size_t interval = 1;
+    for (std::size_t stripe = 1; stripe < maxStripes; ++stripe) {
+        const std::size_t targetRow = stripe * mcuRows / maxStripes;
+        for (; interval < intervals; ++interval) {
+            const std::size_t mcu = interval * restartInterval;
+            if (0 == mcu % mcusPerRow && mcu / mcusPerRow >= targetRow) {
+                starts.push_back(interval);
+                startRows.push_back(mcu / mcusPerRow);
+                ++interval;
+                break;
+            }
+        }
+    }
+    if (starts.size() < 2) {
+        return false;
+    }
+
+    stripes.resize(starts.size());
+    for (std::size_t s = 0; s < starts.size(); ++s) {
+        const bool last = s + 1 == starts.size();
+        const std::size_t first = starts[s];
+        const std::size_t next = last ? intervals : starts[s + 1];
+        JpegStripe& stripe = stripes[s];
+        stripe.y = static_cast<unsigned>(startRows[s] * mcuHeight);
+        stripe.height = (last ? height : static_cast<unsigned>(startRows[s + 1] * mcuHeight)) - stripe.y;
+
+        const std::size_t begin = 0 == first ? headerEnd : markers[first - 1] + 2;
+        const std::size_t end = last ? eoi : markers[next - 1];
+        stripe.data.resize(headerEnd + (end - begin) + 2);
+        std::memcpy(stripe.data.data(), bytes, headerEnd);
+        stripe.data[sofPos + 5] = static_cast<unsigned char>(stripe.height >> 8);
+        stripe.data[sofPos + 6] = static_cast<unsigned char>(stripe.height & 0xFF);
+        std::memcpy(stripe.data.data() + headerEnd, bytes + begin, end - begin);
+        // the decoder expects RST0 after the scan header and the markers to follow modulo 8
+        for (std::size_t i = first + 1; i < next; ++i) {
+            stripe.data[headerEnd + (markers[i - 1] - begin) + 1] =
+                static_cast<unsigned char>(0xD0 + ((i - first - 1) & 7));
+        }
+        stripe.data[stripe.data.size() - 2] = 0xFF;
+        stripe.data[stripe.data.size() - 1] = 0xD9;
+    }
+    return true;
+}
+
+cv::Mat decodeJpeg(const void* data, std::size_t size, int flags, std::size_t stripes) {
+    std::vector<JpegStripe> parts;
+    if (stripes > 1 && splitJpegStripes(data, size, stripes, parts)) {
+        std::vector<cv::Mat> decoded(parts.size());
+        parallelFor(parts.size(), [&](std::size_t i) {
+            decoded[i] = cv::imdecode(parts[i].data, flags);
+        });
+        int rows = 0;
+        bool valid = true;
+        for (const auto& part : decoded) {
+            valid = valid && !part.empty() && part.cols == decoded.front().cols && part.type() == decoded.front().type();
+            rows += part.rows;
+        }
+        if (valid) {
+            cv::Mat img(rows, decoded.front().cols, decoded.front().type());
+            int y = 0;
+            for (const auto& part : decoded) {
+                part.copyTo(img.rowRange(y, y + part.rows));
+                y += part.rows;
+            }
+            return img;
+        }
+    }
+    return cv::imdecode({static_cast<const char*>(data), static_cast<int>(size)}, flags);
+}
@@ -0,0 +1,33 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+/**
+* \brief A band of MCU rows of a JPEG made a JPEG of its own: the headers of the picture with the height of
+* the band, its restart intervals with the markers renumbered from RST0 and an EOI
+*/
+struct JpegStripe {
+    std::vector<unsigned char> data;
+    unsigned y = 0;       // first row of the band in the picture
+    unsigned height = 0;
+};
+
+/**
+* \brief Splits a baseline JPEG at the restart markers falling on MCU row boundaries into up to maxStripes
+* bands of about the same height. The entropy coder restarts at a marker, so the bands decode independently.
+* Returns false for pictures without restart markers on row boundaries, progressive or multi scan ones
+*/
+bool splitJpegStripes(const void* data, std::size_t size, std::size_t maxStripes, std::vector<JpegStripe>& stripes);
+
+/**
+* \brief cv::imdecode of a JPEG, with stripes > 1 a picture splitJpegStripes splits is decoded by bands in
+* parallel on the shared pool, e.g. the 4K frames of MJPEG cameras. Other pictures are decoded whole
+*/
+cv::Mat decodeJpeg(const void* data, std::size_t size, int flags, std::size_t stripes);
@@ -0,0 +1,144 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "latency_tracer.hpp"
+
+namespace {
+const char* const intervalNames[] = {
+    "decode", "input queue", "batching", "infer", "postprocess", "render", "end-to-end"
+};
+static_assert(sizeof(intervalNames) / sizeof(intervalNames[0]) == LatencyTracer::IntervalsCount,
+              "Interval names do not match the trace stages");
+
+using msec = std::chrono::duration<float, std::milli>;
+using usec = std::chrono::duration<double, std::micro>;
+
+float percentile(std::vector<float>& samples, float share) {
+    if (samples.empty()) {
+        return 0.0f;
+    }
+    auto nth = samples.begin() + static_cast<std::ptrdiff_t>(share * static_cast<float>(samples.size() - 1));
+    std::nth_element(samples.begin(), nth, samples.end());
+    return *nth;
+}
+}  // namespace
+
+LatencyTracer::LatencyTracer(std::size_t channelsCount_, std::size_t windowSize_, bool keepTraces_):
+    channelsCount(channelsCount_),
+    windowSize(windowSize_),
+    keepTraces(keepTraces_),
+    startTime(FrameTrace::clock::now()),
+    windows(channelsCount_ * IntervalsCount),
+    framesCount(channelsCount_, 0) {
+    for (auto& window : windows) {
+        window.samples.reserve(windowSize);
+    }
+}
+
+void LatencyTracer::add(const VideoFrame& frame) {
+    const auto& trace = frame.trace;
+    if (frame.sourceIdx >= channelsCount || !trace.has(FrameTrace::Capture)) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    auto addSample = [&](std::size_t interval, float value) {
+        auto& window = windows[frame.sourceIdx * IntervalsCount + interval];
+        if (window.samples.size() < windowSize) {
+            window.samples.push_back(value);
+        } else {
+            window.samples[window.pos] = value;
+            window.pos = (window.pos + 1) % windowSize;
+        }
+    };
+    std::size_t last = FrameTrace::Capture;
+    for (std::size_t stage = FrameTrace::Capture + 1; stage < FrameTrace::StagesCount; ++stage) {
+        if (!trace.has(static_cast<FrameTrace::Stage>(stage))) {
+            continue;
+        }
+        // a stage skipped by the frame is folded into the next reached one
+        addSample(stage - 1, msec(trace.stamps[stage] - trace.stamps[last]).count());
+        last = stage;
+    }
+    addSample(EndToEnd, msec(trace.stamps[last] - trace.stamps[FrameTrace::Capture]).count());
+    ++framesCount[frame.sourceIdx];
+
+    if (keepTraces && traces.size() < MaxTracedFrames) {
+        traces.emplace_back(frame.sourceIdx, trace);
+    }
+}
+
+std::vector<LatencyTracer::ChannelStats> LatencyTracer::getStats() const {
+    std::vector<ChannelStats> ret(channelsCount);
+    std::vector<float> samples;
+    std::unique_lock<std::mutex> lock(mutex);
+    for (std::size_t channel = 0; channel < channelsCount; ++channel) {
+        ret[channel].framesCount = framesCount[channel];
+        for (std::size_t interval = 0; interval < IntervalsCount; ++interval) {
+            samples = windows[channel * IntervalsCount + interval].samples;
+            auto& percentiles = ret[channel].intervals[interval];
+            percentiles.p50 = percentile(samples, 0.50f);
+            percentiles.p95 = percentile(samples, 0.95f);
+            percentiles.p99 = percentile(samples, 0.99f);
+        }
+    }
+    return ret;
+}
+
+void LatencyTracer::printStats(std::ostream& os) const {
+    const auto stats = getStats();
+    os << std::fixed << std::setprecision(1);
+    os << "Latency p50/p95/p99 in ms, per channel:" << std::endl;
+    for (std::size_t channel = 0; channel < stats.size(); ++channel) {
+        os << "  channel " << channel << " (" << stats[channel].framesCount << " frames):";
+        for (std::size_t interval = 0; interval < IntervalsCount; ++interval) {
+            const auto& percentiles = stats[channel].intervals[interval];
+            os << " " << intervalNames[interval] << " "
+               << percentiles.p50 << "/" << percentiles.p95 << "/" << percentiles.p99;
+        }
+        os << std::endl;
+    }
+}
+
+void LatencyTracer::dumpTrace(const std::string& filePath) const {
+    std::ofstream file(filePath);
+    if (!file.is_open()) {
+        throw std::runtime_error("Can't open " + filePath + " for writing");
+    }
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    // every channel is shown as a separate thread row
+    for (std::size_t channel = 0; channel < channelsCount; ++channel) {
+        file << (channel > 0 ? "," : "") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << channel
+             << ",\"args\":{\"name\":\"channel " << channel << "\"}}";
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    for (const auto& item : traces) {
+        const auto& trace = item.second;
+        std::size_t last = FrameTrace::Capture;
+        for (std::size_t stage = FrameTrace::Capture + 1; stage < FrameTrace::StagesCount; ++stage) {
+            if (!trace.has(static_cast<FrameTrace::Stage>(stage))) {
+                continue;
+            }
+            file << ",\n{\"name\":\"" << intervalNames[stage - 1] << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << item.first
+                 << ",\"ts\":" << usec(trace.stamps[last] - startTime).count()
+                 << ",\"dur\":" << usec(trace.stamps[stage] - trace.stamps[last]).count() << "}";
+            last = stage;
+        }
+    }
+    file << "\n]}\n";
+    if (!file) {
+        throw std::runtime_error("Failed to write " + filePath);
+    }
+}
+
+const char* LatencyTracer::getIntervalName(std::size_t interval) {
+    return interval < IntervalsCount ? intervalNames[interval] : "";
+}
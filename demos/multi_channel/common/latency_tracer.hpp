@@ -0,0 +1,71 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "input.hpp"
+
+/**
+* \brief Collects per channel stage latencies of the frames leaving the pipeline
+* and optionally keeps their traces for a Chrome trace (chrome://tracing) dump
+*/
+class LatencyTracer final {
+public:
+    // interval i lasts from stage i to stage i + 1 of FrameTrace, the last one is capture to the last stage reached
+    enum {
+        EndToEnd = FrameTrace::StagesCount - 1,
+        IntervalsCount = FrameTrace::StagesCount
+    };
+
+    enum {
+        DefaultWindowSize = 500,
+        MaxTracedFrames = 100000
+    };
+
+    struct Percentiles {
+        float p50 = 0.0f;
+        float p95 = 0.0f;
+        float p99 = 0.0f;
+    };
+
+    struct ChannelStats {
+        std::size_t framesCount = 0;
+        Percentiles intervals[IntervalsCount];  // msec over the last windowSize frames
+    };
+
+    LatencyTracer(std::size_t channelsCount, std::size_t windowSize, bool keepTraces);
+
+    void add(const VideoFrame& frame);
+
+    std::vector<ChannelStats> getStats() const;
+
+    void printStats(std::ostream& os) const;
+
+    void dumpTrace(const std::string& filePath) const;
+
+    static const char* getIntervalName(std::size_t interval);
+
+private:
+    struct Window {
+        std::vector<float> samples;
+        std::size_t pos = 0;
+    };
+
+    const std::size_t channelsCount;
+    const std::size_t windowSize;
+    const bool keepTraces;
+    const FrameTrace::clock::time_point startTime;
+
+    mutable std::mutex mutex;
+    std::vector<Window> windows;  // channelsCount x IntervalsCount
+    std::vector<std::size_t> framesCount;
+    std::vector<std::pair<std::size_t, FrameTrace>> traces;
+};
@@ -0,0 +1,405 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include <cstring>
+#include <iomanip>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <samples/slog.hpp>
+
+#include "metrics_exporter.hpp"
+
+#ifndef _WIN32
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+namespace {
+std::string escape(const std::string& value) {
+    std::string escaped;
+    for (char c : value) {
+        if ('\\' == c || '"' == c) {
+            escaped += '\\';
+            escaped += c;
+        } else if ('\n' == c) {
+            escaped += "\\n";
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+#ifndef _WIN32
+bool sendAll(int fd, const std::string& data) {
+    std::size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return false;
+        }
+        sent += static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+// reads until the end of the request headers, the exporter doesn't accept request bodies
+std::string receiveHeaders(int fd) {
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n <= 0) {
+            break;
+        }
+        request.append(buffer, static_cast<std::size_t>(n));
+    }
+    return request;
+}
+
+void setTimeouts(int fd) {
+    timeval timeout{2, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+#endif
+}  // namespace
+
+void OpenMetricsWriter::family(const std::string& name, const std::string& type, const std::string& help) {
+    out << "# TYPE " << name << ' ' << type << '\n';
+    out << "# HELP " << name << ' ' << help << '\n';
+}
+
+void OpenMetricsWriter::gauge(const std::string& name, const std::string& help) {
+    family(name, "gauge", help);
+    sampleName = name;
+}
+
+void OpenMetricsWriter::counter(const std::string& name, const std::string& help) {
+    family(name, "counter", help);
+    sampleName = name + "_total";
+}
+
+void OpenMetricsWriter::sample(double value, const Labels& labels) {
+    out << sampleName;
+    if (!labels.empty()) {
+        out << '{';
+        for (std::size_t i = 0; i < labels.size(); ++i) {
+            out << (0 == i ? "" : ",") << labels[i].first << "=\"" << escape(labels[i].second) << '"';
+        }
+        out << '}';
+    }
+    out << ' ' << std::setprecision(std::numeric_limits<double>::digits10) << value << '\n';
+}
+
+std::string OpenMetricsWriter::str() const {
+    return out.str() + "# EOF\n";
+}
+
+MetricsExporter::MetricsExporter(unsigned port, const std::string& pushUrl) {
+#ifdef _WIN32
+    if (0 != port || !pushUrl.empty()) {
+        throw std::runtime_error("Metrics export is not supported on Windows");
+    }
+#else
+    if (!pushUrl.empty()) {
+        std::string url = pushUrl;
+        const std::string scheme = "http://";
+        if (0 == url.compare(0, scheme.size(), scheme)) {
+            url = url.substr(scheme.size());
+        }
+        std::size_t pathStart = url.find('/');
+        pushPath = std::string::npos == pathStart ? "/metrics/job/multichannel" : url.substr(pathStart);
+        std::string hostPort = url.substr(0, pathStart);
+        std::size_t portStart = hostPort.rfind(':');
+        pushHost = hostPort.substr(0, portStart);
+        pushPort = std::string::npos == portStart ? "9091" : hostPort.substr(portStart + 1);
+        if (pushHost.empty()) {
+            throw std::invalid_argument("Invalid metrics push URL " + pushUrl);
+        }
+        pushThread = std::thread(&MetricsExporter::push, this);
+    }
+    if (0 != port) {
+        listenFd = socket(AF_INET, SOCK_STREAM, 0);
+        if (listenFd < 0) {
+            throw std::runtime_error("Can't create a socket for the metrics endpoint");
+        }
+        int reuse = 1;
+        setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        sockaddr_in address;
+        std::memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        address.sin_port = htons(static_cast<std::uint16_t>(port));
+        if (0 != bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) || 0 != listen(listenFd, 8)) {
+            close(listenFd);
+            {
+                // under the lock, so the push thread can't miss the wakeup between its check and its wait
+                std::lock_guard<std::mutex> lock(mutex);
+                terminate = true;
+            }
+            updated.notify_all();
+            if (pushThread.joinable()) {
+                pushThread.join();
+            }
+            throw std::runtime_error("Can't listen on the metrics port " + std::to_string(port));
+        }
+        serverThread = std::thread(&MetricsExporter::serve, this);
+        slog::info << "Serving metrics at http://<host>:" << port << "/metrics" << slog::endl;
+    }
+#endif
+}
+
+MetricsExporter::~MetricsExporter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        terminate = true;
+    }
+    updated.notify_all();
+    if (serverThread.joinable()) {
+        serverThread.join();
+    }
+    if (pushThread.joinable()) {
+        pushThread.join();
+    }
+#ifndef _WIN32
+    if (listenFd >= 0) {
+        close(listenFd);
+    }
+#endif
+}
+
+void MetricsExporter::update(std::string newExposition) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        exposition = std::move(newExposition);
+        ++version;
+    }
+    updated.notify_all();
+}
+
+void MetricsExporter::serve() {
+#ifndef _WIN32
+    while (!terminate) {
+        pollfd listening = {listenFd, POLLIN, 0};
+        if (poll(&listening, 1, 200) <= 0) {  // wakes up to check terminate
+            continue;
+        }
+        int fd = accept(listenFd, nullptr, nullptr);
+        if (fd < 0) {
+            continue;
+        }
+        setTimeouts(fd);
+        const std::string request = receiveHeaders(fd);
+        std::string response;
+        if (0 == request.compare(0, 13, "GET /metrics ") || 0 == request.compare(0, 14, "GET /metrics/ ")) {
+            std::string body;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                body = exposition.empty() ? "# EOF\n" : exposition;
+            }
+            response = "HTTP/1.1 200 OK\r\n"
+                       "Content-Type: application/openmetrics-text; version=1.0.0; charset=utf-8\r\n"
+                       "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                       "Connection: close\r\n\r\n" + body;
+        } else {
+            response = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        }
+        sendAll(fd, response);
+        close(fd);
+    }
+#endif
+}
+
+void MetricsExporter::push() {
+    std::uint64_t pushedVersion = 0;
+    while (true) {
+        std::string snapshot;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            updated.wait(lock, [&] { return terminate || version != pushedVersion; });
+            if (terminate) {
+                return;
+            }
+            pushedVersion = version;
+            snapshot = exposition;
+        }
+        pushOnce(snapshot);  // slow gateways skip intermediate snapshots instead of delaying the pipeline
+    }
+}
+
+void MetricsExporter::pushOnce(const std::string& snapshot) {
+#ifndef _WIN32
+    static bool failureReported = false;
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addresses = nullptr;
+    bool pushed = false;
+    if (0 == getaddrinfo(pushHost.c_str(), pushPort.c_str(), &hints, &addresses)) {
+        for (addrinfo* address = addresses; address && !pushed; address = address->ai_next) {
+            int fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+            if (fd < 0) {
+                continue;
+            }
+            setTimeouts(fd);
+            if (0 == connect(fd, address->ai_addr, address->ai_addrlen)) {
+                // the Pushgateway accepts the text format, OpenMetrics # EOF is a comment there
+                const std::string request = "PUT " + pushPath + " HTTP/1.1\r\n"
+                                            "Host: " + pushHost + ":" + pushPort + "\r\n"
+                                            "Content-Type: text/plain; version=0.0.4\r\n"
+                                            "Content-Length: " + std::to_string(snapshot.size()) + "\r\n"
+                                            "Connection: close\r\n\r\n" + snapshot;
+                if (sendAll(fd, request)) {
+                    const std::string response = receiveHeaders(fd);
+                    std::size_t status = response.find(' ');
+                    pushed = std::string::npos != status && '2' == response[status + 1];
+                }
+            }
+            close(fd);
+        }
+        freeaddrinfo(addresses);
+    }
+    if (!pushed && !failureReported) {
+        slog::warn << "Can't push metrics to " << pushHost << ":" << pushPort << pushPath
+                   << ", retrying with the next snapshots" << slog::endl;
+    }
+    failureReported = !pushed;
+#endif
+}
+
+PipelineMetrics::PipelineMetrics(unsigned port, const std::string& pushUrl) : exporter(port, pushUrl) {
+    cpuMonitor.setHistorySize(1);
+    memoryMonitor.setHistorySize(1);
+}
+
+void PipelineMetrics::publish(float fps,
+                              const VideoSources::Stats& inputStats,
+                              const IEGraph::Stats& inferStats,
+                              const AsyncOutput::Stats& outputStats,
+                              const std::vector<LatencyTracer::ChannelStats>& latencyStats) {
+    cpuMonitor.collectData();
+    memoryMonitor.collectData();
+
+    OpenMetricsWriter metrics;
+    auto channel = [](std::size_t i) {
+        return OpenMetricsWriter::Labels{{"channel", std::to_string(i)}};
+    };
+    auto distribution = [&metrics](const PerfTimer::Stats& stats) {
+        metrics.sample(stats.mean, {{"stat", "mean"}});
+        metrics.sample(stats.p50, {{"stat", "p50"}});
+        metrics.sample(stats.p95, {{"stat", "p95"}});
+        metrics.sample(stats.p99, {{"stat", "p99"}});
+        metrics.sample(stats.max, {{"stat", "max"}});
+    };
+
+    metrics.gauge("multichannel_fps", "Frames per second leaving the pipeline over the last sampling period");
+    metrics.sample(fps);
+
+    metrics.gauge("multichannel_input_read_time_ms", "Mean time to read a frame of the channel");
+    for (std::size_t i = 0; i < inputStats.readTimes.size(); ++i) {
+        metrics.sample(inputStats.readTimes[i], channel(i));
+    }
+    metrics.gauge("multichannel_capture_latency_ms", "Mean time from driver capture to dequeue of a camera frame");
+    for (std::size_t i = 0; i < inputStats.captureLatencies.size(); ++i) {
+        metrics.sample(inputStats.captureLatencies[i], channel(i));
+    }
+    metrics.gauge("multichannel_hw_decoding_latency_ms", "Mean hardware decoding latency");
+    metrics.sample(inputStats.decodingLatency);
+    metrics.gauge("multichannel_hw_decoding_batch_size", "Mean number of frames submitted to the hardware decoder at once");
+    metrics.sample(inputStats.decodingBatchSize);
+    metrics.counter("multichannel_input_dropped_frames", "Frames dropped by the capture queues");
+    for (std::size_t i = 0; i < inputStats.droppedFrames.size(); ++i) {
+        metrics.sample(static_cast<double>(inputStats.droppedFrames[i]), channel(i));
+    }
+
+    metrics.gauge("multichannel_preprocess_time_ms", "Mean preprocessing time of a batch");
+    metrics.sample(inferStats.preprocessTime);
+    metrics.gauge("multichannel_infer_latency_ms", "Plugin latency of a batch");
+    distribution(inferStats.inferTimeStats);
+    metrics.gauge("multichannel_copies_per_frame", "Mean number of frame copies between the decoder and the plugin");
+    metrics.sample(inferStats.copiesPerFrame);
+    metrics.gauge("multichannel_batch_fill_ratio", "Mean share of batch slots filled with frames");
+    metrics.sample(inferStats.batchFillRatio);
+    metrics.gauge("multichannel_device_infer_latency_ms", "Mean batch latency of the device");
+    for (const auto& device : inferStats.devices) {
+        metrics.sample(device.inferTime, {{"device", device.name}});
+    }
+    metrics.gauge("multichannel_device_batches_share", "Share of all batches run on the device");
+    for (const auto& device : inferStats.devices) {
+        metrics.sample(device.batchesShare, {{"device", device.name}});
+    }
+    metrics.gauge("multichannel_device_occupancy", "Mean share of the device infer requests in flight");
+    for (const auto& device : inferStats.devices) {
+        metrics.sample(device.occupancy, {{"device", device.name}});
+    }
+    metrics.counter("multichannel_inferred_frames", "Frames inferred since the start");
+    metrics.sample(static_cast<double>(inferStats.inferredFrames));
+    metrics.counter("multichannel_channel_frames", "Frames of the channel returned with their results");
+    for (std::size_t i = 0; i < inferStats.channelFrames.size(); ++i) {
+        metrics.sample(static_cast<double>(inferStats.channelFrames[i]), channel(i));
+    }
+    metrics.counter("multichannel_infer_dropped_frames", "Frames dropped because all infer requests were busy");
+    for (std::size_t i = 0; i < inferStats.droppedFrames.size(); ++i) {
+        metrics.sample(static_cast<double>(inferStats.droppedFrames[i]), channel(i));
+    }
+    metrics.gauge("multichannel_channel_fps", "Mean frame rate of the channel since the start");
+    for (std::size_t i = 0; i < inferStats.channelFps.size(); ++i) {
+        metrics.sample(inferStats.channelFps[i], channel(i));
+    }
+    metrics.gauge("multichannel_stage_time_share", "Shares of the elapsed time spent in the pipeline stages");
+    metrics.sample(inferStats.inputWaitShare, {{"stage", "input_wait"}});
+    metrics.sample(inferStats.preprocessShare, {{"stage", "preprocess"}});
+    metrics.sample(inferStats.postprocessShare, {{"stage", "postprocess"}});
+
+    metrics.gauge("multichannel_render_time_ms", "Render time of a frame of all channels");
+    distribution(outputStats.renderTimeStats);
+    metrics.counter("multichannel_render_dropped_frames", "Results dropped because the renderer was busy");
+    for (std::size_t i = 0; i < outputStats.droppedFrames.size(); ++i) {
+        metrics.sample(static_cast<double>(outputStats.droppedFrames[i]), channel(i));
+    }
+
+    metrics.gauge("multichannel_end_to_end_latency_ms", "Latency from capture to the last stage of the recent frames");
+    for (std::size_t i = 0; i < latencyStats.size(); ++i) {
+        const auto& endToEnd = latencyStats[i].intervals[LatencyTracer::EndToEnd];
+        metrics.sample(endToEnd.p50, {{"channel", std::to_string(i)}, {"quantile", "0.5"}});
+        metrics.sample(endToEnd.p95, {{"channel", std::to_string(i)}, {"quantile", "0.95"}});
+        metrics.sample(endToEnd.p99, {{"channel", std::to_string(i)}, {"quantile", "0.99"}});
+    }
+
+    const auto cpuHistory = cpuMonitor.getLastHistory();
+    if (!cpuHistory.empty()) {
+        metrics.gauge("cpu_core_utilization_ratio", "Utilization of the CPU core");
+        for (std::size_t i = 0; i < cpuHistory.back().size(); ++i) {
+            metrics.sample(cpuHistory.back()[i], {{"core", std::to_string(i)}});
+        }
+    }
+    const auto memoryHistory = memoryMonitor.getLastHistory();
+    if (!memoryHistory.empty()) {
+        constexpr double GiB = 1024.0 * 1024.0 * 1024.0;
+        metrics.gauge("memory_used_bytes", "Memory used in the system");
+        metrics.sample(memoryHistory.back().first * GiB);
+        metrics.gauge("swap_used_bytes", "Swap used in the system");
+        metrics.sample(memoryHistory.back().second * GiB);
+        metrics.gauge("process_resident_memory_bytes", "Resident set size of the demo");
+        metrics.sample(memoryMonitor.getProcessRss() * GiB);
+        metrics.gauge("process_peak_resident_memory_bytes", "Peak resident set size of the demo");
+        metrics.sample(memoryMonitor.getPeakProcessRss() * GiB);
+        if (memoryMonitor.allocationsAreCounted()) {
+            metrics.gauge("process_allocation_rate_bytes_per_second", "Heap allocation rate of the demo");
+            metrics.sample(memoryMonitor.getAllocationRate() * 1024 * 1024);
+        }
+    }
+
+    exporter.update(metrics.str());
+}
@@ -0,0 +1,102 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <monitors/cpu_monitor.h>
+#include <monitors/memory_monitor.h>
+
+#include "graph.hpp"
+#include "input.hpp"
+#include "latency_tracer.hpp"
+#include "output.hpp"
+
+/**
+* \brief Formats metric families in the OpenMetrics text format, which Prometheus scrapes and accepts by push
+*/
+class OpenMetricsWriter final {
+public:
+    using Labels = std::vector<std::pair<std::string, std::string>>;
+
+    // starts a family, its samples follow. Counter samples get the _total suffix
+    void gauge(const std::string& name, const std::string& help);
+    void counter(const std::string& name, const std::string& help);
+    void sample(double value, const Labels& labels = {});
+
+    // the exposition ending with # EOF
+    std::string str() const;
+
+private:
+    void family(const std::string& name, const std::string& type, const std::string& help);
+
+    std::ostringstream out;
+    std::string sampleName;
+};
+
+/**
+* \brief Publishes the latest metrics snapshot: serves it to GET /metrics on the port
+* and/or pushes it to a Prometheus Pushgateway every time the snapshot is updated
+*/
+class MetricsExporter final {
+public:
+    // port 0 doesn't serve, empty pushUrl doesn't push. pushUrl is host:port/path,
+    // e.g. localhost:9091/metrics/job/multichannel
+    MetricsExporter(unsigned port, const std::string& pushUrl);
+    ~MetricsExporter();
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    void update(std::string exposition);
+
+private:
+    void serve();
+    void push();
+    void pushOnce(const std::string& exposition);
+
+    std::string pushHost;
+    std::string pushPort;
+    std::string pushPath;
+
+    std::mutex mutex;
+    std::condition_variable updated;
+    std::string exposition;
+    std::uint64_t version = 0;
+    std::atomic<bool> terminate = {false};
+
+    int listenFd = -1;
+    std::thread serverThread;
+    std::thread pushThread;
+};
+
+/**
+* \brief Collects the metrics of the multi-channel pipeline stages and of the system monitors
+* into the exporter every time publish() is called
+*/
+class PipelineMetrics final {
+public:
+    PipelineMetrics(unsigned port, const std::string& pushUrl);
+
+    void publish(float fps,
+                 const VideoSources::Stats& inputStats,
+                 const IEGraph::Stats& inferStats,
+                 const AsyncOutput::Stats& outputStats,
+                 const std::vector<LatencyTracer::ChannelStats>& latencyStats);
+
+private:
+    CpuMonitor cpuMonitor;
+    MemoryMonitor memoryMonitor;
+    MetricsExporter exporter;
+};
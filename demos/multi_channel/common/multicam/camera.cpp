@@ -6,6 +6,7 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstdlib>
 #include <stdexcept>
 #include <string>
 #include <memory>
@@ -14,7 +15,9 @@
 #include <fcntl.h>
 #include <linux/videodev2.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "controller.hpp"
@@ -22,6 +25,19 @@
 
 namespace mcam {
 namespace {
+std::int64_t monotonic_now_us() {
+    timespec now = {};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<std::int64_t>(now.tv_sec) * 1000000 + now.tv_nsec / 1000;
+}
+
+std::int64_t monotonic_timestamp_us(const v4l2_buffer& buf) {
+    if (V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC != (buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK)) {
+        return -1;
+    }
+    return static_cast<std::int64_t>(buf.timestamp.tv_sec) * 1000000 + buf.timestamp.tv_usec;
+}
+
 int xioctl(int fd, unsigned long int request, void *arg) {
     int r = -1;
     do {
@@ -71,6 +87,22 @@ void set_device_params(const file_descriptor& fd, camera::settings& params,
 
 //    v4l2_cropcap cropcap = {};
 
+    if (!params.preferred_formats.empty()) {
+        std::vector<unsigned> supported;
+        v4l2_fmtdesc desc = {};
+        desc.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        while (0 == xioctl(fd.get(), VIDIOC_ENUM_FMT, &desc)) {
+            supported.push_back(desc.pixelformat);
+            ++desc.index;
+        }
+        auto it = std::find_first_of(params.preferred_formats.begin(), params.preferred_formats.end(),
+                                     supported.begin(), supported.end());
+        if (params.preferred_formats.end() == it) {
+            throw_error("device doesn't support any of the preferred formats");
+        }
+        params.format4cc = *it;
+    }
+
     v4l2_format fmt = {};
     fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
     fmt.fmt.pix.width       = params.width;
@@ -84,6 +116,7 @@ void set_device_params(const file_descriptor& fd, camera::settings& params,
     params.width     = fmt.fmt.pix.width;
     params.height    = fmt.fmt.pix.height;
     params.format4cc = fmt.fmt.pix.pixelformat;
+    params.stride    = fmt.fmt.pix.bytesperline;
 
     if (0 != params.frametime_numerator ||
         0 != params.frametime_denominator) {
@@ -122,6 +155,25 @@ camera::camera(controller& owner_, string_ref name_, callback_t callback_,
 
 camera::~camera() {
     owner.unregister_camera(*this);
+    stop_capture();
+}
+
+void camera::buffer_deleter::operator()(void* ptr) const {
+    switch (from) {
+    case origin::heap:
+        free(ptr);
+        break;
+    case origin::mapped:
+        munmap(ptr, size);
+        break;
+    case origin::user:
+    default:
+        break;
+    }
+}
+
+unsigned camera::v4l2_memory() const {
+    return io_mode::user_ptr == params.io ? V4L2_MEMORY_USERPTR : V4L2_MEMORY_MMAP;
 }
 
 void camera::alloc_buffers() {
@@ -132,36 +184,90 @@ void camera::alloc_buffers() {
 
     req.count  = params.num_buffers;
     req.type   = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    req.memory = V4L2_MEMORY_USERPTR;
+    req.memory = v4l2_memory();
 
     if (-1 == xioctl(dev.get(), VIDIOC_REQBUFS, &req)) {
         if (EINVAL == errno) {
-            throw_error("User pointer i/o not supported");
+            throw_error(V4L2_MEMORY_USERPTR == req.memory ? "User pointer i/o not supported" :
+                                                            "Memory mapping i/o not supported");
         } else {
-            throw_errno_error("Unable to setup user pointer i/o mode:", errno);
+            throw_errno_error("Unable to setup frame buffers i/o mode:", errno);
         }
     }
     params.num_buffers = req.count;
 
     buffers.clear();
+    dma_bufs.clear();
     const auto count = params.num_buffers;
     buffers.reserve(count);
-    for (unsigned i = 0 ; i < count; ++i) {
-        std::unique_ptr<char[]> buff(new char[frame_buffer_size]);
-        buffers.emplace_back(std::move(buff));
+    if (io_mode::user_ptr != params.io) {
+        map_buffers();
+    } else if (!params.user_buffers.empty()) {
+        if (params.user_buffers.size() < count || params.user_buffer_size < frame_buffer_size) {
+            throw_error("Not enough user buffers for the frame format");
+        }
+        for (unsigned i = 0 ; i < count; ++i) {
+            buffers.emplace_back(params.user_buffers[i], buffer_deleter());
+        }
+    } else {
+        // drivers may require page aligned user pointers
+        const auto alignment = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+        for (unsigned i = 0 ; i < count; ++i) {
+            void* ptr = nullptr;
+            if (0 != posix_memalign(&ptr, alignment, frame_buffer_size)) {
+                throw_error("Unable to allocate frame buffer");
+            }
+            buffers.emplace_back(ptr, buffer_deleter(buffer_deleter::origin::heap, frame_buffer_size));
+        }
     }
 
     for (unsigned i = 0 ; i < count; ++i) {
+        queue_buffer(i);
+    }
+}
+
+void camera::map_buffers() {
+    for (unsigned i = 0 ; i < params.num_buffers; ++i) {
         v4l2_buffer buf = {};
         buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_USERPTR;
+        buf.memory = V4L2_MEMORY_MMAP;
         buf.index = i;
-        buf.m.userptr = reinterpret_cast<unsigned long>(buffers[i].get());
+        if (-1 == xioctl(dev.get(), VIDIOC_QUERYBUF, &buf)) {
+            throw_errno_error("Unable to query frame buffer:", errno);
+        }
+        auto ptr = mmap(nullptr, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED,
+                        dev.get(), buf.m.offset);
+        if (MAP_FAILED == ptr) {
+            throw_errno_error("Unable to map frame buffer:", errno);
+        }
+        buffers.emplace_back(ptr, buffer_deleter(buffer_deleter::origin::mapped, buf.length));
+
+        if (io_mode::dma_buf == params.io) {
+            v4l2_exportbuffer expbuf = {};
+            expbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+            expbuf.index = i;
+            expbuf.flags = O_RDONLY | O_CLOEXEC;
+            if (-1 == xioctl(dev.get(), VIDIOC_EXPBUF, &expbuf)) {
+                throw_errno_error("Unable to export frame buffer as DMA-BUF:", errno);
+            }
+            dma_bufs.emplace_back(expbuf.fd);
+        }
+    }
+}
+
+void camera::queue_buffer(unsigned index) {
+    assert(index < buffers.size());
+    v4l2_buffer buf = {};
+    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buf.memory = v4l2_memory();
+    buf.index = index;
+    if (V4L2_MEMORY_USERPTR == buf.memory) {
+        buf.m.userptr = reinterpret_cast<unsigned long>(buffers[index].get());
         buf.length = static_cast<__u32>(frame_buffer_size);
+    }
 
-        if (-1 == xioctl(dev.get(), VIDIOC_QBUF, &buf)) {
-            throw_errno_error("Unable to enqueue frame buffer ptr:", errno);
-        }
+    if (-1 == xioctl(dev.get(), VIDIOC_QBUF, &buf)) {
+        throw_errno_error("Unable to enqueue frame buffer:", errno);
     }
 }
 
@@ -173,13 +279,54 @@ void camera::start_capture() {
     }
 }
 
+void camera::stop_capture() {
+    assert(dev.valid());
+    v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    // releases the driver's references to the buffers before they are unmapped
+    xioctl(dev.get(), VIDIOC_STREAMOFF, &type);
+}
+
+void camera::update_stats(const v4l2_buffer& buf) {
+    if (has_sequence && buf.sequence > last_sequence + 1) {
+        dropped_count += buf.sequence - last_sequence - 1;
+    }
+    has_sequence = true;
+    last_sequence = buf.sequence;
+    ++frames_count;
+
+    const std::int64_t captured_us = monotonic_timestamp_us(buf);
+    if (captured_us >= 0) {
+        const std::int64_t now_us = monotonic_now_us();
+        if (now_us >= captured_us) {
+            const auto latency = static_cast<std::uint64_t>(now_us - captured_us);
+            latency_sum_us += latency;
+            ++latency_count;
+            if (latency > latency_max_us) {
+                latency_max_us = latency;  // the only writer
+            }
+        }
+    }
+}
+
+camera::stats camera::get_stats() const {
+    stats ret;
+    ret.frames = frames_count;
+    ret.dropped_buffers = dropped_count;
+    const std::size_t count = latency_count;
+    if (count > 0) {
+        ret.avg_dequeue_latency = static_cast<float>(latency_sum_us.load()) / static_cast<float>(count) / 1000.0f;
+    }
+    ret.max_dequeue_latency = static_cast<float>(latency_max_us.load()) / 1000.0f;
+    return ret;
+}
+
 void camera::read_frame() {
     assert(dev.valid());
     assert(nullptr != callback);
     while (true) {
         v4l2_buffer buf = {};
         buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_USERPTR;
+        buf.memory = v4l2_memory();
         if (-1 == xioctl(dev.get(), VIDIOC_DQBUF, &buf)) {
             switch (errno) {
             case EAGAIN:
@@ -194,29 +341,23 @@ void camera::read_frame() {
                 throw_errno_error("Unable to get frame buffer ptr:", errno);
             }
         }
-        auto ptr = reinterpret_cast<void*>(buf.m.userptr);
+        update_stats(buf);
+        assert(buf.index < buffers.size());
+        auto ptr = buffers[buf.index].get();
         assert(nullptr != ptr);
         auto len = buf.bytesused;
         assert(len > 0);
-        callback(frame_status::ok, params, frame(*this, buf.index, ptr, len));
+        const int fd = buf.index < dma_bufs.size() ? dma_bufs[buf.index].get() : -1;
+        callback(frame_status::ok, params, frame(*this, buf.index, ptr, len, fd, monotonic_timestamp_us(buf)));
     }
 }
 
 void camera::reclaim_frame(frame& f) {
-    v4l2_buffer buf = {};
-    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    buf.memory = V4L2_MEMORY_USERPTR;
-    buf.index = f.index;
-    buf.m.userptr = reinterpret_cast<unsigned long>(f.ptr);
-    buf.length = static_cast<__u32>(frame_buffer_size);
-
-    if (-1 == xioctl(dev.get(), VIDIOC_QBUF, &buf)) {
-        throw_errno_error("Unable to enqueue frame buffer ptr:", errno);
-    }
+    queue_buffer(f.index);
 }
 
-camera::frame::frame(camera& c, unsigned i, void* p, std::size_t l):
-    cam(&c), index(i), ptr(p), len(l) {
+camera::frame::frame(camera& c, unsigned i, void* p, std::size_t l, int f, std::int64_t ts):
+    cam(&c), index(i), ptr(p), len(l), fd(f), ts_us(ts) {
     assert(nullptr != ptr);
     assert(0 != len);
 }
@@ -226,6 +367,8 @@ camera::frame::frame(camera::frame&& rhs) {
     std::swap(index, rhs.index);
     std::swap(ptr, rhs.ptr);
     std::swap(len, rhs.len);
+    std::swap(fd, rhs.fd);
+    std::swap(ts_us, rhs.ts_us);
 }
 
 camera::frame::~frame() {
@@ -240,6 +383,8 @@ camera::frame& camera::frame::operator=(camera::frame&& rhs) {
         std::swap(index, rhs.index);
         std::swap(ptr, rhs.ptr);
         std::swap(len, rhs.len);
+        std::swap(fd, rhs.fd);
+        std::swap(ts_us, rhs.ts_us);
     }
     return *this;
 }
@@ -256,4 +401,16 @@ std::size_t camera::frame::size() const {
     return len;
 }
 
+int camera::frame::dma_buf_fd() const {
+    return fd;
+}
+
+std::int64_t camera::frame::timestamp_us() const {
+    return ts_us;
+}
+
+std::int64_t camera::frame::age_us() const {
+    return ts_us < 0 ? -1 : std::max<std::int64_t>(monotonic_now_us() - ts_us, 0);
+}
+
 }  // namespace mcam
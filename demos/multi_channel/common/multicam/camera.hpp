@@ -6,12 +6,14 @@
 
 #include "utils.hpp"
 
-#include <boost/intrusive/list.hpp>
-
+#include <atomic>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <vector>
 
+struct v4l2_buffer;
+
 namespace mcam {
 
 class controller;
@@ -19,16 +21,41 @@ class controller;
 class camera final {
 public:
     friend class ::mcam::controller;
+    /// How frame buffers are shared with the driver, no mode copies frame data
+    enum class io_mode {
+        /// Page aligned buffers allocated by the camera or passed in settings::user_buffers
+        user_ptr,
+        /// Driver buffers mapped to the process
+        mmap,
+        /// Driver buffers mapped to the process and exported as DMA-BUF file descriptors
+        dma_buf
+    };
+
     struct settings final {
         unsigned width = 0;
         unsigned height = 0;
         unsigned format4cc = 0;
 
+        /// Formats to negotiate in the order of preference, the first one the device supports
+        /// replaces format4cc. Empty - format4cc is requested as is
+        std::vector<unsigned> preferred_formats;
+
+        /// Bytes per row of the negotiated format, set by the camera
+        unsigned stride = 0;
+
         /// Requested frame time (e.g. 1 / 60 for 60 fps)
         unsigned frametime_numerator = 0;
         unsigned frametime_denominator = 0;
 
         unsigned num_buffers = 1;
+
+        io_mode io = io_mode::user_ptr;
+
+        /// Buffers to capture into in user_ptr mode, e.g. pinned memory shared with a consumer.
+        /// Empty - allocated by the camera, otherwise num_buffers of at least user_buffer_size bytes
+        /// which must outlive the camera
+        std::vector<void*> user_buffers;
+        std::size_t user_buffer_size = 0;
     };
 
     class frame final {
@@ -36,8 +63,10 @@ public:
         unsigned index = 0;
         void* ptr = nullptr;
         std::size_t len = 0;
+        int fd = -1;
+        std::int64_t ts_us = -1;
 
-        frame(camera& c, unsigned i, void* p, std::size_t l);
+        frame(camera& c, unsigned i, void* p, std::size_t l, int f, std::int64_t ts);
     public:
         friend class camera;
 
@@ -53,6 +82,17 @@ public:
 
         const void* data() const;
         std::size_t size() const;
+
+        /// DMA-BUF of the frame buffer in dma_buf mode, -1 otherwise. Owned by the camera,
+        /// the buffer is reused by the driver once the frame is released
+        int dma_buf_fd() const;
+
+        /// CLOCK_MONOTONIC microseconds the driver captured the frame at,
+        /// -1 for the drivers stamping the frames with another clock
+        std::int64_t timestamp_us() const;
+
+        /// Microseconds since the frame was captured, -1 when the timestamp is unknown
+        std::int64_t age_us() const;
     };
     enum class frame_status {
         ok,
@@ -65,6 +105,18 @@ public:
            const settings& params_);
     ~camera();
 
+    struct stats final {
+        std::size_t frames = 0;
+        /// Frames the driver had no free buffer for, from gaps in buffer sequence numbers
+        std::size_t dropped_buffers = 0;
+        /// Milliseconds from the driver timestamp until the buffer is dequeued
+        float avg_dequeue_latency = 0.0f;
+        float max_dequeue_latency = 0.0f;
+    };
+
+    /// Safe to call from any thread
+    stats get_stats() const;
+
 private:
     friend class camera::frame;
     struct device {
@@ -75,18 +127,44 @@ private:
     };
 
     void alloc_buffers();
+    void map_buffers();
+    void queue_buffer(unsigned index);
     void start_capture();
+    void stop_capture();
     void read_frame();
     void reclaim_frame(frame& f);
+    void update_stats(const ::v4l2_buffer& buf);
 
     controller& owner;
     settings params;
     file_descriptor dev;
     std::size_t frame_buffer_size = 0;
-    std::vector<std::unique_ptr<char[]>> buffers;
+    struct buffer_deleter final {
+        enum class origin { user, heap, mapped };
+        origin from;
+        std::size_t size;  // of the mapping
+
+        explicit buffer_deleter(origin from_ = origin::user, std::size_t size_ = 0):
+            from(from_), size(size_) {}
+        void operator()(void* ptr) const;
+    };
+    /// Frame memory by buffer index
+    std::vector<std::unique_ptr<void, buffer_deleter>> buffers;
+    std::vector<file_descriptor> dma_bufs;
     callback_t callback;
 
-    boost::intrusive::list_member_hook<> list_node;
+    unsigned v4l2_memory() const;
+
+    std::uint64_t id = 0;  // assigned by the controller
+
+    // updated by the single thread reading frames at a time
+    bool has_sequence = false;
+    std::uint32_t last_sequence = 0;
+    std::atomic<std::size_t> frames_count = {0};
+    std::atomic<std::size_t> dropped_count = {0};
+    std::atomic<std::uint64_t> latency_sum_us = {0};
+    std::atomic<std::uint64_t> latency_max_us = {0};
+    std::atomic<std::size_t> latency_count = {0};
 };
 
 }  // namespace mcam
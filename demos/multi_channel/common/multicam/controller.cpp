@@ -4,118 +4,172 @@
 
 #include "controller.hpp"
 
+#include <cassert>
+#include <cstdint>
 #include <vector>
 
 #include "utils.hpp"
+#include "placement.hpp"
 
-#include <fcntl.h>
-#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 
 namespace mcam {
 namespace {
 using lock_guard = std::lock_guard<std::mutex>;
-}
+using unique_lock = std::unique_lock<std::mutex>;
 
-controller::controller() {
-    queue_thread = std::thread([this]() {
-        std::vector<pollfd> fds;
-        std::vector<camera*> temp_ptrs;
-        const auto poll_flags = POLLIN | POLLRDNORM | POLLERR;
-        while (!terminate) { {
-                lock_guard lock(list_mutex);
-                auto size = cameras.size() + 1;
-                if (fds.size() != size) {
-                    fds.clear();
-                    temp_ptrs.clear();
-                    fds.push_back(pollfd{notifier.get_fd_to_poll(), POLLIN, 0});
-                    for (auto& cam : cameras) {
-                        assert(cam.dev.valid());
-                        fds.push_back(pollfd{cam.dev.get(), poll_flags, 0});
-                        temp_ptrs.push_back(&cam);
-                    }
-                }
-            }
+constexpr const std::uint64_t wakeup_id = 0;
+constexpr const int max_events = 64;
+}  // namespace
 
-            if (-1 == poll(fds.data(), fds.size(), -1)) {
-                throw_errno_error("failed wait on poll:", errno);
-            }
+controller::controller(const std::vector<unsigned>& cpus, unsigned num_workers):
+    epoll_fd(epoll_create1(EPOLL_CLOEXEC)),
+    wakeup_fd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
+    if (!epoll_fd.valid()) {
+        throw_errno_error("failed to create epoll set:", errno);
+    }
+    if (!wakeup_fd.valid()) {
+        throw_errno_error("failed to create eventfd:", errno);
+    }
+    epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.u64 = wakeup_id;
+    if (-1 == epoll_ctl(epoll_fd.get(), EPOLL_CTL_ADD, wakeup_fd.get(), &ev)) {
+        throw_errno_error("failed to add eventfd to epoll set:", errno);
+    }
 
-            for (size_t i = 0; i < fds.size(); ++i) {
-                if (0 != (fds[i].revents & poll_flags)) {
-                    if (0 == i) {
-                        notifier.flush();
-                    } else {
-                        auto cam = temp_ptrs[i - 1];
-                        assert(nullptr != cam);
-                        cam->read_frame();
-                    }
-                }
-            }
-        }
+    for (unsigned i = 0; i < num_workers; ++i) {
+        workers.emplace_back([this, cpus]() {
+            pinCurrentThread(cpus);  // not fatal, the thread keeps running anywhere
+            worker_loop();
+        });
+    }
+    queue_thread = std::thread([this, cpus]() {
+        pinCurrentThread(cpus);
+        poll_loop();
     });
 }
 
 controller::~controller() {
     terminate = true;
-    notifier.signal();
+    const std::uint64_t val = 1;
+    if (-1 == write(wakeup_fd.get(), &val, sizeof(val))) {
+        assert(false);
+    }
     if (queue_thread.joinable()) {
         queue_thread.join();
     }
+    {
+        lock_guard lock(jobs_mutex);
+        jobs.clear();
+    }
+    jobs_available.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
 }
 
-void controller::register_camera(camera& cam) {
-    {
-        lock_guard lock(list_mutex);
-        cameras.push_back(cam);
+void controller::poll_loop() {
+    epoll_event events[max_events];
+    while (!terminate) {
+        const int count = epoll_wait(epoll_fd.get(), events, max_events, -1);
+        if (-1 == count) {
+            if (EINTR == errno) {
+                continue;
+            }
+            throw_errno_error("failed wait on epoll:", errno);
+        }
+        for (int i = 0; i < count; ++i) {
+            const auto id = events[i].data.u64;
+            if (wakeup_id == id) {
+                std::uint64_t val = 0;
+                (void)read(wakeup_fd.get(), &val, sizeof(val));
+            } else if (workers.empty()) {
+                process(id);
+            } else {
+                {
+                    lock_guard lock(jobs_mutex);
+                    jobs.push_back(id);
+                }
+                jobs_available.notify_one();
+            }
+        }
     }
-    notifier.signal();
 }
 
-void controller::unregister_camera(camera& cam) {
-    {
-        lock_guard lock(list_mutex);
-        cameras.erase(decltype(cameras)::s_iterator_to(cam));
+void controller::worker_loop() {
+    while (true) {
+        std::uint64_t id = 0;
+        {
+            unique_lock lock(jobs_mutex);
+            jobs_available.wait(lock, [this]() { return terminate || !jobs.empty(); });
+            if (terminate) {
+                return;
+            }
+            id = jobs.front();
+            jobs.pop_front();
+        }
+        process(id);
     }
-    notifier.signal();
 }
 
-controller::poll_notifier::poll_notifier() {
-    int pfd[2] = {};
-    if (-1 == pipe(pfd)) {
-        throw_errno_error("failed to create a pipe:", errno);
+void controller::process(std::uint64_t id) {
+    camera* cam = nullptr;
+    {
+        lock_guard lock(list_mutex);
+        auto it = cameras.find(id);
+        if (cameras.end() == it || it->second.removing) {
+            return;
+        }
+        it->second.busy = true;
+        cam = it->second.cam;
     }
-    read_fd  = file_descriptor(pfd[0]);
-    write_fd = file_descriptor(pfd[1]);
-    int flags = fcntl(read_fd.get(), F_GETFL, 0);
-    if (-1 == fcntl(read_fd.get(), F_SETFL, flags | O_NONBLOCK)) {
-        throw_errno_error("Unable to set pipe ijnto non-blocking mode:", errno);
+    // one shot events keep other workers away until the camera is rearmed,
+    // the camera dequeues until the driver has nothing left as edge triggering requires
+    cam->read_frame();
+    {
+        lock_guard lock(list_mutex);
+        auto it = cameras.find(id);
+        assert(cameras.end() != it);
+        it->second.busy = false;
+        if (!it->second.removing) {
+            arm(*cam, EPOLL_CTL_MOD);
+        }
     }
+    idle.notify_all();
 }
 
-void controller::poll_notifier::signal() {
-    assert(write_fd.valid());
-    char buff[1] = {42};
-    if (-1 == write(write_fd.get(), buff, 1)) {
-        throw_errno_error("failed to write to pipe:", errno);
+void controller::arm(const camera& cam, int op) {
+    assert(cam.dev.valid());
+    epoll_event ev = {};
+    ev.events = EPOLLIN | EPOLLET | EPOLLONESHOT;
+    ev.data.u64 = cam.id;
+    if (-1 == epoll_ctl(epoll_fd.get(), op, cam.dev.get(), &ev)) {
+        throw_errno_error("failed to add camera to epoll set:", errno);
     }
 }
 
-void controller::poll_notifier::flush() {
-    assert(read_fd.valid());
-    constexpr const size_t Len = 1024;
-    char buff[Len];
-    while (true) {
-        auto res = read(read_fd.get(), buff, Len);
-        if (-1 == res) {
-            if (EAGAIN == errno) {
-                break;
-            }
-            throw_errno_error("failed to read from pipe:", errno);
-        }
-        if (0 == res) {
-            break;
-        }
-    }
+void controller::register_camera(camera& cam) {
+    lock_guard lock(list_mutex);
+    cam.id = next_id++;
+    entry e;
+    e.cam = &cam;
+    cameras[cam.id] = e;
+    arm(cam, EPOLL_CTL_ADD);
+}
+
+void controller::unregister_camera(camera& cam) {
+    unique_lock lock(list_mutex);
+    auto it = cameras.find(cam.id);
+    assert(cameras.end() != it);
+    // references survive rehashing by cameras registered meanwhile, iterators do not
+    auto& e = it->second;
+    e.removing = true;
+    epoll_ctl(epoll_fd.get(), EPOLL_CTL_DEL, cam.dev.get(), nullptr);
+    idle.wait(lock, [&]() { return !e.busy; });
+    cameras.erase(cam.id);
 }
 
 }  // namespace mcam
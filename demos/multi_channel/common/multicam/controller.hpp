@@ -5,50 +5,59 @@
 #pragma once
 
 #include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
 #include <mutex>
 #include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include "camera.hpp"
 #include "utils.hpp"
 
 namespace mcam {
 
+/// Waits for frames of all registered cameras on one edge-triggered epoll set
 class controller final {
 public:
     friend class ::mcam::camera;
 
-    controller();
+    // cpus - where the controller threads run, empty - anywhere
+    // num_workers - threads dequeuing frames and running camera callbacks, 0 - the polling thread
+    explicit controller(const std::vector<unsigned>& cpus = {}, unsigned num_workers = 0);
     ~controller();
 
 private:
     void register_camera(camera& cam);
     void unregister_camera(camera& cam);
 
-    std::thread queue_thread;
-    std::atomic_bool terminate = {false};
-
-    std::mutex list_mutex;
-    boost::intrusive::list<
-        camera,
-        boost::intrusive::member_hook<
-            camera,
-            boost::intrusive::list_member_hook<>, &camera::list_node
-        >
-    > cameras;
-
-    struct poll_notifier final {
-        file_descriptor read_fd;
-        file_descriptor write_fd;
+    void arm(const camera& cam, int op);
+    void process(std::uint64_t id);
+    void poll_loop();
+    void worker_loop();
 
-        poll_notifier();
+    file_descriptor epoll_fd;
+    file_descriptor wakeup_fd;  // eventfd, registered with id 0
 
-        void signal();
-        void flush();
+    std::thread queue_thread;
+    std::vector<std::thread> workers;
+    std::atomic_bool terminate = {false};
 
-        int get_fd_to_poll() const { return read_fd.get(); }
+    struct entry final {
+        camera* cam = nullptr;
+        bool busy = false;      // frames are being read, at most one reader per camera
+        bool removing = false;  // not rearmed anymore
     };
-
-    poll_notifier notifier;
+    std::mutex list_mutex;
+    std::condition_variable idle;
+    std::uint64_t next_id = 1;
+    // events carry ids, so the ones fetched before a camera was unregistered resolve to nothing
+    std::unordered_map<std::uint64_t, entry> cameras;
+
+    std::mutex jobs_mutex;
+    std::condition_variable jobs_available;
+    std::deque<std::uint64_t> jobs;
 };
 
 }  // namespace mcam
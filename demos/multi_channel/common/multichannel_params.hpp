@@ -12,7 +12,8 @@ static const char help_message[] = "Print a usage message";
 static const char model_path_message[] = "Required. Path to an .xml file with a trained model.";
 static const char target_device_message[] = "Optional. Specify the target device for a network (the list of available devices is shown below). "
                                             "Default value is CPU. Use \"-d HETERO:<comma-separated_devices_list>\" format to specify HETERO plugin. "
-                                            "The demo looks for a suitable plugin for a specified device.";
+                                            "Use \"-d <comma-separated_devices_list>\" format to balance batches between several devices, "
+                                            "each with its own infer requests. The demo looks for a suitable plugin for a specified device.";
 static const char performance_counter_message[] = "Optional. Enable per-layer performance report";
 static const char custom_cldnn_message[] = "Required for GPU custom kernels. "
                                            "Absolute path to an .xml file with the kernels descriptions";
@@ -31,6 +32,14 @@ static const char real_input_fps[] = "Optional. Disable input frames caching, fo
 static const char input_video[] = "Optional. Specify full path to input video files";
 static const char loop_video_output_message[] = "Optional. Enable playing video on a loop.";
 static const char utilization_monitors_message[] = "Optional. List of monitors to show initially.";
+static const char u8_input_message[] = "Optional. Feed the network with U8 NHWC input and let the plugin convert precision and layout";
+static const char zero_copy_message[] = "Optional. Wrap frames matching the network input size into input blobs without copying "
+                                        "(batch size 1 only, implies -u8_input)";
+static const char batch_timeout_message[] = "Optional. Maximum time in msec to wait for a full batch, after that "
+                                            "a partially filled batch is inferred. Default value is 0 (always wait for a full batch)";
+static const char postprocess_threads_message[] = "Optional. Threads postprocessing the inferred batches in parallel, "
+                                                  "the results are still shown in the order of the frames. "
+                                                  "0 - postprocess on the rendering thread. Default value is 2";
 
 DEFINE_bool(h, false, help_message);
 DEFINE_string(m, "", model_path_message);
@@ -51,3 +60,322 @@ DEFINE_bool(real_input_fps, false, real_input_fps);
 DEFINE_string(i, "", input_video);
 DEFINE_bool(loop_video, false, loop_video_output_message);
 DEFINE_string(u, "", utilization_monitors_message);
+DEFINE_bool(u8_input, false, u8_input_message);
+DEFINE_bool(zero_copy, false, zero_copy_message);
+DEFINE_uint32(batch_timeout, 0, batch_timeout_message);
+DEFINE_uint32(postprocess_threads, 2, postprocess_threads_message);
+
+/// @brief Flag to enable throughput streams auto-configuration
+static const char auto_throughput_message[] = "Optional. Configure CPU/GPU throughput streams from the core and "
+                                              "channel count and size the infer request pool by the device optimal "
+                                              "number of infer requests, overrides -nireq";
+
+/// @brief Enable throughput streams auto-configuration
+/// It is a optional parameter
+DEFINE_bool(auto_throughput, false, auto_throughput_message);
+
+/// @brief Overflow policies of the pipeline stages
+static const char input_overflow_message[] = "Optional. What a capture thread does when its frame queue is full: "
+                                             "block, drop_oldest or drop_newest. Default value is block";
+static const char infer_overflow_message[] = "Optional. What to do with a collected batch when all infer requests are busy: "
+                                             "block, drop_oldest or drop_newest. Default value is block";
+static const char output_overflow_message[] = "Optional. What to do with results when the renderer is busy: "
+                                              "block, drop_oldest or drop_newest. Default value is drop_oldest";
+
+/// @brief Overflow policies of the pipeline stages
+/// It is a optional parameter
+DEFINE_string(input_overflow, "block", input_overflow_message);
+DEFINE_string(infer_overflow, "block", infer_overflow_message);
+DEFINE_string(output_overflow, "drop_oldest", output_overflow_message);
+
+/// @brief Path to the Chrome trace output file
+static const char trace_file_message[] = "Optional. Write stage timings of every frame to the file in Chrome trace JSON format "
+                                         "(open in chrome://tracing)";
+
+/// @brief Path to the Chrome trace output file
+/// It is a optional parameter
+DEFINE_string(trace_file, "", trace_file_message);
+
+/// @brief message for remote blobs flag
+static const char remote_blobs_message[] = "Optional. Keep hardware decoded frames in video memory and feed them to the GPU "
+                                           "plugin as NV12 remote blobs. Requires -d GPU and -bs 1";
+
+/// @brief Flag to feed VA surfaces to the GPU plugin
+/// It is a optional parameter
+DEFINE_bool(remote_blobs, false, remote_blobs_message);
+
+/// @brief message for NUMA placement argument
+static const char numa_message[] = "Optional. Pin capture and decoding threads of every channel to a NUMA node: "
+                                   "\"auto\" splits channels into groups per node, or a comma separated list of "
+                                   "node ids per channel. Inference and rendering run on the node with most channels";
+
+/// @brief Placement of the pipeline threads on NUMA nodes
+/// It is a optional parameter
+DEFINE_string(numa, "", numa_message);
+
+/// @brief message for camera i/o argument
+static const char cam_io_message[] = "Optional. Web camera frame buffers when built with the native camera API: "
+                                     "userptr, mmap or dmabuf. Frames are never copied out of them";
+
+/// @brief V4L2 i/o mode of web cameras
+/// It is a optional parameter
+DEFINE_string(cam_io, "userptr", cam_io_message);
+
+/// @brief message for camera format argument
+static const char cam_format_message[] = "Optional. Web camera format when built with the native camera API: mjpeg, "
+                                         "yuyv, nv12 or raw (nv12 or yuyv if supported, mjpeg otherwise). "
+                                         "Raw frames skip decoding and are converted straight into the network input";
+
+/// @brief Capture format of web cameras
+/// It is a optional parameter
+DEFINE_string(cam_format, "mjpeg", cam_format_message);
+
+/// @brief message for camera workers argument
+static const char cam_workers_message[] = "Optional. Threads dequeuing web camera frames per CPU set of the channels (per "
+                                          "NUMA node with -numa) when built with the native camera API, 0 - the thread "
+                                          "waiting for frames";
+
+/// @brief Number of camera worker threads
+/// It is a optional parameter
+DEFINE_uint32(cam_workers, 2, cam_workers_message);
+
+/// @brief message for capture threads argument
+static const char capture_threads_message[] = "Optional. Threads reading and decoding the OpenCV video inputs per CPU "
+                                              "set of the channels (per NUMA node with -numa), the inputs take turns "
+                                              "on them";
+
+/// @brief Number of capture threads
+/// It is a optional parameter
+DEFINE_uint32(capture_threads, 4, capture_threads_message);
+
+/// @brief message for hardware video file decoding flag
+static const char hw_file_decode_message[] = "Optional. Decode H.264/H.265 video files with VA-API through GStreamer and "
+                                             "read them as fast as they are decoded, e.g. to process recordings offline";
+
+/// @brief Flag to decode video files on the GPU
+/// It is a optional parameter
+DEFINE_bool(hw_file_decode, false, hw_file_decode_message);
+
+/// @brief message for input regions
+static const char roi_message[] = "Optional. Regions of the inputs to analyse in the order of the inputs, e.g. "
+                                  "\"0,0,640,360;;100,50,800,600\": x,y,width,height in the frame pixels, an empty "
+                                  "entry is the whole frame. The network input is cut from the region, so its "
+                                  "objects get the whole network resolution";
+
+/// @brief Regions of the inputs
+/// It is a optional parameter
+DEFINE_string(roi, "", roi_message);
+
+/// @brief message for motion gating
+static const char motion_threshold_message[] = "Optional. Skip the inference of a frame when less than this share of "
+                                               "the pixels of its downscaled region changed since the last inferred "
+                                               "frame of its input, the previous results are shown then. "
+                                               "0 - infer every frame. Default value is 0";
+
+/// @brief Share of the changed pixels a frame is inferred from
+/// It is a optional parameter
+DEFINE_double(motion_threshold, 0.0, motion_threshold_message);
+
+/// @brief message for channel weights
+static const char channel_weights_message[] = "Optional. Comma separated weights of the channels, e.g. \"4,1,1\", "
+                                              "the channels without an entry get 1. When the inference can't keep "
+                                              "up, the channels get the frames in the ratio of their weights";
+
+/// @brief Weights of the channels
+/// It is a optional parameter
+DEFINE_string(channel_weights, "", channel_weights_message);
+
+/// @brief message for drain mode flag
+static const char drain_message[] = "Optional. Process every frame of the input video files once as fast as they are "
+                                    "decoded and exit with a throughput summary. Implies -no_show, disables "
+                                    "-loop_video, -real_input_fps and frame dropping";
+
+/// @brief Flag to drain the inputs for benchmarking
+/// It is a optional parameter
+DEFINE_bool(drain, false, drain_message);
+
+/// @brief message for OpenCL rendering flag
+static const char ocl_render_message[] = "Optional. Scale channel frames into the output window with OpenCL "
+                                         "through cv::UMat instead of the CPU threads";
+
+/// @brief Flag to compose the output window with OpenCL
+/// It is a optional parameter
+DEFINE_bool(ocl_render, false, ocl_render_message);
+
+/// @brief message for compiled networks cache flag
+static const char cache_dir_message[] = "Optional. Directory to cache compiled networks in. Later runs import the cached networks "
+                                        "instead of compiling them if the model, device and config didn't change. "
+                                        "Devices without network export support compile on each run";
+
+/// @brief Flag to cache compiled networks
+/// It is a optional parameter
+DEFINE_string(cache_dir, "", cache_dir_message);
+
+/// @brief message for metrics port flag
+static const char metrics_port_message[] = "Optional. Serve the pipeline and system metrics in the OpenMetrics format at "
+                                           "http://<host>:<port>/metrics for Prometheus. 0 disables the endpoint";
+
+/// @brief Flag to serve the metrics at a port
+/// It is a optional parameter
+DEFINE_uint32(metrics_port, 0, metrics_port_message);
+
+/// @brief message for metrics push flag
+static const char metrics_push_message[] = "Optional. Push the metrics to a Prometheus Pushgateway at host:port/path, "
+                                           "e.g. localhost:9091/metrics/job/multichannel, every -fps_sp msec";
+
+/// @brief Flag to push the metrics to a Pushgateway
+/// It is a optional parameter
+DEFINE_string(metrics_push, "", metrics_push_message);
+
+/// @brief message for output stream flag
+static const char out_message[] = "Optional. Encode the output window to H.264 and write it to a file, an RTSP server "
+                                  "(rtsp://...) or a shared memory socket (shm:<socket path>). A target with %d, "
+                                  "e.g. channel%d.mp4, gets a stream per channel instead. Works with -no_show";
+
+/// @brief Flag to encode the output
+/// It is a optional parameter
+DEFINE_string(out, "", out_message);
+
+/// @brief message for output stream fps flag
+static const char out_fps_message[] = "Optional. Frame rate of the -out streams";
+
+/// @brief Flag to set the frame rate of the output streams
+/// It is a optional parameter
+DEFINE_double(out_fps, 25.0, out_fps_message);
+
+/// @brief message for hardware encoding flag
+static const char out_hw_message[] = "Optional. Encode the -out streams by VA-API, falls back to x264 "
+                                     "if it isn't available";
+
+/// @brief Flag to encode the output streams on the GPU
+/// It is a optional parameter
+DEFINE_bool(out_hw, true, out_hw_message);
+
+/// @brief message for frame bus flag
+static const char bus_publish_message[] = "Optional. Publish the decoded input frames to a shared memory frame bus of "
+                                          "this name. Other demos on the host read them by -i bus:<name>/<input index> "
+                                          "instead of opening and decoding the inputs again";
+
+/// @brief Flag to publish the inputs to a frame bus
+/// It is a optional parameter
+DEFINE_string(bus_publish, "", bus_publish_message);
+
+/// @brief message for frame bus subscribers flag
+static const char bus_subscribers_message[] = "Optional. Subscribers the -bus_publish bus takes at once, up to 64";
+
+/// @brief Flag to set the subscribers of the frame bus
+/// It is a optional parameter
+DEFINE_uint32(bus_subscribers, 2, bus_subscribers_message);
+
+/// @brief message for frame bus depth flag
+static const char bus_depth_message[] = "Optional. Frames of an input a subscriber of the -bus_publish bus holds in "
+                                        "shared memory while it analyses them, it copies the frames beyond them. The "
+                                        "bus keeps -bus_subscribers * -bus_depth + 2 frames of every input";
+
+/// @brief Flag to set the frame bus depth
+/// It is a optional parameter
+DEFINE_uint32(bus_depth, 3, bus_depth_message);
+
+/// @brief message for benchmark flag
+static const char bench_message[] = "Optional. Benchmark the steady state for this many seconds after the -bench_warmup "
+                                    "seconds, then exit with a JSON report of the throughput and the latency "
+                                    "distributions of the pipeline stages. 0 - no benchmark";
+
+/// @brief Flag to benchmark the steady state
+/// It is a optional parameter
+DEFINE_uint32(bench, 0, bench_message);
+
+/// @brief message for benchmark warm up flag
+static const char bench_warmup_message[] = "Optional. Seconds of the frames discarded before the -bench measurement";
+
+/// @brief Flag to set the benchmark warm up
+/// It is a optional parameter
+DEFINE_uint32(bench_warmup, 10, bench_warmup_message);
+
+/// @brief message for benchmark report flag
+static const char bench_json_message[] = "Required with -bench. Path to write the -bench report to";
+
+/// @brief Flag to set the benchmark report path
+/// It is a optional parameter
+DEFINE_string(bench_json, "", bench_json_message);
+
+/// @brief message for benchmark tag flag
+static const char bench_tag_message[] = "Optional. A label of the run written to the -bench report, "
+                                        "e.g. the precision of the model for A/B comparisons";
+
+/// @brief Flag to label the benchmark report
+/// It is a optional parameter
+DEFINE_string(bench_tag, "", bench_tag_message);
+
+/// @brief message for warm up runs flag
+static const char warmup_runs_message[] = "Optional. Inferences of every infer request of every device before the first frame";
+
+/// @brief Flag to set the warm up inferences
+/// It is a optional parameter
+DEFINE_uint32(warmup_runs, 1, warmup_runs_message);
+
+/// @brief message for reduced decoding flag
+static const char reduced_decode_message[] = "Optional. Decode the MJPEG camera frames in software at 1/2, 1/4 or 1/8 "
+                                             "of their resolution when that still covers the network input. Ignored with -roi";
+
+/// @brief Flag to decode the frames at a reduced resolution
+/// It is a optional parameter
+DEFINE_bool(reduced_decode, false, reduced_decode_message);
+
+/// @brief message for decoding stripes flag
+static const char decode_stripes_message[] = "Optional. Decode the MJPEG camera frames with restart markers in software "
+                                             "in up to this many bands in parallel";
+
+/// @brief Flag to decode the frames in parallel bands
+/// It is a optional parameter
+DEFINE_uint32(decode_stripes, 1, decode_stripes_message);
+
+/// @brief message for record flag
+static const char record_message[] = "Optional. Record the frames of every input with the moments they were captured "
+                                     "to <dir>/input<index>.caprec. The recordings are replayed by -i <dir>/input<index>.caprec "
+                                     "at the recorded pace, so the runs of different builds get the same input load";
+
+/// @brief Flag to record the inputs
+/// It is a optional parameter
+DEFINE_string(record, "", record_message);
+
+/// @brief message for replay fast flag
+static const char replay_fast_message[] = "Optional. Replay the .caprec inputs as fast as the demo reads them instead of "
+                                          "at the recorded pace";
+
+/// @brief Flag to replay the recordings without pacing
+/// It is a optional parameter
+DEFINE_bool(replay_fast, false, replay_fast_message);
+
+/// @brief message for hugepages flag
+static const char hugepages_message[] = "Optional. Allocate the frames, the preprocessing images and the input blobs "
+                                        "from a 64-byte aligned arena on 2 MB hugepages which keeps the freed "
+                                        "buffers for reuse. Uses the reserved hugepages (vm.nr_hugepages) if there "
+                                        "are free ones, transparent hugepages otherwise. "
+                                        "The arena statistics are printed with the means of the monitors";
+
+/// @brief Flag to allocate from the hugepage arena
+/// It is a optional parameter
+DEFINE_bool(hugepages, false, hugepages_message);
+
+/// @brief message for adaptive decode flag
+static const char adaptive_decode_message[] = "Optional. With hardware decoding, route the MJPEG frames of every input "
+                                              "to VA-API or to the software decoding threads, whichever decodes "
+                                              "faster under the current load. The routes are reconsidered every "
+                                              "second and printed with the statistics. Ignored with -remote_blobs";
+
+/// @brief Flag to route the frames between the hardware and the software decoding
+/// It is a optional parameter
+DEFINE_bool(adaptive_decode, false, adaptive_decode_message);
+
+/// @brief message for thread shares flag
+static const char thread_shares_message[] = "Optional. Comma separated weights the hardware threads are split by "
+                                            "between the CPU inference streams, the OpenCV parallel loops and the "
+                                            "decoding and postprocessing threads of the pipeline, so they don't "
+                                            "oversubscribe the cores, e.g. \"2,1,1\". Every share is at least one "
+                                            "thread, the split is printed at startup. Empty - the default sizes of "
+                                            "the pools";
+
+/// @brief Flag to split the threads between the inference, OpenCV and the pipeline
+/// It is a optional parameter
+DEFINE_string(thread_shares, "", thread_shares_message);
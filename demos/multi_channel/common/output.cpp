@@ -6,48 +6,46 @@
 #include <vector>
 #include <utility>
 
+#include <samples/instrumentation.hpp>
+
 #include "output.hpp"
 
-AsyncOutput::AsyncOutput(bool collectStats, size_t queueSize,
-                         DrawFunc drawFunc):
+AsyncOutput::AsyncOutput(bool collectStats, size_t queueSize, OverflowPolicy overflowPolicy,
+                         size_t numChannels, DrawFunc drawFunc):
     queueSize(queueSize),
+    overflowPolicy(overflowPolicy),
+    droppedFrames(numChannels),
     drawFunc(std::move(drawFunc)),
+    queue(queueSize),
     perfTimer(collectStats ? PerfTimer::DefaultIterationsCount : 0) {}
 
 AsyncOutput::~AsyncOutput() {
     terminate = true;
-    condVar.notify_one();
     if (thread.joinable()) {
         thread.join();
     }
 }
 
 void AsyncOutput::push(std::vector<std::shared_ptr<VideoFrame> > &&item) {
-    std::unique_lock<std::mutex> lock(mutex);
-    while (queue.size() >= queueSize) {
-        queue.pop();
+    std::vector<std::vector<std::shared_ptr<VideoFrame>>> dropped;
+    // blocking gives up once the renderer is gone, the results are not counted as dropped then
+    pushWithPolicy(queue, std::move(item), overflowPolicy, [&]() { return terminate.load(); }, dropped);
+    for (const auto& results : dropped) {
+        for (const auto& frame : results) {
+            droppedFrames.add(frame->sourceIdx);
+        }
     }
-    queue.push(std::move(item));
-    lock.unlock();
-    condVar.notify_one();
 }
 
 void AsyncOutput::start() {
     thread = std::thread([&]() {
+        instrumentation::registerCurrentThread("output");
         std::vector<std::shared_ptr<VideoFrame>> elem;
         while (!terminate) {
-            std::unique_lock<std::mutex> lock(mutex);
-            condVar.wait(lock, [&]() {
-                return !queue.empty() || terminate;
-            });
-            if (queue.empty()) {
+            if (!queue.pop(elem, [&]() { return terminate.load(); })) {
                 break;
             }
 
-            elem = std::move(queue.front());
-            queue.pop();
-            lock.unlock();
-
             if (perfTimer.enabled()) {
                 ScopedTimer sc(perfTimer);
                 if (!drawFunc(elem)) {
@@ -67,5 +65,6 @@ bool AsyncOutput::isAlive() const {
 }
 
 AsyncOutput::Stats AsyncOutput::getStats() const {
-    return Stats{perfTimer.getValue()};
+    const auto renderTimeStats = perfTimer.getStats();
+    return Stats{renderTimeStats.mean, renderTimeStats, droppedFrames.get()};
 }
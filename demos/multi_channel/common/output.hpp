@@ -4,40 +4,43 @@
 
 #pragma once
 
-#include <queue>
 #include <vector>
 #include <thread>
-#include <mutex>
-#include <condition_variable>
 #include <atomic>
 #include <functional>
 #include <memory>
 
+#include "backpressure.hpp"
 #include "graph.hpp"
 #include "perf_timer.hpp"
+#include "ring_buffer.hpp"
 
 class AsyncOutput{
 public:
     using DrawFunc = std::function<bool(const std::vector<std::shared_ptr<VideoFrame>>&)>;
 
-    AsyncOutput(bool collectStats, size_t queueSize, DrawFunc drawFunc);
+    // drops are counted per VideoFrame::sourceIdx below numChannels
+    AsyncOutput(bool collectStats, size_t queueSize, OverflowPolicy overflowPolicy,
+                size_t numChannels, DrawFunc drawFunc);
     ~AsyncOutput();
     void push(std::vector<std::shared_ptr<VideoFrame>>&& item);
     void start();
     bool isAlive() const;
     struct Stats {
         float renderTime;
+        PerfTimer::Stats renderTimeStats;  // distribution of renderTime
+        std::vector<std::size_t> droppedFrames;  // per channel
     };
     Stats getStats() const;
 
 private:
     const size_t queueSize;
+    const OverflowPolicy overflowPolicy;
+    DropCounters droppedFrames;
     DrawFunc drawFunc;
-    std::queue<std::vector<std::shared_ptr<VideoFrame>>> queue;
+    RingBuffer<std::vector<std::shared_ptr<VideoFrame>>> queue;
     std::atomic_bool terminate = {false};
     std::thread thread;
-    std::mutex mutex;
-    std::condition_variable condVar;
 
     PerfTimer perfTimer;
 };
@@ -2,15 +2,130 @@
 // SPDX-License-Identifier: Apache-2.0
 //
 
+#include <algorithm>
+#include <limits>
+
 #include "perf_timer.hpp"
 
+void PerfTimer::Generation::clear() {
+    for (auto& bucket : buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    count.store(0, std::memory_order_relaxed);
+    sum.store(0, std::memory_order_relaxed);
+    min.store(std::numeric_limits<std::uint64_t>::max(), std::memory_order_relaxed);
+    max.store(0, std::memory_order_relaxed);
+}
+
 PerfTimer::PerfTimer(size_t maxCount_):
     maxCount(maxCount_) {
-    values.reserve(maxCount);
+    for (auto& generation : generations) {
+        generation.clear();
+    }
+}
+
+std::size_t PerfTimer::getBucket(std::uint64_t usec) {
+    usec = std::min<std::uint64_t>(usec, (std::uint64_t(1) << MaxValueBits) - 1);
+    if (usec < SubBuckets) {
+        return static_cast<std::size_t>(usec);
+    }
+    unsigned msb = SubBucketBits;
+    while ((usec >> (msb + 1)) != 0) {
+        ++msb;
+    }
+    const auto subBucket = (usec >> (msb - SubBucketBits)) & (SubBuckets - 1);
+    return (msb - SubBucketBits + 1) * SubBuckets + static_cast<std::size_t>(subBucket);
+}
+
+std::uint64_t PerfTimer::getBucketMiddle(std::size_t bucket) {
+    if (bucket < SubBuckets) {
+        return bucket;
+    }
+    const unsigned shift = static_cast<unsigned>(bucket / SubBuckets) - 1;
+    const std::uint64_t lower = (SubBuckets + bucket % SubBuckets) << shift;
+    return lower + ((std::uint64_t(1) << shift) >> 1);
+}
+
+void PerfTimer::addMicroseconds(std::uint64_t usec) {
+    const auto index = totalCount.fetch_add(1, std::memory_order_relaxed);
+    const auto epoch = index / maxCount;
+    if (0 == index % maxCount) {
+        // writers still in the previous epoch use another generation than the one being cleared
+        generations[(epoch + 1) % GenerationsCount].clear();
+    }
+    auto& generation = generations[epoch % GenerationsCount];
+    generation.buckets[getBucket(usec)].fetch_add(1, std::memory_order_relaxed);
+    generation.sum.fetch_add(usec, std::memory_order_relaxed);
+
+    auto current = generation.min.load(std::memory_order_relaxed);
+    while (usec < current && !generation.min.compare_exchange_weak(current, usec, std::memory_order_relaxed)) {}
+    current = generation.max.load(std::memory_order_relaxed);
+    while (usec > current && !generation.max.compare_exchange_weak(current, usec, std::memory_order_relaxed)) {}
+
+    generation.count.fetch_add(1, std::memory_order_release);
+}
+
+PerfTimer::Stats PerfTimer::getStats() const {
+    Stats stats;
+    if (!enabled()) {
+        return stats;
+    }
+    const auto epoch = totalCount.load(std::memory_order_acquire) / maxCount;
+    const Generation* window[] = {
+        &generations[epoch % GenerationsCount],
+        &generations[(epoch + GenerationsCount - 1) % GenerationsCount]
+    };
+    const std::size_t windowSize = epoch > 0 ? 2 : 1;
+
+    std::uint64_t buckets[BucketsCount] = {};
+    std::uint64_t sum = 0;
+    std::uint64_t min = std::numeric_limits<std::uint64_t>::max();
+    std::uint64_t max = 0;
+    for (std::size_t i = 0; i < windowSize; ++i) {
+        auto& generation = *window[i];
+        if (0 == generation.count.load(std::memory_order_acquire)) {
+            continue;
+        }
+        for (std::size_t bucket = 0; bucket < BucketsCount; ++bucket) {
+            buckets[bucket] += generation.buckets[bucket].load(std::memory_order_relaxed);
+        }
+        sum += generation.sum.load(std::memory_order_relaxed);
+        min = std::min<std::uint64_t>(min, generation.min.load(std::memory_order_relaxed));
+        max = std::max<std::uint64_t>(max, generation.max.load(std::memory_order_relaxed));
+    }
+    // buckets are updated before the counters, so count them as the sample number
+    std::uint64_t count = 0;
+    for (auto value : buckets) {
+        count += value;
+    }
+    if (0 == count) {
+        return stats;
+    }
+
+    auto toMsec = [](std::uint64_t usec) { return static_cast<float>(usec) / 1000.0f; };
+    auto percentile = [&](float share) {
+        const auto rank = static_cast<std::uint64_t>(share * static_cast<float>(count - 1)) + 1;
+        std::uint64_t accumulated = 0;
+        for (std::size_t bucket = 0; bucket < BucketsCount; ++bucket) {
+            accumulated += buckets[bucket];
+            if (accumulated >= rank) {
+                return toMsec(std::min(std::max(getBucketMiddle(bucket), min), max));
+            }
+        }
+        return toMsec(max);
+    };
+    stats.count = count;
+    stats.mean = toMsec(sum) / static_cast<float>(count);
+    stats.min = toMsec(min);
+    stats.max = toMsec(max);
+    stats.p50 = percentile(0.50f);
+    stats.p95 = percentile(0.95f);
+    stats.p99 = percentile(0.99f);
+    return stats;
 }
 
 float PerfTimer::getValue() const {
-    return avgValue;
+    return getStats().mean;
 }
 
 bool PerfTimer::enabled() const {
@@ -5,40 +5,80 @@
 #pragma once
 
 #include <cassert>
-#include <vector>
+#include <cstdint>
 #include <chrono>
 #include <atomic>
-#include <numeric>
 
+/**
+* \brief Fixed memory latency histogram safe to update from any thread without locks.
+* Buckets are log-linear (16 per power of two of microseconds) like in HDR histograms, so
+* percentiles are within ~6% of the real value. Statistics cover a rolling window of the
+* last maxCount to 2 * maxCount samples.
+*/
 class PerfTimer final {
-    const size_t maxCount;
-    using duration = std::chrono::duration<float, std::milli>;
-    std::vector<duration> values;
-    std::atomic<float> avgValue = {0.0f};
-
 public:
     enum {
         DefaultIterationsCount = 50
     };
 
+    struct Stats {
+        std::uint64_t count = 0;  // samples in the window
+        float mean = 0.0f;        // msec
+        float min = 0.0f;
+        float max = 0.0f;
+        float p50 = 0.0f;
+        float p95 = 0.0f;
+        float p99 = 0.0f;
+    };
+
     explicit PerfTimer(size_t maxCount_);
 
+    PerfTimer(const PerfTimer&) = delete;
+    PerfTimer& operator =(const PerfTimer&) = delete;
+
     template<typename T>
     void addValue(const T& dur) {
         assert(enabled());
-        values.push_back(std::chrono::duration_cast<duration>(dur));
-        if (values.size() >= maxCount) {
-            auto res = std::accumulate(values.begin(),
-                                       values.end(),
-                                       duration(0.0f));
-            avgValue = res.count() / static_cast<float>(values.size());
-            values.clear();
-        }
+        const auto usec = std::chrono::duration_cast<std::chrono::microseconds>(dur).count();
+        addMicroseconds(usec > 0 ? static_cast<std::uint64_t>(usec) : 0);
     }
 
+    // mean over the window in msec
     float getValue() const;
 
+    Stats getStats() const;
+
     bool enabled() const;
+
+private:
+    enum {
+        SubBuckets = 16,  // per power of two, must match SubBucketBits
+        SubBucketBits = 4,
+        MaxValueBits = 31,  // longer samples are clamped to ~35 min
+        BucketsCount = (MaxValueBits - SubBucketBits + 1) * SubBuckets,
+        // samples are written to one generation, the previous one is still reported
+        // and the next one is cleared when its epoch begins
+        GenerationsCount = 3
+    };
+
+    struct Generation {
+        std::atomic<std::uint32_t> buckets[BucketsCount];
+        std::atomic<std::uint64_t> count;
+        std::atomic<std::uint64_t> sum;  // usec
+        std::atomic<std::uint64_t> min;
+        std::atomic<std::uint64_t> max;
+
+        void clear();
+    };
+
+    const size_t maxCount;
+    std::atomic<std::uint64_t> totalCount = {0};
+    Generation generations[GenerationsCount];
+
+    void addMicroseconds(std::uint64_t usec);
+
+    static std::size_t getBucket(std::uint64_t usec);
+    static std::uint64_t getBucketMiddle(std::size_t bucket);
 };
 
 struct ScopedTimer final{
@@ -0,0 +1,206 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "placement.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <samples/slog.hpp>
+
+#include "threading.hpp"
+
+namespace {
+// parses sysfs lists like "0-3,8-11"
+std::vector<unsigned> parseList(const std::string& list) {
+    std::vector<unsigned> ret;
+    std::stringstream stream(list);
+    std::string range;
+    while (std::getline(stream, range, ',')) {
+        if (range.empty() || range == "\n") {
+            continue;
+        }
+        const auto dash = range.find('-');
+        const unsigned first = static_cast<unsigned>(std::stoul(range.substr(0, dash)));
+        const unsigned last = std::string::npos == dash ? first :
+                              static_cast<unsigned>(std::stoul(range.substr(dash + 1)));
+        for (unsigned i = first; i <= last; ++i) {
+            ret.push_back(i);
+        }
+    }
+    return ret;
+}
+
+bool readList(const std::string& path, std::vector<unsigned>& list) {
+    std::ifstream file(path);
+    std::string line;
+    if (!file || !std::getline(file, line)) {
+        return false;
+    }
+    list = parseList(line);
+    return true;
+}
+
+std::vector<unsigned> getAllowedCpus() {
+    std::vector<unsigned> ret;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (0 == sched_getaffinity(0, sizeof(set), &set)) {
+        for (unsigned i = 0; i < CPU_SETSIZE; ++i) {
+            if (CPU_ISSET(i, &set)) {
+                ret.push_back(i);
+            }
+        }
+        return ret;
+    }
+#endif
+    for (unsigned i = 0; i < std::max(1u, std::thread::hardware_concurrency()); ++i) {
+        ret.push_back(i);
+    }
+    return ret;
+}
+
+std::string toString(const std::vector<unsigned>& list) {
+    std::stringstream ret;
+    for (std::size_t i = 0; i < list.size(); ++i) {
+        std::size_t last = i;
+        while (last + 1 < list.size() && list[last + 1] == list[last] + 1) {
+            ++last;
+        }
+        ret << (i > 0 ? "," : "") << list[i];
+        if (last > i) {
+            ret << "-" << list[last];
+        }
+        i = last;
+    }
+    return ret.str();
+}
+}  // namespace
+
+std::vector<ThreadPlacement::Node> ThreadPlacement::readTopology() {
+    const auto allowed = getAllowedCpus();
+    std::vector<Node> ret;
+    std::vector<unsigned> online;
+    if (readList("/sys/devices/system/node/online", online)) {
+        for (auto id : online) {
+            std::vector<unsigned> cpus;
+            if (!readList("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist", cpus)) {
+                continue;
+            }
+            Node node;
+            node.id = static_cast<int>(id);
+            std::copy_if(cpus.begin(), cpus.end(), std::back_inserter(node.cpus), [&](unsigned cpu) {
+                return std::find(allowed.begin(), allowed.end(), cpu) != allowed.end();
+            });
+            if (!node.cpus.empty()) {
+                ret.push_back(std::move(node));
+            }
+        }
+    }
+    if (ret.empty()) {
+        Node node;
+        node.cpus = allowed;
+        ret.push_back(std::move(node));
+    }
+    return ret;
+}
+
+ThreadPlacement::ThreadPlacement(const std::string& config, std::size_t channelsCount) {
+    if (config.empty() || 0 == channelsCount) {
+        return;
+    }
+    nodes = readTopology();
+    if ("auto" == config) {
+        for (std::size_t i = 0; i < channelsCount; ++i) {
+            channelNodes.push_back(i * nodes.size() / channelsCount);
+        }
+    } else {
+        std::vector<std::size_t> list;
+        std::stringstream stream(config);
+        std::string id;
+        while (std::getline(stream, id, ',')) {
+            auto node = std::find_if(nodes.begin(), nodes.end(), [&](const Node& n) {
+                return std::to_string(n.id) == id;
+            });
+            if (nodes.end() == node) {
+                throw std::invalid_argument("Unknown NUMA node or node without allowed CPUs: " + id);
+            }
+            list.push_back(static_cast<std::size_t>(node - nodes.begin()));
+        }
+        if (list.empty()) {
+            throw std::invalid_argument("Empty NUMA placement list");
+        }
+        for (std::size_t i = 0; i < channelsCount; ++i) {
+            channelNodes.push_back(list[i % list.size()]);
+        }
+    }
+
+    std::vector<std::size_t> channelsPerNode(nodes.size(), 0);
+    for (auto node : channelNodes) {
+        ++channelsPerNode[node];
+    }
+    mainNode = static_cast<std::size_t>(std::max_element(channelsPerNode.begin(), channelsPerNode.end()) -
+                                        channelsPerNode.begin());
+}
+
+std::vector<unsigned> ThreadPlacement::getChannelCpus(std::size_t channel) const {
+    if (channel >= channelNodes.size()) {
+        return {};
+    }
+    return nodes[channelNodes[channel]].cpus;
+}
+
+std::vector<std::vector<unsigned>> ThreadPlacement::getChannelsCpus() const {
+    std::vector<std::vector<unsigned>> ret;
+    for (std::size_t i = 0; i < channelNodes.size(); ++i) {
+        ret.push_back(getChannelCpus(i));
+    }
+    return ret;
+}
+
+void ThreadPlacement::pinMainThread() const {
+    if (!enabled()) {
+        return;
+    }
+    if (!pinCurrentThread(nodes[mainNode].cpus)) {
+        slog::warn << "Failed to pin threads to NUMA node " << nodes[mainNode].id << slog::endl;
+        return;
+    }
+#ifndef USE_TBB
+    get_thread_pool();  // the pool is created on first use, its workers must inherit the mask
+#endif
+}
+
+void ThreadPlacement::report() const {
+    if (!enabled()) {
+        return;
+    }
+    slog::info << "Thread placement:" << slog::endl;
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        std::stringstream channels;
+        for (std::size_t c = 0; c < channelNodes.size(); ++c) {
+            if (channelNodes[c] == i) {
+                channels << " " << c;
+            }
+        }
+        if (channels.str().empty() && i != mainNode) {
+            continue;
+        }
+        slog::info << "\tNUMA node " << nodes[i].id << " (CPUs " << toString(nodes[i].cpus) << "):"
+                   << (channels.str().empty() ? "" : " channels" + channels.str())
+                   << (i == mainNode ? " inference and rendering" : "") << slog::endl;
+    }
+}
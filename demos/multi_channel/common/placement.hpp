@@ -0,0 +1,83 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+/**
+* \brief Pins the calling thread to the CPUs, threads it creates afterwards inherit the mask. It is inline for
+* the multicam library, which can't link the common one
+* \return false if pinning is not supported or failed, the thread keeps floating then
+*/
+inline bool pinCurrentThread(const std::vector<unsigned>& cpus) {
+#ifdef __linux__
+    if (cpus.empty()) {
+        return false;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (auto cpu : cpus) {
+        if (cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    return 0 == pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)cpus;
+    return false;
+#endif
+}
+
+/**
+* \brief Splits input channels between NUMA nodes, so capture and decoding of a channel run
+* on one node and allocate frames from its memory (Linux allocates pages on first touch).
+* Inference and rendering go to the node that serves most channels.
+*/
+class ThreadPlacement final {
+public:
+    struct Node {
+        int id = 0;
+        std::vector<unsigned> cpus;  // only the ones the process is allowed to run on
+    };
+
+    /**
+    * \param config "" - threads are not pinned, "auto" - consecutive channel groups of equal size
+    * per node, or a comma separated list of node ids per channel repeated for the remaining channels
+    * \throw std::invalid_argument for unknown nodes or a malformed list
+    */
+    ThreadPlacement(const std::string& config, std::size_t channelsCount);
+
+    bool enabled() const {
+        return !channelNodes.empty();
+    }
+
+    // empty when placement is disabled
+    std::vector<unsigned> getChannelCpus(std::size_t channel) const;
+    std::vector<std::vector<unsigned>> getChannelsCpus() const;
+
+    /**
+    * \brief Pins the calling thread to the main node, should run before the inference, rendering
+    * and worker pool threads are created so they inherit the mask
+    */
+    void pinMainThread() const;
+
+    // logs the node of every channel and of the main thread
+    void report() const;
+
+    // online NUMA nodes with at least one allowed CPU, a single node holding all CPUs without sysfs
+    static std::vector<Node> readTopology();
+
+private:
+    std::vector<Node> nodes;
+    std::vector<std::size_t> channelNodes;  // index in nodes per channel
+    std::size_t mainNode = 0;
+};
@@ -0,0 +1,131 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "raw_image.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+// source index pair and 8 bit weight of the second one for a destination coordinate
+struct Tap {
+    int i0;
+    int i1;
+    int w1;
+};
+
+std::vector<Tap> makeTaps(int dstLen, int srcLen) {
+    assert(dstLen > 0);
+    assert(srcLen > 0);
+    std::vector<Tap> taps(static_cast<std::size_t>(dstLen));
+    const float scale = static_cast<float>(srcLen) / static_cast<float>(dstLen);
+    for (int d = 0; d < dstLen; ++d) {
+        // pixel centers are aligned like in cv::resize with INTER_LINEAR
+        const float s = std::max(0.0f, (static_cast<float>(d) + 0.5f) * scale - 0.5f);
+        auto& tap = taps[static_cast<std::size_t>(d)];
+        tap.i0 = std::min(static_cast<int>(s), srcLen - 1);
+        tap.i1 = std::min(tap.i0 + 1, srcLen - 1);
+        tap.w1 = tap.i0 == tap.i1 ? 0 : static_cast<int>((s - static_cast<float>(tap.i0)) * 256.0f + 0.5f);
+    }
+    return taps;
+}
+
+inline int lerp(int a, int b, int w1) {
+    return (a * (256 - w1) + b * w1 + 128) >> 8;
+}
+
+inline int sample(const std::uint8_t* row0, const std::uint8_t* row1, const Tap& x, int yw,
+                  int step, int offset) {
+    return lerp(lerp(row0[x.i0 * step + offset], row0[x.i1 * step + offset], x.w1),
+                lerp(row1[x.i0 * step + offset], row1[x.i1 * step + offset], x.w1), yw);
+}
+
+inline std::uint8_t saturate(int val) {
+    return static_cast<std::uint8_t>(std::min(255, std::max(0, val)));
+}
+
+// Store(int y, int x, int b, int g, int r) receives every destination pixel
+template<typename Store>
+void convert(const RawImage& src, cv::Size dstSize, Store&& store) {
+    if (src.empty()) {
+        throw std::invalid_argument("No raw image to convert");
+    }
+    const bool nv12 = RawImage::NV12 == src.format;
+    const int width = src.size.width;
+    const int height = src.size.height;
+    const int chromaHeight = nv12 ? height / 2 : height;
+    // luma and chroma steps and offsets within a row
+    const int lumaStep = nv12 ? 1 : 2;
+    const int chromaStep = nv12 ? 2 : 4;
+    const int uOffset = nv12 ? 0 : 1;
+    const int vOffset = nv12 ? 1 : 3;
+    const std::uint8_t* chromaPlane = nv12 ? src.data + src.stride * static_cast<std::size_t>(height) : src.data;
+
+    const auto lumaX = makeTaps(dstSize.width, width);
+    const auto chromaX = makeTaps(dstSize.width, width / 2);
+    const auto lumaY = makeTaps(dstSize.height, height);
+    const auto chromaY = makeTaps(dstSize.height, chromaHeight);
+
+    for (int y = 0; y < dstSize.height; ++y) {
+        const auto& ly = lumaY[static_cast<std::size_t>(y)];
+        const auto& cy = chromaY[static_cast<std::size_t>(y)];
+        const std::uint8_t* l0 = src.data + src.stride * static_cast<std::size_t>(ly.i0);
+        const std::uint8_t* l1 = src.data + src.stride * static_cast<std::size_t>(ly.i1);
+        const std::uint8_t* c0 = chromaPlane + src.stride * static_cast<std::size_t>(cy.i0);
+        const std::uint8_t* c1 = chromaPlane + src.stride * static_cast<std::size_t>(cy.i1);
+        for (int x = 0; x < dstSize.width; ++x) {
+            const auto& lx = lumaX[static_cast<std::size_t>(x)];
+            const auto& cx = chromaX[static_cast<std::size_t>(x)];
+            // BT.601 limited range in 10 bit fixed point, like cv::COLOR_YUV2BGR_*
+            const int c = (sample(l0, l1, lx, ly.w1, lumaStep, 0) - 16) * 1192;
+            const int u = sample(c0, c1, cx, cy.w1, chromaStep, uOffset) - 128;
+            const int v = sample(c0, c1, cx, cy.w1, chromaStep, vOffset) - 128;
+            store(y, x,
+                  (c + 2066 * u + 512) >> 10,
+                  (c - 833 * v - 400 * u + 512) >> 10,
+                  (c + 1634 * v + 512) >> 10);
+        }
+    }
+}
+}  // namespace
+
+void rawToChwF32(const RawImage& src, cv::Size dstSize, float* dst) {
+    assert(nullptr != dst);
+    const std::size_t planeSize = static_cast<std::size_t>(dstSize.area());
+    convert(src, dstSize, [&](int y, int x, int b, int g, int r) {
+        const std::size_t idx = static_cast<std::size_t>(y) * static_cast<std::size_t>(dstSize.width) +
+                                static_cast<std::size_t>(x);
+        dst[idx] = static_cast<float>(saturate(b));
+        dst[planeSize + idx] = static_cast<float>(saturate(g));
+        dst[2 * planeSize + idx] = static_cast<float>(saturate(r));
+    });
+}
+
+void rawToHwcU8(const RawImage& src, cv::Size dstSize, std::uint8_t* dst) {
+    assert(nullptr != dst);
+    convert(src, dstSize, [&](int y, int x, int b, int g, int r) {
+        auto pixel = dst + 3 * (static_cast<std::size_t>(y) * static_cast<std::size_t>(dstSize.width) +
+                                static_cast<std::size_t>(x));
+        pixel[0] = saturate(b);
+        pixel[1] = saturate(g);
+        pixel[2] = saturate(r);
+    });
+}
+
+cv::Mat rawToBgr(const RawImage& src) {
+    if (src.empty()) {
+        return {};
+    }
+    cv::Mat bgr;
+    auto data = const_cast<std::uint8_t*>(src.data);
+    if (RawImage::NV12 == src.format) {
+        cv::cvtColor(cv::Mat(src.size.height * 3 / 2, src.size.width, CV_8UC1, data, src.stride),
+                     bgr, cv::COLOR_YUV2BGR_NV12);
+    } else {
+        cv::cvtColor(cv::Mat(src.size, CV_8UC2, data, src.stride), bgr, cv::COLOR_YUV2BGR_YUYV);
+    }
+    return bgr;
+}
@@ -0,0 +1,49 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <opencv2/opencv.hpp>
+
+/**
+* \brief Uncompressed camera frame left in its capture buffer, the buffer goes back to the
+* camera when the last copy of holder is released
+*/
+struct RawImage {
+    enum Format {
+        None,
+        YUYV,  // packed 4:2:2
+        NV12   // Y plane followed by interleaved UV plane, 4:2:0
+    };
+
+    Format format = None;
+    const std::uint8_t* data = nullptr;
+    cv::Size size;
+    std::size_t stride = 0;  // bytes per row of the Y plane (of the packed data for YUYV)
+    std::shared_ptr<void> holder;
+
+    bool empty() const {
+        return None == format || nullptr == data;
+    }
+};
+
+/**
+* \brief Converts BT.601 YUV to planar BGR floats of dstSize, resizing bilinearly on the way,
+* so the capture buffer is read once and written straight into a network input blob
+*/
+void rawToChwF32(const RawImage& src, cv::Size dstSize, float* dst);
+
+/**
+* \brief Same as rawToChwF32 for interleaved 8 bit BGR, e.g. a U8/NHWC input blob
+*/
+void rawToHwcU8(const RawImage& src, cv::Size dstSize, std::uint8_t* dst);
+
+/**
+* \brief Full size BGR image, e.g. for display
+*/
+cv::Mat rawToBgr(const RawImage& src);
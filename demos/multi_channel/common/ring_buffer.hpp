@@ -0,0 +1,195 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
+
+/**
+* \brief Exponential backoff for busy waiting: spins on the cpu first,
+* then yields and finally sleeps for increasing periods.
+*/
+class Backoff final {
+    unsigned step = 0;
+
+    enum {
+        SpinSteps = 6,   // up to 2^6 pause instructions per step
+        YieldSteps = 16,
+        MaxSleepMicrosec = 500
+    };
+
+    static void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+        _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+        __asm__ __volatile__("yield");
+#endif
+    }
+
+public:
+    void pause() {
+        if (step < SpinSteps) {
+            for (unsigned i = 0; i < (1u << step); ++i) {
+                cpuRelax();
+            }
+        } else if (step < YieldSteps) {
+            std::this_thread::yield();
+        } else {
+            auto sleepTime = std::min<unsigned>(MaxSleepMicrosec, 10u << std::min<unsigned>(step - YieldSteps, 6u));
+            std::this_thread::sleep_for(std::chrono::microseconds(sleepTime));
+        }
+        ++step;
+    }
+
+    void reset() {
+        step = 0;
+    }
+};
+
+/**
+* \brief Bounded lock-free multi-producer multi-consumer queue
+* (D. Vyukov's sequence-numbered cell algorithm). A cell of a single one can't tell full from empty,
+* so a queue of a capacity of 1 has two cells and limits its size on its own.
+*/
+template<typename T>
+class RingBuffer final {
+    struct Cell {
+        std::atomic<std::size_t> sequence;
+        T data;
+    };
+
+    static constexpr std::size_t CacheLineSize = 64;
+
+    const std::size_t capacity;
+    const std::size_t cellsCount;
+    std::unique_ptr<Cell[]> cells;
+
+    // padding keeps producer and consumer positions on separate cache lines
+    char padding0[CacheLineSize];
+    std::atomic<std::size_t> enqueuePos = {0};
+    char padding1[CacheLineSize];
+    std::atomic<std::size_t> dequeuePos = {0};
+
+public:
+    explicit RingBuffer(std::size_t capacity_):
+        capacity(capacity_), cellsCount(std::max<std::size_t>(capacity_, 2)), cells(new Cell[cellsCount]) {
+        assert(capacity > 0);
+        for (std::size_t i = 0; i < cellsCount; ++i) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    RingBuffer(const RingBuffer&) = delete;
+    RingBuffer& operator =(const RingBuffer&) = delete;
+
+    /**
+    * \brief Enqueues the value if there is free space. The value is moved from only on success.
+    */
+    bool tryPush(T&& value) {
+        Cell* cell = nullptr;
+        std::size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &cells[pos % cellsCount];
+            std::size_t seq = cell->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (0 == diff) {
+                if (capacity < cellsCount && pos >= dequeuePos.load(std::memory_order_acquire) + capacity) {
+                    return false;  // full, the spare cell is free
+                }
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;  // full
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& value) {
+        Cell* cell = nullptr;
+        std::size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &cells[pos % cellsCount];
+            std::size_t seq = cell->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (0 == diff) {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;  // empty
+            } else {
+                pos = dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+        value = std::move(cell->data);
+        cell->data = T();  // do not keep resources of the popped element alive
+        cell->sequence.store(pos + cellsCount, std::memory_order_release);
+        return true;
+    }
+
+    /**
+    * \brief Blocks with backoff until the value is enqueued or stop() returns true.
+    */
+    template<typename StopPred>
+    bool push(T&& value, StopPred&& stop) {
+        Backoff backoff;
+        while (!tryPush(std::move(value))) {
+            if (stop()) {
+                return false;
+            }
+            backoff.pause();
+        }
+        return true;
+    }
+
+    /**
+    * \brief Blocks with backoff until a value is dequeued or stop() returns true.
+    * Elements still in the queue are returned even after stop() became true.
+    */
+    template<typename StopPred>
+    bool pop(T& value, StopPred&& stop) {
+        Backoff backoff;
+        while (!tryPop(value)) {
+            if (stop()) {
+                return tryPop(value);
+            }
+            backoff.pause();
+        }
+        return true;
+    }
+
+    /**
+    * \brief Approximate number of elements, exact only when there are no concurrent operations.
+    */
+    std::size_t size() const {
+        auto head = dequeuePos.load(std::memory_order_acquire);
+        auto tail = enqueuePos.load(std::memory_order_acquire);
+        return tail > head ? tail - head : 0;
+    }
+
+    bool empty() const {
+        return 0 == size();
+    }
+
+    std::size_t getCapacity() const {
+        return capacity;
+    }
+};
@@ -0,0 +1,119 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <ie_iextension.h>
+
+#include <samples/network_cache.hpp>
+#include <samples/slog.hpp>
+
+#include "shared_inference.hpp"
+
+SharedInference& SharedInference::instance() {
+    static SharedInference sharedInference;
+    return sharedInference;
+}
+
+InferenceEngine::Core& SharedInference::core() {
+    return ie;
+}
+
+void SharedInference::addCpuExtension(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    // the plugin refuses the layers of a library added again
+    if (cpuExtensions.insert(path).second) {
+        ie.AddExtension(InferenceEngine::make_so_pointer<InferenceEngine::IExtension>(path), "CPU");
+    }
+}
+
+std::string SharedInference::describe(const InferenceEngine::CNNNetwork& network, const std::string& modelPath,
+                                      const std::string& deviceName,
+                                      const std::map<std::string, std::string>& config) const {
+    std::string description = network_cache::describe(ie, network, modelPath, deviceName, config);
+    if (description.empty()) {
+        return description;
+    }
+    // unlike the exported networks the loaded ones keep the preprocessing of their inputs
+    for (const auto& input : network.getInputsInfo()) {
+        const InferenceEngine::PreProcessInfo& preProcess = input.second->getPreProcess();
+        description += ";pre " + input.first + ' ' + std::to_string(preProcess.getResizeAlgorithm()) + ' '
+            + std::to_string(preProcess.getMeanVariant()) + ' ' + std::to_string(preProcess.getColorFormat());
+    }
+    return description;
+}
+
+std::shared_ptr<InferenceEngine::ExecutableNetwork> SharedInference::findNetwork(
+        const InferenceEngine::CNNNetwork& network, const std::string& modelPath, const std::string& deviceName,
+        const std::map<std::string, std::string>& config) {
+    const std::string description = describe(network, modelPath, deviceName, config);
+    std::lock_guard<std::mutex> lock(mutex);
+    pruneNetworks();
+    auto found = networks.find(description);
+    return description.empty() || networks.end() == found ? nullptr : found->second.lock();
+}
+
+std::shared_ptr<InferenceEngine::ExecutableNetwork> SharedInference::loadNetwork(
+        const InferenceEngine::CNNNetwork& network, const std::string& modelPath, const std::string& deviceName,
+        const std::map<std::string, std::string>& config, const std::string& cacheDir) {
+    const std::string description = describe(network, modelPath, deviceName, config);
+    // the loads are serialized, so two graphs never compile the same network at once
+    std::lock_guard<std::mutex> lock(mutex);
+    pruneNetworks();
+    if (!description.empty()) {
+        auto found = networks.find(description);
+        if (networks.end() != found) {
+            if (auto executableNetwork = found->second.lock()) {
+                stats.reusedNetworks++;
+                slog::info << "Reusing the network of " << modelPath << " loaded to " << deviceName
+                           << " by another pipeline" << slog::endl;
+                return executableNetwork;
+            }
+        }
+    }
+    auto executableNetwork = std::make_shared<InferenceEngine::ExecutableNetwork>(
+        loadNetworkCached(ie, network, modelPath, deviceName, config, cacheDir));
+    stats.loadedNetworks++;
+    if (!description.empty()) {
+        networks[description] = executableNetwork;
+    }
+    return executableNetwork;
+}
+
+void SharedInference::pruneNetworks() {
+    for (auto it = networks.begin(); it != networks.end();) {
+        if (it->second.expired()) {
+            it = networks.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void SharedInference::setCpuBudget(std::size_t cores) {
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.cpuBudget = cores;
+}
+
+std::size_t SharedInference::getCpuBudget() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats.cpuBudget;
+}
+
+std::size_t SharedInference::takeCpuCores(std::size_t wanted) {
+    std::lock_guard<std::mutex> lock(mutex);
+    const std::size_t left = stats.cpuBudget > stats.takenCpuCores ? stats.cpuBudget - stats.takenCpuCores : 0;
+    const std::size_t taken = std::max<std::size_t>(std::min(wanted, left), 1);
+    stats.takenCpuCores += taken;
+    return taken;
+}
+
+SharedInference::Stats SharedInference::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
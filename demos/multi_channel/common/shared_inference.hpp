@@ -0,0 +1,94 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+
+#include <inference_engine.hpp>
+
+/**
+* \brief The InferenceEngine::Core of the process and the executable networks loaded on it. The IEGraphs of a process
+* share the plugins and reuse the executable network another graph loaded for the same model files, device, config,
+* inputs and outputs, so several pipelines of one host process don't duplicate the weights and the thread pools.
+* The CPU networks may also take their streams out of one budget of cores, see setCpuBudget(). The IEGraphs are to
+* be created on one thread, the plugin config set before a load applies to the networks loaded after it
+*/
+class SharedInference final {
+public:
+    static SharedInference& instance();
+
+    SharedInference(const SharedInference&) = delete;
+    SharedInference& operator=(const SharedInference&) = delete;
+
+    InferenceEngine::Core& core();
+
+    /**
+    * \brief Adds the custom layers library to the CPU plugin, once per library
+    */
+    void addCpuExtension(const std::string& path);
+
+    /**
+    * \brief Returns the network loaded for the same model, device, config, inputs and outputs if one is still
+    * used by a graph, nullptr otherwise
+    */
+    std::shared_ptr<InferenceEngine::ExecutableNetwork> findNetwork(const InferenceEngine::CNNNetwork& network,
+                                                                    const std::string& modelPath,
+                                                                    const std::string& deviceName,
+                                                                    const std::map<std::string, std::string>& config);
+
+    /**
+    * \brief Returns findNetwork() or loads the network through the cache of compiled networks in cacheDir, see
+    * loadNetworkCached(). A network is released with the last graph using it
+    */
+    std::shared_ptr<InferenceEngine::ExecutableNetwork> loadNetwork(const InferenceEngine::CNNNetwork& network,
+                                                                    const std::string& modelPath,
+                                                                    const std::string& deviceName,
+                                                                    const std::map<std::string, std::string>& config,
+                                                                    const std::string& cacheDir);
+
+    /**
+    * \brief Limits the CPU cores the CPU throughput streams of all the networks of the process take, 0 - no limit,
+    * every network sizes its streams by itself
+    */
+    void setCpuBudget(std::size_t cores);
+
+    std::size_t getCpuBudget() const;
+
+    /**
+    * \brief Takes up to wanted cores of the budget for a network, at least one even when the budget is spent. The
+    * cores are taken for the life of the process
+    */
+    std::size_t takeCpuCores(std::size_t wanted);
+
+    struct Stats {
+        std::size_t loadedNetworks = 0;  // executable networks loaded to the devices
+        std::size_t reusedNetworks = 0;  // loads served by a network loaded before
+        std::size_t cpuBudget = 0;
+        std::size_t takenCpuCores = 0;
+    };
+
+    Stats getStats() const;
+
+private:
+    SharedInference() = default;
+
+    std::string describe(const InferenceEngine::CNNNetwork& network, const std::string& modelPath,
+                         const std::string& deviceName, const std::map<std::string, std::string>& config) const;
+
+    // drops the networks released by all their graphs, so the descriptions of the reloaded graphs don't pile up
+    void pruneNetworks();
+
+    InferenceEngine::Core ie;
+    std::set<std::string> cpuExtensions;
+    // by the descriptions of the networks, an empty one is never shared
+    std::map<std::string, std::weak_ptr<InferenceEngine::ExecutableNetwork>> networks;
+    Stats stats;
+    mutable std::mutex mutex;
+};
@@ -0,0 +1,132 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <samples/instrumentation.hpp>
+#include <samples/slog.hpp>
+
+#include "stream_writer.hpp"
+
+namespace {
+bool startsWith(const std::string& str, const std::string& prefix) {
+    return str.compare(0, prefix.size(), prefix) == 0;
+}
+
+const char shmPrefix[] = "shm:";
+
+/**
+* \brief The pipeline ends in the muxer of the target: an RTSP client of a server which serves the
+* stream, a shared memory sink of a byte stream or an MP4 file
+*/
+std::string makeEncodingPipeline(const std::string& target, bool hwEncoding) {
+    std::stringstream pipeline;
+    pipeline << "appsrc ! videoconvert ! ";
+    if (hwEncoding) {
+        pipeline << "vaapipostproc ! vaapih264enc";
+    } else {
+        pipeline << "video/x-raw,format=I420 ! x264enc tune=zerolatency speed-preset=ultrafast";
+    }
+    pipeline << " ! h264parse ! ";
+    if (startsWith(target, "rtsp://")) {
+        pipeline << "rtspclientsink location=\"" << target << "\"";
+    } else if (startsWith(target, shmPrefix)) {
+        pipeline << "video/x-h264,stream-format=byte-stream ! shmsink socket-path=\""
+                 << target.substr(sizeof(shmPrefix) - 1) << "\" wait-for-connection=false sync=false";
+    } else {
+        pipeline << "mp4mux ! filesink location=\"" << target << "\"";
+    }
+    return pipeline.str();
+}
+}  // namespace
+
+StreamWriter::StreamWriter(const std::string& target_, cv::Size frameSize_, double fps, std::size_t queueSize_,
+                           bool hwEncoding):
+    target(target_), frameSize(frameSize_), queueSize(std::max<std::size_t>(queueSize_, 1)) {
+    std::vector<bool> encoders;
+    if (hwEncoding) {
+        encoders.push_back(true);
+    }
+    encoders.push_back(false);
+    for (bool hw : encoders) {
+        if (writer.open(makeEncodingPipeline(target, hw), cv::CAP_GSTREAMER, 0, fps, frameSize, true)) {
+            break;
+        }
+        slog::warn << "Can't open the " << (hw ? "VA-API" : "x264") << " H.264 encoder for " << target << slog::endl;
+    }
+    if (!writer.isOpened() && !startsWith(target, "rtsp://") && !startsWith(target, shmPrefix)) {
+        // OpenCV without GStreamer still writes files by its own encoders
+        writer.open(target, cv::VideoWriter::fourcc('m', 'p', '4', 'v'), fps, frameSize, true);
+    }
+    if (!writer.isOpened()) {
+        throw std::runtime_error("Can't open the output stream " + target);
+    }
+    thread = std::thread(&StreamWriter::writeFrames, this);
+}
+
+StreamWriter::~StreamWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        terminate = true;
+    }
+    framesChanged.notify_all();
+    thread.join();
+    writer.release();
+}
+
+void StreamWriter::write(const cv::Mat& frame) {
+    cv::Mat copy;
+    if (frame.size() == frameSize) {
+        frame.copyTo(copy);
+    } else {
+        cv::resize(frame, copy, frameSize);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (frames.size() >= queueSize) {
+            frames.pop_front();
+            droppedFrames++;
+        }
+        frames.push_back(std::move(copy));
+    }
+    framesChanged.notify_one();
+}
+
+std::size_t StreamWriter::getDroppedFrames() const {
+    return droppedFrames;
+}
+
+const std::string& StreamWriter::getTarget() const {
+    return target;
+}
+
+void StreamWriter::writeFrames() {
+    instrumentation::registerCurrentThread("encoder");
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        framesChanged.wait(lock, [&]() { return !frames.empty() || terminate; });
+        // the queued frames are written on termination, so a file ends with the last shown frame
+        if (frames.empty()) {
+            return;
+        }
+        cv::Mat frame = std::move(frames.front());
+        frames.pop_front();
+        lock.unlock();
+        writer.write(frame);
+        lock.lock();
+    }
+}
+
+std::string channelTarget(const std::string& target, std::size_t channel) {
+    const auto pos = target.find("%d");
+    if (pos == std::string::npos) {
+        return "";
+    }
+    return target.substr(0, pos) + std::to_string(channel) + target.substr(pos + 2);
+}
@@ -0,0 +1,60 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <opencv2/opencv.hpp>
+
+/**
+* \brief Encodes frames to H.264 in a background thread and writes them to a file, an RTSP server
+* (rtsp://...) or a shared memory socket (shm:<socket path>). The encoding is done by VA-API when
+* hwEncoding is set and it is available, by x264 otherwise. The queue of the frames is bounded and
+* the oldest frame is dropped when the encoder can't keep up, so a slow sink never stalls the caller
+*/
+class StreamWriter final {
+public:
+    StreamWriter(const std::string& target, cv::Size frameSize, double fps, std::size_t queueSize, bool hwEncoding);
+    ~StreamWriter();
+
+    StreamWriter(const StreamWriter&) = delete;
+    StreamWriter& operator=(const StreamWriter&) = delete;
+
+    /**
+    * \brief Queues a copy of the frame, frames of another size are scaled to the size of the stream
+    */
+    void write(const cv::Mat& frame);
+
+    std::size_t getDroppedFrames() const;
+
+    const std::string& getTarget() const;
+
+private:
+    const std::string target;
+    const cv::Size frameSize;
+    const std::size_t queueSize;
+    cv::VideoWriter writer;
+
+    std::deque<cv::Mat> frames;
+    std::atomic<std::size_t> droppedFrames = {0};
+    bool terminate = false;
+    mutable std::mutex mutex;
+    std::condition_variable framesChanged;
+    std::thread thread;
+
+    void writeFrames();
+};
+
+/**
+* \brief Returns the target of a channel if the target is a pattern with %d, e.g. "channel%d.mp4",
+* and an empty string if the target is a single stream of the whole window
+*/
+std::string channelTarget(const std::string& target, std::size_t channel);
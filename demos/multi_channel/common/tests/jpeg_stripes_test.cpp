@@ -0,0 +1,172 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+// Splits JPEGs with restart markers into stripes and decodes them: every stripe is a JPEG of its band of MCU rows
+// with the markers renumbered from RST0, the bands put together are the whole picture byte for byte. The pictures
+// without the markers on the row boundaries, the progressive, lossless and arithmetic coded ones and the ones with
+// EXIF aren't split
+
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+
+#include <tests/unit_test.hpp>
+
+#include "jpeg_stripes.hpp"
+
+namespace {
+const int jpegQuality = 90;
+
+// a gray picture in three channels keeps the chroma constant, so the upsampling of the chroma across the bands,
+// which differs from the one of the whole picture, can't change the pixels
+cv::Mat makePicture(int rows, int cols, int type) {
+    cv::Mat picture(rows, cols, type);
+    for (int y = 0; y < rows; y++) {
+        unsigned char* row = picture.ptr<unsigned char>(y);
+        for (int x = 0; x < cols * picture.channels(); x++) {
+            const int column = x / picture.channels();
+            row[x] = static_cast<unsigned char>(column * 7 + y * 3 + column * y % 13);
+        }
+    }
+    return picture;
+}
+
+std::vector<unsigned char> encode(const cv::Mat& picture, int restartInterval, bool progressive = false) {
+    std::vector<int> params = {cv::IMWRITE_JPEG_QUALITY, jpegQuality};
+    if (restartInterval > 0) {
+        params.insert(params.end(), {cv::IMWRITE_JPEG_RST_INTERVAL, restartInterval});
+    }
+    if (progressive) {
+        params.insert(params.end(), {cv::IMWRITE_JPEG_PROGRESSIVE, 1});
+    }
+    std::vector<unsigned char> jpeg;
+    CHECK(cv::imencode(".jpg", picture, jpeg, params));
+    return jpeg;
+}
+
+bool sameBytes(const cv::Mat& a, const cv::Mat& b) {
+    return a.size() == b.size() && a.type() == b.type() && a.isContinuous() && b.isContinuous()
+        && 0 == std::memcmp(a.data, b.data, a.total() * a.elemSize());
+}
+
+// the offset of the entropy coded data, after the scan header
+std::size_t scanStart(const std::vector<unsigned char>& jpeg) {
+    for (std::size_t pos = 2; pos + 4 <= jpeg.size();) {
+        const std::size_t end = pos + 2 + 256 * jpeg[pos + 2] + jpeg[pos + 3];
+        if (0xDA == jpeg[pos + 1]) {
+            return end;
+        }
+        pos = end;
+    }
+    CHECK(false);
+    return 0;
+}
+
+// the restart markers of the entropy coded data
+std::vector<unsigned char> restartMarkers(const std::vector<unsigned char>& jpeg) {
+    std::vector<unsigned char> markers;
+    for (std::size_t pos = scanStart(jpeg); pos + 1 < jpeg.size(); pos++) {
+        if (0xFF == jpeg[pos] && jpeg[pos + 1] >= 0xD0 && jpeg[pos + 1] <= 0xD7) {
+            markers.push_back(jpeg[pos + 1]);
+        }
+    }
+    return markers;
+}
+
+// decodes the stripes of a picture and checks they are its bands starting at the rows
+void checkStripes(const std::vector<unsigned char>& jpeg, std::size_t maxStripes, int flags,
+                  const std::vector<unsigned>& rows, unsigned rowsPerInterval) {
+    const cv::Mat whole = cv::imdecode(jpeg, flags);
+    CHECK(!whole.empty());
+    std::vector<JpegStripe> stripes;
+    CHECK(splitJpegStripes(jpeg.data(), jpeg.size(), maxStripes, stripes));
+    CHECK(rows.size() == stripes.size());
+    for (std::size_t i = 0; i < stripes.size(); i++) {
+        const JpegStripe& stripe = stripes[i];
+        const unsigned end = i + 1 < rows.size() ? rows[i + 1] : static_cast<unsigned>(whole.rows);
+        CHECK(rows[i] == stripe.y);
+        CHECK(end - rows[i] == stripe.height);
+
+        CHECK(stripe.data.size() > 4);
+        CHECK(0xFF == stripe.data[0] && 0xD8 == stripe.data[1]);
+        CHECK(0xFF == stripe.data[stripe.data.size() - 2] && 0xD9 == stripe.data[stripe.data.size() - 1]);
+        const std::vector<unsigned char> markers = restartMarkers(stripe.data);
+        CHECK((stripe.height + rowsPerInterval - 1) / rowsPerInterval - 1 == markers.size());
+        for (std::size_t k = 0; k < markers.size(); k++) {
+            CHECK(static_cast<unsigned char>(0xD0 + (k & 7)) == markers[k]);
+        }
+
+        const cv::Mat band = cv::imdecode(stripe.data, flags);
+        CHECK(sameBytes(whole.rowRange(static_cast<int>(stripe.y), static_cast<int>(end)).clone(), band));
+    }
+    CHECK(sameBytes(whole, decodeJpeg(jpeg.data(), jpeg.size(), flags, maxStripes)));
+}
+
+// a JPEG of the segments after the SOI
+std::vector<unsigned char> segments(const std::vector<std::vector<unsigned char>>& parts) {
+    std::vector<unsigned char> jpeg = {0xFF, 0xD8};
+    for (const auto& part : parts) {
+        jpeg.insert(jpeg.end(), part.begin(), part.end());
+    }
+    return jpeg;
+}
+
+// a frame header of a 16x16 picture of a component
+std::vector<unsigned char> frameHeader(unsigned char type) {
+    return {0xFF, type, 0x00, 0x0B, 0x08, 0x00, 0x10, 0x00, 0x10, 0x01, 0x01, 0x11, 0x00};
+}
+}  // namespace
+
+void runTest() {
+    // a gray picture is of 8x8 MCUs, the markers of the interval of a row of 32 of them start every row, the last
+    // row is half a MCU high
+    const cv::Mat gray = makePicture(124, 256, CV_8UC1);
+    const std::vector<unsigned char> grayJpeg = encode(gray, 32);
+    checkStripes(grayJpeg, 4, cv::IMREAD_GRAYSCALE, {0, 32, 64, 96}, 8);
+    // the markers every 3 rows, a stripe starts at the first marker at or after its share of the picture
+    checkStripes(encode(gray, 3 * 32), 4, cv::IMREAD_GRAYSCALE, {0, 48, 72, 96}, 24);
+    // a stripe the most
+    checkStripes(grayJpeg, 100, cv::IMREAD_GRAYSCALE,
+                 {0, 8, 16, 24, 32, 40, 48, 56, 64, 72, 80, 88, 96, 104, 112, 120}, 8);
+
+    // a color picture is of 16x16 MCUs with the 4:2:0 chroma subsampling of imencode
+    const cv::Mat color = makePicture(128, 256, CV_8UC3);
+    checkStripes(encode(color, 16), 3, cv::IMREAD_COLOR, {0, 32, 80}, 16);
+
+    std::vector<JpegStripe> stripes;
+    // a stripe isn't split
+    CHECK(!splitJpegStripes(grayJpeg.data(), grayJpeg.size(), 1, stripes));
+    // no restart markers
+    const std::vector<unsigned char> plainJpeg = encode(gray, 0);
+    CHECK(!splitJpegStripes(plainJpeg.data(), plainJpeg.size(), 4, stripes));
+    CHECK(sameBytes(cv::imdecode(plainJpeg, cv::IMREAD_GRAYSCALE),
+                    decodeJpeg(plainJpeg.data(), plainJpeg.size(), cv::IMREAD_GRAYSCALE, 4)));
+    // the intervals of 33 MCUs of the rows of 32 of them end on no row boundary within the 16 rows
+    const std::vector<unsigned char> unalignedJpeg = encode(gray, 33);
+    CHECK(!restartMarkers(unalignedJpeg).empty());
+    CHECK(!splitJpegStripes(unalignedJpeg.data(), unalignedJpeg.size(), 4, stripes));
+    // a progressive picture of several scans
+    const std::vector<unsigned char> progressiveJpeg = encode(gray, 32, true);
+    CHECK(!splitJpegStripes(progressiveJpeg.data(), progressiveJpeg.size(), 4, stripes));
+    CHECK(sameBytes(cv::imdecode(progressiveJpeg, cv::IMREAD_GRAYSCALE),
+                    decodeJpeg(progressiveJpeg.data(), progressiveJpeg.size(), cv::IMREAD_GRAYSCALE, 4)));
+    // the EXIF orientation applies to the whole picture
+    std::vector<unsigned char> exifJpeg = grayJpeg;
+    const std::vector<unsigned char> exif = {0xFF, 0xE1, 0x00, 0x08, 'E', 'x', 'i', 'f', 0x00, 0x00};
+    exifJpeg.insert(exifJpeg.begin() + 2, exif.begin(), exif.end());
+    CHECK(!splitJpegStripes(exifJpeg.data(), exifJpeg.size(), 4, stripes));
+    // the progressive, lossless, hierarchical and arithmetic coded frames
+    for (unsigned char type : {0xC2, 0xC3, 0xC5, 0xC6, 0xC7, 0xC9, 0xCA, 0xCB, 0xCD, 0xCE, 0xCF}) {
+        const std::vector<unsigned char> jpeg = segments({frameHeader(type), {0xFF, 0xD9}});
+        CHECK(!splitJpegStripes(jpeg.data(), jpeg.size(), 4, stripes));
+    }
+    // a truncated picture and not a JPEG
+    for (std::size_t size : {grayJpeg.size() - 1, grayJpeg.size() / 2, std::size_t{20}, std::size_t{3}}) {
+        CHECK(!splitJpegStripes(grayJpeg.data(), size, 4, stripes));
+    }
+    CHECK(!splitJpegStripes(grayJpeg.data() + 2, grayJpeg.size() - 2, 4, stripes));
+}
@@ -0,0 +1,77 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+// The ring buffer holds up to its capacity of elements and returns them in order, a queue of a single element
+// included: its second push fails instead of overwriting the first element. Producers and consumers on several
+// threads pass every element once
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#include <tests/unit_test.hpp>
+
+#include "ring_buffer.hpp"
+
+namespace {
+void checkSequential(std::size_t capacity) {
+    RingBuffer<int> queue(capacity);
+    CHECK(capacity == queue.getCapacity());
+    int value = -1;
+    CHECK(!queue.tryPop(value));
+    for (int round = 0; round < 5; round++) {
+        for (std::size_t i = 0; i < capacity; i++) {
+            CHECK(queue.tryPush(round * 100 + static_cast<int>(i)));
+        }
+        CHECK(capacity == queue.size());
+        int extra = -1;
+        CHECK(!queue.tryPush(std::move(extra)));
+        for (std::size_t i = 0; i < capacity; i++) {
+            CHECK(queue.tryPop(value));
+            CHECK(round * 100 + static_cast<int>(i) == value);
+        }
+        CHECK(!queue.tryPop(value));
+        CHECK(queue.empty());
+    }
+}
+
+void checkConcurrent(std::size_t capacity) {
+    const int threads = 2;
+    const int perProducer = 20000;
+    RingBuffer<int> queue(capacity);
+    std::atomic<int> producing = {threads};
+    std::atomic<long long> sum = {0};
+    std::atomic<int> popped = {0};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() {
+            for (int i = 1; i <= perProducer; i++) {
+                CHECK(queue.push(t * perProducer + i, []() { return false; }));
+            }
+            --producing;
+        });
+        workers.emplace_back([&]() {
+            int value = 0;
+            while (queue.pop(value, [&]() { return 0 == producing; })) {
+                sum += value;
+                ++popped;
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    const long long count = static_cast<long long>(threads) * perProducer;
+    CHECK(count == popped);
+    CHECK(count * (count + 1) / 2 == sum);
+}
+}  // namespace
+
+void runTest() {
+    for (std::size_t capacity : {1, 2, 3, 8}) {
+        checkSequential(capacity);
+        checkConcurrent(capacity);
+    }
+}
@@ -4,6 +4,17 @@
 
 #include "threading.hpp"
 
+#include <algorithm>
+#include <string>
+
+#include <samples/instrumentation.hpp>
+#include <samples/slog.hpp>
+
+namespace {
+std::size_t pipeline_threads = 0;
+std::atomic<bool> pool_created = {false};
+}  // namespace
+
 #ifdef USE_TBB
 #include <cassert>
 
@@ -26,3 +37,113 @@ tbb::task_arena& get_tbb_arena() {
 }
 #endif
 
+
+constexpr std::size_t ThreadPool::AnyWorker;
+
+ThreadPool::ThreadPool(std::size_t workersCount) {
+    if (0 == workersCount) {
+        workersCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (std::size_t i = 0; i < workersCount; ++i) {
+        workers.emplace_back(new Worker);
+    }
+    for (std::size_t i = 0; i < workersCount; ++i) {
+        threads.emplace_back(&ThreadPool::run, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        terminate = true;
+    }
+    wakeCondVar.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::enqueue(Task task, std::size_t affinityHint) {
+    if (AnyWorker == affinityHint) {
+        affinityHint = nextWorker.fetch_add(1, std::memory_order_relaxed);
+    }
+    auto& worker = *workers[affinityHint % workers.size()];
+    {
+        // counted first, so a worker woken up early retries instead of missing the task
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        ++pendingTasks;
+    }
+    {
+        std::unique_lock<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back(std::move(task));
+    }
+    wakeCondVar.notify_one();
+}
+
+bool ThreadPool::takeTask(std::size_t workerIdx, Task& task) {
+    {
+        auto& own = *workers[workerIdx];
+        std::unique_lock<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.front());
+            own.tasks.pop_front();
+            return true;
+        }
+    }
+    for (std::size_t i = 1; i < workers.size(); ++i) {
+        auto& victim = *workers[(workerIdx + i) % workers.size()];
+        std::unique_lock<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::run(std::size_t workerIdx) {
+    instrumentation::registerCurrentThread("pool worker " + std::to_string(workerIdx));
+    while (true) {
+        Task task;
+        if (takeTask(workerIdx, task)) {
+            {
+                std::unique_lock<std::mutex> lock(wakeMutex);
+                --pendingTasks;
+            }
+            task();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        if (pendingTasks > 0) {
+            lock.unlock();
+            std::this_thread::yield();  // the task is being pushed
+            continue;
+        }
+        if (terminate) {
+            return;
+        }
+        wakeCondVar.wait(lock, [this]() { return terminate || pendingTasks > 0; });
+    }
+}
+
+ThreadPool& get_thread_pool() {
+    static ThreadPool pool(pipeline_threads);
+    pool_created = true;
+    return pool;
+}
+
+void set_pipeline_threads(std::size_t threads) {
+#ifdef USE_TBB
+    auto& arena = get_tbb_arena();
+    if (arena.is_active()) {
+        slog::warn << "The TBB arena is already initialized, it keeps its size" << slog::endl;
+    } else {
+        arena.initialize(0 == threads ? tbb::task_arena::automatic : static_cast<int>(threads));
+    }
+#endif
+    if (pool_created) {
+        slog::warn << "The thread pool is already created, it keeps its size" << slog::endl;
+    }
+    pipeline_threads = threads;
+}
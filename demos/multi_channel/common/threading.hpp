@@ -4,13 +4,24 @@
 
 #pragma once
 
-#ifdef USE_TBB
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <utility>
+#include <vector>
+
+#ifdef USE_TBB
 
-#include <tbb/task_arena.h>
-#ifdef TBB_TASK_ISOLATION
 #include <tbb/parallel_for.h>
-#endif
+#include <tbb/task_arena.h>
 
 struct TbbArenaWrapper final{
     tbb::task_arena arena;
@@ -49,3 +60,137 @@ void run_in_arena(F&& func) {
     });
 }
 #endif
+
+/**
+* \brief Work stealing pool for builds without TBB. Every worker owns a task deque, it runs
+* its own tasks in submission order and steals the most recent tasks of other workers when idle
+*/
+class ThreadPool final {
+public:
+    using Task = std::function<void()>;
+    static constexpr std::size_t AnyWorker = std::numeric_limits<std::size_t>::max();
+
+    // 0 - one worker per hardware thread
+    explicit ThreadPool(std::size_t workersCount = 0);
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator =(const ThreadPool&) = delete;
+    ~ThreadPool();
+
+    /**
+    * \brief Queues the task, runs pending tasks before the pool is destroyed
+    * \param affinityHint index of the preferred worker, tasks with the same hint share a worker
+    * and its caches unless they are stolen, AnyWorker distributes tasks round robin
+    */
+    void enqueue(Task task, std::size_t affinityHint = AnyWorker);
+
+    /**
+    * \brief Calls body(i) for every i in [begin, end) and waits for completion, the calling thread
+    * takes part so the loop progresses even when all workers are busy. Rethrows the first exception
+    */
+    template<typename F>
+    void parallel_for(std::size_t begin, std::size_t end, F&& body);
+
+    std::size_t size() const {
+        return workers.size();
+    }
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+
+    std::mutex wakeMutex;
+    std::condition_variable wakeCondVar;
+    std::size_t pendingTasks = 0;  // queued and not yet taken, guarded by wakeMutex
+    bool terminate = false;
+    std::atomic<std::size_t> nextWorker = {0};
+
+    bool takeTask(std::size_t workerIdx, Task& task);
+    void run(std::size_t workerIdx);
+
+    struct LoopState {
+        std::atomic<std::size_t> next;
+        std::size_t end;
+        std::size_t count;
+        std::size_t finished = 0;  // guarded by mutex
+        std::exception_ptr error;
+        std::mutex mutex;
+        std::condition_variable done;
+    };
+};
+
+template<typename F>
+void ThreadPool::parallel_for(std::size_t begin, std::size_t end, F&& body) {
+    if (end <= begin) {
+        return;
+    }
+    const std::size_t count = end - begin;
+    if (1 == count || workers.empty()) {
+        for (std::size_t i = begin; i < end; ++i) {
+            body(i);
+        }
+        return;
+    }
+
+    // helpers may start after the loop is over, so the state outlives this call,
+    // while body is only touched by iterations the caller is still waiting for
+    auto state = std::make_shared<LoopState>();
+    state->next = begin;
+    state->end = end;
+    state->count = count;
+    auto iterate = [state, &body]() {
+        std::size_t i;
+        while ((i = state->next.fetch_add(1)) < state->end) {
+            std::exception_ptr error;
+            try {
+                body(i);
+            } catch (...) {
+                error = std::current_exception();
+            }
+            std::unique_lock<std::mutex> lock(state->mutex);
+            if (error && !state->error) {
+                state->error = error;
+            }
+            ++state->finished;
+            if (state->finished == state->count) {
+                state->done.notify_one();
+            }
+        }
+    };
+    const std::size_t helpers = std::min(count - 1, workers.size());
+    for (std::size_t i = 0; i < helpers; ++i) {
+        enqueue(iterate, i);
+    }
+    iterate();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->done.wait(lock, [&]() { return state->finished == state->count; });
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+}
+
+ThreadPool& get_thread_pool();
+
+/**
+* \brief Sizes the TBB arena or the shared thread pool of the builds without TBB, see ThreadPolicy::pipeline().
+* Call it before their first use, they keep their size then. 0 - one thread per hardware thread
+*/
+void set_pipeline_threads(std::size_t threads);
+
+/**
+* \brief Calls body(i) for every i in [0, count) on the shared thread pool and waits for completion
+*/
+template<typename F>
+void parallelFor(size_t count, F&& body) {
+#ifdef USE_TBB
+    run_in_arena([&](){
+        tbb::parallel_for<size_t>(0, count, body);
+    });
+#else
+    get_thread_pool().parallel_for(0, count, body);
+#endif
+}
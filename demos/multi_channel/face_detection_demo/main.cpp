@@ -20,6 +20,7 @@
 #include <sstream>
 #include <memory>
 #include <string>
+#include <numeric>
 
 #ifdef USE_TBB
 #include <tbb/parallel_for.h>
@@ -30,13 +31,29 @@
 #include <monitors/presenter.h>
 #include <samples/slog.hpp>
 #include <samples/args_helper.hpp>
+#include <samples/hugepage_allocator.hpp>
+#include <samples/instrumentation.hpp>
+#include <samples/thread_policy.hpp>
+#include <samples/detection_output.hpp>
 
 #include "input.hpp"
 #include "multichannel_params.hpp"
 #include "multichannel_face_detection_params.hpp"
 #include "output.hpp"
+#include "stream_writer.hpp"
 #include "threading.hpp"
 #include "graph.hpp"
+#include "compositor.hpp"
+#include "latency_tracer.hpp"
+#include "benchmark.hpp"
+#include "metrics_exporter.hpp"
+#include "placement.hpp"
+#include "channel_scheduler.hpp"
+#include "drain.hpp"
+#include "cascade.hpp"
+#if USE_GAPI
+#include "gapi_pipeline.hpp"
+#endif
 
 namespace {
 
@@ -54,6 +71,9 @@ void showUsage() {
     std::cout << "          Or" << std::endl;
     std::cout << "      -c \"<absolute_path>\"       " << custom_cldnn_message << std::endl;
     std::cout << "    -d \"<device>\"                " << target_device_message << std::endl;
+    std::cout << "    -m_ag \"<path>\"               " << age_gender_model_message << std::endl;
+    std::cout << "    -d_ag \"<device>\"             " << age_gender_device_message << std::endl;
+    std::cout << "    -bs_ag                       " << age_gender_batch_message << std::endl;
     std::cout << "    -nc                          " << num_cameras << std::endl;
     std::cout << "    -bs                          " << batch_size << std::endl;
     std::cout << "    -nireq                       " << num_infer_requests << std::endl;
@@ -69,6 +89,49 @@ void showUsage() {
     std::cout << "    -i                           " << input_video << std::endl;
     std::cout << "    -loop_video                  " << loop_video_output_message << std::endl;
     std::cout << "    -u                           " << utilization_monitors_message << std::endl;
+    std::cout << "    -u8_input                    " << u8_input_message << std::endl;
+    std::cout << "    -zero_copy                   " << zero_copy_message << std::endl;
+    std::cout << "    -batch_timeout               " << batch_timeout_message << std::endl;
+    std::cout << "    -postprocess_threads         " << postprocess_threads_message << std::endl;
+    std::cout << "    -auto_throughput             " << auto_throughput_message << std::endl;
+    std::cout << "    -input_overflow              " << input_overflow_message << std::endl;
+    std::cout << "    -infer_overflow              " << infer_overflow_message << std::endl;
+    std::cout << "    -output_overflow             " << output_overflow_message << std::endl;
+    std::cout << "    -trace_file                  " << trace_file_message << std::endl;
+    std::cout << "    -remote_blobs                " << remote_blobs_message << std::endl;
+    std::cout << "    -numa                        " << numa_message << std::endl;
+    std::cout << "    -cam_io                      " << cam_io_message << std::endl;
+    std::cout << "    -cam_format                  " << cam_format_message << std::endl;
+    std::cout << "    -cam_workers                 " << cam_workers_message << std::endl;
+    std::cout << "    -capture_threads             " << capture_threads_message << std::endl;
+    std::cout << "    -hw_file_decode              " << hw_file_decode_message << std::endl;
+    std::cout << "    -roi                         " << roi_message << std::endl;
+    std::cout << "    -motion_threshold            " << motion_threshold_message << std::endl;
+    std::cout << "    -channel_weights             " << channel_weights_message << std::endl;
+    std::cout << "    -drain                       " << drain_message << std::endl;
+    std::cout << "    -ocl_render                  " << ocl_render_message << std::endl;
+    std::cout << "    -cache_dir \"<path>\"          " << cache_dir_message << std::endl;
+    std::cout << "    -metrics_port                " << metrics_port_message << std::endl;
+    std::cout << "    -metrics_push \"<url>\"        " << metrics_push_message << std::endl;
+    std::cout << "    -out \"<target>\"              " << out_message << std::endl;
+    std::cout << "    -out_fps                     " << out_fps_message << std::endl;
+    std::cout << "    -out_hw                      " << out_hw_message << std::endl;
+    std::cout << "    -bus_publish \"<name>\"        " << bus_publish_message << std::endl;
+    std::cout << "    -bus_subscribers             " << bus_subscribers_message << std::endl;
+    std::cout << "    -bus_depth                   " << bus_depth_message << std::endl;
+    std::cout << "    -bench                       " << bench_message << std::endl;
+    std::cout << "    -bench_warmup                " << bench_warmup_message << std::endl;
+    std::cout << "    -bench_json \"<path>\"         " << bench_json_message << std::endl;
+    std::cout << "    -bench_tag \"<tag>\"           " << bench_tag_message << std::endl;
+    std::cout << "    -warmup_runs                 " << warmup_runs_message << std::endl;
+    std::cout << "    -reduced_decode              " << reduced_decode_message << std::endl;
+    std::cout << "    -decode_stripes              " << decode_stripes_message << std::endl;
+    std::cout << "    -record \"<dir>\"              " << record_message << std::endl;
+    std::cout << "    -replay_fast                 " << replay_fast_message << std::endl;
+    std::cout << "    -hugepages                   " << hugepages_message << std::endl;
+    std::cout << "    -adaptive_decode             " << adaptive_decode_message << std::endl;
+    std::cout << "    -thread_shares \"<weights>\"   " << thread_shares_message << std::endl;
+    std::cout << "    -backend \"<backend>\"         " << backend_message << std::endl;
 }
 
 bool ParseAndCheckCommandLine(int argc, char *argv[]) {
@@ -87,6 +150,38 @@ bool ParseAndCheckCommandLine(int argc, char *argv[]) {
     if (FLAGS_nc == 0 && FLAGS_i.empty()) {
         throw std::logic_error("Please specify at least one video source(web cam or video file)");
     }
+    if (FLAGS_motion_threshold < 0.0 || FLAGS_motion_threshold > 1.0) {
+        throw std::logic_error("Parameter -motion_threshold must be in [0, 1]");
+    }
+    if (!FLAGS_out.empty() && FLAGS_out_fps <= 0.0) {
+        throw std::logic_error("Parameter -out_fps must be positive");
+    }
+    if (FLAGS_bench > 0 && FLAGS_bench_json.empty()) {
+        throw std::logic_error("Parameter -bench_json is not set, the -bench report isn't mixed with the log");
+    }
+    if (FLAGS_drain) {
+        if (FLAGS_nc != 0) {
+            throw std::logic_error("Web cams never run out of frames, -drain supports video files only");
+        }
+        // neither the display nor dropping may hold frames back
+        FLAGS_no_show = true;
+        FLAGS_loop_video = false;
+        FLAGS_infer_overflow = "block";
+    }
+    if ("ie" != FLAGS_backend && "gapi" != FLAGS_backend) {
+        throw std::logic_error("Parameter -backend must be ie or gapi");
+    }
+    if ("gapi" == FLAGS_backend) {
+#if !USE_GAPI
+        throw std::logic_error("The demo is built without MULTICHANNEL_DEMO_USE_GAPI, -backend gapi is unavailable");
+#endif
+        if (!FLAGS_m_ag.empty() || 0 != FLAGS_metrics_port || !FLAGS_metrics_push.empty()) {
+            throw std::logic_error("-m_ag and the metrics export need -backend ie");
+        }
+        if (FLAGS_nc != 0 && FLAGS_duplicate_num != 0) {
+            throw std::logic_error("Every channel of -backend gapi opens its input, a web cam can't be duplicated");
+        }
+    }
     slog::info << "\tDetection model:           " << FLAGS_m << slog::endl;
     slog::info << "\tDetection threshold:       " << FLAGS_t << slog::endl;
     slog::info << "\tUtilizing device:          " << FLAGS_d << slog::endl;
@@ -99,6 +194,7 @@ bool ParseAndCheckCommandLine(int argc, char *argv[]) {
     slog::info << "\tBatch size:                " << FLAGS_bs << slog::endl;
     slog::info << "\tNumber of infer requests:  " << FLAGS_nireq << slog::endl;
     slog::info << "\tNumber of input web cams:  "  << FLAGS_nc << slog::endl;
+    slog::info << "\tPipeline backend:          " << FLAGS_backend << slog::endl;
 
     return true;
 }
@@ -106,16 +202,71 @@ bool ParseAndCheckCommandLine(int argc, char *argv[]) {
 struct Face {
     cv::Rect2f rect;
     float confidence;
-    unsigned char age;
-    unsigned char gender;
+    unsigned char age;     // 0 - not recognized
+    unsigned char gender;  // 'M', 'F' or 0 - not recognized
     Face(cv::Rect2f r, float c, unsigned char a, unsigned char g): rect(r), confidence(c), age(a), gender(g) {}
 };
 
+// adds the faces of the DetectionOutput rows to the face vectors of the frames of the batch
+void parseFaces(const float* data, size_t rowsNumber, const std::vector<std::vector<Face>*>& faces) {
+    detection_output::parse(data, rowsNumber, static_cast<float>(FLAGS_t), faces.size(),
+                            [&](size_t idxInBatch, const detection_output::Row& row) {
+        const float x0 = detection_output::clamp(row.xmin);
+        const float y0 = detection_output::clamp(row.ymin);
+        const float x1 = detection_output::clamp(row.xmax);
+        const float y1 = detection_output::clamp(row.ymax);
+        faces[idxInBatch]->emplace_back(cv::Rect2f{x0, y0, x1 - x0, y1 - y0}, row.confidence, 0, 0);
+    });
+}
+
+// the result of the age/gender network for a face crop
+struct AgeGender {
+    float age;
+    float maleProb;
+};
+
+// the regions of the faces for the age/gender network, in the pixels of the frame
+std::vector<cv::Rect> faceRois(const VideoFrame& vframe) {
+    std::vector<cv::Rect> rois;
+    if (vframe.detections.empty()) {
+        return rois;
+    }
+    const cv::Size2f size = vframe.frame.size();
+    for (const Face& face : vframe.detections.get<std::vector<Face>>()) {
+        const cv::Rect2f rect(face.rect.x * size.width, face.rect.y * size.height,
+                              face.rect.width * size.width, face.rect.height * size.height);
+        rois.push_back(cv::Rect(rect));
+    }
+    return rois;
+}
+
+void attachAgeGender(VideoFrame& vframe, std::size_t faceIdx, const Detections& detections) {
+    Face& face = vframe.detections.get<std::vector<Face>>()[faceIdx];
+    const AgeGender& ageGender = detections.get<AgeGender>();
+    face.age = static_cast<unsigned char>(std::min(std::max(ageGender.age * 100.0f, 1.0f), 100.0f));
+    face.gender = ageGender.maleProb > 0.5f ? 'M' : 'F';
+}
+
+// the network sees the region of the frame, so the boxes are moved from the region to the whole frame
+void mapToFrame(VideoFrame& vframe) {
+    if (vframe.roi.empty() || vframe.detections.empty()) {
+        return;
+    }
+    for (Face& face : vframe.detections.get<std::vector<Face>>()) {
+        face.rect = vframe.toFrame(face.rect, cv::Size2f(1.0f, 1.0f));
+    }
+}
+
 void drawDetections(cv::Mat& img, const std::vector<Face>& detections) {
     for (const Face& f : detections) {
         cv::Rect ri(static_cast<int>(f.rect.x*img.cols), static_cast<int>(f.rect.y*img.rows),
                     static_cast<int>(f.rect.width*img.cols), static_cast<int>(f.rect.height*img.rows));
         cv::rectangle(img, ri, cv::Scalar(255, 0, 0), 2);
+        if (0 != f.age) {
+            const std::string label = std::string(1, static_cast<char>(f.gender)) + "," + std::to_string(f.age);
+            cv::putText(img, label, ri.tl() + cv::Point(0, -3), cv::HersheyFonts::FONT_HERSHEY_COMPLEX_SMALL, 0.8,
+                        cv::Scalar(255, 0, 0), 1);
+        }
     }
 }
 
@@ -150,21 +301,16 @@ DisplayParams prepareDisplayParams(size_t count) {
     return params;
 }
 
-void displayNSources(const std::vector<std::shared_ptr<VideoFrame>>& data,
-                     float time,
-                     const std::string& stats,
-                     DisplayParams params,
-                     Presenter& presenter) {
-    cv::Mat windowImage = cv::Mat::zeros(params.windowSize, CV_8UC3);
-    auto loopBody = [&](size_t i) {
-        auto& elem = data[i];
-        if (!elem->frame.empty()) {
-            cv::Rect rectFrame = cv::Rect(params.points[i], params.frameSize);
-            cv::Mat windowPart = windowImage(rectFrame);
-            cv::resize(elem->frame, windowPart, params.frameSize);
-            drawDetections(windowPart, elem->detections.get<std::vector<Face>>());
-        }
-    };
+cv::Mat& displayNSources(const std::vector<std::shared_ptr<VideoFrame>>& data,
+                         float time,
+                         const std::string& stats,
+                         DisplayParams params,
+                         Presenter& presenter,
+                         GridCompositor& compositor) {
+    DEMO_FRAME("display");
+    cv::Mat& windowImage = compositor.compose(data, [&](cv::Mat& cell, const Detections& detections) {
+        drawDetections(cell, detections.get<std::vector<Face>>());
+    });
 
     auto drawStats = [&]() {
         if (FLAGS_show_stats && !stats.empty()) {
@@ -183,25 +329,16 @@ void displayNSources(const std::vector<std::shared_ptr<VideoFrame>>& data,
         }
     };
 
-//  #ifdef USE_TBB
-#if 0  // disable multithreaded rendering for now
-    run_in_arena([&](){
-        tbb::parallel_for<size_t>(0, data.size(), [&](size_t i) {
-            loopBody(i);
-        });
-    });
-#else
-    for (size_t i = 0; i < data.size(); ++i) {
-        loopBody(i);
-    }
-#endif
     presenter.drawGraphs(windowImage);
     drawStats();
 
     char str[256];
     snprintf(str, sizeof(str), "%5.2f fps", static_cast<double>(1000.0f/time));
     cv::putText(windowImage, str, cv::Point(800, 100), cv::HersheyFonts::FONT_HERSHEY_COMPLEX, 2.0,  cv::Scalar(0, 255, 0), 2);
-    cv::imshow(params.name, windowImage);
+    if (!FLAGS_no_show) {
+        cv::imshow(params.name, windowImage);
+    }
+    return windowImage;
 }
 
 }  // namespace
@@ -217,6 +354,22 @@ int main(int argc, char* argv[]) {
         if (!ParseAndCheckCommandLine(argc, argv)) {
             return 0;
         }
+        if (FLAGS_hugepages) {
+            // before the capture and the inference threads allocate their buffers
+            useHugePageArena();
+        }
+        // before the pools start, with -thread_shares the IE streams, OpenCV and the pipeline take their shares of
+        // the cores
+        std::size_t inferenceThreads = 0;  // the plugin default
+        if (!FLAGS_thread_shares.empty()) {
+            const ThreadPolicy threadPolicy(FLAGS_thread_shares);
+            threadPolicy.report();
+            threadPolicy.apply();
+            set_pipeline_threads(threadPolicy.pipeline());
+            inferenceThreads = threadPolicy.inference();
+        }
+        const bool exportMetrics = 0 != FLAGS_metrics_port || !FLAGS_metrics_push.empty();
+        const bool gapiBackend = "gapi" == FLAGS_backend;
 
         std::string modelPath = FLAGS_m;
         std::size_t found = modelPath.find_last_of(".");
@@ -230,18 +383,23 @@ int main(int argc, char* argv[]) {
         IEGraph::InitParams graphParams;
         graphParams.batchSize       = FLAGS_bs;
         graphParams.maxRequests     = FLAGS_nireq;
-        graphParams.collectStats    = FLAGS_show_stats;
+        graphParams.collectStats    = FLAGS_show_stats || exportMetrics;
         graphParams.reportPerf      = FLAGS_pc;
         graphParams.modelPath       = modelPath;
         graphParams.cpuExtPath      = FLAGS_l;
         graphParams.cldnnConfigPath = FLAGS_c;
+        graphParams.cacheDir        = FLAGS_cache_dir;
         graphParams.deviceName      = FLAGS_d;
-
-        std::shared_ptr<IEGraph> network(new IEGraph(graphParams));
-        auto inputDims = network->getInputDims();
-        if (4 != inputDims.size()) {
-            throw std::runtime_error("Invalid network input dimensions");
-        }
+        graphParams.u8Input         = FLAGS_u8_input;
+        graphParams.zeroCopy        = FLAGS_zero_copy;
+        graphParams.batchTimeoutMSec = FLAGS_batch_timeout;
+        graphParams.postprocessThreads = FLAGS_postprocess_threads;
+        graphParams.autoThroughput  = FLAGS_auto_throughput;
+        graphParams.overflowPolicy  = parseOverflowPolicy(FLAGS_infer_overflow);
+        graphParams.remoteSurfaces  = FLAGS_remote_blobs;
+        graphParams.warmupRuns      = FLAGS_warmup_runs;
+        graphParams.arenaBlobs      = FLAGS_hugepages;
+        graphParams.cpuThreads      = inferenceThreads;
 
         std::vector<std::string> files;
         parseInputFilesArguments(files);
@@ -264,78 +422,178 @@ int main(int argc, char* argv[]) {
             throw std::logic_error("Number of inputs exceed maximum value [25]");
         }
 
-        VideoSources::InitParams vsParams;
-        vsParams.queueSize            = FLAGS_n_iqs;
-        vsParams.collectStats         = FLAGS_show_stats;
-        vsParams.realFps              = FLAGS_real_input_fps;
-        vsParams.expectedHeight = static_cast<unsigned>(inputDims[2]);
-        vsParams.expectedWidth  = static_cast<unsigned>(inputDims[3]);
-
-        VideoSources sources(vsParams);
-        if (!files.empty()) {
-            slog::info << "Trying to open input video ..." << slog::endl;
-            for (auto& file : files) {
-                try {
-                    sources.openVideo(file, false, FLAGS_loop_video);
-                } catch (...) {
-                    slog::info << "Cannot open video [" << file << "]" << slog::endl;
-                    throw;
-                }
-            }
-        }
-        if (FLAGS_nc) {
-            slog::info << "Trying to connect " << FLAGS_nc << " web cams ..." << slog::endl;
+        // threads created from now on inherit the placement of the main thread
+        ThreadPlacement placement(FLAGS_numa, numberOfInputs);
+        placement.report();
+        placement.pinMainThread();
+
+        std::shared_ptr<IEGraph> network;
+        std::unique_ptr<Cascade> cascade;
+        std::unique_ptr<VideoSources> sources;
+#if USE_GAPI
+        std::unique_ptr<GapiPipeline> gapiPipeline;
+        if (gapiBackend) {
+            GapiPipeline::InitParams gapiParams;
+            gapiParams.modelPath   = modelPath;
+            gapiParams.deviceName  = FLAGS_d;
+            gapiParams.maxRequests = FLAGS_nireq;
+            gapiParams.loopVideo   = FLAGS_loop_video;
+            // every channel opens its input itself, the duplicates of a file too
+            std::vector<std::string> inputs = files;
             for (size_t i = 0; i < FLAGS_nc; ++i) {
-                try {
-                    sources.openVideo(std::to_string(i), true, false);
-                } catch (...) {
-                    slog::info << "Cannot open web cam [" << i << "]" << slog::endl;
-                    throw;
-                }
+                inputs.push_back(std::to_string(i));
+            }
+            for (const auto& input : inputs) {
+                gapiParams.inputs.insert(gapiParams.inputs.end(), duplicateFactor, input);
             }
+            slog::info << "Compiling the G-API streaming graphs of the channels ..." << slog::endl;
+            gapiPipeline.reset(new GapiPipeline(gapiParams));
         }
-        sources.start();
-
-        size_t currentFrame = 0;
-
-        network->start([&](VideoFrame& img) {
-            img.sourceIdx = currentFrame;
-            auto camIdx = currentFrame / duplicateFactor;
-            currentFrame = (currentFrame + 1) % numberOfInputs;
-            return sources.getFrame(camIdx, img);
-        }, [](InferenceEngine::InferRequest::Ptr req, const std::vector<std::string>& outputDataBlobNames, cv::Size frameSize) {
-            auto output = req->GetBlob(outputDataBlobNames[0]);
-
-            float* dataPtr = output->buffer();
-            InferenceEngine::SizeVector svec = output->getTensorDesc().getDims();
-            size_t total = 1;
-            for (auto v : svec) {
-                total *= v;
+#endif
+        if (!gapiBackend) {
+            graphParams.numChannels     = numberOfInputs;
+            network.reset(new IEGraph(graphParams));
+
+            if (!FLAGS_m_ag.empty()) {
+                IEGraph::InitParams ageGenderParams = graphParams;
+                ageGenderParams.batchSize       = FLAGS_bs_ag;
+                ageGenderParams.modelPath       = FLAGS_m_ag;
+                ageGenderParams.deviceName      = FLAGS_d_ag;
+                ageGenderParams.zeroCopy        = false;
+                ageGenderParams.remoteSurfaces  = false;
+                ageGenderParams.postprocessThreads = 0;  // on the collector thread of the cascade
+                ageGenderParams.overflowPolicy  = OverflowPolicy::Block;  // the cascade bounds the crops instead
+                // few faces must not wait for a full batch of the faces of the next frames
+                ageGenderParams.batchTimeoutMSec = FLAGS_batch_timeout > 0 ? FLAGS_batch_timeout : 10;
+                const size_t cropsQueueSize = 2 * FLAGS_bs_ag * FLAGS_nireq;
+                cascade.reset(new Cascade(std::make_shared<IEGraph>(ageGenderParams), cropsQueueSize,
+                                          faceRois, attachAgeGender));
             }
-
-
-            std::vector<Detections> detections(FLAGS_bs);
-            for (auto& d : detections) {
-                d.set(new std::vector<Face>);
+            auto inputDims = network->getInputDims();
+            if (4 != inputDims.size()) {
+                throw std::runtime_error("Invalid network input dimensions");
             }
 
-            for (size_t i = 0; i < total; i+=7) {
-                float conf = dataPtr[i + 2];
-                if (conf > FLAGS_t) {
-                    int idxInBatch = static_cast<int>(dataPtr[i]);
-                    float x0 = std::min(std::max(0.0f, dataPtr[i + 3]), 1.0f);
-                    float y0 = std::min(std::max(0.0f, dataPtr[i + 4]), 1.0f);
-                    float x1 = std::min(std::max(0.0f, dataPtr[i + 5]), 1.0f);
-                    float y1 = std::min(std::max(0.0f, dataPtr[i + 6]), 1.0f);
-
-                    cv::Rect2f rect = {x0 , y0, x1-x0, y1-y0};
-                    detections[idxInBatch].get<std::vector<Face>>().emplace_back(rect, conf, 0, 0);
+            VideoSources::InitParams vsParams;
+            vsParams.queueSize            = FLAGS_n_iqs;
+            vsParams.collectStats         = FLAGS_show_stats || exportMetrics;
+            vsParams.realFps              = FLAGS_real_input_fps;
+            vsParams.readTimeoutMSec      = FLAGS_batch_timeout;
+            vsParams.overflowPolicy       = parseOverflowPolicy(FLAGS_input_overflow);
+            vsParams.hwSurfaces           = FLAGS_remote_blobs;
+            vsParams.downloadSurfaces     = !FLAGS_no_show || !FLAGS_out.empty() || !FLAGS_bus_publish.empty() ||
+                                            !FLAGS_record.empty() ||
+                                            nullptr != cascade;  // the faces are cut from the frames in system memory
+            vsParams.channelCpus          = placement.getChannelsCpus();
+            vsParams.channelRois          = parseChannelRois(FLAGS_roi);
+            vsParams.motionThreshold      = static_cast<float>(FLAGS_motion_threshold);
+            vsParams.publishBus           = FLAGS_bus_publish;
+            vsParams.busSubscribers       = FLAGS_bus_subscribers;
+            vsParams.busDepth             = FLAGS_bus_depth;
+            vsParams.cameraFormat         = FLAGS_cam_format;
+            vsParams.cameraIo             = FLAGS_cam_io;
+            vsParams.cameraWorkers        = FLAGS_cam_workers;
+            vsParams.captureThreads       = FLAGS_capture_threads;
+            vsParams.hwFileDecoding       = FLAGS_hw_file_decode;
+            vsParams.drain                = FLAGS_drain;
+            vsParams.reducedDecoding      = FLAGS_reduced_decode;
+            vsParams.decodingStripes      = FLAGS_decode_stripes;
+            vsParams.adaptiveDecoding     = FLAGS_adaptive_decode;
+            vsParams.recordDir            = FLAGS_record;
+            vsParams.replayFast           = FLAGS_replay_fast;
+            vsParams.expectedHeight = static_cast<unsigned>(inputDims[2]);
+            vsParams.expectedWidth  = static_cast<unsigned>(inputDims[3]);
+
+            sources.reset(new VideoSources(vsParams));
+            if (!files.empty()) {
+                slog::info << "Trying to open input video ..." << slog::endl;
+                for (auto& file : files) {
+                    try {
+                        sources->openVideo(file, false, FLAGS_loop_video);
+                    } catch (...) {
+                        slog::info << "Cannot open video [" << file << "]" << slog::endl;
+                        throw;
+                    }
                 }
             }
-            return detections;
-        });
+            if (FLAGS_nc) {
+                slog::info << "Trying to connect " << FLAGS_nc << " web cams ..." << slog::endl;
+                for (size_t i = 0; i < FLAGS_nc; ++i) {
+                    try {
+                        sources->openVideo(std::to_string(i), true, false);
+                    } catch (...) {
+                        slog::info << "Cannot open web cam [" << i << "]" << slog::endl;
+                        throw;
+                    }
+                }
+            }
+        }
+        // created before the sources start, so the trace begins with the first captured frame
+        LatencyTracer tracer(numberOfInputs, LatencyTracer::DefaultWindowSize, !FLAGS_trace_file.empty());
+        std::unique_ptr<SteadyStateBenchmark> benchmark;
+        if (FLAGS_bench > 0) {
+            benchmark.reset(new SteadyStateBenchmark(numberOfInputs, std::chrono::seconds(FLAGS_bench_warmup),
+                                                     std::chrono::seconds(FLAGS_bench)));
+        }
 
-        network->setDetectionConfidence(static_cast<float>(FLAGS_t));
+        // in drain mode channels are read to their ends, the input is over once all of them are
+        ChannelScheduler channelScheduler(FLAGS_channel_weights, numberOfInputs);
+        // the face vectors of the frames the pipeline released are refilled
+        auto facesPool = std::make_shared<DetectionsPool<std::vector<Face>>>();
+#if USE_GAPI
+        if (gapiPipeline) {
+            gapiPipeline->start([facesPool](const std::vector<cv::Mat>& outputs, cv::Size) {
+                Detections detections = facesPool->acquire();
+                parseFaces(outputs[0].ptr<float>(), outputs[0].total() / 7,
+                           {&detections.get<std::vector<Face>>()});
+                return detections;
+            });
+        }
+#endif
+        if (!gapiBackend) {
+            sources->start();
+
+            network->start([&](VideoFrame& img) {
+                return readScheduledFrame(channelScheduler, *sources, duplicateFactor, FLAGS_drain, img);
+            }, [facesPool](InferenceEngine::InferRequest::Ptr req, const std::vector<std::string>& outputDataBlobNames, cv::Size frameSize) {
+                auto output = req->GetBlob(outputDataBlobNames[0]);
+                size_t rowsNumber = output->size() / 7;
+
+                // the face vectors of the pool keep their capacity, so the faces are usually added without allocations
+                std::vector<Detections> detections(FLAGS_bs);
+                std::vector<std::vector<Face>*> faces(detections.size());
+                for (size_t i = 0; i < detections.size(); i++) {
+                    detections[i] = facesPool->acquire();
+                    faces[i] = &detections[i].get<std::vector<Face>>();
+                }
+                parseFaces(output->buffer().as<float*>(), rowsNumber, faces);
+                return detections;
+            });
+
+            network->setDetectionConfidence(static_cast<float>(FLAGS_t));
+
+            if (cascade) {
+                cascade->start([](InferenceEngine::InferRequest::Ptr req, const std::vector<std::string>& outputDataBlobNames, cv::Size) {
+                    // the age is a single value of a face, the gender is the probabilities of female and male
+                    InferenceEngine::Blob::Ptr ageBlob, genderBlob;
+                    for (const auto& name : outputDataBlobNames) {
+                        auto blob = req->GetBlob(name);
+                        const auto& dims = blob->getTensorDesc().getDims();
+                        (dims.size() > 1 && 2 == dims[1] ? genderBlob : ageBlob) = blob;
+                    }
+                    if (!ageBlob || !genderBlob) {
+                        throw std::runtime_error("The age/gender recognition model must have an age and a gender output");
+                    }
+                    const float* ages = ageBlob->buffer();
+                    const float* genders = genderBlob->buffer();
+                    std::vector<Detections> detections(FLAGS_bs_ag);
+                    for (size_t i = 0; i < detections.size(); i++) {
+                        detections[i].set(new AgeGender{ages[i], genders[2 * i + 1]});
+                    }
+                    return detections;
+                });
+            }
+        }
 
         std::atomic<float> averageFps = {0.0f};
 
@@ -352,16 +610,52 @@ int main(int argc, char* argv[]) {
 
         cv::Size graphSize{static_cast<int>(params.windowSize.width / 4), 60};
         Presenter presenter(FLAGS_u, params.windowSize.height - graphSize.height - 10, graphSize);
+        GridCompositor compositor(params.windowSize, params.frameSize,
+                                  std::vector<cv::Point>(params.points, params.points + params.count), FLAGS_ocl_render);
+
+        // the encoders take the frames from the output thread and don't wait for the display
+        const size_t encoderQueueSize = 4;
+        std::vector<std::unique_ptr<StreamWriter>> writers;
+        if (!FLAGS_out.empty()) {
+            if (channelTarget(FLAGS_out, 0).empty()) {
+                writers.emplace_back(new StreamWriter(FLAGS_out, params.windowSize, FLAGS_out_fps,
+                                                      encoderQueueSize, FLAGS_out_hw));
+            } else {
+                for (size_t i = 0; i < numberOfInputs; i++) {
+                    writers.emplace_back(new StreamWriter(channelTarget(FLAGS_out, i), params.frameSize,
+                                                          FLAGS_out_fps, encoderQueueSize, FLAGS_out_hw));
+                }
+            }
+        }
+        const bool render = !FLAGS_no_show || !writers.empty();
 
         const size_t outputQueueSize = 1;
-        AsyncOutput output(FLAGS_show_stats, outputQueueSize,
+        AsyncOutput output(FLAGS_show_stats || exportMetrics, outputQueueSize,
+                           parseOverflowPolicy(FLAGS_output_overflow), numberOfInputs,
         [&](const std::vector<std::shared_ptr<VideoFrame>>& result) {
             std::string str;
             if (FLAGS_show_stats) {
                 std::unique_lock<std::mutex> lock(statMutex);
                 str = statStream.str();
             }
-            displayNSources(result, averageFps, str, params, presenter);
+            displayNSources(result, averageFps, str, params, presenter, compositor);
+            for (const auto& frame : result) {
+                frame->trace.stamp(FrameTrace::Render);
+                tracer.add(*frame);
+                if (benchmark) {
+                    benchmark->add(*frame);
+                }
+            }
+            if (writers.size() == 1 && channelTarget(FLAGS_out, 0).empty()) {
+                writers.front()->write(windowImage);
+            } else {
+                for (size_t i = 0; i < writers.size(); i++) {
+                    writers[i]->write(windowImage(cv::Rect(params.points[i], params.frameSize)));
+                }
+            }
+            if (FLAGS_no_show) {
+                return true;
+            }
             int key = cv::waitKey(1);
             presenter.handleKey(key);
 
@@ -370,6 +664,11 @@ int main(int argc, char* argv[]) {
 
         output.start();
 
+        std::unique_ptr<PipelineMetrics> metrics;
+        if (exportMetrics) {
+            metrics.reset(new PipelineMetrics(FLAGS_metrics_port, FLAGS_metrics_push));
+        }
+
         using timer = std::chrono::high_resolution_clock;
         using duration = std::chrono::duration<float, std::milli>;
         timer::time_point lastTime = timer::now();
@@ -379,20 +678,58 @@ int main(int argc, char* argv[]) {
 
         size_t perfItersCounter = 0;
 
-        while (sources.isRunning() || network->isRunning()) {
+        // the postprocessed frames of either backend, empty once it stopped
+        auto getBatchData = [&]() {
+#if USE_GAPI
+            if (gapiPipeline) {
+                return gapiPipeline->getBatchData();
+            }
+#endif
+            return network->getBatchData(params.frameSize);
+        };
+        auto isRunning = [&]() {
+#if USE_GAPI
+            if (gapiPipeline) {
+                return gapiPipeline->isRunning();
+            }
+#endif
+            return sources->isRunning() || network->isRunning();
+        };
+
+        while (isRunning()) {
             bool readData = true;
             while (readData) {
-                auto br = network->getBatchData(params.frameSize);
+                auto br = getBatchData();
+                if (cascade) {
+                    // the faces of the frames are classified, the frames come back once all their faces are
+                    for (const auto& vframe : br) {
+                        mapToFrame(*vframe);
+                        cascade->push(vframe);
+                    }
+                    if (br.empty()) {
+                        cascade->finish();
+                    }
+                    br = cascade->pop();
+                }
                 if (br.empty()) {
                     break; // IEGraph::getBatchData had nothing to process and returned. That means it was stopped
                 }
                 for (size_t i = 0; i < br.size(); i++) {
+                    if (!cascade) {
+                        mapToFrame(*br[i]);
+                    }
+                    if (!render) {
+                        tracer.add(*br[i]);  // nothing is rendered, so postprocessing ends the trace
+                        if (benchmark) {
+                            benchmark->add(*br[i]);
+                        }
+                    }
                     // this approach waits for the next input image for sourceIdx. If provided a single image,
                     // it may not show results, especially if -real_input_fps is enabled
                     auto val = static_cast<unsigned int>(br[i]->sourceIdx);
                     auto it = find_if(batchRes.begin(), batchRes.end(), [val] (const std::shared_ptr<VideoFrame>& vf) { return vf->sourceIdx == val; } );
                     if (it != batchRes.end()) {
-                        if (!FLAGS_no_show) {
+                        if (render) {
                             output.push(std::move(batchRes));
                         }
                         batchRes.clear();
@@ -403,7 +740,7 @@ int main(int argc, char* argv[]) {
             }
             ++fpsCounter;
 
-            if (!output.isAlive()) {
+            if (!output.isAlive() || (benchmark && benchmark->finished())) {
                 break;
             }
 
@@ -416,17 +753,51 @@ int main(int argc, char* argv[]) {
                 fpsCounter = 0;
                 lastTime = currTime;
 
+                averageFps = frameTime;  // also drawn into the encoded streams
                 if (FLAGS_no_show) {
                     slog::info << "Average Throughput : " << 1000.f/frameTime << " fps" << slog::endl;
-                    if (++perfItersCounter >= FLAGS_n_sp) {
+                    if (!FLAGS_drain && !benchmark && ++perfItersCounter >= FLAGS_n_sp) {
                         break;
                     }
-                } else {
-                    averageFps = frameTime;
                 }
 
-                if (FLAGS_show_stats) {
-                    auto inputStat = sources.getStats();
+                if (metrics) {
+                    metrics->publish(1000.f / frameTime, sources->getStats(), network->getStats(),
+                                     output.getStats(), tracer.getStats());
+                }
+
+#if USE_GAPI
+                if (FLAGS_show_stats && gapiPipeline) {
+                    // G-API doesn't expose the stages of its graphs, the channels and their latencies are compared
+                    auto gapiStat = gapiPipeline->getStats();
+                    auto latencyStat = tracer.getStats();
+                    std::unique_lock<std::mutex> lock(statMutex);
+                    statStream.str(std::string());
+                    statStream << std::fixed << std::setprecision(1);
+                    statStream << "Channel FPS: ";
+                    for (size_t i = 0; i < gapiStat.channelFps.size(); ++i) {
+                        if (0 == (i % 4)) {
+                            statStream << std::endl;
+                        }
+                        statStream << gapiStat.channelFps[i] << " ";
+                    }
+                    statStream << std::endl;
+                    statStream << "End-to-end latency p50/p95/p99:";
+                    for (size_t i = 0; i < latencyStat.size(); ++i) {
+                        if (0 == (i % 4)) {
+                            statStream << std::endl;
+                        }
+                        const auto& endToEnd = latencyStat[i].intervals[LatencyTracer::EndToEnd];
+                        statStream << endToEnd.p50 << "/" << endToEnd.p95 << "/" << endToEnd.p99 << "ms ";
+                    }
+                    statStream << std::endl;
+                    if (FLAGS_no_show) {
+                        slog::info << statStream.str() << slog::endl;
+                    }
+                }
+#endif
+                if (FLAGS_show_stats && network) {
+                    auto inputStat = sources->getStats();
                     auto inferStat = network->getStats();
                     auto outputStat = output.getStats();
 
@@ -441,18 +812,109 @@ int main(int argc, char* argv[]) {
                         statStream << inputStat.readTimes[i] << "ms ";
                     }
                     statStream << std::endl;
+                    if (std::any_of(inputStat.captureLatencies.begin(), inputStat.captureLatencies.end(),
+                                    [](float latency) { return latency > 0.0f; })) {
+                        statStream << "Camera dequeue latency: ";
+                        for (size_t i = 0; i < inputStat.captureLatencies.size(); ++i) {
+                            if (0 == (i % 4)) {
+                                statStream << std::endl;
+                            }
+                            statStream << inputStat.captureLatencies[i] << "ms ";
+                        }
+                        statStream << std::endl;
+                    }
                     statStream << "HW decoding latency: "
-                               << inputStat.decodingLatency << "ms";
+                               << inputStat.decodingLatency << "ms (batch "
+                               << inputStat.decodingBatchSize << ")";
                     statStream << std::endl;
+                    if (!inputStat.decodingModes.empty()) {
+                        statStream << "Decoding routes: HW " << inputStat.hwDecodingLatency << "ms, SW "
+                                   << inputStat.swDecodingLatency << "ms, " << inputStat.decodingReroutes
+                                   << " reroutes";
+                        for (size_t i = 0; i < inputStat.decodingModes.size(); ++i) {
+                            if (0 == (i % 8)) {
+                                statStream << std::endl;
+                            }
+                            statStream << (Decoder::Mode::Hw == inputStat.decodingModes[i] ? "HW " : "SW ");
+                        }
+                        statStream << std::endl;
+                    }
                     statStream << "Preprocess time: "
                                << inferStat.preprocessTime << "ms";
                     statStream << std::endl;
                     statStream << "Plugin latency: "
-                               << inferStat.inferTime << "ms";
+                               << inferStat.inferTime << "ms (p95/p99/max: "
+                               << inferStat.inferTimeStats.p95 << "/" << inferStat.inferTimeStats.p99 << "/"
+                               << inferStat.inferTimeStats.max << "ms)";
+                    statStream << std::endl;
+                    statStream << "Input copies per frame: "
+                               << inferStat.copiesPerFrame;
                     statStream << std::endl;
+                    statStream << "Batch fill ratio: "
+                               << inferStat.batchFillRatio;
+                    statStream << std::endl;
+                    if (inferStat.devices.size() > 1) {
+                        for (const auto& device : inferStat.devices) {
+                            statStream << device.name << ": " << device.inferTime << "ms "
+                                       << 100.0f * device.batchesShare << "%" << std::endl;
+                        }
+                    }
+                    if (cascade) {
+                        const auto cascadeStat = cascade->getStats();
+                        statStream << "Age/gender: " << cascadeStat.cropsPerFrame << " faces per frame, "
+                                   << cascadeStat.graphStats.inferTime << "ms per batch, batch fill ratio "
+                                   << cascadeStat.graphStats.batchFillRatio << std::endl;
+                    }
 
                     statStream << "Render time: " << outputStat.renderTime
-                               << "ms" << std::endl;
+                               << "ms (p95/p99/max: " << outputStat.renderTimeStats.p95 << "/"
+                               << outputStat.renderTimeStats.p99 << "/" << outputStat.renderTimeStats.max
+                               << "ms)" << std::endl;
+
+                    auto latencyStat = tracer.getStats();
+                    statStream << "End-to-end latency p50/p95/p99:";
+                    for (size_t i = 0; i < latencyStat.size(); ++i) {
+                        if (0 == (i % 4)) {
+                            statStream << std::endl;
+                        }
+                        const auto& endToEnd = latencyStat[i].intervals[LatencyTracer::EndToEnd];
+                        statStream << endToEnd.p50 << "/" << endToEnd.p95 << "/" << endToEnd.p99 << "ms ";
+                    }
+                    statStream << std::endl;
+                    auto sum = [](const std::vector<size_t>& counters) {
+                        return std::accumulate(counters.begin(), counters.end(), size_t(0));
+                    };
+                    statStream << "Dropped frames (input/infer/render): " << sum(inputStat.droppedFrames) << "/"
+                               << sum(inferStat.droppedFrames) << "/" << sum(outputStat.droppedFrames);
+                    for (size_t i = 0; i < inferStat.droppedFrames.size() && i < outputStat.droppedFrames.size(); ++i) {
+                        if (0 == (i % 4)) {
+                            statStream << std::endl;
+                        }
+                        statStream << inferStat.droppedFrames[i] + outputStat.droppedFrames[i] << " ";
+                    }
+                    statStream << std::endl;
+                    statStream << "Channel FPS: ";
+                    for (size_t i = 0; i < inferStat.channelFps.size(); ++i) {
+                        if (0 == (i % 4)) {
+                            statStream << std::endl;
+                        }
+                        statStream << inferStat.channelFps[i] << " ";
+                    }
+                    statStream << std::endl;
+                    if (!inputStat.unchangedShares.empty()) {
+                        statStream << "Skipped unchanged frames: " << inferStat.skippedFrames;
+                        for (size_t i = 0; i < inputStat.unchangedShares.size(); ++i) {
+                            if (0 == (i % 4)) {
+                                statStream << std::endl;
+                            }
+                            statStream << 100.0f * inputStat.unchangedShares[i] << "% ";
+                        }
+                        statStream << std::endl;
+                    }
+                    for (const auto& writer : writers) {
+                        statStream << "Encoder dropped frames of " << writer->getTarget() << ": "
+                                   << writer->getDroppedFrames() << std::endl;
+                    }
 
                     if (FLAGS_no_show) {
                         slog::info << statStream.str() << slog::endl;
@@ -461,8 +923,36 @@ int main(int argc, char* argv[]) {
             }
         }
 
+#if USE_GAPI
+        if (FLAGS_drain && gapiPipeline) {
+            auto gapiStat = gapiPipeline->getStats();
+            printDrainedFrames(gapiStat.inferredFrames, gapiStat.elapsedTime);
+        }
+        gapiPipeline.reset();
+#endif
+        if (FLAGS_drain && network) {
+            printDrainSummary(network->getStats());
+        }
+
+        cascade.reset();  // stops the second network while the first one still holds the frames of the crops
         network.reset();
 
+        if (FLAGS_show_stats) {
+            tracer.printStats(std::cout);
+        }
+        if (benchmark) {
+            benchmark->writeJson(FLAGS_bench_json, {
+                {"demo", argv[0]}, {"model", FLAGS_m}, {"device", FLAGS_d}, {"tag", FLAGS_bench_tag},
+                {"backend", FLAGS_backend},
+                {"channels", std::to_string(numberOfInputs)}, {"batch_size", std::to_string(FLAGS_bs)},
+                {"infer_requests", std::to_string(FLAGS_nireq)}, {"u8_input", FLAGS_u8_input ? "true" : "false"}});
+            slog::info << "Benchmark report is written to " << FLAGS_bench_json << slog::endl;
+        }
+        if (!FLAGS_trace_file.empty()) {
+            tracer.dumpTrace(FLAGS_trace_file);
+            slog::info << "Frame trace is written to " << FLAGS_trace_file << slog::endl;
+        }
+
         std::cout << presenter.reportMeans() << '\n';
     }
     catch (const std::exception& error) {
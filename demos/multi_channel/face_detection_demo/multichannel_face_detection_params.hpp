@@ -11,3 +11,25 @@
 static const char thresh_output_message[] = "Optional. Probability threshold for detections";
 
 DEFINE_double(t, 0.5, thresh_output_message);
+
+static const char age_gender_model_message[] = "Optional. Path to an .xml file of an age/gender recognition model, e.g. "
+                                               "age-gender-recognition-retail-0013. The detected faces of all the "
+                                               "channels are cut out and classified in batches by it";
+
+DEFINE_string(m_ag, "", age_gender_model_message);
+
+static const char age_gender_device_message[] = "Optional. Target device for the age/gender recognition model";
+
+DEFINE_string(d_ag, "CPU", age_gender_device_message);
+
+static const char age_gender_batch_message[] = "Optional. Batch size of the age/gender recognition model, "
+                                               "the batches mix the faces of all the channels";
+
+DEFINE_uint32(bs_ag, 4, age_gender_batch_message);
+
+static const char backend_message[] = "Optional. The pipeline of the channels: ie - the threads and the queues of the "
+                                      "demo, gapi - a G-API streaming graph per channel if the demo is built with "
+                                      "MULTICHANNEL_DEMO_USE_GAPI. gapi ignores the options of the input and of the "
+                                      "infer queues, e.g. -bs, -roi, -u8_input and -real_input_fps";
+
+DEFINE_string(backend, "ie", backend_message);
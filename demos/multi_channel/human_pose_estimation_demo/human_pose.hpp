@@ -16,14 +16,6 @@
 
 #pragma once
 
-#include <vector>
+#include <pose/human_pose.hpp>
 
-#include <opencv2/core/core.hpp>
-
-struct HumanPose {
-    HumanPose(const std::vector<cv::Point2f>& keypoints = std::vector<cv::Point2f>(),
-              const float& score = 0);
-
-    std::vector<cv::Point2f> keypoints;
-    float score;
-};
+using human_pose_estimation::HumanPose;
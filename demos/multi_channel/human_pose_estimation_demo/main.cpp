@@ -18,7 +18,9 @@
 * \file multichannel_face_detection/main.cpp
 * \example multichannel_face_detection/main.cpp
 */
+#include <algorithm>
 #include <iostream>
+#include <iterator>
 #include <vector>
 #include <utility>
 
@@ -31,6 +33,7 @@
 #include <sstream>
 #include <memory>
 #include <string>
+#include <numeric>
 
 #ifdef USE_TBB
 #include <tbb/parallel_for.h>
@@ -41,15 +44,25 @@
 #include <monitors/presenter.h>
 #include <samples/slog.hpp>
 #include <samples/args_helper.hpp>
+#include <samples/hugepage_allocator.hpp>
+#include <samples/instrumentation.hpp>
+#include <samples/thread_policy.hpp>
 
 #include "input.hpp"
 #include "multichannel_params.hpp"
 #include "output.hpp"
+#include "stream_writer.hpp"
 #include "threading.hpp"
 #include "graph.hpp"
+#include "compositor.hpp"
+#include "latency_tracer.hpp"
+#include "benchmark.hpp"
+#include "metrics_exporter.hpp"
+#include "placement.hpp"
+#include "channel_scheduler.hpp"
+#include "drain.hpp"
 
 #include "human_pose.hpp"
-#include "peak.hpp"
 #include "postprocessor.hpp"
 #include "render_human_pose.hpp"
 #include "postprocess.hpp"
@@ -84,6 +97,48 @@ void showUsage() {
     std::cout << "    -i                           " << input_video << std::endl;
     std::cout << "    -loop_video                  " << loop_video_output_message << std::endl;
     std::cout << "    -u                           " << utilization_monitors_message << std::endl;
+    std::cout << "    -u8_input                    " << u8_input_message << std::endl;
+    std::cout << "    -zero_copy                   " << zero_copy_message << std::endl;
+    std::cout << "    -batch_timeout               " << batch_timeout_message << std::endl;
+    std::cout << "    -postprocess_threads         " << postprocess_threads_message << std::endl;
+    std::cout << "    -auto_throughput             " << auto_throughput_message << std::endl;
+    std::cout << "    -input_overflow              " << input_overflow_message << std::endl;
+    std::cout << "    -infer_overflow              " << infer_overflow_message << std::endl;
+    std::cout << "    -output_overflow             " << output_overflow_message << std::endl;
+    std::cout << "    -trace_file                  " << trace_file_message << std::endl;
+    std::cout << "    -remote_blobs                " << remote_blobs_message << std::endl;
+    std::cout << "    -numa                        " << numa_message << std::endl;
+    std::cout << "    -cam_io                      " << cam_io_message << std::endl;
+    std::cout << "    -cam_format                  " << cam_format_message << std::endl;
+    std::cout << "    -cam_workers                 " << cam_workers_message << std::endl;
+    std::cout << "    -capture_threads             " << capture_threads_message << std::endl;
+    std::cout << "    -hw_file_decode              " << hw_file_decode_message << std::endl;
+    std::cout << "    -roi                         " << roi_message << std::endl;
+    std::cout << "    -motion_threshold            " << motion_threshold_message << std::endl;
+    std::cout << "    -channel_weights             " << channel_weights_message << std::endl;
+    std::cout << "    -drain                       " << drain_message << std::endl;
+    std::cout << "    -ocl_render                  " << ocl_render_message << std::endl;
+    std::cout << "    -cache_dir \"<path>\"          " << cache_dir_message << std::endl;
+    std::cout << "    -metrics_port                " << metrics_port_message << std::endl;
+    std::cout << "    -metrics_push \"<url>\"        " << metrics_push_message << std::endl;
+    std::cout << "    -out \"<target>\"              " << out_message << std::endl;
+    std::cout << "    -out_fps                     " << out_fps_message << std::endl;
+    std::cout << "    -out_hw                      " << out_hw_message << std::endl;
+    std::cout << "    -bus_publish \"<name>\"        " << bus_publish_message << std::endl;
+    std::cout << "    -bus_subscribers             " << bus_subscribers_message << std::endl;
+    std::cout << "    -bus_depth                   " << bus_depth_message << std::endl;
+    std::cout << "    -bench                       " << bench_message << std::endl;
+    std::cout << "    -bench_warmup                " << bench_warmup_message << std::endl;
+    std::cout << "    -bench_json \"<path>\"         " << bench_json_message << std::endl;
+    std::cout << "    -bench_tag \"<tag>\"           " << bench_tag_message << std::endl;
+    std::cout << "    -warmup_runs                 " << warmup_runs_message << std::endl;
+    std::cout << "    -reduced_decode              " << reduced_decode_message << std::endl;
+    std::cout << "    -decode_stripes              " << decode_stripes_message << std::endl;
+    std::cout << "    -record \"<dir>\"              " << record_message << std::endl;
+    std::cout << "    -replay_fast                 " << replay_fast_message << std::endl;
+    std::cout << "    -hugepages                   " << hugepages_message << std::endl;
+    std::cout << "    -adaptive_decode             " << adaptive_decode_message << std::endl;
+    std::cout << "    -thread_shares \"<weights>\"   " << thread_shares_message << std::endl;
 }
 
 bool ParseAndCheckCommandLine(int argc, char *argv[]) {
@@ -102,6 +157,24 @@ bool ParseAndCheckCommandLine(int argc, char *argv[]) {
     if (FLAGS_nc == 0 && FLAGS_i.empty()) {
         throw std::logic_error("Please specify at least one video source(web cam or video file)");
     }
+    if (FLAGS_motion_threshold < 0.0 || FLAGS_motion_threshold > 1.0) {
+        throw std::logic_error("Parameter -motion_threshold must be in [0, 1]");
+    }
+    if (!FLAGS_out.empty() && FLAGS_out_fps <= 0.0) {
+        throw std::logic_error("Parameter -out_fps must be positive");
+    }
+    if (FLAGS_bench > 0 && FLAGS_bench_json.empty()) {
+        throw std::logic_error("Parameter -bench_json is not set, the -bench report isn't mixed with the log");
+    }
+    if (FLAGS_drain) {
+        if (FLAGS_nc != 0) {
+            throw std::logic_error("Web cams never run out of frames, -drain supports video files only");
+        }
+        // neither the display nor dropping may hold frames back
+        FLAGS_no_show = true;
+        FLAGS_loop_video = false;
+        FLAGS_infer_overflow = "block";
+    }
     slog::info << "\tDetection model:           " << FLAGS_m << slog::endl;
     slog::info << "\tUtilizing device:          " << FLAGS_d << slog::endl;
     if (!FLAGS_l.empty()) {
@@ -148,21 +221,31 @@ DisplayParams prepareDisplayParams(size_t count) {
     return params;
 }
 
-void displayNSources(const std::vector<std::shared_ptr<VideoFrame>>& data,
-                     float time,
-                     const std::string& stats,
-                     DisplayParams params,
-                     Presenter& presenter) {
-    cv::Mat windowImage = cv::Mat::zeros(params.windowSize, CV_8UC3);
-    auto loopBody = [&](size_t i) {
-        auto& elem = data[i];
-        if (!elem->frame.empty()) {
-            cv::Rect rectFrame = cv::Rect(params.points[i], params.frameSize);
-            cv::Mat windowPart = windowImage(rectFrame);
-            cv::resize(elem->frame, windowPart, params.frameSize);
-            renderHumanPose(elem->detections.get<std::vector<HumanPose>>(), windowPart);
+// the network sees the region of the frame, so the poses are moved from the region to the whole frame
+void mapToFrame(VideoFrame& vframe, cv::Size frameSize) {
+    if (vframe.roi.empty() || vframe.detections.empty()) {
+        return;
+    }
+    const cv::Point2f absentKeypoint(-1.0f, -1.0f);
+    for (HumanPose& pose : vframe.detections.get<std::vector<HumanPose>>()) {
+        for (cv::Point2f& keypoint : pose.keypoints) {
+            if (keypoint != absentKeypoint) {
+                keypoint = vframe.toFrame(keypoint, frameSize);
+            }
         }
-    };
+    }
+}
+
+cv::Mat& displayNSources(const std::vector<std::shared_ptr<VideoFrame>>& data,
+                         float time,
+                         const std::string& stats,
+                         DisplayParams params,
+                         Presenter& presenter,
+                         GridCompositor& compositor) {
+    DEMO_FRAME("display");
+    cv::Mat& windowImage = compositor.compose(data, [&](cv::Mat& cell, const Detections& detections) {
+        renderHumanPose(detections.get<std::vector<HumanPose>>(), cell);
+    });
 
     auto drawStats = [&]() {
         if (FLAGS_show_stats && !stats.empty()) {
@@ -181,25 +264,16 @@ void displayNSources(const std::vector<std::shared_ptr<VideoFrame>>& data,
         }
     };
 
-//  #ifdef USE_TBB
-#if 0  // disable multithreaded rendering for now
-    run_in_arena([&](){
-        tbb::parallel_for<size_t>(0, data.size(), [&](size_t i) {
-            loopBody(i);
-        });
-    });
-#else
-    for (size_t i = 0; i < data.size(); ++i) {
-        loopBody(i);
-    }
-#endif
     presenter.drawGraphs(windowImage);
     drawStats();
 
     char str[256];
     snprintf(str, sizeof(str), "%5.2f fps", static_cast<double>(1000.0f/time));
     cv::putText(windowImage, str, cv::Point(800, 100), cv::HersheyFonts::FONT_HERSHEY_COMPLEX, 2.0,  cv::Scalar(0, 255, 0), 2);
-    cv::imshow(params.name, windowImage);
+    if (!FLAGS_no_show) {
+        cv::imshow(params.name, windowImage);
+    }
+    return windowImage;
 }
 
 }  // namespace
@@ -215,6 +289,21 @@ int main(int argc, char* argv[]) {
         if (!ParseAndCheckCommandLine(argc, argv)) {
             return 0;
         }
+        if (FLAGS_hugepages) {
+            // before the capture and the inference threads allocate their buffers
+            useHugePageArena();
+        }
+        // before the pools start, with -thread_shares the IE streams, OpenCV and the pipeline take their shares of
+        // the cores
+        std::size_t inferenceThreads = 0;  // the plugin default
+        if (!FLAGS_thread_shares.empty()) {
+            const ThreadPolicy threadPolicy(FLAGS_thread_shares);
+            threadPolicy.report();
+            threadPolicy.apply();
+            set_pipeline_threads(threadPolicy.pipeline());
+            inferenceThreads = threadPolicy.inference();
+        }
+        const bool exportMetrics = 0 != FLAGS_metrics_port || !FLAGS_metrics_push.empty();
 
         std::string modelPath = FLAGS_m;
         std::size_t found = modelPath.find_last_of(".");
@@ -228,18 +317,23 @@ int main(int argc, char* argv[]) {
         IEGraph::InitParams graphParams;
         graphParams.batchSize       = FLAGS_bs;
         graphParams.maxRequests     = FLAGS_nireq;
-        graphParams.collectStats    = FLAGS_show_stats;
+        graphParams.collectStats    = FLAGS_show_stats || exportMetrics;
         graphParams.reportPerf      = FLAGS_pc;
         graphParams.modelPath       = modelPath;
         graphParams.cpuExtPath      = FLAGS_l;
         graphParams.cldnnConfigPath = FLAGS_c;
+        graphParams.cacheDir        = FLAGS_cache_dir;
         graphParams.deviceName      = FLAGS_d;
-
-        std::shared_ptr<IEGraph> network(new IEGraph(graphParams));
-        auto inputDims = network->getInputDims();
-        if (4 != inputDims.size()) {
-            throw std::runtime_error("Invalid network input dimensions");
-        }
+        graphParams.u8Input         = FLAGS_u8_input;
+        graphParams.zeroCopy        = FLAGS_zero_copy;
+        graphParams.batchTimeoutMSec = FLAGS_batch_timeout;
+        graphParams.postprocessThreads = FLAGS_postprocess_threads;
+        graphParams.autoThroughput  = FLAGS_auto_throughput;
+        graphParams.overflowPolicy  = parseOverflowPolicy(FLAGS_infer_overflow);
+        graphParams.remoteSurfaces  = FLAGS_remote_blobs;
+        graphParams.warmupRuns      = FLAGS_warmup_runs;
+        graphParams.arenaBlobs      = FLAGS_hugepages;
+        graphParams.cpuThreads      = inferenceThreads;
 
         std::vector<std::string> files;
         parseInputFilesArguments(files);
@@ -262,10 +356,44 @@ int main(int argc, char* argv[]) {
             throw std::logic_error("Number of inputs exceed maximum value [25]");
         }
 
+        // threads created from now on inherit the placement of the main thread
+        ThreadPlacement placement(FLAGS_numa, numberOfInputs);
+        placement.report();
+        placement.pinMainThread();
+
+        graphParams.numChannels     = numberOfInputs;
+        std::shared_ptr<IEGraph> network(new IEGraph(graphParams));
+        auto inputDims = network->getInputDims();
+        if (4 != inputDims.size()) {
+            throw std::runtime_error("Invalid network input dimensions");
+        }
+
         VideoSources::InitParams vsParams;
         vsParams.queueSize            = FLAGS_n_iqs;
-        vsParams.collectStats         = FLAGS_show_stats;
+        vsParams.collectStats         = FLAGS_show_stats || exportMetrics;
         vsParams.realFps              = FLAGS_real_input_fps;
+        vsParams.readTimeoutMSec      = FLAGS_batch_timeout;
+        vsParams.overflowPolicy       = parseOverflowPolicy(FLAGS_input_overflow);
+        vsParams.hwSurfaces           = FLAGS_remote_blobs;
+        vsParams.downloadSurfaces     = !FLAGS_no_show || !FLAGS_out.empty() || !FLAGS_bus_publish.empty() ||
+                                        !FLAGS_record.empty();
+        vsParams.channelCpus          = placement.getChannelsCpus();
+        vsParams.channelRois          = parseChannelRois(FLAGS_roi);
+        vsParams.motionThreshold      = static_cast<float>(FLAGS_motion_threshold);
+        vsParams.publishBus           = FLAGS_bus_publish;
+        vsParams.busSubscribers       = FLAGS_bus_subscribers;
+        vsParams.busDepth             = FLAGS_bus_depth;
+        vsParams.cameraFormat         = FLAGS_cam_format;
+        vsParams.cameraIo             = FLAGS_cam_io;
+        vsParams.cameraWorkers        = FLAGS_cam_workers;
+        vsParams.captureThreads       = FLAGS_capture_threads;
+        vsParams.hwFileDecoding       = FLAGS_hw_file_decode;
+        vsParams.drain                = FLAGS_drain;
+        vsParams.reducedDecoding      = FLAGS_reduced_decode;
+        vsParams.decodingStripes      = FLAGS_decode_stripes;
+        vsParams.adaptiveDecoding     = FLAGS_adaptive_decode;
+        vsParams.recordDir            = FLAGS_record;
+        vsParams.replayFast           = FLAGS_replay_fast;
         vsParams.expectedHeight = static_cast<unsigned>(inputDims[2]);
         vsParams.expectedWidth  = static_cast<unsigned>(inputDims[3]);
 
@@ -292,16 +420,23 @@ int main(int argc, char* argv[]) {
                 }
             }
         }
+        // created before the sources start, so the trace begins with the first captured frame
+        LatencyTracer tracer(numberOfInputs, LatencyTracer::DefaultWindowSize, !FLAGS_trace_file.empty());
+        std::unique_ptr<SteadyStateBenchmark> benchmark;
+        if (FLAGS_bench > 0) {
+            benchmark.reset(new SteadyStateBenchmark(numberOfInputs, std::chrono::seconds(FLAGS_bench_warmup),
+                                                     std::chrono::seconds(FLAGS_bench)));
+        }
         sources.start();
 
-        size_t currentFrame = 0;
+        // in drain mode channels are read to their ends, the input is over once all of them are
+        ChannelScheduler channelScheduler(FLAGS_channel_weights, numberOfInputs);
+        // the pose vectors of the frames the pipeline released are refilled
+        auto posesPool = std::make_shared<DetectionsPool<std::vector<HumanPose>>>();
 
         network->start([&](VideoFrame& img) {
-            img.sourceIdx = currentFrame;
-            auto camIdx = currentFrame / duplicateFactor;
-            currentFrame = (currentFrame + 1) % numberOfInputs;
-            return sources.getFrame(camIdx, img);
-        }, [](InferenceEngine::InferRequest::Ptr req, const std::vector<std::string>& outputDataBlobNames, cv::Size frameSize) {
+            return readScheduledFrame(channelScheduler, sources, duplicateFactor, FLAGS_drain, img);
+        }, [posesPool](InferenceEngine::InferRequest::Ptr req, const std::vector<std::string>& outputDataBlobNames, cv::Size frameSize) {
             auto pafsBlobIt   = req->GetBlob(outputDataBlobNames[0]);
             auto pafsDesc     = pafsBlobIt->getTensorDesc();
             auto pafsWidth    = getTensorWidth(pafsDesc);
@@ -316,8 +451,8 @@ int main(int argc, char* argv[]) {
             auto heatMapsChannels = getTensorChannels(heatMapsDesc);
             std::vector<Detections> detections(pafsBatch);
 
-
-            for (size_t i = 0; i < pafsBatch; i++) {
+            // the frames of the batch are postprocessed in parallel, each one to its place in the batch order
+            parallelFor(pafsBatch, [&](size_t i) {
                 std::vector<HumanPose> poses = postprocess(
                 static_cast<float*>(heatMapsBlobIt->buffer()) + i * heatMapsWidth * heatMapsHeight * heatMapsChannels,
                 heatMapsWidth * heatMapsHeight,
@@ -327,11 +462,11 @@ int main(int argc, char* argv[]) {
                 pafsChannels,
                 heatMapsWidth, heatMapsHeight, frameSize);
 
-                detections[i].set(new std::vector<HumanPose>(poses.size()));
-                for (decltype(poses.size()) j = 0; j < poses.size(); j++) {
-                    detections[i].get<std::vector<HumanPose>>()[j] = std::move(poses[j]);
-                }
-            }
+                detections[i] = posesPool->acquire();
+                auto& framePoses = detections[i].get<std::vector<HumanPose>>();
+                framePoses.insert(framePoses.end(), std::make_move_iterator(poses.begin()),
+                                  std::make_move_iterator(poses.end()));
+            });
             return detections;
         });
 
@@ -350,16 +485,52 @@ int main(int argc, char* argv[]) {
 
         cv::Size graphSize{static_cast<int>(params.windowSize.width / 4), 60};
         Presenter presenter(FLAGS_u, params.windowSize.height - graphSize.height - 10, graphSize);
+        GridCompositor compositor(params.windowSize, params.frameSize,
+                                  std::vector<cv::Point>(params.points, params.points + params.count), FLAGS_ocl_render);
+
+        // the encoders take the frames from the output thread and don't wait for the display
+        const size_t encoderQueueSize = 4;
+        std::vector<std::unique_ptr<StreamWriter>> writers;
+        if (!FLAGS_out.empty()) {
+            if (channelTarget(FLAGS_out, 0).empty()) {
+                writers.emplace_back(new StreamWriter(FLAGS_out, params.windowSize, FLAGS_out_fps,
+                                                      encoderQueueSize, FLAGS_out_hw));
+            } else {
+                for (size_t i = 0; i < numberOfInputs; i++) {
+                    writers.emplace_back(new StreamWriter(channelTarget(FLAGS_out, i), params.frameSize,
+                                                          FLAGS_out_fps, encoderQueueSize, FLAGS_out_hw));
+                }
+            }
+        }
+        const bool render = !FLAGS_no_show || !writers.empty();
 
         const size_t outputQueueSize = 1;
-        AsyncOutput output(FLAGS_show_stats, outputQueueSize,
+        AsyncOutput output(FLAGS_show_stats || exportMetrics, outputQueueSize,
+                           parseOverflowPolicy(FLAGS_output_overflow), numberOfInputs,
         [&](const std::vector<std::shared_ptr<VideoFrame>>& result) {
             std::string str;
             if (FLAGS_show_stats) {
                 std::unique_lock<std::mutex> lock(statMutex);
                 str = statStream.str();
             }
-            displayNSources(result, averageFps, str, params, presenter);
+            displayNSources(result, averageFps, str, params, presenter, compositor);
+            for (const auto& frame : result) {
+                frame->trace.stamp(FrameTrace::Render);
+                tracer.add(*frame);
+                if (benchmark) {
+                    benchmark->add(*frame);
+                }
+            }
+            if (writers.size() == 1 && channelTarget(FLAGS_out, 0).empty()) {
+                writers.front()->write(windowImage);
+            } else {
+                for (size_t i = 0; i < writers.size(); i++) {
+                    writers[i]->write(windowImage(cv::Rect(params.points[i], params.frameSize)));
+                }
+            }
+            if (FLAGS_no_show) {
+                return true;
+            }
             int key = cv::waitKey(1);
             presenter.handleKey(key);
 
@@ -368,6 +539,11 @@ int main(int argc, char* argv[]) {
 
         output.start();
 
+        std::unique_ptr<PipelineMetrics> metrics;
+        if (exportMetrics) {
+            metrics.reset(new PipelineMetrics(FLAGS_metrics_port, FLAGS_metrics_push));
+        }
+
         using timer = std::chrono::high_resolution_clock;
         using duration = std::chrono::duration<float, std::milli>;
         timer::time_point lastTime = timer::now();
@@ -385,12 +561,19 @@ int main(int argc, char* argv[]) {
                     break; // IEGraph::getBatchData had nothing to process and returned. That means it was stopped
                 }
                 for (size_t i = 0; i < br.size(); i++) {
+                    mapToFrame(*br[i], params.frameSize);
+                    if (!render) {
+                        tracer.add(*br[i]);  // nothing is rendered, so postprocessing ends the trace
+                        if (benchmark) {
+                            benchmark->add(*br[i]);
+                        }
+                    }
                     // this approach waits for the next input image for sourceIdx. If provided a single image,
                     // it may not show results, especially if -real_input_fps is enabled
                     auto val = static_cast<unsigned int>(br[i]->sourceIdx);
                     auto it = find_if(batchRes.begin(), batchRes.end(), [val] (const std::shared_ptr<VideoFrame>& vf) { return vf->sourceIdx == val; } );
                     if (it != batchRes.end()) {
-                        if (!FLAGS_no_show) {
+                        if (render) {
                             output.push(std::move(batchRes));
                         }
                         batchRes.clear();
@@ -401,7 +584,7 @@ int main(int argc, char* argv[]) {
             }
             ++fpsCounter;
 
-            if (!output.isAlive()) {
+            if (!output.isAlive() || (benchmark && benchmark->finished())) {
                 break;
             }
 
@@ -414,13 +597,17 @@ int main(int argc, char* argv[]) {
                 fpsCounter = 0;
                 lastTime = currTime;
 
+                averageFps = frameTime;  // also drawn into the encoded streams
                 if (FLAGS_no_show) {
                     slog::info << "Average Throughput : " << 1000.f/frameTime << " fps" << slog::endl;
-                    if (++perfItersCounter >= FLAGS_n_sp) {
+                    if (!FLAGS_drain && !benchmark && ++perfItersCounter >= FLAGS_n_sp) {
                         break;
                     }
-                } else {
-                    averageFps = frameTime;
+                }
+
+                if (metrics) {
+                    metrics->publish(1000.f / frameTime, sources.getStats(), network->getStats(),
+                                     output.getStats(), tracer.getStats());
                 }
 
                 if (FLAGS_show_stats) {
@@ -439,18 +626,103 @@ int main(int argc, char* argv[]) {
                         statStream << inputStat.readTimes[i] << "ms ";
                     }
                     statStream << std::endl;
+                    if (std::any_of(inputStat.captureLatencies.begin(), inputStat.captureLatencies.end(),
+                                    [](float latency) { return latency > 0.0f; })) {
+                        statStream << "Camera dequeue latency: ";
+                        for (size_t i = 0; i < inputStat.captureLatencies.size(); ++i) {
+                            if (0 == (i % 4)) {
+                                statStream << std::endl;
+                            }
+                            statStream << inputStat.captureLatencies[i] << "ms ";
+                        }
+                        statStream << std::endl;
+                    }
                     statStream << "HW decoding latency: "
-                               << inputStat.decodingLatency << "ms";
+                               << inputStat.decodingLatency << "ms (batch "
+                               << inputStat.decodingBatchSize << ")";
                     statStream << std::endl;
+                    if (!inputStat.decodingModes.empty()) {
+                        statStream << "Decoding routes: HW " << inputStat.hwDecodingLatency << "ms, SW "
+                                   << inputStat.swDecodingLatency << "ms, " << inputStat.decodingReroutes
+                                   << " reroutes";
+                        for (size_t i = 0; i < inputStat.decodingModes.size(); ++i) {
+                            if (0 == (i % 8)) {
+                                statStream << std::endl;
+                            }
+                            statStream << (Decoder::Mode::Hw == inputStat.decodingModes[i] ? "HW " : "SW ");
+                        }
+                        statStream << std::endl;
+                    }
                     statStream << "Preprocess time: "
                                << inferStat.preprocessTime << "ms";
                     statStream << std::endl;
                     statStream << "Plugin latency: "
-                               << inferStat.inferTime << "ms";
+                               << inferStat.inferTime << "ms (p95/p99/max: "
+                               << inferStat.inferTimeStats.p95 << "/" << inferStat.inferTimeStats.p99 << "/"
+                               << inferStat.inferTimeStats.max << "ms)";
+                    statStream << std::endl;
+                    statStream << "Input copies per frame: "
+                               << inferStat.copiesPerFrame;
+                    statStream << std::endl;
+                    statStream << "Batch fill ratio: "
+                               << inferStat.batchFillRatio;
                     statStream << std::endl;
+                    if (inferStat.devices.size() > 1) {
+                        for (const auto& device : inferStat.devices) {
+                            statStream << device.name << ": " << device.inferTime << "ms "
+                                       << 100.0f * device.batchesShare << "%" << std::endl;
+                        }
+                    }
 
                     statStream << "Render time: " << outputStat.renderTime
-                               << "ms" << std::endl;
+                               << "ms (p95/p99/max: " << outputStat.renderTimeStats.p95 << "/"
+                               << outputStat.renderTimeStats.p99 << "/" << outputStat.renderTimeStats.max
+                               << "ms)" << std::endl;
+
+                    auto latencyStat = tracer.getStats();
+                    statStream << "End-to-end latency p50/p95/p99:";
+                    for (size_t i = 0; i < latencyStat.size(); ++i) {
+                        if (0 == (i % 4)) {
+                            statStream << std::endl;
+                        }
+                        const auto& endToEnd = latencyStat[i].intervals[LatencyTracer::EndToEnd];
+                        statStream << endToEnd.p50 << "/" << endToEnd.p95 << "/" << endToEnd.p99 << "ms ";
+                    }
+                    statStream << std::endl;
+                    auto sum = [](const std::vector<size_t>& counters) {
+                        return std::accumulate(counters.begin(), counters.end(), size_t(0));
+                    };
+                    statStream << "Dropped frames (input/infer/render): " << sum(inputStat.droppedFrames) << "/"
+                               << sum(inferStat.droppedFrames) << "/" << sum(outputStat.droppedFrames);
+                    for (size_t i = 0; i < inferStat.droppedFrames.size() && i < outputStat.droppedFrames.size(); ++i) {
+                        if (0 == (i % 4)) {
+                            statStream << std::endl;
+                        }
+                        statStream << inferStat.droppedFrames[i] + outputStat.droppedFrames[i] << " ";
+                    }
+                    statStream << std::endl;
+                    statStream << "Channel FPS: ";
+                    for (size_t i = 0; i < inferStat.channelFps.size(); ++i) {
+                        if (0 == (i % 4)) {
+                            statStream << std::endl;
+                        }
+                        statStream << inferStat.channelFps[i] << " ";
+                    }
+                    statStream << std::endl;
+                    if (!inputStat.unchangedShares.empty()) {
+                        statStream << "Skipped unchanged frames: " << inferStat.skippedFrames;
+                        for (size_t i = 0; i < inputStat.unchangedShares.size(); ++i) {
+                            if (0 == (i % 4)) {
+                                statStream << std::endl;
+                            }
+                            statStream << 100.0f * inputStat.unchangedShares[i] << "% ";
+                        }
+                        statStream << std::endl;
+                    }
+                    for (const auto& writer : writers) {
+                        statStream << "Encoder dropped frames of " << writer->getTarget() << ": "
+                                   << writer->getDroppedFrames() << std::endl;
+                    }
 
                     if (FLAGS_no_show) {
                         slog::info << statStream.str() << slog::endl;
@@ -459,8 +731,27 @@ int main(int argc, char* argv[]) {
             }
         }
 
+        if (FLAGS_drain) {
+            printDrainSummary(network->getStats());
+        }
+
         network.reset();
 
+        if (FLAGS_show_stats) {
+            tracer.printStats(std::cout);
+        }
+        if (benchmark) {
+            benchmark->writeJson(FLAGS_bench_json, {
+                {"demo", argv[0]}, {"model", FLAGS_m}, {"device", FLAGS_d}, {"tag", FLAGS_bench_tag},
+                {"channels", std::to_string(numberOfInputs)}, {"batch_size", std::to_string(FLAGS_bs)},
+                {"infer_requests", std::to_string(FLAGS_nireq)}, {"u8_input", FLAGS_u8_input ? "true" : "false"}});
+            slog::info << "Benchmark report is written to " << FLAGS_bench_json << slog::endl;
+        }
+        if (!FLAGS_trace_file.empty()) {
+            tracer.dumpTrace(FLAGS_trace_file);
+            slog::info << "Frame trace is written to " << FLAGS_trace_file << slog::endl;
+        }
+
         std::cout << presenter.reportMeans() << '\n';
     }
     catch (const std::exception& error) {
@@ -16,31 +16,12 @@
 
 #include <vector>
 
+#include <pose/peak.hpp>
+
 #include "postprocess.hpp"
-#include "peak.hpp"
 #include "postprocessor.hpp"
 
 namespace {
-class FindPeaksBody: public cv::ParallelLoopBody {
-public:
-    FindPeaksBody(const std::vector<cv::Mat>& heatMaps, float minPeaksDistance,
-                  std::vector<std::vector<Peak> >& peaksFromHeatMap)
-        : heatMaps(heatMaps),
-          minPeaksDistance(minPeaksDistance),
-          peaksFromHeatMap(peaksFromHeatMap) {}
-
-    virtual void operator()(const cv::Range& range) const {
-        for (int i = range.start; i < range.end; i++) {
-            findPeaks(heatMaps, minPeaksDistance, peaksFromHeatMap, i);
-        }
-    }
-
-private:
-    const std::vector<cv::Mat>& heatMaps;
-    float minPeaksDistance;
-    std::vector<std::vector<Peak> >& peaksFromHeatMap;
-};
-
 int upsampleRatio = 4;
 int stride = 8;
 float minPeaksDistance = 6.0f / (stride / upsampleRatio);
@@ -54,21 +35,11 @@ float minSubsetScore = 0.2f;
 std::vector<HumanPose> extractPoses(
         const std::vector<cv::Mat>& heatMaps,
         const std::vector<cv::Mat>& pafs) {
-    std::vector<std::vector<Peak> > peaksFromHeatMap(heatMaps.size());
-    FindPeaksBody findPeaksBody(heatMaps, minPeaksDistance, peaksFromHeatMap);
-    cv::parallel_for_(cv::Range(0, static_cast<int>(heatMaps.size())),
-                      findPeaksBody);
-    int peaksBefore = 0;
-    for (size_t heatmapId = 1; heatmapId < heatMaps.size(); heatmapId++) {
-        peaksBefore += static_cast<int>(peaksFromHeatMap[heatmapId - 1].size());
-        for (auto& peak : peaksFromHeatMap[heatmapId]) {
-            peak.id += peaksBefore;
-        }
-    }
-    std::vector<HumanPose> poses = groupPeaksToPoses(
-                peaksFromHeatMap, pafs, keypointsNumber, midPointsScoreThreshold,
-                foundMidPointsRatioThreshold, minJointsNumber, minSubsetScore);
-    return poses;
+    // the frames of the channels are postprocessed by several threads
+    static thread_local human_pose_estimation::PoseGroupingScratch scratch;
+    return human_pose_estimation::findPoses(
+                heatMaps, pafs, keypointsNumber, minPeaksDistance, midPointsScoreThreshold,
+                foundMidPointsRatioThreshold, minJointsNumber, minSubsetScore, false, scratch);
 }
 }  // namespace
 
@@ -77,6 +48,8 @@ std::vector<HumanPose> postprocess(
         const float* pafsData, const int pafOffset, const int nPafs,
         const int featureMapWidth, const int featureMapHeight,
         const cv::Size& imageSize) {
+    // the upsampled maps are reused by the next frames of the thread
+    static thread_local std::vector<cv::Mat> upsampledHeatMaps, upsampledPafs;
     std::vector<cv::Mat> heatMaps(nHeatMaps);
     for (size_t i = 0; i < heatMaps.size(); i++) {
         heatMaps[i] = cv::Mat(featureMapHeight, featureMapWidth, CV_32FC1,
@@ -84,7 +57,7 @@ std::vector<HumanPose> postprocess(
                                   const_cast<float*>(
                                       heatMapsData + i * heatMapOffset)));
     }
-    postprocessor.resizeFeatureMaps(heatMaps);
+    postprocessor.resizeFeatureMaps(heatMaps, upsampledHeatMaps);
 
     std::vector<cv::Mat> pafs(nPafs);
     for (size_t i = 0; i < pafs.size(); i++) {
@@ -93,9 +66,9 @@ std::vector<HumanPose> postprocess(
                               const_cast<float*>(
                                   pafsData + i * pafOffset)));
     }
-    postprocessor.resizeFeatureMaps(pafs);
+    postprocessor.resizeFeatureMaps(pafs, upsampledPafs);
 
-    std::vector<HumanPose> poses = extractPoses(heatMaps, pafs);
-    postprocessor.correctCoordinates(poses, heatMaps[0].size(), imageSize);
+    std::vector<HumanPose> poses = extractPoses(upsampledHeatMaps, upsampledPafs);
+    postprocessor.correctCoordinates(poses, upsampledHeatMaps[0].size(), imageSize);
     return poses;
 }
@@ -26,9 +26,10 @@ Postprocessor::Postprocessor(int const upsampleRatio, int const stride, cv::Vec4
       stride(stride),
       pad(pad) {}
 
-void Postprocessor::resizeFeatureMaps(std::vector<cv::Mat>& featureMaps) const {
-    for (auto& featureMap : featureMaps) {
-        cv::resize(featureMap, featureMap, cv::Size(),
+void Postprocessor::resizeFeatureMaps(const std::vector<cv::Mat>& featureMaps, std::vector<cv::Mat>& upsampled) const {
+    upsampled.resize(featureMaps.size());
+    for (size_t i = 0; i < featureMaps.size(); i++) {
+        cv::resize(featureMaps[i], upsampled[i], cv::Size(),
                    upsampleRatio, upsampleRatio, cv::INTER_CUBIC);
     }
 }
@@ -25,7 +25,8 @@
 class Postprocessor {
 public:
     explicit Postprocessor(int const upsampleRatio = 4, int const stride = 8, cv::Vec4i const pad = cv::Vec4i::all(0));
-    void resizeFeatureMaps(std::vector<cv::Mat>& featureMaps) const;
+    // upsampled keeps the buffers of the previous call if the sizes are the same
+    void resizeFeatureMaps(const std::vector<cv::Mat>& featureMaps, std::vector<cv::Mat>& upsampled) const;
     void correctCoordinates(std::vector<HumanPose>& poses,
                             const cv::Size& featureMapsSize,
                             const cv::Size& imageSize) const;
@@ -20,6 +20,7 @@
 #include <sstream>
 #include <memory>
 #include <string>
+#include <numeric>
 
 #ifdef USE_TBB
 #include <tbb/parallel_for.h>
@@ -31,13 +32,26 @@
 #include <monitors/presenter.h>
 #include <samples/slog.hpp>
 #include <samples/args_helper.hpp>
+#include <samples/hugepage_allocator.hpp>
+#include <samples/instrumentation.hpp>
+#include <samples/thread_policy.hpp>
+#include <samples/nms.hpp>
+#include <samples/yolo_region.hpp>
 
 #include "input.hpp"
 #include "multichannel_params.hpp"
 #include "multichannel_object_detection_demo_yolov3_params.hpp"
 #include "output.hpp"
+#include "stream_writer.hpp"
 #include "threading.hpp"
 #include "graph.hpp"
+#include "compositor.hpp"
+#include "latency_tracer.hpp"
+#include "benchmark.hpp"
+#include "metrics_exporter.hpp"
+#include "placement.hpp"
+#include "channel_scheduler.hpp"
+#include "drain.hpp"
 
 namespace {
 
@@ -70,6 +84,48 @@ void showUsage() {
     std::cout << "    -i                           " << input_video << std::endl;
     std::cout << "    -loop_video                  " << loop_video_output_message << std::endl;
     std::cout << "    -u                           " << utilization_monitors_message << std::endl;
+    std::cout << "    -u8_input                    " << u8_input_message << std::endl;
+    std::cout << "    -zero_copy                   " << zero_copy_message << std::endl;
+    std::cout << "    -batch_timeout               " << batch_timeout_message << std::endl;
+    std::cout << "    -postprocess_threads         " << postprocess_threads_message << std::endl;
+    std::cout << "    -auto_throughput             " << auto_throughput_message << std::endl;
+    std::cout << "    -input_overflow              " << input_overflow_message << std::endl;
+    std::cout << "    -infer_overflow              " << infer_overflow_message << std::endl;
+    std::cout << "    -output_overflow             " << output_overflow_message << std::endl;
+    std::cout << "    -trace_file                  " << trace_file_message << std::endl;
+    std::cout << "    -remote_blobs                " << remote_blobs_message << std::endl;
+    std::cout << "    -numa                        " << numa_message << std::endl;
+    std::cout << "    -cam_io                      " << cam_io_message << std::endl;
+    std::cout << "    -cam_format                  " << cam_format_message << std::endl;
+    std::cout << "    -cam_workers                 " << cam_workers_message << std::endl;
+    std::cout << "    -capture_threads             " << capture_threads_message << std::endl;
+    std::cout << "    -hw_file_decode              " << hw_file_decode_message << std::endl;
+    std::cout << "    -roi                         " << roi_message << std::endl;
+    std::cout << "    -motion_threshold            " << motion_threshold_message << std::endl;
+    std::cout << "    -channel_weights             " << channel_weights_message << std::endl;
+    std::cout << "    -drain                       " << drain_message << std::endl;
+    std::cout << "    -ocl_render                  " << ocl_render_message << std::endl;
+    std::cout << "    -cache_dir \"<path>\"          " << cache_dir_message << std::endl;
+    std::cout << "    -metrics_port                " << metrics_port_message << std::endl;
+    std::cout << "    -metrics_push \"<url>\"        " << metrics_push_message << std::endl;
+    std::cout << "    -out \"<target>\"              " << out_message << std::endl;
+    std::cout << "    -out_fps                     " << out_fps_message << std::endl;
+    std::cout << "    -out_hw                      " << out_hw_message << std::endl;
+    std::cout << "    -bus_publish \"<name>\"        " << bus_publish_message << std::endl;
+    std::cout << "    -bus_subscribers             " << bus_subscribers_message << std::endl;
+    std::cout << "    -bus_depth                   " << bus_depth_message << std::endl;
+    std::cout << "    -bench                       " << bench_message << std::endl;
+    std::cout << "    -bench_warmup                " << bench_warmup_message << std::endl;
+    std::cout << "    -bench_json \"<path>\"         " << bench_json_message << std::endl;
+    std::cout << "    -bench_tag \"<tag>\"           " << bench_tag_message << std::endl;
+    std::cout << "    -warmup_runs                 " << warmup_runs_message << std::endl;
+    std::cout << "    -reduced_decode              " << reduced_decode_message << std::endl;
+    std::cout << "    -decode_stripes              " << decode_stripes_message << std::endl;
+    std::cout << "    -record \"<dir>\"              " << record_message << std::endl;
+    std::cout << "    -replay_fast                 " << replay_fast_message << std::endl;
+    std::cout << "    -hugepages                   " << hugepages_message << std::endl;
+    std::cout << "    -adaptive_decode             " << adaptive_decode_message << std::endl;
+    std::cout << "    -thread_shares \"<weights>\"   " << thread_shares_message << std::endl;
 }
 
 bool ParseAndCheckCommandLine(int argc, char *argv[]) {
@@ -88,6 +144,24 @@ bool ParseAndCheckCommandLine(int argc, char *argv[]) {
     if (FLAGS_nc == 0 && FLAGS_i.empty()) {
         throw std::logic_error("Please specify at least one video source(web cam or video file)");
     }
+    if (FLAGS_motion_threshold < 0.0 || FLAGS_motion_threshold > 1.0) {
+        throw std::logic_error("Parameter -motion_threshold must be in [0, 1]");
+    }
+    if (!FLAGS_out.empty() && FLAGS_out_fps <= 0.0) {
+        throw std::logic_error("Parameter -out_fps must be positive");
+    }
+    if (FLAGS_bench > 0 && FLAGS_bench_json.empty()) {
+        throw std::logic_error("Parameter -bench_json is not set, the -bench report isn't mixed with the log");
+    }
+    if (FLAGS_drain) {
+        if (FLAGS_nc != 0) {
+            throw std::logic_error("Web cams never run out of frames, -drain supports video files only");
+        }
+        // neither the display nor dropping may hold frames back
+        FLAGS_no_show = true;
+        FLAGS_loop_video = false;
+        FLAGS_infer_overflow = "block";
+    }
     slog::info << "\tDetection model:           " << FLAGS_m << slog::endl;
     slog::info << "\tDetection threshold:       " << FLAGS_t << slog::endl;
     slog::info << "\tUtilizing device:          " << FLAGS_d << slog::endl;
@@ -104,12 +178,6 @@ bool ParseAndCheckCommandLine(int argc, char *argv[]) {
     return true;
 }
 
-static int EntryIndex(int side, int lcoords, int lclasses, int location, int entry) {
-    int n = location / (side * side);
-    int loc = location % (side * side);
-    return n * side * side * (lcoords + lclasses + 1) + entry * side * side + loc;
-}
-
 class YoloParams {
     template <typename T>
     void computeAnchors(const std::vector<float> & initialAnchors, const std::vector<T> & mask) {
@@ -170,68 +238,44 @@ struct DetectionObject {
     }
 };
 
-double IntersectionOverUnion(const DetectionObject &box_1, const DetectionObject &box_2) {
-    double width_of_overlap_area = fmin(box_1.xmax, box_2.xmax) - fmax(box_1.xmin, box_2.xmin);
-    double height_of_overlap_area = fmin(box_1.ymax, box_2.ymax) - fmax(box_1.ymin, box_2.ymin);
-    double area_of_overlap;
-    if (width_of_overlap_area < 0 || height_of_overlap_area < 0)
-        area_of_overlap = 0;
-    else
-        area_of_overlap = width_of_overlap_area * height_of_overlap_area;
-    double box_1_area = (box_1.ymax - box_1.ymin)  * (box_1.xmax - box_1.xmin);
-    double box_2_area = (box_2.ymax - box_2.ymin)  * (box_2.xmax - box_2.xmin);
-    double area_of_union = box_1_area + box_2_area - area_of_overlap;
-    return area_of_overlap / area_of_union;
-}
-
-void ParseYOLOV3Output(InferenceEngine::InferRequest::Ptr req,
-                       const std::string &outputName,
+void ParseYOLOV3Output(const InferenceEngine::Blob::Ptr &blob, size_t batchIdx,
                        const YoloParams &yoloParams, const unsigned long resized_im_h,
                        const unsigned long resized_im_w, const unsigned long original_im_h,
                        const unsigned long original_im_w,
                        const double threshold, std::vector<DetectionObject> &objects) {
-    InferenceEngine::Blob::Ptr blob = req->GetBlob(outputName);
-
-    const int out_blob_h = static_cast<int>(blob->getTensorDesc().getDims()[2]);
-    const int out_blob_w = static_cast<int>(blob->getTensorDesc().getDims()[3]);
+    const InferenceEngine::SizeVector &dims = blob->getTensorDesc().getDims();
+    const int out_blob_h = static_cast<int>(dims[2]);
+    const int out_blob_w = static_cast<int>(dims[3]);
     if (out_blob_h != out_blob_w)
         throw std::runtime_error("Invalid size of output. It should be in NCHW layout and H should be equal to W. Current H = " + std::to_string(out_blob_h) +
         ", current W = " + std::to_string(out_blob_h));
 
-    auto num = yoloParams.num;
-    auto coords = yoloParams.coords;
-    auto classes = yoloParams.classes;
-
-    auto anchors = yoloParams.anchors;
-
-    auto side = out_blob_h;
-    auto side_square = side * side;
-    const float *output_blob = blob->buffer().as<InferenceEngine::PrecisionTrait<InferenceEngine::Precision::FP32>::value_type *>();
+    const float h_scale = static_cast<float>(original_im_h) / static_cast<float>(resized_im_h);
+    const float w_scale = static_cast<float>(original_im_w) / static_cast<float>(resized_im_w);
+    const float *output_blob = blob->buffer().as<InferenceEngine::PrecisionTrait<InferenceEngine::Precision::FP32>::value_type *>()
+                               + batchIdx * dims[1] * dims[2] * dims[3];
     // --------------------------- Parsing YOLO Region output -------------------------------------
-    for (int i = 0; i < side_square; ++i) {
-        int row = i / side;
-        int col = i % side;
-        for (int n = 0; n < num; ++n) {
-            int obj_index = EntryIndex(side, coords, classes, n * side * side + i, coords);
-            int box_index = EntryIndex(side, coords, classes, n * side * side + i, 0);
-            float scale = output_blob[obj_index];
-            if (scale < threshold)
-                continue;
-            double x = (col + output_blob[box_index + 0 * side_square]) / side * resized_im_w;
-            double y = (row + output_blob[box_index + 1 * side_square]) / side * resized_im_h;
-            double height = std::exp(output_blob[box_index + 3 * side_square]) * anchors[2 * n + 1];
-            double width = std::exp(output_blob[box_index + 2 * side_square]) * anchors[2 * n];
-            for (int j = 0; j < classes; ++j) {
-                int class_index = EntryIndex(side, coords, classes, n * side_square + i, coords + 1 + j);
-                float prob = scale * output_blob[class_index];
-                if (prob < threshold)
-                    continue;
-                DetectionObject obj(x, y, height, width, j, prob,
-                        static_cast<float>(original_im_h) / static_cast<float>(resized_im_h),
-                        static_cast<float>(original_im_w) / static_cast<float>(resized_im_w));
-                objects.push_back(obj);
-            }
-        }
+    decodeYoloRegion(output_blob, out_blob_h, yoloParams.num, yoloParams.coords, yoloParams.classes, yoloParams.anchors,
+                     static_cast<float>(threshold), cv::Size(static_cast<int>(resized_im_w), static_cast<int>(resized_im_h)),
+                     [&](float x, float y, float height, float width, int class_id, float prob) {
+        objects.emplace_back(x, y, height, width, class_id, prob, h_scale, w_scale);
+    });
+}
+
+// the network sees the region of the frame, so the boxes are moved from the region to the whole frame
+void mapToFrame(VideoFrame& vframe, cv::Size frameSize) {
+    if (vframe.roi.empty() || vframe.detections.empty()) {
+        return;
+    }
+    for (DetectionObject& object : vframe.detections.get<std::vector<DetectionObject>>()) {
+        const cv::Point2f tl = vframe.toFrame(cv::Point2f(static_cast<float>(object.xmin),
+                                                          static_cast<float>(object.ymin)), frameSize);
+        const cv::Point2f br = vframe.toFrame(cv::Point2f(static_cast<float>(object.xmax),
+                                                          static_cast<float>(object.ymax)), frameSize);
+        object.xmin = static_cast<int>(tl.x);
+        object.ymin = static_cast<int>(tl.y);
+        object.xmax = static_cast<int>(br.x);
+        object.ymax = static_cast<int>(br.y);
     }
 }
 
@@ -307,22 +351,17 @@ std::map<std::string, YoloParams> GetYoloParams(const std::vector<std::string>&
     return __yoloParams;
 }
 
-void displayNSources(const std::vector<std::shared_ptr<VideoFrame>>& data,
-                     float time,
-                     const std::string& stats,
-                     const DisplayParams& params,
-                     const std::vector<cv::Scalar> &colors,
-                     Presenter& presenter) {
-    cv::Mat windowImage = cv::Mat::zeros(params.windowSize, CV_8UC3);
-    auto loopBody = [&](size_t i) {
-        auto& elem = data[i];
-        if (!elem->frame.empty()) {
-            cv::Rect rectFrame = cv::Rect(params.points[i], params.frameSize);
-            cv::Mat windowPart = windowImage(rectFrame);
-            cv::resize(elem->frame, windowPart, params.frameSize);
-            drawDetections(windowPart, elem->detections.get<std::vector<DetectionObject>>(), colors);
-        }
-    };
+cv::Mat& displayNSources(const std::vector<std::shared_ptr<VideoFrame>>& data,
+                         float time,
+                         const std::string& stats,
+                         const DisplayParams& params,
+                         const std::vector<cv::Scalar> &colors,
+                         Presenter& presenter,
+                         GridCompositor& compositor) {
+    DEMO_FRAME("display");
+    cv::Mat& windowImage = compositor.compose(data, [&](cv::Mat& cell, const Detections& detections) {
+        drawDetections(cell, detections.get<std::vector<DetectionObject>>(), colors);
+    });
 
     auto drawStats = [&]() {
         if (FLAGS_show_stats && !stats.empty()) {
@@ -341,25 +380,16 @@ void displayNSources(const std::vector<std::shared_ptr<VideoFrame>>& data,
         }
     };
 
-//  #ifdef USE_TBB
-#if 0  // disable multithreaded rendering for now
-    run_in_arena([&](){
-        tbb::parallel_for<size_t>(0, data.size(), [&](size_t i) {
-            loopBody(i);
-        });
-    });
-#else
-    for (size_t i = 0; i < data.size(); ++i) {
-        loopBody(i);
-    }
-#endif
     presenter.drawGraphs(windowImage);
     drawStats();
 
     char str[256];
     snprintf(str, sizeof(str), "%5.2f fps", static_cast<double>(1000.0f/time));
     cv::putText(windowImage, str, cv::Point(800, 100), cv::HersheyFonts::FONT_HERSHEY_COMPLEX, 2.0,  cv::Scalar(0, 255, 0), 2);
-    cv::imshow(params.name, windowImage);
+    if (!FLAGS_no_show) {
+        cv::imshow(params.name, windowImage);
+    }
+    return windowImage;
 }
 
 }  // namespace
@@ -376,6 +406,21 @@ int main(int argc, char* argv[]) {
         if (!ParseAndCheckCommandLine(argc, argv)) {
             return 0;
         }
+        if (FLAGS_hugepages) {
+            // before the capture and the inference threads allocate their buffers
+            useHugePageArena();
+        }
+        // before the pools start, with -thread_shares the IE streams, OpenCV and the pipeline take their shares of
+        // the cores
+        std::size_t inferenceThreads = 0;  // the plugin default
+        if (!FLAGS_thread_shares.empty()) {
+            const ThreadPolicy threadPolicy(FLAGS_thread_shares);
+            threadPolicy.report();
+            threadPolicy.apply();
+            set_pipeline_threads(threadPolicy.pipeline());
+            inferenceThreads = threadPolicy.inference();
+        }
+        const bool exportMetrics = 0 != FLAGS_metrics_port || !FLAGS_metrics_push.empty();
 
         std::string modelPath = FLAGS_m;
         std::size_t found = modelPath.find_last_of(".");
@@ -391,23 +436,28 @@ int main(int argc, char* argv[]) {
         IEGraph::InitParams graphParams;
         graphParams.batchSize       = FLAGS_bs;
         graphParams.maxRequests     = FLAGS_nireq;
-        graphParams.collectStats    = FLAGS_show_stats;
+        graphParams.collectStats    = FLAGS_show_stats || exportMetrics;
         graphParams.reportPerf      = FLAGS_pc;
         graphParams.modelPath       = modelPath;
         graphParams.cpuExtPath      = FLAGS_l;
         graphParams.cldnnConfigPath = FLAGS_c;
+        graphParams.cacheDir        = FLAGS_cache_dir;
         graphParams.deviceName      = FLAGS_d;
+        graphParams.u8Input         = FLAGS_u8_input;
+        graphParams.zeroCopy        = FLAGS_zero_copy;
+        graphParams.batchTimeoutMSec = FLAGS_batch_timeout;
+        graphParams.postprocessThreads = FLAGS_postprocess_threads;
+        graphParams.autoThroughput  = FLAGS_auto_throughput;
+        graphParams.overflowPolicy  = parseOverflowPolicy(FLAGS_infer_overflow);
+        graphParams.remoteSurfaces  = FLAGS_remote_blobs;
+        graphParams.warmupRuns      = FLAGS_warmup_runs;
+        graphParams.arenaBlobs      = FLAGS_hugepages;
+        graphParams.cpuThreads      = inferenceThreads;
         graphParams.postLoadFunc    = [&yoloParams](const std::vector<std::string>& outputDataBlobNames,
                                                     InferenceEngine::CNNNetwork &network) {
                                                         yoloParams = GetYoloParams(outputDataBlobNames, network);
                                                     };
 
-        std::shared_ptr<IEGraph> network(new IEGraph(graphParams));
-        auto inputDims = network->getInputDims();
-        if (4 != inputDims.size()) {
-            throw std::runtime_error("Invalid network input dimensions");
-        }
-
         std::vector<std::string> files;
         parseInputFilesArguments(files);
 
@@ -429,10 +479,44 @@ int main(int argc, char* argv[]) {
             throw std::logic_error("Number of inputs exceed maximum value [25]");
         }
 
+        // threads created from now on inherit the placement of the main thread
+        ThreadPlacement placement(FLAGS_numa, numberOfInputs);
+        placement.report();
+        placement.pinMainThread();
+
+        graphParams.numChannels     = numberOfInputs;
+        std::shared_ptr<IEGraph> network(new IEGraph(graphParams));
+        auto inputDims = network->getInputDims();
+        if (4 != inputDims.size()) {
+            throw std::runtime_error("Invalid network input dimensions");
+        }
+
         VideoSources::InitParams vsParams;
         vsParams.queueSize            = FLAGS_n_iqs;
-        vsParams.collectStats         = FLAGS_show_stats;
+        vsParams.collectStats         = FLAGS_show_stats || exportMetrics;
         vsParams.realFps              = FLAGS_real_input_fps;
+        vsParams.readTimeoutMSec      = FLAGS_batch_timeout;
+        vsParams.overflowPolicy       = parseOverflowPolicy(FLAGS_input_overflow);
+        vsParams.hwSurfaces           = FLAGS_remote_blobs;
+        vsParams.downloadSurfaces     = !FLAGS_no_show || !FLAGS_out.empty() || !FLAGS_bus_publish.empty() ||
+                                        !FLAGS_record.empty();
+        vsParams.channelCpus          = placement.getChannelsCpus();
+        vsParams.channelRois          = parseChannelRois(FLAGS_roi);
+        vsParams.motionThreshold      = static_cast<float>(FLAGS_motion_threshold);
+        vsParams.publishBus           = FLAGS_bus_publish;
+        vsParams.busSubscribers       = FLAGS_bus_subscribers;
+        vsParams.busDepth             = FLAGS_bus_depth;
+        vsParams.cameraFormat         = FLAGS_cam_format;
+        vsParams.cameraIo             = FLAGS_cam_io;
+        vsParams.cameraWorkers        = FLAGS_cam_workers;
+        vsParams.captureThreads       = FLAGS_capture_threads;
+        vsParams.hwFileDecoding       = FLAGS_hw_file_decode;
+        vsParams.drain                = FLAGS_drain;
+        vsParams.reducedDecoding      = FLAGS_reduced_decode;
+        vsParams.decodingStripes      = FLAGS_decode_stripes;
+        vsParams.adaptiveDecoding     = FLAGS_adaptive_decode;
+        vsParams.recordDir            = FLAGS_record;
+        vsParams.replayFast           = FLAGS_replay_fast;
         vsParams.expectedHeight = static_cast<unsigned>(inputDims[2]);
         vsParams.expectedWidth  = static_cast<unsigned>(inputDims[3]);
 
@@ -459,50 +543,72 @@ int main(int argc, char* argv[]) {
                 }
             }
         }
+        // created before the sources start, so the trace begins with the first captured frame
+        LatencyTracer tracer(numberOfInputs, LatencyTracer::DefaultWindowSize, !FLAGS_trace_file.empty());
+        std::unique_ptr<SteadyStateBenchmark> benchmark;
+        if (FLAGS_bench > 0) {
+            benchmark.reset(new SteadyStateBenchmark(numberOfInputs, std::chrono::seconds(FLAGS_bench_warmup),
+                                                     std::chrono::seconds(FLAGS_bench)));
+        }
         sources.start();
 
-        size_t currentFrame = 0;
+        // in drain mode channels are read to their ends, the input is over once all of them are
+        ChannelScheduler channelScheduler(FLAGS_channel_weights, numberOfInputs);
 
         std::vector<cv::Scalar> colors;
         if (yoloParams.size() > 0)
             for (int i = 0; i < static_cast<int>(yoloParams.begin()->second.classes); ++i)
                 colors.push_back(cv::Scalar(rand() % 256, rand() % 256, rand() % 256));
+        // the object vectors of the frames the pipeline released are refilled
+        auto objectsPool = std::make_shared<DetectionsPool<std::vector<DetectionObject>>>();
 
         network->start([&](VideoFrame& img) {
-            img.sourceIdx = currentFrame;
-            auto camIdx = currentFrame / duplicateFactor;
-            currentFrame = (currentFrame + 1) % numberOfInputs;
-            return sources.getFrame(camIdx, img);
-        }, [&yoloParams](InferenceEngine::InferRequest::Ptr req,
+            return readScheduledFrame(channelScheduler, sources, duplicateFactor, FLAGS_drain, img);
+        }, [&yoloParams, objectsPool](InferenceEngine::InferRequest::Ptr req,
                 const std::vector<std::string>& outputDataBlobNames,
                 cv::Size frameSize
                 ) {
             unsigned long resized_im_h = 416;
             unsigned long resized_im_w = 416;
 
-            std::vector<DetectionObject> objects;
-            // Parsing outputs
-            for (auto &output_name :outputDataBlobNames) {
-                ParseYOLOV3Output(req, output_name, yoloParams[output_name], resized_im_h, resized_im_w, frameSize.height, frameSize.width, FLAGS_t, objects);
+            std::vector<InferenceEngine::Blob::Ptr> blobs;
+            for (auto &output_name : outputDataBlobNames) {
+                blobs.push_back(req->GetBlob(output_name));
             }
-            // Filtering overlapping boxes and lower confidence object
-            std::sort(objects.begin(), objects.end(), std::greater<DetectionObject>());
-            for (size_t i = 0; i < objects.size(); ++i) {
-                if (objects[i].confidence == 0)
-                    continue;
-                for (size_t j = i + 1; j < objects.size(); ++j)
-                    if (IntersectionOverUnion(objects[i], objects[j]) >= 0.4)
-                        objects[j].confidence = 0;
-            }
-
-            std::vector<Detections> detections(1);
-            detections[0].set(new std::vector<DetectionObject>);
+            const size_t batchSize = blobs.empty() ? 0 : blobs.front()->getTensorDesc().getDims()[0];
+
+            // Parsing outputs, every scale of every frame of the batch is a task of the shared pool
+            std::vector<std::vector<DetectionObject>> candidates(batchSize * blobs.size());
+            parallelFor(candidates.size(), [&](size_t task) {
+                const size_t output = task % blobs.size();
+                ParseYOLOV3Output(blobs[output], task / blobs.size(), yoloParams.at(outputDataBlobNames[output]),
+                                  resized_im_h, resized_im_w, frameSize.height, frameSize.width, FLAGS_t, candidates[task]);
+            });
+
+            // Merging the scales of a frame and filtering overlapping boxes of the same class
+            std::vector<Detections> detections(batchSize);
+            parallelFor(batchSize, [&](size_t frameIdx) {
+                std::vector<DetectionObject> objects;
+                for (size_t output = 0; output < blobs.size(); output++) {
+                    const std::vector<DetectionObject> &scaleObjects = candidates[frameIdx * blobs.size() + output];
+                    objects.insert(objects.end(), scaleObjects.begin(), scaleObjects.end());
+                }
+                NmsBoxes boxes;
+                boxes.reserve(objects.size());
+                for (const auto &object : objects) {
+                    boxes.push_back(static_cast<float>(object.xmin), static_cast<float>(object.ymin),
+                                    static_cast<float>(object.xmax), static_cast<float>(object.ymax),
+                                    object.confidence, object.class_id);
+                }
 
-            for (auto &object : objects) {
-                if (object.confidence < FLAGS_t)
-                    continue;
-                detections[0].get<std::vector<DetectionObject>>().push_back(object);
-            }
+                detections[frameIdx] = objectsPool->acquire();
+                auto &frameDetections = detections[frameIdx].get<std::vector<DetectionObject>>();
+                for (int idx : nms(boxes, 0.4f)) {
+                    if (objects[idx].confidence < FLAGS_t)
+                        continue;
+                    frameDetections.push_back(objects[idx]);
+                }
+            });
 
             return detections;
         });
@@ -524,16 +630,52 @@ int main(int argc, char* argv[]) {
 
         cv::Size graphSize{static_cast<int>(params.windowSize.width / 4), 60};
         Presenter presenter(FLAGS_u, params.windowSize.height - graphSize.height - 10, graphSize);
+        GridCompositor compositor(params.windowSize, params.frameSize,
+                                  std::vector<cv::Point>(params.points, params.points + params.count), FLAGS_ocl_render);
+
+        // the encoders take the frames from the output thread and don't wait for the display
+        const size_t encoderQueueSize = 4;
+        std::vector<std::unique_ptr<StreamWriter>> writers;
+        if (!FLAGS_out.empty()) {
+            if (channelTarget(FLAGS_out, 0).empty()) {
+                writers.emplace_back(new StreamWriter(FLAGS_out, params.windowSize, FLAGS_out_fps,
+                                                      encoderQueueSize, FLAGS_out_hw));
+            } else {
+                for (size_t i = 0; i < numberOfInputs; i++) {
+                    writers.emplace_back(new StreamWriter(channelTarget(FLAGS_out, i), params.frameSize,
+                                                          FLAGS_out_fps, encoderQueueSize, FLAGS_out_hw));
+                }
+            }
+        }
+        const bool render = !FLAGS_no_show || !writers.empty();
 
         const size_t outputQueueSize = 1;
-        AsyncOutput output(FLAGS_show_stats, outputQueueSize,
+        AsyncOutput output(FLAGS_show_stats || exportMetrics, outputQueueSize,
+                           parseOverflowPolicy(FLAGS_output_overflow), numberOfInputs,
         [&](const std::vector<std::shared_ptr<VideoFrame>>& result) {
             std::string str;
             if (FLAGS_show_stats) {
                 std::unique_lock<std::mutex> lock(statMutex);
                 str = statStream.str();
             }
-            displayNSources(result, averageFps, str, params, colors, presenter);
+            displayNSources(result, averageFps, str, params, colors, presenter, compositor);
+            for (const auto& frame : result) {
+                frame->trace.stamp(FrameTrace::Render);
+                tracer.add(*frame);
+                if (benchmark) {
+                    benchmark->add(*frame);
+                }
+            }
+            if (writers.size() == 1 && channelTarget(FLAGS_out, 0).empty()) {
+                writers.front()->write(windowImage);
+            } else {
+                for (size_t i = 0; i < writers.size(); i++) {
+                    writers[i]->write(windowImage(cv::Rect(params.points[i], params.frameSize)));
+                }
+            }
+            if (FLAGS_no_show) {
+                return true;
+            }
             int key = cv::waitKey(1);
             presenter.handleKey(key);
 
@@ -542,6 +684,11 @@ int main(int argc, char* argv[]) {
 
         output.start();
 
+        std::unique_ptr<PipelineMetrics> metrics;
+        if (exportMetrics) {
+            metrics.reset(new PipelineMetrics(FLAGS_metrics_port, FLAGS_metrics_push));
+        }
+
         using timer = std::chrono::high_resolution_clock;
         using duration = std::chrono::duration<float, std::milli>;
         timer::time_point lastTime = timer::now();
@@ -559,10 +706,17 @@ int main(int argc, char* argv[]) {
                     break;
                 }
                 for (size_t i = 0; i < br.size(); i++) {
+                    mapToFrame(*br[i], params.frameSize);
+                    if (!render) {
+                        tracer.add(*br[i]);  // nothing is rendered, so postprocessing ends the trace
+                        if (benchmark) {
+                            benchmark->add(*br[i]);
+                        }
+                    }
                     auto val = static_cast<unsigned int>(br[i]->sourceIdx);
                     auto it = find_if(batchRes.begin(), batchRes.end(), [val] (const std::shared_ptr<VideoFrame>& vf) { return vf->sourceIdx == val; } );
                     if (it != batchRes.end()) {
-                        if (!FLAGS_no_show) {
+                        if (render) {
                             output.push(std::move(batchRes));
                         }
                         batchRes.clear();
@@ -573,7 +727,7 @@ int main(int argc, char* argv[]) {
             }
             ++fpsCounter;
 
-            if (!output.isAlive()) {
+            if (!output.isAlive() || (benchmark && benchmark->finished())) {
                 break;
             }
 
@@ -586,13 +740,17 @@ int main(int argc, char* argv[]) {
                 fpsCounter = 0;
                 lastTime = currTime;
 
+                averageFps = frameTime;  // also drawn into the encoded streams
                 if (FLAGS_no_show) {
                     slog::info << "Average Throughput : " << 1000.f/frameTime << " fps" << slog::endl;
-                    if (++perfItersCounter >= FLAGS_n_sp) {
+                    if (!FLAGS_drain && !benchmark && ++perfItersCounter >= FLAGS_n_sp) {
                         break;
                     }
-                } else {
-                    averageFps = frameTime;
+                }
+
+                if (metrics) {
+                    metrics->publish(1000.f / frameTime, sources.getStats(), network->getStats(),
+                                     output.getStats(), tracer.getStats());
                 }
 
                 if (FLAGS_show_stats) {
@@ -611,18 +769,103 @@ int main(int argc, char* argv[]) {
                         statStream << inputStat.readTimes[i] << "ms ";
                     }
                     statStream << std::endl;
+                    if (std::any_of(inputStat.captureLatencies.begin(), inputStat.captureLatencies.end(),
+                                    [](float latency) { return latency > 0.0f; })) {
+                        statStream << "Camera dequeue latency: ";
+                        for (size_t i = 0; i < inputStat.captureLatencies.size(); ++i) {
+                            if (0 == (i % 4)) {
+                                statStream << std::endl;
+                            }
+                            statStream << inputStat.captureLatencies[i] << "ms ";
+                        }
+                        statStream << std::endl;
+                    }
                     statStream << "HW decoding latency: "
-                               << inputStat.decodingLatency << "ms";
+                               << inputStat.decodingLatency << "ms (batch "
+                               << inputStat.decodingBatchSize << ")";
                     statStream << std::endl;
+                    if (!inputStat.decodingModes.empty()) {
+                        statStream << "Decoding routes: HW " << inputStat.hwDecodingLatency << "ms, SW "
+                                   << inputStat.swDecodingLatency << "ms, " << inputStat.decodingReroutes
+                                   << " reroutes";
+                        for (size_t i = 0; i < inputStat.decodingModes.size(); ++i) {
+                            if (0 == (i % 8)) {
+                                statStream << std::endl;
+                            }
+                            statStream << (Decoder::Mode::Hw == inputStat.decodingModes[i] ? "HW " : "SW ");
+                        }
+                        statStream << std::endl;
+                    }
                     statStream << "Preprocess time: "
                                << inferStat.preprocessTime << "ms";
                     statStream << std::endl;
                     statStream << "Plugin latency: "
-                               << inferStat.inferTime << "ms";
+                               << inferStat.inferTime << "ms (p95/p99/max: "
+                               << inferStat.inferTimeStats.p95 << "/" << inferStat.inferTimeStats.p99 << "/"
+                               << inferStat.inferTimeStats.max << "ms)";
                     statStream << std::endl;
+                    statStream << "Input copies per frame: "
+                               << inferStat.copiesPerFrame;
+                    statStream << std::endl;
+                    statStream << "Batch fill ratio: "
+                               << inferStat.batchFillRatio;
+                    statStream << std::endl;
+                    if (inferStat.devices.size() > 1) {
+                        for (const auto& device : inferStat.devices) {
+                            statStream << device.name << ": " << device.inferTime << "ms "
+                                       << 100.0f * device.batchesShare << "%" << std::endl;
+                        }
+                    }
 
                     statStream << "Render time: " << outputStat.renderTime
-                               << "ms" << std::endl;
+                               << "ms (p95/p99/max: " << outputStat.renderTimeStats.p95 << "/"
+                               << outputStat.renderTimeStats.p99 << "/" << outputStat.renderTimeStats.max
+                               << "ms)" << std::endl;
+
+                    auto latencyStat = tracer.getStats();
+                    statStream << "End-to-end latency p50/p95/p99:";
+                    for (size_t i = 0; i < latencyStat.size(); ++i) {
+                        if (0 == (i % 4)) {
+                            statStream << std::endl;
+                        }
+                        const auto& endToEnd = latencyStat[i].intervals[LatencyTracer::EndToEnd];
+                        statStream << endToEnd.p50 << "/" << endToEnd.p95 << "/" << endToEnd.p99 << "ms ";
+                    }
+                    statStream << std::endl;
+                    auto sum = [](const std::vector<size_t>& counters) {
+                        return std::accumulate(counters.begin(), counters.end(), size_t(0));
+                    };
+                    statStream << "Dropped frames (input/infer/render): " << sum(inputStat.droppedFrames) << "/"
+                               << sum(inferStat.droppedFrames) << "/" << sum(outputStat.droppedFrames);
+                    for (size_t i = 0; i < inferStat.droppedFrames.size() && i < outputStat.droppedFrames.size(); ++i) {
+                        if (0 == (i % 4)) {
+                            statStream << std::endl;
+                        }
+                        statStream << inferStat.droppedFrames[i] + outputStat.droppedFrames[i] << " ";
+                    }
+                    statStream << std::endl;
+                    statStream << "Channel FPS: ";
+                    for (size_t i = 0; i < inferStat.channelFps.size(); ++i) {
+                        if (0 == (i % 4)) {
+                            statStream << std::endl;
+                        }
+                        statStream << inferStat.channelFps[i] << " ";
+                    }
+                    statStream << std::endl;
+                    if (!inputStat.unchangedShares.empty()) {
+                        statStream << "Skipped unchanged frames: " << inferStat.skippedFrames;
+                        for (size_t i = 0; i < inputStat.unchangedShares.size(); ++i) {
+                            if (0 == (i % 4)) {
+                                statStream << std::endl;
+                            }
+                            statStream << 100.0f * inputStat.unchangedShares[i] << "% ";
+                        }
+                        statStream << std::endl;
+                    }
+                    for (const auto& writer : writers) {
+                        statStream << "Encoder dropped frames of " << writer->getTarget() << ": "
+                                   << writer->getDroppedFrames() << std::endl;
+                    }
 
                     if (FLAGS_no_show) {
                         slog::info << statStream.str() << slog::endl;
@@ -631,8 +874,27 @@ int main(int argc, char* argv[]) {
             }
         }
 
+        if (FLAGS_drain) {
+            printDrainSummary(network->getStats());
+        }
+
         network.reset();
 
+        if (FLAGS_show_stats) {
+            tracer.printStats(std::cout);
+        }
+        if (benchmark) {
+            benchmark->writeJson(FLAGS_bench_json, {
+                {"demo", argv[0]}, {"model", FLAGS_m}, {"device", FLAGS_d}, {"tag", FLAGS_bench_tag},
+                {"channels", std::to_string(numberOfInputs)}, {"batch_size", std::to_string(FLAGS_bs)},
+                {"infer_requests", std::to_string(FLAGS_nireq)}, {"u8_input", FLAGS_u8_input ? "true" : "false"}});
+            slog::info << "Benchmark report is written to " << FLAGS_bench_json << slog::endl;
+        }
+        if (!FLAGS_trace_file.empty()) {
+            tracer.dumpTrace(FLAGS_trace_file);
+            slog::info << "Frame trace is written to " << FLAGS_trace_file << slog::endl;
+        }
+
         std::cout << presenter.reportMeans() << '\n';
     }
     catch (const std::exception& error) {
@@ -0,0 +1,290 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+/**
+* \brief The entry point for the Inference Engine multi_channel_pipeline_host application
+* \file multi_channel/pipeline_host/main.cpp
+* \example multi_channel/pipeline_host/main.cpp
+*/
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include <samples/common.hpp>
+#include <samples/detection_output.hpp>
+#include <samples/instrumentation.hpp>
+#include <samples/slog.hpp>
+
+#include "graph.hpp"
+#include "input.hpp"
+#include "multichannel_pipeline_host_params.hpp"
+#include "shared_inference.hpp"
+
+namespace {
+
+/**
+* \brief This function show a help message
+*/
+void showUsage() {
+    std::cout << std::endl;
+    std::cout << "multi_channel_pipeline_host [OPTION]" << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << std::endl;
+    std::cout << "    -h                           " << help_message << std::endl;
+    std::cout << "    -pipelines \"<path>\"          " << pipelines_message << std::endl;
+    std::cout << "      -l \"<absolute_path>\"       " << custom_cpu_library_message << std::endl;
+    std::cout << "          Or" << std::endl;
+    std::cout << "      -c \"<absolute_path>\"       " << custom_cldnn_message << std::endl;
+    std::cout << "    -bs                          " << batch_size << std::endl;
+    std::cout << "    -n_iqs                       " << input_queue_size << std::endl;
+    std::cout << "    -t                           " << thresh_output_message << std::endl;
+    std::cout << "    -loop_video                  " << loop_video_output_message << std::endl;
+    std::cout << "    -cache_dir \"<path>\"          " << cache_dir_message << std::endl;
+    std::cout << "    -cpu_cores                   " << cpu_cores_message << std::endl;
+    std::cout << "    -time                        " << time_message << std::endl;
+}
+
+bool ParseAndCheckCommandLine(int argc, char *argv[]) {
+    // ---------------------------Parsing and validation of input args--------------------------------------
+    gflags::ParseCommandLineNonHelpFlags(&argc, &argv, true);
+    if (FLAGS_h) {
+        showUsage();
+        showAvailableDevices();
+        return false;
+    }
+    slog::info << "Parsing input parameters" << slog::endl;
+
+    if (FLAGS_pipelines.empty()) {
+        throw std::logic_error("Parameter -pipelines is not set");
+    }
+    if (0 == FLAGS_bs) {
+        throw std::logic_error("Parameter -bs must be positive");
+    }
+    return true;
+}
+
+struct PipelineDesc {
+    std::string name;
+    std::string modelPath;
+    std::string deviceName;
+    std::vector<std::string> inputs;
+};
+
+std::vector<PipelineDesc> readPipelines(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot open " + path);
+    }
+    std::vector<PipelineDesc> pipelines;
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream fields(line);
+        PipelineDesc desc;
+        std::string inputs;
+        if (!(fields >> desc.name) || '#' == desc.name[0]) {
+            continue;
+        }
+        if (!(fields >> desc.modelPath >> desc.deviceName >> inputs)) {
+            throw std::logic_error("The pipeline " + desc.name + " needs a model, a device and inputs");
+        }
+        std::istringstream inputsStream(inputs);
+        std::string input;
+        while (std::getline(inputsStream, input, ',')) {
+            if (!input.empty()) {
+                desc.inputs.push_back(input);
+            }
+        }
+        pipelines.push_back(std::move(desc));
+    }
+    if (pipelines.empty()) {
+        throw std::logic_error("No pipelines in " + path);
+    }
+    return pipelines;
+}
+
+// returns the detections of the DetectionOutput rows of the batch, relative to the frames
+std::vector<Detections> parseDetections(InferenceEngine::InferRequest::Ptr req,
+                                        const std::vector<std::string>& outputDataBlobNames) {
+    auto output = req->GetBlob(outputDataBlobNames[0]);
+    std::vector<Detections> detections(FLAGS_bs);
+    std::vector<std::vector<cv::Rect2f>*> rects(detections.size());
+    for (size_t i = 0; i < detections.size(); i++) {
+        rects[i] = new std::vector<cv::Rect2f>;
+        detections[i].set(rects[i]);
+    }
+    detection_output::parse(output->buffer().as<float*>(), output->size() / 7, static_cast<float>(FLAGS_t),
+                            rects.size(), [&](size_t idxInBatch, const detection_output::Row& row) {
+        const float x0 = detection_output::clamp(row.xmin);
+        const float y0 = detection_output::clamp(row.ymin);
+        rects[idxInBatch]->emplace_back(x0, y0, detection_output::clamp(row.xmax) - x0,
+                                        detection_output::clamp(row.ymax) - y0);
+    });
+    return detections;
+}
+
+/**
+* \brief The video sources, the network and the consumer of a pipeline of the host. The networks of all the
+* pipelines are loaded on the Core of the process, see SharedInference
+*/
+class Pipeline {
+public:
+    explicit Pipeline(const PipelineDesc& desc): name(desc.name) {
+        slog::info << "Loading the pipeline " << name << ": " << desc.modelPath << " on " << desc.deviceName
+                   << slog::endl;
+        IEGraph::InitParams graphParams;
+        graphParams.batchSize       = FLAGS_bs;
+        graphParams.modelPath       = desc.modelPath;
+        graphParams.cpuExtPath      = FLAGS_l;
+        graphParams.cldnnConfigPath = FLAGS_c;
+        graphParams.cacheDir        = FLAGS_cache_dir;
+        graphParams.deviceName      = desc.deviceName;
+        // the streams and the requests of every network are sized by its share of the cores
+        graphParams.autoThroughput  = true;
+        graphParams.numChannels     = desc.inputs.size();
+        network.reset(new IEGraph(graphParams));
+        auto inputDims = network->getInputDims();
+        if (4 != inputDims.size()) {
+            throw std::runtime_error("Invalid network input dimensions of the pipeline " + name);
+        }
+
+        VideoSources::InitParams vsParams;
+        vsParams.queueSize      = FLAGS_n_iqs;
+        vsParams.expectedHeight = static_cast<unsigned>(inputDims[2]);
+        vsParams.expectedWidth  = static_cast<unsigned>(inputDims[3]);
+        sources.reset(new VideoSources(vsParams));
+        for (const auto& input : desc.inputs) {
+            const bool camera = std::all_of(input.begin(), input.end(), ::isdigit);
+            sources->openVideo(input, camera, FLAGS_loop_video && !camera);
+        }
+        channelsNum = desc.inputs.size();
+    }
+
+    ~Pipeline() {
+        stop();
+    }
+
+    void start() {
+        sources->start();
+        network->start([this](VideoFrame& img) {
+            // the channels of the pipeline take turns
+            img.sourceIdx = nextChannel++ % channelsNum;
+            return sources->getFrame(img.sourceIdx, img);
+        }, [](InferenceEngine::InferRequest::Ptr req, const std::vector<std::string>& outputDataBlobNames, cv::Size) {
+            return parseDetections(req, outputDataBlobNames);
+        });
+        network->setDetectionConfidence(static_cast<float>(FLAGS_t));
+        startTime = std::chrono::steady_clock::now();
+        consumer = std::thread([this] {
+            instrumentation::registerCurrentThread(name + " consumer");
+            while (!terminate && (sources->isRunning() || network->isRunning())) {
+                for (const auto& vframe : network->getBatchData(cv::Size())) {
+                    frames++;
+                    if (!vframe->detections.empty()) {
+                        detections += vframe->detections.get<std::vector<cv::Rect2f>>().size();
+                    }
+                }
+            }
+            running = false;
+        });
+    }
+
+    void stop() {
+        terminate = true;
+        if (consumer.joinable()) {
+            consumer.join();
+        }
+    }
+
+    bool isRunning() const {
+        return running;
+    }
+
+    void report() const {
+        const float elapsed = std::chrono::duration<float>(std::chrono::steady_clock::now() - startTime).count();
+        slog::info << name << ": " << frames << " frames of " << channelsNum << " channels, "
+                   << (elapsed > 0.0f ? frames / elapsed : 0.0f) << " FPS, " << detections << " detections"
+                   << slog::endl;
+    }
+
+private:
+    const std::string name;
+    std::unique_ptr<VideoSources> sources;
+    std::unique_ptr<IEGraph> network;
+    std::size_t channelsNum = 0;
+    std::size_t nextChannel = 0;  // of the getter thread of the network
+    std::chrono::steady_clock::time_point startTime;
+    std::atomic<std::size_t> frames = {0};
+    std::atomic<std::size_t> detections = {0};
+    std::atomic<bool> terminate = {false};
+    std::atomic<bool> running = {true};
+    std::thread consumer;
+};
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    try {
+        slog::info << "InferenceEngine: " << InferenceEngine::GetInferenceEngineVersion() << slog::endl;
+
+        if (!ParseAndCheckCommandLine(argc, argv)) {
+            return 0;
+        }
+
+        const auto pipelineDescs = readPipelines(FLAGS_pipelines);
+        // leave half of the logical cores to decoding and postprocessing by default
+        SharedInference::instance().setCpuBudget(FLAGS_cpu_cores > 0 ? FLAGS_cpu_cores :
+            std::max<std::size_t>(std::thread::hardware_concurrency() / 2, 1));
+
+        // the graphs are created on this thread one by one, see SharedInference
+        std::vector<std::unique_ptr<Pipeline>> pipelines;
+        for (const auto& desc : pipelineDescs) {
+            if (desc.inputs.empty()) {
+                throw std::logic_error("The pipeline " + desc.name + " has no inputs");
+            }
+            pipelines.emplace_back(new Pipeline(desc));
+        }
+        const SharedInference::Stats loadStats = SharedInference::instance().getStats();
+        slog::info << "Loaded " << loadStats.loadedNetworks << " networks for " << pipelines.size()
+                   << " pipelines, " << loadStats.reusedNetworks << " loads reused a network, the CPU networks took "
+                   << loadStats.takenCpuCores << " of " << loadStats.cpuBudget << " cores" << slog::endl;
+
+        for (auto& pipeline : pipelines) {
+            pipeline->start();
+        }
+        const auto startTime = std::chrono::steady_clock::now();
+        while (std::any_of(pipelines.begin(), pipelines.end(), [](const std::unique_ptr<Pipeline>& pipeline) {
+                   return pipeline->isRunning();
+               })) {
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+            if (FLAGS_time > 0 && std::chrono::steady_clock::now() - startTime >= std::chrono::seconds(FLAGS_time)) {
+                break;
+            }
+        }
+        for (auto& pipeline : pipelines) {
+            pipeline->stop();
+            pipeline->report();
+        }
+    }
+    catch (const std::exception& error) {
+        slog::err << error.what() << slog::endl;
+        return 1;
+    }
+    catch (...) {
+        slog::err << "Unknown/internal exception happened." << slog::endl;
+        return 1;
+    }
+
+    slog::info << "Execution successful" << slog::endl;
+    return 0;
+}
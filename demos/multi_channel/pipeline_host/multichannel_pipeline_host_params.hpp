@@ -0,0 +1,43 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <gflags/gflags.h>
+
+static const char help_message[] = "Print a usage message";
+static const char pipelines_message[] = "Required. Path to a file of the pipelines to run, a pipeline per line: "
+                                        "<name> <path to an .xml file of an SSD model> <device> "
+                                        "<comma-separated video files or camera indexes>. "
+                                        "The lines starting with # are skipped";
+static const char custom_cldnn_message[] = "Required for GPU custom kernels. "
+                                           "Absolute path to an .xml file with the kernels descriptions";
+static const char custom_cpu_library_message[] = "Required for CPU custom layers. "
+                                                 "Absolute path to a shared library with the kernels implementations";
+static const char batch_size[] = "Optional. Batch size for processing (the number of frames processed per infer request)";
+static const char input_queue_size[] = "Optional. Frame queue size for input channels";
+static const char thresh_output_message[] = "Optional. Probability threshold for detections";
+static const char loop_video_output_message[] = "Optional. Enable playing video on a loop.";
+static const char cache_dir_message[] = "Optional. Directory to cache compiled networks in. Later runs import the cached networks "
+                                        "instead of compiling them if the model, device and config didn't change. "
+                                        "Devices without network export support compile on each run";
+static const char cpu_cores_message[] = "Optional. Cores the CPU streams of all the pipelines take, every CPU network "
+                                        "takes up to a core per batch in flight of what the pipelines loaded "
+                                        "before it left. 0 - half of the logical cores. Default value is 0";
+static const char time_message[] = "Optional. Seconds to run the pipelines for, 0 - until their inputs end. "
+                                   "Default value is 0";
+
+DEFINE_bool(h, false, help_message);
+DEFINE_string(pipelines, "", pipelines_message);
+DEFINE_string(c, "", custom_cldnn_message);
+DEFINE_string(l, "", custom_cpu_library_message);
+DEFINE_uint32(bs, 1, batch_size);
+DEFINE_uint32(n_iqs, 5, input_queue_size);
+DEFINE_double(t, 0.5, thresh_output_message);
+DEFINE_bool(loop_video, false, loop_video_output_message);
+DEFINE_string(cache_dir, "", cache_dir_message);
+DEFINE_uint32(cpu_cores, 0, cpu_cores_message);
+DEFINE_uint32(time, 0, time_message);
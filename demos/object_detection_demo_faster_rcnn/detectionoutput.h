@@ -10,6 +10,7 @@
 #include <algorithm>
 
 #include <inference_engine.hpp>
+#include <opencv2/core/core.hpp>
 
 using namespace InferenceEngine;
 using InferenceEngine::details::InferenceEngineException;
@@ -100,6 +101,8 @@ public:
             SizeVector num_priors_actual_size{conf_size};
             _num_priors_actual = make_shared_blob<int>({Precision::I32, num_priors_actual_size, C});
             _num_priors_actual->allocate();
+
+            _prior_boxes.resize(4 * static_cast<size_t>(_num_priors));
         } catch (const InferenceEngineException& ex) {
             throw std::logic_error(std::string("Can't create detection output: ") + ex.what());
         }
@@ -123,20 +126,23 @@ public:
         int *indices_data          = _indices->buffer();
         int *num_priors_actual     = _num_priors_actual->buffer();
 
-        const float *prior_variances = prior_data + _num_priors*_prior_size;
         const float *ppriors = prior_data;
 
+        // the priors are decoded once for all the classes, the classes are independent and run in parallel
         for (int n = 0; n < N; ++n) {
-            for (int c = 0; c < _num_loc_classes; ++c) {
-                if (c == _background_label_id) {
-                    continue;
-                }
+            decodePriors(ppriors, num_priors_actual, n);
+            cv::parallel_for_(cv::Range(0, _num_loc_classes), [&](const cv::Range& range) {
+                for (int c = range.start; c < range.end; ++c) {
+                    if (c == _background_label_id) {
+                        continue;
+                    }
 
-                const float *ploc = loc_data + n*4*_num_loc_classes*_num_priors + c*4;
-                float *pboxes = decoded_bboxes_data + n*4*_num_loc_classes*_num_priors + c*4*_num_priors;
-                float *psizes = bbox_sizes_data + n*_num_loc_classes*_num_priors + c*_num_priors;
-                decodeBBoxes(ppriors, ploc, prior_variances, pboxes, psizes, num_priors_actual, n);
-            }
+                    const float *ploc = loc_data + n*4*_num_loc_classes*_num_priors + c*4;
+                    float *pboxes = decoded_bboxes_data + n*4*_num_loc_classes*_num_priors + c*4*_num_priors;
+                    float *psizes = bbox_sizes_data + n*_num_loc_classes*_num_priors + c*_num_priors;
+                    decodeBBoxes(ploc, pboxes, psizes, num_priors_actual[n]);
+                }
+            });
         }
 
         for (int n = 0; n < N; ++n) {
@@ -152,29 +158,32 @@ public:
         for (int n = 0; n < N; ++n) {
             int detections_total = 0;
 
-            for (int c = 0; c < _num_classes; ++c) {
-                if (c == _background_label_id) {
-                    // Ignore background class.
-                    continue;
-                }
+            cv::parallel_for_(cv::Range(0, _num_classes), [&](const cv::Range& range) {
+                for (int c = range.start; c < range.end; ++c) {
+                    if (c == _background_label_id) {
+                        // Ignore background class.
+                        continue;
+                    }
 
-                int *pindices    = indices_data + n*_num_classes*_num_priors + c*_num_priors;
-                int *pbuffer     = buffer_data + c*_num_priors;
-                int *pdetections = detections_data + n*_num_classes + c;
+                    int *pindices    = indices_data + n*_num_classes*_num_priors + c*_num_priors;
+                    int *pbuffer     = buffer_data + c*_num_priors;
+                    int *pdetections = detections_data + n*_num_classes + c;
 
-                const float *pconf = reordered_conf_data + n*_num_classes*_num_priors + c*_num_priors;
-                const float *pboxes = decoded_bboxes_data + n*4*_num_classes*_num_priors + c*4*_num_priors;
-                const float *psizes = bbox_sizes_data + n*_num_classes*_num_priors + c*_num_priors;
+                    const float *pconf = reordered_conf_data + n*_num_classes*_num_priors + c*_num_priors;
+                    const float *pboxes = decoded_bboxes_data + n*4*_num_classes*_num_priors + c*4*_num_priors;
+                    const float *psizes = bbox_sizes_data + n*_num_classes*_num_priors + c*_num_priors;
 
-                nms(pconf, pboxes, psizes, pbuffer, pindices, *pdetections, num_priors_actual[n]);
-            }
+                    nms(pconf, pboxes, psizes, pbuffer, pindices, *pdetections, num_priors_actual[n]);
+                }
+            });
 
             for (int c = 0; c < _num_classes; ++c) {
                 detections_total += detections_data[n*_num_classes + c];
             }
 
             if (_keep_top_k > -1 && detections_total > _keep_top_k) {
-                std::vector<std::pair<float, std::pair<int, int>>> conf_index_class_map;
+                std::vector<std::pair<float, std::pair<int, int>>>& conf_index_class_map = _conf_index_class_map;
+                conf_index_class_map.clear();
 
                 for (int c = 0; c < _num_classes; ++c) {
                     int detections = detections_data[n*_num_classes + c];
@@ -187,8 +196,9 @@ public:
                     }
                 }
 
-                std::sort(conf_index_class_map.begin(), conf_index_class_map.end(),
-                          SortScorePairDescend<std::pair<int, int>>);
+                // only the kept detections are ordered
+                std::partial_sort(conf_index_class_map.begin(), conf_index_class_map.begin() + _keep_top_k,
+                                  conf_index_class_map.end(), SortScorePairDescend<std::pair<int, int>>);
                 conf_index_class_map.resize(_keep_top_k);
 
                 // Store the new indices.
@@ -276,8 +286,9 @@ private:
     int _num_loc_classes = 0;
     int _num_priors = 0;
 
-    void decodeBBoxes(const float *prior_data, const float *loc_data, const float *variance_data,
-                      float *decoded_bboxes, float *decoded_bbox_sizes, int* num_priors_actual, int n);
+    void decodePriors(const float *prior_data, int* num_priors_actual, int n);
+
+    void decodeBBoxes(const float *loc_data, float *decoded_bboxes, float *decoded_bbox_sizes, int num_priors_actual);
 
     void nms(const float *conf_data, const float *bboxes, const float *sizes,
              int *buffer, int *indices, int &detections, int num_priors_actual);
@@ -289,6 +300,9 @@ private:
     Blob::Ptr _reordered_conf;
     Blob::Ptr _bbox_sizes;
     Blob::Ptr _num_priors_actual;
+
+    std::vector<float> _prior_boxes;  // center x, center y, width and height of every prior in the image fractions
+    std::vector<std::pair<float, std::pair<int, int>>> _conf_index_class_map;
 };
 
 struct ConfidenceComparator {
@@ -340,11 +354,7 @@ static inline float JaccardOverlap(const float *decoded_bbox,
     return intersect_size / (bbox1_size + bbox2_size - intersect_size);
 }
 
-void DetectionOutputPostProcessor::decodeBBoxes(const float *prior_data,
-                                   const float *loc_data,
-                                   const float *variance_data,
-                                   float *decoded_bboxes,
-                                   float *decoded_bbox_sizes,
+void DetectionOutputPostProcessor::decodePriors(const float *prior_data,
                                    int* num_priors_actual,
                                    int n) {
     num_priors_actual[n] = _num_priors;
@@ -357,35 +367,39 @@ void DetectionOutputPostProcessor::decodeBBoxes(const float *prior_data,
         }
     }
 
+    float *prior_boxes = _prior_boxes.data();
     for (int p = 0; p < num_priors_actual[n]; ++p) {
-        float prior_xmin = prior_data[p*_prior_size + 0 + _offset];
-        float prior_ymin = prior_data[p*_prior_size + 1 + _offset];
-        float prior_xmax = prior_data[p*_prior_size + 2 + _offset];
-        float prior_ymax = prior_data[p*_prior_size + 3 + _offset];
-
-        float loc_xmin = loc_data[4*p*_num_loc_classes + 0];
-        float loc_ymin = loc_data[4*p*_num_loc_classes + 1];
-        float loc_xmax = loc_data[4*p*_num_loc_classes + 2];
-        float loc_ymax = loc_data[4*p*_num_loc_classes + 3];
-
-        prior_xmin /= _image_width;
-        prior_ymin /= _image_height;
-        prior_xmax /= _image_width;
-        prior_ymax /= _image_height;
+        float prior_xmin = prior_data[p*_prior_size + 0 + _offset] / _image_width;
+        float prior_ymin = prior_data[p*_prior_size + 1 + _offset] / _image_height;
+        float prior_xmax = prior_data[p*_prior_size + 2 + _offset] / _image_width;
+        float prior_ymax = prior_data[p*_prior_size + 3 + _offset] / _image_height;
+
+        prior_boxes[p*4 + 0] = (prior_xmin + prior_xmax) / 2.0f;
+        prior_boxes[p*4 + 1] = (prior_ymin + prior_ymax) / 2.0f;
+        prior_boxes[p*4 + 2] = prior_xmax - prior_xmin;
+        prior_boxes[p*4 + 3] = prior_ymax - prior_ymin;
+    }
+}
 
-        float prior_width    =  prior_xmax - prior_xmin;
-        float prior_height   =  prior_ymax - prior_ymin;
-        float prior_center_x = (prior_xmin + prior_xmax) / 2.0f;
-        float prior_center_y = (prior_ymin + prior_ymax) / 2.0f;
+void DetectionOutputPostProcessor::decodeBBoxes(const float *loc_data,
+                                   float *decoded_bboxes,
+                                   float *decoded_bbox_sizes,
+                                   int num_priors_actual) {
+    const float *prior_boxes = _prior_boxes.data();
+    // a straight loop without branches over the priors, so the compiler vectorizes it
+    for (int p = 0; p < num_priors_actual; ++p) {
+        const float prior_center_x = prior_boxes[p*4 + 0];
+        const float prior_center_y = prior_boxes[p*4 + 1];
+        const float prior_width    = prior_boxes[p*4 + 2];
+        const float prior_height   = prior_boxes[p*4 + 3];
 
-        float decode_bbox_center_x, decode_bbox_center_y;
-        float decode_bbox_width, decode_bbox_height;
+        const float *loc = loc_data + 4*p*_num_loc_classes;
 
         // variance is encoded in target, we simply need to restore the offset predictions.
-        decode_bbox_center_x = loc_xmin * prior_width  + prior_center_x;
-        decode_bbox_center_y = loc_ymin * prior_height + prior_center_y;
-        decode_bbox_width  = std::exp(loc_xmax) * prior_width;
-        decode_bbox_height = std::exp(loc_ymax) * prior_height;
+        float decode_bbox_center_x = loc[0] * prior_width  + prior_center_x;
+        float decode_bbox_center_y = loc[1] * prior_height + prior_center_y;
+        float decode_bbox_width  = std::exp(loc[2]) * prior_width;
+        float decode_bbox_height = std::exp(loc[3]) * prior_height;
 
         float new_xmin = decode_bbox_center_x - decode_bbox_width  / 2.0f;
         float new_ymin = decode_bbox_center_y - decode_bbox_height / 2.0f;
@@ -4,9 +4,19 @@
 
 #include <gflags/gflags.h>
 #include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <functional>
 #include <iostream>
+#include <mutex>
+#include <sstream>
 #include <string>
 #include <memory>
+#include <thread>
+#include <utility>
 #include <vector>
 #include <limits>
 
@@ -19,6 +29,10 @@
 #include <samples/ocv_common.hpp>
 #include <samples/slog.hpp>
 #include <samples/args_helper.hpp>
+#include <samples/mapped_weights.hpp>
+#include <samples/network_cache.hpp>
+#include <samples/infer_request_pool.hpp>
+#include <samples/image_set_loader.hpp>
 #include "object_detection_demo_faster_rcnn.h"
 #include "detectionoutput.h"
 
@@ -47,6 +61,216 @@ bool ParseAndCheckCommandLine(int argc, char *argv[]) {
     return true;
 }
 
+/**
+* \brief Outputs of an inferred image copied from its request, so the request infers the next image while
+* they are postprocessed
+*/
+struct DetectionJob {
+    size_t imageId;
+    cv::Size imageSize;
+    std::vector<Blob::Ptr> outputs;  // the boxes, the probabilities and the proposals
+};
+
+Blob::Ptr copyBlob(const Blob::Ptr &blob) {
+    TBlob<float>::Ptr copy = make_shared_blob<float>(blob->getTensorDesc());
+    copy->allocate();
+    std::memcpy(copy->buffer().as<float*>(), blob->cbuffer().as<const float*>(), blob->byteSize());
+    return copy;
+}
+
+/**
+* \brief Threads running DetectionOutputPostProcessor on the pushed jobs, every thread has its own post-processor.
+* The printed detections of every image are kept in the image order
+*/
+class DetectionWorkers {
+public:
+    DetectionWorkers(size_t threadsNum, size_t imagesNum,
+                     const std::function<std::unique_ptr<DetectionOutputPostProcessor>()> &makePostProcessor,
+                     size_t maxProposalCount, size_t objectSize):
+            detections(imagesNum), maxProposalCount(maxProposalCount), objectSize(objectSize), finished(false) {
+        for (size_t i = 0; i < threadsNum; i++) {
+            std::shared_ptr<DetectionOutputPostProcessor> postProcessor = makePostProcessor();
+            threads.emplace_back([this, postProcessor] {
+                work(*postProcessor);
+            });
+        }
+    }
+
+    DetectionWorkers(const DetectionWorkers&) = delete;
+    DetectionWorkers& operator=(const DetectionWorkers&) = delete;
+
+    ~DetectionWorkers() {
+        stop();
+    }
+
+    /**
+    * \brief Waits while every thread has a job queued, so the copied outputs don't pile up
+    */
+    void push(DetectionJob job) {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [this] {return jobs.size() < threads.size() || error;});
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        jobs.push_back(std::move(job));
+        lock.unlock();
+        changed.notify_all();
+    }
+
+    /**
+    * \brief Postprocesses the queued jobs, stops the threads and returns the printed detections of every image.
+    * Rethrows an exception of a thread
+    */
+    std::vector<std::string> finish() {
+        stop();
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        return std::move(detections);
+    }
+
+private:
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished = true;
+        }
+        changed.notify_all();
+        for (auto &thread : threads) {
+            if (thread.joinable()) {
+                thread.join();
+            }
+        }
+    }
+
+    void work(DetectionOutputPostProcessor &postProcessor) {
+        Blob::Ptr outputBlob = std::make_shared<TBlob<float>>(TensorDesc(Precision::FP32, {1, 1, maxProposalCount, objectSize}, Layout::NCHW));
+        outputBlob->allocate();
+        std::vector<Blob::Ptr> outputBlobs = { outputBlob };
+        try {
+            while (true) {
+                DetectionJob job;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    changed.wait(lock, [this] {return !jobs.empty() || finished || error;});
+                    if (jobs.empty() || error) {
+                        return;
+                    }
+                    job = std::move(jobs.front());
+                    jobs.pop_front();
+                }
+                changed.notify_all();
+
+                if (OK != postProcessor.execute(job.outputs, outputBlobs, nullptr)) {
+                    throw std::runtime_error("Can't postprocess the outputs of the image " + std::to_string(job.imageId));
+                }
+                const float* detection = outputBlob->cbuffer().as<const float*>();
+                std::ostringstream out;
+                for (size_t curProposal = 0; curProposal < maxProposalCount; curProposal++) {
+                    if (detection[curProposal * objectSize + 0] < 0) {
+                        break;
+                    }
+                    out << "[" << curProposal << "," << static_cast<int>(detection[curProposal * objectSize + 1])
+                        << "] element, prob = " << detection[curProposal * objectSize + 2] << "    ("
+                        << static_cast<int>(detection[curProposal * objectSize + 3] * job.imageSize.width) << ","
+                        << static_cast<int>(detection[curProposal * objectSize + 4] * job.imageSize.height) << ")-("
+                        << static_cast<int>(detection[curProposal * objectSize + 5] * job.imageSize.width) << ","
+                        << static_cast<int>(detection[curProposal * objectSize + 6] * job.imageSize.height) << ")\n";
+                }
+                detections[job.imageId] = out.str();  // every thread writes its own images
+            }
+        } catch (...) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+            changed.notify_all();
+        }
+    }
+
+    std::vector<std::string> detections;
+    const size_t maxProposalCount;
+    const size_t objectSize;
+    std::deque<DetectionJob> jobs;
+    bool finished;
+    std::exception_ptr error;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<std::thread> threads;
+};
+
+/**
+* \brief Infers the images by nireq asynchronous requests of an image each. The outputs of the completed requests
+* are postprocessed by as many DetectionWorkers threads, while the main thread fills the requests with the next
+* images the ImageSetLoader decoded
+*/
+void runThroughputMode(ExecutableNetwork &executableNetwork, const std::vector<std::string> &imagePaths, size_t nireq,
+                       const std::string &imageInputName, const std::string &imInfoInputName, const SizeVector &imageInputDims,
+                       const std::function<std::unique_ptr<DetectionOutputPostProcessor>()> &makePostProcessor,
+                       size_t maxProposalCount, size_t objectSize) {
+    InferRequestPool<size_t> inferRequests(executableNetwork, nireq);
+    slog::info << "Number of infer requests in the throughput mode: " << inferRequests.depth() << slog::endl;
+    if (!imInfoInputName.empty()) {
+        // the image info is the same for every image
+        for (const auto &request : inferRequests.requests()) {
+            Blob::Ptr imInfo = request->GetBlob(imInfoInputName);
+            const size_t imInfoDim = imInfo->getTensorDesc().getDims()[1];
+            float *p = imInfo->buffer().as<PrecisionTrait<Precision::FP32>::value_type*>();
+            p[0] = static_cast<float>(imageInputDims[2]);
+            p[1] = static_cast<float>(imageInputDims[3]);
+            for (size_t k = 2; k < imInfoDim; k++) {
+                p[k] = 1.0f;  // all scale factors are set to 1.0
+            }
+        }
+    }
+
+    DetectionWorkers workers(inferRequests.depth(), imagePaths.size(), makePostProcessor, maxProposalCount, objectSize);
+    std::vector<cv::Size> imageSizes(imagePaths.size());
+    size_t inferredImages = 0;
+
+    slog::info << "Start inference" << slog::endl;
+    auto startTime = std::chrono::steady_clock::now();
+    // the images of the next requests are decoded while the current ones are inferred
+    ImageSetLoader loader(imagePaths, 2 * inferRequests.depth());
+    ImageSetLoader::Image image;
+    while (true) {
+        while (inferRequests.hasIdle() && loader.next(image)) {
+            Blob::Ptr imageInput = inferRequests.idleRequest()->GetBlob(imageInputName);
+            matU8ToBlob<unsigned char>(image.image, imageInput);
+            imageSizes[image.index] = image.image.size();
+            inferRequests.startAsync(image.index);
+        }
+        if (inferRequests.empty()) {
+            break;
+        }
+
+        InferRequestPool<size_t>::Result result = inferRequests.pop();
+        DetectionJob job{result.payload, imageSizes[result.payload], {
+            copyBlob(result.request->GetBlob(FLAGS_bbox_name)),
+            copyBlob(result.request->GetBlob(FLAGS_prob_name)),
+            copyBlob(result.request->GetBlob(FLAGS_proposal_name))}};
+        inferRequests.release(result);
+        workers.push(std::move(job));
+        inferredImages++;
+    }
+    std::vector<std::string> detections = workers.finish();
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    for (size_t imageId = 0; imageId < imagePaths.size(); imageId++) {
+        if (imageSizes[imageId] != cv::Size()) {
+            std::cout << imagePaths[imageId] << ":\n" << detections[imageId];
+        }
+    }
+    if (0 == inferredImages) {
+        throw std::logic_error("Valid input images were not found!");
+    }
+    slog::info << "Processed " << inferredImages << " images in " << seconds << " s, "
+               << inferredImages / seconds << " images/s" << slog::endl;
+    loader.printStats();
+}
+
 /**
 * \brief The entry point for the Inference Engine object_detection demo Faster RCNN application
 * \file object_detection_demo_faster_rcnn/main.cpp
@@ -96,7 +320,7 @@ int main(int argc, char *argv[]) {
             slog::endl;
 
         /** Read network model **/
-        CNNNetwork network = ie.ReadNetwork(FLAGS_m);
+        CNNNetwork network = readNetworkMapped(ie, FLAGS_m);
 
         // -----------------------------------------------------------------------------------------------------
 
@@ -169,41 +393,55 @@ int main(int argc, char *argv[]) {
          * so that we can easily parse it.
          */
 
-        DetectionOutputPostProcessor detOutPostProcessor(
-            inputsInfo[imageInputName]->getTensorDesc().getDims(),
-            outputsInfo[FLAGS_bbox_name]->getTensorDesc().getDims(),
-            outputsInfo[FLAGS_prob_name]->getTensorDesc().getDims(),
-            outputsInfo[FLAGS_proposal_name]->getTensorDesc().getDims());
+        const SizeVector imageInputDims = inputsInfo[imageInputName]->getTensorDesc().getDims();
+        const SizeVector bboxDims = outputsInfo[FLAGS_bbox_name]->getTensorDesc().getDims();
+        const SizeVector probDims = outputsInfo[FLAGS_prob_name]->getTensorDesc().getDims();
+        const SizeVector proposalDims = outputsInfo[FLAGS_proposal_name]->getTensorDesc().getDims();
+        auto makePostProcessor = [&]() {
+            return std::unique_ptr<DetectionOutputPostProcessor>(
+                new DetectionOutputPostProcessor(imageInputDims, bboxDims, probDims, proposalDims));
+        };
+        std::unique_ptr<DetectionOutputPostProcessor> detOutPostProcessor = makePostProcessor();
 
         // --------------------------- 4. Loading model to the device ------------------------------------------
         slog::info << "Loading model to the device" << slog::endl;
-        ExecutableNetwork executable_network = ie.LoadNetwork(network, FLAGS_d);
+        ExecutableNetwork executable_network = loadNetworkCached(ie, network, FLAGS_m, FLAGS_d, {}, FLAGS_cache_dir);
         // -----------------------------------------------------------------------------------------------------
 
+        if (FLAGS_nireq > 0) {
+            // the post-processor handles the proposals of a single image
+            if (network.getBatchSize() != 1) {
+                throw std::logic_error("The throughput mode requires a network of batch 1");
+            }
+            runThroughputMode(executable_network, imagePaths, FLAGS_nireq, imageInputName, imInfoInputName, imageInputDims,
+                              makePostProcessor, maxProposalCount, objectSize);
+            slog::info << "Execution successful" << slog::endl;
+            return 0;
+        }
+
         // --------------------------- 5. Create infer request -------------------------------------------------
         slog::info << "Create infer request" << slog::endl;
         InferRequest infer_request = executable_network.CreateInferRequest();
         // -----------------------------------------------------------------------------------------------------
 
         // --------------------------- 6. Prepare input --------------------------------------------------------
-        /** Collect images **/
+        size_t batchSize = network.getBatchSize();
+        slog::info << "Batch size is " << std::to_string(batchSize) << slog::endl;
+
+        /** Collect images, only the ones of the batch are decoded **/
         std::vector<cv::Mat> images;
-        for (auto &path: imagePaths) {
-            cv::Mat image = cv::imread(path, cv::IMREAD_COLOR);
-            if (image.empty()) {
-                slog::warn << "Image " + path + " cannot be read!" << slog::endl;
-                continue;
-            }
-            images.push_back(image);
+        ImageSetLoader loader(imagePaths, batchSize);
+        for (auto &image : loader.nextBatch(batchSize)) {
+            images.push_back(image.image);
         }
         if (images.empty()) throw std::logic_error("Valid input images were not found!");
 
-        size_t batchSize = network.getBatchSize();
-        slog::info << "Batch size is " << std::to_string(batchSize) << slog::endl;
-        if (batchSize != images.size()) {
-            slog::warn << "Number of images " + std::to_string(images.size()) +
+        if (batchSize != imagePaths.size()) {
+            slog::warn << "Number of images " + std::to_string(imagePaths.size()) +
                 " doesn't match batch size " + std::to_string(batchSize) << slog::endl;
-            batchSize = std::min(batchSize, images.size());
+        }
+        if (batchSize != images.size()) {
+            batchSize = images.size();
             slog::warn << "Number of images to be processed is "<< std::to_string(batchSize) << slog::endl;
         }
 
@@ -248,7 +486,7 @@ int main(int argc, char *argv[]) {
         output_blob->allocate();
         std::vector<Blob::Ptr> detOutOutBlobs = { output_blob };
 
-        detOutPostProcessor.execute(detOutInBlobs, detOutOutBlobs, nullptr);
+        detOutPostProcessor->execute(detOutInBlobs, detOutOutBlobs, nullptr);
 
         const float* detection = static_cast<PrecisionTrait<Precision::FP32>::value_type*>(output_blob->buffer());
 
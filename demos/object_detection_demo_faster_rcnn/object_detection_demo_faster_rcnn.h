@@ -26,6 +26,14 @@ static const char custom_cpu_library_message[] = "Required for CPU custom layers
 static const char bbox_layer_name_message[] = "Optional. The name of output box prediction layer. Default value is \"bbox_pred\"";
 static const char proposal_layer_name_message[] = "Optional. The name of output proposal layer. Default value is \"proposal\"";
 static const char prob_layer_name_message[] = "Optional. The name of output probability layer. Default value is \"cls_prob\"";
+static const char cache_dir_message[] = "Optional. Directory to cache compiled networks in. Later runs import the cached networks "
+                                        "instead of compiling them if the model, device and config didn't change. "
+                                        "Devices without network export support compile on each run.";
+static const char nireq_message[] = "Optional. Number of infer requests of the throughput mode. Default value is 0, in this case "
+                                    "the images are inferred as a batch by one request and drawn to out_<i>.bmp. "
+                                    "In the throughput mode every request infers an image, the requests run at once and the outputs "
+                                    "are postprocessed by as many threads while the next images are inferred. The detections "
+                                    "are printed with the number of images per second.";
 
 DEFINE_bool(h, false, help_message);
 DEFINE_string(i, "", image_message);
@@ -36,6 +44,8 @@ DEFINE_string(l, "", custom_cpu_library_message);
 DEFINE_string(bbox_name, "bbox_pred", bbox_layer_name_message);
 DEFINE_string(proposal_name, "proposal", proposal_layer_name_message);
 DEFINE_string(prob_name, "cls_prob", prob_layer_name_message);
+DEFINE_string(cache_dir, "", cache_dir_message);
+DEFINE_uint32(nireq, 0, nireq_message);
 
 /**
 * @brief This function show a help message
@@ -54,4 +64,6 @@ static void showUsage() {
     std::cout << "    -bbox_name \"<string>\"     " << bbox_layer_name_message << std::endl;
     std::cout << "    -proposal_name \"<string>\" " << proposal_layer_name_message << std::endl;
     std::cout << "    -prob_name \"<string>\"     " << prob_layer_name_message << std::endl;
+    std::cout << "    -cache_dir \"<path>\"       " << cache_dir_message << std::endl;
+    std::cout << "    -nireq \"<integer>\"        " << nireq_message << std::endl;
 }
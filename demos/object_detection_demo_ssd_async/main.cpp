@@ -12,6 +12,8 @@
 
 #include <chrono>
 #include <iostream>
+#include <fstream>
+#include <map>
 #include <memory>
 #include <vector>
 #include <string>
@@ -22,7 +24,16 @@
 
 #include <monitors/presenter.h>
 #include <samples/ocv_common.hpp>
+#include <samples/frame_prefetcher.hpp>
 #include <samples/slog.hpp>
+#include <samples/mapped_weights.hpp>
+#include <samples/network_cache.hpp>
+#include <samples/infer_request_pool.hpp>
+#include <samples/gpu_preprocessing.hpp>
+#include <samples/perf_counters.hpp>
+#include <samples/pipeline_worker.hpp>
+#include <samples/async_presenter.hpp>
+#include <samples/autotune.hpp>
 
 #include "object_detection_demo_ssd_async.hpp"
 
@@ -50,9 +61,13 @@ bool ParseAndCheckCommandLine(int argc, char *argv[]) {
 }
 
 void frameToBlob(const cv::Mat& frame,
-                 InferRequest::Ptr& inferRequest,
-                 const std::string& inputName) {
-    if (FLAGS_auto_resize) {
+                 const InferRequest::Ptr& inferRequest,
+                 const std::string& inputName,
+                 GpuPreprocessor* gpuPreprocessor) {
+    if (gpuPreprocessor) {
+        /* Resize and copy the image to the input buffer on the GPU */
+        gpuPreprocessor->frameToBlob(frame, inferRequest, inputName);
+    } else if (FLAGS_auto_resize) {
         /* Just set input blob containing read image. Resize and layout conversion will be done automatically */
         inferRequest->SetBlob(inputName, wrapMat2Blob(frame));
     } else {
@@ -73,21 +88,17 @@ int main(int argc, char *argv[]) {
         }
 
         slog::info << "Reading input" << slog::endl;
-        cv::VideoCapture cap;
-        if (!((FLAGS_i == "cam") ? cap.open(0) : cap.open(FLAGS_i.c_str()))) {
-            throw std::logic_error("Cannot open input file or camera: " + FLAGS_i);
-        }
-        const size_t width  = (size_t) cap.get(cv::CAP_PROP_FRAME_WIDTH);
-        const size_t height = (size_t) cap.get(cv::CAP_PROP_FRAME_HEIGHT);
+        FramePrefetcher frameReader(VideoCaptureSource::open(FLAGS_i));
 
         // read input (video) frame
-        cv::Mat curr_frame;  cap >> curr_frame;
-        cv::Mat next_frame;
-
-        if (!cap.grab()) {
-            throw std::logic_error("This demo supports only video (or camera) inputs !!! "
-                                   "Failed getting next frame from the " + FLAGS_i);
+        cv::Mat frame;
+        if (!frameReader.read(frame)) {
+            throw std::logic_error("Failed to get frame from " + FLAGS_i);
         }
+        const size_t width  = (size_t) frame.cols;
+        const size_t height = (size_t) frame.rows;
+        const cv::Size frameSize = frame.size();
+
         // -----------------------------------------------------------------------------------------------------
 
         // --------------------------- 1. Load inference engine -------------------------------------
@@ -110,15 +121,31 @@ int main(int argc, char *argv[]) {
         }
 
         /** Per layer metrics **/
-        if (FLAGS_pc) {
+        if (FLAGS_pc || !FLAGS_pc_report.empty()) {
             ie.SetConfig({ { PluginConfigParams::KEY_PERF_COUNT, PluginConfigParams::YES } });
         }
         // -----------------------------------------------------------------------------------------------------
 
         // --------------------------- 2. Read IR Generated by ModelOptimizer (.xml and .bin files) ------------
+        /** A frame is inferred per request, so only the precision variants and the streams are tuned **/
+        std::string modelPath = FLAGS_m;
+        std::map<std::string, std::string> loadConfig;
+        if (FLAGS_autotune) {
+            const autotune::Measurement tuned = autotuneNetwork(ie, "object_detection_demo_ssd_async", FLAGS_m, FLAGS_d,
+                                                                FLAGS_cache_dir, [](CNNNetwork& network) {
+                for (const auto& input : network.getInputsInfo()) {
+                    if (input.second->getTensorDesc().getDims().size() == 4) {
+                        input.second->setPrecision(Precision::U8);
+                    }
+                }
+            });
+            modelPath = tuned.candidate.modelPath;
+            loadConfig = autotune::config(tuned.candidate, FLAGS_d);
+        }
+
         slog::info << "Loading network files" << slog::endl;
         /** Read network model **/
-        auto cnnNetwork = ie.ReadNetwork(FLAGS_m);
+        auto cnnNetwork = readNetworkMapped(ie, modelPath);
         /** Set batch size to 1 **/
         slog::info << "Batch size is forced to  1." << slog::endl;
         cnnNetwork.setBatchSize(1);
@@ -140,11 +167,18 @@ int main(int argc, char *argv[]) {
         std::string imageInputName, imageInfoInputName;
         size_t netInputHeight, netInputWidth;
 
+        /** The frames for a GPU are resized by OpenCL in the buffers of the context shared with the plugin **/
+        std::unique_ptr<GpuPreprocessor> gpuPreprocessor;
+        if (GpuPreprocessor::isAvailable(FLAGS_d)) {
+            slog::info << "The frames are preprocessed on the GPU" << slog::endl;
+            gpuPreprocessor.reset(new GpuPreprocessor(ie, FLAGS_d));
+        }
+
         for (const auto & inputInfoItem : inputInfo) {
             if (inputInfoItem.second->getTensorDesc().getDims().size() == 4) {  // first input contains images
                 imageInputName = inputInfoItem.first;
                 inputInfoItem.second->setPrecision(Precision::U8);
-                if (FLAGS_auto_resize) {
+                if (FLAGS_auto_resize && !gpuPreprocessor) {
                     inputInfoItem.second->getPreProcess().setResizeAlgorithm(ResizeAlgorithm::RESIZE_BILINEAR);
                     inputInfoItem.second->getInputData()->setLayout(Layout::NHWC);
                 } else {
@@ -219,12 +253,17 @@ int main(int argc, char *argv[]) {
 
         // --------------------------- 4. Loading model to the device ------------------------------------------
         slog::info << "Loading model to the device" << slog::endl;
-        ExecutableNetwork network = ie.LoadNetwork(cnnNetwork, FLAGS_d);
+        const std::vector<DeviceNetwork> networks = loadOnDevices(FLAGS_d, [&](const std::string& deviceName) {
+            if (gpuPreprocessor) {
+                return gpuPreprocessor->loadNetwork(cnnNetwork);
+            }
+            return loadNetworkCached(ie, cnnNetwork, modelPath, deviceName, loadConfig, FLAGS_cache_dir);
+        });
         // -----------------------------------------------------------------------------------------------------
 
-        // --------------------------- 5. Create infer request -------------------------------------------------
-        InferRequest::Ptr async_infer_request_curr = network.CreateInferRequestPtr();
-        InferRequest::Ptr async_infer_request_next = network.CreateInferRequestPtr();
+        // --------------------------- 5. Create infer requests ------------------------------------------------
+        InferRequestPool<cv::Mat> inferRequests(networks, FLAGS_nireq);
+        slog::info << "Number of infer requests in the async mode: " << inferRequests.depth() << slog::endl;
 
         /* it's enough just to set image info input (if used in the model) only once */
         if (!imageInfoInputName.empty()) {
@@ -235,17 +274,16 @@ int main(int argc, char *argv[]) {
                 data[1] = static_cast<float>(netInputWidth);  // width
                 data[2] = 1;
             };
-            setImgInfoBlob(async_infer_request_curr);
-            setImgInfoBlob(async_infer_request_next);
+            for (const InferRequest::Ptr& inferRequest : inferRequests.requests()) {
+                setImgInfoBlob(inferRequest);
+            }
         }
         // -----------------------------------------------------------------------------------------------------
 
         // --------------------------- 6. Do inference ---------------------------------------------------------
         slog::info << "Start inference " << slog::endl;
 
-        bool isLastFrame = false;
         bool isAsyncMode = false;  // execution is always started using SYNC mode
-        bool isModeChanged = false;  // set to TRUE when execution mode is changed (SYNC<->ASYNC)
 
         typedef std::chrono::duration<double, std::ratio<1, 1000>> ms;
         auto total_t0 = std::chrono::high_resolution_clock::now();
@@ -254,155 +292,174 @@ int main(int argc, char *argv[]) {
 
         std::cout << "To close the application, press 'CTRL+C' here or switch to the output window and press ESC key" << std::endl;
         std::cout << "To switch between sync/async modes, press TAB key in the output window" << std::endl;
-        cv::Size graphSize{static_cast<int>(cap.get(cv::CAP_PROP_FRAME_WIDTH) / 4), 60};
-        Presenter presenter(FLAGS_u, static_cast<int>(cap.get(cv::CAP_PROP_FRAME_HEIGHT)) - graphSize.height - 10, graphSize);
-        while (true) {
-            auto t0 = std::chrono::high_resolution_clock::now();
-            // Here is the first asynchronous point:
-            // in the async mode we capture frame to populate the NEXT infer request
-            // in the regular mode we capture frame to the CURRENT infer request
-            if (!cap.read(next_frame)) {
-                if (next_frame.empty()) {
-                    isLastFrame = true;  // end of video file
-                } else {
-                    throw std::logic_error("Failed to get frame from cv::VideoCapture");
+        cv::Size graphSize{frameSize.width / 4, 60};
+        Presenter presenter(FLAGS_u, frameSize.height - graphSize.height - 10, graphSize);
+        AsyncPresenter display("Detection results", !FLAGS_no_show, &presenter);
+        const bool collectPerfCounters = FLAGS_pc || !FLAGS_pc_report.empty();
+        PerfCountersAggregator perfCounters;
+        struct DetectionJob {
+            cv::Mat frame;
+            std::vector<float> detections;  // a copy, so the request is reused at once
+            ms inference;
+            ms postprocessing;
+        };
+        // the detections are parsed and drawn in the background while the main thread starts the next
+        // frames and shows the previous ones, so the capture, the inference, the postprocessing and the
+        // rendering overlap
+        PipelineWorker<DetectionJob, DetectionJob> postprocessor([&](DetectionJob& job) {
+            const auto t0 = std::chrono::high_resolution_clock::now();
+            cv::Mat& curr_frame = job.frame;
+            const float *detections = job.detections.data();
+            for (int i = 0; i < maxProposalCount; i++) {
+                float image_id = detections[i * objectSize + 0];
+                if (image_id < 0) {
+                    break;
                 }
-            }
-            if (isAsyncMode) {
-                if (isModeChanged) {
-                    frameToBlob(curr_frame, async_infer_request_curr, imageInputName);
+
+                float confidence = detections[i * objectSize + 2];
+                auto label = static_cast<int>(detections[i * objectSize + 1]);
+                float xmin = detections[i * objectSize + 3] * width;
+                float ymin = detections[i * objectSize + 4] * height;
+                float xmax = detections[i * objectSize + 5] * width;
+                float ymax = detections[i * objectSize + 6] * height;
+
+                if (FLAGS_r) {
+                    std::cout << "[" << i << "," << label << "] element, prob = " << confidence <<
+                              "    (" << xmin << "," << ymin << ")-(" << xmax << "," << ymax << ")"
+                              << ((confidence > FLAGS_t) ? " WILL BE RENDERED!" : "") << std::endl;
                 }
-                if (!isLastFrame) {
-                    frameToBlob(next_frame, async_infer_request_next, imageInputName);
+
+                if (confidence > FLAGS_t) {
+                    /** Drawing only objects when > confidence_threshold probability **/
+                    std::ostringstream conf;
+                    conf << ":" << std::fixed << std::setprecision(3) << confidence;
+                    cv::putText(curr_frame,
+                                (static_cast<size_t>(label) < labels.size() ?
+                                labels[label] : std::string("label #") + std::to_string(label)) + conf.str(),
+                                cv::Point2f(xmin, ymin - 5), cv::FONT_HERSHEY_COMPLEX_SMALL, 1,
+                                cv::Scalar(0, 0, 255));
+                    cv::rectangle(curr_frame, cv::Point2f(xmin, ymin), cv::Point2f(xmax, ymax), cv::Scalar(0, 0, 255));
                 }
-            } else if (!isModeChanged) {
-                frameToBlob(curr_frame, async_infer_request_curr, imageInputName);
             }
+            job.postprocessing = std::chrono::duration_cast<ms>(std::chrono::high_resolution_clock::now() - t0);
+            return std::move(job);
+        });
 
-            auto t1 = std::chrono::high_resolution_clock::now();
-            double ocv_decode_time = std::chrono::duration_cast<ms>(t1 - t0).count();
+        double ocv_decode_time = 0;
+        ms decodeSum{0}, inferenceSum{0}, postprocessingSum{0}, renderSum{0};
+        size_t framesNum = 0;
+        while (true) {
+            auto t0 = std::chrono::high_resolution_clock::now();
+            // Here is the asynchronous point:
+            // in the async mode we populate and start all the idle infer requests with the next frames
+            // in the regular mode we start one request only after the previous frame is shown
+            while (!frame.empty() && inferRequests.hasIdle()
+                    && (isAsyncMode || (inferRequests.empty() && postprocessor.empty()))) {
+                frameToBlob(frame, inferRequests.idleRequest(), imageInputName, gpuPreprocessor.get());
+                inferRequests.startAsync(frame);
+                frame = cv::Mat();  // the started request keeps the frame
+                frameReader.read(frame);
+            }
 
-            t0 = std::chrono::high_resolution_clock::now();
-            // Main sync point:
-            // in the truly Async mode we start the NEXT infer request, while waiting for the CURRENT to complete
-            // in the regular mode we start the CURRENT request and immediately wait for it's completion
-            if (isAsyncMode) {
-                if (isModeChanged) {
-                    async_infer_request_curr->StartAsync();
-                }
-                if (!isLastFrame) {
-                    async_infer_request_next->StartAsync();
+            auto t1 = std::chrono::high_resolution_clock::now();
+            ocv_decode_time += std::chrono::duration_cast<ms>(t1 - t0).count();
+
+            // the completed requests go to the postprocessing in the order of frames, we wait for the oldest
+            // started request only if there is nothing to show. At most depth() frames wait for the postprocessing,
+            // the completed requests are held past that, so no request is idle and the frames aren't read until
+            // the postprocessing catches up
+            while (!inferRequests.empty() && postprocessor.size() < inferRequests.depth()
+                    && (inferRequests.frontReady() || postprocessor.empty())) {
+                InferRequestPool<cv::Mat>::Result result = inferRequests.pop();
+                const float *detections = result.request->GetBlob(outputName)->buffer().as<PrecisionTrait<Precision::FP32>::value_type*>();
+                DetectionJob job{std::move(result.payload),
+                                 std::vector<float>(detections, detections + maxProposalCount * objectSize),
+                                 std::chrono::duration_cast<ms>(std::chrono::high_resolution_clock::now() - result.startTime),
+                                 ms{0}};
+                if (collectPerfCounters) {
+                    perfCounters.add(*result.request);
                 }
-            } else if (!isModeChanged) {
-                async_infer_request_curr->StartAsync();
+                inferRequests.release(result);
+                postprocessor.push(std::move(job));
+            }
+            if (postprocessor.empty()) {
+                break;  // end of video file
             }
 
-            if (OK == async_infer_request_curr->Wait(IInferRequest::WaitMode::RESULT_READY)) {
-                t1 = std::chrono::high_resolution_clock::now();
-                ms detection = std::chrono::duration_cast<ms>(t1 - t0);
-
-                t0 = std::chrono::high_resolution_clock::now();
-                ms wall = std::chrono::duration_cast<ms>(t0 - wallclock);
-                wallclock = t0;
-
-                t0 = std::chrono::high_resolution_clock::now();
-
-                presenter.drawGraphs(curr_frame);
-
-                std::ostringstream out;
-                out << "OpenCV cap/render time: " << std::fixed << std::setprecision(2)
-                    << (ocv_decode_time + ocv_render_time) << " ms";
-                cv::putText(curr_frame, out.str(), cv::Point2f(0, 25), cv::FONT_HERSHEY_TRIPLEX, 0.6, cv::Scalar(0, 255, 0));
+            // Main sync point:
+            // we wait for the postprocessing of the oldest frame
+            DetectionJob job = postprocessor.pop();
+            cv::Mat& curr_frame = job.frame;
+            t0 = std::chrono::high_resolution_clock::now();
+            ms wall = std::chrono::duration_cast<ms>(t0 - wallclock);
+            wallclock = t0;
+
+            std::ostringstream out;
+            out << "OpenCV cap/render time: " << std::fixed << std::setprecision(2)
+                << (ocv_decode_time + ocv_render_time) << " ms";
+            cv::putText(curr_frame, out.str(), cv::Point2f(0, 25), cv::FONT_HERSHEY_TRIPLEX, 0.6, cv::Scalar(0, 255, 0));
+            out.str("");
+            out << "Wallclock time " << (isAsyncMode ? "(TRUE ASYNC):      " : "(SYNC, press Tab): ");
+            out << std::fixed << std::setprecision(2) << wall.count() << " ms (" << 1000.f / wall.count() << " fps)";
+            cv::putText(curr_frame, out.str(), cv::Point2f(0, 50), cv::FONT_HERSHEY_TRIPLEX, 0.6, cv::Scalar(0, 0, 255));
+            if (!isAsyncMode) {  // In the true async mode, there is no way to measure detection time directly
                 out.str("");
-                out << "Wallclock time " << (isAsyncMode ? "(TRUE ASYNC):      " : "(SYNC, press Tab): ");
-                out << std::fixed << std::setprecision(2) << wall.count() << " ms (" << 1000.f / wall.count() << " fps)";
-                cv::putText(curr_frame, out.str(), cv::Point2f(0, 50), cv::FONT_HERSHEY_TRIPLEX, 0.6, cv::Scalar(0, 0, 255));
-                if (!isAsyncMode) {  // In the true async mode, there is no way to measure detection time directly
-                    out.str("");
-                    out << "Detection time  : " << std::fixed << std::setprecision(2) << detection.count()
-                        << " ms ("
-                        << 1000.f / detection.count() << " fps)";
-                    cv::putText(curr_frame, out.str(), cv::Point2f(0, 75), cv::FONT_HERSHEY_TRIPLEX, 0.6,
-                                cv::Scalar(255, 0, 0));
-                }
-
-                // ---------------------------Process output blobs--------------------------------------------------
-                // Processing results of the CURRENT request
-                const float *detections = async_infer_request_curr->GetBlob(outputName)->buffer().as<PrecisionTrait<Precision::FP32>::value_type*>();
-                for (int i = 0; i < maxProposalCount; i++) {
-                    float image_id = detections[i * objectSize + 0];
-                    if (image_id < 0) {
-                        break;
-                    }
-
-                    float confidence = detections[i * objectSize + 2];
-                    auto label = static_cast<int>(detections[i * objectSize + 1]);
-                    float xmin = detections[i * objectSize + 3] * width;
-                    float ymin = detections[i * objectSize + 4] * height;
-                    float xmax = detections[i * objectSize + 5] * width;
-                    float ymax = detections[i * objectSize + 6] * height;
-
-                    if (FLAGS_r) {
-                        std::cout << "[" << i << "," << label << "] element, prob = " << confidence <<
-                                  "    (" << xmin << "," << ymin << ")-(" << xmax << "," << ymax << ")"
-                                  << ((confidence > FLAGS_t) ? " WILL BE RENDERED!" : "") << std::endl;
-                    }
-
-                    if (confidence > FLAGS_t) {
-                        /** Drawing only objects when > confidence_threshold probability **/
-                        std::ostringstream conf;
-                        conf << ":" << std::fixed << std::setprecision(3) << confidence;
-                        cv::putText(curr_frame,
-                                    (static_cast<size_t>(label) < labels.size() ?
-                                    labels[label] : std::string("label #") + std::to_string(label)) + conf.str(),
-                                    cv::Point2f(xmin, ymin - 5), cv::FONT_HERSHEY_COMPLEX_SMALL, 1,
-                                    cv::Scalar(0, 0, 255));
-                        cv::rectangle(curr_frame, cv::Point2f(xmin, ymin), cv::Point2f(xmax, ymax), cv::Scalar(0, 0, 255));
-                    }
-                }
+                out << "Detection time  : " << std::fixed << std::setprecision(2) << job.inference.count()
+                    << " ms ("
+                    << 1000.f / job.inference.count() << " fps)";
+                cv::putText(curr_frame, out.str(), cv::Point2f(0, 75), cv::FONT_HERSHEY_TRIPLEX, 0.6,
+                            cv::Scalar(255, 0, 0));
             }
 
-            if (!FLAGS_no_show) {
-                cv::imshow("Detection results", curr_frame);
-            }
+            display.show(std::move(curr_frame));
 
             t1 = std::chrono::high_resolution_clock::now();
             ocv_render_time = std::chrono::duration_cast<ms>(t1 - t0).count();
-
-            if (isLastFrame) {
-                break;
-            }
-
-            if (isModeChanged) {
-                isModeChanged = false;
-            }
-
-            // Final point:
-            // in the truly Async mode we swap the NEXT and CURRENT requests for the next iteration
-            curr_frame = next_frame;
-            next_frame = cv::Mat();
-            if (isAsyncMode) {
-                async_infer_request_curr.swap(async_infer_request_next);
-            }
-
-            const int key = cv::waitKey(1);
+            decodeSum += ms{ocv_decode_time};
+            inferenceSum += job.inference;
+            postprocessingSum += job.postprocessing;
+            renderSum += ms{ocv_render_time};
+            framesNum++;
+            ocv_decode_time = 0;
+
+            const int key = display.waitKey(-1);
             if (27 == key)  // Esc
                 break;
             if (9 == key) {  // Tab
                 isAsyncMode ^= true;
-                isModeChanged = true;
             } else {
-                presenter.handleKey(key);
+                display.handleKey(key);
             }
         }
+        display.stop();
         // -----------------------------------------------------------------------------------------------------
         auto total_t1 = std::chrono::high_resolution_clock::now();
         ms total = std::chrono::duration_cast<ms>(total_t1 - total_t0);
         std::cout << "Total Inference time: " << total.count() << std::endl;
+        printDevicesThroughput(std::cout, inferRequests, total.count() / 1000);
+        if (framesNum > 0) {
+            std::cout << "Mean stage times per frame: capture " << std::fixed << std::setprecision(2)
+                << decodeSum.count() / framesNum << " ms, inference " << inferenceSum.count() / framesNum
+                << " ms, postprocessing " << postprocessingSum.count() / framesNum << " ms, rendering "
+                << renderSum.count() / framesNum << " ms" << std::endl;
+        }
+        const FramePrefetcher::Stats inputStats = frameReader.getStats();
+        if (0 != inputStats.droppedFrames) {
+            std::cout << "Dropped " << inputStats.droppedFrames << " of " << inputStats.readFrames
+                << " input frames" << std::endl;
+        }
 
         /** Show performace results **/
         if (FLAGS_pc) {
-            printPerformanceCounts(*async_infer_request_curr, std::cout, getFullDeviceName(ie, FLAGS_d));
+            printPerformanceCounts(*inferRequests.requests().front(), std::cout, getFullDeviceName(ie, FLAGS_d));
+            perfCounters.printHotspots(std::cout);
+        }
+        if (!FLAGS_pc_report.empty()) {
+            std::ofstream report(FLAGS_pc_report);
+            if (!report.is_open()) {
+                throw std::runtime_error("Can't open the performance counters report file " + FLAGS_pc_report);
+            }
+            perfCounters.writeJson(report, getFullDeviceName(ie, FLAGS_d));
         }
         std::cout << presenter.reportMeans() << '\n';
     }
@@ -26,6 +26,18 @@ static const char raw_output_message[] = "Optional. Inference results as raw val
 static const char input_resizable_message[] = "Optional. Enables resizable input with support of ROI crop & auto resize.";
 static const char no_show_processed_video[] = "Optional. Do not show processed video.";
 static const char utilization_monitors_message[] = "Optional. List of monitors to show initially.";
+static const char cache_dir_message[] = "Optional. Directory to cache compiled networks in. Later runs import the cached networks "
+                                        "instead of compiling them if the model, device and config didn't change. "
+                                        "Devices without network export support compile on each run.";
+static const char nireq_message[] = "Optional. Number of infer requests kept in flight in the async mode. "
+                                    "0 uses the optimal number for the device: at least 2, 4 for MYRIAD and HDDL if the device does not report it. "
+                                    "The requests of -d MULTI:<device1>(<requests1>),<device2> are split between the devices, "
+                                    "0 gives each device its number in brackets or its optimal number.";
+static const char autotune_message[] = "Optional. Benchmark the precision variants of the model in the sibling FP32, FP16 and INT8 "
+                                       "directories with the stream counts of the device and use the fastest. The winner is cached "
+                                       "in the -cache_dir directory, the working directory without it, for the later runs on the host.";
+static const char pc_report_message[] = "Optional. Aggregate the per-layer performance counters of all the inferences "
+                                        "and write their mean, 95th percentile and top layers to the JSON file.";
 
 DEFINE_bool(h, false, help_message);
 DEFINE_string(i, "", video_message);
@@ -39,6 +51,10 @@ DEFINE_double(t, 0.5, thresh_output_message);
 DEFINE_bool(auto_resize, false, input_resizable_message);
 DEFINE_bool(no_show, false, no_show_processed_video);
 DEFINE_string(u, "", utilization_monitors_message);
+DEFINE_string(cache_dir, "", cache_dir_message);
+DEFINE_uint32(nireq, 0, nireq_message);
+DEFINE_string(pc_report, "", pc_report_message);
+DEFINE_bool(autotune, false, autotune_message);
 
 /**
 * \brief This function show a help message
@@ -61,4 +77,8 @@ static void showUsage() {
     std::cout << "    -auto_resize              " << input_resizable_message << std::endl;
     std::cout << "    -no_show                  " << no_show_processed_video << std::endl;
     std::cout << "    -u                        " << utilization_monitors_message << std::endl;
+    std::cout << "    -cache_dir \"<path>\"       " << cache_dir_message << std::endl;
+    std::cout << "    -nireq \"<integer>\"        " << nireq_message << std::endl;
+    std::cout << "    -pc_report \"<path>\"       " << pc_report_message << std::endl;
+    std::cout << "    -autotune                 " << autotune_message << std::endl;
 }
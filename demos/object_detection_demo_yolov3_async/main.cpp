@@ -18,13 +18,23 @@
 #include <string>
 #include <algorithm>
 #include <iterator>
+#include <map>
 
 #include <inference_engine.hpp>
 #include <ngraph/ngraph.hpp>
 
 #include <monitors/presenter.h>
 #include <samples/ocv_common.hpp>
+#include <samples/frame_prefetcher.hpp>
 #include <samples/slog.hpp>
+#include <samples/mapped_weights.hpp>
+#include <samples/network_cache.hpp>
+#include <samples/infer_request_pool.hpp>
+#include <samples/perf_counters.hpp>
+#include <samples/nms.hpp>
+#include <samples/yolo_region.hpp>
+#include <samples/yolo_graph.hpp>
+#include <samples/results_sink.hpp>
 
 #include "object_detection_demo_yolov3_async.hpp"
 
@@ -50,7 +60,7 @@ bool ParseAndCheckCommandLine(int argc, char *argv[]) {
     return true;
 }
 
-void FrameToBlob(const cv::Mat &frame, InferRequest::Ptr &inferRequest, const std::string &inputName) {
+void FrameToBlob(const cv::Mat &frame, const InferRequest::Ptr &inferRequest, const std::string &inputName) {
     if (FLAGS_auto_resize) {
         /* Just set input blob containing read image. Resize and layout conversion will be done automatically */
         inferRequest->SetBlob(inputName, wrapMat2Blob(frame));
@@ -61,12 +71,6 @@ void FrameToBlob(const cv::Mat &frame, InferRequest::Ptr &inferRequest, const st
     }
 }
 
-static int EntryIndex(int side, int lcoords, int lclasses, int location, int entry) {
-    int n = location / (side * side);
-    int loc = location % (side * side);
-    return n * side * side * (lcoords + lclasses + 1) + entry * side * side + loc;
-}
-
 struct DetectionObject {
     int xmin, ymin, xmax, ymax, class_id;
     float confidence;
@@ -88,20 +92,6 @@ struct DetectionObject {
     }
 };
 
-double IntersectionOverUnion(const DetectionObject &box_1, const DetectionObject &box_2) {
-    double width_of_overlap_area = fmin(box_1.xmax, box_2.xmax) - fmax(box_1.xmin, box_2.xmin);
-    double height_of_overlap_area = fmin(box_1.ymax, box_2.ymax) - fmax(box_1.ymin, box_2.ymin);
-    double area_of_overlap;
-    if (width_of_overlap_area < 0 || height_of_overlap_area < 0)
-        area_of_overlap = 0;
-    else
-        area_of_overlap = width_of_overlap_area * height_of_overlap_area;
-    double box_1_area = (box_1.ymax - box_1.ymin)  * (box_1.xmax - box_1.xmin);
-    double box_2_area = (box_2.ymax - box_2.ymin)  * (box_2.xmax - box_2.xmin);
-    double area_of_union = box_1_area + box_2_area - area_of_overlap;
-    return area_of_overlap / area_of_union;
-}
-
 class YoloParams {
     template <typename T>
     void computeAnchors(const std::vector<T> & mask) {
@@ -148,67 +138,57 @@ public:
     }
 };
 
-void ParseYOLOV3Output(const CNNNetwork &cnnNetwork, const std::string & output_name,
-                       const Blob::Ptr &blob, const unsigned long resized_im_h,
-                       const unsigned long resized_im_w, const unsigned long original_im_h,
-                       const unsigned long original_im_w,
-                       const double threshold, std::vector<DetectionObject> &objects) {
-
-    const int out_blob_h = static_cast<int>(blob->getTensorDesc().getDims()[2]);
-    const int out_blob_w = static_cast<int>(blob->getTensorDesc().getDims()[3]);
-    if (out_blob_h != out_blob_w)
-        throw std::runtime_error("Invalid size of output " + output_name +
-        " It should be in NCHW layout and H should be equal to W. Current H = " + std::to_string(out_blob_h) +
-        ", current W = " + std::to_string(out_blob_h));
-
-    // --------------------------- Extracting layer parameters -------------------------------------
-    YoloParams params;
-    if (auto ngraphFunction = cnnNetwork.getFunction()) {
-        for (const auto op : ngraphFunction->get_ops()) {
-            if (op->get_friendly_name() == output_name) {
-                auto regionYolo = std::dynamic_pointer_cast<ngraph::op::RegionYolo>(op);
-                if (!regionYolo) {
-                    throw std::runtime_error("Invalid output type: " +
-                        std::string(regionYolo->get_type_info().name) + ". RegionYolo expected");
-                }
+/**
+* @brief Resolves the region parameters of the outputs once after the network is reshaped, so the parsing of
+* the frames doesn't walk the ngraph ops. The outputs without a RegionYolo op keep the default parameters
+*/
+std::map<std::string, YoloParams> GetYoloParams(const CNNNetwork &cnnNetwork) {
+    auto ngraphFunction = cnnNetwork.getFunction();
+    if (!ngraphFunction) {
+        throw std::runtime_error("Can't get ngraph::Function. Make sure the provided model is in IR version 10 or greater.");
+    }
+    std::map<std::string, std::shared_ptr<ngraph::Node>> ops;
+    for (const auto op : ngraphFunction->get_ops()) {
+        ops[op->get_friendly_name()] = op;
+    }
 
-                params = regionYolo;
-                break;
+    std::map<std::string, YoloParams> yoloParams;
+    for (const auto &output : cnnNetwork.getOutputsInfo()) {
+        const std::string &output_name = output.first;
+        const SizeVector &dims = output.second->getTensorDesc().getDims();
+        if (dims.size() != 4 || dims[2] != dims[3])
+            throw std::runtime_error("Invalid size of output " + output_name +
+            " It should be in NCHW layout and H should be equal to W.");
+
+        YoloParams params;
+        auto op = ops.find(output_name);
+        if (op != ops.end()) {
+            auto regionYolo = std::dynamic_pointer_cast<ngraph::op::RegionYolo>(op->second);
+            if (!regionYolo) {
+                throw std::runtime_error("Invalid output type: " +
+                    std::string(op->second->get_type_info().name) + ". RegionYolo expected");
             }
+            params = regionYolo;
         }
-    } else {
-        throw std::runtime_error("Can't get ngraph::Function. Make sure the provided model is in IR version 10 or greater.");
+        yoloParams.emplace(output_name, params);
     }
+    return yoloParams;
+}
 
-    auto side = out_blob_h;
-    auto side_square = side * side;
+void ParseYOLOV3Output(const YoloParams &params, const Blob::Ptr &blob, const unsigned long resized_im_h,
+                       const unsigned long resized_im_w, const unsigned long original_im_h,
+                       const unsigned long original_im_w,
+                       const double threshold, std::vector<DetectionObject> &objects) {
+    const int side = static_cast<int>(blob->getTensorDesc().getDims()[2]);
+    const float h_scale = static_cast<float>(original_im_h) / static_cast<float>(resized_im_h);
+    const float w_scale = static_cast<float>(original_im_w) / static_cast<float>(resized_im_w);
     const float *output_blob = blob->buffer().as<PrecisionTrait<Precision::FP32>::value_type *>();
     // --------------------------- Parsing YOLO Region output -------------------------------------
-    for (int i = 0; i < side_square; ++i) {
-        int row = i / side;
-        int col = i % side;
-        for (int n = 0; n < params.num; ++n) {
-            int obj_index = EntryIndex(side, params.coords, params.classes, n * side * side + i, params.coords);
-            int box_index = EntryIndex(side, params.coords, params.classes, n * side * side + i, 0);
-            float scale = output_blob[obj_index];
-            if (scale < threshold)
-                continue;
-            double x = (col + output_blob[box_index + 0 * side_square]) / side * resized_im_w;
-            double y = (row + output_blob[box_index + 1 * side_square]) / side * resized_im_h;
-            double height = std::exp(output_blob[box_index + 3 * side_square]) * params.anchors[2 * n + 1];
-            double width = std::exp(output_blob[box_index + 2 * side_square]) * params.anchors[2 * n];
-            for (int j = 0; j < params.classes; ++j) {
-                int class_index = EntryIndex(side, params.coords, params.classes, n * side_square + i, params.coords + 1 + j);
-                float prob = scale * output_blob[class_index];
-                if (prob < threshold)
-                    continue;
-                DetectionObject obj(x, y, height, width, j, prob,
-                        static_cast<float>(original_im_h) / static_cast<float>(resized_im_h),
-                        static_cast<float>(original_im_w) / static_cast<float>(resized_im_w));
-                objects.push_back(obj);
-            }
-        }
-    }
+    decodeYoloRegion(output_blob, side, params.num, params.coords, params.classes, params.anchors,
+                     static_cast<float>(threshold), cv::Size(static_cast<int>(resized_im_w), static_cast<int>(resized_im_h)),
+                     [&](float x, float y, float height, float width, int class_id, float prob) {
+        objects.emplace_back(x, y, height, width, class_id, prob, h_scale, w_scale);
+    });
 }
 
 
@@ -223,22 +203,17 @@ int main(int argc, char *argv[]) {
         }
 
         slog::info << "Reading input" << slog::endl;
-        cv::VideoCapture cap;
-        if (!((FLAGS_i == "cam") ? cap.open(0) : cap.open(FLAGS_i.c_str()))) {
-            throw std::logic_error("Cannot open input file or camera: " + FLAGS_i);
-        }
+        FramePrefetcher frameReader(VideoCaptureSource::open(FLAGS_i));
 
         // read input (video) frame
-        cv::Mat frame;  cap >> frame;
         cv::Mat next_frame;
-
-        const size_t width  = (size_t) cap.get(cv::CAP_PROP_FRAME_WIDTH);
-        const size_t height = (size_t) cap.get(cv::CAP_PROP_FRAME_HEIGHT);
-
-        if (!cap.grab()) {
-            throw std::logic_error("This demo supports only video (or camera) inputs !!! "
-                                   "Failed to get next frame from the " + FLAGS_i);
+        if (!frameReader.read(next_frame)) {
+            throw std::logic_error("Failed to get frame from " + FLAGS_i);
         }
+        const size_t width  = (size_t) next_frame.cols;
+        const size_t height = (size_t) next_frame.rows;
+        const cv::Size frameSize = next_frame.size();
+
         // -----------------------------------------------------------------------------------------------------
 
         // --------------------------- 1. Load inference engine -------------------------------------
@@ -261,7 +236,7 @@ int main(int argc, char *argv[]) {
         }
 
         /** Per-layer metrics **/
-        if (FLAGS_pc) {
+        if (FLAGS_pc || !FLAGS_pc_report.empty()) {
             ie.SetConfig({ { PluginConfigParams::KEY_PERF_COUNT, PluginConfigParams::YES } });
         }
         // -----------------------------------------------------------------------------------------------------
@@ -269,7 +244,7 @@ int main(int argc, char *argv[]) {
         // --------------- 2. Reading the IR generated by the Model Optimizer (.xml and .bin files) ------------
         slog::info << "Loading network files" << slog::endl;
         /** Reading network model **/
-        auto cnnNetwork = ie.ReadNetwork(FLAGS_m);
+        auto cnnNetwork = readNetworkMapped(ie, FLAGS_m);
         /** Reading labels (if specified) **/
         std::string labelFileName = fileNameNoExt(FLAGS_m) + ".labels";
         std::vector<std::string> labels;
@@ -283,10 +258,17 @@ int main(int argc, char *argv[]) {
         // --------------------------- 3. Configuring input and output -----------------------------------------
         // --------------------------------- Preparing input blobs ---------------------------------------------
         slog::info << "Checking that the inputs are as the demo expects" << slog::endl;
-        InputsDataMap inputInfo(cnnNetwork.getInputsInfo());
-        if (inputInfo.size() != 1) {
+        ICNNNetwork::InputShapes inputShapes = cnnNetwork.getInputShapes();
+        if (inputShapes.size() != 1) {
             throw std::logic_error("This demo accepts networks that have only one input");
         }
+        SizeVector& inSizeVector = inputShapes.begin()->second;
+        inSizeVector[0] = 1;  // set batch to 1
+        cnnNetwork.reshape(inputShapes);
+        if (FLAGS_device_postprocessing) {
+            cnnNetwork = appendYoloDetectionOutput(cnnNetwork, static_cast<float>(FLAGS_t), static_cast<float>(FLAGS_iou_t));
+        }
+        InputsDataMap inputInfo(cnnNetwork.getInputsInfo());
         InputInfo::Ptr& input = inputInfo.begin()->second;
         auto inputName = inputInfo.begin()->first;
         input->setPrecision(Precision::U8);
@@ -296,37 +278,37 @@ int main(int argc, char *argv[]) {
         } else {
             input->getInputData()->setLayout(Layout::NCHW);
         }
-
-        ICNNNetwork::InputShapes inputShapes = cnnNetwork.getInputShapes();
-        SizeVector& inSizeVector = inputShapes.begin()->second;
-        inSizeVector[0] = 1;  // set batch to 1
-        cnnNetwork.reshape(inputShapes);
         // --------------------------------- Preparing output blobs -------------------------------------------
         slog::info << "Checking that the outputs are as the demo expects" << slog::endl;
         OutputsDataMap outputInfo(cnnNetwork.getOutputsInfo());
         for (auto &output : outputInfo) {
             output.second->setPrecision(Precision::FP32);
-            output.second->setLayout(Layout::NCHW);
+            if (!FLAGS_device_postprocessing) {
+                output.second->setLayout(Layout::NCHW);
+            }
         }
+        const std::map<std::string, YoloParams> yoloParams = FLAGS_device_postprocessing
+            ? std::map<std::string, YoloParams>() : GetYoloParams(cnnNetwork);
+        const std::string detectionsName = outputInfo.begin()->first;
         // -----------------------------------------------------------------------------------------------------
 
         // --------------------------- 4. Loading model to the device ------------------------------------------
         slog::info << "Loading model to the device" << slog::endl;
-        ExecutableNetwork network = ie.LoadNetwork(cnnNetwork, FLAGS_d);
+        const std::vector<DeviceNetwork> networks = loadOnDevices(FLAGS_d, [&](const std::string& deviceName) {
+            return loadNetworkCached(ie, cnnNetwork, FLAGS_m, deviceName, {}, FLAGS_cache_dir);
+        });
 
         // -----------------------------------------------------------------------------------------------------
 
-        // --------------------------- 5. Creating infer request -----------------------------------------------
-        InferRequest::Ptr async_infer_request_next = network.CreateInferRequestPtr();
-        InferRequest::Ptr async_infer_request_curr = network.CreateInferRequestPtr();
+        // --------------------------- 5. Creating infer requests ----------------------------------------------
+        InferRequestPool<cv::Mat> inferRequests(networks, FLAGS_nireq);
+        slog::info << "Number of infer requests in the async mode: " << inferRequests.depth() << slog::endl;
         // -----------------------------------------------------------------------------------------------------
 
         // --------------------------- 6. Doing inference ------------------------------------------------------
         slog::info << "Start inference " << slog::endl;
 
-        bool isLastFrame = false;
         bool isAsyncMode = false;  // execution is always started using SYNC mode
-        bool isModeChanged = false;  // set to TRUE when execution mode is changed (SYNC<->ASYNC)
 
         typedef std::chrono::duration<double, std::ratio<1, 1000>> ms;
         auto total_t0 = std::chrono::high_resolution_clock::now();
@@ -335,150 +317,160 @@ int main(int argc, char *argv[]) {
 
         std::cout << "To close the application, press 'CTRL+C' here or switch to the output window and press ESC key" << std::endl;
         std::cout << "To switch between sync/async modes, press TAB key in the output window" << std::endl;
-        cv::Size graphSize{static_cast<int>(cap.get(cv::CAP_PROP_FRAME_WIDTH) / 4), 60};
-        Presenter presenter(FLAGS_u, static_cast<int>(cap.get(cv::CAP_PROP_FRAME_HEIGHT)) - graphSize.height - 10, graphSize);
+        cv::Size graphSize{frameSize.width / 4, 60};
+        Presenter presenter(FLAGS_u, frameSize.height - graphSize.height - 10, graphSize);
+        const bool collectPerfCounters = FLAGS_pc || !FLAGS_pc_report.empty();
+        PerfCountersAggregator perfCounters;
+        std::unique_ptr<ResultsSink> resultsSink;
+        if (!FLAGS_results.empty()) {
+            resultsSink.reset(new ResultsSink(FLAGS_results));
+        }
+        uint64_t frameId = 0;
         while (true) {
             auto t0 = std::chrono::high_resolution_clock::now();
-            // Here is the first asynchronous point:
-            // in the Async mode, we capture frame to populate the NEXT infer request
-            // in the regular mode, we capture frame to the CURRENT infer request
-            if (!cap.read(next_frame)) {
-                if (next_frame.empty()) {
-                    isLastFrame = true;  // end of video file
-                } else {
-                    throw std::logic_error("Failed to get frame from cv::VideoCapture");
-                }
+            // Here is the asynchronous point:
+            // in the Async mode, we populate and start all the idle infer requests with the next frames
+            // in the regular mode, we start one request only after the previous one is processed
+            while (!next_frame.empty() && inferRequests.hasIdle() && (isAsyncMode || inferRequests.empty())) {
+                FrameToBlob(next_frame, inferRequests.idleRequest(), inputName);
+                inferRequests.startAsync(next_frame);
+                next_frame = cv::Mat();  // the started request keeps the frame
+                frameReader.read(next_frame);
             }
-            if (isAsyncMode) {
-                if (isModeChanged) {
-                    FrameToBlob(frame, async_infer_request_curr, inputName);
-                }
-                if (!isLastFrame) {
-                    FrameToBlob(next_frame, async_infer_request_next, inputName);
-                }
-            } else if (!isModeChanged) {
-                FrameToBlob(frame, async_infer_request_curr, inputName);
+            if (inferRequests.empty()) {
+                break;  // end of video file
             }
             auto t1 = std::chrono::high_resolution_clock::now();
             double ocv_decode_time = std::chrono::duration_cast<ms>(t1 - t0).count();
 
-            t0 = std::chrono::high_resolution_clock::now();
             // Main sync point:
-            // in the true Async mode, we start the NEXT infer request while waiting for the CURRENT to complete
-            // in the regular mode, we start the CURRENT request and wait for its completion
-            if (isAsyncMode) {
-                if (isModeChanged) {
-                    async_infer_request_curr->StartAsync();
-                }
-                if (!isLastFrame) {
-                    async_infer_request_next->StartAsync();
-                }
-            } else if (!isModeChanged) {
-                async_infer_request_curr->StartAsync();
-            }
-
-            if (OK == async_infer_request_curr->Wait(IInferRequest::WaitMode::RESULT_READY)) {
-                t1 = std::chrono::high_resolution_clock::now();
-                ms detection = std::chrono::duration_cast<ms>(t1 - t0);
-
-                t0 = std::chrono::high_resolution_clock::now();
-                ms wall = std::chrono::duration_cast<ms>(t0 - wallclock);
-                wallclock = t0;
-
-                t0 = std::chrono::high_resolution_clock::now();
-                presenter.drawGraphs(frame);
-                std::ostringstream out;
-                out << "OpenCV cap/render time: " << std::fixed << std::setprecision(2)
-                    << (ocv_decode_time + ocv_render_time) << " ms";
-                cv::putText(frame, out.str(), cv::Point2f(0, 25), cv::FONT_HERSHEY_TRIPLEX, 0.6, cv::Scalar(0, 255, 0));
+            // we wait for the oldest started request, results are processed in the order of frames
+            InferRequestPool<cv::Mat>::Result result = inferRequests.pop();
+            cv::Mat& frame = result.payload;
+            t0 = std::chrono::high_resolution_clock::now();
+            ms detection = std::chrono::duration_cast<ms>(t0 - result.startTime);
+            ms wall = std::chrono::duration_cast<ms>(t0 - wallclock);
+            wallclock = t0;
+
+            presenter.drawGraphs(frame);
+            std::ostringstream out;
+            out << "OpenCV cap/render time: " << std::fixed << std::setprecision(2)
+                << (ocv_decode_time + ocv_render_time) << " ms";
+            cv::putText(frame, out.str(), cv::Point2f(0, 25), cv::FONT_HERSHEY_TRIPLEX, 0.6, cv::Scalar(0, 255, 0));
+            out.str("");
+            out << "Wallclock time " << (isAsyncMode ? "(TRUE ASYNC):      " : "(SYNC, press Tab): ");
+            out << std::fixed << std::setprecision(2) << wall.count() << " ms (" << 1000.f / wall.count() << " fps)";
+            cv::putText(frame, out.str(), cv::Point2f(0, 50), cv::FONT_HERSHEY_TRIPLEX, 0.6, cv::Scalar(0, 0, 255));
+            if (!isAsyncMode) {  // In the true async mode, there is no way to measure detection time directly
                 out.str("");
-                out << "Wallclock time " << (isAsyncMode ? "(TRUE ASYNC):      " : "(SYNC, press Tab): ");
-                out << std::fixed << std::setprecision(2) << wall.count() << " ms (" << 1000.f / wall.count() << " fps)";
-                cv::putText(frame, out.str(), cv::Point2f(0, 50), cv::FONT_HERSHEY_TRIPLEX, 0.6, cv::Scalar(0, 0, 255));
-                if (!isAsyncMode) {  // In the true async mode, there is no way to measure detection time directly
-                    out.str("");
-                    out << "Detection time  : " << std::fixed << std::setprecision(2) << detection.count()
-                        << " ms ("
-                        << 1000.f / detection.count() << " fps)";
-                    cv::putText(frame, out.str(), cv::Point2f(0, 75), cv::FONT_HERSHEY_TRIPLEX, 0.6,
-                                cv::Scalar(255, 0, 0));
-                }
+                out << "Detection time  : " << std::fixed << std::setprecision(2) << detection.count()
+                    << " ms ("
+                    << 1000.f / detection.count() << " fps)";
+                cv::putText(frame, out.str(), cv::Point2f(0, 75), cv::FONT_HERSHEY_TRIPLEX, 0.6,
+                            cv::Scalar(255, 0, 0));
+            }
 
-                // ---------------------------Processing output blobs--------------------------------------------------
-                // Processing results of the CURRENT request
-                const TensorDesc& inputDesc = inputInfo.begin()->second.get()->getTensorDesc();
-                unsigned long resized_im_h = getTensorHeight(inputDesc);
-                unsigned long resized_im_w = getTensorWidth(inputDesc);
-                std::vector<DetectionObject> objects;
-                // Parsing outputs
-                for (auto &output : outputInfo) {
-                    auto output_name = output.first;
-                    Blob::Ptr blob = async_infer_request_curr->GetBlob(output_name);
-                    ParseYOLOV3Output(cnnNetwork, output_name, blob, resized_im_h, resized_im_w, height, width, FLAGS_t, objects);
+            // ---------------------------Processing output blobs--------------------------------------------------
+            // Processing results of the oldest request
+            const TensorDesc& inputDesc = inputInfo.begin()->second.get()->getTensorDesc();
+            unsigned long resized_im_h = getTensorHeight(inputDesc);
+            unsigned long resized_im_w = getTensorWidth(inputDesc);
+            std::vector<DetectionObject> objects;
+            if (FLAGS_device_postprocessing) {
+                // the rows of the label, the score and the relative corners are sorted by the score
+                const Blob::Ptr detectionsBlob = result.request->GetBlob(detectionsName);
+                const float *detections = detectionsBlob->buffer().as<PrecisionTrait<Precision::FP32>::value_type *>();
+                const size_t maxDetections = detectionsBlob->getTensorDesc().getDims()[0];
+                for (size_t i = 0; i < maxDetections && detections[i * 6] >= 0; ++i) {
+                    const float *row = detections + i * 6;
+                    objects.emplace_back((row[2] + row[4]) / 2 * width, (row[3] + row[5]) / 2 * height,
+                                         (row[5] - row[3]) * height, (row[4] - row[2]) * width,
+                                         static_cast<int>(row[0]), row[1], 1.0f, 1.0f);
                 }
-                // Filtering overlapping boxes
-                std::sort(objects.begin(), objects.end(), std::greater<DetectionObject>());
-                for (size_t i = 0; i < objects.size(); ++i) {
-                    if (objects[i].confidence == 0)
-                        continue;
-                    for (size_t j = i + 1; j < objects.size(); ++j)
-                        if (IntersectionOverUnion(objects[i], objects[j]) >= FLAGS_iou_t)
-                            objects[j].confidence = 0;
+            } else {
+                std::vector<const YoloParams*> outputParams;
+                std::vector<Blob::Ptr> outputBlobs;
+                for (const auto &params : yoloParams) {
+                    outputParams.push_back(&params.second);
+                    outputBlobs.push_back(result.request->GetBlob(params.first));
                 }
-                // Drawing boxes
-                for (auto &object : objects) {
-                    if (object.confidence < FLAGS_t)
-                        continue;
-                    auto label = object.class_id;
-                    float confidence = object.confidence;
-                    if (FLAGS_r) {
-                        std::cout << "[" << label << "] element, prob = " << confidence <<
-                                  "    (" << object.xmin << "," << object.ymin << ")-(" << object.xmax << "," << object.ymax << ")"
-                                  << ((confidence > FLAGS_t) ? " WILL BE RENDERED!" : "") << std::endl;
-                    }
-                    if (confidence > FLAGS_t) {
-                        /** Drawing only objects when >confidence_threshold probability **/
-                        std::ostringstream conf;
-                        conf << ":" << std::fixed << std::setprecision(3) << confidence;
-                        cv::putText(frame,
-                                (label < static_cast<int>(labels.size()) ?
-                                        labels[label] : std::string("label #") + std::to_string(label)) + conf.str(),
-                                    cv::Point2f(static_cast<float>(object.xmin), static_cast<float>(object.ymin - 5)), cv::FONT_HERSHEY_COMPLEX_SMALL, 1,
-                                    cv::Scalar(0, 0, 255));
-                        cv::rectangle(frame, cv::Point2f(static_cast<float>(object.xmin), static_cast<float>(object.ymin)),
-                                      cv::Point2f(static_cast<float>(object.xmax), static_cast<float>(object.ymax)), cv::Scalar(0, 0, 255));
+                // Parsing outputs, the scales are parsed in parallel and their objects are merged before the filtering
+                std::vector<std::vector<DetectionObject>> scaleObjects(outputBlobs.size());
+                cv::parallel_for_(cv::Range(0, static_cast<int>(outputBlobs.size())), [&](const cv::Range& range) {
+                    for (int i = range.start; i < range.end; ++i) {
+                        ParseYOLOV3Output(*outputParams[i], outputBlobs[i], resized_im_h, resized_im_w, height, width,
+                                          FLAGS_t, scaleObjects[i]);
                     }
+                });
+                for (const auto &scale : scaleObjects) {
+                    objects.insert(objects.end(), scale.begin(), scale.end());
+                }
+                // Filtering overlapping boxes of the same class
+                NmsBoxes boxes;
+                boxes.reserve(objects.size());
+                for (const auto &object : objects) {
+                    boxes.push_back(static_cast<float>(object.xmin), static_cast<float>(object.ymin),
+                                    static_cast<float>(object.xmax), static_cast<float>(object.ymax),
+                                    object.confidence, object.class_id);
+                }
+                std::vector<DetectionObject> kept_objects;
+                for (int idx : nms(boxes, static_cast<float>(FLAGS_iou_t))) {
+                    kept_objects.push_back(objects[idx]);
+                }
+                objects.swap(kept_objects);
+            }
+            if (resultsSink) {
+                results::Frame frameResults;
+                frameResults.frameId = frameId;
+                frameResults.timestampUs = results::nowUs();
+                for (const auto &object : objects) {
+                    frameResults.addObject(static_cast<float>(object.xmin), static_cast<float>(object.ymin),
+                                           static_cast<float>(object.xmax - object.xmin),
+                                           static_cast<float>(object.ymax - object.ymin), object.confidence, object.class_id);
+                }
+                resultsSink->push(frameResults);
+            }
+            ++frameId;
+            // Drawing boxes
+            for (auto &object : objects) {
+                if (object.confidence < FLAGS_t)
+                    continue;
+                auto label = object.class_id;
+                float confidence = object.confidence;
+                if (FLAGS_r) {
+                    std::cout << "[" << label << "] element, prob = " << confidence <<
+                              "    (" << object.xmin << "," << object.ymin << ")-(" << object.xmax << "," << object.ymax << ")"
+                              << ((confidence > FLAGS_t) ? " WILL BE RENDERED!" : "") << std::endl;
+                }
+                if (confidence > FLAGS_t) {
+                    /** Drawing only objects when >confidence_threshold probability **/
+                    std::ostringstream conf;
+                    conf << ":" << std::fixed << std::setprecision(3) << confidence;
+                    cv::putText(frame,
+                            (label < static_cast<int>(labels.size()) ?
+                                    labels[label] : std::string("label #") + std::to_string(label)) + conf.str(),
+                                cv::Point2f(static_cast<float>(object.xmin), static_cast<float>(object.ymin - 5)), cv::FONT_HERSHEY_COMPLEX_SMALL, 1,
+                                cv::Scalar(0, 0, 255));
+                    cv::rectangle(frame, cv::Point2f(static_cast<float>(object.xmin), static_cast<float>(object.ymin)),
+                                  cv::Point2f(static_cast<float>(object.xmax), static_cast<float>(object.ymax)), cv::Scalar(0, 0, 255));
                 }
             }
             if (!FLAGS_no_show) {
                 cv::imshow("Detection results", frame);
             }
+            if (collectPerfCounters) {
+                perfCounters.add(*result.request);
+            }
+            inferRequests.release(result);
 
             t1 = std::chrono::high_resolution_clock::now();
             ocv_render_time = std::chrono::duration_cast<ms>(t1 - t0).count();
 
-            if (isLastFrame) {
-                break;
-            }
-
-            if (isModeChanged) {
-                isModeChanged = false;
-            }
-
-            // Final point:
-            // in the truly Async mode, we swap the NEXT and CURRENT requests for the next iteration
-            frame = next_frame;
-            next_frame = cv::Mat();
-            if (isAsyncMode) {
-                async_infer_request_curr.swap(async_infer_request_next);
-            }
-
             const int key = cv::waitKey(1);
             if (27 == key)  // Esc
                 break;
             if (9 == key) {  // Tab
                 isAsyncMode ^= true;
-                isModeChanged = true;
             } else {
                 presenter.handleKey(key);
             }
@@ -487,10 +479,24 @@ int main(int argc, char *argv[]) {
         auto total_t1 = std::chrono::high_resolution_clock::now();
         ms total = std::chrono::duration_cast<ms>(total_t1 - total_t0);
         std::cout << "Total Inference time: " << total.count() << std::endl;
+        printDevicesThroughput(std::cout, inferRequests, total.count() / 1000);
+        const FramePrefetcher::Stats inputStats = frameReader.getStats();
+        if (0 != inputStats.droppedFrames) {
+            std::cout << "Dropped " << inputStats.droppedFrames << " of " << inputStats.readFrames
+                << " input frames" << std::endl;
+        }
 
         /** Showing performace results **/
         if (FLAGS_pc) {
-            printPerformanceCounts(*async_infer_request_curr, std::cout, getFullDeviceName(ie, FLAGS_d));
+            printPerformanceCounts(*inferRequests.requests().front(), std::cout, getFullDeviceName(ie, FLAGS_d));
+            perfCounters.printHotspots(std::cout);
+        }
+        if (!FLAGS_pc_report.empty()) {
+            std::ofstream report(FLAGS_pc_report);
+            if (!report.is_open()) {
+                throw std::runtime_error("Can't open the performance counters report file " + FLAGS_pc_report);
+            }
+            perfCounters.writeJson(report, getFullDeviceName(ie, FLAGS_d));
         }
 
         std::cout << presenter.reportMeans() << '\n';
@@ -21,11 +21,25 @@ static const char custom_cldnn_message[] = "Optional. Required for GPU custom ke
 static const char custom_cpu_library_message[] = "Optional. Required for CPU custom layers. "
                                                  "Absolute path to a shared library with the layers implementation.";
 static const char thresh_output_message[] = "Optional. Probability threshold for detections.";
-static const char iou_thresh_output_message[] = "Optional. Filtering intersection over union threshold for overlapping boxes.";
+static const char iou_thresh_output_message[] = "Optional. Filtering intersection over union threshold for overlapping boxes of the same class.";
 static const char raw_output_message[] = "Optional. Output inference results raw values showing.";
 static const char input_resizable_message[] = "Optional. Enable resizable input with support of ROI crop and auto resize.";
 static const char no_show_processed_video[] = "Optional. Do not show processed video.";
 static const char utilization_monitors_message[] = "Optional. List of monitors to show initially.";
+static const char cache_dir_message[] = "Optional. Directory to cache compiled networks in. Later runs import the cached networks "
+                                        "instead of compiling them if the model, device and config didn't change. "
+                                        "Devices without network export support compile on each run.";
+static const char nireq_message[] = "Optional. Number of infer requests kept in flight in the async mode. "
+                                    "0 uses the optimal number for the device: at least 2, 4 for MYRIAD and HDDL if the device does not report it. "
+                                    "The requests of -d MULTI:<device1>(<requests1>),<device2> are split between the devices, "
+                                    "0 gives each device its number in brackets or its optimal number.";
+static const char pc_report_message[] = "Optional. Aggregate the per-layer performance counters of all the inferences "
+                                        "and write their mean, 95th percentile and top layers to the JSON file.";
+static const char device_postprocessing_message[] = "Optional. Decode the boxes and filter them by the NMS as a part of the inference, "
+                                                    "so the device returns only the detections instead of the raw regions. "
+                                                    "Requires the NonMaxSuppression support of the device, HETERO can run it on CPU.";
+static const char results_message[] = "Optional. Write the detections of every frame in a compact binary format to \"shm:<name>\" shared "
+                                      "memory ring, \"tcp:<host>:<port>\" or \"unix:<path>\" socket or to a file.";
 
 DEFINE_bool(h, false, help_message);
 DEFINE_string(i, "", video_message);
@@ -40,6 +54,11 @@ DEFINE_double(iou_t, 0.4, iou_thresh_output_message);
 DEFINE_bool(auto_resize, false, input_resizable_message);
 DEFINE_bool(no_show, false, no_show_processed_video);
 DEFINE_string(u, "", utilization_monitors_message);
+DEFINE_string(cache_dir, "", cache_dir_message);
+DEFINE_uint32(nireq, 0, nireq_message);
+DEFINE_string(pc_report, "", pc_report_message);
+DEFINE_bool(device_postprocessing, false, device_postprocessing_message);
+DEFINE_string(results, "", results_message);
 
 /**
 * \brief This function shows a help message
@@ -63,4 +82,9 @@ static void showUsage() {
     std::cout << "    -auto_resize              " << input_resizable_message << std::endl;
     std::cout << "    -no_show                  " << no_show_processed_video << std::endl;
     std::cout << "    -u                        " << utilization_monitors_message << std::endl;
+    std::cout << "    -cache_dir \"<path>\"       " << cache_dir_message << std::endl;
+    std::cout << "    -nireq \"<integer>\"        " << nireq_message << std::endl;
+    std::cout << "    -pc_report \"<path>\"       " << pc_report_message << std::endl;
+    std::cout << "    -device_postprocessing    " << device_postprocessing_message << std::endl;
+    std::cout << "    -results \"<target>\"       " << results_message << std::endl;
 }
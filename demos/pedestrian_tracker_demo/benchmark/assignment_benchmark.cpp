@@ -0,0 +1,84 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+// Compares AssignmentSolver with KuhnMunkres, the Munkres solver the tracker used
+// before it, on random dissimilarity matrices of the given sizes: dense, gated and
+// warm started from the previous "frame". KuhnMunkres is kept here as the reference.
+
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include <samples/assignment.hpp>
+#include <samples/microbenchmark.hpp>
+
+#include "kuhn_munkres.hpp"
+
+namespace {
+const int kRepeats = 10;
+const float kGate = 0.1f;
+const float kFrameNoise = 0.02f;
+
+template <typename F>
+double MeasureMs(F solve) {
+    return measureRuns(solve, 0, kRepeats).mean();
+}
+
+double Cost(const cv::Mat &dissimilarity, const std::vector<size_t> &res) {
+    double cost = 0;
+    for (size_t i = 0; i < res.size(); i++) {
+        if (res[i] < static_cast<size_t>(dissimilarity.cols)) {
+            cost += dissimilarity.at<float>(static_cast<int>(i), static_cast<int>(res[i]));
+        }
+    }
+    return cost;
+}
+}  // namespace
+
+int main(int argc, char *argv[]) {
+    const std::vector<int> sizes = benchmarkSizes(argc, argv, {50, 100, 200, 400});
+
+    cv::RNG rng(0);
+    std::cout << std::fixed << std::setprecision(3)
+              << "size\tKuhnMunkres ms\tdense ms\tgated ms\twarm ms\tcost diff" << std::endl;
+    for (int n : sizes) {
+        std::vector<cv::Mat> frames(kRepeats + 1);
+        for (auto &frame : frames) {
+            frame.create(n, n, CV_32F);
+            rng.fill(frame, cv::RNG::UNIFORM, 0.0f, 1.0f);
+        }
+        // Consecutive frames differ a bit, the way the tracks move between frames.
+        std::vector<cv::Mat> moved(kRepeats + 1);
+        moved[0] = frames[0];
+        for (int i = 1; i <= kRepeats; i++) {
+            cv::Mat noise(n, n, CV_32F);
+            rng.fill(noise, cv::RNG::UNIFORM, -kFrameNoise, kFrameNoise);
+            cv::Mat next = moved[i - 1] + noise;
+            moved[i] = cv::max(next, 0.0);
+        }
+
+        double cost_diff = 0;
+        double kuhn_munkres_ms = MeasureMs([&](int i) {
+            cost_diff -= Cost(frames[i], KuhnMunkres().Solve(frames[i]));
+        });
+        double dense_ms = MeasureMs([&](int i) {
+            cost_diff += Cost(frames[i], AssignmentSolver().solve(frames[i]));
+        });
+        double gated_ms = MeasureMs([&](int i) {
+            AssignmentSolver(kGate).solve(frames[i]);
+        });
+        AssignmentSolver warm_solver;
+        warm_solver.solve(moved[0]);
+        double warm_ms = MeasureMs([&](int i) {
+            std::vector<float> duals = warm_solver.getRowDuals();
+            warm_solver.solve(moved[i + 1], duals);
+        });
+
+        std::cout << n << '\t' << kuhn_munkres_ms << '\t' << dense_ms << '\t'
+                  << gated_ms << '\t' << warm_ms << '\t' << cost_diff / kRepeats << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,101 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+// Measures PedestrianTracker::Process on synthetic crowds of the given sizes
+// and breaks the time of a frame down by stages. The strong descriptors are
+// precomputed per walker, so no network is needed.
+
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include <samples/microbenchmark.hpp>
+#include <samples/synthetic_crowd.hpp>
+
+#include "descriptor.hpp"
+#include "distance.hpp"
+#include "tracker.hpp"
+
+namespace {
+const cv::Size kFrameSize(1920, 1080);
+const int kFrames = 300;
+const int kWarmupFrames = 25;
+const uint64_t kFrameMs = 40;
+const int kEmbeddingSize = 256;
+
+// Returns the precomputed embedding of the walker in the center of an image.
+class WalkerEmbeddings : public IImageDescriptor {
+public:
+    WalkerEmbeddings(int walkers, cv::RNG *rng) : embeddings_(walkers + 1) {
+        for (auto &embedding : embeddings_) {
+            embedding.create(1, kEmbeddingSize, CV_32F);
+            rng->fill(embedding, cv::RNG::NORMAL, 0.0f, 1.0f);
+        }
+    }
+
+    cv::Size size() const override { return cv::Size(kEmbeddingSize, 1); }
+
+    void Compute(const cv::Mat &mat, cv::Mat *descr) override {
+        int id = SyntheticCrowd::walkerId(mat.at<cv::Vec3b>(mat.rows / 2, mat.cols / 2));
+        *descr = embeddings_.at(id).clone();
+    }
+
+    void Compute(const std::vector<cv::Mat> &mats,
+                 std::vector<cv::Mat> *descrs) override {
+        descrs->resize(mats.size());
+        for (size_t i = 0; i < mats.size(); i++) {
+            Compute(mats[i], &(*descrs)[i]);
+        }
+    }
+
+private:
+    std::vector<cv::Mat> embeddings_;
+};
+}  // namespace
+
+int main(int argc, char *argv[]) {
+    const std::vector<int> sizes = benchmarkSizes(argc, argv, {10, 50, 100, 200, 500});
+
+    std::cout << std::fixed << std::setprecision(3)
+              << "objects\ttotal ms\tmax ms\taffinity ms\tassignment ms\treid ms\tbookkeeping ms" << std::endl;
+    for (int n : sizes) {
+        cv::RNG rng(0);
+        SyntheticCrowd crowd(n, kFrameSize);
+
+        PedestrianTracker tracker;
+        tracker.set_descriptor_fast(std::make_shared<ResizedImageDescriptor>(
+            cv::Size(16, 32), cv::InterpolationFlags::INTER_LINEAR));
+        tracker.set_distance_fast(std::make_shared<MatchTemplateDistance>());
+        tracker.set_descriptor_strong(std::make_shared<WalkerEmbeddings>(n, &rng));
+        tracker.set_distance_strong(std::make_shared<CosDistance>(cv::Size(kEmbeddingSize, 1)));
+
+        TrackerTimings sum;
+        BenchmarkSamples totals;
+        cv::Mat frame;
+        for (int frame_idx = 0; frame_idx < kWarmupFrames + kFrames; frame_idx++) {
+            TrackedObjects detections;
+            for (const auto &rect : crowd.step(frame)) {
+                detections.emplace_back(rect, rng.uniform(0.5f, 1.0f), frame_idx, -1);
+            }
+            tracker.Process(frame, detections, kFrameMs * (frame_idx + 1));
+            if (frame_idx < kWarmupFrames) continue;
+
+            const auto &timings = tracker.timings();
+            sum.affinity += timings.affinity;
+            sum.assignment += timings.assignment;
+            sum.reid += timings.reid;
+            sum.total += timings.total;
+            totals.add(timings.total);
+        }
+
+        double bookkeeping = sum.total - sum.affinity - sum.assignment - sum.reid;
+        std::cout << n << '\t' << totals.mean() << '\t' << totals.max() << '\t'
+                  << sum.affinity / kFrames << '\t' << sum.assignment / kFrames << '\t'
+                  << sum.reid / kFrames << '\t' << bookkeeping / kFrames << std::endl;
+    }
+    return 0;
+}
@@ -25,6 +25,10 @@ struct CnnConfig {
     std::string path_to_model;
     /** @brief Maximal size of batch */
     int max_batch_size{1};
+    /** @brief Maximal number of batches inferred at once */
+    int max_infer_requests{2};
+    /** @brief Directory to cache compiled networks in, empty - no cache */
+    std::string cache_dir;
 };
 
 /**
@@ -87,10 +91,14 @@ protected:
     InferenceEngine::ExecutableNetwork executable_network_;
     /** @brief IE InferRequest */
     mutable InferenceEngine::InferRequest infer_request_;
-    /** @brief Pointer to the pre-allocated input blob */
-    mutable InferenceEngine::Blob::Ptr input_blob_;
-    /** @brief Map of output blobs */
-    InferenceEngine::BlobMap outputs_;
+    /** @brief Requests inferring the batches after the first one at once */
+    mutable std::vector<InferenceEngine::InferRequest::Ptr> extra_requests_;
+    /** @brief Name of the input blob */
+    std::string input_blob_name_;
+    /** @brief Names of output blobs */
+    std::vector<std::string> output_blobs_names_;
+    /** @brief Whether the partial batches are inferred with SetBatch() */
+    bool dynamic_batch_{false};
 };
 
 class VectorCNN : public CnnBase {
@@ -103,6 +111,8 @@ public:
                  cv::Mat* vector, cv::Size outp_shape = cv::Size()) const;
     void Compute(const std::vector<cv::Mat>& images,
                  std::vector<cv::Mat>* vectors, cv::Size outp_shape = cv::Size()) const;
+    void Compute(const cv::Mat& frame, const std::vector<cv::Rect>& rois,
+                 std::vector<cv::Mat>* vectors, cv::Size outp_shape = cv::Size()) const;
 
     int size() const { return result_size_; }
 
@@ -44,6 +44,22 @@ public:
     virtual void Compute(const std::vector<cv::Mat> &mats,
                          std::vector<cv::Mat> *descrs) = 0;
 
+    ///
+    /// \brief Computes descriptors of image regions of one frame in batches.
+    /// \param[in] frame Frame containing the images of interest.
+    /// \param[in] rois Regions of the images of interest in the frame.
+    /// \param[out] descrs Matrices to store the computed descriptors.
+    ///
+    virtual void Compute(const cv::Mat &frame, const std::vector<cv::Rect> &rois,
+                         std::vector<cv::Mat> *descrs) {
+        std::vector<cv::Mat> mats;
+        mats.reserve(rois.size());
+        for (const auto &roi : rois) {
+            mats.push_back(frame(roi));
+        }
+        Compute(mats, descrs);
+    }
+
     ///
     /// \brief Prints performance counts for CNN-based descriptors
     ///
@@ -97,8 +113,37 @@ public:
         PT_CHECK(descrs != nullptr);
         descrs->resize(mats.size());
         for (size_t i = 0; i < mats.size(); i++)  {
-            Compute(mats[i], &(descrs[i]));
+            Compute(mats[i], &((*descrs)[i]));
+        }
+    }
+
+    ///
+    /// \brief Computes descriptors of image regions of one frame.
+    /// The descriptors share one allocation and the regions are resized in
+    /// parallel straight from the frame.
+    /// \param[in] frame Frame containing the images of interest.
+    /// \param[in] rois Regions of the images of interest in the frame.
+    /// \param[out] descrs Matrices to store the computed descriptors.
+    ///
+    void Compute(const cv::Mat &frame, const std::vector<cv::Rect> &rois,
+                 std::vector<cv::Mat> *descrs) override {
+        PT_CHECK(descrs != nullptr);
+        PT_CHECK(!frame.empty());
+        descrs->resize(rois.size());
+        if (rois.empty()) {
+            return;
         }
+        cv::Mat storage(static_cast<int>(rois.size()) * descr_size_.height,
+                        descr_size_.width, frame.type());
+        for (size_t i = 0; i < rois.size(); i++) {
+            (*descrs)[i] = storage.rowRange(static_cast<int>(i) * descr_size_.height,
+                                            static_cast<int>(i + 1) * descr_size_.height);
+        }
+        cv::parallel_for_(cv::Range(0, static_cast<int>(rois.size())), [&](const cv::Range &range) {
+            for (int i = range.start; i < range.end; i++) {
+                cv::resize(frame(rois[i]), (*descrs)[i], descr_size_, 0, 0, interpolation_);
+            }
+        });
     }
 
 private:
@@ -118,6 +163,8 @@ public:
                  const std::string & deviceName):
         handler(config, ie, deviceName) {}
 
+    using IImageDescriptor::Compute;
+
     ///
     /// \brief Descriptor size getter.
     /// \return Descriptor size.
@@ -145,6 +192,17 @@ public:
         handler.Compute(mats, descrs);
     }
 
+    ///
+    /// \brief Computes descriptors of image regions of one frame in batches.
+    /// \param[in] frame Frame containing the images of interest.
+    /// \param[in] rois Regions of the images of interest in the frame.
+    /// \param[out] descrs Matrices to store the computed descriptors.
+    ///
+    virtual void Compute(const cv::Mat &frame, const std::vector<cv::Rect> &rois,
+                         std::vector<cv::Mat> *descrs) {
+        handler.Compute(frame, rois, descrs);
+    }
+
     virtual void PrintPerformanceCounts(std::string fullDeviceName) const {
         handler.PrintPerformanceCounts(fullDeviceName);
     }
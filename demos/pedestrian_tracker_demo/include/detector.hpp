@@ -22,11 +22,24 @@ struct DetectorConfig : public CnnConfig {
     float increase_scale_x{1.f};
     float increase_scale_y{1.f};
     bool is_async = false;
+    int num_requests = 1;  // the submitted batches which may wait for their results with is_async
 };
 
 class ObjectDetector {
 private:
-    InferenceEngine::InferRequest::Ptr request;
+    // A request with the batch submitted to it
+    struct Request {
+        InferenceEngine::InferRequest::Ptr request;
+        std::vector<cv::Size> frame_sizes;
+        int frames = 0;
+        int frame_idx = -1;
+    };
+
+    // The requests are submitted and fetched in a ring, so the results come
+    // in the order of the submitted batches
+    std::vector<Request> requests_;
+    size_t next_submitted_ = 0;
+    size_t submitted_count_ = 0;
     DetectorConfig config_;
     InferenceEngine::Core ie_;
     std::string deviceName_;
@@ -37,18 +50,12 @@ private:
     std::string output_name_;
     int max_detections_count_;
     int object_size_;
-    int enqueued_frames_ = 0;
-    float width_ = 0;
-    float height_ = 0;
-    bool results_fetched_ = false;
-    int frame_idx_ = -1;
 
-    TrackedObjects results_;
+    std::vector<TrackedObjects> results_;
 
-    void enqueue(const cv::Mat &frame);
-    void submitRequest();
-    void wait();
-    void fetchResults();
+    void enqueue(Request &request, const cv::Mat &frame, int batch_idx);
+    void submitRequest(Request &request);
+    void fetchResults(Request &request);
 
 public:
     ObjectDetector(const DetectorConfig& config,
@@ -56,9 +63,16 @@ public:
                    const std::string & deviceName);
 
     void submitFrame(const cv::Mat &frame, int frame_idx);
+    // Submits up to max_batch_size frames as one batch, e.g. of different sources.
+    // Up to num_requests batches may be submitted before their results are fetched
+    void submitFrames(const std::vector<cv::Mat> &frames, int frame_idx);
+    // Waits for the oldest submitted batch
     void waitAndFetchResults();
+    // Returns true if one more batch can be submitted
+    bool canSubmit() const;
 
-    const TrackedObjects& getResults() const;
+    // Returns the detections of the frame with the index in the submitted batch
+    const TrackedObjects& getResults(size_t batch_idx = 0) const;
 
     void PrintPerformanceCounts(std::string fullDeviceName);
 };
@@ -39,6 +39,30 @@ public:
     virtual std::vector<float> Compute(const std::vector<cv::Mat> &descrs1,
                                        const std::vector<cv::Mat> &descrs2) = 0;
 
+    ///
+    /// \brief Precomputes what the distance needs from a descriptor, so that
+    /// a descriptor compared many times is processed once.
+    /// \param[in] descr Descriptor.
+    /// \return Prepared descriptor for ComputePrepared().
+    ///
+    virtual cv::Mat Prepare(const cv::Mat &descr) { return descr; }
+
+    ///
+    /// \brief Computes distances from one prepared descriptor to many.
+    /// \param[in] prepared Descriptor returned by Prepare().
+    /// \param[in] others Descriptors returned by Prepare().
+    /// \return Distances between the descriptor and each of the others.
+    ///
+    virtual std::vector<float> ComputePrepared(const cv::Mat &prepared,
+                                               const std::vector<cv::Mat> &others) {
+        std::vector<float> distances;
+        distances.reserve(others.size());
+        for (const auto &other : others) {
+            distances.push_back(Compute(prepared, other));
+        }
+        return distances;
+    }
+
     virtual ~IDescriptorDistance() {}
 };
 
@@ -114,6 +138,23 @@ public:
     ///
     std::vector<float> Compute(const std::vector<cv::Mat> &descrs1,
                                const std::vector<cv::Mat> &descrs2) override;
+    ///
+    /// \brief Converts an image descriptor to a float row, mean-subtracted
+    /// per channel for the TM_CCOEFF methods, followed by its squared norm.
+    /// \param[in] descr Image descriptor.
+    /// \return Prepared descriptor.
+    ///
+    cv::Mat Prepare(const cv::Mat &descr) override;
+    ///
+    /// \brief Computes distances from one prepared image descriptor to many
+    /// with a dot product per pair, the same as MatchTemplate gives for
+    /// images of the same size.
+    /// \param[in] prepared Prepared image descriptor used as the template.
+    /// \param[in] others Prepared image descriptors.
+    /// \return Distances between the descriptor and each of the others.
+    ///
+    std::vector<float> ComputePrepared(const cv::Mat &prepared,
+                                       const std::vector<cv::Mat> &others) override;
     virtual ~MatchTemplateDistance() {}
 
 private:
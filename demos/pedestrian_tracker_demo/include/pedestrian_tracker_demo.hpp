@@ -10,7 +10,8 @@
 #include <gflags/gflags.h>
 
 static const char help_message[] = "Print a usage message.";
-static const char video_message[] = "Required. Video sequence to process.";
+static const char video_message[] = "Required. Video sequence to process. "
+                                    "Several comma-separated sequences are tracked with shared networks.";
 static const char pedestrian_detection_model_message[] = "Required. Path to the Pedestrian Detection Retail model (.xml) file.";
 static const char pedestrian_reid_model_message[] = "Required. Path to the Pedestrian Reidentification Retail model (.xml) file.";
 static const char target_device_detection_message[] = "Optional. Specify the target device for pedestrian detection "
@@ -42,6 +43,42 @@ static const char last_frame_message[] = "Optional. The index of the last frame
 /// @brief Message list of monitors to show
 static const char utilization_monitors_message[] = "Optional. List of monitors to show initially.";
 
+/// @brief Message for the compiled networks cache directory
+static const char cache_dir_message[] = "Optional. Directory to cache compiled networks in. Later runs import the cached networks "
+                                        "instead of compiling them if the model, device and config didn't change. "
+                                        "Devices without network export support compile on each run.";
+
+/// @brief Message for writing the log from a background thread
+static const char log_async_message[] = "Optional. Write the log and the raw output (-r) from a background thread, "
+                                        "so printing does not slow down the processing.";
+
+/// @brief Message for writing the log to a file
+static const char log_file_message[] = "Optional. Write the log and the raw output (-r) to the file as JSON Lines records "
+                                       "from a background thread instead of the console.";
+
+/// @brief Message for pipelining the detection with the tracking
+static const char async_message[] = "Optional. Run the detector on the next frame while the tracker matches the current one "
+                                    "and runs the re-identification network on it. The frames are read ahead on a "
+                                    "background thread.";
+
+/// @brief Message for the number of the detector infer requests
+static const char nireq_message[] = "Optional. With -async, the number of the detector infer requests, so the detector "
+                                    "runs on up to this number of the next frames while the current one is tracked.";
+
+/// @brief Message for streaming the tracks out
+static const char stream_out_message[] = "Optional. Append the tracks to the -out file and print the raw output (-r) as the tracks "
+                                         "leave the tracker instead of keeping all tracks until the end, so the memory does not "
+                                         "grow with the video length.";
+
+/// @brief Message for the binary trajectories file
+static const char out_bin_message[] = "Optional. With -stream_out, write the -out file as binary records of six little-endian "
+                                      "int32 values: frame index, track id, x, y, width and height.";
+
+/// @brief Message for the eager re-identification descriptors
+static const char eager_reid_message[] = "Optional. Compute the re-identification descriptor of a track when the track is "
+                                         "created instead of keeping the crop of its last detection for a later "
+                                         "re-identification, so a track stores only its descriptors.";
+
 
 DEFINE_bool(h, false, help_message);
 DEFINE_string(i, "", video_message);
@@ -63,6 +100,38 @@ DEFINE_int32(last, -1, last_frame_message);
 /// It is an optional parameter
 DEFINE_string(u, "", utilization_monitors_message);
 
+/// \brief Define a path to the compiled networks cache<br>
+/// It is an optional parameter
+DEFINE_string(cache_dir, "", cache_dir_message);
+
+/// \brief Define a flag to write the log from a background thread<br>
+/// It is an optional parameter
+DEFINE_bool(log_async, false, log_async_message);
+
+/// \brief Define a path to the log file<br>
+/// It is an optional parameter
+DEFINE_string(log_file, "", log_file_message);
+
+/// \brief Define a flag to pipeline the detection with the tracking<br>
+/// It is an optional parameter
+DEFINE_bool(async, false, async_message);
+
+/// \brief Define a number of the detector infer requests<br>
+/// It is an optional parameter
+DEFINE_uint32(nireq, 1, nireq_message);
+
+/// \brief Define a flag to stream the tracks out<br>
+/// It is an optional parameter
+DEFINE_bool(stream_out, false, stream_out_message);
+
+/// \brief Define a flag to write the trajectories file in the binary format<br>
+/// It is an optional parameter
+DEFINE_bool(out_bin, false, out_bin_message);
+
+/// \brief Define a flag to compute the re-identification descriptors of the tracks eagerly<br>
+/// It is an optional parameter
+DEFINE_bool(eager_reid, false, eager_reid_message);
+
 
 /**
  * @brief This function show a help message
@@ -89,4 +158,12 @@ static void showUsage() {
     std::cout << "    -first                       " << first_frame_message << std::endl;
     std::cout << "    -last                        " << last_frame_message << std::endl;
     std::cout << "    -u                           " << utilization_monitors_message << std::endl;
+    std::cout << "    -cache_dir \"<path>\"          " << cache_dir_message << std::endl;
+    std::cout << "    -log_async                   " << log_async_message << std::endl;
+    std::cout << "    -log_file \"<path>\"           " << log_file_message << std::endl;
+    std::cout << "    -async                       " << async_message << std::endl;
+    std::cout << "    -nireq                       " << nireq_message << std::endl;
+    std::cout << "    -stream_out                  " << stream_out_message << std::endl;
+    std::cout << "    -out_bin                     " << out_bin_message << std::endl;
+    std::cout << "    -eager_reid                  " << eager_reid_message << std::endl;
 }
@@ -6,6 +6,7 @@
 
 #include "core.hpp"
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -65,12 +66,112 @@ struct TrackerParams {
                                    /// restricted by this parameter. If it is negative or zero, the max number of
                                    /// objects in track is not restricted.
 
+    bool eager_reid_descriptors;  ///< Compute the strong descriptor of a track
+                                  /// when it is created instead of keeping the
+                                  /// image of its last object until the strong
+                                  /// matching needs the descriptor.
+
     ///
     /// Default constructor.
     ///
     TrackerParams();
 };
 
+///
+/// \brief The TrackHistory class stores the last objects of a track.
+///
+/// The fields of the objects are stored in separate arrays which are used as
+/// ring buffers once the capacity is reached, so a track takes fixed memory.
+/// Zero capacity doesn't limit the history.
+///
+class TrackHistory {
+public:
+    ///
+    /// \brief TrackHistory constructor.
+    /// \param capacity Max number of the stored objects, 0 if unlimited.
+    ///
+    explicit TrackHistory(size_t capacity = 0) : capacity_(capacity), begin_(0) {}
+
+    ///
+    /// \brief empty returns if the history does not contain objects.
+    ///
+    bool empty() const { return rects_.empty(); }
+
+    ///
+    /// \brief size returns number of the stored objects.
+    ///
+    size_t size() const { return rects_.size(); }
+
+    ///
+    /// \brief operator [] returns the stored object with specified index,
+    ///        0 is the oldest one.
+    /// \param i Index of object.
+    ///
+    TrackedObject operator[](size_t i) const {
+        PT_CHECK_LT(i, size());
+        size_t idx = begin_ + i < size() ? begin_ + i : begin_ + i - size();
+        TrackedObject object(rects_[idx], confidences_[idx], frame_indices_[idx], object_ids_[idx]);
+        object.timestamp = timestamps_[idx];
+        return object;
+    }
+
+    ///
+    /// \brief back returns the last object.
+    ///
+    TrackedObject back() const {
+        PT_CHECK(!empty());
+        return (*this)[size() - 1];
+    }
+
+    ///
+    /// \brief push_back appends an object evicting the oldest one if the
+    ///        history is full.
+    /// \param object Object to append.
+    /// \param[out] evicted The evicted object if it isn't nullptr.
+    /// \return true if an object was evicted.
+    ///
+    bool push_back(const TrackedObject &object, TrackedObject *evicted = nullptr) {
+        if (capacity_ == 0 || size() < capacity_) {
+            rects_.push_back(object.rect);
+            confidences_.push_back(static_cast<float>(object.confidence));
+            frame_indices_.push_back(object.frame_idx);
+            object_ids_.push_back(object.object_id);
+            timestamps_.push_back(object.timestamp);
+            return false;
+        }
+        if (evicted != nullptr) {
+            *evicted = (*this)[0];
+        }
+        rects_[begin_] = object.rect;
+        confidences_[begin_] = static_cast<float>(object.confidence);
+        frame_indices_[begin_] = object.frame_idx;
+        object_ids_[begin_] = object.object_id;
+        timestamps_[begin_] = object.timestamp;
+        begin_ = begin_ + 1 < capacity_ ? begin_ + 1 : 0;
+        return true;
+    }
+
+    ///
+    /// \brief to_objects returns the stored objects from the oldest one.
+    ///
+    TrackedObjects to_objects() const {
+        TrackedObjects objects;
+        for (size_t i = 0; i < size(); i++) {
+            objects.push_back((*this)[i]);
+        }
+        return objects;
+    }
+
+private:
+    size_t capacity_;
+    size_t begin_;  ///< Index of the oldest object.
+    std::vector<cv::Rect> rects_;
+    std::vector<float> confidences_;
+    std::vector<int> frame_indices_;
+    std::vector<int> object_ids_;
+    std::vector<uint64_t> timestamps_;
+};
+
 ///
 /// \brief The Track struct describes tracks.
 ///
@@ -78,20 +179,27 @@ struct Track {
     ///
     /// \brief Track constructor.
     /// \param objs Detected objects sequence.
-    /// \param last_image Image of last image in the detected object sequence.
+    /// \param last_image Image of last image in the detected object sequence,
+    ///                   empty if the strong descriptor needn't be computed from it.
     /// \param descriptor_fast Fast descriptor.
     /// \param descriptor_strong Strong descriptor (reid embedding).
+    /// \param history_size Max number of objects to keep, 0 if unlimited.
     ///
     Track(const TrackedObjects &objs, const cv::Mat &last_image,
-          const cv::Mat &descriptor_fast, const cv::Mat &descriptor_strong)
-        : objects(objs),
+          const cv::Mat &descriptor_fast, const cv::Mat &descriptor_strong,
+          size_t history_size = 0)
+        : objects(history_size),
         predicted_rect(!objs.empty() ? objs.back().rect : cv::Rect()),
         last_image(last_image),
         descriptor_fast(descriptor_fast),
         descriptor_strong(descriptor_strong),
         lost(0),
-        length(1) {
+        length(1),
+        log_id(-1) {
             PT_CHECK(!objs.empty());
+            for (const auto &obj : objs) {
+                objects.push_back(obj);
+            }
             first_object = objs[0];
         }
 
@@ -108,50 +216,47 @@ struct Track {
     size_t size() const { return objects.size(); }
 
     ///
-    /// \brief operator [] return const reference to detected object with
-    ///        specified index.
-    /// \param i Index of object.
-    /// \return const reference to detected object with specified index.
-    ///
-    const TrackedObject &operator[](size_t i) const { return objects[i]; }
-
-    ///
-    /// \brief operator [] return non-const reference to detected object with
-    ///        specified index.
+    /// \brief operator [] returns detected object with specified index.
     /// \param i Index of object.
-    /// \return non-const reference to detected object with specified index.
+    /// \return detected object with specified index.
     ///
-    TrackedObject &operator[](size_t i) { return objects[i]; }
-
-    ///
-    /// \brief back returns const reference to last object in track.
-    /// \return const reference to last object in track.
-    ///
-    const TrackedObject &back() const {
-        PT_CHECK(!empty());
-        return objects.back();
-    }
+    TrackedObject operator[](size_t i) const { return objects[i]; }
 
     ///
-    /// \brief back returns non-const reference to last object in track.
-    /// \return non-const reference to last object in track.
+    /// \brief back returns last object in track.
+    /// \return last object in track.
     ///
-    TrackedObject &back() {
+    TrackedObject back() const {
         PT_CHECK(!empty());
         return objects.back();
     }
 
-    TrackedObjects objects;   ///< Detected objects;
+    TrackHistory objects;     ///< Detected objects;
     cv::Rect predicted_rect;  ///< Rectangle that represents predicted position
                               /// and size of bounding box if track has been lost.
-    cv::Mat last_image;       ///< Image of last detected object in track.
+    cv::Mat last_image;       ///< Image of last detected object in track, kept
+                              /// only until the strong descriptor is known.
     cv::Mat descriptor_fast;  ///< Fast descriptor.
+    cv::Mat descriptor_fast_prepared;  ///< Fast descriptor prepared for the
+                                       /// fast distance.
     cv::Mat descriptor_strong;  ///< Strong descriptor (reid embedding).
     size_t lost;                ///< How many frames ago track has been lost.
 
     TrackedObject first_object;  ///< First object in track.
     size_t length;  ///< Length of a track including number of objects that were
                     /// removed from track in order to avoid memory usage growth.
+    int log_id;  ///< Object id of the spilled objects of the track (-1 if N/A).
+};
+
+///
+/// \brief The TrackerTimings struct stores how long the stages of processing
+/// of the last frame took in milliseconds.
+///
+struct TrackerTimings {
+    double affinity = 0;    ///< Fast descriptors and the affinity matrix.
+    double assignment = 0;  ///< Solving the assignment problem.
+    double reid = 0;        ///< Strong descriptors and their distances.
+    double total = 0;       ///< Whole frame, the rest of it is bookkeeping.
 };
 
 ///
@@ -301,11 +406,33 @@ public:
     ///
     void DropForgottenTracks();
 
+    ///
+    /// \brief Streams the tracks out of the tracker instead of keeping them for
+    /// the detection log, so the memory doesn't grow with the processed video.
+    /// The callback receives the objects evicted from the history of a valid
+    /// track and the rest of a valid track once it is forgotten. The object
+    /// ids of the received objects number the valid tracks.
+    /// \param[in] callback Callback to receive the objects.
+    ///
+    void set_track_spill(const std::function<void(const TrackedObjects &)> &callback);
+
+    ///
+    /// \brief Spills the valid tracks which are still in the tracker and
+    /// forgets all tracks. It is called after the last frame.
+    ///
+    void SpillTracks();
+
     ///
     /// \brief Prints reid performance counter
     ///
     void PrintReidPerformanceCounts(std::string fullDeviceName) const;
 
+    ///
+    /// \brief Timings of the stages of the last processed frame.
+    /// \return Timings of the last Process() call.
+    ///
+    const TrackerTimings &timings() const;
+
 private:
     struct Match {
         int frame_idx1;
@@ -340,6 +467,17 @@ private:
     static float MotionAffinity(float w, const cv::Rect &trk,
                                 const cv::Rect &det);
 
+    // Returns the distance which the motion affinity decays with.
+    static float MotionDistance(const cv::Rect &trk, const cv::Rect &det);
+
+    // Returns the max motion distance of a track and a detection which still
+    // can be matched, the pairs farther apart are not scored.
+    float MaxMotionDistance() const;
+
+    // Returns the max dissimilarity of a track and a detection which still can
+    // be matched or infinity.
+    float MaxDissimilarity() const;
+
     // Returns time affinity.
     static float TimeAffinity(float w, const float &trk, const float &det);
 
@@ -379,8 +517,7 @@ private:
     std::vector<std::pair<size_t, size_t>> GetTrackToDetectionIds(
         const std::set<std::tuple<size_t, size_t, float>> &matches);
 
-    float AffinityFast(const cv::Mat &descriptor1, const TrackedObject &obj1,
-                       const cv::Mat &descriptor2, const TrackedObject &obj2);
+    float AffinityFast(const TrackedObject &obj1, const TrackedObject &obj2);
 
     float Affinity(const TrackedObject &obj1, const TrackedObject &obj2);
 
@@ -408,10 +545,17 @@ private:
 
     void UpdateLostTracks(const std::set<size_t> &track_ids);
 
+    void ComputeEagerStrongDescriptors(const cv::Mat &frame);
+
+    cv::Mat PooledCopy(const cv::Mat &descriptor);
+
+    void RecycleDescriptors(Track *track);
+
     const std::set<size_t> &active_track_ids() const;
 
     TrackedObjects FilterDetections(const TrackedObjects &detections) const;
     bool IsTrackForgotten(const Track &track) const;
+    void SpillObjects(Track *track, TrackedObjects objects);
 
     // Parameters of the pipeline.
     TrackerParams params_;
@@ -434,6 +578,12 @@ private:
     // All tracks.
     std::unordered_map<size_t, Track> tracks_;
 
+    // Tracks of the current frame waiting for the eager strong descriptors.
+    std::vector<size_t> tracks_without_strong_;
+
+    // Descriptor buffers of the dropped tracks reused by the new tracks.
+    std::vector<cv::Mat> descriptor_pool_;
+
     // Previous frame image.
     cv::Size prev_frame_size_;
 
@@ -447,6 +597,15 @@ private:
     // Distance between current active tracks.
     std::unordered_map<std::pair<size_t, size_t>, float, pair_hash> tracks_dists_;
 
+    // Receives the objects of the valid tracks which leave the tracker.
+    std::function<void(const TrackedObjects &)> track_spill_;
+
+    // Number of the tracks which were spilled.
+    int spilled_tracks_counter_;
+
+    // Row duals of the last assignment problem by track id.
+    std::unordered_map<size_t, float> assignment_duals_;
+
     // Number of all current tracks.
     size_t tracks_counter_;
 
@@ -455,5 +614,7 @@ private:
     std::vector<cv::Scalar> colors_;
 
     uint64_t prev_timestamp_;
+
+    TrackerTimings timings_;
 };
 
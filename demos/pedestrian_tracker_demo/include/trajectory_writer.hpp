@@ -0,0 +1,80 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include "core.hpp"
+
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+///
+/// \brief The TrajectoryWriter class appends tracked objects to a file from a
+/// background thread.
+///
+/// The objects are serialized by the caller into a pending buffer which the
+/// background thread writes and flushes, so a 24/7 run doesn't keep the
+/// trajectories in memory. The caller waits only if the thread falls behind
+/// by more than the buffer limit, no objects are dropped. Once a write fails
+/// the thread stops and the next Write() or Close() throws.
+///
+class TrajectoryWriter {
+public:
+    enum class Format {
+        CSV,     ///< frame,id,x,y,width,height lines like SaveDetectionLogToTrajFile.
+        BINARY   ///< Records of six little-endian int32: frame, id, x, y, width, height.
+    };
+
+    ///
+    /// \brief Creates the file and starts the writing thread.
+    /// \param[in] path Path to the file.
+    /// \param[in] format Format of the records.
+    /// \param[in] max_pending_bytes Size of the pending buffer which blocks
+    /// the caller.
+    ///
+    TrajectoryWriter(const std::string &path, Format format,
+                     size_t max_pending_bytes = 1 << 20);
+
+    ///
+    /// \brief Writes the pending objects and stops the thread, a failed write
+    /// isn't reported.
+    ///
+    ~TrajectoryWriter();
+
+    TrajectoryWriter(const TrajectoryWriter &) = delete;
+    TrajectoryWriter &operator=(const TrajectoryWriter &) = delete;
+
+    ///
+    /// \brief Appends the objects.
+    /// \param[in] objects Objects to append, the object ids are written.
+    ///
+    void Write(const TrackedObjects &objects);
+
+    ///
+    /// \brief Writes the pending objects and stops the thread.
+    /// \throw std::runtime_error if a write failed.
+    ///
+    void Close();
+
+private:
+    void Run();
+    void Stop();
+
+    std::string path_;
+    std::ofstream file_;
+    Format format_;
+    size_t max_pending_bytes_;
+
+    std::mutex mutex_;
+    std::condition_variable has_pending_;
+    std::condition_variable has_space_;
+    std::string pending_;
+    bool stopped_;
+    bool failed_;
+
+    std::thread thread_;
+};
@@ -93,6 +93,22 @@ void SaveDetectionLogToTrajFile(const std::string& path,
 ///
 void PrintDetectionLog(const DetectionLog& log);
 
+///
+/// \brief Append tracked objects to a stream in the format of
+///        SaveDetectionLogToTrajFile.
+/// \param[in,out] stream -- stream to append to
+/// \param[in] objects -- objects to store
+///
+void SaveTrackedObjectsToTrajStream(std::ostream& stream,
+                                    const TrackedObjects& objects);
+
+///
+/// \brief Print tracked objects to stdout in the format of
+///        PrintDetectionLog.
+/// \param[in] objects -- objects to print
+///
+void PrintTrackedObjects(const TrackedObjects& objects);
+
 ///
 /// \brief Draws a polyline on a frame.
 /// \param[in] polyline Vector of points (polyline).
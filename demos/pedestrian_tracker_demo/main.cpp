@@ -8,29 +8,37 @@
 #include "descriptor.hpp"
 #include "distance.hpp"
 #include "detector.hpp"
+#include "trajectory_writer.hpp"
 #include "pedestrian_tracker_demo.hpp"
 
 #include <monitors/presenter.h>
+#include <samples/args_helper.hpp>
+#include <samples/slog.hpp>
 
 #include <opencv2/core.hpp>
 
+#include <condition_variable>
+#include <deque>
+#include <exception>
 #include <iostream>
 #include <utility>
 #include <vector>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <gflags/gflags.h>
 
 using namespace InferenceEngine;
 using ImageWithFrameIndex = std::pair<cv::Mat, int>;
 
 std::unique_ptr<PedestrianTracker>
-CreatePedestrianTracker(const std::string& reid_model,
-                        const InferenceEngine::Core & ie,
-                        const std::string & deviceName,
+CreatePedestrianTracker(const std::shared_ptr<IImageDescriptor>& descriptor_strong,
+                        const std::shared_ptr<IDescriptorDistance>& distance_strong,
                         bool should_keep_tracking_info) {
     TrackerParams params;
+    params.eager_reid_descriptors = FLAGS_eager_reid;
 
     if (should_keep_tracking_info) {
         params.drop_forgotten_tracks = false;
@@ -39,7 +47,6 @@ CreatePedestrianTracker(const std::string& reid_model,
 
     std::unique_ptr<PedestrianTracker> tracker(new PedestrianTracker(params));
 
-    // Load reid-model.
     std::shared_ptr<IImageDescriptor> descriptor_fast =
         std::make_shared<ResizedImageDescriptor>(
             cv::Size(16, 32), cv::InterpolationFlags::INTER_LINEAR);
@@ -49,30 +56,186 @@ CreatePedestrianTracker(const std::string& reid_model,
     tracker->set_descriptor_fast(descriptor_fast);
     tracker->set_distance_fast(distance_fast);
 
-    if (!reid_model.empty()) {
-        CnnConfig reid_config(reid_model);
-        reid_config.max_batch_size = 16;   // defaulting to 16
-
-        std::shared_ptr<IImageDescriptor> descriptor_strong =
-            std::make_shared<DescriptorIE>(reid_config, ie, deviceName);
-
-        if (descriptor_strong == nullptr) {
-            THROW_IE_EXCEPTION << "[SAMPLES] internal error - invalid descriptor";
-        }
-        std::shared_ptr<IDescriptorDistance> distance_strong =
-            std::make_shared<CosDistance>(descriptor_strong->size());
-
+    if (descriptor_strong != nullptr) {
         tracker->set_descriptor_strong(descriptor_strong);
         tracker->set_distance_strong(distance_strong);
-    } else {
+    }
+
+    return tracker;
+}
+
+// The reid network is shared by the trackers of all sources
+std::shared_ptr<IImageDescriptor> CreateReidDescriptor(const std::string& reid_model,
+                                                       const InferenceEngine::Core & ie,
+                                                       const std::string & deviceName) {
+    if (reid_model.empty()) {
         std::cout << "WARNING: Reid model "
             << "was not specified. "
             << "Only fast reidentification approach will be used." << std::endl;
+        return nullptr;
     }
 
-    return tracker;
+    // Load reid-model.
+    CnnConfig reid_config(reid_model);
+    reid_config.max_batch_size = 16;   // defaulting to 16
+    reid_config.cache_dir = FLAGS_cache_dir;
+
+    std::shared_ptr<IImageDescriptor> descriptor_strong =
+        std::make_shared<DescriptorIE>(reid_config, ie, deviceName);
+
+    if (descriptor_strong == nullptr) {
+        THROW_IE_EXCEPTION << "[SAMPLES] internal error - invalid descriptor";
+    }
+    return descriptor_strong;
+}
+
+cv::VideoCapture OpenVideoCapture(const std::string& input) {
+    cv::VideoCapture cap;
+    try {
+        int intInput = std::stoi(input);
+        if (!cap.open(intInput)) {
+            throw std::runtime_error("Can't open " + std::to_string(intInput));
+        }
+    } catch (const std::invalid_argument&) {
+        if (!cap.open(input)) {
+            throw std::runtime_error("Can't open " + input);
+        }
+    } catch (const std::out_of_range&) {
+        if (!cap.open(input)) {
+            throw std::runtime_error("Can't open " + input);
+        }
+    }
+    return cap;
 }
 
+// Inserts the source index before the extension if there are several sources
+std::string GetSourceOutputPath(const std::string& path, size_t source_idx, size_t sources_count) {
+    if (sources_count == 1) {
+        return path;
+    }
+    size_t name_pos = path.find_last_of("/\\");
+    size_t ext_pos = path.find_last_of('.');
+    if (ext_pos == std::string::npos || (name_pos != std::string::npos && ext_pos < name_pos)) {
+        ext_pos = path.size();
+    }
+    return path.substr(0, ext_pos) + '_' + std::to_string(source_idx) + path.substr(ext_pos);
+}
+
+// A video source tracked by its own tracker
+struct Source {
+    cv::VideoCapture cap;
+    double video_fps = 0.0;
+    std::unique_ptr<PedestrianTracker> tracker;
+    std::string detlog_out;
+    std::unique_ptr<TrajectoryWriter> detlog_writer;
+    std::string window_name;
+};
+
+// The frames of the sources with the same index, detected as one batch
+struct FrameBatch {
+    int32_t frame_idx = 0;
+    std::vector<size_t> sources;  // Indices of the sources which have the frame
+    std::vector<cv::Mat> frames;
+};
+
+// Reads the batches of the sources up to capacity batches ahead on its own
+// thread, so the capture overlaps with the detection and the tracking. Zero
+// capacity reads on the calling thread.
+class FramePrefetcher {
+public:
+    FramePrefetcher(std::vector<Source> &sources, int32_t first_idx, int32_t last_idx, size_t capacity)
+        : sources_(sources), next_idx_(first_idx), last_idx_(last_idx), capacity_(capacity) {
+        if (capacity_ > 0) {
+            thread_ = std::thread(&FramePrefetcher::Run, this);
+        }
+    }
+
+    ~FramePrefetcher() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopped_ = true;
+        }
+        cond_.notify_all();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+    // Returns false after the last frames
+    bool Read(FrameBatch *batch) {
+        if (capacity_ == 0) {
+            return ReadBatch(batch);
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_.wait(lock, [this] { return !batches_.empty() || finished_; });
+        if (exception_) {
+            std::rethrow_exception(exception_);
+        }
+        if (batches_.empty()) {
+            return false;
+        }
+        *batch = std::move(batches_.front());
+        batches_.pop_front();
+        cond_.notify_all();
+        return true;
+    }
+
+private:
+    bool ReadBatch(FrameBatch *batch) {
+        batch->frame_idx = next_idx_++;
+        batch->sources.clear();
+        batch->frames.clear();
+        if (0 <= last_idx_ && batch->frame_idx > last_idx_) {
+            return false;
+        }
+        for (size_t i = 0; i < sources_.size(); i++) {
+            cv::Mat frame;
+            if (sources_[i].cap.read(frame)) {
+                batch->sources.push_back(i);
+                batch->frames.push_back(frame);
+            }
+        }
+        return !batch->frames.empty();
+    }
+
+    void Run() {
+        try {
+            for (;;) {
+                FrameBatch batch;
+                bool has_frames = ReadBatch(&batch);
+                std::unique_lock<std::mutex> lock(mutex_);
+                cond_.wait(lock, [this] { return stopped_ || batches_.size() < capacity_; });
+                if (stopped_) {
+                    return;
+                }
+                if (!has_frames) {
+                    break;
+                }
+                batches_.push_back(std::move(batch));
+                cond_.notify_all();
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            exception_ = std::current_exception();
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        finished_ = true;
+        cond_.notify_all();
+    }
+
+    std::vector<Source> &sources_;
+    int32_t next_idx_;
+    const int32_t last_idx_;
+    const size_t capacity_;
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::deque<FrameBatch> batches_;
+    bool stopped_ = false;
+    bool finished_ = false;
+    std::exception_ptr exception_;
+};
+
 bool ParseAndCheckCommandLine(int argc, char *argv[]) {
     // ---------------------------Parsing and validation of input args--------------------------------------
 
@@ -105,6 +268,12 @@ int main_work(int argc, char **argv) {
         return 0;
     }
 
+    if (!FLAGS_log_file.empty()) {
+        slog::startAsyncLogging(std::unique_ptr<slog::AsyncSink>(new slog::AsyncSink(FLAGS_log_file)));
+    } else if (FLAGS_log_async) {
+        slog::startAsyncLogging(std::unique_ptr<slog::AsyncSink>(new slog::AsyncSink(std::cout)));
+    }
+
 
     // Reading command line parameters.
     auto det_model = FLAGS_m_det;
@@ -140,37 +309,58 @@ int main_work(int argc, char **argv) {
             devices, custom_cpu_library, path_to_custom_layers,
             should_use_perf_counter);
 
+    std::vector<std::string> inputs = split(FLAGS_i, ',');
+
+    // One detector request detects on the frames of all sources as a batch
     DetectorConfig detector_confid(det_model);
+    detector_confid.cache_dir = FLAGS_cache_dir;
+    detector_confid.is_async = FLAGS_async;
+    detector_confid.num_requests = static_cast<int>(FLAGS_nireq);
+    detector_confid.max_batch_size = static_cast<int>(inputs.size());
     ObjectDetector pedestrian_detector(detector_confid, ie, detector_mode);
 
-    bool should_keep_tracking_info = should_save_det_log || should_print_out;
-    std::unique_ptr<PedestrianTracker> tracker =
-        CreatePedestrianTracker(reid_model, ie, reid_mode,
-                                should_keep_tracking_info);
+    std::shared_ptr<IImageDescriptor> descriptor_strong = CreateReidDescriptor(reid_model, ie, reid_mode);
+    std::shared_ptr<IDescriptorDistance> distance_strong;
+    if (descriptor_strong != nullptr) {
+        distance_strong = std::make_shared<CosDistance>(descriptor_strong->size());
+    }
 
-    cv::VideoCapture cap;
-    try {
-        int intInput = std::stoi(FLAGS_i);
-        if (!cap.open(intInput)) {
-            throw std::runtime_error("Can't open " + std::to_string(intInput));
+    bool should_keep_tracking_info = should_save_det_log || should_print_out;
+    bool should_stream_tracking_info = should_keep_tracking_info && FLAGS_stream_out;
+
+    std::vector<Source> sources(inputs.size());
+    for (size_t i = 0; i < sources.size(); i++) {
+        Source &source = sources[i];
+        source.tracker = CreatePedestrianTracker(descriptor_strong, distance_strong,
+                                                 should_keep_tracking_info && !should_stream_tracking_info);
+        source.detlog_out = GetSourceOutputPath(detlog_out, i, sources.size());
+        source.window_name = sources.size() == 1 ? "dbg" : "dbg " + std::to_string(i);
+
+        if (should_stream_tracking_info) {
+            if (should_save_det_log) {
+                source.detlog_writer.reset(new TrajectoryWriter(source.detlog_out, FLAGS_out_bin
+                                                                ? TrajectoryWriter::Format::BINARY
+                                                                : TrajectoryWriter::Format::CSV));
+            }
+            TrajectoryWriter *detlog_writer = source.detlog_writer.get();
+            source.tracker->set_track_spill([=](const TrackedObjects &objects) {
+                if (should_save_det_log)
+                    detlog_writer->Write(objects);
+                if (should_print_out)
+                    PrintTrackedObjects(objects);
+            });
         }
-    } catch (const std::invalid_argument&) {
-        if (!cap.open(FLAGS_i)) {
-            throw std::runtime_error("Can't open " + FLAGS_i);
+
+        source.cap = OpenVideoCapture(inputs[i]);
+        source.video_fps = source.cap.get(cv::CAP_PROP_FPS);
+        if (0.0 == source.video_fps) {
+            // the default frame rate for DukeMTMC dataset
+            source.video_fps = 60.0;
         }
-    } catch (const std::out_of_range&) {
-        if (!cap.open(FLAGS_i)) {
-            throw std::runtime_error("Can't open " + FLAGS_i);
+        if (0 >= FLAGS_first && !source.cap.set(cv::CAP_PROP_POS_FRAMES, FLAGS_first)) {
+            throw std::runtime_error("Can't set the frame to begin with");
         }
     }
-    double video_fps = cap.get(cv::CAP_PROP_FPS);
-    if (0.0 == video_fps) {
-        // the default frame rate for DukeMTMC dataset
-        video_fps = 60.0;
-    }
-    if (0 >= FLAGS_first && !cap.set(cv::CAP_PROP_POS_FRAMES, FLAGS_first)) {
-        throw std::runtime_error("Can't set the frame to begin with");
-    }
 
     std::cout << "To close the application, press 'CTRL+C' here";
     if (!FLAGS_no_show) {
@@ -178,72 +368,117 @@ int main_work(int argc, char **argv) {
     }
     std::cout << std::endl;
 
-    cv::Size graphSize{static_cast<int>(cap.get(cv::CAP_PROP_FRAME_WIDTH) / 4), 60};
+    cv::Size graphSize{static_cast<int>(sources[0].cap.get(cv::CAP_PROP_FRAME_WIDTH) / 4), 60};
     Presenter presenter(FLAGS_u, 10, graphSize);
 
-    for (int32_t frame_idx = std::max(0, FLAGS_first); 0 > FLAGS_last || frame_idx <= FLAGS_last; ++frame_idx) {
-        cv::Mat frame;
-        if (!cap.read(frame)) {
-            break;
+    // -async reads the frames ahead for all the detector requests and one more
+    FramePrefetcher prefetcher(sources, std::max(0, FLAGS_first), FLAGS_last,
+                               FLAGS_async ? FLAGS_nireq + 1 : 0);
+    std::deque<FrameBatch> submitted_batches;
+    bool has_next_batch = true;
+    // Keeps the detector busy with as many next batches as it takes
+    auto submit_next_batches = [&]() {
+        while (has_next_batch && pedestrian_detector.canSubmit()) {
+            FrameBatch batch;
+            has_next_batch = prefetcher.Read(&batch);
+            if (has_next_batch) {
+                pedestrian_detector.submitFrames(batch.frames, batch.frame_idx);
+                submitted_batches.push_back(std::move(batch));
+            }
         }
+    };
 
-        pedestrian_detector.submitFrame(frame, frame_idx);
+    submit_next_batches();
+    bool should_stop = false;
+
+    while (!submitted_batches.empty() && !should_stop) {
+        FrameBatch batch = std::move(submitted_batches.front());
+        submitted_batches.pop_front();
+        const int32_t frame_idx = batch.frame_idx;
         pedestrian_detector.waitAndFetchResults();
 
-        TrackedObjects detections = pedestrian_detector.getResults();
+        std::vector<TrackedObjects> batch_detections;
+        for (size_t b = 0; b < batch.sources.size(); b++) {
+            batch_detections.push_back(pedestrian_detector.getResults(b));
+        }
+
+        // The next frames are submitted before the current ones are tracked,
+        // so an asynchronous detector (-async) runs concurrently with the
+        // trackers and their re-identification network.
+        submit_next_batches();
 
-        // timestamp in milliseconds
-        uint64_t cur_timestamp = static_cast<uint64_t >(1000.0 / video_fps * frame_idx);
-        tracker->Process(frame, detections, cur_timestamp);
+        for (size_t b = 0; b < batch.sources.size(); b++) {
+            Source &source = sources[batch.sources[b]];
+            cv::Mat frame = batch.frames[b];
+            const TrackedObjects &detections = batch_detections[b];
+            auto &tracker = source.tracker;
 
-        presenter.drawGraphs(frame);
+            // timestamp in milliseconds
+            uint64_t cur_timestamp = static_cast<uint64_t >(1000.0 / source.video_fps * frame_idx);
+            tracker->Process(frame, detections, cur_timestamp);
 
-        if (should_show) {
-            // Drawing colored "worms" (tracks).
-            frame = tracker->DrawActiveTracks(frame);
+            if (batch.sources[b] == 0) {
+                presenter.drawGraphs(frame);
+            }
 
-            // Drawing all detected objects on a frame by BLUE COLOR
-            for (const auto &detection : detections) {
-                cv::rectangle(frame, detection.rect, cv::Scalar(255, 0, 0), 3);
+            if (should_show) {
+                // Drawing colored "worms" (tracks).
+                frame = tracker->DrawActiveTracks(frame);
+
+                // Drawing all detected objects on a frame by BLUE COLOR
+                for (const auto &detection : detections) {
+                    cv::rectangle(frame, detection.rect, cv::Scalar(255, 0, 0), 3);
+                }
+
+                // Drawing tracked detections only by RED color and print ID and detection
+                // confidence level.
+                for (const auto &detection : tracker->TrackedDetections()) {
+                    cv::rectangle(frame, detection.rect, cv::Scalar(0, 0, 255), 3);
+                    std::string text = std::to_string(detection.object_id) +
+                        " conf: " + std::to_string(detection.confidence);
+                    cv::putText(frame, text, detection.rect.tl(), cv::FONT_HERSHEY_COMPLEX,
+                                1.0, cv::Scalar(0, 0, 255), 3);
+                }
+
+                cv::resize(frame, frame, cv::Size(), 0.5, 0.5);
+                cv::imshow(source.window_name, frame);
             }
 
-            // Drawing tracked detections only by RED color and print ID and detection
-            // confidence level.
-            for (const auto &detection : tracker->TrackedDetections()) {
-                cv::rectangle(frame, detection.rect, cv::Scalar(0, 0, 255), 3);
-                std::string text = std::to_string(detection.object_id) +
-                    " conf: " + std::to_string(detection.confidence);
-                cv::putText(frame, text, detection.rect.tl(), cv::FONT_HERSHEY_COMPLEX,
-                            1.0, cv::Scalar(0, 0, 255), 3);
+            if (should_save_det_log && !should_stream_tracking_info && (frame_idx % 100 == 0)) {
+                DetectionLog log = tracker->GetDetectionLog(true);
+                SaveDetectionLogToTrajFile(source.detlog_out, log);
             }
+        }
 
-            cv::resize(frame, frame, cv::Size(), 0.5, 0.5);
-            cv::imshow("dbg", frame);
+        if (should_show) {
             char k = cv::waitKey(delay);
             if (k == 27)
-                break;
+                should_stop = true;
             presenter.handleKey(k);
         }
-
-        if (should_save_det_log && (frame_idx % 100 == 0)) {
-            DetectionLog log = tracker->GetDetectionLog(true);
-            SaveDetectionLogToTrajFile(detlog_out, log);
-        }
     }
 
-    if (should_keep_tracking_info) {
-        DetectionLog log = tracker->GetDetectionLog(true);
+    for (auto &source : sources) {
+        if (should_stream_tracking_info) {
+            source.tracker->SpillTracks();
+            if (source.detlog_writer) {
+                source.detlog_writer->Close();
+            }
+        } else if (should_keep_tracking_info) {
+            DetectionLog log = source.tracker->GetDetectionLog(true);
 
-        if (should_save_det_log)
-            SaveDetectionLogToTrajFile(detlog_out, log);
-        if (should_print_out)
-            PrintDetectionLog(log);
+            if (should_save_det_log)
+                SaveDetectionLogToTrajFile(source.detlog_out, log);
+            if (should_print_out)
+                PrintDetectionLog(log);
+        }
     }
     if (should_use_perf_counter) {
         pedestrian_detector.PrintPerformanceCounts(getFullDeviceName(ie, FLAGS_d_det));
-        tracker->PrintReidPerformanceCounts(getFullDeviceName(ie, FLAGS_d_reid));
+        sources[0].tracker->PrintReidPerformanceCounts(getFullDeviceName(ie, FLAGS_d_reid));
     }
 
+    slog::stopAsyncLogging();
     std::cout << presenter.reportMeans() << '\n';
     return 0;
 }
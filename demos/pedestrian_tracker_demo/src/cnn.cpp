@@ -4,6 +4,7 @@
 
 #include "cnn.hpp"
 
+#include <map>
 #include <string>
 #include <vector>
 #include <algorithm>
@@ -14,6 +15,8 @@
 #include <opencv2/imgproc/imgproc.hpp>
 
 #include <inference_engine.hpp>
+#include <samples/mapped_weights.hpp>
+#include <samples/network_cache.hpp>
 
 using namespace InferenceEngine;
 
@@ -23,7 +26,7 @@ CnnBase::CnnBase(const Config& config,
     config_(config), ie_(ie), deviceName_(deviceName) {}
 
 void CnnBase::Load() {
-    auto cnnNetwork = ie_.ReadNetwork(config_.path_to_model);
+    auto cnnNetwork = readNetworkMapped(ie_, config_.path_to_model);
 
     const int currentBatchSize = cnnNetwork.getBatchSize();
     if (currentBatchSize != config_.max_batch_size)
@@ -35,45 +38,75 @@ void CnnBase::Load() {
         THROW_IE_EXCEPTION << "Network should have only one input";
     }
 
-    SizeVector inputDims = in.begin()->second->getTensorDesc().getDims();
     in.begin()->second->setPrecision(Precision::U8);
-    input_blob_ = make_shared_blob<uint8_t>(TensorDesc(Precision::U8, inputDims, Layout::NCHW));
-    input_blob_->allocate();
-    BlobMap inputs;
-    inputs[in.begin()->first] = input_blob_;
+    in.begin()->second->setLayout(Layout::NCHW);
+    input_blob_name_ = in.begin()->first;
     outInfo_ = cnnNetwork.getOutputsInfo();
 
     for (auto&& item : outInfo_) {
-        SizeVector outputDims = item.second->getTensorDesc().getDims();
-        auto outputLayout = item.second->getTensorDesc().getLayout();
         item.second->setPrecision(Precision::FP32);
-        TBlob<float>::Ptr output =
-            make_shared_blob<float>(TensorDesc(Precision::FP32, outputDims, outputLayout));
-        output->allocate();
-        outputs_[item.first] = output;
+        output_blobs_names_.push_back(item.first);
     }
 
-    executable_network_ = ie_.LoadNetwork(cnnNetwork, deviceName_);
+    std::map<std::string, std::string> loadConfig;
+    dynamic_batch_ = config_.max_batch_size > 1 &&
+                     (deviceName_.find("CPU") != std::string::npos || deviceName_.find("GPU") != std::string::npos);
+    if (dynamic_batch_) {
+        loadConfig[PluginConfigParams::KEY_DYN_BATCH_ENABLED] = PluginConfigParams::YES;
+    }
+
+    executable_network_ = loadNetworkCached(ie_, cnnNetwork, config_.path_to_model, deviceName_, loadConfig,
+                                            config_.cache_dir);
     infer_request_ = executable_network_.CreateInferRequest();
-    infer_request_.SetInput(inputs);
-    infer_request_.SetOutput(outputs_);
 }
 
 void CnnBase::InferBatch(
     const std::vector<cv::Mat>& frames,
     const std::function<void(const InferenceEngine::BlobMap&, size_t)>& fetch_results) const {
-    const size_t batch_size = input_blob_->getTensorDesc().getDims()[0];
+    const size_t batch_size = infer_request_.GetBlob(input_blob_name_)->getTensorDesc().getDims()[0];
+    const size_t num_imgs = frames.size();
+    const size_t num_batches = (num_imgs + batch_size - 1) / batch_size;
+    const size_t num_requests = std::min(num_batches, static_cast<size_t>(std::max(1, config_.max_infer_requests)));
+    while (extra_requests_.size() + 1 < num_requests) {
+        extra_requests_.push_back(executable_network_.CreateInferRequestPtr());
+    }
 
-    size_t num_imgs = frames.size();
-    for (size_t batch_i = 0; batch_i < num_imgs; batch_i += batch_size) {
-        const size_t current_batch_size = std::min(batch_size, num_imgs - batch_i);
-        for (size_t b = 0; b < current_batch_size; b++) {
-            matU8ToBlob<uint8_t>(frames[batch_i + b], input_blob_, b);
+    auto request = [this, num_requests](size_t batch) -> InferRequest& {
+        const size_t request_i = batch % num_requests;
+        return request_i == 0 ? infer_request_ : *extra_requests_[request_i - 1];
+    };
+    auto current_batch_size = [batch_size, num_imgs](size_t batch) {
+        return std::min(batch_size, num_imgs - batch * batch_size);
+    };
+    auto fetch = [&](size_t batch) {
+        InferRequest& batch_request = request(batch);
+        batch_request.Wait(IInferRequest::WaitMode::RESULT_READY);
+        BlobMap outputs;
+        for (const auto& name : output_blobs_names_) {
+            outputs[name] = batch_request.GetBlob(name);
         }
+        fetch_results(outputs, current_batch_size(batch));
+    };
 
-        infer_request_.Infer();
+    // The batches are inferred by num_requests requests at once, a request
+    // gives its results away before it takes the next batch
+    for (size_t batch = 0; batch < num_batches; batch++) {
+        if (batch >= num_requests) {
+            fetch(batch - num_requests);
+        }
+        InferRequest& batch_request = request(batch);
+        Blob::Ptr input = batch_request.GetBlob(input_blob_name_);
+        for (size_t b = 0; b < current_batch_size(batch); b++) {
+            matU8ToBlob<uint8_t>(frames[batch * batch_size + b], input, b);
+        }
 
-        fetch_results(outputs_, current_batch_size);
+        if (dynamic_batch_) {
+            batch_request.SetBatch(current_batch_size(batch));
+        }
+        batch_request.StartAsync();
+    }
+    for (size_t batch = num_batches - num_requests; batch < num_batches; batch++) {
+        fetch(batch);
     }
 }
 
@@ -93,7 +126,7 @@ VectorCNN::VectorCNN(const Config& config,
     : CnnBase(config, ie, deviceName) {
     Load();
 
-    if (outputs_.size() != 1) {
+    if (output_blobs_names_.size() != 1) {
         THROW_IE_EXCEPTION << "Demo supports topologies only with 1 output";
     }
 
@@ -138,3 +171,15 @@ void VectorCNN::Compute(const std::vector<cv::Mat>& images, std::vector<cv::Mat>
     };
     InferBatch(images, results_fetcher);
 }
+
+void VectorCNN::Compute(const cv::Mat& frame, const std::vector<cv::Rect>& rois,
+                        std::vector<cv::Mat>* vectors, cv::Size outp_shape) const {
+    // The regions are views of the frame, matU8ToBlob() resizes them straight
+    // into the input blob
+    std::vector<cv::Mat> images;
+    images.reserve(rois.size());
+    for (const auto& roi : rois) {
+        images.push_back(frame(roi));
+    }
+    Compute(images, vectors, outp_shape);
+}
@@ -3,6 +3,7 @@
 //
 
 #include "detector.hpp"
+#include "logging.hpp"
 
 #include <algorithm>
 #include <string>
@@ -11,11 +12,12 @@
 #include <inference_engine.hpp>
 
 #include <ngraph/ngraph.hpp>
+#include <samples/detection_output.hpp>
+#include <samples/mapped_weights.hpp>
+#include <samples/network_cache.hpp>
 
 using namespace InferenceEngine;
 
-#define SSD_EMPTY_DETECTIONS_INDICATOR -1.0
-
 namespace {
 cv::Rect TruncateToValidRect(const cv::Rect& rect,
                              const cv::Size& size) {
@@ -46,61 +48,78 @@ cv::Rect IncreaseRect(const cv::Rect& r, float coeff_x,
 }
 }  // namespace
 
-void ObjectDetector::submitRequest() {
-    if (request == nullptr) return;
-    if (!enqueued_frames_) return;
-    enqueued_frames_ = 0;
-    results_fetched_ = false;
-    results_.clear();
-
+void ObjectDetector::submitRequest(Request &request) {
     if (config_.is_async) {
-        request->StartAsync();
+        request.request->StartAsync();
     } else {
-        request->Infer();
+        request.request->Infer();
     }
 }
 
-const TrackedObjects& ObjectDetector::getResults() const {
-    return results_;
+const TrackedObjects& ObjectDetector::getResults(size_t batch_idx) const {
+    PT_CHECK_LT(batch_idx, results_.size());
+    return results_[batch_idx];
 }
 
-void ObjectDetector::enqueue(const cv::Mat &frame) {
-    if (!request) {
-        request = net_.CreateInferRequestPtr();
+void ObjectDetector::enqueue(Request &request, const cv::Mat &frame, int batch_idx) {
+    if (!request.request) {
+        request.request = net_.CreateInferRequestPtr();
     }
 
-    width_ = static_cast<float>(frame.cols);
-    height_ = static_cast<float>(frame.rows);
+    request.frame_sizes.resize(batch_idx + 1);
+    request.frame_sizes[batch_idx] = frame.size();
+    const float width = static_cast<float>(frame.cols);
+    const float height = static_cast<float>(frame.rows);
 
-    Blob::Ptr inputBlob = request->GetBlob(input_name_);
+    Blob::Ptr inputBlob = request.request->GetBlob(input_name_);
 
-    matU8ToBlob<uint8_t>(frame, inputBlob);
+    matU8ToBlob<uint8_t>(frame, inputBlob, batch_idx);
 
     if (!im_info_name_.empty()) {
-        float* buffer = request->GetBlob(im_info_name_)->buffer().as<float*>();
+        float* buffer = request.request->GetBlob(im_info_name_)->buffer().as<float*>() + 6 * batch_idx;
         buffer[0] = static_cast<float>(inputBlob->getTensorDesc().getDims()[2]);
         buffer[1] = static_cast<float>(inputBlob->getTensorDesc().getDims()[3]);
-        buffer[2] = buffer[4] = static_cast<float>(inputBlob->getTensorDesc().getDims()[3]) / width_;
-        buffer[3] = buffer[5] = static_cast<float>(inputBlob->getTensorDesc().getDims()[2]) / height_;
+        buffer[2] = buffer[4] = static_cast<float>(inputBlob->getTensorDesc().getDims()[3]) / width;
+        buffer[3] = buffer[5] = static_cast<float>(inputBlob->getTensorDesc().getDims()[2]) / height;
     }
 
-    enqueued_frames_ = 1;
+    request.frames = batch_idx + 1;
 }
 
 void ObjectDetector::submitFrame(const cv::Mat &frame, int frame_idx) {
-    frame_idx_ = frame_idx;
-    enqueue(frame);
-    submitRequest();
+    submitFrames({frame}, frame_idx);
+}
+
+void ObjectDetector::submitFrames(const std::vector<cv::Mat> &frames, int frame_idx) {
+    PT_CHECK_LE(frames.size(), static_cast<size_t>(std::max(1, config_.max_batch_size)));
+    PT_CHECK(canSubmit());
+    if (frames.empty()) return;
+    Request &request = requests_[next_submitted_];
+    request.frame_idx = frame_idx;
+    for (size_t i = 0; i < frames.size(); i++) {
+        enqueue(request, frames[i], static_cast<int>(i));
+    }
+    submitRequest(request);
+    next_submitted_ = (next_submitted_ + 1) % requests_.size();
+    submitted_count_++;
+}
+
+bool ObjectDetector::canSubmit() const {
+    return submitted_count_ < requests_.size();
 }
 
 ObjectDetector::ObjectDetector(
     const DetectorConfig& config,
     const InferenceEngine::Core & ie,
     const std::string & deviceName) :
+    requests_(config.is_async ? static_cast<size_t>(std::max(1, config.num_requests)) : 1),
     config_(config),
     ie_(ie),
     deviceName_(deviceName) {
-    auto cnnNetwork = ie_.ReadNetwork(config.path_to_model);
+    auto cnnNetwork = readNetworkMapped(ie_, config.path_to_model);
+    if (config_.max_batch_size > 1) {
+        cnnNetwork.setBatchSize(config_.max_batch_size);
+    }
 
     InputsDataMap inputInfo(cnnNetwork.getInputsInfo());
     if (1 == inputInfo.size() || 2 == inputInfo.size()) {
@@ -110,7 +129,8 @@ ObjectDetector::ObjectDetector(
                 inputInfo->setPrecision(Precision::U8);
                 inputInfo->getInputData()->setLayout(Layout::NCHW);
                 input_name_ = input.first;
-            } else if (SizeVector{1, 6} == inputInfo->getTensorDesc().getDims()) {
+            } else if (2 == inputInfo->getTensorDesc().getDims().size() &&
+                       6 == inputInfo->getTensorDesc().getDims()[1]) {
                 inputInfo->setPrecision(Precision::FP32);
                 im_info_name_ = input.first;
             } else {
@@ -147,37 +167,24 @@ ObjectDetector::ObjectDetector(
     _output->setPrecision(Precision::FP32);
     _output->setLayout(TensorDesc::getLayoutByDims(_output->getDims()));
 
-    net_ = ie_.LoadNetwork(cnnNetwork, deviceName_);
+    net_ = loadNetworkCached(ie_, cnnNetwork, config_.path_to_model, deviceName_, {}, config_.cache_dir);
 }
 
-void ObjectDetector::wait() {
-    if (!request || !config_.is_async) return;
-    request->Wait(InferenceEngine::IInferRequest::WaitMode::RESULT_READY);
-}
-
-void ObjectDetector::fetchResults() {
-    results_.clear();
-    if (results_fetched_) return;
-    results_fetched_ = true;
-    const float *data = request->GetBlob(output_name_)->buffer().as<float *>();
+void ObjectDetector::fetchResults(Request &request) {
+    results_.assign(request.frames, TrackedObjects());
+    const float *data = request.request->GetBlob(output_name_)->buffer().as<float *>();
 
-    for (int det_id = 0; det_id < max_detections_count_; ++det_id) {
-        const int start_pos = det_id * object_size_;
-
-        const float batchID = data[start_pos];
-        if (batchID == SSD_EMPTY_DETECTIONS_INDICATOR) {
-            break;
-        }
+    // the batch slots without submitted frames are skipped
+    detection_output::parse(data, static_cast<size_t>(max_detections_count_), config_.confidence_threshold,
+                            results_.size(), [&](size_t batch_idx, const detection_output::Row& row) {
+        const float width = static_cast<float>(request.frame_sizes[batch_idx].width);
+        const float height = static_cast<float>(request.frame_sizes[batch_idx].height);
 
-        const float score = std::min(std::max(0.0f, data[start_pos + 2]), 1.0f);
-        const float x0 =
-            std::min(std::max(0.0f, data[start_pos + 3]), 1.0f) * width_;
-        const float y0 =
-            std::min(std::max(0.0f, data[start_pos + 4]), 1.0f) * height_;
-        const float x1 =
-            std::min(std::max(0.0f, data[start_pos + 5]), 1.0f) * width_;
-        const float y1 =
-            std::min(std::max(0.0f, data[start_pos + 6]), 1.0f) * height_;
+        const float score = detection_output::clamp(row.confidence);
+        const float x0 = detection_output::clamp(row.xmin) * width;
+        const float y0 = detection_output::clamp(row.ymin) * height;
+        const float x1 = detection_output::clamp(row.xmax) * width;
+        const float y1 = detection_output::clamp(row.ymax) * height;
 
         TrackedObject object;
         object.confidence = score;
@@ -189,21 +196,26 @@ void ObjectDetector::fetchResults() {
         object.rect = TruncateToValidRect(IncreaseRect(object.rect,
                                                        config_.increase_scale_x,
                                                        config_.increase_scale_y),
-                                          cv::Size(static_cast<int>(width_), static_cast<int>(height_)));
-        object.frame_idx = frame_idx_;
+                                          cv::Size(static_cast<int>(width), static_cast<int>(height)));
+        object.frame_idx = request.frame_idx;
 
         if (object.confidence > config_.confidence_threshold && object.rect.area() > 0) {
-            results_.emplace_back(object);
+            results_[batch_idx].emplace_back(object);
         }
-    }
+    });
 }
 
 void ObjectDetector::waitAndFetchResults() {
-    wait();
-    fetchResults();
+    if (0 == submitted_count_) return;
+    Request &request = requests_[(next_submitted_ + requests_.size() - submitted_count_) % requests_.size()];
+    if (config_.is_async) {
+        request.request->Wait(InferenceEngine::IInferRequest::WaitMode::RESULT_READY);
+    }
+    fetchResults(request);
+    submitted_count_--;
 }
 
 void ObjectDetector::PrintPerformanceCounts(std::string fullDeviceName) {
     std::cout << "Performance counts for object detector" << std::endl << std::endl;
-    ::printPerformanceCounts(*request, std::cout, fullDeviceName, false);
+    ::printPerformanceCounts(*requests_.front().request, std::cout, fullDeviceName, false);
 }
@@ -5,8 +5,13 @@
 #include "distance.hpp"
 #include "logging.hpp"
 
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
 #include <vector>
 
+#include <samples/embeddings.hpp>
+
 CosDistance::CosDistance(const cv::Size &descriptor_size)
     : descriptor_size_(descriptor_size) {
     PT_CHECK(descriptor_size.area() != 0);
@@ -30,9 +35,16 @@ std::vector<float> CosDistance::Compute(const std::vector<cv::Mat> &descrs1,
     PT_CHECK(descrs1.size() != 0);
     PT_CHECK(descrs1.size() == descrs2.size());
 
-    std::vector<float> distances(descrs1.size(), 1.f);
     for (size_t i = 0; i < descrs1.size(); i++) {
-        distances.at(i) = Compute(descrs1.at(i), descrs2.at(i));
+        PT_CHECK(descrs1[i].size() == descriptor_size_);
+        PT_CHECK(descrs2[i].size() == descriptor_size_);
+    }
+
+    // each descriptor is normalized once, then a distance is a single dot product
+    std::vector<float> distances = NormalizedEmbeddings::rowSimilarities(
+        NormalizedEmbeddings(descrs1), NormalizedEmbeddings(descrs2));
+    for (float &distance : distances) {
+        distance = 0.5f * (1.0f - distance);
     }
 
     return distances;
@@ -59,3 +71,53 @@ std::vector<float> MatchTemplateDistance::Compute(const std::vector<cv::Mat> &de
     }
     return result;
 }
+
+cv::Mat MatchTemplateDistance::Prepare(const cv::Mat &descr) {
+    PT_CHECK(!descr.empty());
+    cv::Mat values;
+    descr.convertTo(values, CV_32F);
+    if (type_ == cv::TM_CCOEFF || type_ == cv::TM_CCOEFF_NORMED) {
+        values -= cv::mean(values);
+    }
+    values = values.reshape(1, 1);
+
+    cv::Mat prepared(1, values.cols + 1, CV_32F);
+    values.copyTo(prepared.colRange(0, values.cols));
+    prepared.at<float>(0, values.cols) = static_cast<float>(values.dot(values));
+    return prepared;
+}
+
+std::vector<float> MatchTemplateDistance::ComputePrepared(const cv::Mat &prepared,
+                                                          const std::vector<cv::Mat> &others) {
+    PT_CHECK(!prepared.empty());
+    const int size = prepared.cols - 1;
+    const cv::Mat values = prepared.colRange(0, size);
+    const double xx = prepared.at<float>(0, size);
+
+    std::vector<float> distances;
+    distances.reserve(others.size());
+    for (const auto &other : others) {
+        PT_CHECK_EQ(other.cols, prepared.cols);
+        const double yy = other.at<float>(0, size);
+        double xy = values.dot(other.colRange(0, size));
+        double res = type_ == cv::TM_SQDIFF || type_ == cv::TM_SQDIFF_NORMED
+                     ? std::max(xx + yy - 2 * xy, 0.0) : xy;
+        if (type_ == cv::TM_CCORR_NORMED || type_ == cv::TM_CCOEFF_NORMED ||
+            type_ == cv::TM_SQDIFF_NORMED) {
+            // Follows the normalization of cv::matchTemplate, the prepared
+            // descriptor is the template.
+            double norm = std::sqrt(xx * yy);
+            if (type_ == cv::TM_CCOEFF_NORMED && xx < DBL_EPSILON) {
+                res = 1;
+            } else if (std::abs(res) < norm) {
+                res /= norm;
+            } else if (std::abs(res) < norm * 1.125) {
+                res = res > 0 ? 1 : -1;
+            } else {
+                res = type_ != cv::TM_SQDIFF_NORMED ? 0 : 1;
+            }
+        }
+        distances.push_back(scale_ * static_cast<float>(res) + offset_);
+    }
+    return distances;
+}
@@ -11,13 +11,25 @@
 #include <utility>
 #include <limits>
 #include <algorithm>
+#include <chrono>
+#include <cmath>
 
 #include "core.hpp"
 #include "tracker.hpp"
 #include "utils.hpp"
-#include "kuhn_munkres.hpp"
+
+#include <samples/assignment.hpp>
+#include <samples/instrumentation.hpp>
 
 namespace {
+// Milliseconds since *start, which is moved to now to time the next stage.
+double ElapsedMs(std::chrono::steady_clock::time_point *start) {
+    auto now = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::milli> elapsed = now - *start;
+    *start = now;
+    return elapsed.count();
+}
+
 cv::Point Center(const cv::Rect& rect) {
     return cv::Point(static_cast<int>(rect.x + rect.width * 0.5),
                      static_cast<int>(rect.y + rect.height * 0.5));
@@ -90,7 +102,8 @@ TrackerParams::TrackerParams()
     strong_affinity_thr(0.2805f),
     reid_thr(0.61f),
     drop_forgotten_tracks(true),
-    max_num_objects_in_track(300) {}
+    max_num_objects_in_track(300),
+    eager_reid_descriptors(false) {}
 
 void ValidateParams(const TrackerParams &p) {
     PT_CHECK_GE(p.min_track_duration, static_cast<size_t>(500));
@@ -145,6 +158,7 @@ PedestrianTracker::PedestrianTracker(const TrackerParams &params)
     : params_(params),
     descriptor_strong_(nullptr),
     distance_strong_(nullptr),
+    spilled_tracks_counter_(0),
     tracks_counter_(0),
     frame_size_(0, 0),
     prev_timestamp_(std::numeric_limits<uint64_t>::max()) {
@@ -178,7 +192,12 @@ void PedestrianTracker::set_descriptor_strong(const Descriptor &val) {
 const PedestrianTracker::Distance &PedestrianTracker::distance_fast() const { return distance_fast_; }
 
 // Distance fast setter.
-void PedestrianTracker::set_distance_fast(const Distance &val) { distance_fast_ = val; }
+void PedestrianTracker::set_distance_fast(const Distance &val) {
+    distance_fast_ = val;
+    for (auto &track : tracks_) {
+        track.second.descriptor_fast_prepared = distance_fast_->Prepare(track.second.descriptor_fast);
+    }
+}
 
 // Distance strong getter.
 const PedestrianTracker::Distance &PedestrianTracker::distance_strong() const { return distance_strong_; }
@@ -233,19 +252,40 @@ void PedestrianTracker::SolveAssignmentProblem(
     PT_CHECK(matches);
     matches->clear();
 
+    auto stage_start = std::chrono::steady_clock::now();
     cv::Mat dissimilarity;
     ComputeDissimilarityMatrix(track_ids, detections, descriptors,
                                &dissimilarity);
+    timings_.affinity += ElapsedMs(&stage_start);
 
-    auto res = KuhnMunkres().Solve(dissimilarity);
+    // The duals of the tracks from the previous frame warm start the solver.
+    std::vector<float> track_duals;
+    track_duals.reserve(track_ids.size());
+    for (auto id : track_ids) {
+        auto dual = assignment_duals_.find(id);
+        track_duals.push_back(dual != assignment_duals_.end()
+                              ? dual->second : std::numeric_limits<float>::quiet_NaN());
+    }
+    AssignmentSolver solver;
+    auto res = solver.solve(dissimilarity, track_duals);
+    timings_.assignment += ElapsedMs(&stage_start);
+    assignment_duals_.clear();
+    size_t row = 0;
+    for (auto id : track_ids) {
+        assignment_duals_[id] = solver.getRowDuals()[row++];
+    }
 
     for (size_t i = 0; i < detections.size(); i++) {
         unmatched_detections->insert(i);
     }
 
+    // The solve is dense, so the matches are those of KuhnMunkres. The pairs
+    // below strong_affinity_thr would be rejected later, they are left
+    // unmatched here, so no strong descriptors are computed for them.
+    const float max_dissimilarity = MaxDissimilarity();
     size_t i = 0;
     for (auto id : track_ids) {
-        if (res[i] < detections.size()) {
+        if (res[i] < detections.size() && dissimilarity.at<float>(i, res[i]) <= max_dissimilarity) {
             matches->emplace(id, res[i], 1 - dissimilarity.at<float>(i, res[i]));
         } else {
             unmatched_tracks->insert(id);
@@ -266,7 +306,7 @@ const ObjectTracks PedestrianTracker::all_tracks(bool valid_only) const {
     for (size_t id : sorted_ids) {
         if (!valid_only || IsTrackValid(id)) {
             TrackedObjects filtered_objects;
-            for (const auto &object : tracks().at(id).objects) {
+            for (const auto &object : tracks().at(id).objects.to_objects()) {
                 filtered_objects.emplace_back(object);
                 filtered_objects.back().object_id = counter;
             }
@@ -374,6 +414,7 @@ void PedestrianTracker::UpdateLostTracks(
 void PedestrianTracker::Process(const cv::Mat &frame,
                                 const TrackedObjects &input_detections,
                                 uint64_t timestamp) {
+    DEMO_TASK("track");
     if (prev_timestamp_ != std::numeric_limits<uint64_t>::max())
         PT_CHECK_LT(prev_timestamp_, timestamp);
 
@@ -383,13 +424,18 @@ void PedestrianTracker::Process(const cv::Mat &frame,
         PT_CHECK_EQ(frame_size_, frame.size());
     }
 
+    timings_ = TrackerTimings();
+    auto process_start = std::chrono::steady_clock::now();
+
     TrackedObjects detections = FilterDetections(input_detections);
     for (auto &obj : detections) {
         obj.timestamp = timestamp;
     }
 
+    auto stage_start = std::chrono::steady_clock::now();
     std::vector<cv::Mat> descriptors_fast;
     ComputeFastDesciptors(frame, detections, &descriptors_fast);
+    timings_.affinity += ElapsedMs(&stage_start);
 
     auto active_tracks = active_track_ids_;
 
@@ -404,10 +450,12 @@ void PedestrianTracker::Process(const cv::Mat &frame,
         std::map<size_t, std::pair<bool, cv::Mat>> is_matching_to_track;
 
         if (distance_strong_) {
+            stage_start = std::chrono::steady_clock::now();
             std::vector<std::pair<size_t, size_t>> reid_track_and_det_ids =
                 GetTrackToDetectionIds(matches);
             is_matching_to_track = StrongMatching(
                 frame, detections, reid_track_and_det_ids);
+            timings_.reid += ElapsedMs(&stage_start);
         }
 
         for (const auto &match : matches) {
@@ -455,11 +503,18 @@ void PedestrianTracker::Process(const cv::Mat &frame,
         UpdateLostTracks(active_tracks);
     }
 
+    if (!tracks_without_strong_.empty()) {
+        stage_start = std::chrono::steady_clock::now();
+        ComputeEagerStrongDescriptors(frame);
+        timings_.reid += ElapsedMs(&stage_start);
+    }
+
     prev_frame_size_ = frame.size();
-    if (params_.drop_forgotten_tracks) DropForgottenTracks();
+    if (params_.drop_forgotten_tracks || track_spill_) DropForgottenTracks();
 
     tracks_dists_.clear();
     prev_timestamp_ = timestamp;
+    timings_.total = ElapsedMs(&process_start);
 }
 
 void PedestrianTracker::DropForgottenTracks() {
@@ -475,11 +530,16 @@ void PedestrianTracker::DropForgottenTracks() {
     bool reassign_id = max_id > kMaxTrackID;
 
     size_t counter = 0;
-    for (const auto &pair : tracks_) {
+    for (auto &pair : tracks_) {
+        if (track_spill_ && IsTrackForgotten(pair.first) && IsTrackValid(pair.first)) {
+            SpillObjects(&pair.second, pair.second.objects.to_objects());
+        }
         if (!IsTrackForgotten(pair.first)) {
             new_tracks.emplace(reassign_id ? counter : pair.first, pair.second);
             new_active_tracks.emplace(reassign_id ? counter : pair.first);
             counter++;
+        } else {
+            RecycleDescriptors(&pair.second);
         }
     }
     tracks_.swap(new_tracks);
@@ -497,11 +557,29 @@ float PedestrianTracker::ShapeAffinity(float weight, const cv::Rect &trk,
 
 float PedestrianTracker::MotionAffinity(float weight, const cv::Rect &trk,
                                         const cv::Rect &det) {
+    return static_cast<float>(exp(static_cast<double>(-weight * MotionDistance(trk, det))));
+}
+
+float PedestrianTracker::MotionDistance(const cv::Rect &trk, const cv::Rect &det) {
     float x_dist = static_cast<float>(trk.x - det.x) * (trk.x - det.x) /
         (det.width * det.width);
     float y_dist = static_cast<float>(trk.y - det.y) * (trk.y - det.y) /
         (det.height * det.height);
-    return static_cast<float>(exp(static_cast<double>(-weight * (x_dist + y_dist))));
+    return x_dist + y_dist;
+}
+
+float PedestrianTracker::MaxMotionDistance() const {
+    // A match needs the affinity above strong_affinity_thr and the other
+    // factors of the affinity are at most 1, so the motion affinity is too.
+    if (params_.motion_affinity_w <= 0.0f || params_.strong_affinity_thr <= 0.0f) {
+        return std::numeric_limits<float>::infinity();
+    }
+    return -std::log(params_.strong_affinity_thr) / params_.motion_affinity_w;
+}
+
+float PedestrianTracker::MaxDissimilarity() const {
+    return params_.strong_affinity_thr > 0.0f
+           ? 1.0f - params_.strong_affinity_thr : std::numeric_limits<float>::infinity();
 }
 
 float PedestrianTracker::TimeAffinity(float weight, const float &trk_time,
@@ -512,11 +590,13 @@ float PedestrianTracker::TimeAffinity(float weight, const float &trk_time,
 void PedestrianTracker::ComputeFastDesciptors(
     const cv::Mat &frame, const TrackedObjects &detections,
     std::vector<cv::Mat> *desriptors) {
-    *desriptors = std::vector<cv::Mat>(detections.size(), cv::Mat());
-    for (size_t i = 0; i < detections.size(); i++) {
-        descriptor_fast_->Compute(frame(detections[i].rect).clone(),
-                                  &((*desriptors)[i]));
+    std::vector<cv::Rect> rois;
+    rois.reserve(detections.size());
+    for (const auto &detection : detections) {
+        rois.push_back(detection.rect);
     }
+    desriptors->clear();
+    descriptor_fast_->Compute(frame, rois, desriptors);
 }
 
 void PedestrianTracker::ComputeDissimilarityMatrix(
@@ -524,16 +604,59 @@ void PedestrianTracker::ComputeDissimilarityMatrix(
     const std::vector<cv::Mat> &descriptors_fast,
     cv::Mat *dissimilarity_matrix) {
     cv::Mat am(active_tracks.size(), detections.size(), CV_32F, cv::Scalar(0));
-    size_t i = 0;
+
+    // Only the detections whose x is within the motion distance from the
+    // predicted rect are scored. The distance is normalized by the detection
+    // size, so the widest detection bounds the x range.
+    const float max_motion_dist = MaxMotionDistance();
+    std::vector<size_t> dets_by_x(detections.size());
+    int max_width = 0;
+    for (size_t j = 0; j < detections.size(); j++) {
+        dets_by_x[j] = j;
+        max_width = std::max(max_width, detections[j].rect.width);
+    }
+    std::sort(dets_by_x.begin(), dets_by_x.end(), [&](size_t a, size_t b) {
+        return detections[a].rect.x < detections[b].rect.x;
+    });
+    const float x_radius = std::sqrt(max_motion_dist) * max_width;
+
+    // The tracks with a nonzero geometric affinity to each detection, then the
+    // appearance of a detection is compared with all its tracks at once.
+    std::vector<std::vector<std::pair<size_t, float>>> det_candidates(detections.size());
+    std::vector<const Track *> rows;
+    rows.reserve(active_tracks.size());
     for (auto id : active_tracks) {
-        auto ptr = am.ptr<float>(i);
-        for (size_t j = 0; j < descriptors_fast.size(); j++) {
-            auto last_det = tracks_.at(id).objects.back();
-            last_det.rect = tracks_.at(id).predicted_rect;
-            ptr[j] = AffinityFast(tracks_.at(id).descriptor_fast, last_det,
-                                  descriptors_fast[j], detections[j]);
+        const auto &track = tracks_.at(id);
+        auto last_det = track.objects.back();
+        last_det.rect = track.predicted_rect;
+        auto det_it = std::lower_bound(dets_by_x.begin(), dets_by_x.end(), last_det.rect.x - x_radius,
+                                       [&](size_t j, float x) { return detections[j].rect.x < x; });
+        for (; det_it != dets_by_x.end() && detections[*det_it].rect.x <= last_det.rect.x + x_radius; ++det_it) {
+            size_t j = *det_it;
+            if (MotionDistance(last_det.rect, detections[j].rect) <= max_motion_dist) {
+                float aff = AffinityFast(last_det, detections[j]);
+                if (aff > 0.0f) {
+                    det_candidates[j].emplace_back(rows.size(), aff);
+                }
+            }
+        }
+        rows.push_back(&track);
+    }
+
+    std::vector<cv::Mat> track_descriptors;
+    for (size_t j = 0; j < detections.size(); j++) {
+        const auto &candidates = det_candidates[j];
+        if (candidates.empty()) continue;
+        track_descriptors.clear();
+        for (const auto &candidate : candidates) {
+            track_descriptors.push_back(rows[candidate.first]->descriptor_fast_prepared);
+        }
+        auto app_dists = distance_fast_->ComputePrepared(
+            distance_fast_->Prepare(descriptors_fast[j]), track_descriptors);
+        for (size_t k = 0; k < candidates.size(); k++) {
+            am.at<float>(static_cast<int>(candidates[k].first), static_cast<int>(j)) =
+                candidates[k].second * (1.0f - app_dists[k]);
         }
-        i++;
     }
     *dissimilarity_matrix = 1.0 - am;
 }
@@ -667,10 +790,19 @@ void PedestrianTracker::AddNewTrack(const cv::Mat &frame,
                                     const cv::Mat &descriptor_strong) {
     auto detection_with_id = detection;
     detection_with_id.object_id = tracks_counter_;
-    tracks_.emplace(std::pair<size_t, Track>(
+    const bool needs_strong = distance_strong_ && descriptor_strong.empty();
+    auto track = tracks_.emplace(std::pair<size_t, Track>(
             tracks_counter_,
-            Track({detection_with_id}, frame(detection.rect).clone(),
-                  descriptor_fast.clone(), descriptor_strong.clone())));
+            Track({detection_with_id},
+                  needs_strong && !params_.eager_reid_descriptors ? frame(detection.rect).clone() : cv::Mat(),
+                  PooledCopy(descriptor_fast),
+                  descriptor_strong.empty() ? cv::Mat() : PooledCopy(descriptor_strong),
+                  params_.max_num_objects_in_track > 0
+                  ? static_cast<size_t>(params_.max_num_objects_in_track) : 0))).first;
+    track->second.descriptor_fast_prepared = distance_fast_->Prepare(track->second.descriptor_fast);
+    if (needs_strong && params_.eager_reid_descriptors) {
+        tracks_without_strong_.push_back(tracks_counter_);
+    }
 
     for (size_t id : active_track_ids_) {
         tracks_dists_.emplace(std::pair<size_t, size_t>(id, tracks_counter_),
@@ -692,32 +824,88 @@ void PedestrianTracker::AppendToTrack(const cv::Mat &frame,
     detection_with_id.object_id = track_id;
 
     auto &cur_track = tracks_.at(track_id);
-    cur_track.objects.emplace_back(detection_with_id);
+    TrackedObject evicted;
+    if (cur_track.objects.push_back(detection_with_id, &evicted) &&
+        track_spill_ && IsTrackValid(track_id)) {
+        SpillObjects(&cur_track, {evicted});
+    }
     cur_track.predicted_rect = detection.rect;
     cur_track.lost = 0;
-    cur_track.last_image = frame(detection.rect).clone();
-    cur_track.descriptor_fast = descriptor_fast.clone();
+    // copyTo() reuses the buffers of the track, the descriptors keep their size
+    descriptor_fast.copyTo(cur_track.descriptor_fast);
+    cur_track.descriptor_fast_prepared = distance_fast_->Prepare(cur_track.descriptor_fast);
     cur_track.length++;
 
     if (cur_track.descriptor_strong.empty()) {
-        cur_track.descriptor_strong = descriptor_strong.clone();
+        descriptor_strong.copyTo(cur_track.descriptor_strong);
     } else if (!descriptor_strong.empty()) {
-        cur_track.descriptor_strong =
-            0.5 * (descriptor_strong + cur_track.descriptor_strong);
+        cv::addWeighted(descriptor_strong, 0.5, cur_track.descriptor_strong, 0.5, 0.0,
+                        cur_track.descriptor_strong);
     }
 
+    // The image is needed only to compute the missing strong descriptor.
+    if (!distance_strong_ || !cur_track.descriptor_strong.empty()) {
+        cur_track.last_image.release();
+    } else if (params_.eager_reid_descriptors) {
+        tracks_without_strong_.push_back(track_id);
+    } else {
+        frame(detection.rect).copyTo(cur_track.last_image);
+    }
+}
+
+void PedestrianTracker::ComputeEagerStrongDescriptors(const cv::Mat &frame) {
+    std::vector<size_t> track_ids;
+    std::vector<cv::Mat> images;
+    for (size_t track_id : tracks_without_strong_) {
+        auto track = tracks_.find(track_id);
+        if (track == tracks_.end() || !track->second.descriptor_strong.empty() ||
+            std::find(track_ids.begin(), track_ids.end(), track_id) != track_ids.end()) {
+            continue;
+        }
+        track_ids.push_back(track_id);
+        images.push_back(frame(track->second.objects.back().rect));
+    }
+    tracks_without_strong_.clear();
+    if (images.empty()) {
+        return;
+    }
+
+    std::vector<cv::Mat> descriptors;
+    descriptor_strong_->Compute(images, &descriptors);
+    for (size_t i = 0; i < track_ids.size(); i++) {
+        tracks_.at(track_ids[i]).descriptor_strong = PooledCopy(descriptors[i]);
+    }
+}
+
+cv::Mat PedestrianTracker::PooledCopy(const cv::Mat &descriptor) {
+    cv::Mat copy;
+    for (size_t i = 0; i < descriptor_pool_.size(); i++) {
+        if (descriptor_pool_[i].size() == descriptor.size() &&
+            descriptor_pool_[i].type() == descriptor.type()) {
+            copy = descriptor_pool_[i];
+            descriptor_pool_[i] = descriptor_pool_.back();
+            descriptor_pool_.pop_back();
+            break;
+        }
+    }
+    descriptor.copyTo(copy);
+    return copy;
+}
 
-    if (params_.max_num_objects_in_track > 0) {
-        while (cur_track.size() >
-               static_cast<size_t>(params_.max_num_objects_in_track)) {
-            cur_track.objects.erase(cur_track.objects.begin());
+void PedestrianTracker::RecycleDescriptors(Track *track) {
+    const size_t kMaxPooledDescriptors = 256;
+    for (cv::Mat *descriptor : {&track->descriptor_fast, &track->descriptor_strong}) {
+        // Only the buffers which nothing else refers to, e.g. not the fast
+        // descriptor which is also the prepared one.
+        if (descriptor_pool_.size() < kMaxPooledDescriptors && descriptor->u != nullptr &&
+            descriptor->u->refcount == 1) {
+            descriptor_pool_.push_back(*descriptor);
         }
+        descriptor->release();
     }
 }
 
-float PedestrianTracker::AffinityFast(const cv::Mat &descriptor1,
-                                      const TrackedObject &obj1,
-                                      const cv::Mat &descriptor2,
+float PedestrianTracker::AffinityFast(const TrackedObject &obj1,
                                       const TrackedObject &obj2) {
     const float eps = 1e-6f;
     float shp_aff = ShapeAffinity(params_.shape_affinity_w, obj1.rect, obj2.rect);
@@ -731,9 +919,7 @@ float PedestrianTracker::AffinityFast(const cv::Mat &descriptor1,
 
     if (time_aff < eps) return 0.0f;
 
-    float app_aff = 1.0f - distance_fast_->Compute(descriptor1, descriptor2);
-
-    return shp_aff * mot_aff * app_aff * time_aff;
+    return shp_aff * mot_aff * time_aff;
 }
 
 float PedestrianTracker::Affinity(const TrackedObject &obj1,
@@ -766,13 +952,48 @@ bool PedestrianTracker::IsTrackForgotten(const Track &track) const {
     return (track.lost > params_.forget_delay);
 }
 
+void PedestrianTracker::set_track_spill(const std::function<void(const TrackedObjects &)> &callback) {
+    track_spill_ = callback;
+}
+
+void PedestrianTracker::SpillTracks() {
+    if (track_spill_) {
+        std::set<size_t> sorted_ids;
+        for (const auto &pair : tracks_) {
+            sorted_ids.emplace(pair.first);
+        }
+        for (size_t id : sorted_ids) {
+            if (IsTrackValid(id)) {
+                auto &track = tracks_.at(id);
+                SpillObjects(&track, track.objects.to_objects());
+            }
+        }
+    }
+    tracks_.clear();
+    active_track_ids_.clear();
+    tracks_dists_.clear();
+    assignment_duals_.clear();
+}
+
+void PedestrianTracker::SpillObjects(Track *track, TrackedObjects objects) {
+    PT_CHECK(track);
+    if (objects.empty()) return;
+    if (track->log_id < 0) {
+        track->log_id = spilled_tracks_counter_++;
+    }
+    for (auto &object : objects) {
+        object.object_id = track->log_id;
+    }
+    track_spill_(objects);
+}
+
 std::unordered_map<size_t, std::vector<cv::Point>>
 PedestrianTracker::GetActiveTracks() const {
     std::unordered_map<size_t, std::vector<cv::Point>> active_tracks;
     for (size_t idx : active_track_ids()) {
         auto track = tracks().at(idx);
         if (IsTrackValid(idx) && !IsTrackForgotten(idx)) {
-            active_tracks.emplace(idx, Centers(track.objects));
+            active_tracks.emplace(idx, Centers(track.objects.to_objects()));
         }
     }
     return active_tracks;
@@ -821,3 +1042,5 @@ void PedestrianTracker::PrintReidPerformanceCounts(std::string fullDeviceName) c
         descriptor_strong_->PrintPerformanceCounts(fullDeviceName);
     }
 }
+
+const TrackerTimings &PedestrianTracker::timings() const { return timings_; }
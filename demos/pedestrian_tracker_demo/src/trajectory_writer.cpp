@@ -0,0 +1,110 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "trajectory_writer.hpp"
+#include "utils.hpp"
+
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+void AppendInt32(std::string *out, int value) {
+    uint32_t bits = static_cast<uint32_t>(value);
+    for (int byte = 0; byte < 4; byte++) {
+        out->push_back(static_cast<char>(bits >> (8 * byte)));
+    }
+}
+}  // anonymous namespace
+
+TrajectoryWriter::TrajectoryWriter(const std::string &path, Format format,
+                                   size_t max_pending_bytes)
+    : path_(path),
+    file_(path, format == Format::BINARY ? std::ios::binary : std::ios::out),
+    format_(format),
+    max_pending_bytes_(max_pending_bytes),
+    stopped_(false),
+    failed_(false) {
+    if (!file_.is_open()) {
+        throw std::runtime_error("Can't open " + path);
+    }
+    thread_ = std::thread(&TrajectoryWriter::Run, this);
+}
+
+TrajectoryWriter::~TrajectoryWriter() {
+    Stop();
+}
+
+void TrajectoryWriter::Stop() {
+    if (!thread_.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopped_ = true;
+    }
+    has_pending_.notify_one();
+    thread_.join();
+}
+
+void TrajectoryWriter::Close() {
+    Stop();
+    if (failed_) {
+        throw std::runtime_error("Can't write " + path_);
+    }
+}
+
+void TrajectoryWriter::Write(const TrackedObjects &objects) {
+    std::string records;
+    if (format_ == Format::CSV) {
+        std::ostringstream stream;
+        SaveTrackedObjectsToTrajStream(stream, objects);
+        records = stream.str();
+    } else {
+        records.reserve(objects.size() * 6 * 4);
+        for (const auto &object : objects) {
+            AppendInt32(&records, object.frame_idx);
+            AppendInt32(&records, object.object_id);
+            AppendInt32(&records, object.rect.x);
+            AppendInt32(&records, object.rect.y);
+            AppendInt32(&records, object.rect.width);
+            AppendInt32(&records, object.rect.height);
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    has_space_.wait(lock, [&] { return failed_ || pending_.size() < max_pending_bytes_; });
+    if (failed_) {
+        throw std::runtime_error("Can't write " + path_);
+    }
+    pending_ += records;
+    lock.unlock();
+    has_pending_.notify_one();
+}
+
+void TrajectoryWriter::Run() {
+    std::string writing;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        has_pending_.wait(lock, [&] { return stopped_ || !pending_.empty(); });
+        if (pending_.empty()) {
+            break;  // stopped and everything is written
+        }
+        writing.swap(pending_);
+        lock.unlock();
+        has_space_.notify_all();
+        file_.write(writing.data(), writing.size());
+        file_.flush();
+        writing.clear();
+        lock.lock();
+        if (!file_) {
+            failed_ = true;  // the rest can't be appended in order either
+            pending_.clear();
+            lock.unlock();
+            has_space_.notify_all();
+            return;
+        }
+    }
+}
@@ -7,6 +7,7 @@
 #include <opencv2/imgproc.hpp>
 
 #include <ie_plugin_config.hpp>
+#include <samples/slog.hpp>
 
 #include <algorithm>
 #include <vector>
@@ -18,6 +19,16 @@
 using namespace InferenceEngine;
 
 namespace {
+template <typename StreamType>
+void SaveObjectToStream(StreamType& stream, int frame_idx,
+                        const TrackedObject& object) {
+    stream << frame_idx << ',';
+    stream << object.object_id << ','
+        << object.rect.x << ',' << object.rect.y << ','
+        << object.rect.width << ',' << object.rect.height;
+    stream << '\n';
+}
+
 template <typename StreamType>
 void SaveDetectionLogToStream(StreamType& stream,
                               const DetectionLog& log) {
@@ -29,12 +40,7 @@ void SaveDetectionLogToStream(StreamType& stream,
                      const TrackedObject& b)
                   { return a.object_id < b.object_id; });
         for (const auto& object : objects) {
-            auto frame_idx_to_save = entry.frame_idx;
-            stream << frame_idx_to_save << ',';
-            stream << object.object_id << ','
-                << object.rect.x << ',' << object.rect.y << ','
-                << object.rect.width << ',' << object.rect.height;
-            stream << '\n';
+            SaveObjectToStream(stream, entry.frame_idx, object);
         }
     }
 }
@@ -61,7 +67,22 @@ void SaveDetectionLogToTrajFile(const std::string& path,
 }
 
 void PrintDetectionLog(const DetectionLog& log) {
-    SaveDetectionLogToStream(std::cout, log);
+    slog::AsyncLineStream out(std::cout);
+    SaveDetectionLogToStream(out, log);
+}
+
+void SaveTrackedObjectsToTrajStream(std::ostream& stream,
+                                    const TrackedObjects& objects) {
+    for (const auto& object : objects) {
+        SaveObjectToStream(stream, object.frame_idx, object);
+    }
+}
+
+void PrintTrackedObjects(const TrackedObjects& objects) {
+    slog::AsyncLineStream out(std::cout);
+    for (const auto& object : objects) {
+        SaveObjectToStream(out, object.frame_idx, object);
+    }
 }
 
 InferenceEngine::Core
@@ -6,7 +6,7 @@
 
 #include <opencv2/core/core.hpp>
 
-#include "human_pose.hpp"
+#include <pose/human_pose.hpp>
 
 namespace human_pose_estimation {
 std::vector<HumanPose> extractPoses(
@@ -7,6 +7,7 @@
 
 #include <iostream>
 #include <stdexcept>
+#include <string>
 #include <vector>
 
 #define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
@@ -16,7 +17,39 @@
 
 #include "extract_poses.hpp"
 
-static std::vector<cv::Mat> wrap_feature_maps(PyArrayObject* py_feature_maps) {
+namespace {
+const int keypoints_number = 18;
+const int pafs_number = 2 * (keypoints_number + 1);
+
+// Holds a reference to a float32 C-contiguous view of feature maps. The numpy arrays, which
+// already are such, aren't copied, the other objects are converted
+class FeatureMapsArray {
+public:
+    explicit FeatureMapsArray(PyObject* object)
+        : array(reinterpret_cast<PyArrayObject*>(PyArray_FROM_OTF(object, NPY_FLOAT32, NPY_ARRAY_IN_ARRAY))) {}
+    FeatureMapsArray(const FeatureMapsArray&) = delete;
+    FeatureMapsArray& operator=(const FeatureMapsArray&) = delete;
+    FeatureMapsArray(FeatureMapsArray&& other) noexcept : array(other.array) {
+        other.array = nullptr;
+    }
+    ~FeatureMapsArray() {
+        Py_XDECREF(array);
+    }
+
+    PyArrayObject* get() const {
+        return array;
+    }
+
+private:
+    PyArrayObject* array;
+};
+
+struct FrameFeatureMaps {
+    std::vector<cv::Mat> heatmaps;
+    std::vector<cv::Mat> pafs;
+};
+
+std::vector<cv::Mat> wrap_feature_maps(PyArrayObject* py_feature_maps) {
     int num_channels = static_cast<int>(PyArray_SHAPE(py_feature_maps)[0]);
     int h = static_cast<int>(PyArray_SHAPE(py_feature_maps)[1]);
     int w = static_cast<int>(PyArray_SHAPE(py_feature_maps)[2]);
@@ -30,39 +63,107 @@ static std::vector<cv::Mat> wrap_feature_maps(PyArrayObject* py_feature_maps) {
     return feature_maps;
 }
 
-static PyObject* extract_poses(PyObject* self, PyObject* args) {
-    PyArrayObject* py_heatmaps;
-    PyArrayObject* py_pafs;
-    int ratio;
-    if (!PyArg_ParseTuple(args, "OOi", &py_heatmaps, &py_pafs, &ratio)) {
-        return nullptr;
+// Converts the heatmaps and the pafs of a frame and wraps them without copying, the arrays
+// keep the data alive. Sets a Python error and returns false if they don't fit the network
+bool wrap_frame(PyObject* py_heatmaps, PyObject* py_pafs, std::vector<FeatureMapsArray>& arrays,
+                FrameFeatureMaps& frame) {
+    arrays.emplace_back(py_heatmaps);
+    PyArrayObject* heatmaps = arrays.back().get();
+    if (heatmaps == nullptr) {
+        return false;
+    }
+    arrays.emplace_back(py_pafs);
+    PyArrayObject* pafs = arrays.back().get();
+    if (pafs == nullptr) {
+        return false;
+    }
+    if (PyArray_NDIM(heatmaps) != 3 || PyArray_NDIM(pafs) != 3) {
+        PyErr_SetString(PyExc_ValueError, "heatmaps and pafs are expected to have CxHxW dimensions");
+        return false;
+    }
+    if (PyArray_SHAPE(heatmaps)[0] < keypoints_number || PyArray_SHAPE(pafs)[0] < pafs_number) {
+        PyErr_Format(PyExc_ValueError, "expected at least %d heatmaps and %d pafs", keypoints_number, pafs_number);
+        return false;
+    }
+    if (PyArray_SHAPE(heatmaps)[1] != PyArray_SHAPE(pafs)[1] || PyArray_SHAPE(heatmaps)[2] != PyArray_SHAPE(pafs)[2]) {
+        PyErr_SetString(PyExc_ValueError, "heatmaps and pafs are expected to have the same size");
+        return false;
     }
-    std::vector<cv::Mat> heatmaps = wrap_feature_maps(py_heatmaps);
-    std::vector<cv::Mat> pafs = wrap_feature_maps(py_pafs);
+    frame.heatmaps = wrap_feature_maps(heatmaps);
+    frame.pafs = wrap_feature_maps(pafs);
+    return true;
+}
 
-    std::vector<human_pose_estimation::HumanPose> poses = human_pose_estimation::extractPoses(
-                heatmaps, pafs, ratio);
+// Extracts the poses without holding the GIL, so the other Python threads, e.g. of the other
+// streams, run meanwhile. Sets a Python error and returns false if the extraction failed
+bool extract_frame_poses(const FrameFeatureMaps& frame, int ratio,
+                         std::vector<human_pose_estimation::HumanPose>& poses) {
+    if (ratio <= 0) {
+        PyErr_SetString(PyExc_ValueError, "upsample ratio is expected to be positive");
+        return false;
+    }
+    std::string error;
+    PyThreadState* thread_state = PyEval_SaveThread();
+    try {
+        poses = human_pose_estimation::extractPoses(frame.heatmaps, frame.pafs, ratio);
+    } catch (const std::exception& e) {
+        error = e.what();
+    } catch (...) {
+        error = "Unknown exception in pose extraction";
+    }
+    PyEval_RestoreThread(thread_state);
+    if (!error.empty()) {
+        PyErr_SetString(PyExc_RuntimeError, error.c_str());
+        return false;
+    }
+    return true;
+}
 
+// Returns a num_persons x (num_keypoints * 3 + 1) array of the x, y and score of every keypoint
+// followed by the score of the pose
+PyObject* poses_to_array(const std::vector<human_pose_estimation::HumanPose>& poses) {
     size_t num_persons = poses.size();
     size_t num_keypoints = 0;
     if (num_persons > 0) {
         num_keypoints = poses[0].keypoints.size();
     }
     npy_intp dims[] = {static_cast<npy_intp>(num_persons), static_cast<npy_intp>(num_keypoints * 3 + 1)};
-    PyObject* out_array = PyArray_SimpleNew(2, dims, NPY_FLOAT);
-    char* out_data = PyArray_BYTES(reinterpret_cast<PyArrayObject*>(out_array));
-    for (size_t person_id = 0; person_id < num_persons; person_id++) {
-        float* person_data = reinterpret_cast<float*>(out_data + PyArray_STRIDE(
-            reinterpret_cast<PyArrayObject*>(out_array), 0) * person_id);
-        for (size_t kpt_id = 0; kpt_id < num_keypoints * 3; kpt_id += 3) {
-            person_data[kpt_id + 0] = poses[person_id].keypoints[kpt_id / 3].x;
-            person_data[kpt_id + 1] = poses[person_id].keypoints[kpt_id / 3].y;
-            person_data[kpt_id + 2] = poses[person_id].keypoints[kpt_id / 3].z;
+    PyObject* out_array = PyArray_SimpleNew(2, dims, NPY_FLOAT32);
+    if (out_array == nullptr) {
+        return nullptr;
+    }
+    // a new array is C-contiguous
+    float* person_data = static_cast<float*>(PyArray_DATA(reinterpret_cast<PyArrayObject*>(out_array)));
+    for (const auto& pose : poses) {
+        for (size_t kpt_id = 0; kpt_id < num_keypoints; kpt_id++) {
+            *person_data++ = pose.keypoints[kpt_id].x;
+            *person_data++ = pose.keypoints[kpt_id].y;
+            *person_data++ = pose.keypointsScores[kpt_id];
         }
-        person_data[num_keypoints * 3] = poses[person_id].score;
+        *person_data++ = pose.score;
     }
     return out_array;
 }
+}  // namespace
+
+static PyObject* extract_poses(PyObject* self, PyObject* args) {
+    PyObject* py_heatmaps;
+    PyObject* py_pafs;
+    int ratio;
+    if (!PyArg_ParseTuple(args, "OOi", &py_heatmaps, &py_pafs, &ratio)) {
+        return nullptr;
+    }
+    std::vector<FeatureMapsArray> arrays;
+    FrameFeatureMaps frame;
+    if (!wrap_frame(py_heatmaps, py_pafs, arrays, frame)) {
+        return nullptr;
+    }
+    std::vector<human_pose_estimation::HumanPose> poses;
+    if (!extract_frame_poses(frame, ratio, poses)) {
+        return nullptr;
+    }
+    return poses_to_array(poses);
+}
 
 PyMethodDef method_table[] = {
     {"extract_poses", static_cast<PyCFunction>(extract_poses), METH_VARARGS,
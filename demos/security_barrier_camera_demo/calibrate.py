@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+
+# Copyright (c) 2019 Intel Corporation
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""
+Calibration of the device placement and the infer request counts of the security barrier demo.
+
+The demo runs for --time seconds per trial with the demo arguments given after "--", e.g. the inputs
+and the models. The stages are the detector and Vehicle Attributes and LPR if -m_va and -m_lpr are given.
+First every assignment of --devices to the stages is tried with the default request counts, then the
+request counts of --nireq are tried for one stage at a time for the best assignment. A trial is scored by the
+total input FPS of the channels over the run and the worst 95th percentile of the capture to result
+latency from the demo's -report. The trials within --tolerance of the best FPS are compared by the latency.
+A trial which doesn't exit within --time and a couple of minutes of the network loading fails.
+
+The best configuration is written to --output as a gflags flag file for later runs:
+    security_barrier_camera_demo -flagfile <output> <the demo arguments>
+"""
+
+import argparse
+import itertools
+import json
+import subprocess
+import sys
+import tempfile
+from pathlib import Path
+
+# the flags of the device and of the request count of every stage, the detector is always run
+STAGES = [
+    ('detection', '-m', 'd', 'nireq'),
+    ('vehicle attributes', '-m_va', 'd_va', 'nireq_va'),
+    ('lpr', '-m_lpr', 'd_lpr', 'nireq_lpr'),
+]
+# seconds a trial may run beyond --time to load the networks and to exit, a trial which hangs is killed after them
+TRIAL_GRACE = 120
+
+def parse_args():
+    parser = argparse.ArgumentParser(
+        formatter_class=argparse.RawDescriptionHelpFormatter, description=__doc__)
+    parser.add_argument('--demo', type=Path, required=True, help='path to the security_barrier_camera_demo binary')
+    parser.add_argument('--output', type=Path, required=True, help='flag file to write the best configuration to')
+    parser.add_argument('--devices', default='CPU,GPU',
+        help='comma separated devices to place the stages on')
+    parser.add_argument('--nireq', default='1,2,4,8',
+        help='comma separated infer request counts to try for every stage')
+    parser.add_argument('--time', type=int, default=15, help='seconds of a trial')
+    parser.add_argument('--tolerance', type=float, default=0.02,
+        help='share of the best FPS within which the lower latency wins')
+    parser.add_argument('demo_args', nargs=argparse.REMAINDER, help='-- followed by the demo arguments')
+    args = parser.parse_args()
+    if args.demo_args[:1] == ['--']:
+        args.demo_args = args.demo_args[1:]
+    return args
+
+def run_trial(args, config, report_path):
+    """Returns (fps, latency_ms) of a run of the demo with the configuration, None if it failed."""
+    command = [str(args.demo)] + args.demo_args + ['-no_show', '-time', str(args.time),
+        '-report', str(report_path), '-report_period', '0'] + ['-{}={}'.format(*item) for item in config]
+    try:
+        subprocess.run(command, check=True, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE,
+            universal_newlines=True, timeout=args.time + TRIAL_GRACE)
+    except subprocess.TimeoutExpired:
+        print('    failed: no exit in {} seconds'.format(args.time + TRIAL_GRACE))
+        return None
+    except subprocess.CalledProcessError as e:
+        lines = e.stderr.strip().splitlines()
+        print('    failed: {}'.format(lines[-1] if lines else 'exit code {}'.format(e.returncode)))
+        return None
+    records = [json.loads(line) for line in report_path.read_text().splitlines() if line]
+    final = records[-1]
+    fps = sum(channel['input_fps'] for channel in final['channels'])
+    latency = max(channel['capture_latency_ms']['p95'] for channel in final['channels'])
+    return fps, latency
+
+def is_better(result, best, tolerance):
+    if best is None: return True
+    if result[0] > best[0] * (1 + tolerance): return True
+    return result[0] >= best[0] * (1 - tolerance) and result[1] < best[1]
+
+def main():
+    args = parse_args()
+    stages = [stage for stage in STAGES if stage[1] in args.demo_args]
+    if not stages or stages[0][1] != '-m':
+        sys.exit('The demo arguments must have at least the detection model -m')
+    devices = args.devices.split(',')
+    nireqs = args.nireq.split(',')
+
+    results = {}
+    with tempfile.TemporaryDirectory() as temp_dir:
+        report_path = Path(temp_dir) / 'report.jsonl'
+
+        def measure(config):
+            config = tuple(config)
+            if config not in results:
+                print(' '.join('-{}={}'.format(*item) for item in config))
+                results[config] = run_trial(args, config, report_path)
+                if results[config] is not None:
+                    print('    {:.1f} FPS, {:.1f} ms'.format(*results[config]))
+            return results[config]
+
+        best_config, best = None, None
+        for placement in itertools.product(devices, repeat=len(stages)):
+            config = [(stage[2], device) for stage, device in zip(stages, placement)]
+            result = measure(config)
+            if result is not None and is_better(result, best, args.tolerance):
+                best_config, best = config, result
+        if best is None:
+            sys.exit('No device assignment ran')
+
+        for stage in stages:
+            for nireq in nireqs:
+                config = [item for item in best_config if item[0] != stage[3]] + [(stage[3], nireq)]
+                result = measure(config)
+                if result is not None and is_better(result, best, args.tolerance):
+                    best_config, best = config, result
+
+    with args.output.open('w') as output:
+        output.write('# {:.1f} FPS, {:.1f} ms 95th percentile capture to result latency\n'.format(*best))
+        for item in best_config:
+            output.write('-{}={}\n'.format(*item))
+    print('The best configuration of {:.1f} FPS and {:.1f} ms is written to {}'.format(best[0], best[1], args.output))
+
+if __name__ == '__main__':
+    main()
@@ -5,19 +5,31 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
 #include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <limits>
 #include <list>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <utility>
-#include <set>
 #include <string>
 #include <thread>
 #include <vector>
 
 #include <opencv2/core/core.hpp>
 
+#include <samples/instrumentation.hpp>
+
 class VideoFrame {  // VideoFrame can represent not a single image but the whole grid
 public:
     typedef std::shared_ptr<VideoFrame> Ptr;
@@ -29,6 +41,7 @@ public:
     const unsigned sourceID;
     const int64_t frameId;
     cv::Mat frame;
+    std::chrono::steady_clock::time_point captureTime;  // when the frame was read from its source
 };
 
 class Worker;
@@ -36,68 +49,123 @@ class Worker;
 class Task {
 public:
     explicit Task(VideoFrame::Ptr sharedVideoFrame, float priority = 0):
-        sharedVideoFrame{sharedVideoFrame}, priority{priority} {}
+        sharedVideoFrame{sharedVideoFrame}, priority{priority}, created{std::chrono::steady_clock::now()} {}
     virtual bool isReady() = 0;
+    // what a not ready task waits for, Worker::notify() with the same key checks it again.
+    // Tasks waiting for nullptr are also checked periodically, e.g. when they get ready with time
+    virtual const void* waitKey() const {
+        return nullptr;
+    }
     virtual void process() = 0;
+    // the task type in Worker::Stats, a string literal
+    virtual const char* name() const {
+        return "Task";
+    }
     virtual ~Task() = default;
 
     VideoFrame::Ptr sharedVideoFrame;  // it is possible that two tasks try to draw on the same cvMat
     const float priority;
+    const std::chrono::steady_clock::time_point created;
 };
 
-struct HigherPriority {
-    bool operator()(const std::shared_ptr<Task>& lhs, const std::shared_ptr<Task>& rhs) const {
-        return lhs->priority > rhs->priority
-            || (lhs->priority == rhs->priority && lhs->sharedVideoFrame->frameId < rhs->sharedVideoFrame->frameId)
-            || (lhs->priority == rhs->priority && lhs->sharedVideoFrame->frameId == rhs->sharedVideoFrame->frameId && lhs < rhs);
+class LatencyHistogram {  // counts latencies in logarithmic buckets, 4 per power of 2 microseconds
+public:
+    LatencyHistogram(): count{0} {
+        buckets.fill(0);
+    }
+    void add(std::chrono::steady_clock::duration latency) {
+        const int64_t usec = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+        const std::size_t bucket = usec < 1 ? 0 : 1 + static_cast<std::size_t>(4 * std::log2(static_cast<double>(usec)));
+        buckets[std::min(bucket, buckets.size() - 1)]++;
+        count++;
+    }
+    LatencyHistogram& operator+=(const LatencyHistogram& other) {
+        for (std::size_t i = 0; i < buckets.size(); i++) {
+            buckets[i] += other.buckets[i];
+        }
+        count += other.count;
+        return *this;
     }
+    // the upper bound of the bucket with the percentile, msec
+    double percentile(double share) const {
+        const uint64_t rank = static_cast<uint64_t>(std::ceil(share * count));
+        uint64_t counted = 0;
+        for (std::size_t i = 0; i < buckets.size(); i++) {
+            counted += buckets[i];
+            if (counted >= rank && 0 != counted) {
+                return 0 == i ? 0.001 : std::pow(2.0, i / 4.0) / 1000;
+            }
+        }
+        return 0.0;
+    }
+    uint64_t getCount() const {
+        return count;
+    }
+
+private:
+    std::array<uint64_t, 128> buckets;
+    uint64_t count;
 };
 
+/**
+* \brief Runs tasks by priority on its threads. Every thread has its own queue with a FIFO per priority
+* and takes the highest priority task of all queues, its own one on ties, so idle threads steal from
+* busy ones without a global lock. Tasks which are not ready are parked by their Task::waitKey() until
+* notify() reports that what they wait for changed, instead of being polled with isReady() in a loop
+*/
 class Worker {
 public:
     explicit Worker(unsigned threadNum):
-        threadPool(threadNum), running{false} {}
+        threadPool(threadNum), queues(threadNum + 1), running{false}, queuedTasks{0}, idleThreads{0}, timedWaiter{false},
+        nextQueue{0}, notifications{0}, parkedTasks{0}, timedParkedTasks{0} {
+        for (auto& queue : queues) {
+            queue.reset(new TaskQueue);
+        }
+    }
     ~Worker() {
         stop();
     }
     void runThreads() {
         running = true;
-        for (std::thread& t : threadPool) {
-            t = std::thread(&Worker::threadFunc, this);
+        for (std::size_t i = 0; i < threadPool.size(); ++i) {
+            threadPool[i] = std::thread(&Worker::run, this, i);
         }
     }
     void push(std::shared_ptr<Task> task) {
-        tasksMutex.lock();
-        tasks.insert(task);
-        tasksMutex.unlock();
-        tasksCondVar.notify_one();
+        enqueue(currentQueue(), std::move(task));
     }
-    void threadFunc() {
-        while (running) {
-            std::unique_lock<std::mutex> lk(tasksMutex);
-            while (running && tasks.empty()) {
-                tasksCondVar.wait(lk);
+    // what tasks parked with the key wait for changed, e.g. an InferRequest is released, they are checked again
+    void notify(const void* key = nullptr) {
+        ++notifications;
+        if (0 == parkedTasks) {
+            return;
+        }
+        std::vector<std::shared_ptr<Task>> woken;
+        {
+            std::lock_guard<std::mutex> lock{parkedMutex};
+            auto it = parked.find(key);
+            if (parked.end() == it) {
+                return;
             }
-            try {
-                auto it = std::find_if(tasks.begin(), tasks.end(), [](const std::shared_ptr<Task>& task){return task->isReady();});
-                if (tasks.end() != it) {
-                    const std::shared_ptr<Task> task = std::move(*it);
-                    tasks.erase(it);
-                    lk.unlock();
-                    task->process();
-                }
-            } catch (...) {
-                std::lock_guard<std::mutex> lock{excpetionMutex};
-                if (nullptr == currentException) {
-                    currentException = std::current_exception();
-                    stop();
-                }
+            woken.swap(it->second);
+            parked.erase(it);
+            parkedTasks -= woken.size();
+            if (nullptr == key) {
+                timedParkedTasks = 0;
             }
         }
+        const std::size_t queueIdx = currentQueue();
+        for (auto& task : woken) {
+            enqueue(queueIdx, std::move(task));
+        }
+    }
+    void threadFunc() {
+        run(threadPool.size());  // the calling thread takes the last queue
     }
     void stop() {
         running = false;
-        tasksCondVar.notify_all();
+        std::lock_guard<std::mutex> lock{idleMutex};
+        idleCondVar.notify_all();
     }
     void join() {
         for (auto& t : threadPool) {
@@ -108,54 +176,309 @@ public:
         }
     }
 
+    struct Stats {
+        std::size_t queuedTasks;
+        std::size_t parkedTasks;
+        std::map<std::string, LatencyHistogram> latencies;  // from Task creation to the end of process() by Task::name()
+    };
+    Stats getStats() const {
+        Stats stats{queuedTasks, parkedTasks, {}};
+        for (const auto& queue : queues) {
+            std::lock_guard<std::mutex> lock{queue->statsMutex};
+            for (const auto& latency : queue->latencies) {
+                stats.latencies[latency.first] += latency.second;
+            }
+        }
+        return stats;
+    }
+
 private:
-    std::condition_variable tasksCondVar;
-    std::set<std::shared_ptr<Task>, HigherPriority> tasks;
-    std::mutex tasksMutex;
+    // tasks parked with nullptr key are also checked this often
+    static constexpr std::chrono::milliseconds recheckPeriod{1};
+
+    struct NameLess {
+        bool operator()(const char* a, const char* b) const {
+            return std::strcmp(a, b) < 0;
+        }
+    };
+
+    struct TaskQueue {
+        std::mutex mutex;
+        std::map<float, std::deque<std::shared_ptr<Task>>, std::greater<float>> levels;  // only non empty ones
+        std::atomic<float> topPriority{std::numeric_limits<float>::lowest()};  // lowest() when empty
+        // of the tasks processed by the thread of the queue, the mutex is only contended by getStats()
+        mutable std::mutex statsMutex;
+        std::map<const char*, LatencyHistogram, NameLess> latencies;
+    };
+
     std::vector<std::thread> threadPool;
+    std::vector<std::unique_ptr<TaskQueue>> queues;  // one more than threadPool for the threadFunc() caller
     std::atomic<bool> running;
+    std::atomic<std::size_t> queuedTasks;
+    std::mutex idleMutex;
+    std::condition_variable idleCondVar;
+    std::atomic<std::size_t> idleThreads;
+    std::atomic<bool> timedWaiter;
+    std::atomic<std::size_t> nextQueue;  // for pushes from other threads, e.g. InferRequest callbacks
+    std::atomic<std::uint64_t> notifications;
+    std::mutex parkedMutex;
+    std::map<const void*, std::vector<std::shared_ptr<Task>>> parked;
+    std::atomic<std::size_t> parkedTasks;
+    std::atomic<std::size_t> timedParkedTasks;  // parked with nullptr key
     std::exception_ptr currentException;
     std::mutex excpetionMutex;
+
+    static std::pair<const Worker*, std::size_t>& threadSlot() {
+        static thread_local std::pair<const Worker*, std::size_t> slot{nullptr, 0};
+        return slot;
+    }
+
+    std::size_t currentQueue() {
+        const auto& slot = threadSlot();
+        return this == slot.first ? slot.second : nextQueue++ % queues.size();
+    }
+
+    void enqueue(std::size_t queueIdx, std::shared_ptr<Task>&& task) {
+        TaskQueue& queue = *queues[queueIdx];
+        {
+            std::lock_guard<std::mutex> lock{queue.mutex};
+            const float priority = task->priority;
+            queue.levels[priority].push_back(std::move(task));
+            queue.topPriority = queue.levels.begin()->first;
+        }
+        ++queuedTasks;
+        if (0 != idleThreads) {
+            std::lock_guard<std::mutex> lock{idleMutex};
+            idleCondVar.notify_one();
+        }
+    }
+
+    bool pop(std::size_t queueIdx, std::shared_ptr<Task>& task) {
+        while (0 != queuedTasks) {
+            std::size_t best = queueIdx;
+            float bestPriority = queues[queueIdx]->topPriority;
+            for (std::size_t i = 0; i < queues.size(); ++i) {
+                const float priority = queues[i]->topPriority;
+                if (priority > bestPriority) {
+                    best = i;
+                    bestPriority = priority;
+                }
+            }
+            if (std::numeric_limits<float>::lowest() == bestPriority) {
+                return false;  // the counted task is not enqueued yet
+            }
+            TaskQueue& queue = *queues[best];
+            std::lock_guard<std::mutex> lock{queue.mutex};
+            if (queue.levels.empty()) {
+                continue;  // stolen meanwhile
+            }
+            auto level = queue.levels.begin();
+            task = std::move(level->second.front());
+            level->second.pop_front();
+            if (level->second.empty()) {
+                queue.levels.erase(level);
+            }
+            queue.topPriority = queue.levels.empty() ? std::numeric_limits<float>::lowest() : queue.levels.begin()->first;
+            --queuedTasks;
+            return true;
+        }
+        return false;
+    }
+
+    void park(std::shared_ptr<Task>&& task, std::uint64_t checkedAt) {
+        const void* key = task->waitKey();
+        {
+            std::lock_guard<std::mutex> lock{parkedMutex};
+            parked[key].push_back(std::move(task));
+            ++parkedTasks;
+            if (nullptr == key) {
+                ++timedParkedTasks;
+            }
+        }
+        if (checkedAt != notifications) {
+            notify(key);  // a notification came after isReady(), it may have missed it
+        }
+    }
+
+    void wait() {
+        std::unique_lock<std::mutex> lk(idleMutex);
+        ++idleThreads;
+        auto hasWork = [this]() { return !running || 0 != queuedTasks; };
+        bool recheck = false;
+        if (0 != timedParkedTasks && !timedWaiter.exchange(true)) {  // one idle thread is enough to recheck
+            recheck = !idleCondVar.wait_for(lk, recheckPeriod, hasWork);
+            timedWaiter = false;
+        } else {
+            idleCondVar.wait(lk, hasWork);
+        }
+        --idleThreads;
+        lk.unlock();
+        if (recheck) {
+            notify();
+        }
+    }
+
+    void run(std::size_t queueIdx) {
+        instrumentation::registerCurrentThread("worker " + std::to_string(queueIdx));
+        threadSlot() = {this, queueIdx};
+        while (running) {
+            std::shared_ptr<Task> task;
+            if (!pop(queueIdx, task)) {
+                wait();
+                continue;
+            }
+            try {
+                const std::uint64_t checkedAt = notifications;
+                if (task->isReady()) {
+                    DEMO_TASK(task->name());
+                    task->process();  // it notifies the tasks waiting for what it changes
+                    const auto latency = std::chrono::steady_clock::now() - task->created;
+                    TaskQueue& queue = *queues[queueIdx];
+                    std::lock_guard<std::mutex> lock{queue.statsMutex};
+                    queue.latencies[task->name()].add(latency);
+                } else {
+                    park(std::move(task), checkedAt);
+                }
+            } catch (...) {
+                std::lock_guard<std::mutex> lock{excpetionMutex};
+                if (nullptr == currentException) {
+                    currentException = std::current_exception();
+                    stop();
+                }
+            }
+        }
+    }
 };
 
+constexpr std::chrono::milliseconds Worker::recheckPeriod;
+
 void tryPush(const std::weak_ptr<Worker>& worker, std::shared_ptr<Task>&& task) {
     try {
         std::shared_ptr<Worker>(worker)->push(task);
     } catch (const std::bad_weak_ptr&) {}
 }
 
-template <class C> class ConcurrentContainer {
+void tryNotify(const std::weak_ptr<Worker>& worker, const void* key) {
+    try {
+        std::shared_ptr<Worker>(worker)->notify(key);
+    } catch (const std::bad_weak_ptr&) {}
+}
+
+/**
+* \brief A lock-free bounded MPMC queue. Every cell has a sequence telling the turn of the producer and the
+* consumer it waits for, so push() and tryPop() take their positions with a CAS and contend only on them.
+* The sequence of a single cell is the same when it is full and when it is empty, so the capacity is 2 at least
+*/
+template <class T> class BoundedQueue {
 public:
-    C container;
-    mutable std::mutex mutex;
-
-    bool lockedEmpty() const noexcept {
-        std::lock_guard<std::mutex> lock{mutex};
-        return container.empty();
-    }
-    typename C::size_type lockedSize() const noexcept {
-        std::lock_guard<std::mutex> lock{mutex};
-        return container.size();
-    }
-    void lockedPush_back(const typename C::value_type& value) {
-        std::lock_guard<std::mutex> lock{mutex};
-        container.push_back(value);
-    }
-    bool lockedTry_pop(typename C::value_type& value) {
-        mutex.lock();
-        if (!container.empty()) {
-            value = container.back();
-            container.pop_back();
-            mutex.unlock();
-            return true;
-        } else {
-            mutex.unlock();
-            return false;
+    explicit BoundedQueue(std::size_t capacity):
+        capacity{std::max<std::size_t>(capacity, 2)}, cells{new Cell[this->capacity]}, pushPos{0}, popPos{0} {
+        for (std::size_t i = 0; i < this->capacity; i++) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
         }
     }
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
 
-    operator C() const {
-        std::lock_guard<std::mutex> lock{mutex};
-        return container;
+    // false if the queue is full. It is also full for a moment while a tryPop() of the cell of the previous
+    // round hasn't finished, so a caller knowing there is room has to retry
+    bool push(const T& value) {
+        std::size_t pos = pushPos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[pos % capacity];
+            const std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const std::ptrdiff_t turn = static_cast<std::ptrdiff_t>(sequence - pos);
+            if (0 == turn) {
+                if (pushPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = value;
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (turn < 0) {
+                return false;
+            } else {
+                pos = pushPos.load(std::memory_order_relaxed);
+            }
+        }
     }
+    // false if the queue is empty
+    bool tryPop(T& value) {
+        std::size_t pos = popPos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[pos % capacity];
+            const std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const std::ptrdiff_t turn = static_cast<std::ptrdiff_t>(sequence - (pos + 1));
+            if (0 == turn) {
+                if (popPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    value = std::move(cell.value);
+                    cell.sequence.store(pos + capacity, std::memory_order_release);
+                    return true;
+                }
+            } else if (turn < 0) {
+                return false;
+            } else {
+                pos = popPos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+    // a snapshot, it may be outdated when it is returned
+    std::size_t size() const {
+        const std::size_t popped = popPos.load(std::memory_order_relaxed);
+        const std::size_t pushed = pushPos.load(std::memory_order_relaxed);
+        return pushed > popped ? std::min(pushed - popped, capacity) : 0;
+    }
+    bool empty() const {
+        return 0 == size();
+    }
+
+private:
+    struct Cell {
+        std::atomic<std::size_t> sequence;
+        T value;
+    };
+
+    const std::size_t capacity;
+    const std::unique_ptr<Cell[]> cells;
+    // the positions are on their own cache lines not to bounce between producers and consumers
+    alignas(64) std::atomic<std::size_t> pushPos;
+    alignas(64) std::atomic<std::size_t> popPos;
+};
+
+/**
+* \brief Accumulates the values pushed by any threads without a lock: push() prepends a node with a CAS. The
+* owner takes all the values once the pushing threads are done, so the nodes are never popped concurrently
+*/
+template <class T> class ConcurrentCollector {
+public:
+    ConcurrentCollector(): head{nullptr} {}
+    ConcurrentCollector(const ConcurrentCollector&) = delete;
+    ConcurrentCollector& operator=(const ConcurrentCollector&) = delete;
+    ~ConcurrentCollector() {
+        take();
+    }
+
+    void push(T value) {
+        Node* node = new Node{std::move(value), head.load(std::memory_order_relaxed)};
+        while (!head.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed)) {}
+    }
+    // the values in the order of push(), the caller has to assure that none pushes concurrently
+    std::list<T> take() {
+        std::list<T> values;
+        Node* node = head.exchange(nullptr, std::memory_order_acquire);
+        while (nullptr != node) {
+            values.push_front(std::move(node->value));
+            Node* next = node->next;
+            delete node;
+            node = next;
+        }
+        return values;
+    }
+
+private:
+    struct Node {
+        T value;
+        Node* next;
+    };
+
+    std::atomic<Node*> head;
 };
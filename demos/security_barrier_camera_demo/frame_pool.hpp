@@ -0,0 +1,73 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include <mutex>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+class FramePool {  // keeps up to capacity free cv::Mat buffers of a channel, so frames of the same size don't allocate
+public:
+    struct Stats {
+        std::size_t reused;
+        std::size_t allocated;
+        std::size_t dropped;  // released buffers which were shared or didn't fit into the pool
+    };
+
+    explicit FramePool(std::size_t capacity): capacity{capacity}, stats{0, 0, 0} {
+        buffers.reserve(capacity);
+    }
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    cv::Mat acquire(cv::Size size, int type) {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            for (cv::Mat& buffer : buffers) {
+                if (size == buffer.size() && type == buffer.type()) {
+                    cv::Mat reused = buffer;
+                    std::swap(buffer, buffers.back());
+                    buffers.pop_back();
+                    stats.reused++;
+                    return reused;
+                }
+            }
+            stats.allocated++;
+        }
+        return cv::Mat(size, type);
+    }
+
+    void release(const cv::Mat& mat) {  // the caller drops its reference to mat after it
+        std::lock_guard<std::mutex> lock{mutex};
+        // another owner may still read or write a shared buffer
+        if (mat.empty() || nullptr == mat.u || 1 != mat.u->refcount || !mat.isContinuous() || mat.isSubmatrix()) {
+            stats.dropped++;
+            return;
+        }
+        if (buffers.size() < capacity) {
+            buffers.push_back(mat);
+            return;
+        }
+        for (cv::Mat& buffer : buffers) {  // the channel changed its resolution, old sizes are not needed anymore
+            if (mat.size() != buffer.size() || mat.type() != buffer.type()) {
+                buffer = mat;
+                return;
+            }
+        }
+        stats.dropped++;
+    }
+
+    Stats getStats() const {
+        std::lock_guard<std::mutex> lock{mutex};
+        return stats;
+    }
+
+private:
+    const std::size_t capacity;
+    mutable std::mutex mutex;
+    std::vector<cv::Mat> buffers;
+    Stats stats;
+};
@@ -5,11 +5,11 @@
 #pragma once
 
 #include <algorithm>
-#include <set>
 #include <string>
 #include <vector>
 
 #include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
 
 class GridMat {
 public:
@@ -59,21 +59,24 @@ public:
             throw std::logic_error("Cannot display " + std::to_string(frames.size()) + " channels in a grid with " + std::to_string(points.size()) + " cells");
         }
 
-        for (size_t i = 0; i < frames.size(); i++) {
-            cv::Mat cell = outimg(cv::Rect(points[i].x, points[i].y, cellSize.width, cellSize.height));
-
-            if ((cellSize.width == frames[i].cols) && (cellSize.height == frames[i].rows)) {
-                frames[i].copyTo(cell);
-            } else if ((cellSize.width > frames[i].cols) && (cellSize.height > frames[i].rows)) {
-                frames[i].copyTo(cell(cv::Rect(0, 0, frames[i].cols, frames[i].rows)));
-            } else {
-                cv::resize(frames[i], cell, cellSize);
+        // the cells don't overlap, so they are resized in parallel
+        cv::parallel_for_(cv::Range(0, static_cast<int>(frames.size())), [&](const cv::Range& range) {
+            for (int i = range.start; i < range.end; i++) {
+                drawCell(frames[i], i);
             }
-        }
-        unupdatedSourceIDs.clear();
+        });
+        updatedSourceIDs.assign(updatedSourceIDs.size(), true);
+        unupdatedCount = 0;
     }
 
     void update(const cv::Mat& frame, const size_t sourceID) {
+        drawCell(frame, sourceID);
+        markUpdated(sourceID);
+    }
+
+    // writes only the pixels of the cell, the different cells can be drawn concurrently. The result counts after
+    // markUpdated()
+    void drawCell(const cv::Mat& frame, const size_t sourceID) {
         cv::Mat cell = outimg(cv::Rect(points[sourceID], cellSize));
 
         if ((cellSize.width == frame.cols) && (cellSize.height == frame.rows)) {
@@ -83,18 +86,24 @@ public:
         } else {
             cv::resize(frame, cell, cellSize);
         }
-        unupdatedSourceIDs.erase(unupdatedSourceIDs.find(sourceID));
+    }
+
+    void markUpdated(const size_t sourceID) {
+        if (!updatedSourceIDs[sourceID]) {
+            updatedSourceIDs[sourceID] = true;
+            unupdatedCount--;
+        }
     }
 
     bool isFilled() const noexcept {
-        return unupdatedSourceIDs.empty();
+        return 0 == unupdatedCount;
     }
-    void clear() {
-        size_t counter = 0;
-        std::generate_n(std::inserter(unupdatedSourceIDs, unupdatedSourceIDs.end()), points.size(), [&counter]{return counter++;});
+    void clear() {  // doesn't allocate, the Drawer clears a grid for every shown frame
+        updatedSourceIDs.assign(points.size(), false);
+        unupdatedCount = points.size();
     }
-    std::set<size_t> getUnupdatedSourceIDs() const noexcept {
-        return unupdatedSourceIDs;
+    size_t getUnupdatedCount() const noexcept {
+        return unupdatedCount;
     }
     cv::Mat getMat() const noexcept {
         return outimg;
@@ -102,7 +111,8 @@ public:
 
 private:
     cv::Size cellSize;
-    std::set<size_t> unupdatedSourceIDs;
+    std::vector<bool> updatedSourceIDs;
+    size_t unupdatedCount;
     std::vector<cv::Point> points;
 };
 
@@ -4,15 +4,25 @@
 
 #pragma once
 
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
 #include <list>
 #include <memory>
+#include <mutex>
 #include <set>
+#include <string>
 #include <thread>
+#include <utility>
 #include <vector>
-#include <queue>
 
 #include <opencv2/core/core.hpp>
 
+#include <samples/capture_recording.hpp>
+
+#include "frame_pool.hpp"
+
 class InputChannel;
 
 class IInputSource {
@@ -20,6 +30,10 @@ public:
     virtual bool read(cv::Mat& mat, const std::shared_ptr<InputChannel>& caller) = 0;
     virtual void addSubscriber(const std::weak_ptr<InputChannel>& inputChannel) = 0;
     virtual cv::Size getSize() = 0;
+    // a camera produces frames whether they are read or not
+    virtual bool isLive() const {
+        return false;
+    }
     virtual void lock() {
         sourceLock.lock();
     }
@@ -35,8 +49,8 @@ class InputChannel: public std::enable_shared_from_this<InputChannel> {  // note
 public:
     InputChannel(const InputChannel&) = delete;
     InputChannel& operator=(const InputChannel&) = delete;
-    static std::shared_ptr<InputChannel> create(const std::shared_ptr<IInputSource>& source) {
-        auto tmp = std::shared_ptr<InputChannel>(new InputChannel(source));
+    static std::shared_ptr<InputChannel> create(const std::shared_ptr<IInputSource>& source, std::size_t poolCapacity) {
+        auto tmp = std::shared_ptr<InputChannel>(new InputChannel(source, poolCapacity));
         source->addSubscriber(tmp);
         return tmp;
     }
@@ -55,31 +69,54 @@ public:
                 source->unlock();
             }
         }
-        mat = readQueue.front().clone();
-        readQueue.pop();
+        // the queued frame is owned by this channel only, so it is taken without a copy and the previous buffer
+        // of mat goes back to the pool
+        pool.release(mat);
+        mat = readQueue.front();
+        readQueue.front() = cv::Mat();
+        spareNodes.splice(spareNodes.end(), readQueue, readQueue.begin());
         readQueueMutex.unlock();
         return true;
     }
     void push(const cv::Mat& mat) {
+        cv::Mat copy = pool.acquire(mat.size(), mat.type());
+        mat.copyTo(copy);
         readQueueMutex.lock();
-        readQueue.push(mat);
+        if (spareNodes.empty()) {
+            readQueue.push_back(copy);
+        } else {  // reuse a list node of a read frame
+            readQueue.splice(readQueue.end(), spareNodes, spareNodes.begin());
+            readQueue.back() = copy;
+        }
         readQueueMutex.unlock();
     }
     cv::Size getSize() {
         return source->getSize();
     }
+    bool isLive() const {
+        return source->isLive();
+    }
+    std::size_t queueSize() {  // frames a shared source read for this channel which are not taken yet
+        std::lock_guard<std::mutex> lock{readQueueMutex};
+        return readQueue.size();
+    }
+    FramePool::Stats getPoolStats() const {
+        return pool.getStats();
+    }
 
 private:
-    explicit InputChannel(const std::shared_ptr<IInputSource>& source): source{source} {}
+    InputChannel(const std::shared_ptr<IInputSource>& source, std::size_t poolCapacity): source{source}, pool{poolCapacity} {}
     std::shared_ptr<IInputSource> source;
-    std::queue<cv::Mat, std::list<cv::Mat>> readQueue;
+    FramePool pool;
+    std::list<cv::Mat> readQueue;
+    std::list<cv::Mat> spareNodes;  // nodes of read frames, so queueing doesn't allocate in a steady state
     std::mutex readQueueMutex;
 };
 
 class VideoCaptureSource: public IInputSource {
 public:
-    VideoCaptureSource(const cv::VideoCapture& videoCapture, bool loop): videoCapture{videoCapture}, loop{loop},
-        imSize{static_cast<int>(videoCapture.get(cv::CAP_PROP_FRAME_WIDTH)), static_cast<int>(videoCapture.get(cv::CAP_PROP_FRAME_HEIGHT))} {}
+    VideoCaptureSource(const cv::VideoCapture& videoCapture, bool loop, bool live = false): videoCapture{videoCapture}, loop{loop},
+        live{live}, imSize{static_cast<int>(videoCapture.get(cv::CAP_PROP_FRAME_WIDTH)), static_cast<int>(videoCapture.get(cv::CAP_PROP_FRAME_HEIGHT))} {}
     bool read(cv::Mat& mat, const std::shared_ptr<InputChannel>& caller) override {
         if (!videoCapture.read(mat)) {
             if (loop) {
@@ -90,12 +127,11 @@ public:
             }
         }
         if (1 != subscribedInputChannels.size()) {
-            cv::Mat shared = mat.clone();
             for (const std::weak_ptr<InputChannel>& weakInputChannel : subscribedInputChannels) {
                 try {
                     std::shared_ptr<InputChannel> sharedInputChannel = std::shared_ptr<InputChannel>(weakInputChannel);
                     if (caller != sharedInputChannel) {
-                        sharedInputChannel->push(shared);
+                        sharedInputChannel->push(mat);  // copies into a buffer of the channel's pool
                     }
                 } catch (const std::bad_weak_ptr&) {}
             }
@@ -108,11 +144,15 @@ public:
     cv::Size getSize() override {
         return imSize;
     }
+    bool isLive() const override {
+        return live;
+    }
 
 private:
     std::vector<std::weak_ptr<InputChannel>> subscribedInputChannels;
     cv::VideoCapture videoCapture;
     bool loop;
+    bool live;
     cv::Size imSize;
 };
 
@@ -147,3 +187,156 @@ private:
     cv::Mat im;
     bool loop;
 };
+
+class ReplaySource: public IInputSource {  // a paced replay is live like the camera it may have been recorded from
+public:
+    ReplaySource(const std::string& path, bool paced, bool loop): replayer{path, paced, loop}, paced{paced} {}
+    bool read(cv::Mat& mat, const std::shared_ptr<InputChannel>& caller) override {
+        if (!replayer.read(mat)) {
+            return false;
+        }
+        if (1 != subscribedInputChannels.size()) {
+            for (const std::weak_ptr<InputChannel>& weakInputChannel : subscribedInputChannels) {
+                std::shared_ptr<InputChannel> sharedInputChannel = weakInputChannel.lock();
+                if (sharedInputChannel && caller != sharedInputChannel) {
+                    sharedInputChannel->push(mat);
+                }
+            }
+        }
+        return true;
+    }
+    void addSubscriber(const std::weak_ptr<InputChannel>& inputChannel) override {
+        subscribedInputChannels.push_back(inputChannel);
+    }
+    cv::Size getSize() override {
+        return replayer.getSize();
+    }
+    bool isLive() const override {
+        return paced;
+    }
+
+private:
+    std::vector<std::weak_ptr<InputChannel>> subscribedInputChannels;
+    CaptureReplayer replayer;
+    bool paced;
+};
+
+class RecordingSource: public IInputSource {  // records every frame read from the source once, whichever channel reads it
+public:
+    RecordingSource(const std::shared_ptr<IInputSource>& source, const std::string& path): source{source}, recorder{path} {}
+    bool read(cv::Mat& mat, const std::shared_ptr<InputChannel>& caller) override {
+        if (!source->read(mat, caller)) {
+            return false;
+        }
+        recorder.write(mat, std::chrono::steady_clock::now().time_since_epoch());
+        return true;
+    }
+    void addSubscriber(const std::weak_ptr<InputChannel>& inputChannel) override {
+        source->addSubscriber(inputChannel);
+    }
+    cv::Size getSize() override {
+        return source->getSize();
+    }
+    bool isLive() const override {
+        return source->isLive();
+    }
+
+private:
+    std::shared_ptr<IInputSource> source;
+    CaptureRecorder recorder;
+};
+
+/**
+* \brief Reads an InputChannel in a dedicated thread, so a slow source doesn't hold the Worker threads. The read frame
+* waits in a single slot with the time it was captured. A frame of a live source replaces the not taken one to keep
+* the latency low, the other sources wait for the slot to be taken, so no frame of a file is lost
+*/
+class ChannelCapture {
+public:
+    // onChange is called from the capture thread after a frame is put to the slot or the input ends
+    ChannelCapture(const std::shared_ptr<InputChannel>& channel, std::function<void()> onChange):
+            channel{channel}, onChange{std::move(onChange)}, live{channel->isLive()}, hasFrame{false}, ended{false},
+            stopped{false}, droppedFrames{0} {
+        thread = std::thread(&ChannelCapture::capture, this);
+    }
+    ChannelCapture(const ChannelCapture&) = delete;
+    ChannelCapture& operator=(const ChannelCapture&) = delete;
+    ~ChannelCapture() {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            stopped = true;
+        }
+        changed.notify_all();
+        thread.join();
+    }
+
+    // take() doesn't wait
+    bool isReady() const {
+        std::lock_guard<std::mutex> lock{mutex};
+        return hasFrame || ended;
+    }
+
+    // swaps the captured frame with the buffer of a processed frame, which the next read reuses. Returns false if
+    // the input ended
+    bool take(cv::Mat& frame, std::chrono::steady_clock::time_point& captureTime) {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            if (!hasFrame) {
+                return false;
+            }
+            std::swap(frame, slot);
+            captureTime = slotCaptureTime;
+            hasFrame = false;
+        }
+        changed.notify_all();
+        return true;
+    }
+
+    uint64_t getDroppedFrames() const {  // replaced before they were taken
+        std::lock_guard<std::mutex> lock{mutex};
+        return droppedFrames;
+    }
+
+private:
+    void capture() {
+        cv::Mat frame;
+        while (true) {
+            const bool read = channel->read(frame);
+            const std::chrono::steady_clock::time_point captureTime = std::chrono::steady_clock::now();
+            std::unique_lock<std::mutex> lock{mutex};
+            if (!live) {
+                changed.wait(lock, [this]{return !hasFrame || stopped;});
+            }
+            if (stopped) {
+                return;
+            }
+            if (!read) {
+                ended = true;
+                lock.unlock();
+                onChange();
+                return;
+            }
+            if (hasFrame) {
+                droppedFrames++;
+            }
+            std::swap(frame, slot);  // the replaced or the given back buffer is read to next
+            slotCaptureTime = captureTime;
+            hasFrame = true;
+            lock.unlock();
+            onChange();
+        }
+    }
+
+    const std::shared_ptr<InputChannel> channel;
+    const std::function<void()> onChange;
+    const bool live;
+    cv::Mat slot;
+    std::chrono::steady_clock::time_point slotCaptureTime;
+    bool hasFrame;
+    bool ended;
+    bool stopped;
+    uint64_t droppedFrames;
+    mutable std::mutex mutex;
+    std::condition_variable changed;
+    std::thread thread;
+};
@@ -4,12 +4,14 @@
 
 #include <algorithm>
 #include <chrono>
+#include <deque>
 #include <iomanip>
 #include <list>
 #include <map>
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 #include <set>
@@ -20,12 +22,18 @@
 #include <monitors/presenter.h>
 #include <samples/ocv_common.hpp>
 #include <samples/args_helper.hpp>
+#include <samples/cpu_plan.hpp>
+#include <samples/parallel_load.hpp>
+#include <samples/results_sink.hpp>
 
 #include "common.hpp"
 #include "grid_mat.hpp"
 #include "input_wrappers.hpp"
 #include "security_barrier_camera_demo.hpp"
 #include "net_wrappers.hpp"
+#include "plate_cache.hpp"
+#include "report.hpp"
+#include "tracker.hpp"
 
 using namespace InferenceEngine;
 
@@ -52,6 +60,12 @@ bool ParseAndCheckCommandLine(int argc, char *argv[]) {
     if (FLAGS_n_wt == 0) {
         throw std::logic_error("-n_wt can not be zero");
     }
+    if (FLAGS_det_period == 0) {
+        throw std::logic_error("-det_period can not be zero");
+    }
+    if (FLAGS_bs_va == 0 || FLAGS_bs_lpr == 0) {
+        throw std::logic_error("-bs_va and -bs_lpr can not be zero");
+    }
     return true;
 }
 
@@ -72,20 +86,93 @@ struct InferRequestsContainer {
 
     void assign(const std::vector<InferRequest>& inferRequests) {
         actualInferRequests = inferRequests;
-        this->inferRequests.container.clear();
+        this->inferRequests.reset(new BoundedQueue<InferRequest*>{actualInferRequests.size()});
 
         for (auto& ir : this->actualInferRequests) {
-            this->inferRequests.container.push_back(ir);
+            this->inferRequests->push(&ir);
         }
     }
 
     std::vector<InferRequest> getActualInferRequests() {
         return actualInferRequests;
     }
-    ConcurrentContainer<std::vector<std::reference_wrapper<InferRequest>>> inferRequests;
+    // the free InferRequests, any thread takes and returns them without a lock
+    bool tryTake(InferRequest*& inferRequest) {
+        return inferRequests->tryPop(inferRequest);
+    }
+    void giveBack(InferRequest& inferRequest) {
+        // the capacity is the number of the InferRequests, push() fails only while a tryTake() is finishing
+        while (!inferRequests->push(&inferRequest)) {
+            std::this_thread::yield();
+        }
+    }
+    std::size_t freeCount() const {
+        return inferRequests->size();
+    }
 
 private:
     std::vector<InferRequest> actualInferRequests;
+    std::unique_ptr<BoundedQueue<InferRequest*>> inferRequests;
+};
+
+class ClassifiersAggreagator;
+
+struct ClassifiedCrop {  // a detection waiting for its classifier or recogniser batch
+    std::shared_ptr<ClassifiersAggreagator> classifiersAggreagator;
+    cv::Rect rect;
+    uint64_t trackId;  // the IouTracker track caching the result, 0 - untracked
+    uint64_t plateReadId;  // the PlateCache read of the plate, 0 - uncached
+    std::chrono::steady_clock::time_point pushTime;
+};
+
+class CropBatcher {  // accumulates crops of all channels into batched InferRequests of one network
+public:
+    CropBatcher(std::size_t batchSize, std::chrono::steady_clock::duration maxWait):
+        batchSize{batchSize}, maxWait{maxWait} {}
+
+    void push(const std::shared_ptr<ClassifiersAggreagator>& classifiersAggreagator, cv::Rect rect, uint64_t trackId,
+              uint64_t plateReadId = 0) {
+        std::lock_guard<std::mutex> lock{mutex};
+        crops.push_back(ClassifiedCrop{classifiersAggreagator, rect, trackId, plateReadId, std::chrono::steady_clock::now()});
+    }
+
+    bool empty() {
+        std::lock_guard<std::mutex> lock{mutex};
+        return crops.empty();
+    }
+
+    // takes up to batchSize crops and a free InferRequest for them if the batch is full or its oldest crop
+    // has waited for maxWait, otherwise returns nullptr and leaves the crops for the next batch
+    InferRequest* take(InferRequestsContainer& infers, std::vector<ClassifiedCrop>& batch) {
+        std::lock_guard<std::mutex> lock{mutex};
+        if (crops.empty()
+                || (crops.size() < batchSize && std::chrono::steady_clock::now() - crops.front().pushTime < maxWait)) {
+            return nullptr;
+        }
+        InferRequest* inferRequest;
+        if (!infers.tryTake(inferRequest)) {
+            return nullptr;
+        }
+        const std::size_t batchCropsCount = std::min(batchSize, crops.size());
+        batch.assign(std::make_move_iterator(crops.begin()), std::make_move_iterator(crops.begin() + batchCropsCount));
+        crops.erase(crops.begin(), crops.begin() + batchCropsCount);
+        return inferRequest;
+    }
+
+private:
+    const std::size_t batchSize;
+    const std::chrono::steady_clock::duration maxWait;
+    std::mutex mutex;
+    std::deque<ClassifiedCrop> crops;
+};
+
+struct ChannelTracking {  // detection skipping and plate caching state of a channel, see -det_period and -lpr_cache
+    ChannelTracking(): lastDetectedFrameId{-1}, plateCache{FLAGS_lpr_cache} {}
+    std::mutex mutex;
+    IouTracker tracker;
+    PlateCache plateCache;
+    int64_t lastDetectedFrameId;
+    cv::Mat lastDetectedThumbnail;  // to measure the motion since the last detection
 };
 
 struct Context {  // stores all global data for tasks
@@ -98,8 +185,9 @@ struct Context {  // stores all global data for tasks
             const std::weak_ptr<Worker> resAggregatorsWorker,
             uint64_t nireq,
             bool isVideo,
-            std::size_t nclassifiersireq, std::size_t nrecognizersireq):
-        readersContext{inputChannels, readersWorker, std::vector<int64_t>(inputChannels.size(), -1), std::vector<std::mutex>(inputChannels.size())},
+            std::size_t nclassifiersireq, std::size_t nrecognizersireq,
+            std::chrono::steady_clock::duration cropsMaxWait):
+        readersContext{inputChannels, readersWorker, std::vector<int64_t>(inputChannels.size(), -1), std::vector<std::mutex>(inputChannels.size()), {}},
         inferTasksContext{detector, inferTasksWorker},
         detectionsProcessorsContext{vehicleAttributesClassifier, lpr, detectionsProcessorsWorker},
         drawersContext{pause, gridParam, displayResolution, showPeriod, drawersWorker, monitorsStr},
@@ -109,7 +197,16 @@ struct Context {  // stores all global data for tasks
         isVideo{isVideo},
         t0{std::chrono::steady_clock::time_point()},
         freeDetectionInfersCount{0},
-        frameCounter{0}
+        frameCounter{0},
+        readFrames(inputChannels.size()),
+        captureLatencies(inputChannels.size()),
+        captureLatenciesMutexes(inputChannels.size()),
+        detectedFrames{0},
+        classifiedVehicles{0},
+        recognizedPlates{0},
+        attributesBatcher{vehicleAttributesClassifier.batchSize(), cropsMaxWait},
+        platesBatcher{lpr.batchSize(), cropsMaxWait},
+        channelsTracking(inputChannels.size())
     {
         assert(inputChannels.size() == gridParam.size());
         std::vector<InferRequest> detectorInferRequests;
@@ -127,12 +224,20 @@ struct Context {  // stores all global data for tasks
         detectorsInfers.assign(detectorInferRequests);
         attributesInfers.assign(attributesInferRequests);
         platesInfers.assign(lprInferRequests);
+        // the captures start reading right away, the Readers parked by waitKey() are notified about the frames
+        for (unsigned sourceID = 0; sourceID < inputChannels.size(); sourceID++) {
+            const void* key = &readersContext.lastCapturedFrameIds[sourceID];
+            readersContext.captures.emplace_back(new ChannelCapture(inputChannels[sourceID], [this, key]{
+                tryNotify(readersContext.readersWorker, key);
+            }));
+        }
     }
     struct {
         std::vector<std::shared_ptr<InputChannel>> inputChannels;
         std::weak_ptr<Worker> readersWorker;
         std::vector<int64_t> lastCapturedFrameIds;
-        std::vector<std::mutex> lastCapturedFrameIdsMutexes;
+        std::vector<std::mutex> lastCapturedFrameIdsMutexes;  // keep the Readers of a channel in the frameId order
+        std::vector<std::unique_ptr<ChannelCapture>> captures;  // read the channels, Readers only take the frames
     } readersContext;
     struct {
         Detector detector;
@@ -147,7 +252,7 @@ struct Context {  // stores all global data for tasks
         DrawersContext(int pause, const std::vector<cv::Size>& gridParam, cv::Size displayResolution, std::chrono::steady_clock::duration showPeriod,
                        const std::weak_ptr<Worker>& drawersWorker, const std::string& monitorsStr):
             pause{pause}, gridParam{gridParam}, displayResolution{displayResolution}, showPeriod{showPeriod}, drawersWorker{drawersWorker},
-            lastShownframeId{0}, prevShow{std::chrono::steady_clock::time_point()}, framesAfterUpdate{0}, updateTime{std::chrono::steady_clock::time_point()},
+            lastShownframeId{0}, isShowing{false}, prevShow{std::chrono::steady_clock::time_point()}, framesAfterUpdate{0}, updateTime{std::chrono::steady_clock::time_point()},
             presenter{monitorsStr,
                 GridMat(gridParam, displayResolution).outimg.rows - 70,
                 cv::Size{GridMat(gridParam, displayResolution).outimg.cols / 4, 60}} {}
@@ -157,8 +262,12 @@ struct Context {  // stores all global data for tasks
         std::chrono::steady_clock::duration showPeriod;  // desiered frequency of imshow
         std::weak_ptr<Worker> drawersWorker;
         int64_t lastShownframeId;
+        // the first grid is being shown outside of drawerMutex, the other Drawers keep composing the next grid
+        bool isShowing;
         std::chrono::steady_clock::time_point prevShow;  // time stamp of previous imshow
-        std::map<int64_t, GridMat> gridMats;
+        // grids of the frames being drawn ordered by frameId, the shown one is moved to the end to be reused. The
+        // Drawers fill their cells without drawerMutex, so one grid is composed while the previous one is shown
+        std::list<std::pair<int64_t, GridMat>> gridMats;
         std::mutex drawerMutex;
         std::ostringstream outThroughput;
         unsigned framesAfterUpdate;
@@ -176,7 +285,17 @@ struct Context {  // stores all global data for tasks
     std::chrono::steady_clock::time_point t0;
     std::atomic<std::vector<InferRequest>::size_type> freeDetectionInfersCount;
     std::atomic<uint64_t> frameCounter;
+    // for -report
+    std::vector<std::atomic<uint64_t>> readFrames;
+    std::vector<LatencyHistogram> captureLatencies;
+    std::vector<std::mutex> captureLatenciesMutexes;
+    std::atomic<uint64_t> detectedFrames;
+    std::atomic<uint64_t> classifiedVehicles;
+    std::atomic<uint64_t> recognizedPlates;
     InferRequestsContainer detectorsInfers, attributesInfers, platesInfers;
+    CropBatcher attributesBatcher, platesBatcher;
+    std::vector<ChannelTracking> channelsTracking;
+    std::unique_ptr<ResultsSink> resultsSink;  // for -results
 };
 
 class ReborningVideoFrame: public VideoFrame {
@@ -193,6 +312,9 @@ public:
         Task{sharedVideoFrame, 1.0} {}
     bool isReady() override;
     void process() override;
+    const char* name() const override {
+        return "Drawer";
+    }
 };
 
 class ResAggregator: public Task {  // draws results on the frame
@@ -203,68 +325,126 @@ public:
         return true;
     }
     void process() override;
+    const char* name() const override {
+        return "ResAggregator";
+    }
 private:
     std::list<BboxAndDescr> boxesAndDescrs;
 };
 
 class ClassifiersAggreagator {  // waits for all classifiers and recognisers accumulating results
 public:
-    std::string rawDetections;
-    ConcurrentContainer<std::list<std::string>> rawAttributes;
-    ConcurrentContainer<std::list<std::string>> rawDecodedPlates;
-
     explicit ClassifiersAggreagator(const VideoFrame::Ptr& sharedVideoFrame):
-        sharedVideoFrame{sharedVideoFrame} {}
+        sharedVideoFrame{sharedVideoFrame},
+        rawReport{FLAGS_r && (static_cast<ReborningVideoFrame*>(sharedVideoFrame.get())->context.isVideo
+            || 0 == sharedVideoFrame->frameId) ? new RawReport : nullptr} {}
     ~ClassifiersAggreagator() {
-        std::mutex& printMutex = static_cast<ReborningVideoFrame*>(sharedVideoFrame.get())->context.classifiersAggreagatorPrintMutex;
-        printMutex.lock();
-        std::cout << rawDetections;
-        for (const std::string& rawAttribute : rawAttributes.container) {  // destructor assures that none uses the container
-            std::cout << rawAttribute;
-        }
-        for (const std::string& rawDecodedPlate : rawDecodedPlates.container) {
-            std::cout << rawDecodedPlate;
+        if (rawReport) {
+            std::lock_guard<std::mutex> lock{
+                static_cast<ReborningVideoFrame*>(sharedVideoFrame.get())->context.classifiersAggreagatorPrintMutex};
+            std::cout << rawReport->detections;
+            for (const std::string& rawAttribute : rawReport->attributes.take()) {  // destructor assures that none pushes
+                std::cout << rawAttribute;
+            }
+            for (const std::string& rawDecodedPlate : rawReport->decodedPlates.take()) {
+                std::cout << rawDecodedPlate;
+            }
         }
-        printMutex.unlock();
         tryPush(static_cast<ReborningVideoFrame*>(sharedVideoFrame.get())->context.resAggregatorsWorker,
-                std::make_shared<ResAggregator>(sharedVideoFrame, std::move(boxesAndDescrs)));
+                std::make_shared<ResAggregator>(sharedVideoFrame, boxesAndDescrs.take()));
     }
     void push(BboxAndDescr&& bboxAndDescr) {
-        boxesAndDescrs.lockedPush_back(std::move(bboxAndDescr));
+        boxesAndDescrs.push(std::move(bboxAndDescr));
+    }
+    // -r output of the frame. The report lines are built by the callables only if the frame is reported, so
+    // nothing is formatted, allocated or locked for the frames without the output
+    bool reportsRaw() const {
+        return static_cast<bool>(rawReport);
+    }
+    void setRawDetections(std::string&& rawDetections) {
+        rawReport->detections = std::move(rawDetections);
+    }
+    template <typename MakeLine>
+    void reportRawAttributes(MakeLine makeLine) {
+        if (rawReport) {
+            rawReport->attributes.push(makeLine());
+        }
+    }
+    template <typename MakeLine>
+    void reportRawDecodedPlate(MakeLine makeLine) {
+        if (rawReport) {
+            rawReport->decodedPlates.push(makeLine());
+        }
     }
     const VideoFrame::Ptr sharedVideoFrame;
 
 private:
-    ConcurrentContainer<std::list<BboxAndDescr>> boxesAndDescrs;
+    struct RawReport {
+        std::string detections;
+        ConcurrentCollector<std::string> attributes;
+        ConcurrentCollector<std::string> decodedPlates;
+    };
+
+    ConcurrentCollector<BboxAndDescr> boxesAndDescrs;
+    const std::unique_ptr<RawReport> rawReport;  // nullptr if the frame isn't reported
 };
 
-class DetectionsProcessor: public Task {  // extracts detections from blob InferRequests and runs classifiers and recognisers
+class DetectionsProcessor: public Task {  // extracts detections from blob InferRequests and passes them to classifiers and recognisers
 public:
     DetectionsProcessor(VideoFrame::Ptr sharedVideoFrame, InferRequest* inferRequest):
-        Task{sharedVideoFrame, 1.0}, inferRequest{inferRequest}, requireGettingNumberOfDetections{true} {}
-    DetectionsProcessor(VideoFrame::Ptr sharedVideoFrame, std::shared_ptr<ClassifiersAggreagator>&& classifiersAggreagator, std::list<cv::Rect>&& vehicleRects,
-    std::list<cv::Rect>&& plateRects):
-        Task{sharedVideoFrame, 1.0}, classifiersAggreagator{std::move(classifiersAggreagator)}, inferRequest{nullptr},
-        vehicleRects{std::move(vehicleRects)}, plateRects{std::move(plateRects)}, requireGettingNumberOfDetections{false} {}
-    bool isReady() override;
+        Task{sharedVideoFrame, 1.0}, inferRequest{inferRequest} {}
+    bool isReady() override {
+        return true;
+    }
     void process() override;
+    const char* name() const override {
+        return "DetectionsProcessor";
+    }
 
 private:
-    std::shared_ptr<ClassifiersAggreagator> classifiersAggreagator;  // when no one stores this object we will draw
     InferRequest* inferRequest;
-    std::list<cv::Rect> vehicleRects;
-    std::list<cv::Rect> plateRects;
-    std::vector<std::reference_wrapper<InferRequest>> reservedAttributesRequests;
-    std::vector<std::reference_wrapper<InferRequest>> reservedLprRequests;
-    bool requireGettingNumberOfDetections;
 };
 
-class InferTask: public Task {  // runs detection
+class ClassifiersBatch: public Task {  // runs a batch of crops accumulated by a CropBatcher
+public:
+    enum class Network {
+        ATTRIBUTES,
+        LPR,
+    };
+    ClassifiersBatch(VideoFrame::Ptr sharedVideoFrame, Network network):
+        Task{sharedVideoFrame, 1.0}, network{network}, inferRequest{nullptr} {}
+    bool isReady() override;  // waits for the batch to fill or time out, parked with nullptr key to be rechecked
+    void process() override;
+    const char* name() const override {
+        return Network::ATTRIBUTES == network ? "VehicleAttributesBatch" : "LprBatch";
+    }
+
+private:
+    Network network;
+    InferRequest* inferRequest;
+    std::vector<ClassifiedCrop> batch;
+};
+
+class InferTask: public Task {  // runs detection or propagates the tracked boxes to the frame
 public:
     explicit InferTask(VideoFrame::Ptr sharedVideoFrame):
-        Task{sharedVideoFrame, 5.0} {}
+        Task{sharedVideoFrame, 5.0}, decision{Decision::UNDECIDED}, inferRequest{nullptr} {}
     bool isReady() override;
+    const void* waitKey() const override;  // detection InferRequests
     void process() override;
+    const char* name() const override {
+        return "InferTask";
+    }
+
+private:
+    enum class Decision {
+        UNDECIDED,
+        DETECT,
+        TRACK,
+    } decision;
+    InferRequest* inferRequest;  // taken by isReady() for process()
+    Decision decide();
+    void track();
 };
 
 class Reader: public Task {
@@ -272,7 +452,11 @@ public:
     explicit Reader(VideoFrame::Ptr sharedVideoFrame):
         Task{sharedVideoFrame, 2.0} {}
     bool isReady() override;
+    const void* waitKey() const override;  // the previous frame of the source
     void process() override;
+    const char* name() const override {
+        return "Reader";
+    }
 };
 
 ReborningVideoFrame::~ReborningVideoFrame() {
@@ -286,19 +470,29 @@ ReborningVideoFrame::~ReborningVideoFrame() {
     } catch (const std::bad_weak_ptr&) {}
 }
 
+std::list<std::pair<int64_t, GridMat>>::iterator findGridMat(std::list<std::pair<int64_t, GridMat>>& gridMats, int64_t frameId) {
+    return std::find_if(gridMats.begin(), gridMats.end(),
+        [frameId](const std::pair<int64_t, GridMat>& gridMat) {return gridMat.first == frameId;});
+}
+
 bool Drawer::isReady() {
     Context& context = static_cast<ReborningVideoFrame*>(sharedVideoFrame.get())->context;
+    // another thread may be showing a frame, this Drawer is checked again after it
+    std::unique_lock<std::mutex> lock{context.drawersContext.drawerMutex, std::try_to_lock};
+    if (!lock.owns_lock()) {
+        return false;
+    }
     std::chrono::steady_clock::time_point prevShow = context.drawersContext.prevShow;
     std::chrono::steady_clock::duration showPeriod = context.drawersContext.showPeriod;
     if (1u == context.drawersContext.gridParam.size()) {
-        if (std::chrono::steady_clock::now() - prevShow > showPeriod) {
+        if (!context.drawersContext.isShowing && std::chrono::steady_clock::now() - prevShow > showPeriod) {
             return true;
         } else {
             return false;
         }
     } else {
-        std::map<int64_t, GridMat>& gridMats = context.drawersContext.gridMats;
-        auto gridMatIt = gridMats.find(sharedVideoFrame->frameId);
+        std::list<std::pair<int64_t, GridMat>>& gridMats = context.drawersContext.gridMats;
+        auto gridMatIt = findGridMat(gridMats, sharedVideoFrame->frameId);
         if (gridMats.end() == gridMatIt) {
             if (2 > gridMats.size()) {  // buffer size
                 return true;
@@ -306,7 +500,7 @@ bool Drawer::isReady() {
                 return false;
             }
         } else {
-            if (1u == gridMatIt->second.getUnupdatedSourceIDs().size()) {
+            if (1u == gridMatIt->second.getUnupdatedCount()) {
                 if (context.drawersContext.lastShownframeId == sharedVideoFrame->frameId
                     && std::chrono::steady_clock::now() - prevShow > showPeriod) {
                     return true;
@@ -323,19 +517,28 @@ bool Drawer::isReady() {
 void Drawer::process() {
     const int64_t frameId = sharedVideoFrame->frameId;
     Context& context = static_cast<ReborningVideoFrame*>(sharedVideoFrame.get())->context;
-    std::map<int64_t, GridMat>& gridMats = context.drawersContext.gridMats;
-    context.drawersContext.drawerMutex.lock();
-    auto gridMatIt = gridMats.find(frameId);
+    std::list<std::pair<int64_t, GridMat>>& gridMats = context.drawersContext.gridMats;
+    std::unique_lock<std::mutex> lock{context.drawersContext.drawerMutex};
+    auto gridMatIt = findGridMat(gridMats, frameId);
     if (gridMats.end() == gridMatIt) {
-        gridMatIt = gridMats.emplace(frameId, GridMat(context.drawersContext.gridParam,
-                                                      context.drawersContext.displayResolution)).first;
+        auto nextIt = std::find_if(gridMats.begin(), gridMats.end(),
+            [frameId](const std::pair<int64_t, GridMat>& gridMat) {return gridMat.first > frameId;});
+        gridMatIt = gridMats.emplace(nextIt, frameId, GridMat(context.drawersContext.gridParam,
+                                                              context.drawersContext.displayResolution));
     }
 
-    gridMatIt->second.update(sharedVideoFrame->frame, sharedVideoFrame->sourceID);
+    // the grid isn't reused until its every cell is marked, so it stays in place while the cell is resized
+    GridMat& gridMat = gridMatIt->second;
+    lock.unlock();
+    gridMat.drawCell(sharedVideoFrame->frame, sharedVideoFrame->sourceID);
+    lock.lock();
+    gridMat.markUpdated(sharedVideoFrame->sourceID);
     auto firstGridIt = gridMats.begin();
     int64_t& lastShownframeId = context.drawersContext.lastShownframeId;
-    if (firstGridIt->first == lastShownframeId && firstGridIt->second.isFilled()) {
-        lastShownframeId++;
+    if (!context.drawersContext.isShowing && firstGridIt->first == lastShownframeId && firstGridIt->second.isFilled()) {
+        // no Drawer writes to the filled grid and the fields of the show are used by the showing thread only
+        context.drawersContext.isShowing = true;
+        lock.unlock();
         cv::Mat mat = firstGridIt->second.getMat();
 
         constexpr float OPACITY = 0.6f;
@@ -360,10 +563,11 @@ void Drawer::process() {
         }
         cv::putText(mat, context.drawersContext.outThroughput.str(), cv::Point2f(15, 35), cv::FONT_HERSHEY_TRIPLEX, 0.7, cv::Scalar{255, 255, 255});
 
+        DEMO_FRAME("display");
         context.drawersContext.presenter.drawGraphs(mat);
 
         cv::imshow("Detection results", firstGridIt->second.getMat());
-        context.drawersContext.prevShow = std::chrono::steady_clock::now();
+        const std::chrono::steady_clock::time_point shown = std::chrono::steady_clock::now();
         const int key = cv::waitKey(context.drawersContext.pause);
         if (key == 27 || 'q' == key || 'Q' == key || !context.isVideo) {
             try {
@@ -374,17 +578,47 @@ void Drawer::process() {
         } else {
             context.drawersContext.presenter.handleKey(key);
         }
+        lock.lock();
+        context.drawersContext.prevShow = shown;
+        lastShownframeId++;
+        context.drawersContext.isShowing = false;
         firstGridIt->second.clear();
-        gridMats.emplace((--gridMats.end())->first + 1, firstGridIt->second);
-        gridMats.erase(firstGridIt);
+        firstGridIt->first = gridMats.back().first + 1;
+        gridMats.splice(gridMats.end(), gridMats, firstGridIt);
     }
-    context.drawersContext.drawerMutex.unlock();
+    lock.unlock();
+    tryNotify(context.drawersContext.drawersWorker, nullptr);
 }
 
 void ResAggregator::process() {
     Context& context = static_cast<ReborningVideoFrame*>(sharedVideoFrame.get())->context;
-    context.freeDetectionInfersCount += context.detectorsInfers.inferRequests.lockedSize();
+    context.freeDetectionInfersCount += context.detectorsInfers.freeCount();
     context.frameCounter++;
+    {
+        const unsigned sourceID = sharedVideoFrame->sourceID;
+        const std::chrono::steady_clock::duration latency = std::chrono::steady_clock::now() - sharedVideoFrame->captureTime;
+        std::lock_guard<std::mutex> lock{context.captureLatenciesMutexes[sourceID]};
+        context.captureLatencies[sourceID].add(latency);
+    }
+    if (context.resultsSink) {
+        // the label is 1 for a vehicle, 2 for a plate and 0 for a not classified detection. The detections passed
+        // the threshold, their confidences aren't kept
+        results::Frame frameResults;
+        frameResults.channel = sharedVideoFrame->sourceID;
+        frameResults.frameId = static_cast<uint64_t>(sharedVideoFrame->frameId);
+        frameResults.timestampUs = results::nowUs();
+        for (const BboxAndDescr& bboxAndDescr : boxesAndDescrs) {
+            const cv::Rect& rect = bboxAndDescr.rect;
+            frameResults.addObject(static_cast<float>(rect.x), static_cast<float>(rect.y), static_cast<float>(rect.width),
+                static_cast<float>(rect.height), 1.0f, static_cast<int32_t>(bboxAndDescr.objectType));
+            if (BboxAndDescr::ObjectType::VEHICLE == bboxAndDescr.objectType) {
+                frameResults.addAttribute("attributes", bboxAndDescr.descr);
+            } else if (BboxAndDescr::ObjectType::PLATE == bboxAndDescr.objectType) {
+                frameResults.addAttribute("plate", bboxAndDescr.descr);
+            }
+        }
+        context.resultsSink->push(frameResults);
+    }
     if (!FLAGS_no_show) {
         for (const BboxAndDescr& bboxAndDescr : boxesAndDescrs) {
             switch (bboxAndDescr.objectType) {
@@ -414,173 +648,274 @@ void ResAggregator::process() {
     }
 }
 
-bool DetectionsProcessor::isReady() {
+void DetectionsProcessor::process() {
     Context& context = static_cast<ReborningVideoFrame*>(sharedVideoFrame.get())->context;
-    if (requireGettingNumberOfDetections) {
-        classifiersAggreagator = std::make_shared<ClassifiersAggreagator>(sharedVideoFrame);
-        std::list<Detector::Result> results;
-        if (!(FLAGS_r && ((sharedVideoFrame->frameId == 0 && !context.isVideo) || context.isVideo))) {
-            results = context.inferTasksContext.detector.getResults(*inferRequest, sharedVideoFrame->frame.size());
-        } else {
-            std::ostringstream rawResultsStream;
-            results = context.inferTasksContext.detector.getResults(*inferRequest, sharedVideoFrame->frame.size(), &rawResultsStream);
-            classifiersAggreagator->rawDetections = rawResultsStream.str();
+    std::shared_ptr<ClassifiersAggreagator> classifiersAggreagator = std::make_shared<ClassifiersAggreagator>(sharedVideoFrame);
+    std::list<Detector::Result> results;
+    if (!classifiersAggreagator->reportsRaw()) {
+        results = context.inferTasksContext.detector.getResults(*inferRequest, sharedVideoFrame->frame.size());
+    } else {
+        std::ostringstream rawResultsStream;
+        results = context.inferTasksContext.detector.getResults(*inferRequest, sharedVideoFrame->frame.size(), &rawResultsStream);
+        classifiersAggreagator->setRawDetections(rawResultsStream.str());
+    }
+    context.detectorsInfers.giveBack(*inferRequest);
+    tryNotify(context.inferTasksContext.inferTasksWorker, &context.detectorsInfers);
+    context.detectedFrames++;
+
+    std::vector<std::pair<std::size_t, cv::Rect>> detections;
+    std::vector<float> confidences;
+    detections.reserve(results.size());
+    confidences.reserve(results.size());
+    for (Detector::Result result : results) {
+        switch (result.label) {
+            case 1:
+            {
+                detections.emplace_back(result.label, result.location & cv::Rect{cv::Point(0, 0), sharedVideoFrame->frame.size()});
+                confidences.push_back(result.confidence);
+                break;
+            }
+            case 2:
+            {
+                // expanding a bounding box a bit, better for the license plate recognition
+                result.location.x -= 5;
+                result.location.y -= 5;
+                result.location.width += 10;
+                result.location.height += 10;
+                detections.emplace_back(result.label, result.location & cv::Rect{cv::Point(0, 0), sharedVideoFrame->frame.size()});
+                confidences.push_back(result.confidence);
+                break;
+            }
+            default: throw std::exception();  // must never happen
+                     break;
         }
-        for (Detector::Result result : results) {
-            switch (result.label) {
-                case 1:
-                {
-                    vehicleRects.emplace_back(result.location & cv::Rect{cv::Point(0, 0), sharedVideoFrame->frame.size()});
-                    break;
+    }
+    std::vector<IouTracker::Match> matches;
+    if (FLAGS_det_period > 1) {
+        ChannelTracking& tracking = context.channelsTracking[sharedVideoFrame->sourceID];
+        std::lock_guard<std::mutex> lock{tracking.mutex};
+        DEMO_TASK("track");
+        matches = tracking.tracker.update(sharedVideoFrame->frameId, detections);
+    }
+
+    bool vehiclesPushed = false, platesPushed = false;
+    for (std::size_t i = 0; i < detections.size(); i++) {
+        const bool vehicle = 1 == detections[i].first;
+        const cv::Rect& rect = detections[i].second;
+        if ((vehicle && FLAGS_m_va.empty()) || (!vehicle && FLAGS_m_lpr.empty())) {
+            classifiersAggreagator->push(BboxAndDescr{BboxAndDescr::ObjectType::NONE, rect, ""});
+        } else if (!matches.empty() && !matches[i].classify) {  // the track is described already
+            classifiersAggreagator->push(BboxAndDescr{vehicle ? BboxAndDescr::ObjectType::VEHICLE : BboxAndDescr::ObjectType::PLATE,
+                                                      rect, matches[i].descr});
+        } else if (vehicle) {
+            context.attributesBatcher.push(classifiersAggreagator, rect, matches.empty() ? 0 : matches[i].trackId);
+            vehiclesPushed = true;
+        } else {
+            uint64_t plateReadId = 0;
+            if (0 != FLAGS_lpr_cache && !rect.empty()) {
+                const uint64_t cropHash = PlateCache::hash(sharedVideoFrame->frame(rect));
+                std::string plate;
+                ChannelTracking& tracking = context.channelsTracking[sharedVideoFrame->sourceID];
+                std::lock_guard<std::mutex> lock{tracking.mutex};
+                const PlateCache::Lookup cached = tracking.plateCache.lookup(sharedVideoFrame->frameId, rect, cropHash,
+                                                                             confidences[i], plate, plateReadId);
+                if (PlateCache::Lookup::HIT == cached) {
+                    if (!matches.empty()) {
+                        tracking.tracker.setDescr(matches[i].trackId, plate);
+                    }
+                    classifiersAggreagator->push(BboxAndDescr{BboxAndDescr::ObjectType::PLATE, rect, std::move(plate)});
+                    continue;
                 }
-                case 2:
-                {
-                    // expanding a bounding box a bit, better for the license plate recognition
-                    result.location.x -= 5;
-                    result.location.y -= 5;
-                    result.location.width += 10;
-                    result.location.height += 10;
-                    plateRects.emplace_back(result.location & cv::Rect{cv::Point(0, 0), sharedVideoFrame->frame.size()});
-                    break;
+                if (PlateCache::Lookup::PENDING == cached) {  // the read in flight describes the track
+                    classifiersAggreagator->push(BboxAndDescr{BboxAndDescr::ObjectType::PLATE, rect, ""});
+                    continue;
                 }
-                default: throw std::exception();  // must never happen
-                         break;
             }
+            context.platesBatcher.push(classifiersAggreagator, rect, matches.empty() ? 0 : matches[i].trackId, plateReadId);
+            platesPushed = true;
         }
-        context.detectorsInfers.inferRequests.lockedPush_back(*inferRequest);
-        requireGettingNumberOfDetections = false;
     }
-
-    if ((vehicleRects.empty() || FLAGS_m_va.empty()) && (plateRects.empty() || FLAGS_m_lpr.empty())) {
-        return true;
-    } else {
-        // isReady() is called under mutexes so it is assured that available InferRequests will not be taken, but new InferRequests can come in
-        // acquire as many InferRequests as it is possible or needed
-        InferRequestsContainer& attributesInfers = context.attributesInfers;
-        attributesInfers.inferRequests.mutex.lock();
-        const std::size_t numberOfAttributesInferRequestsAcquired = std::min(vehicleRects.size(), attributesInfers.inferRequests.container.size());
-        reservedAttributesRequests.assign(attributesInfers.inferRequests.container.end() - numberOfAttributesInferRequestsAcquired,
-                                          attributesInfers.inferRequests.container.end());
-        attributesInfers.inferRequests.container.erase(attributesInfers.inferRequests.container.end() - numberOfAttributesInferRequestsAcquired,
-                                                       attributesInfers.inferRequests.container.end());
-        attributesInfers.inferRequests.mutex.unlock();
-
-        InferRequestsContainer& platesInfers = context.platesInfers;
-        platesInfers.inferRequests.mutex.lock();
-        const std::size_t numberOfLprInferRequestsAcquired = std::min(plateRects.size(), platesInfers.inferRequests.container.size());
-        reservedLprRequests.assign(platesInfers.inferRequests.container.end() - numberOfLprInferRequestsAcquired, platesInfers.inferRequests.container.end());
-        platesInfers.inferRequests.container.erase(platesInfers.inferRequests.container.end() - numberOfLprInferRequestsAcquired,
-                                                   platesInfers.inferRequests.container.end());
-        platesInfers.inferRequests.mutex.unlock();
-        return numberOfAttributesInferRequestsAcquired || numberOfLprInferRequestsAcquired;
+    if (vehiclesPushed) {
+        tryPush(context.detectionsProcessorsContext.detectionsProcessorsWorker,
+                std::make_shared<ClassifiersBatch>(sharedVideoFrame, ClassifiersBatch::Network::ATTRIBUTES));
+    }
+    if (platesPushed) {
+        tryPush(context.detectionsProcessorsContext.detectionsProcessorsWorker,
+                std::make_shared<ClassifiersBatch>(sharedVideoFrame, ClassifiersBatch::Network::LPR));
     }
 }
 
-void DetectionsProcessor::process() {
+void cacheDescr(Context& context, const VideoFrame& videoFrame, uint64_t trackId, const std::string& descr) {
+    ChannelTracking& tracking = context.channelsTracking[videoFrame.sourceID];
+    std::lock_guard<std::mutex> lock{tracking.mutex};
+    tracking.tracker.setDescr(trackId, descr);
+}
+
+bool ClassifiersBatch::isReady() {
     Context& context = static_cast<ReborningVideoFrame*>(sharedVideoFrame.get())->context;
-    if (!FLAGS_m_va.empty()) {
-        auto vehicleRectsIt = vehicleRects.begin();
-        for (auto attributesRequestIt = reservedAttributesRequests.begin(); attributesRequestIt != reservedAttributesRequests.end();
-                vehicleRectsIt++, attributesRequestIt++) {
-            const cv::Rect vehicleRect = *vehicleRectsIt;
-            InferRequest& attributesRequest = *attributesRequestIt;
-            context.detectionsProcessorsContext.vehicleAttributesClassifier.setImage(attributesRequest, sharedVideoFrame->frame, vehicleRect);
-
-            attributesRequest.SetCompletionCallback(
-                std::bind(
-                    [](std::shared_ptr<ClassifiersAggreagator> classifiersAggreagator,
-                        InferRequest& attributesRequest,
-                        cv::Rect rect,
-                        Context& context) {
-                            attributesRequest.SetCompletionCallback([]{});  // destroy the stored bind object
+    CropBatcher& batcher = Network::ATTRIBUTES == network ? context.attributesBatcher : context.platesBatcher;
+    InferRequestsContainer& infers = Network::ATTRIBUTES == network ? context.attributesInfers : context.platesInfers;
+    if (batcher.empty()) {
+        return true;  // another ClassifiersBatch took the crops, nothing to do
+    }
+    inferRequest = batcher.take(infers, batch);
+    return nullptr != inferRequest;
+}
 
+void ClassifiersBatch::process() {
+    if (nullptr == inferRequest) {
+        return;
+    }
+    Context& context = static_cast<ReborningVideoFrame*>(sharedVideoFrame.get())->context;
+    if (Network::ATTRIBUTES == network) {
+        for (std::size_t batchIdx = 0; batchIdx < batch.size(); batchIdx++) {
+            context.detectionsProcessorsContext.vehicleAttributesClassifier.setImage(*inferRequest,
+                batch[batchIdx].classifiersAggreagator->sharedVideoFrame->frame, batch[batchIdx].rect, batchIdx);
+        }
+        inferRequest->SetCompletionCallback(
+            std::bind(
+                [](std::vector<ClassifiedCrop> batch,
+                    InferRequest& attributesRequest,
+                    Context& context) {
+                        attributesRequest.SetCompletionCallback([]{});  // destroy the stored bind object
+
+                        for (std::size_t batchIdx = 0; batchIdx < batch.size(); batchIdx++) {
+                            const std::shared_ptr<ClassifiersAggreagator>& classifiersAggreagator = batch[batchIdx].classifiersAggreagator;
                             const std::pair<std::string, std::string>& attributes
-                                = context.detectionsProcessorsContext.vehicleAttributesClassifier.getResults(attributesRequest);
-
-                            if (FLAGS_r && ((classifiersAggreagator->sharedVideoFrame->frameId == 0 && !context.isVideo) || context.isVideo)) {
-                                classifiersAggreagator->rawAttributes.lockedPush_back("Vehicle Attributes results:" + attributes.first + ';'
-                                                                                      + attributes.second + '\n');
+                                = context.detectionsProcessorsContext.vehicleAttributesClassifier.getResults(attributesRequest, batchIdx);
+
+                            classifiersAggreagator->reportRawAttributes([&attributes] {
+                                return "Vehicle Attributes results:" + attributes.first + ';' + attributes.second + '\n';
+                            });
+                            const std::string descr = attributes.first + ' ' + attributes.second;
+                            if (0 != batch[batchIdx].trackId) {
+                                cacheDescr(context, *classifiersAggreagator->sharedVideoFrame, batch[batchIdx].trackId, descr);
                             }
-                            classifiersAggreagator->push(BboxAndDescr{BboxAndDescr::ObjectType::VEHICLE, rect, attributes.first + ' ' + attributes.second});
-                            context.attributesInfers.inferRequests.lockedPush_back(attributesRequest);
-                        }, classifiersAggreagator,
-                           std::ref(attributesRequest),
-                           vehicleRect,
-                           std::ref(context)));
-
-            attributesRequest.StartAsync();
-        }
-        vehicleRects.erase(vehicleRects.begin(), vehicleRectsIt);
+                            classifiersAggreagator->push(BboxAndDescr{BboxAndDescr::ObjectType::VEHICLE, batch[batchIdx].rect, descr});
+                        }
+                        context.classifiedVehicles += batch.size();
+                        batch.clear();  // release the frames before the InferRequest is taken again
+                        context.attributesInfers.giveBack(attributesRequest);
+                        tryNotify(context.detectionsProcessorsContext.detectionsProcessorsWorker, nullptr);
+                    }, std::move(batch),
+                       std::ref(*inferRequest),
+                       std::ref(context)));
     } else {
-        for (const cv::Rect vehicleRect : vehicleRects) {
-            classifiersAggreagator->push(BboxAndDescr{BboxAndDescr::ObjectType::NONE, vehicleRect, ""});
+        for (std::size_t batchIdx = 0; batchIdx < batch.size(); batchIdx++) {
+            context.detectionsProcessorsContext.lpr.setImage(*inferRequest,
+                batch[batchIdx].classifiersAggreagator->sharedVideoFrame->frame, batch[batchIdx].rect, batchIdx);
         }
-        vehicleRects.clear();
+        inferRequest->SetCompletionCallback(
+            std::bind(
+                [](std::vector<ClassifiedCrop> batch,
+                    InferRequest& lprRequest,
+                    Context& context) {
+                        lprRequest.SetCompletionCallback([]{});  // destroy the stored bind object
+
+                        for (std::size_t batchIdx = 0; batchIdx < batch.size(); batchIdx++) {
+                            const std::shared_ptr<ClassifiersAggreagator>& classifiersAggreagator = batch[batchIdx].classifiersAggreagator;
+                            std::string result = context.detectionsProcessorsContext.lpr.getResults(lprRequest, batchIdx);
+
+                            classifiersAggreagator->reportRawDecodedPlate([&result] {
+                                return "License Plate Recognition results:" + result + '\n';
+                            });
+                            if (0 != batch[batchIdx].trackId) {
+                                cacheDescr(context, *classifiersAggreagator->sharedVideoFrame, batch[batchIdx].trackId, result);
+                            }
+                            if (0 != batch[batchIdx].plateReadId) {
+                                ChannelTracking& tracking = context.channelsTracking[classifiersAggreagator->sharedVideoFrame->sourceID];
+                                std::lock_guard<std::mutex> lock{tracking.mutex};
+                                tracking.plateCache.store(batch[batchIdx].plateReadId, result);
+                            }
+                            classifiersAggreagator->push(BboxAndDescr{BboxAndDescr::ObjectType::PLATE, batch[batchIdx].rect, std::move(result)});
+                        }
+                        context.recognizedPlates += batch.size();
+                        batch.clear();  // release the frames before the InferRequest is taken again
+                        context.platesInfers.giveBack(lprRequest);
+                        tryNotify(context.detectionsProcessorsContext.detectionsProcessorsWorker, nullptr);
+                    }, std::move(batch),
+                       std::ref(*inferRequest),
+                       std::ref(context)));
     }
+    inferRequest->StartAsync();
 
-    if (!FLAGS_m_lpr.empty()) {
-        auto plateRectsIt = plateRects.begin();
-        for (auto lprRequestsIt = reservedLprRequests.begin(); lprRequestsIt != reservedLprRequests.end(); plateRectsIt++, lprRequestsIt++) {
-            const cv::Rect plateRect = *plateRectsIt;
-            InferRequest& lprRequest = *lprRequestsIt;
-            context.detectionsProcessorsContext.lpr.setImage(lprRequest, sharedVideoFrame->frame, plateRect);
-
-            lprRequest.SetCompletionCallback(
-                std::bind(
-                    [](std::shared_ptr<ClassifiersAggreagator> classifiersAggreagator,
-                        InferRequest& lprRequest,
-                        cv::Rect rect,
-                        Context& context) {
-                            lprRequest.SetCompletionCallback([]{});  // destroy the stored bind object
-
-                            std::string result = context.detectionsProcessorsContext.lpr.getResults(lprRequest);
+    CropBatcher& batcher = Network::ATTRIBUTES == network ? context.attributesBatcher : context.platesBatcher;
+    if (!batcher.empty()) {  // the crops which didn't fit into the batch
+        tryPush(context.detectionsProcessorsContext.detectionsProcessorsWorker,
+                std::make_shared<ClassifiersBatch>(sharedVideoFrame, network));
+    }
+}
 
-                            if (FLAGS_r && ((classifiersAggreagator->sharedVideoFrame->frameId == 0 && !context.isVideo) || context.isVideo)) {
-                                classifiersAggreagator->rawDecodedPlates.lockedPush_back("License Plate Recognition results:" + result + '\n');
-                            }
-                            classifiersAggreagator->push(BboxAndDescr{BboxAndDescr::ObjectType::PLATE, rect, std::move(result)});
-                            context.platesInfers.inferRequests.lockedPush_back(lprRequest);
-                        }, classifiersAggreagator,
-                           std::ref(lprRequest),
-                           plateRect,
-                           std::ref(context)));
+InferTask::Decision InferTask::decide() {
+    if (1 == FLAGS_det_period) {
+        return Decision::DETECT;
+    }
+    Context& context = static_cast<ReborningVideoFrame*>(sharedVideoFrame.get())->context;
+    cv::Mat thumbnail;
+    if (FLAGS_det_motion > 0) {
+        cv::resize(sharedVideoFrame->frame, thumbnail, cv::Size{64, 36}, 0, 0, cv::INTER_AREA);
+        cv::cvtColor(thumbnail, thumbnail, cv::COLOR_BGR2GRAY);
+    }
+    ChannelTracking& tracking = context.channelsTracking[sharedVideoFrame->sourceID];
+    std::lock_guard<std::mutex> lock{tracking.mutex};
+    bool detect = tracking.lastDetectedFrameId < 0
+        || sharedVideoFrame->frameId - tracking.lastDetectedFrameId >= static_cast<int64_t>(FLAGS_det_period);
+    if (!detect && !thumbnail.empty() && !tracking.lastDetectedThumbnail.empty()
+            && sharedVideoFrame->frameId > tracking.lastDetectedFrameId) {
+        detect = cv::norm(thumbnail, tracking.lastDetectedThumbnail, cv::NORM_L1) / thumbnail.total() > FLAGS_det_motion;
+    }
+    if (!detect) {
+        return Decision::TRACK;
+    }
+    tracking.lastDetectedFrameId = sharedVideoFrame->frameId;
+    tracking.lastDetectedThumbnail = thumbnail;
+    return Decision::DETECT;
+}
 
-            lprRequest.StartAsync();
+void InferTask::track() {
+    Context& context = static_cast<ReborningVideoFrame*>(sharedVideoFrame.get())->context;
+    std::shared_ptr<ClassifiersAggreagator> classifiersAggreagator = std::make_shared<ClassifiersAggreagator>(sharedVideoFrame);
+    ChannelTracking& tracking = context.channelsTracking[sharedVideoFrame->sourceID];
+    std::lock_guard<std::mutex> lock{tracking.mutex};
+    for (const IouTracker::Track& track : tracking.tracker.getTracks()) {
+        const cv::Rect rect = IouTracker::predict(track, sharedVideoFrame->frameId)
+            & cv::Rect{cv::Point(0, 0), sharedVideoFrame->frame.size()};
+        if (rect.empty()) {
+            continue;
         }
-        plateRects.erase(plateRects.begin(), plateRectsIt);
-    } else {
-        for (const cv::Rect& plateRect : plateRects) {
-            classifiersAggreagator->push(BboxAndDescr{BboxAndDescr::ObjectType::NONE, plateRect, ""});
+        BboxAndDescr::ObjectType objectType = BboxAndDescr::ObjectType::NONE;
+        if (1 == track.label && !FLAGS_m_va.empty()) {
+            objectType = BboxAndDescr::ObjectType::VEHICLE;
+        } else if (2 == track.label && !FLAGS_m_lpr.empty()) {
+            objectType = BboxAndDescr::ObjectType::PLATE;
         }
-        plateRects.clear();
-    }
-    if (!vehicleRects.empty() || !plateRects.empty()) {
-        tryPush(context.detectionsProcessorsContext.detectionsProcessorsWorker,
-            std::make_shared<DetectionsProcessor>(sharedVideoFrame, std::move(classifiersAggreagator), std::move(vehicleRects), std::move(plateRects)));
+        classifiersAggreagator->push(BboxAndDescr{objectType, rect, track.descr});
     }
 }
 
 bool InferTask::isReady() {
-    InferRequestsContainer& detectorsInfers = static_cast<ReborningVideoFrame*>(sharedVideoFrame.get())->context.detectorsInfers;
-    if (detectorsInfers.inferRequests.container.empty()) {
-        return false;
-    } else {
-        detectorsInfers.inferRequests.mutex.lock();
-        if (detectorsInfers.inferRequests.container.empty()) {
-            detectorsInfers.inferRequests.mutex.unlock();
-            return false;
-        } else {
-            return true;  // process() will unlock the mutex
-        }
+    if (Decision::UNDECIDED == decision) {
+        decision = decide();
+    }
+    if (Decision::TRACK == decision) {
+        return true;
     }
+    // process() uses the taken InferRequest
+    return nullptr != inferRequest
+        || static_cast<ReborningVideoFrame*>(sharedVideoFrame.get())->context.detectorsInfers.tryTake(inferRequest);
+}
+
+const void* InferTask::waitKey() const {
+    return &static_cast<ReborningVideoFrame*>(sharedVideoFrame.get())->context.detectorsInfers;
 }
 
 void InferTask::process() {
+    if (Decision::TRACK == decision) {
+        track();  // the ClassifiersAggreagator passes the boxes on when track() releases it
+        return;
+    }
     Context& context = static_cast<ReborningVideoFrame*>(sharedVideoFrame.get())->context;
-    InferRequestsContainer& detectorsInfers = context.detectorsInfers;
-    std::reference_wrapper<InferRequest> inferRequest = detectorsInfers.inferRequests.container.back();
-    detectorsInfers.inferRequests.container.pop_back();
-    detectorsInfers.inferRequests.mutex.unlock();
+    std::reference_wrapper<InferRequest> inferRequest = *this->inferRequest;
 
     context.inferTasksContext.detector.setImage(inferRequest, sharedVideoFrame->frame);
 
@@ -602,7 +937,9 @@ void InferTask::process() {
 bool Reader::isReady() {
     Context& context = static_cast<ReborningVideoFrame*>(sharedVideoFrame.get())->context;
     context.readersContext.lastCapturedFrameIdsMutexes[sharedVideoFrame->sourceID].lock();
-    if (context.readersContext.lastCapturedFrameIds[sharedVideoFrame->sourceID] + 1 == sharedVideoFrame->frameId) {
+    // the capture thread notifies waitKey() when its frame is ready
+    if (context.readersContext.lastCapturedFrameIds[sharedVideoFrame->sourceID] + 1 == sharedVideoFrame->frameId
+            && context.readersContext.captures[sharedVideoFrame->sourceID]->isReady()) {
         return true;
     } else {
         context.readersContext.lastCapturedFrameIdsMutexes[sharedVideoFrame->sourceID].unlock();
@@ -610,17 +947,24 @@ bool Reader::isReady() {
     }
 }
 
+const void* Reader::waitKey() const {
+    Context& context = static_cast<ReborningVideoFrame*>(sharedVideoFrame.get())->context;
+    return &context.readersContext.lastCapturedFrameIds[sharedVideoFrame->sourceID];
+}
+
 void Reader::process() {
     unsigned sourceID = sharedVideoFrame->sourceID;
     Context& context = static_cast<ReborningVideoFrame*>(sharedVideoFrame.get())->context;
-    const std::vector<std::shared_ptr<InputChannel>>& inputChannels = context.readersContext.inputChannels;
-    if (inputChannels[sourceID]->read(sharedVideoFrame->frame)) {
+    if (context.readersContext.captures[sourceID]->take(sharedVideoFrame->frame, sharedVideoFrame->captureTime)) {
+        context.readFrames[sourceID]++;
         context.readersContext.lastCapturedFrameIds[sourceID]++;
         context.readersContext.lastCapturedFrameIdsMutexes[sourceID].unlock();
+        tryNotify(context.readersContext.readersWorker, waitKey());
         tryPush(context.inferTasksContext.inferTasksWorker, std::make_shared<InferTask>(sharedVideoFrame));
     } else {
         context.readersContext.lastCapturedFrameIds[sourceID]++;
         context.readersContext.lastCapturedFrameIdsMutexes[sourceID].unlock();
+        tryNotify(context.readersContext.readersWorker, waitKey());
         try {
             std::shared_ptr<Worker>(context.drawersContext.drawersWorker)->stop();
         } catch (const std::bad_weak_ptr&) {}
@@ -646,6 +990,7 @@ int main(int argc, char* argv[]) {
         if (files.empty() && 0 == FLAGS_nc) throw std::logic_error("No inputs were found");
         std::vector<std::shared_ptr<VideoCaptureSource>> videoCapturSourcess;
         std::vector<std::shared_ptr<ImageSource>> imageSourcess;
+        std::vector<std::shared_ptr<ReplaySource>> replaySources;
         if (FLAGS_nc) {
             for (size_t i = 0; i < FLAGS_nc; ++i) {
                 cv::VideoCapture videoCapture(i);
@@ -657,10 +1002,14 @@ int main(int argc, char* argv[]) {
                 videoCapture.set(cv::CAP_PROP_BUFFERSIZE , 1);
                 videoCapture.set(cv::CAP_PROP_FRAME_WIDTH, 640);
                 videoCapture.set(cv::CAP_PROP_FRAME_HEIGHT, 480);
-                videoCapturSourcess.push_back(std::make_shared<VideoCaptureSource>(videoCapture, FLAGS_loop_video));
+                videoCapturSourcess.push_back(std::make_shared<VideoCaptureSource>(videoCapture, FLAGS_loop_video, true));
             }
         }
         for (const std::string& file : files) {
+            if (capture_recording::isRecording(file)) {
+                replaySources.push_back(std::make_shared<ReplaySource>(file, !FLAGS_replay_fast, FLAGS_loop_video));
+                continue;
+            }
             cv::Mat frame = cv::imread(file, cv::IMREAD_COLOR);
             if (frame.empty()) {
                 cv::VideoCapture videoCapture(file);
@@ -673,15 +1022,25 @@ int main(int argc, char* argv[]) {
                 imageSourcess.push_back(std::make_shared<ImageSource>(frame, true));
             }
         }
-        uint32_t channelsNum = 0 == FLAGS_ni ? videoCapturSourcess.size() + imageSourcess.size() : FLAGS_ni;
         std::vector<std::shared_ptr<IInputSource>> inputSources;
-        inputSources.reserve(videoCapturSourcess.size() + imageSourcess.size());
+        inputSources.reserve(videoCapturSourcess.size() + replaySources.size() + imageSourcess.size());
         for (const std::shared_ptr<VideoCaptureSource>& videoSource : videoCapturSourcess) {
             inputSources.push_back(videoSource);
         }
+        for (const std::shared_ptr<ReplaySource>& replaySource : replaySources) {
+            inputSources.push_back(replaySource);
+        }
         for (const std::shared_ptr<ImageSource>& imageSource : imageSourcess) {
             inputSources.push_back(imageSource);
         }
+        uint32_t channelsNum = 0 == FLAGS_ni ? inputSources.size() : FLAGS_ni;
+        if (!FLAGS_record.empty()) {
+            for (std::size_t i = 0; i < inputSources.size(); i++) {
+                const std::string path = FLAGS_record + "/input" + std::to_string(i) + ".caprec";
+                slog::info << "Recording input " << i << " to " << path << slog::endl;
+                inputSources[i] = std::make_shared<RecordingSource>(inputSources[i], path);
+            }
+        }
 
         std::vector<std::shared_ptr<InputChannel>> inputChannels;
         inputChannels.reserve(channelsNum);
@@ -689,7 +1048,7 @@ int main(int argc, char* argv[]) {
             if (inputSources.size() == channelI) {
                 channelI = 0;
             }
-            inputChannels.push_back(InputChannel::create(inputSources[channelI]));
+            inputChannels.push_back(InputChannel::create(inputSources[channelI], FLAGS_n_iqs));
         }
 
         // -----------------------------------------------------------------------------------------------------
@@ -766,25 +1125,63 @@ int main(int argc, char* argv[]) {
             return config;
         };
 
+        /** Splitting the CPU between the networks **/
+        CpuPlan cpuPlan{FLAGS_nthreads};
+        if (!FLAGS_cpu_weights.empty()) {
+            std::vector<float> weights = CpuPlan::parseWeights(FLAGS_cpu_weights);
+            const std::vector<std::pair<std::string, std::string>> networks{
+                {"Detect", FLAGS_d}, {"Attr", FLAGS_m_va.empty() ? "" : FLAGS_d_va}, {"LPR", FLAGS_m_lpr.empty() ? "" : FLAGS_d_lpr}};
+            if (weights.size() != networks.size()) {
+                throw std::logic_error("-cpu_weights must have a weight for each of the detection, Vehicle Attributes and LPR models");
+            }
+            for (std::size_t i = 0; i < networks.size(); i++) {
+                cpuPlan.add(networks[i].first, networks[i].second, weights[i]);
+            }
+            cpuPlan.report();
+        }
+        auto makeNetworkConfig = [&](const std::string &deviceName, const std::string &suffix) {
+            std::map<std::string, std::string> config = makeTagConfig(deviceName, suffix);
+            for (const auto& item : cpuPlan.config(suffix)) {
+                config.insert(item);
+            }
+            return config;
+        };
+
         // -----------------------------------------------------------------------------------------------------
         unsigned nireq = FLAGS_nireq == 0 ? inputChannels.size() : FLAGS_nireq;
+        // the detector, the attributes classifier and the LPR, their configs and request numbers are set up front
+        ParallelLoader loader;
         slog::info << "Loading detection model to the "<< FLAGS_d << " plugin" << slog::endl;
-        Detector detector(ie, FLAGS_d, FLAGS_m,
-            {static_cast<float>(FLAGS_t), static_cast<float>(FLAGS_t)}, FLAGS_auto_resize, makeTagConfig(FLAGS_d, "Detect"));
+        Detector detector;
+        const std::map<std::string, std::string> detectorConfig = makeNetworkConfig(FLAGS_d, "Detect");
+        loader.add("Detect", [&]() {
+            detector = Detector(ie, FLAGS_d, FLAGS_m,
+                {static_cast<float>(FLAGS_t), static_cast<float>(FLAGS_t)}, FLAGS_auto_resize, detectorConfig,
+                FLAGS_cache_dir);
+        });
         VehicleAttributesClassifier vehicleAttributesClassifier;
         std::size_t nclassifiersireq{0};
         Lpr lpr;
         std::size_t nrecognizersireq{0};
         if (!FLAGS_m_va.empty()) {
             slog::info << "Loading Vehicle Attribs model to the "<< FLAGS_d_va << " plugin" << slog::endl;
-            vehicleAttributesClassifier = VehicleAttributesClassifier(ie, FLAGS_d_va, FLAGS_m_va, FLAGS_auto_resize, makeTagConfig(FLAGS_d_va, "Attr"));
-            nclassifiersireq = nireq * 3;
+            const std::map<std::string, std::string> config = makeNetworkConfig(FLAGS_d_va, "Attr");
+            loader.add("Attr", [&ie, &vehicleAttributesClassifier, config]() {
+                vehicleAttributesClassifier = VehicleAttributesClassifier(ie, FLAGS_d_va, FLAGS_m_va, FLAGS_auto_resize,
+                                                                          config, FLAGS_bs_va, FLAGS_cache_dir);
+            });
+            nclassifiersireq = 0 == FLAGS_nireq_va ? nireq * 3 : FLAGS_nireq_va;
         }
         if (!FLAGS_m_lpr.empty()) {
             slog::info << "Loading Licence Plate Recognition (LPR) model to the "<< FLAGS_d_lpr << " plugin" << slog::endl;
-            lpr = Lpr(ie, FLAGS_d_lpr, FLAGS_m_lpr, FLAGS_auto_resize, makeTagConfig(FLAGS_d_lpr, "LPR"));
-            nrecognizersireq = nireq * 3;
+            const std::map<std::string, std::string> config = makeNetworkConfig(FLAGS_d_lpr, "LPR");
+            loader.add("LPR", [&ie, &lpr, config]() {
+                lpr = Lpr(ie, FLAGS_d_lpr, FLAGS_m_lpr, FLAGS_auto_resize, config, FLAGS_bs_lpr, FLAGS_cache_dir);
+            });
+            nrecognizersireq = 0 == FLAGS_nireq_lpr ? nireq * 3 : FLAGS_nireq_lpr;
         }
+        loader.run();
+        loader.report();
         std::shared_ptr<Worker> worker = std::make_shared<Worker>(FLAGS_n_wt - 1);
         bool isVideo = imageSourcess.empty() ? true : false;
         int pause = imageSourcess.empty() ? 1 : 0;
@@ -820,7 +1217,11 @@ int main(int argc, char* argv[]) {
                         worker,
                         nireq,
                         isVideo,
-                        nclassifiersireq, nrecognizersireq};
+                        nclassifiersireq, nrecognizersireq,
+                        std::chrono::milliseconds{FLAGS_crops_max_wait}};
+        if (!FLAGS_results.empty()) {
+            context.resultsSink.reset(new ResultsSink(FLAGS_results));
+        }
 
         for (uint64_t i = 0; i < FLAGS_n_iqs; i++) {
             for (unsigned sourceID = 0; sourceID < inputChannels.size(); sourceID++) {
@@ -839,10 +1240,83 @@ int main(int argc, char* argv[]) {
         const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
         context.t0 = t0;
         context.drawersContext.updateTime = t0;
+        auto takeSnapshot = [&]() {
+            ReportSnapshot snapshot{std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count(), {}, {},
+                context.detectedFrames, context.classifiedVehicles, context.recognizedPlates, worker->getStats()};
+            for (std::size_t i = 0; i < inputChannels.size(); i++) {
+                snapshot.readFrames.push_back(context.readFrames[i]);
+                snapshot.queuedFrames.push_back(inputChannels[i]->queueSize());
+                std::lock_guard<std::mutex> lock{context.captureLatenciesMutexes[i]};
+                snapshot.captureLatencies.push_back(context.captureLatencies[i]);
+            }
+            return snapshot;
+        };
+        std::unique_ptr<ReportWriter> reportWriter;
+        std::mutex reportMutex;
+        std::condition_variable reportCondVar;
+        bool reportStop = false;
+        std::thread reportThread;
+        if (!FLAGS_report.empty()) {
+            reportWriter.reset(new ReportWriter(FLAGS_report));
+            if (0 != FLAGS_report_period) {
+                reportThread = std::thread([&]() {
+                    ReportSnapshot previous = takeSnapshot();
+                    std::unique_lock<std::mutex> lock{reportMutex};
+                    while (!reportCondVar.wait_for(lock, std::chrono::seconds{FLAGS_report_period}, [&]{return reportStop;})) {
+                        ReportSnapshot snapshot = takeSnapshot();
+                        reportWriter->writeRecord(snapshot, previous, false);
+                        previous = std::move(snapshot);
+                    }
+                });
+            }
+        }
+        auto stopReportThread = [&]() {
+            if (reportThread.joinable()) {
+                {
+                    std::lock_guard<std::mutex> lock{reportMutex};
+                    reportStop = true;
+                }
+                reportCondVar.notify_all();  // the -time thread waits on it too
+                reportThread.join();
+            }
+        };
+        // -time stops the Worker as closing the window does
+        bool timerStop = false;
+        std::thread timerThread;
+        if (0 != FLAGS_time) {
+            timerThread = std::thread([&]() {
+                std::unique_lock<std::mutex> lock{reportMutex};
+                if (!reportCondVar.wait_for(lock, std::chrono::seconds{FLAGS_time}, [&]{return timerStop;})) {
+                    worker->stop();
+                }
+            });
+        }
+        auto stopTimerThread = [&]() {
+            if (timerThread.joinable()) {
+                {
+                    std::lock_guard<std::mutex> lock{reportMutex};
+                    timerStop = true;
+                }
+                reportCondVar.notify_all();
+                timerThread.join();
+            }
+        };
         worker->runThreads();
         worker->threadFunc();
-        worker->join();
+        try {
+            worker->join();
+        } catch (...) {
+            stopTimerThread();
+            stopReportThread();
+            throw;
+        }
+        stopTimerThread();
+        stopReportThread();
         const auto t1 = std::chrono::steady_clock::now();
+        if (reportWriter) {
+            ReportSnapshot start{0.0, std::vector<uint64_t>(inputChannels.size(), 0), {}, 0, 0, 0, {}, {}};
+            reportWriter->writeRecord(takeSnapshot(), start, true);
+        }
 
         std::map<std::string, std::string> mapDevices = getMapFullDevicesNames(ie, {FLAGS_d, FLAGS_d_va, FLAGS_d_lpr});
         for (auto& net : std::array<std::pair<std::vector<InferRequest>, std::string>, 3>{
@@ -868,6 +1342,45 @@ int main(int argc, char* argv[]) {
                 / (frameCounter * context.nireq) * 100;
             std::cout << "Detection InferRequests usage: " << detectionsInfersUsage << "%\n";
         }
+        for (unsigned sourceID = 0; sourceID < inputChannels.size(); sourceID++) {
+            const LatencyHistogram& latency = context.captureLatencies[sourceID];
+            if (0 != latency.getCount()) {
+                std::cout << "Channel " << sourceID << " capture to result latency: " << std::fixed << std::setprecision(1)
+                    << latency.percentile(0.5) << " ms median, " << latency.percentile(0.95) << " ms 95th percentile";
+                const uint64_t droppedFrames = context.readersContext.captures[sourceID]->getDroppedFrames();
+                if (0 != droppedFrames) {
+                    std::cout << ", " << droppedFrames << " frames replaced by newer ones";
+                }
+                std::cout << '\n';
+            }
+        }
+
+        FramePool::Stats poolStats{0, 0, 0};
+        for (const std::shared_ptr<InputChannel>& inputChannel : inputChannels) {
+            const FramePool::Stats channelStats = inputChannel->getPoolStats();
+            poolStats.reused += channelStats.reused;
+            poolStats.allocated += channelStats.allocated;
+            poolStats.dropped += channelStats.dropped;
+        }
+        if (0 != FLAGS_lpr_cache) {
+            PlateCache::Stats cacheStats{0, 0, 0};
+            for (ChannelTracking& tracking : context.channelsTracking) {
+                std::lock_guard<std::mutex> lock{tracking.mutex};
+                cacheStats.hits += tracking.plateCache.getStats().hits;
+                cacheStats.pending += tracking.plateCache.getStats().pending;
+                cacheStats.misses += tracking.plateCache.getStats().misses;
+            }
+            const std::size_t lookups = cacheStats.hits + cacheStats.pending + cacheStats.misses;
+            if (0 != lookups) {
+                std::cout << "License plate cache hit rate: " << std::fixed << std::setprecision(1)
+                    << 100.0 * cacheStats.hits / lookups << "% (" << cacheStats.hits << " / " << lookups
+                    << " plates, " << cacheStats.pending << " waited for a read in flight)\n";
+            }
+        }
+        if (0 != poolStats.reused + poolStats.allocated) {
+            std::cout << "Queued frame buffers: " << poolStats.reused << " reused, " << poolStats.allocated << " allocated, "
+                << poolStats.dropped << " dropped\n";
+        }
 
         std::cout << context.drawersContext.presenter.reportMeans() << '\n';
     } catch (const std::exception& error) {
@@ -13,6 +13,9 @@
 #include <inference_engine.hpp>
 #include <samples/common.hpp>
 #include <samples/ocv_common.hpp>
+#include <samples/slog.hpp>
+#include <samples/mapped_weights.hpp>
+#include <samples/network_cache.hpp>
 
 class Detector {
 public:
@@ -27,9 +30,9 @@ public:
 
     Detector() = default;
     Detector(InferenceEngine::Core& ie, const std::string& deviceName, const std::string& xmlPath, const std::vector<float>& detectionTresholds,
-            const bool autoResize, const std::map<std::string, std::string> & pluginConfig) :
+            const bool autoResize, const std::map<std::string, std::string> & pluginConfig, const std::string& cacheDir = "") :
         detectionTresholds{detectionTresholds}, ie_{ie} {
-        auto network = ie.ReadNetwork(xmlPath);
+        auto network = readNetworkMapped(ie, xmlPath);
         InferenceEngine::InputsDataMap inputInfo(network.getInputsInfo());
         if (inputInfo.size() != 1) {
             throw std::logic_error("Detector should have only one input");
@@ -64,7 +67,7 @@ public:
         }
         _output->setPrecision(InferenceEngine::Precision::FP32);
 
-        net = ie_.LoadNetwork(network, deviceName, pluginConfig);
+        net = loadNetworkCached(ie_, network, xmlPath, deviceName, pluginConfig, cacheDir);
     }
 
     InferenceEngine::InferRequest createInferRequest() {
@@ -129,15 +132,18 @@ class VehicleAttributesClassifier {
 public:
     VehicleAttributesClassifier() = default;
     VehicleAttributesClassifier(InferenceEngine::Core& ie, const std::string & deviceName,
-        const std::string& xmlPath, const bool autoResize, const std::map<std::string, std::string> & pluginConfig) : ie_(ie) {
-        auto network = ie.ReadNetwork(FLAGS_m_va);
+        const std::string& xmlPath, const bool autoResize, const std::map<std::string, std::string> & pluginConfig,
+        std::size_t batchSize = 1, const std::string& cacheDir = "") : ie_(ie) {
+        auto network = readNetworkMapped(ie, xmlPath);
         InferenceEngine::InputsDataMap attributesInputInfo(network.getInputsInfo());
         if (attributesInputInfo.size() != 1) {
             throw std::logic_error("Vehicle Attribs topology should have only one input");
         }
         InferenceEngine::InputInfo::Ptr& attributesInputInfoFirst = attributesInputInfo.begin()->second;
         attributesInputInfoFirst->setPrecision(InferenceEngine::Precision::U8);
-        if (FLAGS_auto_resize) {
+        // crops are passed as ROI blobs of the frame and resized by the plugin, an ROI blob covers a single
+        // crop though, so crops of batches are copied and resized on the CPU
+        if (autoResize && 1 == batchSize) {
             attributesInputInfoFirst->getPreProcess().setResizeAlgorithm(InferenceEngine::ResizeAlgorithm::RESIZE_BILINEAR);
             attributesInputInfoFirst->setLayout(InferenceEngine::Layout::NHWC);
         } else {
@@ -156,14 +162,24 @@ public:
         it->second->setPrecision(InferenceEngine::Precision::FP32);
         outputNameForType = (it)->second->getName();  // type is the second output.
 
-        net = ie_.LoadNetwork(network, deviceName, pluginConfig);
+        if (batchSize > 1) {
+            network.setBatchSize(batchSize);
+        }
+        maxBatchSize = batchSize;
+
+        net = loadNetworkCached(ie_, network, xmlPath, deviceName, pluginConfig, cacheDir);
     }
 
     InferenceEngine::InferRequest createInferRequest() {
         return net.CreateInferRequest();
     }
 
-    void setImage(InferenceEngine::InferRequest& inferRequest, const cv::Mat& img, const cv::Rect vehicleRect) {
+    std::size_t batchSize() const {
+        return maxBatchSize;
+    }
+
+    void setImage(InferenceEngine::InferRequest& inferRequest, const cv::Mat& img, const cv::Rect vehicleRect,
+                  std::size_t batchIndex = 0) {
         InferenceEngine::Blob::Ptr roiBlob = inferRequest.GetBlob(attributesInputName);
         if (InferenceEngine::Layout::NHWC == roiBlob->getTensorDesc().getLayout()) {  // autoResize is set
             InferenceEngine::ROI cropRoi{0, static_cast<size_t>(vehicleRect.x), static_cast<size_t>(vehicleRect.y), static_cast<size_t>(vehicleRect.width),
@@ -173,10 +189,10 @@ public:
             inferRequest.SetBlob(attributesInputName, roiBlob);
         } else {
             const cv::Mat& vehicleImage = img(vehicleRect);
-            matU8ToBlob<uint8_t>(vehicleImage, roiBlob);
+            matU8ToBlob<uint8_t>(vehicleImage, roiBlob, static_cast<int>(batchIndex));
         }
     }
-    std::pair<std::string, std::string> getResults(InferenceEngine::InferRequest& inferRequest) {
+    std::pair<std::string, std::string> getResults(InferenceEngine::InferRequest& inferRequest, std::size_t batchIndex = 0) {
         static const std::string colors[] = {
             "white", "gray", "yellow", "red", "green", "blue", "black"
         };
@@ -185,9 +201,9 @@ public:
         };
 
         // 7 possible colors for each vehicle and we should select the one with the maximum probability
-        auto colorsValues = inferRequest.GetBlob(outputNameForColor)->buffer().as<float*>();
+        auto colorsValues = inferRequest.GetBlob(outputNameForColor)->buffer().as<float*>() + 7 * batchIndex;
         // 4 possible types for each vehicle and we should select the one with the maximum probability
-        auto typesValues  = inferRequest.GetBlob(outputNameForType)->buffer().as<float*>();
+        auto typesValues  = inferRequest.GetBlob(outputNameForType)->buffer().as<float*>() + 4 * batchIndex;
 
         const auto color_id = std::max_element(colorsValues, colorsValues + 7) - colorsValues;
         const auto  type_id = std::max_element(typesValues,  typesValues  + 4) - typesValues;
@@ -195,6 +211,7 @@ public:
     }
 
 private:
+    std::size_t maxBatchSize = 1;
     std::string attributesInputName;
     std::string outputNameForColor;
     std::string outputNameForType;
@@ -206,9 +223,9 @@ class Lpr {
 public:
     Lpr() = default;
     Lpr(InferenceEngine::Core& ie, const std::string & deviceName, const std::string& xmlPath, const bool autoResize,
-        const std::map<std::string, std::string> &pluginConfig) :
+        const std::map<std::string, std::string> &pluginConfig, std::size_t batchSize = 1, const std::string& cacheDir = "") :
         ie_{ie} {
-        auto network = ie.ReadNetwork(FLAGS_m_lpr);
+        auto network = readNetworkMapped(ie, xmlPath);
 
         /** LPR network should have 2 inputs (and second is just a stub) and one output **/
         // ---------------------------Check inputs ------------------------------------------------------
@@ -216,9 +233,15 @@ public:
         if (LprInputInfo.size() != 1 && LprInputInfo.size() != 2) {
             throw std::logic_error("LPR should have 1 or 2 inputs");
         }
+        if (batchSize > 1 && LprInputInfo.size() == 2) {
+            // the sequence input isn't batched
+            slog::warn << "LPR batching is not supported for models with a sequence input, batch size 1 is used" << slog::endl;
+            batchSize = 1;
+        }
         InferenceEngine::InputInfo::Ptr& LprInputInfoFirst = LprInputInfo.begin()->second;
         LprInputInfoFirst->setPrecision(InferenceEngine::Precision::U8);
-        if (FLAGS_auto_resize) {
+        // crops of batches are copied and resized on the CPU, see VehicleAttributesClassifier
+        if (autoResize && 1 == batchSize) {
             LprInputInfoFirst->getPreProcess().setResizeAlgorithm(InferenceEngine::ResizeAlgorithm::RESIZE_BILINEAR);
             LprInputInfoFirst->setLayout(InferenceEngine::Layout::NHWC);
         } else {
@@ -247,14 +270,24 @@ public:
         size_t indexOfSequenceSize = LprInputSeqName == "" ? 2 : 1;
         maxSequenceSizePerPlate = lprOutputInfo->second->getTensorDesc().getDims()[indexOfSequenceSize];
 
-        net = ie_.LoadNetwork(network, deviceName, pluginConfig);
+        if (batchSize > 1) {
+            network.setBatchSize(batchSize);
+        }
+        maxBatchSize = batchSize;
+
+        net = loadNetworkCached(ie_, network, xmlPath, deviceName, pluginConfig, cacheDir);
     }
 
     InferenceEngine::InferRequest createInferRequest() {
         return net.CreateInferRequest();
     }
 
-    void setImage(InferenceEngine::InferRequest& inferRequest, const cv::Mat& img, const cv::Rect plateRect) {
+    std::size_t batchSize() const {
+        return maxBatchSize;
+    }
+
+    void setImage(InferenceEngine::InferRequest& inferRequest, const cv::Mat& img, const cv::Rect plateRect,
+                  std::size_t batchIndex = 0) {
         InferenceEngine::Blob::Ptr roiBlob = inferRequest.GetBlob(LprInputName);
         if (InferenceEngine::Layout::NHWC == roiBlob->getTensorDesc().getLayout()) {  // autoResize is set
             InferenceEngine::ROI cropRoi{0, static_cast<size_t>(plateRect.x), static_cast<size_t>(plateRect.y), static_cast<size_t>(plateRect.width),
@@ -264,7 +297,7 @@ public:
             inferRequest.SetBlob(LprInputName, roiBlob);
         } else {
             const cv::Mat& vehicleImage = img(plateRect);
-            matU8ToBlob<uint8_t>(vehicleImage, roiBlob);
+            matU8ToBlob<uint8_t>(vehicleImage, roiBlob, static_cast<int>(batchIndex));
         }
 
         if (LprInputSeqName != "") {
@@ -277,7 +310,7 @@ public:
         }
     }
 
-    std::string getResults(InferenceEngine::InferRequest& inferRequest) {
+    std::string getResults(InferenceEngine::InferRequest& inferRequest, std::size_t batchIndex = 0) {
         static const char *const items[] = {
                 "0", "1", "2", "3", "4", "5", "6", "7", "8", "9",
                 "<Anhui>", "<Beijing>", "<Chongqing>", "<Fujian>",
@@ -296,7 +329,7 @@ public:
         std::string result;
         result.reserve(14u + 6u);  // the longest province name + 6 plate signs
         // up to 88 items per license plate, ended with "-1"
-        const auto data = inferRequest.GetBlob(LprOutputName)->buffer().as<float*>();
+        const auto data = inferRequest.GetBlob(LprOutputName)->buffer().as<float*>() + maxSequenceSizePerPlate * batchIndex;
         for (int i = 0; i < maxSequenceSizePerPlate; i++) {
             if (data[i] == -1) {
                 break;
@@ -307,6 +340,7 @@ public:
     }
 
 private:
+    std::size_t maxBatchSize = 1;
     int maxSequenceSizePerPlate;
     std::string LprInputName;
     std::string LprInputSeqName;
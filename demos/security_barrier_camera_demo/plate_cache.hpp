@@ -0,0 +1,145 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+class PlateCache {  // reuses license plate reads of a channel for boxes which neither move nor change their content
+public:
+    enum class Lookup {
+        HIT,      // the plate is the cached read
+        PENDING,  // the box is being read, its plate isn't known yet
+        MISS      // a new read is started
+    };
+
+    struct Stats {
+        std::size_t hits;
+        std::size_t pending;
+        std::size_t misses;
+    };
+
+    static constexpr float sameBoxIou = 0.9f;
+    static constexpr int sameContentBits = 6;  // of 64 bits of the crop hash which may differ
+
+    explicit PlateCache(int64_t maxAge = 0): maxAge{maxAge}, nextReadId{1}, stats{0, 0, 0} {}
+
+    // a 64-bit average hash: bits of the crop downscaled to 8x8 which are brighter than its mean
+    static uint64_t hash(const cv::Mat& crop) {
+        cv::Mat small;
+        cv::resize(crop, small, cv::Size{8, 8}, 0, 0, cv::INTER_AREA);
+        if (3 == small.channels()) {
+            cv::cvtColor(small, small, cv::COLOR_BGR2GRAY);
+        }
+        const double mean = cv::mean(small)[0];
+        uint64_t bits = 0;
+        for (int i = 0; i < 64; i++) {
+            bits = (bits << 1) | (small.at<uint8_t>(i / 8, i % 8) > mean ? 1u : 0u);
+        }
+        return bits;
+    }
+
+    // returns HIT with the cached plate if the same box and content was read less than maxAge frames ago, PENDING
+    // if it is being read and wasn't read before, otherwise starts a new read and returns MISS with its readId to
+    // store() the result
+    Lookup lookup(int64_t frameId, const cv::Rect& rect, uint64_t cropHash, float confidence, std::string& plate, uint64_t& readId) {
+        Entry* found = nullptr;
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < entries.size(); i++) {
+            if (frameId - entries[i].lastSeen > maxAge && 0 == entries[i].pendingReadId) {
+                continue;  // evicted
+            }
+            if (kept != i) {
+                entries[kept] = std::move(entries[i]);
+            }
+            Entry& entry = entries[kept++];
+            if (nullptr == found && iou(entry.rect, rect) >= sameBoxIou && popcount(entry.hash ^ cropHash) <= sameContentBits) {
+                found = &entry;
+            }
+        }
+        entries.resize(kept);
+        if (nullptr != found) {
+            found->lastSeen = std::max(found->lastSeen, frameId);
+            if (frameId - found->readFrameId < maxAge) {
+                if (!found->plate.empty()) {
+                    stats.hits++;
+                    plate = found->plate;
+                    return Lookup::HIT;
+                }
+                if (0 != found->pendingReadId) {
+                    stats.pending++;
+                    return Lookup::PENDING;
+                }
+            }
+        } else {
+            entries.push_back(Entry{rect, cropHash, frameId, frameId, "", 0.0f, 0, 0.0f});
+            found = &entries.back();
+        }
+        stats.misses++;
+        found->readFrameId = frameId;
+        found->pendingReadId = nextReadId++;
+        found->pendingConfidence = confidence;
+        readId = found->pendingReadId;
+        return Lookup::MISS;
+    }
+
+    void store(uint64_t readId, const std::string& plate) {
+        for (Entry& entry : entries) {
+            if (readId == entry.pendingReadId) {
+                // keeps the plate read from the most confident detection of the box
+                if (entry.plate.empty() || entry.pendingConfidence >= entry.confidence) {
+                    entry.plate = plate;
+                    entry.confidence = entry.pendingConfidence;
+                }
+                entry.pendingReadId = 0;
+                return;
+            }
+        }
+    }
+
+    Stats getStats() const {
+        return stats;
+    }
+
+private:
+    struct Entry {
+        cv::Rect rect;
+        uint64_t hash;
+        int64_t readFrameId;  // the frame of the last read
+        int64_t lastSeen;
+        std::string plate;
+        float confidence;
+        uint64_t pendingReadId;  // 0 - no read is in flight
+        float pendingConfidence;
+    };
+
+    static float iou(const cv::Rect& a, const cv::Rect& b) {
+        const int intersection = (a & b).area();
+        const int unite = a.area() + b.area() - intersection;
+        return 0 == unite ? 0.0f : static_cast<float>(intersection) / unite;
+    }
+
+    static int popcount(uint64_t bits) {
+        int count = 0;
+        for (; 0 != bits; bits &= bits - 1) {
+            count++;
+        }
+        return count;
+    }
+
+    const int64_t maxAge;
+    uint64_t nextReadId;
+    std::vector<Entry> entries;
+    Stats stats;
+};
+
+constexpr float PlateCache::sameBoxIou;
+constexpr int PlateCache::sameContentBits;
@@ -0,0 +1,112 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+
+struct ReportSnapshot {  // cumulative counters of the pipeline at a moment
+    double time;  // sec since the start
+    std::vector<uint64_t> readFrames;  // per channel
+    std::vector<std::size_t> queuedFrames;  // per channel, read by a shared source for the channel but not taken yet
+    uint64_t detectedFrames;
+    uint64_t classifiedVehicles;
+    uint64_t recognizedPlates;
+    Worker::Stats workerStats;
+    std::vector<LatencyHistogram> captureLatencies;  // per channel, from the capture of a frame to its results
+};
+
+/**
+* \brief Writes a report record per writeRecord() call, as JSON Lines or as CSV rows of
+* time,record,metric,key,value if the file name ends with .csv. Rates are measured since the previous record,
+* the final record measures them since the start, latencies are always measured since the start. A channel without
+* frames with results reports the capture latency 0
+*/
+class ReportWriter {
+public:
+    explicit ReportWriter(const std::string& path):
+        out{path}, csv{path.size() >= 4 && 0 == path.compare(path.size() - 4, 4, ".csv")} {
+        if (!out.is_open()) {
+            throw std::runtime_error("Can't open the report file " + path);
+        }
+        out << std::fixed << std::setprecision(3);
+        if (csv) {
+            out << "time,record,metric,key,value\n";
+        }
+    }
+
+    void writeRecord(const ReportSnapshot& now, const ReportSnapshot& since, bool final) {
+        const double duration = now.time - since.time;
+        auto rate = [duration](uint64_t nowCount, uint64_t sinceCount) {
+            return duration > 0 ? (nowCount - sinceCount) / duration : 0.0;
+        };
+        std::vector<double> inputFps;
+        for (std::size_t i = 0; i < now.readFrames.size(); i++) {
+            inputFps.push_back(rate(now.readFrames[i], i < since.readFrames.size() ? since.readFrames[i] : 0));
+        }
+        const std::map<std::string, double> inferenceFps{
+            {"detector", rate(now.detectedFrames, since.detectedFrames)},
+            {"vehicle_attributes", rate(now.classifiedVehicles, since.classifiedVehicles)},
+            {"lpr", rate(now.recognizedPlates, since.recognizedPlates)}};
+
+        const char* recordType = final ? "final" : "periodic";
+        if (csv) {
+            auto row = [&](const std::string& metric, const std::string& key, double value) {
+                out << now.time << ',' << recordType << ',' << metric << ',' << key << ',' << value << '\n';
+            };
+            for (std::size_t i = 0; i < inputFps.size(); i++) {
+                row("input_fps", std::to_string(i), inputFps[i]);
+                row("queued_frames", std::to_string(i), static_cast<double>(now.queuedFrames[i]));
+                row("capture_latency_p50_ms", std::to_string(i), now.captureLatencies[i].percentile(0.5));
+                row("capture_latency_p95_ms", std::to_string(i), now.captureLatencies[i].percentile(0.95));
+            }
+            for (const auto& fps : inferenceFps) {
+                row("inference_fps", fps.first, fps.second);
+            }
+            row("worker_queued_tasks", "", static_cast<double>(now.workerStats.queuedTasks));
+            row("worker_parked_tasks", "", static_cast<double>(now.workerStats.parkedTasks));
+            for (const auto& latency : now.workerStats.latencies) {
+                row("task_latency_p50_ms", latency.first, latency.second.percentile(0.5));
+                row("task_latency_p95_ms", latency.first, latency.second.percentile(0.95));
+                row("tasks", latency.first, static_cast<double>(latency.second.getCount()));
+            }
+        } else {
+            out << "{\"time\":" << now.time << ",\"record\":\"" << recordType << "\",\"channels\":[";
+            for (std::size_t i = 0; i < inputFps.size(); i++) {
+                out << (0 == i ? "" : ",") << "{\"id\":" << i << ",\"input_fps\":" << inputFps[i]
+                    << ",\"queued_frames\":" << now.queuedFrames[i]
+                    << ",\"capture_latency_ms\":{\"p50\":" << now.captureLatencies[i].percentile(0.5)
+                    << ",\"p95\":" << now.captureLatencies[i].percentile(0.95) << "}}";
+            }
+            out << "],\"inference_fps\":{";
+            const char* separator = "";
+            for (const auto& fps : inferenceFps) {
+                out << separator << '"' << fps.first << "\":" << fps.second;
+                separator = ",";
+            }
+            out << "},\"worker\":{\"queued_tasks\":" << now.workerStats.queuedTasks
+                << ",\"parked_tasks\":" << now.workerStats.parkedTasks << "},\"task_latency_ms\":{";
+            separator = "";
+            for (const auto& latency : now.workerStats.latencies) {
+                out << separator << '"' << latency.first << "\":{\"p50\":" << latency.second.percentile(0.5)
+                    << ",\"p95\":" << latency.second.percentile(0.95) << ",\"count\":" << latency.second.getCount() << '}';
+                separator = ",";
+            }
+            out << "}}\n";
+        }
+        out.flush();
+    }
+
+private:
+    std::ofstream out;
+    const bool csv;
+};
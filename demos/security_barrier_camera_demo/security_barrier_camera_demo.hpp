@@ -34,8 +34,12 @@ static const char custom_cldnn_message[] = "Required for GPU custom kernels. "
 static const char custom_cpu_library_message[] = "Required for CPU custom layers. "
                                                  "Absolute path to a shared library with the kernels implementation.";
 static const char no_show_processed_video[] = "Optional. Do not show processed video.";
-static const char input_resizable_message[] = "Optional. Enable resizable input with support of ROI crop and auto resize.";
+static const char input_resizable_message[] = "Optional. Enable resizable input with support of ROI crop and auto resize. "
+                                              "Enabled by default, -auto_resize=false copies and resizes inputs on the CPU.";
 static const char ninfer_request_message[] = "Optional. Number of infer requests. 0 sets the number of infer requests equal to the number of inputs.";
+static const char ninfer_request_va_message[] = "Optional. Number of infer requests for Vehicle Attributes. 0 sets it to 3 times the detection infer requests.";
+static const char ninfer_request_lpr_message[] = "Optional. Number of infer requests for License Plate Recognition. 0 sets it to 3 times the detection infer requests.";
+static const char time_message[] = "Optional. Stop after the given number of seconds. 0 runs until the input ends or the window is closed.";
 static const char num_cameras[] = "Required for web camera input. Maximum number of processed camera inputs (web cameras).";
 static const char fpga_device_ids_message[] = "Optional. Specify FPGA device IDs (0,1,n).";
 static const char loop_video_output_message[] = "Optional. Enable playing video on a loop.";
@@ -56,6 +60,29 @@ static const char infer_num_threads_message[] = "Optional. Number of threads to
 static const char infer_num_streams_message[] = "Optional. Number of streams to use for inference on the CPU or/and GPU in throughput mode "
                                                 "(for HETERO and MULTI device cases use format <device1>:<nstreams1>,<device2>:<nstreams2> or just <nstreams>)";
 static const char utilization_monitors_message[] = "Optional. List of monitors to show initially.";
+static const char batch_size_va_message[] = "Optional. Batch size for Vehicle Attributes. Vehicle crops of all channels are combined into batches. "
+                                            "Batched crops are copied and resized on the CPU.";
+static const char batch_size_lpr_message[] = "Optional. Batch size for License Plate Recognition. Plate crops of all channels are combined into batches. "
+                                             "Batched crops are copied and resized on the CPU, batching is not supported for LPR models with a sequence input.";
+static const char crops_max_wait_message[] = "Optional. Maximum time in milliseconds a crop waits for its classification batch to fill.";
+static const char detection_period_message[] = "Optional. Run the detector on every Nth frame of a channel and move the boxes with a tracker in between. "
+                                               "Classifiers run only for new or changed tracks and their results are cached per track. "
+                                               "1 detects every frame without tracking.";
+static const char detection_motion_message[] = "Optional. With -det_period greater than 1, also run the detector when the mean absolute difference "
+                                               "between the frame and the last detected frame of the channel exceeds this value (0-255). 0 disables the check.";
+static const char lpr_cache_message[] = "Optional. Reuse a license plate read for up to N frames of a channel while the plate box stays in place and its "
+                                        "content doesn't change, keeping the read of the most confident detection. 0 disables the cache.";
+static const char report_message[] = "Optional. Write throughput, queue depth, capture to result latency and task latency records to the file, "
+                                     "as CSV if its name ends with .csv and as JSON Lines otherwise.";
+static const char report_period_message[] = "Optional. Seconds between -report records, 0 writes only the final record at exit.";
+static const char cpu_weights_message[] = "Optional. Comma separated weights of the detection, Vehicle Attributes and LPR models to split "
+                                          "the CPU threads (-nthreads or all the cores) between them. Each model on the CPU gets its own "
+                                          "threads and streams, models on other devices are skipped. Empty shares the CPU between all the models.";
+static const char cache_dir_message[] = "Optional. Directory to cache compiled networks in. Later runs import the cached networks "
+                                        "instead of compiling them if the model, device and config didn't change. "
+                                        "Devices without network export support compile on each run.";
+static const char results_message[] = "Optional. Write the boxes, the vehicle attributes and the license plates of every frame in a compact binary "
+                                      "format to \"shm:<name>\" shared memory ring, \"tcp:<host>:<port>\" or \"unix:<path>\" socket or to a file.";
 
 DEFINE_bool(h, false, help_message);
 DEFINE_string(i, "", video_message);
@@ -71,8 +98,11 @@ DEFINE_double(t, 0.5, thresh_output_message);
 DEFINE_string(c, "", custom_cldnn_message);
 DEFINE_string(l, "", custom_cpu_library_message);
 DEFINE_bool(no_show, false, no_show_processed_video);
-DEFINE_bool(auto_resize, false, input_resizable_message);
+DEFINE_bool(auto_resize, true, input_resizable_message);
 DEFINE_uint32(nireq, 0, ninfer_request_message);
+DEFINE_uint32(nireq_va, 0, ninfer_request_va_message);
+DEFINE_uint32(nireq_lpr, 0, ninfer_request_lpr_message);
+DEFINE_uint32(time, 0, time_message);
 DEFINE_uint32(nc, 0, num_cameras);
 DEFINE_string(fpga_device_ids, "", fpga_device_ids_message);
 DEFINE_bool(loop_video, false, loop_video_output_message);
@@ -85,6 +115,24 @@ DEFINE_bool(tag, false, use_tag_scheduler_message);
 DEFINE_uint32(nthreads, 0, infer_num_threads_message);
 DEFINE_string(nstreams, "", infer_num_streams_message);
 DEFINE_string(u, "", utilization_monitors_message);
+DEFINE_uint32(bs_va, 1, batch_size_va_message);
+DEFINE_uint32(bs_lpr, 1, batch_size_lpr_message);
+DEFINE_uint32(crops_max_wait, 5, crops_max_wait_message);
+DEFINE_uint32(det_period, 1, detection_period_message);
+DEFINE_double(det_motion, 0.0, detection_motion_message);
+DEFINE_uint32(lpr_cache, 0, lpr_cache_message);
+DEFINE_string(report, "", report_message);
+DEFINE_uint32(report_period, 5, report_period_message);
+DEFINE_string(cpu_weights, "", cpu_weights_message);
+DEFINE_string(cache_dir, "", cache_dir_message);
+static const char record_message[] = "Optional. Record the frames of every input with the moments they were read to <dir>/input<index>.caprec, "
+                                     "the cameras first, then the videos, the recordings and the images. The recordings are replayed by "
+                                     "-i <dir>/input<index>.caprec at the recorded pace, so the runs of different builds get the same input load.";
+static const char replay_fast_message[] = "Optional. Replay the .caprec inputs as fast as they are read instead of at the recorded pace.";
+
+DEFINE_string(results, "", results_message);
+DEFINE_string(record, "", record_message);
+DEFINE_bool(replay_fast, false, replay_fast_message);
 
 /**
 * \brief This function show a help message
@@ -111,6 +159,9 @@ void showUsage() {
     std::cout << "    -no_show                   " << no_show_processed_video << std::endl;
     std::cout << "    -auto_resize               " << input_resizable_message << std::endl;
     std::cout << "    -nireq                     " << ninfer_request_message << std::endl;
+    std::cout << "    -nireq_va                  " << ninfer_request_va_message << std::endl;
+    std::cout << "    -nireq_lpr                 " << ninfer_request_lpr_message << std::endl;
+    std::cout << "    -time                      " << time_message << std::endl;
     std::cout << "    -nc                        " << num_cameras << std::endl;
     std::cout << "    -fpga_device_ids           " << fpga_device_ids_message << std::endl;
     std::cout << "    -loop_video                " << loop_video_output_message << std::endl;
@@ -123,4 +174,17 @@ void showUsage() {
     std::cout << "    -nstreams \"<integer>\"      " << infer_num_streams_message << std::endl;
     std::cout << "    -nthreads \"<integer>\"      " << infer_num_threads_message << std::endl;
     std::cout << "    -u                         " << utilization_monitors_message << std::endl;
+    std::cout << "    -bs_va                     " << batch_size_va_message << std::endl;
+    std::cout << "    -bs_lpr                    " << batch_size_lpr_message << std::endl;
+    std::cout << "    -crops_max_wait            " << crops_max_wait_message << std::endl;
+    std::cout << "    -det_period                " << detection_period_message << std::endl;
+    std::cout << "    -det_motion                " << detection_motion_message << std::endl;
+    std::cout << "    -lpr_cache                 " << lpr_cache_message << std::endl;
+    std::cout << "    -report                    " << report_message << std::endl;
+    std::cout << "    -report_period             " << report_period_message << std::endl;
+    std::cout << "    -cpu_weights               " << cpu_weights_message << std::endl;
+    std::cout << "    -cache_dir \"<path>\"        " << cache_dir_message << std::endl;
+    std::cout << "    -results \"<target>\"        " << results_message << std::endl;
+    std::cout << "    -record \"<dir>\"            " << record_message << std::endl;
+    std::cout << "    -replay_fast               " << replay_fast_message << std::endl;
 }
@@ -0,0 +1,121 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+class IouTracker {  // propagates detections of a channel with a constant velocity between detected frames and caches their descriptions
+public:
+    struct Track {
+        uint64_t id;
+        std::size_t label;
+        cv::Rect rect;  // the last detected box
+        int64_t frameId;  // the frame rect was detected on
+        cv::Point2f velocity;  // of the box per frame
+        std::string descr;
+        bool described;  // descr is set or being classified
+        unsigned misses;  // detected frames without the track
+    };
+
+    struct Match {
+        uint64_t trackId;
+        bool classify;  // the track is new or changed, the cached descr is empty or outdated
+        std::string descr;
+    };
+
+    static constexpr float matchIou = 0.3f;  // a detection continues the track it overlaps the most if the overlap is at least that
+    static constexpr float changedIou = 0.5f;  // a detection overlapping the predicted box less than that is classified again
+    static constexpr unsigned maxMisses = 2;
+
+    IouTracker(): nextId{1} {}
+
+    // matches the detections of a frame to the tracks, detections which continue no track start new ones
+    std::vector<Match> update(int64_t frameId, const std::vector<std::pair<std::size_t, cv::Rect>>& detections) {
+        std::vector<Match> matches;
+        matches.reserve(detections.size());
+        std::vector<bool> updated(tracks.size(), false);
+        for (const std::pair<std::size_t, cv::Rect>& detection : detections) {
+            std::size_t bestTrack = tracks.size();
+            float bestIou = matchIou;
+            for (std::size_t i = 0; i < tracks.size(); i++) {
+                if (updated[i] || tracks[i].label != detection.first) {
+                    continue;
+                }
+                const float overlap = iou(predict(tracks[i], frameId), detection.second);
+                if (overlap >= bestIou) {
+                    bestIou = overlap;
+                    bestTrack = i;
+                }
+            }
+            if (tracks.size() == bestTrack) {
+                tracks.push_back(Track{nextId++, detection.first, detection.second, frameId, cv::Point2f{}, "", true, 0});
+                updated.push_back(true);
+                matches.push_back(Match{tracks.back().id, true, ""});
+                continue;
+            }
+            Track& track = tracks[bestTrack];
+            updated[bestTrack] = true;
+            const bool changed = !track.described || bestIou < changedIou;
+            if (frameId > track.frameId) {  // detections of earlier frames may complete later
+                const float frames = static_cast<float>(frameId - track.frameId);
+                track.velocity = cv::Point2f{(detection.second.x - track.rect.x) / frames, (detection.second.y - track.rect.y) / frames};
+                track.rect = detection.second;
+                track.frameId = frameId;
+            }
+            track.misses = 0;
+            track.described = true;
+            matches.push_back(Match{track.id, changed, track.descr});
+        }
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < tracks.size(); i++) {
+            if (updated[i] || ++tracks[i].misses <= maxMisses) {
+                if (kept != i) {
+                    tracks[kept] = std::move(tracks[i]);
+                }
+                kept++;
+            }
+        }
+        tracks.resize(kept);
+        return matches;
+    }
+
+    void setDescr(uint64_t trackId, const std::string& descr) {
+        for (Track& track : tracks) {
+            if (trackId == track.id) {
+                track.descr = descr;
+                return;
+            }
+        }
+    }
+
+    const std::vector<Track>& getTracks() const {
+        return tracks;
+    }
+
+    static cv::Rect predict(const Track& track, int64_t frameId) {
+        const float frames = static_cast<float>(frameId - track.frameId);
+        return cv::Rect{cv::Point{track.rect.x + static_cast<int>(track.velocity.x * frames),
+                                  track.rect.y + static_cast<int>(track.velocity.y * frames)}, track.rect.size()};
+    }
+
+private:
+    static float iou(const cv::Rect& a, const cv::Rect& b) {
+        const int intersection = (a & b).area();
+        const int unite = a.area() + b.area() - intersection;
+        return 0 == unite ? 0.0f : static_cast<float>(intersection) / unite;
+    }
+
+    uint64_t nextId;
+    std::vector<Track> tracks;
+};
+
+constexpr float IouTracker::matchIou;
+constexpr float IouTracker::changedIou;
+constexpr unsigned IouTracker::maxMisses;
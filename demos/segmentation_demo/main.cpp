@@ -2,9 +2,13 @@
 // SPDX-License-Identifier: Apache-2.0
 //
 
+#include <atomic>
 #include <chrono>
 #include <iostream>
+#include <memory>
+#include <random>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <gflags/gflags.h>
@@ -12,17 +16,49 @@
 #include <opencv2/videoio.hpp>
 
 #include <inference_engine.hpp>
+#include <ngraph/ngraph.hpp>
+#include <ngraph/opsets/opset3.hpp>
 
 #include <monitors/presenter.h>
 #include <samples/common.hpp>
 #include <samples/ocv_common.hpp>
+#include <samples/frame_prefetcher.hpp>
+#include <samples/infer_request_pool.hpp>
 #include <samples/slog.hpp>
+#include <samples/mapped_weights.hpp>
+#include <samples/network_cache.hpp>
+#include <samples/async_presenter.hpp>
 
 #include "segmentation_demo.h"
 
 using namespace InferenceEngine;
 typedef std::chrono::duration<double, std::chrono::milliseconds::period> Ms;
 
+// Replaces the N x C x H x W class probabilities output of the network by the N x H x W indices of the most
+// probable classes, the device computes them and the host receives C times less data. The network keeps its
+// output if it is ArgMax'ed already
+CNNNetwork appendArgMax(CNNNetwork network) {
+    const std::shared_ptr<ngraph::Function> function = network.getFunction();
+    if (!function)
+        throw std::logic_error("-device_argmax requires a model in IR version 10 or greater");
+    if (function->get_results().size() != 1)
+        throw std::runtime_error("Demo supports topologies only with 1 output");
+    const ngraph::Output<ngraph::Node> probabilities = function->get_results().front()->input_value(0);
+    if (probabilities.get_partial_shape().rank().get_length() != 4) {
+        slog::info << "The model output isn't 4D, -device_argmax is ignored" << slog::endl;
+        return network;
+    }
+    // TopK with k = 1 is the ArgMax of opset3, the first maximal class wins like in the host ArgMax
+    const auto topK = std::make_shared<ngraph::opset3::TopK>(probabilities,
+        ngraph::opset3::Constant::create(ngraph::element::i64, ngraph::Shape{}, {1}), 1,
+        ngraph::opset3::TopK::Mode::MAX, ngraph::opset3::TopK::SortType::NONE, ngraph::element::i32);
+    const auto classMap = std::make_shared<ngraph::opset3::Squeeze>(topK->output(1),
+        ngraph::opset3::Constant::create(ngraph::element::i64, ngraph::Shape{1}, {1}));
+    classMap->set_friendly_name(probabilities.get_node()->get_friendly_name() + "/argmax");
+    return CNNNetwork(std::make_shared<ngraph::Function>(ngraph::OutputVector{classMap}, function->get_parameters(),
+        function->get_friendly_name()));
+}
+
 bool ParseAndCheckCommandLine(int argc, char *argv[]) {
     // ---------------------------Parsing and validation of input args--------------------------------------
     slog::info << "Parsing input parameters" << slog::endl;
@@ -69,7 +105,7 @@ int main(int argc, char *argv[]) {
         slog::info << "Device info" << slog::endl;
         std::cout << ie.GetVersions(FLAGS_d);
 
-        CNNNetwork network = ie.ReadNetwork(FLAGS_m);
+        CNNNetwork network = readNetworkMapped(ie, FLAGS_m);
 
         ICNNNetwork::InputShapes inputShapes = network.getInputShapes();
         if (inputShapes.size() != 1)
@@ -80,6 +116,8 @@ int main(int argc, char *argv[]) {
             throw std::runtime_error("3-channel 4-dimensional model's input is expected");
         inSizeVector[0] = 1;  // set batch size to 1
         network.reshape(inputShapes);
+        if (FLAGS_device_argmax)
+            network = appendArgMax(network);
 
         InputInfo& inputInfo = *network.getInputsInfo().begin()->second;
         inputInfo.getPreProcess().setResizeAlgorithm(ResizeAlgorithm::RESIZE_BILINEAR);
@@ -112,81 +150,105 @@ int main(int argc, char *argv[]) {
                     "supported.");
         }
 
-        ExecutableNetwork executableNetwork = ie.LoadNetwork(network, FLAGS_d);
-        InferRequest inferRequest = executableNetwork.CreateInferRequest();
+        // the class map is 8-bit to colorize it by cv::LUT
+        constexpr int MAX_CLASSES = 256;
+        if (outChannels > MAX_CLASSES)
+            throw std::runtime_error("Demo supports topologies only with up to " + std::to_string(MAX_CLASSES) + " classes");
 
-        cv::VideoCapture cap;
+        ExecutableNetwork executableNetwork = loadNetworkCached(ie, network, FLAGS_m, FLAGS_d, {}, FLAGS_cache_dir);
+        InferRequestPool<cv::Mat> inferRequests(executableNetwork,
+            0 == FLAGS_nireq ? defaultInferRequestsNum(executableNetwork, FLAGS_d) : FLAGS_nireq);
+        slog::info << "Number of infer requests: " << inferRequests.depth() << slog::endl;
+
+        std::unique_ptr<FrameSource> source;
         try {
-            int index = std::stoi(FLAGS_i);
-            if (!cap.open(index))
-                throw std::runtime_error("Can't open camera " + std::to_string(index));
+            source.reset(new VideoCaptureSource(std::stoi(FLAGS_i)));
         } catch (const std::invalid_argument&) {
-            if (!cap.open(FLAGS_i))
-                throw std::runtime_error("Can't open input " + FLAGS_i);
+            source.reset(new VideoCaptureSource(FLAGS_i));
         } catch (const std::out_of_range&) {
-            if (!cap.open(FLAGS_i))
-                throw std::runtime_error("Can't open input " + FLAGS_i);
+            source.reset(new VideoCaptureSource(FLAGS_i));
         }
+        FramePrefetcher frameReader(std::move(source));
+        cv::Mat inImg;
+        if (!frameReader.read(inImg))
+            throw std::runtime_error("Can't read a frame from " + FLAGS_i);
 
-        float blending = 0.3f;
+        // the trackbar of the display thread sets it
+        std::atomic<float> blending{0.3f};
         constexpr char WIN_NAME[] = "segmentation";
-        if (!FLAGS_no_show) {
-            cv::namedWindow(WIN_NAME);
-            int initValue = static_cast<int>(blending * 100);
-            cv::createTrackbar("blending", WIN_NAME, &initValue, 100,
-                [](int position, void* blendingPtr){*static_cast<float*>(blendingPtr) = position * 0.01f;},
-                &blending);
-        }
 
-        cv::Mat inImg, resImg, maskImg(outHeight, outWidth, CV_8UC3);
-        std::vector<cv::Vec3b> colors(arraySize(CITYSCAPES_COLORS));
-        for (std::size_t i = 0; i < colors.size(); ++i)
-            colors[i] = {CITYSCAPES_COLORS[i].blue(), CITYSCAPES_COLORS[i].green(), CITYSCAPES_COLORS[i].red()};
+        // the classes after the Cityscapes colors get random ones
+        cv::Mat palette(1, MAX_CLASSES, CV_8UC3);
         std::mt19937 rng;
         std::uniform_int_distribution<int> distr(0, 255);
+        for (int i = 0; i < MAX_CLASSES; ++i) {
+            palette.at<cv::Vec3b>(i) = i < static_cast<int>(arraySize(CITYSCAPES_COLORS))
+                ? cv::Vec3b{CITYSCAPES_COLORS[i].blue(), CITYSCAPES_COLORS[i].green(), CITYSCAPES_COLORS[i].red()}
+                : cv::Vec3b(distr(rng), distr(rng), distr(rng));
+        }
+        // reused by the frames
+        cv::Mat maxProb, greater, classMap(outHeight, outWidth, CV_8U), classMap3, maskImg, resizedMask;
         int delay = FLAGS_delay;
-        cv::Size graphSize{static_cast<int>(cap.get(cv::CAP_PROP_FRAME_WIDTH) / 4), 60};
+        cv::Size graphSize{inImg.cols / 4, 60};
         Presenter presenter(FLAGS_u, 10, graphSize);
+        // the window and its blending trackbar are created on the display thread, which owns all the HighGUI calls
+        AsyncPresenter display(WIN_NAME, !FLAGS_no_show, &presenter, [&blending, WIN_NAME] {
+            cv::namedWindow(WIN_NAME);
+            cv::createTrackbar("blending", WIN_NAME, nullptr, 100,
+                [](int position, void* blendingPtr) {
+                    *static_cast<std::atomic<float>*>(blendingPtr) = position * 0.01f;
+                }, &blending);
+            cv::setTrackbarPos("blending", WIN_NAME, static_cast<int>(blending * 100));
+        });
 
-        std::chrono::steady_clock::duration latencySum{0};
+        std::chrono::high_resolution_clock::duration latencySum{0};
         unsigned latencySamplesNum = 0;
         std::ostringstream latencyStream;
 
-        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
-        while (cap.read(inImg) && delay >= 0) {
-            if (CV_8UC3 != inImg.type())
-                throw std::runtime_error("BGR (or RGB) image expected to come from input");
-            inferRequest.SetBlob(inName, wrapMat2Blob(inImg));
-            inferRequest.Infer();
-
-            const float * const predictions = inferRequest.GetBlob(outName)->cbuffer().as<float*>();
-            for (int rowId = 0; rowId < outHeight; ++rowId) {
-                for (int colId = 0; colId < outWidth; ++colId) {
-                    std::size_t classId = 0;
-                    if (outChannels == 0) {  // assume the output is already ArgMax'ed
-                        classId = static_cast<std::size_t>(predictions[rowId * outWidth + colId]);
-                    } else {
-                        float maxProb = -1.0f;
-                        for (int chId = 0; chId < outChannels; ++chId) {
-                            float prob = predictions[chId * outHeight * outWidth + rowId * outWidth + colId];
-                            if (prob > maxProb) {
-                                classId = chId;
-                                maxProb = prob;
-                            }
-                        }
-                    }
-                    while (classId >= colors.size()) {
-                        cv::Vec3b color(distr(rng), distr(rng), distr(rng));
-                        colors.push_back(color);
-                    }
-                    maskImg.at<cv::Vec3b>(rowId, colId) = colors[classId];
+        while (delay >= 0) {
+            // the idle requests infer the next frames while the oldest started one is processed
+            while (!inImg.empty() && inferRequests.hasIdle()) {
+                if (CV_8UC3 != inImg.type())
+                    throw std::runtime_error("BGR (or RGB) image expected to come from input");
+                inferRequests.idleRequest()->SetBlob(inName, wrapMat2Blob(inImg));
+                inferRequests.startAsync(inImg);
+                inImg = cv::Mat();  // the started request keeps the frame
+                if (!frameReader.read(inImg))
+                    inImg.release();
+            }
+            if (inferRequests.empty())
+                break;  // end of the input
+
+            InferRequestPool<cv::Mat>::Result result = inferRequests.pop();
+            const float * const predictions = result.request->GetBlob(outName)->cbuffer().as<float*>();
+            if (outChannels == 0) {  // assume the output is already ArgMax'ed
+                cv::Mat(outHeight, outWidth, CV_32F, const_cast<float*>(predictions)).convertTo(classMap, CV_8U);
+            } else {
+                // the argmax visits the channel planes one by one, the first channel of the maximal
+                // probability wins as the comparison is strict
+                const std::size_t planeSize = static_cast<std::size_t>(outHeight) * outWidth;
+                cv::Mat(outHeight, outWidth, CV_32F, const_cast<float*>(predictions)).copyTo(maxProb);
+                classMap.setTo(0);
+                for (int chId = 1; chId < outChannels; ++chId) {
+                    const cv::Mat plane(outHeight, outWidth, CV_32F, const_cast<float*>(predictions + chId * planeSize));
+                    cv::compare(plane, maxProb, greater, cv::CMP_GT);
+                    classMap.setTo(chId, greater);
+                    cv::max(plane, maxProb, maxProb);
                 }
             }
-            cv::resize(maskImg, resImg, inImg.size());
-            resImg = inImg * blending + resImg * (1 - blending);
-            presenter.drawGraphs(resImg);
+            inferRequests.release(result);
+
+            // colorizing at the output resolution and enlarging by the nearest neighbour is the same as
+            // colorizing the enlarged class map, and the input frame is blended with the mask in place
+            // without the full size temporaries
+            cv::Mat& resImg = result.payload;
+            cv::merge(std::vector<cv::Mat>(3, classMap), classMap3);
+            cv::LUT(classMap3, palette, maskImg);
+            cv::resize(maskImg, resizedMask, resImg.size(), 0, 0, FLAGS_smooth_mask ? cv::INTER_LINEAR : cv::INTER_NEAREST);
+            const float resBlending = blending;
+            cv::addWeighted(resImg, resBlending, resizedMask, 1 - resBlending, 0, resImg);
 
-            latencySum += std::chrono::steady_clock::now() - t0;
+            latencySum += std::chrono::high_resolution_clock::now() - result.startTime;
             ++latencySamplesNum;
             latencyStream.str("");
             latencyStream << std::fixed << std::setprecision(1)
@@ -200,8 +262,8 @@ int main(int argc, char *argv[]) {
                 cv::Scalar{255, 0, 0}, THICKNESS);
 
             if (!FLAGS_no_show) {
-                cv::imshow(WIN_NAME, resImg);
-                int key = cv::waitKey(delay);
+                display.show(std::move(resImg));
+                int key = display.waitKey(delay);
                 switch(key) {
                     case 'q':
                     case 'Q':
@@ -214,11 +276,11 @@ int main(int argc, char *argv[]) {
                         delay = !delay * (FLAGS_delay + !FLAGS_delay);
                         break;
                     default:
-                        presenter.handleKey(key);
+                        display.handleKey(key);
                 }
             }
-            t0 = std::chrono::steady_clock::now();
         }
+        display.stop();
         std::cout << "Mean pipeline latency: " << latencyStream.str() << '\n';
         std::cout << presenter.reportMeans() << '\n';
     }
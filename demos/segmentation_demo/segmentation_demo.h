@@ -25,6 +25,15 @@ static const char delay_message[] = "Optional. Default is 1. Interval in millise
                                     "exits.";
 static const char no_show_message[] = "Optional. Do not visualize inference results.";
 static const char utilization_monitors_message[] = "Optional. List of monitors to show initially.";
+static const char cache_dir_message[] = "Optional. Directory to cache compiled networks in. Later runs import the cached networks "
+                                        "instead of compiling them if the model, device and config didn't change. "
+                                        "Devices without network export support compile on each run.";
+static const char smooth_mask_message[] = "Optional. Enlarge the colorized class map to the input by the bilinear interpolation, "
+                                          "which smooths the borders of the classes but is slower. By default the nearest neighbour is used.";
+static const char nireq_message[] = "Optional. Number of infer requests kept in flight. "
+                                    "0 uses the optimal number for the device: at least 2, 4 for MYRIAD and HDDL if the device does not report it.";
+static const char device_argmax_message[] = "Optional. Append the ArgMax over the classes to the model, so that the device returns the class map "
+                                            "instead of the probabilities of every class. Requires a model in IR version 10 or greater.";
 
 DEFINE_string(c, "", custom_cldnn_message);
 DEFINE_string(l, "", custom_cpu_library_message);
@@ -36,6 +45,10 @@ DEFINE_string(config, "", config_message);
 DEFINE_int32(delay, 1, delay_message);
 DEFINE_bool(no_show, false, no_show_message);
 DEFINE_string(u, "", utilization_monitors_message);
+DEFINE_string(cache_dir, "", cache_dir_message);
+DEFINE_uint32(nireq, 0, nireq_message);
+DEFINE_bool(smooth_mask, false, smooth_mask_message);
+DEFINE_bool(device_argmax, false, device_argmax_message);
 
 static void showUsage() {
     std::cout << std::endl;
@@ -52,4 +65,8 @@ static void showUsage() {
     std::cout << "    -delay                    " << delay_message << std::endl;
     std::cout << "    -no_show                  " << no_show_message << std::endl;
     std::cout << "    -u                        " << utilization_monitors_message << std::endl;
+    std::cout << "    -cache_dir \"<path>\"       " << cache_dir_message << std::endl;
+    std::cout << "    -nireq \"<integer>\"        " << nireq_message << std::endl;
+    std::cout << "    -smooth_mask              " << smooth_mask_message << std::endl;
+    std::cout << "    -device_argmax            " << device_argmax_message << std::endl;
 }
@@ -0,0 +1,59 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+// Measures Tracker::Process on synthetic crowds of the given sizes and breaks
+// the time of a frame down by stages.
+
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include <samples/microbenchmark.hpp>
+#include <samples/synthetic_crowd.hpp>
+
+#include "tracker.hpp"
+
+namespace {
+const cv::Size kFrameSize(1920, 1080);
+const int kFrames = 300;
+const int kWarmupFrames = 25;
+}  // namespace
+
+int main(int argc, char *argv[]) {
+    const std::vector<int> sizes = benchmarkSizes(argc, argv, {10, 50, 100, 200, 500});
+
+    std::cout << std::fixed << std::setprecision(3)
+              << "objects\ttotal ms\tmax ms\taffinity ms\tassignment ms\tbookkeeping ms" << std::endl;
+    for (int n : sizes) {
+        cv::RNG rng(0);
+        SyntheticCrowd crowd(n, kFrameSize);
+        Tracker tracker;
+
+        TrackerTimings sum;
+        BenchmarkSamples totals;
+        cv::Mat frame;
+        for (int frame_idx = 0; frame_idx < kWarmupFrames + kFrames; frame_idx++) {
+            TrackedObjects detections;
+            for (const auto &rect : crowd.step(frame)) {
+                detections.emplace_back(rect, rng.uniform(0.5f, 1.0f));
+            }
+            tracker.Process(frame, detections, frame_idx);
+            if (frame_idx < kWarmupFrames) continue;
+
+            const auto &timings = tracker.timings();
+            sum.affinity += timings.affinity;
+            sum.assignment += timings.assignment;
+            sum.total += timings.total;
+            totals.add(timings.total);
+        }
+
+        double bookkeeping = sum.total - sum.affinity - sum.assignment;
+        std::cout << n << '\t' << totals.mean() << '\t' << totals.max() << '\t'
+                  << sum.affinity / kFrames << '\t' << sum.assignment / kFrames << '\t'
+                  << bookkeeping / kFrames << std::endl;
+    }
+    return 0;
+}
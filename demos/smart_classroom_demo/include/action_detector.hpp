@@ -119,6 +119,7 @@ public:
         BaseCnnDetection::printPerformanceCounts(fullDeviceName);
     }
     DetectedActions fetchResults() override;
+    std::unique_ptr<AsyncDetection<DetectedAction>> clone() const override;
 
 private:
     ActionDetectorConfig config_;
@@ -151,19 +152,33 @@ private:
     };
     typedef std::vector<NormalizedBBox> NormalizedBBoxes;
 
+    /**
+    * @brief Action confidences of a candidate bbox in the output of its anchor.
+    */
+    struct CandidateAnchor {
+        int glob_anchor_id;
+        int conf_shift;
+        int conf_step;
+    };
+
+    /** @brief Action anchors of the candidates, computed once for the network */
+    std::vector<CandidateAnchor> candidate_anchors_;
+    /** @brief Prior boxes and their variances of the candidates, generated once
+    * for the new network and read from the first output for the old one */
+    NormalizedBBoxes priors_;
+    NormalizedBBoxes prior_variances_;
+
      /**
     * @brief Translates the detections from the network outputs
     *
     * @param loc Location buffer
     * @param main_conf Detection conf buffer
     * @param add_conf Action conf buffer
-    * @param priorboxes Priorboxes buffer
     * @param frame_size Size of input image (WxH)
     * @return Detected objects
     */
     DetectedActions GetDetections(const cv::Mat& loc,
                                   const cv::Mat& main_conf,
-                                  const cv::Mat& priorboxes,
                                   const std::vector<cv::Mat>& add_conf,
                                   const cv::Size& frame_size) const;
 
@@ -0,0 +1,98 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+///
+/// \brief Block of the action log, the fields of the records are stored as
+/// separate columns.
+///
+struct ActionLogBlock {
+    std::vector<int32_t> frame_ids;
+    std::vector<int32_t> track_ids;
+    std::vector<int32_t> labels;
+    std::vector<float> confidences;
+    std::vector<int32_t> x, y, width, height;
+
+    size_t size() const { return frame_ids.size(); }
+    void reserve(size_t size);
+};
+
+///
+/// \brief Writes the per-person action detections to a binary columnar file
+/// from a background thread.
+///
+/// The file is the "SCAL" magic and the version followed by blocks, a block
+/// is the number of its records and then the columns of ActionLogBlock in the
+/// declaration order. The values are in the host byte order. Add() only copies
+/// the fields to the current block, the full blocks are written by the thread.
+///
+class ActionLogWriter {
+public:
+    ///
+    /// \brief Creates the file and starts the writing thread.
+    /// \param[in] path Path to the log file.
+    /// \param[in] block_size Number of records in a block.
+    ///
+    explicit ActionLogWriter(const std::string& path, size_t block_size = 4096);
+    ActionLogWriter(const ActionLogWriter&) = delete;
+    ActionLogWriter& operator=(const ActionLogWriter&) = delete;
+
+    ///
+    /// \brief Writes the rest of the records and stops the thread.
+    ///
+    ~ActionLogWriter();
+
+    ///
+    /// \brief Adds the detection of a tracked person.
+    /// \param[in] frame_idx Index of the frame.
+    /// \param[in] track_id Id of the track of the person.
+    /// \param[in] label Action.
+    /// \param[in] confidence Detection confidence.
+    /// \param[in] rect Bounding box of the person.
+    ///
+    void Add(int frame_idx, int track_id, int label, float confidence, const cv::Rect& rect);
+
+private:
+    void Submit();
+    void Write();
+
+    std::ofstream file_;
+    const size_t block_size_;
+    ActionLogBlock block_;
+    std::deque<ActionLogBlock> blocks_;  // full blocks waiting for the thread
+    bool stopped_;
+    std::mutex mutex_;
+    std::condition_variable submitted_;
+    std::thread writer_;
+};
+
+///
+/// \brief Reads the blocks of a log written by ActionLogWriter.
+///
+class ActionLogReader {
+public:
+    explicit ActionLogReader(const std::string& path);
+
+    ///
+    /// \brief Reads the next block.
+    /// \param[out] block The block.
+    /// \return false at the end of the file.
+    ///
+    bool Read(ActionLogBlock* block);
+
+private:
+    std::ifstream file_;
+};
@@ -25,11 +25,15 @@ struct CnnConfig {
     std::string path_to_model;
     /** @brief Maximal size of batch */
     int max_batch_size{1};
+    /** @brief Maximal number of batches inferred at once */
+    int max_infer_requests{2};
 
     /** @brief Inference Engine */
     InferenceEngine::Core ie;
     /** @brief Device name */
     std::string deviceName;
+    /** @brief Directory to cache compiled networks in, empty - no cache */
+    std::string cache_dir;
 };
 
 /**
@@ -59,6 +63,16 @@ public:
     */
     void PrintPerformanceCounts(std::string fullDeviceName) const;
 
+    /**
+    * @brief Returns the config the network was created with
+    */
+    const Config& config() const { return config_; }
+
+    /**
+    * @brief Returns the size of the input images of the network
+    */
+    cv::Size input_size() const { return input_size_; }
+
 protected:
     /**
    * @brief Run network
@@ -88,8 +102,12 @@ protected:
     InferenceEngine::ExecutableNetwork executable_network_;
     /** @brief IE InferRequest */
     mutable InferenceEngine::InferRequest infer_request_;
+    /** @brief Requests inferring the batches after the first one at once */
+    mutable std::vector<InferenceEngine::InferRequest::Ptr> extra_requests_;
     /** @brief Name of the input blob input blob */
     std::string input_blob_name_;
+    /** @brief Size of the input images */
+    cv::Size input_size_;
     /** @brief Names of output blobs */
     std::vector<std::string> output_blobs_names_;
 };
@@ -102,6 +120,12 @@ public:
                  cv::Mat* vector, cv::Size outp_shape = cv::Size()) const;
     void Compute(const std::vector<cv::Mat>& images,
                  std::vector<cv::Mat>* vectors, cv::Size outp_shape = cv::Size()) const;
+    void Compute(const cv::Mat& frame, const std::vector<cv::Rect>& rois,
+                 std::vector<cv::Mat>* vectors, cv::Size outp_shape = cv::Size()) const;
+
+protected:
+    static void FetchVectors(const InferenceEngine::BlobMap& outputs, size_t batch_size,
+                             cv::Size outp_shape, std::vector<cv::Mat>* vectors);
 };
 
 class AsyncAlgorithm {
@@ -117,6 +141,11 @@ template <typename T>
 class AsyncDetection : public AsyncAlgorithm {
 public:
     virtual std::vector<T> fetchResults() = 0;
+    /**
+    * @brief Returns a detector for another stream of frames. It shares the
+    * loaded network with this one and creates its own requests.
+    */
+    virtual std::unique_ptr<AsyncDetection<T>> clone() const = 0;
 };
 
 template <typename T>
@@ -127,6 +156,31 @@ public:
     void wait() override {}
     void printPerformanceCounts(const std::string &) override {}
     std::vector<T> fetchResults() override { return {}; }
+    std::unique_ptr<AsyncDetection<T>> clone() const override {
+        return std::unique_ptr<AsyncDetection<T>>(new NullDetection<T>);
+    }
+};
+
+/**
+* @brief Computes vectors of the enqueued images asynchronously, the images
+* are split into batches inferred by separate requests at once
+*/
+class AsyncVectorCNN : public VectorCNN, public AsyncDetection<cv::Mat> {
+public:
+    AsyncVectorCNN(const CnnConfig& config, cv::Size outp_shape = cv::Size());
+
+    void enqueue(const cv::Mat& image) override;
+    void submitRequest() override;
+    void wait() override;
+    void printPerformanceCounts(const std::string& fullDeviceName) override;
+    std::vector<cv::Mat> fetchResults() override;
+    std::unique_ptr<AsyncDetection<cv::Mat>> clone() const override;
+
+private:
+    cv::Size outp_shape_;
+    std::vector<cv::Mat> images_;
+    std::vector<InferenceEngine::InferRequest::Ptr> requests_;
+    std::vector<size_t> batch_sizes_;  // of the submitted requests
 };
 
 class BaseCnnDetection : public AsyncAlgorithm {
@@ -59,6 +59,7 @@ public:
     }
 
     DetectedObjects fetchResults() override;
+    std::unique_ptr<AsyncDetection<DetectedObject>> clone() const override;
 };
 
 }  // namespace detection
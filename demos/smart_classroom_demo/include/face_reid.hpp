@@ -5,10 +5,12 @@
 #pragma once
 
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include <opencv2/core/core.hpp>
+#include <samples/embeddings.hpp>
 
 #include "cnn.hpp"
 #include "detector.hpp"
@@ -37,7 +39,9 @@ public:
                       bool crop_gallery, const detection::DetectorConfig &detector_config,
                       const VectorCNN& landmarks_det,
                       const VectorCNN& image_reid,
-                      bool use_greedy_matcher=false);
+                      bool use_greedy_matcher=false,
+                      int top_k=0,
+                      const std::string& cache_path="");
     size_t size() const;
     std::vector<int> GetIDsByEmbeddings(const std::vector<cv::Mat>& embeddings) const;
     std::string GetLabelByID(int id) const;
@@ -49,15 +53,24 @@ private:
                                         const cv::Mat& image,
                                         int min_size_fr,
                                         bool crop_gallery,
-                                        detection::FaceDetection& detector,
+                                        std::unique_ptr<detection::FaceDetection>& detector,
+                                        const detection::DetectorConfig& detector_config,
                                         const VectorCNN& landmarks_det,
                                         const VectorCNN& image_reid,
                                         cv::Mat & embedding);
     std::vector<int> idx_to_id;
     double reid_threshold;
     std::vector<GalleryObject> identities;
+    NormalizedEmbeddings reference_embeddings;  // of all the identities, in the idx_to_id order
     bool use_greedy_matcher;
+    int top_k;  // gallery faces matched per face, 0 for all of them
+    std::shared_ptr<EmbeddingsIndex> index;  // of reference_embeddings if top_k is positive
 };
 
-void AlignFaces(std::vector<cv::Mat>* face_images,
-                std::vector<cv::Mat>* landmarks_vec);
+// Estimates the transforms of all the faces at first and then warps the faces
+// in parallel, each face is warped straight to aligned_size or to its own size
+// if aligned_size is empty.
+void AlignFaces(const std::vector<cv::Mat>& face_images,
+                const std::vector<cv::Mat>& landmarks_vec,
+                cv::Size aligned_size,
+                std::vector<cv::Mat>* aligned_faces);
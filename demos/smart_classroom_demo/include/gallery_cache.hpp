@@ -0,0 +1,81 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+#include <opencv2/core/core.hpp>
+
+///
+/// \brief Binary cache of the registration results of the gallery images.
+///
+/// The entries are keyed by the hash of the image file content. The file
+/// stores the hash of a key describing the models and the registration
+/// parameters, a cache with another key is ignored. The file is memory-mapped
+/// on load, Save() rewrites it with only the entries found or added since, so
+/// the removed images leave the cache and the added ones join it.
+///
+class GalleryCache {
+public:
+    ///
+    /// \brief Loads the cache if the file exists and was saved with the key.
+    /// \param[in] path Path to the cache file.
+    /// \param[in] key Description of what the registration results depend on.
+    ///
+    GalleryCache(const std::string& path, const std::string& key);
+    ~GalleryCache();
+
+    ///
+    /// \brief Hashes the content of an image file.
+    /// \param[in] path Path to the image.
+    /// \param[out] image_hash Hash of the content.
+    /// \return false if the file can't be read.
+    ///
+    static bool HashImage(const std::string& path, uint64_t* image_hash);
+
+    ///
+    /// \brief Finds the registration result of an image.
+    /// \param[in] image_hash Hash of the image file content.
+    /// \param[out] status Registration status.
+    /// \param[out] embedding Embedding if the registration succeeded.
+    /// \return true if the image is in the cache.
+    ///
+    bool Find(uint64_t image_hash, int* status, cv::Mat* embedding);
+
+    ///
+    /// \brief Adds the registration result of an image.
+    /// \param[in] image_hash Hash of the image file content.
+    /// \param[in] status Registration status.
+    /// \param[in] embedding CV_32F embedding, empty if the registration failed.
+    ///
+    void Add(uint64_t image_hash, int status, const cv::Mat& embedding);
+
+    ///
+    /// \brief Writes the found and added entries if they differ from the
+    /// loaded ones.
+    ///
+    void Save();
+
+private:
+    struct Entry {
+        int status;
+        cv::Mat embedding;  // points to the mapped file for the loaded entries
+        bool used;
+    };
+
+    class MappedFile;
+
+    void Load();
+
+    std::string path_;
+    uint64_t key_hash_;
+    std::unique_ptr<MappedFile> file_;
+    std::map<uint64_t, Entry> entries_;
+    cv::Size embedding_size_;
+    bool changed_;
+};
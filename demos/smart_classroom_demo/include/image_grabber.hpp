@@ -5,12 +5,20 @@
 #pragma once
 
 #include <opencv2/opencv.hpp>
+#include <deque>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include <samples/frame_prefetcher.hpp>
+
+// Reads a video, an image, the camera ("cam") or a comma separated list of
+// videos played one after another as one stream. The frames are decoded ahead
+// in background threads, several files of a list are decoded at once, so the
+// next file is ready when the current one ends.
 class ImageGrabber {
 public:
-    explicit ImageGrabber(const std::string& fname);
+    explicit ImageGrabber(const std::string& fname, size_t parallel_files = 2);
     bool GrabNext();
     bool Retrieve(cv::Mat& img);
     bool IsOpened() const;
@@ -18,12 +26,14 @@ public:
     std::string GetVideoPath() const;
 
 private:
-    bool is_sequence;
-    bool is_opened;
-    cv::VideoCapture cap;
+    bool OpenNext();
 
+    bool is_opened;
+    int fps;
+    size_t parallel_files;
     std::vector<std::string> videos;
-    std::vector<std::vector<int>> frames;
+    std::deque<std::unique_ptr<FramePrefetcher>> prefetchers;  // of the current video and the next ones
+    size_t opened_videos;
     int current_video_idx;
-    int current_frame_idx;
+    cv::Mat frame;
 };
@@ -9,11 +9,13 @@
 #include <set>
 #include <unordered_map>
 #include <map>
+#include <memory>
 #include <string>
 #include <iostream>
 #include <opencv2/opencv.hpp>
 #include <sstream>
 #include <details/ie_exception.hpp>
+#include "action_log.hpp"
 #include "tracker.hpp"
 
 #include "actions.hpp"
@@ -23,12 +25,20 @@ private:
     bool write_logs_;
     std::ofstream act_stat_log_stream_;
     cv::FileStorage act_det_log_stream_;
+    std::unique_ptr<ActionLogWriter> act_det_log_writer_;
     std::ostream& log_stream_;
+    std::string source_id_;
 
 public:
+    // source_id prefixes the frame and person records, it tells the rooms
+    // apart when several of them are logged to one stream. The per-person
+    // detections go to act_det_log_file as a binary ActionLogWriter log if
+    // act_det_log_binary is set.
     explicit DetectionsLogger(std::ostream& stream, bool enabled,
                               const std::string& act_stat_log_file,
-                              const std::string& act_det_log_file);
+                              const std::string& act_det_log_file,
+                              bool act_det_log_binary = false,
+                              const std::string& source_id = "");
 
     ~DetectionsLogger();
     void CreateNextFrameRecord(const std::string& path, const int frame_idx,
@@ -10,7 +10,8 @@
 #include <gflags/gflags.h>
 
 static const char help_message[] = "Print a usage message.";
-static const char video_message[] = "Required. Path to a video or image file. Default value is \"cam\" to work with camera.";
+static const char video_message[] = "Required. Path to a video or image file, or a comma separated list of videos "
+                                    "processed one after another. Default value is \"cam\" to work with camera.";
 static const char person_action_detection_model_message[] = "Required. Path to the Person/Action Detection Retail model (.xml) file.";
 static const char face_detection_model_message[] = "Required. Path to the Face Detection Retail model (.xml) file.";
 static const char facial_landmarks_model_message[] = "Required. Path to the Facial Landmarks Regression Retail model (.xml) file.";
@@ -65,6 +66,33 @@ static const char min_size_fr_reg_output_message[] = "Optional. Minimum input si
 static const char act_det_output_message[] = "Optional. Output file name to save per-person action detections in.";
 static const char tracker_smooth_size_message[] = "Optional. Number of frames to smooth actions.";
 static const char utilization_monitors_message[] = "Optional. List of monitors to show initially.";
+static const char cache_dir_message[] = "Optional. Directory to cache compiled networks in. Later runs import the cached networks "
+                                        "instead of compiling them if the model, device and config didn't change. "
+                                        "Devices without network export support compile on each run.";
+static const char log_async_message[] = "Optional. Write the log and the raw output (-r) from a background thread, "
+                                        "so printing does not slow down the processing.";
+static const char log_file_message[] = "Optional. Write the log and the raw output (-r) to the file as JSON Lines records "
+                                       "from a background thread instead of the console.";
+static const char fg_top_k_message[] = "Optional. Number of the nearest gallery faces to match a face with. If positive, "
+                                       "the demo finds them in an approximate (inverted file) index of the gallery, "
+                                       "which is faster for large galleries. 0 matches with the whole gallery exactly.";
+static const char fg_cache_message[] = "Optional. File to cache the embeddings of the faces gallery (-fg) images in. "
+                                       "Later runs register only the images which are not in the cache, the cache is "
+                                       "invalidated if the models or the registration parameters change.";
+static const char reid_interval_message[] = "Optional. Number of frames the identity of a tracked face is kept for "
+                                            "before the face is re-identified again. New tracks and tracks without "
+                                            "an identity are re-identified on every frame. 1 re-identifies all the "
+                                            "faces on every frame.";
+static const char rooms_message[] = "Optional. File with a room id and an input (as for -i) per line. If set, "
+                                    "the demo processes all the rooms instead of -i without showing them. The "
+                                    "networks are loaded once, the faces of all the rooms are recognized in "
+                                    "shared batches, the tracking is done per room and the -r, -ad and -al "
+                                    "outputs are written with the room ids. Only the students actions are "
+                                    "recognized.";
+static const char al_binary_message[] = "Optional. Write the per-person action detections (-al) as a compact binary "
+                                        "columnar log from a background thread. smart_classroom_log_to_csv converts "
+                                        "the log to CSV.";
+static const char parallel_decode_message[] = "Optional. Number of the videos of an -i list decoded at once ahead of the processing.";
 
 DEFINE_bool(h, false, help_message);
 DEFINE_string(i, "cam", video_message);
@@ -107,6 +135,15 @@ DEFINE_int32(min_size_fr, 128, min_size_fr_reg_output_message);
 DEFINE_string(al, "", act_det_output_message);
 DEFINE_int32(ss_t, -1, tracker_smooth_size_message);
 DEFINE_string(u, "", utilization_monitors_message);
+DEFINE_string(cache_dir, "", cache_dir_message);
+DEFINE_bool(log_async, false, log_async_message);
+DEFINE_string(log_file, "", log_file_message);
+DEFINE_int32(fg_top_k, 0, fg_top_k_message);
+DEFINE_string(fg_cache, "", fg_cache_message);
+DEFINE_int32(reid_interval, 10, reid_interval_message);
+DEFINE_string(rooms, "", rooms_message);
+DEFINE_bool(al_binary, false, al_binary_message);
+DEFINE_uint32(parallel_decode, 2, parallel_decode_message);
 
 /**
 * @brief This function show a help message
@@ -158,4 +195,13 @@ static void showUsage() {
     std::cout << "    -al                            " << act_det_output_message << std::endl;
     std::cout << "    -ss_t                          " << tracker_smooth_size_message << std::endl;
     std::cout << "    -u                             " << utilization_monitors_message << std::endl;
+    std::cout << "    -cache_dir \"<path>\"            " << cache_dir_message << std::endl;
+    std::cout << "    -log_async                     " << log_async_message << std::endl;
+    std::cout << "    -log_file \"<path>\"             " << log_file_message << std::endl;
+    std::cout << "    -fg_top_k                      " << fg_top_k_message << std::endl;
+    std::cout << "    -fg_cache \"<path>\"             " << fg_cache_message << std::endl;
+    std::cout << "    -reid_interval                 " << reid_interval_message << std::endl;
+    std::cout << "    -rooms \"<path>\"                " << rooms_message << std::endl;
+    std::cout << "    -al_binary                     " << al_binary_message << std::endl;
+    std::cout << "    -parallel_decode               " << parallel_decode_message << std::endl;
 }
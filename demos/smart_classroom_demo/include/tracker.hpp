@@ -36,7 +36,7 @@ using TrackedObjects = std::vector<TrackedObject>;
 ///
 /// \brief The KuhnMunkres class
 ///
-/// Solves the assignment problem.
+/// Solves the assignment problem with AssignmentSolver or greedily.
 ///
 class KuhnMunkres {
 public:
@@ -170,6 +170,16 @@ struct Track {
                     /// removed from track in order to avoid memory usage growth.
 };
 
+///
+/// \brief The TrackerTimings struct stores how long the stages of processing
+/// of the last frame took in milliseconds.
+///
+struct TrackerTimings {
+    double affinity = 0;    ///< Computing the dissimilarity matrix.
+    double assignment = 0;  ///< Solving the assignment problem.
+    double total = 0;       ///< Whole frame, the rest of it is bookkeeping.
+};
+
 ///
 /// \brief Simple Hungarian algorithm-based tracker.
 ///
@@ -270,6 +280,12 @@ public:
     ///
     void DropForgottenTracks();
 
+    ///
+    /// \brief Timings of the stages of the last processed frame.
+    /// \return Timings of the last Process() call.
+    ///
+    const TrackerTimings &timings() const { return timings_; }
+
 private:
     const std::set<size_t> &active_track_ids() const { return active_track_ids_; }
 
@@ -327,6 +343,8 @@ private:
     size_t tracks_counter_;
 
     cv::Size frame_size_;
+
+    TrackerTimings timings_;
 };
 
 int LabelWithMaxFrequencyInTrack(const Track &track, int window_size);
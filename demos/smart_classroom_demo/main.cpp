@@ -8,6 +8,7 @@
 #include <monitors/presenter.h>
 #include <samples/ocv_common.hpp>
 #include <samples/slog.hpp>
+#include <samples/parallel_load.hpp>
 #include <string>
 #include <memory>
 #include <limits>
@@ -17,6 +18,8 @@
 #include <set>
 #include <algorithm>
 #include <utility>
+#include <fstream>
+#include <sstream>
 #include <ie_iextension.h>
 
 #include "actions.hpp"
@@ -367,6 +370,13 @@ float CalculateIoM(const cv::Rect& rect1, const cv::Rect& rect2) {
   return area_intersect / area_min;
 }
 
+float CalculateIoU(const cv::Rect& rect1, const cv::Rect& rect2) {
+  float area_intersect = static_cast<float>((rect1 & rect2).area());
+  float area_union = static_cast<float>(rect1.area() + rect2.area()) - area_intersect;
+
+  return area_union > 0 ? area_intersect / area_union : 0.0f;
+}
+
 cv::Rect DecreaseRectByRelBorders(const cv::Rect& r) {
     float w = static_cast<float>(r.width);
     float h = static_cast<float>(r.height);
@@ -436,7 +446,19 @@ public:
     virtual std::string GetLabelByID(int id) const = 0;
     virtual std::vector<std::string> GetIDToLabelMap() const = 0;
 
-    virtual std::vector<int> Recognize(const cv::Mat& frame, const detection::DetectedObjects& faces) = 0;
+    /// Starts recognizing the faces of a frame, the frames are recognized in
+    /// the order they are submitted.
+    void Submit(const cv::Mat& frame, const detection::DetectedObjects& faces) {
+        SubmitFrames({frame}, {faces});
+    }
+    /// Starts recognizing the faces of several frames in shared batches.
+    virtual void SubmitFrames(const std::vector<cv::Mat>& frames,
+                              const std::vector<detection::DetectedObjects>& faces) = 0;
+    /// Returns true if the ids of the faces of the oldest submitted frame are ready.
+    virtual bool HasResults() const = 0;
+    /// Returns the ids of the faces of the oldest submitted frame, waits for
+    /// them if they are not ready.
+    virtual std::vector<int> FetchResults() = 0;
 
     virtual void PrintPerformanceCounts(
         const std::string &landmarks_device, const std::string &reid_device) = 0;
@@ -452,12 +474,27 @@ public:
 
     std::vector<std::string> GetIDToLabelMap() const override { return {}; }
 
-    std::vector<int> Recognize(const cv::Mat&, const detection::DetectedObjects& faces) override {
-        return std::vector<int>(faces.size(), EmbeddingsGallery::unknown_id);
+    void SubmitFrames(const std::vector<cv::Mat>&,
+                      const std::vector<detection::DetectedObjects>& faces) override {
+        for (const auto& frame_faces : faces) {
+            ids_.emplace_back(frame_faces.size(), EmbeddingsGallery::unknown_id);
+        }
+    }
+
+    bool HasResults() const override { return !ids_.empty(); }
+
+    std::vector<int> FetchResults() override {
+        CV_Assert(!ids_.empty());
+        std::vector<int> ids = ids_.front();
+        ids_.pop_front();
+        return ids;
     }
 
     void PrintPerformanceCounts(
         const std::string &, const std::string &) override {}
+
+private:
+    std::deque<std::vector<int>> ids_;
 };
 
 class FaceRecognizerDefault : public FaceRecognizer {
@@ -470,13 +507,15 @@ public:
             double reid_threshold,
             int min_size_fr,
             bool crop_gallery,
-            bool greedy_reid_matching
+            bool greedy_reid_matching,
+            int gallery_top_k,
+            const std::string& gallery_cache_path
     )
-        : landmarks_detector(landmarks_detector_config),
+        : landmarks_detector(landmarks_detector_config, cv::Size(2, 5)),
           face_reid(reid_config),
           face_gallery(face_gallery_path, reid_threshold, min_size_fr, crop_gallery,
                        face_registration_det_config, landmarks_detector, face_reid,
-                       greedy_reid_matching)
+                       greedy_reid_matching, gallery_top_k, gallery_cache_path)
     {
         if (face_gallery.size() == 0) {
             slog::warn << "Face reid gallery is empty!" << slog::endl;
@@ -497,33 +536,387 @@ public:
         return face_gallery.GetIDToLabelMap();
     }
 
-    std::vector<int> Recognize(const cv::Mat& frame, const detection::DetectedObjects& faces) override {
-        std::vector<cv::Mat> face_rois;
-
-        for (const auto& face : faces) {
-            face_rois.push_back(frame(face.rect));
+    // The landmarks of the frames are inferred while the faces of the
+    // previously submitted frames are re-identified, so the ids of the frames
+    // are ready when the frames after the next ones are submitted.
+    void SubmitFrames(const std::vector<cv::Mat>& frames,
+                      const std::vector<detection::DetectedObjects>& faces) override {
+        CV_Assert(frames.size() == faces.size());
+        FinishReid();
+        FinishLandmarks();
+
+        landmarks_faces.clear();
+        landmarks_frame_sizes.clear();
+        for (size_t i = 0; i < frames.size(); i++) {
+            for (const auto& face : faces[i]) {
+                landmarks_faces.push_back(frames[i](face.rect));
+                landmarks_detector.enqueue(landmarks_faces.back());
+            }
+            landmarks_frame_sizes.push_back(faces[i].size());
         }
+        landmarks_detector.submitRequest();
+        landmarks_pending = true;
+    }
 
-        std::vector<cv::Mat> landmarks, embeddings;
+    bool HasResults() const override { return !ids.empty(); }
 
-        landmarks_detector.Compute(face_rois, &landmarks, cv::Size(2, 5));
-        AlignFaces(&face_rois, &landmarks);
-        face_reid.Compute(face_rois, &embeddings);
-        return face_gallery.GetIDsByEmbeddings(embeddings);
+    std::vector<int> FetchResults() override {
+        FinishReid();
+        if (ids.empty()) {
+            FinishLandmarks();
+            FinishReid();
+        }
+        CV_Assert(!ids.empty());
+        std::vector<int> frame_ids = ids.front();
+        ids.pop_front();
+        return frame_ids;
     }
 
     void PrintPerformanceCounts(
             const std::string &landmarks_device, const std::string &reid_device) {
-        landmarks_detector.PrintPerformanceCounts(landmarks_device);
-        face_reid.PrintPerformanceCounts(reid_device);
+        landmarks_detector.wait();
+        face_reid.wait();
+        landmarks_detector.printPerformanceCounts(landmarks_device);
+        face_reid.printPerformanceCounts(reid_device);
     }
 
 private:
-    VectorCNN landmarks_detector;
-    VectorCNN face_reid;
+    void FinishLandmarks() {
+        if (!landmarks_pending) return;
+        landmarks_detector.wait();
+        std::vector<cv::Mat> landmarks = landmarks_detector.fetchResults();
+        std::vector<cv::Mat> aligned_faces;
+        AlignFaces(landmarks_faces, landmarks, face_reid.input_size(), &aligned_faces);
+        for (const auto& face : aligned_faces) {
+            face_reid.enqueue(face);
+        }
+        face_reid.submitRequest();
+        reid_frame_sizes = landmarks_frame_sizes;
+        landmarks_pending = false;
+        reid_pending = true;
+    }
+
+    void FinishReid() {
+        if (!reid_pending) return;
+        face_reid.wait();
+        const std::vector<cv::Mat> embeddings = face_reid.fetchResults();
+        auto frame_begin = embeddings.begin();
+        for (size_t frame_size : reid_frame_sizes) {
+            ids.push_back(face_gallery.GetIDsByEmbeddings({frame_begin, frame_begin + frame_size}));
+            frame_begin += frame_size;
+        }
+        reid_pending = false;
+    }
+
+    AsyncVectorCNN landmarks_detector;
+    AsyncVectorCNN face_reid;
     EmbeddingsGallery face_gallery;
+    std::vector<cv::Mat> landmarks_faces;
+    std::vector<size_t> landmarks_frame_sizes;  // numbers of the faces of the frames
+    std::vector<size_t> reid_frame_sizes;
+    bool landmarks_pending = false;
+    bool reid_pending = false;
+    std::deque<std::vector<int>> ids;
+};
+
+// State of a frame waiting for the ids of its faces
+struct RecognitionFrame {
+    cv::Mat frame;
+    std::string path;
+    detection::DetectedObjects faces;
+    DetectedActions actions;
+    std::vector<size_t> recognized_faces;  // indices of the faces passed to the recognizer
+
+    // Returns the ids of all the faces given the ids of the recognized ones,
+    // the other faces are unknown
+    std::vector<int> FaceIds(const std::vector<int>& recognized_ids) const {
+        std::vector<int> ids(faces.size(), EmbeddingsGallery::unknown_id);
+        for (size_t i = 0; i < recognized_faces.size(); i++) {
+            ids[recognized_faces[i]] = recognized_ids[i];
+        }
+        return ids;
+    }
+};
+
+// Decides which faces of a frame are re-identified. A face is matched with the
+// face tracks of the last tracked frame and is re-identified if it starts a
+// new track, its track has no identity yet or the track was re-identified
+// reid_interval frames ago. The tracker votes the identities of the other
+// faces from the re-identified faces of their tracks.
+class FaceIdentityCache {
+public:
+    explicit FaceIdentityCache(int reid_interval) : reid_interval(std::max(reid_interval, 1)) {}
+
+    std::vector<size_t> SelectFacesToRecognize(const detection::DetectedObjects& faces,
+                                               const TrackedObjects& tracked_faces,
+                                               size_t frame_idx) {
+        const float min_track_iou = 0.5f;
+        std::vector<size_t> selected;
+        std::set<int> matched_tracks;
+        for (size_t i = 0; i < faces.size(); i++) {
+            int track_ind = -1;
+            float max_iou = min_track_iou;
+            for (size_t j = 0; j < tracked_faces.size(); j++) {
+                float iou = CalculateIoU(faces[i].rect, tracked_faces[j].rect);
+                if (iou > max_iou && matched_tracks.count(tracked_faces[j].object_id) == 0) {
+                    max_iou = iou;
+                    track_ind = static_cast<int>(j);
+                }
+            }
+            ++faces_number;
+
+            if (track_ind >= 0) {
+                const auto& track = tracked_faces[track_ind];
+                matched_tracks.insert(track.object_id);
+                auto last_reid = last_reid_frames.find(track.object_id);
+                if (track.label != EmbeddingsGallery::unknown_id && last_reid != last_reid_frames.end() &&
+                    frame_idx - last_reid->second < static_cast<size_t>(reid_interval)) {
+                    ++saved_reids_number;
+                    continue;
+                }
+                last_reid_frames[track.object_id] = frame_idx;
+            }
+            selected.push_back(i);
+        }
+        return selected;
+    }
+
+    size_t saved_reids() const { return saved_reids_number; }
+    size_t faces() const { return faces_number; }
+
+private:
+    int reid_interval;
+    std::map<int, size_t> last_reid_frames;  // by face track id
+    size_t saved_reids_number = 0;
+    size_t faces_number = 0;
 };
 
+void DumpStudentActions(const Tracker& tracker_reid, const FaceRecognizer& face_recognizer,
+                        const std::vector<std::map<int, int>>& face_obj_id_to_action_maps,
+                        const std::vector<std::string>& actions_map,
+                        int smooth_window_size, int smooth_min_length,
+                        const std::string& video_path, const cv::Size& frame_size, size_t num_frames,
+                        DetectionsLogger* logger) {
+    auto face_tracks = tracker_reid.vector_tracks();
+
+    // correct labels for track
+    std::vector<Track> new_face_tracks = UpdateTrackLabelsToBestAndFilterOutUnknowns(face_tracks);
+    std::map<int, int> face_track_id_to_label = GetMapFaceTrackIdToLabel(new_face_tracks);
+
+    std::vector<std::string> face_id_to_label_map = face_recognizer.GetIDToLabelMap();
+
+    if (!face_id_to_label_map.empty()) {
+        std::map<int, FrameEventsTrack> face_obj_id_to_actions_track;
+        ConvertActionMapsToFrameEventTracks(face_obj_id_to_action_maps, default_action_index,
+                                            &face_obj_id_to_actions_track);
+
+        const int start_frame = 0;
+        const int end_frame = face_obj_id_to_action_maps.size();
+        std::map<int, RangeEventsTrack> face_obj_id_to_events;
+        SmoothTracks(face_obj_id_to_actions_track, start_frame, end_frame,
+                     smooth_window_size, smooth_min_length, default_action_index,
+                     &face_obj_id_to_events);
+
+        slog::info << "Final ID->events mapping" << slog::endl;
+        logger->DumpTracks(face_obj_id_to_events,
+                           actions_map, face_track_id_to_label,
+                           face_id_to_label_map);
+
+        std::vector<std::map<int, int>> face_obj_id_to_smoothed_action_maps;
+        ConvertRangeEventsTracksToActionMaps(end_frame, face_obj_id_to_events,
+                                             &face_obj_id_to_smoothed_action_maps);
+
+        slog::info << "Final per-frame ID->action mapping" << slog::endl;
+        logger->DumpDetections(video_path, frame_size, num_frames,
+                               new_face_tracks,
+                               face_track_id_to_label,
+                               actions_map, face_id_to_label_map,
+                               face_obj_id_to_smoothed_action_maps);
+    }
+}
+
+// Appends the room id to the name of an output file
+std::string RoomFilePath(const std::string& path, const std::string& room_id) {
+    if (path.empty()) {
+        return path;
+    }
+    size_t ext = path.rfind('.');
+    size_t dir = path.find_last_of("/\\");
+    if (ext == std::string::npos || (dir != std::string::npos && ext < dir)) {
+        ext = path.size();
+    }
+    return path.substr(0, ext) + "_" + room_id + path.substr(ext);
+}
+
+// Input, detectors and trackers of a room processed with -rooms
+struct Room {
+    Room(const std::string& id, const std::string& input,
+         const TrackerParams& tracker_reid_params, const TrackerParams& tracker_action_params,
+         std::ostream& raw_output)
+        : id(id), cap(input, FLAGS_parallel_decode),
+          tracker_reid(tracker_reid_params), tracker_action(tracker_action_params),
+          logger(raw_output, FLAGS_r, RoomFilePath(FLAGS_ad, id), RoomFilePath(FLAGS_al, id), FLAGS_al_binary, id),
+          identity_cache(FLAGS_reid_interval) {}
+
+    std::string id;
+    ImageGrabber cap;
+    std::unique_ptr<AsyncDetection<DetectedAction>> action_detector;
+    std::unique_ptr<AsyncDetection<detection::DetectedObject>> face_detector;
+    Tracker tracker_reid;
+    Tracker tracker_action;
+    DetectionsLogger logger;
+    FaceIdentityCache identity_cache;
+    std::deque<RecognitionFrame> recognition_frames;
+    std::vector<std::map<int, int>> face_obj_id_to_action_maps;
+    cv::Mat frame, prev_frame;
+    std::string prev_frame_path;
+    size_t submitted_frames = 0;
+    size_t processed_frames = 0;
+    bool is_last_frame = false;
+};
+
+void ProcessRoomFrame(const RecognitionFrame& recognized, const std::vector<int>& ids,
+                      const FaceRecognizer& face_recognizer, const std::vector<std::string>& actions_map,
+                      Room* room) {
+    const size_t frame_idx = room->processed_frames;
+    room->logger.CreateNextFrameRecord(recognized.path, frame_idx, recognized.frame.cols, recognized.frame.rows);
+
+    TrackedObjects tracked_face_objects;
+    for (size_t i = 0; i < recognized.faces.size(); i++) {
+        tracked_face_objects.emplace_back(recognized.faces[i].rect, recognized.faces[i].confidence, ids[i]);
+    }
+    room->tracker_reid.Process(recognized.frame, tracked_face_objects, frame_idx);
+    const auto tracked_faces = room->tracker_reid.TrackedDetectionsWithLabels();
+
+    TrackedObjects tracked_action_objects;
+    for (const auto& action : recognized.actions) {
+        tracked_action_objects.emplace_back(action.rect, action.detection_conf, action.label);
+    }
+    room->tracker_action.Process(recognized.frame, tracked_action_objects, frame_idx);
+    const auto tracked_actions = room->tracker_action.TrackedDetectionsWithLabels();
+
+    std::map<int, int> frame_face_obj_id_to_action;
+    for (const auto& face : tracked_faces) {
+        int person_ind = GetIndexOfTheNearestPerson(face, tracked_actions);
+        frame_face_obj_id_to_action[face.object_id] =
+            person_ind >= 0 ? tracked_actions[person_ind].label : default_action_index;
+        room->logger.AddFaceToFrame(face.rect, face_recognizer.GetLabelByID(face.label), "");
+    }
+    for (const auto& action : tracked_actions) {
+        room->logger.AddPersonToFrame(action.rect, GetActionTextLabel(action.label, actions_map), "");
+        room->logger.AddDetectionToFrame(action, frame_idx);
+    }
+    room->face_obj_id_to_action_maps.push_back(frame_face_obj_id_to_action);
+
+    room->logger.FinalizeFrameRecord();
+    ++room->processed_frames;
+}
+
+// Processes the rooms of the rooms file in lockstep. The detectors of all the
+// rooms share the loaded networks and infer the frames of the rooms at once,
+// the faces of the frames of all the rooms are recognized in shared batches.
+bool ProcessRooms(const std::string& rooms_path,
+                  const AsyncDetection<DetectedAction>& action_detector,
+                  const AsyncDetection<detection::DetectedObject>& face_detector,
+                  FaceRecognizer* face_recognizer,
+                  const TrackerParams& tracker_reid_params,
+                  const TrackerParams& tracker_action_params,
+                  const std::vector<std::string>& actions_map,
+                  std::ostream& raw_output) {
+    std::vector<std::unique_ptr<Room>> rooms;
+    std::ifstream rooms_file(rooms_path);
+    std::string line;
+    while (std::getline(rooms_file, line)) {
+        std::istringstream line_stream(line);
+        std::string id, input;
+        if (!(line_stream >> id)) {
+            continue;
+        }
+        std::getline(line_stream >> std::ws, input);
+
+        slog::info << "Reading video '" << input << "' of the room " << id << slog::endl;
+        rooms.emplace_back(new Room(id, input, tracker_reid_params, tracker_action_params, raw_output));
+        Room& room = *rooms.back();
+        if (!room.cap.IsOpened() || !room.cap.GrabNext() || !room.cap.Retrieve(room.frame)) {
+            slog::err << "Can't read the first frame of the room " << id << slog::endl;
+            return false;
+        }
+        room.action_detector = action_detector.clone();
+        room.face_detector = face_detector.clone();
+        room.action_detector->enqueue(room.frame);
+        room.action_detector->submitRequest();
+        room.face_detector->enqueue(room.frame);
+        room.face_detector->submitRequest();
+        room.prev_frame = room.frame.clone();
+        room.prev_frame_path = room.cap.GetVideoPath();
+    }
+    if (rooms.empty()) {
+        slog::err << "No rooms in " << rooms_path << slog::endl;
+        return false;
+    }
+
+    std::deque<Room*> recognition_order;  // rooms of the frames submitted to the recognizer
+    size_t active_rooms = rooms.size();
+    while (active_rooms > 0) {
+        std::vector<cv::Mat> frames;
+        std::vector<detection::DetectedObjects> faces_to_recognize;
+        for (auto& room_ptr : rooms) {
+            Room& room = *room_ptr;
+            if (room.is_last_frame) continue;
+            room.is_last_frame = !room.cap.GrabNext() || !room.cap.Retrieve(room.frame);
+
+            room.face_detector->wait();
+            detection::DetectedObjects faces = room.face_detector->fetchResults();
+            room.action_detector->wait();
+            DetectedActions actions = room.action_detector->fetchResults();
+
+            auto recognized_faces = room.identity_cache.SelectFacesToRecognize(
+                faces, room.tracker_reid.TrackedDetectionsWithLabels(), room.submitted_frames++);
+            frames.push_back(room.prev_frame);
+            faces_to_recognize.emplace_back();
+            for (size_t i : recognized_faces) {
+                faces_to_recognize.back().push_back(faces[i]);
+            }
+            room.recognition_frames.push_back({room.prev_frame, room.prev_frame_path, faces, actions,
+                                               recognized_faces});
+            recognition_order.push_back(&room);
+
+            if (room.is_last_frame) {
+                --active_rooms;
+                continue;
+            }
+            room.prev_frame_path = room.cap.GetVideoPath();
+            room.face_detector->enqueue(room.frame);
+            room.face_detector->submitRequest();
+            room.action_detector->enqueue(room.frame);
+            room.action_detector->submitRequest();
+            room.prev_frame = room.frame.clone();
+        }
+        face_recognizer->SubmitFrames(frames, faces_to_recognize);
+
+        while (!recognition_order.empty() && (face_recognizer->HasResults() || active_rooms == 0)) {
+            Room* room = recognition_order.front();
+            recognition_order.pop_front();
+            RecognitionFrame recognized = std::move(room->recognition_frames.front());
+            room->recognition_frames.pop_front();
+            ProcessRoomFrame(recognized, recognized.FaceIds(face_recognizer->FetchResults()),
+                             *face_recognizer, actions_map, room);
+        }
+    }
+
+    for (const auto& room : rooms) {
+        slog::info << "Room " << room->id << ": frames processed: " << room->processed_frames
+                   << ", face re-id inferences saved: " << room->identity_cache.saved_reids()
+                   << " of " << room->identity_cache.faces() << slog::endl;
+        DumpStudentActions(room->tracker_reid, *face_recognizer, room->face_obj_id_to_action_maps, actions_map,
+                           static_cast<int>(room->cap.GetFPS() * FLAGS_d_ad),
+                           static_cast<int>(room->cap.GetFPS() * FLAGS_min_ad),
+                           room->cap.GetVideoPath(), room->prev_frame.size(), room->processed_frames,
+                           &room->logger);
+    }
+    return true;
+}
+
 bool ParseAndCheckCommandLine(int argc, char *argv[]) {
     // ---------------------------Parsing and validation of input args--------------------------------------
 
@@ -536,8 +929,8 @@ bool ParseAndCheckCommandLine(int argc, char *argv[]) {
 
     slog::info << "Parsing input parameters" << slog::endl;
 
-    if (FLAGS_i.empty()) {
-        throw std::logic_error("Parameter -i is not set");
+    if (FLAGS_i.empty() && FLAGS_rooms.empty()) {
+        throw std::logic_error("Parameter -i or -rooms is not set");
     }
     if (FLAGS_m_act.empty() && FLAGS_m_fd.empty()) {
         throw std::logic_error("At least one parameter -m_act or -m_fd must be set");
@@ -557,6 +950,12 @@ int main(int argc, char* argv[]) {
             return 0;
         }
 
+        if (!FLAGS_log_file.empty()) {
+            slog::startAsyncLogging(std::unique_ptr<slog::AsyncSink>(new slog::AsyncSink(FLAGS_log_file)));
+        } else if (FLAGS_log_async) {
+            slog::startAsyncLogging(std::unique_ptr<slog::AsyncSink>(new slog::AsyncSink(std::cout)));
+        }
+
         const auto video_path = FLAGS_i;
         const auto ad_model_path = FLAGS_m_act;
         const auto fd_model_path = FLAGS_m_fd;
@@ -587,13 +986,21 @@ int main(int argc, char* argv[]) {
             return 1;
         }
 
-        slog::info << "Reading video '" << video_path << "'" << slog::endl;
-        ImageGrabber cap(video_path);
-        if (!cap.IsOpened()) {
-            slog::err << "Cannot open the video" << slog::endl;
+        if (!FLAGS_rooms.empty() && actions_type != STUDENT) {
+            slog::err << "Only the students actions can be recognized in several rooms (-rooms)." << slog::endl;
             return 1;
         }
 
+        std::unique_ptr<ImageGrabber> cap;
+        if (FLAGS_rooms.empty()) {
+            slog::info << "Reading video '" << video_path << "'" << slog::endl;
+            cap.reset(new ImageGrabber(video_path, FLAGS_parallel_decode));
+            if (!cap->IsOpened()) {
+                slog::err << "Cannot open the video" << slog::endl;
+                return 1;
+            }
+        }
+
         slog::info << "Loading Inference Engine" << slog::endl;
         Core ie;
 
@@ -634,17 +1041,22 @@ int main(int argc, char* argv[]) {
             loadedDevices.insert(device);
         }
 
+        // every detector and recognizer is constructed on a loader thread from a config filled in here
+        ParallelLoader loader;
         std::unique_ptr<AsyncDetection<DetectedAction>> action_detector;
         if (!ad_model_path.empty()) {
             // Load action detector
             ActionDetectorConfig action_config(ad_model_path);
             action_config.deviceName = FLAGS_d_act;
             action_config.ie = ie;
+            action_config.cache_dir = FLAGS_cache_dir;
             action_config.is_async = true;
             action_config.detection_confidence_threshold = static_cast<float>(FLAGS_t_ad);
             action_config.action_confidence_threshold = static_cast<float>(FLAGS_t_ar);
             action_config.num_action_classes = actions_map.size();
-            action_detector.reset(new ActionDetection(action_config));
+            loader.add("action detection", [&action_detector, action_config]() {
+                action_detector.reset(new ActionDetection(action_config));
+            });
         } else {
             action_detector.reset(new NullDetection<DetectedAction>);
         }
@@ -655,13 +1067,16 @@ int main(int argc, char* argv[]) {
             detection::DetectorConfig face_config(fd_model_path);
             face_config.deviceName = FLAGS_d_fd;
             face_config.ie = ie;
+            face_config.cache_dir = FLAGS_cache_dir;
             face_config.is_async = true;
             face_config.confidence_threshold = static_cast<float>(FLAGS_t_fd);
             face_config.input_h = FLAGS_inh_fd;
             face_config.input_w = FLAGS_inw_fd;
             face_config.increase_scale_x = static_cast<float>(FLAGS_exp_r_fd);
             face_config.increase_scale_y = static_cast<float>(FLAGS_exp_r_fd);
-            face_detector.reset(new detection::FaceDetection(face_config));
+            loader.add("face detection", [&face_detector, face_config]() {
+                face_detector.reset(new detection::FaceDetection(face_config));
+            });
         } else {
             face_detector.reset(new NullDetection<detection::DetectedObject>);
         }
@@ -674,6 +1089,7 @@ int main(int argc, char* argv[]) {
             detection::DetectorConfig face_registration_det_config(fd_model_path);
             face_registration_det_config.deviceName = FLAGS_d_fd;
             face_registration_det_config.ie = ie;
+            face_registration_det_config.cache_dir = FLAGS_cache_dir;
             face_registration_det_config.is_async = false;
             face_registration_det_config.confidence_threshold = static_cast<float>(FLAGS_t_reg_fd);
             face_registration_det_config.increase_scale_x = static_cast<float>(FLAGS_exp_r_fd);
@@ -686,6 +1102,7 @@ int main(int argc, char* argv[]) {
             else
                 reid_config.max_batch_size = 1;
             reid_config.ie = ie;
+            reid_config.cache_dir = FLAGS_cache_dir;
 
             CnnConfig landmarks_config(lm_model_path);
             landmarks_config.deviceName = FLAGS_d_lm;
@@ -694,16 +1111,16 @@ int main(int argc, char* argv[]) {
             else
                 landmarks_config.max_batch_size = 1;
             landmarks_config.ie = ie;
-
-            face_recognizer.reset(new FaceRecognizerDefault(
-                landmarks_config, reid_config,
-                face_registration_det_config,
-                FLAGS_fg, FLAGS_t_reid, FLAGS_min_size_fr, FLAGS_crop_gallery, FLAGS_greedy_reid_matching));
-
-            if (actions_type == TEACHER && !face_recognizer->LabelExists(teacher_id)) {
-                slog::err << "Teacher id does not exist in the gallery!" << slog::endl;
-                return 1;
-            }
+            landmarks_config.cache_dir = FLAGS_cache_dir;
+
+            // the landmarks and the reidentification networks are loaded together with the gallery they embed
+            loader.add("face recognition", [&face_recognizer, landmarks_config, reid_config, face_registration_det_config]() {
+                face_recognizer.reset(new FaceRecognizerDefault(
+                    landmarks_config, reid_config,
+                    face_registration_det_config,
+                    FLAGS_fg, FLAGS_t_reid, FLAGS_min_size_fr, FLAGS_crop_gallery, FLAGS_greedy_reid_matching,
+                    FLAGS_fg_top_k, FLAGS_fg_cache));
+            });
         } else {
             slog::warn << "Face recognition models are disabled!" << slog::endl;
             if (actions_type == TEACHER) {
@@ -713,6 +1130,13 @@ int main(int argc, char* argv[]) {
 
             face_recognizer.reset(new FaceRecognizerNull);
         }
+        loader.run();
+        loader.report();
+
+        if (actions_type == TEACHER && !face_recognizer->LabelExists(teacher_id)) {
+            slog::err << "Teacher id does not exist in the gallery!" << slog::endl;
+            return 1;
+        }
 
         // Create tracker for reid
         TrackerParams tracker_reid_params;
@@ -744,6 +1168,23 @@ int main(int argc, char* argv[]) {
 
         Tracker tracker_action(tracker_action_params);
 
+        if (!FLAGS_rooms.empty()) {
+            slog::AsyncLineStream raw_output(std::cout);
+            if (!ProcessRooms(FLAGS_rooms, *action_detector, *face_detector, face_recognizer.get(),
+                              tracker_reid_params, tracker_action_params, actions_map, raw_output)) {
+                return 1;
+            }
+            if (FLAGS_pc) {
+                std::map<std::string, std::string> mapDevices = getMapFullDevicesNames(ie, devices);
+                face_recognizer->PrintPerformanceCounts(
+                    getFullDeviceName(mapDevices, FLAGS_d_lm),
+                    getFullDeviceName(mapDevices, FLAGS_d_reid));
+            }
+            slog::stopAsyncLogging();
+            slog::info << "Execution successful" << slog::endl;
+            return 0;
+        }
+
         cv::Mat frame, prev_frame;
 
         float work_time_ms = 0.f;
@@ -761,8 +1202,8 @@ int main(int argc, char* argv[]) {
 
         int teacher_track_id = -1;
 
-        if (cap.GrabNext()) {
-            cap.Retrieve(frame);
+        if (cap->GrabNext()) {
+            cap->Retrieve(frame);
         } else {
             slog::err << "Can't read the first frame" << slog::endl;
             return 1;
@@ -779,18 +1220,19 @@ int main(int argc, char* argv[]) {
 
         bool is_last_frame = false;
         bool is_monitoring_enabled = false;
-        auto prev_frame_path = cap.GetVideoPath();
+        auto prev_frame_path = cap->GetVideoPath();
 
         cv::VideoWriter vid_writer;
         if (!FLAGS_out_v.empty()) {
             vid_writer = cv::VideoWriter(FLAGS_out_v, cv::VideoWriter::fourcc('M', 'J', 'P', 'G'),
-                                         cap.GetFPS(), Visualizer::GetOutputSize(frame.size()));
+                                         cap->GetFPS(), Visualizer::GetOutputSize(frame.size()));
         }
         Visualizer sc_visualizer(!FLAGS_no_show, vid_writer, num_top_persons);
-        DetectionsLogger logger(std::cout, FLAGS_r, FLAGS_ad, FLAGS_al);
+        slog::AsyncLineStream raw_output(std::cout);
+        DetectionsLogger logger(raw_output, FLAGS_r, FLAGS_ad, FLAGS_al, FLAGS_al_binary);
 
-        const int smooth_window_size = static_cast<int>(cap.GetFPS() * FLAGS_d_ad);
-        const int smooth_min_length = static_cast<int>(cap.GetFPS() * FLAGS_min_ad);
+        const int smooth_window_size = static_cast<int>(cap->GetFPS() * FLAGS_d_ad);
+        const int smooth_min_length = static_cast<int>(cap->GetFPS() * FLAGS_min_ad);
 
         std::cout << "To close the application, press 'CTRL+C' here";
         if (!FLAGS_no_show) {
@@ -801,13 +1243,14 @@ int main(int argc, char* argv[]) {
         cv::Size graphSize{static_cast<int>(frame.cols / 4), 60};
         Presenter presenter(FLAGS_u, frame.rows - graphSize.height - 10, graphSize);
 
+        std::deque<RecognitionFrame> recognition_frames;
+        FaceIdentityCache identity_cache(FLAGS_reid_interval);
         while (!is_last_frame) {
-            logger.CreateNextFrameRecord(cap.GetVideoPath(), work_num_frames, prev_frame.cols, prev_frame.rows);
             auto started = std::chrono::high_resolution_clock::now();
 
-            is_last_frame = !cap.GrabNext();
+            is_last_frame = !cap->GrabNext();
             if (!is_last_frame)
-                cap.Retrieve(frame);
+                cap->Retrieve(frame);
 
             char key = cv::waitKey(1);
             if (key == ESC_KEY) {
@@ -815,11 +1258,11 @@ int main(int argc, char* argv[]) {
             }
             presenter.handleKey(key);
 
-            presenter.drawGraphs(prev_frame);
-
-            sc_visualizer.SetFrame(prev_frame);
-
             if (actions_type == TOP_K) {
+                logger.CreateNextFrameRecord(cap->GetVideoPath(), work_num_frames, prev_frame.cols, prev_frame.rows);
+                presenter.drawGraphs(prev_frame);
+                sc_visualizer.SetFrame(prev_frame);
+
                 if ( (is_monitoring_enabled && key == SPACE_KEY) ||
                      (!is_monitoring_enabled && key != SPACE_KEY) ) {
                     if (key == SPACE_KEY) {
@@ -854,7 +1297,7 @@ int main(int argc, char* argv[]) {
                     DetectedActions actions = action_detector->fetchResults();
 
                     if (!is_last_frame) {
-                        prev_frame_path = cap.GetVideoPath();
+                        prev_frame_path = cap->GetVideoPath();
                         action_detector->enqueue(frame);
                         action_detector->submitRequest();
                     }
@@ -903,115 +1346,146 @@ int main(int argc, char* argv[]) {
                         sc_visualizer.DrawObject(action.rect, box_caption, white_color, box_color, true);
                     }
                 }
+
+                sc_visualizer.Show();
+                if (FLAGS_last_frame >= 0 && work_num_frames > static_cast<size_t>(FLAGS_last_frame)) {
+                    break;
+                }
+                logger.FinalizeFrameRecord();
             } else {
                 face_detector->wait();
-                detection::DetectedObjects faces = face_detector->fetchResults();
+                detection::DetectedObjects detected_faces = face_detector->fetchResults();
 
                 action_detector->wait();
-                DetectedActions actions = action_detector->fetchResults();
+                DetectedActions detected_actions = action_detector->fetchResults();
+
+                auto recognized_faces = identity_cache.SelectFacesToRecognize(
+                    detected_faces, tracker_reid.TrackedDetectionsWithLabels(), total_num_frames);
+                detection::DetectedObjects faces_to_recognize;
+                for (size_t i : recognized_faces) {
+                    faces_to_recognize.push_back(detected_faces[i]);
+                }
+                face_recognizer->Submit(prev_frame, faces_to_recognize);
+                recognition_frames.push_back({prev_frame, prev_frame_path, detected_faces, detected_actions,
+                                              recognized_faces});
 
                 if (!is_last_frame) {
-                    prev_frame_path = cap.GetVideoPath();
+                    prev_frame_path = cap->GetVideoPath();
                     face_detector->enqueue(frame);
                     face_detector->submitRequest();
                     action_detector->enqueue(frame);
                     action_detector->submitRequest();
                 }
 
-                auto ids = face_recognizer->Recognize(prev_frame, faces);
+                // The frames are shown once the ids of their faces are ready,
+                // the last ones are shown when the input ends
+                while (!recognition_frames.empty() && (face_recognizer->HasResults() || is_last_frame)) {
+                    RecognitionFrame recognized = std::move(recognition_frames.front());
+                    recognition_frames.pop_front();
+                    const auto& faces = recognized.faces;
+                    const auto& actions = recognized.actions;
+                    cv::Mat recognized_frame = recognized.frame;
+                    auto ids = recognized.FaceIds(face_recognizer->FetchResults());
+
+                    logger.CreateNextFrameRecord(recognized.path, work_num_frames,
+                                                 recognized_frame.cols, recognized_frame.rows);
+                    presenter.drawGraphs(recognized_frame);
+                    sc_visualizer.SetFrame(recognized_frame);
+
+                    TrackedObjects tracked_face_objects;
+
+                    for (size_t i = 0; i < faces.size(); i++) {
+                        tracked_face_objects.emplace_back(faces[i].rect, faces[i].confidence, ids[i]);
+                    }
+                    tracker_reid.Process(recognized_frame, tracked_face_objects, work_num_frames);
 
-                TrackedObjects tracked_face_objects;
+                    const auto tracked_faces = tracker_reid.TrackedDetectionsWithLabels();
 
-                for (size_t i = 0; i < faces.size(); i++) {
-                    tracked_face_objects.emplace_back(faces[i].rect, faces[i].confidence, ids[i]);
-                }
-                tracker_reid.Process(prev_frame, tracked_face_objects, work_num_frames);
+                    TrackedObjects tracked_action_objects;
+                    for (const auto& action : actions) {
+                        tracked_action_objects.emplace_back(action.rect, action.detection_conf, action.label);
+                    }
 
-                const auto tracked_faces = tracker_reid.TrackedDetectionsWithLabels();
+                    tracker_action.Process(recognized_frame, tracked_action_objects, work_num_frames);
+                    const auto tracked_actions = tracker_action.TrackedDetectionsWithLabels();
 
-                TrackedObjects tracked_action_objects;
-                for (const auto& action : actions) {
-                    tracked_action_objects.emplace_back(action.rect, action.detection_conf, action.label);
-                }
+                    auto elapsed = std::chrono::high_resolution_clock::now() - started;
+                    auto elapsed_ms =
+                            std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
 
-                tracker_action.Process(prev_frame, tracked_action_objects, work_num_frames);
-                const auto tracked_actions = tracker_action.TrackedDetectionsWithLabels();
+                    work_time_ms += elapsed_ms;
 
-                auto elapsed = std::chrono::high_resolution_clock::now() - started;
-                auto elapsed_ms =
-                        std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+                    std::map<int, int> frame_face_obj_id_to_action;
+                    for (size_t j = 0; j < tracked_faces.size(); j++) {
+                        const auto& face = tracked_faces[j];
+                        std::string face_label = face_recognizer->GetLabelByID(face.label);
 
-                work_time_ms += elapsed_ms;
+                        std::string label_to_draw;
+                        if (face.label != EmbeddingsGallery::unknown_id)
+                            label_to_draw += face_label;
 
-                std::map<int, int> frame_face_obj_id_to_action;
-                for (size_t j = 0; j < tracked_faces.size(); j++) {
-                    const auto& face = tracked_faces[j];
-                    std::string face_label = face_recognizer->GetLabelByID(face.label);
+                        int person_ind = GetIndexOfTheNearestPerson(face, tracked_actions);
+                        int action_ind = default_action_index;
+                        if (person_ind >= 0) {
+                            action_ind = tracked_actions[person_ind].label;
+                        }
 
-                    std::string label_to_draw;
-                    if (face.label != EmbeddingsGallery::unknown_id)
-                        label_to_draw += face_label;
+                        if (actions_type == STUDENT) {
+                            if (action_ind != default_action_index) {
+                                label_to_draw += "[" + GetActionTextLabel(action_ind, actions_map) + "]";
+                            }
+                            frame_face_obj_id_to_action[face.object_id] = action_ind;
+                            sc_visualizer.DrawObject(face.rect, label_to_draw, red_color, white_color, true);
+                            logger.AddFaceToFrame(face.rect, face_label, "");
+                        }
 
-                    int person_ind = GetIndexOfTheNearestPerson(face, tracked_actions);
-                    int action_ind = default_action_index;
-                    if (person_ind >= 0) {
-                        action_ind = tracked_actions[person_ind].label;
+                        if ((actions_type == TEACHER) && (person_ind >= 0)) {
+                            if (face_label == teacher_id) {
+                                teacher_track_id = tracked_actions[person_ind].object_id;
+                            } else if (teacher_track_id == tracked_actions[person_ind].object_id) {
+                                teacher_track_id = -1;
+                            }
+                        }
                     }
 
                     if (actions_type == STUDENT) {
-                        if (action_ind != default_action_index) {
-                            label_to_draw += "[" + GetActionTextLabel(action_ind, actions_map) + "]";
+                        for (const auto& action : tracked_actions) {
+                            const auto& action_label = GetActionTextLabel(action.label, actions_map);
+                            const auto& action_color = GetActionTextColor(action.label);
+                            const auto& text_label = fd_model_path.empty() ? action_label : "";
+                            sc_visualizer.DrawObject(action.rect, text_label, action_color, white_color, true);
+                            logger.AddPersonToFrame(action.rect, action_label, "");
+                            logger.AddDetectionToFrame(action, work_num_frames);
                         }
-                        frame_face_obj_id_to_action[face.object_id] = action_ind;
-                        sc_visualizer.DrawObject(face.rect, label_to_draw, red_color, white_color, true);
-                        logger.AddFaceToFrame(face.rect, face_label, "");
-                    }
-
-                    if ((actions_type == TEACHER) && (person_ind >= 0)) {
-                        if (face_label == teacher_id) {
-                            teacher_track_id = tracked_actions[person_ind].object_id;
-                        } else if (teacher_track_id == tracked_actions[person_ind].object_id) {
-                            teacher_track_id = -1;
+                        face_obj_id_to_action_maps.push_back(frame_face_obj_id_to_action);
+                    } else if (teacher_track_id >= 0) {
+                        auto res_find = std::find_if(tracked_actions.begin(), tracked_actions.end(),
+                                    [teacher_track_id](const TrackedObject& o){ return o.object_id == teacher_track_id; });
+                        if (res_find != tracked_actions.end()) {
+                            const auto& track_action = *res_find;
+                            const auto& action_label = GetActionTextLabel(track_action.label, actions_map);
+                            sc_visualizer.DrawObject(track_action.rect, action_label, red_color, white_color, true);
+                            logger.AddPersonToFrame(track_action.rect, action_label, teacher_id);
                         }
                     }
-                }
 
-                if (actions_type == STUDENT) {
-                    for (const auto& action : tracked_actions) {
-                        const auto& action_label = GetActionTextLabel(action.label, actions_map);
-                        const auto& action_color = GetActionTextColor(action.label);
-                        const auto& text_label = fd_model_path.empty() ? action_label : "";
-                        sc_visualizer.DrawObject(action.rect, text_label, action_color, white_color, true);
-                        logger.AddPersonToFrame(action.rect, action_label, "");
-                        logger.AddDetectionToFrame(action, work_num_frames);
-                    }
-                    face_obj_id_to_action_maps.push_back(frame_face_obj_id_to_action);
-                } else if (teacher_track_id >= 0) {
-                    auto res_find = std::find_if(tracked_actions.begin(), tracked_actions.end(),
-                                [teacher_track_id](const TrackedObject& o){ return o.object_id == teacher_track_id; });
-                    if (res_find != tracked_actions.end()) {
-                        const auto& track_action = *res_find;
-                        const auto& action_label = GetActionTextLabel(track_action.label, actions_map);
-                        sc_visualizer.DrawObject(track_action.rect, action_label, red_color, white_color, true);
-                        logger.AddPersonToFrame(track_action.rect, action_label, teacher_id);
-                    }
-                }
+                    sc_visualizer.DrawFPS(1e3f / (work_time_ms / static_cast<float>(work_num_frames) + 1e-6f),
+                                          red_color);
 
-                sc_visualizer.DrawFPS(1e3f / (work_time_ms / static_cast<float>(work_num_frames) + 1e-6f),
-                                      red_color);
+                    ++work_num_frames;
 
-                ++work_num_frames;
+                    sc_visualizer.Show();
+                    if (FLAGS_last_frame >= 0 && work_num_frames > static_cast<size_t>(FLAGS_last_frame)) {
+                        is_last_frame = true;
+                        break;
+                    }
+                    logger.FinalizeFrameRecord();
+                    started = std::chrono::high_resolution_clock::now();
+                }
             }
 
             ++total_num_frames;
-
-            sc_visualizer.Show();
-
-            if (FLAGS_last_frame >= 0 && work_num_frames > static_cast<size_t>(FLAGS_last_frame)) {
-                break;
-            }
             prev_frame = frame.clone();
-            logger.FinalizeFrameRecord();
         }
         sc_visualizer.Finalize();
 
@@ -1021,6 +1495,10 @@ int main(int argc, char* argv[]) {
             slog::info << "Mean FPS: " << 1e3f / mean_time_ms << slog::endl;
         }
         slog::info << "Frames processed: " << total_num_frames << slog::endl;
+        if (actions_type != TOP_K && identity_cache.faces() > 0) {
+            slog::info << "Face re-id inferences saved: " << identity_cache.saved_reids()
+                       << " of " << identity_cache.faces() << slog::endl;
+        }
         if (FLAGS_pc) {
             std::map<std::string, std::string>  mapDevices = getMapFullDevicesNames(ie, devices);
             face_detector->wait();
@@ -1033,44 +1511,12 @@ int main(int argc, char* argv[]) {
         }
 
         if (actions_type == STUDENT) {
-            auto face_tracks = tracker_reid.vector_tracks();
-
-            // correct labels for track
-            std::vector<Track> new_face_tracks = UpdateTrackLabelsToBestAndFilterOutUnknowns(face_tracks);
-            std::map<int, int> face_track_id_to_label = GetMapFaceTrackIdToLabel(new_face_tracks);
-
-            std::vector<std::string> face_id_to_label_map = face_recognizer->GetIDToLabelMap();
-
-            if (!face_id_to_label_map.empty()) {
-                std::map<int, FrameEventsTrack> face_obj_id_to_actions_track;
-                ConvertActionMapsToFrameEventTracks(face_obj_id_to_action_maps, default_action_index,
-                                                    &face_obj_id_to_actions_track);
-
-                const int start_frame = 0;
-                const int end_frame = face_obj_id_to_action_maps.size();
-                std::map<int, RangeEventsTrack> face_obj_id_to_events;
-                SmoothTracks(face_obj_id_to_actions_track, start_frame, end_frame,
-                             smooth_window_size, smooth_min_length, default_action_index,
-                             &face_obj_id_to_events);
-
-                slog::info << "Final ID->events mapping" << slog::endl;
-                logger.DumpTracks(face_obj_id_to_events,
-                                  actions_map, face_track_id_to_label,
-                                  face_id_to_label_map);
-
-                std::vector<std::map<int, int>> face_obj_id_to_smoothed_action_maps;
-                ConvertRangeEventsTracksToActionMaps(end_frame, face_obj_id_to_events,
-                                                     &face_obj_id_to_smoothed_action_maps);
-
-                slog::info << "Final per-frame ID->action mapping" << slog::endl;
-                logger.DumpDetections(cap.GetVideoPath(), frame.size(), work_num_frames,
-                                      new_face_tracks,
-                                      face_track_id_to_label,
-                                      actions_map, face_id_to_label_map,
-                                      face_obj_id_to_smoothed_action_maps);
-            }
+            DumpStudentActions(tracker_reid, *face_recognizer, face_obj_id_to_action_maps, actions_map,
+                               smooth_window_size, smooth_min_length, cap->GetVideoPath(), frame.size(),
+                               work_num_frames, &logger);
         }
 
+        slog::stopAsyncLogging();
         std::cout << presenter.reportMeans() << '\n';
     }
     catch (const std::exception& error) {
@@ -9,6 +9,8 @@
 #include <limits>
 #include <numeric>
 #include <opencv2/imgproc/imgproc.hpp>
+#include <samples/mapped_weights.hpp>
+#include <samples/network_cache.hpp>
 
 using namespace InferenceEngine;
 
@@ -48,7 +50,7 @@ void ActionDetection::enqueue(const cv::Mat &frame) {
 ActionDetection::ActionDetection(const ActionDetectorConfig& config)
         : BaseCnnDetection(config.is_async), config_(config) {
     topoName = "action detector";
-    auto network = config.ie.ReadNetwork(config.path_to_model);
+    auto network = readNetworkMapped(config.ie, config.path_to_model);
 
     network.setBatchSize(config.max_batch_size);
 
@@ -71,7 +73,7 @@ ActionDetection::ActionDetection(const ActionDetectorConfig& config)
 
     new_network_ = outputInfo.find(config_.new_loc_blob_name) != outputInfo.end();
     input_name_ = inputInfo.begin()->first;
-    net_ = config_.ie.LoadNetwork(network, config_.deviceName);
+    net_ = loadNetworkCached(config_.ie, network, config_.path_to_model, config_.deviceName, {}, config_.cache_dir);
 
     const auto& head_anchors = new_network_ ? config_.new_anchors : config_.old_anchors;
     const int num_heads = head_anchors.size();
@@ -116,6 +118,30 @@ ActionDetection::ActionDetection(const ActionDetectorConfig& config)
 
     num_candidates_ = head_shift;
 
+    candidate_anchors_.resize(num_candidates_);
+    for (int head_id = 0; head_id < num_heads; ++head_id) {
+        const int head_num_anchors = head_anchors[head_id];
+        for (int p = head_ranges_[head_id]; p < head_ranges_[head_id + 1]; ++p) {
+            const int head_p = p - head_ranges_[head_id];
+            const int anchor_id = head_p % head_num_anchors;
+
+            auto& candidate = candidate_anchors_[p];
+            candidate.glob_anchor_id = glob_anchor_map_[head_id][anchor_id];
+            candidate.conf_shift = new_network_
+                                     ? head_p / head_num_anchors
+                                     : head_p / head_num_anchors * config_.num_action_classes;
+            candidate.conf_step = head_step_sizes_[head_id];
+
+            if (new_network_) {
+                priors_.push_back(GeneratePriorBox(head_p / head_num_anchors,
+                                                   config_.new_det_heads[head_id].step,
+                                                   config_.new_det_heads[head_id].anchors[anchor_id],
+                                                   head_blob_sizes_[head_id]));
+                prior_variances_.push_back(ParseBBoxRecord(config_.variances, false));
+            }
+        }
+    }
+
     binary_task_ = config_.num_action_classes == 2;
 }
 
@@ -127,15 +153,26 @@ std::vector<int> ieSizeToVector(const SizeVector& ie_output_dims) {
     return blob_sizes;
 }
 
+std::unique_ptr<AsyncDetection<DetectedAction>> ActionDetection::clone() const {
+    auto detector = new ActionDetection(*this);
+    detector->request = nullptr;
+    detector->enqueued_frames_ = 0;
+    return std::unique_ptr<AsyncDetection<DetectedAction>>(detector);
+}
+
 DetectedActions ActionDetection::fetchResults() {
     const auto loc_blob_name = new_network_ ? config_.new_loc_blob_name : config_.old_loc_blob_name;
     const auto det_conf_blob_name = new_network_ ? config_.new_det_conf_blob_name : config_.old_det_conf_blob_name;
 
-    const cv::Mat priorbox_out =
-        new_network_
-          ? cv::Mat()
-          : cv::Mat(ieSizeToVector(request->GetBlob(config_.old_priorbox_blob_name)->getTensorDesc().getDims()),
-                    CV_32F, request->GetBlob(config_.old_priorbox_blob_name)->buffer());
+    /** The prior boxes of the old network are constant, read them once **/
+    if (priors_.empty()) {
+        const float* prior_data = request->GetBlob(config_.old_priorbox_blob_name)->buffer().as<float*>();
+        for (int p = 0; p < num_candidates_; ++p) {
+            priors_.push_back(ParseBBoxRecord(prior_data + p * SSD_PRIORBOX_RECORD_SIZE, false));
+            prior_variances_.push_back(
+                ParseBBoxRecord(prior_data + (num_candidates_ + p) * SSD_PRIORBOX_RECORD_SIZE, false));
+        }
+    }
 
     const cv::Mat loc_out(ieSizeToVector(request->GetBlob(loc_blob_name)->getTensorDesc().getDims()),
                           CV_32F, request->GetBlob(loc_blob_name)->buffer());
@@ -151,7 +188,7 @@ DetectedActions ActionDetection::fetchResults() {
     }
 
     /** Parse detections **/
-    return GetDetections(loc_out, main_conf_out, priorbox_out, add_conf_out,
+    return GetDetections(loc_out, main_conf_out, add_conf_out,
                          cv::Size(static_cast<int>(width_), static_cast<int>(height_)));
 }
 
@@ -216,12 +253,10 @@ cv::Rect ActionDetection::ConvertToRect(
 }
 
 DetectedActions ActionDetection::GetDetections(const cv::Mat& loc, const cv::Mat& main_conf,
-        const cv::Mat& priorboxes, const std::vector<cv::Mat>& add_conf,
-        const cv::Size& frame_size) const {
+        const std::vector<cv::Mat>& add_conf, const cv::Size& frame_size) const {
     /** Prepare input data buffers **/
     const float* loc_data = reinterpret_cast<float*>(loc.data);
     const float* det_conf_data = reinterpret_cast<float*>(main_conf.data);
-    const float* prior_data = new_network_ ? NULL : reinterpret_cast<float*>(priorboxes.data);
 
     const int total_num_anchors = add_conf.size();
     std::vector<float*> action_conf_data(total_num_anchors);
@@ -229,39 +264,31 @@ DetectedActions ActionDetection::GetDetections(const cv::Mat& loc, const cv::Mat
         action_conf_data[i] = reinterpret_cast<float*>(add_conf[i].data);
     }
 
+    /** Select the candidates over the detection threshold with the vectorized
+     *  OpenCV routines, the rest of the candidates is never visited **/
+    const cv::Mat det_conf(num_candidates_, 1, CV_32FC(NUM_DETECTION_CLASSES), main_conf.data);
+    cv::Mat positive_conf, passed_mask;
+    cv::extractChannel(det_conf, positive_conf, POSITIVE_DETECTION_IDX);
+    cv::compare(positive_conf, config_.detection_confidence_threshold, passed_mask, cv::CMP_GE);
+    std::vector<cv::Point> passed;
+    cv::findNonZero(passed_mask, passed);
+
     /** Variable to store all detection candidates**/
     DetectedActions valid_detections;
+    valid_detections.reserve(passed.size());
 
-    /** Iterate over all candidate bboxes**/
-    for (int p = 0; p < num_candidates_; ++p) {
+    /** Iterate over the confident candidate bboxes**/
+    for (const auto& point : passed) {
+        const int p = point.y;
         /** Parse detection confidence from the SSD Detection output **/
         const float detection_conf =
                 det_conf_data[p * NUM_DETECTION_CLASSES + POSITIVE_DETECTION_IDX];
 
-        /** Skip low-confidence detections **/
-        if (detection_conf < config_.detection_confidence_threshold) {
-            continue;
-        }
-
-        /** Estimate the action head ID **/
-        int head_id = 0;
-        while (p >= head_ranges_[head_id + 1]) {
-            ++head_id;
-        }
-        const int head_p = p - head_ranges_[head_id];
-
-        /** Estimate the action anchor ID **/
-        const int head_num_anchors =
-            new_network_ ? config_.new_anchors[head_id] : config_.old_anchors[head_id];
-        const int anchor_id = head_p % head_num_anchors;
-
         /** Estimate the action label **/
-        const int glob_anchor_id = glob_anchor_map_[head_id][anchor_id];
-        const float* anchor_conf_data = action_conf_data[glob_anchor_id];
-        const int action_conf_idx_shift = new_network_
-                                            ? head_p / head_num_anchors
-                                            : head_p / head_num_anchors * config_.num_action_classes;
-        const int action_conf_step = head_step_sizes_[head_id];
+        const auto& candidate = candidate_anchors_[p];
+        const float* anchor_conf_data = action_conf_data[candidate.glob_anchor_id];
+        const int action_conf_idx_shift = candidate.conf_shift;
+        const int action_conf_step = candidate.conf_step;
         const float scale = new_network_ ? config_.new_action_scale : config_.old_action_scale;
         int action_label = -1;
         float action_max_exp_value = 0.f;
@@ -289,21 +316,10 @@ DetectedActions ActionDetection::GetDetections(const cv::Mat& loc, const cv::Mat
         }
 
         /** Parse bbox from the SSD Detection output **/
-        const auto priorbox = new_network_
-                                ? GeneratePriorBox(head_p / head_num_anchors,
-                                                   config_.new_det_heads[head_id].step,
-                                                   config_.new_det_heads[head_id].anchors[anchor_id],
-                                                   head_blob_sizes_[head_id])
-                                : ParseBBoxRecord(prior_data + p * SSD_PRIORBOX_RECORD_SIZE, false);
-        const auto variance =
-                ParseBBoxRecord(new_network_
-                                    ? config_.variances
-                                    : prior_data + (num_candidates_ + p) * SSD_PRIORBOX_RECORD_SIZE,
-                                false);
         const auto encoded_bbox =
                 ParseBBoxRecord(loc_data + p * SSD_LOCATION_RECORD_SIZE, new_network_);
 
-        const auto det_rect = ConvertToRect(priorbox, variance, encoded_bbox, frame_size);
+        const auto det_rect = ConvertToRect(priors_[p], prior_variances_[p], encoded_bbox, frame_size);
 
         /** Store detected action **/
         valid_detections.emplace_back(det_rect, action_label, detection_conf, action_conf);
@@ -349,6 +365,14 @@ void ActionDetection::SoftNonMaxSuppression(const DetectedActions& detections,
         valid_scores[i] = scores[valid_score_idx[i]];
     }
 
+    /** Store the bboxes and their areas in the score order **/
+    std::vector<cv::Rect> valid_rects(max_queue_size);
+    std::vector<int> valid_areas(max_queue_size);
+    for (size_t i = 0; i < valid_score_idx.size(); ++i) {
+        valid_rects[i] = detections[valid_score_idx[i]].rect;
+        valid_areas[i] = valid_rects[i].area();
+    }
+
     /** Carry out Soft Non-Maximum Suppression algorithm **/
     out_indices->clear();
     for (size_t step = 0; step < valid_scores.size(); ++step) {
@@ -370,16 +394,15 @@ void ActionDetection::SoftNonMaxSuppression(const DetectedActions& detections,
                 continue;
             }
 
-            /** Calculate the Intersection over Union metric between two bboxes**/
-            const size_t reference_idx = valid_score_idx[local_reference_idx];
-            const auto& rect1 = detections[anchor_idx].rect;
-            const auto& rect2 = detections[reference_idx].rect;
-            const auto intersection = rect1 & rect2;
-            float overlap = 0.f;
-            if (intersection.width > 0 && intersection.height > 0) {
-                const int intersection_area = intersection.area();
-                overlap = static_cast<float>(intersection_area) / static_cast<float>(rect1.area() + rect2.area() - intersection_area);
+            /** Calculate the Intersection over Union metric between two bboxes,
+             *  the scores of the bboxes without overlap stay the same **/
+            const auto intersection = valid_rects[local_anchor_idx] & valid_rects[local_reference_idx];
+            if (intersection.width <= 0 || intersection.height <= 0) {
+                continue;
             }
+            const int intersection_area = intersection.area();
+            const float overlap = static_cast<float>(intersection_area) /
+                static_cast<float>(valid_areas[local_anchor_idx] + valid_areas[local_reference_idx] - intersection_area);
 
             /** Scale bbox score using the exponential rule **/
             valid_scores[local_reference_idx] *= std::exp(-overlap * overlap / sigma);
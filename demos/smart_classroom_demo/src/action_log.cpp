@@ -0,0 +1,139 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "action_log.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+const char kMagic[4] = {'S', 'C', 'A', 'L'};
+const uint32_t kVersion = 1;
+
+template <typename T>
+void WriteColumn(std::ofstream* file, const std::vector<T>& column) {
+    file->write(reinterpret_cast<const char*>(column.data()), sizeof(T) * column.size());
+}
+
+template <typename T>
+void ReadColumn(std::ifstream* file, uint32_t size, std::vector<T>* column) {
+    column->resize(size);
+    file->read(reinterpret_cast<char*>(column->data()), sizeof(T) * size);
+}
+}  // namespace
+
+void ActionLogBlock::reserve(size_t size) {
+    frame_ids.reserve(size);
+    track_ids.reserve(size);
+    labels.reserve(size);
+    confidences.reserve(size);
+    x.reserve(size);
+    y.reserve(size);
+    width.reserve(size);
+    height.reserve(size);
+}
+
+ActionLogWriter::ActionLogWriter(const std::string& path, size_t block_size)
+    : file_(path, std::ios::binary), block_size_(block_size), stopped_(false) {
+    if (!file_.is_open()) {
+        throw std::runtime_error("Can't open the action log file " + path);
+    }
+    file_.write(kMagic, sizeof(kMagic));
+    file_.write(reinterpret_cast<const char*>(&kVersion), sizeof(kVersion));
+    block_.reserve(block_size_);
+    writer_ = std::thread(&ActionLogWriter::Write, this);
+}
+
+ActionLogWriter::~ActionLogWriter() {
+    Submit();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopped_ = true;
+    }
+    submitted_.notify_one();
+    writer_.join();
+}
+
+void ActionLogWriter::Add(int frame_idx, int track_id, int label, float confidence, const cv::Rect& rect) {
+    block_.frame_ids.push_back(frame_idx);
+    block_.track_ids.push_back(track_id);
+    block_.labels.push_back(label);
+    block_.confidences.push_back(confidence);
+    block_.x.push_back(rect.x);
+    block_.y.push_back(rect.y);
+    block_.width.push_back(rect.width);
+    block_.height.push_back(rect.height);
+    if (block_.size() >= block_size_) {
+        Submit();
+    }
+}
+
+void ActionLogWriter::Submit() {
+    if (block_.size() == 0) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        blocks_.push_back(std::move(block_));
+    }
+    submitted_.notify_one();
+    block_ = ActionLogBlock();
+    block_.reserve(block_size_);
+}
+
+void ActionLogWriter::Write() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        submitted_.wait(lock, [this] { return stopped_ || !blocks_.empty(); });
+        if (blocks_.empty()) {
+            return;
+        }
+        ActionLogBlock block = std::move(blocks_.front());
+        blocks_.pop_front();
+        lock.unlock();
+
+        const uint32_t size = static_cast<uint32_t>(block.size());
+        file_.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        WriteColumn(&file_, block.frame_ids);
+        WriteColumn(&file_, block.track_ids);
+        WriteColumn(&file_, block.labels);
+        WriteColumn(&file_, block.confidences);
+        WriteColumn(&file_, block.x);
+        WriteColumn(&file_, block.y);
+        WriteColumn(&file_, block.width);
+        WriteColumn(&file_, block.height);
+
+        lock.lock();
+    }
+}
+
+ActionLogReader::ActionLogReader(const std::string& path) : file_(path, std::ios::binary) {
+    char magic[sizeof(kMagic)];
+    uint32_t version = 0;
+    file_.read(magic, sizeof(magic));
+    file_.read(reinterpret_cast<char*>(&version), sizeof(version));
+    if (!file_ || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 || version != kVersion) {
+        throw std::runtime_error(path + " is not an action log");
+    }
+}
+
+bool ActionLogReader::Read(ActionLogBlock* block) {
+    uint32_t size = 0;
+    if (!file_.read(reinterpret_cast<char*>(&size), sizeof(size))) {
+        return false;
+    }
+    ReadColumn(&file_, size, &block->frame_ids);
+    ReadColumn(&file_, size, &block->track_ids);
+    ReadColumn(&file_, size, &block->labels);
+    ReadColumn(&file_, size, &block->confidences);
+    ReadColumn(&file_, size, &block->x);
+    ReadColumn(&file_, size, &block->y);
+    ReadColumn(&file_, size, &block->width);
+    ReadColumn(&file_, size, &block->height);
+    if (!file_) {
+        throw std::runtime_error("The action log is truncated");
+    }
+    return true;
+}
@@ -48,25 +48,34 @@ cv::Mat GetTransform(cv::Mat* src, cv::Mat* dst) {
     return m;
 }
 
-void AlignFaces(std::vector<cv::Mat>* face_images,
-                std::vector<cv::Mat>* landmarks_vec) {
-    if (landmarks_vec->size() == 0) {
-        return;
-    }
-    CV_Assert(face_images->size() == landmarks_vec->size());
+void AlignFaces(const std::vector<cv::Mat>& face_images,
+                const std::vector<cv::Mat>& landmarks_vec,
+                cv::Size aligned_size,
+                std::vector<cv::Mat>* aligned_faces) {
+    CV_Assert(face_images.size() == landmarks_vec.size());
+    const int faces_number = static_cast<int>(face_images.size());
+    std::vector<cv::Mat> transforms(faces_number);
+    std::vector<cv::Size> sizes(faces_number);
     cv::Mat ref_landmarks = cv::Mat(5, 2, CV_32F);
+    cv::Mat landmarks = cv::Mat(5, 2, CV_32F);
 
-    for (size_t j = 0; j < face_images->size(); j++) {
+    for (int j = 0; j < faces_number; j++) {
+        const cv::Mat& face = face_images[j];
+        sizes[j] = aligned_size == cv::Size() ? face.size() : aligned_size;
         for (int i = 0; i < ref_landmarks.rows; i++) {
-            ref_landmarks.at<float>(i, 0) =
-                    ref_landmarks_normalized[2 * i] * face_images->at(j).cols;
-            ref_landmarks.at<float>(i, 1) =
-                    ref_landmarks_normalized[2 * i + 1] * face_images->at(j).rows;
-            landmarks_vec->at(j).at<float>(i, 0) *= face_images->at(j).cols;
-            landmarks_vec->at(j).at<float>(i, 1) *= face_images->at(j).rows;
+            ref_landmarks.at<float>(i, 0) = ref_landmarks_normalized[2 * i] * sizes[j].width;
+            ref_landmarks.at<float>(i, 1) = ref_landmarks_normalized[2 * i + 1] * sizes[j].height;
+            landmarks.at<float>(i, 0) = landmarks_vec[j].at<float>(i, 0) * face.cols;
+            landmarks.at<float>(i, 1) = landmarks_vec[j].at<float>(i, 1) * face.rows;
         }
-        cv::Mat m = GetTransform(&ref_landmarks, &landmarks_vec->at(j));
-        cv::warpAffine(face_images->at(j), face_images->at(j), m,
-                       face_images->at(j).size(), cv::WARP_INVERSE_MAP);
+        transforms[j] = GetTransform(&ref_landmarks, &landmarks);
     }
+
+    aligned_faces->resize(faces_number);
+    cv::parallel_for_(cv::Range(0, faces_number), [&](const cv::Range& range) {
+        for (int j = range.start; j < range.end; j++) {
+            cv::warpAffine(face_images[j], (*aligned_faces)[j], transforms[j],
+                           sizes[j], cv::WARP_INVERSE_MAP);
+        }
+    });
 }
@@ -12,13 +12,16 @@
 #include <opencv2/imgproc/imgproc.hpp>
 
 #include <inference_engine.hpp>
+#include <samples/mapped_weights.hpp>
+#include <samples/network_cache.hpp>
+#include <samples/roi_batch.hpp>
 
 using namespace InferenceEngine;
 
 CnnDLSDKBase::CnnDLSDKBase(const Config& config) : config_(config) {}
 
 void CnnDLSDKBase::Load() {
-    auto cnnNetwork = config_.ie.ReadNetwork(config_.path_to_model);
+    auto cnnNetwork = readNetworkMapped(config_.ie, config_.path_to_model);
 
 
     const int currentBatchSize = cnnNetwork.getBatchSize();
@@ -32,6 +35,8 @@ void CnnDLSDKBase::Load() {
     in.begin()->second->setPrecision(Precision::U8);
     in.begin()->second->setLayout(Layout::NCHW);
     input_blob_name_ = in.begin()->first;
+    const SizeVector input_dims = in.begin()->second->getTensorDesc().getDims();
+    input_size_ = cv::Size(static_cast<int>(input_dims[3]), static_cast<int>(input_dims[2]));
 
     OutputsDataMap out = cnnNetwork.getOutputsInfo();
     for (auto&& item : out) {
@@ -39,32 +44,51 @@ void CnnDLSDKBase::Load() {
         output_blobs_names_.push_back(item.first);
     }
 
-    executable_network_ = config_.ie.LoadNetwork(cnnNetwork, config_.deviceName);
+    executable_network_ = loadNetworkCached(config_.ie, cnnNetwork, config_.path_to_model, config_.deviceName, {}, config_.cache_dir);
     infer_request_ = executable_network_.CreateInferRequest();
 }
 
 void CnnDLSDKBase::InferBatch(
         const std::vector<cv::Mat>& frames,
         const std::function<void(const InferenceEngine::BlobMap&, size_t)>& fetch_results) const {
-    Blob::Ptr input = infer_request_.GetBlob(input_blob_name_);
-    const size_t batch_size = input->getTensorDesc().getDims()[0];
-
-    size_t num_imgs = frames.size();
-    for (size_t batch_i = 0; batch_i < num_imgs; batch_i += batch_size) {
-        const size_t current_batch_size = std::min(batch_size, num_imgs - batch_i);
-        for (size_t b = 0; b < current_batch_size; b++) {
-            matU8ToBlob<uint8_t>(frames[batch_i + b], input, b);
-        }
-
-        if (config_.max_batch_size != 1)
-            infer_request_.SetBatch(current_batch_size);
-        infer_request_.Infer();
+    const size_t batch_size = infer_request_.GetBlob(input_blob_name_)->getTensorDesc().getDims()[0];
+    const size_t num_imgs = frames.size();
+    const RoiBatchBuilder roi_batch(input_blob_name_, batch_size, config_.max_batch_size != 1);
+    const size_t num_batches = roi_batch.batchesNum(num_imgs);
+    const size_t num_requests = std::min(num_batches, static_cast<size_t>(std::max(1, config_.max_infer_requests)));
+    while (extra_requests_.size() + 1 < num_requests) {
+        extra_requests_.push_back(executable_network_.CreateInferRequestPtr());
+    }
 
+    auto request = [this, num_requests](size_t batch) -> InferRequest& {
+        const size_t request_i = batch % num_requests;
+        return request_i == 0 ? infer_request_ : *extra_requests_[request_i - 1];
+    };
+    auto current_batch_size = [&roi_batch, num_imgs](size_t batch) {
+        return roi_batch.batchSize(num_imgs, batch);
+    };
+    auto fetch = [&](size_t batch) {
+        InferRequest& batch_request = request(batch);
+        batch_request.Wait(IInferRequest::WaitMode::RESULT_READY);
         InferenceEngine::BlobMap blobs;
         for (const auto& name : output_blobs_names_)  {
-            blobs[name] = infer_request_.GetBlob(name);
+            blobs[name] = batch_request.GetBlob(name);
         }
-        fetch_results(blobs, current_batch_size);
+        fetch_results(blobs, current_batch_size(batch));
+    };
+
+    // The batches are inferred by num_requests requests at once, a request
+    // gives its results away before it takes the next batch
+    for (size_t batch = 0; batch < num_batches; batch++) {
+        if (batch >= num_requests) {
+            fetch(batch - num_requests);
+        }
+        InferRequest& batch_request = request(batch);
+        roi_batch.fill(batch_request, frames, batch);
+        batch_request.StartAsync();
+    }
+    for (size_t batch = num_batches - num_requests; batch < num_batches; batch++) {
+        fetch(batch);
     }
 }
 
@@ -100,26 +124,103 @@ void VectorCNN::Compute(const std::vector<cv::Mat>& images, std::vector<cv::Mat>
     }
     vectors->clear();
     auto results_fetcher = [vectors, outp_shape](const InferenceEngine::BlobMap& outputs, size_t batch_size) {
-        for (auto&& item : outputs) {
-            InferenceEngine::Blob::Ptr blob = item.second;
-            if (blob == nullptr) {
-                THROW_IE_EXCEPTION << "VectorCNN::Compute() Invalid blob '" << item.first << "'";
-            }
-            InferenceEngine::SizeVector ie_output_dims = blob->getTensorDesc().getDims();
-            std::vector<int> blob_sizes(ie_output_dims.size(), 0);
-            for (size_t i = 0; i < blob_sizes.size(); ++i) {
-                blob_sizes[i] = ie_output_dims[i];
-            }
-            cv::Mat out_blob(blob_sizes, CV_32F, blob->buffer());
-            for (size_t b = 0; b < batch_size; b++) {
-                cv::Mat blob_wrapper(out_blob.size[1], 1, CV_32F,
-                                     reinterpret_cast<void*>((out_blob.ptr<float>(0) + b * out_blob.size[1])));
-                vectors->emplace_back();
-                if (outp_shape != cv::Size())
-                    blob_wrapper = blob_wrapper.reshape(1, {outp_shape.height, outp_shape.width});
-                blob_wrapper.copyTo(vectors->back());
-            }
-        }
+        FetchVectors(outputs, batch_size, outp_shape, vectors);
     };
     InferBatch(images, results_fetcher);
 }
+
+void VectorCNN::Compute(const cv::Mat& frame, const std::vector<cv::Rect>& rois,
+                        std::vector<cv::Mat>* vectors, cv::Size outp_shape) const {
+    // The regions are views of the frame, matU8ToBlob() resizes them straight
+    // into the input blob
+    std::vector<cv::Mat> images;
+    images.reserve(rois.size());
+    for (const auto& roi : rois) {
+        images.push_back(frame(roi));
+    }
+    Compute(images, vectors, outp_shape);
+}
+
+void VectorCNN::FetchVectors(const InferenceEngine::BlobMap& outputs, size_t batch_size,
+                             cv::Size outp_shape, std::vector<cv::Mat>* vectors) {
+    for (auto&& item : outputs) {
+        InferenceEngine::Blob::Ptr blob = item.second;
+        if (blob == nullptr) {
+            THROW_IE_EXCEPTION << "VectorCNN::Compute() Invalid blob '" << item.first << "'";
+        }
+        InferenceEngine::SizeVector ie_output_dims = blob->getTensorDesc().getDims();
+        std::vector<int> blob_sizes(ie_output_dims.size(), 0);
+        for (size_t i = 0; i < blob_sizes.size(); ++i) {
+            blob_sizes[i] = ie_output_dims[i];
+        }
+        cv::Mat out_blob(blob_sizes, CV_32F, blob->buffer());
+        for (size_t b = 0; b < batch_size; b++) {
+            cv::Mat blob_wrapper(out_blob.size[1], 1, CV_32F,
+                                 reinterpret_cast<void*>((out_blob.ptr<float>(0) + b * out_blob.size[1])));
+            vectors->emplace_back();
+            if (outp_shape != cv::Size())
+                blob_wrapper = blob_wrapper.reshape(1, {outp_shape.height, outp_shape.width});
+            blob_wrapper.copyTo(vectors->back());
+        }
+    }
+}
+
+AsyncVectorCNN::AsyncVectorCNN(const Config& config, cv::Size outp_shape)
+        : VectorCNN(config), outp_shape_(outp_shape) {}
+
+void AsyncVectorCNN::enqueue(const cv::Mat& image) {
+    images_.push_back(image);
+}
+
+void AsyncVectorCNN::submitRequest() {
+    const size_t batch_size = static_cast<size_t>(config_.max_batch_size);
+    const RoiBatchBuilder roi_batch(input_blob_name_, batch_size, batch_size != 1);
+    batch_sizes_.clear();
+    for (size_t batch = 0; batch < roi_batch.batchesNum(images_.size()); batch++) {
+        if (batch == requests_.size()) {
+            requests_.push_back(executable_network_.CreateInferRequestPtr());
+        }
+        InferRequest& request = *requests_[batch];
+        batch_sizes_.push_back(roi_batch.fill(request, images_, batch));
+        request.StartAsync();
+    }
+    images_.clear();
+}
+
+void AsyncVectorCNN::wait() {
+    for (size_t i = 0; i < batch_sizes_.size(); i++) {
+        requests_[i]->Wait(IInferRequest::WaitMode::RESULT_READY);
+    }
+}
+
+std::vector<cv::Mat> AsyncVectorCNN::fetchResults() {
+    std::vector<cv::Mat> vectors;
+    for (size_t i = 0; i < batch_sizes_.size(); i++) {
+        InferenceEngine::BlobMap blobs;
+        for (const auto& name : output_blobs_names_)  {
+            blobs[name] = requests_[i]->GetBlob(name);
+        }
+        FetchVectors(blobs, batch_sizes_[i], outp_shape_, &vectors);
+    }
+    batch_sizes_.clear();
+    return vectors;
+}
+
+std::unique_ptr<AsyncDetection<cv::Mat>> AsyncVectorCNN::clone() const {
+    auto cnn = new AsyncVectorCNN(*this);
+    cnn->infer_request_ = executable_network_.CreateInferRequest();
+    cnn->extra_requests_.clear();
+    cnn->images_.clear();
+    cnn->requests_.clear();
+    cnn->batch_sizes_.clear();
+    return std::unique_ptr<AsyncDetection<cv::Mat>>(cnn);
+}
+
+void AsyncVectorCNN::printPerformanceCounts(const std::string& fullDeviceName) {
+    if (requests_.empty()) {
+        PrintPerformanceCounts(fullDeviceName);
+        return;
+    }
+    std::cout << "Performance counts for " << config_.path_to_model << std::endl << std::endl;
+    ::printPerformanceCounts(*requests_[0], std::cout, fullDeviceName, false);
+}
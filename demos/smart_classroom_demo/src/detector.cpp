@@ -12,6 +12,8 @@
 #include <inference_engine.hpp>
 
 #include <ngraph/ngraph.hpp>
+#include <samples/mapped_weights.hpp>
+#include <samples/network_cache.hpp>
 
 using namespace InferenceEngine;
 
@@ -73,7 +75,7 @@ void FaceDetection::enqueue(const cv::Mat &frame) {
 FaceDetection::FaceDetection(const DetectorConfig& config) :
         BaseCnnDetection(config.is_async), config_(config) {
     topoName = "face detector";
-    auto cnnNetwork = config.ie.ReadNetwork(config.path_to_model);
+    auto cnnNetwork = readNetworkMapped(config.ie, config.path_to_model);
 
     InputsDataMap inputInfo(cnnNetwork.getInputsInfo());
     if (inputInfo.size() != 1) {
@@ -111,7 +113,14 @@ FaceDetection::FaceDetection(const DetectorConfig& config) :
     _output->setLayout(TensorDesc::getLayoutByDims(_output->getDims()));
 
     input_name_ = inputInfo.begin()->first;
-    net_ = config_.ie.LoadNetwork(cnnNetwork, config_.deviceName);
+    net_ = loadNetworkCached(config_.ie, cnnNetwork, config_.path_to_model, config_.deviceName, {}, config_.cache_dir);
+}
+
+std::unique_ptr<AsyncDetection<DetectedObject>> FaceDetection::clone() const {
+    auto detector = new FaceDetection(*this);
+    detector->request = nullptr;
+    detector->enqueued_frames_ = 0;
+    return std::unique_ptr<AsyncDetection<DetectedObject>>(detector);
 }
 
 DetectedObjects FaceDetection::fetchResults() {
@@ -0,0 +1,225 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "gallery_cache.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+# define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <samples/network_cache.hpp>
+#include <samples/slog.hpp>
+
+namespace {
+const char kMagic[4] = {'S', 'C', 'G', 'C'};
+const uint32_t kVersion = 1;
+
+// The file is the header and the entries, an entry is EntryHeader followed by
+// rows * cols floats of the embedding. The values are in the host byte order.
+struct FileHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t key_hash;
+    uint32_t entries_number;
+    int32_t rows;
+    int32_t cols;
+    uint32_t reserved;
+};
+
+struct EntryHeader {
+    uint64_t image_hash;
+    int32_t status;
+    uint32_t reserved;
+};
+}  // namespace
+
+class GalleryCache::MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+#ifdef _WIN32
+        file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL, nullptr);
+        LARGE_INTEGER size;
+        if (file_ == INVALID_HANDLE_VALUE || !GetFileSizeEx(file_, &size) || size.QuadPart == 0) return;
+        mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping_ == nullptr) return;
+        data_ = static_cast<const char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+        if (data_ != nullptr) size_ = static_cast<size_t>(size.QuadPart);
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED) {
+                data_ = static_cast<const char*>(data);
+                size_ = static_cast<size_t>(info.st_size);
+            }
+        }
+        close(fd);
+#endif
+    }
+
+    ~MappedFile() {
+#ifdef _WIN32
+        if (data_ != nullptr) UnmapViewOfFile(data_);
+        if (mapping_ != nullptr) CloseHandle(mapping_);
+        if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+#else
+        if (data_ != nullptr) munmap(const_cast<char*>(data_), size_);
+#endif
+    }
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+#ifdef _WIN32
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = nullptr;
+#endif
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+GalleryCache::GalleryCache(const std::string& path, const std::string& key)
+    : path_(path), key_hash_(network_cache::hash(key)), changed_(false) {
+    Load();
+}
+
+GalleryCache::~GalleryCache() {}
+
+bool GalleryCache::HashImage(const std::string& path, uint64_t* image_hash) {
+    *image_hash = network_cache::hash("", 0);
+    return network_cache::hashFile(path, *image_hash);
+}
+
+void GalleryCache::Load() {
+    file_.reset(new MappedFile(path_));
+    const char* data = file_->data();
+    FileHeader header;
+    if (data == nullptr || file_->size() < sizeof(header)) {
+        return;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion ||
+        header.rows <= 0 || header.cols <= 0) {
+        slog::warn << "Ignoring the gallery cache " << path_ << " of an unknown format" << slog::endl;
+        return;
+    }
+    if (header.key_hash != key_hash_) {
+        slog::info << "The gallery cache " << path_ << " is for other models or parameters, "
+                   << "the gallery is registered again" << slog::endl;
+        return;
+    }
+    const size_t entry_size = sizeof(EntryHeader) + sizeof(float) * header.rows * header.cols;
+    if (file_->size() != sizeof(header) + entry_size * header.entries_number) {
+        slog::warn << "Ignoring the truncated gallery cache " << path_ << slog::endl;
+        return;
+    }
+
+    embedding_size_ = cv::Size(header.cols, header.rows);
+    const char* entry_data = data + sizeof(header);
+    for (uint32_t i = 0; i < header.entries_number; i++, entry_data += entry_size) {
+        EntryHeader entry_header;
+        std::memcpy(&entry_header, entry_data, sizeof(entry_header));
+        cv::Mat embedding(header.rows, header.cols, CV_32F,
+                          const_cast<char*>(entry_data + sizeof(entry_header)));
+        entries_[entry_header.image_hash] = Entry{entry_header.status, embedding, false};
+    }
+}
+
+bool GalleryCache::Find(uint64_t image_hash, int* status, cv::Mat* embedding) {
+    auto entry = entries_.find(image_hash);
+    if (entry == entries_.end()) {
+        return false;
+    }
+    entry->second.used = true;
+    *status = entry->second.status;
+    *embedding = entry->second.embedding.clone();
+    return true;
+}
+
+void GalleryCache::Add(uint64_t image_hash, int status, const cv::Mat& embedding) {
+    if (!embedding.empty()) {
+        CV_Assert(embedding.type() == CV_32F);
+        if (embedding_size_ == cv::Size()) {
+            embedding_size_ = embedding.size();
+        }
+        CV_Assert(embedding.size() == embedding_size_);
+    }
+    entries_[image_hash] = Entry{status, embedding.clone(), true};
+    changed_ = true;
+}
+
+void GalleryCache::Save() {
+    for (const auto& entry : entries_) {
+        changed_ = changed_ || !entry.second.used;
+    }
+    if (!changed_ || embedding_size_ == cv::Size()) {
+        return;
+    }
+
+    FileHeader header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.key_hash = key_hash_;
+    header.entries_number = 0;
+    header.rows = embedding_size_.height;
+    header.cols = embedding_size_.width;
+    header.reserved = 0;
+    for (const auto& entry : entries_) {
+        header.entries_number += entry.second.used ? 1 : 0;
+    }
+
+    // The loaded entries point to the mapped file, so the new one is written
+    // next to it and replaces it after the mapping is closed.
+    const std::string tmp_path = path_ + ".tmp";
+    {
+        std::ofstream out(tmp_path, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        const cv::Mat zeros = cv::Mat::zeros(embedding_size_, CV_32F);
+        for (const auto& entry : entries_) {
+            if (!entry.second.used) continue;
+            EntryHeader entry_header{entry.first, entry.second.status, 0};
+            out.write(reinterpret_cast<const char*>(&entry_header), sizeof(entry_header));
+            const cv::Mat& embedding = entry.second.embedding.empty() ? zeros : entry.second.embedding;
+            const cv::Mat continuous = embedding.isContinuous() ? embedding : embedding.clone();
+            out.write(continuous.ptr<char>(), sizeof(float) * continuous.total());
+        }
+        if (!out) {
+            slog::warn << "Failed to write the gallery cache " << tmp_path << slog::endl;
+            return;
+        }
+    }
+
+    for (auto entry = entries_.begin(); entry != entries_.end();) {
+        if (entry->second.used) {
+            entry->second.embedding = entry->second.embedding.clone();
+            ++entry;
+        } else {
+            entry = entries_.erase(entry);
+        }
+    }
+    file_.reset();
+    std::remove(path_.c_str());
+    if (std::rename(tmp_path.c_str(), path_.c_str()) != 0) {
+        slog::warn << "Failed to replace the gallery cache " << path_ << slog::endl;
+    }
+    changed_ = false;
+}
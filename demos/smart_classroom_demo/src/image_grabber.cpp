@@ -2,35 +2,86 @@
 // SPDX-License-Identifier: Apache-2.0
 //
 
-#include <fstream>
+#include <algorithm>
+#include <exception>
+#include <sstream>
 #include <string>
+#include <utility>
+#include <vector>
+
+#include <samples/slog.hpp>
 
 #include "image_grabber.hpp"
 
-ImageGrabber::ImageGrabber(const std::string& fname) {
-    is_sequence = false;
-    if (fname == "cam") {
-        is_opened = cap.open(0);
-    } else {
-        is_opened = cap.open(fname);
+namespace {
+const size_t kPrefetchedFrames = 4;  // per file
+
+std::vector<std::string> SplitList(const std::string& list) {
+    std::vector<std::string> items;
+    std::istringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
     }
-    current_video_idx = 0;
-    videos.push_back(fname);
-    current_frame_idx = 0;
+    return items;
 }
+}  // namespace
 
-std::string ImageGrabber::GetVideoPath() const {
-    return current_video_idx >= 0 ? videos[current_video_idx] : std::string("");
+ImageGrabber::ImageGrabber(const std::string& fname, size_t parallel_files)
+    : is_opened(false), fps(0), parallel_files(std::max<size_t>(parallel_files, 1)),
+      videos(SplitList(fname)), opened_videos(0), current_video_idx(0) {
+    try {
+        while (prefetchers.size() < this->parallel_files && OpenNext()) {}
+        is_opened = !prefetchers.empty();
+    } catch (const std::exception&) {
+        is_opened = false;
+    }
+}
+
+bool ImageGrabber::OpenNext() {
+    if (opened_videos >= videos.size()) {
+        return false;
+    }
+    auto source = VideoCaptureSource::open(videos[opened_videos]);
+    if (opened_videos == 0) {
+        fps = static_cast<int>(source->capture().get(cv::CAP_PROP_FPS));
+    }
+    prefetchers.emplace_back(new FramePrefetcher(std::move(source), kPrefetchedFrames));
+    opened_videos++;
+    return true;
 }
 
-int ImageGrabber::GetFPS() const {
-    return static_cast<int>(cap.get(cv::CAP_PROP_FPS));
+std::string ImageGrabber::GetVideoPath() const {
+    return current_video_idx < static_cast<int>(videos.size()) ? videos[current_video_idx] : std::string("");
 }
 
+int ImageGrabber::GetFPS() const { return fps; }
+
 bool ImageGrabber::IsOpened() const { return is_opened; }
 
 bool ImageGrabber::GrabNext() {
-    return cap.grab();
+    while (!prefetchers.empty()) {
+        if (prefetchers.front()->read(frame)) {
+            return true;
+        }
+        prefetchers.pop_front();
+        try {
+            OpenNext();
+        } catch (const std::exception& error) {
+            // the videos opened before the failed one are still played, the stream ends after them
+            slog::warn << error.what() << ", the input ends before it" << slog::endl;
+            opened_videos = videos.size();
+        }
+        if (!prefetchers.empty()) {
+            current_video_idx++;
+        }
+    }
+    return false;
 }
 
-bool ImageGrabber::Retrieve(cv::Mat& img) { return cap.retrieve(img); }
+bool ImageGrabber::Retrieve(cv::Mat& img) {
+    img = frame;
+    return !img.empty();
+}
@@ -27,12 +27,16 @@ std::string FrameIdxToString(const std::string& path, int frame_idx) {
 
 DetectionsLogger::DetectionsLogger(std::ostream& stream, bool enabled,
                                    const std::string& act_stat_log_file,
-                                   const std::string& act_det_log_file)
-    : log_stream_(stream) {
+                                   const std::string& act_det_log_file,
+                                   bool act_det_log_binary,
+                                   const std::string& source_id)
+    : log_stream_(stream), source_id_(source_id) {
     write_logs_ = enabled;
     act_stat_log_stream_.open(act_stat_log_file, std::fstream::out);
 
-    if (!act_det_log_file.empty()) {
+    if (!act_det_log_file.empty() && act_det_log_binary) {
+        act_det_log_writer_.reset(new ActionLogWriter(act_det_log_file));
+    } else if (!act_det_log_file.empty()) {
         act_det_log_stream_.open(act_det_log_file, cv::FileStorage::WRITE);
 
         act_det_log_stream_ << "data" << "[";
@@ -41,9 +45,12 @@ DetectionsLogger::DetectionsLogger(std::ostream& stream, bool enabled,
 
 void DetectionsLogger::CreateNextFrameRecord(const std::string& path, const int frame_idx,
                                              const size_t width, const size_t height) {
-    if (write_logs_)
+    if (write_logs_) {
+        if (!source_id_.empty())
+            log_stream_ << "Room: " << source_id_ << " ";
         log_stream_ << "Frame_name: " << path << "@" << frame_idx << " width: "
                     << width << " height: " << height << std::endl;
+    }
 }
 
 void DetectionsLogger::AddFaceToFrame(const cv::Rect& rect, const std::string& id, const std::string& action) {
@@ -67,7 +74,9 @@ void DetectionsLogger::AddPersonToFrame(const cv::Rect& rect, const std::string&
 }
 
 void DetectionsLogger::AddDetectionToFrame(const TrackedObject& object, const int frame_idx) {
-    if (act_det_log_stream_.isOpened()) {
+    if (act_det_log_writer_) {
+        act_det_log_writer_->Add(frame_idx, object.object_id, object.label, object.confidence, object.rect);
+    } else if (act_det_log_stream_.isOpened()) {
         act_det_log_stream_ << "{" << "frame_id" << frame_idx
                             << "det_conf" << object.confidence
                             << "label" << object.label
@@ -145,6 +154,8 @@ void DetectionsLogger::DumpTracks(const std::map<int, RangeEventsTrack>& obj_id_
             const auto& events = tup.second;
 
             std::string face_label = GetUnknownOrLabel(person_id_to_label, track_id_to_label_faces.at(obj_id));
+            if (!source_id_.empty())
+                log_stream_ << "Room: " << source_id_ << " ";
             log_stream_ << "Person: " << face_label << std::endl;
 
             for (const auto& event : events) {
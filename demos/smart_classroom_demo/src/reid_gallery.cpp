@@ -3,25 +3,23 @@
 //
 
 #include "face_reid.hpp"
+#include "gallery_cache.hpp"
 #include "tracker.hpp"
 
 #include <fstream>
 #include <iostream>
+#include <sstream>
 #include <vector>
 #include <string>
 #include <limits>
+#include <cmath>
+#include <memory>
 
 #include <opencv2/opencv.hpp>
 
-namespace {
-    float ComputeReidDistance(const cv::Mat& descr1, const cv::Mat& descr2) {
-        float xy = static_cast<float>(descr1.dot(descr2));
-        float xx = static_cast<float>(descr1.dot(descr1));
-        float yy = static_cast<float>(descr2.dot(descr2));
-        float norm = sqrt(xx * yy) + 1e-6f;
-        return 1.0f - xy / norm;
-    }
+#include <samples/network_cache.hpp>
 
+namespace {
     bool file_exists(const std::string& name) {
         std::ifstream f(name.c_str());
         return f.good();
@@ -35,6 +33,29 @@ namespace {
         #endif
     }
 
+    // everything the embeddings of the gallery images depend on besides the images
+    std::string DescribeRegistration(int min_size_fr, bool crop_gallery,
+                                     const detection::DetectorConfig& detector_config,
+                                     const VectorCNN& landmarks_det, const VectorCNN& image_reid) {
+        std::ostringstream description;
+        for (const std::string& model : {landmarks_det.config().path_to_model, image_reid.config().path_to_model,
+                                         crop_gallery ? detector_config.path_to_model : std::string()}) {
+            uint64_t model_hash = network_cache::hash("", 0);
+            if (!model.empty()) {
+                network_cache::hashFile(model, model_hash);
+                network_cache::hashFile(model.substr(0, model.rfind('.')) + ".bin", model_hash);
+            }
+            description << model_hash << ';';
+        }
+        description << min_size_fr << ';' << crop_gallery;
+        if (crop_gallery) {
+            description << ';' << detector_config.confidence_threshold << ';' << detector_config.increase_scale_x
+                        << ';' << detector_config.increase_scale_y << ';' << detector_config.input_h
+                        << ';' << detector_config.input_w;
+        }
+        return description.str();
+    }
+
     std::string folder_name(const std::string& path) {
         size_t found_pos;
         found_pos = path.find_last_of(separator());
@@ -51,16 +72,21 @@ const int EmbeddingsGallery::unknown_id = TrackedObject::UNKNOWN_LABEL_IDX;
 RegistrationStatus EmbeddingsGallery::RegisterIdentity(const std::string& identity_label,
                                                        const cv::Mat& image,
                                                        int min_size_fr, bool crop_gallery,
-                                                       detection::FaceDetection& detector,
+                                                       std::unique_ptr<detection::FaceDetection>& detector,
+                                                       const detection::DetectorConfig& detector_config,
                                                        const VectorCNN& landmarks_det,
                                                        const VectorCNN& image_reid,
                                                        cv::Mat& embedding) {
     cv::Mat target = image;
     if (crop_gallery) {
-      detector.enqueue(image);
-      detector.submitRequest();
-      detector.wait();
-      detection::DetectedObjects faces = detector.fetchResults();
+      // the detector is loaded only if some image is not in the cache
+      if (!detector) {
+        detector.reset(new detection::FaceDetection(detector_config));
+      }
+      detector->enqueue(image);
+      detector->submitRequest();
+      detector->wait();
+      detection::DetectedObjects faces = detector->fetchResults();
       if (faces.size() == 0) {
         return RegistrationStatus::FAILURE_NOT_DETECTED;
       }
@@ -72,9 +98,8 @@ RegistrationStatus EmbeddingsGallery::RegisterIdentity(const std::string& identi
     }
     cv::Mat landmarks;
     landmarks_det.Compute(target, &landmarks, cv::Size(2, 5));
-    std::vector<cv::Mat> images = {target};
-    std::vector<cv::Mat> landmarks_vec = {landmarks};
-    AlignFaces(&images, &landmarks_vec);
+    std::vector<cv::Mat> images;
+    AlignFaces({target}, {landmarks}, image_reid.input_size(), &images);
     image_reid.Compute(images[0], &embedding);
     return RegistrationStatus::SUCCESS;
 }
@@ -84,14 +109,22 @@ EmbeddingsGallery::EmbeddingsGallery(const std::string& ids_list,
                                      bool crop_gallery, const detection::DetectorConfig &detector_config,
                                      const VectorCNN& landmarks_det,
                                      const VectorCNN& image_reid,
-                                     bool use_greedy_matcher)
+                                     bool use_greedy_matcher,
+                                     int top_k,
+                                     const std::string& cache_path)
     : reid_threshold(threshold),
-      use_greedy_matcher(use_greedy_matcher) {
+      use_greedy_matcher(use_greedy_matcher),
+      top_k(top_k) {
     if (ids_list.empty()) {
         return;
     }
 
-    detection::FaceDetection detector(detector_config);
+    std::unique_ptr<detection::FaceDetection> detector;
+    std::unique_ptr<GalleryCache> cache;
+    if (!cache_path.empty()) {
+        cache.reset(new GalleryCache(cache_path, DescribeRegistration(min_size_fr, crop_gallery, detector_config,
+                                                                      landmarks_det, image_reid)));
+    }
 
     cv::FileStorage fs(ids_list, cv::FileStorage::Mode::READ);
     cv::FileNode fn = fs.root();
@@ -115,43 +148,82 @@ EmbeddingsGallery::EmbeddingsGallery(const std::string& ids_list,
                 path = folder_name(ids_list) + separator() + item[i].string();
             }
 
-            cv::Mat image = cv::imread(path);
-            CV_Assert(!image.empty());
+            uint64_t image_hash = 0;
+            bool hashed = cache && GalleryCache::HashImage(path, &image_hash);
+            int cached_status = 0;
             cv::Mat emb;
-            RegistrationStatus status = RegisterIdentity(label, image, min_size_fr, crop_gallery,  detector, landmarks_det, image_reid, emb);
+            bool cached = hashed && cache->Find(image_hash, &cached_status, &emb);
+            RegistrationStatus status = static_cast<RegistrationStatus>(cached_status);
+            if (!cached) {
+                cv::Mat image = cv::imread(path);
+                CV_Assert(!image.empty());
+                status = RegisterIdentity(label, image, min_size_fr, crop_gallery, detector, detector_config,
+                                          landmarks_det, image_reid, emb);
+                if (hashed) {
+                    cache->Add(image_hash, static_cast<int>(status),
+                               status == RegistrationStatus::SUCCESS ? emb : cv::Mat());
+                }
+            }
             if (status == RegistrationStatus::SUCCESS) {
                 embeddings.push_back(emb);
+                reference_embeddings.add(emb);
                 idx_to_id.push_back(id);
                 identities.emplace_back(embeddings, label, id);
                 ++id;
             }
         }
     }
+
+    if (cache) {
+        cache->Save();
+    }
+
+    if (top_k > 0 && reference_embeddings.size() > top_k) {
+        // sqrt(size) lists of sqrt(size) faces, a tenth of them are searched
+        int lists_number = static_cast<int>(std::sqrt(reference_embeddings.size()));
+        index = std::make_shared<EmbeddingsIndex>(reference_embeddings, lists_number, (lists_number + 9) / 10);
+    }
 }
 
 std::vector<int> EmbeddingsGallery::GetIDsByEmbeddings(const std::vector<cv::Mat>& embeddings) const {
     if (embeddings.empty() || idx_to_id.empty())
         return std::vector<int>(embeddings.size(), unknown_id);
 
-    cv::Mat distances(static_cast<int>(embeddings.size()), static_cast<int>(idx_to_id.size()), CV_32F);
-
-    for (int i = 0; i < distances.rows; i++) {
-        int k = 0;
-        for (size_t j = 0; j < identities.size(); j++) {
-            for (const auto& reference_emb : identities[j].embeddings) {
-                distances.at<float>(i, k) = ComputeReidDistance(embeddings[i], reference_emb);
-                k++;
+    NormalizedEmbeddings queries(embeddings);
+    cv::Mat distances;
+    std::vector<int> col_to_idx;
+    if (index) {
+        // only the union of the nearest gallery faces of the faces are matched
+        std::vector<int> idx_to_col(idx_to_id.size(), -1);
+        cv::Mat candidates;
+        for (const auto& nearest : index->search(queries, top_k)) {
+            for (int idx : nearest) {
+                if (idx_to_col[idx] < 0) {
+                    idx_to_col[idx] = static_cast<int>(col_to_idx.size());
+                    col_to_idx.push_back(idx);
+                    candidates.push_back(reference_embeddings.matrix().row(idx));
+                }
             }
         }
+        if (candidates.empty())
+            return std::vector<int>(embeddings.size(), unknown_id);
+        cv::gemm(queries.matrix(), candidates, 1.0, cv::noArray(), 0.0, distances, cv::GEMM_2_T);
+        distances = 1.0f - distances;
+    } else {
+        // the gallery is normalized once, so all the cosine distances of a frame are a single matrix product
+        distances = 1.0f - NormalizedEmbeddings::similarities(queries, reference_embeddings);
+        for (size_t idx = 0; idx < idx_to_id.size(); idx++)
+            col_to_idx.push_back(static_cast<int>(idx));
     }
     KuhnMunkres matcher(use_greedy_matcher);
     auto matched_idx = matcher.Solve(distances);
     std::vector<int> output_ids;
     for (auto col_idx : matched_idx) {
-        if (distances.at<float>(output_ids.size(), col_idx) > reid_threshold)
+        if (col_idx >= col_to_idx.size() ||
+            distances.at<float>(output_ids.size(), col_idx) > reid_threshold)
             output_ids.push_back(unknown_id);
         else
-            output_ids.push_back(idx_to_id[col_idx]);
+            output_ids.push_back(idx_to_id[col_to_idx[col_idx]]);
     }
     return output_ids;
 }
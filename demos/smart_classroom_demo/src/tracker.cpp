@@ -5,6 +5,11 @@
 #include "tracker.hpp"
 #include <unordered_map>
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <numeric>
 #include <utility>
 #include <limits>
 #include <memory>
@@ -13,11 +18,13 @@
 #include <set>
 #include "logger.hpp"
 
+#include <samples/assignment.hpp>
+
 const int TrackedObject::UNKNOWN_LABEL_IDX = -1;
 
 class KuhnMunkres::Impl {
 public:
-    explicit Impl(bool greedy) : n_(), greedy_(greedy) {}
+    explicit Impl(bool greedy) : greedy_(greedy) {}
 
     std::vector<size_t> Solve(const cv::Mat &dissimilarity_matrix) {
         CV_Assert(dissimilarity_matrix.type() == CV_32F);
@@ -25,173 +32,30 @@ public:
         cv::minMaxLoc(dissimilarity_matrix, &min_val);
         CV_Assert(min_val >= 0);
 
-        n_ = std::max(dissimilarity_matrix.rows, dissimilarity_matrix.cols);
-        dm_ = cv::Mat(n_, n_, CV_32F, cv::Scalar(0));
-        marked_ = cv::Mat(n_, n_, CV_8S, cv::Scalar(0));
-        points_ = std::vector<cv::Point>(n_ * 2);
-
-        dissimilarity_matrix.copyTo(dm_(
-                                        cv::Rect(0, 0, dissimilarity_matrix.cols, dissimilarity_matrix.rows)));
-
-        is_row_visited_ = std::vector<int>(n_, 0);
-        is_col_visited_ = std::vector<int>(n_, 0);
-
-        Run();
-
-        std::vector<size_t> results(dissimilarity_matrix.rows, -1);
-        for (int i = 0; i < dissimilarity_matrix.rows; i++) {
-            const auto ptr = marked_.ptr<char>(i);
-            for (int j = 0; j < dissimilarity_matrix.cols; j++) {
-                if (ptr[j] == kStar) {
-                    results[i] = j;
-                }
-            }
+        if (!greedy_) {
+            return AssignmentSolver().solve(dissimilarity_matrix);
         }
-        return results;
-    }
 
-    void TrySimpleCase() {
-        auto is_row_visited = std::vector<int>(n_, 0);
-        auto is_col_visited = std::vector<int>(n_, 0);
-
-        for (int row = 0; row < n_; row++) {
-            auto ptr = dm_.ptr<float>(row);
-            auto marked_ptr = marked_.ptr<char>(row);
-            auto min_val = *std::min_element(ptr, ptr + n_);
-            for (int col = 0; col < n_; col++) {
-                ptr[col] -= min_val;
-                if (ptr[col] == 0 && !is_col_visited[col] && !is_row_visited[row]) {
-                    marked_ptr[col] = kStar;
+        // Matches every row with the first free column of its minimal value. The
+        // zero padding to a square matrix is the minimum when columns are fewer.
+        std::vector<size_t> results(dissimilarity_matrix.rows, -1);
+        std::vector<int> is_col_visited(dissimilarity_matrix.cols, 0);
+        for (int row = 0; row < dissimilarity_matrix.rows; row++) {
+            const auto ptr = dissimilarity_matrix.ptr<float>(row);
+            const auto min_val = dissimilarity_matrix.cols < dissimilarity_matrix.rows
+                                 ? 0.0f : *std::min_element(ptr, ptr + dissimilarity_matrix.cols);
+            for (int col = 0; col < dissimilarity_matrix.cols; col++) {
+                if (ptr[col] == min_val && !is_col_visited[col]) {
+                    results[row] = col;
                     is_col_visited[col] = 1;
-                    is_row_visited[row] = 1;
-                }
-            }
-        }
-    }
-
-    bool CheckIfOptimumIsFound() {
-        int count = 0;
-        for (int i = 0; i < n_; i++) {
-            const auto marked_ptr = marked_.ptr<char>(i);
-            for (int j = 0; j < n_; j++) {
-                if (marked_ptr[j] == kStar) {
-                    is_col_visited_[j] = 1;
-                    count++;
-                }
-            }
-        }
-
-        return count >= n_;
-    }
-
-    cv::Point FindUncoveredMinValPos() {
-        auto min_val = std::numeric_limits<float>::max();
-        cv::Point min_val_pos(-1, -1);
-        for (int i = 0; i < n_; i++) {
-            if (!is_row_visited_[i]) {
-                auto dm_ptr = dm_.ptr<float>(i);
-                for (int j = 0; j < n_; j++) {
-                    if (!is_col_visited_[j] && dm_ptr[j] < min_val) {
-                        min_val = dm_ptr[j];
-                        min_val_pos = cv::Point(j, i);
-                    }
-                }
-            }
-        }
-        return min_val_pos;
-    }
-
-    void UpdateDissimilarityMatrix(float val) {
-        for (int i = 0; i < n_; i++) {
-            auto dm_ptr = dm_.ptr<float>(i);
-            for (int j = 0; j < n_; j++) {
-                if (is_row_visited_[i]) dm_ptr[j] += val;
-                if (!is_col_visited_[j]) dm_ptr[j] -= val;
-            }
-        }
-    }
-
-    int FindInRow(int row, int what) {
-        for (int j = 0; j < n_; j++) {
-            if (marked_.at<char>(row, j) == what) {
-                return j;
-            }
-        }
-        return -1;
-    }
-
-    int FindInCol(int col, int what) {
-        for (int i = 0; i < n_; i++) {
-            if (marked_.at<char>(i, col) == what) {
-                return i;
-            }
-        }
-        return -1;
-    }
-
-    void Run() {
-        TrySimpleCase();
-
-        if (greedy_)
-            return;
-
-        while (!CheckIfOptimumIsFound()) {
-            while (true) {
-                auto point = FindUncoveredMinValPos();
-                auto min_val = dm_.at<float>(point.y, point.x);
-                if (min_val > 0) {
-                    UpdateDissimilarityMatrix(min_val);
-                } else {
-                    marked_.at<char>(point.y, point.x) = kPrime;
-                    int col = FindInRow(point.y, kStar);
-                    if (col >= 0) {
-                        is_row_visited_[point.y] = 1;
-                        is_col_visited_[col] = 0;
-                    } else {
-                        int count = 0;
-                        points_[count] = point;
-
-                        while (true) {
-                            int row = FindInCol(points_[count].x, kStar);
-                            if (row >= 0) {
-                                count++;
-                                points_[count] = cv::Point(points_[count - 1].x, row);
-                                int col = FindInRow(points_[count].y, kPrime);
-                                count++;
-                                points_[count] = cv::Point(col, points_[count - 1].y);
-                            } else {
-                                break;
-                            }
-                        }
-
-                        for (int i = 0; i < count + 1; i++) {
-                            auto &mark = marked_.at<char>(points_[i].y, points_[i].x);
-                            mark = mark == kStar ? 0 : kStar;
-                        }
-
-                        is_row_visited_ = std::vector<int>(n_, 0);
-                        is_col_visited_ = std::vector<int>(n_, 0);
-
-                        marked_.setTo(0, marked_ == kPrime);
-                        break;
-                    }
+                    break;
                 }
             }
         }
+        return results;
     }
 
 private:
-    static constexpr int kStar = 1;
-    static constexpr int kPrime = 2;
-
-    cv::Mat dm_;
-    cv::Mat marked_;
-    std::vector<cv::Point> points_;
-
-    std::vector<int> is_row_visited_;
-    std::vector<int> is_col_visited_;
-
-    int n_;
     bool greedy_;
 };
 
@@ -224,6 +88,16 @@ TrackerParams::TrackerParams()
       averaging_window_size_for_rects(1),
       averaging_window_size_for_labels(1) {}
 
+namespace {
+// Milliseconds since *start, which is moved to now to time the next stage.
+double ElapsedMs(std::chrono::steady_clock::time_point *start) {
+    auto now = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::milli> elapsed = now - *start;
+    *start = now;
+    return elapsed.count();
+}
+}  // namespace
+
 bool IsInRange(float x, const cv::Vec2f &v) { return v[0] <= x && x <= v[1]; }
 bool IsInRange(float x, float a, float b) { return a <= x && x <= b; }
 
@@ -253,10 +127,13 @@ void Tracker::SolveAssignmentProblem(
     CV_Assert(matches);
     matches->clear();
 
+    auto stage_start = std::chrono::steady_clock::now();
     cv::Mat dissimilarity;
     ComputeDissimilarityMatrix(track_ids, detections, &dissimilarity);
+    timings_.affinity += ElapsedMs(&stage_start);
 
     auto res = KuhnMunkres().Solve(dissimilarity);
+    timings_.assignment += ElapsedMs(&stage_start);
 
     for (size_t i = 0; i < detections.size(); i++) {
         unmatched_detections->insert(i);
@@ -310,6 +187,9 @@ void Tracker::UpdateLostTracks(const std::set<size_t> &track_ids) {
 
 void Tracker::Process(const cv::Mat &frame, const TrackedObjects &detections,
                       int frame_idx) {
+    timings_ = TrackerTimings();
+    auto process_start = std::chrono::steady_clock::now();
+
     if (frame_size_ == cv::Size()) {
         frame_size_ = frame.size();
     } else {
@@ -354,6 +234,7 @@ void Tracker::Process(const cv::Mat &frame, const TrackedObjects &detections,
     }
 
     if (params_.drop_forgotten_tracks) DropForgottenTracks();
+    timings_.total = ElapsedMs(&process_start);
 }
 
 void Tracker::DropForgottenTracks() {
@@ -396,19 +277,94 @@ float Tracker::MotionAffinity(const cv::Rect &trk, const cv::Rect &det) {
     return exp(-params_.motion_affinity_w * (x_dist + y_dist));
 }
 
+// Only the pairs which may be matched are scored. A match needs the affinity above
+// affinity_thr, the shape affinity is at most 1, so the motion affinity alone must
+// exceed it: the top left corner of the track box is less than gate detection sizes
+// away from the corner of the detection along both axes. The track corners are put
+// into a uniform grid of cells of about the gate size, every detection visits the
+// cells of its gate and the other pairs get the dissimilarity 1, as if not similar
+// at all. The rows of the scored pairs are computed in parallel.
 void Tracker::ComputeDissimilarityMatrix(const std::set<size_t> &active_tracks,
                                          const TrackedObjects &detections,
                                          cv::Mat *dissimilarity_matrix) {
     dissimilarity_matrix->create(active_tracks.size(), detections.size(), CV_32F);
-    size_t i = 0;
+    std::vector<const TrackedObject *> last_dets;
+    last_dets.reserve(active_tracks.size());
     for (auto id : active_tracks) {
-        auto ptr = dissimilarity_matrix->ptr<float>(i);
-        for (size_t j = 0; j < detections.size(); j++) {
-            auto last_det = tracks_.at(id).objects.back();
-            ptr[j] = Distance(last_det, detections[j]);
+        last_dets.push_back(&tracks_.at(id).objects.back());
+    }
+    const int rows = static_cast<int>(last_dets.size());
+    const int cols = static_cast<int>(detections.size());
+
+    std::vector<std::vector<int>> candidates(rows);
+    const float gate = params_.affinity_thr > 0 && params_.motion_affinity_w > 0
+            ? std::sqrt(std::max(0.0f, -std::log(params_.affinity_thr)) / params_.motion_affinity_w)
+            : std::numeric_limits<float>::infinity();
+    if (std::isfinite(gate)) {
+        float mean_width = 0, mean_height = 0;
+        for (const auto &det : detections) {
+            mean_width += det.rect.width;
+            mean_height += det.rect.height;
+        }
+        const float cell_width = std::max(1.0f, gate * mean_width / cols);
+        const float cell_height = std::max(1.0f, gate * mean_height / cols);
+        auto cell_key = [](int64_t x, int64_t y) {
+            return (static_cast<uint64_t>(x) << 32) ^ static_cast<uint32_t>(y);
+        };
+
+        std::unordered_map<uint64_t, std::vector<int>> grid;
+        for (int i = 0; i < rows; i++) {
+            const cv::Rect &rect = last_dets[i]->rect;
+            grid[cell_key(static_cast<int64_t>(std::floor(rect.x / cell_width)),
+                          static_cast<int64_t>(std::floor(rect.y / cell_height)))].push_back(i);
+        }
+        for (int j = 0; j < cols; j++) {
+            const cv::Rect &det = detections[j].rect;
+            const float max_dx = gate * det.width, max_dy = gate * det.height;
+            const auto x0 = static_cast<int64_t>(std::floor((det.x - max_dx) / cell_width));
+            const auto x1 = static_cast<int64_t>(std::floor((det.x + max_dx) / cell_width));
+            const auto y0 = static_cast<int64_t>(std::floor((det.y - max_dy) / cell_height));
+            const auto y1 = static_cast<int64_t>(std::floor((det.y + max_dy) / cell_height));
+            auto visit = [&](int i) {
+                const cv::Rect &trk = last_dets[i]->rect;
+                if (std::abs(trk.x - det.x) <= max_dx && std::abs(trk.y - det.y) <= max_dy) {
+                    candidates[i].push_back(j);
+                }
+            };
+            if ((x1 - x0 + 1) * (y1 - y0 + 1) > static_cast<int64_t>(grid.size())) {
+                // a detection much larger than the others, its gate covers more cells than are filled
+                for (int i = 0; i < rows; i++) {
+                    visit(i);
+                }
+                continue;
+            }
+            for (auto x = x0; x <= x1; x++) {
+                for (auto y = y0; y <= y1; y++) {
+                    auto cell = grid.find(cell_key(x, y));
+                    if (cell != grid.end()) {
+                        for (int i : cell->second) {
+                            visit(i);
+                        }
+                    }
+                }
+            }
+        }
+    } else {
+        for (auto &row : candidates) {
+            row.resize(cols);
+            std::iota(row.begin(), row.end(), 0);
         }
-        i++;
     }
+
+    dissimilarity_matrix->setTo(1.0f);
+    cv::parallel_for_(cv::Range(0, rows), [&](const cv::Range &range) {
+        for (int i = range.start; i < range.end; i++) {
+            auto ptr = dissimilarity_matrix->ptr<float>(i);
+            for (int j : candidates[i]) {
+                ptr[j] = Distance(*last_dets[i], detections[j]);
+            }
+        }
+    });
 }
 
 void Tracker::AddNewTracks(const TrackedObjects &detections) {
@@ -0,0 +1,46 @@
+// Copyright (C) 2018-2019 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+//
+
+// Converts a binary action log written with -al_binary to CSV.
+// Usage: smart_classroom_log_to_csv <log> [<csv>], the CSV goes to the
+// standard output if its path is not given.
+
+#include <exception>
+#include <fstream>
+#include <iostream>
+
+#include "action_log.hpp"
+
+int main(int argc, char* argv[]) {
+    if (argc < 2 || argc > 3) {
+        std::cerr << "Usage: " << argv[0] << " <log> [<csv>]" << std::endl;
+        return 1;
+    }
+    try {
+        ActionLogReader reader(argv[1]);
+        std::ofstream file;
+        if (argc == 3) {
+            file.open(argv[2]);
+            if (!file.is_open()) {
+                std::cerr << "Can't open " << argv[2] << std::endl;
+                return 1;
+            }
+        }
+        std::ostream& out = argc == 3 ? file : std::cout;
+
+        out << "frame_id,track_id,label,det_conf,x,y,width,height\n";
+        ActionLogBlock block;
+        while (reader.Read(&block)) {
+            for (size_t i = 0; i < block.size(); i++) {
+                out << block.frame_ids[i] << ',' << block.track_ids[i] << ',' << block.labels[i] << ','
+                    << block.confidences[i] << ',' << block.x[i] << ',' << block.y[i] << ','
+                    << block.width[i] << ',' << block.height[i] << '\n';
+            }
+        }
+    } catch (const std::exception& error) {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
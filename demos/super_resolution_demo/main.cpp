@@ -8,15 +8,28 @@
  * @example super_resolution_demo/main.cpp
  */
 #include <algorithm>
+#include <chrono>
+#include <deque>
+#include <iomanip>
 #include <vector>
+#include <sstream>
 #include <string>
 #include <memory>
 
+#include <opencv2/videoio.hpp>
+
 #include <inference_engine.hpp>
 
+#include <monitors/presenter.h>
 #include <samples/slog.hpp>
 #include <samples/args_helper.hpp>
 #include <samples/ocv_common.hpp>
+#include <samples/mapped_weights.hpp>
+#include <samples/network_cache.hpp>
+#include <samples/infer_request_pool.hpp>
+#include <samples/image_writer.hpp>
+#include <samples/frame_prefetcher.hpp>
+#include <samples/image_set_loader.hpp>
 
 #include "super_resolution_demo.h"
 
@@ -41,9 +54,355 @@ bool ParseAndCheckCommandLine(int argc, char *argv[]) {
         throw std::logic_error("Parameter -m is not set");
     }
 
+    if (FLAGS_tile_overlap < 0) {
+        throw std::logic_error("Parameter -tile_overlap must not be negative");
+    }
+
+    if (FLAGS_diff_threshold < 0 || FLAGS_diff_threshold > 255) {
+        throw std::logic_error("Parameter -diff_threshold must be in [0, 255]");
+    }
+
     return true;
 }
 
+/**
+* @brief Returns the origins of the tiles covering length, the neighbour tiles overlap by at least overlap and
+* the last tile ends at the length
+*/
+std::vector<int> tileOrigins(int length, int tile, int overlap) {
+    std::vector<int> origins;
+    const int step = std::max(tile - overlap, 1);
+    for (int origin = 0; origin + tile < length; origin += step) {
+        origins.push_back(origin);
+    }
+    origins.push_back(std::max(length - tile, 0));
+    return origins;
+}
+
+/**
+* @brief Returns the weights of the pixels of an upscaled tile, they ramp up linearly over the ramp pixels
+* at each side of the tile, so the overlapping tiles cross-fade without visible seams
+*/
+cv::Mat tileWeights(cv::Size size, int ramp) {
+    auto axisWeights = [ramp](int length) {
+        cv::Mat weights(1, length, CV_32F);
+        for (int i = 0; i < length; i++) {
+            weights.at<float>(i) = ramp > 0 ? std::min({1.0f, (i + 0.5f) / ramp, (length - i - 0.5f) / ramp}) : 1.0f;
+        }
+        return weights;
+    };
+    return axisWeights(size.height).t() * axisWeights(size.width);
+}
+
+/**
+* @brief Accumulates the weighted upscaled tiles in a band of rows one tile high, which slides down the
+* output image. The rows above the band are complete and are written to the output, so the memory of the blending
+* doesn't depend on the height of the image
+*/
+class SeamBlender {
+public:
+    SeamBlender(const cv::Mat& output, cv::Size tileSize, int ramp, bool binarize)
+        : output(output), weights(tileWeights(tileSize, ramp)), binarize(binarize), bandTop(0) {
+        for (int c = 0; c < output.channels(); c++) {
+            band.push_back(cv::Mat::zeros(tileSize.height, output.cols, CV_32F));
+        }
+        weightSum = cv::Mat::zeros(tileSize.height, output.cols, CV_32F);
+    }
+
+    /**
+    * @brief Adds the planes of an upscaled tile at the origin in the output, the origin must not be above
+    * the origin of the previous tile
+    */
+    void add(const float* planes, cv::Point origin) {
+        if (origin.y > bandTop) {
+            flush(origin.y);
+        }
+        const cv::Rect roi(origin.x, origin.y - bandTop, weights.cols, weights.rows);
+        for (size_t c = 0; c < band.size(); c++) {
+            const cv::Mat plane(weights.size(), CV_32F, const_cast<float*>(planes + c * weights.total()));
+            cv::Mat bandRoi = band[c](roi);
+            cv::accumulateProduct(plane, weights, bandRoi);
+        }
+        cv::Mat weightSumRoi = weightSum(roi);
+        cv::accumulate(weights, weightSumRoi);
+    }
+
+    /**
+    * @brief Writes the rows of the output above y, all the tiles covering them must have been added
+    */
+    void flush(int y) {
+        const int rows = std::min(y, output.rows) - bandTop;
+        if (rows <= 0) {
+            return;
+        }
+        // the stripes of the rows are normalized and merged in parallel
+        cv::parallel_for_(cv::Range(0, rows), [&](const cv::Range& range) {
+            std::vector<cv::Mat> planes(band.size());
+            cv::Mat normalized;
+            const cv::Mat weightRows = weightSum.rowRange(range);
+            for (size_t c = 0; c < band.size(); c++) {
+                cv::divide(band[c].rowRange(range), weightRows, normalized);
+                if (binarize) {
+                    // Post-processing for text-image-super-resolution models
+                    cv::threshold(normalized, normalized, 0.5f, 1.0f, cv::THRESH_BINARY);
+                }
+                normalized.convertTo(planes[c], CV_8U, 255);
+            }
+            cv::Mat outputRows = output.rowRange(bandTop + range.start, bandTop + range.end);
+            cv::merge(planes, outputRows);
+        });
+
+        // the rows below the written ones move to the top of the band
+        for (cv::Mat& plane : band) {
+            shift(plane, rows);
+        }
+        shift(weightSum, rows);
+        bandTop += rows;
+    }
+
+private:
+    static void shift(cv::Mat& band, int rows) {
+        if (rows < band.rows) {
+            band.rowRange(rows, band.rows).clone().copyTo(band.rowRange(0, band.rows - rows));
+        }
+        band.rowRange(std::max(band.rows - rows, 0), band.rows).setTo(0);
+    }
+
+    cv::Mat output;  // shares the data of the output image
+    const cv::Mat weights;
+    const bool binarize;
+    int bandTop;
+    std::vector<cv::Mat> band;
+    cv::Mat weightSum;
+};
+
+/**
+* @brief Upscales the images by the overlapping tiles inferred by a pool of requests. The tiles of an image are
+* started as soon as the requests of the previous image's tiles are, so the requests stay busy across the images
+* and the frames of a video are pipelined. The upscaled images are returned in the order they are submitted.
+* The incremental upscaler infers only the tiles of an image which differ from their last inferred inputs and
+* blends the upscaled planes kept from that inference for the rest, it's meant for the frames of a video
+*/
+class TiledUpscaler {
+public:
+    struct Upscaled {
+        std::size_t id;
+        cv::Mat image;
+        std::chrono::high_resolution_clock::time_point submitTime;
+        std::size_t tilesNum;
+        std::size_t inferredTilesNum;
+    };
+
+    /**
+    * @param diffThreshold with incremental, a tile changed if its values differ from the last inferred ones by more
+    */
+    TiledUpscaler(ExecutableNetwork& network, std::size_t nireq, const std::string& lrInputName,
+                  const std::string& bicInputName, const std::string& outputName, int overlap,
+                  bool incremental = false, int diffThreshold = 0)
+        : inferRequests(network, nireq), lrInputName(lrInputName), bicInputName(bicInputName),
+          outputName(outputName), overlap(overlap), incremental(incremental), diffThreshold(diffThreshold) {
+        const SizeVector lrInputDims = network.GetInputsInfo().at(lrInputName)->getTensorDesc().getDims();
+        tileSize = cv::Size(static_cast<int>(lrInputDims[3]), static_cast<int>(lrInputDims[2]));
+        const SizeVector outputDims = network.GetOutputsInfo().at(outputName)->getTensorDesc().getDims();
+        outChannels = static_cast<int>(outputDims[1]);
+        outTileSize = cv::Size(static_cast<int>(outputDims[3]), static_cast<int>(outputDims[2]));
+        scale = outTileSize.width / tileSize.width;
+    }
+
+    std::size_t depth() const {
+        return inferRequests.depth();
+    }
+
+    /**
+    * @brief Returns true if a submitted image would be started at once: the tiles of the submitted images are
+    * started and a request is idle
+    */
+    bool canSubmit() const {
+        return inferRequests.hasIdle() && (jobs.empty() || jobs.back().nextTile == jobs.back().inferredTiles.size());
+    }
+
+    bool empty() const {
+        return jobs.empty();
+    }
+
+    /**
+    * @brief Starts the tiles of the image which the idle requests allow
+    */
+    void submit(std::size_t id, cv::Mat img) {
+        jobs.emplace_back();
+        Job& job = jobs.back();
+        job.id = id;
+        job.submitTime = std::chrono::high_resolution_clock::now();
+        job.size = img.size();
+        /** The images smaller than a tile are padded up to it, the padding is cropped from the result **/
+        if (img.cols < tileSize.width || img.rows < tileSize.height) {
+            cv::copyMakeBorder(img, img, 0, std::max(tileSize.height - img.rows, 0),
+                               0, std::max(tileSize.width - img.cols, 0), cv::BORDER_REPLICATE);
+        }
+        job.img = img;
+        for (int y : tileOrigins(img.rows, tileSize.height, overlap)) {
+            for (int x : tileOrigins(img.cols, tileSize.width, overlap)) {
+                job.tiles.emplace_back(cv::Point(x, y), tileSize);
+            }
+        }
+        if (incremental) {
+            selectChangedTiles(job);
+        } else {
+            for (std::size_t i = 0; i < job.tiles.size(); i++) {
+                job.inferredTiles.push_back(i);
+            }
+        }
+        job.result.create(img.rows * scale, img.cols * scale, CV_8UC(outChannels));
+        job.blender.reset(new SeamBlender(job.result, outTileSize, overlap * scale, outChannels == 1));
+        startTiles();
+    }
+
+    /**
+    * @brief Waits for the oldest submitted image, requires !empty()
+    */
+    Upscaled next() {
+        Job& job = jobs.front();
+        /** The tiles are started in the raster order and completed in it, so the blender streams the rows. The
+        * kept planes of the tiles which aren't inferred are blended in their places in the order **/
+        std::size_t inferred = 0;
+        for (std::size_t i = 0; i < job.tiles.size(); i++) {
+            const cv::Point origin = job.tiles[i].tl() * scale;
+            if (inferred == job.inferredTiles.size() || job.inferredTiles[inferred] != i) {
+                job.blender->add(job.cache->upscaled[i].data(), origin);
+                continue;
+            }
+            startTiles();
+            InferRequestPool<cv::Rect>::Result result = inferRequests.pop();
+            const Blob::Ptr outputBlob = result.request->GetBlob(outputName);
+            const float* planes = outputBlob->cbuffer().as<const float*>();
+            job.blender->add(planes, origin);
+            if (job.cache) {
+                job.cache->upscaled[i].assign(planes, planes + outChannels * outTileSize.area());
+            }
+            inferRequests.release(result);
+            inferred++;
+        }
+        job.blender->flush(job.result.rows);
+        Upscaled upscaled{job.id, job.result(cv::Rect(0, 0, job.size.width * scale, job.size.height * scale)),
+                          job.submitTime, job.tiles.size(), job.inferredTiles.size()};
+        jobs.pop_front();
+        startTiles();
+        return upscaled;
+    }
+
+private:
+    /**
+    * @brief The last inferred inputs of the tiles of an image size and their upscaled planes. A frame of another
+    * size starts a new cache, the jobs in flight keep theirs
+    */
+    struct TileCache {
+        cv::Size size;  // after the padding
+        std::vector<cv::Mat> inputs;  // empty for the tiles never inferred
+        std::vector<std::vector<float>> upscaled;  // filled when the inferred tiles complete
+    };
+
+    struct Job {
+        std::size_t id;
+        std::chrono::high_resolution_clock::time_point submitTime;
+        cv::Size size;  // before the padding
+        cv::Mat img;
+        std::vector<cv::Rect> tiles;
+        std::vector<std::size_t> inferredTiles;  // the indices of the tiles, in the raster order
+        std::size_t nextTile = 0;  // in inferredTiles
+        cv::Mat result;
+        std::unique_ptr<SeamBlender> blender;
+        std::shared_ptr<TileCache> cache;  // with incremental only
+    };
+
+    /**
+    * @brief Fills the inferred tiles of the job with the tiles which differ from their last inferred inputs. The
+    * jobs complete in the order, so the planes of a tile inferred by an earlier job are kept before this job blends
+    * them
+    */
+    void selectChangedTiles(Job& job) {
+        if (!tileCache || tileCache->size != job.img.size()) {
+            tileCache = std::make_shared<TileCache>();
+            tileCache->size = job.img.size();
+            tileCache->inputs.resize(job.tiles.size());
+            tileCache->upscaled.resize(job.tiles.size());
+        }
+        job.cache = tileCache;
+        // a few pixels are allowed to differ, so the noise of the sensor and the compression doesn't wake the tiles
+        const int maxChangedValues = 4;
+        std::vector<uchar> changed(job.tiles.size());
+        cv::parallel_for_(cv::Range(0, static_cast<int>(job.tiles.size())), [&](const cv::Range& range) {
+            cv::Mat diff;
+            for (int i = range.start; i < range.end; i++) {
+                const cv::Mat tile = job.img(job.tiles[i]);
+                cv::Mat& input = tileCache->inputs[i];
+                if (!input.empty()) {
+                    cv::absdiff(tile, input, diff);
+                    if (cv::countNonZero(diff.reshape(1) > diffThreshold) <= maxChangedValues) {
+                        continue;
+                    }
+                }
+                tile.copyTo(input);
+                changed[i] = 1;
+            }
+        });
+        for (std::size_t i = 0; i < job.tiles.size(); i++) {
+            if (changed[i]) {
+                job.inferredTiles.push_back(i);
+            }
+        }
+    }
+
+    void startTiles() {
+        for (Job& job : jobs) {
+            if (!inferRequests.hasIdle()) {
+                return;
+            }
+            if (job.nextTile == job.inferredTiles.size()) {
+                continue;
+            }
+            /** The inputs of all the idle requests are filled in parallel before they are started **/
+            const std::vector<InferRequest::Ptr> idleRequests = inferRequests.idleRequests();
+            const int startedTilesNum = static_cast<int>(std::min(idleRequests.size(),
+                                                                  job.inferredTiles.size() - job.nextTile));
+            cv::parallel_for_(cv::Range(0, startedTilesNum), [&](const cv::Range& range) {
+                cv::Mat resized;
+                for (int k = range.start; k < range.end; k++) {
+                    const cv::Mat tile = job.img(job.tiles[job.inferredTiles[job.nextTile + k]]);
+                    Blob::Ptr lrInputBlob = idleRequests[k]->GetBlob(lrInputName);
+                    matU8ToBlob<float_t>(tile, lrInputBlob);
+                    if (!bicInputName.empty()) {
+                        Blob::Ptr bicInputBlob = idleRequests[k]->GetBlob(bicInputName);
+
+                        int w = bicInputBlob->getTensorDesc().getDims()[3];
+                        int h = bicInputBlob->getTensorDesc().getDims()[2];
+
+                        cv::resize(tile, resized, cv::Size(w, h), 0, 0, cv::INTER_CUBIC);
+
+                        matU8ToBlob<float_t>(resized, bicInputBlob);
+                    }
+                }
+            });
+            for (int k = 0; k < startedTilesNum; k++) {
+                inferRequests.startAsync(job.tiles[job.inferredTiles[job.nextTile++]]);
+            }
+        }
+    }
+
+    InferRequestPool<cv::Rect> inferRequests;  // the payload is the tile of the oldest image with tiles in flight
+    const std::string lrInputName;
+    const std::string bicInputName;  // empty for the topologies with 1 input
+    const std::string outputName;
+    const int overlap;
+    const bool incremental;
+    const int diffThreshold;
+    std::shared_ptr<TileCache> tileCache;  // of the last submitted image size
+    cv::Size tileSize;
+    cv::Size outTileSize;
+    int outChannels;
+    int scale;
+    std::deque<Job> jobs;
+};
+
 int main(int argc, char *argv[]) {
     try {
         slog::info << "InferenceEngine: " << GetInferenceEngineVersion() << slog::endl;
@@ -52,10 +411,13 @@ int main(int argc, char *argv[]) {
             return 0;
         }
 
+        const bool videoMode = FLAGS_video || "cam" == FLAGS_i;
         /** This vector stores paths to the processed images **/
         std::vector<std::string> imageNames;
-        parseInputFilesArguments(imageNames);
-        if (imageNames.empty()) throw std::logic_error("No suitable images were found");
+        if (!videoMode) {
+            parseInputFilesArguments(imageNames);
+            if (imageNames.empty()) throw std::logic_error("No suitable images were found");
+        }
         // -----------------------------------------------------------------------------------------------------
 
         // --------------------------- 1. Load inference engine -------------------------------------
@@ -83,7 +445,7 @@ int main(int argc, char *argv[]) {
         slog::info << "Loading network files" << slog::endl;
 
         /** Read network model **/
-        auto network = ie.ReadNetwork(FLAGS_m);
+        auto network = readNetworkMapped(ie, FLAGS_m);
         // -----------------------------------------------------------------------------------------------------
 
         // --------------------------- 3. Configure input & output ---------------------------------------------
@@ -98,39 +460,17 @@ int main(int argc, char *argv[]) {
             throw std::logic_error("The demo supports topologies with 1 or 2 inputs only");
 
         const std::string lrInputBlobName = "0";
+        const std::string bicInputBlobName = "1";
+        const bool twoInputs = inputInfo.size() == 2;
 
-        /** Collect images**/
-        std::vector<cv::Mat> inputImages;
-        for (const auto &i : imageNames) {
-            /** Get size of low resolution input **/
-            auto lrInputInfoItem = inputInfo[lrInputBlobName];
-            int w = static_cast<int>(lrInputInfoItem->getTensorDesc().getDims()[3]);
-            int h = static_cast<int>(lrInputInfoItem->getTensorDesc().getDims()[2]);
-            int c = static_cast<int>(lrInputInfoItem->getTensorDesc().getDims()[1]);
-
-            cv::Mat img = cv::imread(i, c == 1 ? cv::IMREAD_GRAYSCALE : cv::IMREAD_COLOR);
-            if (img.empty()) {
-                slog::warn << "Image " + i + " cannot be read!" << slog::endl;
-                continue;
-            }
+        /** Get size of low resolution input, the images are upscaled by the tiles of that size **/
+        const SizeVector lrInputDims = inputInfo[lrInputBlobName]->getTensorDesc().getDims();
+        const cv::Size tileSize(static_cast<int>(lrInputDims[3]), static_cast<int>(lrInputDims[2]));
+        const int c = static_cast<int>(lrInputDims[1]);
 
-            if (w != img.cols || h != img.rows) {
-                slog::warn << "Size of the image " << i << " is not equal to WxH = " << w << "x" << h << slog::endl;
-                continue;
-            }
-            if (c != img.channels()) {
-                slog::warn << "Number of channels of the image " << i << " is not equal to " << c <<slog::endl;
-                continue;
-            }
-
-            inputImages.push_back(img);
-        }
-
-        if (inputImages.empty()) throw std::logic_error("Valid input images were not found!");
-
-        /** Setting batch size using image count **/
-        network.setBatchSize(imageNames.size());
-        slog::info << "Batch size is " << std::to_string(network.getBatchSize()) << slog::endl;
+        /** The tiles are inferred one by one, several requests keep the device busy **/
+        network.setBatchSize(1);
+        slog::info << "Tile size is " << tileSize.width << "x" << tileSize.height << slog::endl;
 
         // ------------------------------ Prepare output blobs -------------------------------------------------
         slog::info << "Preparing output blobs" << slog::endl;
@@ -149,90 +489,168 @@ int main(int argc, char *argv[]) {
 
             item.second->setPrecision(Precision::FP32);
         }
+        const SizeVector outputDims = outputInfo[firstOutputName]->getTensorDesc().getDims();
+        const size_t numOfChannels = outputDims[1];
+        const cv::Size outTileSize(static_cast<int>(outputDims[3]), static_cast<int>(outputDims[2]));
+        if (outTileSize.width % tileSize.width != 0 || outTileSize.height % tileSize.height != 0
+                || outTileSize.width / tileSize.width != outTileSize.height / tileSize.height) {
+            throw std::logic_error("The demo supports topologies upscaling by the same integer factor along both axes only");
+        }
+        if (numOfChannels != 1 && numOfChannels != 3) {
+            throw std::logic_error("The demo supports topologies with 1 or 3 output channels only");
+        }
+        if (FLAGS_tile_overlap >= std::min(tileSize.width, tileSize.height)) {
+            throw std::logic_error("Parameter -tile_overlap must be less than the tile size");
+        }
+        slog::info << "Output tile size [C,H,W]: " << numOfChannels << ", " << outTileSize.height << ", "
+                   << outTileSize.width << slog::endl;
         // -----------------------------------------------------------------------------------------------------
 
         // --------------------------- 4. Loading model to the device ------------------------------------------
         slog::info << "Loading model to the device" << slog::endl;
-        ExecutableNetwork executableNetwork = ie.LoadNetwork(network, FLAGS_d);
-        // -----------------------------------------------------------------------------------------------------
-
-        // --------------------------- 5. Create infer request -------------------------------------------------
-        slog::info << "Create infer request" << slog::endl;
-        InferRequest inferRequest = executableNetwork.CreateInferRequest();
+        ExecutableNetwork executableNetwork = loadNetworkCached(ie, network, FLAGS_m, FLAGS_d, {}, FLAGS_cache_dir);
         // -----------------------------------------------------------------------------------------------------
 
-        // --------------------------- 6. Prepare input --------------------------------------------------------
-        Blob::Ptr lrInputBlob = inferRequest.GetBlob(lrInputBlobName);
-        for (size_t i = 0; i < inputImages.size(); ++i) {
-            cv::Mat img = inputImages[i];
-            matU8ToBlob<float_t>(img, lrInputBlob, i);
-
-            bool twoInputs = inputInfo.size() == 2;
-            if (twoInputs) {
-                const std::string bicInputBlobName = "1";
-                Blob::Ptr bicInputBlob = inferRequest.GetBlob(bicInputBlobName);
-
-                int w = bicInputBlob->getTensorDesc().getDims()[3];
-                int h = bicInputBlob->getTensorDesc().getDims()[2];
-
-                cv::Mat resized;
-                cv::resize(img, resized, cv::Size(w, h), 0, 0, cv::INTER_CUBIC);
-
-                matU8ToBlob<float_t>(resized, bicInputBlob, i);
-            }
+        // --------------------------- 5. Create infer requests ------------------------------------------------
+        slog::info << "Create infer requests" << slog::endl;
+        TiledUpscaler upscaler(executableNetwork,
+                               0 == FLAGS_nireq ? defaultInferRequestsNum(executableNetwork, FLAGS_d) : FLAGS_nireq,
+                               lrInputBlobName, twoInputs ? bicInputBlobName : "", firstOutputName, FLAGS_tile_overlap,
+                               videoMode && FLAGS_incremental, FLAGS_diff_threshold);
+        slog::info << "Number of infer requests: " << upscaler.depth() << slog::endl;
+        if (FLAGS_incremental && !videoMode) {
+            slog::warn << "-incremental works in the video mode only, all the tiles of the images are inferred" << slog::endl;
         }
         // -----------------------------------------------------------------------------------------------------
 
-        // --------------------------- 7. Do inference ---------------------------------------------------------
+        // --------------------------- 6. Do inference ---------------------------------------------------------
         std::cout << "To close the application, press 'CTRL+C' here";
         if (FLAGS_show) {
-            std::cout << " or switch to the output window and press any key";
+            std::cout << (videoMode ? " or switch to the output window and press ESC key"
+                                    : " or switch to the output window and press any key");
         }
         std::cout << std::endl;
 
         slog::info << "Start inference" << slog::endl;
-        inferRequest.Infer();
-        // -----------------------------------------------------------------------------------------------------
-
-        // --------------------------- 8. Process output -------------------------------------------------------
-        const Blob::Ptr outputBlob = inferRequest.GetBlob(firstOutputName);
-        const auto outputData = outputBlob->buffer().as<PrecisionTrait<Precision::FP32>::value_type*>();
-
-        size_t numOfImages = outputBlob->getTensorDesc().getDims()[0];
-        size_t numOfChannels = outputBlob->getTensorDesc().getDims()[1];
-        size_t h = outputBlob->getTensorDesc().getDims()[2];
-        size_t w = outputBlob->getTensorDesc().getDims()[3];
-        size_t nunOfPixels = w * h;
-
-        slog::info << "Output size [N,C,H,W]: " << numOfImages << ", " << numOfChannels << ", " << h << ", " << w << slog::endl;
-
-        for (size_t i = 0; i < numOfImages; ++i) {
-            std::vector<cv::Mat> imgPlanes;
-            if (numOfChannels == 3) {
-                imgPlanes = std::vector<cv::Mat>{
-                      cv::Mat(h, w, CV_32FC1, &(outputData[i * nunOfPixels * numOfChannels])),
-                      cv::Mat(h, w, CV_32FC1, &(outputData[i * nunOfPixels * numOfChannels + nunOfPixels])),
-                      cv::Mat(h, w, CV_32FC1, &(outputData[i * nunOfPixels * numOfChannels + nunOfPixels * 2]))};
-            } else {
-                imgPlanes = std::vector<cv::Mat>{cv::Mat(h, w, CV_32FC1, &(outputData[i * nunOfPixels * numOfChannels]))};
-
-                // Post-processing for text-image-super-resolution models
-                cv::threshold(imgPlanes[0], imgPlanes[0], 0.5f, 1.0f, cv::THRESH_BINARY);
+        if (!videoMode) {
+            ImageWriterPool imageWriter;
+            auto writeResult = [&](const TiledUpscaler::Upscaled& upscaled) {
+                if (FLAGS_show) {
+                    cv::imshow("result", upscaled.image);
+                    cv::waitKey();
+                }
+
+                std::string outImgName = std::string("sr_" + std::to_string(upscaled.id + 1) + ".png");
+                imageWriter.write(outImgName, upscaled.image);
             };
-
-            for (auto & img : imgPlanes)
-                img.convertTo(img, CV_8UC1, 255);
-
-            cv::Mat resultImg;
-            cv::merge(imgPlanes, resultImg);
-
-            if (FLAGS_show) {
-                cv::imshow("result", resultImg);
-                cv::waitKey();
+            /** The next images are decoded while the tiles of the previous ones are upscaled **/
+            ImageSetLoader loader(imageNames, 4, c == 1 ? cv::IMREAD_GRAYSCALE : cv::IMREAD_COLOR);
+            ImageSetLoader::Image loaded;
+            while (loader.next(loaded)) {
+                if (c != loaded.image.channels()) {
+                    slog::warn << "Number of channels of the image " << loaded.path << " is not equal to " << c <<slog::endl;
+                    continue;
+                }
+                while (!upscaler.canSubmit()) {
+                    writeResult(upscaler.next());
+                }
+                upscaler.submit(loaded.index, loaded.image);
+            }
+            while (!upscaler.empty()) {
+                writeResult(upscaler.next());
+            }
+            imageWriter.finish();
+            loader.printStats();
+        } else {
+            /** The frames are captured in the background, the next ones are upscaled while a frame is shown **/
+            std::unique_ptr<VideoCaptureSource> source = VideoCaptureSource::open(FLAGS_i);
+            double fps = source->capture().get(cv::CAP_PROP_FPS);
+            FramePrefetcher frames(std::move(source));
+            cv::VideoWriter videoWriter;
+
+            typedef std::chrono::duration<double, std::ratio<1, 1000>> ms;
+            std::unique_ptr<Presenter> presenter;
+            std::chrono::high_resolution_clock::duration latencySum{0};
+            std::size_t submittedNum = 0;
+            std::size_t framesNum = 0;
+            std::size_t tilesNum = 0;
+            std::size_t inferredTilesNum = 0;
+            const auto startTime = std::chrono::high_resolution_clock::now();
+            bool inputEnded = false;
+            bool quit = false;
+            cv::Mat frame;
+            while (!quit) {
+                while (!inputEnded && upscaler.canSubmit()) {
+                    if (!frames.read(frame)) {
+                        inputEnded = true;
+                        break;
+                    }
+                    if (1 == c && 1 != frame.channels()) {
+                        cv::cvtColor(frame, frame, cv::COLOR_BGR2GRAY);
+                    }
+                    upscaler.submit(submittedNum++, frame);
+                    frame = cv::Mat();  // the upscaler keeps the frame
+                }
+                if (upscaler.empty()) {
+                    break;  // end of the input
+                }
+
+                TiledUpscaler::Upscaled upscaled = upscaler.next();
+                const auto now = std::chrono::high_resolution_clock::now();
+                latencySum += now - upscaled.submitTime;
+                framesNum++;
+                tilesNum += upscaled.tilesNum;
+                inferredTilesNum += upscaled.inferredTilesNum;
+
+                if (!FLAGS_o.empty()) {
+                    if (!videoWriter.isOpened() && !videoWriter.open(FLAGS_o, cv::VideoWriter::fourcc('M', 'J', 'P', 'G'),
+                            fps > 0 ? fps : 25, upscaled.image.size(), upscaled.image.channels() == 3)) {
+                        throw std::runtime_error("Can't open the output video " + FLAGS_o);
+                    }
+                    videoWriter.write(upscaled.image);
+                }
+
+                if (FLAGS_show) {
+                    cv::Mat shown = upscaled.image;
+                    if (1 == shown.channels()) {
+                        cv::cvtColor(shown, shown, cv::COLOR_GRAY2BGR);
+                    }
+                    if (!presenter) {
+                        presenter.reset(new Presenter(FLAGS_u, 10, {shown.cols / 4, 60}));
+                    }
+                    presenter->drawGraphs(shown);
+                    std::ostringstream out;
+                    out << "Latency: " << std::fixed << std::setprecision(1)
+                        << std::chrono::duration_cast<ms>(now - upscaled.submitTime).count() << " ms, FPS: "
+                        << framesNum / std::chrono::duration_cast<std::chrono::duration<double>>(now - startTime).count();
+                    if (FLAGS_incremental) {
+                        out << ", inferred tiles: " << upscaled.inferredTilesNum << "/" << upscaled.tilesNum;
+                    }
+                    cv::putText(shown, out.str(), cv::Point2f(0, 25), cv::FONT_HERSHEY_TRIPLEX, 0.6, cv::Scalar(0, 255, 0));
+                    cv::imshow("result", shown);
+                    const int key = cv::waitKey(1);
+                    if (27 == key) {  // Esc
+                        quit = true;
+                    } else {
+                        presenter->handleKey(key);
+                    }
+                }
             }
 
-            std::string outImgName = std::string("sr_" + std::to_string(i + 1) + ".png");
-            cv::imwrite(outImgName, resultImg);
+            if (framesNum > 0) {
+                const double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(
+                    std::chrono::high_resolution_clock::now() - startTime).count();
+                std::cout << "Mean latency: " << std::fixed << std::setprecision(1)
+                          << std::chrono::duration_cast<ms>(latencySum).count() / framesNum << " ms" << std::endl;
+                std::cout << "Throughput: " << framesNum / seconds << " FPS" << std::endl;
+                if (FLAGS_incremental) {
+                    std::cout << "Inferred tiles: " << inferredTilesNum << " of " << tilesNum << " ("
+                              << 100.0 * inferredTilesNum / tilesNum << "%)" << std::endl;
+                }
+            }
+            if (presenter) {
+                std::cout << presenter->reportMeans() << std::endl;
+            }
         }
         // -----------------------------------------------------------------------------------------------------
     }
@@ -10,7 +10,8 @@
 #include <iostream>
 
 static const char help_message[] = "Print a usage message.";
-static const char image_message[] = "Required. Path to an image.";
+static const char image_message[] = "Required. Path to an image or a folder of images. With -video, a path to a video "
+                                    "file or a stream, \"cam\" works with a camera in both modes.";
 static const char model_message[] = "Required. Path to an .xml file with a trained model.";
 static const char plugin_message[] = "Plugin name. For example MKLDNNPlugin. If this parameter is pointed, "
                                      "the demo will look for this plugin only";
@@ -22,6 +23,21 @@ static const char custom_cpu_library_message[] = "Required for CPU custom layers
 static const char custom_cldnn_message[] = "Required for GPU custom kernels."
                                             "Absolute path to the xml file with the kernels descriptions.";
 static const char show_processed_images[] = "Optional. Show processed images. Default value is false.";
+static const char cache_dir_message[] = "Optional. Directory to cache compiled networks in. Later runs import the cached networks "
+                                        "instead of compiling them if the model, device and config didn't change. "
+                                        "Devices without network export support compile on each run.";
+static const char video_message[] = "Optional. Upscale the frames of the video input and show them with -show, "
+                                    "the latency and the throughput are reported.";
+static const char output_video_message[] = "Optional. Path to an output video file of the upscaled frames in the video mode.";
+static const char utilization_monitors_message[] = "Optional. List of monitors to show initially in the video mode.";
+static const char nireq_message[] = "Optional. Number of infer requests of the tiles kept in flight. "
+                                    "0 uses the optimal number for the device: at least 2, 4 for MYRIAD and HDDL if the device does not report it.";
+static const char tile_overlap_message[] = "Optional. Overlap of the neighbour tiles in the pixels of the input image, the upscaled "
+                                           "tiles are blended over the overlap to hide the seams. Default value is 16.";
+static const char incremental_message[] = "Optional. In the video mode, infer only the tiles which changed since they were inferred "
+                                          "last and reuse the previous upscaled tiles for the rest.";
+static const char diff_threshold_message[] = "Optional. Difference of a pixel value which counts as a change of the tile with "
+                                             "-incremental. Default value is 10.";
 
 
 DEFINE_bool(h, false, help_message);
@@ -31,6 +47,14 @@ DEFINE_string(d, "CPU", target_device_message);
 DEFINE_string(l, "", custom_cpu_library_message);
 DEFINE_string(c, "", custom_cldnn_message);
 DEFINE_bool(show, false, show_processed_images);
+DEFINE_string(cache_dir, "", cache_dir_message);
+DEFINE_uint32(nireq, 0, nireq_message);
+DEFINE_bool(video, false, video_message);
+DEFINE_string(o, "", output_video_message);
+DEFINE_string(u, "", utilization_monitors_message);
+DEFINE_int32(tile_overlap, 16, tile_overlap_message);
+DEFINE_bool(incremental, false, incremental_message);
+DEFINE_int32(diff_threshold, 10, diff_threshold_message);
 
 /**
 * @brief This function show a help message
@@ -45,4 +69,12 @@ static void showUsage() {
     std::cout << "    -m \"<path>\"             " << model_message << std::endl;
     std::cout << "    -d \"<device>\"           " << target_device_message << std::endl;
     std::cout << "    -show                   " << show_processed_images << std::endl;
+    std::cout << "    -cache_dir \"<path>\"     " << cache_dir_message << std::endl;
+    std::cout << "    -nireq \"<integer>\"      " << nireq_message << std::endl;
+    std::cout << "    -tile_overlap \"<integer>\" " << tile_overlap_message << std::endl;
+    std::cout << "    -video                  " << video_message << std::endl;
+    std::cout << "    -incremental            " << incremental_message << std::endl;
+    std::cout << "    -diff_threshold \"<integer>\" " << diff_threshold_message << std::endl;
+    std::cout << "    -o \"<path>\"             " << output_video_message << std::endl;
+    std::cout << "    -u                      " << utilization_monitors_message << std::endl;
 }
@@ -19,6 +19,8 @@ from args import *
 from data_sequences import DATA_SEQUENCES
 
 MONITORS = {'-u': 'cdm'}
+# the steady state benchmark of the multi channel demos, the inputs are looped for its duration
+MULTI_CHANNEL_BENCHMARK = {'-loop_video': None, '-bench': '20', '-bench_warmup': '5'}
 TestCase = collections.namedtuple('TestCase', ['options'])
 
 class Demo:
@@ -29,13 +31,18 @@ class Demo:
         return {device: [arg for key in self.device_keys for arg in [key, device]] for device in device_list}
 
 class NativeDemo(Demo):
-    def __init__(self, subdirectory, device_keys, test_cases):
+    def __init__(self, subdirectory, device_keys, test_cases, perf_options=None, perf_report_option=None):
         self.subdirectory = subdirectory
 
         self.device_keys = device_keys
 
         self.test_cases = test_cases
 
+        # added to the options of the cases in the performance mode, along with the option
+        # of the path of the JSON report, if the demo writes one
+        self.perf_options = perf_options or {}
+        self.perf_report_option = perf_report_option
+
         self._name = subdirectory.replace('/', '_')
 
     @property
@@ -155,6 +162,7 @@ NATIVE_DEMOS = [
 
     NativeDemo(subdirectory='multi_channel/face_detection_demo',
             device_keys=['-d'],
+            perf_options=MULTI_CHANNEL_BENCHMARK, perf_report_option='-bench_json',
             test_cases=combine_cases(
         TestCase(options={'-no_show': None,
             **MONITORS,
@@ -168,6 +176,7 @@ NATIVE_DEMOS = [
     )),
 
     NativeDemo(subdirectory='multi_channel/human_pose_estimation_demo', device_keys=['-d'],
+            perf_options=MULTI_CHANNEL_BENCHMARK, perf_report_option='-bench_json',
             test_cases=combine_cases(
         TestCase(options={'-no_show': None,
             **MONITORS,
@@ -0,0 +1,96 @@
+# Copyright (c) 2019 Intel Corporation
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""
+Performance metrics of the demo runs and their comparison with the stored baselines.
+
+A baselines file is a JSON object mapping a device to an object mapping the case keys to the
+metrics of the cases, "fps" and "latency_ms", and optionally a "tolerance" overriding the
+default one for the case.
+"""
+
+import json
+import re
+
+# the demos print the FPS as "<value> fps", "<value> FPS" or "FPS: <value>", the last report is the summary
+FPS_PATTERNS = [
+    re.compile(r'(\d+(?:\.\d+)?)\s*fps\b', re.IGNORECASE),
+    re.compile(r'\bfps\s*:\s*(\d+(?:\.\d+)?)', re.IGNORECASE),
+]
+LATENCY_PATTERN = re.compile(r'latency[^\n\d]*(\d+(?:\.\d+)?)\s*ms', re.IGNORECASE)
+
+def _last_match(patterns, output):
+    matches = [match for pattern in patterns for match in pattern.finditer(output)]
+    if not matches: return None
+    return float(max(matches, key=lambda match: match.start()).group(1))
+
+def _arg_key(value):
+    if value is None: return None
+    if isinstance(value, str): return value
+    if isinstance(value, list): return ','.join(map(_arg_key, value))
+    # the data arguments resolve to the paths of a temporary directory, so they are keyed by their names
+    for attribute in ('name', 'sequence_name', 'rel_path', 'file_name'):
+        if hasattr(value, attribute):
+            key = getattr(value, attribute)
+            if hasattr(value, 'precision'):
+                key += '/' + value.precision
+            return str(key)
+    return str(value)
+
+def case_key(demo_name, test_case):
+    return ' '.join([demo_name] + [key if value is None else '{}={}'.format(key, _arg_key(value))
+        for key, value in sorted(test_case.options.items())])
+
+def parse_metrics(output, json_report=None):
+    """Returns the throughput and the latency in the output or in the JSON benchmark report of a run."""
+    if json_report is not None and json_report.exists():
+        report = json.loads(json_report.read_text())
+        metrics = {'fps': report['throughput_fps']}
+        if 'end_to_end' in report.get('latency_ms', {}):
+            metrics['latency_ms'] = report['latency_ms']['end_to_end']['p50']
+        return metrics
+
+    metrics = {}
+    fps = _last_match(FPS_PATTERNS, output)
+    if fps is not None: metrics['fps'] = fps
+    latency = _last_match([LATENCY_PATTERN], output)
+    if latency is not None: metrics['latency_ms'] = latency
+    return metrics
+
+def best_metrics(runs):
+    """Returns the best metrics of the repeated runs of a case, the others are slowed down by noise."""
+    best = {}
+    for metrics in runs:
+        if 'fps' in metrics: best['fps'] = max(best.get('fps', 0), metrics['fps'])
+        if 'latency_ms' in metrics: best['latency_ms'] = min(best.get('latency_ms', float('inf')), metrics['latency_ms'])
+    return best
+
+def find_regressions(metrics, baseline, tolerance):
+    """Returns the descriptions of the metrics worse than the baseline by more than the tolerance."""
+    tolerance = baseline.get('tolerance', tolerance)
+    regressions = []
+    if 'fps' in metrics and 'fps' in baseline and metrics['fps'] < baseline['fps'] * (1 - tolerance):
+        regressions.append('{:.2f} FPS is lower than the baseline {:.2f} FPS'.format(metrics['fps'], baseline['fps']))
+    if 'latency_ms' in metrics and 'latency_ms' in baseline \
+            and metrics['latency_ms'] > baseline['latency_ms'] * (1 + tolerance):
+        regressions.append('{:.2f} ms latency is higher than the baseline {:.2f} ms'.format(
+            metrics['latency_ms'], baseline['latency_ms']))
+    return regressions
+
+def load_baselines(path):
+    if path is None or not path.exists(): return {}
+    return json.loads(path.read_text())
+
+def save_baselines(path, baselines):
+    path.write_text(json.dumps(baselines, indent=4, sort_keys=True) + '\n')
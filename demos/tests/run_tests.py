@@ -23,6 +23,11 @@ For the tests to work, the test data directory must contain:
 * a "ILSVRC2012_img_val" subdirectory with the ILSVRC2012 dataset;
 * a "Image_Retrieval" subdirectory with image retrieval dataset (images, videos) (see https://github.com/19900531/test)
   and list of images (see https://github.com/opencv/openvino_training_extensions/blob/develop/tensorflow_toolkit/image_retrieval/data/gallery/gallery.txt)
+
+With --perf, only the native demos are tested and the FPS and the latency they report (or the JSON
+reports of the demos which write them) are compared with the per-device baselines of --perf-baselines.
+A case slower than its baseline by more than the tolerance is a failure. --perf-update-baselines
+stores the measured metrics as the new baselines instead, e.g. after an expected change.
 """
 
 import argparse
@@ -40,8 +45,10 @@ import timeit
 
 from pathlib import Path
 
+import perf
+
 from args import ArgContext, ModelArg
-from cases import DEMOS
+from cases import DEMOS, NativeDemo
 from data_sequences import DATA_SEQUENCES
 
 def parse_args():
@@ -61,7 +68,20 @@ def parse_args():
         help='list of devices to test')
     parser.add_argument('--report-file', type=Path,
         help='path to report file')
-    return parser.parse_args()
+    parser.add_argument('--perf', action='store_true',
+        help='measure the performance of the native demos and compare it with the baselines')
+    parser.add_argument('--perf-baselines', type=Path, metavar='FILE',
+        help='JSON file with the per-device performance baselines')
+    parser.add_argument('--perf-tolerance', type=float, default=0.1, metavar='SHARE',
+        help='share of the baseline a metric may be worse by (default: 0.1)')
+    parser.add_argument('--perf-runs', type=int, default=1, metavar='N',
+        help='number of runs of every case, the best one is compared (default: 1)')
+    parser.add_argument('--perf-update-baselines', action='store_true',
+        help='store the measured metrics to the baselines file instead of comparing them')
+    args = parser.parse_args()
+    if args.perf_update_baselines and args.perf_baselines is None:
+        parser.error('--perf-update-baselines requires --perf-baselines')
+    return args
 
 def collect_result(demo_name, device, pipeline, execution_time, report_file):
     first_time = not report_file.exists()
@@ -72,6 +92,23 @@ def collect_result(demo_name, device, pipeline, execution_time, report_file):
             testwriter.writerow(["DemoName", "Device", "ModelsInPipeline", "ExecutionTime"])
         testwriter.writerow([demo_name, device, " ".join(pipeline), execution_time])
 
+def check_performance(args, baselines, device, key, metrics):
+    print('Performance:', ', '.join('{} {:.2f}'.format(name, value) for name, value in sorted(metrics.items()))
+        or 'no metrics reported')
+    if args.perf_update_baselines:
+        if metrics:
+            # keeps the tolerance of the case
+            baselines.setdefault(device, {}).setdefault(key, {}).update(metrics)
+        return 0
+    baseline = baselines.get(device, {}).get(key)
+    if baseline is None:
+        print('No performance baseline for the case')
+        return 0
+    regressions = perf.find_regressions(metrics, baseline, args.perf_tolerance)
+    for regression in regressions:
+        print('Performance regression:', regression)
+    return 1 if regressions else 0
+
 def main():
     args = parse_args()
 
@@ -90,11 +127,14 @@ def main():
         demos_to_test = {demo.full_name for demo in DEMOS}
 
     num_failures = 0
+    num_regressions = 0
+    baselines = perf.load_baselines(args.perf_baselines) if args.perf else {}
 
     os.putenv('PYTHONPATH',  "{}:{}/lib".format(os.environ['PYTHONPATH'], args.demo_build_dir))
 
     for demo in DEMOS:
         if demo.full_name not in demos_to_test: continue
+        if args.perf and not isinstance(demo, NativeDemo): continue
 
         print('Testing {}...'.format(demo.full_name))
         print()
@@ -153,6 +193,16 @@ def main():
 
             fixed_args = demo.fixed_args(demos_dir, args.demo_build_dir)
 
+            perf_args = []
+            perf_report = None
+            if args.perf:
+                perf_args = [demo_arg
+                    for key, value in sorted(demo.perf_options.items())
+                    for demo_arg in option_to_args(key, value)]
+                if demo.perf_report_option is not None:
+                    perf_report = Path(temp_dir) / 'perf_report.json'
+                    perf_args += [demo.perf_report_option, str(perf_report)]
+
             print('Fixed arguments:', ' '.join(map(shlex.quote, fixed_args)))
             print()
             device_args = demo.device_args(args.devices.split())
@@ -168,16 +218,26 @@ def main():
                     print('Test case #{}/{}:'.format(test_case_index, device),
                         ' '.join(shlex.quote(str(arg)) for arg in dev_arg + case_args))
                     print(flush=True)
+                    runs_metrics = []
                     try:
-                        start_time = timeit.default_timer()
-                        subprocess.check_output(fixed_args + dev_arg + case_args,
-                            stderr=subprocess.STDOUT, universal_newlines=True)
-                        execution_time = timeit.default_timer() - start_time
+                        for run in range(args.perf_runs if args.perf else 1):
+                            if perf_report is not None and perf_report.exists():
+                                perf_report.unlink()
+                            start_time = timeit.default_timer()
+                            output = subprocess.check_output(fixed_args + dev_arg + case_args + perf_args,
+                                stderr=subprocess.STDOUT, universal_newlines=True)
+                            execution_time = timeit.default_timer() - start_time
+                            if args.perf:
+                                runs_metrics.append(perf.parse_metrics(output, perf_report))
                     except subprocess.CalledProcessError as e:
                         print(e.output)
                         print('Exit code:', e.returncode)
                         num_failures += 1
                         execution_time = -1
+                    else:
+                        if args.perf:
+                            num_regressions += check_performance(args, baselines, device,
+                                perf.case_key(demo.full_name, test_case), perf.best_metrics(runs_metrics))
 
                     if args.report_file:
                         collect_result(demo.full_name, device, pipeline, execution_time, args.report_file)
@@ -185,8 +245,12 @@ def main():
         print()
 
     print("Failures: {}".format(num_failures))
+    if args.perf:
+        print("Performance regressions: {}".format(num_regressions))
+    if args.perf_update_baselines:
+        perf.save_baselines(args.perf_baselines, baselines)
 
-    sys.exit(0 if num_failures == 0 else 1)
+    sys.exit(0 if num_failures == 0 and num_regressions == 0 else 1)
 
 if __name__ == main():
     main()
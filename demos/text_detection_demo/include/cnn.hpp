@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <deque>
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -16,11 +18,27 @@ class Cnn {
   public:
     Cnn():is_initialized_(false), channels_(0), input_data_(nullptr), time_elapsed_(0), ncalls_(0) {}
 
+    // A network with max_batch_size > 1 is loaded once more for the batch, both have max_requests requests
     void Init(const std::string &model_path, Core & ie, const std::string & deviceName,
-              const cv::Size &new_input_resolution = cv::Size());
+              const cv::Size &new_input_resolution = cv::Size(), const std::string &cache_dir = "",
+              size_t max_batch_size = 1, size_t max_requests = 1);
 
     InferenceEngine::BlobMap Infer(const cv::Mat &frame);
 
+    // Infer() split to overlap the inference of the frame with other work. The blobs returned by Wait()
+    // are the outputs of the request, so they are valid until the next StartAsync(). time_elapsed()
+    // counts only the time spent in these calls, not the time the request was inferred in the background
+    void StartAsync(const cv::Mat &frame);
+    InferenceEngine::BlobMap Wait();
+
+    // Warps the crops of the BGR image by the affine transforms straight into the inputs and infers them in
+    // batches by several requests at once. The crops of a batch are warped concurrently and converted to
+    // the input channels and precision at the input resolution. The first output of every crop is passed to output_fetcher in
+    // place while the next requests are inferred: the output is the slices of output_dims() along the
+    // dimensions after the batch one and the slices are slice_stride floats apart
+    void InferBatch(const cv::Mat &image, const std::vector<cv::Mat> &transforms,
+                    const std::function<void(size_t crop_idx, const float *output, size_t slice_stride)> &output_fetcher);
+
     bool is_initialized() const {return is_initialized_;}
 
     size_t ncalls() const {return ncalls_;}
@@ -28,13 +46,31 @@ class Cnn {
 
     const cv::Size& input_size() const {return input_size_;}
 
+    // Dimensions of the first output for a single image
+    const SizeVector& output_dims() const {return output_dims_;}
+
   private:
+    struct Requests {
+        Requests(): batch_size(1), output_batch_axis(0) {}
+
+        size_t batch_size;
+        size_t output_batch_axis;
+        std::vector<InferRequest> requests;
+        std::deque<size_t> idle;
+    };
+
+    void WarpToInput(const cv::Mat &source, const cv::Mat &transform, float *input_data) const;
+
     bool is_initialized_;
     cv::Size input_size_;
     int channels_;
     float* input_data_;
     InferRequest infer_request_;
+    std::string input_name_;
     std::vector<std::string> output_names_;
+    SizeVector output_dims_;
+    Requests single_requests_;
+    Requests batch_requests_;  // empty if the batch isn't enabled
 
     double time_elapsed_;
     size_t ncalls_;
@@ -4,8 +4,12 @@
 
 #pragma once
 
+#include <cstddef>
 #include <string>
-#include <vector>
 
-std::string CTCGreedyDecoder(const std::vector<float> &data, const std::string& alphabet, char pad_symbol, double *conf);
-std::string CTCBeamSearchDecoder(const std::vector<float> &data, const std::string& alphabet, char pad_symbol, double *conf, int bandwidth);
+// The decoders read the scores in place, e.g. from an output blob: there are alphabet.length() scores of
+// a timestep and the scores of the next timestep are timestep_stride floats further
+std::string CTCGreedyDecoder(const float *data, size_t timesteps, size_t timestep_stride,
+                             const std::string& alphabet, char pad_symbol, double *conf);
+std::string CTCBeamSearchDecoder(const float *data, size_t timesteps, size_t timestep_stride,
+                                 const std::string& alphabet, char pad_symbol, double *conf, int bandwidth);
@@ -22,7 +22,9 @@
 
 #include <monitors/presenter.h>
 #include <samples/common.hpp>
+#include <samples/frame_prefetcher.hpp>
 #include <samples/slog.hpp>
+#include <samples/async_presenter.hpp>
 
 #include "cnn.hpp"
 #include "image_grabber.hpp"
@@ -37,7 +39,8 @@ using namespace InferenceEngine;
 std::vector<cv::Point2f> floatPointsFromRotatedRect(const cv::RotatedRect &rect);
 std::vector<cv::Point> boundedIntPointsFromRotatedRect(const cv::RotatedRect &rect, const cv::Size& image_size);
 cv::Point topLeftPoint(const std::vector<cv::Point2f> & points, int *idx);
-cv::Mat cropImage(const cv::Mat &image, const std::vector<cv::Point2f> &points, const cv::Size& target_size, int top_left_point_idx);
+cv::Mat cropTransform(const std::vector<cv::Point2f> &points, const cv::Size& target_size, int top_left_point_idx);
+cv::Mat resizeTransform(const cv::Rect &rect, const cv::Size& target_size);
 void setLabel(cv::Mat& im, const std::string& label, const cv::Point & p);
 
 bool ParseAndCheckCommandLine(int argc, char *argv[]) {
@@ -60,6 +63,12 @@ bool ParseAndCheckCommandLine(int argc, char *argv[]) {
     if (FLAGS_dt.empty()) {
         throw std::logic_error("Parameter -dt is not set");
     }
+    if (FLAGS_b_tr == 0) {
+        throw std::logic_error("Parameter -b_tr must be positive");
+    }
+    if (FLAGS_nireq_tr == 0) {
+        throw std::logic_error("Parameter -nireq_tr must be positive");
+    }
 
     return true;
 }
@@ -135,17 +144,25 @@ int main(int argc, char *argv[]) {
         Cnn text_detection, text_recognition;
 
         if (!FLAGS_m_td.empty())
-            text_detection.Init(FLAGS_m_td, ie, FLAGS_d_td, cv::Size(FLAGS_w_td, FLAGS_h_td));
+            text_detection.Init(FLAGS_m_td, ie, FLAGS_d_td, cv::Size(FLAGS_w_td, FLAGS_h_td), FLAGS_cache_dir);
 
         if (!FLAGS_m_tr.empty())
-            text_recognition.Init(FLAGS_m_tr, ie, FLAGS_d_tr);
+            text_recognition.Init(FLAGS_m_tr, ie, FLAGS_d_tr, cv::Size(), FLAGS_cache_dir, FLAGS_b_tr, FLAGS_nireq_tr);
 
         slog::info << "Reading input" << slog::endl;
-        std::unique_ptr<Grabber> grabber = Grabber::make_grabber(FLAGS_dt, FLAGS_i);
+        std::shared_ptr<Grabber> grabber = Grabber::make_grabber(FLAGS_dt, FLAGS_i);
         int wait_time = (FLAGS_dt == "image" || FLAGS_dt == "list") ? 0 : 3;
+        // decodes the next image while the current one is processed
+        FramePrefetcher frameReader(std::unique_ptr<FrameSource>(new FunctionSource([grabber](cv::Mat& frame) {
+            grabber->GrabNextImage(&frame);
+            return !frame.empty();
+        }, FLAGS_dt == "webcam")));
 
         cv::Mat image;
-        grabber->GrabNextImage(&image);
+        frameReader.read(image);
+        if (text_detection.is_initialized() && !image.empty()) {
+            text_detection.StartAsync(image);
+        }
 
         slog::info << "Starting inference" << slog::endl;
 
@@ -157,6 +174,7 @@ int main(int argc, char *argv[]) {
 
         cv::Size graphSize{static_cast<int>(image.cols / 4), 60};
         Presenter presenter(FLAGS_u, image.rows - graphSize.height - 10, graphSize);
+        AsyncPresenter display("Press ESC key to exit", !FLAGS_no_show, &presenter);
 
         while (!image.empty()) {
             cv::Mat demo_image = image.clone();
@@ -165,7 +183,7 @@ int main(int argc, char *argv[]) {
             std::chrono::steady_clock::time_point begin_frame = std::chrono::steady_clock::now();
             std::vector<cv::RotatedRect> rects;
             if (text_detection.is_initialized()) {
-                auto blobs = text_detection.Infer(image);
+                auto blobs = text_detection.Wait();
                 std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
                 rects = postProcess(blobs, orig_image_size, cls_conf_threshold, link_conf_threshold);
                 std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
@@ -174,6 +192,14 @@ int main(int argc, char *argv[]) {
                 rects.emplace_back(cv::Point2f(0.0f, 0.0f), cv::Size2f(0.0f, 0.0f), 0.0f);
             }
 
+            // the next image is detected on its device while the words of this one are recognized,
+            // the blobs of this image are postprocessed already
+            cv::Mat next_image;
+            frameReader.read(next_image);
+            if (text_detection.is_initialized() && !next_image.empty()) {
+                text_detection.StartAsync(next_image);
+            }
+
             if (FLAGS_max_rect_num >= 0 && static_cast<int>(rects.size()) > FLAGS_max_rect_num) {
                 std::sort(rects.begin(), rects.end(), [](const cv::RotatedRect & a, const cv::RotatedRect & b) {
                     return a.size.area() > b.size.area();
@@ -183,16 +209,21 @@ int main(int argc, char *argv[]) {
 
             int num_found = text_recognition.is_initialized() ? 0 : static_cast<int>(rects.size());
 
-            for (const auto &rect : rects) {
-                cv::Mat cropped_text;
-                std::vector<cv::Point2f> points;
-                int top_left_point_idx = 0;
+            std::vector<std::vector<cv::Point2f>> rects_points(rects.size());
+            std::vector<int> top_left_point_idxs(rects.size(), 0);
+            std::vector<cv::Mat> crop_transforms;
+            for (size_t rect_idx = 0; rect_idx < rects.size(); rect_idx++) {
+                const cv::RotatedRect &rect = rects[rect_idx];
+                std::vector<cv::Point2f> &points = rects_points[rect_idx];
+                cv::Mat crop_transform;
 
                 if (rect.size != cv::Size2f(0, 0) && text_detection.is_initialized()) {
                     std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
                     points = floatPointsFromRotatedRect(rect);
-                    topLeftPoint(points, &top_left_point_idx);
-                    cropped_text = cropImage(image, points, text_recognition.input_size(), top_left_point_idx);
+                    topLeftPoint(points, &top_left_point_idxs[rect_idx]);
+                    if (text_recognition.is_initialized()) {
+                        crop_transform = cropTransform(points, text_recognition.input_size(), top_left_point_idxs[rect_idx]);
+                    }
                     std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
                     text_crop_time += std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
                 } else {
@@ -200,39 +231,51 @@ int main(int argc, char *argv[]) {
                         int w = static_cast<int>(image.cols * 0.05);
                         int h = static_cast<int>(w * 0.5);
                         cv::Rect r(static_cast<int>(image.cols * 0.5 - w * 0.5), static_cast<int>(image.rows * 0.5 - h * 0.5), w, h);
-                        cropped_text = image(r).clone();
+                        crop_transform = resizeTransform(r, text_recognition.input_size());
                         cv::rectangle(demo_image, r, cv::Scalar(0, 0, 255), 2);
                         points.emplace_back(r.tl());
                     } else {
-                        cropped_text = image;
+                        crop_transform = resizeTransform(cv::Rect(0, 0, image.cols, image.rows), text_recognition.input_size());
                         points.emplace_back(0.0f, 0.0f);
                         points.emplace_back(static_cast<float>(image.cols - 1), 0.0f);
                         points.emplace_back(static_cast<float>(image.cols - 1), static_cast<float>(image.rows - 1));
                         points.emplace_back(0.0f, static_cast<float>(image.rows - 1));
                     }
                 }
-
-                std::string res = "";
-                double conf = 1.0;
                 if (text_recognition.is_initialized()) {
-                    auto blobs = text_recognition.Infer(cropped_text);
-                    auto output_shape = blobs.begin()->second->getTensorDesc().getDims();
-                    if (output_shape[2] != kAlphabet.length())
-                        throw std::runtime_error("The text recognition model does not correspond to alphabet.");
-
-                    float *output_data_pointer = blobs.begin()->second->buffer().as<PrecisionTrait<Precision::FP32>::value_type *>();
-                    std::vector<float> output_data(output_data_pointer, output_data_pointer + output_shape[0] * output_shape[2]);
+                    crop_transforms.push_back(crop_transform);
+                }
+            }
 
+            // all the words of the image are recognized in batches at once and decoded from the outputs in place
+            std::vector<std::string> words(rects.size());
+            std::vector<double> words_confs(rects.size(), 1.0);
+            if (text_recognition.is_initialized()) {
+                if (text_recognition.output_dims()[2] != kAlphabet.length())
+                    throw std::runtime_error("The text recognition model does not correspond to alphabet.");
+                const size_t timesteps = text_recognition.output_dims()[0];
+                text_recognition.InferBatch(image, crop_transforms,
+                        [&](size_t rect_idx, const float *output_data, size_t timestep_stride) {
                     std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
                     if (decoder_bandwidth == 0) {
-                        res = CTCGreedyDecoder(output_data, kAlphabet, kPadSymbol, &conf);
+                        words[rect_idx] = CTCGreedyDecoder(output_data, timesteps, timestep_stride, kAlphabet, kPadSymbol,
+                                                           &words_confs[rect_idx]);
                     } else {
-                        res = CTCBeamSearchDecoder(output_data, kAlphabet, kPadSymbol, &conf, decoder_bandwidth);
+                        words[rect_idx] = CTCBeamSearchDecoder(output_data, timesteps, timestep_stride, kAlphabet, kPadSymbol,
+                                                               &words_confs[rect_idx], decoder_bandwidth);
                     }
                     std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
                     text_recognition_postproc_time += std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
+                });
+            }
 
-                    res = conf >= min_text_recognition_confidence ? res : "";
+            for (size_t rect_idx = 0; rect_idx < rects.size(); rect_idx++) {
+                const std::vector<cv::Point2f> &points = rects_points[rect_idx];
+                const int top_left_point_idx = top_left_point_idxs[rect_idx];
+
+                std::string res = "";
+                if (text_recognition.is_initialized()) {
+                    res = words_confs[rect_idx] >= min_text_recognition_confidence ? words[rect_idx] : "";
                     num_found += !res.empty() ? 1 : 0;
                 }
 
@@ -274,18 +317,16 @@ int main(int argc, char *argv[]) {
             }
             int fps = static_cast<int>(1000 / avg_time);
 
-            presenter.drawGraphs(demo_image);
-
             if (!FLAGS_no_show) {
                 cv::putText(demo_image, "fps: " + std::to_string(fps) + " found: " + std::to_string(num_found),
                             cv::Point(50, 50), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 255), 1);
-                cv::imshow("Press ESC key to exit", demo_image);
-                char k = cv::waitKey(wait_time);
+                display.show(std::move(demo_image));
+                char k = display.waitKey(wait_time);
                 if (k == 27) break;
-                presenter.handleKey(k);
+                display.handleKey(k);
             }
 
-            grabber->GrabNextImage(&image);
+            image = next_image;
         }
 
         if (text_detection.ncalls() && !FLAGS_r) {
@@ -371,22 +412,24 @@ cv::Point topLeftPoint(const std::vector<cv::Point2f> & points, int *idx) {
     return most_left;
 }
 
-cv::Mat cropImage(const cv::Mat &image, const std::vector<cv::Point2f> &points, const cv::Size& target_size, int top_left_point_idx) {
+cv::Mat cropTransform(const std::vector<cv::Point2f> &points, const cv::Size& target_size, int top_left_point_idx) {
     cv::Point2f point0 = points[static_cast<size_t>(top_left_point_idx)];
     cv::Point2f point1 = points[(top_left_point_idx + 1) % 4];
     cv::Point2f point2 = points[(top_left_point_idx + 2) % 4];
 
-    cv::Mat crop(target_size, CV_8UC3, cv::Scalar(0));
-
     std::vector<cv::Point2f> from{point0, point1, point2};
     std::vector<cv::Point2f> to{cv::Point2f(0.0f, 0.0f), cv::Point2f(static_cast<float>(target_size.width-1), 0.0f),
                                 cv::Point2f(static_cast<float>(target_size.width-1), static_cast<float>(target_size.height-1))};
 
-    cv::Mat M = cv::getAffineTransform(from, to);
-
-    cv::warpAffine(image, crop, M, crop.size());
+    return cv::getAffineTransform(from, to);
+}
 
-    return crop;
+// The transform warping the rect as cv::resize does, the centers of the pixels are aligned
+cv::Mat resizeTransform(const cv::Rect &rect, const cv::Size& target_size) {
+    const double scale_x = static_cast<double>(target_size.width) / rect.width;
+    const double scale_y = static_cast<double>(target_size.height) / rect.height;
+    return (cv::Mat_<double>(2, 3) << scale_x, 0, (0.5 - rect.x) * scale_x - 0.5,
+                                      0, scale_y, (0.5 - rect.y) * scale_y - 0.5);
 }
 
 void setLabel(cv::Mat& im, const std::string& label, const cv::Point & p) {
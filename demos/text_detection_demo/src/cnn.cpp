@@ -4,18 +4,24 @@
 
 #include "cnn.hpp"
 
+#include <algorithm>
 #include <chrono>
 #include <map>
 #include <string>
+#include <vector>
 
 #include <samples/common.hpp>
+#include <samples/mapped_weights.hpp>
+#include <samples/network_cache.hpp>
+#include <samples/slog.hpp>
 
 
-void Cnn::Init(const std::string &model_path, Core & ie, const std::string & deviceName, const cv::Size &new_input_resolution) {
+void Cnn::Init(const std::string &model_path, Core & ie, const std::string & deviceName, const cv::Size &new_input_resolution,
+               const std::string &cache_dir, size_t max_batch_size, size_t max_requests) {
     // ---------------------------------------------------------------------------------------------------
 
     // --------------------------- 1. Reading network ----------------------------------------------------
-    auto network = ie.ReadNetwork(model_path);
+    auto network = readNetworkMapped(ie, model_path);
 
     // --------------------------- Changing input shape if it is needed ----------------------------------
     InputsDataMap inputInfo(network.getInputsInfo());
@@ -54,27 +60,72 @@ void Cnn::Init(const std::string &model_path, Core & ie, const std::string & dev
     for (auto output : output_info) {
         output_names_.emplace_back(output.first);
     }
+    output_dims_ = output_info.begin()->second->getTensorDesc().getDims();
+    // the batch of a single image is the first dimension equal to 1, e.g. the second one of a time-major output
+    single_requests_.output_batch_axis = std::find(output_dims_.begin(), output_dims_.end(), 1) - output_dims_.begin();
+    if (single_requests_.output_batch_axis == output_dims_.size()) {
+        single_requests_.output_batch_axis = 0;
+    }
 
     // ---------------------------------------------------------------------------------------------------
 
     // --------------------------- Loading model to the device -------------------------------------------
-    ExecutableNetwork executable_network = ie.LoadNetwork(network, deviceName);
+    ExecutableNetwork executable_network = loadNetworkCached(ie, network, model_path, deviceName, {}, cache_dir);
     // ---------------------------------------------------------------------------------------------------
 
     // --------------------------- Creating infer request ------------------------------------------------
-    infer_request_ = executable_network.CreateInferRequest();
+    for (size_t i = 0; i < std::max<size_t>(max_requests, 1); i++) {
+        single_requests_.requests.push_back(executable_network.CreateInferRequest());
+        single_requests_.idle.push_back(i);
+    }
+    infer_request_ = single_requests_.requests.front();
     // ---------------------------------------------------------------------------------------------------
 
     // --------------------------- Preparing input -------------------------------------------------------
 
     /* Resize manually and copy data from the image to the input blob */
+    input_name_ = input_name;
     Blob::Ptr input = infer_request_.GetBlob(input_name);
     input_data_ = input->buffer().as<PrecisionTrait<Precision::FP32>::value_type *>();
 
+    // --------------------------- Loading the batched network -------------------------------------------
+    // The outputs of some networks, e.g. the time-major ones of the text recognition, have the batch not
+    // in the first dimension, so the batch is set by reshape instead of the dynamic batch of the devices,
+    // the crops which don't fill a batch are inferred by the single image requests
+    if (max_batch_size > 1) {
+        try {
+            input_dims[0] = max_batch_size;
+            input_shapes[input_name] = input_dims;
+            network.reshape(input_shapes);
+            const SizeVector batch_output_dims = network.getOutputsInfo().begin()->second->getTensorDesc().getDims();
+            for (size_t axis = 0; axis < batch_output_dims.size() && axis < output_dims_.size(); axis++) {
+                if (batch_output_dims[axis] != output_dims_[axis]) {
+                    batch_requests_.output_batch_axis = axis;
+                    break;
+                }
+            }
+            ExecutableNetwork batch_network = loadNetworkCached(ie, network, model_path, deviceName, {}, cache_dir);
+            batch_requests_.batch_size = max_batch_size;
+            for (size_t i = 0; i < std::max<size_t>(max_requests, 1); i++) {
+                batch_requests_.requests.push_back(batch_network.CreateInferRequest());
+                batch_requests_.idle.push_back(i);
+            }
+        } catch (const std::exception &error) {
+            slog::warn << model_path << " can't be inferred in batches of " << max_batch_size << ": " << error.what()
+                       << slog::endl;
+            batch_requests_ = Requests();
+        }
+    }
+
     is_initialized_ = true;
 }
 
 InferenceEngine::BlobMap Cnn::Infer(const cv::Mat &frame) {
+    StartAsync(frame);
+    return Wait();
+}
+
+void Cnn::StartAsync(const cv::Mat &frame) {
     std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
 
     cv::Mat image;
@@ -103,10 +154,19 @@ InferenceEngine::BlobMap Cnn::Infer(const cv::Mat &frame) {
     // ---------------------------------------------------------------------------------------------------
 
     // --------------------------- Doing inference -------------------------------------------------------
-    /* Running the request synchronously */
-    infer_request_.Infer();
+    /* Running the request asynchronously */
+    infer_request_.StartAsync();
     // ---------------------------------------------------------------------------------------------------
 
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    time_elapsed_ += std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count();
+}
+
+InferenceEngine::BlobMap Cnn::Wait() {
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+    infer_request_.Wait(IInferRequest::WaitMode::RESULT_READY);
+
     // --------------------------- Processing output -----------------------------------------------------
 
     InferenceEngine::BlobMap blobs;
@@ -120,3 +180,88 @@ InferenceEngine::BlobMap Cnn::Infer(const cv::Mat &frame) {
 
     return blobs;
 }
+
+void Cnn::InferBatch(const cv::Mat &image, const std::vector<cv::Mat> &transforms,
+                     const std::function<void(size_t crop_idx, const float *output, size_t slice_stride)> &output_fetcher) {
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::duration fetch_time(0);
+
+    struct Started {
+        Requests *requests;
+        size_t request;
+        size_t first_crop;
+    };
+    std::deque<Started> started;
+    size_t next_crop = 0;
+    while (next_crop < transforms.size() || !started.empty()) {
+        // --------------------------- Starting the idle requests ----------------------------------------
+        while (next_crop < transforms.size()) {
+            Requests &requests = !batch_requests_.requests.empty()
+                    && transforms.size() - next_crop >= batch_requests_.batch_size ? batch_requests_ : single_requests_;
+            if (requests.idle.empty())
+                break;
+            const size_t request = requests.idle.front();
+            requests.idle.pop_front();
+            InferRequest &infer_request = requests.requests[request];
+            float *input_data = infer_request.GetBlob(input_name_)->buffer().as<PrecisionTrait<Precision::FP32>::value_type *>();
+            const size_t first_crop = next_crop;
+            const size_t crop_input_size = channels_ * input_size_.area();
+            // the crops of the batch are warped to their own slices of the input concurrently
+            cv::parallel_for_(cv::Range(0, static_cast<int>(requests.batch_size)), [&](const cv::Range &range) {
+                for (int i = range.start; i < range.end; i++) {
+                    WarpToInput(image, transforms[first_crop + i], input_data + i * crop_input_size);
+                }
+            });
+            infer_request.StartAsync();
+            started.push_back({&requests, request, next_crop});
+            next_crop += requests.batch_size;
+        }
+
+        // --------------------------- Processing the oldest request -------------------------------------
+        const Started oldest = started.front();
+        started.pop_front();
+        InferRequest &infer_request = oldest.requests->requests[oldest.request];
+        infer_request.Wait(IInferRequest::WaitMode::RESULT_READY);
+
+        std::chrono::steady_clock::time_point fetch_begin = std::chrono::steady_clock::now();
+        Blob::Ptr output = infer_request.GetBlob(output_names_.front());
+        const SizeVector &dims = output->getTensorDesc().getDims();
+        size_t inner_size = 1;
+        for (size_t axis = oldest.requests->output_batch_axis + 1; axis < dims.size(); axis++) {
+            inner_size *= dims[axis];
+        }
+        const float *output_data = output->buffer().as<PrecisionTrait<Precision::FP32>::value_type *>();
+        const size_t batch_size = oldest.requests->batch_size;
+        for (size_t i = 0; i < batch_size; i++) {
+            output_fetcher(oldest.first_crop + i, output_data + i * inner_size, batch_size * inner_size);
+        }
+        oldest.requests->idle.push_back(oldest.request);
+        fetch_time += std::chrono::steady_clock::now() - fetch_begin;
+    }
+
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    time_elapsed_ += std::chrono::duration_cast<std::chrono::milliseconds>(end - begin - fetch_time).count();
+    ncalls_ += transforms.size();
+}
+
+void Cnn::WarpToInput(const cv::Mat &source, const cv::Mat &transform, float *input_data) const {
+    const int image_size = input_size_.area();
+    // the crop is converted after the warp at the input resolution, so the pixels of the image outside of the
+    // crops are never converted
+    cv::Mat warped;
+    cv::warpAffine(source, warped, transform, input_size_);
+    if (channels_ == 1) {
+        if (warped.channels() == 3) {
+            cv::cvtColor(warped, warped, cv::COLOR_BGR2GRAY);
+        }
+        cv::Mat plane(input_size_, CV_32F, input_data);
+        warped.convertTo(plane, CV_32F);
+    } else {
+        warped.convertTo(warped, CV_32F);
+        std::vector<cv::Mat> planes;
+        for (int ch = 0; ch < channels_; ++ch) {
+            planes.emplace_back(input_size_, CV_32F, input_data + ch * image_size);
+        }
+        cv::split(warped, planes);
+    }
+}
@@ -5,8 +5,8 @@
 #include "text_detection.hpp"
 
 #include <algorithm>
+#include <numeric>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
 namespace {
@@ -72,24 +72,62 @@ std::vector<float> sliceAndGetSecondChannel(const std::vector<float> &data) {
     return new_data;
 }
 
-std::vector<cv::RotatedRect> maskToBoxes(const cv::Mat &mask, float min_area, float min_height,
-                                         cv::Size image_size) {
+// Returns the ranges of the pixels of a line of the image, which the pixels of a line of the mask
+// are resized to by cv::INTER_NEAREST. The range is empty if the image is smaller and skips the pixel
+std::vector<cv::Vec2i> nearestPixelRanges(int mask_length, int image_length) {
+    std::vector<cv::Vec2i> ranges(mask_length, cv::Vec2i(image_length, -1));
+    const double scale = static_cast<double>(mask_length) / image_length;
+    for (int i = 0; i < image_length; i++) {
+        cv::Vec2i& range = ranges[std::min(cvFloor(i * scale), mask_length - 1)];
+        range[0] = std::min(range[0], i);
+        range[1] = std::max(range[1], i);
+    }
+    return ranges;
+}
+
+// The components are boxed as their resized masks are, but in one pass over the labels: the hull of
+// a component is the hull of the blocks of the image pixels the first and the last pixels of its
+// runs in the rows are resized to, so only their corners are passed to cv::minAreaRect
+std::vector<cv::RotatedRect> labelsToBoxes(const std::vector<int> &labels, cv::Size mask_size,
+                                           int components_number, float min_area, float min_height,
+                                           cv::Size image_size) {
+    const std::vector<cv::Vec2i> columns = nearestPixelRanges(mask_size.width, image_size.width);
+    const std::vector<cv::Vec2i> rows = nearestPixelRanges(mask_size.height, image_size.height);
+    auto isResized = [](const cv::Vec2i& range) { return range[0] <= range[1]; };
+
+    std::vector<std::vector<cv::Point>> corners(components_number);
+    for (int y = 0; y < mask_size.height; y++) {
+        if (!isResized(rows[y]))
+            continue;
+        const int* row_labels = labels.data() + y * mask_size.width;
+        for (int x = 0; x < mask_size.width;) {
+            const int label = row_labels[x];
+            int begin = x;
+            int end = x;
+            while (end + 1 < mask_size.width && row_labels[end + 1] == label)
+                end++;
+            x = end + 1;
+            if (label == 0)
+                continue;
+            while (begin <= end && !isResized(columns[begin]))
+                begin++;
+            while (end >= begin && !isResized(columns[end]))
+                end--;
+            if (begin > end)
+                continue;
+            std::vector<cv::Point>& component = corners[label - 1];
+            component.emplace_back(columns[begin][0], rows[y][0]);
+            component.emplace_back(columns[begin][0], rows[y][1]);
+            component.emplace_back(columns[end][1], rows[y][0]);
+            component.emplace_back(columns[end][1], rows[y][1]);
+        }
+    }
+
     std::vector<cv::RotatedRect> bboxes;
-    double min_val;
-    double max_val;
-    cv::minMaxLoc(mask, &min_val, &max_val);
-    int max_bbox_idx = static_cast<int>(max_val);
-    cv::Mat resized_mask;
-    cv::resize(mask, resized_mask, image_size, 0, 0, cv::INTER_NEAREST);
-
-    for (int i = 1; i <= max_bbox_idx; i++) {
-        cv::Mat bbox_mask = resized_mask == i;
-        std::vector<std::vector<cv::Point>> contours;
-
-        cv::findContours(bbox_mask, contours, cv::RETR_CCOMP, cv::CHAIN_APPROX_SIMPLE);
-        if (contours.empty())
+    for (const auto &component : corners) {
+        if (component.empty())
             continue;
-        cv::RotatedRect r = cv::minAreaRect(contours[0]);
+        cv::RotatedRect r = cv::minAreaRect(component);
         if (std::min(r.size.width, r.size.height) < min_height)
             continue;
         if (r.size.area() < min_area)
@@ -98,88 +136,80 @@ std::vector<cv::RotatedRect> maskToBoxes(const cv::Mat &mask, float min_area, fl
     }
 
     return bboxes;
-  }
-
-int findRoot(int point, std::unordered_map<int, int> *group_mask) {
-    int root = point;
-    bool update_parent = false;
-    while (group_mask->at(root) != -1) {
-        root = group_mask->at(root);
-        update_parent = true;
-    }
-    if (update_parent) {
-       (*group_mask)[point] = root;
-    }
-    return root;
 }
 
-void join(int p1, int p2, std::unordered_map<int, int> *group_mask) {
-    int root1 = findRoot(p1, group_mask);
-    int root2 = findRoot(p2, group_mask);
-    if (root1 != root2) {
-        (*group_mask)[root1] = root2;
+int findRoot(int point, std::vector<int> *parents) {
+    auto &rparents = *parents;
+    while (rparents[point] != point) {
+        rparents[point] = rparents[rparents[point]];  // path halving
+        point = rparents[point];
     }
+    return point;
 }
 
-cv::Mat get_all(const std::vector<cv::Point> &points, int w, int h,
-                std::unordered_map<int, int> *group_mask) {
-    std::unordered_map<int, int> root_map;
-
-    cv::Mat mask(h, w, CV_32S, cv::Scalar(0));
-    for (const auto &point : points) {
-        int point_root = findRoot(point.x + point.y * w, group_mask);
-        if (root_map.find(point_root) == root_map.end()) {
-            root_map.emplace(point_root, static_cast<int>(root_map.size() + 1));
-        }
-        mask.at<int>(point.x + point.y * w) = root_map[point_root];
+void join(int p1, int p2, std::vector<int> *parents) {
+    int root1 = findRoot(p1, parents);
+    int root2 = findRoot(p2, parents);
+    if (root1 != root2) {
+        (*parents)[root1] = root2;
     }
-
-    return mask;
 }
 
-cv::Mat decodeImageByJoin(const std::vector<float> &cls_data, const std::vector<int> & cls_data_shape,
-                          const std::vector<float> &link_data, const std::vector<int> & link_data_shape,
-                          float cls_conf_threshold, float link_conf_threshold) {
+// Labels the linked text pixels, the labels of the components start from 1 in the order of their first
+// pixels and the other pixels are 0. Returns the number of the components
+int decodeImageByJoin(const std::vector<float> &cls_data, const std::vector<int> & cls_data_shape,
+                      const std::vector<float> &link_data, const std::vector<int> & link_data_shape,
+                      float cls_conf_threshold, float link_conf_threshold, std::vector<int> *labels) {
     int h = cls_data_shape[1];
     int w = cls_data_shape[2];
 
-    std::vector<uchar> pixel_mask(h * w, 0);
-    std::unordered_map<int, int> group_mask;
-    std::vector<cv::Point> points;
-    for (size_t i = 0; i < pixel_mask.size(); i++) {
-        pixel_mask[i] = cls_data[i] >= cls_conf_threshold;
-        if (pixel_mask[i]) {
-            points.emplace_back(i % w, i / w);
-            group_mask[i] = -1;
-        }
-    }
-
-    std::vector<uchar> link_mask(link_data.size(), 0);
-    for (size_t i = 0; i < link_mask.size(); i++) {
-        link_mask[i] = link_data[i] >= link_conf_threshold;
-    }
-
+    cv::Mat pixel_mask;
+    cv::compare(cv::Mat(1, h * w, CV_32F, const_cast<float*>(cls_data.data())), cls_conf_threshold,
+                pixel_mask, cv::CMP_GE);
+    cv::Mat link_mask;
+    cv::compare(cv::Mat(1, static_cast<int>(link_data.size()), CV_32F, const_cast<float*>(link_data.data())),
+                link_conf_threshold, link_mask, cv::CMP_GE);
+    const uchar* pixels = pixel_mask.ptr<uchar>();
+    const uchar* links = link_mask.ptr<uchar>();
+
+    std::vector<int> parents(h * w);
+    std::iota(parents.begin(), parents.end(), 0);
     size_t neighbours = size_t(link_data_shape[3]);
-    for (const auto &point : points) {
-        size_t neighbour = 0;
-        for (int ny = point.y - 1; ny <= point.y + 1; ny++) {
-            for (int nx = point.x - 1; nx <= point.x + 1; nx++) {
-                if (nx == point.x && ny == point.y)
-                    continue;
-                if (nx >= 0 && nx < w && ny >= 0 && ny < h) {
-                    uchar pixel_value = pixel_mask[size_t(ny) * size_t(w) + size_t(nx)];
-                    uchar link_value = link_mask[
-                        (size_t(point.y) * size_t(w) + size_t(point.x)) * neighbours + neighbour];
-                    if (pixel_value && link_value) {
-                        join(point.x + point.y * w, nx + ny * w, &group_mask);
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            const int point = x + y * w;
+            if (!pixels[point])
+                continue;
+            size_t neighbour = 0;
+            for (int ny = y - 1; ny <= y + 1; ny++) {
+                for (int nx = x - 1; nx <= x + 1; nx++) {
+                    if (nx == x && ny == y)
+                        continue;
+                    if (nx >= 0 && nx < w && ny >= 0 && ny < h) {
+                        if (pixels[nx + ny * w] && links[size_t(point) * neighbours + neighbour]) {
+                            join(point, nx + ny * w, &parents);
+                        }
                     }
+                    neighbour++;
                 }
-                neighbour++;
             }
         }
     }
 
-    return get_all(points, w, h, &group_mask);
+    auto &rlabels = *labels;
+    rlabels.assign(h * w, 0);
+    std::vector<int> root_labels(h * w, 0);
+    int components_number = 0;
+    for (int point = 0; point < h * w; point++) {
+        if (!pixels[point])
+            continue;
+        int &root_label = root_labels[findRoot(point, &parents)];
+        if (root_label == 0) {
+            root_label = ++components_number;
+        }
+        rlabels[point] = root_label;
+    }
+    return components_number;
 }
 }  // namespace
 
@@ -229,9 +259,12 @@ std::vector<cv::RotatedRect> postProcess(const InferenceEngine::BlobMap &blobs,
     new_cls_data_shape[2] = static_cast<int>(cls_shape[3]);
     new_cls_data_shape[3] = static_cast<int>(cls_shape[1]) / 2;
 
-    cv::Mat mask = decodeImageByJoin(cls_data, new_cls_data_shape, link_data, new_link_data_shape, cls_conf_threshold, link_conf_threshold);
-    std::vector<cv::RotatedRect> rects = maskToBoxes(mask, static_cast<float>(kMinArea),
-                                                     static_cast<float>(kMinHeight), image_size);
+    std::vector<int> labels;
+    int components_number = decodeImageByJoin(cls_data, new_cls_data_shape, link_data, new_link_data_shape,
+                                              cls_conf_threshold, link_conf_threshold, &labels);
+    std::vector<cv::RotatedRect> rects = labelsToBoxes(labels, cv::Size(new_cls_data_shape[2], new_cls_data_shape[1]),
+                                                       components_number, static_cast<float>(kMinArea),
+                                                       static_cast<float>(kMinHeight), image_size);
 
     return rects;
 }
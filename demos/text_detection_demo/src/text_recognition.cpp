@@ -5,39 +5,34 @@
 #include "text_recognition.hpp"
 
 #include <algorithm>
-#include <cmath>
+#include <cstdint>
+#include <numeric>
 #include <string>
 #include <vector>
-#include <limits>
-#include <stdexcept>
-#include <numeric>
+
+#include <opencv2/core/hal/hal.hpp>
 
 namespace  {
-    void softmax_and_choose(const std::vector<float>::const_iterator& begin, const std::vector<float>::const_iterator& end, int *argmax, float *prob) {
-        auto max_element = std::max_element(begin, end);
-        *argmax = static_cast<int>(std::distance(begin, max_element));
-        float max_val = *max_element;
-        double sum = 0;
-        for (auto i = begin; i != end; i++) {
-           sum += std::exp((*i) - max_val);
+    // Writes the softmax of the scores to prob and returns the index of the maximal score,
+    // the exponents are computed by the vectorized OpenCV function
+    int softmax(const float *scores, int num_classes, float *prob) {
+        const float *max_score = std::max_element(scores, scores + num_classes);
+        for (int i = 0; i < num_classes; i++) {
+            prob[i] = scores[i] - *max_score;
         }
-        if (std::fabs(sum) < std::numeric_limits<double>::epsilon()) {
-            throw std::logic_error("sum can't be equal to zero");
+        cv::hal::exp32f(prob, prob, num_classes);
+        // the exponent of the maximal score is 1, so the sum isn't zero
+        const float inv_sum = 1.0f / std::accumulate(prob, prob + num_classes, 0.0f);
+        for (int i = 0; i < num_classes; i++) {
+            prob[i] *= inv_sum;
         }
-        *prob = 1.0f / static_cast<float>(sum);
-    }
-
-    std::vector<float> softmax(const std::vector<float>::const_iterator& begin, const std::vector<float>::const_iterator& end) {
-        std::vector<float> prob(end - begin, 0.f);
-        std::transform(begin, end, prob.begin(), [](float x) { return std::exp(x); });
-        float sum = std::accumulate(prob.begin(), prob.end(), 0.0f);
-        for (int i = 0; i < static_cast<int>(prob.size()); i++)
-            prob[i] /= sum;
-        return prob;
+        return static_cast<int>(max_score - scores);
     }
 
     struct BeamElement {
-        std::vector<int> sentence;   //!< The sequence of chars that will be a result of the beam element
+        int node;                    //!< The node of the sequence of chars in PrefixTree, -1 for a new one
+        int parent;                  //!< The node a new sequence extends
+        int symbol;                  //!< The char a new sequence is extended by
         float prob_blank;            //!< The probability that the last char in CTC sequence
                                      //!< for the beam element is the special blank char
         float prob_not_blank;        //!< The probability that the last char in CTC sequence
@@ -47,21 +42,90 @@ namespace  {
             return prob_blank + prob_not_blank;
         }
     };
+
+    // The sequences of chars of the beams as a tree, the node 0 is the empty sequence and the other nodes
+    // extend their parents by a char. The children are found by a hash table with linear probing
+    class PrefixTree {
+    public:
+        void reset(size_t capacity) {
+            parents_.assign(1, -1);
+            symbols_.assign(1, -1);
+            parents_.reserve(capacity);
+            symbols_.reserve(capacity);
+            size_t table_size = 1;
+            while (table_size < 2 * capacity) {
+                table_size <<= 1;
+            }
+            table_.assign(table_size, -1);
+        }
+
+        int size() const {return static_cast<int>(parents_.size());}
+        int parent(int node) const {return parents_[node];}
+        int symbol(int node) const {return symbols_[node];}
+
+        // Returns the child of the node extended by the symbol, -1 if there is no such node
+        int find(int node, int symbol) const {
+            for (size_t slot = Slot(node, symbol); ; slot = (slot + 1) & (table_.size() - 1)) {
+                const int child = table_[slot];
+                if (child == -1 || (parents_[child] == node && symbols_[child] == symbol)) {
+                    return child;
+                }
+            }
+        }
+
+        int add(int node, int symbol) {
+            const int child = size();
+            parents_.push_back(node);
+            symbols_.push_back(symbol);
+            size_t slot = Slot(node, symbol);
+            while (table_[slot] != -1) {
+                slot = (slot + 1) & (table_.size() - 1);
+            }
+            table_[slot] = child;
+            return child;
+        }
+
+    private:
+        size_t Slot(int node, int symbol) const {
+            const uint64_t key = (static_cast<uint64_t>(node) << 16) ^ static_cast<uint64_t>(symbol);
+            return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & (table_.size() - 1);
+        }
+
+        std::vector<int> parents_;
+        std::vector<int> symbols_;
+        std::vector<int> table_;
+    };
+
+    // The buffers of the decoding reused by the calls of a thread, so they allocate only
+    // for the longer sequences and the wider beams
+    struct DecoderState {
+        std::vector<float> prob;
+        PrefixTree prefixes;
+        std::vector<BeamElement> beams;
+        std::vector<BeamElement> candidates;
+        std::vector<int> node_candidates;  // candidate of a beam node at the current timestep, -1 for the others
+        std::vector<int> order;
+    };
+
+    DecoderState& decoderState() {
+        static thread_local DecoderState state;
+        return state;
+    }
 }  // namespace
 
-std::string CTCGreedyDecoder(const std::vector<float> &data, const std::string& alphabet, char pad_symbol, double *conf) {
+std::string CTCGreedyDecoder(const float *data, size_t timesteps, size_t timestep_stride,
+                             const std::string& alphabet, char pad_symbol, double *conf) {
     std::string res = "";
     bool prev_pad = false;
     *conf = 1;
 
-    const int num_classes = alphabet.length();
-    for (std::vector<float>::const_iterator it = data.begin(); it != data.end(); it += num_classes) {
-      int argmax;
-      float prob;
-
-      softmax_and_choose(it, it + num_classes, &argmax, &prob);
+    const int num_classes = static_cast<int>(alphabet.length());
+    std::vector<float> &prob = decoderState().prob;
+    prob.resize(num_classes);
+    for (size_t t = 0; t < timesteps; t++) {
+      int argmax = softmax(data + t * timestep_stride, num_classes, prob.data());
 
-      (*conf) *= prob;
+      (*conf) *= prob[argmax];
 
       auto symbol = alphabet[argmax];
       if (symbol != pad_symbol) {
@@ -76,79 +140,81 @@ std::string CTCGreedyDecoder(const std::vector<float> &data, const std::string&
     return res;
 }
 
-std::string CTCBeamSearchDecoder(const std::vector<float> &data, const std::string& alphabet, char pad_symbol, double *conf, int bandwidth) {
-    const int num_classes = alphabet.length();
-
-    std::vector<BeamElement> curr;
-    std::vector<BeamElement> last;
-
-    last.push_back(BeamElement{std::vector<int>(), 1.f, 0.f});
-
-    for (std::vector<float>::const_iterator it = data.begin(); it != data.end(); it += num_classes) {
-        curr.clear();
-
-        std::vector<float> prob = softmax(it, it + num_classes);
-
-        for(const auto& candidate: last) {
+std::string CTCBeamSearchDecoder(const float *data, size_t timesteps, size_t timestep_stride,
+                                 const std::string& alphabet, char pad_symbol, double *conf, int bandwidth) {
+    const int num_classes = static_cast<int>(alphabet.length());
+    const int blank = num_classes - 1;
+    const size_t beam_width = static_cast<size_t>(std::max(bandwidth, 1));
+
+    DecoderState &state = decoderState();
+    std::vector<float> &prob = state.prob;
+    PrefixTree &prefixes = state.prefixes;
+    std::vector<BeamElement> &beams = state.beams;
+    std::vector<BeamElement> &candidates = state.candidates;
+    std::vector<int> &node_candidates = state.node_candidates;
+    std::vector<int> &order = state.order;
+
+    // every timestep adds at most beam_width nodes
+    const size_t capacity = 1 + timesteps * beam_width;
+    prob.resize(num_classes);
+    prefixes.reset(capacity);
+    node_candidates.assign(capacity, -1);
+    beams.assign(1, BeamElement{0, -1, -1, 1.f, 0.f});
+
+    for (size_t t = 0; t < timesteps; t++) {
+        softmax(data + t * timestep_stride, num_classes, prob.data());
+
+        // the beams keep their sequences
+        candidates.clear();
+        for (const auto& beam : beams) {
             float prob_not_blank = 0.f;
-            const std::vector<int>& candidate_sentence = candidate.sentence;
-            if (!candidate_sentence.empty()) {
-                int n = candidate_sentence.back();
-                prob_not_blank = candidate.prob_not_blank * prob[n];
+            if (beam.node != 0) {
+                prob_not_blank = beam.prob_not_blank * prob[prefixes.symbol(beam.node)];
             }
-            float prob_blank = candidate.prob() * prob[num_classes - 1];
-
-            auto check_res = std::find_if(curr.begin(), curr.end(), [&candidate_sentence](const BeamElement& n) {
-                return n.sentence == candidate_sentence;
-            });
-            if (check_res == std::end(curr)) {
-                curr.push_back(BeamElement{candidate.sentence, prob_blank, prob_not_blank});
-            } else {
-                check_res->prob_not_blank  += prob_not_blank;
-                if (check_res->prob_blank != 0.f) {
-                    throw std::logic_error("Probability that the last char in CTC-sequence is the special blank char must be zero here");
-                }
-                check_res->prob_blank = prob_blank;
-            }
-
-            for (int i = 0; i < num_classes - 1; i++) {
-                auto extend = candidate_sentence;
-                extend.push_back(i);
-
-                if (candidate_sentence.size() > 0 && candidate.sentence.back() == i) {
-                    prob_not_blank = prob[i] * candidate.prob_blank;
-                } else {
-                    prob_not_blank = prob[i] * candidate.prob();
-                }
-                
-                auto check_res = std::find_if(curr.begin(), curr.end(), [&extend](const BeamElement &n) {
-                    return n.sentence == extend;
-                });
+            node_candidates[beam.node] = static_cast<int>(candidates.size());
+            candidates.push_back(BeamElement{beam.node, -1, -1, beam.prob() * prob[blank], prob_not_blank});
+        }
 
-                if (check_res == std::end(curr)) {
-                    curr.push_back(BeamElement{extend, 0.f, prob_not_blank});
+        // the beams are extended by every char, an extension may be another beam's sequence
+        for (const auto& beam : beams) {
+            const int last_symbol = prefixes.symbol(beam.node);
+            for (int i = 0; i < blank; i++) {
+                const float prob_not_blank = prob[i] * (last_symbol == i ? beam.prob_blank : beam.prob());
+                const int node = prefixes.find(beam.node, i);
+                if (node != -1 && node_candidates[node] != -1) {
+                    candidates[node_candidates[node]].prob_not_blank += prob_not_blank;
                 } else {
-                    check_res->prob_not_blank += prob_not_blank;
+                    candidates.push_back(BeamElement{node, beam.node, i, 0.f, prob_not_blank});
                 }
             }
         }
+        for (const auto& beam : beams) {
+            node_candidates[beam.node] = -1;
+        }
 
-        sort(curr.begin(), curr.end(), [](const BeamElement &a, const BeamElement &b) -> bool {
-            return a.prob() > b.prob();
+        const size_t num_to_copy = std::min(beam_width, candidates.size());
+        order.resize(candidates.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::partial_sort(order.begin(), order.begin() + num_to_copy, order.end(), [&candidates](int a, int b) {
+            return candidates[a].prob() > candidates[b].prob();
         });
 
-        last.clear();
-        int num_to_copy = std::min(bandwidth, static_cast<int>(curr.size()));
-        for (int b = 0; b < num_to_copy; b++) {
-            last.push_back(curr[b]);
+        beams.clear();
+        for (size_t b = 0; b < num_to_copy; b++) {
+            BeamElement beam = candidates[order[b]];
+            if (beam.node == -1) {
+                beam.node = prefixes.add(beam.parent, beam.symbol);
+            }
+            beams.push_back(beam);
         }
     }
 
-    *conf = last[0].prob();
-    std::string res="";
-    for (const auto& idx: last[0].sentence) {
-        res += alphabet[idx];
+    *conf = beams[0].prob();
+    std::string res = "";
+    for (int node = beams[0].node; node != 0; node = prefixes.parent(node)) {
+        res += alphabet[prefixes.symbol(node)];
     }
+    std::reverse(res.begin(), res.end());
 
     return res;
 }
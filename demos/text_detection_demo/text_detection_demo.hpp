@@ -43,7 +43,14 @@ static const char input_data_type_message[] = "Required. Input data type: \"imag
                                               "\"video\" (for a saved video), "
                                               "\"webcam\" (for a webcamera device). By default, it is \"image\".";
 static const char utilization_monitors_message[] = "Optional. List of monitors to show initially.";
-static const char decoder_bandwidth_message[] = "Optional. Bandwidth for CTC beam search decoder. Default value is 0, in this case CTC greedy decoder will be used.";
+static const char decoder_bandwidth_message[] = "Optional. Bandwidth for CTC beam search decoder. Default value is 5, 0 - CTC greedy decoder will be used.";
+static const char cache_dir_message[] = "Optional. Directory to cache compiled networks in. Later runs import the cached networks "
+                                        "instead of compiling them if the model, device and config didn't change. "
+                                        "Devices without network export support compile on each run.";
+static const char text_recognition_batch_message[] = "Optional. Number of the words the Text Recognition model infers in one batch. "
+                                                     "The words which don't fill a batch are inferred one by one. Default value is 16.";
+static const char text_recognition_requests_message[] = "Optional. Number of the infer requests of the Text Recognition model "
+                                                        "in flight at once. Default value is 2.";
 
 DEFINE_bool(h, false, help_message);
 DEFINE_string(i, "", input_message);
@@ -65,7 +72,10 @@ DEFINE_string(c, "", custom_gpu_library_message);
 DEFINE_bool(no_show, false, no_show_message);
 DEFINE_bool(r, false, raw_output_message);
 DEFINE_string(u, "", utilization_monitors_message);
-DEFINE_uint32(b, 0, decoder_bandwidth_message);
+DEFINE_uint32(b, 5, decoder_bandwidth_message);
+DEFINE_string(cache_dir, "", cache_dir_message);
+DEFINE_uint32(b_tr, 16, text_recognition_batch_message);
+DEFINE_uint32(nireq_tr, 2, text_recognition_requests_message);
 
 /**
 * @brief This function shows a help message
@@ -96,4 +106,7 @@ static void showUsage() {
     std::cout << "    -r                           " << raw_output_message << std::endl;
     std::cout << "    -u                           " << utilization_monitors_message << std::endl;
     std::cout << "    -b                           " << decoder_bandwidth_message << std::endl;
+    std::cout << "    -cache_dir \"<path>\"          " << cache_dir_message << std::endl;
+    std::cout << "    -b_tr \"<value>\"              " << text_recognition_batch_message << std::endl;
+    std::cout << "    -nireq_tr \"<value>\"          " << text_recognition_requests_message << std::endl;
 }